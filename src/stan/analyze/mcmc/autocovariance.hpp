@@ -7,6 +7,7 @@
 #include <boost/accumulators/statistics/variance.hpp>
 #include <unsupported/Eigen/FFT>
 #include <complex>
+#include <stdexcept>
 #include <vector>
 
 namespace stan {
@@ -61,6 +62,34 @@ void autocorrelation(const Eigen::MatrixBase<DerivedA>& y,
   ac /= ac(0);
 }
 
+/**
+ * Write autocovariance estimates for every lag for the specified
+ * input sequence into the specified result using the specified FFT
+ * engine. Reusing the engine across sequences of the same length
+ * avoids recomputing its twiddle factors.
+ *
+ * @tparam T Scalar type.
+ * @param y Input sequence.
+ * @param acov Autocovariances.
+ * @param fft FFT engine instance.
+ */
+template <typename T, typename DerivedA, typename DerivedB>
+void autocovariance(const Eigen::MatrixBase<DerivedA>& y,
+                    Eigen::MatrixBase<DerivedB>& acov, Eigen::FFT<T>& fft) {
+  autocorrelation(y, acov, fft);
+
+  using boost::accumulators::accumulator_set;
+  using boost::accumulators::stats;
+  using boost::accumulators::tag::variance;
+
+  accumulator_set<double, stats<variance>> acc;
+  for (int n = 0; n < y.size(); ++n) {
+    acc(y(n));
+  }
+
+  acov = acov.array() * boost::accumulators::variance(acc);
+}
+
 /**
  * Write autocovariance estimates for every lag for the specified
  * input sequence into the specified result using the specified FFT
@@ -85,18 +114,7 @@ template <typename T, typename DerivedA, typename DerivedB>
 void autocovariance(const Eigen::MatrixBase<DerivedA>& y,
                     Eigen::MatrixBase<DerivedB>& acov) {
   Eigen::FFT<T> fft;
-  autocorrelation(y, acov, fft);
-
-  using boost::accumulators::accumulator_set;
-  using boost::accumulators::stats;
-  using boost::accumulators::tag::variance;
-
-  accumulator_set<double, stats<variance>> acc;
-  for (int n = 0; n < y.size(); ++n) {
-    acc(y(n));
-  }
-
-  acov = acov.array() * boost::accumulators::variance(acc);
+  autocovariance(y, acov, fft);
 }
 
 /**
@@ -129,6 +147,128 @@ void autocovariance(const std::vector<T>& y, std::vector<T>& acov) {
   autocovariance<T>(y_map, acov_map);
 }
 
+/**
+ * Engine for autocovariance estimates of many sequences, holding an
+ * FFT engine, which keeps its plans for every padded length it has
+ * seen, and the work buffers, which are only reallocated when the
+ * padded length changes. The estimates are those of
+ * <code>autocovariance()</code>, normalized by N, with the variance
+ * taken from the zero-lag term rather than from a separate pass.
+ *
+ * <p>Two sequences of the same length are transformed together, as
+ * the real and imaginary parts of a single complex sequence, which
+ * halves the number of transforms.
+ *
+ * <p>An engine isn't thread safe; use one per thread.
+ *
+ * @tparam T Scalar type.
+ */
+template <typename T>
+class autocovariance_engine {
+ public:
+  /**
+   * Write the autocovariances of a sequence for every lag.
+   *
+   * @param y Input sequence.
+   * @param acov Autocovariances, resized to the length of the input.
+   */
+  template <typename DerivedA, typename DerivedB>
+  void operator()(const Eigen::MatrixBase<DerivedA>& y,
+                  Eigen::MatrixBase<DerivedB>& acov) {
+    size_t N = y.size();
+    resize(N);
+    real_signal_.setZero();
+    real_signal_.head(N) = y.array() - y.mean();
+    fft_.fwd(freq_, real_signal_);
+    freq_ = freq_.cwiseAbs2();
+    fft_.inv(signal_, freq_);
+    acov = signal_.head(N).real() / N;
+  }
+
+  /**
+   * Write the autocovariances of two sequences of the same length for
+   * every lag, with a single forward and inverse transform.
+   *
+   * @param y1 First input sequence.
+   * @param y2 Second input sequence.
+   * @param acov1 Autocovariances of the first sequence.
+   * @param acov2 Autocovariances of the second sequence.
+   * @throw std::invalid_argument If the sequences have different
+   * lengths.
+   */
+  template <typename DerivedA1, typename DerivedA2, typename DerivedB1,
+            typename DerivedB2>
+  void operator()(const Eigen::MatrixBase<DerivedA1>& y1,
+                  const Eigen::MatrixBase<DerivedA2>& y2,
+                  Eigen::MatrixBase<DerivedB1>& acov1,
+                  Eigen::MatrixBase<DerivedB2>& acov2) {
+    if (y1.size() != y2.size())
+      throw std::invalid_argument(
+          "autocovariance_engine: sequences have different lengths");
+    size_t N = y1.size();
+    resize(N);
+    signal_.setZero();
+    signal_.head(N).real() = y1.array() - y1.mean();
+    signal_.head(N).imag() = y2.array() - y2.mean();
+    fft_.fwd(freq_, signal_);
+
+    // With Z the transform of y1 + i y2, the transforms of y1 and y2
+    // are (Z(k) + conj(Z(-k))) / 2 and (Z(k) - conj(Z(-k))) / 2i, and
+    // the inverse transform of |Y1|^2 + i |Y2|^2 has the
+    // autocovariances of y1 and y2 as its real and imaginary parts
+    size_t Mt2 = freq_.size();
+    for (size_t k = 0; k <= Mt2 / 2; ++k) {
+      size_t j = (Mt2 - k) % Mt2;
+      std::complex<T> z_k = freq_(k);
+      std::complex<T> z_j = std::conj(freq_(j));
+      T power1 = std::norm(z_k + z_j) / 4;
+      T power2 = std::norm(z_k - z_j) / 4;
+      freq_(k) = std::complex<T>(power1, power2);
+      freq_(j) = freq_(k);
+    }
+    fft_.inv(signal_, freq_);
+    acov1 = signal_.head(N).real() / N;
+    acov2 = signal_.head(N).imag() / N;
+  }
+
+  /**
+   * Write the autocovariances of each column of a matrix for every
+   * lag, transforming the columns in pairs.
+   *
+   * @param y Input sequences, one per column.
+   * @param acov Autocovariances, resized to the dimensions of the
+   * input, one column per sequence.
+   */
+  template <typename DerivedA>
+  void columns(const Eigen::MatrixBase<DerivedA>& y,
+               Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& acov) {
+    acov.resize(y.rows(), y.cols());
+    Eigen::Index k = 0;
+    for (; k + 1 < y.cols(); k += 2) {
+      auto acov1 = acov.col(k);
+      auto acov2 = acov.col(k + 1);
+      (*this)(y.col(k), y.col(k + 1), acov1, acov2);
+    }
+    if (k < y.cols()) {
+      auto acov1 = acov.col(k);
+      (*this)(y.col(k), acov1);
+    }
+  }
+
+ private:
+  void resize(size_t N) {
+    size_t Mt2 = 2 * math::internal::fft_next_good_size(N);
+    real_signal_.resize(Mt2);
+    signal_.resize(Mt2);
+    freq_.resize(Mt2);
+  }
+
+  Eigen::FFT<T> fft_;
+  Eigen::Matrix<T, Eigen::Dynamic, 1> real_signal_;
+  Eigen::Matrix<std::complex<T>, Eigen::Dynamic, 1> signal_;
+  Eigen::Matrix<std::complex<T>, Eigen::Dynamic, 1> freq_;
+};
+
 }  // namespace analyze
 }  // namespace stan
 
@@ -0,0 +1,194 @@
+#ifndef STAN_ANALYZE_MCMC_COMPUTE_BRIDGE_SAMPLING_HPP
+#define STAN_ANALYZE_MCMC_COMPUTE_BRIDGE_SAMPLING_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Log marginal likelihood estimated by
+ * <code>compute_bridge_sampling()</code>.
+ */
+struct bridge_sampling_estimate {
+  double log_marginal_likelihood;
+  /**
+   * Approximate relative standard error of the marginal likelihood,
+   * the square root of its relative mean squared error.
+   */
+  double relative_error;
+  int iterations;
+  bool converged;
+};
+
+namespace internal {
+
+/**
+ * Return log(exp(a) + exp(b)).
+ */
+inline double log_add_exp(double a, double b) {
+  double m = std::max(a, b);
+  if (m == -std::numeric_limits<double>::infinity())
+    return m;
+  return m + std::log1p(std::exp(-std::abs(a - b)));
+}
+
+/**
+ * Return the log of the mean of exp(x) over the elements of x.
+ */
+inline double log_mean_exp(const Eigen::VectorXd& x) {
+  double m = x.maxCoeff();
+  if (!std::isfinite(m))
+    return m;
+  return m + std::log((x.array() - m).exp().mean());
+}
+
+/**
+ * Return the relative variance of the values, their variance over their
+ * squared mean.
+ */
+inline double relative_variance(const Eigen::VectorXd& x) {
+  double mean = x.mean();
+  return (x.array() - mean).square().sum() / (x.size() - 1) / (mean * mean);
+}
+
+}  // namespace internal
+
+/**
+ * Estimates the log marginal likelihood of a model from the log of its
+ * unnormalized density p and the log density of a normalized proposal
+ * q, each evaluated at draws of the posterior and at draws of the
+ * proposal, by the iterative bridge sampling scheme of Meng and Wong
+ * (1996), "Simulating ratios of normalizing constants via a simple
+ * identity", Statistica Sinica 6(4), with the optimal bridge function,
+ * as described by Gronau et al. (2017), "A tutorial on bridge
+ * sampling", Journal of Mathematical Psychology 81.
+ *
+ * The fixed point iteration starts at the median of the log ratios
+ * p / q of the posterior draws and runs on the log scale until the
+ * relative change of the estimate is below the tolerance.
+ *
+ * The relative error is the approximation of Fruhwirth-Schnatter
+ * (2004), "Estimating marginal likelihoods for mixture and Markov
+ * switching models using bridge sampling techniques", Econometrics
+ * Journal 7(1), with the autocorrelation of the posterior draws
+ * accounted for by their effective sample size; the posterior draws
+ * are taken to be one chain in the order they were drawn.
+ *
+ * Draws where the log density is NaN, such as those where the model
+ * threw, are given a log density of negative infinity.
+ *
+ * @param log_p_posterior log unnormalized density at the posterior
+ *   draws
+ * @param log_q_posterior log proposal density at the posterior draws
+ * @param log_p_proposal log unnormalized density at the proposal draws
+ * @param log_q_proposal log proposal density at the proposal draws
+ * @param tolerance relative change of the estimate at which the
+ *   iteration stops
+ * @param max_iterations largest number of iterations
+ * @return log marginal likelihood, its relative error and the number
+ *   of iterations
+ * @throws std::invalid_argument if there are fewer than two draws of
+ *   either, the sizes of the densities of either don't match, or no
+ *   posterior draw has a finite log ratio
+ */
+inline bridge_sampling_estimate compute_bridge_sampling(
+    const Eigen::VectorXd& log_p_posterior,
+    const Eigen::VectorXd& log_q_posterior,
+    const Eigen::VectorXd& log_p_proposal,
+    const Eigen::VectorXd& log_q_proposal, double tolerance = 1e-10,
+    int max_iterations = 1000) {
+  if (log_p_posterior.size() != log_q_posterior.size()
+      || log_p_proposal.size() != log_q_proposal.size())
+    throw std::invalid_argument(
+        "compute_bridge_sampling: the numbers of densities of the draws "
+        "don't match");
+  if (log_p_posterior.size() < 2 || log_p_proposal.size() < 2)
+    throw std::invalid_argument(
+        "compute_bridge_sampling: fewer than two draws");
+  const double inf = std::numeric_limits<double>::infinity();
+  auto log_ratios = [inf](const Eigen::VectorXd& log_p,
+                          const Eigen::VectorXd& log_q) {
+    Eigen::VectorXd l = log_p - log_q;
+    for (Eigen::Index i = 0; i < l.size(); ++i)
+      if (std::isnan(log_p(i)))
+        l(i) = -inf;
+    return l;
+  };
+  const Eigen::VectorXd l1 = log_ratios(log_p_posterior, log_q_posterior);
+  const Eigen::VectorXd l2 = log_ratios(log_p_proposal, log_q_proposal);
+
+  std::vector<double> finite;
+  for (Eigen::Index i = 0; i < l1.size(); ++i)
+    if (std::isfinite(l1(i)))
+      finite.push_back(l1(i));
+  if (finite.empty())
+    throw std::invalid_argument(
+        "compute_bridge_sampling: no posterior draw has a finite log "
+        "ratio");
+  std::nth_element(finite.begin(), finite.begin() + finite.size() / 2,
+                   finite.end());
+  const double l_star = finite[finite.size() / 2];
+
+  const double n1 = l1.size();
+  const double n2 = l2.size();
+  const double log_s1 = std::log(n1 / (n1 + n2));
+  const double log_s2 = std::log(n2 / (n1 + n2));
+  Eigen::VectorXd numerator(l2.size());
+  Eigen::VectorXd denominator(l1.size());
+  bridge_sampling_estimate result;
+  result.converged = false;
+  double log_r = 0;
+  for (result.iterations = 1; result.iterations <= max_iterations;
+       ++result.iterations) {
+    for (Eigen::Index j = 0; j < l2.size(); ++j) {
+      double a = l2(j) - l_star;
+      numerator(j)
+          = a == -inf ? -inf
+                      : a - internal::log_add_exp(log_s1 + a, log_s2 + log_r);
+    }
+    for (Eigen::Index i = 0; i < l1.size(); ++i)
+      denominator(i) = -internal::log_add_exp(log_s1 + l1(i) - l_star,
+                                              log_s2 + log_r);
+    double log_r_new = internal::log_mean_exp(numerator)
+                       - internal::log_mean_exp(denominator);
+    double change = std::abs(std::expm1(log_r - log_r_new));
+    log_r = log_r_new;
+    if (!(change >= tolerance)) {
+      result.converged = std::isfinite(log_r);
+      break;
+    }
+  }
+  result.iterations = std::min(result.iterations, max_iterations);
+  result.log_marginal_likelihood = log_r + l_star;
+
+  // The bridge function weighted by each density, normalized by the
+  // estimate, at the proposal and posterior draws
+  const double s1 = std::exp(log_s1);
+  const double s2 = std::exp(log_s2);
+  Eigen::VectorXd f1(l2.size());
+  for (Eigen::Index j = 0; j < l2.size(); ++j)
+    f1(j) = 1 / (s1 + s2 * std::exp(result.log_marginal_likelihood - l2(j)));
+  Eigen::VectorXd f2(l1.size());
+  for (Eigen::Index i = 0; i < l1.size(); ++i)
+    f2(i) = 1 / (s1 * std::exp(l1(i) - result.log_marginal_likelihood) + s2);
+  double ess = compute_effective_sample_size({f2.data()},
+                                             {static_cast<size_t>(n1)});
+  if (!(ess > 0) || !std::isfinite(ess))
+    ess = n1;
+  result.relative_error
+      = std::sqrt(internal::relative_variance(f1) / n2
+                  + internal::relative_variance(f2) / ess);
+  return result;
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef STAN_ANALYZE_MCMC_COMPUTE_CONVERGENCE_DIAGNOSTICS_HPP
+#define STAN_ANALYZE_MCMC_COMPUTE_CONVERGENCE_DIAGNOSTICS_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <stan/analyze/mcmc/for_each_parameter.hpp>
+#include <tbb/enumerable_thread_specific.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Split and unsplit convergence diagnostics of a parameter, as
+ * returned by <code>compute_convergence_diagnostics()</code>.
+ */
+struct convergence_diagnostics {
+  double mean;
+  double sd;
+  double rhat;
+  double split_rhat;
+  double ess;
+  double split_ess;
+  /**
+   * Monte Carlo standard error of the mean, the standard deviation
+   * over the square root of the effective sample size.
+   */
+  double mcse;
+  /**
+   * Monte Carlo standard error of the mean, the standard deviation
+   * over the square root of the split effective sample size.
+   */
+  double split_mcse;
+};
+
+namespace internal {
+
+/**
+ * Number of draws, mean and sum of squared deviations from the mean
+ * of a run of draws, with whether the run is constant.
+ */
+struct run_moments {
+  double n;
+  double mean;
+  double m2;
+  double first;
+  bool constant;
+  bool finite;
+};
+
+/**
+ * Return whether two values are equal up to the relative precision of
+ * <code>Eigen::DenseBase::isApproxToConstant()</code>.
+ */
+inline bool is_approx(double x, double y) {
+  return std::fabs(x - y)
+         <= Eigen::NumTraits<double>::dummy_precision()
+                * std::min(std::fabs(x), std::fabs(y));
+}
+
+/**
+ * Return the moments of a run of draws, computed in two passes.
+ *
+ * @param x draws
+ * @param n number of draws, at least one
+ * @return moments of the draws
+ */
+inline run_moments compute_run_moments(const double* x, size_t n) {
+  run_moments run{static_cast<double>(n), 0, 0, x[0], true, true};
+  for (size_t i = 0; i < n; ++i) {
+    run.finite &= std::isfinite(x[i]);
+    run.mean += x[i];
+  }
+  run.mean /= n;
+  for (size_t i = 0; i < n; ++i) {
+    run.m2 += (x[i] - run.mean) * (x[i] - run.mean);
+    run.constant &= is_approx(x[i], run.first);
+  }
+  return run;
+}
+
+/**
+ * Return the moments of two consecutive runs taken together, merged
+ * with the pairwise update of Chan et al.
+ */
+inline run_moments merge_run_moments(const run_moments& a,
+                                     const run_moments& b) {
+  double n = a.n + b.n;
+  double delta = b.mean - a.mean;
+  return {n,
+          a.mean + delta * b.n / n,
+          a.m2 + b.m2 + delta * delta * a.n * b.n / n,
+          a.first,
+          a.constant && b.constant && is_approx(b.first, a.first),
+          a.finite && b.finite};
+}
+
+/**
+ * Return true if the diagnostics of the runs are undefined: a draw
+ * isn't finite, or a run is constant and every run starts at the same
+ * value, as checked by <code>compute_effective_sample_size()</code>
+ * and <code>compute_potential_scale_reduction()</code>.
+ */
+inline bool undefined_diagnostics(const std::vector<run_moments>& runs) {
+  bool any_constant = false;
+  bool same_first = true;
+  for (const run_moments& run : runs) {
+    if (!run.finite)
+      return true;
+    any_constant |= run.constant;
+    same_first &= is_approx(run.first, runs[0].first);
+  }
+  return any_constant && same_first;
+}
+
+}  // namespace internal
+
+/**
+ * Computes the potential scale reduction, effective sample size and
+ * Monte Carlo standard error of the specified parameter across all
+ * kept samples, both for the chains and for the chains split in
+ * halves, together with the mean and standard deviation of the draws.
+ *
+ * Each half chain is read once for its mean and sum of squared
+ * deviations, and the moments of the whole chains and of all of the
+ * draws are merged from those of the halves, so the split and unsplit
+ * diagnostics share every moment. The autocovariances of the two
+ * halves of a chain, and of pairs of whole chains, are each computed
+ * with a single complex FFT. The results agree up to rounding with
+ * <code>compute_potential_scale_reduction()</code>,
+ * <code>compute_split_potential_scale_reduction()</code>,
+ * <code>compute_effective_sample_size()</code> and
+ * <code>compute_split_effective_sample_size()</code> for chains of
+ * equal length.
+ *
+ * Chains are trimmed from the back to the length of the shortest
+ * chain, and when that length N is odd the (N+1)/2th draw is left out
+ * of the split diagnostics. A diagnostic is NaN when there are too few
+ * draws for it, a draw isn't finite, or the draws are constant.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @param engine engine for the autocovariances, which can be reused
+ *   across parameters
+ * @return convergence diagnostics of the parameter
+ */
+inline convergence_diagnostics compute_convergence_diagnostics(
+    std::vector<const double*> draws, std::vector<size_t> sizes,
+    autocovariance_engine<double>& engine) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  convergence_diagnostics result{nan, nan, nan, nan, nan, nan, nan, nan};
+  int num_chains = sizes.size();
+  size_t num_draws = *std::min_element(sizes.begin(), sizes.end());
+  if (num_draws < 2)
+    return result;
+  size_t half = num_draws / 2;
+  size_t second_half = num_draws - half;
+
+  std::vector<internal::run_moments> halves(2 * num_chains);
+  std::vector<internal::run_moments> chains(num_chains);
+  for (int chain = 0; chain < num_chains; ++chain) {
+    const double* x = draws[chain];
+    halves[2 * chain] = internal::compute_run_moments(x, half);
+    halves[2 * chain + 1]
+        = internal::compute_run_moments(x + second_half, half);
+    chains[chain] = halves[2 * chain];
+    if (second_half > half)
+      chains[chain] = internal::merge_run_moments(
+          chains[chain], internal::compute_run_moments(x + half, 1));
+    chains[chain]
+        = internal::merge_run_moments(chains[chain], halves[2 * chain + 1]);
+  }
+
+  internal::run_moments all = chains[0];
+  for (int chain = 1; chain < num_chains; ++chain)
+    all = internal::merge_run_moments(all, chains[chain]);
+  if (!all.finite)
+    return result;
+  result.mean = all.mean;
+  result.sd = std::sqrt(all.m2 / (all.n - 1));
+
+  typedef Eigen::Map<const Eigen::VectorXd> draws_t;
+  Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, 1> acov;
+  Eigen::VectorXd mean;
+  Eigen::VectorXd var;
+
+  if (!internal::undefined_diagnostics(chains)) {
+    mean.resize(num_chains);
+    var.resize(num_chains);
+    for (int chain = 0; chain < num_chains; ++chain) {
+      mean(chain) = chains[chain].mean;
+      var(chain) = chains[chain].m2 / (num_draws - 1.0);
+    }
+    result.rhat = internal::potential_scale_reduction(mean, var, num_draws);
+    if (num_draws >= 4) {
+      acov.resize(num_chains);
+      int chain = 0;
+      for (; chain + 1 < num_chains; chain += 2)
+        engine(draws_t(draws[chain], num_draws),
+               draws_t(draws[chain + 1], num_draws), acov(chain),
+               acov(chain + 1));
+      if (chain < num_chains)
+        engine(draws_t(draws[chain], num_draws), acov(chain));
+      result.ess = internal::effective_sample_size(acov, mean, var, num_draws);
+      result.mcse = result.sd / std::sqrt(result.ess);
+    }
+  }
+
+  if (half >= 2 && !internal::undefined_diagnostics(halves)) {
+    mean.resize(2 * num_chains);
+    var.resize(2 * num_chains);
+    for (int i = 0; i < 2 * num_chains; ++i) {
+      mean(i) = halves[i].mean;
+      var(i) = halves[i].m2 / (half - 1.0);
+    }
+    result.split_rhat = internal::potential_scale_reduction(mean, var, half);
+    if (half >= 4) {
+      acov.resize(2 * num_chains);
+      for (int chain = 0; chain < num_chains; ++chain)
+        engine(draws_t(draws[chain], half),
+               draws_t(draws[chain] + second_half, half), acov(2 * chain),
+               acov(2 * chain + 1));
+      result.split_ess
+          = internal::effective_sample_size(acov, mean, var, half);
+      result.split_mcse = result.sd / std::sqrt(result.split_ess);
+    }
+  }
+  return result;
+}
+
+/**
+ * Computes the split and unsplit convergence diagnostics of the
+ * specified parameter across all kept samples, as for the overload
+ * taking an autocovariance engine.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @return convergence diagnostics of the parameter
+ */
+inline convergence_diagnostics compute_convergence_diagnostics(
+    std::vector<const double*> draws, std::vector<size_t> sizes) {
+  autocovariance_engine<double> engine;
+  return compute_convergence_diagnostics(draws, sizes, engine);
+}
+
+/**
+ * Computes the split and unsplit convergence diagnostics of every
+ * parameter across all kept samples, summarizing the parameters in
+ * parallel on the TBB thread pool. Each worker thread reuses one
+ * autocovariance engine.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return convergence diagnostics of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline std::vector<convergence_diagnostics> compute_convergence_diagnostics(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  tbb::enumerable_thread_specific<autocovariance_engine<double>> engines;
+  return internal::map_parameters<convergence_diagnostics>(
+      chains, [&engines](const std::vector<const double*>& draws,
+                         const std::vector<size_t>& sizes) {
+        return compute_convergence_diagnostics(draws, sizes,
+                                               engines.local());
+      });
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
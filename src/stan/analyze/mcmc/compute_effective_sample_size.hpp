@@ -3,7 +3,9 @@
 
 #include <stan/math/prim/fun/Eigen.hpp>
 #include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/for_each_parameter.hpp>
 #include <stan/analyze/mcmc/split_chains.hpp>
+#include <tbb/enumerable_thread_specific.h>
 #include <algorithm>
 #include <cmath>
 #include <vector>
@@ -11,6 +13,110 @@
 
 namespace stan {
 namespace analyze {
+namespace internal {
+
+/**
+ * Computes the effective sample size from the autocovariances averaged
+ * over the chains, the mean of the chains' variances and the variance of
+ * their means, using Geyer's initial monotone sequence estimator. The
+ * value returned is the minimum of ESS and the number_total_draws *
+ * log10(number_total_draws).
+ *
+ * @tparam F type of callable returning the mean autocovariance at a lag
+ * @param mean_acov mean over the chains of the autocovariance at a lag,
+ *   for lags up to <code>num_draws - 1</code>
+ * @param mean_var mean of the unbiased variances of the chains
+ * @param var_chain_mean unbiased variance of the chain means, zero for a
+ *   single chain
+ * @param num_chains number of chains
+ * @param num_draws number of draws of each chain, at least four
+ * @return effective sample size
+ */
+template <typename F>
+inline double effective_sample_size_from_moments(const F& mean_acov,
+                                                 double mean_var,
+                                                 double var_chain_mean,
+                                                 int num_chains,
+                                                 size_t num_draws) {
+  double var_plus = mean_var * (num_draws - 1) / num_draws + var_chain_mean;
+  Eigen::VectorXd rho_hat_s(num_draws);
+  rho_hat_s.setZero();
+  double rho_hat_even = 1.0;
+  rho_hat_s(0) = rho_hat_even;
+  double rho_hat_odd = 1 - (mean_var - mean_acov(1)) / var_plus;
+  rho_hat_s(1) = rho_hat_odd;
+
+  // Convert raw autocovariance estimators into Geyer's initial
+  // positive sequence. Loop only until num_draws - 4 to
+  // leave the last pair of autocorrelations as a bias term that
+  // reduces variance in the case of antithetical chains.
+  size_t s = 1;
+  while (s < (num_draws - 4) && (rho_hat_even + rho_hat_odd) > 0) {
+    rho_hat_even = 1 - (mean_var - mean_acov(s + 1)) / var_plus;
+    rho_hat_odd = 1 - (mean_var - mean_acov(s + 2)) / var_plus;
+    if ((rho_hat_even + rho_hat_odd) >= 0) {
+      rho_hat_s(s + 1) = rho_hat_even;
+      rho_hat_s(s + 2) = rho_hat_odd;
+    }
+    s += 2;
+  }
+
+  int max_s = s;
+  // this is used in the improved estimate, which reduces variance
+  // in antithetic case -- see tau_hat below
+  if (rho_hat_even > 0)
+    rho_hat_s(max_s + 1) = rho_hat_even;
+
+  // Convert Geyer's initial positive sequence into an initial
+  // monotone sequence
+  for (int s = 1; s <= max_s - 3; s += 2) {
+    if (rho_hat_s(s + 1) + rho_hat_s(s + 2) > rho_hat_s(s - 1) + rho_hat_s(s)) {
+      rho_hat_s(s + 1) = (rho_hat_s(s - 1) + rho_hat_s(s)) / 2;
+      rho_hat_s(s + 2) = rho_hat_s(s + 1);
+    }
+  }
+
+  double num_total_draws = num_chains * num_draws;
+  // Geyer's truncated estimator for the asymptotic variance
+  // Improved estimate reduces variance in antithetic case
+  double tau_hat = -1 + 2 * rho_hat_s.head(max_s).sum() + rho_hat_s(max_s + 1);
+  return std::min(num_total_draws / tau_hat,
+                  num_total_draws * std::log10(num_total_draws));
+}
+
+/**
+ * Computes the effective sample size from the autocovariances, means
+ * and variances of the chains, using Geyer's initial monotone sequence
+ * estimator. The value returned is the minimum of ESS and the
+ * number_total_draws * log10(number_total_draws).
+ *
+ * @param acov autocovariances of each chain, as returned by
+ *   <code>autocovariance_engine</code>, of at least
+ *   <code>num_draws</code> lags
+ * @param chain_mean mean of each chain
+ * @param chain_var unbiased variance of each chain
+ * @param num_draws number of draws of each chain, at least four
+ * @return effective sample size
+ */
+inline double effective_sample_size(
+    const Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, 1>& acov,
+    const Eigen::VectorXd& chain_mean, const Eigen::VectorXd& chain_var,
+    size_t num_draws) {
+  int num_chains = chain_mean.size();
+  Eigen::VectorXd acov_s(num_chains);
+  auto mean_acov = [&acov, &acov_s, num_chains](size_t s) {
+    for (int chain = 0; chain < num_chains; ++chain)
+      acov_s(chain) = acov(chain)(s);
+    return acov_s.mean();
+  };
+  return effective_sample_size_from_moments(
+      mean_acov, chain_var.mean(),
+      num_chains > 1 ? math::variance(chain_mean) : 0.0, num_chains,
+      num_draws);
+}
+
+}  // namespace internal
+
 /**
  * Computes the effective sample size (ESS) for the specified
  * parameter across all kept samples.  The value returned is the
@@ -27,10 +133,13 @@ namespace analyze {
  *
  * @param draws stores pointers to arrays of chains
  * @param sizes stores sizes of chains
+ * @param engine engine for the autocovariances, which can be reused
+ *   across parameters
  * @return effective sample size for the specified parameter
  */
-inline double compute_effective_sample_size(std::vector<const double*> draws,
-                                            std::vector<size_t> sizes) {
+inline double compute_effective_sample_size(
+    std::vector<const double*> draws, std::vector<size_t> sizes,
+    autocovariance_engine<double>& engine) {
   int num_chains = sizes.size();
   size_t num_draws = sizes[0];
   for (int chain = 1; chain < num_chains; ++chain) {
@@ -70,71 +179,55 @@ inline double compute_effective_sample_size(std::vector<const double*> draws,
     }
   }
 
+  typedef Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>> draws_t;
   Eigen::Matrix<Eigen::VectorXd, Eigen::Dynamic, 1> acov(num_chains);
+  int chain = 0;
+  for (; chain + 1 < num_chains; chain += 2) {
+    draws_t draw1(draws[chain], sizes[chain]);
+    draws_t draw2(draws[chain + 1], sizes[chain + 1]);
+    if (sizes[chain] == sizes[chain + 1]) {
+      engine(draw1, draw2, acov(chain), acov(chain + 1));
+    } else {
+      engine(draw1, acov(chain));
+      engine(draw2, acov(chain + 1));
+    }
+  }
+  if (chain < num_chains)
+    engine(draws_t(draws[chain], sizes[chain]), acov(chain));
+
   Eigen::VectorXd chain_mean(num_chains);
   Eigen::VectorXd chain_var(num_chains);
   for (int chain = 0; chain < num_chains; ++chain) {
-    Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>> draw(
-        draws[chain], sizes[chain]);
-    autocovariance<double>(draw, acov(chain));
+    draws_t draw(draws[chain], sizes[chain]);
     chain_mean(chain) = draw.mean();
     chain_var(chain) = acov(chain)(0) * num_draws / (num_draws - 1);
   }
+  return internal::effective_sample_size(acov, chain_mean, chain_var,
+                                         num_draws);
+}
 
-  double mean_var = chain_var.mean();
-  double var_plus = mean_var * (num_draws - 1) / num_draws;
-  if (num_chains > 1)
-    var_plus += math::variance(chain_mean);
-  Eigen::VectorXd rho_hat_s(num_draws);
-  rho_hat_s.setZero();
-  Eigen::VectorXd acov_s(num_chains);
-  for (int chain = 0; chain < num_chains; ++chain)
-    acov_s(chain) = acov(chain)(1);
-  double rho_hat_even = 1.0;
-  rho_hat_s(0) = rho_hat_even;
-  double rho_hat_odd = 1 - (mean_var - acov_s.mean()) / var_plus;
-  rho_hat_s(1) = rho_hat_odd;
-
-  // Convert raw autocovariance estimators into Geyer's initial
-  // positive sequence. Loop only until num_draws - 4 to
-  // leave the last pair of autocorrelations as a bias term that
-  // reduces variance in the case of antithetical chains.
-  size_t s = 1;
-  while (s < (num_draws - 4) && (rho_hat_even + rho_hat_odd) > 0) {
-    for (int chain = 0; chain < num_chains; ++chain)
-      acov_s(chain) = acov(chain)(s + 1);
-    rho_hat_even = 1 - (mean_var - acov_s.mean()) / var_plus;
-    for (int chain = 0; chain < num_chains; ++chain)
-      acov_s(chain) = acov(chain)(s + 2);
-    rho_hat_odd = 1 - (mean_var - acov_s.mean()) / var_plus;
-    if ((rho_hat_even + rho_hat_odd) >= 0) {
-      rho_hat_s(s + 1) = rho_hat_even;
-      rho_hat_s(s + 2) = rho_hat_odd;
-    }
-    s += 2;
-  }
-
-  int max_s = s;
-  // this is used in the improved estimate, which reduces variance
-  // in antithetic case -- see tau_hat below
-  if (rho_hat_even > 0)
-    rho_hat_s(max_s + 1) = rho_hat_even;
-
-  // Convert Geyer's initial positive sequence into an initial
-  // monotone sequence
-  for (int s = 1; s <= max_s - 3; s += 2) {
-    if (rho_hat_s(s + 1) + rho_hat_s(s + 2) > rho_hat_s(s - 1) + rho_hat_s(s)) {
-      rho_hat_s(s + 1) = (rho_hat_s(s - 1) + rho_hat_s(s)) / 2;
-      rho_hat_s(s + 2) = rho_hat_s(s + 1);
-    }
-  }
-
-  double num_total_draws = num_chains * num_draws;
-  // Geyer's truncated estimator for the asymptotic variance
-  // Improved estimate reduces variance in antithetic case
-  double tau_hat = -1 + 2 * rho_hat_s.head(max_s).sum() + rho_hat_s(max_s + 1);
-  return std::min(num_total_draws / tau_hat,
-                  num_total_draws * std::log10(num_total_draws));
+/**
+ * Computes the effective sample size (ESS) for the specified
+ * parameter across all kept samples.  The value returned is the
+ * minimum of ESS and the number_total_draws *
+ * log10(number_total_draws).
+ *
+ * See more details in Stan reference manual section "Effective
+ * Sample Size". http://mc-stan.org/users/documentation
+ *
+ * Current implementation assumes draws are stored in contiguous
+ * blocks of memory.  Chains are trimmed from the back to match the
+ * length of the shortest chain.  Note that the effective sample size
+ * can not be estimated with less than four draws.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @return effective sample size for the specified parameter
+ */
+inline double compute_effective_sample_size(std::vector<const double*> draws,
+                                            std::vector<size_t> sizes) {
+  autocovariance_engine<double> engine;
+  return compute_effective_sample_size(draws, sizes, engine);
 }
 
 /**
@@ -180,10 +273,13 @@ inline double compute_effective_sample_size(std::vector<const double*> draws,
  *
  * @param draws stores pointers to arrays of chains
  * @param sizes stores sizes of chains
+ * @param engine engine for the autocovariances, which can be reused
+ *   across parameters
  * @return effective sample size for the specified parameter
  */
 inline double compute_split_effective_sample_size(
-    std::vector<const double*> draws, std::vector<size_t> sizes) {
+    std::vector<const double*> draws, std::vector<size_t> sizes,
+    autocovariance_engine<double>& engine) {
   int num_chains = sizes.size();
   size_t num_draws = sizes[0];
   for (int chain = 1; chain < num_chains; ++chain) {
@@ -195,7 +291,32 @@ inline double compute_split_effective_sample_size(
   double half = num_draws / 2.0;
   std::vector<size_t> half_sizes(2 * num_chains, std::floor(half));
 
-  return compute_effective_sample_size(split_draws, half_sizes);
+  return compute_effective_sample_size(split_draws, half_sizes, engine);
+}
+
+/**
+ * Computes the split effective sample size (ESS) for the specified
+ * parameter across all kept samples.  The value returned is the
+ * minimum of ESS and the number_total_draws *
+ * log10(number_total_draws). When the number of total draws N is
+ * odd, the (N+1)/2th draw is ignored.
+ *
+ * See more details in Stan reference manual section "Effective
+ * Sample Size". http://mc-stan.org/users/documentation
+ *
+ * Current implementation assumes draws are stored in contiguous
+ * blocks of memory.  Chains are trimmed from the back to match the
+ * length of the shortest chain.  Note that the effective sample size
+ * can not be estimated with less than four draws.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @return effective sample size for the specified parameter
+ */
+inline double compute_split_effective_sample_size(
+    std::vector<const double*> draws, std::vector<size_t> sizes) {
+  autocovariance_engine<double> engine;
+  return compute_split_effective_sample_size(draws, sizes, engine);
 }
 
 /**
@@ -225,6 +346,52 @@ inline double compute_split_effective_sample_size(
   return compute_split_effective_sample_size(draws, sizes);
 }
 
+/**
+ * Computes the effective sample size (ESS) of every parameter across
+ * all kept samples, summarizing the parameters in parallel on the TBB
+ * thread pool. Each worker thread reuses one autocovariance engine, so
+ * its FFT plans and buffers are only built once per chain length.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return effective sample size of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline Eigen::VectorXd compute_effective_sample_size(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  tbb::enumerable_thread_specific<autocovariance_engine<double>> engines;
+  return internal::for_each_parameter(
+      chains, [&engines](const std::vector<const double*>& draws,
+                         const std::vector<size_t>& sizes) {
+        return compute_effective_sample_size(draws, sizes, engines.local());
+      });
+}
+
+/**
+ * Computes the split effective sample size (ESS) of every parameter
+ * across all kept samples, summarizing the parameters in parallel on
+ * the TBB thread pool. Each worker thread reuses one autocovariance
+ * engine, so its FFT plans and buffers are only built once per chain
+ * length.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return split effective sample size of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline Eigen::VectorXd compute_split_effective_sample_size(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  tbb::enumerable_thread_specific<autocovariance_engine<double>> engines;
+  return internal::for_each_parameter(
+      chains, [&engines](const std::vector<const double*>& draws,
+                         const std::vector<size_t>& sizes) {
+        return compute_split_effective_sample_size(draws, sizes,
+                                                   engines.local());
+      });
+}
+
 }  // namespace analyze
 }  // namespace stan
 
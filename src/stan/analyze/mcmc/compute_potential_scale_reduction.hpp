@@ -3,6 +3,7 @@
 
 #include <stan/math/prim.hpp>
 #include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/for_each_parameter.hpp>
 #include <stan/analyze/mcmc/split_chains.hpp>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
@@ -15,6 +16,54 @@
 
 namespace stan {
 namespace analyze {
+namespace internal {
+
+/**
+ * Computes the potential scale reduction (Rhat) from the variance of
+ * the chain means and the mean of the chain variances.
+ *
+ * @param var_chain_mean unbiased variance of the chain means
+ * @param mean_var mean of the unbiased variances of the chains
+ * @param num_draws number of draws of each chain
+ * @return potential scale reduction
+ */
+inline double potential_scale_reduction_from_moments(double var_chain_mean,
+                                                     double mean_var,
+                                                     size_t num_draws) {
+  double var_between = num_draws * var_chain_mean;
+  double var_within = mean_var;
+
+  // rewrote [(n-1)*W/n + B/n]/W as (n-1+ B/W)/n
+  return sqrt((var_between / var_within + num_draws - 1) / num_draws);
+}
+
+/**
+ * Computes the potential scale reduction (Rhat) from the means and
+ * variances of the chains.
+ *
+ * @param chain_mean mean of each chain
+ * @param chain_var unbiased variance of each chain
+ * @param num_draws number of draws of each chain
+ * @return potential scale reduction
+ */
+inline double potential_scale_reduction(const Eigen::VectorXd& chain_mean,
+                                        const Eigen::VectorXd& chain_var,
+                                        size_t num_draws) {
+  int num_chains = chain_mean.size();
+  boost::accumulators::accumulator_set<
+      double, boost::accumulators::stats<boost::accumulators::tag::variance>>
+      acc_chain_mean;
+  for (int chain = 0; chain < num_chains; ++chain)
+    acc_chain_mean(chain_mean(chain));
+
+  return potential_scale_reduction_from_moments(
+      boost::accumulators::variance(acc_chain_mean) * num_chains
+          / (num_chains - 1),
+      chain_var.mean(), num_draws);
+}
+
+}  // namespace internal
+
 
 /**
  * Computes the potential scale reduction (Rhat) for the specified
@@ -74,7 +123,6 @@ inline double compute_potential_scale_reduction(
   using boost::accumulators::tag::variance;
 
   Eigen::VectorXd chain_mean(num_chains);
-  accumulator_set<double, stats<variance>> acc_chain_mean;
   Eigen::VectorXd chain_var(num_chains);
   double unbiased_var_scale = num_draws / (num_draws - 1.0);
 
@@ -85,17 +133,12 @@ inline double compute_potential_scale_reduction(
     }
 
     chain_mean(chain) = boost::accumulators::mean(acc_draw);
-    acc_chain_mean(chain_mean(chain));
     chain_var(chain)
         = boost::accumulators::variance(acc_draw) * unbiased_var_scale;
   }
 
-  double var_between = num_draws * boost::accumulators::variance(acc_chain_mean)
-                       * num_chains / (num_chains - 1);
-  double var_within = chain_var.mean();
-
-  // rewrote [(n-1)*W/n + B/n]/W as (n-1+ B/W)/n
-  return sqrt((var_between / var_within + num_draws - 1) / num_draws);
+  return internal::potential_scale_reduction(chain_mean, chain_var,
+                                             num_draws);
 }
 
 /**
@@ -177,6 +220,46 @@ inline double compute_split_potential_scale_reduction(
   return compute_split_potential_scale_reduction(draws, sizes);
 }
 
+/**
+ * Computes the potential scale reduction (Rhat) of every parameter
+ * across all kept samples, summarizing the parameters in parallel on
+ * the TBB thread pool.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return potential scale reduction of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline Eigen::VectorXd compute_potential_scale_reduction(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  return internal::for_each_parameter(
+      chains, [](const std::vector<const double*>& draws,
+                 const std::vector<size_t>& sizes) {
+        return compute_potential_scale_reduction(draws, sizes);
+      });
+}
+
+/**
+ * Computes the split potential scale reduction (Rhat) of every
+ * parameter across all kept samples, summarizing the parameters in
+ * parallel on the TBB thread pool.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return split potential scale reduction of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline Eigen::VectorXd compute_split_potential_scale_reduction(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  return internal::for_each_parameter(
+      chains, [](const std::vector<const double*>& draws,
+                 const std::vector<size_t>& sizes) {
+        return compute_split_potential_scale_reduction(draws, sizes);
+      });
+}
+
 }  // namespace analyze
 }  // namespace stan
 
@@ -0,0 +1,418 @@
+#ifndef STAN_ANALYZE_MCMC_COMPUTE_PSIS_LOO_HPP
+#define STAN_ANALYZE_MCMC_COMPUTE_PSIS_LOO_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/for_each_parameter.hpp>
+#include <stan/analyze/mcmc/summarize_in_blocks.hpp>
+#include <stan/util/deterministic_reduce.hpp>
+#include <tbb/enumerable_thread_specific.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Shape and scale of a generalized Pareto distribution with location
+ * zero, as estimated by <code>fit_generalized_pareto()</code>.
+ */
+struct generalized_pareto {
+  double k;
+  double sigma;
+};
+
+/**
+ * Leave-one-out contribution of an observation, as computed by
+ * <code>compute_psis_loo()</code>.
+ */
+struct psis_loo_pointwise {
+  /**
+   * Expected log predictive density of the observation given the
+   * others.
+   */
+  double elpd_loo;
+  /**
+   * Log predictive density of the observation given all observations
+   * less its leave-one-out estimate.
+   */
+  double p_loo;
+  /**
+   * Estimated shape of the tail of the importance ratios. Estimates
+   * above <code>psis_loo::k_threshold</code> mean the leave-one-out
+   * estimate is unreliable, and infinity means there were too few or
+   * only equal draws in the tail to fit it.
+   */
+  double pareto_k;
+};
+
+/**
+ * Pareto smoothed importance sampling leave-one-out cross-validation
+ * of a model, as described by Vehtari et al. (2024), "Pareto smoothed
+ * importance sampling", Journal of Machine Learning Research 25(72),
+ * and Vehtari, Gelman and Gabry (2017), "Practical Bayesian model
+ * evaluation using leave-one-out cross-validation and WAIC",
+ * Statistics and Computing 27(5).
+ */
+struct psis_loo {
+  double elpd_loo;
+  double se_elpd_loo;
+  double p_loo;
+  double se_p_loo;
+  /**
+   * Largest Pareto k for which the estimate of an observation is
+   * reliable with this many draws, <code>min(1 - 1 / log10(S),
+   * 0.7)</code>.
+   */
+  double k_threshold;
+  /**
+   * Number of observations whose Pareto k is above the threshold.
+   */
+  int num_high_k;
+  std::vector<psis_loo_pointwise> pointwise;
+};
+
+namespace internal {
+
+inline double log_sum_exp(const double* x, size_t n) {
+  double max = *std::max_element(x, x + n);
+  if (!std::isfinite(max))
+    return max;
+  double sum = 0;
+  for (size_t i = 0; i < n; ++i)
+    sum += std::exp(x[i] - max);
+  return max + std::log(sum);
+}
+
+/**
+ * Return the quantile of a generalized Pareto distribution with
+ * location zero.
+ */
+inline double generalized_pareto_quantile(double p, double k,
+                                          double sigma) {
+  if (k == 0)
+    return -sigma * std::log1p(-p);
+  return sigma * std::expm1(-k * std::log1p(-p)) / k;
+}
+
+/**
+ * Return the sum of values and the standard error of the sum, summed
+ * in parallel with a result that doesn't depend on the number of
+ * threads.
+ */
+inline void sum_and_se(const std::vector<double>& x, double& sum,
+                       double& se) {
+  double n = x.size();
+  sum = stan::util::deterministic_sum(x);
+  double mean = sum / n;
+  double m2 = stan::util::deterministic_reduce(
+      x.size(), stan::util::deterministic_sum_chunk_size, 0.0,
+      [&x, mean](size_t begin, size_t end) {
+        double m2 = 0;
+        for (size_t i = begin; i < end; ++i)
+          m2 += (x[i] - mean) * (x[i] - mean);
+        return m2;
+      },
+      [](double left, double right) { return left + right; });
+  se = n > 1 ? std::sqrt(n * m2 / (n - 1)) : 0;
+}
+
+}  // namespace internal
+
+/**
+ * Fits a generalized Pareto distribution with location zero to
+ * positive values, with the empirical Bayes estimate of Zhang and
+ * Stephens (2009), "A new and efficient estimation method for the
+ * generalized Pareto distribution", Technometrics 51(3), and the shape
+ * shrunk towards 0.5 by a weakly informative prior worth ten draws.
+ *
+ * @param x values in increasing order
+ * @return estimated shape and scale, with an infinite shape if the
+ *   estimate isn't a number
+ * @throws std::invalid_argument if there are no values
+ */
+inline generalized_pareto fit_generalized_pareto(
+    const std::vector<double>& x) {
+  if (x.empty())
+    throw std::invalid_argument("fit_generalized_pareto: no values");
+  const double prior = 3;
+  double n = x.size();
+  int m = 30 + static_cast<int>(std::sqrt(n));
+  double xstar = x[static_cast<size_t>(std::floor(n / 4 + 0.5)) - 1];
+  auto mean_log1p = [&x, n](double theta) {
+    double sum = 0;
+    for (double v : x)
+      sum += std::log1p(-theta * v);
+    return sum / n;
+  };
+
+  std::vector<double> theta(m);
+  std::vector<double> log_lik(m);
+  for (int j = 0; j < m; ++j) {
+    theta[j] = 1 / x.back() + (1 - std::sqrt(m / (j + 0.5))) / prior / xstar;
+    double k = mean_log1p(theta[j]);
+    log_lik[j] = n * (std::log(-theta[j] / k) - k - 1);
+  }
+  double log_norm = internal::log_sum_exp(log_lik.data(), m);
+  double theta_hat = 0;
+  for (int j = 0; j < m; ++j)
+    theta_hat += theta[j] * std::exp(log_lik[j] - log_norm);
+
+  double k = mean_log1p(theta_hat);
+  double sigma = -k / theta_hat;
+  k = (k * n + 10 * 0.5) / (n + 10);
+  if (std::isnan(k))
+    k = std::numeric_limits<double>::infinity();
+  return {k, sigma};
+}
+
+/**
+ * Return the number of largest importance ratios whose tail is fitted,
+ * <code>ceil(min(S / 5, 3 sqrt(S / r_eff)))</code>.
+ *
+ * @param num_draws number of draws S
+ * @param r_eff relative efficiency of the draws
+ * @return number of draws in the tail
+ */
+inline size_t psis_tail_length(size_t num_draws, double r_eff = 1) {
+  return std::ceil(
+      std::min(0.2 * num_draws, 3 * std::sqrt(num_draws / r_eff)));
+}
+
+/**
+ * Pareto smooths importance ratios. The largest ratios are replaced by
+ * the expected order statistics of a generalized Pareto distribution
+ * fitted to them, the weights are truncated at the largest raw ratio,
+ * and the log weights are normalized to sum to one.
+ *
+ * Only the tail is sorted, after a linear time selection of its
+ * cutoff.
+ *
+ * @param[in, out] log_weights log importance ratios on input, smoothed
+ *   and normalized log weights on output
+ * @param r_eff relative efficiency of the draws
+ * @return estimated Pareto shape k of the tail, which is infinite if
+ *   the tail has fewer than five draws or all of its draws are equal
+ * @throws std::invalid_argument if there are no ratios
+ */
+inline double compute_psis(Eigen::VectorXd& log_weights, double r_eff = 1) {
+  size_t S = log_weights.size();
+  if (S == 0)
+    throw std::invalid_argument("compute_psis: no log ratios");
+  log_weights.array() -= log_weights.maxCoeff();
+  double k = std::numeric_limits<double>::infinity();
+
+  size_t M = psis_tail_length(S, r_eff);
+  if (M >= 5 && M < S) {
+    std::vector<int> order(S);
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&log_weights](int a, int b) {
+      return log_weights(a) < log_weights(b);
+    };
+    auto tail = order.end() - M;
+    std::nth_element(order.begin(), tail - 1, order.end(), less);
+    std::sort(tail, order.end(), less);
+    double cutoff = log_weights(*(tail - 1));
+    if (log_weights(order.back()) - log_weights(*tail)
+        >= std::numeric_limits<double>::epsilon() / 100) {
+      double exp_cutoff = std::exp(cutoff);
+      std::vector<double> exceedances(M);
+      for (size_t i = 0; i < M; ++i)
+        exceedances[i] = std::exp(log_weights(tail[i])) - exp_cutoff;
+      generalized_pareto fit = fit_generalized_pareto(exceedances);
+      k = fit.k;
+      if (std::isfinite(k))
+        for (size_t i = 0; i < M; ++i)
+          log_weights(tail[i]) = std::log(
+              internal::generalized_pareto_quantile((i + 0.5) / M, k,
+                                                    fit.sigma)
+              + exp_cutoff);
+    }
+  }
+
+  log_weights = log_weights.array().min(0);
+  log_weights.array()
+      -= internal::log_sum_exp(log_weights.data(), log_weights.size());
+  return k;
+}
+
+/**
+ * Computes the leave-one-out contribution of an observation from its
+ * log likelihood in each draw, by Pareto smoothed importance sampling
+ * with the ratios <code>1 / p(y_i | theta)</code>.
+ *
+ * The relative efficiency of the draws is the effective sample size of
+ * the likelihood over the number of draws, taken as one when it isn't
+ * defined.
+ *
+ * @param draws stores pointers to arrays of chains of log likelihoods
+ * @param sizes stores sizes of chains
+ * @param engine engine for the autocovariances, which can be reused
+ *   across observations
+ * @return leave-one-out contribution of the observation
+ */
+inline psis_loo_pointwise compute_psis_loo(
+    std::vector<const double*> draws, std::vector<size_t> sizes,
+    autocovariance_engine<double>& engine) {
+  size_t S = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+  Eigen::VectorXd log_lik(S);
+  for (size_t chain = 0, start = 0; chain < draws.size();
+       start += sizes[chain++])
+    log_lik.segment(start, sizes[chain])
+        = Eigen::Map<const Eigen::VectorXd>(draws[chain], sizes[chain]);
+
+  Eigen::VectorXd lik = (log_lik.array() - log_lik.maxCoeff()).exp();
+  std::vector<const double*> lik_draws(draws.size());
+  for (size_t chain = 0, start = 0; chain < draws.size();
+       start += sizes[chain++])
+    lik_draws[chain] = lik.data() + start;
+  double r_eff = compute_effective_sample_size(lik_draws, sizes, engine) / S;
+  if (!std::isfinite(r_eff) || r_eff <= 0)
+    r_eff = 1;
+
+  psis_loo_pointwise result;
+  Eigen::VectorXd log_weights = -log_lik;
+  result.pareto_k = compute_psis(log_weights, r_eff);
+  log_weights += log_lik;
+  result.elpd_loo
+      = internal::log_sum_exp(log_weights.data(), log_weights.size());
+  result.p_loo = internal::log_sum_exp(log_lik.data(), S) - std::log(S)
+                 - result.elpd_loo;
+  return result;
+}
+
+namespace internal {
+
+inline psis_loo summarize_psis_loo(
+    std::vector<psis_loo_pointwise>&& pointwise, size_t num_draws) {
+  psis_loo result;
+  result.k_threshold
+      = std::min(1 - 1 / std::log10(static_cast<double>(num_draws)), 0.7);
+  result.num_high_k = 0;
+  std::vector<double> elpd_loo(pointwise.size());
+  std::vector<double> p_loo(pointwise.size());
+  for (size_t i = 0; i < pointwise.size(); ++i) {
+    elpd_loo[i] = pointwise[i].elpd_loo;
+    p_loo[i] = pointwise[i].p_loo;
+    result.num_high_k += !(pointwise[i].pareto_k <= result.k_threshold);
+  }
+  sum_and_se(elpd_loo, result.elpd_loo, result.se_elpd_loo);
+  sum_and_se(p_loo, result.p_loo, result.se_p_loo);
+  result.pointwise = std::move(pointwise);
+  return result;
+}
+
+}  // namespace internal
+
+/**
+ * Computes the Pareto smoothed importance sampling leave-one-out
+ * cross-validation of a model from the log likelihood of each
+ * observation in each draw, smoothing the observations in parallel on
+ * the TBB thread pool. Each worker thread reuses one autocovariance
+ * engine.
+ *
+ * @param chains log likelihoods of each chain, with one row per draw
+ *   and one column per observation
+ * @return leave-one-out estimates and diagnostics
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of observations
+ */
+inline psis_loo compute_psis_loo(const std::vector<Eigen::MatrixXd>& chains) {
+  tbb::enumerable_thread_specific<autocovariance_engine<double>> engines;
+  std::vector<psis_loo_pointwise> pointwise
+      = internal::map_parameters<psis_loo_pointwise>(
+          chains, [&engines](const std::vector<const double*>& draws,
+                             const std::vector<size_t>& sizes) {
+            return compute_psis_loo(draws, sizes, engines.local());
+          });
+  size_t num_draws = 0;
+  for (const Eigen::MatrixXd& chain : chains)
+    num_draws += chain.rows();
+  return internal::summarize_psis_loo(std::move(pointwise), num_draws);
+}
+
+/**
+ * Computes the Pareto smoothed importance sampling leave-one-out
+ * cross-validation of a model from the log likelihoods saved in Stan
+ * csv or binary output files, without ever holding all of them in
+ * memory.
+ *
+ * The log likelihood of each observation is the column named
+ * <code>name</code> or an element of the variable <code>name</code>.
+ * These columns are read in blocks of <code>block_size</code> columns,
+ * reading every file again for each block, and each block is smoothed
+ * as for <code>compute_psis_loo(chains)</code>. Warmup draws are
+ * excluded when the files saved them.
+ *
+ * @param[in] files names of the output files, one per chain, which may
+ *   mix csv and binary output
+ * @param[in] name name of the log likelihood variable
+ * @param[in] block_size number of observations smoothed at once
+ * @param[out] out output stream to send messages from the readers
+ * @return leave-one-out estimates and diagnostics
+ * @throws std::invalid_argument if there are no files, the block size
+ *   is zero, a file can't be read, the files have different columns, or
+ *   there is no log likelihood column
+ */
+inline psis_loo compute_psis_loo(const std::vector<std::string>& files,
+                                 const std::string& name, size_t block_size,
+                                 std::ostream* out = nullptr) {
+  if (files.empty())
+    throw std::invalid_argument("compute_psis_loo: no files");
+  if (block_size == 0)
+    throw std::invalid_argument("compute_psis_loo: block size is zero");
+  std::vector<std::string> header
+      = internal::read_output_header(files[0], out);
+  for (size_t i = 1; i < files.size(); ++i)
+    if (internal::read_output_header(files[i], out) != header)
+      throw std::invalid_argument("compute_psis_loo: columns of " + files[i]
+                                  + " don't match those of " + files[0]);
+
+  std::vector<size_t> log_lik_columns;
+  for (size_t col = 0; col < header.size(); ++col) {
+    const std::string& column = header[col];
+    if (column == name
+        || (column.size() > name.size()
+            && column.compare(0, name.size(), name) == 0
+            && (column[name.size()] == '.' || column[name.size()] == '[')))
+      log_lik_columns.push_back(col);
+  }
+  if (log_lik_columns.empty())
+    throw std::invalid_argument("compute_psis_loo: no column " + name);
+
+  std::vector<psis_loo_pointwise> pointwise;
+  std::vector<Eigen::MatrixXd> chains(files.size());
+  std::vector<size_t> columns;
+  size_t num_draws = 0;
+  for (size_t first = 0; first < log_lik_columns.size();
+       first += block_size) {
+    size_t last = std::min(first + block_size, log_lik_columns.size());
+    columns.assign(log_lik_columns.begin() + first,
+                   log_lik_columns.begin() + last);
+    num_draws = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+      io::stan_csv csv = internal::read_output_columns(files[i], columns, out);
+      int warmup = csv.metadata.save_warmup ? csv.metadata.num_warmup : 0;
+      warmup = std::min<int>(warmup, csv.samples.rows());
+      chains[i] = csv.samples.bottomRows(csv.samples.rows() - warmup);
+      num_draws += chains[i].rows();
+    }
+    psis_loo block = compute_psis_loo(chains);
+    pointwise.insert(pointwise.end(), block.pointwise.begin(),
+                     block.pointwise.end());
+  }
+  return internal::summarize_psis_loo(std::move(pointwise), num_draws);
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef STAN_ANALYZE_MCMC_COMPUTE_RANK_NORMALIZED_DIAGNOSTICS_HPP
+#define STAN_ANALYZE_MCMC_COMPUTE_RANK_NORMALIZED_DIAGNOSTICS_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/math/prim/fun/inv_Phi.hpp>
+#include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <stan/analyze/mcmc/for_each_parameter.hpp>
+#include <stan/analyze/mcmc/split_chains.hpp>
+#include <tbb/enumerable_thread_specific.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Rank-normalized convergence diagnostics of a parameter, as described
+ * by Vehtari et al. (2021), "Rank-normalization, folding, and
+ * localization: An improved R-hat for assessing convergence of MCMC",
+ * Bayesian Analysis 16(2), https://doi.org/10.1214/20-BA1221.
+ */
+struct rank_normalized_diagnostics {
+  /**
+   * Split R-hat of the rank-normalized draws.
+   */
+  double rhat_bulk;
+  /**
+   * Split R-hat of the rank-normalized absolute deviations of the
+   * draws from their median.
+   */
+  double rhat_folded;
+  /**
+   * Maximum of the bulk and folded R-hat.
+   */
+  double rhat;
+  /**
+   * Split ESS of the rank-normalized draws.
+   */
+  double ess_bulk;
+  /**
+   * Minimum of the split ESS of the indicators of the draws being at
+   * most their 5% and their 95% quantiles.
+   */
+  double ess_tail;
+};
+
+namespace internal {
+
+/**
+ * Write the normal scores of the values in the specified increasing
+ * order: a value of rank r among S values, averaged over ties, is
+ * replaced by <code>inv_Phi((r - 3/8) / (S + 1/4))</code>.
+ *
+ * @tparam F Type of the values, callable as <code>double f(int)</code>
+ * @param order indices of the values in increasing order
+ * @param value value of an index
+ * @param[out] z normal scores, by index
+ */
+template <typename F>
+void normal_scores(const std::vector<int>& order, const F& value,
+                   std::vector<double>& z) {
+  int S = order.size();
+  for (int i = 0; i < S;) {
+    int j = i + 1;
+    while (j < S && value(order[j]) == value(order[i]))
+      ++j;
+    double rank = (i + j + 1) / 2.0;
+    double score = math::inv_Phi((rank - 0.375) / (S + 0.25));
+    for (int k = i; k < j; ++k)
+      z[order[k]] = score;
+    i = j;
+  }
+}
+
+/**
+ * Return the quantile of sorted values, interpolating linearly between
+ * order statistics as R's default quantile type 7.
+ *
+ * @param x values
+ * @param order indices of the values in increasing order
+ * @param p probability
+ * @return quantile
+ */
+inline double sorted_quantile(const std::vector<double>& x,
+                              const std::vector<int>& order, double p) {
+  double h = (order.size() - 1) * p;
+  size_t lo = std::floor(h);
+  size_t hi = std::min(lo + 1, order.size() - 1);
+  return x[order[lo]] + (h - lo) * (x[order[hi]] - x[order[lo]]);
+}
+
+/**
+ * Return the maximum or minimum of two values, or NaN if either is
+ * NaN.
+ */
+inline double nan_max(double a, double b) {
+  return std::isnan(a) || std::isnan(b) ? a + b : std::max(a, b);
+}
+
+inline double nan_min(double a, double b) {
+  return std::isnan(a) || std::isnan(b) ? a + b : std::min(a, b);
+}
+
+}  // namespace internal
+
+/**
+ * Computes the rank-normalized split R-hat, folded split R-hat, bulk
+ * ESS and tail ESS of the specified parameter across all kept
+ * samples.
+ *
+ * The chains are split in halves, trimmed from the back to the length
+ * of the shortest chain, and the draws of all halves are sorted once.
+ * That single ordering gives the ranks for the bulk diagnostics, the
+ * median and the quantiles for the tail ESS, and, by merging the runs
+ * below and above the median, the ranks of the folded draws, so no
+ * other sort is needed.
+ *
+ * All diagnostics are NaN if there are fewer than two draws per half
+ * chain, if a draw isn't finite, or if all draws are equal.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @param engine engine for the autocovariances, which can be reused
+ *   across parameters
+ * @return rank-normalized diagnostics of the parameter
+ */
+inline rank_normalized_diagnostics compute_rank_normalized_diagnostics(
+    std::vector<const double*> draws, std::vector<size_t> sizes,
+    autocovariance_engine<double>& engine) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  rank_normalized_diagnostics result{nan, nan, nan, nan, nan};
+  size_t num_draws = *std::min_element(sizes.begin(), sizes.end());
+  size_t half = num_draws / 2;
+  if (half < 2)
+    return result;
+
+  std::vector<const double*> split_draws = split_chains(draws, sizes);
+  int num_pieces = split_draws.size();
+  int S = num_pieces * half;
+  std::vector<double> x(S);
+  for (int k = 0; k < num_pieces; ++k)
+    std::copy(split_draws[k], split_draws[k] + half, x.begin() + k * half);
+  for (double v : x)
+    if (!std::isfinite(v))
+      return result;
+
+  std::vector<int> order(S);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&x](int a, int b) { return x[a] < x[b]; });
+  if (x[order[0]] == x[order[S - 1]])
+    return result;
+
+  // Every statistic is computed from scores laid out like the split
+  // draws, one half chain after the other
+  std::vector<double> z(S);
+  std::vector<const double*> z_pieces(num_pieces);
+  for (int k = 0; k < num_pieces; ++k)
+    z_pieces[k] = z.data() + k * half;
+  std::vector<size_t> piece_sizes(num_pieces, half);
+
+  internal::normal_scores(
+      order, [&x](int i) { return x[i]; }, z);
+  result.rhat_bulk = compute_potential_scale_reduction(z_pieces, piece_sizes);
+  result.ess_bulk
+      = compute_effective_sample_size(z_pieces, piece_sizes, engine);
+
+  result.ess_tail = std::numeric_limits<double>::infinity();
+  for (double p : {0.05, 0.95}) {
+    double q = internal::sorted_quantile(x, order, p);
+    for (int i = 0; i < S; ++i)
+      z[i] = x[i] <= q;
+    result.ess_tail = internal::nan_min(
+        result.ess_tail,
+        compute_effective_sample_size(z_pieces, piece_sizes, engine));
+  }
+
+  // The draws below the median in decreasing order and the others in
+  // increasing order both have increasing distances from the median,
+  // so merging them orders the folded draws
+  double median = internal::sorted_quantile(x, order, 0.5);
+  auto folded = [&x, median](int i) { return std::fabs(x[i] - median); };
+  int above = std::partition_point(order.begin(), order.end(),
+                                   [&x, median](int i) {
+                                     return x[i] < median;
+                                   })
+              - order.begin();
+  std::vector<int> folded_order(S);
+  int below = above - 1;
+  for (int n = 0; n < S; ++n) {
+    if (above == S
+        || (below >= 0 && folded(order[below]) <= folded(order[above])))
+      folded_order[n] = order[below--];
+    else
+      folded_order[n] = order[above++];
+  }
+  internal::normal_scores(folded_order, folded, z);
+  result.rhat_folded
+      = compute_potential_scale_reduction(z_pieces, piece_sizes);
+  result.rhat = internal::nan_max(result.rhat_bulk, result.rhat_folded);
+  return result;
+}
+
+/**
+ * Computes the rank-normalized diagnostics of the specified parameter
+ * across all kept samples, as for the overload taking an
+ * autocovariance engine.
+ *
+ * @param draws stores pointers to arrays of chains
+ * @param sizes stores sizes of chains
+ * @return rank-normalized diagnostics of the parameter
+ */
+inline rank_normalized_diagnostics compute_rank_normalized_diagnostics(
+    std::vector<const double*> draws, std::vector<size_t> sizes) {
+  autocovariance_engine<double> engine;
+  return compute_rank_normalized_diagnostics(draws, sizes, engine);
+}
+
+/**
+ * Computes the rank-normalized diagnostics of every parameter across
+ * all kept samples, summarizing the parameters in parallel on the TBB
+ * thread pool. Each worker thread reuses one autocovariance engine.
+ *
+ * @param chains draws of each chain, with one row per draw and one
+ *   column per parameter
+ * @return rank-normalized diagnostics of each parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+inline std::vector<rank_normalized_diagnostics>
+compute_rank_normalized_diagnostics(
+    const std::vector<Eigen::MatrixXd>& chains) {
+  tbb::enumerable_thread_specific<autocovariance_engine<double>> engines;
+  return internal::map_parameters<rank_normalized_diagnostics>(
+      chains, [&engines](const std::vector<const double*>& draws,
+                         const std::vector<size_t>& sizes) {
+        return compute_rank_normalized_diagnostics(draws, sizes,
+                                                   engines.local());
+      });
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
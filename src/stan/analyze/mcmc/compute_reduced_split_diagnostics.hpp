@@ -0,0 +1,113 @@
+#ifndef STAN_ANALYZE_MCMC_COMPUTE_REDUCED_SPLIT_DIAGNOSTICS_HPP
+#define STAN_ANALYZE_MCMC_COMPUTE_REDUCED_SPLIT_DIAGNOSTICS_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Computes the split potential scale reduction (Rhat) and the split
+ * effective sample size (ESS) of a parameter whose chains are held by
+ * several processes, without gathering their draws.
+ *
+ * Each process passes the draws of its own chains and a function adding
+ * a vector elementwise across all processes, such as an MPI all-reduce,
+ * which is called twice with vectors of the same length on every
+ * process. The first reduction sums the number of split chains and
+ * their means; the second sums the squared deviations of the split chain
+ * means from the mean of all chains, their variances and their
+ * autocovariances at each lag. The results match
+ * <code>compute_split_potential_scale_reduction()</code> and
+ * <code>compute_split_effective_sample_size()</code> of all chains taken
+ * together, up to rounding, and are the same on every process.
+ *
+ * Every chain of every process must have the same number of draws; the
+ * results are NaN otherwise, or if a draw isn't finite or all draws are
+ * equal. A process without chains passes no draws and still takes part
+ * in the reductions.
+ *
+ * @param draws pointers to the draws of each chain of this process
+ * @param num_draws number of draws of each chain
+ * @param all_reduce_sum function replacing a vector by its elementwise
+ *   sum over all processes
+ * @param engine engine for the autocovariances
+ * @param[out] rhat split potential scale reduction, NaN with fewer than
+ *   four draws per chain
+ * @param[out] ess split effective sample size, NaN with fewer than eight
+ *   draws per chain
+ */
+inline void compute_reduced_split_diagnostics(
+    const std::vector<const double*>& draws, size_t num_draws,
+    const std::function<void(Eigen::VectorXd&)>& all_reduce_sum,
+    autocovariance_engine<double>& engine, double& rhat, double& ess) {
+  typedef Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>> draws_t;
+  rhat = std::numeric_limits<double>::quiet_NaN();
+  ess = std::numeric_limits<double>::quiet_NaN();
+  // When the number of draws is odd the middle draw is ignored
+  const size_t half = num_draws / 2;
+  const size_t offset = num_draws - half;
+  const size_t num_local = 2 * draws.size();
+
+  Eigen::VectorXd chain_mean = Eigen::VectorXd::Zero(num_local);
+  double num_nonfinite = 0;
+  for (size_t chain = 0; chain < draws.size(); ++chain) {
+    draws_t draw(draws[chain], num_draws);
+    num_nonfinite += (!draw.array().isFinite()).count();
+    if (half == 0)
+      continue;
+    chain_mean(2 * chain) = draw.head(half).mean();
+    chain_mean(2 * chain + 1) = draw.segment(offset, half).mean();
+  }
+
+  // The sums of the lengths and of their squares only agree if every
+  // chain has the same length
+  Eigen::VectorXd counts(5);
+  counts << num_local, chain_mean.sum(), num_nonfinite,
+      static_cast<double>(num_local * half),
+      static_cast<double>(num_local * half * half);
+  all_reduce_sum(counts);
+  const double num_chains = counts(0);
+  if (num_chains < 2 || counts(2) > 0
+      || counts(3) * counts(3) != num_chains * counts(4) || half < 2)
+    return;
+  const double grand_mean = counts(1) / num_chains;
+
+  Eigen::VectorXd moments = Eigen::VectorXd::Zero(2 + half);
+  Eigen::VectorXd acov1;
+  Eigen::VectorXd acov2;
+  for (size_t chain = 0; chain < draws.size(); ++chain) {
+    draws_t draw(draws[chain], num_draws);
+    engine(draw.head(half), draw.segment(offset, half), acov1, acov2);
+    double delta1 = chain_mean(2 * chain) - grand_mean;
+    double delta2 = chain_mean(2 * chain + 1) - grand_mean;
+    moments(0) += delta1 * delta1 + delta2 * delta2;
+    moments(1) += (acov1(0) + acov2(0)) * half / (half - 1.0);
+    moments.tail(half) += acov1 + acov2;
+  }
+  all_reduce_sum(moments);
+  const double var_chain_mean = moments(0) / (num_chains - 1);
+  const double mean_var = moments(1) / num_chains;
+  if (var_chain_mean == 0 && mean_var == 0)
+    return;
+
+  rhat = internal::potential_scale_reduction_from_moments(var_chain_mean,
+                                                          mean_var, half);
+  if (half < 4)
+    return;
+  ess = internal::effective_sample_size_from_moments(
+      [&moments, num_chains](size_t s) { return moments(2 + s) / num_chains; },
+      mean_var, var_chain_mean, num_chains, half);
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef STAN_ANALYZE_MCMC_FOR_EACH_PARAMETER_HPP
+#define STAN_ANALYZE_MCMC_FOR_EACH_PARAMETER_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+namespace internal {
+
+/**
+ * Evaluates a per-parameter summary for every column of the draws in
+ * parallel on the TBB thread pool.
+ *
+ * The draws of each chain are stored as a matrix with one row per draw
+ * and one column per parameter. Columns of a column major matrix are
+ * contiguous, so each parameter is summarized from pointers into the
+ * chains without copying.
+ *
+ * @tparam R Type of the summary of a parameter
+ * @tparam F Type of the summary, callable as
+ *   <code>R f(std::vector<const double*>, std::vector<size_t>)</code>
+ * @param chains draws of each chain
+ * @param f summary of a single parameter
+ * @return summary of every parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+template <typename R, typename F>
+std::vector<R> map_parameters(const std::vector<Eigen::MatrixXd>& chains,
+                              const F& f) {
+  if (chains.empty())
+    throw std::invalid_argument("for_each_parameter: no chains");
+  const Eigen::Index num_params = chains[0].cols();
+  std::vector<size_t> sizes(chains.size());
+  for (size_t chain = 0; chain < chains.size(); ++chain) {
+    if (chains[chain].cols() != num_params)
+      throw std::invalid_argument(
+          "for_each_parameter: chains have different numbers of"
+          " parameters");
+    sizes[chain] = chains[chain].rows();
+  }
+
+  std::vector<R> result(num_params);
+  tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, num_params),
+                    [&](const tbb::blocked_range<Eigen::Index>& r) {
+                      std::vector<const double*> draws(chains.size());
+                      for (Eigen::Index i = r.begin(); i != r.end(); ++i) {
+                        for (size_t chain = 0; chain < chains.size(); ++chain)
+                          draws[chain] = chains[chain].col(i).data();
+                        result[i] = f(draws, sizes);
+                      }
+                    });
+  return result;
+}
+
+/**
+ * Evaluates a scalar per-parameter summary for every column of the
+ * draws in parallel on the TBB thread pool, as for
+ * <code>map_parameters()</code>.
+ *
+ * @tparam F Type of the summary, callable as
+ *   <code>double f(std::vector<const double*>, std::vector<size_t>)</code>
+ * @param chains draws of each chain
+ * @param f summary of a single parameter
+ * @return summary of every parameter
+ * @throws std::invalid_argument if there are no chains or the chains
+ *   don't all have the same number of parameters
+ */
+template <typename F>
+Eigen::VectorXd for_each_parameter(const std::vector<Eigen::MatrixXd>& chains,
+                                   const F& f) {
+  std::vector<double> result = map_parameters<double>(chains, f);
+  return Eigen::Map<Eigen::VectorXd>(result.data(), result.size());
+}
+
+}  // namespace internal
+}  // namespace analyze
+}  // namespace stan
+
+#endif
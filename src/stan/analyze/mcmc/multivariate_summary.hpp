@@ -0,0 +1,261 @@
+#ifndef STAN_ANALYZE_MCMC_MULTIVARIATE_SUMMARY_HPP
+#define STAN_ANALYZE_MCMC_MULTIVARIATE_SUMMARY_HPP
+
+#include <stan/analyze/mcmc/summarize_in_blocks.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+
+/**
+ * Accumulates the mean and covariance of a block of parameters and the
+ * covariance of their batch means over a stream of draws, from which
+ * the posterior correlation and the multivariate effective sample size
+ * of the block are computed, in memory that depends only on the size of
+ * the block.
+ *
+ * Draws are added in chunks, one row per draw. The centered draws of a
+ * chunk update the sums of squares with one symmetric rank-k update and
+ * are merged into the running totals by the pairwise update of Chan,
+ * Golub and LeVeque, so the covariance is as accurate as a two-pass
+ * computation. Each chain is cut into consecutive batches of
+ * <code>batch_size</code> draws, whose means feed a second covariance;
+ * the last batch of a chain is dropped if it isn't full.
+ *
+ * The multivariate effective sample size is that of Vats, Flegal and
+ * Jones (2019), n (det Lambda / det Sigma)^(1/p), with Lambda the
+ * covariance of the draws and Sigma the batch means estimate of the
+ * asymptotic covariance of their mean, b times the covariance of the
+ * batch means for batches of b draws. A batch size of about the square
+ * root of the number of draws per chain is usual.
+ */
+class multivariate_summary {
+ public:
+  /**
+   * @param num_params number of parameters of the block
+   * @param batch_size number of draws of each batch
+   * @throws std::invalid_argument if either number is zero
+   */
+  multivariate_summary(size_t num_params, size_t batch_size)
+      : batch_size_(batch_size),
+        n_(0),
+        mean_(Eigen::VectorXd::Zero(num_params)),
+        m2_(Eigen::MatrixXd::Zero(num_params, num_params)),
+        num_batches_(0),
+        batch_mean_(Eigen::VectorXd::Zero(num_params)),
+        batch_m2_(Eigen::MatrixXd::Zero(num_params, num_params)),
+        batch_sum_(Eigen::VectorXd::Zero(num_params)),
+        batch_fill_(0) {
+    if (num_params == 0)
+      throw std::invalid_argument(
+          "multivariate_summary: the block has no parameters");
+    if (batch_size == 0)
+      throw std::invalid_argument(
+          "multivariate_summary: the batch size is zero");
+  }
+
+  /**
+   * Start a new chain, dropping the draws of the unfinished batch of
+   * the previous one from the batch means.
+   */
+  void start_chain() {
+    batch_sum_.setZero();
+    batch_fill_ = 0;
+  }
+
+  /**
+   * Add a chunk of draws of the current chain.
+   *
+   * @param draws draws of the block, one row per draw
+   * @throws std::invalid_argument if the number of columns does not
+   *   match the size of the block
+   */
+  template <typename EigMat>
+  void add(const EigMat& draws) {
+    if (draws.cols() != mean_.size())
+      throw std::invalid_argument(
+          "multivariate_summary: the draws have "
+          + std::to_string(draws.cols()) + " columns, not "
+          + std::to_string(mean_.size()));
+    if (draws.rows() == 0)
+      return;
+    merge(draws);
+
+    for (Eigen::Index n = 0; n < draws.rows(); ++n) {
+      batch_sum_ += draws.row(n).transpose();
+      if (++batch_fill_ == batch_size_) {
+        ++num_batches_;
+        batch_sum_ /= static_cast<double>(batch_size_);
+        Eigen::VectorXd delta = batch_sum_ - batch_mean_;
+        batch_mean_ += delta / static_cast<double>(num_batches_);
+        batch_m2_.selfadjointView<Eigen::Lower>().rankUpdate(
+            delta, (num_batches_ - 1.0) / num_batches_);
+        batch_sum_.setZero();
+        batch_fill_ = 0;
+      }
+    }
+  }
+
+  size_t num_params() const { return mean_.size(); }
+
+  size_t num_draws() const { return n_; }
+
+  size_t num_batches() const { return num_batches_; }
+
+  const Eigen::VectorXd& mean() const { return mean_; }
+
+  /**
+   * Return the sample covariance of the draws, or NaN with fewer than
+   * two draws.
+   */
+  Eigen::MatrixXd covariance() const {
+    if (n_ < 2)
+      return nan_matrix();
+    return full(m2_) / (n_ - 1.0);
+  }
+
+  /**
+   * Return the sample correlation of the draws, or NaN with fewer than
+   * two draws.
+   */
+  Eigen::MatrixXd correlation() const {
+    Eigen::MatrixXd cov = covariance();
+    Eigen::VectorXd inv_sd = cov.diagonal().cwiseSqrt().cwiseInverse();
+    return inv_sd.asDiagonal() * cov * inv_sd.asDiagonal();
+  }
+
+  /**
+   * Return the batch means estimate of the asymptotic covariance of the
+   * mean, times the number of draws, or NaN with fewer than two full
+   * batches.
+   */
+  Eigen::MatrixXd batch_means_covariance() const {
+    if (num_batches_ < 2)
+      return nan_matrix();
+    return full(batch_m2_) * (batch_size_ / (num_batches_ - 1.0));
+  }
+
+  /**
+   * Return the multivariate effective sample size of the block, or NaN
+   * with fewer than two full batches or a singular covariance.
+   */
+  double multivariate_ess() const {
+    if (n_ < 2 || num_batches_ < 2)
+      return std::numeric_limits<double>::quiet_NaN();
+    Eigen::LLT<Eigen::MatrixXd> lambda(covariance());
+    Eigen::LLT<Eigen::MatrixXd> sigma(batch_means_covariance());
+    if (lambda.info() != Eigen::Success || sigma.info() != Eigen::Success)
+      return std::numeric_limits<double>::quiet_NaN();
+    // Log determinants from the Cholesky factors
+    double log_det_ratio
+        = 2
+          * (lambda.matrixLLT().diagonal().array().log().sum()
+             - sigma.matrixLLT().diagonal().array().log().sum());
+    return n_ * std::exp(log_det_ratio / mean_.size());
+  }
+
+ private:
+  size_t batch_size_;
+  size_t n_;
+  Eigen::VectorXd mean_;
+  // Sums of squared deviations, lower triangle only
+  Eigen::MatrixXd m2_;
+  size_t num_batches_;
+  Eigen::VectorXd batch_mean_;
+  Eigen::MatrixXd batch_m2_;
+  Eigen::VectorXd batch_sum_;
+  size_t batch_fill_;
+  Eigen::MatrixXd centered_;
+
+  /**
+   * Merge a chunk of draws into the count, mean and sums of squares.
+   */
+  template <typename EigMat>
+  void merge(const EigMat& draws) {
+    double k = draws.rows();
+    Eigen::VectorXd chunk_mean = draws.colwise().mean().transpose();
+    centered_ = draws.rowwise() - chunk_mean.transpose();
+    Eigen::VectorXd delta = chunk_mean - mean_;
+    double total = n_ + k;
+    m2_.selfadjointView<Eigen::Lower>().rankUpdate(centered_.transpose());
+    m2_.selfadjointView<Eigen::Lower>().rankUpdate(delta, n_ * k / total);
+    mean_ += delta * (k / total);
+    n_ += draws.rows();
+  }
+
+  Eigen::MatrixXd nan_matrix() const {
+    return Eigen::MatrixXd::Constant(mean_.size(), mean_.size(),
+                                     std::numeric_limits<double>::quiet_NaN());
+  }
+
+  static Eigen::MatrixXd full(const Eigen::MatrixXd& lower) {
+    return lower.selfadjointView<Eigen::Lower>();
+  }
+};
+
+/**
+ * Return the multivariate summary of a block of columns of the draws of
+ * several chains stored in Stan csv or binary output files. Each file
+ * is read for the columns of the block only and added in chunks of
+ * <code>chunk_size</code> draws, excluding the warmup draws when the
+ * file saved them.
+ *
+ * @param[in] files names of the output files, one per chain, which may
+ *   mix csv and binary output
+ * @param[in] columns zero-based indices of the columns of the block, in
+ *   increasing order
+ * @param[in] batch_size number of draws of each batch, or 0 for the
+ *   square root of the number of draws of the first chain
+ * @param[in] chunk_size number of draws added at once
+ * @param[out] out output stream to send messages from the readers
+ * @return summary of the block
+ * @throws std::invalid_argument if there are no files or columns, the
+ *   chunk size is zero, or a file can't be read
+ */
+inline multivariate_summary summarize_multivariate(
+    const std::vector<std::string>& files, const std::vector<size_t>& columns,
+    size_t batch_size, size_t chunk_size = 1024,
+    std::ostream* out = nullptr) {
+  if (files.empty())
+    throw std::invalid_argument("summarize_multivariate: no files");
+  if (columns.empty())
+    throw std::invalid_argument("summarize_multivariate: no columns");
+  if (chunk_size == 0)
+    throw std::invalid_argument("summarize_multivariate: chunk size is zero");
+  auto first_draw = [](const io::stan_csv& chain) {
+    if (!chain.metadata.save_warmup)
+      return Eigen::Index(0);
+    return std::min<Eigen::Index>(chain.metadata.num_warmup,
+                                  chain.samples.rows());
+  };
+  io::stan_csv chain = internal::read_output_columns(files[0], columns, out);
+  if (batch_size == 0)
+    batch_size = std::max(
+        1.0, std::floor(std::sqrt(static_cast<double>(
+                 chain.samples.rows() - first_draw(chain)))));
+
+  multivariate_summary summary(columns.size(), batch_size);
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (i > 0)
+      chain = internal::read_output_columns(files[i], columns, out);
+    const Eigen::MatrixXd& draws = chain.samples;
+    summary.start_chain();
+    for (Eigen::Index n = first_draw(chain); n < draws.rows();
+         n += chunk_size) {
+      Eigen::Index rows = std::min<Eigen::Index>(chunk_size, draws.rows() - n);
+      summary.add(draws.middleRows(n, rows));
+    }
+  }
+  return summary;
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
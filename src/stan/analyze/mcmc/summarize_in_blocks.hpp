@@ -0,0 +1,151 @@
+#ifndef STAN_ANALYZE_MCMC_SUMMARIZE_IN_BLOCKS_HPP
+#define STAN_ANALYZE_MCMC_SUMMARIZE_IN_BLOCKS_HPP
+
+#include <stan/io/stan_binary_reader.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/mcmc/chains.hpp>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace analyze {
+namespace internal {
+
+/**
+ * Return the names of the columns of a Stan csv or binary output file.
+ *
+ * @param[in] file name of the file
+ * @param[out] out output stream to send messages
+ * @return names of the columns
+ * @throws std::invalid_argument if the file can't be opened or has no
+ *   header
+ */
+inline std::vector<std::string> read_output_header(const std::string& file,
+                                                   std::ostream* out) {
+  std::ifstream in(file, std::ios_base::in | std::ios_base::binary);
+  if (!in)
+    throw std::invalid_argument("Can't open " + file);
+  std::vector<std::string> header;
+  bool ok;
+  if (io::stan_binary_reader::is_binary(in)) {
+    ok = io::stan_binary_reader::read_header(in, header, out);
+  } else {
+    io::stan_csv_metadata metadata;
+    io::stan_csv_reader::read_metadata(in, metadata, out);
+    ok = io::stan_csv_reader::read_header(in, header, out);
+  }
+  if (!ok)
+    throw std::invalid_argument("Error with header of " + file);
+  return header;
+}
+
+/**
+ * Return the selected columns of every draw of a Stan csv or binary
+ * output file, with its metadata.
+ *
+ * @param[in] file name of the file
+ * @param[in] columns zero-based indices of the columns to read, in
+ *   increasing order
+ * @param[out] out output stream to send messages
+ * @return output holding only the selected columns
+ * @throws std::invalid_argument if the file can't be opened or parsed
+ */
+inline io::stan_csv read_output_columns(const std::string& file,
+                                        const std::vector<size_t>& columns,
+                                        std::ostream* out) {
+  std::ifstream in(file, std::ios_base::in | std::ios_base::binary);
+  if (!in)
+    throw std::invalid_argument("Can't open " + file);
+  if (io::stan_binary_reader::is_binary(in))
+    return io::stan_binary_reader::parse(in, out, true, columns);
+  io::stan_csv_selection selection;
+  selection.indices = columns;
+  return io::stan_csv_reader::parse(in, out, selection);
+}
+
+}  // namespace internal
+
+/**
+ * Writes a summary table of the draws of several chains stored in Stan
+ * csv or binary output files, without ever holding all of the draws in
+ * memory.
+ *
+ * The columns are summarized in blocks of <code>block_size</code>
+ * columns. For each block every file is read again, keeping only the
+ * columns of the block, and the block is summarized with
+ * <code>mcmc::chains::summary()</code>, so at most
+ * <code>block_size</code> times the total number of draws values are
+ * held at once. The csv reader skips the other columns without parsing
+ * them.
+ *
+ * The table is written as csv with a header row and one row per column
+ * of the files, holding its quoted name, mean, Monte Carlo standard
+ * error, standard deviation, quantiles, split effective sample size and
+ * split potential scale reduction. Warmup draws are excluded when the files
+ * saved them.
+ *
+ * @param[in] files names of the output files, one per chain, which may
+ *   mix csv and binary output
+ * @param[in] block_size number of columns summarized at once
+ * @param[in] probs probabilities of the quantiles
+ * @param[in, out] table stream the summary table is written to
+ * @param[out] out output stream to send messages from the readers
+ * @throws std::invalid_argument if there are no files, the block size
+ *   is zero, a file can't be read, or the files have different columns
+ */
+inline void summarize_in_blocks(const std::vector<std::string>& files,
+                                size_t block_size,
+                                const Eigen::VectorXd& probs,
+                                std::ostream& table,
+                                std::ostream* out = nullptr) {
+  if (files.empty())
+    throw std::invalid_argument("summarize_in_blocks: no files");
+  if (block_size == 0)
+    throw std::invalid_argument("summarize_in_blocks: block size is zero");
+  std::vector<std::string> header
+      = internal::read_output_header(files[0], out);
+  for (size_t i = 1; i < files.size(); ++i)
+    if (internal::read_output_header(files[i], out) != header)
+      throw std::invalid_argument("summarize_in_blocks: columns of "
+                                  + files[i] + " don't match those of "
+                                  + files[0]);
+
+  table << "name,mean,mcse,sd";
+  for (int i = 0; i < probs.size(); ++i)
+    table << "," << 100 * probs(i) << "%";
+  table << ",ess,rhat\n";
+
+  std::vector<size_t> columns;
+  for (size_t first = 0; first < header.size(); first += block_size) {
+    size_t last = std::min(first + block_size, header.size());
+    columns.clear();
+    for (size_t col = first; col < last; ++col)
+      columns.push_back(col);
+
+    std::vector<std::string> names(header.begin() + first,
+                                   header.begin() + last);
+    mcmc::chains<> chains(names);
+    for (const std::string& file : files)
+      chains.add(internal::read_output_columns(file, columns, out));
+
+    std::vector<mcmc::parameter_summary> summaries = chains.summary(probs);
+    for (size_t i = 0; i < summaries.size(); ++i) {
+      const mcmc::parameter_summary& s = summaries[i];
+      table << "\"" << names[i] << "\"," << s.mean << "," << s.mcse << ","
+            << s.sd;
+      for (int j = 0; j < s.quantiles.size(); ++j)
+        table << "," << s.quantiles(j);
+      table << "," << s.ess << "," << s.rhat << "\n";
+    }
+  }
+}
+
+}  // namespace analyze
+}  // namespace stan
+
+#endif
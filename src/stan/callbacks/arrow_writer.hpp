@@ -0,0 +1,419 @@
+#ifndef STAN_CALLBACKS_ARROW_WRITER_HPP
+#define STAN_CALLBACKS_ARROW_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/column_type.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>arrow_writer</code> is an implementation of <code>writer</code>
+ * that writes draws as an Apache Arrow IPC stream, which Arrow based
+ * tools read into columns without parsing any text.
+ *
+ * The first names written, such as the header of an
+ * <code>mcmc_writer</code>, are the fields of the schema. Draws are
+ * accumulated into columns and written as a record batch every
+ * <code>batch_rows</code> draws, and the last batch and the end of the
+ * stream are written on destruction or by <code>finish()</code>. The
+ * stream is flushed after every batch, so it can be a pipe read while
+ * the draws are written.
+ *
+ * Columns are doubles unless other types are set with
+ * <code>set_column_types()</code>: <code>float32</code> columns are
+ * single precision floats, <code>int32</code> ones signed 32 bit
+ * integers and <code>uint8</code> ones unsigned 8 bit integers, where
+ * values that aren't finite are null. Messages and blank lines have no
+ * place in the stream and are dropped.
+ */
+class arrow_writer : public writer {
+ public:
+  /**
+   * Constructs an Arrow writer with an output stream, which should be
+   * opened in binary mode.
+   *
+   * @param[in, out] output stream to write
+   * @param[in] batch_rows number of draws in each record batch
+   * @throw std::invalid_argument if the number of draws in a batch isn't
+   *   positive
+   */
+  explicit arrow_writer(std::ostream& output, size_t batch_rows = 1024)
+      : output_(output),
+        batch_rows_(batch_rows),
+        schema_written_(false),
+        finished_(false),
+        rows_(0) {
+    if (batch_rows < 1)
+      throw std::invalid_argument(
+          "arrow_writer: the number of draws in a batch must be positive");
+  }
+
+  /**
+   * Virtual destructor. Writes the last batch and the end of the stream
+   * if they haven't been written.
+   */
+  virtual ~arrow_writer() { finish(); }
+
+  /**
+   * Sets the fields of the schema the first time it is called. Later
+   * names are ignored.
+   *
+   * @param[in] names Names in a std::vector
+   */
+  void operator()(const std::vector<std::string>& names) {
+    if (schema_written_ || !names_.empty())
+      return;
+    names_ = names;
+    if (types_.size() != names_.size())
+      types_.assign(names_.size(), io::column_type::float64);
+  }
+
+  /**
+   * Store the columns as the specified types, e.g. from
+   * <code>io::draws_column_types()</code>. Has no effect once the first
+   * batch has been written.
+   *
+   * @param[in] types a type per column
+   */
+  void set_column_types(const std::vector<io::column_type>& types) {
+    if (!schema_written_)
+      types_ = types;
+  }
+
+  /**
+   * Appends a draw to the current batch, writing the batch when full.
+   *
+   * @param[in] state Values in a std::vector
+   * @throw std::invalid_argument if the draw doesn't have a value per
+   *   name
+   */
+  void operator()(const std::vector<double>& state) {
+    if (state.empty())
+      return;
+    if (state.size() != names_.size() || types_.size() != names_.size())
+      throw std::invalid_argument(
+          "arrow_writer: number of values in draw does not match names");
+    if (!schema_written_)
+      write_schema();
+    for (size_t j = 0; j < state.size(); ++j) {
+      column& c = columns_[j];
+      size_t width = io::column_width(types_[j]);
+      c.values.resize((rows_ + 1) * width);
+      bool valid = std::isfinite(state[j])
+                   || types_[j] == io::column_type::float64
+                   || types_[j] == io::column_type::float32;
+      io::store_column_value(types_[j], valid ? state[j] : 0,
+                             c.values.data() + rows_ * width);
+      if (rows_ % 8 == 0)
+        c.validity.push_back(0);
+      if (valid)
+        c.validity.back() |= 1 << (rows_ % 8);
+      else
+        ++c.null_count;
+    }
+    if (++rows_ == batch_rows_)
+      write_batch();
+  }
+
+  /**
+   * Drops a blank line.
+   */
+  void operator()() {}
+
+  /**
+   * Drops a message.
+   *
+   * @param[in] message A string
+   */
+  void operator()(const std::string& message) {}
+
+  /**
+   * Writes the last batch, the schema if no draws were written, and the
+   * end of the stream, and flushes the stream. Further calls have no
+   * effect.
+   */
+  void finish() {
+    if (finished_)
+      return;
+    finished_ = true;
+    if (!schema_written_)
+      write_schema();
+    if (rows_ > 0)
+      write_batch();
+    write_uint32(0xFFFFFFFF);
+    write_uint32(0);
+    output_.flush();
+  }
+
+ private:
+  struct column {
+    std::vector<unsigned char> values;
+    std::vector<unsigned char> validity;
+    uint64_t null_count = 0;
+  };
+
+  /**
+   * Builds a flatbuffer front to back: every table is preceded by its
+   * vtable and followed by the objects it refers to, which are written
+   * once it has been laid out and patched into it.
+   */
+  class flatbuffer {
+   public:
+    struct field {
+      uint16_t id;
+      uint8_t size;
+      uint64_t value;
+    };
+
+    flatbuffer() : bytes_(4, 0) {}
+
+    /**
+     * Writes a table and returns its position. Fields of size 0 are
+     * offsets to objects written later, patched with
+     * <code>patch()</code> at <code>positions()</code>.
+     */
+    size_t table(const std::vector<field>& fields) {
+      uint16_t num_ids = 0;
+      for (const field& f : fields)
+        num_ids = std::max<uint16_t>(num_ids, f.id + 1);
+      std::vector<uint16_t> vtable(2 + num_ids, 0);
+      uint16_t end = 4;
+      for (uint8_t size : {8, 4, 2, 1}) {
+        for (const field& f : fields) {
+          if ((f.size == 0 ? 4 : f.size) != size)
+            continue;
+          end = (end + size - 1) / size * size;
+          vtable[2 + f.id] = end;
+          end += size;
+        }
+      }
+      vtable[0] = 2 * vtable.size();
+      vtable[1] = end;
+      size_t vtable_pos = align(2);
+      for (uint16_t x : vtable)
+        append(x, 2);
+      size_t table_pos = align(8);
+      bytes_.resize(table_pos + end, 0);
+      put(table_pos, table_pos - vtable_pos, 4);
+      positions_.clear();
+      for (const field& f : fields) {
+        size_t pos = table_pos + vtable[2 + f.id];
+        if (f.size == 0)
+          positions_.push_back(pos);
+        else
+          put(pos, f.value, f.size);
+      }
+      return table_pos;
+    }
+
+    /**
+     * Return the positions of the offset fields of the last table, in
+     * the order they were given.
+     */
+    std::vector<size_t> positions() const { return positions_; }
+
+    size_t string(const std::string& s) {
+      align(4);
+      size_t pos = append(s.size(), 4);
+      bytes_.insert(bytes_.end(), s.begin(), s.end());
+      bytes_.push_back(0);
+      return pos;
+    }
+
+    /**
+     * Writes a vector of 16 byte structs of two longs.
+     */
+    size_t structs(const std::vector<uint64_t>& longs) {
+      while (bytes_.size() % 8 != 4)
+        bytes_.push_back(0);
+      size_t pos = append(longs.size() / 2, 4);
+      for (uint64_t x : longs)
+        append(x, 8);
+      return pos;
+    }
+
+    /**
+     * Writes a vector of offsets and returns the positions to patch.
+     */
+    std::vector<size_t> offsets(size_t n, size_t& pos) {
+      align(4);
+      pos = append(n, 4);
+      std::vector<size_t> slots;
+      for (size_t i = 0; i < n; ++i)
+        slots.push_back(append(0, 4));
+      return slots;
+    }
+
+    void patch(size_t slot, size_t target) { put(slot, target - slot, 4); }
+
+    void root(size_t table) { put(0, table, 4); }
+
+    /**
+     * Return the bytes, padded to a multiple of 8.
+     */
+    const std::vector<unsigned char>& bytes() {
+      align(8);
+      return bytes_;
+    }
+
+   private:
+    std::vector<unsigned char> bytes_;
+    std::vector<size_t> positions_;
+
+    size_t align(size_t n) {
+      while (bytes_.size() % n != 0)
+        bytes_.push_back(0);
+      return bytes_.size();
+    }
+
+    size_t append(uint64_t x, size_t size) {
+      size_t pos = bytes_.size();
+      bytes_.resize(pos + size);
+      put(pos, x, size);
+      return pos;
+    }
+
+    void put(size_t pos, uint64_t x, size_t size) {
+      for (size_t i = 0; i < size; ++i)
+        bytes_[pos + i] = static_cast<unsigned char>((x >> (8 * i)) & 0xff);
+    }
+  };
+
+  // Message.fbs and Schema.fbs of the Arrow format
+  static constexpr uint16_t metadata_v5 = 4;
+  static constexpr uint8_t schema_header = 1;
+  static constexpr uint8_t record_batch_header = 3;
+  static constexpr uint8_t int_type = 2;
+  static constexpr uint8_t floating_point_type = 3;
+
+  std::ostream& output_;
+  size_t batch_rows_;
+  bool schema_written_;
+  bool finished_;
+  std::vector<std::string> names_;
+  std::vector<io::column_type> types_;
+  std::vector<column> columns_;
+  size_t rows_;
+
+  void write_schema() {
+    schema_written_ = true;
+    if (types_.size() != names_.size())
+      types_.assign(names_.size(), io::column_type::float64);
+    columns_.assign(names_.size(), column());
+
+    flatbuffer fb;
+    size_t message = fb.table({{0, 2, metadata_v5},
+                               {1, 1, schema_header},
+                               {2, 0, 0},
+                               {3, 8, 0}});
+    size_t header_slot = fb.positions()[0];
+    fb.root(message);
+    size_t schema = fb.table({{0, 2, 0}, {1, 0, 0}});
+    size_t fields_slot = fb.positions()[0];
+    fb.patch(header_slot, schema);
+    size_t fields;
+    std::vector<size_t> slots = fb.offsets(names_.size(), fields);
+    fb.patch(fields_slot, fields);
+    for (size_t j = 0; j < names_.size(); ++j) {
+      bool is_float = types_[j] == io::column_type::float64
+                      || types_[j] == io::column_type::float32;
+      uint8_t type_type = is_float ? floating_point_type : int_type;
+      size_t field = fb.table(
+          {{0, 0, 0}, {1, 1, 1}, {2, 1, type_type}, {3, 0, 0}, {5, 0, 0}});
+      std::vector<size_t> field_slots = fb.positions();
+      fb.patch(slots[j], field);
+      fb.patch(field_slots[0], fb.string(names_[j]));
+      size_t type;
+      if (is_float)
+        type = fb.table(
+            {{0, 2, types_[j] == io::column_type::float64 ? 2u : 1u}});
+      else if (types_[j] == io::column_type::int32)
+        type = fb.table({{0, 4, 32}, {1, 1, 1}});
+      else
+        type = fb.table({{0, 4, 8}, {1, 1, 0}});
+      fb.patch(field_slots[1], type);
+      size_t children;
+      fb.offsets(0, children);
+      fb.patch(field_slots[2], children);
+    }
+    write_message(fb.bytes(), {});
+  }
+
+  void write_batch() {
+    std::vector<uint64_t> nodes;
+    std::vector<uint64_t> buffers;
+    std::vector<unsigned char> body;
+    for (column& c : columns_) {
+      nodes.push_back(rows_);
+      nodes.push_back(c.null_count);
+      buffers.push_back(body.size());
+      if (c.null_count > 0) {
+        buffers.push_back(c.validity.size());
+        append_padded(body, c.validity);
+      } else {
+        buffers.push_back(0);
+      }
+      buffers.push_back(body.size());
+      buffers.push_back(c.values.size());
+      append_padded(body, c.values);
+      c.values.clear();
+      c.validity.clear();
+      c.null_count = 0;
+    }
+
+    flatbuffer fb;
+    size_t message = fb.table({{0, 2, metadata_v5},
+                               {1, 1, record_batch_header},
+                               {2, 0, 0},
+                               {3, 8, body.size()}});
+    size_t header_slot = fb.positions()[0];
+    fb.root(message);
+    size_t batch = fb.table({{0, 8, rows_}, {1, 0, 0}, {2, 0, 0}});
+    std::vector<size_t> slots = fb.positions();
+    fb.patch(header_slot, batch);
+    fb.patch(slots[0], fb.structs(nodes));
+    fb.patch(slots[1], fb.structs(buffers));
+    write_message(fb.bytes(), body);
+    rows_ = 0;
+    output_.flush();
+  }
+
+  /**
+   * Writes an encapsulated message: a continuation marker, the size of
+   * the metadata, the metadata and the body.
+   */
+  void write_message(const std::vector<unsigned char>& metadata,
+                     const std::vector<unsigned char>& body) {
+    write_uint32(0xFFFFFFFF);
+    write_uint32(metadata.size());
+    output_.write(reinterpret_cast<const char*>(metadata.data()),
+                  metadata.size());
+    output_.write(reinterpret_cast<const char*>(body.data()), body.size());
+  }
+
+  static void append_padded(std::vector<unsigned char>& body,
+                            const std::vector<unsigned char>& buffer) {
+    body.insert(body.end(), buffer.begin(), buffer.end());
+    while (body.size() % 8 != 0)
+      body.push_back(0);
+  }
+
+  void write_uint32(uint32_t x) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i)
+      bytes[i] = static_cast<char>((x >> (8 * i)) & 0xff);
+    output_.write(bytes, 4);
+  }
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
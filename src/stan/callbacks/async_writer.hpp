@@ -0,0 +1,250 @@
+#ifndef STAN_CALLBACKS_ASYNC_WRITER_HPP
+#define STAN_CALLBACKS_ASYNC_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * What an <code>async_writer</code> does with a draw when its buffer is
+ * full.
+ */
+enum class backpressure {
+  /** Wait until the background thread has made room. */
+  block,
+  /** Discard the draw and count it. */
+  drop
+};
+
+/**
+ * <code>async_writer</code> is a decorator that hands every call off to
+ * a background thread, which forwards it to the wrapped writer. The
+ * sampling thread only copies the values into a preallocated slot of a
+ * bounded ring buffer, so formatting and I/O, and any stalls of the
+ * underlying file system, no longer hold up the chain.
+ *
+ * The buffer is lock free for a single thread writing through the
+ * decorator; like the other writers it must not be called from two
+ * threads at once. The slots keep their storage, so once the buffer
+ * has gone around once, draws are queued without allocating.
+ *
+ * Only draws, the <code>std::vector&lt;double&gt;</code> calls, are
+ * written asynchronously. Names, messages and blank lines are queued
+ * behind them and then flushed, so everything written before them,
+ * such as the draws before the elapsed time at the end of sampling, is
+ * out once the call returns. The buffer is also flushed on
+ * destruction.
+ *
+ * An exception thrown by the wrapped writer on the background thread
+ * is rethrown by the next call to the decorator or to
+ * <code>flush()</code>; the calls queued after it are discarded.
+ */
+class async_writer : public writer {
+ public:
+  /**
+   * Constructor, which starts the background thread.
+   *
+   * @param[in, out] writer writer calls are forwarded to
+   * @param[in] capacity number of calls the buffer holds, including the
+   *   call being forwarded
+   * @param[in] policy what to do with a draw when the buffer is full
+   * @throw std::invalid_argument if the capacity is zero
+   */
+  explicit async_writer(writer& writer, size_t capacity = 1024,
+                        backpressure policy = backpressure::block)
+      : writer_(writer),
+        slots_(capacity),
+        policy_(policy),
+        head_(0),
+        tail_(0),
+        num_dropped_(0),
+        consumer_waiting_(false),
+        producer_waiting_(false),
+        failed_(false),
+        stop_(false) {
+    if (capacity == 0)
+      throw std::invalid_argument("async_writer capacity must be positive");
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  /**
+   * Flushes the buffer and stops the background thread. Errors of the
+   * wrapped writer that were not rethrown yet are dropped.
+   */
+  virtual ~async_writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_.store(true);
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  void operator()(const std::vector<std::string>& names) {
+    push(false, [&names](message& m) {
+      m.type = message::names_call;
+      m.names = names;
+    });
+    flush();
+  }
+
+  void operator()(const std::vector<double>& state) {
+    push(true, [&state](message& m) {
+      m.type = message::values_call;
+      m.values.assign(state.begin(), state.end());
+    });
+  }
+
+  void operator()() {
+    push(false, [](message& m) { m.type = message::blank_call; });
+    flush();
+  }
+
+  void operator()(const std::string& text) {
+    push(false, [&text](message& m) {
+      m.type = message::text_call;
+      m.text = text;
+    });
+    flush();
+  }
+
+  /**
+   * Wait until every call queued so far has been forwarded to the
+   * wrapped writer.
+   *
+   * @throw any exception the wrapped writer threw
+   */
+  void flush() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      producer_waiting_.store(true);
+      cv_.wait(lock, [&]() { return head_.load() == tail; });
+      producer_waiting_.store(false);
+    }
+    rethrow();
+  }
+
+  /**
+   * Return the number of draws discarded because the buffer was full.
+   */
+  size_t num_dropped() const { return num_dropped_.load(); }
+
+ private:
+  struct message {
+    enum kind { names_call, values_call, blank_call, text_call };
+    kind type;
+    std::vector<std::string> names;
+    std::vector<double> values;
+    std::string text;
+  };
+
+  template <class F>
+  void push(bool droppable, const F& fill) {
+    rethrow();
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load() == slots_.size()) {
+      if (droppable && policy_ == backpressure::drop) {
+        ++num_dropped_;
+        return;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      producer_waiting_.store(true);
+      cv_.wait(lock, [&]() { return tail - head_.load() < slots_.size(); });
+      producer_waiting_.store(false);
+    }
+    fill(slots_[tail % slots_.size()]);
+    tail_.store(tail + 1);
+    if (consumer_waiting_.load()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv_.notify_all();
+    }
+  }
+
+  void run() {
+    while (true) {
+      size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        consumer_waiting_.store(true);
+        cv_.wait(lock, [&]() { return head != tail_.load() || stop_.load(); });
+        consumer_waiting_.store(false);
+        if (head == tail_.load())
+          return;
+      }
+      if (!failed_.load())
+        forward(slots_[head % slots_.size()]);
+      head_.store(head + 1);
+      if (producer_waiting_.load()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+      }
+    }
+  }
+
+  void forward(const message& m) {
+    try {
+      switch (m.type) {
+        case message::names_call:
+          writer_(m.names);
+          break;
+        case message::values_call:
+          writer_(m.values);
+          break;
+        case message::blank_call:
+          writer_();
+          break;
+        case message::text_call:
+          writer_(m.text);
+          break;
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = std::current_exception();
+      failed_.store(true);
+    }
+  }
+
+  void rethrow() {
+    if (!failed_.load())
+      return;
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(error, error_);
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  writer& writer_;
+  std::vector<message> slots_;
+  backpressure policy_;
+  // Calls forwarded and calls queued since construction
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  std::atomic<size_t> num_dropped_;
+  std::atomic<bool> consumer_waiting_;
+  std::atomic<bool> producer_waiting_;
+  std::atomic<bool> failed_;
+  std::atomic<bool> stop_;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
@@ -0,0 +1,131 @@
+#ifndef STAN_CALLBACKS_BATCHED_LOGGER_HPP
+#define STAN_CALLBACKS_BATCHED_LOGGER_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>batched_logger</code> is a decorator that rate limits the warn
+ * and error messages forwarded to another logger, such as the messages
+ * written for every rejected proposal.
+ *
+ * The first time a warn or error message is logged in an interval it
+ * is forwarded; repeats only increment its count. At the end of the
+ * interval a summary line is forwarded for every message that was
+ * repeated, at the message's level. An interval ends before each info
+ * message, so with the services the summaries appear with the progress
+ * written every <code>refresh</code> iterations, and on
+ * <code>flush()</code> or destruction.
+ *
+ * Debug, info and fatal messages are always forwarded.
+ */
+class batched_logger : public logger {
+ public:
+  /**
+   * @param[in, out] logger logger messages are forwarded to
+   */
+  explicit batched_logger(logger& logger) : logger_(logger) {}
+
+  virtual ~batched_logger() { flush(); }
+
+  void debug(const std::string& message) { logger_.debug(message); }
+
+  void debug(const std::stringstream& message) { logger_.debug(message); }
+
+  void info(const std::string& message) {
+    flush();
+    logger_.info(message);
+  }
+
+  void info(const std::stringstream& message) {
+    flush();
+    logger_.info(message);
+  }
+
+  void warn(const std::string& message) {
+    if (warn_.count(message))
+      logger_.warn(message);
+  }
+
+  void warn(const std::stringstream& message) { warn(message.str()); }
+
+  void error(const std::string& message) {
+    if (error_.count(message))
+      logger_.error(message);
+  }
+
+  void error(const std::stringstream& message) { error(message.str()); }
+
+  void fatal(const std::string& message) { logger_.fatal(message); }
+
+  void fatal(const std::stringstream& message) { logger_.fatal(message); }
+
+  /**
+   * End the interval, forwarding a summary of the repeated messages.
+   */
+  void flush() {
+    for (const std::string& summary : warn_.summarize())
+      logger_.warn(summary);
+    for (const std::string& summary : error_.summarize())
+      logger_.error(summary);
+  }
+
+ private:
+  /**
+   * Occurrences of the messages of one level in the current interval.
+   */
+  class message_counts {
+   public:
+    /**
+     * Count an occurrence of a message.
+     *
+     * @return true if it is the first in the interval
+     */
+    bool count(const std::string& message) {
+      auto it = counts_.find(message);
+      if (it != counts_.end()) {
+        ++it->second;
+        return false;
+      }
+      counts_.emplace(message, 1);
+      order_.push_back(message);
+      return true;
+    }
+
+    /**
+     * Return a line for every message that was repeated, in the order
+     * the messages were first logged, and start a new interval.
+     */
+    std::vector<std::string> summarize() {
+      std::vector<std::string> summaries;
+      for (const std::string& message : order_) {
+        size_t n = counts_[message];
+        if (n > 1 && !message.empty())
+          summaries.push_back("(repeated " + std::to_string(n - 1)
+                              + " more times) " + message);
+      }
+      counts_.clear();
+      order_.clear();
+      return summaries;
+    }
+
+   private:
+    std::unordered_map<std::string, size_t> counts_;
+    std::vector<std::string> order_;
+  };
+
+  logger& logger_;
+  message_counts warn_;
+  message_counts error_;
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
@@ -0,0 +1,308 @@
+#ifndef STAN_CALLBACKS_BINARY_WRITER_HPP
+#define STAN_CALLBACKS_BINARY_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/column_type.hpp>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>binary_writer</code> is an implementation of <code>writer</code>
+ * that writes a compact binary format to a stream instead of csv text.
+ *
+ * The stream starts with the 8 byte magic string <code>STANBIN1</code>
+ * followed by a sequence of records. Every record starts with a 16 byte
+ * header made of a <code>uint64</code> record type and a
+ * <code>uint64</code> payload size in bytes. Payloads are padded
+ * with zeros to a multiple of 8 bytes. All integers and doubles are
+ * stored little-endian.
+ *
+ * - <code>names</code>: a <code>uint64</code> count followed by each
+ *   name as a <code>uint64</code> length and its characters.
+ * - <code>values</code>: the raw doubles of one draw.
+ * - <code>blank</code>: empty payload.
+ * - <code>message</code>: the characters of the message.
+ * - <code>index</code>: one entry of three <code>uint64</code> per run of
+ *   consecutive <code>values</code> records of the same width: the byte
+ *   offset of the first record, the number of records, and the number
+ *   of doubles in each.
+ * - <code>column_types</code>: a <code>uint64</code> count followed by
+ *   one byte per column, a <code>stan::io::column_type</code>.
+ * - <code>typed_values</code>: the values of one draw, each stored as
+ *   the type of its column in the last <code>column_types</code> record,
+ *   see <code>set_column_types()</code>.
+ *
+ * Because the record header is exactly two doubles wide, a run of
+ * draws can be viewed in place, e.g. from a memory mapped file, as a
+ * row major matrix with an outer stride of <code>cols + 2</code>
+ * doubles starting two doubles past the run's offset.
+ *
+ * When the index is enabled it is written on destruction or by
+ * <code>finish()</code>, followed by a 16 byte trailer holding the
+ * offset of the index record and the magic string
+ * <code>STANIDX1</code>.
+ */
+class binary_writer : public writer {
+ public:
+  enum record_type : uint32_t {
+    names_record = 1,
+    values_record = 2,
+    blank_record = 3,
+    message_record = 4,
+    index_record = 5,
+    column_types_record = 6,
+    typed_values_record = 7
+  };
+
+  static const char* file_magic() { return "STANBIN1"; }
+
+  static const char* index_magic() { return "STANIDX1"; }
+
+  /**
+   * Size in bytes of each record header.
+   */
+  static constexpr size_t header_size = 16;
+
+  /**
+   * Constructs a binary writer with an output stream, which should be
+   * opened in binary mode.
+   *
+   * @param[in, out] output stream to write
+   * @param[in] write_index whether to append the index of draws
+   *   and the trailer when finished. Default is true.
+   */
+  explicit binary_writer(std::ostream& output, bool write_index = true)
+      : output_(output),
+        write_index_(write_index),
+        finished_(false),
+        in_run_(false),
+        offset_(0),
+        row_bytes_(0) {
+    write_bytes(file_magic(), 8);
+  }
+
+  /**
+   * Virtual destructor. Writes the index if it hasn't been written.
+   */
+  virtual ~binary_writer() { finish(); }
+
+  /**
+   * Writes a set of names as a single record.
+   *
+   * @param[in] names Names in a std::vector
+   */
+  void operator()(const std::vector<std::string>& names) {
+    uint64_t size = 8;
+    for (const std::string& name : names)
+      size += 8 + name.size();
+    write_header(names_record, size);
+    write_uint64(names.size());
+    for (const std::string& name : names) {
+      write_uint64(name.size());
+      write_bytes(name.data(), name.size());
+    }
+    write_padding(size);
+    in_run_ = false;
+  }
+
+  /**
+   * Store the columns of the following draws as the specified types,
+   * e.g. from <code>io::draws_column_types()</code>, and write them as a
+   * <code>column_types</code> record. Draws with one value per column
+   * are then written as <code>typed_values</code> records, which take
+   * 4 bytes for a <code>float32</code> or <code>int32</code> value and
+   * 1 for a <code>uint8</code> one, and draws of other widths are still
+   * written as doubles. Typed draws can't be viewed in place as doubles,
+   * so they aren't in the index.
+   *
+   * @param[in] types a type per column; when empty or all
+   *   <code>float64</code> every draw is written as doubles
+   */
+  void set_column_types(const std::vector<io::column_type>& types) {
+    types_ = types;
+    row_bytes_ = 0;
+    bool narrow = false;
+    for (io::column_type type : types_) {
+      row_bytes_ += io::column_width(type);
+      narrow = narrow || type != io::column_type::float64;
+    }
+    if (!narrow)
+      types_.clear();
+    write_header(column_types_record, 8 + types.size());
+    write_uint64(types.size());
+    for (io::column_type type : types) {
+      char byte = static_cast<char>(type);
+      write_bytes(&byte, 1);
+    }
+    write_padding(8 + types.size());
+    in_run_ = false;
+  }
+
+  /**
+   * Writes a set of values as raw doubles, or as the types of the
+   * columns if they were set.
+   *
+   * @param[in] state Values in a std::vector
+   */
+  void operator()(const std::vector<double>& state) {
+    if (state.empty())
+      return;
+    if (!types_.empty() && state.size() == types_.size()) {
+      write_typed(state);
+      return;
+    }
+    uint64_t start = offset_;
+    write_header(values_record, 8 * state.size());
+    if (is_little_endian()) {
+      write_bytes(reinterpret_cast<const char*>(state.data()),
+                  8 * state.size());
+    } else {
+      for (double x : state)
+        write_double(x);
+    }
+
+    if (in_run_ && index_.back().cols == state.size())
+      ++index_.back().rows;
+    else
+      index_.push_back(run{start, 1, state.size()});
+    in_run_ = true;
+  }
+
+  /**
+   * Writes a blank record.
+   */
+  void operator()() {
+    write_header(blank_record, 0);
+    in_run_ = false;
+  }
+
+  /**
+   * Writes a message record.
+   *
+   * @param[in] message A string
+   */
+  void operator()(const std::string& message) {
+    write_header(message_record, message.size());
+    write_bytes(message.data(), message.size());
+    write_padding(message.size());
+    in_run_ = false;
+  }
+
+  /**
+   * Writes the index and trailer, if enabled, and flushes the stream.
+   * Further calls have no effect.
+   */
+  void finish() {
+    if (finished_)
+      return;
+    finished_ = true;
+    if (write_index_) {
+      uint64_t index_offset = offset_;
+      write_header(index_record, 24 * index_.size());
+      for (const run& r : index_) {
+        write_uint64(r.offset);
+        write_uint64(r.rows);
+        write_uint64(r.cols);
+      }
+      write_uint64(index_offset);
+      write_bytes(index_magic(), 8);
+    }
+    output_.flush();
+  }
+
+  /**
+   * Returns true if the host stores doubles little-endian.
+   */
+  static bool is_little_endian() {
+    const uint16_t one = 1;
+    unsigned char low;
+    std::memcpy(&low, &one, 1);
+    return low == 1;
+  }
+
+ private:
+  struct run {
+    uint64_t offset;
+    uint64_t rows;
+    uint64_t cols;
+  };
+
+  /**
+   * Output stream
+   */
+  std::ostream& output_;
+
+  bool write_index_;
+  bool finished_;
+
+  /**
+   * Whether the last record written was a values record
+   */
+  bool in_run_;
+
+  /**
+   * Number of bytes written so far
+   */
+  uint64_t offset_;
+
+  std::vector<run> index_;
+
+  /**
+   * Types of the columns of typed draws, empty if draws are doubles
+   */
+  std::vector<io::column_type> types_;
+  size_t row_bytes_;
+  std::vector<unsigned char> row_;
+
+  void write_typed(const std::vector<double>& state) {
+    row_.resize(row_bytes_);
+    unsigned char* bytes = row_.data();
+    for (size_t i = 0; i < state.size(); ++i) {
+      io::store_column_value(types_[i], state[i], bytes);
+      bytes += io::column_width(types_[i]);
+    }
+    write_header(typed_values_record, row_bytes_);
+    write_bytes(reinterpret_cast<const char*>(row_.data()), row_bytes_);
+    write_padding(row_bytes_);
+    in_run_ = false;
+  }
+
+  void write_bytes(const char* data, size_t n) {
+    output_.write(data, n);
+    offset_ += n;
+  }
+
+  void write_uint64(uint64_t x) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i)
+      bytes[i] = static_cast<char>((x >> (8 * i)) & 0xff);
+    write_bytes(bytes, 8);
+  }
+
+  void write_double(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, 8);
+    write_uint64(bits);
+  }
+
+  void write_header(record_type type, uint64_t size) {
+    write_uint64(static_cast<uint64_t>(type));
+    write_uint64(size);
+  }
+
+  void write_padding(uint64_t size) {
+    static const char zeros[8] = {0};
+    if (size % 8 != 0)
+      write_bytes(zeros, 8 - size % 8);
+  }
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
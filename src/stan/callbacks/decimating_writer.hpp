@@ -0,0 +1,126 @@
+#ifndef STAN_CALLBACKS_DECIMATING_WRITER_HPP
+#define STAN_CALLBACKS_DECIMATING_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>decimating_writer</code> is a decorator that cuts down the rows
+ * of values forwarded to another writer, meant for the diagnostic
+ * output so that it can be left on.
+ *
+ * Without a window only every <code>thin</code>-th row is forwarded.
+ * With a window, rows are only forwarded around the rows whose trigger
+ * column, by default <code>divergent__</code>, is nonzero: the last
+ * <code>window</code> rows before such a row are kept in a ring and
+ * forwarded with it, and so are the <code>window</code> rows after it.
+ * Every row is considered in that mode, regardless of the thinning.
+ * If the names have no trigger column no rows are forwarded.
+ *
+ * Values can also be rounded to single precision, so that a writer
+ * formatting the shortest round-trip text writes at most 9 significant
+ * digits.
+ *
+ * Names, messages and blank lines are always forwarded.
+ */
+class decimating_writer : public writer {
+ public:
+  /**
+   * @param[in, out] writer writer rows are forwarded to
+   * @param[in] thin period of the rows forwarded without a window
+   * @param[in] single_precision whether to round values to single
+   *   precision
+   * @param[in] window number of rows forwarded before and after each
+   *   triggering row, or zero to thin instead
+   * @param[in] trigger name of the column that triggers writing
+   */
+  explicit decimating_writer(writer& writer, size_t thin = 1,
+                             bool single_precision = false,
+                             size_t window = 0,
+                             const std::string& trigger = "divergent__")
+      : writer_(writer),
+        thin_(std::max<size_t>(thin, 1)),
+        single_precision_(single_precision),
+        window_(window),
+        trigger_(trigger),
+        trigger_column_(-1),
+        count_(0),
+        ring_(window),
+        ring_start_(0),
+        ring_size_(0),
+        num_after_(0) {}
+
+  virtual ~decimating_writer() {}
+
+  void operator()(const std::vector<std::string>& names) {
+    auto it = std::find(names.begin(), names.end(), trigger_);
+    trigger_column_ = it == names.end() ? -1 : it - names.begin();
+    writer_(names);
+  }
+
+  void operator()(const std::vector<double>& state) {
+    const std::vector<double>& row = round(state);
+    if (window_ == 0) {
+      if (count_++ % thin_ == 0)
+        writer_(row);
+      return;
+    }
+    bool triggered = trigger_column_ >= 0
+                     && static_cast<size_t>(trigger_column_) < row.size()
+                     && row[trigger_column_] != 0;
+    if (triggered) {
+      for (size_t i = 0; i < ring_size_; ++i)
+        writer_(ring_[(ring_start_ + i) % window_]);
+      ring_size_ = 0;
+      writer_(row);
+      num_after_ = window_;
+    } else if (num_after_ > 0) {
+      writer_(row);
+      --num_after_;
+    } else {
+      // Overwrite the oldest row once the ring is full
+      size_t slot = (ring_start_ + ring_size_) % window_;
+      ring_[slot].assign(row.begin(), row.end());
+      if (ring_size_ < window_)
+        ++ring_size_;
+      else
+        ring_start_ = (ring_start_ + 1) % window_;
+    }
+  }
+
+  void operator()() { writer_(); }
+
+  void operator()(const std::string& message) { writer_(message); }
+
+ private:
+  writer& writer_;
+  size_t thin_;
+  bool single_precision_;
+  size_t window_;
+  std::string trigger_;
+  int trigger_column_;
+  size_t count_;
+  std::vector<std::vector<double>> ring_;
+  size_t ring_start_;
+  size_t ring_size_;
+  size_t num_after_;
+  std::vector<double> rounded_;
+
+  const std::vector<double>& round(const std::vector<double>& state) {
+    if (!single_precision_)
+      return state;
+    rounded_.resize(state.size());
+    for (size_t i = 0; i < state.size(); ++i)
+      rounded_[i] = static_cast<float>(state[i]);
+    return rounded_;
+  }
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
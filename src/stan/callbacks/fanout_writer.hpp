@@ -0,0 +1,299 @@
+#ifndef STAN_CALLBACKS_FANOUT_WRITER_HPP
+#define STAN_CALLBACKS_FANOUT_WRITER_HPP
+
+#include <stan/callbacks/async_writer.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>fanout_writer</code> is an implementation of <code>writer</code>
+ * that writes to any number of sinks, generalizing
+ * <code>tee_writer</code>.
+ *
+ * A sink is either called directly, on the thread writing through the
+ * fan-out, or threaded, with its own background thread. Calls for the
+ * threaded sinks are copied once into a slot of a bounded ring buffer
+ * shared by all of them; each slot counts the threaded sinks that have
+ * yet to forward it and is reused once the count drops to zero. A
+ * threaded sink that is slow therefore holds up the others only once
+ * the whole buffer is ahead of it, and with
+ * <code>backpressure::drop</code> the writing thread never waits: draws
+ * that find the buffer full are discarded for every threaded sink and
+ * counted.
+ *
+ * As with <code>async_writer</code>, only draws are written
+ * asynchronously. Names, messages and blank lines are flushed, so the
+ * sinks have received everything written before them once the call
+ * returns. The buffer is also flushed on destruction. An exception
+ * thrown by a threaded sink is rethrown by the next call to the
+ * fan-out or to <code>flush()</code>; that sink receives no more calls.
+ *
+ * Sinks must be added before anything is written, and the fan-out, like
+ * the other writers, must not be called from two threads at once.
+ */
+class fanout_writer : public writer {
+ public:
+  /**
+   * @param[in] capacity number of calls the buffer holds
+   * @param[in] policy what to do with a draw when the buffer is full
+   * @throw std::invalid_argument if the capacity is zero
+   */
+  explicit fanout_writer(size_t capacity = 1024,
+                         backpressure policy = backpressure::block)
+      : capacity_(capacity),
+        slots_(new slot[capacity]),
+        policy_(policy),
+        tail_(0),
+        num_dropped_(0),
+        producer_waiting_(false),
+        failed_(false),
+        stop_(false) {
+    if (capacity == 0)
+      throw std::invalid_argument("fanout_writer capacity must be positive");
+  }
+
+  /**
+   * Flushes the buffer and stops the background threads. Errors of the
+   * sinks that were not rethrown yet are dropped.
+   */
+  virtual ~fanout_writer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_.store(true);
+    }
+    cv_.notify_all();
+    for (auto& s : threaded_)
+      s->thread.join();
+  }
+
+  /**
+   * Add a sink.
+   *
+   * @param[in, out] writer sink
+   * @param[in] threaded whether the sink gets its own background thread
+   * @throw std::logic_error if anything has been written already
+   */
+  void add(writer& writer, bool threaded = true) {
+    if (tail_.load() > 0)
+      throw std::logic_error(
+          "fanout_writer: sinks must be added before writing");
+    if (!threaded) {
+      direct_.push_back(&writer);
+      return;
+    }
+    threaded_.emplace_back(new sink(writer));
+    sink* s = threaded_.back().get();
+    s->thread = std::thread([this, s]() { run(*s); });
+  }
+
+  void operator()(const std::vector<std::string>& names) {
+    push(false, [&names](message& m) {
+      m.type = message::names_call;
+      m.names = names;
+    });
+    for (writer* w : direct_)
+      (*w)(names);
+    flush();
+  }
+
+  void operator()(const std::vector<double>& state) {
+    push(true, [&state](message& m) {
+      m.type = message::values_call;
+      m.values.assign(state.begin(), state.end());
+    });
+    for (writer* w : direct_)
+      (*w)(state);
+  }
+
+  void operator()() {
+    push(false, [](message& m) { m.type = message::blank_call; });
+    for (writer* w : direct_)
+      (*w)();
+    flush();
+  }
+
+  void operator()(const std::string& text) {
+    push(false, [&text](message& m) {
+      m.type = message::text_call;
+      m.text = text;
+    });
+    for (writer* w : direct_)
+      (*w)(text);
+    flush();
+  }
+
+  /**
+   * Wait until every threaded sink has forwarded every call queued so
+   * far.
+   *
+   * @throw any exception a threaded sink threw
+   */
+  void flush() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      producer_waiting_.store(true);
+      cv_.wait(lock, [&]() {
+        for (auto& s : threaded_)
+          if (s->head.load() != tail)
+            return false;
+        return true;
+      });
+      producer_waiting_.store(false);
+    }
+    rethrow();
+  }
+
+  /**
+   * Return the number of draws discarded because the buffer was full.
+   */
+  size_t num_dropped() const { return num_dropped_.load(); }
+
+ private:
+  struct message {
+    enum kind { names_call, values_call, blank_call, text_call };
+    kind type;
+    std::vector<std::string> names;
+    std::vector<double> values;
+    std::string text;
+  };
+
+  struct slot {
+    slot() : refs(0) {}
+    message m;
+    // Threaded sinks that have yet to forward the message
+    std::atomic<size_t> refs;
+  };
+
+  struct sink {
+    explicit sink(writer& w)
+        : writer_(w), head(0), waiting(false), failed(false) {}
+    writer& writer_;
+    // Calls forwarded since construction
+    std::atomic<size_t> head;
+    std::atomic<bool> waiting;
+    bool failed;
+    std::thread thread;
+  };
+
+  template <class F>
+  void push(bool droppable, const F& fill) {
+    rethrow();
+    if (threaded_.empty())
+      return;
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    slot& s = slots_[tail % capacity_];
+    if (s.refs.load() != 0) {
+      if (droppable && policy_ == backpressure::drop) {
+        ++num_dropped_;
+        return;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      producer_waiting_.store(true);
+      cv_.wait(lock, [&]() { return s.refs.load() == 0; });
+      producer_waiting_.store(false);
+    }
+    fill(s.m);
+    s.refs.store(threaded_.size());
+    tail_.store(tail + 1);
+    for (auto& t : threaded_) {
+      if (t->waiting.load()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+        break;
+      }
+    }
+  }
+
+  void run(sink& t) {
+    while (true) {
+      size_t head = t.head.load(std::memory_order_relaxed);
+      if (head == tail_.load()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        t.waiting.store(true);
+        cv_.wait(lock, [&]() { return head != tail_.load() || stop_.load(); });
+        t.waiting.store(false);
+        if (head == tail_.load())
+          return;
+      }
+      slot& s = slots_[head % capacity_];
+      if (!t.failed)
+        forward(t, s.m);
+      t.head.store(head + 1);
+      bool released = s.refs.fetch_sub(1) == 1;
+      if (producer_waiting_.load() && (released || head + 1 == tail_.load())) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+      }
+    }
+  }
+
+  void forward(sink& t, const message& m) {
+    try {
+      switch (m.type) {
+        case message::names_call:
+          t.writer_(m.names);
+          break;
+        case message::values_call:
+          t.writer_(m.values);
+          break;
+        case message::blank_call:
+          t.writer_();
+          break;
+        case message::text_call:
+          t.writer_(m.text);
+          break;
+      }
+    } catch (...) {
+      t.failed = true;
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_)
+        error_ = std::current_exception();
+      failed_.store(true);
+    }
+  }
+
+  void rethrow() {
+    if (!failed_.load())
+      return;
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(error, error_);
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  size_t capacity_;
+  std::unique_ptr<slot[]> slots_;
+  backpressure policy_;
+  std::vector<writer*> direct_;
+  std::vector<std::unique_ptr<sink>> threaded_;
+  // Calls queued since construction
+  std::atomic<size_t> tail_;
+  std::atomic<size_t> num_dropped_;
+  std::atomic<bool> producer_waiting_;
+  std::atomic<bool> failed_;
+  std::atomic<bool> stop_;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
@@ -0,0 +1,148 @@
+#ifndef STAN_CALLBACKS_GZIP_WRITER_HPP
+#define STAN_CALLBACKS_GZIP_WRITER_HPP
+
+#include <stan/callbacks/stream_writer.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <zlib.h>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>gzip_writer</code> is an implementation of <code>writer</code>
+ * that writes the same csv text as <code>stream_writer</code>, gzip
+ * compressed, to a stream that should be opened in binary mode.
+ *
+ * The text is compressed in independent frames: once the text buffered
+ * since the last frame reaches the frame size, it is written as a
+ * complete gzip member. A sequence of members is itself a valid gzip
+ * file, so the output can be read with the usual tools. Every frame
+ * can be decompressed on its own, so a reader can start at any frame
+ * boundary and a crash loses at most the frame being filled.
+ *
+ * Using this writer requires linking against zlib.
+ */
+class gzip_writer : public writer {
+ public:
+  /**
+   * Constructs a gzip writer with an output stream, an optional prefix
+   * for comments, the uncompressed size of the frames and the
+   * compression level.
+   *
+   * @param[in, out] output stream to write
+   * @param[in] comment_prefix string to stream before each comment line.
+   *   Default is "".
+   * @param[in] frame_size uncompressed bytes per frame. Default is 1 MiB.
+   * @param[in] level zlib compression level, from 1 (fastest) to 9
+   *   (smallest). Default is 6.
+   * @throw std::runtime_error if zlib can't be initialized
+   */
+  explicit gzip_writer(std::ostream& output,
+                       const std::string& comment_prefix = "",
+                       size_t frame_size = 1 << 20, int level = 6)
+      : output_(output),
+        formatter_(text_, comment_prefix),
+        frame_size_(frame_size) {
+    stream_.zalloc = Z_NULL;
+    stream_.zfree = Z_NULL;
+    stream_.opaque = Z_NULL;
+    // 16 added to the window bits selects the gzip wrapper
+    if (deflateInit2(&stream_, level, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY)
+        != Z_OK)
+      throw std::runtime_error("gzip_writer: can't initialize zlib");
+  }
+
+  /**
+   * Writes the frame being filled and releases zlib.
+   */
+  virtual ~gzip_writer() {
+    try {
+      flush();
+    } catch (const std::exception& e) {
+    }
+    deflateEnd(&stream_);
+  }
+
+  void operator()(const std::vector<std::string>& names) {
+    formatter_(names);
+    fill();
+  }
+
+  void operator()(const std::vector<double>& state) {
+    formatter_(state);
+    fill();
+  }
+
+  void operator()() {
+    formatter_();
+    fill();
+  }
+
+  void operator()(const std::string& message) {
+    formatter_(message);
+    fill();
+  }
+
+  /**
+   * Formats values with <code>stream_writer::use_fast_format</code>.
+   *
+   * @param[in] precision number of significant digits, or 0 for the
+   *   shortest round-trip representation
+   */
+  void use_fast_format(int precision = 0) {
+    formatter_.use_fast_format(precision);
+  }
+
+  /**
+   * Writes the text buffered so far as a frame, if there is any, and
+   * flushes the output stream.
+   *
+   * @throw std::runtime_error if compression fails
+   */
+  void flush() {
+    std::string text = text_.str();
+    if (!text.empty()) {
+      write_frame(text);
+      text_.str("");
+    }
+    output_.flush();
+  }
+
+ private:
+  std::ostream& output_;
+  std::stringstream text_;
+  stream_writer formatter_;
+  size_t frame_size_;
+  z_stream stream_;
+  std::vector<unsigned char> compressed_;
+
+  void fill() {
+    if (static_cast<size_t>(text_.tellp()) >= frame_size_)
+      flush();
+  }
+
+  void write_frame(const std::string& text) {
+    compressed_.resize(deflateBound(&stream_, text.size()));
+    stream_.next_in
+        = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    stream_.avail_in = text.size();
+    stream_.next_out = compressed_.data();
+    stream_.avail_out = compressed_.size();
+    int ret = deflate(&stream_, Z_FINISH);
+    if (ret != Z_STREAM_END)
+      throw std::runtime_error("gzip_writer: compression failed");
+    output_.write(reinterpret_cast<const char*>(compressed_.data()),
+                  compressed_.size() - stream_.avail_out);
+    deflateReset(&stream_);
+  }
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
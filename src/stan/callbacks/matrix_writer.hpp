@@ -0,0 +1,105 @@
+#ifndef STAN_CALLBACKS_MATRIX_WRITER_HPP
+#define STAN_CALLBACKS_MATRIX_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>matrix_writer</code> is an implementation of <code>writer</code>
+ * that keeps the draws in memory, one per row of a column major matrix,
+ * for applications that embed the samplers.
+ *
+ * The matrix is allocated once the names are written, with as many rows
+ * as the expected number of draws: <code>ceil(num_samples /
+ * num_thin)</code>, plus the saved warmup draws. Each draw is copied
+ * straight into its row. Should more draws arrive than expected the
+ * matrix grows, doubling its rows. Messages and blank lines are kept
+ * as strings; a blank line is kept as an empty string.
+ */
+class matrix_writer : public writer {
+ public:
+  /**
+   * @param[in] num_draws expected number of draws
+   */
+  explicit matrix_writer(size_t num_draws)
+      : num_draws_(num_draws), num_rows_(0) {}
+
+  virtual ~matrix_writer() {}
+
+  /**
+   * Stores the names and allocates the matrix with one column per name.
+   * Draws written before are discarded.
+   *
+   * @param[in] names Names in a std::vector
+   */
+  void operator()(const std::vector<std::string>& names) {
+    names_ = names;
+    draws_.resize(num_draws_, names.size());
+    num_rows_ = 0;
+  }
+
+  /**
+   * Copies a draw into the next row of the matrix.
+   *
+   * @param[in] state Values in a std::vector
+   * @throw std::invalid_argument if the number of values doesn't match
+   *   the number of names
+   */
+  void operator()(const std::vector<double>& state) {
+    if (state.size() != static_cast<size_t>(draws_.cols()))
+      throw std::invalid_argument(
+          "matrix_writer: number of values doesn't match the number of "
+          "names");
+    if (num_rows_ == draws_.rows())
+      draws_.conservativeResize(std::max<Eigen::Index>(1, 2 * num_rows_),
+                                Eigen::NoChange);
+    draws_.row(num_rows_++)
+        = Eigen::Map<const Eigen::RowVectorXd>(state.data(), state.size());
+  }
+
+  void operator()() { messages_.emplace_back(); }
+
+  void operator()(const std::string& message) {
+    messages_.push_back(message);
+  }
+
+  /**
+   * Return the draws written so far, one per row, without copying them.
+   */
+  Eigen::Block<const Eigen::MatrixXd> draws() const {
+    return draws_.topRows(num_rows_);
+  }
+
+  /**
+   * Return the number of draws written so far.
+   */
+  Eigen::Index num_draws() const { return num_rows_; }
+
+  /**
+   * Return the names of the columns.
+   */
+  const std::vector<std::string>& names() const { return names_; }
+
+  /**
+   * Return the messages written, in order.
+   */
+  const std::vector<std::string>& messages() const { return messages_; }
+
+ private:
+  Eigen::Index num_draws_;
+  Eigen::Index num_rows_;
+  std::vector<std::string> names_;
+  Eigen::MatrixXd draws_;
+  std::vector<std::string> messages_;
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
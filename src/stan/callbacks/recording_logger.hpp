@@ -0,0 +1,69 @@
+#ifndef STAN_CALLBACKS_RECORDING_LOGGER_HPP
+#define STAN_CALLBACKS_RECORDING_LOGGER_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * <code>recording_logger</code> records the messages logged to it, with
+ * their levels, so they can be replayed in order to another logger
+ * later. This lets work done concurrently log its messages in the
+ * order the work would have been done in serially.
+ */
+class recording_logger : public logger {
+ public:
+  void debug(const std::string& message) { add(0, message); }
+  void debug(const std::stringstream& message) { add(0, message.str()); }
+  void info(const std::string& message) { add(1, message); }
+  void info(const std::stringstream& message) { add(1, message.str()); }
+  void warn(const std::string& message) { add(2, message); }
+  void warn(const std::stringstream& message) { add(2, message.str()); }
+  void error(const std::string& message) { add(3, message); }
+  void error(const std::stringstream& message) { add(3, message.str()); }
+  void fatal(const std::string& message) { add(4, message); }
+  void fatal(const std::stringstream& message) { add(4, message.str()); }
+
+  /**
+   * Log the recorded messages to the specified logger, in the order
+   * they were recorded and at their levels.
+   *
+   * @param[in,out] logger logger to replay the messages to
+   */
+  void replay(logger& logger) const {
+    for (const std::pair<int, std::string>& message : messages_) {
+      switch (message.first) {
+        case 0:
+          logger.debug(message.second);
+          break;
+        case 1:
+          logger.info(message.second);
+          break;
+        case 2:
+          logger.warn(message.second);
+          break;
+        case 3:
+          logger.error(message.second);
+          break;
+        default:
+          logger.fatal(message.second);
+      }
+    }
+  }
+
+ private:
+  std::vector<std::pair<int, std::string>> messages_;
+
+  void add(int level, const std::string& message) {
+    messages_.emplace_back(level, message);
+  }
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
@@ -0,0 +1,229 @@
+#ifndef STAN_CALLBACKS_SHM_WRITER_HPP
+#define STAN_CALLBACKS_SHM_WRITER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace callbacks {
+
+/**
+ * Layout of a shared memory segment that draws are published to.
+ *
+ * The segment starts with a header made of the 8 byte magic string
+ * <code>STANSHM1</code> and five <code>uint64</code>: a ready flag,
+ * set once the rest of the segment is initialized, the number of
+ * chains, the number of columns, the number of draws each chain's ring
+ * holds, and the size in bytes of the names that follow. The names are
+ * separated by newlines and padded with zeros to a multiple of 8
+ * bytes.
+ *
+ * Each chain then has a ring made of a <code>uint64</code> count of the
+ * draws published so far followed by its slots. Every slot is a
+ * <code>uint64</code> sequence number followed by the values of one
+ * draw. Draw <code>n</code> is written to slot <code>n % capacity</code>,
+ * whose sequence number is odd while the draw is being written and
+ * <code>2 * n + 2</code> once it is complete, so readers can detect
+ * draws that were torn or overwritten while they were copied.
+ */
+struct shm_layout {
+  static const char* magic() { return "STANSHM1"; }
+
+  static constexpr size_t header_size = 48;
+
+  size_t num_chains;
+  size_t num_cols;
+  size_t capacity;
+  size_t names_size;
+
+  size_t names_offset() const { return header_size; }
+
+  size_t padded_names_size() const { return (names_size + 7) / 8 * 8; }
+
+  size_t slot_size() const { return 8 * (1 + num_cols); }
+
+  size_t chain_size() const { return 8 + capacity * slot_size(); }
+
+  size_t chain_offset(size_t chain) const {
+    return header_size + padded_names_size() + chain * chain_size();
+  }
+
+  size_t slot_offset(size_t chain, uint64_t n) const {
+    return chain_offset(chain) + 8 + (n % capacity) * slot_size();
+  }
+
+  size_t size() const { return chain_offset(num_chains); }
+
+  static std::atomic<uint64_t>& word(char* base, size_t offset) {
+    return *reinterpret_cast<std::atomic<uint64_t>*>(base + offset);
+  }
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8,
+              "shared memory words must be 8 bytes");
+
+/**
+ * A named shared memory segment that one or more chains publish their
+ * draws to, so that other processes can follow them while sampling,
+ * through <code>io::shm_reader</code>.
+ *
+ * The segment is created when the first chain writes its names, sized
+ * for a ring of draws per chain; all chains must write the same names.
+ * Each ring keeps the latest draws and never waits for readers, so a
+ * reader that falls behind by more than the capacity misses draws. The
+ * segment is removed on destruction; readers that have mapped it keep
+ * their mapping.
+ */
+class shm_segment {
+ public:
+  /**
+   * @param[in] name name of the shared memory object, e.g.
+   *   <code>stan_draws</code>
+   * @param[in] num_chains number of chains publishing to the segment
+   * @param[in] capacity number of draws each chain's ring holds
+   * @throw std::invalid_argument if the number of chains or the
+   *   capacity is zero
+   */
+  shm_segment(const std::string& name, size_t num_chains,
+              size_t capacity = 1024)
+      : name_(name), layout_{num_chains, 0, capacity, 0}, base_(nullptr) {
+    if (num_chains == 0 || capacity == 0)
+      throw std::invalid_argument(
+          "shm_segment: number of chains and capacity must be positive");
+  }
+
+  ~shm_segment() {
+    if (base_)
+      boost::interprocess::shared_memory_object::remove(name_.c_str());
+  }
+
+  shm_segment(const shm_segment&) = delete;
+  shm_segment& operator=(const shm_segment&) = delete;
+
+  /**
+   * Create the segment for the names if no chain has yet, or check the
+   * names match those it was created for.
+   *
+   * @param[in] names column names
+   * @throw std::invalid_argument if the names differ from those of
+   *   another chain
+   */
+  void initialize(const std::vector<std::string>& names) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string joined;
+    for (size_t i = 0; i < names.size(); ++i)
+      joined += (i > 0 ? "\n" : "") + names[i];
+    if (base_) {
+      if (joined != names_)
+        throw std::invalid_argument(
+            "shm_segment: all chains must write the same names");
+      return;
+    }
+    names_ = joined;
+    layout_.num_cols = names.size();
+    layout_.names_size = joined.size();
+
+    using boost::interprocess::shared_memory_object;
+    // Left over by a run that didn't finish
+    shared_memory_object::remove(name_.c_str());
+    shared_memory_object shm(boost::interprocess::create_only, name_.c_str(),
+                             boost::interprocess::read_write);
+    shm.truncate(layout_.size());
+    region_ = std::make_unique<boost::interprocess::mapped_region>(
+        shm, boost::interprocess::read_write);
+    base_ = static_cast<char*>(region_->get_address());
+
+    std::memset(base_, 0, layout_.size());
+    std::memcpy(base_, shm_layout::magic(), 8);
+    uint64_t sizes[4] = {layout_.num_chains, layout_.num_cols,
+                         layout_.capacity, layout_.names_size};
+    std::memcpy(base_ + 16, sizes, sizeof(sizes));
+    std::memcpy(base_ + layout_.names_offset(), joined.data(),
+                joined.size());
+    shm_layout::word(base_, 8).store(1, std::memory_order_release);
+  }
+
+  /**
+   * Publish a draw of a chain.
+   *
+   * @param[in] chain index of the chain, from zero
+   * @param[in] values values of the draw
+   * @throw std::invalid_argument if the segment isn't initialized, the
+   *   chain is out of range or the number of values doesn't match the
+   *   number of names
+   */
+  void publish(size_t chain, const std::vector<double>& values) {
+    if (!base_ || chain >= layout_.num_chains
+        || values.size() != layout_.num_cols)
+      throw std::invalid_argument(
+          "shm_segment: draw doesn't match the segment");
+    std::atomic<uint64_t>& count
+        = shm_layout::word(base_, layout_.chain_offset(chain));
+    uint64_t n = count.load(std::memory_order_relaxed);
+    size_t offset = layout_.slot_offset(chain, n);
+    std::atomic<uint64_t>& seq = shm_layout::word(base_, offset);
+    seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(base_ + offset + 8, values.data(), 8 * values.size());
+    seq.store(2 * n + 2, std::memory_order_release);
+    count.store(n + 1, std::memory_order_release);
+  }
+
+  const std::string& name() const { return name_; }
+
+ private:
+  std::string name_;
+  shm_layout layout_;
+  std::string names_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  char* base_;
+  std::mutex mutex_;
+};
+
+/**
+ * <code>shm_writer</code> is an implementation of <code>writer</code>
+ * that publishes the draws of one chain to a shared memory segment.
+ * Several writers, one per chain, can share a segment, e.g. as the
+ * sample writers of the multi-chain services. Messages and blank lines
+ * are not published.
+ */
+class shm_writer : public writer {
+ public:
+  /**
+   * @param[in, out] segment segment to publish to
+   * @param[in] chain index of the chain in the segment, from zero
+   */
+  shm_writer(shm_segment& segment, size_t chain)
+      : segment_(&segment), chain_(chain) {}
+
+  virtual ~shm_writer() {}
+
+  void operator()(const std::vector<std::string>& names) {
+    segment_->initialize(names);
+  }
+
+  void operator()(const std::vector<double>& state) {
+    segment_->publish(chain_, state);
+  }
+
+  void operator()() {}
+
+  void operator()(const std::string& message) {}
+
+ private:
+  shm_segment* segment_;
+  size_t chain_;
+};
+
+}  // namespace callbacks
+}  // namespace stan
+#endif
@@ -2,9 +2,17 @@
 #define STAN_CALLBACKS_STREAM_WRITER_HPP
 
 #include <stan/callbacks/writer.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <ostream>
 #include <vector>
 #include <string>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
 
 namespace stan {
 namespace callbacks {
@@ -25,7 +33,10 @@ class stream_writer : public writer {
    */
   explicit stream_writer(std::ostream& output,
                          const std::string& comment_prefix = "")
-      : output_(output), comment_prefix_(comment_prefix) {}
+      : output_(output),
+        comment_prefix_(comment_prefix),
+        fast_format_(false),
+        precision_(0) {}
 
   /**
    * Virtual destructor
@@ -48,11 +59,36 @@ class stream_writer : public writer {
    * Writes a set of values in csv format followed by a newline.
    *
    * Note: the precision of the output is determined by the settings
-   *  of the stream on construction.
+   *  of the stream on construction, unless the fast format is used.
    *
    * @param[in] state Values in a std::vector
    */
-  void operator()(const std::vector<double>& state) { write_vector(state); }
+  void operator()(const std::vector<double>& state) {
+    if (fast_format_)
+      write_fast(state);
+    else
+      write_vector(state);
+  }
+
+  /**
+   * Format values into a reusable buffer that is written to the stream
+   * with a single call per row, rather than streaming each value
+   * through the locale and the stream's formatting flags. Rows end with
+   * a newline but, unlike the stream formatting, don't flush the
+   * stream.
+   *
+   * With a precision the values are formatted as
+   * <code>std::setprecision(precision)</code> formats them on a default
+   * stream. Without one, each value is written with the fewest digits
+   * that read back as the same double.
+   *
+   * @param[in] precision number of significant digits, at most 17, or
+   *   0 for the shortest round-trip representation
+   */
+  void use_fast_format(int precision = 0) {
+    fast_format_ = true;
+    precision_ = std::min(precision, 17);
+  }
 
   /**
    * Writes the comment_prefix to the stream followed by a newline.
@@ -79,6 +115,63 @@ class stream_writer : public writer {
    */
   std::string comment_prefix_;
 
+  bool fast_format_;
+  int precision_;
+
+  /**
+   * Row being formatted by the fast format
+   */
+  std::string buffer_;
+
+  /**
+   * Appends a value to the buffer.
+   *
+   * @param[in] x value
+   */
+  void append(double x) {
+    char digits[32];
+    int n;
+#ifdef __cpp_lib_to_chars
+    std::to_chars_result result
+        = precision_ > 0 ? std::to_chars(digits, digits + sizeof(digits), x,
+                                         std::chars_format::general,
+                                         precision_)
+                         : std::to_chars(digits, digits + sizeof(digits), x);
+    n = result.ptr - digits;
+#else
+    if (precision_ > 0) {
+      n = std::snprintf(digits, sizeof(digits), "%.*g", precision_, x);
+    } else {
+      // Shortest of 15, 16 or 17 significant digits that round trips
+      for (int p = 15; p <= 17; ++p) {
+        n = std::snprintf(digits, sizeof(digits), "%.*g", p, x);
+        if (p == 17 || std::strtod(digits, nullptr) == x)
+          break;
+      }
+    }
+#endif
+    buffer_.append(digits, n);
+  }
+
+  /**
+   * Writes a set of values in csv format followed by a newline using
+   * the fast format.
+   *
+   * @param[in] v Values in a std::vector
+   */
+  void write_fast(const std::vector<double>& v) {
+    if (v.empty())
+      return;
+    buffer_.clear();
+    for (size_t i = 0; i < v.size(); ++i) {
+      if (i > 0)
+        buffer_ += ',';
+      append(v[i]);
+    }
+    buffer_ += '\n';
+    output_.write(buffer_.data(), buffer_.size());
+  }
+
   /**
    * Writes a set of values in csv format followed by a newline.
    *
@@ -5,13 +5,13 @@
 #include <stan/io/validate_dims.hpp>
 #include <stan/math.hpp>
 #include <stan/math/prim/fun/Eigen.hpp>
-#include <map>
 #include <algorithm>
 #include <functional>
 #include <numeric>
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -30,8 +30,10 @@ class array_var_context : public var_context {
   template <typename T>
   using data_pair_t = std::pair<std::vector<T>, std::vector<size_t>>;
 
-  std::map<std::string, data_pair_t<double>> vars_r_;  // Holds data for reals
-  std::map<std::string, data_pair_t<int>> vars_i_;     // Holds data for doubles
+  // Holds data for reals
+  std::unordered_map<std::string, data_pair_t<double>> vars_r_;
+  // Holds data for integers
+  std::unordered_map<std::string, data_pair_t<int>> vars_i_;
   // When search for variable name fails, return one these
   const std::vector<double> empty_vec_r_;
   const std::vector<int> empty_vec_i_;
@@ -287,6 +289,21 @@ class array_var_context : public var_context {
     return empty_vec_r_;
   }
 
+  /**
+   * Return a view of the double values for the variable with the
+   * specified name, which refers to the stored values unless they are
+   * integers.
+   *
+   * @param name Name of variable.
+   * @return View of the values of variable.
+   */
+  values_view<double> vals_r_view(const std::string& name) const {
+    const auto ret_val_r = vars_r_.find(name);
+    if (ret_val_r != vars_r_.end())
+      return values_view<double>(ret_val_r->second.first);
+    return values_view<double>(vals_r(name));
+  }
+
   /**
    * Return the dimensions for the double variable with the specified
    * name.
@@ -322,6 +339,20 @@ class array_var_context : public var_context {
     return empty_vec_i_;
   }
 
+  /**
+   * Return a view of the integer values for the variable with the
+   * specified name.
+   *
+   * @param name Name of variable.
+   * @return View of the values.
+   */
+  values_view<int> vals_i_view(const std::string& name) const {
+    auto ret_val_i = vars_i_.find(name);
+    if (ret_val_i != vars_i_.end())
+      return values_view<int>(ret_val_i->second.first);
+    return values_view<int>();
+  }
+
   /**
    * Return the dimensions for the integer variable with the specified
    * name.
@@ -366,6 +397,7 @@ class array_var_context : public var_context {
     for (const auto& vars_r_iter : vars_r_) {
       names.push_back(vars_r_iter.first);
     }
+    std::sort(names.begin(), names.end());
   }
 
   /**
@@ -377,9 +409,10 @@ class array_var_context : public var_context {
   virtual void names_i(std::vector<std::string>& names) const {
     names.clear();
     names.reserve(vars_i_.size());
-    for (const auto& vars_i_iter : vars_r_) {
+    for (const auto& vars_i_iter : vars_i_) {
       names.push_back(vars_i_iter.first);
     }
+    std::sort(names.begin(), names.end());
   }
 
   /**
@@ -0,0 +1,306 @@
+#ifndef STAN_IO_BINARY_VAR_CONTEXT_HPP
+#define STAN_IO_BINARY_VAR_CONTEXT_HPP
+
+#include <stan/io/var_context.hpp>
+#include <stan/io/validate_dims.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * A <code>binary_var_context</code> reads named arrays from a memory
+ * mapped binary data file, so that large data sets are mapped instead
+ * of parsed and processes reading the same file share its pages.
+ *
+ * The file starts with the 8 byte magic string <code>STANDAT1</code>
+ * and a <code>uint64</code> number of variables, followed by an entry
+ * per variable: a <code>uint32</code> length of the name, a
+ * <code>uint32</code> type, 0 for doubles and 1 for 32 bit integers, a
+ * <code>uint64</code> number of dimensions, a <code>uint64</code>
+ * offset of the values from the start of the file, the name, padded
+ * with zeros to a multiple of 8 bytes, and a <code>uint64</code> per
+ * dimension. The values of each variable are stored in last-index
+ * major order, as in the dump format, at an offset that is a multiple
+ * of 8. Numbers are in the byte order of the machine that wrote the
+ * file, which <code>write()</code> produces from any other
+ * <code>var_context</code>.
+ *
+ * Only the entries are read on construction; values are copied out of
+ * the mapping when they are requested. As with <code>dump</code>,
+ * integer variables are also available as doubles.
+ */
+class binary_var_context : public var_context {
+ public:
+  /**
+   * Map a binary data file.
+   *
+   * @param path path of the file
+   * @throw std::invalid_argument if the file can't be mapped or isn't a
+   *   valid binary data file
+   */
+  explicit binary_var_context(const std::string& path) {
+    using boost::interprocess::file_mapping;
+    using boost::interprocess::mapped_region;
+    try {
+      file_mapping file(path.c_str(), boost::interprocess::read_only);
+      region_ = std::make_unique<mapped_region>(
+          file, boost::interprocess::read_only);
+    } catch (const boost::interprocess::interprocess_exception& e) {
+      throw std::invalid_argument("binary_var_context: can't map " + path
+                                  + ": " + e.what());
+    }
+    parse(static_cast<const char*>(region_->get_address()),
+          region_->get_size());
+  }
+
+  /**
+   * Read a binary data file already in memory, which must outlive the
+   * context and be aligned to 8 bytes.
+   *
+   * @param data start of the file
+   * @param size size of the file in bytes
+   * @throw std::invalid_argument if it isn't a valid binary data file
+   */
+  binary_var_context(const char* data, size_t size) { parse(data, size); }
+
+  /**
+   * Write the variables of a <code>var_context</code> as a binary data
+   * file.
+   *
+   * @param[in, out] out stream to write to, opened in binary mode
+   * @param context variables to write
+   */
+  static void write(std::ostream& out, const var_context& context) {
+    struct var {
+      std::string name;
+      uint32_t type;
+      std::vector<size_t> dims;
+      size_t size;
+    };
+    std::vector<var> vars;
+    std::vector<std::string> names;
+    context.names_r(names);
+    for (const std::string& name : names)
+      if (!context.contains_i(name))
+        vars.push_back({name, real_type, context.dims_r(name), 0});
+    context.names_i(names);
+    for (const std::string& name : names)
+      vars.push_back({name, int_type, context.dims_i(name), 0});
+
+    uint64_t offset = 16;
+    for (var& v : vars)
+      offset += 24 + padded(v.name.size()) + 8 * v.dims.size();
+    std::vector<uint64_t> offsets;
+    for (var& v : vars) {
+      offsets.push_back(offset);
+      v.size = v.type == int_type ? context.vals_i(v.name).size()
+                                  : context.vals_r(v.name).size();
+      offset += padded(v.size * (v.type == int_type ? 4 : 8));
+    }
+
+    out.write(magic(), 8);
+    write_word<uint64_t>(out, vars.size());
+    for (size_t i = 0; i < vars.size(); ++i) {
+      const var& v = vars[i];
+      write_word<uint32_t>(out, v.name.size());
+      write_word<uint32_t>(out, v.type);
+      write_word<uint64_t>(out, v.dims.size());
+      write_word<uint64_t>(out, offsets[i]);
+      out.write(v.name.data(), v.name.size());
+      write_padding(out, v.name.size());
+      for (size_t d : v.dims)
+        write_word<uint64_t>(out, d);
+    }
+    for (const var& v : vars) {
+      if (v.type == int_type) {
+        std::vector<int> values = context.vals_i(v.name);
+        std::vector<int32_t> words(values.begin(), values.end());
+        out.write(reinterpret_cast<const char*>(words.data()),
+                  4 * words.size());
+        write_padding(out, 4 * words.size());
+      } else {
+        std::vector<double> values = context.vals_r(v.name);
+        out.write(reinterpret_cast<const char*>(values.data()),
+                  8 * values.size());
+      }
+    }
+  }
+
+  bool contains_r(const std::string& name) const {
+    return vars_.find(name) != vars_.end();
+  }
+
+  bool contains_i(const std::string& name) const {
+    auto it = vars_.find(name);
+    return it != vars_.end() && it->second.type == int_type;
+  }
+
+  std::vector<double> vals_r(const std::string& name) const {
+    auto it = vars_.find(name);
+    if (it == vars_.end())
+      return {};
+    const entry& e = it->second;
+    std::vector<double> values(e.size);
+    if (e.type == real_type) {
+      std::memcpy(values.data(), e.data, 8 * e.size);
+    } else {
+      const int32_t* ints = reinterpret_cast<const int32_t*>(e.data);
+      for (size_t i = 0; i < e.size; ++i)
+        values[i] = ints[i];
+    }
+    return values;
+  }
+
+  /**
+   * Return a view of the values of a variable, which refers to the
+   * mapped pages unless the variable holds integers.
+   */
+  values_view<double> vals_r_view(const std::string& name) const {
+    auto it = vars_.find(name);
+    if (it != vars_.end() && it->second.type == real_type)
+      return values_view<double>(
+          reinterpret_cast<const double*>(it->second.data), it->second.size);
+    return values_view<double>(vals_r(name));
+  }
+
+  std::vector<size_t> dims_r(const std::string& name) const {
+    auto it = vars_.find(name);
+    return it == vars_.end() ? std::vector<size_t>() : it->second.dims;
+  }
+
+  std::vector<int> vals_i(const std::string& name) const {
+    if (!contains_i(name))
+      return {};
+    const entry& e = vars_.find(name)->second;
+    const int32_t* ints = reinterpret_cast<const int32_t*>(e.data);
+    return std::vector<int>(ints, ints + e.size);
+  }
+
+  /**
+   * Return a view of the values of an integer variable, which refers to
+   * the mapped pages where <code>int</code> has 32 bits.
+   */
+  values_view<int> vals_i_view(const std::string& name) const {
+    if (sizeof(int) != sizeof(int32_t) || !contains_i(name))
+      return values_view<int>(vals_i(name));
+    const entry& e = vars_.find(name)->second;
+    return values_view<int>(reinterpret_cast<const int*>(e.data), e.size);
+  }
+
+  std::vector<size_t> dims_i(const std::string& name) const {
+    return contains_i(name) ? vars_.find(name)->second.dims
+                            : std::vector<size_t>();
+  }
+
+  void names_r(std::vector<std::string>& names) const {
+    names.clear();
+    for (const auto& var : vars_)
+      if (var.second.type == real_type)
+        names.push_back(var.first);
+  }
+
+  void names_i(std::vector<std::string>& names) const {
+    names.clear();
+    for (const auto& var : vars_)
+      if (var.second.type == int_type)
+        names.push_back(var.first);
+  }
+
+  void validate_dims(const std::string& stage, const std::string& name,
+                     const std::string& base_type,
+                     const std::vector<size_t>& dims_declared) const {
+    stan::io::validate_dims(*this, stage, name, base_type, dims_declared);
+  }
+
+ private:
+  static constexpr uint32_t real_type = 0;
+  static constexpr uint32_t int_type = 1;
+
+  struct entry {
+    uint32_t type;
+    std::vector<size_t> dims;
+    const char* data;
+    size_t size;
+  };
+
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  std::map<std::string, entry> vars_;
+
+  static const char* magic() { return "STANDAT1"; }
+
+  static size_t padded(size_t size) { return (size + 7) / 8 * 8; }
+
+  template <typename T>
+  static void write_word(std::ostream& out, T word) {
+    out.write(reinterpret_cast<const char*>(&word), sizeof(T));
+  }
+
+  static void write_padding(std::ostream& out, size_t size) {
+    static const char zeros[8] = {0};
+    out.write(zeros, padded(size) - size);
+  }
+
+  static void invalid(const std::string& why) {
+    throw std::invalid_argument("binary_var_context: " + why);
+  }
+
+  template <typename T>
+  static T read_word(const char* data, size_t size, size_t& pos) {
+    if (size - pos < sizeof(T))
+      invalid("truncated header");
+    T word;
+    std::memcpy(&word, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return word;
+  }
+
+  void parse(const char* data, size_t size) {
+    if (size < 16 || std::memcmp(data, magic(), 8) != 0)
+      invalid("not a binary data file");
+    size_t pos = 8;
+    uint64_t num_vars = read_word<uint64_t>(data, size, pos);
+    for (uint64_t n = 0; n < num_vars; ++n) {
+      uint32_t name_size = read_word<uint32_t>(data, size, pos);
+      entry e;
+      e.type = read_word<uint32_t>(data, size, pos);
+      uint64_t num_dims = read_word<uint64_t>(data, size, pos);
+      uint64_t offset = read_word<uint64_t>(data, size, pos);
+      if (e.type != real_type && e.type != int_type)
+        invalid("unknown type");
+      if (size - pos < padded(name_size))
+        invalid("truncated header");
+      std::string name(data + pos, name_size);
+      pos += padded(name_size);
+      if ((size - pos) / 8 < num_dims)
+        invalid("truncated header");
+      e.size = 1;
+      for (uint64_t d = 0; d < num_dims; ++d) {
+        e.dims.push_back(read_word<uint64_t>(data, size, pos));
+        if (e.dims.back() > 0 && e.size > SIZE_MAX / e.dims.back())
+          invalid("dimensions of " + name + " out of range");
+        e.size *= e.dims.back();
+      }
+      size_t width = e.type == int_type ? 4 : 8;
+      if (offset % 8 != 0 || offset > size
+          || (e.size > 0 && (size - offset) / width < e.size))
+        invalid("values of " + name + " out of bounds");
+      e.data = data + offset;
+      vars_[name] = std::move(e);
+    }
+  }
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
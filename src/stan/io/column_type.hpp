@@ -0,0 +1,159 @@
+#ifndef STAN_IO_COLUMN_TYPE_HPP
+#define STAN_IO_COLUMN_TYPE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * Storage type of a column of draws. Every draw is produced as a
+ * <code>double</code>, but integer valued quantities, indicators and
+ * parameters that don't need double precision can be stored narrower
+ * and are widened back to <code>double</code> when they are read.
+ *
+ * A value that isn't finite, as written for the generated quantities
+ * of a draw that failed, is stored in an integer column as the
+ * smallest <code>int32</code> or as 255 and read back as NaN. Other
+ * values are rounded to the nearest integer; for <code>int32</code>
+ * those that round outside (-2^31, 2^31) are stored as the smallest
+ * <code>int32</code> as well, and for <code>uint8</code> they are
+ * clamped to [0, 254].
+ */
+enum class column_type : uint8_t {
+  float64 = 0,
+  float32 = 1,
+  int32 = 2,
+  uint8 = 3
+};
+
+/**
+ * Return the number of bytes a value of a column takes.
+ */
+inline size_t column_width(column_type type) {
+  switch (type) {
+    case column_type::float32:
+    case column_type::int32:
+      return 4;
+    case column_type::uint8:
+      return 1;
+    default:
+      return 8;
+  }
+}
+
+/**
+ * Return the storage type of the named columns known from the
+ * sampler: <code>treedepth__</code> and <code>n_leapfrog__</code> are
+ * <code>int32</code> and <code>divergent__</code> is <code>uint8</code>.
+ * The types of the model columns aren't part of the model's metadata
+ * here and are those of <code>model_types</code>, which is either
+ * empty, for <code>float64</code> model columns, or has a type per
+ * model column, the columns after the sampler's.
+ *
+ * @param names names of the columns, the sample and sampler parameters
+ *   followed by those of the model
+ * @param num_sampler_columns number of leading columns that are sample
+ *   or sampler parameters
+ * @param model_types types of the model columns, or empty
+ * @return a type per column
+ */
+inline std::vector<column_type> draws_column_types(
+    const std::vector<std::string>& names, size_t num_sampler_columns,
+    const std::vector<column_type>& model_types = {}) {
+  std::vector<column_type> types(names.size(), column_type::float64);
+  for (size_t i = 0; i < num_sampler_columns && i < names.size(); ++i) {
+    if (names[i] == "treedepth__" || names[i] == "n_leapfrog__")
+      types[i] = column_type::int32;
+    else if (names[i] == "divergent__")
+      types[i] = column_type::uint8;
+  }
+  for (size_t i = 0;
+       i < model_types.size() && num_sampler_columns + i < names.size(); ++i)
+    types[num_sampler_columns + i] = model_types[i];
+  return types;
+}
+
+/**
+ * Store a value as a column type, little-endian.
+ *
+ * @param type storage type
+ * @param x value
+ * @param[out] bytes <code>column_width(type)</code> bytes to write
+ */
+inline void store_column_value(column_type type, double x,
+                               unsigned char* bytes) {
+  uint64_t bits = 0;
+  switch (type) {
+    case column_type::float32: {
+      float f = static_cast<float>(x);
+      uint32_t b;
+      std::memcpy(&b, &f, 4);
+      bits = b;
+      break;
+    }
+    case column_type::int32: {
+      // NaN fails both comparisons
+      double r = std::round(x);
+      bits = static_cast<uint32_t>(
+          r > std::numeric_limits<int32_t>::min()
+                  && r <= std::numeric_limits<int32_t>::max()
+              ? static_cast<int32_t>(r)
+              : std::numeric_limits<int32_t>::min());
+      break;
+    }
+    case column_type::uint8:
+      bits = !std::isfinite(x) ? 255
+             : x < 0           ? 0
+             : x > 254         ? 254
+                               : static_cast<uint8_t>(std::lround(x));
+      break;
+    default:
+      std::memcpy(&bits, &x, 8);
+  }
+  for (size_t i = 0; i < column_width(type); ++i)
+    bytes[i] = static_cast<unsigned char>((bits >> (8 * i)) & 0xff);
+}
+
+/**
+ * Read a value stored as a column type and widen it to a double.
+ *
+ * @param type storage type
+ * @param bytes <code>column_width(type)</code> little-endian bytes
+ * @return value
+ */
+inline double load_column_value(column_type type, const unsigned char* bytes) {
+  uint64_t bits = 0;
+  for (int i = column_width(type) - 1; i >= 0; --i)
+    bits = (bits << 8) | bytes[i];
+  switch (type) {
+    case column_type::float32: {
+      uint32_t b = static_cast<uint32_t>(bits);
+      float f;
+      std::memcpy(&f, &b, 4);
+      return f;
+    }
+    case column_type::int32: {
+      int32_t n = static_cast<int32_t>(static_cast<uint32_t>(bits));
+      return n == std::numeric_limits<int32_t>::min()
+                 ? std::numeric_limits<double>::quiet_NaN()
+                 : n;
+    }
+    case column_type::uint8:
+      return bits == 255 ? std::numeric_limits<double>::quiet_NaN() : bits;
+    default: {
+      double x;
+      std::memcpy(&x, &bits, 8);
+      return x;
+    }
+  }
+}
+
+}  // namespace io
+}  // namespace stan
+#endif
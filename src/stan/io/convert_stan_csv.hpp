@@ -0,0 +1,176 @@
+#ifndef STAN_IO_CONVERT_STAN_CSV_HPP
+#define STAN_IO_CONVERT_STAN_CSV_HPP
+
+#include <stan/io/column_type.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * Options of <code>convert_stan_csv()</code>.
+ */
+struct stan_csv_conversion {
+  // Drop the saved warmup draws of every chain
+  bool drop_warmup;
+  // Keep every thin-th draw of every chain
+  size_t thin;
+
+  stan_csv_conversion() : drop_warmup(false), thin(1) {}
+};
+
+/**
+ * Converts the Stan CSV output of one or more chains of a fit into a
+ * single stream of another format, such as the binary format of
+ * <code>stan::callbacks::binary_writer</code> or the Arrow stream of
+ * <code>stan::callbacks::arrow_writer</code>.
+ *
+ * The files are parsed in parallel, each with
+ * <code>stan_csv_reader::parse</code>, and written in order. The
+ * columns are a <code>chain__</code> column, the index of the file the
+ * draw comes from, followed by the columns of the files, whose headers
+ * must be the same. The chain, <code>treedepth__</code>,
+ * <code>n_leapfrog__</code> and <code>divergent__</code> columns are
+ * stored as integers.
+ *
+ * The metadata of the first file is written as messages before the
+ * names, the adaptation of each chain before its draws and its timing
+ * after them, as <code>mcmc_writer</code> writes them, so a reader of
+ * the format that keeps messages recovers them. The metadata,
+ * adaptation and timing of every chain are also returned.
+ *
+ * @tparam Writer writer with <code>set_column_types()</code>
+ * @param[in, out] inputs streams of the chains
+ * @param[in, out] writer writer of the merged draws
+ * @param[in] options warmup and thinning of the draws
+ * @param[out] out output stream to send messages, or a null pointer
+ * @return a <code>stan_csv</code> per chain without its samples
+ * @throws std::invalid_argument if the headers of the files differ or
+ *   the thinning isn't positive
+ */
+template <class Writer>
+std::vector<stan_csv> convert_stan_csv(const std::vector<std::istream*>& inputs,
+                                       Writer& writer,
+                                       const stan_csv_conversion& options,
+                                       std::ostream* out) {
+  if (options.thin < 1)
+    throw std::invalid_argument(
+        "convert_stan_csv: the thinning must be positive");
+  std::vector<stan_csv> chains(inputs.size());
+  std::vector<std::stringstream> messages(inputs.size());
+  std::vector<std::string> errors(inputs.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, inputs.size()),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      for (size_t i = r.begin(); i != r.end(); ++i) {
+                        try {
+                          chains[i] = stan_csv_reader::parse(*inputs[i],
+                                                             &messages[i]);
+                        } catch (const std::exception& e) {
+                          errors[i] = e.what();
+                        }
+                      }
+                    });
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (out)
+      *out << messages[i].str();
+    if (!errors[i].empty())
+      throw std::invalid_argument(errors[i]);
+    if (chains[i].header != chains[0].header)
+      throw std::invalid_argument(
+          "convert_stan_csv: header of chain " + std::to_string(i)
+          + " does not match the header of chain 0");
+  }
+  if (chains.empty())
+    return chains;
+
+  const stan_csv_metadata& metadata = chains[0].metadata;
+  bool save_warmup = metadata.save_warmup && !options.drop_warmup;
+  writer("stan_version_major = "
+         + std::to_string(metadata.stan_version_major));
+  writer("stan_version_minor = "
+         + std::to_string(metadata.stan_version_minor));
+  writer("stan_version_patch = "
+         + std::to_string(metadata.stan_version_patch));
+  writer("model = " + metadata.model);
+  writer("num_samples = " + std::to_string(metadata.num_samples));
+  writer("num_warmup = " + std::to_string(metadata.num_warmup));
+  writer("save_warmup = " + std::to_string(save_warmup));
+  writer("thin = " + std::to_string(metadata.thin * options.thin));
+  writer("algorithm = " + metadata.algorithm);
+  writer("engine = " + metadata.engine);
+  writer("max_depth = " + std::to_string(metadata.max_depth));
+
+  std::vector<std::string> names{"chain__"};
+  names.insert(names.end(), chains[0].header.begin(), chains[0].header.end());
+  size_t num_sampler_columns = 0;
+  while (num_sampler_columns < names.size()
+         && names[num_sampler_columns].size() > 2
+         && names[num_sampler_columns].compare(
+                names[num_sampler_columns].size() - 2, 2, "__")
+                == 0)
+    ++num_sampler_columns;
+  std::vector<column_type> types
+      = draws_column_types(names, num_sampler_columns);
+  types[0] = column_type::int32;
+  writer(names);
+  writer.set_column_types(types);
+
+  std::vector<double> row(names.size());
+  for (size_t i = 0; i < chains.size(); ++i) {
+    stan_csv& chain = chains[i];
+    const Eigen::MatrixXd& metric = chain.adaptation.metric;
+    if (metric.size() > 0) {
+      writer("Adaptation terminated");
+      std::stringstream step_size;
+      step_size << "Step size = " << chain.adaptation.step_size;
+      writer(step_size.str());
+      writer(metric.rows() == 1 ? "Diagonal elements of inverse mass matrix:"
+                                : "Elements of inverse mass matrix:");
+      for (Eigen::Index r = 0; r < metric.rows(); ++r) {
+        std::stringstream values;
+        for (Eigen::Index c = 0; c < metric.cols(); ++c)
+          values << (c > 0 ? ", " : "") << metric(r, c);
+        writer(values.str());
+      }
+    }
+
+    Eigen::Index first = 0;
+    if (chain.metadata.save_warmup && options.drop_warmup)
+      first = std::min<Eigen::Index>(chain.metadata.num_warmup,
+                                     chain.samples.rows());
+    row[0] = i;
+    for (Eigen::Index n = first; n < chain.samples.rows();
+         n += options.thin) {
+      for (Eigen::Index j = 0; j < chain.samples.cols(); ++j)
+        row[j + 1] = chain.samples(n, j);
+      writer(row);
+    }
+
+    std::stringstream warmup, sampling;
+    warmup << "Elapsed Time: " << chain.timing.warmup << " seconds (Warm-up)";
+    sampling << "              " << chain.timing.sampling
+             << " seconds (Sampling)";
+    writer();
+    writer(warmup.str());
+    writer(sampling.str());
+    writer();
+
+    chain.samples.resize(0, 0);
+    if (options.drop_warmup)
+      chain.metadata.save_warmup = false;
+  }
+  return chains;
+}
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -82,6 +82,44 @@ class deserializer {
   using is_fp_or_ad = bool_constant<std::is_floating_point<S>::value
                                     || is_autodiff<S>::value>;
 
+  template <typename S>
+  struct is_real_std_vector : std::false_type {};
+
+  template <typename S, typename A>
+  struct is_real_std_vector<std::vector<S, A>> : is_fp_or_ad<S> {};
+
+  template <typename S>
+  struct is_int_std_vector : std::false_type {};
+
+  template <typename S, typename A>
+  struct is_int_std_vector<std::vector<S, A>> : std::is_integral<S> {};
+
+  // An `std::vector` of reals with scalar bounds, transformed as one block
+  template <typename S, typename... Bounds>
+  using is_real_block
+      = bool_constant<is_real_std_vector<std::decay_t<S>>::value
+                      && math::conjunction<is_stan_scalar<Bounds>...>::value>;
+
+  /**
+   * Return the next `m` reals as an `std::vector`, transformed as a
+   * single column vector so that the transform is applied to the whole
+   * block rather than element by element.
+   * @tparam Ret The `std::vector` type to return.
+   * @tparam F Type of the transform.
+   * @param m The size of the vector.
+   * @param f The transform, taking and returning a column vector.
+   */
+  template <typename Ret, typename F>
+  inline auto read_block(Eigen::Index m, const F& f) {
+    std::decay_t<Ret> ret(m);
+    if (likely(m > 0)) {
+      Eigen::Map<Eigen::Matrix<value_type_t<Ret>, Eigen::Dynamic, 1>>(
+          ret.data(), m)
+          = f(this->read<vector_t>(m));
+    }
+    return ret;
+  }
+
  public:
   using matrix_t = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
   using vector_t = Eigen::Matrix<T, Eigen::Dynamic, 1>;
@@ -315,6 +353,43 @@ class deserializer {
     return this->read<value_type_t<Ret>>(sizes...);
   }
 
+  /**
+   * Return an `std::vector` of reals, checking the capacity once and
+   * copying the whole block.
+   * @tparam Ret The type to return.
+   * @param m The size of the vector.
+   */
+  template <typename Ret,
+            require_t<is_real_std_vector<std::decay_t<Ret>>>* = nullptr>
+  inline auto read(Eigen::Index m) {
+    if (unlikely(m == 0)) {
+      return std::decay_t<Ret>();
+    } else {
+      check_r_capacity(m);
+      const T* begin = &scalar_ptr_increment(m);
+      return std::decay_t<Ret>(begin, begin + m);
+    }
+  }
+
+  /**
+   * Return an `std::vector` of integers, checking the capacity once and
+   * copying the whole block.
+   * @tparam Ret The type to return.
+   * @param m The size of the vector.
+   */
+  template <typename Ret,
+            require_t<is_int_std_vector<std::decay_t<Ret>>>* = nullptr>
+  inline auto read(Eigen::Index m) {
+    if (unlikely(m == 0)) {
+      return std::decay_t<Ret>();
+    } else {
+      check_i_capacity(m);
+      const int* begin = &map_i_.coeffRef(pos_i_);
+      pos_i_ += m;
+      return std::decay_t<Ret>(begin, begin + m);
+    }
+  }
+
   /**
    * Return an `std::vector`
    * @tparam Ret The type to return.
@@ -324,7 +399,9 @@ class deserializer {
    * `read` functions.
    */
   template <typename Ret, typename... Sizes,
-            require_std_vector_t<Ret>* = nullptr>
+            require_std_vector_t<Ret>* = nullptr,
+            require_not_t<is_real_std_vector<std::decay_t<Ret>>>* = nullptr,
+            require_not_t<is_int_std_vector<std::decay_t<Ret>>>* = nullptr>
   inline auto read(Eigen::Index m, Sizes... dims) {
     if (unlikely(m == 0)) {
       return Ret();
@@ -356,7 +433,8 @@ class deserializer {
    * @param sizes a pack of sizes to use to construct the return.
    */
   template <typename Ret, bool Jacobian, typename LB, typename LP,
-            typename... Sizes>
+            typename... Sizes,
+            require_not_t<is_real_block<Ret, LB>>* = nullptr>
   inline auto read_constrain_lb(const LB& lb, LP& lp, Sizes... sizes) {
     if (Jacobian) {
       return stan::math::lb_constrain(this->read<Ret>(sizes...), lb, lp);
@@ -365,6 +443,35 @@ class deserializer {
     }
   }
 
+  /**
+   * Return the next `std::vector` of reals transformed to have the
+   * specified lower bound, applying the transform to the whole block at once.
+   *
+   * <p>See <code>stan::math::lb_constrain</code>.
+   *
+   * @tparam Ret The `std::vector` type to return.
+   * @tparam Jacobian Whether to increment the log of the absolute Jacobian
+   * determinant of the transform.
+   * @tparam LB Type of lower bound.
+   * @tparam LP Type of log probability.
+   * @param lb Lower bound.
+   * @param lp Reference to log probability variable to increment.
+   * @param m Size of the vector.
+   */
+  template <typename Ret, bool Jacobian, typename LB, typename LP,
+            require_t<is_real_block<Ret, LB>>* = nullptr>
+  inline auto read_constrain_lb(const LB& lb, LP& lp, Eigen::Index m) {
+    if (Jacobian) {
+      return this->read_block<Ret>(m, [&lb, &lp](const auto& x) {
+        return stan::math::lb_constrain(x, lb, lp);
+      });
+    } else {
+      return this->read_block<Ret>(m, [&lb](const auto& x) {
+        return stan::math::lb_constrain(x, lb);
+      });
+    }
+  }
+
   /**
    * Return the next object transformed to have the specified
    * upper bound, possibly incrementing the specified reference with the
@@ -382,7 +489,8 @@ class deserializer {
    * @param sizes a pack of sizes to use to construct the return.
    */
   template <typename Ret, bool Jacobian, typename UB, typename LP,
-            typename... Sizes>
+            typename... Sizes,
+            require_not_t<is_real_block<Ret, UB>>* = nullptr>
   inline auto read_constrain_ub(const UB& ub, LP& lp, Sizes... sizes) {
     if (Jacobian) {
       return stan::math::ub_constrain(this->read<Ret>(sizes...), ub, lp);
@@ -391,6 +499,35 @@ class deserializer {
     }
   }
 
+  /**
+   * Return the next `std::vector` of reals transformed to have the
+   * specified upper bound, applying the transform to the whole block at once.
+   *
+   * <p>See <code>stan::math::ub_constrain</code>.
+   *
+   * @tparam Ret The `std::vector` type to return.
+   * @tparam Jacobian Whether to increment the log of the absolute Jacobian
+   * determinant of the transform.
+   * @tparam UB Type of upper bound.
+   * @tparam LP Type of log probability.
+   * @param ub Upper bound.
+   * @param lp Reference to log probability variable to increment.
+   * @param m Size of the vector.
+   */
+  template <typename Ret, bool Jacobian, typename UB, typename LP,
+            require_t<is_real_block<Ret, UB>>* = nullptr>
+  inline auto read_constrain_ub(const UB& ub, LP& lp, Eigen::Index m) {
+    if (Jacobian) {
+      return this->read_block<Ret>(m, [&ub, &lp](const auto& x) {
+        return stan::math::ub_constrain(x, ub, lp);
+      });
+    } else {
+      return this->read_block<Ret>(m, [&ub](const auto& x) {
+        return stan::math::ub_constrain(x, ub);
+      });
+    }
+  }
+
   /**
    * Return the next object transformed to be between the
    * the specified lower and upper bounds.
@@ -410,7 +547,8 @@ class deserializer {
    * @param sizes Pack of integrals to use to construct the return's type.
    */
   template <typename Ret, bool Jacobian, typename LB, typename UB, typename LP,
-            typename... Sizes>
+            typename... Sizes,
+            require_not_t<is_real_block<Ret, LB, UB>>* = nullptr>
   inline auto read_constrain_lub(const LB& lb, const UB& ub, LP& lp,
                                  Sizes... sizes) {
     if (Jacobian) {
@@ -420,6 +558,38 @@ class deserializer {
     }
   }
 
+  /**
+   * Return the next `std::vector` of reals transformed to be between the
+   * specified bounds, applying the transform to the whole block at once.
+   *
+   * <p>See <code>stan::math::lub_constrain</code>.
+   *
+   * @tparam Ret The `std::vector` type to return.
+   * @tparam Jacobian Whether to increment the log of the absolute Jacobian
+   * determinant of the transform.
+   * @tparam LB Type of lower bound.
+   * @tparam UB Type of upper bound.
+   * @tparam LP Type of log probability.
+   * @param lb Lower bound.
+   * @param ub Upper bound.
+   * @param lp Reference to log probability variable to increment.
+   * @param m Size of the vector.
+   */
+  template <typename Ret, bool Jacobian, typename LB, typename UB, typename LP,
+            require_t<is_real_block<Ret, LB, UB>>* = nullptr>
+  inline auto read_constrain_lub(const LB& lb, const UB& ub, LP& lp,
+                                 Eigen::Index m) {
+    if (Jacobian) {
+      return this->read_block<Ret>(m, [&lb, &ub, &lp](const auto& x) {
+        return stan::math::lub_constrain(x, lb, ub, lp);
+      });
+    } else {
+      return this->read_block<Ret>(m, [&lb, &ub](const auto& x) {
+        return stan::math::lub_constrain(x, lb, ub);
+      });
+    }
+  }
+
   /**
    * Return the next object transformed to have the specified offset and
    * multiplier.
@@ -1,6 +1,7 @@
 #ifndef STAN_IO_DUMP_HPP
 #define STAN_IO_DUMP_HPP
 
+#include <stan/io/dump_block_reader.hpp>
 #include <stan/io/validate_zero_buf.hpp>
 #include <stan/io/validate_dims.hpp>
 #include <stan/io/var_context.hpp>
@@ -8,12 +9,13 @@
 #include <boost/lexical_cast.hpp>
 #include <iostream>
 #include <limits>
-#include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include <algorithm>
 #include <cctype>
 
 namespace stan {
@@ -290,16 +292,25 @@ class dump_reader {
     return x;
   }
 
+  // move the integers read so far to the doubles
+  void promote_ints() {
+    for (size_t j = 0; j < stack_i_.size(); ++j)
+      stack_r_.push_back(static_cast<double>(stack_i_[j]));
+    stack_i_.clear();
+  }
+
   // scan number stores number or throws bad lexical cast exception
   void scan_number(bool negate_val) {
     // must take longest first!
     if (scan_chars("Inf")) {
       scan_chars("inity");  // read past if there
+      promote_ints();
       stack_r_.push_back(negate_val ? -std::numeric_limits<double>::infinity()
                                     : std::numeric_limits<double>::infinity());
       return;
     }
     if (scan_chars("NaN", false)) {
+      promote_ints();
       stack_r_.push_back(std::numeric_limits<double>::quiet_NaN());
       return;
     }
@@ -323,9 +334,7 @@ class dump_reader {
       stack_i_.push_back(negate_val ? -n : n);
       scan_optional_long();
     } else {
-      for (size_t j = 0; j < stack_i_.size(); ++j)
-        stack_r_.push_back(static_cast<double>(stack_i_[j]));
-      stack_i_.clear();
+      promote_ints();
       double x = scan_double();
       stack_r_.push_back(negate_val ? -x : x);
     }
@@ -589,16 +598,19 @@ class dump_reader {
  * <p>See <code>dump_reader</code> for more information on the format.
  *
  * <p>Dump objects are created from reading dump files from an
- * input stream.
+ * input stream, which is read in full with a
+ * <code>dump_block_reader</code>.
  *
  * <p>The dimensions and values of variables
  * may be accessed by name.
  */
 class dump : public stan::io::var_context {
  private:
-  std::map<std::string, std::pair<std::vector<double>, std::vector<size_t> > >
+  std::unordered_map<std::string,
+                     std::pair<std::vector<double>, std::vector<size_t> > >
       vars_r_;
-  std::map<std::string, std::pair<std::vector<int>, std::vector<size_t> > >
+  std::unordered_map<std::string,
+                     std::pair<std::vector<int>, std::vector<size_t> > >
       vars_i_;
   std::vector<double> const empty_vec_r_;
   std::vector<int> const empty_vec_i_;
@@ -625,17 +637,16 @@ class dump : public stan::io::var_context {
    * @param in Input stream from which to read.
    */
   explicit dump(std::istream& in) {
-    dump_reader reader(in);
+    dump_block_reader reader(in);
     while (reader.next()) {
       if (reader.is_int()) {
-        vars_i_[reader.name()]
-            = std::pair<std::vector<int>, std::vector<size_t> >(
-                reader.int_values(), reader.dims());
-
+        auto& var = vars_i_[reader.name()];
+        var.first = std::move(reader.int_values());
+        var.second = std::move(reader.dims());
       } else {
-        vars_r_[reader.name()]
-            = std::pair<std::vector<double>, std::vector<size_t> >(
-                reader.double_values(), reader.dims());
+        auto& var = vars_r_[reader.name()];
+        var.first = std::move(reader.double_values());
+        var.second = std::move(reader.dims());
       }
     }
   }
@@ -672,19 +683,31 @@ class dump : public stan::io::var_context {
    * @return Values of variable.
    */
   std::vector<double> vals_r(const std::string& name) const {
-    if (contains_r_only(name)) {
-      return (vars_r_.find(name)->second).first;
-    } else if (contains_i(name)) {
-      std::vector<int> vec_int = (vars_i_.find(name)->second).first;
-      std::vector<double> vec_r(vec_int.size());
-      for (size_t ii = 0; ii < vec_int.size(); ii++) {
-        vec_r[ii] = vec_int[ii];
-      }
-      return vec_r;
-    }
+    auto it_r = vars_r_.find(name);
+    if (it_r != vars_r_.end())
+      return it_r->second.first;
+    auto it_i = vars_i_.find(name);
+    if (it_i != vars_i_.end())
+      return std::vector<double>(it_i->second.first.begin(),
+                                 it_i->second.first.end());
     return empty_vec_r_;
   }
 
+  /**
+   * Return a view of the double values for the variable with the
+   * specified name, which refers to the stored values unless they are
+   * integers.
+   *
+   * @param name Name of variable.
+   * @return View of the values of variable.
+   */
+  values_view<double> vals_r_view(const std::string& name) const {
+    auto it = vars_r_.find(name);
+    if (it != vars_r_.end())
+      return values_view<double>(it->second.first);
+    return values_view<double>(vals_r(name));
+  }
+
   /**
    * Return the dimensions for the double variable with the specified
    * name.
@@ -693,11 +716,12 @@ class dump : public stan::io::var_context {
    * @return Dimensions of variable.
    */
   std::vector<size_t> dims_r(const std::string& name) const {
-    if (contains_r_only(name)) {
-      return (vars_r_.find(name)->second).second;
-    } else if (contains_i(name)) {
-      return (vars_i_.find(name)->second).second;
-    }
+    auto it_r = vars_r_.find(name);
+    if (it_r != vars_r_.end())
+      return it_r->second.second;
+    auto it_i = vars_i_.find(name);
+    if (it_i != vars_i_.end())
+      return it_i->second.second;
     return empty_vec_ui_;
   }
 
@@ -709,10 +733,22 @@ class dump : public stan::io::var_context {
    * @return Values.
    */
   std::vector<int> vals_i(const std::string& name) const {
-    if (contains_i(name)) {
-      return (vars_i_.find(name)->second).first;
-    }
-    return empty_vec_i_;
+    auto it = vars_i_.find(name);
+    return it != vars_i_.end() ? it->second.first : empty_vec_i_;
+  }
+
+  /**
+   * Return a view of the integer values for the variable with the
+   * specified name.
+   *
+   * @param name Name of variable.
+   * @return View of the values.
+   */
+  values_view<int> vals_i_view(const std::string& name) const {
+    auto it = vars_i_.find(name);
+    if (it != vars_i_.end())
+      return values_view<int>(it->second.first);
+    return values_view<int>();
   }
 
   /**
@@ -723,10 +759,8 @@ class dump : public stan::io::var_context {
    * @return Dimensions of variable.
    */
   std::vector<size_t> dims_i(const std::string& name) const {
-    if (contains_i(name)) {
-      return (vars_i_.find(name)->second).second;
-    }
-    return empty_vec_ui_;
+    auto it = vars_i_.find(name);
+    return it != vars_i_.end() ? it->second.second : empty_vec_ui_;
   }
 
   /**
@@ -736,13 +770,11 @@ class dump : public stan::io::var_context {
    * @param names Vector to store the list of names in.
    */
   virtual void names_r(std::vector<std::string>& names) const {
-    names.resize(0);
-    for (std::map<std::string, std::pair<std::vector<double>,
-                                         std::vector<size_t> > >::const_iterator
-             it
-         = vars_r_.begin();
-         it != vars_r_.end(); ++it)
-      names.push_back((*it).first);
+    names.clear();
+    names.reserve(vars_r_.size());
+    for (const auto& var : vars_r_)
+      names.push_back(var.first);
+    std::sort(names.begin(), names.end());
   }
 
   /**
@@ -752,13 +784,11 @@ class dump : public stan::io::var_context {
    * @param names Vector to store the list of names in.
    */
   virtual void names_i(std::vector<std::string>& names) const {
-    names.resize(0);
-    for (std::map<std::string, std::pair<std::vector<int>,
-                                         std::vector<size_t> > >::const_iterator
-             it
-         = vars_i_.begin();
-         it != vars_i_.end(); ++it)
-      names.push_back((*it).first);
+    names.clear();
+    names.reserve(vars_i_.size());
+    for (const auto& var : vars_i_)
+      names.push_back(var.first);
+    std::sort(names.begin(), names.end());
   }
 
   /**
@@ -0,0 +1,583 @@
+#ifndef STAN_IO_DUMP_BLOCK_READER_HPP
+#define STAN_IO_DUMP_BLOCK_READER_HPP
+
+#include <stan/io/validate_zero_buf.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+namespace stan {
+namespace io {
+
+/**
+ * Reads data from S-plus dump format, as <code>dump_reader</code> does,
+ * from text held in memory.
+ *
+ * The text is either read from a stream in large blocks up front, or
+ * given as a range of characters, such as a memory mapped file, which
+ * is not copied. Scanning then works on pointers into the text instead
+ * of on a stream a character at a time, numbers are converted with
+ * <code>std::from_chars</code> where the standard library provides it,
+ * and the arrays of values are reserved from the number of entries in
+ * each <code>c(...)</code> sequence or range.
+ *
+ * The format, the values read, the type promotion and the error
+ * messages are those of <code>dump_reader</code>; see there for the
+ * grammar. Values that <code>std::from_chars</code> doesn't convert in
+ * full, such as out of range ones, are converted as
+ * <code>dump_reader</code> converts them, so they fail the same way.
+ */
+class dump_block_reader {
+ private:
+  std::string text_;
+  const char* p_;
+  const char* end_;
+  // Set once a read runs past the end, like the fail bit of a stream
+  bool failed_;
+  std::string buf_;
+  std::string name_;
+  std::vector<int> stack_i_;
+  std::vector<double> stack_r_;
+  std::vector<size_t> dims_;
+  size_t expected_size_;
+
+  static bool is_space(char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+  }
+
+  static bool is_alpha(char c) {
+    return std::isalpha(static_cast<unsigned char>(c));
+  }
+
+  static bool is_digit(char c) {
+    return std::isdigit(static_cast<unsigned char>(c));
+  }
+
+  bool get(char& c) {
+    if (failed_ || p_ == end_) {
+      failed_ = true;
+      return false;
+    }
+    c = *p_++;
+    return true;
+  }
+
+  // Reads like operator>>, skipping whitespace
+  bool get_skip_space(char& c) {
+    while (get(c))
+      if (!is_space(c))
+        return true;
+    return false;
+  }
+
+  void putback() { --p_; }
+
+  bool scan_single_char(char c_expected) {
+    if (failed_ || p_ == end_) {
+      failed_ = true;
+      return false;
+    }
+    if (*p_ != c_expected)
+      return false;
+    ++p_;
+    return true;
+  }
+
+  bool scan_optional_long() {
+    return scan_single_char('l') || scan_single_char('L');
+  }
+
+  bool scan_char(char c_expected) {
+    char c;
+    if (!get_skip_space(c))
+      return false;
+    if (c != c_expected) {
+      putback();
+      return false;
+    }
+    return true;
+  }
+
+  bool scan_name_unquoted() {
+    char c;
+    if (!get_skip_space(c))
+      return false;
+    if (!is_alpha(c))
+      return false;
+    name_.push_back(c);
+    while (get(c)) {
+      if (is_alpha(c) || is_digit(c) || c == '_' || c == '.') {
+        name_.push_back(c);
+      } else {
+        putback();
+        return true;
+      }
+    }
+    return true;  // but hit eos
+  }
+
+  bool scan_name() {
+    if (scan_char('"')) {
+      if (!scan_name_unquoted())
+        return false;
+      if (!scan_char('"'))
+        return false;
+    } else if (scan_char('\'')) {
+      if (!scan_name_unquoted())
+        return false;
+      if (!scan_char('\''))
+        return false;
+    } else {
+      if (!scan_name_unquoted())
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Scan a keyword, skipping whitespace before each of its characters.
+   * On a mismatch the input is left where <code>dump_reader</code>
+   * leaves it: after the first character of the keyword, or at the
+   * mismatching character if it is the first or second.
+   */
+  bool scan_chars(const char* s, bool case_sensitive = true) {
+    const char* second = p_;
+    for (size_t i = 0; s[i]; ++i) {
+      char c;
+      if (!get_skip_space(c))
+        return false;
+      // all ASCII, so toupper is OK
+      if ((case_sensitive && c != s[i])
+          || (!case_sensitive && ::toupper(c) != ::toupper(s[i]))) {
+        if (i >= 2)
+          p_ = second;
+        else
+          putback();
+        return false;
+      }
+      if (i == 1)
+        second = p_ - 1;
+    }
+    return true;
+  }
+
+  void scan_digits() {
+    char c;
+    buf_.clear();
+    while (get(c)) {
+      if (is_space(c))
+        continue;
+      if (is_digit(c)) {
+        buf_.push_back(c);
+      } else {
+        putback();
+        break;
+      }
+    }
+  }
+
+  size_t scan_dim() {
+    scan_digits();
+    scan_optional_long();
+    size_t d = 0;
+    if (parse(d))
+      return d;
+    try {
+      d = boost::lexical_cast<size_t>(buf_);
+    } catch (const boost::bad_lexical_cast& exc) {
+      std::string msg = "value " + buf_ + " beyond array dimension range";
+      throw std::invalid_argument(msg);
+    }
+    return d;
+  }
+
+  int scan_int() {
+    scan_digits();
+    return get_int();
+  }
+
+  int get_int() {
+    int n = 0;
+    if (parse(n))
+      return n;
+    try {
+      n = boost::lexical_cast<int>(buf_);
+    } catch (const boost::bad_lexical_cast& exc) {
+      std::string msg = "value " + buf_ + " beyond int range";
+      throw std::invalid_argument(msg);
+    }
+    return n;
+  }
+
+  double scan_double() {
+    double x = 0;
+    try {
+      if (!parse(x))
+        x = boost::lexical_cast<double>(buf_);
+      if (x == 0)
+        validate_zero_buf(buf_);
+    } catch (const boost::bad_lexical_cast& exc) {
+      std::string msg = "value " + buf_ + " beyond numeric range";
+      throw std::invalid_argument(msg);
+    }
+    return x;
+  }
+
+  /**
+   * Convert the whole buffer with <code>std::from_chars</code>, if
+   * available, returning true on success.
+   */
+  template <typename T>
+  bool parse(T& x) const {
+#ifdef __cpp_lib_to_chars
+    if (buf_.empty() || buf_[0] == '+' || buf_[0] == '-')
+      return false;
+    const char* last = buf_.data() + buf_.size();
+    std::from_chars_result result = std::from_chars(buf_.data(), last, x);
+    return result.ec == std::errc() && result.ptr == last;
+#else
+    return false;
+#endif
+  }
+
+  void push_double(double x) {
+    if (!stack_i_.empty()) {
+      stack_r_.reserve(std::max(expected_size_, stack_i_.size() + 1));
+      stack_r_.insert(stack_r_.end(), stack_i_.begin(), stack_i_.end());
+      stack_i_.clear();
+    } else if (stack_r_.empty()) {
+      stack_r_.reserve(expected_size_);
+    }
+    stack_r_.push_back(x);
+  }
+
+  void scan_number(bool negate_val) {
+    // must take longest first!
+    if (scan_chars("Inf")) {
+      scan_chars("inity");  // read past if there
+      push_double(negate_val ? -std::numeric_limits<double>::infinity()
+                             : std::numeric_limits<double>::infinity());
+      return;
+    }
+    if (scan_chars("NaN", false)) {
+      push_double(std::numeric_limits<double>::quiet_NaN());
+      return;
+    }
+
+    char c;
+    bool is_double = false;
+    buf_.clear();
+    while (get(c)) {
+      if (is_digit(c)) {
+        buf_.push_back(c);
+      } else if (c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+') {
+        is_double = true;
+        buf_.push_back(c);
+      } else {
+        putback();
+        break;
+      }
+    }
+    if (!is_double && stack_r_.empty()) {
+      int n = get_int();
+      stack_i_.push_back(negate_val ? -n : n);
+      scan_optional_long();
+    } else {
+      double x = scan_double();
+      push_double(negate_val ? -x : x);
+    }
+  }
+
+  void scan_number() {
+    char c;
+    while (get(c)) {
+      if (is_space(c))
+        continue;
+      putback();
+      break;
+    }
+    bool negate_val = scan_char('-');
+    if (!negate_val)
+      scan_char('+');  // flush leading +
+    return scan_number(negate_val);
+  }
+
+  bool scan_zero_integers() {
+    if (!scan_char('('))
+      return false;
+    if (scan_char(')')) {
+      dims_.push_back(0U);
+      return true;
+    }
+    int s = scan_int();
+    if (s < 0)
+      return false;
+    stack_i_.assign(stack_i_.size() + s, 0);
+    if (!scan_char(')'))
+      return false;
+    dims_.push_back(s);
+    return true;
+  }
+
+  bool scan_zero_doubles() {
+    if (!scan_char('('))
+      return false;
+    if (scan_char(')')) {
+      dims_.push_back(0U);
+      return true;
+    }
+    int s = scan_int();
+    if (s < 0)
+      return false;
+    stack_r_.assign(stack_r_.size() + s, 0);
+    if (!scan_char(')'))
+      return false;
+    dims_.push_back(s);
+    return true;
+  }
+
+  void push_range(int start, int end) {
+    stack_i_.reserve(stack_i_.size() + std::abs(static_cast<long>(end) - start)
+                     + 1);
+    if (start <= end) {
+      for (int i = start; i <= end; ++i)
+        stack_i_.push_back(i);
+    } else {
+      for (int i = start; i >= end; --i)
+        stack_i_.push_back(i);
+    }
+  }
+
+  bool scan_seq_value() {
+    if (!scan_char('('))
+      return false;
+    if (scan_char(')')) {
+      dims_.push_back(0U);
+      return true;
+    }
+    // The entries of a sequence are numbers, so it ends at the next
+    // closing parenthesis
+    const void* close = std::memchr(p_, ')', end_ - p_);
+    expected_size_
+        = std::count(p_, close ? static_cast<const char*>(close) : end_, ',')
+          + 1;
+    stack_i_.reserve(expected_size_);
+    scan_number();  // first entry
+    while (scan_char(',')) {
+      scan_number();
+    }
+    dims_.push_back(stack_r_.size() + stack_i_.size());
+    return scan_char(')');
+  }
+
+  bool scan_struct_value() {
+    if (!scan_char('('))
+      return false;
+    if (scan_chars("integer")) {
+      scan_zero_integers();
+    } else if (scan_chars("double")) {
+      scan_zero_doubles();
+    } else if (scan_char('c')) {
+      scan_seq_value();
+    } else {
+      int start = scan_int();
+      if (!scan_char(':'))
+        return false;
+      int end = scan_int();
+      push_range(start, end);
+    }
+    dims_.clear();
+    if (!scan_char(','))
+      return false;
+    if (!scan_char('.'))
+      return false;
+    if (!scan_chars("Dim"))
+      return false;
+    if (!scan_char('='))
+      return false;
+    if (scan_char('c')) {
+      if (!scan_char('('))
+        return false;
+      size_t dim = scan_dim();
+      dims_.push_back(dim);
+      while (scan_char(',')) {
+        dim = scan_dim();
+        dims_.push_back(dim);
+      }
+      if (!scan_char(')'))
+        return false;
+    } else {
+      size_t start = scan_dim();
+      if (!scan_char(':'))
+        return false;
+      size_t end = scan_dim();
+      if (start < end) {
+        for (size_t i = start; i <= end; ++i)
+          dims_.push_back(i);
+      } else {
+        for (size_t i = start; i >= end; --i)
+          dims_.push_back(i);
+      }
+    }
+    if (!scan_char(')'))
+      return false;
+    return true;
+  }
+
+  bool scan_value() {
+    if (scan_char('c'))
+      return scan_seq_value();
+    if (scan_chars("integer"))
+      return scan_zero_integers();
+    if (scan_chars("double"))
+      return scan_zero_doubles();
+    if (scan_chars("structure"))
+      return scan_struct_value();
+    scan_number();
+    if (!scan_char(':'))
+      return true;
+    if (stack_i_.size() != 1)
+      return false;
+    scan_number();
+    if (stack_i_.size() != 2)
+      return false;
+    int start = stack_i_[0];
+    int end = stack_i_[1];
+    stack_i_.clear();
+    push_range(start, end);
+    dims_.push_back(stack_i_.size());
+    return true;
+  }
+
+ public:
+  /**
+   * Construct a reader for the text of a stream, which is read in full
+   * up front, in blocks of the specified size.
+   *
+   * @param in Input stream from which to read.
+   * @param block_size Number of characters read at a time.
+   */
+  explicit dump_block_reader(std::istream& in, size_t block_size = 1 << 20)
+      : failed_(false), expected_size_(0) {
+    std::istream::pos_type start = in.tellg();
+    if (start != std::istream::pos_type(-1)) {
+      if (in.seekg(0, std::ios::end)) {
+        std::istream::pos_type end = in.tellg();
+        if (end != std::istream::pos_type(-1) && end >= start)
+          text_.reserve(static_cast<size_t>(end - start));
+        in.seekg(start);
+      } else {
+        in.clear();
+      }
+    }
+    std::vector<char> block(std::max<size_t>(block_size, 1));
+    while (in.read(block.data(), block.size()) || in.gcount() > 0)
+      text_.append(block.data(), in.gcount());
+    p_ = text_.data();
+    end_ = p_ + text_.size();
+  }
+
+  /**
+   * Construct a reader for a range of characters, such as a memory
+   * mapped file, which must outlive the reader.
+   *
+   * @param begin First character.
+   * @param end One past the last character.
+   */
+  dump_block_reader(const char* begin, const char* end)
+      : p_(begin), end_(end), failed_(false), expected_size_(0) {}
+
+  dump_block_reader(const dump_block_reader&) = delete;
+  dump_block_reader& operator=(const dump_block_reader&) = delete;
+
+  /**
+   * Return the name of the most recently read variable.
+   *
+   * @return Name of most recently read variable.
+   */
+  const std::string& name() const { return name_; }
+
+  /**
+   * Return the dimensions of the most recently
+   * read variable.
+   *
+   * @return Last dimensions.
+   */
+  std::vector<size_t>& dims() { return dims_; }
+
+  /**
+   * Checks if the last item read is integer.
+   *
+   * Return <code>true</code> if the value(s) in the most recently
+   * read item are integer values and <code>false</code> if
+   * they are floating point.
+   */
+  bool is_int() const { return stack_r_.size() == 0; }
+
+  /**
+   * Returns the integer values from the last item if the last item
+   * read was an integer and the empty vector otherwise. The values
+   * may be moved from; they are cleared by the next read.
+   *
+   * @return Integer values of last item.
+   */
+  std::vector<int>& int_values() { return stack_i_; }
+
+  /**
+   * Returns the floating point values from the last item if the last
+   * item read contained floating point values and the empty vector
+   * otherwise. The values may be moved from; they are cleared by the
+   * next read.
+   *
+   * @return Floating point values of last item.
+   */
+  std::vector<double>& double_values() { return stack_r_; }
+
+  /**
+   * Read the next value, returning <code>true</code> if successful
+   * and <code>false</code> if no further input may be read.
+   *
+   * @return Return <code>true</code> if a fresh variable was read.
+   * @throws std::invalid_argument if bad number values encountered.
+   */
+  bool next() {
+    stack_r_.clear();
+    stack_i_.clear();
+    dims_.clear();
+    name_.clear();
+    expected_size_ = 0;
+    if (!scan_name())  // set name
+      return false;
+    if (!scan_char('<'))  // set <-
+      return false;
+    if (!scan_char('-'))
+      return false;
+    try {
+      bool okSyntax = scan_value();  // set stack_r_, stack_i_, dims_
+      if (!okSyntax) {
+        std::string msg = "syntax error";
+        throw std::invalid_argument(msg);
+      }
+    } catch (const std::invalid_argument& e) {
+      std::string msg = "data " + name_ + " " + e.what();
+      throw std::invalid_argument(msg);
+    }
+    return true;
+  }
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -0,0 +1,206 @@
+#ifndef STAN_IO_PROGRAM_FILE_CACHE_HPP
+#define STAN_IO_PROGRAM_FILE_CACHE_HPP
+
+#include <stan/io/starts_with.hpp>
+#include <stan/io/trim_spaces.hpp>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * A <code>program_file_cache</code> holds the lines of files included
+ * by Stan programs, already split and scanned for include statements,
+ * so that files included repeatedly, within one program or by several
+ * programs read with the same cache, are read from disk only once.
+ *
+ * Files are keyed by their canonical path. An entry is reused only if
+ * the file's modification time and size are unchanged since it was
+ * read; otherwise the file is read again. A cache may be shared by
+ * readers on different threads.
+ */
+class program_file_cache {
+ public:
+  /**
+   * The lines of a file, each with its trailing newline, if any, and
+   * for each line the path it includes, or the empty string if it isn't
+   * an include statement.
+   */
+  struct file {
+    std::vector<std::string> lines;
+    std::vector<std::string> includes;
+  };
+
+  /**
+   * Return the specified line with any line comment removed.
+   *
+   * @param line line of text
+   * @return text before the first <code>//</code>
+   */
+  static std::string trim_comment(const std::string& line) {
+    size_t pos = line.find("//");
+    return pos == std::string::npos ? line : line.substr(0, pos);
+  }
+
+  /**
+   * Return the lines of a file read from a stream.
+   *
+   * @param in stream to read
+   * @return lines of the stream
+   * @throw std::runtime_error if an include statement has no path
+   */
+  static std::shared_ptr<const file> scan(std::istream& in) {
+    std::string text((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    auto result = std::make_shared<file>();
+    size_t begin = 0;
+    while (begin < text.size()) {
+      size_t end = text.find('\n', begin);
+      end = end == std::string::npos ? text.size() : end + 1;
+      result->lines.emplace_back(text, begin, end - begin);
+      const std::string& line = result->lines.back();
+      result->includes.push_back(starts_with("#include ", trim_spaces(line))
+                                     ? include_path(line)
+                                     : std::string());
+      begin = end;
+    }
+    return result;
+  }
+
+  /**
+   * Return the lines of the file at the specified path, reading it
+   * only if it isn't cached or has changed since it was cached.
+   *
+   * @param path path of the file
+   * @return lines of the file, or a null pointer if there is no
+   * readable regular file at the path
+   * @throw std::runtime_error if an include statement has no path
+   */
+  std::shared_ptr<const file> get(const std::string& path) {
+    const std::string key = canonical_path(path);
+    struct stat info;
+    if (stat(key.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+      return nullptr;
+    std::time_t mtime = info.st_mtime;
+    off_t size = info.st_size;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = files_.find(key);
+      if (it != files_.end() && it->second.mtime == mtime
+          && it->second.size == size)
+        return it->second.contents;
+    }
+    std::ifstream in(key, std::ios::binary);
+    if (!in.good())
+      return nullptr;
+    std::shared_ptr<const file> contents = scan(in);
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_[key] = entry{mtime, size, contents};
+    return contents;
+  }
+
+  /**
+   * Return the number of files in the cache.
+   */
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return files_.size();
+  }
+
+  /**
+   * Remove all files from the cache.
+   */
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.clear();
+  }
+
+ private:
+  struct entry {
+    std::time_t mtime;
+    off_t size;
+    std::shared_ptr<const file> contents;
+  };
+
+  std::unordered_map<std::string, entry> files_;
+  mutable std::mutex mutex_;
+
+  /**
+   * Return the absolute path of a file with symbolic links and
+   * <code>.</code> and <code>..</code> resolved, or the path itself if
+   * it can't be resolved.
+   *
+   * @param path path of the file
+   */
+  static std::string canonical_path(const std::string& path) {
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, path.c_str(), _MAX_PATH) == nullptr)
+      return path;
+    return resolved;
+#else
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (resolved == nullptr)
+      return path;
+    std::string result(resolved);
+    std::free(resolved);
+    return result;
+#endif
+  }
+
+  /**
+   * Returns the include path from a line that begins with
+   * <code>#include</code> after whitespace.  A path may be a single
+   * token or it must be quoted with double quote characters.  Line or
+   * block comments are allowed after the include.
+   *
+   * Does not yet support included file names with double quotes in
+   * the name.
+   *
+   * @param line line of text beginning with <code>#include</code>
+   * @return text after <code>#include</code> with whitespace
+   * trimmed
+   */
+  static std::string include_path(const std::string& line) {
+    // trim out the initial spaces, #include, and spaces after and advance
+    std::string trimmed_line = trim_comment(trim_spaces(line));
+    std::size_t start = std::string("#include").size();
+    while (is_whitespace(line[start]) && start < trimmed_line.size())
+      ++start;
+    std::string rest = trimmed_line.substr(start);
+
+    // deal with case where there is nothing left
+    if (rest.size() == 0) {
+      throw std::runtime_error("***nothing after #include***");
+    }
+
+    // extract include path and line position after path
+    std::size_t pos = 0;
+    if (rest[pos] == '"') {
+      // quoted case
+      ++pos;
+      while (pos < rest.size() && rest[pos] != '"')
+        ++pos;
+      return rest.substr(1, pos - 1);
+    }
+    while (pos < rest.size() && !is_whitespace(rest[pos]))
+      ++pos;
+    return rest.substr(0, pos);  // pos past last char
+  }
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -2,13 +2,11 @@
 #define STAN_IO_PROGRAM_READER_HPP
 
 #include <stan/io/ends_with.hpp>
-#include <stan/io/read_line.hpp>
-#include <stan/io/starts_with.hpp>
-#include <stan/io/trim_spaces.hpp>
+#include <stan/io/program_file_cache.hpp>
 #include <cstdio>
 #include <istream>
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -75,15 +73,31 @@ class program_reader {
    */
   program_reader(std::istream& in, const std::string& name,
                  const std::vector<std::string>& search_path) {
+    program_file_cache cache;
     int concat_line_num = 0;
-    read(in, name, search_path, concat_line_num);
+    read(in, name, search_path, concat_line_num, cache);
+  }
+
+  /**
+   * Construct a program reader as above, reading included files
+   * through the specified cache, which may be shared with other
+   * readers so that files they have read aren't read again.
+   *
+   * @param[in] in stream from which to start reading
+   * @param[in] name name path or name attached to stream
+   * @param[in] search_path ordered sequence of directory names to
+   * search for included files
+   * @param[in,out] cache cache of included files
+   */
+  program_reader(std::istream& in, const std::string& name,
+                 const std::vector<std::string>& search_path,
+                 program_file_cache& cache) {
+    int concat_line_num = 0;
+    read(in, name, search_path, concat_line_num, cache);
   }
 
   static std::string trim_comment(const std::string& line) {
-    for (std::size_t i = 0; i < line.size(); ++i)
-      if (starts_with("//", line.substr(i)))
-        return line.substr(0, i);
-    return line;  // no comments
+    return program_file_cache::trim_comment(line);
   }
 
   /**
@@ -93,7 +107,7 @@ class program_reader {
    * @param r reader to copy
    */
   program_reader(const program_reader& r)
-      : program_(r.program_.str()), history_(r.history_) {}
+      : program_(r.program_), history_(r.history_) {}
 
   /**
    * Construct a program reader with an empty program and
@@ -108,7 +122,7 @@ class program_reader {
    *
    * @return stream for program
    */
-  std::string program() const { return program_.str(); }
+  std::string program() const { return program_; }
 
   /**
    * Return the include trace of the path and line numbers leading
@@ -172,60 +186,28 @@ class program_reader {
   }
 
  private:
-  std::stringstream program_;
+  std::string program_;
   std::vector<preproc_event> history_;
 
   /**
-   * Returns the include path from a line that begins with
-   * <code>#include</code> after whitespace.  A path may be a single
-   * token or it must be quoted with double quote characters.  Line or
-   * block comments are allowed after the include.
-   *
-   * Does not yet support included file names with double quotes in
-   * the name.
-   *
-   * @param line line of text beginning with <code>#include</code>
-   * @return text after <code>#include</code> with whitespace
-   * trimmed
+   * Files being read and the lines of them that make up the program,
+   * which are copied into the program once all includes are resolved.
    */
-  static std::string include_path(const std::string& line) {
-    // trim out the initial spaces, #include, and spaces after and advance
-    std::string trimmed_line = trim_comment(trim_spaces(line));
-    std::size_t start = std::string("#include").size();
-    while (is_whitespace(line[start]) && start < trimmed_line.size())
-      ++start;
-    std::string rest = trimmed_line.substr(start);
-
-    // deal with case where there is nothing left
-    if (rest.size() == 0) {
-      throw std::runtime_error("***nothing after #include***");
-    }
-
-    // extract include path and line position after path
-    std::string path;
-    std::size_t pos = 0;
-    if (rest[pos] == '"') {
-      // quoted case
-      ++pos;
-      while (pos < rest.size() && rest[pos] != '"')
-        ++pos;
-      return rest.substr(1, pos - 1);
-    }
-    while (pos < rest.size() && !is_whitespace(rest[pos]))
-      ++pos;
-    return rest.substr(0, pos);  // pos past last char
-  }
+  struct pieces {
+    std::vector<std::shared_ptr<const program_file_cache::file>> files;
+    std::vector<const std::string*> lines;
+  };
 
-  void read(std::istream& in, const std::string& path,
+  void read(const program_file_cache::file& in, const std::string& path,
             const std::vector<std::string>& search_path, int& concat_line_num,
-            bool is_nested, std::set<std::string>& visited_paths) {
+            bool is_nested, std::set<std::string>& visited_paths,
+            program_file_cache& cache, pieces& text) {
     if (visited_paths.find(path) != visited_paths.end())
       return;  // avoids recursive visitation
     visited_paths.insert(path);
     history_.push_back(preproc_event(concat_line_num, 0, "start", path));
     for (int line_num = 1;; ++line_num) {
-      std::string line = read_line(in);
-      if (line.empty()) {
+      if (static_cast<size_t>(line_num) > in.lines.size()) {
         // ends initial out of loop start event
         if (!is_nested) {
           // pad end concat_line_num of outermost file in order to properly
@@ -237,8 +219,9 @@ class program_reader {
               preproc_event(concat_line_num, line_num - 1, "end", path));
         }
         break;
-      } else if (starts_with("#include ", trim_spaces(line))) {
-        std::string incl_path = include_path(line);
+      }
+      const std::string& incl_path = in.includes[line_num - 1];
+      if (!incl_path.empty()) {
         history_.push_back(
             preproc_event(concat_line_num, line_num - 1, "include", incl_path));
         bool found_path = false;
@@ -249,20 +232,13 @@ class program_reader {
                     ? search_path[i] + "/"
                           + incl_path  // / will work under Windows
                     : search_path[i] + incl_path;
-
-          std::ifstream include_in(f.c_str());
-          try {
-            if (!include_in.good()) {
-              include_in.close();
-              continue;
-            }
-            read(include_in, incl_path, search_path, concat_line_num, true,
-                 visited_paths);
-          } catch (...) {
-            include_in.close();
-            throw;
-          }
-          include_in.close();
+          std::shared_ptr<const program_file_cache::file> include_in
+              = cache.get(f);
+          if (!include_in)
+            continue;
+          text.files.push_back(include_in);
+          read(*include_in, incl_path, search_path, concat_line_num, true,
+               visited_paths, cache, text);
           history_.push_back(
               preproc_event(concat_line_num, line_num, "restart", path));
           found_path = true;
@@ -282,7 +258,7 @@ class program_reader {
         }
       } else {
         ++concat_line_num;
-        program_ << line;
+        text.lines.push_back(&in.lines[line_num - 1]);
       }
     }
     visited_paths.erase(path);  // allow multiple, just not nested
@@ -292,22 +268,36 @@ class program_reader {
    * Read the rest of a program from the specified input stream in
    * the specified path, with the specified search path for
    * include files, and incrementing the specified concatenated
-   * line number.  This method is called recursively for included
-   * files.  If a file is included recursively, the second include
+   * line number.  Included files are read through the specified
+   * cache.  If a file is included recursively, the second include
    * is ignored.
    *
+   * <p>The program text is appended in a single step once all of
+   * the includes are resolved, so that it is allocated only once.
+   *
    * @param[in] in stream from which to read
    * @param[in] path name of stream
    * @param[in] search_path sequence of path names to search for
    * include files
    * @param[in,out] concat_line_num position in concatenated file
    * to be updated
+   * @param[in,out] cache cache of included files
    * @throw std::runtime_error if an included file cannot be found
    */
   void read(std::istream& in, const std::string& path,
-            const std::vector<std::string>& search_path, int& concat_line_num) {
+            const std::vector<std::string>& search_path, int& concat_line_num,
+            program_file_cache& cache) {
+    pieces text;
+    text.files.push_back(program_file_cache::scan(in));
     std::set<std::string> visited_paths;
-    read(in, path, search_path, concat_line_num, false, visited_paths);
+    read(*text.files.front(), path, search_path, concat_line_num, false,
+         visited_paths, cache, text);
+    size_t size = program_.size();
+    for (const std::string* line : text.lines)
+      size += line->size();
+    program_.reserve(size);
+    for (const std::string* line : text.lines)
+      program_ += *line;
   }
 };
 
@@ -63,15 +63,8 @@ class random_var_context : public var_context {
     dims_.erase(dims_.begin() + i, dims_.end());
     names_.erase(names_.begin() + i, names_.end());
 
-    if (init_zero) {
-      for (size_t n = 0; n < num_unconstrained_; ++n)
-        unconstrained_params_[n] = 0.0;
-    } else {
-      boost::random::uniform_real_distribution<double> unif(-init_radius,
-                                                            init_radius);
-      for (size_t n = 0; n < num_unconstrained_; ++n)
-        unconstrained_params_[n] = unif(rng);
-    }
+    draw_unconstrained(model, rng, init_radius, init_zero,
+                       unconstrained_params_);
 
     std::vector<double> constrained_params;
     std::vector<int> int_params;
@@ -86,6 +79,40 @@ class random_var_context : public var_context {
    */
   ~random_var_context() {}
 
+  /**
+   * Draw the unconstrained parameters of a model exactly as the
+   * constructor does, without constraining them or building a context.
+   * When no initial values are given this is all that is needed, and
+   * the parameters equal <code>get_unconstrained()</code> of a context
+   * constructed from the same state of the RNG.
+   *
+   * @tparam Model Model class
+   * @tparam RNG Random number generator type
+   * @param[in] model instantiated model to generate variables for
+   * @param[in,out] rng pseudo-random number generator
+   * @param[in] init_radius the unconstrained variables are uniform draws
+   *   from -init_radius to init_radius.
+   * @param[in] init_zero indicates whether all unconstrained variables
+   *   should be initialized at 0.
+   * @param[out] unconstrained unconstrained parameters, resized to the
+   *   number of parameters
+   */
+  template <class Model, class RNG>
+  static void draw_unconstrained(const Model& model, RNG& rng,
+                                 double init_radius, bool init_zero,
+                                 std::vector<double>& unconstrained) {
+    size_t num_unconstrained = model.num_params_r();
+    unconstrained.resize(num_unconstrained);
+    if (init_zero) {
+      std::fill(unconstrained.begin(), unconstrained.end(), 0.0);
+    } else {
+      boost::random::uniform_real_distribution<double> unif(-init_radius,
+                                                            init_radius);
+      for (size_t n = 0; n < num_unconstrained; ++n)
+        unconstrained[n] = unif(rng);
+    }
+  }
+
   /**
    * Return <code>true</code> if the specified variable name is
    * defined. Will return <code>true</code> if the name matches
@@ -115,6 +142,22 @@ class random_var_context : public var_context {
     return vals_r_[loc - names_.begin()];
   }
 
+  /**
+   * Returns a view of the values of the constrained variables.
+   *
+   * @param name Name of variable.
+   *
+   * @return a view of the constrained values if the variable is in the
+   *   var_context; an empty view is returned otherwise
+   */
+  values_view<double> vals_r_view(const std::string& name) const {
+    std::vector<std::string>::const_iterator loc
+        = std::find(names_.begin(), names_.end(), name);
+    if (loc == names_.end())
+      return values_view<double>();
+    return values_view<double>(vals_r_[loc - names_.begin()]);
+  }
+
   /**
    * Returns the dimensions of the variable
    *
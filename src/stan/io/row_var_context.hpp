@@ -0,0 +1,131 @@
+#ifndef STAN_IO_ROW_VAR_CONTEXT_HPP
+#define STAN_IO_ROW_VAR_CONTEXT_HPP
+
+#include <stan/io/var_context.hpp>
+#include <stan/io/validate_dims.hpp>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * A <code>row_var_context</code> presents one row of a table of draws,
+ * such as a row of a Stan CSV file, as real variables with fixed names
+ * and dimensions.
+ *
+ * The layout of the row is computed once on construction. The values
+ * are not copied: <code>set_row()</code> points the context at the
+ * values of the next row, so a single context can be reused for every
+ * row of the table. Each variable occupies a contiguous range of the
+ * row, in column major order, in the order the variables were given.
+ */
+class row_var_context : public var_context {
+ public:
+  /**
+   * Construct a context for rows holding the given variables.
+   *
+   * @param names names of the variables
+   * @param dims dimensions of each variable
+   * @throw std::invalid_argument if the number of names and dimensions
+   *   differ or a name is repeated
+   */
+  row_var_context(const std::vector<std::string>& names,
+                  const std::vector<std::vector<size_t>>& dims)
+      : values_(nullptr), size_(0) {
+    if (names.size() != dims.size())
+      throw std::invalid_argument(
+          "row_var_context: number of names and dimensions differ");
+    for (size_t i = 0; i < names.size(); ++i) {
+      size_t size = std::accumulate(dims[i].begin(), dims[i].end(),
+                                    static_cast<size_t>(1),
+                                    std::multiplies<size_t>());
+      if (!vars_.emplace(names[i], var{dims[i], size_, size}).second)
+        throw std::invalid_argument("row_var_context: variable " + names[i]
+                                    + " is repeated");
+      size_ += size;
+    }
+  }
+
+  /**
+   * Point the context at the values of a row, which must hold
+   * <code>size()</code> values and outlive their use through the context.
+   *
+   * @param values first value of the row
+   */
+  void set_row(const double* values) { values_ = values; }
+
+  /**
+   * Return the number of values in a row.
+   */
+  size_t size() const { return size_; }
+
+  bool contains_r(const std::string& name) const {
+    return vars_.find(name) != vars_.end();
+  }
+
+  std::vector<double> vals_r(const std::string& name) const {
+    auto it = vars_.find(name);
+    if (it == vars_.end())
+      return {};
+    const double* begin = values_ + it->second.offset;
+    return std::vector<double>(begin, begin + it->second.size);
+  }
+
+  /**
+   * Return a view of the values of a variable in the current row.
+   */
+  values_view<double> vals_r_view(const std::string& name) const {
+    auto it = vars_.find(name);
+    if (it == vars_.end())
+      return values_view<double>();
+    return values_view<double>(values_ + it->second.offset, it->second.size);
+  }
+
+  std::vector<size_t> dims_r(const std::string& name) const {
+    auto it = vars_.find(name);
+    return it == vars_.end() ? std::vector<size_t>() : it->second.dims;
+  }
+
+  bool contains_i(const std::string& name) const { return false; }
+
+  std::vector<int> vals_i(const std::string& name) const { return {}; }
+
+  std::vector<size_t> dims_i(const std::string& name) const { return {}; }
+
+  void names_r(std::vector<std::string>& names) const {
+    names.clear();
+    names.reserve(vars_.size());
+    for (const auto& var : vars_)
+      names.push_back(var.first);
+    std::sort(names.begin(), names.end());
+  }
+
+  void names_i(std::vector<std::string>& names) const { names.clear(); }
+
+  void validate_dims(const std::string& stage, const std::string& name,
+                     const std::string& base_type,
+                     const std::vector<size_t>& dims_declared) const {
+    stan::io::validate_dims(*this, stage, name, base_type, dims_declared);
+  }
+
+ private:
+  struct var {
+    std::vector<size_t> dims;
+    size_t offset;
+    size_t size;
+  };
+
+  std::unordered_map<std::string, var> vars_;
+  const double* values_;
+  size_t size_;
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -2,6 +2,7 @@
 #define STAN_IO_SERIALIZER_HPP
 
 #include <stan/math/rev.hpp>
+#include <algorithm>
 
 namespace stan {
 namespace io {
@@ -68,6 +69,19 @@ class serializer {
   explicit serializer(RVec& data_r)
       : map_r_(data_r.data(), data_r.size()), r_size_(data_r.size()) {}
 
+  /**
+   * Construct a variable serializer writing to a caller-owned buffer,
+   * such as a row of a preallocated output block or a memory mapped
+   * file, so that values are written where they are finally stored.
+   *
+   * Attempting to write beyond the end of the buffer will raise a
+   * runtime exception.
+   *
+   * @param data_r Start of the buffer
+   * @param size Number of scalars the buffer holds
+   */
+  serializer(T* data_r, size_t size) : map_r_(data_r, size), r_size_(size) {}
+
   /**
    * Return the number of scalars available to be written to.
    */
@@ -223,11 +237,27 @@ class serializer {
     this->write(stan::math::value_of(x));
   }
 
+  /**
+   * Write a `std::vector` of scalars to storage, checking the capacity
+   * once and copying the whole block.
+   * @tparam StdVec The type to write
+   */
+  template <typename StdVec, require_std_vector_t<StdVec>* = nullptr,
+            require_t<is_arithmetic_or_ad<value_type_t<StdVec>>>* = nullptr>
+  inline void write(StdVec&& x) {
+    if (x.empty())
+      return;
+    check_r_capacity(x.size());
+    std::copy(x.begin(), x.end(), &map_r_.coeffRef(pos_r_));
+    pos_r_ += x.size();
+  }
+
   /**
    * Write a `std::vector` to storage
    * @tparam StdVec The type to write
    */
-  template <typename StdVec, require_std_vector_t<StdVec>* = nullptr>
+  template <typename StdVec, require_std_vector_t<StdVec>* = nullptr,
+            require_not_t<is_arithmetic_or_ad<value_type_t<StdVec>>>* = nullptr>
   inline void write(StdVec&& x) {
     for (size_t i = 0; i < x.size(); ++i) {
       this->write(x[i]);
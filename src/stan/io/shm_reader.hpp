@@ -0,0 +1,153 @@
+#ifndef STAN_IO_SHM_READER_HPP
+#define STAN_IO_SHM_READER_HPP
+
+#include <stan/callbacks/shm_writer.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * Follows the draws published to a shared memory segment by
+ * <code>callbacks::shm_writer</code>, from another process or thread.
+ *
+ * The reader keeps, for every chain, the index of the next draw to
+ * read. Draws overwritten before they were read are skipped and
+ * counted.
+ */
+class shm_reader {
+ public:
+  /**
+   * @param[in] name name of the shared memory object
+   */
+  explicit shm_reader(const std::string& name)
+      : name_(name), layout_{0, 0, 0, 0}, base_(nullptr) {}
+
+  /**
+   * Map the segment if it exists and has been initialized by a writer.
+   * Readers usually retry until this succeeds.
+   *
+   * @return true if the segment is mapped
+   */
+  bool open() {
+    if (base_)
+      return true;
+    using boost::interprocess::shared_memory_object;
+    try {
+      shared_memory_object shm(boost::interprocess::open_only, name_.c_str(),
+                               boost::interprocess::read_only);
+      boost::interprocess::offset_t size = 0;
+      if (!shm.get_size(size)
+          || size < static_cast<boost::interprocess::offset_t>(
+                 callbacks::shm_layout::header_size))
+        return false;
+      auto region = std::make_unique<boost::interprocess::mapped_region>(
+          shm, boost::interprocess::read_only);
+      char* base = static_cast<char*>(region->get_address());
+      if (std::memcmp(base, callbacks::shm_layout::magic(), 8) != 0
+          || callbacks::shm_layout::word(base, 8).load(
+                 std::memory_order_acquire)
+                 == 0)
+        return false;
+      uint64_t sizes[4];
+      std::memcpy(sizes, base + 16, sizeof(sizes));
+      layout_ = callbacks::shm_layout{sizes[0], sizes[1], sizes[2], sizes[3]};
+      if (region->get_size() < layout_.size())
+        return false;
+
+      std::string joined(base + layout_.names_offset(), layout_.names_size);
+      names_.clear();
+      size_t start = 0;
+      for (size_t end; (end = joined.find('\n', start)) != std::string::npos;
+           start = end + 1)
+        names_.push_back(joined.substr(start, end - start));
+      if (layout_.num_cols > 0)
+        names_.push_back(joined.substr(start));
+      next_.assign(layout_.num_chains, 0);
+      num_missed_.assign(layout_.num_chains, 0);
+      region_ = std::move(region);
+      base_ = base;
+      return true;
+    } catch (const boost::interprocess::interprocess_exception& e) {
+      return false;
+    }
+  }
+
+  size_t num_chains() const { return layout_.num_chains; }
+
+  const std::vector<std::string>& names() const { return names_; }
+
+  /**
+   * Read the draws of a chain published since the last read.
+   *
+   * @param[in] chain index of the chain, from zero
+   * @param[out] draws draws read, appended in order
+   * @return number of draws read
+   */
+  size_t read(size_t chain, std::vector<std::vector<double>>& draws) {
+    if (!base_ || chain >= layout_.num_chains)
+      return 0;
+    uint64_t count
+        = callbacks::shm_layout::word(base_, layout_.chain_offset(chain))
+              .load(std::memory_order_acquire);
+    uint64_t& next = next_[chain];
+    size_t num_read = 0;
+    std::vector<double> values(layout_.num_cols);
+    while (next < count) {
+      if (count - next > layout_.capacity) {
+        num_missed_[chain] += count - next - layout_.capacity;
+        next = count - layout_.capacity;
+      }
+      size_t offset = layout_.slot_offset(chain, next);
+      std::atomic<uint64_t>& seq = callbacks::shm_layout::word(base_, offset);
+      uint64_t before = seq.load(std::memory_order_acquire);
+      std::memcpy(values.data(), base_ + offset + 8, 8 * values.size());
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t after = seq.load(std::memory_order_relaxed);
+      if (before != 2 * next + 2 || after != before) {
+        // Overwritten while reading; catch up with the writer
+        count = callbacks::shm_layout::word(base_,
+                                            layout_.chain_offset(chain))
+                    .load(std::memory_order_acquire);
+        if (count - next <= layout_.capacity) {
+          ++num_missed_[chain];
+          ++next;
+        }
+        continue;
+      }
+      draws.push_back(values);
+      ++next;
+      ++num_read;
+    }
+    return num_read;
+  }
+
+  /**
+   * Return the number of draws of a chain that were overwritten before
+   * they could be read.
+   *
+   * @param[in] chain index of the chain, from zero
+   */
+  uint64_t num_missed(size_t chain) const { return num_missed_[chain]; }
+
+ private:
+  std::string name_;
+  callbacks::shm_layout layout_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  char* base_;
+  std::vector<std::string> names_;
+  std::vector<uint64_t> next_;
+  std::vector<uint64_t> num_missed_;
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
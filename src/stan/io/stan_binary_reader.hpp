@@ -0,0 +1,430 @@
+#ifndef STAN_IO_STAN_BINARY_READER_HPP
+#define STAN_IO_STAN_BINARY_READER_HPP
+
+#include <stan/callbacks/binary_writer.hpp>
+#include <stan/io/column_type.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * A run of consecutive draws of the same width in a binary output file,
+ * as recorded in its index.
+ */
+struct stan_binary_block {
+  /**
+   * Byte offset of the record header of the first draw
+   */
+  uint64_t offset;
+
+  /**
+   * Number of draws in the run
+   */
+  uint64_t rows;
+
+  /**
+   * Number of values in each draw
+   */
+  uint64_t cols;
+};
+
+/**
+ * Reads output written by <code>stan::callbacks::binary_writer</code>
+ * into the same <code>stan_csv</code> structure produced by
+ * <code>stan_csv_reader</code>. Messages are interpreted as the comment
+ * lines of a csv file, so the metadata, adaptation and timing are
+ * recovered in the same way. Draws whose columns were stored as
+ * narrower types are widened to doubles.
+ */
+class stan_binary_reader {
+ public:
+  stan_binary_reader() {}
+  ~stan_binary_reader() {}
+
+  /**
+   * Return true if the stream starts with the binary output magic
+   * string. The stream is left at its original position.
+   *
+   * @param[in, out] in input stream
+   */
+  static bool is_binary(std::istream& in) {
+    std::streampos start = in.tellg();
+    char magic[8];
+    bool found = static_cast<bool>(in.read(magic, 8))
+                 && std::memcmp(magic, callbacks::binary_writer::file_magic(),
+                                8)
+                        == 0;
+    in.clear();
+    in.seekg(start);
+    return found;
+  }
+
+  /**
+   * Reads the index of draws from the end of a seekable stream.
+   *
+   * @param[in, out] in input stream
+   * @param[out] index runs of draws in the file
+   * @param[out] out output stream to send messages
+   * @return false if the stream doesn't end with an index
+   */
+  static bool read_index(std::istream& in,
+                         std::vector<stan_binary_block>& index,
+                         std::ostream* out) {
+    index.clear();
+    in.seekg(0, std::ios_base::end);
+    std::streamoff size = in.tellg();
+    if (size < 8 + 16) {
+      if (out)
+        *out << "Error: file too short to hold an index" << std::endl;
+      return false;
+    }
+    in.seekg(size - 16);
+    uint64_t index_offset;
+    char magic[8];
+    if (!read_uint64(in, index_offset) || !in.read(magic, 8)
+        || std::memcmp(magic, callbacks::binary_writer::index_magic(), 8)
+               != 0) {
+      if (out)
+        *out << "Error: no index found at the end of the file" << std::endl;
+      return false;
+    }
+    in.seekg(index_offset);
+    uint64_t type;
+    uint64_t payload;
+    if (!read_uint64(in, type) || !read_uint64(in, payload)
+        || type != callbacks::binary_writer::index_record
+        || payload % 24 != 0) {
+      if (out)
+        *out << "Error: malformed index record" << std::endl;
+      return false;
+    }
+    index.resize(payload / 24);
+    for (stan_binary_block& block : index) {
+      if (!read_uint64(in, block.offset) || !read_uint64(in, block.rows)
+          || !read_uint64(in, block.cols)) {
+        if (out)
+          *out << "Error: truncated index record" << std::endl;
+        index.clear();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Reads the names of the columns, skipping the records before them,
+   * without reading any draw.
+   *
+   * @param[in, out] in input stream positioned at the start of the file,
+   *   left after the names record
+   * @param[out] header names of the columns
+   * @param[out] out output stream to send messages
+   * @param[in] prettify_name whether to rewrite <code>a.1.2</code>
+   *   style names as <code>a[1,2]</code>, as the csv reader does
+   * @return false if the stream is not binary output or has no names
+   *   record
+   */
+  static bool read_header(std::istream& in, std::vector<std::string>& header,
+                          std::ostream* out, bool prettify_name = true) {
+    char magic[8];
+    if (!in.read(magic, 8)
+        || std::memcmp(magic, callbacks::binary_writer::file_magic(), 8)
+               != 0) {
+      if (out)
+        *out << "Error: not a Stan binary output file" << std::endl;
+      return false;
+    }
+    uint64_t type;
+    uint64_t payload;
+    while (read_uint64(in, type) && read_uint64(in, payload)
+           && type != callbacks::binary_writer::index_record) {
+      if (type == callbacks::binary_writer::names_record)
+        return read_names(in, payload, header, prettify_name);
+      in.ignore(payload + (8 - payload % 8) % 8);
+    }
+    return false;
+  }
+
+  /**
+   * Parses the file.
+   *
+   * @param[in] in input stream to parse, opened in binary mode
+   * @param[out] out output stream to send messages
+   * @param[in] prettify_name whether to rewrite <code>a.1.2</code>
+   *   style names as <code>a[1,2]</code>, as the csv reader does
+   * @param[in] columns zero-based indices of the columns to keep, in
+   *   increasing order. When empty every column is kept. The header of
+   *   the returned <code>stan_csv</code> holds only the kept columns
+   * @throws std::invalid_argument if the stream is not binary output,
+   *   has no names record, or a column is out of range
+   */
+  static stan_csv parse(std::istream& in, std::ostream* out,
+                        bool prettify_name = true,
+                        const std::vector<size_t>& columns = {}) {
+    stan_csv data;
+    char magic[8];
+    if (!in.read(magic, 8)
+        || std::memcmp(magic, callbacks::binary_writer::file_magic(), 8)
+               != 0) {
+      if (out)
+        *out << "Error: not a Stan binary output file" << std::endl;
+      throw std::invalid_argument("Error with magic of input file in parse");
+    }
+
+    std::stringstream metadata;
+    std::stringstream adaptation;
+    bool have_header = false;
+    bool in_adaptation = false;
+    bool have_adaptation = false;
+    std::vector<double> values;
+    std::vector<double> row;
+    std::vector<column_type> types;
+    std::vector<unsigned char> bytes;
+    std::string message;
+    size_t rows = 0;
+    data.timing.warmup = 0;
+    data.timing.sampling = 0;
+
+    uint64_t type;
+    uint64_t payload;
+    while (read_uint64(in, type) && read_uint64(in, payload)) {
+      if (type == callbacks::binary_writer::index_record)
+        break;
+      if (type != callbacks::binary_writer::message_record
+          && type != callbacks::binary_writer::blank_record)
+        in_adaptation = false;
+
+      if (type == callbacks::binary_writer::names_record) {
+        if (!read_names(in, payload, data.header, prettify_name)) {
+          if (out)
+            *out << "Error: error reading header" << std::endl;
+          throw std::invalid_argument(
+              "Error with header of input file in parse");
+        }
+        if (!columns.empty() && columns.back() >= data.header.size())
+          throw std::invalid_argument("Error with column index in parse");
+        have_header = true;
+      } else if (type == callbacks::binary_writer::column_types_record) {
+        if (!read_types(in, payload, types)) {
+          if (out)
+            *out << "Error: error reading column types" << std::endl;
+          break;
+        }
+      } else if (type == callbacks::binary_writer::values_record
+                 || type == callbacks::binary_writer::typed_values_record) {
+        bool typed = type == callbacks::binary_writer::typed_values_record;
+        bool width_ok = typed ? types.size() == data.header.size()
+                                    && payload == row_bytes(types)
+                              : payload == 8 * data.header.size();
+        if (!have_header || !width_ok) {
+          if (out)
+            *out << "Error: expected " << data.header.size()
+                 << " columns, but found a draw of " << payload
+                 << " bytes instead for row " << rows + 1 << std::endl;
+          break;
+        }
+        if (typed ? !read_typed(in, types, bytes, row)
+                  : !read_doubles(in, payload / 8, row))
+          break;
+        if (columns.empty()) {
+          values.insert(values.end(), row.begin(), row.end());
+        } else {
+          for (size_t col : columns)
+            values.push_back(row[col]);
+        }
+        ++rows;
+      } else if (type == callbacks::binary_writer::message_record
+                 || type == callbacks::binary_writer::blank_record) {
+        message.resize(payload);
+        if (payload > 0 && !in.read(&message[0], payload))
+          break;
+        skip_padding(in, payload);
+        if (!have_header) {
+          metadata << "# " << message << '\n';
+        } else if (message == "Adaptation terminated" && !have_adaptation) {
+          in_adaptation = true;
+          have_adaptation = true;
+          adaptation << "# " << message << '\n';
+        } else if (in_adaptation
+                   && type == callbacks::binary_writer::message_record) {
+          adaptation << "# " << message << '\n';
+        } else {
+          in_adaptation = false;
+          read_timing(message, data.timing);
+        }
+      } else {
+        if (out)
+          *out << "Warning: skipping unknown record type " << type
+               << std::endl;
+        in.ignore(payload + (8 - payload % 8) % 8);
+      }
+    }
+
+    if (!have_header) {
+      if (out)
+        *out << "Error: error reading header" << std::endl;
+      throw std::invalid_argument("Error with header of input file in parse");
+    }
+
+    if (metadata.rdbuf()->in_avail() > 0
+        && !stan_csv_reader::read_metadata(metadata, data.metadata, out)) {
+      if (out)
+        *out << "Warning: non-fatal error reading metadata" << std::endl;
+    }
+
+    if (!have_adaptation
+        || !stan_csv_reader::read_adaptation(adaptation, data.adaptation,
+                                             out)) {
+      if (out)
+        *out << "Warning: non-fatal error reading adaptation data"
+             << std::endl;
+    }
+
+    if (!columns.empty()) {
+      std::vector<std::string> header;
+      header.reserve(columns.size());
+      for (size_t col : columns)
+        header.push_back(data.header[col]);
+      data.header.swap(header);
+    }
+
+    size_t cols = data.header.size();
+    data.samples.resize(rows, cols);
+    if (rows > 0)
+      data.samples = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic,
+                                              Eigen::Dynamic, Eigen::RowMajor>>(
+          values.data(), rows, cols);
+    return data;
+  }
+
+ private:
+  static bool read_uint64(std::istream& in, uint64_t& x) {
+    unsigned char bytes[8];
+    if (!in.read(reinterpret_cast<char*>(bytes), 8))
+      return false;
+    x = 0;
+    for (int i = 7; i >= 0; --i)
+      x = (x << 8) | bytes[i];
+    return true;
+  }
+
+  static void skip_padding(std::istream& in, uint64_t size) {
+    if (size % 8 != 0)
+      in.ignore(8 - size % 8);
+  }
+
+  static bool read_doubles(std::istream& in, size_t n,
+                           std::vector<double>& x) {
+    x.resize(n);
+    if (callbacks::binary_writer::is_little_endian())
+      return static_cast<bool>(
+          in.read(reinterpret_cast<char*>(x.data()), 8 * n));
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t bits;
+      if (!read_uint64(in, bits))
+        return false;
+      std::memcpy(&x[i], &bits, 8);
+    }
+    return true;
+  }
+
+  static size_t row_bytes(const std::vector<column_type>& types) {
+    size_t bytes = 0;
+    for (column_type type : types)
+      bytes += column_width(type);
+    return bytes;
+  }
+
+  static bool read_types(std::istream& in, uint64_t payload,
+                         std::vector<column_type>& types) {
+    uint64_t count;
+    if (!read_uint64(in, count) || payload != 8 + count)
+      return false;
+    std::vector<unsigned char> bytes(count);
+    if (count > 0 && !in.read(reinterpret_cast<char*>(bytes.data()), count))
+      return false;
+    types.clear();
+    for (unsigned char byte : bytes) {
+      if (byte > static_cast<unsigned char>(column_type::uint8))
+        return false;
+      types.push_back(static_cast<column_type>(byte));
+    }
+    skip_padding(in, payload);
+    return true;
+  }
+
+  static bool read_typed(std::istream& in,
+                         const std::vector<column_type>& types,
+                         std::vector<unsigned char>& bytes,
+                         std::vector<double>& x) {
+    size_t size = row_bytes(types);
+    bytes.resize(size);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), size))
+      return false;
+    skip_padding(in, size);
+    x.resize(types.size());
+    const unsigned char* b = bytes.data();
+    for (size_t i = 0; i < types.size(); ++i) {
+      x[i] = load_column_value(types[i], b);
+      b += column_width(types[i]);
+    }
+    return true;
+  }
+
+  static bool read_names(std::istream& in, uint64_t payload,
+                         std::vector<std::string>& names, bool prettify_name) {
+    uint64_t count;
+    if (!read_uint64(in, count))
+      return false;
+    names.resize(count);
+    for (std::string& name : names) {
+      uint64_t length;
+      if (!read_uint64(in, length))
+        return false;
+      name.resize(length);
+      if (length > 0 && !in.read(&name[0], length))
+        return false;
+      int pos = name.find('.');
+      if (pos > 0 && prettify_name) {
+        name.replace(pos, 1, "[");
+        std::replace(name.begin(), name.end(), '.', ',');
+        name += "]";
+      }
+    }
+    skip_padding(in, payload);
+    return true;
+  }
+
+  static void read_timing(const std::string& message,
+                          stan_csv_timing& timing) {
+    bool warmup = message.find("seconds (Warm-up)") != std::string::npos;
+    bool sampling = message.find("seconds (Sampling)") != std::string::npos;
+    if (!warmup && !sampling)
+      return;
+    std::string value = message;
+    boost::replace_first(value, "Elapsed Time:", "");
+    double seconds = 0;
+    std::stringstream(value) >> seconds;
+    if (warmup)
+      timing.warmup += seconds;
+    else
+      timing.sampling += seconds;
+  }
+};
+
+}  // namespace io
+
+}  // namespace stan
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef STAN_IO_STAN_CSV_GZIP_READER_HPP
+#define STAN_IO_STAN_CSV_GZIP_READER_HPP
+
+#include <stan/io/stan_csv_reader.hpp>
+#include <zlib.h>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * Stream buffer that decompresses gzip data read from another stream
+ * as it is consumed. Concatenated gzip members, such as the frames
+ * written by <code>callbacks::gzip_writer</code>, are decompressed one
+ * after the other as a single stream.
+ */
+class gzip_istreambuf : public std::streambuf {
+ public:
+  /**
+   * @param[in, out] in stream of compressed data, opened in binary mode
+   * @param[in] buffer_size size of the compressed and decompressed
+   *   buffers
+   * @throw std::runtime_error if zlib can't be initialized
+   */
+  explicit gzip_istreambuf(std::istream& in, size_t buffer_size = 1 << 16)
+      : in_(in), compressed_(buffer_size), text_(buffer_size), done_(false) {
+    stream_.zalloc = Z_NULL;
+    stream_.zfree = Z_NULL;
+    stream_.opaque = Z_NULL;
+    stream_.next_in = Z_NULL;
+    stream_.avail_in = 0;
+    if (inflateInit2(&stream_, 15 + 16) != Z_OK)
+      throw std::runtime_error("gzip_istreambuf: can't initialize zlib");
+    setg(text_.data(), text_.data(), text_.data());
+  }
+
+  ~gzip_istreambuf() { inflateEnd(&stream_); }
+
+ protected:
+  /**
+   * Decompress the next chunk of text.
+   *
+   * @throw std::runtime_error if the compressed data is corrupt
+   */
+  int_type underflow() {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    while (!done_) {
+      if (stream_.avail_in == 0 && !refill())
+        break;
+      stream_.next_out = reinterpret_cast<Bytef*>(text_.data());
+      stream_.avail_out = text_.size();
+      int ret = inflate(&stream_, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END) {
+        // Another member may follow
+        inflateReset(&stream_);
+      } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        throw std::runtime_error("gzip_istreambuf: corrupt gzip data");
+      }
+      size_t n = text_.size() - stream_.avail_out;
+      if (n > 0) {
+        setg(text_.data(), text_.data(), text_.data() + n);
+        return traits_type::to_int_type(*gptr());
+      }
+    }
+    return traits_type::eof();
+  }
+
+ private:
+  std::istream& in_;
+  std::vector<char> compressed_;
+  std::vector<char> text_;
+  z_stream stream_;
+  bool done_;
+
+  bool refill() {
+    in_.read(compressed_.data(), compressed_.size());
+    std::streamsize n = in_.gcount();
+    if (n <= 0) {
+      done_ = true;
+      return false;
+    }
+    stream_.next_in = reinterpret_cast<Bytef*>(compressed_.data());
+    stream_.avail_in = n;
+    return true;
+  }
+};
+
+/**
+ * Reads the gzip compressed csv output of
+ * <code>callbacks::gzip_writer</code>, or of any csv output compressed
+ * with gzip, decompressing it while it is parsed.
+ */
+class stan_csv_gzip_reader {
+ public:
+  stan_csv_gzip_reader() {}
+  ~stan_csv_gzip_reader() {}
+
+  /**
+   * Return true if the stream starts with the gzip magic bytes. The
+   * stream is left at its original position.
+   *
+   * @param[in, out] in input stream
+   */
+  static bool is_gzip(std::istream& in) {
+    std::streampos start = in.tellg();
+    char magic[2];
+    bool found = static_cast<bool>(in.read(magic, 2))
+                 && static_cast<unsigned char>(magic[0]) == 0x1f
+                 && static_cast<unsigned char>(magic[1]) == 0x8b;
+    in.clear();
+    in.seekg(start);
+    return found;
+  }
+
+  /**
+   * Parses the selected columns and draws of a compressed file, as
+   * <code>stan_csv_reader::parse</code> does for uncompressed ones.
+   *
+   * @param[in] in input stream to parse, opened in binary mode
+   * @param[out] out output stream to send messages
+   * @param[in] selection columns and range of draws to read
+   * @throws std::invalid_argument if the header can't be read or a
+   *   selected column is not in it
+   * @throws std::runtime_error if the compressed data is corrupt
+   */
+  static stan_csv parse(std::istream& in, std::ostream* out,
+                        const stan_csv_selection& selection
+                        = stan_csv_selection()) {
+    gzip_istreambuf buffer(in);
+    std::istream text(&buffer);
+    // Let errors of the stream buffer through instead of setting badbit
+    text.exceptions(std::ios::badbit);
+    return stan_csv_reader::parse(text, out, selection);
+  }
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -3,12 +3,23 @@
 
 #include <boost/algorithm/string.hpp>
 #include <stan/math/prim.hpp>
+#include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <istream>
 #include <iostream>
+#include <limits>
+#include <locale>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
 
 namespace stan {
 namespace io {
@@ -69,6 +80,23 @@ struct stan_csv_timing {
   stan_csv_timing() : warmup(0), sampling(0) {}
 };
 
+/**
+ * Selects the columns and the range of draws read by
+ * <code>stan_csv_reader::parse</code>. Columns may be given by name, by
+ * zero-based index, or both. Names are matched against the header as
+ * returned by <code>read_header</code>. The selected columns keep the
+ * order of the header, and when none is given every column is read.
+ */
+struct stan_csv_selection {
+  std::vector<std::string> names;
+  std::vector<size_t> indices;
+  size_t first_draw;
+  size_t num_draws;
+
+  stan_csv_selection()
+      : first_draw(0), num_draws(std::numeric_limits<size_t>::max()) {}
+};
+
 struct stan_csv {
   stan_csv_metadata metadata;
   std::vector<std::string> header;
@@ -261,75 +289,123 @@ class stan_csv_reader {
       return true;
   }
 
-  static bool read_samples(std::istream& in, Eigen::MatrixXd& samples,
-                           stan_csv_timing& timing, std::ostream* out) {
-    std::stringstream ss;
-    std::string line;
-
-    int rows = 0;
-    int cols = -1;
-
+  /**
+   * Reads the draws and the timing comments following the adaptation.
+   *
+   * The stream is consumed in large blocks and every value is parsed in
+   * place with <code>std::from_chars</code>, so no string is allocated
+   * per line or per value. Values that can't be parsed are read as zero.
+   * Without a floating point <code>std::from_chars</code>, before C++17
+   * or with an older standard library, the values are parsed with
+   * <code>std::strtod</code>, which uses the decimal point of the C
+   * locale; under a locale with another decimal point the values are
+   * parsed again in the classic locale, more slowly.
+   *
+   * @param[in, out] in input stream positioned at the first draw
+   * @param[out] samples draws, one row per draw
+   * @param[in, out] timing warmup and sampling times are added to this
+   * @param[out] out output stream to send messages
+   * @param[in] columns zero-based indices of the columns to keep, in
+   *   increasing order. When empty every column is kept. The other
+   *   columns are skipped without being parsed
+   * @param[in] first_draw index of the first draw to keep
+   * @param[in] num_draws maximum number of draws to keep. Draws outside
+   *   of the range are only checked for their number of columns
+   * @param[out] adaptation if not null, the adaptation is read into it
+   *   from comments among the draws, as it follows saved warmup draws
+   * @return false if there are no draws to read or a row has the wrong
+   *   number of columns
+   */
+  static bool read_samples(
+      std::istream& in, Eigen::MatrixXd& samples, stan_csv_timing& timing,
+      std::ostream* out, const std::vector<size_t>& columns = {},
+      size_t first_draw = 0,
+      size_t num_draws = std::numeric_limits<size_t>::max(),
+      stan_csv_adaptation* adaptation = nullptr) {
     if (in.peek() == '#' || in.good() == false)
       return false;
 
-    while (in.good()) {
-      bool comment_line = (in.peek() == '#');
-      bool empty_line = (in.peek() == '\n');
-
-      std::getline(in, line);
-
-      if (empty_line)
-        continue;
-      if (!line.length())
-        break;
-
-      if (comment_line) {
-        if (line.find("(Warm-up)") != std::string::npos) {
-          int left = 17;
-          int right = line.find(" seconds");
-          double warmup;
-          std::stringstream(line.substr(left, right - left)) >> warmup;
-          timing.warmup += warmup;
-        } else if (line.find("(Sampling)") != std::string::npos) {
-          int left = 17;
-          int right = line.find(" seconds");
-          double sampling;
-          std::stringstream(line.substr(left, right - left)) >> sampling;
-          timing.sampling += sampling;
+    sample_parser parser(timing, out, columns, first_draw, num_draws);
+    std::vector<char> block(1 << 20);
+    std::string partial_line;
+    while (in) {
+      in.read(block.data(), block.size());
+      const char* begin = block.data();
+      const char* end = begin + in.gcount();
+      const char* line = begin;
+      for (const char* eol;
+           (eol = static_cast<const char*>(
+                std::memchr(line, '\n', end - line)))
+           != nullptr;
+           line = eol + 1) {
+        bool ok;
+        if (partial_line.empty()) {
+          ok = parser.parse_line(line, eol);
+        } else {
+          partial_line.append(line, eol);
+          ok = parser.parse_line(partial_line.data(),
+                                 partial_line.data() + partial_line.size());
+          partial_line.clear();
         }
-      } else {
-        ss << line << '\n';
-        int current_cols = std::count(line.begin(), line.end(), ',') + 1;
-        if (cols == -1) {
-          cols = current_cols;
-        } else if (cols != current_cols) {
-          if (out)
-            *out << "Error: expected " << cols << " columns, but found "
-                 << current_cols << " instead for row " << rows + 1
-                 << std::endl;
+        if (!ok)
           return false;
-        }
-        rows++;
       }
-
-      in.peek();
+      partial_line.append(line, end);
     }
+    if (!partial_line.empty()
+        && !parser.parse_line(partial_line.data(),
+                              partial_line.data() + partial_line.size()))
+      return false;
 
-    ss.seekg(std::ios_base::beg);
+    if (parser.rows > 0)
+      samples = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic,
+                                         Eigen::Dynamic, Eigen::RowMajor>>(
+          parser.values.data(), parser.rows, parser.num_kept_cols());
+    if (adaptation && parser.adaptation.tellp() > 0)
+      read_adaptation(parser.adaptation, *adaptation, out);
+    return true;
+  }
 
-    if (rows > 0) {
-      samples.resize(rows, cols);
-      for (int row = 0; row < rows; row++) {
-        std::getline(ss, line);
-        std::stringstream ls(line);
-        for (int col = 0; col < cols; col++) {
-          std::getline(ls, line, ',');
-          boost::trim(line);
-          std::stringstream(line) >> samples(row, col);
-        }
+  /**
+   * Reads at most <code>max_draws</code> draws, one line at a time, so
+   * that a large file can be processed in batches without holding all
+   * of its draws. Comment and empty lines are skipped.
+   *
+   * @param[in, out] in input stream positioned after the header or at a
+   *   line of a previous batch
+   * @param[out] values values of the kept columns of the draws read, one
+   *   draw after the other
+   * @param[in] num_cols number of columns of each draw
+   * @param[in] columns zero-based indices of the columns to keep, in
+   *   increasing order. When empty every column is kept
+   * @param[in] max_draws maximum number of draws to read
+   * @param[out] out output stream to send messages
+   * @return number of draws read, less than <code>max_draws</code> only
+   *   at the end of the stream
+   * @throws std::invalid_argument if a selected column is out of range
+   *   or a draw has the wrong number of columns
+   */
+  static size_t read_draws(std::istream& in, std::vector<double>& values,
+                           size_t num_cols, const std::vector<size_t>& columns,
+                           size_t max_draws, std::ostream* out) {
+    if (!columns.empty() && columns.back() >= num_cols)
+      throw std::invalid_argument("Error with column index in read_draws");
+    stan_csv_timing timing;
+    sample_parser parser(timing, out, columns, 0, max_draws);
+    parser.cols = num_cols;
+    parser.values.swap(values);
+    parser.values.clear();
+    std::string line;
+    while (static_cast<size_t>(parser.rows) < max_draws
+           && std::getline(in, line)) {
+      if (!parser.parse_line(line.data(), line.data() + line.size())) {
+        parser.values.swap(values);
+        throw std::invalid_argument(
+            "Error with number of columns in read_draws");
       }
     }
-    return true;
+    parser.values.swap(values);
+    return parser.rows;
   }
 
   /**
@@ -339,6 +415,23 @@ class stan_csv_reader {
    * @param[out] out output stream to send messages
    */
   static stan_csv parse(std::istream& in, std::ostream* out) {
+    return parse(in, out, stan_csv_selection());
+  }
+
+  /**
+   * Parses the selected columns and draws of the file. The header of the
+   * returned <code>stan_csv</code> holds only the selected columns. When
+   * warmup draws were saved, the number of warmup draws in the metadata
+   * is reduced to those within the selected range.
+   *
+   * @param[in] in input stream to parse
+   * @param[out] out output stream to send messages
+   * @param[in] selection columns and range of draws to read
+   * @throws std::invalid_argument if the header can't be read or a
+   *   selected column is not in it
+   */
+  static stan_csv parse(std::istream& in, std::ostream* out,
+                        const stan_csv_selection& selection) {
     stan_csv data;
 
     if (!read_metadata(in, data.metadata, out)) {
@@ -352,21 +445,370 @@ class stan_csv_reader {
       throw std::invalid_argument("Error with header of input file in parse");
     }
 
-    if (!read_adaptation(in, data.adaptation, out)) {
-      if (out)
-        *out << "Warning: non-fatal error reading adaptation data" << std::endl;
+    std::vector<size_t> columns = select_columns(data.header, selection, out);
+    if (!columns.empty()) {
+      std::vector<std::string> header;
+      header.reserve(columns.size());
+      for (size_t col : columns)
+        header.push_back(data.header[col]);
+      data.header.swap(header);
     }
 
+    bool have_adaptation = read_adaptation(in, data.adaptation, out);
+
     data.timing.warmup = 0;
     data.timing.sampling = 0;
 
-    if (!read_samples(in, data.samples, data.timing, out)) {
+    if (!read_samples(in, data.samples, data.timing, out, columns,
+                      selection.first_draw, selection.num_draws,
+                      have_adaptation ? nullptr : &data.adaptation)) {
       if (out)
         *out << "Warning: non-fatal error reading samples" << std::endl;
     }
+    if (!have_adaptation && data.adaptation.metric.size() == 0) {
+      if (out)
+        *out << "Warning: non-fatal error reading adaptation data" << std::endl;
+    }
+
+    // Keep the saved warmup consistent with the draws actually read
+    if (data.metadata.save_warmup
+        && (selection.first_draw > 0
+            || selection.num_draws != std::numeric_limits<size_t>::max())) {
+      size_t warmup = data.metadata.num_warmup > selection.first_draw
+                          ? data.metadata.num_warmup - selection.first_draw
+                          : 0;
+      data.metadata.num_warmup
+          = std::min(warmup, static_cast<size_t>(data.samples.rows()));
+    }
 
     return data;
   }
+
+  /**
+   * Parses the metadata, the header and the adaptation of the file and
+   * stops there, without reading the draws after the adaptation. The
+   * samples of the returned <code>stan_csv</code> are empty and its
+   * timing is zero, see <code>read_timing()</code>. When warmup draws
+   * were saved they come before the adaptation, and their lines are
+   * skipped without being parsed.
+   *
+   * @param[in] in input stream to parse
+   * @param[out] out output stream to send messages
+   * @throws std::invalid_argument if the header can't be read
+   */
+  static stan_csv parse_metadata(std::istream& in, std::ostream* out) {
+    stan_csv data;
+
+    if (!read_metadata(in, data.metadata, out)) {
+      if (out)
+        *out << "Warning: non-fatal error reading metadata" << std::endl;
+    }
+
+    if (!read_header(in, data.header, out)) {
+      if (out)
+        *out << "Error: error reading header" << std::endl;
+      throw std::invalid_argument(
+          "Error with header of input file in parse_metadata");
+    }
+
+    if (data.metadata.save_warmup) {
+      while (in.peek() != '#' && in.good())
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    // Only read the comments if they are the adaptation, not the timing
+    // of a run without one
+    std::stringstream comments;
+    std::string line;
+    while (in.peek() == '#' && std::getline(in, line))
+      comments << line << '\n';
+    std::string first_line = comments.str();
+    first_line = first_line.substr(0, first_line.find('\n'));
+    if (first_line.find("Adaptation terminated") == std::string::npos
+        || !read_adaptation(comments, data.adaptation, out)) {
+      if (out)
+        *out << "Warning: non-fatal error reading adaptation data" << std::endl;
+    }
+
+    return data;
+  }
+
+  /**
+   * Reads the timing comments at the end of a file by seeking to its end
+   * and reading back only as far as the comments after the last draw,
+   * so the timing of a finished run is read without its draws.
+   *
+   * @param[in, out] in input stream to read, which must be seekable; it
+   *   is left at the end of the file
+   * @param[in, out] timing warmup and sampling times are added to this
+   * @param[out] out output stream to send messages
+   * @return false if the stream can't be seeked or doesn't end with
+   *   the timing comments
+   */
+  static bool read_timing(std::istream& in, stan_csv_timing& timing,
+                          std::ostream* out) {
+    in.clear();
+    in.seekg(0, std::ios_base::end);
+    std::streamoff size = in.tellg();
+    if (size < 0) {
+      if (out)
+        *out << "Warning: can't seek to the timing of the input" << std::endl;
+      return false;
+    }
+
+    std::string tail;
+    size_t comments = std::string::npos;
+    for (std::streamoff window = 4096; comments == std::string::npos;
+         window *= 2) {
+      std::streamoff start = std::max<std::streamoff>(0, size - window);
+      tail.resize(size - start);
+      in.seekg(start);
+      in.read(&tail[0], tail.size());
+      if (in.gcount() != static_cast<std::streamsize>(tail.size()))
+        return false;
+      // Walk back over the trailing comment lines. The first line of the
+      // window may be cut, so it only counts at the start of the file
+      size_t end = tail.size();
+      while (end > 0) {
+        size_t begin = tail.rfind('\n', end - 1);
+        begin = begin == std::string::npos ? 0 : begin + 1;
+        if (begin == 0 && start > 0)
+          break;
+        if (begin < end && tail[begin] != '#' && tail[begin] != '\r') {
+          comments = end;
+          break;
+        }
+        end = begin == 0 ? 0 : begin - 1;
+        if (begin == 0)
+          comments = 0;
+      }
+      if (start == 0 && comments == std::string::npos)
+        comments = 0;
+    }
+    in.clear();
+    in.seekg(0, std::ios_base::end);
+
+    if (tail.find("Elapsed Time", comments) == std::string::npos) {
+      if (out)
+        *out << "Warning: no timing at the end of the input" << std::endl;
+      return false;
+    }
+    std::vector<size_t> columns;
+    sample_parser parser(timing, out, columns, 0, 0);
+    size_t begin = comments;
+    while (begin < tail.size()) {
+      size_t end = tail.find('\n', begin);
+      if (end == std::string::npos)
+        end = tail.size();
+      parser.parse_line(tail.data() + begin, tail.data() + end);
+      begin = end + 1;
+    }
+    return true;
+  }
+
+ private:
+  /**
+   * Returns the sorted indices of the selected columns, or an empty
+   * vector when every column is selected.
+   */
+  static std::vector<size_t> select_columns(
+      const std::vector<std::string>& header,
+      const stan_csv_selection& selection, std::ostream* out) {
+    std::vector<size_t> columns;
+    if (selection.names.empty() && selection.indices.empty())
+      return columns;
+
+    std::vector<bool> keep(header.size(), false);
+    for (size_t index : selection.indices) {
+      if (index >= header.size()) {
+        if (out)
+          *out << "Error: column index " << index << " is out of range"
+               << std::endl;
+        throw std::invalid_argument("Error with column index in parse");
+      }
+      keep[index] = true;
+    }
+    for (const std::string& name : selection.names) {
+      auto it = std::find(header.begin(), header.end(), name);
+      if (it == header.end()) {
+        if (out)
+          *out << "Error: column " << name << " is not in the header"
+               << std::endl;
+        throw std::invalid_argument("Error with column name in parse");
+      }
+      keep[it - header.begin()] = true;
+    }
+    for (size_t col = 0; col < header.size(); ++col)
+      if (keep[col])
+        columns.push_back(col);
+    return columns;
+  }
+
+  /**
+   * Accumulates the draws and timing of the sample section one line
+   * at a time.
+   */
+  struct sample_parser {
+    stan_csv_timing& timing;
+    std::ostream* out;
+    const std::vector<size_t>& columns;
+    size_t first_draw;
+    size_t num_draws;
+    std::vector<double> values;
+    size_t draws;
+    int rows;
+    int cols;
+    // Comments of the adaptation found among the draws
+    std::stringstream adaptation;
+    bool in_adaptation;
+
+    sample_parser(stan_csv_timing& timing, std::ostream* out,
+                  const std::vector<size_t>& columns, size_t first_draw,
+                  size_t num_draws)
+        : timing(timing),
+          out(out),
+          columns(columns),
+          first_draw(first_draw),
+          num_draws(num_draws),
+          draws(0),
+          rows(0),
+          cols(-1),
+          in_adaptation(false) {}
+
+    int num_kept_cols() const {
+      return columns.empty() ? cols : static_cast<int>(columns.size());
+    }
+
+    /**
+     * Parses the line in <code>[begin, end)</code>, which excludes the
+     * newline.
+     *
+     * @return false if the line has the wrong number of columns
+     */
+    bool parse_line(const char* begin, const char* end) {
+      if (begin != end && end[-1] == '\r')
+        --end;
+      if (begin == end)
+        return true;
+
+      if (*begin == '#') {
+        std::string line(begin, end);
+        if (line.find("Adaptation terminated") != std::string::npos
+            && adaptation.tellp() == 0)
+          in_adaptation = true;
+        if (in_adaptation)
+          adaptation << line << '\n';
+        else
+          parse_timing(line);
+        return true;
+      }
+      in_adaptation = false;
+
+      int current_cols = std::count(begin, end, ',') + 1;
+      if (cols == -1) {
+        cols = current_cols;
+        if (!columns.empty() && columns.back() >= static_cast<size_t>(cols)) {
+          if (out)
+            *out << "Error: selected column " << columns.back()
+                 << " is beyond the " << cols << " columns of the draws"
+                 << std::endl;
+          return false;
+        }
+      } else if (cols != current_cols) {
+        if (out)
+          *out << "Error: expected " << cols << " columns, but found "
+               << current_cols << " instead for row " << draws + 1
+               << std::endl;
+        return false;
+      }
+
+      size_t draw = draws++;
+      if (draw < first_draw || draw - first_draw >= num_draws)
+        return true;
+
+      const char* field = begin;
+      if (columns.empty()) {
+        for (int col = 0; col < cols; ++col) {
+          const char* field_end = std::find(field, end, ',');
+          values.push_back(parse_value(field, field_end));
+          field = field_end + 1;
+        }
+      } else {
+        size_t col = 0;
+        for (size_t keep : columns) {
+          for (; col < keep; ++col)
+            field = std::find(field, end, ',') + 1;
+          const char* field_end = std::find(field, end, ',');
+          values.push_back(parse_value(field, field_end));
+          field = field_end + 1;
+          ++col;
+        }
+      }
+      ++rows;
+      return true;
+    }
+
+    /**
+     * Parses a single value, ignoring surrounding whitespace, with a
+     * period as the decimal point whatever the locale. The conversion
+     * is checked against the end of the field so that it never reads
+     * past the line.
+     */
+    static double parse_value(const char* begin, const char* end) {
+      while (begin != end && (*begin == ' ' || *begin == '\t'))
+        ++begin;
+      if (begin == end)
+        return 0;
+#ifdef __cpp_lib_to_chars
+      if (*begin == '+')
+        ++begin;
+      double value;
+      std::from_chars_result parsed = std::from_chars(begin, end, value);
+      if (parsed.ec == std::errc::invalid_argument)
+        return 0;
+      if (parsed.ec == std::errc::result_out_of_range) {
+        // Overflows to infinity and underflows to zero, as with strtod
+        const char* exponent = std::find_if(
+            begin, parsed.ptr, [](char c) { return c == 'e' || c == 'E'; });
+        double magnitude = exponent + 1 < parsed.ptr && exponent[1] == '-'
+                               ? 0
+                               : std::numeric_limits<double>::infinity();
+        return *begin == '-' ? -magnitude : magnitude;
+      }
+      return value;
+#else
+      char* parsed;
+      double value = std::strtod(begin, &parsed);
+      if (parsed > end || (parsed < end && *parsed == '.')) {
+        // strtod read past the comma ending the field, or stopped at
+        // the period, because the C locale uses another decimal point
+        std::istringstream field(std::string(begin, end));
+        field.imbue(std::locale::classic());
+        field >> value;
+        return field.fail() ? 0 : value;
+      }
+      if (parsed == begin)
+        return 0;
+      return value;
+#endif
+    }
+
+    void parse_timing(const std::string& line) {
+      if (line.find("(Warm-up)") != std::string::npos) {
+        int left = 17;
+        int right = line.find(" seconds");
+        double warmup;
+        std::stringstream(line.substr(left, right - left)) >> warmup;
+        timing.warmup += warmup;
+      } else if (line.find("(Sampling)") != std::string::npos) {
+        int left = 17;
+        int right = line.find(" seconds");
+        double sampling;
+        std::stringstream(line.substr(left, right - left)) >> sampling;
+        timing.sampling += sampling;
+      }
+    }
+  };
 };
 
 }  // namespace io
@@ -0,0 +1,104 @@
+#ifndef STAN_IO_VALUES_VIEW_HPP
+#define STAN_IO_VALUES_VIEW_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace io {
+
+/**
+ * A contiguous, read-only sequence of the values of a variable, as
+ * returned by <code>var_context::vals_r_view()</code> and
+ * <code>var_context::vals_i_view()</code>.
+ *
+ * A view either refers to values owned by the context, which must
+ * outlive it and must not be changed while it is in use, or owns a copy
+ * of them, for contexts that don't store the values contiguously in the
+ * requested type. Views can be moved but not copied.
+ *
+ * @tparam T type of the values
+ */
+template <typename T>
+class values_view {
+ public:
+  typedef const T* const_iterator;
+
+  /**
+   * Construct an empty view.
+   */
+  values_view() : data_(nullptr), size_(0) {}
+
+  /**
+   * Construct a view that refers to values owned elsewhere.
+   *
+   * @param data first value
+   * @param size number of values
+   */
+  values_view(const T* data, size_t size) : data_(data), size_(size) {}
+
+  /**
+   * Construct a view that refers to the values of a vector owned
+   * elsewhere.
+   *
+   * @param values values
+   */
+  explicit values_view(const std::vector<T>& values)
+      : data_(values.data()), size_(values.size()) {}
+
+  /**
+   * Construct a view that owns a copy of the values.
+   *
+   * @param values values, which are moved into the view
+   */
+  explicit values_view(std::vector<T>&& values)
+      : copy_(std::move(values)), data_(copy_.data()), size_(copy_.size()) {}
+
+  values_view(values_view&& other) noexcept { *this = std::move(other); }
+
+  values_view& operator=(values_view&& other) noexcept {
+    bool owned = other.data_ == other.copy_.data() && !other.copy_.empty();
+    copy_ = std::move(other.copy_);
+    data_ = owned ? copy_.data() : other.data_;
+    size_ = other.size_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    return *this;
+  }
+
+  values_view(const values_view&) = delete;
+  values_view& operator=(const values_view&) = delete;
+
+  const T* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  const T& operator[](size_t i) const { return data_[i]; }
+
+  const_iterator begin() const { return data_; }
+
+  const_iterator end() const { return data_ + size_; }
+
+  /**
+   * Return true if the view owns a copy of the values rather than
+   * referring to the context's.
+   */
+  bool owns_values() const { return !copy_.empty() && data_ == copy_.data(); }
+
+  /**
+   * Return a copy of the values as a vector.
+   */
+  std::vector<T> to_vector() const { return std::vector<T>(begin(), end()); }
+
+ private:
+  std::vector<T> copy_;
+  const T* data_;
+  size_t size_;
+};
+
+}  // namespace io
+}  // namespace stan
+#endif
@@ -1,6 +1,7 @@
 #ifndef STAN_IO_VAR_CONTEXT_HPP
 #define STAN_IO_VAR_CONTEXT_HPP
 
+#include <stan/io/values_view.hpp>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -85,6 +86,33 @@ class var_context {
    */
   virtual std::vector<int> vals_i(const std::string& name) const = 0;
 
+  /**
+   * Return a view of the floating point values for the variable of
+   * the specified name, as returned by <code>vals_r()</code>. Contexts
+   * that store the values contiguously as doubles should override
+   * this to return a view of them instead of a copy; the view is valid
+   * while the context is alive and unchanged. By default the view owns
+   * a copy of the values.
+   *
+   * @param name Name of variable.
+   * @return View of the values for the named variable.
+   */
+  virtual values_view<double> vals_r_view(const std::string& name) const {
+    return values_view<double>(vals_r(name));
+  }
+
+  /**
+   * Return a view of the integer values for the variable of the
+   * specified name, as returned by <code>vals_i()</code>. As with
+   * <code>vals_r_view()</code>, the default view owns a copy.
+   *
+   * @param name Name of variable.
+   * @return View of the integer values.
+   */
+  virtual values_view<int> vals_i_view(const std::string& name) const {
+    return values_view<int>(vals_i(name));
+  }
+
   /**
    * Return the dimensions of the specified floating point variable.
    * If the variable doesn't exist (or if it is a scalar), the
@@ -27,6 +27,25 @@ class writer {
   std::vector<T> data_r_;
   std::vector<int> data_i_;
 
+  /**
+   * Append the values of a vector, row vector or matrix expression in
+   * column major order, growing the real values once.
+   */
+  template <typename EigMat>
+  void append(const EigMat& x) {
+    size_t start = data_r_.size();
+    data_r_.resize(start + x.size());
+    Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>>(
+        data_r_.data() + start, x.rows(), x.cols())
+        = x;
+  }
+
+  static Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>> as_vector(
+      const std::vector<T>& y) {
+    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(y.data(),
+                                                                 y.size());
+  }
+
  public:
   typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> matrix_t;
   typedef Eigen::Matrix<T, Eigen::Dynamic, 1> vector_t;
@@ -74,6 +93,15 @@ class writer {
    */
   std::vector<int> &data_i() { return data_i_; }
 
+  /**
+   * Allocate room for the specified total number of real values, such
+   * as the number of unconstrained parameters of a model, so that
+   * writing them doesn't reallocate.
+   *
+   * @param n Number of real values.
+   */
+  void reserve(size_t n) { data_r_.reserve(n); }
+
   /**
    * Write the specified integer to the sequence of integer values.
    *
@@ -90,6 +118,16 @@ class writer {
    */
   void scalar_unconstrain(T &y) { data_r_.push_back(y); }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * scalars, all at once.
+   *
+   * @param y The values.
+   */
+  void scalar_unconstrain(const std::vector<T> &y) {
+    data_r_.insert(data_r_.end(), y.begin(), y.end());
+  }
+
   /**
    * Write the unconstrained value corresponding to the specified
    * positive-constrained scalar.  The transformation applied is
@@ -107,6 +145,19 @@ class writer {
     data_r_.push_back(log(y));
   }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * positive-constrained scalars, all at once.
+   *
+   * @param y The positive values.
+   * @throw std::runtime_error if a value is negative.
+   */
+  void scalar_pos_unconstrain(const std::vector<T> &y) {
+    if ((as_vector(y).array() < 0.0).any())
+      BOOST_THROW_EXCEPTION(std::runtime_error("y is negative"));
+    append(as_vector(y).array().log().matrix());
+  }
+
   /**
    * Return the unconstrained version of the specified input,
    * which is constrained to be above the specified lower bound.
@@ -122,6 +173,18 @@ class writer {
     data_r_.push_back(stan::math::lb_free(y, lb));
   }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * lower-bounded scalars, all at once.
+   *
+   * @param lb Lower bound.
+   * @param y Lower-bounded values.
+   * @throw std::domain_error if a value is lower than the lower bound.
+   */
+  void scalar_lb_unconstrain(double lb, const std::vector<T> &y) {
+    append(stan::math::lb_free(as_vector(y), lb));
+  }
+
   /**
    * Write the unconstrained value corresponding to the specified
    * lower-bounded value.  The unconstraining transform is
@@ -136,6 +199,18 @@ class writer {
     data_r_.push_back(stan::math::ub_free(y, ub));
   }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * upper-bounded scalars, all at once.
+   *
+   * @param ub Upper bound.
+   * @param y Upper-bounded values.
+   * @throw std::domain_error if a value is higher than the upper bound.
+   */
+  void scalar_ub_unconstrain(double ub, const std::vector<T> &y) {
+    append(stan::math::ub_free(as_vector(y), ub));
+  }
+
   /**
    * Write the unconstrained value corresponding to the specified
    * value with the specified bounds.  The unconstraining
@@ -152,6 +227,19 @@ class writer {
     data_r_.push_back(stan::math::lub_free(y, lb, ub));
   }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * bounded scalars, all at once.
+   *
+   * @param lb Lower bound.
+   * @param ub Upper bound.
+   * @param y Bounded values.
+   * @throw std::domain_error if a value is not between the bounds.
+   */
+  void scalar_lub_unconstrain(double lb, double ub, const std::vector<T> &y) {
+    append(stan::math::lub_free(as_vector(y), lb, ub));
+  }
+
   /**
    * Write the unconstrained value corresponding to the specified
    * value with the specified offset and multiplier.  The unconstraining
@@ -169,6 +257,20 @@ class writer {
         stan::math::offset_multiplier_free(y, offset, multiplier));
   }
 
+  /**
+   * Write the unconstrained values corresponding to an array of
+   * scalars with the specified offset and multiplier, all at once.
+   *
+   * @param offset offset.
+   * @param multiplier multiplier.
+   * @param y Values.
+   */
+  void scalar_offset_multiplier_unconstrain(double offset, double multiplier,
+                                            const std::vector<T> &y) {
+    append(stan::math::offset_multiplier_free(as_vector(y), offset,
+                                              multiplier));
+  }
+
   /**
    * Write the unconstrained value corresponding to the specified
    * correlation-constrained variable.
@@ -210,14 +312,14 @@ class writer {
    * @throw std::runtime_error if vector is not in ascending order.
    */
   void ordered_unconstrain(vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
     if (y.size() == 0)
       return;
     stan::math::check_ordered("stan::io::ordered_unconstrain", "Vector", y);
     data_r_.push_back(y[0]);
-    for (idx_t i = 1; i < y.size(); ++i) {
-      data_r_.push_back(log(y[i] - y[i - 1]));
-    }
+    append((y.tail(y.size() - 1) - y.head(y.size() - 1))
+               .array()
+               .log()
+               .matrix());
   }
 
   /**
@@ -237,17 +339,16 @@ class writer {
    * @throw std::runtime_error if vector is not in ascending order.
    */
   void positive_ordered_unconstrain(vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-
     // reimplements pos_ordered_free in prob to avoid malloc
     if (y.size() == 0)
       return;
     stan::math::check_positive_ordered("stan::io::positive_ordered_unconstrain",
                                        "Vector", y);
     data_r_.push_back(log(y[0]));
-    for (idx_t i = 1; i < y.size(); ++i) {
-      data_r_.push_back(log(y[i] - y[i - 1]));
-    }
+    append((y.tail(y.size() - 1) - y.head(y.size() - 1))
+               .array()
+               .log()
+               .matrix());
   }
 
   /**
@@ -255,105 +356,64 @@ class writer {
    *
    * @param y Vector to write.
    */
-  void vector_unconstrain(const vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      data_r_.push_back(y[i]);
-  }
+  void vector_unconstrain(const vector_t &y) { append(y); }
 
   /**
    * Write the specified unconstrained vector.
    *
    * @param y Vector to write.
    */
-  void row_vector_unconstrain(const vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      data_r_.push_back(y[i]);
-  }
+  void row_vector_unconstrain(const vector_t &y) { append(y); }
 
   /**
    * Write the specified unconstrained matrix.
    *
    * @param y Matrix to write.
    */
-  void matrix_unconstrain(const matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-    for (idx_t j = 0; j < y.cols(); ++j)
-      for (idx_t i = 0; i < y.rows(); ++i)
-        data_r_.push_back(y(i, j));
-  }
+  void matrix_unconstrain(const matrix_t &y) { append(y); }
 
   void vector_lb_unconstrain(double lb, vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_lb_unconstrain(lb, y(i));
+    append(stan::math::lb_free(y, lb));
   }
   void row_vector_lb_unconstrain(double lb, row_vector_t &y) {
-    typedef typename stan::math::index_type<row_vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_lb_unconstrain(lb, y(i));
+    append(stan::math::lb_free(y, lb));
   }
   void matrix_lb_unconstrain(double lb, matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-    for (idx_t j = 0; j < y.cols(); ++j)
-      for (idx_t i = 0; i < y.rows(); ++i)
-        scalar_lb_unconstrain(lb, y(i, j));
+    append(stan::math::lb_free(y, lb));
   }
 
   void vector_ub_unconstrain(double ub, vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_ub_unconstrain(ub, y(i));
+    append(stan::math::ub_free(y, ub));
   }
   void row_vector_ub_unconstrain(double ub, row_vector_t &y) {
-    typedef typename stan::math::index_type<row_vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_ub_unconstrain(ub, y(i));
+    append(stan::math::ub_free(y, ub));
   }
   void matrix_ub_unconstrain(double ub, matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-    for (idx_t j = 0; j < y.cols(); ++j)
-      for (idx_t i = 0; i < y.rows(); ++i)
-        scalar_ub_unconstrain(ub, y(i, j));
+    append(stan::math::ub_free(y, ub));
   }
 
   void vector_lub_unconstrain(double lb, double ub, vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_lub_unconstrain(lb, ub, y(i));
+    append(stan::math::lub_free(y, lb, ub));
   }
   void row_vector_lub_unconstrain(double lb, double ub, row_vector_t &y) {
-    typedef typename stan::math::index_type<row_vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_lub_unconstrain(lb, ub, y(i));
+    append(stan::math::lub_free(y, lb, ub));
   }
   void matrix_lub_unconstrain(double lb, double ub, matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-    for (idx_t j = 0; j < y.cols(); ++j)
-      for (idx_t i = 0; i < y.rows(); ++i)
-        scalar_lub_unconstrain(lb, ub, y(i, j));
+    append(stan::math::lub_free(y, lb, ub));
   }
 
   void vector_offset_multiplier_unconstrain(double offset, double multiplier,
                                             vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_offset_multiplier_unconstrain(offset, multiplier, y(i));
+    append(stan::math::offset_multiplier_free(y, offset, multiplier));
   }
   void row_vector_offset_multiplier_unconstrain(double offset,
                                                 double multiplier,
                                                 row_vector_t &y) {
-    typedef typename stan::math::index_type<row_vector_t>::type idx_t;
-    for (idx_t i = 0; i < y.size(); ++i)
-      scalar_offset_multiplier_unconstrain(offset, multiplier, y(i));
+    append(stan::math::offset_multiplier_free(y, offset, multiplier));
   }
   void matrix_offset_multiplier_unconstrain(double offset, double multiplier,
                                             matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-    for (idx_t j = 0; j < y.cols(); ++j)
-      for (idx_t i = 0; i < y.rows(); ++i)
-        scalar_offset_multiplier_unconstrain(offset, multiplier, y(i, j));
+    append(stan::math::offset_multiplier_free(y, offset, multiplier));
   }
 
   /**
@@ -374,10 +434,7 @@ class writer {
   void unit_vector_unconstrain(vector_t &y) {
     stan::math::check_unit_vector("stan::io::unit_vector_unconstrain", "Vector",
                                   y);
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-    vector_t uy = stan::math::unit_vector_free(y);
-    for (idx_t i = 0; i < uy.size(); ++i)
-      data_r_.push_back(uy[i]);
+    append(stan::math::unit_vector_free(y));
   }
 
   /**
@@ -395,12 +452,8 @@ class writer {
    * @throw std::runtime_error if the vector is not a simplex.
    */
   void simplex_unconstrain(vector_t &y) {
-    typedef typename stan::math::index_type<vector_t>::type idx_t;
-
     stan::math::check_simplex("stan::io::simplex_unconstrain", "Vector", y);
-    vector_t uy = stan::math::simplex_free(y);
-    for (idx_t i = 0; i < uy.size(); ++i)
-      data_r_.push_back(uy[i]);
+    append(stan::math::simplex_free(y));
   }
 
   /**
@@ -415,13 +468,8 @@ class writer {
    * @throw std::runtime_error if y has no elements or if it is not square
    */
   void cholesky_factor_cov_unconstrain(matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-
     // FIXME:  optimize by unrolling cholesky_factor_free
-    Eigen::Matrix<T, Eigen::Dynamic, 1> y_free
-        = stan::math::cholesky_factor_free(y);
-    for (idx_t i = 0; i < y_free.size(); ++i)
-      data_r_.push_back(y_free[i]);
+    append(stan::math::cholesky_factor_free(y));
   }
 
   /**
@@ -436,13 +484,8 @@ class writer {
    * @throw std::runtime_error if y has no elements or if it is not square
    */
   void cholesky_factor_corr_unconstrain(matrix_t &y) {
-    typedef typename stan::math::index_type<matrix_t>::type idx_t;
-
     // FIXME:  optimize by unrolling cholesky_factor_free
-    Eigen::Matrix<T, Eigen::Dynamic, 1> y_free
-        = stan::math::cholesky_corr_free(y);
-    for (idx_t i = 0; i < y_free.size(); ++i)
-      data_r_.push_back(y_free[i]);
+    append(stan::math::cholesky_corr_free(y));
   }
 
   /**
@@ -464,11 +507,7 @@ class writer {
           std::runtime_error("y must have elements and"
                              " y must be a square matrix"));
     vector_t L_vec = stan::math::cov_matrix_free(y);
-    int i = 0;
-    for (idx_t m = 0; m < k; ++m) {
-      for (idx_t n = 0; n <= m; ++n)
-        data_r_.push_back(L_vec.coeff(i++));
-    }
+    append(L_vec.head((k * (k + 1)) / 2));
   }
 
   /**
@@ -494,8 +533,7 @@ class writer {
     idx_t k = y.rows();
     idx_t k_choose_2 = (k * (k - 1)) / 2;
     vector_t cpcs = stan::math::corr_matrix_free(y);
-    for (idx_t i = 0; i < k_choose_2; ++i)
-      data_r_.push_back(cpcs[i]);
+    append(cpcs.head(k_choose_2));
   }
 };
 }  // namespace io
@@ -1,6 +1,11 @@
 #ifndef STAN_MCMC_BASE_ADAPTER_HPP
 #define STAN_MCMC_BASE_ADAPTER_HPP
 
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <string>
+
 namespace stan {
 namespace mcmc {
 
@@ -14,6 +19,48 @@ class base_adapter {
 
   bool adapting() { return adapt_flag_; }
 
+  /**
+   * Return true if the adaptation uses an adaptive schedule that may
+   * end warmup before the configured number of iterations.
+   */
+  virtual bool adaptive_schedule() const { return false; }
+
+  /**
+   * Return true if the adaptive schedule has converged, so that warmup
+   * can end after the current iteration.
+   */
+  virtual bool adaptation_converged() { return false; }
+
+  /**
+   * Write the schedule the adaptation has followed with the adaptation
+   * info.
+   *
+   * @param writer writer of the adaptation info
+   */
+  virtual void write_adaptation_schedule(callbacks::writer& writer) {}
+
+  /**
+   * Return the name of the warmup phase the next adaptation step
+   * belongs to, such as a buffer or a slow adaptation window.
+   */
+  virtual std::string adaptation_phase() const { return "stepsize"; }
+
+  /**
+   * Return the total wall clock time spent computing metric estimates,
+   * in seconds.
+   */
+  virtual double adaptation_estimate_seconds() const { return 0; }
+
+  void write_adapter_state(state_writer& writer) const {
+    writer.tag("adapter");
+    writer.write(adapt_flag_);
+  }
+
+  void read_adapter_state(state_reader& reader) {
+    reader.tag("adapter");
+    reader.read(adapt_flag_);
+  }
+
  protected:
   bool adapt_flag_;
 };
@@ -4,6 +4,7 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/mcmc/sample.hpp>
+#include <stan/mcmc/sampler_state.hpp>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -29,6 +30,26 @@ class base_mcmc {
       std::vector<std::string>& model_names, std::vector<std::string>& names) {}
 
   virtual void get_sampler_diagnostics(std::vector<double>& values) {}
+
+  /**
+   * Write the state the sampler carries from one transition to the
+   * next, such as the current point and step size. Settings given
+   * before sampling starts and random number generators are not
+   * included.
+   *
+   * @param writer state writer
+   */
+  virtual void write_state(state_writer& writer) const {}
+
+  /**
+   * Restore a state written by <code>write_state()</code> to a sampler
+   * configured in the same way, so that later transitions continue
+   * exactly as they would have.
+   *
+   * @param reader state reader
+   * @throws std::invalid_argument if the state is malformed
+   */
+  virtual void read_state(state_reader& reader) {}
 };
 
 }  // namespace mcmc
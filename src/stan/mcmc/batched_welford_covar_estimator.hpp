@@ -0,0 +1,152 @@
+#ifndef STAN_MCMC_BATCHED_WELFORD_COVAR_ESTIMATOR_HPP
+#define STAN_MCMC_BATCHED_WELFORD_COVAR_ESTIMATOR_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stdexcept>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Running mean and covariance of draws, with the interface of
+ * <code>stan::math::welford_covar_estimator</code>, that buffers the
+ * draws and folds them into the running sums a batch at a time.
+ *
+ * Adding draws one at a time costs a rank one update of the n x n sum
+ * of squares per draw. Here a full batch of b draws is centered on its
+ * own mean and added with a single rank b update, which Eigen computes
+ * as a blocked, vectorized symmetric product over the lower triangle
+ * only, and then merged with the running sums by the pairwise update of
+ * Chan et al. The running sums match those of adding the draws one at a
+ * time up to rounding. Pending draws are flushed before any estimate is
+ * returned, so the estimate at the end of an adaptation window includes
+ * every draw of the window.
+ */
+class batched_welford_covar_estimator {
+ public:
+  /**
+   * Construct an estimator of n parameters.
+   *
+   * @param n number of parameters
+   * @param batch_size number of draws buffered before they are added to
+   *   the running sums
+   * @throws std::invalid_argument if the batch size isn't positive
+   */
+  explicit batched_welford_covar_estimator(int n, int batch_size = 32)
+      : num_samples_(0),
+        m_(Eigen::VectorXd::Zero(n)),
+        m2_(Eigen::MatrixXd::Zero(n, n)),
+        batch_(n, batch_size),
+        batch_count_(0) {
+    if (batch_size < 1)
+      throw std::invalid_argument(
+          "batched_welford_covar_estimator: batch size must be positive");
+  }
+
+  void restart() {
+    num_samples_ = 0;
+    m_.setZero();
+    m2_.setZero();
+    batch_count_ = 0;
+  }
+
+  int num_samples() const { return num_samples_ + batch_count_; }
+
+  void add_sample(const Eigen::VectorXd& q) {
+    batch_.col(batch_count_++) = q;
+    if (batch_count_ == batch_.cols())
+      flush();
+  }
+
+  void sample_mean(Eigen::VectorXd& mean) {
+    flush();
+    mean = m_;
+  }
+
+  void sample_covariance(Eigen::MatrixXd& covar) {
+    flush();
+    if (num_samples_ > 1) {
+      covar = m2_.selfadjointView<Eigen::Lower>();
+      covar /= num_samples_ - 1.0;
+    }
+  }
+
+  /**
+   * Write the running sums, including the pending draws, in the format
+   * of <code>welford_covar_estimator::write_state()</code>.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    batched_welford_covar_estimator flushed(*this);
+    flushed.flush();
+    writer.write(flushed.num_samples_);
+    writer.write(flushed.m_);
+    writer.write(
+        Eigen::MatrixXd(flushed.m2_.selfadjointView<Eigen::Lower>()));
+  }
+
+  /**
+   * Read running sums written by <code>write_state()</code> or by
+   * <code>welford_covar_estimator::write_state()</code>.
+   * The estimator is unchanged if they can't be read.
+   *
+   * @param reader state reader
+   * @throws std::invalid_argument if the sums can't be read or have
+   *   another dimension
+   */
+  void read_state(state_reader& reader) {
+    double num_samples;
+    Eigen::VectorXd m;
+    Eigen::MatrixXd m2;
+    reader.read(num_samples);
+    reader.read(m);
+    reader.read(m2);
+    if (m.size() != m_.size() || m2.rows() != m2_.rows()
+        || m2.cols() != m2_.cols())
+      throw std::invalid_argument("Sampler state: estimator size mismatch");
+    num_samples_ = num_samples;
+    m_ = m;
+    m2_ = m2;
+    batch_count_ = 0;
+  }
+
+ protected:
+  double num_samples_;
+  Eigen::VectorXd m_;
+  /**
+   * Sum of squared deviations from the mean, of which only the lower
+   * triangle is kept up to date.
+   */
+  Eigen::MatrixXd m2_;
+  Eigen::MatrixXd batch_;
+  int batch_count_;
+
+  /**
+   * Add the pending draws to the running sums.
+   */
+  void flush() {
+    if (batch_count_ == 0)
+      return;
+    double b = batch_count_;
+    double n = num_samples_ + b;
+    auto batch = batch_.leftCols(batch_count_);
+    Eigen::VectorXd batch_mean = batch.rowwise().mean();
+    batch.colwise() -= batch_mean;
+    Eigen::VectorXd delta = batch_mean - m_;
+    m2_.selfadjointView<Eigen::Lower>().rankUpdate(batch);
+    m2_.selfadjointView<Eigen::Lower>().rankUpdate(delta,
+                                                    num_samples_ * b / n);
+    m_ += (b / n) * delta;
+    num_samples_ = n;
+    batch_count_ = 0;
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
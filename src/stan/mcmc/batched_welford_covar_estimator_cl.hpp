@@ -0,0 +1,181 @@
+#ifndef STAN_MCMC_BATCHED_WELFORD_COVAR_ESTIMATOR_CL_HPP
+#define STAN_MCMC_BATCHED_WELFORD_COVAR_ESTIMATOR_CL_HPP
+#ifdef STAN_OPENCL
+
+#include <stan/math/opencl/prim.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Running mean and covariance of draws, with the interface of
+ * <code>batched_welford_covar_estimator</code>, whose n x n sum of
+ * squares is kept and updated on the OpenCL device.
+ *
+ * Draws are buffered on the host. A full batch of b draws is centered
+ * on its own mean, and the correction of the pairwise update of Chan et
+ * al. is appended to it as one more weighted column, so the whole
+ * update is a single rank b + 1 product computed on the device. Only
+ * the batch crosses the bus. The product is added a panel of rows at a
+ * time, so the device never holds a second n x n matrix. The sums
+ * match those of <code>batched_welford_covar_estimator</code> up to
+ * rounding.
+ */
+class batched_welford_covar_estimator_cl {
+ public:
+  /**
+   * Construct an estimator of n parameters.
+   *
+   * @param n number of parameters
+   * @param batch_size number of draws buffered before they are added to
+   *   the running sums
+   * @throws std::invalid_argument if the batch size isn't positive
+   */
+  explicit batched_welford_covar_estimator_cl(int n, int batch_size = 32)
+      : num_samples_(0),
+        m_(Eigen::VectorXd::Zero(n)),
+        m2_cl_(n, n),
+        batch_(n, batch_size),
+        batch_count_(0) {
+    if (batch_size < 1)
+      throw std::invalid_argument(
+          "batched_welford_covar_estimator_cl: batch size must be positive");
+    m2_cl_ = stan::math::constant(0.0, n, n);
+  }
+
+  void restart() {
+    num_samples_ = 0;
+    m_.setZero();
+    m2_cl_ = stan::math::constant(0.0, m_.size(), m_.size());
+    batch_count_ = 0;
+  }
+
+  int num_samples() const { return num_samples_ + batch_count_; }
+
+  void add_sample(const Eigen::VectorXd& q) {
+    batch_.col(batch_count_++) = q;
+    if (batch_count_ == batch_.cols())
+      flush();
+  }
+
+  void sample_mean(Eigen::VectorXd& mean) {
+    flush();
+    mean = m_;
+  }
+
+  /**
+   * Copy the sample covariance from the device.
+   *
+   * @param[out] covar sample covariance, unchanged if there are fewer
+   *   than two draws
+   */
+  void sample_covariance(Eigen::MatrixXd& covar) {
+    flush();
+    if (num_samples_ > 1) {
+      covar = stan::math::from_matrix_cl(m2_cl_);
+      covar /= num_samples_ - 1.0;
+    }
+  }
+
+  /**
+   * Write the running sums, including the pending draws, in the format
+   * of <code>batched_welford_covar_estimator::write_state()</code>.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    batched_welford_covar_estimator_cl flushed(*this);
+    flushed.flush();
+    writer.write(flushed.num_samples_);
+    writer.write(flushed.m_);
+    writer.write(Eigen::MatrixXd(stan::math::from_matrix_cl(flushed.m2_cl_)));
+  }
+
+  /**
+   * Read running sums written by <code>write_state()</code> or by the
+   * host estimators. The estimator is unchanged if they can't be read.
+   *
+   * @param reader state reader
+   * @throws std::invalid_argument if the sums can't be read or have
+   *   another dimension
+   */
+  void read_state(state_reader& reader) {
+    double num_samples;
+    Eigen::VectorXd m;
+    Eigen::MatrixXd m2;
+    reader.read(num_samples);
+    reader.read(m);
+    reader.read(m2);
+    if (m.size() != m_.size() || m2.rows() != m_.size()
+        || m2.cols() != m_.size())
+      throw std::invalid_argument("Sampler state: estimator size mismatch");
+    num_samples_ = num_samples;
+    m_ = m;
+    m2_cl_ = stan::math::to_matrix_cl(m2);
+    batch_count_ = 0;
+  }
+
+ protected:
+  /**
+   * Upper bound on the number of elements of the temporary product of
+   * a panel of rows.
+   */
+  static constexpr int panel_elements_ = 1 << 24;
+
+  double num_samples_;
+  Eigen::VectorXd m_;
+  /**
+   * Sum of squared deviations from the mean, on the device.
+   */
+  stan::math::matrix_cl<double> m2_cl_;
+  Eigen::MatrixXd batch_;
+  int batch_count_;
+
+  /**
+   * Add the pending draws to the running sums.
+   */
+  void flush() {
+    if (batch_count_ == 0)
+      return;
+    double b = batch_count_;
+    double n = num_samples_ + b;
+    int dim = m_.size();
+    Eigen::MatrixXd update(dim, batch_count_ + 1);
+    update.leftCols(batch_count_) = batch_.leftCols(batch_count_);
+    Eigen::VectorXd batch_mean = update.leftCols(batch_count_).rowwise().mean();
+    update.leftCols(batch_count_).colwise() -= batch_mean;
+    Eigen::VectorXd delta = batch_mean - m_;
+    update.col(batch_count_) = std::sqrt(num_samples_ * b / n) * delta;
+
+    stan::math::matrix_cl<double> update_cl = stan::math::to_matrix_cl(update);
+    stan::math::matrix_cl<double> update_t_cl
+        = stan::math::transpose(update_cl);
+    int panel = std::max(1, std::min(dim, panel_elements_ / dim));
+    for (int start = 0; start < dim; start += panel) {
+      int rows = std::min(panel, dim - start);
+      stan::math::matrix_cl<double> panel_cl
+          = stan::math::block_zero_based(update_cl, start, 0, rows,
+                                         update.cols())
+            * update_t_cl;
+      stan::math::block_zero_based(m2_cl_, start, 0, rows, dim)
+          = stan::math::block_zero_based(m2_cl_, start, 0, rows, dim)
+            + panel_cl;
+    }
+    m_ += (b / n) * delta;
+    num_samples_ = n;
+    batch_count_ = 0;
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
+#endif
@@ -0,0 +1,120 @@
+#ifndef STAN_MCMC_BLOCK_COVAR_ADAPTATION_HPP
+#define STAN_MCMC_BLOCK_COVAR_ADAPTATION_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/welford_covar_estimator.hpp>
+#include <stan/mcmc/windowed_adaptation.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Windowed adaptation of a block diagonal covariance. Each block of
+ * consecutive parameters has its own Welford estimator and gets the
+ * same regularization as <code>covar_adaptation</code>, so no
+ * correlation between blocks is ever estimated or stored.
+ */
+class block_covar_adaptation : public windowed_adaptation {
+ public:
+  /**
+   * Construct an adaptation of n parameters with n blocks of size one.
+   *
+   * @param n number of parameters
+   */
+  explicit block_covar_adaptation(int n)
+      : windowed_adaptation("block covariance") {
+    set_blocks(std::vector<int>(n, 1));
+  }
+
+  /**
+   * Set the sizes of the consecutive blocks and restart the estimators.
+   *
+   * @param block_sizes sizes of the blocks
+   */
+  void set_blocks(const std::vector<int>& block_sizes) {
+    block_sizes_ = block_sizes;
+    block_starts_.clear();
+    estimators_.clear();
+    int start = 0;
+    for (int size : block_sizes) {
+      block_starts_.push_back(start);
+      estimators_.emplace_back(size);
+      start += size;
+    }
+  }
+
+  bool learn_covariance(std::vector<Eigen::MatrixXd>& covar,
+                        const Eigen::VectorXd& q) {
+    STAN_INSTRUMENT_REGION("learn_covariance");
+    if (adaptation_window()) {
+      for (size_t b = 0; b < estimators_.size(); ++b)
+        estimators_[b].add_sample(
+            q.segment(block_starts_[b], block_sizes_[b]));
+    }
+
+    if (end_adaptation_window()) {
+      compute_next_window();
+
+      start_estimate();
+      covar.resize(estimators_.size());
+      for (size_t b = 0; b < estimators_.size(); ++b) {
+        int size = block_sizes_[b];
+        covar[b] = Eigen::MatrixXd::Zero(size, size);
+        estimators_[b].sample_covariance(covar[b]);
+
+        double n = static_cast<double>(estimators_[b].num_samples());
+        covar[b] = (n / (n + 5.0)) * covar[b]
+                   + 1e-3 * (5.0 / (n + 5.0))
+                         * Eigen::MatrixXd::Identity(size, size);
+
+        estimators_[b].restart();
+      }
+      end_estimate();
+
+      ++adapt_window_counter_;
+      return true;
+    }
+
+    ++adapt_window_counter_;
+    return false;
+  }
+
+  /**
+   * Write the window position and the running sums of every block.
+   * The block structure is part of the configuration and must be set
+   * before the state is read.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    writer.write(block_sizes_);
+    for (const welford_covar_estimator& estimator : estimators_)
+      estimator.write_state(writer);
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    std::vector<int> block_sizes;
+    reader.read(block_sizes);
+    if (block_sizes != block_sizes_)
+      throw std::invalid_argument("Sampler state: block sizes don't match");
+    for (welford_covar_estimator& estimator : estimators_)
+      estimator.read_state(reader);
+  }
+
+ protected:
+  std::vector<int> block_sizes_;
+  std::vector<int> block_starts_;
+  std::vector<welford_covar_estimator> estimators_;
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef STAN_MCMC_CHAINS_HPP
 #define STAN_MCMC_CHAINS_HPP
 
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/binary_var_context.hpp>
+#include <stan/io/column_type.hpp>
 #include <stan/io/stan_csv_reader.hpp>
 #include <stan/math/prim.hpp>
 #include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
@@ -15,10 +18,16 @@
 #include <boost/accumulators/statistics/variates/covariate.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 #include <boost/random/additive_combine.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <string>
 #include <sstream>
@@ -30,6 +39,29 @@ namespace stan {
 namespace mcmc {
 using Eigen::Dynamic;
 
+/**
+ * Summary statistics of the kept draws of a parameter across all
+ * chains, as returned by <code>chains::summary()</code>.
+ */
+struct parameter_summary {
+  double mean;
+  double sd;
+  /**
+   * Monte Carlo standard error of the mean, the standard deviation
+   * over the square root of the effective sample size.
+   */
+  double mcse;
+  Eigen::VectorXd quantiles;
+  /**
+   * Split effective sample size.
+   */
+  double ess;
+  /**
+   * Split potential scale reduction.
+   */
+  double rhat;
+};
+
 /**
  * An <code>mcmc::chains</code> object stores parameter names and
  * dimensionalities along with samples from multiple chains.
@@ -40,16 +72,225 @@ using Eigen::Dynamic;
  * chains.  Readers for single chains need only be read/write locked
  * with writers of that chain.  For reading across chains, full
  * read/write locking is required.  Thus methods will be classified
- * as global or single-chain read or write methods.
+ * as global or single-chain read or write methods. To analyze chains
+ * while they run, accumulate their draws in a <code>live_chains</code>
+ * object, which needs no locks, and take snapshots of it.
  *
  * <p><b>Storage Order</b>: Storage is column/last-index major.
+ *
+ * <p><b>Storage Growth</b>: The storage of a chain grows geometrically,
+ * so adding draws one at a time takes amortized constant time per
+ * draw. Use <code>reserve()</code> to allocate it once when the number
+ * of draws is known in advance.
+ *
+ * <p><b>Mapped Chains</b>: A chain added with <code>add_mapped()</code>
+ * is read in place from a memory mapped columnar draws file, written by
+ * <code>write_columnar()</code>, without copying it. Its pages are read
+ * only as the statistics touch them, and processes analyzing the same
+ * file share them in the page cache. Mapped chains can't be added to.
+ *
+ * <p><b>Column Types</b>: Integer valued columns, indicators and
+ * columns that don't need double precision can be stored as narrower
+ * types with <code>set_column_types()</code>, and are widened to
+ * <code>double</code> when they are read.
  */
 template <class RNG = boost::random::ecuyer1988>
 class chains {
  private:
   std::vector<std::string> param_names_;
   Eigen::Matrix<Eigen::MatrixXd, Dynamic, 1> samples_;
+  Eigen::VectorXi num_samples_;
   Eigen::VectorXi warmup_;
+  // Files the mapped chains are read from and their draws, null for
+  // the other chains
+  std::vector<std::shared_ptr<const io::binary_var_context>> mapped_;
+  std::vector<const double*> mapped_draws_;
+  // Storage type of each parameter and its column in the storage of
+  // its type: the columns of samples_ for float64 parameters and of
+  // narrow_ for the others
+  std::vector<io::column_type> column_types_;
+  std::vector<int> slot_;
+  int num_float64_;
+  // Bytes of the narrow columns of each chain
+  std::vector<std::vector<std::vector<unsigned char>>> narrow_;
+
+  bool is_narrow(const int chain, const int index) const {
+    return !mapped_draws_[chain]
+           && column_types_[index] != io::column_type::float64;
+  }
+
+  /**
+   * Return the draws of a parameter stored as doubles in a chain, which
+   * are the leading rows of a column of its storage or of its mapped
+   * file.
+   */
+  const double* column(const int chain, const int index) const {
+    if (mapped_draws_[chain])
+      return mapped_draws_[chain]
+             + static_cast<size_t>(index) * num_samples_(chain);
+    return samples_(chain).col(slot_[index]).data();
+  }
+
+  /**
+   * Return the kept draws of a parameter in a chain, which are the
+   * trailing draws of its leading rows of storage, in place for a
+   * column of doubles and otherwise widened into a buffer.
+   *
+   * @param buffer room for the kept draws of the chain
+   * @return pointer to the kept draws
+   */
+  const double* kept_samples(const int chain, const int index,
+                             double* buffer) const {
+    if (!is_narrow(chain, index))
+      return column(chain, index) + warmup_(chain);
+    io::column_type type = column_types_[index];
+    size_t width = io::column_width(type);
+    const unsigned char* bytes
+        = narrow_[chain][slot_[index]].data() + width * warmup_(chain);
+    for (int i = 0; i < num_kept_samples(chain); ++i, bytes += width)
+      buffer[i] = io::load_column_value(type, bytes);
+    return buffer;
+  }
+
+  void resize_chains(const int n_chains) {
+    int n = num_chains();
+
+    // Need this block for Windows. conservativeResize
+    // does not keep the references.
+    Eigen::Matrix<Eigen::MatrixXd, Dynamic, 1> samples_copy(n);
+    for (int i = 0; i < n; i++)
+      samples_copy(i).swap(samples_(i));
+    Eigen::VectorXi num_samples_copy = num_samples_;
+    Eigen::VectorXi warmup_copy = warmup_;
+
+    samples_.resize(n_chains);
+    num_samples_.resize(n_chains);
+    warmup_.resize(n_chains);
+    mapped_.resize(n_chains);
+    mapped_draws_.resize(n_chains, nullptr);
+    narrow_.resize(n_chains);
+    for (int i = 0; i < n; i++) {
+      samples_(i).swap(samples_copy(i));
+      num_samples_(i) = num_samples_copy(i);
+      warmup_(i) = warmup_copy(i);
+    }
+    for (int i = n; i < n_chains; i++) {
+      samples_(i) = Eigen::MatrixXd(0, num_float64_);
+      narrow_[i].assign(num_params() - num_float64_, {});
+      num_samples_(i) = 0;
+      warmup_(i) = 0;
+    }
+  }
+
+  void reserve_rows(const int chain, const int rows) {
+    if (mapped_[chain])
+      throw std::invalid_argument("chains: can't add draws to a mapped chain");
+    if (rows <= samples_(chain).rows())
+      return;
+    Eigen::MatrixXd grown(rows, num_float64_);
+    grown.topRows(num_samples_(chain))
+        = samples_(chain).topRows(num_samples_(chain));
+    samples_(chain).swap(grown);
+    for (int index = 0; index < num_params(); ++index)
+      if (is_narrow(chain, index))
+        narrow_[chain][slot_[index]].resize(
+            rows * io::column_width(column_types_[index]));
+  }
+
+  /**
+   * Point to the kept draws of a parameter in each chain, which are
+   * contiguous in the column major storage, or are widened into a
+   * buffer if the parameter is stored narrower.
+   */
+  void kept_draws(const int index, std::vector<const double*>& draws,
+                  std::vector<size_t>& sizes,
+                  std::vector<double>& buffer) const {
+    int n_chains = num_chains();
+    draws.resize(n_chains);
+    sizes.resize(n_chains);
+    buffer.resize(num_kept_samples());
+    size_t start = 0;
+    for (int chain = 0; chain < n_chains; ++chain) {
+      draws[chain] = kept_samples(chain, index, buffer.data() + start);
+      sizes[chain] = num_kept_samples(chain);
+      start += sizes[chain];
+    }
+  }
+
+  std::vector<int> all_indices() const {
+    std::vector<int> indices(num_params());
+    for (int i = 0; i < num_params(); ++i)
+      indices[i] = i;
+    return indices;
+  }
+
+  /**
+   * Evaluate a diagnostic of each of the specified parameters in
+   * parallel on the TBB thread pool. Each worker thread reuses its
+   * pointer vectors and one autocovariance engine across parameters.
+   *
+   * @tparam F Type of the diagnostic, callable as
+   *   <code>double f(draws, sizes, engine)</code>
+   */
+  template <typename F>
+  Eigen::VectorXd for_each_parameter(const std::vector<int>& indices,
+                                     const F& f) const {
+    for (int index : indices)
+      if (index < 0 || index >= num_params())
+        throw std::out_of_range("chains: parameter index out of range");
+    Eigen::VectorXd result(indices.size());
+    tbb::enumerable_thread_specific<analyze::autocovariance_engine<double>>
+        engines;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, indices.size()),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        std::vector<const double*> draws;
+                        std::vector<size_t> sizes;
+                        std::vector<double> buffer;
+                        analyze::autocovariance_engine<double>& engine
+                            = engines.local();
+                        for (size_t i = r.begin(); i != r.end(); ++i) {
+                          kept_draws(indices[i], draws, sizes, buffer);
+                          result(i) = f(draws, sizes, engine);
+                        }
+                      });
+    return result;
+  }
+
+  parameter_summary summary(const int index, const Eigen::VectorXd& probs,
+                            analyze::autocovariance_engine<double>& engine,
+                            std::vector<double>& scratch) const {
+    int n_chains = num_chains();
+    std::vector<const double*> draws(n_chains);
+    std::vector<size_t> sizes(n_chains);
+    scratch.resize(num_kept_samples());
+    double sum = 0;
+    size_t start = 0;
+    for (int chain = 0; chain < n_chains; ++chain) {
+      double* copy = scratch.data() + start;
+      const double* x = kept_samples(chain, index, copy);
+      int n = num_kept_samples(chain);
+      draws[chain] = x;
+      sizes[chain] = n;
+      for (int i = 0; i < n; ++i) {
+        sum += x[i];
+        copy[i] = x[i];
+      }
+      start += n;
+    }
+
+    parameter_summary s;
+    double N = scratch.size();
+    s.mean = sum / N;
+    double sum_sq = 0;
+    for (double x : scratch)
+      sum_sq += (x - s.mean) * (x - s.mean);
+    s.sd = std::sqrt(sum_sq / (N - 1));
+    s.ess = analyze::compute_split_effective_sample_size(draws, sizes, engine);
+    s.mcse = s.sd / std::sqrt(s.ess);
+    s.rhat = analyze::compute_split_potential_scale_reduction(draws, sizes);
+    s.quantiles = quantiles_in_place(scratch, probs);
+    return s;
+  }
 
   static double mean(const Eigen::VectorXd& x) {
     return (x.array() / x.size()).sum();
@@ -109,66 +350,40 @@ class chains {
                        * boost::accumulators::variance(acc_y));
   }
 
-  static double quantile(const Eigen::VectorXd& x, const double prob) {
-    using boost::accumulators::accumulator_set;
-    using boost::accumulators::left;
-    using boost::accumulators::quantile;
-    using boost::accumulators::quantile_probability;
-    using boost::accumulators::right;
-    using boost::accumulators::stats;
-    using boost::accumulators::tag::tail;
-    using boost::accumulators::tag::tail_quantile;
-    double M = x.rows();
-    // size_t cache_size = std::min(prob, 1-prob)*M + 2;
-    size_t cache_size = M;
-
-    if (prob < 0.5) {
-      accumulator_set<double, stats<tail_quantile<left> > > acc(
-          tail<left>::cache_size = cache_size);
-      for (int i = 0; i < M; i++)
-        acc(x(i));
-      return quantile(acc, quantile_probability = prob);
+  /**
+   * Return the quantiles of the values in a buffer, which is
+   * reordered. For probability p, the quantile is the ceil(p * n)-th
+   * smallest of the n values when p < 0.5 and the ceil((1 - p) * n)-th
+   * largest otherwise, as for the tail quantiles of
+   * Boost.Accumulators, found by partial sorting.
+   */
+  static Eigen::VectorXd quantiles_in_place(std::vector<double>& x,
+                                            const Eigen::VectorXd& probs) {
+    int M = x.size();
+    Eigen::VectorXd q(probs.size());
+    for (int i = 0; i < probs.size(); i++) {
+      if (M == 0) {
+        q(i) = std::numeric_limits<double>::quiet_NaN();
+        continue;
+      }
+      int k = probs(i) < 0.5
+                  ? static_cast<int>(std::ceil(M * probs(i))) - 1
+                  : M - static_cast<int>(std::ceil(M * (1. - probs(i))));
+      k = std::min(std::max(k, 0), M - 1);
+      std::nth_element(x.begin(), x.begin() + k, x.end());
+      q(i) = x[k];
     }
-    accumulator_set<double, stats<tail_quantile<right> > > acc(
-        tail<right>::cache_size = cache_size);
-    for (int i = 0; i < M; i++)
-      acc(x(i));
-    return quantile(acc, quantile_probability = prob);
+    return q;
+  }
+
+  static double quantile(const Eigen::VectorXd& x, const double prob) {
+    return quantiles(x, Eigen::VectorXd::Constant(1, prob))(0);
   }
 
   static Eigen::VectorXd quantiles(const Eigen::VectorXd& x,
                                    const Eigen::VectorXd& probs) {
-    using boost::accumulators::accumulator_set;
-    using boost::accumulators::left;
-    using boost::accumulators::quantile;
-    using boost::accumulators::quantile_probability;
-    using boost::accumulators::right;
-    using boost::accumulators::stats;
-    using boost::accumulators::tag::tail;
-    using boost::accumulators::tag::tail_quantile;
-    double M = x.rows();
-
-    // size_t cache_size = M/2 + 2;
-    size_t cache_size = M;  // 2 + 2;
-
-    accumulator_set<double, stats<tail_quantile<left> > > acc_left(
-        tail<left>::cache_size = cache_size);
-    accumulator_set<double, stats<tail_quantile<right> > > acc_right(
-        tail<right>::cache_size = cache_size);
-
-    for (int i = 0; i < M; i++) {
-      acc_left(x(i));
-      acc_right(x(i));
-    }
-
-    Eigen::VectorXd q(probs.size());
-    for (int i = 0; i < probs.size(); i++) {
-      if (probs(i) < 0.5)
-        q(i) = quantile(acc_left, quantile_probability = probs(i));
-      else
-        q(i) = quantile(acc_right, quantile_probability = probs(i));
-    }
-    return q;
+    std::vector<double> scratch(x.data(), x.data() + x.size());
+    return quantiles_in_place(scratch, probs);
   }
 
   static Eigen::VectorXd autocorrelation(const Eigen::VectorXd& x) {
@@ -249,7 +464,10 @@ class chains {
 
  public:
   explicit chains(const std::vector<std::string>& param_names)
-      : param_names_(param_names) {}
+      : param_names_(param_names),
+        column_types_(param_names.size(), io::column_type::float64),
+        slot_(all_indices()),
+        num_float64_(param_names.size()) {}
 
   explicit chains(const stan::io::stan_csv& stan_csv)
       : chains(stan_csv.header) {
@@ -259,6 +477,53 @@ class chains {
 
   inline int num_chains() const { return samples_.size(); }
 
+  /**
+   * Return the bytes taken by the stored draws, including the rows
+   * reserved for draws still to be added. The mapped chains take none.
+   */
+  size_t memory_bytes() const {
+    size_t bytes = 0;
+    for (int chain = 0; chain < num_chains(); ++chain) {
+      bytes += samples_(chain).size() * sizeof(double);
+      for (const std::vector<unsigned char>& column : narrow_[chain])
+        bytes += column.size();
+    }
+    return bytes;
+  }
+
+  /**
+   * Store the draws of each parameter as the specified type, e.g. from
+   * <code>io::draws_column_types()</code>. The draws of a column stored
+   * as <code>float32</code> take half the memory, and those of an
+   * <code>int32</code> or <code>uint8</code> column are rounded to
+   * integers. Draws are widened to <code>double</code> when they are
+   * read. Chains added with <code>add_mapped()</code> are read as
+   * doubles whatever the types.
+   *
+   * @param types a type per parameter
+   * @throw std::invalid_argument if there isn't a type per parameter
+   *   or draws have already been added
+   */
+  void set_column_types(const std::vector<io::column_type>& types) {
+    if (types.size() != static_cast<size_t>(num_params()))
+      throw std::invalid_argument(
+          "set_column_types(types): number of types does not match chains");
+    if (num_chains() > 0)
+      throw std::invalid_argument(
+          "set_column_types(types): chains already hold draws");
+    column_types_ = types;
+    int num_narrow = 0;
+    num_float64_ = 0;
+    for (int index = 0; index < num_params(); ++index)
+      slot_[index] = types[index] == io::column_type::float64
+                         ? num_float64_++
+                         : num_narrow++;
+  }
+
+  const std::vector<io::column_type>& column_types() const {
+    return column_types_;
+  }
+
   inline int num_params() const { return param_names_.size(); }
 
   const std::vector<std::string>& param_names() const { return param_names_; }
@@ -283,7 +548,7 @@ class chains {
 
   int warmup(const int chain) const { return warmup_(chain); }
 
-  int num_samples(const int chain) const { return samples_(chain).rows(); }
+  int num_samples(const int chain) const { return num_samples_(chain); }
 
   int num_samples() const {
     int n = 0;
@@ -303,38 +568,49 @@ class chains {
     return n;
   }
 
+  /**
+   * Allocate storage for the specified number of draws in a chain,
+   * adding the chain if needed, so that adding draws up to that number
+   * doesn't reallocate it.
+   *
+   * @param chain chain
+   * @param num_samples number of draws, including warmup
+   */
+  void reserve(const int chain, const int num_samples) {
+    if (chain >= num_chains())
+      resize_chains(chain + 1);
+    reserve_rows(chain, num_samples);
+  }
+
   void add(const int chain, const Eigen::MatrixXd& sample) {
     if (sample.cols() != num_params())
       throw std::invalid_argument(
           "add(chain, sample): number of columns"
           " in sample does not match chains");
-    if (num_chains() == 0 || chain >= num_chains()) {
-      int n = num_chains();
-
-      // Need this block for Windows. conservativeResize
-      // does not keep the references.
-      Eigen::Matrix<Eigen::MatrixXd, Dynamic, 1> samples_copy(num_chains());
-      Eigen::VectorXi warmup_copy(num_chains());
-      for (int i = 0; i < n; i++) {
-        samples_copy(i) = samples_(i);
-        warmup_copy(i) = warmup_(i);
-      }
-
-      samples_.resize(chain + 1);
-      warmup_.resize(chain + 1);
-      for (int i = 0; i < n; i++) {
-        samples_(i) = samples_copy(i);
-        warmup_(i) = warmup_copy(i);
-      }
-      for (int i = n; i < chain + 1; i++) {
-        samples_(i) = Eigen::MatrixXd(0, num_params());
-        warmup_(i) = 0;
+    if (chain >= num_chains())
+      resize_chains(chain + 1);
+    int row = num_samples_(chain);
+    int rows = row + sample.rows();
+    if (rows > samples_(chain).rows())
+      reserve_rows(chain, std::max<int>(rows, 2 * samples_(chain).rows()));
+    if (num_float64_ == num_params()) {
+      samples_(chain).middleRows(row, sample.rows()) = sample;
+      num_samples_(chain) = rows;
+      return;
+    }
+    for (int index = 0; index < num_params(); ++index) {
+      io::column_type type = column_types_[index];
+      if (type == io::column_type::float64) {
+        samples_(chain).col(slot_[index]).segment(row, sample.rows())
+            = sample.col(index);
+        continue;
       }
+      size_t width = io::column_width(type);
+      unsigned char* bytes = narrow_[chain][slot_[index]].data() + width * row;
+      for (int i = 0; i < sample.rows(); ++i, bytes += width)
+        io::store_column_value(type, sample(i, index), bytes);
     }
-    int row = samples_(chain).rows();
-    Eigen::MatrixXd new_samples(row + sample.rows(), num_params());
-    new_samples << samples_(chain), sample;
-    samples_(chain) = new_samples;
+    num_samples_(chain) = rows;
   }
 
   void add(const Eigen::MatrixXd& sample) {
@@ -385,8 +661,62 @@ class chains {
       set_warmup(num_chains() - 1, stan_csv.metadata.num_warmup);
   }
 
+  /**
+   * Add a chain whose draws are read in place from a columnar draws
+   * file, which is memory mapped rather than copied, see
+   * <code>write_columnar()</code>. The warmup draws of the chain are
+   * those recorded in the file.
+   *
+   * @param path path of the file
+   * @throw std::invalid_argument if the file can't be mapped or its
+   *   draws don't have one column per parameter
+   */
+  void add_mapped(const std::string& path) {
+    auto file = std::make_shared<const io::binary_var_context>(path);
+    std::vector<size_t> dims = file->dims_r("draws");
+    if (file->contains_i("draws") || dims.size() != 2
+        || dims[1] != static_cast<size_t>(num_params()))
+      throw std::invalid_argument(
+          "add_mapped(path): draws in " + path
+          + " don't have one column per parameter");
+    std::vector<int> warmup = file->vals_i("warmup");
+    int chain = num_chains();
+    resize_chains(chain + 1);
+    mapped_[chain] = file;
+    mapped_draws_[chain] = file->vals_r_view("draws").data();
+    num_samples_(chain) = dims[0];
+    warmup_(chain) = warmup.empty() ? 0 : warmup[0];
+  }
+
+  /**
+   * Write draws as a columnar draws file for <code>add_mapped()</code>:
+   * a binary data file, see <code>io::binary_var_context</code>, with
+   * the draws as the matrix <code>draws</code>, one row per draw, whose
+   * columns are contiguous, and the number of warmup draws as the
+   * integer <code>warmup</code>.
+   *
+   * @param[in, out] out stream to write to, opened in binary mode
+   * @param draws draws, one column per parameter
+   * @param warmup number of leading warmup draws
+   */
+  static void write_columnar(std::ostream& out, const Eigen::MatrixXd& draws,
+                             const int warmup = 0) {
+    std::vector<std::vector<size_t>> dims_r{
+        {static_cast<size_t>(draws.rows()), static_cast<size_t>(draws.cols())}};
+    std::vector<std::vector<size_t>> dims_i{{1}};
+    io::array_var_context context(
+        std::vector<std::string>{"draws"},
+        Eigen::Map<const Eigen::VectorXd>(draws.data(), draws.size()), dims_r,
+        std::vector<std::string>{"warmup"}, std::vector<int>{warmup}, dims_i);
+    io::binary_var_context::write(out, context);
+  }
+
   Eigen::VectorXd samples(const int chain, const int index) const {
-    return samples_(chain).col(index).bottomRows(num_kept_samples(chain));
+    Eigen::VectorXd s(num_kept_samples(chain));
+    const double* x = kept_samples(chain, index, s.data());
+    if (x != s.data())
+      s = Eigen::Map<const Eigen::VectorXd>(x, s.size());
+    return s;
   }
 
   Eigen::VectorXd samples(const int index) const {
@@ -394,7 +724,9 @@ class chains {
     int start = 0;
     for (int chain = 0; chain < num_chains(); chain++) {
       int n = num_kept_samples(chain);
-      s.middleRows(start, n) = samples_(chain).col(index).bottomRows(n);
+      const double* x = kept_samples(chain, index, s.data() + start);
+      if (x != s.data() + start)
+        s.segment(start, n) = Eigen::Map<const Eigen::VectorXd>(x, n);
       start += n;
     }
     return s;
@@ -562,16 +894,10 @@ class chains {
 
   // FIXME: reimplement using autocorrelation.
   double effective_sample_size(const int index) const {
-    int n_chains = num_chains();
-    std::vector<const double*> draws(n_chains);
-    std::vector<size_t> sizes(n_chains);
-    int n_kept_samples = 0;
-    for (int chain = 0; chain < n_chains; ++chain) {
-      n_kept_samples = num_kept_samples(chain);
-      draws[chain]
-          = samples_(chain).col(index).bottomRows(n_kept_samples).data();
-      sizes[chain] = n_kept_samples;
-    }
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    std::vector<double> buffer;
+    kept_draws(index, draws, sizes, buffer);
     return analyze::compute_effective_sample_size(draws, sizes);
   }
 
@@ -580,16 +906,10 @@ class chains {
   }
 
   double split_effective_sample_size(const int index) const {
-    int n_chains = num_chains();
-    std::vector<const double*> draws(n_chains);
-    std::vector<size_t> sizes(n_chains);
-    int n_kept_samples = 0;
-    for (int chain = 0; chain < n_chains; ++chain) {
-      n_kept_samples = num_kept_samples(chain);
-      draws[chain]
-          = samples_(chain).col(index).bottomRows(n_kept_samples).data();
-      sizes[chain] = n_kept_samples;
-    }
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    std::vector<double> buffer;
+    kept_draws(index, draws, sizes, buffer);
     return analyze::compute_split_effective_sample_size(draws, sizes);
   }
 
@@ -597,24 +917,185 @@ class chains {
     return split_effective_sample_size(index(name));
   }
 
-  double split_potential_scale_reduction(const int index) const {
-    int n_chains = num_chains();
-    std::vector<const double*> draws(n_chains);
-    std::vector<size_t> sizes(n_chains);
-    int n_kept_samples = 0;
-    for (int chain = 0; chain < n_chains; ++chain) {
-      n_kept_samples = num_kept_samples(chain);
-      draws[chain]
-          = samples_(chain).col(index).bottomRows(n_kept_samples).data();
-      sizes[chain] = n_kept_samples;
-    }
+  double potential_scale_reduction(const int index) const {
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    std::vector<double> buffer;
+    kept_draws(index, draws, sizes, buffer);
+    return analyze::compute_potential_scale_reduction(draws, sizes);
+  }
+
+  double potential_scale_reduction(const std::string& name) const {
+    return potential_scale_reduction(index(name));
+  }
 
+  double split_potential_scale_reduction(const int index) const {
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    std::vector<double> buffer;
+    kept_draws(index, draws, sizes, buffer);
     return analyze::compute_split_potential_scale_reduction(draws, sizes);
   }
 
   double split_potential_scale_reduction(const std::string& name) const {
     return split_potential_scale_reduction(index(name));
   }
+
+  /**
+   * Return the effective sample size of each of the specified
+   * parameters, computed in parallel on the TBB thread pool from the
+   * stored draws in place.
+   *
+   * @param indices parameter indices
+   * @return effective sample size of each parameter
+   * @throws std::out_of_range if an index is out of range
+   */
+  Eigen::VectorXd effective_sample_size(const std::vector<int>& indices) const {
+    return for_each_parameter(
+        indices, [](const std::vector<const double*>& draws,
+                    const std::vector<size_t>& sizes,
+                    analyze::autocovariance_engine<double>& engine) {
+          return analyze::compute_effective_sample_size(draws, sizes, engine);
+        });
+  }
+
+  /**
+   * Return the effective sample size of every parameter, as for
+   * <code>effective_sample_size(indices)</code>.
+   */
+  Eigen::VectorXd effective_sample_size() const {
+    return effective_sample_size(all_indices());
+  }
+
+  /**
+   * Return the split effective sample size of each of the specified
+   * parameters, computed in parallel on the TBB thread pool from the
+   * stored draws in place.
+   *
+   * @param indices parameter indices
+   * @return split effective sample size of each parameter
+   * @throws std::out_of_range if an index is out of range
+   */
+  Eigen::VectorXd split_effective_sample_size(
+      const std::vector<int>& indices) const {
+    return for_each_parameter(
+        indices, [](const std::vector<const double*>& draws,
+                    const std::vector<size_t>& sizes,
+                    analyze::autocovariance_engine<double>& engine) {
+          return analyze::compute_split_effective_sample_size(draws, sizes,
+                                                              engine);
+        });
+  }
+
+  /**
+   * Return the split effective sample size of every parameter, as for
+   * <code>split_effective_sample_size(indices)</code>.
+   */
+  Eigen::VectorXd split_effective_sample_size() const {
+    return split_effective_sample_size(all_indices());
+  }
+
+  /**
+   * Return the potential scale reduction of each of the specified
+   * parameters, without splitting the chains, computed in parallel on
+   * the TBB thread pool from the stored draws in place.
+   *
+   * @param indices parameter indices
+   * @return potential scale reduction of each parameter
+   * @throws std::out_of_range if an index is out of range
+   */
+  Eigen::VectorXd potential_scale_reduction(
+      const std::vector<int>& indices) const {
+    return for_each_parameter(
+        indices, [](const std::vector<const double*>& draws,
+                    const std::vector<size_t>& sizes,
+                    analyze::autocovariance_engine<double>& engine) {
+          return analyze::compute_potential_scale_reduction(draws, sizes);
+        });
+  }
+
+  /**
+   * Return the potential scale reduction of every parameter, as for
+   * <code>potential_scale_reduction(indices)</code>.
+   */
+  Eigen::VectorXd potential_scale_reduction() const {
+    return potential_scale_reduction(all_indices());
+  }
+
+  /**
+   * Return the split potential scale reduction of each of the
+   * specified parameters, computed in parallel on the TBB thread pool
+   * from the stored draws in place.
+   *
+   * @param indices parameter indices
+   * @return split potential scale reduction of each parameter
+   * @throws std::out_of_range if an index is out of range
+   */
+  Eigen::VectorXd split_potential_scale_reduction(
+      const std::vector<int>& indices) const {
+    return for_each_parameter(
+        indices, [](const std::vector<const double*>& draws,
+                    const std::vector<size_t>& sizes,
+                    analyze::autocovariance_engine<double>& engine) {
+          return analyze::compute_split_potential_scale_reduction(draws,
+                                                                  sizes);
+        });
+  }
+
+  /**
+   * Return the split potential scale reduction of every parameter, as
+   * for <code>split_potential_scale_reduction(indices)</code>.
+   */
+  Eigen::VectorXd split_potential_scale_reduction() const {
+    return split_potential_scale_reduction(all_indices());
+  }
+
+  /**
+   * Return the summary statistics of the kept draws of a parameter
+   * across all chains. The draws are copied once, into a buffer the
+   * moments and quantiles are computed from; the effective sample size
+   * and potential scale reduction read them in place.
+   *
+   * @param index parameter index
+   * @param probs probabilities of the quantiles
+   * @return summary of the parameter
+   */
+  parameter_summary summary(const int index,
+                            const Eigen::VectorXd& probs) const {
+    analyze::autocovariance_engine<double> engine;
+    std::vector<double> scratch;
+    return summary(index, probs, engine, scratch);
+  }
+
+  parameter_summary summary(const std::string& name,
+                            const Eigen::VectorXd& probs) const {
+    return summary(index(name), probs);
+  }
+
+  /**
+   * Return the summary statistics of every parameter, as for
+   * <code>summary(index, probs)</code>, computed in parallel on the
+   * TBB thread pool. Each worker thread reuses one buffer and one
+   * autocovariance engine across parameters.
+   *
+   * @param probs probabilities of the quantiles
+   * @return summary of each parameter
+   */
+  std::vector<parameter_summary> summary(const Eigen::VectorXd& probs) const {
+    std::vector<parameter_summary> summaries(num_params());
+    tbb::enumerable_thread_specific<analyze::autocovariance_engine<double>>
+        engines;
+    tbb::enumerable_thread_specific<std::vector<double>> scratches;
+    tbb::parallel_for(tbb::blocked_range<int>(0, num_params()),
+                      [&](const tbb::blocked_range<int>& r) {
+                        analyze::autocovariance_engine<double>& engine
+                            = engines.local();
+                        std::vector<double>& scratch = scratches.local();
+                        for (int i = r.begin(); i != r.end(); ++i)
+                          summaries[i] = summary(i, probs, engine, scratch);
+                      });
+    return summaries;
+  }
 };
 
 }  // namespace mcmc
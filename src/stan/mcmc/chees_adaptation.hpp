@@ -0,0 +1,162 @@
+#ifndef STAN_MCMC_CHEES_ADAPTATION_HPP
+#define STAN_MCMC_CHEES_ADAPTATION_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/mcmc/base_adaptation.hpp>
+#include <cmath>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Adapts the integration time of static HMC across many chains by
+ * ascending the change in the estimated squared distance (ChEES)
+ * criterion of Hoffman, Radul and Sountsov (2021), "An adaptive MCMC
+ * scheme for setting trajectory lengths in Hamiltonian Monte Carlo",
+ * AISTATS.
+ *
+ * Every iteration all chains integrate for the same time, the maximum
+ * time T scaled by the next point of the base 2 Halton sequence. After
+ * the transitions, the gradient of ChEES with respect to log T is
+ * estimated from the starting points, the end points and the end
+ * velocities of the trajectories of all chains, each weighted by its
+ * acceptance probability, and log T takes an Adam step with no
+ * momentum. The integration time used after adaptation is the weighted
+ * average of the iterates, with the weights of the step size dual
+ * averaging.
+ */
+class chees_adaptation : public base_adaptation {
+ public:
+  chees_adaptation()
+      : learning_rate_(0.025), beta2_(0.95), kappa_(0.75), log_T_(0) {
+    restart();
+  }
+
+  void set_learning_rate(double r) {
+    if (r > 0)
+      learning_rate_ = r;
+  }
+
+  void set_beta2(double b) {
+    if (b >= 0 && b < 1)
+      beta2_ = b;
+  }
+
+  void set_kappa(double k) {
+    if (k > 0)
+      kappa_ = k;
+  }
+
+  double get_learning_rate() const noexcept { return learning_rate_; }
+
+  double get_beta2() const noexcept { return beta2_; }
+
+  double get_kappa() const noexcept { return kappa_; }
+
+  /**
+   * Set the current maximum integration time.
+   */
+  void set_T(double T) {
+    if (T > 0)
+      log_T_ = std::log(T);
+  }
+
+  double get_T() const { return std::exp(log_T_); }
+
+  void restart() {
+    counter_ = 0;
+    halton_index_ = 0;
+    second_moment_ = 0;
+    log_T_bar_ = 0;
+  }
+
+  /**
+   * Return the next jitter of the integration time, the next point of
+   * the base 2 Halton sequence 1/2, 1/4, 3/4, 1/8, ..., which lies in
+   * (0, 1).
+   */
+  double next_jitter() {
+    ++halton_index_;
+    double jitter = 0;
+    double scale = 0.5;
+    for (unsigned long n = halton_index_; n > 0; n >>= 1, scale *= 0.5)
+      if (n & 1)
+        jitter += scale;
+    return jitter;
+  }
+
+  /**
+   * Update the integration time with the trajectories of one iteration,
+   * one column per chain.
+   *
+   * @param q positions at the start of the trajectories
+   * @param q_end positions at the end of the trajectories
+   * @param v_end velocities, the derivative of the kinetic energy with
+   *   respect to the momentum, at the end of the trajectories
+   * @param accept_prob acceptance probabilities of the end points
+   * @param t integration time of the trajectories
+   */
+  void learn_T(const Eigen::MatrixXd& q, const Eigen::MatrixXd& q_end,
+               const Eigen::MatrixXd& v_end,
+               const Eigen::VectorXd& accept_prob, double t) {
+    ++counter_;
+
+    Eigen::VectorXd mean = q.rowwise().mean();
+    Eigen::VectorXd mean_end = q_end.rowwise().mean();
+    double sum_weights = 0;
+    double sum_gradients = 0;
+    for (Eigen::Index k = 0; k < q.cols(); ++k) {
+      double diff = (q_end.col(k) - mean_end).squaredNorm()
+                    - (q.col(k) - mean).squaredNorm();
+      double gradient
+          = t * diff * (q_end.col(k) - mean_end).dot(v_end.col(k));
+      double weight = accept_prob(k);
+      if (!std::isfinite(gradient) || !(weight > 0))
+        continue;
+      sum_weights += weight;
+      sum_gradients += weight * gradient;
+    }
+    double gradient = sum_weights > 0 ? sum_gradients / sum_weights : 0;
+
+    // Adam without momentum, ascending the criterion
+    second_moment_
+        = beta2_ * second_moment_ + (1 - beta2_) * gradient * gradient;
+    double scale
+        = std::sqrt(second_moment_ / (1 - std::pow(beta2_, counter_)));
+    if (scale > 0)
+      log_T_ += learning_rate_ * gradient / (scale + 1e-8);
+
+    const double x_eta = std::pow(counter_, -kappa_);
+    log_T_bar_ = (1.0 - x_eta) * log_T_bar_ + x_eta * log_T_;
+  }
+
+  /**
+   * Set the integration time to the averaged iterate, if there was any
+   * update.
+   *
+   * @param[out] T integration time
+   */
+  void complete_adaptation(double& T) {
+    if (counter_ > 0)
+      log_T_ = log_T_bar_;
+    T = std::exp(log_T_);
+  }
+
+ protected:
+  double learning_rate_;
+  double beta2_;
+  double kappa_;
+  double log_T_;
+
+  double counter_;
+  unsigned long halton_index_;
+  double second_moment_;
+  double log_T_bar_;
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
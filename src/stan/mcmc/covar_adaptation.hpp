@@ -2,7 +2,14 @@
 #define STAN_MCMC_COVAR_ADAPTATION_HPP
 
 #include <stan/math/prim.hpp>
+#include <stan/mcmc/batched_welford_covar_estimator.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/pooled_moments.hpp>
+#include <stan/mcmc/welford_var_estimator.hpp>
 #include <stan/mcmc/windowed_adaptation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 #include <vector>
 
 namespace stan {
@@ -12,24 +19,101 @@ namespace mcmc {
 class covar_adaptation : public windowed_adaptation {
  public:
   explicit covar_adaptation(int n)
-      : windowed_adaptation("covariance"), estimator_(n) {}
+      : windowed_adaptation("covariance"),
+        n_(n),
+        estimator_(n),
+        ledoit_wolf_(false),
+        gradient_diagonal_(false),
+        grad_estimator_(n) {}
 
-  bool learn_covariance(Eigen::MatrixXd& covar, const Eigen::VectorXd& q) {
-    if (adaptation_window())
+  /**
+   * Set whether window estimates are shrunk toward a multiple of the
+   * identity by the Ledoit-Wolf optimal amount instead of the fixed
+   * regularization, which for short windows shrinks a noisy estimate
+   * too little. The draws of each window are kept until it closes,
+   * which takes O(n w) memory for n parameters and a window of w
+   * draws.
+   *
+   * @param ledoit_wolf true for Ledoit-Wolf shrinkage
+   */
+  void set_ledoit_wolf(bool ledoit_wolf) {
+    ledoit_wolf_ = ledoit_wolf;
+    draws_.clear();
+  }
+
+  bool ledoit_wolf() const { return ledoit_wolf_; }
+
+  /**
+   * Set whether the variances of window estimates are replaced by the
+   * geometric mean of the draw variance and the inverse gradient
+   * variance, <code>sqrt(var(q) / var(grad))</code>, keeping the
+   * correlations of the estimate. The gradient variance is exact for
+   * a Gaussian with independent components and stabilizes the scales
+   * of short windows. The gradients must be passed to
+   * <code>learn_covariance()</code>.
+   *
+   * @param gradient_diagonal true to take the variances from the
+   *   gradients
+   */
+  void set_gradient_diagonal(bool gradient_diagonal) {
+    gradient_diagonal_ = gradient_diagonal;
+    grad_estimator_.restart();
+  }
+
+  bool gradient_diagonal() const { return gradient_diagonal_; }
+
+  /**
+   * Add a draw to the current window and, if the window closes, update
+   * the covariance.
+   *
+   * @param[in, out] covar inverse metric
+   * @param[in] q current draw
+   * @param[in] grad gradient of the log density at the current draw,
+   *   only used when the variances are taken from the gradients
+   * @return true if the covariance was updated
+   */
+  bool learn_covariance(Eigen::MatrixXd& covar, const Eigen::VectorXd& q,
+                        const Eigen::VectorXd& grad = Eigen::VectorXd()) {
+    STAN_INSTRUMENT_REGION("learn_covariance");
+    if (adaptation_window()) {
       estimator_.add_sample(q);
+      if (ledoit_wolf_)
+        draws_.push_back(q);
+      if (gradient_diagonal_ && grad.size() == q.size())
+        grad_estimator_.add_sample(grad);
+    }
 
     if (end_adaptation_window()) {
       compute_next_window();
 
+      if (cross_chain_) {
+        window_pending_ = true;
+        ++adapt_window_counter_;
+        return false;
+      }
+
+      start_estimate();
+      Eigen::MatrixXd previous;
+      if (convergence_tolerance_ > 0)
+        previous = covar;
+
       estimator_.sample_covariance(covar);
 
       double n = static_cast<double>(estimator_.num_samples());
-      covar = (n / (n + 5.0)) * covar
-              + 1e-3 * (5.0 / (n + 5.0))
-                    * Eigen::MatrixXd::Identity(covar.rows(), covar.cols());
+      Eigen::VectorXd scale = Eigen::VectorXd::Ones(n_);
+      if (gradient_diagonal_)
+        rescale_to_gradients(covar, scale);
+      if (!ledoit_wolf_ || !shrink_ledoit_wolf(covar, n, scale))
+        regularize(covar, n);
 
       estimator_.restart();
+      draws_.clear();
+      grad_estimator_.restart();
 
+      close_window(convergence_tolerance_ > 0
+                       ? (covar - previous).norm() / previous.norm()
+                       : 0);
+      end_estimate();
       ++adapt_window_counter_;
       return true;
     }
@@ -38,8 +122,170 @@ class covar_adaptation : public windowed_adaptation {
     return false;
   }
 
+  /**
+   * Combine the pending window estimates of several chains into a
+   * single covariance estimate and restart the estimator of each chain.
+   * The per-chain means and covariances are merged with the pairwise
+   * Welford update, so the result is the sample covariance of all of
+   * the chains' window draws taken together. The chains are merged by a
+   * pairwise tree in their order, so the estimate doesn't depend on the
+   * number of threads. The pooled estimate always gets the fixed
+   * regularization, which suits its larger number of draws.
+   *
+   * @param[in,out] adaptations covariance adaptations of every chain
+   * @param[out] covar regularized pooled covariance
+   * @return true if a window was pending and <code>covar</code> was
+   *   updated
+   */
+  static bool pool_covariance(
+      const std::vector<covar_adaptation*>& adaptations,
+      Eigen::MatrixXd& covar) {
+    std::vector<covar_adaptation*> pending;
+    for (covar_adaptation* adaptation : adaptations)
+      if (adaptation->window_pending_)
+        pending.push_back(adaptation);
+    if (pending.empty())
+      return false;
+
+    typedef pooled_moments<Eigen::MatrixXd> moments_t;
+    moments_t pooled = moments_t::pool(pending.size(), [&pending](size_t i) {
+      moments_t chain;
+      chain.n = static_cast<double>(pending[i]->estimator_.num_samples());
+      pending[i]->estimator_.sample_mean(chain.mean);
+      chain.m2 = Eigen::MatrixXd::Zero(chain.mean.size(), chain.mean.size());
+      if (chain.n > 1) {
+        pending[i]->estimator_.sample_covariance(chain.m2);
+        chain.m2 *= chain.n - 1.0;
+      }
+      return chain;
+    });
+
+    if (pooled.n > 1)
+      covar = pooled.m2 / (pooled.n - 1.0);
+    regularize(covar, pooled.n);
+
+    for (covar_adaptation* adaptation : adaptations) {
+      adaptation->estimator_.restart();
+      adaptation->draws_.clear();
+      adaptation->grad_estimator_.restart();
+      adaptation->window_pending_ = false;
+    }
+    return true;
+  }
+
+  /**
+   * Write the window position and the running sums of the current
+   * window, followed by its draws when they are kept for Ledoit-Wolf
+   * shrinkage and by the running sums of its gradients when they are
+   * used. Both options are part of the configuration and must be set
+   * before the state is read.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    estimator_.write_state(writer);
+    if (ledoit_wolf_) {
+      writer.write(static_cast<int>(draws_.size()));
+      for (const Eigen::VectorXd& draw : draws_)
+        writer.write(draw);
+    }
+    if (gradient_diagonal_)
+      grad_estimator_.write_state(writer);
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    estimator_.read_state(reader);
+    if (ledoit_wolf_) {
+      int num_draws;
+      reader.read(num_draws);
+      if (num_draws < 0)
+        throw std::invalid_argument(
+            "Sampler state: negative number of draws");
+      draws_.resize(num_draws);
+      for (Eigen::VectorXd& draw : draws_) {
+        reader.read(draw);
+        if (draw.size() != n_)
+          throw std::invalid_argument("Sampler state: dimension mismatch");
+      }
+    }
+    if (gradient_diagonal_)
+      grad_estimator_.read_state(reader);
+  }
+
  protected:
-  stan::math::welford_covar_estimator estimator_;
+  int n_;
+  batched_welford_covar_estimator estimator_;
+  bool ledoit_wolf_;
+  bool gradient_diagonal_;
+  std::vector<Eigen::VectorXd> draws_;
+  welford_var_estimator grad_estimator_;
+
+  /**
+   * Replace a sample covariance by its Ledoit-Wolf shrinkage toward
+   * the multiple of the identity with the same trace (Ledoit and Wolf
+   * 2004), computed from the draws of the window.
+   *
+   * @param[in, out] covar sample covariance of the window draws,
+   *   rescaled by <code>scale</code>
+   * @param n number of draws
+   * @param scale scales applied to the window draws
+   * @return false, leaving the covariance unchanged, if there are too
+   *   few draws or they are all equal
+   */
+  bool shrink_ledoit_wolf(Eigen::MatrixXd& covar, double n,
+                          const Eigen::VectorXd& scale) {
+    if (n < 2 || draws_.size() != static_cast<size_t>(n))
+      return false;
+    Eigen::MatrixXd s = ((n - 1) / n) * covar;
+    double mu = s.trace() / s.rows();
+    if (!(mu > 0))
+      return false;
+    Eigen::VectorXd mean;
+    estimator_.sample_mean(mean);
+    double sum_fourth = 0;
+    for (const Eigen::VectorXd& draw : draws_) {
+      double r2 = (draw - mean).cwiseProduct(scale).squaredNorm();
+      sum_fourth += r2 * r2;
+    }
+
+    double d2 = (s - mu * Eigen::MatrixXd::Identity(s.rows(), s.cols()))
+                    .squaredNorm();
+    double b2 = std::min(d2, (sum_fourth / n - s.squaredNorm()) / n);
+    double shrinkage = d2 > 0 ? std::max(b2, 0.0) / d2 : 0;
+    covar = (1 - shrinkage) * s;
+    covar.diagonal().array() += shrinkage * mu;
+    return true;
+  }
+
+  /**
+   * Rescale a sample covariance so that its variances are the
+   * geometric means of its own and of the inverse gradient variances,
+   * keeping its correlations. Parameters whose gradient has no
+   * variance keep their variance.
+   *
+   * @param[in, out] covar sample covariance
+   * @param[out] scale scales applied to the draws
+   */
+  void rescale_to_gradients(Eigen::MatrixXd& covar, Eigen::VectorXd& scale) {
+    if (grad_estimator_.num_samples() < 2)
+      return;
+    Eigen::VectorXd grad_var;
+    grad_estimator_.sample_variance(grad_var);
+    for (int i = 0; i < covar.rows(); ++i) {
+      if (grad_var(i) > 0 && std::isfinite(grad_var(i)) && covar(i, i) > 0)
+        scale(i) = std::sqrt(std::sqrt(covar(i, i) / grad_var(i))
+                             / covar(i, i));
+    }
+    covar = scale.asDiagonal() * covar * scale.asDiagonal();
+  }
+
+  static void regularize(Eigen::MatrixXd& covar, double n) {
+    covar = (n / (n + 5.0)) * covar
+            + 1e-3 * (5.0 / (n + 5.0))
+                  * Eigen::MatrixXd::Identity(covar.rows(), covar.cols());
+  }
 };
 
 }  // namespace mcmc
@@ -0,0 +1,80 @@
+#ifndef STAN_MCMC_COVAR_CL_ADAPTATION_HPP
+#define STAN_MCMC_COVAR_CL_ADAPTATION_HPP
+#ifdef STAN_OPENCL
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/batched_welford_covar_estimator_cl.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/windowed_adaptation.hpp>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Windowed adaptation of a dense covariance whose running sums are kept
+ * on the OpenCL device by a
+ * <code>batched_welford_covar_estimator_cl</code>. Window estimates get
+ * the fixed regularization of <code>covar_adaptation</code>; the
+ * estimate is copied to the host once per window.
+ */
+class covar_cl_adaptation : public windowed_adaptation {
+ public:
+  explicit covar_cl_adaptation(int n)
+      : windowed_adaptation("covariance"), estimator_(n) {}
+
+  /**
+   * Add a draw to the current window and, if the window closes, update
+   * the covariance.
+   *
+   * @param[in, out] covar inverse metric
+   * @param[in] q current draw
+   * @return true if the covariance was updated
+   */
+  bool learn_covariance(Eigen::MatrixXd& covar, const Eigen::VectorXd& q) {
+    STAN_INSTRUMENT_REGION("learn_covariance");
+    if (adaptation_window())
+      estimator_.add_sample(q);
+
+    if (end_adaptation_window()) {
+      compute_next_window();
+
+      start_estimate();
+      estimator_.sample_covariance(covar);
+
+      double n = static_cast<double>(estimator_.num_samples());
+      covar = (n / (n + 5.0)) * covar
+              + 1e-3 * (5.0 / (n + 5.0))
+                    * Eigen::MatrixXd::Identity(covar.rows(), covar.cols());
+
+      estimator_.restart();
+      end_estimate();
+
+      ++adapt_window_counter_;
+      return true;
+    }
+
+    ++adapt_window_counter_;
+    return false;
+  }
+
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    estimator_.write_state(writer);
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    estimator_.read_state(reader);
+  }
+
+ protected:
+  batched_welford_covar_estimator_cl estimator_;
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
+#endif
@@ -0,0 +1,88 @@
+#ifndef STAN_MCMC_DAMPING_ADAPTATION_HPP
+#define STAN_MCMC_DAMPING_ADAPTATION_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/base_adaptation.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/mcmc/welford_var_estimator.hpp>
+#include <cmath>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Adapts the damping of generalized HMC to the scale of the posterior,
+ * following the heuristic of Hoffman and Sountsov (2022), "Tuning-free
+ * generalized Hamiltonian Monte Carlo", AISTATS: the momentum should be
+ * forgotten over the time it takes to cross the widest direction of the
+ * posterior, so the damping is the inverse of its largest standard
+ * deviation in the units of the metric.
+ *
+ * That paper estimates the largest scale from the eigenvalues of the
+ * covariance across many chains. A single chain here estimates the
+ * variance of each parameter from its draws since the metric last
+ * changed, and the largest scale is the largest ratio of a variance to
+ * the matching diagonal element of the inverse metric. For a dense
+ * metric this ignores correlations that the metric doesn't capture.
+ */
+class damping_adaptation : public base_adaptation {
+ public:
+  /**
+   * Construct an adaptation of n parameters.
+   *
+   * @param n number of parameters
+   * @param min_samples number of draws needed before the damping is
+   *   estimated
+   */
+  explicit damping_adaptation(int n, int min_samples = 10)
+      : estimator_(n), min_samples_(min_samples) {}
+
+  /**
+   * Forget the draws, as when the metric changes.
+   */
+  void restart() { estimator_.restart(); }
+
+  /**
+   * Add a draw and, once there are enough draws, set the damping to the
+   * inverse of their largest standard deviation in the units of the
+   * metric.
+   *
+   * @param[in, out] damping damping of the sampler
+   * @param[in] q current draw
+   * @param[in] inv_metric_diagonal diagonal of the inverse metric
+   * @return true if the damping was updated
+   */
+  bool learn_damping(double& damping, const Eigen::VectorXd& q,
+                     const Eigen::VectorXd& inv_metric_diagonal) {
+    estimator_.add_sample(q);
+    if (estimator_.num_samples() < min_samples_)
+      return false;
+    estimator_.sample_variance(var_);
+    double max_scale
+        = (var_.array() / inv_metric_diagonal.array()).maxCoeff();
+    if (!(max_scale > 0) || !std::isfinite(max_scale))
+      return false;
+    damping = 1 / std::sqrt(max_scale);
+    return true;
+  }
+
+  void write_state(state_writer& writer) const {
+    estimator_.write_state(writer);
+  }
+
+  void read_state(state_reader& reader) {
+    estimator_.read_state(reader);
+  }
+
+ protected:
+  welford_var_estimator estimator_;
+  int min_samples_;
+  Eigen::VectorXd var_;
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
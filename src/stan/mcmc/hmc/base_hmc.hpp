@@ -6,8 +6,11 @@
 #include <stan/mcmc/base_mcmc.hpp>
 #include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
 #include <boost/random/uniform_01.hpp>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <limits>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -37,7 +40,21 @@ class base_hmc : public base_mcmc {
         rand_uniform_(rand_int_),
         nom_epsilon_(0.1),
         epsilon_(nom_epsilon_),
-        epsilon_jitter_(0.0) {}
+        epsilon_jitter_(0.0),
+        max_init_stepsize_evals_(100),
+        init_stepsize_bisections_(0),
+        init_stepsize_evals_(0),
+        init_stepsize_seconds_(0),
+        report_cost_(false),
+        reuse_gradient_(!Hamiltonian<Model, BaseRNG>::riemannian),
+        z_current_(false),
+        approximate_transitions_(0),
+        last_grad_evals_(0),
+        last_log_prob_evals_(0),
+        pending_ns_(0),
+        transition_grad_evals_(0),
+        transition_log_prob_evals_(0),
+        transition_ns_(0) {}
 
   /**
    * format and write stepsize
@@ -63,6 +80,21 @@ class base_hmc : public base_mcmc {
     write_sampler_metric(writer);
   }
 
+  void write_state(state_writer& writer) const {
+    writer.tag("hmc");
+    z_.write_state(writer);
+    writer.write(nom_epsilon_);
+    writer.write(epsilon_);
+  }
+
+  void read_state(state_reader& reader) {
+    z_current_ = false;
+    reader.tag("hmc");
+    z_.read_state(reader);
+    reader.read(nom_epsilon_);
+    reader.read(epsilon_);
+  }
+
   void get_sampler_diagnostic_names(std::vector<std::string>& model_names,
                                     std::vector<std::string>& names) {
     z_.get_param_names(model_names, names);
@@ -72,56 +104,65 @@ class base_hmc : public base_mcmc {
     z_.get_params(values);
   }
 
-  void seed(const Eigen::VectorXd& q) { z_.q = q; }
+  void seed(const Eigen::VectorXd& q) {
+    if (z_current_ && !(q.size() == z_.q.size() && q == z_.q))
+      z_current_ = false;
+    z_.q = q;
+  }
 
   void init_hamiltonian(callbacks::logger& logger) {
     this->hamiltonian_.init(this->z_, logger);
   }
 
+  /**
+   * Find a nominal step size for which a single leapfrog step from the
+   * current point, with a fresh momentum, has an acceptance probability
+   * near 0.8. The step size is doubled or halved until the acceptance
+   * probability crosses 0.8, and the bracket is then narrowed by the
+   * configured number of bisections on the log scale.
+   *
+   * The search stops with a warning once it has taken the maximum
+   * number of leapfrog steps, keeping the last step size tried. The
+   * number of leapfrog steps taken is logged at debug level.
+   *
+   * @param logger Logger for messages
+   * @throws std::runtime_error if the step size grows above 1e7 or
+   *   shrinks to zero before the search stops
+   */
   void init_stepsize(callbacks::logger& logger) {
+    // The current point is restored below without its gradient
+    z_current_ = false;
     ps_point z_init(this->z_);
+    init_stepsize_evals_ = 0;
 
     // Skip initialization for extreme step sizes
     if (this->nom_epsilon_ == 0 || this->nom_epsilon_ > 1e7)
       return;
 
-    this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
-
-    // Guaranteed to be finite if randomly initialized
-    double H0 = this->hamiltonian_.H(this->z_);
+    std::chrono::steady_clock::time_point start
+        = std::chrono::steady_clock::now();
 
-    this->integrator_.evolve(this->z_, this->hamiltonian_, this->nom_epsilon_,
-                             logger);
-
-    double h = this->hamiltonian_.H(this->z_);
-    if (std::isnan(h))
-      h = std::numeric_limits<double>::infinity();
+    // The potential, gradient and metric only depend on the position,
+    // so they are computed once and restored for every trial
+    this->hamiltonian_.init(this->z_, logger);
+    typename Hamiltonian<Model, BaseRNG>::PointType z_start(this->z_);
 
-    double delta_H = H0 - h;
+    double delta_H = init_stepsize_delta_H(z_start, logger);
 
     int direction = delta_H > std::log(0.8) ? 1 : -1;
+    bool bracketed = false;
 
     while (1) {
-      this->z_.ps_point::operator=(z_init);
-
-      this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-      this->hamiltonian_.init(this->z_, logger);
-
-      double H0 = this->hamiltonian_.H(this->z_);
-
-      this->integrator_.evolve(this->z_, this->hamiltonian_, this->nom_epsilon_,
-                               logger);
-
-      double h = this->hamiltonian_.H(this->z_);
-      if (std::isnan(h))
-        h = std::numeric_limits<double>::infinity();
+      if (init_stepsize_evals_ >= max_init_stepsize_evals_) {
+        warn_init_stepsize(logger);
+        break;
+      }
 
-      double delta_H = H0 - h;
+      double delta_H = init_stepsize_delta_H(z_start, logger);
 
-      if ((direction == 1) && !(delta_H > std::log(0.8)))
-        break;
-      else if ((direction == -1) && !(delta_H < std::log(0.8)))
+      bracketed = ((direction == 1) && !(delta_H > std::log(0.8)))
+                  || ((direction == -1) && !(delta_H < std::log(0.8)));
+      if (bracketed)
         break;
       else
         this->nom_epsilon_ = direction == 1 ? 2.0 * this->nom_epsilon_
@@ -138,7 +179,195 @@ class base_hmc : public base_mcmc {
             "not continuous?");
     }
 
+    if (bracketed && init_stepsize_bisections_ > 0) {
+      // The last two step sizes tried bracket the crossing
+      double log_lower = std::log(this->nom_epsilon_)
+                         - (direction == 1 ? std::log(2.0) : 0.0);
+      double log_upper = log_lower + std::log(2.0);
+      for (int i = 0; i < init_stepsize_bisections_; ++i) {
+        if (init_stepsize_evals_ >= max_init_stepsize_evals_) {
+          warn_init_stepsize(logger);
+          break;
+        }
+        this->nom_epsilon_ = std::exp(0.5 * (log_lower + log_upper));
+        if (init_stepsize_delta_H(z_start, logger) > std::log(0.8))
+          log_lower = std::log(this->nom_epsilon_);
+        else
+          log_upper = std::log(this->nom_epsilon_);
+      }
+      this->nom_epsilon_ = std::exp(0.5 * (log_lower + log_upper));
+    }
+
+    std::stringstream msg;
+    msg << "Step size initialized to " << this->nom_epsilon_ << " after "
+        << init_stepsize_evals_ << " leapfrog steps";
+    logger.debug(msg);
+
+    this->z_ = z_start;
     this->z_.ps_point::operator=(z_init);
+
+    std::chrono::nanoseconds elapsed
+        = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+    init_stepsize_seconds_ += std::chrono::duration<double>(elapsed).count();
+    if (report_cost_)
+      pending_ns_ += elapsed.count();
+  }
+
+  /**
+   * Set the maximum number of leapfrog steps, each with one gradient
+   * evaluation for explicit integrators, taken by
+   * <code>init_stepsize()</code>. Non-positive values are ignored.
+   *
+   * @param n maximum number of leapfrog steps
+   */
+  void set_max_init_stepsize_evals(int n) {
+    if (n > 0)
+      max_init_stepsize_evals_ = n;
+  }
+
+  int get_max_init_stepsize_evals() const { return max_init_stepsize_evals_; }
+
+  /**
+   * Set the number of bisections used by <code>init_stepsize()</code>
+   * to narrow the bracket around the step size with an acceptance
+   * probability of 0.8. Negative values are ignored.
+   *
+   * @param n number of bisections
+   */
+  void set_init_stepsize_bisections(int n) {
+    if (n >= 0)
+      init_stepsize_bisections_ = n;
+  }
+
+  int get_init_stepsize_bisections() const {
+    return init_stepsize_bisections_;
+  }
+
+  /**
+   * Return the number of leapfrog steps taken by the last call to
+   * <code>init_stepsize()</code>.
+   *
+   * @return number of leapfrog steps
+   */
+  int get_init_stepsize_evals() const { return init_stepsize_evals_; }
+
+  /**
+   * Return the total wall clock time spent in <code>init_stepsize()</code>,
+   * in seconds.
+   *
+   * @return time spent searching for step sizes
+   */
+  double get_init_stepsize_seconds() const { return init_stepsize_seconds_; }
+
+  /**
+   * Return the number of gradient evaluations made by the Hamiltonian
+   * since construction, including failed ones.
+   *
+   * @return number of gradient evaluations
+   */
+  size_t get_num_grad_evals() const { return hamiltonian_.num_grad_evals(); }
+
+  /**
+   * Set whether the cost of each transition is reported as the sampler
+   * parameters <code>n_grad__</code>, <code>n_log_prob__</code> and
+   * <code>transition_ns__</code>, which are not reported by default.
+   *
+   * The counts are the evaluations of the gradient and of the log
+   * density alone made by the Hamiltonian since the previous
+   * transition, including failed ones, so the evaluations of a step
+   * size search between transitions are counted with the next one.
+   * The time is the wall clock time of the transition and of any step
+   * size search before it, in nanoseconds. Evaluations made on another
+   * thread by speculative integration are not counted.
+   *
+   * @param report_cost whether to report the cost of each transition
+   */
+  void set_report_cost(bool report_cost) { report_cost_ = report_cost; }
+
+  bool get_report_cost() const { return report_cost_; }
+
+  /**
+   * Set whether a transition seeded at the point the previous
+   * transition ended at reuses the potential and gradient already held
+   * by that point instead of evaluating them again, which saves one
+   * gradient evaluation per transition. This is on by default for
+   * Euclidean metrics and off for Riemannian metrics.
+   *
+   * The reused values are only those of the phase space point, so this
+   * is only valid for Euclidean metrics. Print statements in the model
+   * are not repeated for the reused point, and the point is evaluated
+   * again after anything else may have changed it, such as a step size
+   * search or a call to the non-const <code>z()</code>.
+   *
+   * @param reuse_gradient whether to reuse the gradient
+   */
+  void set_reuse_gradient(bool reuse_gradient) {
+    reuse_gradient_ = reuse_gradient;
+    z_current_ = false;
+  }
+
+  bool get_reuse_gradient() const { return reuse_gradient_; }
+
+  /**
+   * Evaluate the potential and its gradient with an approximate model
+   * for the specified number of transitions, after which the sampler
+   * switches back to the model and evaluates the current point again.
+   * This is experimental and meant for the initial buffer of warmup,
+   * which only has to move the chain towards the typical set: the
+   * transitions target the density of the approximate model, so their
+   * draws must not be kept. The step size adapted in the meantime is
+   * kept, while the metric windows and sampling use the model.
+   *
+   * @param model approximate model with the same unconstrained
+   *   parameters as the model, such as one built with reduced precision
+   *   math functions; it must outlive the transitions that use it
+   * @param num_transitions number of transitions to use it for
+   */
+  void set_approximate_warmup(const Model& model,
+                              unsigned int num_transitions) {
+    this->hamiltonian_.set_approximate_model(num_transitions > 0 ? &model
+                                                                 : 0);
+    approximate_transitions_ = num_transitions;
+    z_current_ = false;
+  }
+
+  /**
+   * Return the number of transitions left that use the approximate
+   * model.
+   */
+  unsigned int get_approximate_transitions() const {
+    return approximate_transitions_;
+  }
+
+  /**
+   * Set the inverse temperature of the Hamiltonian, so that the sampler
+   * targets the density raised to the power beta, as the tempered
+   * replicas of replica exchange do. The log density of the draws is the
+   * tempered one. The current point is evaluated again at the start of
+   * the next transition.
+   *
+   * @param beta inverse temperature in (0, 1]
+   */
+  void set_inverse_temperature(double beta) {
+    this->hamiltonian_.set_inverse_temperature(beta);
+    z_current_ = false;
+  }
+
+  double get_inverse_temperature() const {
+    return hamiltonian_.inverse_temperature();
+  }
+
+  /**
+   * Set the scale of the normal reference density that the tempered
+   * target is bridged to, see
+   * <code>base_hamiltonian::set_reference_scale()</code>.
+   *
+   * @param scale standard deviation of the reference, or 0 for none
+   */
+  void set_reference_scale(double scale) {
+    this->hamiltonian_.set_reference_scale(scale);
+    z_current_ = false;
   }
 
   /**
@@ -146,7 +375,10 @@ class base_hmc : public base_mcmc {
    *
    * @return The current point in the (unconstrained) parameter space.
    */
-  typename Hamiltonian<Model, BaseRNG>::PointType& z() { return z_; }
+  typename Hamiltonian<Model, BaseRNG>::PointType& z() {
+    z_current_ = false;
+    return z_;
+  }
 
   /**
    * Gets the current point in the (unconstrained) parameters space.
@@ -181,6 +413,8 @@ class base_hmc : public base_mcmc {
   }
 
  protected:
+  typedef Hamiltonian<Model, BaseRNG> hamiltonian_t;
+
   typename Hamiltonian<Model, BaseRNG>::PointType z_;
   Integrator<Hamiltonian<Model, BaseRNG> > integrator_;
   Hamiltonian<Model, BaseRNG> hamiltonian_;
@@ -193,6 +427,115 @@ class base_hmc : public base_mcmc {
   double nom_epsilon_;
   double epsilon_;
   double epsilon_jitter_;
+
+  int max_init_stepsize_evals_;
+  int init_stepsize_bisections_;
+  int init_stepsize_evals_;
+  double init_stepsize_seconds_;
+
+  /**
+   * Evaluate the Hamiltonian at the current point at the start of a
+   * transition, unless the gradient is reused and the point still holds
+   * the values from the end of the previous transition. Transitions
+   * must leave the current point with the potential and gradient of its
+   * position. Once the transitions with the approximate model are used
+   * up, the model is switched back before the point is evaluated.
+   */
+  void init_transition(callbacks::logger& logger) {
+    if (approximate_transitions_ > 0) {
+      --approximate_transitions_;
+    } else if (this->hamiltonian_.approximate_model()) {
+      this->hamiltonian_.set_approximate_model(0);
+      z_current_ = false;
+    }
+    if (!(reuse_gradient_ && z_current_))
+      this->hamiltonian_.init(this->z_, logger);
+    z_current_ = reuse_gradient_;
+  }
+
+  void start_transition_cost() {
+    if (report_cost_)
+      transition_start_ = std::chrono::steady_clock::now();
+  }
+
+  void end_transition_cost() {
+    if (!report_cost_)
+      return;
+    transition_ns_ = pending_ns_
+                     + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - transition_start_)
+                           .count();
+    pending_ns_ = 0;
+
+    size_t grad_evals = this->hamiltonian_.num_grad_evals();
+    size_t log_prob_evals = this->hamiltonian_.num_log_prob_evals();
+    transition_grad_evals_ = grad_evals - last_grad_evals_;
+    transition_log_prob_evals_ = log_prob_evals - last_log_prob_evals_;
+    last_grad_evals_ = grad_evals;
+    last_log_prob_evals_ = log_prob_evals;
+  }
+
+  void get_cost_param_names(std::vector<std::string>& names) {
+    if (!report_cost_)
+      return;
+    names.push_back("n_grad__");
+    names.push_back("n_log_prob__");
+    names.push_back("transition_ns__");
+  }
+
+  void get_cost_params(std::vector<double>& values) {
+    if (!report_cost_)
+      return;
+    values.push_back(transition_grad_evals_);
+    values.push_back(transition_log_prob_evals_);
+    values.push_back(transition_ns_);
+  }
+
+ private:
+  bool report_cost_;
+  bool reuse_gradient_;
+  // Whether z_ holds the potential and gradient of its position as left
+  // by the last transition
+  bool z_current_;
+  unsigned int approximate_transitions_;
+  size_t last_grad_evals_;
+  size_t last_log_prob_evals_;
+  std::chrono::steady_clock::time_point transition_start_;
+  int64_t pending_ns_;
+  size_t transition_grad_evals_;
+  size_t transition_log_prob_evals_;
+  int64_t transition_ns_;
+
+  /**
+   * Take one leapfrog step at the nominal step size from the given
+   * point with a fresh momentum, and return the log acceptance
+   * probability before it is capped at zero.
+   */
+  double init_stepsize_delta_H(
+      const typename Hamiltonian<Model, BaseRNG>::PointType& z_start,
+      callbacks::logger& logger) {
+    this->z_ = z_start;
+    this->hamiltonian_.sample_p(this->z_, this->rand_int_);
+
+    double H0 = this->hamiltonian_.H(this->z_);
+
+    this->integrator_.evolve(this->z_, this->hamiltonian_, this->nom_epsilon_,
+                             logger);
+    ++init_stepsize_evals_;
+
+    double h = this->hamiltonian_.H(this->z_);
+    if (std::isnan(h))
+      h = std::numeric_limits<double>::infinity();
+
+    return H0 - h;
+  }
+
+  void warn_init_stepsize(callbacks::logger& logger) {
+    std::stringstream msg;
+    msg << "Step size initialization stopped after " << init_stepsize_evals_
+        << " leapfrog steps at step size " << this->nom_epsilon_;
+    logger.warn(msg);
+  }
 };
 
 }  // namespace mcmc
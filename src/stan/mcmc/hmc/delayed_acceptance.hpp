@@ -0,0 +1,162 @@
+#ifndef STAN_MCMC_HMC_DELAYED_ACCEPTANCE_HPP
+#define STAN_MCMC_HMC_DELAYED_ACCEPTANCE_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/mcmc/sample.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Delayed-acceptance HMC: the transitions of an HMC sampler are run on
+ * a cheap surrogate of the model, such as a subsampled or approximate
+ * likelihood, and their proposals are then accepted or rejected with
+ * the model, as in Christen and Fox (2005), "Markov chain Monte Carlo
+ * using an approximation", JCGS.
+ *
+ * The first stage is a transition of the sampler, whose Hamiltonian is
+ * that of the surrogate, so the trajectory and its gradients only
+ * evaluate the surrogate. If it moves the chain from q to q', the
+ * second stage accepts q' with probability
+ *
+ * <pre>
+ * min(1, p(q') s(q) / (p(q) s(q'))),
+ * </pre>
+ *
+ * where p is the density of the model and s that of the surrogate,
+ * and otherwise the chain stays at q. NUTS and static HMC transitions
+ * leave s invariant and are reversible, so the draws target p, while
+ * the model's log density, without its gradient, is evaluated once per
+ * draw by a second Hamiltonian of the model. Only transitions the
+ * first stage accepts need it, so the fewer the better the surrogate.
+ *
+ * Adaptation during warmup is that of the sampler on the surrogate,
+ * with the first-stage acceptance statistic and positions, which is
+ * fine for tuning the step size and metric but not for sampling. The
+ * draws have the log density of the model and the first-stage
+ * acceptance statistic; the second-stage acceptance probability is the
+ * sampler parameter <code>delayed_accept_stat__</code>, which is 0 when
+ * the first stage stays at q.
+ *
+ * @tparam Model type of the model and of the surrogate
+ * @tparam Sampler HMC sampler on the surrogate, such as
+ *   <code>adapt_diag_e_nuts<Model, BaseRNG></code>
+ */
+template <class Model, class Sampler>
+class delayed_acceptance : public Sampler {
+ public:
+  /**
+   * @tparam BaseRNG type of random number generator
+   * @param model model the draws target
+   * @param surrogate surrogate of the model with the same unconstrained
+   *   parameters; both must outlive the sampler
+   * @param rng random number generator
+   * @throw std::invalid_argument if the model and the surrogate have a
+   *   different number of unconstrained parameters
+   */
+  template <class BaseRNG>
+  delayed_acceptance(const Model& model, const Model& surrogate, BaseRNG& rng)
+      : Sampler(surrogate, rng),
+        full_hamiltonian_(model),
+        full_z_(model.num_params_r()),
+        current_(false),
+        surrogate_V_(0),
+        full_V_(0),
+        accept_prob_(0) {
+    if (model.num_params_r() != surrogate.num_params_r())
+      throw std::invalid_argument(
+          "The surrogate must have the same number of unconstrained "
+          "parameters as the model");
+  }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    const Eigen::VectorXd q0 = init_sample.cont_params();
+    if (!(current_ && q0.size() == full_z_.q.size() && q0 == full_z_.q))
+      evaluate_start(q0, logger);
+
+    sample s = Sampler::transition(init_sample, logger);
+    const Eigen::VectorXd& q1 = s.cont_params();
+    if (q1 == q0) {
+      accept_prob_ = 0;
+      return sample(q0, -full_V_, s.accept_stat());
+    }
+
+    // The sampler's point holds the proposal and its surrogate potential
+    const double surrogate_V1 = this->z_.V;
+    full_z_.q = q1;
+    full_hamiltonian_.update_potential(full_z_, logger);
+    const double log_ratio
+        = (surrogate_V1 - full_z_.V) - (surrogate_V_ - full_V_);
+    accept_prob_ = std::isnan(log_ratio) ? 0
+                   : log_ratio > 0       ? 1
+                                         : std::exp(log_ratio);
+
+    if (accept_prob_ < 1 && this->rand_uniform_() > accept_prob_) {
+      full_z_.q = q0;
+      this->seed(q0);
+      return sample(q0, -full_V_, s.accept_stat());
+    }
+    surrogate_V_ = surrogate_V1;
+    full_V_ = full_z_.V;
+    return sample(q1, -full_V_, s.accept_stat());
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    Sampler::get_sampler_param_names(names);
+    names.push_back("delayed_accept_stat__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    Sampler::get_sampler_params(values);
+    values.push_back(accept_prob_);
+  }
+
+  void read_state(state_reader& reader) {
+    Sampler::read_state(reader);
+    current_ = false;
+  }
+
+  /**
+   * Return the number of evaluations of the model's log density since
+   * construction, including failed ones.
+   */
+  size_t get_num_full_evals() const {
+    return full_hamiltonian_.num_log_prob_evals();
+  }
+
+ private:
+  typedef typename Sampler::hamiltonian_t hamiltonian_t;
+
+  hamiltonian_t full_hamiltonian_;
+  // Position of the chain and the model's potential there
+  typename hamiltonian_t::PointType full_z_;
+  // Whether the potentials below are those of the position of full_z_
+  bool current_;
+  double surrogate_V_;
+  double full_V_;
+  double accept_prob_;
+
+  /**
+   * Evaluate the potentials of the model and of the surrogate at a
+   * position the chain was seeded at from outside.
+   */
+  void evaluate_start(const Eigen::VectorXd& q, callbacks::logger& logger) {
+    full_z_.q = q;
+    typename hamiltonian_t::PointType z(full_z_);
+    this->hamiltonian_.update_potential(z, logger);
+    surrogate_V_ = z.V;
+    full_hamiltonian_.update_potential(full_z_, logger);
+    full_V_ = full_z_.V;
+    current_ = true;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,67 @@
+#ifndef STAN_MCMC_HMC_GHMC_ADAPT_DENSE_E_GHMC_HPP
+#define STAN_MCMC_HMC_GHMC_ADAPT_DENSE_E_GHMC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/damping_adaptation.hpp>
+#include <stan/mcmc/hmc/ghmc/dense_e_ghmc.hpp>
+#include <stan/mcmc/stepsize_covar_adapter.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Generalized Hamiltonian Monte Carlo with partial momentum refreshment
+ * with a Gaussian-Euclidean disintegration and adaptive dense metric,
+ * adaptive step size and adaptive damping
+ */
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_dense_e_ghmc : public dense_e_ghmc<Model, BaseRNG, Integrator>,
+                           public stepsize_covar_adapter {
+ public:
+  adapt_dense_e_ghmc(const Model& model, BaseRNG& rng)
+      : dense_e_ghmc<Model, BaseRNG, Integrator>(model, rng),
+        stepsize_covar_adapter(model.num_params_r()),
+        damping_adaptation_(model.num_params_r()) {}
+
+  ~adapt_dense_e_ghmc() {}
+
+  damping_adaptation& get_damping_adaptation() { return damping_adaptation_; }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    sample s = dense_e_ghmc<Model, BaseRNG, Integrator>::transition(
+        init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+      bool update = this->covar_adaptation_.learn_covariance(
+          this->z_.inv_e_metric_, this->z_.q);
+
+      if (update) {
+        this->z_.update_metric_factor();
+        this->init_stepsize(logger);
+        this->reset_momentum();
+        damping_adaptation_.restart();
+
+        this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
+        this->stepsize_adaptation_.restart();
+      }
+      damping_adaptation_.learn_damping(this->damping_, this->z_.q,
+                                        this->z_.inv_e_metric_.diagonal());
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+
+ protected:
+  damping_adaptation damping_adaptation_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
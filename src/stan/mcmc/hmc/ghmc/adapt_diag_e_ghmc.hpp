@@ -0,0 +1,66 @@
+#ifndef STAN_MCMC_HMC_GHMC_ADAPT_DIAG_E_GHMC_HPP
+#define STAN_MCMC_HMC_GHMC_ADAPT_DIAG_E_GHMC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/damping_adaptation.hpp>
+#include <stan/mcmc/hmc/ghmc/diag_e_ghmc.hpp>
+#include <stan/mcmc/stepsize_var_adapter.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Generalized Hamiltonian Monte Carlo with partial momentum refreshment
+ * with a Gaussian-Euclidean disintegration and adaptive diagonal metric,
+ * adaptive step size and adaptive damping
+ */
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_diag_e_ghmc : public diag_e_ghmc<Model, BaseRNG, Integrator>,
+                          public stepsize_var_adapter {
+ public:
+  adapt_diag_e_ghmc(const Model& model, BaseRNG& rng)
+      : diag_e_ghmc<Model, BaseRNG, Integrator>(model, rng),
+        stepsize_var_adapter(model.num_params_r()),
+        damping_adaptation_(model.num_params_r()) {}
+
+  ~adapt_diag_e_ghmc() {}
+
+  damping_adaptation& get_damping_adaptation() { return damping_adaptation_; }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    sample s = diag_e_ghmc<Model, BaseRNG, Integrator>::transition(
+        init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+      bool update = this->var_adaptation_.learn_variance(this->z_.inv_e_metric_,
+                                                         this->z_.q);
+
+      if (update) {
+        this->init_stepsize(logger);
+        this->reset_momentum();
+        damping_adaptation_.restart();
+
+        this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
+        this->stepsize_adaptation_.restart();
+      }
+      damping_adaptation_.learn_damping(this->damping_, this->z_.q,
+                                        this->z_.inv_e_metric_);
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+
+ protected:
+  damping_adaptation damping_adaptation_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,53 @@
+#ifndef STAN_MCMC_HMC_GHMC_ADAPT_UNIT_E_GHMC_HPP
+#define STAN_MCMC_HMC_GHMC_ADAPT_UNIT_E_GHMC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/damping_adaptation.hpp>
+#include <stan/mcmc/hmc/ghmc/unit_e_ghmc.hpp>
+#include <stan/mcmc/stepsize_adapter.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Generalized Hamiltonian Monte Carlo with partial momentum refreshment
+ * with a Gaussian-Euclidean disintegration and unit metric,
+ * adaptive step size and adaptive damping
+ */
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_unit_e_ghmc : public unit_e_ghmc<Model, BaseRNG, Integrator>,
+                          public stepsize_adapter {
+ public:
+  adapt_unit_e_ghmc(const Model& model, BaseRNG& rng)
+      : unit_e_ghmc<Model, BaseRNG, Integrator>(model, rng),
+        damping_adaptation_(model.num_params_r()) {}
+
+  ~adapt_unit_e_ghmc() {}
+
+  damping_adaptation& get_damping_adaptation() { return damping_adaptation_; }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    sample s = unit_e_ghmc<Model, BaseRNG, Integrator>::transition(
+        init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+      damping_adaptation_.learn_damping(
+          this->damping_, this->z_.q, Eigen::VectorXd::Ones(this->z_.q.size()));
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+
+ protected:
+  damping_adaptation damping_adaptation_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
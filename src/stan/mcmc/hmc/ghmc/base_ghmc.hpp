@@ -0,0 +1,193 @@
+#ifndef STAN_MCMC_HMC_GHMC_BASE_GHMC_HPP
+#define STAN_MCMC_HMC_GHMC_BASE_GHMC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/base_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Generalized Hamiltonian Monte Carlo (Horowitz 1991), which keeps the
+ * momentum from one transition to the next and only partially
+ * refreshes it, so that short trajectories of a fixed number of steps
+ * keep moving in the same direction across transitions.
+ *
+ * Each transition replaces the momentum p by
+ * <code>alpha * p + sqrt(1 - alpha^2) * xi</code>, with xi a fresh
+ * momentum drawn from the metric, integrates for a fixed number of
+ * steps and accepts the end point with the usual Metropolis
+ * probability. A rejected proposal returns to the starting point with
+ * the momentum negated, which keeps the chain reversible. The
+ * persistence is <code>alpha = exp(-damping * epsilon * L)</code>,
+ * where the damping is the rate at which the momentum is forgotten per
+ * unit of integration time: zero keeps the momentum forever and a
+ * large damping refreshes it fully, as static HMC does.
+ *
+ * The momentum is only carried over when the transition starts where
+ * the previous one ended; otherwise it is drawn afresh. Since every
+ * rejection reverses the direction of travel, the step size should be
+ * adapted to a higher acceptance rate than for NUTS.
+ */
+template <class Model, template <class, class> class Hamiltonian,
+          template <class> class Integrator, class BaseRNG>
+class base_ghmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
+ public:
+  base_ghmc(const Model& model, BaseRNG& rng)
+      : base_hmc<Model, Hamiltonian, Integrator, BaseRNG>(model, rng),
+        L_(1),
+        damping_(1),
+        alpha_(0),
+        energy_(0),
+        p_current_(false) {}
+
+  ~base_ghmc() {}
+
+  void set_metric(const Eigen::MatrixXd& inv_e_metric) {
+    this->z_.set_metric(inv_e_metric);
+  }
+
+  void set_metric(const Eigen::VectorXd& inv_e_metric) {
+    this->z_.set_metric(inv_e_metric);
+  }
+
+  void set_metric_factor(const Eigen::MatrixXd& inv_e_metric_factor) {
+    this->z_.set_metric_factor(inv_e_metric_factor);
+  }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->start_transition_cost();
+
+    this->sample_stepsize();
+
+    const Eigen::VectorXd& q = init_sample.cont_params();
+    bool persist
+        = p_current_ && q.size() == this->z_.q.size() && q == this->z_.q;
+    this->seed(q);
+
+    alpha_ = persist ? std::exp(-damping_ * this->epsilon_ * L_) : 0;
+    p_previous_ = this->z_.p;
+    this->hamiltonian_.sample_p(this->z_, this->rand_int_);
+    if (persist)
+      this->z_.p = alpha_ * p_previous_
+                   + std::sqrt(1 - alpha_ * alpha_) * this->z_.p;
+    this->init_transition(logger);
+
+    ps_point z_init(this->z_);
+
+    double H0 = this->hamiltonian_.H(this->z_);
+
+    for (int i = 0; i < L_; ++i)
+      this->integrator_.evolve(this->z_, this->hamiltonian_, this->epsilon_,
+                               logger);
+
+    double h = this->hamiltonian_.H(this->z_);
+    if (std::isnan(h))
+      h = std::numeric_limits<double>::infinity();
+
+    double acceptProb = std::exp(H0 - h);
+
+    if (acceptProb < 1 && this->rand_uniform_() > acceptProb) {
+      this->z_.ps_point::operator=(z_init);
+      this->z_.p = -this->z_.p;
+    }
+
+    acceptProb = acceptProb > 1 ? 1 : acceptProb;
+
+    this->energy_ = this->hamiltonian_.H(this->z_);
+    p_current_ = true;
+    this->end_transition_cost();
+    return sample(this->z_.q, -this->hamiltonian_.V(this->z_), acceptProb);
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    names.push_back("stepsize__");
+    names.push_back("int_time__");
+    names.push_back("damping__");
+    names.push_back("energy__");
+    this->get_cost_param_names(names);
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    values.push_back(this->epsilon_);
+    values.push_back(this->epsilon_ * L_);
+    values.push_back(this->damping_);
+    values.push_back(this->energy_);
+    this->get_cost_params(values);
+  }
+
+  void set_nominal_stepsize_and_L(const double e, const int l) {
+    if (e > 0 && l > 0) {
+      this->nom_epsilon_ = e;
+      L_ = l;
+    }
+  }
+
+  /**
+   * Set the number of integrator steps of each transition.
+   *
+   * @param l number of steps, ignored unless positive
+   */
+  void set_L(const int l) {
+    if (l > 0)
+      L_ = l;
+  }
+
+  int get_L() const { return L_; }
+
+  /**
+   * Set the rate at which the momentum is forgotten per unit of
+   * integration time.
+   *
+   * @param damping damping, ignored if negative
+   */
+  void set_damping(const double damping) {
+    if (damping >= 0)
+      damping_ = damping;
+  }
+
+  double get_damping() const { return damping_; }
+
+  /**
+   * Return the persistence of the momentum in the last transition, or
+   * zero if its momentum was drawn afresh.
+   */
+  double get_alpha() const { return alpha_; }
+
+  /**
+   * Draw a fresh momentum at the start of the next transition, as after
+   * a change of the metric the momentum was drawn from.
+   */
+  void reset_momentum() { p_current_ = false; }
+
+  void write_state(state_writer& writer) const {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::write_state(writer);
+    writer.write(L_);
+    writer.write(damping_);
+  }
+
+  void read_state(state_reader& reader) {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::read_state(reader);
+    reader.read(L_);
+    reader.read(damping_);
+    // The momentum of the point is the one the chain stopped with
+    p_current_ = true;
+  }
+
+ protected:
+  int L_;
+  double damping_;
+  double alpha_;
+  double energy_;
+  // Whether z_ holds the momentum the last transition ended with
+  bool p_current_;
+  Eigen::VectorXd p_previous_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
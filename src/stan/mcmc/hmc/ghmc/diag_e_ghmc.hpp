@@ -0,0 +1,31 @@
+#ifndef STAN_MCMC_HMC_GHMC_DIAG_E_GHMC_HPP
+#define STAN_MCMC_HMC_GHMC_DIAG_E_GHMC_HPP
+
+#include <stan/mcmc/hmc/hamiltonians/diag_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/integrators/expl_three_stage.hpp>
+#include <stan/mcmc/hmc/integrators/expl_two_stage.hpp>
+#include <stan/mcmc/hmc/ghmc/base_ghmc.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Generalized Hamiltonian Monte Carlo with partial momentum refreshment
+ * with a Gaussian-Euclidean disintegration and diagonal metric
+ *
+ * The integrator is the leapfrog unless another is given, such as
+ * <code>expl_two_stage</code> or <code>expl_three_stage</code>.
+ */
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class diag_e_ghmc
+    : public base_ghmc<Model, diag_e_metric, Integrator, BaseRNG> {
+ public:
+  diag_e_ghmc(const Model& model, BaseRNG& rng)
+      : base_ghmc<Model, diag_e_metric, Integrator, BaseRNG>(model, rng) {}
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,413 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_APPROX_SOFTABS_METRIC_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_APPROX_SOFTABS_METRIC_HPP
+
+#include <stan/math/mix.hpp>
+#include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/approx_softabs_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+#include <stan/mcmc/hmc/hamiltonians/softabs_metric.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Riemannian manifold with an approximate SoftAbs metric that needs no
+ * dense Hessian.
+ *
+ * The leading <code>z.rank</code> eigenpairs of the Hessian, by
+ * magnitude, are found by Lanczos iteration with full
+ * reorthogonalization on Hessian-vector products. The rest of the
+ * spectrum is treated as flat, so the metric is
+ * <code>U softabs(Lambda) U^T + (I - U U^T) / alpha</code>. Every trace
+ * of a matrix times the Hessian is reduced to a sum of
+ * <code>O(rank)</code> directional third derivatives instead of one per
+ * dimension. With <code>rank</code> equal to the dimension this is the
+ * exact SoftAbs metric.
+ *
+ * The gradients are those of this truncated metric. The rotation of the
+ * leading eigenvectors into the rest of the spectrum depends on the
+ * eigenvalues there, so the gradient of the kinetic energy solves
+ * <code>(lambda_i - H) w_i = (I - U U^T) p</code> on the rest of the
+ * spectrum for each leading eigenvalue, by conjugate gradients on
+ * Hessian-vector products. The gradients are exact once the Lanczos
+ * iteration has converged to the leading eigenpairs, as it has when
+ * it runs to the dimension.
+ */
+template <class Model, class BaseRNG>
+class approx_softabs_metric
+    : public base_hamiltonian<Model, approx_softabs_point, BaseRNG> {
+ private:
+  typedef typename stan::math::index_type<Eigen::VectorXd>::type idx_t;
+
+ public:
+  explicit approx_softabs_metric(const Model& model)
+      : base_hamiltonian<Model, approx_softabs_point, BaseRNG>(model) {}
+
+  static constexpr bool riemannian = true;
+
+  double T(approx_softabs_point& z) {
+    return this->tau(z) + 0.5 * z.log_det_metric;
+  }
+
+  double tau(approx_softabs_point& z) {
+    Eigen::VectorXd Up = z.eigenvectors.transpose() * z.p;
+    return 0.5
+           * (z.alpha * z.p.squaredNorm()
+              + Up.dot((z.softabs_lambda_inv.array() - z.alpha).matrix()
+                           .cwiseProduct(Up)));
+  }
+
+  double phi(approx_softabs_point& z) {
+    return this->V(z) + 0.5 * z.log_det_metric;
+  }
+
+  double dG_dt(approx_softabs_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq(z, logger));
+  }
+
+  double dG_dt_given_dphi_dq(approx_softabs_point& z,
+                             const Eigen::VectorXd& dphi_dq,
+                             callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq);
+  }
+
+  Eigen::VectorXd dtau_dq(approx_softabs_point& z, callbacks::logger& logger) {
+    const Eigen::MatrixXd& U = z.eigenvectors;
+    Eigen::VectorXd Up = U.transpose() * z.p;
+    Eigen::VectorXd a = z.softabs_lambda_inv.cwiseProduct(Up);
+    Eigen::VectorXd p_rest = z.p - U * Up;
+    idx_t k = U.cols();
+
+    // The leading block contributes tr(C H) with
+    // C = U diag(a) J diag(a) U^T. Each leading eigenvector u_i rotating
+    // into the rest of the spectrum contributes w_i^T H u_i with weight
+    // -2 (1 / softabs(lambda_i) - alpha) (u_i^T p), where
+    // w_i = (lambda_i - H)^-1 p_rest on the rest of the spectrum
+    std::vector<idx_t> coupled;
+    for (idx_t i = 0; k < z.q.size() && i < k; ++i)
+      if ((z.softabs_lambda_inv(i) - z.alpha) * Up(i) != 0)
+        coupled.push_back(i);
+    idx_t m = coupled.size();
+
+    Eigen::MatrixXd left(z.q.size(), k + m);
+    Eigen::MatrixXd right(z.q.size(), k + m);
+    left.leftCols(k) = U;
+    right.leftCols(k) = U * (a.asDiagonal() * z.pseudo_j * a.asDiagonal());
+    for (idx_t j = 0; j < m; ++j) {
+      idx_t i = coupled[j];
+      left.col(k + j) = solve_rest(z, z.eigenvalues(i), p_rest);
+      right.col(k + j)
+          = -2 * (z.softabs_lambda_inv(i) - z.alpha) * Up(i) * U.col(i);
+    }
+
+    return 0.5 * grad_tr_outer_times_hessian(z.q, left, right);
+  }
+
+  Eigen::VectorXd dtau_dp(approx_softabs_point& z) {
+    Eigen::VectorXd Up = z.eigenvectors.transpose() * z.p;
+    return z.alpha * z.p
+           + z.eigenvectors
+                 * (z.softabs_lambda_inv.array() - z.alpha)
+                       .matrix()
+                       .cwiseProduct(Up);
+  }
+
+  Eigen::VectorXd dphi_dq(approx_softabs_point& z, callbacks::logger& logger) {
+    Eigen::VectorXd a
+        = z.softabs_lambda_inv.cwiseProduct(z.pseudo_j.diagonal());
+    return -0.5
+               * grad_tr_outer_times_hessian(
+                   z.q, z.eigenvectors, z.eigenvectors * a.asDiagonal())
+           + z.g;
+  }
+
+  void sample_p(approx_softabs_point& z, BaseRNG& rng) {
+    Eigen::VectorXd a(z.p.size());
+    fill_std_normal(a, rng);
+
+    double sqrt_rest = 1.0 / std::sqrt(z.alpha);
+    z.p = sqrt_rest * a
+          + z.eigenvectors
+                * (z.softabs_lambda.array().sqrt() - sqrt_rest)
+                      .matrix()
+                      .cwiseProduct(z.eigenvectors.transpose() * a);
+  }
+
+  void init(approx_softabs_point& z, callbacks::logger& logger) {
+    update_metric(z, logger);
+    update_metric_gradient(z, logger);
+  }
+
+  void update_metric(approx_softabs_point& z, callbacks::logger& logger) {
+    ++this->num_grad_evals_;
+    stan::math::gradient(softabs_fun<Model>(this->model_, 0), z.q, z.V, z.g);
+    z.V = -z.V;
+    z.g = -z.g;
+
+    leading_eigenpairs(z);
+
+    idx_t k = z.eigenvalues.size();
+    z.softabs_lambda.resize(k);
+    z.softabs_lambda_inv.resize(k);
+    for (idx_t i = 0; i < k; ++i) {
+      z.softabs_lambda(i) = softabs(z.eigenvalues(i), z.alpha);
+      z.softabs_lambda_inv(i) = 1.0 / z.softabs_lambda(i);
+    }
+
+    // Compute the log determinant of the metric
+    z.log_det_metric = -(z.q.size() - k) * std::log(z.alpha);
+    for (idx_t i = 0; i < k; ++i)
+      z.log_det_metric += std::log(z.softabs_lambda(i));
+  }
+
+  void update_metric_gradient(approx_softabs_point& z,
+                              callbacks::logger& logger) {
+    // Compute the pseudo-Jacobian of the SoftAbs transform of the
+    // leading eigenvalues
+    idx_t k = z.eigenvalues.size();
+    z.pseudo_j.resize(k, k);
+    for (idx_t i = 0; i < k; ++i) {
+      double lambda = z.eigenvalues(i);
+      for (idx_t j = 0; j <= i; ++j) {
+        double delta = lambda - z.eigenvalues(j);
+        if (std::fabs(delta) < jacobian_thresh)
+          z.pseudo_j(i, j) = softabs_derivative(lambda, z.alpha);
+        else
+          z.pseudo_j(i, j)
+              = (z.softabs_lambda(i) - z.softabs_lambda(j)) / delta;
+        z.pseudo_j(j, i) = z.pseudo_j(i, j);
+      }
+    }
+  }
+
+  void update_gradients(approx_softabs_point& z, callbacks::logger& logger) {
+    update_metric_gradient(z, logger);
+  }
+
+  // Threshold below which a power series
+  // approximation of the softabs function is used
+  static double lower_softabs_thresh;
+
+  // Threshold above which an asymptotic
+  // approximation of the softabs function is used
+  static double upper_softabs_thresh;
+
+  // Threshold below which an exact derivative is
+  // used in the Jacobian calculation instead of
+  // finite differencing
+  static double jacobian_thresh;
+
+  // Relative residual at which the solves on the rest of the spectrum
+  // stop
+  static double rest_solve_tol;
+
+ private:
+  static double softabs(double lambda, double alpha) {
+    double alpha_lambda = alpha * lambda;
+    // Thresholds defined such that the approximation
+    // error is on the same order of double precision
+    if (std::fabs(alpha_lambda) < lower_softabs_thresh)
+      return (1.0 + (1.0 / 3.0) * alpha_lambda * alpha_lambda) / alpha;
+    if (std::fabs(alpha_lambda) > upper_softabs_thresh)
+      return std::fabs(lambda);
+    return lambda / std::tanh(alpha_lambda);
+  }
+
+  static double softabs_derivative(double lambda, double alpha) {
+    double alpha_lambda = alpha * lambda;
+    if (std::fabs(alpha_lambda) < lower_softabs_thresh)
+      return (2.0 / 3.0) * alpha_lambda
+             * (1.0 - (2.0 / 15.0) * alpha_lambda * alpha_lambda);
+    if (std::fabs(alpha_lambda) > upper_softabs_thresh)
+      return lambda > 0 ? 1 : -1;
+    double sdx = std::sinh(alpha_lambda) / lambda;
+    return (softabs(lambda, alpha) - alpha / (sdx * sdx)) / lambda;
+  }
+
+  /**
+   * Find the leading eigenpairs of the Hessian of the potential at
+   * <code>z.q</code> by Lanczos iteration, with a fixed starting vector
+   * so that the metric is a deterministic function of the position.
+   */
+  void leading_eigenpairs(approx_softabs_point& z) {
+    idx_t n = z.q.size();
+    idx_t k = std::max(0, std::min(z.rank, static_cast<int>(n)));
+    idx_t m = std::min(n, std::max(2 * k, k + 20));
+    if (k == 0) {
+      z.eigenvalues.resize(0);
+      z.eigenvectors.resize(n, 0);
+      return;
+    }
+
+    Eigen::MatrixXd basis(n, m);
+    Eigen::VectorXd diag(m);
+    Eigen::VectorXd off_diag = Eigen::VectorXd::Zero(m);
+    Eigen::VectorXd v = Eigen::VectorXd::Ones(n) / std::sqrt(n);
+    Eigen::VectorXd w(n);
+    double scale = 0;
+    for (idx_t j = 0; j < m; ++j) {
+      basis.col(j) = v;
+      w = potential_hessian_times(z.q, v);
+      diag(j) = v.dot(w);
+      scale = std::max(scale, std::fabs(diag(j)));
+      if (j + 1 == m)
+        break;
+
+      // Full reorthogonalization, twice for numerical stability
+      for (int pass = 0; pass < 2; ++pass)
+        w -= basis.leftCols(j + 1) * (basis.leftCols(j + 1).transpose() * w);
+      off_diag(j) = w.norm();
+      if (off_diag(j) > 1e-10 * std::max(scale, 1.0)) {
+        v = w / off_diag(j);
+        continue;
+      }
+
+      // The Krylov space is invariant, so continue from a direction
+      // orthogonal to it
+      off_diag(j) = 0;
+      for (idx_t i = 0; i < n; ++i) {
+        v = Eigen::VectorXd::Unit(n, i);
+        for (int pass = 0; pass < 2; ++pass)
+          v -= basis.leftCols(j + 1)
+               * (basis.leftCols(j + 1).transpose() * v);
+        if (v.norm() > 0.5)
+          break;
+      }
+      v.normalize();
+    }
+
+    Eigen::MatrixXd tridiag = Eigen::MatrixXd::Zero(m, m);
+    tridiag.diagonal() = diag;
+    tridiag.diagonal(-1) = off_diag.head(m - 1);
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> ritz(tridiag);
+
+    std::vector<idx_t> order(m);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&ritz](idx_t a, idx_t b) {
+      return std::fabs(ritz.eigenvalues()(a))
+             > std::fabs(ritz.eigenvalues()(b));
+    });
+
+    z.eigenvalues.resize(k);
+    z.eigenvectors.resize(n, k);
+    for (idx_t i = 0; i < k; ++i) {
+      z.eigenvalues(i) = ritz.eigenvalues()(order[i]);
+      z.eigenvectors.col(i) = basis * ritz.eigenvectors().col(order[i]);
+    }
+  }
+
+  /**
+   * Return the Hessian of the potential at the position times the
+   * specified vector.
+   */
+  Eigen::VectorXd potential_hessian_times(const Eigen::VectorXd& q,
+                                          const Eigen::VectorXd& v) {
+    double log_prob;
+    Eigen::VectorXd hv;
+    ++this->num_grad_evals_;
+    stan::math::hessian_times_vector(softabs_fun<Model>(this->model_, 0), q, v,
+                                     log_prob, hv);
+    return -hv;
+  }
+
+  /**
+   * Solve <code>(lambda - H) w = b</code> on the rest of the spectrum,
+   * the complement of the leading eigenvectors, for the Hessian H of the
+   * potential, a leading eigenvalue lambda and b in the rest.
+   *
+   * The rest has eigenvalues no larger in magnitude than lambda, so
+   * <code>sign(lambda) (lambda - H)</code> is positive semidefinite
+   * there and the system is solved by conjugate gradients, with one
+   * Hessian-vector product per iteration.
+   */
+  Eigen::VectorXd solve_rest(approx_softabs_point& z, double lambda,
+                             const Eigen::VectorXd& b) {
+    const Eigen::MatrixXd& U = z.eigenvectors;
+    double sign = lambda < 0 ? -1 : 1;
+    auto project = [&U](Eigen::VectorXd& x) { x -= U * (U.transpose() * x); };
+
+    Eigen::VectorXd w = Eigen::VectorXd::Zero(b.size());
+    Eigen::VectorXd r = sign * b;
+    project(r);
+    Eigen::VectorXd d = r;
+    Eigen::VectorXd Ad(b.size());
+    double rr = r.squaredNorm();
+    const double tol = rest_solve_tol * rest_solve_tol * rr;
+    for (idx_t n = 0; n < b.size() && rr > tol; ++n) {
+      Ad = sign * (lambda * d - potential_hessian_times(z.q, d));
+      project(Ad);
+      double dAd = d.dot(Ad);
+      if (!(dAd > 0))
+        break;
+      double step = rr / dAd;
+      w += step * d;
+      r -= step * Ad;
+      double rr_next = r.squaredNorm();
+      d = r + (rr_next / rr) * d;
+      rr = rr_next;
+    }
+    return w;
+  }
+
+  /**
+   * Return the gradient with respect to the position of
+   * <code>sum_j left_j^T H right_j</code>, the trace of
+   * <code>right left^T</code> times the Hessian of the log density,
+   * with one forward-over-reverse pass per column.
+   */
+  Eigen::VectorXd grad_tr_outer_times_hessian(const Eigen::VectorXd& q,
+                                              const Eigen::MatrixXd& left,
+                                              const Eigen::MatrixXd& right) {
+    using stan::math::fvar;
+    using stan::math::var;
+
+    this->num_grad_evals_ += left.cols();
+
+    // Run nested autodiff in this scope
+    stan::math::nested_rev_autodiff nested;
+
+    Eigen::Matrix<var, Eigen::Dynamic, 1> q_var(q.size());
+    for (idx_t i = 0; i < q.size(); ++i)
+      q_var(i) = q(i);
+
+    Eigen::Matrix<fvar<var>, Eigen::Dynamic, 1> q_fvar(q.size());
+    Eigen::VectorXd right_j(q.size());
+    var sum(0.0);
+    for (idx_t j = 0; j < left.cols(); ++j) {
+      for (idx_t i = 0; i < q.size(); ++i)
+        q_fvar(i) = fvar<var>(q_var(i), left(i, j));
+      right_j = right.col(j);
+      fvar<var> fx;
+      fvar<var> grad_fx_dot_v;
+      stan::math::gradient_dot_vector<fvar<var>, double>(
+          softabs_fun<Model>(this->model_, 0), q_fvar, right_j, fx,
+          grad_fx_dot_v);
+      sum += grad_fx_dot_v.d_;
+    }
+
+    stan::math::grad(sum.vi_);
+    Eigen::VectorXd grad_tr(q.size());
+    for (idx_t i = 0; i < q.size(); ++i)
+      grad_tr(i) = q_var(i).adj();
+    return grad_tr;
+  }
+};
+
+template <class Model, class BaseRNG>
+double approx_softabs_metric<Model, BaseRNG>::lower_softabs_thresh = 1e-4;
+
+template <class Model, class BaseRNG>
+double approx_softabs_metric<Model, BaseRNG>::upper_softabs_thresh = 18;
+
+template <class Model, class BaseRNG>
+double approx_softabs_metric<Model, BaseRNG>::jacobian_thresh = 1e-10;
+
+template <class Model, class BaseRNG>
+double approx_softabs_metric<Model, BaseRNG>::rest_solve_tol = 1e-12;
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,58 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_APPROX_SOFTABS_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_APPROX_SOFTABS_POINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <algorithm>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Riemannian manifold with an
+ * approximate SoftAbs metric, built from the <code>rank</code>
+ * eigenpairs of the Hessian with the largest magnitude. The rest of
+ * the spectrum is treated as flat, where the SoftAbs metric is
+ * <code>1 / alpha</code> times the identity.
+ */
+class approx_softabs_point : public ps_point {
+ public:
+  explicit approx_softabs_point(int n)
+      : ps_point(n),
+        alpha(1.0),
+        rank(std::min(n, 10)),
+        eigenvalues(Eigen::VectorXd::Zero(0)),
+        eigenvectors(Eigen::MatrixXd::Zero(n, 0)),
+        log_det_metric(0),
+        softabs_lambda(Eigen::VectorXd::Zero(0)),
+        softabs_lambda_inv(Eigen::VectorXd::Zero(0)),
+        pseudo_j(Eigen::MatrixXd::Zero(0, 0)) {}
+
+  // SoftAbs regularization parameter
+  double alpha;
+
+  // Number of Hessian eigenpairs kept, at most the dimension
+  int rank;
+
+  // Leading eigenvalues and eigenvectors of the Hessian
+  Eigen::VectorXd eigenvalues;
+  Eigen::MatrixXd eigenvectors;
+
+  // Log determinant of metric
+  double log_det_metric;
+
+  // SoftAbs transformed leading eigenvalues of the Hessian
+  Eigen::VectorXd softabs_lambda;
+  Eigen::VectorXd softabs_lambda_inv;
+
+  // Psuedo-Jacobian of the leading eigenvalues
+  Eigen::MatrixXd pseudo_j;
+
+  virtual inline void write_metric(stan::callbacks::writer& writer) {
+    writer("No free parameters for approximate SoftAbs metric");
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
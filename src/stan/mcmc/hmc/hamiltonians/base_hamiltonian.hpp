@@ -3,11 +3,13 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/mcmc/instrumentation.hpp>
 #include <stan/model/gradient.hpp>
 #include <stan/model/log_prob_propto.hpp>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace stan {
@@ -16,12 +18,24 @@ namespace mcmc {
 template <class Model, class Point, class BaseRNG>
 class base_hamiltonian {
  public:
-  explicit base_hamiltonian(const Model& model) : model_(model) {}
+  explicit base_hamiltonian(const Model& model)
+      : model_(model),
+        approximate_model_(0),
+        inverse_temperature_(1),
+        reference_scale_(0),
+        num_log_prob_evals_(0),
+        num_grad_evals_(0) {}
 
   ~base_hamiltonian() {}
 
   typedef Point PointType;
 
+  /**
+   * Whether the metric depends on the position. The state of a point
+   * under a Euclidean metric is its potential and gradient alone.
+   */
+  static constexpr bool riemannian = false;
+
   virtual double T(Point& z) = 0;
 
   double V(Point& z) { return z.V; }
@@ -35,11 +49,39 @@ class base_hamiltonian {
   // The time derivative of the virial, G = \sum_{d = 1}^{D} q^{d} p_{d}.
   virtual double dG_dt(Point& z, callbacks::logger& logger) = 0;
 
+  /**
+   * The time derivative of the virial, reusing a gradient of phi at
+   * the point that was already computed, for example by an integrator.
+   * Metrics whose <code>dG_dt()</code> does not need the gradient of phi
+   * ignore it.
+   *
+   * @param z point
+   * @param dphi_dq gradient of phi at the point
+   * @param logger logger for messages
+   * @return time derivative of the virial
+   */
+  virtual double dG_dt_given_dphi_dq(Point& z, const Eigen::VectorXd& dphi_dq,
+                                     callbacks::logger& logger) {
+    return dG_dt(z, logger);
+  }
+
   // tau = 0.5 p_{i} p_{j} Lambda^{ij} (q)
   virtual Eigen::VectorXd dtau_dq(Point& z, callbacks::logger& logger) = 0;
 
   virtual Eigen::VectorXd dtau_dp(Point& z) = 0;
 
+  /**
+   * Write the derivative of tau with respect to the momentum into a
+   * vector the caller keeps, so that metrics which override this reuse
+   * its storage instead of allocating a new vector on every call.
+   *
+   * @param z point
+   * @param[out] p_sharp derivative of tau with respect to the momentum
+   */
+  virtual void dtau_dp_into(Point& z, Eigen::VectorXd& p_sharp) {
+    p_sharp = dtau_dp(z);
+  }
+
   // phi = 0.5 * log | Lambda (q) | + V(q)
   virtual Eigen::VectorXd dphi_dq(Point& z, callbacks::logger& logger) = 0;
 
@@ -50,8 +92,13 @@ class base_hamiltonian {
   }
 
   void update_potential(Point& z, callbacks::logger& logger) {
+    ++num_log_prob_evals_;
     try {
-      z.V = -stan::model::log_prob_propto<true>(model_, z.q);
+      z.V = -inverse_temperature_
+            * stan::model::log_prob_propto<true>(potential_model(), z.q);
+      if (reference_scale_ > 0)
+        z.V += (1 - inverse_temperature_) * 0.5 * z.q.squaredNorm()
+               / (reference_scale_ * reference_scale_);
     } catch (const std::exception& e) {
       this->write_error_msg_(e, logger);
       z.V = std::numeric_limits<double>::infinity();
@@ -59,14 +106,24 @@ class base_hamiltonian {
   }
 
   void update_potential_gradient(Point& z, callbacks::logger& logger) {
-    try {
-      stan::model::gradient(model_, z.q, z.V, z.g, logger);
-      z.V = -z.V;
-    } catch (const std::exception& e) {
-      this->write_error_msg_(e, logger);
+    STAN_INSTRUMENT_REGION("update_potential_gradient");
+    ++num_grad_evals_;
+    if (!stan::model::try_negative_gradient(potential_model(), z.q, q_var_,
+                                            z.V, z.g, logger, error_message_)) {
+      this->write_error_msg_(error_message_, logger);
       z.V = std::numeric_limits<double>::infinity();
+      return;
+    }
+    if (inverse_temperature_ != 1) {
+      z.V *= inverse_temperature_;
+      z.g *= inverse_temperature_;
+    }
+    if (reference_scale_ > 0) {
+      const double weight
+          = (1 - inverse_temperature_) / (reference_scale_ * reference_scale_);
+      z.V += weight * 0.5 * z.q.squaredNorm();
+      z.g += weight * z.q;
     }
-    z.g = -z.g;
   }
 
   void update_metric(Point& z, callbacks::logger& logger) {}
@@ -77,22 +134,116 @@ class base_hamiltonian {
     update_potential_gradient(z, logger);
   }
 
+  /**
+   * Set an approximate model to evaluate the potential and its gradient
+   * with instead of the model, or a null pointer to use the model again.
+   * The approximate model is meant to be cheaper and less accurate, for
+   * example built with reduced precision math functions, and must have
+   * the same unconstrained parameters as the model. The metric terms of
+   * Riemannian Hamiltonians are always evaluated with the model.
+   *
+   * @param model approximate model, which must outlive its use here
+   */
+  void set_approximate_model(const Model* model) { approximate_model_ = model; }
+
+  /**
+   * Return the approximate model, or a null pointer if there is none.
+   */
+  const Model* approximate_model() const { return approximate_model_; }
+
+  /**
+   * Set the inverse temperature beta, which scales the potential and its
+   * gradient so that the Hamiltonian targets the density raised to the
+   * power beta. The default is 1. Riemannian metrics, which evaluate the
+   * potential themselves, are not tempered.
+   *
+   * @param beta inverse temperature, which must be positive
+   */
+  void set_inverse_temperature(double beta) { inverse_temperature_ = beta; }
+
+  double inverse_temperature() const { return inverse_temperature_; }
+
+  /**
+   * Set the scale of a normal reference density for tempering, so that
+   * the Hamiltonian targets the density raised to the power beta times
+   * the reference raised to the power 1 - beta, the path from the
+   * reference at beta = 0 to the density at beta = 1 followed by
+   * sequential Monte Carlo. The reference is the normal with mean zero
+   * and this standard deviation in every unconstrained coordinate. The
+   * default of 0 means there is no reference.
+   *
+   * @param scale standard deviation of the reference, or 0 for none
+   */
+  void set_reference_scale(double scale) { reference_scale_ = scale; }
+
+  double reference_scale() const { return reference_scale_; }
+
+  /**
+   * Return the number of evaluations of the log density without its
+   * gradient since construction, including failed ones.
+   *
+   * @return number of log density evaluations
+   */
+  size_t num_log_prob_evals() const { return num_log_prob_evals_; }
+
+  /**
+   * Return the number of evaluations of the gradient of the log
+   * density since construction, including failed ones. The Hessians,
+   * Hessian-vector products and gradients of traces with the Hessian
+   * taken by Riemannian metrics count one evaluation for each
+   * forward-over-reverse pass they take.
+   *
+   * @return number of gradient evaluations
+   */
+  size_t num_grad_evals() const { return num_grad_evals_; }
+
  protected:
   const Model& model_;
+  const Model* approximate_model_;
+  double inverse_temperature_;
+  double reference_scale_;
+
+  // The model the potential is evaluated with
+  const Model& potential_model() const {
+    return approximate_model_ ? *approximate_model_ : model_;
+  }
+
+  // Autodiff variables for the position, reused across gradient
+  // evaluations
+  Eigen::Matrix<stan::math::var, Eigen::Dynamic, 1> q_var_;
 
+  // Message of the last rejected gradient evaluation, whose storage is
+  // reused across rejections
+  std::string error_message_;
+
+  size_t num_log_prob_evals_;
+  size_t num_grad_evals_;
+
+  // The fixed lines are built once, so that a logger that only counts
+  // repeated messages, such as callbacks::batched_logger, doesn't pay
+  // for constructing them on every rejection
   void write_error_msg_(const std::exception& e, callbacks::logger& logger) {
-    logger.error(
+    write_error_msg_(std::string(e.what()), logger);
+  }
+
+  void write_error_msg_(const std::string& message,
+                        callbacks::logger& logger) {
+    static const std::string rejecting(
         "Informational Message: The current Metropolis proposal "
         "is about to be rejected because of the following issue:");
-    logger.error(e.what());
-    logger.error(
+    static const std::string sporadic(
         "If this warning occurs sporadically, such as for highly "
         "constrained variable types like covariance matrices, "
         "then the sampler is fine,");
-    logger.error(
+    static const std::string often(
         "but if this warning occurs often then your model may be "
         "either severely ill-conditioned or misspecified.");
-    logger.error("");
+    static const std::string blank;
+    logger.error(rejecting);
+    logger.error(message);
+    logger.error(sporadic);
+    logger.error(often);
+    logger.error(blank);
   }
 };
 
@@ -0,0 +1,52 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_BLOCK_DENSE_E_METRIC_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_BLOCK_DENSE_E_METRIC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/block_dense_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+
+namespace stan {
+namespace mcmc {
+
+// Euclidean manifold with block diagonal dense metric
+template <class Model, class BaseRNG>
+class block_dense_e_metric
+    : public base_hamiltonian<Model, block_dense_e_point, BaseRNG> {
+ public:
+  explicit block_dense_e_metric(const Model& model)
+      : base_hamiltonian<Model, block_dense_e_point, BaseRNG>(model) {}
+
+  double T(block_dense_e_point& z) { return 0.5 * z.p.dot(dtau_dp(z)); }
+
+  double tau(block_dense_e_point& z) { return T(z); }
+
+  double phi(block_dense_e_point& z) { return this->V(z); }
+
+  double dG_dt(block_dense_e_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(z.g);
+  }
+
+  Eigen::VectorXd dtau_dq(block_dense_e_point& z, callbacks::logger& logger) {
+    return Eigen::VectorXd::Zero(this->model_.num_params_r());
+  }
+
+  Eigen::VectorXd dtau_dp(block_dense_e_point& z) {
+    return z.inv_metric_times(z.p);
+  }
+
+  Eigen::VectorXd dphi_dq(block_dense_e_point& z, callbacks::logger& logger) {
+    return z.g;
+  }
+
+  void sample_p(block_dense_e_point& z, BaseRNG& rng) {
+    Eigen::VectorXd u(z.p.size());
+    fill_std_normal(u, rng);
+
+    z.p = z.metric_sqrt_times(u);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,207 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_BLOCK_DENSE_E_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_BLOCK_DENSE_E_POINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Euclidean manifold whose inverse
+ * metric is block diagonal. Each block covers a contiguous range of
+ * parameters and is a dense matrix, so memory and the cost of applying
+ * the metric scale with the sum of the squared block sizes rather than
+ * with the square of the number of parameters.
+ *
+ * By default every parameter is its own block of size one.
+ */
+class block_dense_e_point : public ps_point {
+ public:
+  /**
+   * Dense inverse mass matrix of each block. After modifying them in
+   * place, update_metric_factor() must be called.
+   */
+  std::vector<Eigen::MatrixXd> inv_e_metric_;
+
+  /**
+   * Construct a point in n-dimensional phase space with n blocks of
+   * size one and the identity matrix as inverse mass matrix.
+   *
+   * @param n number of dimensions
+   */
+  explicit block_dense_e_point(int n) : ps_point(n) {
+    set_blocks(std::vector<int>(n, 1));
+  }
+
+  /**
+   * Set the block structure and reset the inverse mass matrix to the
+   * identity.
+   *
+   * @param block_sizes sizes of the consecutive blocks
+   * @throws std::invalid_argument if a block size is not positive or
+   *   the sizes do not add up to the number of dimensions
+   */
+  void set_blocks(const std::vector<int>& block_sizes) {
+    int n = 0;
+    for (int size : block_sizes) {
+      if (size <= 0)
+        throw std::invalid_argument(
+            "block_dense_e_point: block sizes must be positive");
+      n += size;
+    }
+    if (n != q.size())
+      throw std::invalid_argument(
+          "block_dense_e_point: block sizes must add up to the number of "
+          "parameters");
+    block_starts_.clear();
+    inv_e_metric_.clear();
+    int start = 0;
+    for (int size : block_sizes) {
+      block_starts_.push_back(start);
+      inv_e_metric_.push_back(Eigen::MatrixXd::Identity(size, size));
+      start += size;
+    }
+    update_metric_factor();
+  }
+
+  /**
+   * Return the number of blocks.
+   */
+  int num_blocks() const { return inv_e_metric_.size(); }
+
+  /**
+   * Return the index of the first parameter of a block.
+   *
+   * @param b block index
+   */
+  int block_start(int b) const { return block_starts_[b]; }
+
+  /**
+   * Return the size of a block.
+   *
+   * @param b block index
+   */
+  int block_size(int b) const { return inv_e_metric_[b].rows(); }
+
+  /**
+   * Set the inverse mass matrix of every block.
+   *
+   * @param inv_e_metric inverse mass matrix of each block
+   * @throws std::invalid_argument if the matrices don't match the
+   *   block structure
+   */
+  void set_metric(const std::vector<Eigen::MatrixXd>& inv_e_metric) {
+    if (inv_e_metric.size() != inv_e_metric_.size())
+      throw std::invalid_argument(
+          "block_dense_e_point: wrong number of metric blocks");
+    for (size_t b = 0; b < inv_e_metric.size(); ++b)
+      if (inv_e_metric[b].rows() != block_size(b)
+          || inv_e_metric[b].cols() != block_size(b))
+        throw std::invalid_argument(
+            "block_dense_e_point: metric block has the wrong size");
+    inv_e_metric_ = inv_e_metric;
+    update_metric_factor();
+  }
+
+  /**
+   * Set the inverse mass matrix from the diagonal blocks of a dense
+   * matrix. Elements outside of the blocks are ignored.
+   *
+   * @param inv_e_metric dense inverse mass matrix
+   */
+  void set_metric(const Eigen::MatrixXd& inv_e_metric) {
+    for (int b = 0; b < num_blocks(); ++b)
+      inv_e_metric_[b] = inv_e_metric.block(block_start(b), block_start(b),
+                                            block_size(b), block_size(b));
+    update_metric_factor();
+  }
+
+  /**
+   * Recompute the cached Cholesky factor of each block.
+   */
+  void update_metric_factor() {
+    inv_e_metric_llt_.resize(inv_e_metric_.size());
+    for (size_t b = 0; b < inv_e_metric_.size(); ++b)
+      inv_e_metric_llt_[b].compute(inv_e_metric_[b]);
+  }
+
+  /**
+   * Return the product of the inverse mass matrix and a vector.
+   *
+   * @param x vector
+   */
+  Eigen::VectorXd inv_metric_times(const Eigen::VectorXd& x) const {
+    Eigen::VectorXd y(x.size());
+    for (int b = 0; b < num_blocks(); ++b)
+      y.segment(block_start(b), block_size(b)).noalias()
+          = inv_e_metric_[b] * x.segment(block_start(b), block_size(b));
+    return y;
+  }
+
+  /**
+   * Return a draw with the mass matrix as covariance from a vector of
+   * independent standard normal draws.
+   *
+   * @param u standard normal draws
+   */
+  Eigen::VectorXd metric_sqrt_times(const Eigen::VectorXd& u) const {
+    Eigen::VectorXd y(u.size());
+    for (int b = 0; b < num_blocks(); ++b)
+      y.segment(block_start(b), block_size(b))
+          = inv_e_metric_llt_[b].matrixU().solve(
+              u.segment(block_start(b), block_size(b)));
+    return y;
+  }
+
+  /**
+   * Write elements of mass matrix to string and handoff to writer.
+   * Each block is written as its own rows, in order.
+   *
+   * @param writer Stan writer callback
+   */
+  inline void write_metric(stan::callbacks::writer& writer) {
+    writer("Block elements of inverse mass matrix:");
+    for (const Eigen::MatrixXd& block : inv_e_metric_) {
+      for (int i = 0; i < block.rows(); ++i) {
+        std::stringstream inv_e_metric_ss;
+        inv_e_metric_ss << block(i, 0);
+        for (int j = 1; j < block.cols(); ++j)
+          inv_e_metric_ss << ", " << block(i, j);
+        writer(inv_e_metric_ss.str());
+      }
+    }
+  }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    std::vector<int> block_sizes;
+    for (int b = 0; b < num_blocks(); ++b)
+      block_sizes.push_back(block_size(b));
+    writer.write(block_sizes);
+    for (const Eigen::MatrixXd& block : inv_e_metric_)
+      writer.write(block);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    std::vector<int> block_sizes;
+    reader.read(block_sizes);
+    set_blocks(block_sizes);
+    std::vector<Eigen::MatrixXd> inv_e_metric(block_sizes.size());
+    for (Eigen::MatrixXd& block : inv_e_metric)
+      reader.read(block);
+    set_metric(inv_e_metric);
+  }
+
+ private:
+  std::vector<int> block_starts_;
+  std::vector<Eigen::LLT<Eigen::MatrixXd>> inv_e_metric_llt_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
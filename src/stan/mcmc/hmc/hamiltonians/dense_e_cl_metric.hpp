@@ -0,0 +1,96 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_DENSE_E_CL_METRIC_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_DENSE_E_CL_METRIC_HPP
+#ifdef STAN_OPENCL
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/math/opencl/prim.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_cl_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Euclidean manifold with dense metric, applied on the OpenCL device.
+ *
+ * The product of the inverse metric with the momentum is computed on
+ * the device and cached on the host, since a leapfrog step uses it for
+ * the position update, the kinetic energy and the U-turn criterion at
+ * the same momentum. Each step copies one d-vector to the device and
+ * one back. Momenta are drawn on the host and transformed on the
+ * device.
+ */
+template <class Model, class BaseRNG>
+class dense_e_cl_metric
+    : public base_hamiltonian<Model, dense_e_cl_point, BaseRNG> {
+ public:
+  explicit dense_e_cl_metric(const Model& model)
+      : base_hamiltonian<Model, dense_e_cl_point, BaseRNG>(model),
+        cached_point_(nullptr),
+        cached_version_(0) {}
+
+  double T(dense_e_cl_point& z) { return 0.5 * z.p.dot(inv_metric_times_p(z)); }
+
+  double tau(dense_e_cl_point& z) { return T(z); }
+
+  double phi(dense_e_cl_point& z) { return this->V(z); }
+
+  double dG_dt(dense_e_cl_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(z.g);
+  }
+
+  Eigen::VectorXd dtau_dq(dense_e_cl_point& z, callbacks::logger& logger) {
+    return Eigen::VectorXd::Zero(this->model_.num_params_r());
+  }
+
+  Eigen::VectorXd dtau_dp(dense_e_cl_point& z) {
+    return inv_metric_times_p(z);
+  }
+
+  void dtau_dp_into(dense_e_cl_point& z, Eigen::VectorXd& p_sharp) {
+    p_sharp = inv_metric_times_p(z);
+  }
+
+  Eigen::VectorXd dphi_dq(dense_e_cl_point& z, callbacks::logger& logger) {
+    return z.g;
+  }
+
+  void sample_p(dense_e_cl_point& z, BaseRNG& rng) {
+    u_.resize(z.p.size());
+    fill_std_normal(u_, rng);
+
+    stan::math::matrix_cl<double> p_cl
+        = z.metric_factor_cl() * stan::math::to_matrix_cl(u_);
+    z.p = stan::math::from_matrix_cl(p_cl);
+  }
+
+ private:
+  // Standard normal draws of sample_p(), kept across transitions
+  Eigen::VectorXd u_;
+  // Momentum, point and metric of the cached product
+  Eigen::VectorXd cached_p_;
+  const dense_e_cl_point* cached_point_;
+  unsigned long cached_version_;
+  Eigen::VectorXd p_sharp_;
+
+  const Eigen::VectorXd& inv_metric_times_p(const dense_e_cl_point& z) {
+    if (cached_point_ != &z || cached_version_ != z.metric_version()
+        || cached_p_.size() != z.p.size() || cached_p_ != z.p) {
+      stan::math::matrix_cl<double> p_sharp_cl
+          = z.inv_e_metric_cl() * stan::math::to_matrix_cl(z.p);
+      p_sharp_ = stan::math::from_matrix_cl(p_sharp_cl);
+      cached_p_ = z.p;
+      cached_point_ = &z;
+      cached_version_ = z.metric_version();
+    }
+    return p_sharp_;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
+#endif
@@ -0,0 +1,157 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_DENSE_E_CL_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_DENSE_E_CL_POINT_HPP
+#ifdef STAN_OPENCL
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/math/opencl/prim.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <sstream>
+#include <stdexcept>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Euclidean manifold with dense
+ * metric, whose inverse mass matrix and the factor momenta are drawn
+ * with are kept on the OpenCL device.
+ *
+ * Only the d-vectors of each leapfrog step cross the bus; the d x d
+ * matrices are copied to the device when the metric changes, and the
+ * Cholesky factorization and its inverse are computed there.
+ */
+class dense_e_cl_point : public ps_point {
+ public:
+  /**
+   * Inverse mass matrix on the host. After modifying it in place,
+   * update_metric_factor() must be called to copy it to the device.
+   */
+  Eigen::MatrixXd inv_e_metric_;
+
+  /**
+   * Construct a dense point in n-dimensional phase space
+   * with identity matrix as inverse mass matrix.
+   *
+   * @param n number of dimensions
+   */
+  explicit dense_e_cl_point(int n)
+      : ps_point(n),
+        inv_e_metric_(Eigen::MatrixXd::Identity(n, n)),
+        inv_e_metric_cl_(stan::math::to_matrix_cl(inv_e_metric_)),
+        metric_factor_cl_(stan::math::to_matrix_cl(inv_e_metric_)),
+        metric_version_(0) {}
+
+  /**
+   * Set elements of mass matrix
+   *
+   * @param inv_e_metric initial mass matrix
+   * @throws std::domain_error if it isn't positive definite
+   */
+  void set_metric(const Eigen::MatrixXd& inv_e_metric) {
+    inv_e_metric_ = inv_e_metric;
+    factor_on_device();
+  }
+
+  /**
+   * Set the inverse mass matrix from its lower Cholesky factor. The
+   * product is computed on the device and copied back to the host. The
+   * strictly upper triangle is ignored.
+   *
+   * @param factor lower Cholesky factor of the inverse mass matrix
+   */
+  void set_metric_factor(const Eigen::MatrixXd& factor) {
+    stan::math::matrix_cl<double> factor_cl(factor,
+                                            stan::math::matrix_cl_view::Lower);
+    inv_e_metric_cl_ = factor_cl * stan::math::transpose(factor_cl);
+    inv_e_metric_ = stan::math::from_matrix_cl(inv_e_metric_cl_);
+    metric_factor_cl_ = stan::math::transpose(
+        stan::math::tri_inverse<stan::math::matrix_cl_view::Lower>(factor_cl));
+    ++metric_version_;
+  }
+
+  /**
+   * Copy the inverse mass matrix to the device and recompute the factor
+   * momenta are drawn with there.
+   *
+   * @return false if the inverse mass matrix isn't positive definite
+   */
+  bool update_metric_factor() {
+    try {
+      factor_on_device();
+    } catch (const std::domain_error& e) {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Return the inverse mass matrix on the device.
+   */
+  const stan::math::matrix_cl<double>& inv_e_metric_cl() const {
+    return inv_e_metric_cl_;
+  }
+
+  /**
+   * Return the upper triangular factor U of the mass matrix,
+   * <code>M = U U^T</code>, on the device, which is the transposed
+   * inverse of the lower Cholesky factor of the inverse mass matrix.
+   */
+  const stan::math::matrix_cl<double>& metric_factor_cl() const {
+    return metric_factor_cl_;
+  }
+
+  /**
+   * Return a count that changes every time the metric does, so that
+   * products with the metric can be cached.
+   */
+  unsigned long metric_version() const { return metric_version_; }
+
+  /**
+   * Write elements of mass matrix to string and handoff to writer.
+   *
+   * @param writer Stan writer callback
+   */
+  inline void write_metric(stan::callbacks::writer& writer) {
+    writer("Elements of inverse mass matrix:");
+    for (int i = 0; i < inv_e_metric_.rows(); ++i) {
+      std::stringstream inv_e_metric_ss;
+      inv_e_metric_ss << inv_e_metric_(i, 0);
+      for (int j = 1; j < inv_e_metric_.cols(); ++j)
+        inv_e_metric_ss << ", " << inv_e_metric_(i, j);
+      writer(inv_e_metric_ss.str());
+    }
+  }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    writer.write(inv_e_metric_);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    reader.read(inv_e_metric_);
+    if (inv_e_metric_.rows() != q.size() || inv_e_metric_.cols() != q.size())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+    update_metric_factor();
+  }
+
+ private:
+  stan::math::matrix_cl<double> inv_e_metric_cl_;
+  stan::math::matrix_cl<double> metric_factor_cl_;
+  unsigned long metric_version_;
+
+  void factor_on_device() {
+    ++metric_version_;
+    inv_e_metric_cl_ = stan::math::to_matrix_cl(inv_e_metric_);
+    stan::math::matrix_cl<double> factor_cl
+        = stan::math::cholesky_decompose(inv_e_metric_cl_);
+    metric_factor_cl_ = stan::math::transpose(
+        stan::math::tri_inverse<stan::math::matrix_cl_view::Lower>(factor_cl));
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
+#endif
@@ -5,8 +5,7 @@
 #include <stan/math/prim.hpp>
 #include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
 #include <stan/mcmc/hmc/hamiltonians/dense_e_point.hpp>
-#include <boost/random/variate_generator.hpp>
-#include <boost/random/normal_distribution.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
 
 namespace stan {
 namespace mcmc {
@@ -36,22 +35,27 @@ class dense_e_metric : public base_hamiltonian<Model, dense_e_point, BaseRNG> {
 
   Eigen::VectorXd dtau_dp(dense_e_point& z) { return z.inv_e_metric_ * z.p; }
 
+  void dtau_dp_into(dense_e_point& z, Eigen::VectorXd& p_sharp) {
+    p_sharp.resize(z.p.size());
+    p_sharp.noalias() = z.inv_e_metric_ * z.p;
+  }
+
   Eigen::VectorXd dphi_dq(dense_e_point& z, callbacks::logger& logger) {
     return z.g;
   }
 
   void sample_p(dense_e_point& z, BaseRNG& rng) {
-    typedef typename stan::math::index_type<Eigen::VectorXd>::type idx_t;
-    boost::variate_generator<BaseRNG&, boost::normal_distribution<> >
-        rand_dense_gaus(rng, boost::normal_distribution<>());
-
-    Eigen::VectorXd u(z.p.size());
+    u_.resize(z.p.size());
+    fill_std_normal(u_, rng);
 
-    for (idx_t i = 0; i < u.size(); ++i)
-      u(i) = rand_dense_gaus();
-
-    z.p = z.inv_e_metric_.llt().matrixU().solve(u);
+    z.p = u_;
+    z.inv_e_metric_factor().transpose().triangularView<Eigen::Upper>()
+        .solveInPlace(z.p);
   }
+
+ private:
+  // Standard normal draws of sample_p(), kept across transitions
+  Eigen::VectorXd u_;
 };
 
 }  // namespace mcmc
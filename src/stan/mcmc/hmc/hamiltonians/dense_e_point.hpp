@@ -13,7 +13,8 @@ namespace mcmc {
 class dense_e_point : public ps_point {
  public:
   /**
-   * Inverse mass matrix.
+   * Inverse mass matrix. After modifying it in place,
+   * update_metric_factor() must be called.
    */
   Eigen::MatrixXd inv_e_metric_;
 
@@ -25,6 +26,7 @@ class dense_e_point : public ps_point {
    */
   explicit dense_e_point(int n) : ps_point(n), inv_e_metric_(n, n) {
     inv_e_metric_.setIdentity();
+    update_metric_factor();
   }
 
   /**
@@ -34,6 +36,42 @@ class dense_e_point : public ps_point {
    */
   void set_metric(const Eigen::MatrixXd& inv_e_metric) {
     inv_e_metric_ = inv_e_metric;
+    update_metric_factor();
+  }
+
+  /**
+   * Set the inverse mass matrix from its lower Cholesky factor, which
+   * is cached as is, so a metric that was factored ahead of time isn't
+   * factored again. The strictly upper triangle is ignored.
+   *
+   * @param factor lower Cholesky factor of the inverse mass matrix
+   */
+  void set_metric_factor(const Eigen::MatrixXd& factor) {
+    inv_e_metric_factor_ = factor.triangularView<Eigen::Lower>();
+    inv_e_metric_.noalias()
+        = inv_e_metric_factor_.triangularView<Eigen::Lower>()
+          * inv_e_metric_factor_.transpose();
+  }
+
+  /**
+   * Recompute the cached Cholesky factor of the inverse mass matrix.
+   * The factor is used to draw momenta, so it only changes when the
+   * metric does rather than once per transition.
+   *
+   * @return false if the inverse mass matrix isn't positive definite
+   */
+  bool update_metric_factor() {
+    Eigen::LLT<Eigen::MatrixXd> llt(inv_e_metric_);
+    inv_e_metric_factor_ = llt.matrixL();
+    return llt.info() == Eigen::Success;
+  }
+
+  /**
+   * Return the cached lower Cholesky factor of the inverse mass matrix,
+   * with zeros above the diagonal.
+   */
+  const Eigen::MatrixXd& inv_e_metric_factor() const {
+    return inv_e_metric_factor_;
   }
 
   /**
@@ -51,6 +89,22 @@ class dense_e_point : public ps_point {
       writer(inv_e_metric_ss.str());
     }
   }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    writer.write(inv_e_metric_);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    reader.read(inv_e_metric_);
+    if (inv_e_metric_.rows() != q.size() || inv_e_metric_.cols() != q.size())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+    update_metric_factor();
+  }
+
+ private:
+  Eigen::MatrixXd inv_e_metric_factor_;
 };
 
 }  // namespace mcmc
@@ -4,8 +4,7 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
 #include <stan/mcmc/hmc/hamiltonians/diag_e_point.hpp>
-#include <boost/random/variate_generator.hpp>
-#include <boost/random/normal_distribution.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
 
 namespace stan {
 namespace mcmc {
@@ -37,16 +36,17 @@ class diag_e_metric : public base_hamiltonian<Model, diag_e_point, BaseRNG> {
     return z.inv_e_metric_.cwiseProduct(z.p);
   }
 
+  void dtau_dp_into(diag_e_point& z, Eigen::VectorXd& p_sharp) {
+    p_sharp = z.inv_e_metric_.cwiseProduct(z.p);
+  }
+
   Eigen::VectorXd dphi_dq(diag_e_point& z, callbacks::logger& logger) {
     return z.g;
   }
 
   void sample_p(diag_e_point& z, BaseRNG& rng) {
-    boost::variate_generator<BaseRNG&, boost::normal_distribution<> >
-        rand_diag_gaus(rng, boost::normal_distribution<>());
-
-    for (int i = 0; i < z.p.size(); ++i)
-      z.p(i) = rand_diag_gaus() / sqrt(z.inv_e_metric_(i));
+    fill_std_normal(z.p, rng);
+    z.p.array() /= z.inv_e_metric_.array().sqrt();
   }
 };
 
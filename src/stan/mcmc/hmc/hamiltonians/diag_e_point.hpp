@@ -49,6 +49,18 @@ class diag_e_point : public ps_point {
       inv_e_metric_ss << ", " << inv_e_metric_(i);
     writer(inv_e_metric_ss.str());
   }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    writer.write(inv_e_metric_);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    reader.read(inv_e_metric_);
+    if (inv_e_metric_.size() != q.size())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+  }
 };
 
 }  // namespace mcmc
@@ -0,0 +1,223 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_DIAG_SOFTABS_METRIC_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_DIAG_SOFTABS_METRIC_HPP
+
+#include <stan/math/mix.hpp>
+#include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_softabs_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+#include <stan/mcmc/hmc/hamiltonians/softabs_metric.hpp>
+#include <cmath>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Riemannian manifold with a diagonal SoftAbs metric, whose elements
+ * are the SoftAbs transforms of a Hutchinson estimate of the diagonal
+ * of the Hessian of the potential from <code>z.num_probes()</code>
+ * fixed probes, see <code>diag_softabs_point</code>. The transform
+ * keeps every element positive and at least <code>1 / alpha</code>, so
+ * the metric fixes the local scales of a funnel without the dense
+ * Hessian and eigendecomposition of <code>softabs_metric</code>.
+ *
+ * The metric is a function of the position through the estimate, which
+ * is the diagonal of <code>(1 / k) sum_j diag(z_j) H z_j^T</code>, so
+ * the gradient of any weighted sum of its elements is the gradient of
+ * a trace of the Hessian against k outer products. Updating the metric
+ * costs one gradient and k Hessian-vector products, and each of
+ * <code>dtau_dq()</code> and <code>dphi_dq()</code> costs k directional
+ * third derivatives.
+ */
+template <class Model, class BaseRNG>
+class diag_softabs_metric
+    : public base_hamiltonian<Model, diag_softabs_point, BaseRNG> {
+ private:
+  typedef typename stan::math::index_type<Eigen::VectorXd>::type idx_t;
+
+ public:
+  explicit diag_softabs_metric(const Model& model)
+      : base_hamiltonian<Model, diag_softabs_point, BaseRNG>(model) {}
+
+  static constexpr bool riemannian = true;
+
+  double T(diag_softabs_point& z) {
+    return this->tau(z) + 0.5 * z.log_det_metric;
+  }
+
+  double tau(diag_softabs_point& z) {
+    return 0.5 * z.p.dot(z.softabs_diag_inv.cwiseProduct(z.p));
+  }
+
+  double phi(diag_softabs_point& z) {
+    return this->V(z) + 0.5 * z.log_det_metric;
+  }
+
+  double dG_dt(diag_softabs_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq(z, logger));
+  }
+
+  double dG_dt_given_dphi_dq(diag_softabs_point& z,
+                             const Eigen::VectorXd& dphi_dq,
+                             callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq);
+  }
+
+  Eigen::VectorXd dtau_dq(diag_softabs_point& z, callbacks::logger& logger) {
+    Eigen::VectorXd a = z.softabs_diag_inv.cwiseProduct(z.p);
+    return grad_weighted_diag(
+        z, -0.5 * a.cwiseProduct(a).cwiseProduct(z.softabs_diag_derivative));
+  }
+
+  Eigen::VectorXd dtau_dp(diag_softabs_point& z) {
+    return z.softabs_diag_inv.cwiseProduct(z.p);
+  }
+
+  Eigen::VectorXd dphi_dq(diag_softabs_point& z, callbacks::logger& logger) {
+    return grad_weighted_diag(
+               z, 0.5
+                      * z.softabs_diag_inv.cwiseProduct(
+                          z.softabs_diag_derivative))
+           + z.g;
+  }
+
+  void sample_p(diag_softabs_point& z, BaseRNG& rng) {
+    Eigen::VectorXd a(z.p.size());
+    fill_std_normal(a, rng);
+
+    z.p = z.softabs_diag.cwiseSqrt().cwiseProduct(a);
+  }
+
+  void init(diag_softabs_point& z, callbacks::logger& logger) {
+    update_metric(z, logger);
+    update_metric_gradient(z, logger);
+  }
+
+  void update_metric(diag_softabs_point& z, callbacks::logger& logger) {
+    ++this->num_grad_evals_;
+    stan::math::gradient(softabs_fun<Model>(this->model_, 0), z.q, z.V, z.g);
+    z.V = -z.V;
+    z.g = -z.g;
+
+    // Hutchinson estimate of the diagonal of the Hessian of the potential
+    idx_t n = z.q.size();
+    idx_t k = z.probes.cols();
+    z.hessian_diag.setZero(n);
+    Eigen::VectorXd v(n);
+    Eigen::VectorXd hv(n);
+    for (idx_t j = 0; j < k; ++j) {
+      double log_prob;
+      v = z.probes.col(j);
+      ++this->num_grad_evals_;
+      stan::math::hessian_times_vector(softabs_fun<Model>(this->model_, 0),
+                                       z.q, v, log_prob, hv);
+      z.hessian_diag -= v.cwiseProduct(hv);
+    }
+    z.hessian_diag /= k;
+
+    z.softabs_diag.resize(n);
+    z.softabs_diag_inv.resize(n);
+    z.log_det_metric = 0;
+    for (idx_t i = 0; i < n; ++i) {
+      z.softabs_diag(i) = softabs(z.hessian_diag(i), z.alpha);
+      z.softabs_diag_inv(i) = 1.0 / z.softabs_diag(i);
+      z.log_det_metric += std::log(z.softabs_diag(i));
+    }
+  }
+
+  void update_metric_gradient(diag_softabs_point& z,
+                              callbacks::logger& logger) {
+    idx_t n = z.q.size();
+    z.softabs_diag_derivative.resize(n);
+    for (idx_t i = 0; i < n; ++i)
+      z.softabs_diag_derivative(i)
+          = softabs_derivative(z.hessian_diag(i), z.alpha);
+  }
+
+  void update_gradients(diag_softabs_point& z, callbacks::logger& logger) {
+    update_metric_gradient(z, logger);
+  }
+
+  // Threshold below which a power series
+  // approximation of the softabs function is used
+  static double lower_softabs_thresh;
+
+  // Threshold above which an asymptotic
+  // approximation of the softabs function is used
+  static double upper_softabs_thresh;
+
+ private:
+  static double softabs(double lambda, double alpha) {
+    double alpha_lambda = alpha * lambda;
+    // Thresholds defined such that the approximation
+    // error is on the same order of double precision
+    if (std::fabs(alpha_lambda) < lower_softabs_thresh)
+      return (1.0 + (1.0 / 3.0) * alpha_lambda * alpha_lambda) / alpha;
+    if (std::fabs(alpha_lambda) > upper_softabs_thresh)
+      return std::fabs(lambda);
+    return lambda / std::tanh(alpha_lambda);
+  }
+
+  static double softabs_derivative(double lambda, double alpha) {
+    double alpha_lambda = alpha * lambda;
+    if (std::fabs(alpha_lambda) < lower_softabs_thresh)
+      return (2.0 / 3.0) * alpha_lambda
+             * (1.0 - (2.0 / 15.0) * alpha_lambda * alpha_lambda);
+    if (std::fabs(alpha_lambda) > upper_softabs_thresh)
+      return lambda > 0 ? 1 : -1;
+    double sdx = std::sinh(alpha_lambda) / lambda;
+    return (softabs(lambda, alpha) - alpha / (sdx * sdx)) / lambda;
+  }
+
+  /**
+   * Return the gradient with respect to the position of
+   * <code>sum_i w_i d_i</code>, where d is the estimate of the diagonal
+   * of the Hessian of the potential. It is minus the gradient of
+   * <code>(1 / k) sum_j (w .* z_j)^T H z_j</code> for the Hessian H of
+   * the log density, with one forward-over-reverse pass per probe.
+   */
+  Eigen::VectorXd grad_weighted_diag(diag_softabs_point& z,
+                                     const Eigen::VectorXd& w) {
+    using stan::math::fvar;
+    using stan::math::var;
+
+    this->num_grad_evals_ += z.probes.cols();
+
+    // Run nested autodiff in this scope
+    stan::math::nested_rev_autodiff nested;
+
+    const Eigen::VectorXd& q = z.q;
+    Eigen::Matrix<var, Eigen::Dynamic, 1> q_var(q.size());
+    for (idx_t i = 0; i < q.size(); ++i)
+      q_var(i) = q(i);
+
+    Eigen::Matrix<fvar<var>, Eigen::Dynamic, 1> q_fvar(q.size());
+    Eigen::VectorXd right_j(q.size());
+    var sum(0.0);
+    for (idx_t j = 0; j < z.probes.cols(); ++j) {
+      for (idx_t i = 0; i < q.size(); ++i)
+        q_fvar(i) = fvar<var>(q_var(i), z.probes(i, j));
+      right_j = w.cwiseProduct(z.probes.col(j));
+      fvar<var> fx;
+      fvar<var> grad_fx_dot_v;
+      stan::math::gradient_dot_vector<fvar<var>, double>(
+          softabs_fun<Model>(this->model_, 0), q_fvar, right_j, fx,
+          grad_fx_dot_v);
+      sum += grad_fx_dot_v.d_;
+    }
+
+    stan::math::grad(sum.vi_);
+    Eigen::VectorXd grad(q.size());
+    for (idx_t i = 0; i < q.size(); ++i)
+      grad(i) = -q_var(i).adj() / z.probes.cols();
+    return grad;
+  }
+};
+
+template <class Model, class BaseRNG>
+double diag_softabs_metric<Model, BaseRNG>::lower_softabs_thresh = 1e-4;
+
+template <class Model, class BaseRNG>
+double diag_softabs_metric<Model, BaseRNG>::upper_softabs_thresh = 18;
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,90 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_DIAG_SOFTABS_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_DIAG_SOFTABS_POINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/bernoulli_distribution.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Riemannian manifold with a
+ * diagonal SoftAbs metric, the SoftAbs transform of a Hutchinson
+ * estimate of the diagonal of the Hessian,
+ *
+ * <pre>
+ * diag(H) ~ (1 / k) sum_j z_j .* (H z_j),
+ * </pre>
+ *
+ * with k fixed Rademacher probes z_j. The probes are drawn from a fixed
+ * seed, so that the metric is a deterministic function of the
+ * position. With at least as many probes as dimensions they are the
+ * unit vectors, scaled by the square root of the dimension to keep the
+ * weight of the estimator, and the diagonal is exact.
+ */
+class diag_softabs_point : public ps_point {
+ public:
+  explicit diag_softabs_point(int n)
+      : ps_point(n),
+        alpha(1.0),
+        hessian_diag(Eigen::VectorXd::Zero(n)),
+        log_det_metric(0),
+        softabs_diag(Eigen::VectorXd::Ones(n)),
+        softabs_diag_inv(Eigen::VectorXd::Ones(n)),
+        softabs_diag_derivative(Eigen::VectorXd::Zero(n)) {
+    set_num_probes(std::min(n, 4));
+  }
+
+  // SoftAbs regularization parameter
+  double alpha;
+
+  // Rademacher probes of the Hutchinson estimator, one per column
+  Eigen::MatrixXd probes;
+
+  // Estimate of the diagonal of the Hessian of the potential
+  Eigen::VectorXd hessian_diag;
+
+  // Log determinant of metric
+  double log_det_metric;
+
+  // SoftAbs transformed diagonal, its inverse and its derivative
+  Eigen::VectorXd softabs_diag;
+  Eigen::VectorXd softabs_diag_inv;
+  Eigen::VectorXd softabs_diag_derivative;
+
+  /**
+   * Set the number of probes and draw them. The metric has to be
+   * updated afterwards.
+   *
+   * @param k number of probes, which is at least one
+   */
+  void set_num_probes(int k) {
+    const int n = q.size();
+    k = std::max(k, 1);
+    if (k >= n) {
+      probes = std::sqrt(static_cast<double>(n))
+               * Eigen::MatrixXd::Identity(n, n);
+      return;
+    }
+    boost::ecuyer1988 rng(0);
+    boost::random::bernoulli_distribution<> coin;
+    probes.resize(n, k);
+    for (int j = 0; j < k; ++j)
+      for (int i = 0; i < n; ++i)
+        probes(i, j) = coin(rng) ? 1 : -1;
+  }
+
+  int num_probes() const { return probes.cols(); }
+
+  virtual inline void write_metric(stan::callbacks::writer& writer) {
+    writer("No free parameters for diagonal SoftAbs metric");
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
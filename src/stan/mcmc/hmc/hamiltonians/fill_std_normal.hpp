@@ -0,0 +1,62 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_FILL_STD_NORMAL_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_FILL_STD_NORMAL_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/util/philox4x32.hpp>
+#include <boost/random/normal_distribution.hpp>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Fill a vector with independent standard normal draws, as the
+ * metrics do to resample the momentum.
+ *
+ * The draws are those of boost::normal_distribution called once per
+ * element, so a given generator state gives the same momentum as
+ * drawing the elements one at a time.
+ *
+ * @tparam BaseRNG type of random number generator
+ * @param[out] x vector to fill
+ * @param[in,out] rng random number generator
+ */
+template <class BaseRNG>
+void fill_std_normal(Eigen::VectorXd& x, BaseRNG& rng) {
+  boost::random::normal_distribution<> normal;
+  for (Eigen::Index i = 0; i < x.size(); ++i)
+    x(i) = normal(rng);
+}
+
+/**
+ * Fill a vector with independent standard normal draws from a
+ * philox4x32, in bulk.
+ *
+ * The words of the generator are turned into uniforms in (0, 1) and
+ * then into pairs of normals by the Box-Muller transform, evaluated
+ * over the whole vector with Eigen's vectorized logarithm, square root,
+ * sine and cosine. The first half of the vector holds the cosine
+ * branches and the second half the sine branches. With 32-bit uniforms
+ * the draws are at most about 6.7 in absolute value.
+ *
+ * @param[out] x vector to fill
+ * @param[in,out] rng random number generator
+ */
+inline void fill_std_normal(Eigen::VectorXd& x, util::philox4x32& rng) {
+  const double to_unit = 1.0 / 4294967296.0;
+  const double two_pi = 6.283185307179586476925286766559;
+  const Eigen::Index n = x.size();
+  const Eigen::Index half = (n + 1) / 2;
+  Eigen::ArrayXd u(half);
+  Eigen::ArrayXd theta(half);
+  for (Eigen::Index i = 0; i < half; ++i) {
+    u(i) = (rng() + 0.5) * to_unit;
+    theta(i) = two_pi * ((rng() + 0.5) * to_unit);
+  }
+  Eigen::ArrayXd r = (-2.0 * u.log()).sqrt();
+  x.head(half) = (r * theta.cos()).matrix();
+  x.tail(n - half) = (r * theta.sin()).head(n - half).matrix();
+}
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
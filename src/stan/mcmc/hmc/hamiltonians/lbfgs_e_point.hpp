@@ -0,0 +1,233 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_LBFGS_E_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_LBFGS_E_POINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Euclidean manifold whose inverse
+ * metric is the L-BFGS approximation of the inverse Hessian of the
+ * negative log density, as left by an optimization run. The inverse
+ * metric is never formed: it is the two-loop recursion over the update
+ * pairs (s, y) starting from the diagonal
+ * <code>inv_e_metric_</code>, which costs O(n m) for n dimensions and
+ * m pairs.
+ *
+ * Dropping the pairs leaves a diagonal metric, so the windowed variance
+ * adaptation can take over once it has collected draws.
+ */
+class lbfgs_e_point : public ps_point {
+ public:
+  /**
+   * Diagonal of the initial inverse Hessian the updates are applied
+   * to. After modifying it in place, update_metric_factor() must be
+   * called.
+   */
+  Eigen::VectorXd inv_e_metric_;
+
+  /**
+   * Construct a point in n-dimensional phase space with identity
+   * matrix as inverse mass matrix.
+   *
+   * @param n number of dimensions
+   */
+  explicit lbfgs_e_point(int n)
+      : ps_point(n),
+        inv_e_metric_(Eigen::VectorXd::Ones(n)),
+        s_(n, 0),
+        y_(n, 0) {
+    update_metric_factor();
+  }
+
+  /**
+   * Set a diagonal inverse mass matrix, dropping the L-BFGS updates.
+   *
+   * @param inv_e_metric diagonal of the inverse mass matrix
+   */
+  void set_metric(const Eigen::VectorXd& inv_e_metric) {
+    inv_e_metric_ = inv_e_metric;
+    s_.resize(inv_e_metric.size(), 0);
+    y_.resize(inv_e_metric.size(), 0);
+    update_metric_factor();
+  }
+
+  /**
+   * Set the inverse mass matrix to the L-BFGS approximation of an
+   * inverse Hessian, as returned by
+   * <code>stan::optimization::LBFGSUpdate::history()</code>.
+   *
+   * @param inv_e_metric diagonal of the initial inverse Hessian, such
+   *   as the scaling <code>LBFGSUpdate::gammak()</code> in every element
+   * @param s differences between successive positions, one column per
+   *   update from oldest to newest
+   * @param y differences between successive gradients, matching the
+   *   columns of s
+   * @throws std::invalid_argument if the sizes don't match
+   * @throws std::domain_error if an update has non-positive curvature
+   *   <code>s^T y</code>, which would make the metric indefinite
+   */
+  void set_metric(const Eigen::VectorXd& inv_e_metric,
+                  const Eigen::MatrixXd& s, const Eigen::MatrixXd& y) {
+    if (s.rows() != inv_e_metric.size() || y.rows() != inv_e_metric.size()
+        || s.cols() != y.cols())
+      throw std::invalid_argument(
+          "lbfgs_e_point: L-BFGS updates don't match the metric size");
+    for (int i = 0; i < s.cols(); ++i)
+      if (!(s.col(i).dot(y.col(i)) > 0))
+        throw std::domain_error(
+            "lbfgs_e_point: L-BFGS update with non-positive curvature");
+    inv_e_metric_ = inv_e_metric;
+    s_ = s;
+    y_ = y;
+    update_metric_factor();
+  }
+
+  /**
+   * Return the number of L-BFGS updates in the metric.
+   */
+  int history_size() const { return s_.cols(); }
+
+  /**
+   * Recompute the quantities cached for drawing momenta.
+   *
+   * Scaling the updates to s' = D^(-1/2) s and y' = D^(1/2) y, with D
+   * the initial diagonal, gives the inverse metric as
+   * D^(1/2) H' D^(1/2), where H' is the L-BFGS approximation from the
+   * identity. H' is the identity outside the span of the scaled
+   * updates, so with an orthonormal basis Q of that span and the
+   * eigendecomposition Q^T H' Q = V L V^T, U = Q V gives
+   * H'^(-1/2) = I + U (L^(-1/2) - 1) U^T, from which momenta are drawn
+   * in O(n m). Setting up costs O(n m^2).
+   *
+   * @throws std::domain_error if the metric isn't positive definite
+   */
+  void update_metric_factor() {
+    inv_sqrt_diag_ = inv_e_metric_.array().rsqrt();
+    rho_.resize(s_.cols());
+    for (int i = 0; i < s_.cols(); ++i)
+      rho_(i) = 1 / s_.col(i).dot(y_.col(i));
+    if (s_.cols() == 0) {
+      basis_.resize(inv_e_metric_.size(), 0);
+      scale_.resize(0);
+      return;
+    }
+
+    int n = inv_e_metric_.size();
+    Eigen::MatrixXd w(n, 2 * s_.cols());
+    w << inv_sqrt_diag_.asDiagonal() * s_,
+        inv_e_metric_.cwiseSqrt().asDiagonal() * y_;
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(w);
+    Eigen::MatrixXd q
+        = qr.householderQ() * Eigen::MatrixXd::Identity(n, qr.rank());
+
+    Eigen::MatrixXd hq(n, q.cols());
+    for (int j = 0; j < q.cols(); ++j)
+      hq.col(j) = inv_sqrt_diag_.cwiseProduct(
+          inv_metric_times(inv_sqrt_diag_.cwiseProduct(q.col(j))));
+    Eigen::MatrixXd k = q.transpose() * hq;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(
+        0.5 * (k + k.transpose()));
+    if (!(solver.eigenvalues().minCoeff() > 0))
+      throw std::domain_error(
+          "lbfgs_e_point: L-BFGS metric isn't positive definite");
+    basis_ = q * solver.eigenvectors();
+    scale_ = solver.eigenvalues().array().rsqrt() - 1;
+  }
+
+  /**
+   * Return the product of the inverse mass matrix and a vector, by the
+   * L-BFGS two-loop recursion.
+   *
+   * @param x vector
+   */
+  Eigen::VectorXd inv_metric_times(const Eigen::VectorXd& x) const {
+    Eigen::VectorXd alpha(s_.cols());
+    Eigen::VectorXd r = x;
+    for (int i = s_.cols() - 1; i >= 0; --i) {
+      alpha(i) = rho_(i) * s_.col(i).dot(r);
+      r -= alpha(i) * y_.col(i);
+    }
+    r = inv_e_metric_.cwiseProduct(r);
+    for (int i = 0; i < s_.cols(); ++i) {
+      double beta = rho_(i) * y_.col(i).dot(r);
+      r += (alpha(i) - beta) * s_.col(i);
+    }
+    return r;
+  }
+
+  /**
+   * Return a draw with the mass matrix as covariance from a vector of
+   * independent standard normal draws.
+   *
+   * @param u standard normal draws
+   */
+  Eigen::VectorXd metric_sqrt_times(const Eigen::VectorXd& u) const {
+    Eigen::VectorXd v = u;
+    if (basis_.cols() > 0)
+      v.noalias() += basis_ * scale_.cwiseProduct(basis_.transpose() * u);
+    return inv_sqrt_diag_.cwiseProduct(v);
+  }
+
+  /**
+   * Write elements of mass matrix to string and handoff to writer.
+   * The initial diagonal is written on the first line and each update
+   * on two lines after it, s followed by y.
+   *
+   * @param writer Stan writer callback
+   */
+  inline void write_metric(stan::callbacks::writer& writer) {
+    writer(
+        "Diagonal elements of initial inverse mass matrix, followed by its"
+        " L-BFGS updates:");
+    write_vector(writer, inv_e_metric_);
+    for (int j = 0; j < s_.cols(); ++j) {
+      write_vector(writer, s_.col(j));
+      write_vector(writer, y_.col(j));
+    }
+  }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    writer.write(inv_e_metric_);
+    writer.write(s_);
+    writer.write(y_);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    reader.read(inv_e_metric_);
+    reader.read(s_);
+    reader.read(y_);
+    if (inv_e_metric_.size() != q.size() || s_.rows() != q.size()
+        || y_.rows() != q.size() || s_.cols() != y_.cols())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+    update_metric_factor();
+  }
+
+ private:
+  Eigen::MatrixXd s_;
+  Eigen::MatrixXd y_;
+  Eigen::VectorXd rho_;
+  Eigen::VectorXd inv_sqrt_diag_;
+  Eigen::MatrixXd basis_;
+  Eigen::VectorXd scale_;
+
+  static void write_vector(stan::callbacks::writer& writer,
+                           const Eigen::VectorXd& x) {
+    std::stringstream ss;
+    ss << x(0);
+    for (int i = 1; i < x.size(); ++i)
+      ss << ", " << x(i);
+    writer(ss.str());
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
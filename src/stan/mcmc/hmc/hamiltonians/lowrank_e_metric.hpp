@@ -0,0 +1,52 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_LOWRANK_E_METRIC_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_LOWRANK_E_METRIC_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/lowrank_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+
+namespace stan {
+namespace mcmc {
+
+// Euclidean manifold with diagonal plus low rank metric
+template <class Model, class BaseRNG>
+class lowrank_e_metric
+    : public base_hamiltonian<Model, lowrank_e_point, BaseRNG> {
+ public:
+  explicit lowrank_e_metric(const Model& model)
+      : base_hamiltonian<Model, lowrank_e_point, BaseRNG>(model) {}
+
+  double T(lowrank_e_point& z) { return 0.5 * z.p.dot(dtau_dp(z)); }
+
+  double tau(lowrank_e_point& z) { return T(z); }
+
+  double phi(lowrank_e_point& z) { return this->V(z); }
+
+  double dG_dt(lowrank_e_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(z.g);
+  }
+
+  Eigen::VectorXd dtau_dq(lowrank_e_point& z, callbacks::logger& logger) {
+    return Eigen::VectorXd::Zero(this->model_.num_params_r());
+  }
+
+  Eigen::VectorXd dtau_dp(lowrank_e_point& z) {
+    return z.inv_metric_times(z.p);
+  }
+
+  Eigen::VectorXd dphi_dq(lowrank_e_point& z, callbacks::logger& logger) {
+    return z.g;
+  }
+
+  void sample_p(lowrank_e_point& z, BaseRNG& rng) {
+    Eigen::VectorXd u(z.p.size());
+    fill_std_normal(u, rng);
+
+    z.p = z.metric_sqrt_times(u);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
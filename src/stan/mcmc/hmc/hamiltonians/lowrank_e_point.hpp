@@ -0,0 +1,182 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_LOWRANK_E_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_LOWRANK_E_POINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <sstream>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Euclidean manifold whose inverse
+ * metric is diagonal plus low rank,
+ *
+ * inv_metric = diag(inv_e_metric_) + lowrank_factor_ * lowrank_factor_^T,
+ *
+ * where <code>lowrank_factor_</code> has one column per direction of the
+ * low rank update. Every operation on the metric costs O(n k) for n
+ * dimensions and rank k, and the metric takes O(n k) memory.
+ */
+class lowrank_e_point : public ps_point {
+ public:
+  /**
+   * Diagonal of the inverse mass matrix.
+   */
+  Eigen::VectorXd inv_e_metric_;
+
+  /**
+   * Factor of the low rank part of the inverse mass matrix. After
+   * modifying it or the diagonal in place, update_metric_factor() must
+   * be called.
+   */
+  Eigen::MatrixXd lowrank_factor_;
+
+  /**
+   * Construct a point in n-dimensional phase space with identity
+   * matrix as inverse mass matrix.
+   *
+   * @param n number of dimensions
+   */
+  explicit lowrank_e_point(int n)
+      : ps_point(n),
+        inv_e_metric_(Eigen::VectorXd::Ones(n)),
+        lowrank_factor_(n, 0) {
+    update_metric_factor();
+  }
+
+  /**
+   * Set a diagonal inverse mass matrix, dropping the low rank part.
+   *
+   * @param inv_e_metric diagonal of the inverse mass matrix
+   */
+  void set_metric(const Eigen::VectorXd& inv_e_metric) {
+    inv_e_metric_ = inv_e_metric;
+    lowrank_factor_.resize(inv_e_metric.size(), 0);
+    update_metric_factor();
+  }
+
+  /**
+   * Set a diagonal plus low rank inverse mass matrix.
+   *
+   * @param inv_e_metric diagonal of the inverse mass matrix
+   * @param lowrank_factor factor of the low rank part, one column per
+   *   direction
+   */
+  void set_metric(const Eigen::VectorXd& inv_e_metric,
+                  const Eigen::MatrixXd& lowrank_factor) {
+    inv_e_metric_ = inv_e_metric;
+    lowrank_factor_ = lowrank_factor;
+    update_metric_factor();
+  }
+
+  /**
+   * Recompute the quantities cached for drawing momenta.
+   *
+   * Writing the inverse metric as D^(1/2) (I + V V^T) D^(1/2) with
+   * V = D^(-1/2) lowrank_factor_, the eigendecomposition
+   * V V^T = Q S Q^T gives the inverse square root
+   * (I + V V^T)^(-1/2) = I + Q ((1 + S)^(-1/2) - 1) Q^T,
+   * from which momenta are drawn in O(n k).
+   */
+  void update_metric_factor() {
+    inv_sqrt_diag_ = inv_e_metric_.array().rsqrt();
+    if (lowrank_factor_.cols() == 0) {
+      lowrank_basis_.resize(inv_e_metric_.size(), 0);
+      lowrank_scale_.resize(0);
+      return;
+    }
+    Eigen::MatrixXd v = inv_sqrt_diag_.asDiagonal() * lowrank_factor_;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(v.transpose() * v);
+    Eigen::VectorXd s = solver.eigenvalues().cwiseMax(0);
+    int rank = 0;
+    for (int i = 0; i < s.size(); ++i)
+      if (s(i) > 0)
+        ++rank;
+    lowrank_basis_.resize(v.rows(), rank);
+    lowrank_scale_.resize(rank);
+    for (int i = 0, j = 0; i < s.size(); ++i) {
+      if (!(s(i) > 0))
+        continue;
+      lowrank_basis_.col(j) = v * solver.eigenvectors().col(i) / sqrt(s(i));
+      lowrank_scale_(j) = 1 / sqrt(1 + s(i)) - 1;
+      ++j;
+    }
+  }
+
+  /**
+   * Return the product of the inverse mass matrix and a vector.
+   *
+   * @param x vector
+   */
+  Eigen::VectorXd inv_metric_times(const Eigen::VectorXd& x) const {
+    Eigen::VectorXd y = inv_e_metric_.cwiseProduct(x);
+    if (lowrank_factor_.cols() > 0)
+      y.noalias() += lowrank_factor_ * (lowrank_factor_.transpose() * x);
+    return y;
+  }
+
+  /**
+   * Return a draw with the mass matrix as covariance from a vector of
+   * independent standard normal draws.
+   *
+   * @param u standard normal draws
+   */
+  Eigen::VectorXd metric_sqrt_times(const Eigen::VectorXd& u) const {
+    Eigen::VectorXd y = u;
+    if (lowrank_basis_.cols() > 0)
+      y.noalias() += lowrank_basis_
+                     * lowrank_scale_.cwiseProduct(lowrank_basis_.transpose()
+                                                   * u);
+    return inv_sqrt_diag_.cwiseProduct(y);
+  }
+
+  /**
+   * Write elements of mass matrix to string and handoff to writer.
+   * The diagonal is written on the first line and each column of the
+   * low rank factor on its own line after it.
+   *
+   * @param writer Stan writer callback
+   */
+  inline void write_metric(stan::callbacks::writer& writer) {
+    writer(
+        "Diagonal elements of inverse mass matrix, followed by its low rank"
+        " factor:");
+    write_vector(writer, inv_e_metric_);
+    for (int j = 0; j < lowrank_factor_.cols(); ++j)
+      write_vector(writer, lowrank_factor_.col(j));
+  }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    writer.write(inv_e_metric_);
+    writer.write(lowrank_factor_);
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    reader.read(inv_e_metric_);
+    reader.read(lowrank_factor_);
+    if (inv_e_metric_.size() != q.size() || lowrank_factor_.rows() != q.size())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+    update_metric_factor();
+  }
+
+ private:
+  Eigen::VectorXd inv_sqrt_diag_;
+  Eigen::MatrixXd lowrank_basis_;
+  Eigen::VectorXd lowrank_scale_;
+
+  static void write_vector(stan::callbacks::writer& writer,
+                           const Eigen::VectorXd& x) {
+    std::stringstream ss;
+    ss << x(0);
+    for (int i = 1; i < x.size(); ++i)
+      ss << ", " << x(i);
+    writer(ss.str());
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
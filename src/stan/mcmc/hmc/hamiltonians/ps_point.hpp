@@ -3,7 +3,9 @@
 
 #include <stan/callbacks/writer.hpp>
 #include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/mcmc/sampler_state.hpp>
 #include <boost/lexical_cast.hpp>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -50,6 +52,38 @@ class ps_point {
    * @param writer writer callback
    */
   virtual inline void write_metric(stan::callbacks::writer& writer) {}
+
+  /**
+   * Write the position, momentum, gradient and potential, followed by
+   * the metric of derived points.
+   *
+   * @param writer state writer
+   */
+  virtual void write_state(state_writer& writer) const {
+    writer.tag("ps_point");
+    writer.write(q);
+    writer.write(p);
+    writer.write(g);
+    writer.write(V);
+  }
+
+  /**
+   * Read a state written by <code>write_state()</code>.
+   *
+   * @param reader state reader
+   * @throws std::invalid_argument if the state is malformed or has a
+   *   different number of dimensions
+   */
+  virtual void read_state(state_reader& reader) {
+    reader.tag("ps_point");
+    int n = q.size();
+    reader.read(q);
+    reader.read(p);
+    reader.read(g);
+    reader.read(V);
+    if (q.size() != n || p.size() != n || g.size() != n)
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+  }
 };
 
 }  // namespace mcmc
@@ -3,9 +3,8 @@
 
 #include <stan/math/mix.hpp>
 #include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
 #include <stan/mcmc/hmc/hamiltonians/softabs_point.hpp>
-#include <boost/random/variate_generator.hpp>
-#include <boost/random/normal_distribution.hpp>
 
 namespace stan {
 namespace mcmc {
@@ -35,6 +34,8 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
   explicit softabs_metric(const Model& model)
       : base_hamiltonian<Model, softabs_point, BaseRNG>(model) {}
 
+  static constexpr bool riemannian = true;
+
   double T(softabs_point& z) { return this->tau(z) + 0.5 * z.log_det_metric; }
 
   double tau(softabs_point& z) {
@@ -48,6 +49,11 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
     return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq(z, logger));
   }
 
+  double dG_dt_given_dphi_dq(softabs_point& z, const Eigen::VectorXd& dphi_dq,
+                             callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(dtau_dq(z, logger) + dphi_dq);
+  }
+
   Eigen::VectorXd dtau_dq(softabs_point& z, callbacks::logger& logger) {
     Eigen::VectorXd a = z.softabs_lambda_inv.cwiseProduct(
         z.eigen_deco.eigenvectors().transpose() * z.p);
@@ -57,6 +63,7 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
     Eigen::MatrixXd C = A.transpose() * B;
 
     Eigen::VectorXd b(z.q.size());
+    this->num_grad_evals_ += z.q.size();
     stan::math::grad_tr_mat_times_hessian(softabs_fun<Model>(this->model_, 0),
                                           z.q, C, b);
 
@@ -76,6 +83,7 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
         = a.asDiagonal() * z.eigen_deco.eigenvectors().transpose();
     Eigen::MatrixXd B = z.eigen_deco.eigenvectors() * A;
 
+    this->num_grad_evals_ += z.q.size();
     stan::math::grad_tr_mat_times_hessian(softabs_fun<Model>(this->model_, 0),
                                           z.q, B, a);
 
@@ -83,13 +91,9 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
   }
 
   void sample_p(softabs_point& z, BaseRNG& rng) {
-    boost::variate_generator<BaseRNG&, boost::normal_distribution<> >
-        rand_unit_gaus(rng, boost::normal_distribution<>());
-
     Eigen::VectorXd a(z.p.size());
-
-    for (idx_t n = 0; n < z.p.size(); ++n)
-      a(n) = sqrt(z.softabs_lambda(n)) * rand_unit_gaus();
+    fill_std_normal(a, rng);
+    a.array() *= z.softabs_lambda.array().sqrt();
 
     z.p = z.eigen_deco.eigenvectors() * a;
   }
@@ -100,6 +104,9 @@ class softabs_metric : public base_hamiltonian<Model, softabs_point, BaseRNG> {
   }
 
   void update_metric(softabs_point& z, callbacks::logger& logger) {
+    // The Hessian and the gradients of traces with it take one
+    // forward-over-reverse pass per dimension
+    this->num_grad_evals_ += z.q.size();
     math::hessian<softabs_fun<Model> >(softabs_fun<Model>(this->model_, 0), z.q,
                                        z.V, z.g, z.hessian);
     z.V = -z.V;
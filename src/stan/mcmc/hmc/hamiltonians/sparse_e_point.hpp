@@ -0,0 +1,186 @@
+#ifndef STAN_MCMC_HMC_HAMILTONIANS_SPARSE_E_POINT_HPP
+#define STAN_MCMC_HMC_HAMILTONIANS_SPARSE_E_POINT_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <Eigen/SparseCholesky>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * Point in a phase space with a base Euclidean manifold whose metric
+ * is a sparse symmetric positive definite matrix, such as the
+ * precision of a Gaussian Markov random field. Its covariance, the
+ * inverse metric, is usually dense and is never formed: the metric is
+ * factored once by a sparse Cholesky decomposition with a fill-reducing
+ * ordering, and applying the inverse metric and drawing momenta are
+ * sparse triangular solves and products that cost time proportional to
+ * the number of nonzeros of the factor. Copies of a point share the
+ * factor, which is replaced rather than modified when the metric
+ * changes.
+ *
+ * By default the metric is the identity.
+ */
+class sparse_e_point : public ps_point {
+ public:
+  /**
+   * Sparse mass matrix, which holds both triangles. After modifying
+   * it in place, update_metric_factor() must be called.
+   */
+  Eigen::SparseMatrix<double> e_metric_;
+
+  /**
+   * Construct a point in n-dimensional phase space with the identity
+   * matrix as mass matrix.
+   *
+   * @param n number of dimensions
+   */
+  explicit sparse_e_point(int n) : ps_point(n), e_metric_(n, n) {
+    e_metric_.setIdentity();
+    update_metric_factor();
+  }
+
+  /**
+   * Set the mass matrix and factor it.
+   *
+   * @param e_metric sparse symmetric mass matrix with both triangles
+   * @throws std::invalid_argument if the matrix has the wrong size or
+   *   isn't positive definite
+   */
+  void set_metric(const Eigen::SparseMatrix<double>& e_metric) {
+    if (e_metric.rows() != q.size() || e_metric.cols() != q.size())
+      throw std::invalid_argument(
+          "sparse_e_point: the metric must be square with one row per "
+          "parameter");
+    Eigen::SparseMatrix<double> previous = e_metric_;
+    e_metric_ = e_metric;
+    try {
+      update_metric_factor();
+    } catch (const std::invalid_argument& e) {
+      e_metric_ = previous;
+      throw;
+    }
+  }
+
+  /**
+   * Recompute the cached Cholesky factor of the mass matrix, with a
+   * fill-reducing ordering of its sparsity pattern.
+   *
+   * @throws std::invalid_argument if the matrix isn't positive definite,
+   *   in which case the previous factor is kept
+   */
+  void update_metric_factor() {
+    e_metric_.makeCompressed();
+    std::shared_ptr<llt_t> e_metric_llt = std::make_shared<llt_t>();
+    e_metric_llt->compute(e_metric_);
+    if (e_metric_llt->info() != Eigen::Success)
+      throw std::invalid_argument(
+          "sparse_e_point: the metric must be positive definite");
+    e_metric_llt_ = e_metric_llt;
+  }
+
+  /**
+   * Return the number of nonzeros of the Cholesky factor of the mass
+   * matrix, which the cost of applying its inverse is proportional to.
+   */
+  Eigen::Index factor_nonzeros() const {
+    return e_metric_llt_->matrixL().nestedExpression().nonZeros();
+  }
+
+  /**
+   * Return the product of the inverse mass matrix and a vector.
+   *
+   * @param x vector
+   */
+  Eigen::VectorXd inv_metric_times(const Eigen::VectorXd& x) const {
+    return e_metric_llt_->solve(x);
+  }
+
+  /**
+   * Return a draw with the mass matrix as covariance from a vector of
+   * independent standard normal draws.
+   *
+   * @param u standard normal draws
+   */
+  Eigen::VectorXd metric_sqrt_times(const Eigen::VectorXd& u) const {
+    Eigen::VectorXd y = e_metric_llt_->matrixL() * u;
+    return e_metric_llt_->permutationPinv() * y;
+  }
+
+  /**
+   * Write the nonzero elements of the lower triangle of the mass
+   * matrix, one per line as its row, column and value, and hand them
+   * off to the writer.
+   *
+   * @param writer Stan writer callback
+   */
+  inline void write_metric(stan::callbacks::writer& writer) {
+    writer("Sparse elements of mass matrix (row, column, value):");
+    for (int k = 0; k < e_metric_.outerSize(); ++k) {
+      for (Eigen::SparseMatrix<double>::InnerIterator it(e_metric_, k); it;
+           ++it) {
+        if (it.row() < it.col())
+          continue;
+        std::stringstream e_metric_ss;
+        e_metric_ss << it.row() << ", " << it.col() << ", " << it.value();
+        writer(e_metric_ss.str());
+      }
+    }
+  }
+
+  void write_state(state_writer& writer) const {
+    ps_point::write_state(writer);
+    std::vector<int> rows;
+    std::vector<int> cols;
+    std::vector<double> values;
+    for (int k = 0; k < e_metric_.outerSize(); ++k) {
+      for (Eigen::SparseMatrix<double>::InnerIterator it(e_metric_, k); it;
+           ++it) {
+        rows.push_back(it.row());
+        cols.push_back(it.col());
+        values.push_back(it.value());
+      }
+    }
+    writer.write(rows);
+    writer.write(cols);
+    writer.write(Eigen::Map<Eigen::VectorXd>(values.data(), values.size()));
+  }
+
+  void read_state(state_reader& reader) {
+    ps_point::read_state(reader);
+    std::vector<int> rows;
+    std::vector<int> cols;
+    Eigen::VectorXd values;
+    reader.read(rows);
+    reader.read(cols);
+    reader.read(values);
+    if (rows.size() != cols.size()
+        || static_cast<Eigen::Index>(rows.size()) != values.size())
+      throw std::invalid_argument("Sampler state: dimension mismatch");
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if (rows[i] < 0 || rows[i] >= q.size() || cols[i] < 0
+          || cols[i] >= q.size())
+        throw std::invalid_argument("Sampler state: dimension mismatch");
+      triplets.emplace_back(rows[i], cols[i], values(i));
+    }
+    Eigen::SparseMatrix<double> e_metric(q.size(), q.size());
+    e_metric.setFromTriplets(triplets.begin(), triplets.end());
+    set_metric(e_metric);
+  }
+
+ private:
+  typedef Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt_t;
+  std::shared_ptr<const llt_t> e_metric_llt_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+#endif
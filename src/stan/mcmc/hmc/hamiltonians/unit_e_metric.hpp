@@ -2,9 +2,8 @@
 #define STAN_MCMC_HMC_HAMILTONIANS_UNIT_E_METRIC_HPP
 
 #include <stan/mcmc/hmc/hamiltonians/base_hamiltonian.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
 #include <stan/mcmc/hmc/hamiltonians/unit_e_point.hpp>
-#include <boost/random/variate_generator.hpp>
-#include <boost/random/normal_distribution.hpp>
 
 namespace stan {
 namespace mcmc {
@@ -32,16 +31,16 @@ class unit_e_metric : public base_hamiltonian<Model, unit_e_point, BaseRNG> {
 
   Eigen::VectorXd dtau_dp(unit_e_point& z) { return z.p; }
 
+  void dtau_dp_into(unit_e_point& z, Eigen::VectorXd& p_sharp) {
+    p_sharp = z.p;
+  }
+
   Eigen::VectorXd dphi_dq(unit_e_point& z, callbacks::logger& logger) {
     return z.g;
   }
 
   void sample_p(unit_e_point& z, BaseRNG& rng) {
-    boost::variate_generator<BaseRNG&, boost::normal_distribution<> >
-        rand_unit_gaus(rng, boost::normal_distribution<>());
-
-    for (int i = 0; i < z.p.size(); ++i)
-      z.p(i) = rand_unit_gaus();
+    fill_std_normal(z.p, rng);
   }
 };
 
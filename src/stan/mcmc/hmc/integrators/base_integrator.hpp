@@ -2,6 +2,7 @@
 #define STAN_MCMC_HMC_INTEGRATORS_BASE_INTEGRATOR_HPP
 
 #include <stan/callbacks/logger.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
 
 namespace stan {
 namespace mcmc {
@@ -9,14 +10,33 @@ namespace mcmc {
 template <class Hamiltonian>
 class base_integrator {
  public:
+  /**
+   * Number of gradient evaluations of one step, hidden by the
+   * integrators that take more than one.
+   */
+  static constexpr int num_gradients = 1;
+
   base_integrator() {}
 
   virtual void evolve(typename Hamiltonian::PointType& z,
                       Hamiltonian& hamiltonian, const double epsilon,
                       callbacks::logger& logger)
       = 0;
+
+  /**
+   * Return the gradient of phi at the end point of the last call to
+   * <code>evolve()</code>, if the integrator computed it there, and
+   * a null pointer otherwise. The gradient is only valid until the
+   * point is changed.
+   *
+   * @return pointer to the gradient of phi, or a null pointer
+   */
+  const Eigen::VectorXd* last_dphi_dq() const { return nullptr; }
 };
 
+template <class Hamiltonian>
+constexpr int base_integrator<Hamiltonian>::num_gradients;
+
 }  // namespace mcmc
 }  // namespace stan
 #endif
@@ -3,6 +3,9 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/mcmc/hmc/integrators/base_leapfrog.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/unit_e_metric.hpp>
 #include <stan/math/prim/fun/Eigen.hpp>
 
 namespace stan {
@@ -32,6 +35,126 @@ class expl_leapfrog : public base_leapfrog<Hamiltonian> {
   }
 };
 
+/**
+ * Leapfrog for the diagonal Euclidean metric. The momentum and
+ * position updates are applied to the point in place rather than
+ * through the virtual <code>dphi_dq</code> and <code>dtau_dp</code>,
+ * which return a new vector on every call. The arithmetic is the same,
+ * so trajectories match the generic integrator exactly.
+ */
+template <class Model, class BaseRNG>
+class expl_leapfrog<diag_e_metric<Model, BaseRNG> >
+    : public base_leapfrog<diag_e_metric<Model, BaseRNG> > {
+ public:
+  typedef diag_e_metric<Model, BaseRNG> hamiltonian_t;
+
+  expl_leapfrog() : base_leapfrog<hamiltonian_t>() {}
+
+  void evolve(diag_e_point& z, hamiltonian_t& hamiltonian,
+              const double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+    z.q.noalias() += epsilon * z.inv_e_metric_.cwiseProduct(z.p);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+  }
+
+  void begin_update_p(diag_e_point& z, hamiltonian_t& hamiltonian,
+                      double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+
+  void update_q(diag_e_point& z, hamiltonian_t& hamiltonian, double epsilon,
+                callbacks::logger& logger) {
+    z.q.noalias() += epsilon * z.inv_e_metric_.cwiseProduct(z.p);
+    hamiltonian.update_potential_gradient(z, logger);
+  }
+
+  void end_update_p(diag_e_point& z, hamiltonian_t& hamiltonian,
+                    double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+};
+
+/**
+ * Leapfrog for the unit Euclidean metric, updating the point in place
+ * as for the diagonal metric.
+ */
+template <class Model, class BaseRNG>
+class expl_leapfrog<unit_e_metric<Model, BaseRNG> >
+    : public base_leapfrog<unit_e_metric<Model, BaseRNG> > {
+ public:
+  typedef unit_e_metric<Model, BaseRNG> hamiltonian_t;
+
+  expl_leapfrog() : base_leapfrog<hamiltonian_t>() {}
+
+  void evolve(unit_e_point& z, hamiltonian_t& hamiltonian,
+              const double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+    z.q.noalias() += epsilon * z.p;
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+  }
+
+  void begin_update_p(unit_e_point& z, hamiltonian_t& hamiltonian,
+                      double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+
+  void update_q(unit_e_point& z, hamiltonian_t& hamiltonian, double epsilon,
+                callbacks::logger& logger) {
+    z.q.noalias() += epsilon * z.p;
+    hamiltonian.update_potential_gradient(z, logger);
+  }
+
+  void end_update_p(unit_e_point& z, hamiltonian_t& hamiltonian,
+                    double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+};
+
+/**
+ * Leapfrog for the dense Euclidean metric, updating the point in place
+ * as for the diagonal metric. The sharp momentum is written into a
+ * vector the integrator keeps, so a step allocates nothing.
+ */
+template <class Model, class BaseRNG>
+class expl_leapfrog<dense_e_metric<Model, BaseRNG> >
+    : public base_leapfrog<dense_e_metric<Model, BaseRNG> > {
+ public:
+  typedef dense_e_metric<Model, BaseRNG> hamiltonian_t;
+
+  expl_leapfrog() : base_leapfrog<hamiltonian_t>() {}
+
+  void evolve(dense_e_point& z, hamiltonian_t& hamiltonian,
+              const double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+    hamiltonian.dtau_dp_into(z, p_sharp_);
+    z.q.noalias() += epsilon * p_sharp_;
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p.noalias() -= (0.5 * epsilon) * z.g;
+  }
+
+  void begin_update_p(dense_e_point& z, hamiltonian_t& hamiltonian,
+                      double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+
+  void update_q(dense_e_point& z, hamiltonian_t& hamiltonian, double epsilon,
+                callbacks::logger& logger) {
+    hamiltonian.dtau_dp_into(z, p_sharp_);
+    z.q.noalias() += epsilon * p_sharp_;
+    hamiltonian.update_potential_gradient(z, logger);
+  }
+
+  void end_update_p(dense_e_point& z, hamiltonian_t& hamiltonian,
+                    double epsilon, callbacks::logger& logger) {
+    z.p.noalias() -= epsilon * z.g;
+  }
+
+ private:
+  Eigen::VectorXd p_sharp_;
+};
+
 }  // namespace mcmc
 }  // namespace stan
 #endif
@@ -0,0 +1,62 @@
+#ifndef STAN_MCMC_HMC_INTEGRATORS_EXPL_THREE_STAGE_HPP
+#define STAN_MCMC_HMC_INTEGRATORS_EXPL_THREE_STAGE_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/integrators/base_integrator.hpp>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Three-stage splitting integrator for separable Hamiltonians,
+ *
+ * <pre>
+ * exp(b e B) exp(a e A) exp((1/2 - b) e B) exp((1 - 2 a) e A)
+ *   exp((1/2 - b) e B) exp(a e A) exp(b e B),
+ * </pre>
+ *
+ * where <code>B</code> updates the momentum with the gradient of the
+ * potential and <code>A</code> the position, with the coefficients of
+ * Blanes, Casas and Sanz-Serna (2014) minimizing the energy error on
+ * Gaussian targets. A step takes three gradient evaluations and allows
+ * a step size more than three times as large as leapfrog for the same
+ * energy error.
+ *
+ * The step size seen by the sampler is that of a whole three-stage step.
+ */
+template <class Hamiltonian>
+class expl_three_stage : public base_integrator<Hamiltonian> {
+ public:
+  static constexpr double a = 0.29619504261126;
+  static constexpr double b = 0.11888010966548;
+  static constexpr int num_gradients = 3;
+
+  expl_three_stage() : base_integrator<Hamiltonian>() {}
+
+  void evolve(typename Hamiltonian::PointType& z, Hamiltonian& hamiltonian,
+              const double epsilon, callbacks::logger& logger) {
+    z.p -= (b * epsilon) * hamiltonian.dphi_dq(z, logger);
+    z.q += (a * epsilon) * hamiltonian.dtau_dp(z);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p -= ((0.5 - b) * epsilon) * hamiltonian.dphi_dq(z, logger);
+    z.q += ((1 - 2 * a) * epsilon) * hamiltonian.dtau_dp(z);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p -= ((0.5 - b) * epsilon) * hamiltonian.dphi_dq(z, logger);
+    z.q += (a * epsilon) * hamiltonian.dtau_dp(z);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p -= (b * epsilon) * hamiltonian.dphi_dq(z, logger);
+  }
+};
+
+template <class Hamiltonian>
+constexpr double expl_three_stage<Hamiltonian>::a;
+
+template <class Hamiltonian>
+constexpr double expl_three_stage<Hamiltonian>::b;
+
+template <class Hamiltonian>
+constexpr int expl_three_stage<Hamiltonian>::num_gradients;
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
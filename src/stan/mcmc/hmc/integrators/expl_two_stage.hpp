@@ -0,0 +1,56 @@
+#ifndef STAN_MCMC_HMC_INTEGRATORS_EXPL_TWO_STAGE_HPP
+#define STAN_MCMC_HMC_INTEGRATORS_EXPL_TWO_STAGE_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/integrators/base_integrator.hpp>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Two-stage splitting integrator for separable Hamiltonians,
+ *
+ * <pre>
+ * exp(b e B) exp(e/2 A) exp((1 - 2 b) e B) exp(e/2 A) exp(b e B),
+ * </pre>
+ *
+ * where <code>B</code> updates the momentum with the gradient of the
+ * potential and <code>A</code> the position. With
+ * <code>b = 0.211781</code>, the value of Blanes, Casas and Sanz-Serna
+ * (2014), the energy error on Gaussian targets is minimal over the
+ * step sizes HMC uses. A step takes two gradient evaluations, as the
+ * last one is reused by the next step, and allows a step size more
+ * than twice as large as leapfrog for the same energy error, so fewer
+ * gradients are needed per effective sample on high-dimensional
+ * targets.
+ *
+ * The step size seen by the sampler is that of a whole two-stage step.
+ */
+template <class Hamiltonian>
+class expl_two_stage : public base_integrator<Hamiltonian> {
+ public:
+  static constexpr double b = 0.211781;
+  static constexpr int num_gradients = 2;
+
+  expl_two_stage() : base_integrator<Hamiltonian>() {}
+
+  void evolve(typename Hamiltonian::PointType& z, Hamiltonian& hamiltonian,
+              const double epsilon, callbacks::logger& logger) {
+    z.p -= (b * epsilon) * hamiltonian.dphi_dq(z, logger);
+    z.q += (0.5 * epsilon) * hamiltonian.dtau_dp(z);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p -= ((1 - 2 * b) * epsilon) * hamiltonian.dphi_dq(z, logger);
+    z.q += (0.5 * epsilon) * hamiltonian.dtau_dp(z);
+    hamiltonian.update_potential_gradient(z, logger);
+    z.p -= (b * epsilon) * hamiltonian.dphi_dq(z, logger);
+  }
+};
+
+template <class Hamiltonian>
+constexpr double expl_two_stage<Hamiltonian>::b;
+template <class Hamiltonian>
+constexpr int expl_two_stage<Hamiltonian>::num_gradients;
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -13,7 +13,8 @@ class impl_leapfrog : public base_leapfrog<Hamiltonian> {
   impl_leapfrog()
       : base_leapfrog<Hamiltonian>(),
         max_num_fixed_point_(10),
-        fixed_point_threshold_(1e-8) {}
+        fixed_point_threshold_(1e-8),
+        num_fixed_point_iterations_(0) {}
 
   void begin_update_p(typename Hamiltonian::PointType& z,
                       Hamiltonian& hamiltonian, double epsilon,
@@ -29,11 +30,16 @@ class impl_leapfrog : public base_leapfrog<Hamiltonian> {
     Eigen::VectorXd delta_q(z.q.size());
 
     for (int n = 0; n < this->max_num_fixed_point_; ++n) {
+      ++this->num_fixed_point_iterations_;
       delta_q = z.q;
       z.q.noalias() = q_init + 0.5 * epsilon * hamiltonian.dtau_dp(z);
+      delta_q -= z.q;
+
+      // The metric is already evaluated at an exact fixed point
+      if (n > 0 && delta_q.isZero(0))
+        break;
       hamiltonian.update_metric(z, logger);
 
-      delta_q -= z.q;
       if (delta_q.cwiseAbs().maxCoeff() < this->fixed_point_threshold_)
         break;
     }
@@ -50,7 +56,8 @@ class impl_leapfrog : public base_leapfrog<Hamiltonian> {
   // hat{phi} = dphi/dq * d/dp
   void hat_phi(typename Hamiltonian::PointType& z, Hamiltonian& hamiltonian,
                double epsilon, callbacks::logger& logger) {
-    z.p -= epsilon * hamiltonian.dphi_dq(z, logger);
+    this->dphi_dq_ = hamiltonian.dphi_dq(z, logger);
+    z.p -= epsilon * this->dphi_dq_;
   }
 
   // hat{tau} = dtau/dq * d/dp
@@ -60,6 +67,7 @@ class impl_leapfrog : public base_leapfrog<Hamiltonian> {
     Eigen::VectorXd delta_p(z.p.size());
 
     for (int n = 0; n < num_fixed_point; ++n) {
+      ++this->num_fixed_point_iterations_;
       delta_p = z.p;
       z.p.noalias() = p_init - epsilon * hamiltonian.dtau_dq(z, logger);
       delta_p -= z.p;
@@ -82,9 +90,39 @@ class impl_leapfrog : public base_leapfrog<Hamiltonian> {
       this->fixed_point_threshold_ = t;
   }
 
+  /**
+   * Return the number of fixed point iterations run by
+   * <code>update_q()</code> and <code>hat_tau()</code> since the last
+   * call to <code>reset_num_fixed_point_iterations()</code>.
+   *
+   * @return number of fixed point iterations
+   */
+  int num_fixed_point_iterations() const {
+    return this->num_fixed_point_iterations_;
+  }
+
+  void reset_num_fixed_point_iterations() {
+    this->num_fixed_point_iterations_ = 0;
+  }
+
+  /**
+   * Return the gradient of phi computed by the final
+   * <code>hat_phi()</code> of the last call to <code>evolve()</code>.
+   * It depends only on the position, so it is the exact gradient at
+   * the end point until the point is changed.
+   *
+   * @return pointer to the gradient of phi, or a null pointer before
+   * the first call to <code>evolve()</code>
+   */
+  const Eigen::VectorXd* last_dphi_dq() const {
+    return this->dphi_dq_.size() == 0 ? nullptr : &this->dphi_dq_;
+  }
+
  private:
   int max_num_fixed_point_;
   double fixed_point_threshold_;
+  int num_fixed_point_iterations_;
+  Eigen::VectorXd dphi_dq_;
 };
 
 }  // namespace mcmc
@@ -0,0 +1,44 @@
+#ifndef STAN_MCMC_HMC_NUTS_ADAPT_APPROX_SOFTABS_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_ADAPT_APPROX_SOFTABS_NUTS_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/nuts/approx_softabs_nuts.hpp>
+#include <stan/mcmc/stepsize_adapter.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Riemannian disintegration and an approximate
+ * SoftAbs metric and adaptive step size
+ */
+template <class Model, class BaseRNG>
+class adapt_approx_softabs_nuts : public approx_softabs_nuts<Model, BaseRNG>,
+                                  public stepsize_adapter {
+ public:
+  adapt_approx_softabs_nuts(const Model& model, BaseRNG& rng)
+      : approx_softabs_nuts<Model, BaseRNG>(model, rng) {}
+
+  ~adapt_approx_softabs_nuts() {}
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s
+        = approx_softabs_nuts<Model, BaseRNG>::transition(init_sample, logger);
+
+    if (this->adapt_flag_)
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,62 @@
+#ifndef STAN_MCMC_HMC_NUTS_ADAPT_BLOCK_DENSE_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_ADAPT_BLOCK_DENSE_E_NUTS_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/stepsize_block_covar_adapter.hpp>
+#include <stan/mcmc/hmc/nuts/block_dense_e_nuts.hpp>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and adaptive
+ * block diagonal dense metric and adaptive step size
+ */
+template <class Model, class BaseRNG>
+class adapt_block_dense_e_nuts : public block_dense_e_nuts<Model, BaseRNG>,
+                                 public stepsize_block_covar_adapter {
+ public:
+  adapt_block_dense_e_nuts(const Model& model, BaseRNG& rng)
+      : block_dense_e_nuts<Model, BaseRNG>(model, rng),
+        stepsize_block_covar_adapter(model.num_params_r()) {}
+
+  ~adapt_block_dense_e_nuts() {}
+
+  void set_blocks(const std::vector<int>& block_sizes) {
+    block_dense_e_nuts<Model, BaseRNG>::set_blocks(block_sizes);
+    this->block_covar_adaptation_.set_blocks(block_sizes);
+  }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s
+        = block_dense_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+      bool update = this->block_covar_adaptation_.learn_covariance(
+          this->z_.inv_e_metric_, this->z_.q);
+
+      if (update) {
+        this->z_.update_metric_factor();
+        this->init_stepsize(logger);
+
+        this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
+        this->stepsize_adaptation_.restart();
+      }
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
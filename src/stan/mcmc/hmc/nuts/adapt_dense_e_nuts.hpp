@@ -12,27 +12,31 @@ namespace mcmc {
  * with a Gaussian-Euclidean disintegration and adaptive
  * dense metric and adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_dense_e_nuts : public dense_e_nuts<Model, BaseRNG>,
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_dense_e_nuts : public dense_e_nuts<Model, BaseRNG, Integrator>,
                            public stepsize_covar_adapter {
  public:
   adapt_dense_e_nuts(const Model& model, BaseRNG& rng)
-      : dense_e_nuts<Model, BaseRNG>(model, rng),
+      : dense_e_nuts<Model, BaseRNG, Integrator>(model, rng),
         stepsize_covar_adapter(model.num_params_r()) {}
 
   ~adapt_dense_e_nuts() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
-    sample s = dense_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s = dense_e_nuts<Model, BaseRNG, Integrator>::transition(init_sample,
+                                                                    logger);
 
     if (this->adapt_flag_) {
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
                                                 s.accept_stat());
 
       bool update = this->covar_adaptation_.learn_covariance(
-          this->z_.inv_e_metric_, this->z_.q);
+          this->z_.inv_e_metric_, this->z_.q, this->z_.g);
 
       if (update) {
+        this->z_.update_metric_factor();
         this->init_stepsize(logger);
 
         this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
@@ -12,18 +12,21 @@ namespace mcmc {
  * with a Gaussian-Euclidean disintegration and adaptive
  * diagonal metric and adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_diag_e_nuts : public diag_e_nuts<Model, BaseRNG>,
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_diag_e_nuts : public diag_e_nuts<Model, BaseRNG, Integrator>,
                           public stepsize_var_adapter {
  public:
   adapt_diag_e_nuts(const Model& model, BaseRNG& rng)
-      : diag_e_nuts<Model, BaseRNG>(model, rng),
+      : diag_e_nuts<Model, BaseRNG, Integrator>(model, rng),
         stepsize_var_adapter(model.num_params_r()) {}
 
   ~adapt_diag_e_nuts() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
-    sample s = diag_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s = diag_e_nuts<Model, BaseRNG, Integrator>::transition(init_sample,
+                                                                   logger);
 
     if (this->adapt_flag_) {
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
@@ -0,0 +1,58 @@
+#ifndef STAN_MCMC_HMC_NUTS_ADAPT_LBFGS_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_ADAPT_LBFGS_E_NUTS_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/stepsize_var_adapter.hpp>
+#include <stan/mcmc/hmc/nuts/lbfgs_e_nuts.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and adaptive step size,
+ * whose metric starts as an L-BFGS inverse Hessian and is replaced by
+ * the adapted diagonal metric at the end of the first slow adaptation
+ * window
+ */
+template <class Model, class BaseRNG>
+class adapt_lbfgs_e_nuts : public lbfgs_e_nuts<Model, BaseRNG>,
+                           public stepsize_var_adapter {
+ public:
+  adapt_lbfgs_e_nuts(const Model& model, BaseRNG& rng)
+      : lbfgs_e_nuts<Model, BaseRNG>(model, rng),
+        stepsize_var_adapter(model.num_params_r()) {}
+
+  ~adapt_lbfgs_e_nuts() {}
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s = lbfgs_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+      bool update = this->var_adaptation_.learn_variance(this->z_.inv_e_metric_,
+                                                         this->z_.q);
+
+      if (update) {
+        // Drop the L-BFGS updates, which the adapted diagonal replaces
+        this->z_.set_metric(this->z_.inv_e_metric_);
+        this->init_stepsize(logger);
+
+        this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
+        this->stepsize_adaptation_.restart();
+      }
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
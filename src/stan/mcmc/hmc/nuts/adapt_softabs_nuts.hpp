@@ -22,6 +22,7 @@ class adapt_softabs_nuts : public softabs_nuts<Model, BaseRNG>,
   ~adapt_softabs_nuts() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->set_warmup_transition(this->adapt_flag_);
     sample s = softabs_nuts<Model, BaseRNG>::transition(init_sample, logger);
 
     if (this->adapt_flag_)
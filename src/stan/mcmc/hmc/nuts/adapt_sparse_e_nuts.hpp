@@ -0,0 +1,69 @@
+#ifndef STAN_MCMC_HMC_NUTS_ADAPT_SPARSE_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_ADAPT_SPARSE_E_NUTS_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/stepsize_sparse_precision_adapter.hpp>
+#include <stan/mcmc/hmc/nuts/sparse_e_nuts.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and adaptive
+ * sparse metric and adaptive step size. The metric is adapted as a
+ * precision with the sparsity pattern of the metric it starts from.
+ */
+template <class Model, class BaseRNG>
+class adapt_sparse_e_nuts : public sparse_e_nuts<Model, BaseRNG>,
+                            public stepsize_sparse_precision_adapter {
+ public:
+  adapt_sparse_e_nuts(const Model& model, BaseRNG& rng)
+      : sparse_e_nuts<Model, BaseRNG>(model, rng),
+        stepsize_sparse_precision_adapter(model.num_params_r()) {}
+
+  ~adapt_sparse_e_nuts() {}
+
+  /**
+   * Set the mass matrix and the sparsity pattern of its adaptation.
+   *
+   * @param e_metric sparse symmetric positive definite mass matrix
+   *   with both triangles
+   * @throws std::invalid_argument if the matrix has the wrong size or
+   *   isn't positive definite
+   */
+  void set_metric(const Eigen::SparseMatrix<double>& e_metric) {
+    sparse_e_nuts<Model, BaseRNG>::set_metric(e_metric);
+    this->sparse_precision_adaptation_.set_pattern(e_metric);
+  }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s = sparse_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+
+    if (this->adapt_flag_) {
+      this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
+                                                s.accept_stat());
+
+      bool update = this->sparse_precision_adaptation_.learn_precision(
+          this->z_.e_metric_, this->z_.q);
+
+      if (update) {
+        this->z_.update_metric_factor();
+        this->init_stepsize(logger);
+
+        this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
+        this->stepsize_adaptation_.restart();
+      }
+    }
+    return s;
+  }
+
+  void disengage_adaptation() {
+    base_adapter::disengage_adaptation();
+    this->stepsize_adaptation_.complete_adaptation(this->nom_epsilon_);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
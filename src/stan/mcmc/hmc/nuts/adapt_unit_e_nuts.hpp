@@ -12,17 +12,20 @@ namespace mcmc {
  * with a Gaussian-Euclidean disintegration and unit metric
  * and adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_unit_e_nuts : public unit_e_nuts<Model, BaseRNG>,
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_unit_e_nuts : public unit_e_nuts<Model, BaseRNG, Integrator>,
                           public stepsize_adapter {
  public:
   adapt_unit_e_nuts(const Model& model, BaseRNG& rng)
-      : unit_e_nuts<Model, BaseRNG>(model, rng) {}
+      : unit_e_nuts<Model, BaseRNG, Integrator>(model, rng) {}
 
   ~adapt_unit_e_nuts() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
-    sample s = unit_e_nuts<Model, BaseRNG>::transition(init_sample, logger);
+    this->set_warmup_transition(this->adapt_flag_);
+    sample s = unit_e_nuts<Model, BaseRNG, Integrator>::transition(init_sample,
+                                                                   logger);
 
     if (this->adapt_flag_)
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
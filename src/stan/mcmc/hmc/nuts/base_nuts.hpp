@@ -5,10 +5,16 @@
 #include <stan/math/prim.hpp>
 #include <stan/mcmc/hmc/base_hmc.hpp>
 #include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/nuts/divergence_capture.hpp>
+#include <stan/mcmc/hmc/nuts/trajectory_speculator.hpp>
+#include <stan/mcmc/hmc/nuts/treedepth_monitor.hpp>
+#include <stan/mcmc/instrumentation.hpp>
 #include <algorithm>
 #include <cmath>
 #include <limits>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace stan {
@@ -65,9 +71,15 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     this->z_.set_metric(inv_e_metric);
   }
 
+  void set_metric_factor(const Eigen::MatrixXd& inv_e_metric_factor) {
+    this->z_.set_metric_factor(inv_e_metric_factor);
+  }
+
   void set_max_depth(int d) {
-    if (d > 0)
+    if (d > 0) {
       max_depth_ = d;
+      resize_workspace(max_depth_);
+    }
   }
 
   void set_max_delta(double d) { max_deltaH_ = d; }
@@ -75,39 +87,140 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
   int get_max_depth() { return this->max_depth_; }
   double get_max_delta() { return this->max_deltaH_; }
 
+  /**
+   * Set whether each new subtree is built while the opposite end of
+   * the trajectory is integrated speculatively on another thread.
+   * When the trajectory is later extended in that direction the
+   * precomputed leapfrog states are used instead of being recomputed,
+   * which lowers the latency of a transition at the cost of extra
+   * gradient evaluations. Draws and the random number stream are
+   * identical to those of the serial sampler.
+   *
+   * Speculation requires threading support (<code>STAN_THREADS</code>)
+   * and an explicit leapfrog integrator; otherwise the setting is
+   * ignored.
+   *
+   * @param speculative true to integrate both ends in parallel
+   */
+  void set_speculative(bool speculative) { speculative_ = speculative; }
+
+  bool get_speculative() const { return speculative_; }
+
+  /**
+   * Set whether subtrees are built iteratively, one leaf after the
+   * other, with the pending halves of the tree kept on a preallocated
+   * stack of checkpoints, instead of by recursion. The leaves are
+   * visited, merged and checked for U-turns in the same order, so the
+   * draws and the random number stream are identical to those of the
+   * recursive sampler.
+   *
+   * @param iterative true to build subtrees iteratively
+   */
+  void set_iterative(bool iterative) { iterative_ = iterative; }
+
+  bool get_iterative() const { return iterative_; }
+
+  /**
+   * Set a writer that the leapfrog states of divergent trajectories are
+   * written to, as described in <code>divergence_capture</code>. The
+   * latest states of every trajectory are kept in a ring allocated
+   * once, and only written if the trajectory diverges.
+   *
+   * @param[in, out] writer writer, or a null pointer to stop capturing
+   * @param[in] capacity number of states kept from each trajectory
+   */
+  void set_divergence_writer(callbacks::writer* writer,
+                             size_t capacity = 1024) {
+    divergence_capture_.set_writer(writer, capacity);
+  }
+
+  /**
+   * Set the largest number of leapfrog steps of a trajectory during
+   * warmup, as described in <code>treedepth_monitor</code>. Transitions
+   * after warmup always use the maximum tree depth.
+   *
+   * @param[in] budget number of gradient evaluations, or zero or less
+   *   to not limit warmup trajectories
+   */
+  void set_warmup_gradient_budget(int budget) {
+    treedepth_monitor_.set_gradient_budget(budget);
+  }
+
+  int get_warmup_gradient_budget() const {
+    return treedepth_monitor_.get_gradient_budget();
+  }
+
+  /**
+   * Set whether the following transitions are warmup transitions, whose
+   * tree depth is monitored and limited by the gradient budget. The
+   * adaptive samplers set this from their adaptation flag before every
+   * transition.
+   *
+   * @param[in] warmup true if the transitions are warmup transitions
+   */
+  void set_warmup_transition(bool warmup) { warmup_transition_ = warmup; }
+
+  /**
+   * Return the monitor of the tree depth of warmup transitions.
+   */
+  treedepth_monitor& get_treedepth_monitor() { return treedepth_monitor_; }
+
   sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->start_transition_cost();
+
     // Initialize the algorithm
     this->sample_stepsize();
 
     this->seed(init_sample.cont_params());
 
     this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
+    this->init_transition(logger);
+
+    resize_workspace(this->max_depth_);
+    leaf_log_weights_.reserve(size_t(1) << std::min(this->max_depth_, 20));
+    trajectory_workspace& ws = trajectory_workspace_;
 
-    ps_point z_fwd(this->z_);  // State at forward end of trajectory
-    ps_point z_bck(z_fwd);     // State at backward end of trajectory
+    ps_point& z_fwd = ws.z_fwd;  // State at forward end of trajectory
+    ps_point& z_bck = ws.z_bck;  // State at backward end of trajectory
+    z_fwd = this->z_;
+    z_bck = this->z_;
 
-    ps_point z_sample(z_fwd);
-    ps_point z_propose(z_fwd);
+    ps_point& z_sample = ws.z_sample;
+    ps_point& z_propose = ws.z_propose;
+    z_sample = this->z_;
+    z_propose = this->z_;
 
     // Momentum and sharp momentum at forward end of forward subtree
-    Eigen::VectorXd p_fwd_fwd = this->z_.p;
-    Eigen::VectorXd p_sharp_fwd_fwd = this->hamiltonian_.dtau_dp(this->z_);
+    Eigen::VectorXd& p_fwd_fwd = ws.p_fwd_fwd;
+    Eigen::VectorXd& p_sharp_fwd_fwd = ws.p_sharp_fwd_fwd;
+    p_fwd_fwd = this->z_.p;
+    this->hamiltonian_.dtau_dp_into(this->z_, p_sharp_fwd_fwd);
 
     // Momentum and sharp momentum at backward end of forward subtree
-    Eigen::VectorXd p_fwd_bck = this->z_.p;
-    Eigen::VectorXd p_sharp_fwd_bck = p_sharp_fwd_fwd;
+    Eigen::VectorXd& p_fwd_bck = ws.p_fwd_bck;
+    Eigen::VectorXd& p_sharp_fwd_bck = ws.p_sharp_fwd_bck;
+    p_fwd_bck = this->z_.p;
+    p_sharp_fwd_bck = p_sharp_fwd_fwd;
 
     // Momentum and sharp momentum at forward end of backward subtree
-    Eigen::VectorXd p_bck_fwd = this->z_.p;
-    Eigen::VectorXd p_sharp_bck_fwd = p_sharp_fwd_fwd;
+    Eigen::VectorXd& p_bck_fwd = ws.p_bck_fwd;
+    Eigen::VectorXd& p_sharp_bck_fwd = ws.p_sharp_bck_fwd;
+    p_bck_fwd = this->z_.p;
+    p_sharp_bck_fwd = p_sharp_fwd_fwd;
 
     // Momentum and sharp momentum at backward end of backward subtree
-    Eigen::VectorXd p_bck_bck = this->z_.p;
-    Eigen::VectorXd p_sharp_bck_bck = p_sharp_fwd_fwd;
+    Eigen::VectorXd& p_bck_bck = ws.p_bck_bck;
+    Eigen::VectorXd& p_sharp_bck_bck = ws.p_sharp_bck_bck;
+    p_bck_bck = this->z_.p;
+    p_sharp_bck_bck = p_sharp_fwd_fwd;
 
     // Integrated momenta along trajectory
-    Eigen::VectorXd rho = this->z_.p.transpose();
+    Eigen::VectorXd& rho = ws.rho;
+    rho = this->z_.p;
+
+    Eigen::VectorXd& rho_fwd = ws.rho_fwd;
+    Eigen::VectorXd& rho_bck = ws.rho_bck;
+    Eigen::VectorXd& rho_extended = ws.rho_extended;
 
     // Log sum of state weights (offset by H0) along trajectory
     double log_sum_weight = 0;  // log(exp(H0 - H0))
@@ -119,16 +232,33 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     // criterion is no longer satisfied
     this->depth_ = 0;
     this->divergent_ = false;
+    if (divergence_capture_.enabled())
+      divergence_capture_.start(this->z_.q, this->z_.V);
+
+#ifdef STAN_THREADS
+    speculating_
+        = speculative_
+          && std::is_same<integrator_t, expl_leapfrog<hamiltonian_t>>::value;
+#endif
+    if (speculating_)
+      speculator_.reset(this->z_);
 
-    while (this->depth_ < this->max_depth_) {
+    const int depth_limit = warmup_transition_
+                                ? treedepth_monitor_.depth_limit(max_depth_)
+                                : max_depth_;
+    while (this->depth_ < depth_limit) {
       // Build a new subtree in a random direction
-      Eigen::VectorXd rho_fwd = Eigen::VectorXd::Zero(rho.size());
-      Eigen::VectorXd rho_bck = Eigen::VectorXd::Zero(rho.size());
+      rho_fwd.setZero();
+      rho_bck.setZero();
 
       bool valid_subtree = false;
       double log_sum_weight_subtree = -std::numeric_limits<double>::infinity();
 
       if (this->rand_uniform_() > 0.5) {
+        if (speculating_)
+          speculator_.run(this->hamiltonian_, z_bck, -1, this->epsilon_,
+                           1 << this->depth_, H0, this->max_deltaH_);
+
         // Extend the current trajectory forward
         this->z_.ps_point::operator=(z_fwd);
         rho_bck = rho;
@@ -141,6 +271,10 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
             sum_metro_prob, logger);
         z_fwd.ps_point::operator=(this->z_);
       } else {
+        if (speculating_)
+          speculator_.run(this->hamiltonian_, z_fwd, 1, this->epsilon_,
+                           1 << this->depth_, H0, this->max_deltaH_);
+
         // Extend the current trajectory backwards
         this->z_.ps_point::operator=(z_bck);
         rho_fwd = rho;
@@ -154,37 +288,43 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
         z_bck.ps_point::operator=(this->z_);
       }
 
+      if (speculating_)
+        speculator_.cancel();
+
       if (!valid_subtree)
         break;
 
       // Sample from accepted subtree
       ++(this->depth_);
 
-      if (log_sum_weight_subtree > log_sum_weight) {
+      // The exponential of the weight ratio gives both the acceptance
+      // probability and the update of the log summed weight
+      double log_weight_ratio = log_sum_weight_subtree - log_sum_weight;
+      if (log_weight_ratio > 0) {
         z_sample = z_propose;
+        log_sum_weight
+            = log_sum_weight_subtree + std::log1p(std::exp(-log_weight_ratio));
       } else {
-        double accept_prob = std::exp(log_sum_weight_subtree - log_sum_weight);
+        double accept_prob = std::exp(log_weight_ratio);
         if (this->rand_uniform_() < accept_prob)
           z_sample = z_propose;
+        log_sum_weight += std::log1p(accept_prob);
       }
 
-      log_sum_weight
-          = math::log_sum_exp(log_sum_weight, log_sum_weight_subtree);
-
       // Break when no-u-turn criterion is no longer satisfied
-      rho = rho_bck + rho_fwd;
+      rho.noalias() = rho_bck + rho_fwd;
 
       // Demand satisfaction around merged subtrees
       bool persist_criterion
           = compute_criterion(p_sharp_bck_bck, p_sharp_fwd_fwd, rho);
 
       // Demand satisfaction between subtrees
-      Eigen::VectorXd rho_extended = rho_bck + p_fwd_bck;
+      rho_extended.noalias() = rho_bck + p_fwd_bck;
 
       persist_criterion
           &= compute_criterion(p_sharp_bck_bck, p_sharp_fwd_bck, rho_extended);
 
-      rho_extended = rho_fwd + p_bck_fwd;
+      rho_extended.noalias() = rho_fwd + p_bck_fwd;
       persist_criterion
           &= compute_criterion(p_sharp_bck_fwd, p_sharp_fwd_fwd, rho_extended);
 
@@ -192,7 +332,13 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
         break;
     }
 
-    this->n_leapfrog_ = n_leapfrog;
+    speculating_ = false;
+    this->n_leapfrog_
+        = n_leapfrog * Integrator<Hamiltonian<Model, BaseRNG> >::num_gradients;
+    if (warmup_transition_)
+      treedepth_monitor_.record(this->depth_, depth_limit, max_depth_, logger);
+    if (this->divergent_ && divergence_capture_.enabled())
+      divergence_capture_.write();
 
     // Compute average acceptance probabilty across entire trajectory,
     // even over subtrees that may have been rejected
@@ -200,6 +346,7 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
 
     this->z_.ps_point::operator=(z_sample);
     this->energy_ = this->hamiltonian_.H(this->z_);
+    this->end_transition_cost();
     return sample(this->z_.q, -this->z_.V, accept_prob);
   }
 
@@ -209,6 +356,7 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     names.push_back("n_leapfrog__");
     names.push_back("divergent__");
     names.push_back("energy__");
+    this->get_cost_param_names(names);
   }
 
   void get_sampler_params(std::vector<double>& values) {
@@ -217,6 +365,7 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     values.push_back(this->n_leapfrog_);
     values.push_back(this->divergent_);
     values.push_back(this->energy_);
+    this->get_cost_params(values);
   }
 
   virtual bool compute_criterion(Eigen::VectorXd& p_sharp_minus,
@@ -226,9 +375,12 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
   }
 
   /**
-   * Recursively build a new subtree to completion or until
-   * the subtree becomes invalid.  Returns validity of the
-   * resulting subtree.
+   * Build a new subtree to completion or until the subtree becomes
+   * invalid.  Returns validity of the resulting subtree.
+   *
+   * The energies of the new leaves are gathered while the subtree is
+   * built and their Metropolis acceptance probabilities are added to
+   * <code>sum_metro_prob</code> in one pass at the end.
    *
    * @param depth Depth of the desired subtree
    * @param z_propose State proposed from subtree
@@ -249,29 +401,70 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
                   Eigen::VectorXd& p_beg, Eigen::VectorXd& p_end, double H0,
                   double sign, int& n_leapfrog, double& log_sum_weight,
                   double& sum_metro_prob, callbacks::logger& logger) {
-    // Base case
-    if (depth == 0) {
-      this->integrator_.evolve(this->z_, this->hamiltonian_,
-                               sign * this->epsilon_, logger);
-      ++n_leapfrog;
-
-      double h = this->hamiltonian_.H(this->z_);
-      if (std::isnan(h))
-        h = std::numeric_limits<double>::infinity();
+    STAN_INSTRUMENT_REGION("build_tree");
+    leaf_log_weights_.clear();
+    bool valid = iterative_
+                     ? build_subtree_iterative(depth, z_propose, p_sharp_beg,
+                                               p_sharp_end, rho, p_beg, p_end,
+                                               H0, sign, n_leapfrog,
+                                               log_sum_weight, logger)
+                     : build_subtree(depth, z_propose, p_sharp_beg,
+                                     p_sharp_end, rho, p_beg, p_end, H0, sign,
+                                     n_leapfrog, log_sum_weight, logger);
+    // Leaves with higher energy than the initial state are accepted with
+    // probability exp(H0 - h), the others always
+    sum_metro_prob
+        += Eigen::Map<const Eigen::ArrayXd>(leaf_log_weights_.data(),
+                                            leaf_log_weights_.size())
+               .min(0.0)
+               .exp()
+               .sum();
+    return valid;
+  }
 
-      if ((h - H0) > this->max_deltaH_)
-        this->divergent_ = true;
+  int depth_;
+  int max_depth_;
+  double max_deltaH_;
 
-      log_sum_weight = math::log_sum_exp(log_sum_weight, H0 - h);
+  // Gradient evaluations of the last transition, which are the
+  // integrator steps scaled by the gradients each of them takes
+  int n_leapfrog_;
+  bool divergent_;
+  double energy_;
 
-      if (H0 - h > 0)
-        sum_metro_prob += 1;
-      else
-        sum_metro_prob += std::exp(H0 - h);
+ protected:
+  /**
+   * Recursively build a new subtree for <code>build_tree()</code>,
+   * recording the log weight H0 - h of every new leaf in
+   * <code>leaf_log_weights_</code>.
+   *
+   * @param depth Depth of the desired subtree
+   * @param z_propose State proposed from subtree
+   * @param p_sharp_beg Sharp momentum at beginning of new tree
+   * @param p_sharp_end Sharp momentum at end of new tree
+   * @param rho Summed momentum across trajectory
+   * @param p_beg Momentum at beginning of returned tree
+   * @param p_end Momentum at end of returned tree
+   * @param H0 Hamiltonian of initial state
+   * @param sign Direction in time to built subtree
+   * @param n_leapfrog Summed number of leapfrog evaluations
+   * @param log_sum_weight Log of summed weights across trajectory
+   * @param logger Logger for messages
+   */
+  bool build_subtree(int depth, ps_point& z_propose,
+                     Eigen::VectorXd& p_sharp_beg, Eigen::VectorXd& p_sharp_end,
+                     Eigen::VectorXd& rho, Eigen::VectorXd& p_beg,
+                     Eigen::VectorXd& p_end, double H0, double sign,
+                     int& n_leapfrog, double& log_sum_weight,
+                     callbacks::logger& logger) {
+    // Base case
+    if (depth == 0) {
+      double log_weight = evolve_leaf(H0, sign, n_leapfrog, logger);
+      log_sum_weight = math::log_sum_exp(log_sum_weight, log_weight);
 
       z_propose = this->z_;
 
-      p_sharp_beg = this->hamiltonian_.dtau_dp(this->z_);
+      this->hamiltonian_.dtau_dp_into(this->z_, p_sharp_beg);
       p_sharp_end = p_sharp_beg;
 
       rho += this->z_.p;
@@ -282,57 +475,71 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     }
     // General recursion
 
+    // Scratch storage reserved for this depth; deeper recursive calls
+    // only ever touch the slots of strictly smaller depths
+    resize_workspace(depth + 1);
+    subtree_workspace& ws = subtree_workspace_[depth];
+
     // Build the initial subtree
     double log_sum_weight_init = -std::numeric_limits<double>::infinity();
 
     // Momentum and sharp momentum at end of the initial subtree
-    Eigen::VectorXd p_init_end(this->z_.p.size());
-    Eigen::VectorXd p_sharp_init_end(this->z_.p.size());
+    Eigen::VectorXd& p_init_end = ws.p_init_end;
+    Eigen::VectorXd& p_sharp_init_end = ws.p_sharp_init_end;
 
-    Eigen::VectorXd rho_init = Eigen::VectorXd::Zero(rho.size());
+    Eigen::VectorXd& rho_init = ws.rho_init;
+    rho_init.setZero();
 
     bool valid_init
-        = build_tree(depth - 1, z_propose, p_sharp_beg, p_sharp_init_end,
-                     rho_init, p_beg, p_init_end, H0, sign, n_leapfrog,
-                     log_sum_weight_init, sum_metro_prob, logger);
+        = build_subtree(depth - 1, z_propose, p_sharp_beg, p_sharp_init_end,
+                        rho_init, p_beg, p_init_end, H0, sign, n_leapfrog,
+                        log_sum_weight_init, logger);
 
     if (!valid_init)
       return false;
 
     // Build the final subtree
-    ps_point z_propose_final(this->z_);
+    ps_point& z_propose_final = ws.z_propose_final;
+    z_propose_final = this->z_;
 
     double log_sum_weight_final = -std::numeric_limits<double>::infinity();
 
     // Momentum and sharp momentum at beginning of the final subtree
-    Eigen::VectorXd p_final_beg(this->z_.p.size());
-    Eigen::VectorXd p_sharp_final_beg(this->z_.p.size());
+    Eigen::VectorXd& p_final_beg = ws.p_final_beg;
+    Eigen::VectorXd& p_sharp_final_beg = ws.p_sharp_final_beg;
 
-    Eigen::VectorXd rho_final = Eigen::VectorXd::Zero(rho.size());
+    Eigen::VectorXd& rho_final = ws.rho_final;
+    rho_final.setZero();
 
-    bool valid_final
-        = build_tree(depth - 1, z_propose_final, p_sharp_final_beg, p_sharp_end,
-                     rho_final, p_final_beg, p_end, H0, sign, n_leapfrog,
-                     log_sum_weight_final, sum_metro_prob, logger);
+    bool valid_final = build_subtree(
+        depth - 1, z_propose_final, p_sharp_final_beg, p_sharp_end, rho_final,
+        p_final_beg, p_end, H0, sign, n_leapfrog, log_sum_weight_final, logger);
 
     if (!valid_final)
       return false;
 
-    // Multinomial sample from right subtree
-    double log_sum_weight_subtree
-        = math::log_sum_exp(log_sum_weight_init, log_sum_weight_final);
+    // Multinomial sample from right subtree. Offsetting by the larger
+    // of the two log weights keeps the exponential bounded by one, and
+    // the same exponential gives both the log summed weight and the
+    // probability of selecting the right subtree
+    double log_sum_weight_subtree;
+    double accept_prob;
+    if (log_sum_weight_final > log_sum_weight_init) {
+      double ratio = std::exp(log_sum_weight_init - log_sum_weight_final);
+      log_sum_weight_subtree = log_sum_weight_final + std::log1p(ratio);
+      accept_prob = 1 / (1 + ratio);
+    } else {
+      double ratio = std::exp(log_sum_weight_final - log_sum_weight_init);
+      log_sum_weight_subtree = log_sum_weight_init + std::log1p(ratio);
+      accept_prob = ratio / (1 + ratio);
+    }
     log_sum_weight = math::log_sum_exp(log_sum_weight, log_sum_weight_subtree);
 
-    if (log_sum_weight_final > log_sum_weight_subtree) {
+    if (this->rand_uniform_() < accept_prob)
       z_propose = z_propose_final;
-    } else {
-      double accept_prob
-          = std::exp(log_sum_weight_final - log_sum_weight_subtree);
-      if (this->rand_uniform_() < accept_prob)
-        z_propose = z_propose_final;
-    }
 
-    Eigen::VectorXd rho_subtree = rho_init + rho_final;
+    Eigen::VectorXd& rho_subtree = ws.rho_subtree;
+    rho_subtree.noalias() = rho_init + rho_final;
     rho += rho_subtree;
 
     // Demand satisfaction around merged subtrees
@@ -340,24 +547,333 @@ class base_nuts : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
         = compute_criterion(p_sharp_beg, p_sharp_end, rho_subtree);
 
     // Demand satisfaction between subtrees
-    rho_subtree = rho_init + p_final_beg;
+    rho_subtree.noalias() = rho_init + p_final_beg;
     persist_criterion
         &= compute_criterion(p_sharp_beg, p_sharp_final_beg, rho_subtree);
 
-    rho_subtree = rho_final + p_init_end;
+    rho_subtree.noalias() = rho_final + p_init_end;
     persist_criterion
         &= compute_criterion(p_sharp_init_end, p_sharp_end, rho_subtree);
 
     return persist_criterion;
   }
 
-  int depth_;
-  int max_depth_;
-  double max_deltaH_;
+  /**
+   * Take the leapfrog step to a new leaf, flag a divergence and record
+   * the log weight H0 - h of the leaf in <code>leaf_log_weights_</code>.
+   *
+   * @param H0 Hamiltonian of initial state
+   * @param sign Direction in time to built subtree
+   * @param n_leapfrog Summed number of leapfrog evaluations
+   * @param logger Logger for messages
+   * @return log weight of the leaf
+   */
+  double evolve_leaf(double H0, double sign, int& n_leapfrog,
+                     callbacks::logger& logger) {
+    if (!speculating_ || !speculator_.take(sign, this->z_, logger))
+      this->integrator_.evolve(this->z_, this->hamiltonian_,
+                               sign * this->epsilon_, logger);
+    ++n_leapfrog;
 
-  int n_leapfrog_;
-  bool divergent_;
-  double energy_;
+    double h = this->hamiltonian_.H(this->z_);
+    if (std::isnan(h))
+      h = std::numeric_limits<double>::infinity();
+
+    if ((h - H0) > this->max_deltaH_)
+      this->divergent_ = true;
+
+    if (divergence_capture_.enabled())
+      divergence_capture_.record(sign, this->z_.q, this->z_.V, h - H0);
+
+    leaf_log_weights_.push_back(H0 - h);
+    return H0 - h;
+  }
+
+  /**
+   * Build a new subtree for <code>build_tree()</code> without
+   * recursion, taking the same arguments as <code>build_subtree()</code>.
+   *
+   * The leaves are integrated in order. A completed subtree that is the
+   * first half of a larger one waits on the stack of checkpoints, one
+   * per level, holding its proposal, log summed weight, summed momentum
+   * and the momenta and sharp momenta at both ends. Leaf i completes
+   * one subtree for every trailing one bit of i, and each is merged with
+   * its waiting first half by multinomial sampling and checked for
+   * U-turns exactly as the recursion does.
+   */
+  bool build_subtree_iterative(int depth, ps_point& z_propose,
+                               Eigen::VectorXd& p_sharp_beg,
+                               Eigen::VectorXd& p_sharp_end,
+                               Eigen::VectorXd& rho, Eigen::VectorXd& p_beg,
+                               Eigen::VectorXd& p_end, double H0, double sign,
+                               int& n_leapfrog, double& log_sum_weight,
+                               callbacks::logger& logger) {
+    resize_checkpoints(depth + 1);
+    checkpoint_free_.clear();
+    for (int k = depth; k >= 0; --k)
+      checkpoint_free_.push_back(k);
+
+    int tree = 0;
+    const size_t num_leaves = size_t(1) << depth;
+    for (size_t i = 0; i < num_leaves; ++i) {
+      int current = checkpoint_free_.back();
+      checkpoint_free_.pop_back();
+      subtree_checkpoint& leaf = checkpoints_[current];
+
+      leaf.log_sum_weight = evolve_leaf(H0, sign, n_leapfrog, logger);
+      if (this->divergent_)
+        return false;
+      leaf.z_propose = this->z_;
+      this->hamiltonian_.dtau_dp_into(this->z_, leaf.p_sharp_beg);
+      leaf.p_sharp_end = leaf.p_sharp_beg;
+      leaf.rho = this->z_.p;
+      leaf.p_beg = this->z_.p;
+      leaf.p_end = leaf.p_beg;
+
+      // Merge every subtree the leaf completes with its first half
+      int level = 0;
+      for (; (i >> level) & 1; ++level) {
+        int init = checkpoint_pending_[level];
+        bool persist_criterion
+            = merge_checkpoints(checkpoints_[init], checkpoints_[current]);
+        checkpoint_free_.push_back(current);
+        current = init;
+        if (!persist_criterion)
+          return false;
+      }
+      if (level < depth)
+        checkpoint_pending_[level] = current;
+      tree = current;
+    }
+
+    // After the last leaf the whole subtree has been merged
+    subtree_checkpoint& subtree = checkpoints_[tree];
+    z_propose = subtree.z_propose;
+    p_sharp_beg = subtree.p_sharp_beg;
+    p_sharp_end = subtree.p_sharp_end;
+    rho += subtree.rho;
+    p_beg = subtree.p_beg;
+    p_end = subtree.p_end;
+    log_sum_weight
+        = math::log_sum_exp(log_sum_weight, subtree.log_sum_weight);
+    return true;
+  }
+
+  /**
+   * The state of a completed subtree kept by
+   * <code>build_subtree_iterative()</code>.
+   */
+  struct subtree_checkpoint {
+    explicit subtree_checkpoint(int n)
+        : z_propose(n),
+          p_sharp_beg(n),
+          p_sharp_end(n),
+          p_beg(n),
+          p_end(n),
+          rho(n),
+          log_sum_weight(0) {}
+
+    ps_point z_propose;
+    Eigen::VectorXd p_sharp_beg;
+    Eigen::VectorXd p_sharp_end;
+    Eigen::VectorXd p_beg;
+    Eigen::VectorXd p_end;
+    Eigen::VectorXd rho;
+    double log_sum_weight;
+  };
+
+  /**
+   * Merge a completed subtree into the subtree that precedes it, which
+   * then holds the merged subtree, and return whether the merged
+   * subtree satisfies the no-U-turn criterion.
+   *
+   * @param tree_init First half of the merged subtree
+   * @param tree_final Second half of the merged subtree
+   */
+  bool merge_checkpoints(subtree_checkpoint& tree_init,
+                         subtree_checkpoint& tree_final) {
+    // Multinomial sample from right subtree, as in build_subtree()
+    const double log_sum_weight_init = tree_init.log_sum_weight;
+    const double log_sum_weight_final = tree_final.log_sum_weight;
+    double log_sum_weight_subtree;
+    double accept_prob;
+    if (log_sum_weight_final > log_sum_weight_init) {
+      double ratio = std::exp(log_sum_weight_init - log_sum_weight_final);
+      log_sum_weight_subtree = log_sum_weight_final + std::log1p(ratio);
+      accept_prob = 1 / (1 + ratio);
+    } else {
+      double ratio = std::exp(log_sum_weight_final - log_sum_weight_init);
+      log_sum_weight_subtree = log_sum_weight_init + std::log1p(ratio);
+      accept_prob = ratio / (1 + ratio);
+    }
+    tree_init.log_sum_weight = log_sum_weight_subtree;
+
+    if (this->rand_uniform_() < accept_prob)
+      tree_init.z_propose = tree_final.z_propose;
+
+    Eigen::VectorXd& rho_subtree = checkpoint_rho_;
+    rho_subtree.noalias() = tree_init.rho + tree_final.rho;
+
+    // Demand satisfaction around merged subtrees
+    bool persist_criterion = compute_criterion(
+        tree_init.p_sharp_beg, tree_final.p_sharp_end, rho_subtree);
+
+    // Demand satisfaction between subtrees
+    Eigen::VectorXd& rho_extended = checkpoint_rho_extended_;
+    rho_extended.noalias() = tree_init.rho + tree_final.p_beg;
+    persist_criterion &= compute_criterion(
+        tree_init.p_sharp_beg, tree_final.p_sharp_beg, rho_extended);
+
+    rho_extended.noalias() = tree_final.rho + tree_init.p_end;
+    persist_criterion &= compute_criterion(
+        tree_init.p_sharp_end, tree_final.p_sharp_end, rho_extended);
+
+    tree_init.rho.swap(rho_subtree);
+    tree_init.p_sharp_end.swap(tree_final.p_sharp_end);
+    tree_init.p_end.swap(tree_final.p_end);
+    return persist_criterion;
+  }
+
+  /**
+   * Make sure the given number of checkpoints exist.
+   *
+   * @param num_checkpoints Number of checkpoints needed
+   */
+  void resize_checkpoints(int num_checkpoints) {
+    if (static_cast<int>(checkpoints_.size()) >= num_checkpoints)
+      return;
+    int n = this->z_.q.size();
+    checkpoints_.reserve(num_checkpoints);
+    while (static_cast<int>(checkpoints_.size()) < num_checkpoints)
+      checkpoints_.emplace_back(n);
+    checkpoint_pending_.resize(num_checkpoints);
+    checkpoint_free_.reserve(num_checkpoints);
+  }
+
+  bool iterative_{false};
+  std::vector<subtree_checkpoint> checkpoints_;
+  std::vector<int> checkpoint_pending_;
+  std::vector<int> checkpoint_free_;
+  Eigen::VectorXd checkpoint_rho_;
+  Eigen::VectorXd checkpoint_rho_extended_;
+
+  typedef Hamiltonian<Model, BaseRNG> hamiltonian_t;
+  typedef Integrator<hamiltonian_t> integrator_t;
+  typedef trajectory_speculator<hamiltonian_t, integrator_t> speculator_t;
+
+  bool speculative_{false};
+
+  /**
+   * Background integration of the trajectory end that is not being
+   * extended.
+   */
+  speculator_t speculator_;
+
+  /**
+   * Whether the current transition takes states from the speculator.
+   */
+  bool speculating_{false};
+
+  divergence_capture divergence_capture_;
+
+  /**
+   * Whether the current transition is a warmup transition.
+   */
+  bool warmup_transition_{false};
+
+  treedepth_monitor treedepth_monitor_;
+
+  /**
+   * Scratch storage for the merge step of a single level of the
+   * trajectory tree.  One instance is kept per tree depth so that the
+   * recursion in build_tree() never allocates.
+   */
+  struct subtree_workspace {
+    explicit subtree_workspace(int n)
+        : z_propose_final(n),
+          p_init_end(n),
+          p_sharp_init_end(n),
+          p_final_beg(n),
+          p_sharp_final_beg(n),
+          rho_init(n),
+          rho_final(n),
+          rho_subtree(n) {}
+
+    ps_point z_propose_final;
+    Eigen::VectorXd p_init_end;
+    Eigen::VectorXd p_sharp_init_end;
+    Eigen::VectorXd p_final_beg;
+    Eigen::VectorXd p_sharp_final_beg;
+    Eigen::VectorXd rho_init;
+    Eigen::VectorXd rho_final;
+    Eigen::VectorXd rho_subtree;
+  };
+
+  /**
+   * Scratch storage for the trajectory state tracked by transition().
+   */
+  struct trajectory_workspace {
+    explicit trajectory_workspace(int n)
+        : z_fwd(n),
+          z_bck(n),
+          z_sample(n),
+          z_propose(n),
+          p_fwd_fwd(n),
+          p_sharp_fwd_fwd(n),
+          p_fwd_bck(n),
+          p_sharp_fwd_bck(n),
+          p_bck_fwd(n),
+          p_sharp_bck_fwd(n),
+          p_bck_bck(n),
+          p_sharp_bck_bck(n),
+          rho(n),
+          rho_fwd(n),
+          rho_bck(n),
+          rho_extended(n) {}
+
+    ps_point z_fwd;
+    ps_point z_bck;
+    ps_point z_sample;
+    ps_point z_propose;
+    Eigen::VectorXd p_fwd_fwd;
+    Eigen::VectorXd p_sharp_fwd_fwd;
+    Eigen::VectorXd p_fwd_bck;
+    Eigen::VectorXd p_sharp_fwd_bck;
+    Eigen::VectorXd p_bck_fwd;
+    Eigen::VectorXd p_sharp_bck_fwd;
+    Eigen::VectorXd p_bck_bck;
+    Eigen::VectorXd p_sharp_bck_bck;
+    Eigen::VectorXd rho;
+    Eigen::VectorXd rho_fwd;
+    Eigen::VectorXd rho_bck;
+    Eigen::VectorXd rho_extended;
+  };
+
+  /**
+   * Make sure scratch storage exists for subtrees of every depth
+   * below the given number of levels.  Storage only ever grows, so
+   * references into slots of smaller depths remain valid while the
+   * recursion in build_tree() is active.
+   *
+   * @param num_levels Number of tree depths that need storage
+   */
+  void resize_workspace(int num_levels) {
+    if (static_cast<int>(subtree_workspace_.size()) >= num_levels)
+      return;
+    int n = this->z_.q.size();
+    subtree_workspace_.reserve(num_levels);
+    while (static_cast<int>(subtree_workspace_.size()) < num_levels)
+      subtree_workspace_.emplace_back(n);
+  }
+
+  trajectory_workspace trajectory_workspace_{
+      static_cast<int>(this->z_.q.size())};
+  std::vector<subtree_workspace> subtree_workspace_;
+
+  /**
+   * Log weights H0 - h of the leaves of the subtree being built.
+   */
+  std::vector<double> leaf_log_weights_;
 };
 
 }  // namespace mcmc
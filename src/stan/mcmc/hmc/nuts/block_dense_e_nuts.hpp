@@ -0,0 +1,46 @@
+#ifndef STAN_MCMC_HMC_NUTS_BLOCK_DENSE_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_BLOCK_DENSE_E_NUTS_HPP
+
+#include <stan/mcmc/hmc/nuts/base_nuts.hpp>
+#include <stan/mcmc/hmc/hamiltonians/block_dense_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/block_dense_e_metric.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and block diagonal dense
+ * metric
+ */
+template <class Model, class BaseRNG>
+class block_dense_e_nuts
+    : public base_nuts<Model, block_dense_e_metric, expl_leapfrog, BaseRNG> {
+ public:
+  block_dense_e_nuts(const Model& model, BaseRNG& rng)
+      : base_nuts<Model, block_dense_e_metric, expl_leapfrog, BaseRNG>(model,
+                                                                       rng) {}
+
+  using base_nuts<Model, block_dense_e_metric, expl_leapfrog,
+                  BaseRNG>::set_metric;
+
+  /**
+   * Set the sizes of the consecutive parameter blocks and reset the
+   * metric to the identity.
+   *
+   * @param block_sizes sizes of the blocks, which must add up to the
+   *   number of parameters
+   */
+  void set_blocks(const std::vector<int>& block_sizes) {
+    this->z_.set_blocks(block_sizes);
+  }
+
+  void set_metric(const std::vector<Eigen::MatrixXd>& inv_e_metric) {
+    this->z_.set_metric(inv_e_metric);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -5,19 +5,25 @@
 #include <stan/mcmc/hmc/hamiltonians/diag_e_point.hpp>
 #include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
 #include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/integrators/expl_three_stage.hpp>
+#include <stan/mcmc/hmc/integrators/expl_two_stage.hpp>
 
 namespace stan {
 namespace mcmc {
 /**
  * The No-U-Turn sampler (NUTS) with multinomial sampling
  * with a Gaussian-Euclidean disintegration and diagonal metric
+ *
+ * The integrator is the leapfrog unless another is given, such as
+ * <code>expl_two_stage</code> or <code>expl_three_stage</code>.
  */
-template <class Model, class BaseRNG>
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
 class diag_e_nuts
-    : public base_nuts<Model, diag_e_metric, expl_leapfrog, BaseRNG> {
+    : public base_nuts<Model, diag_e_metric, Integrator, BaseRNG> {
  public:
   diag_e_nuts(const Model& model, BaseRNG& rng)
-      : base_nuts<Model, diag_e_metric, expl_leapfrog, BaseRNG>(model, rng) {}
+      : base_nuts<Model, diag_e_metric, Integrator, BaseRNG>(model, rng) {}
 };
 
 }  // namespace mcmc
@@ -0,0 +1,46 @@
+#ifndef STAN_MCMC_HMC_NUTS_DIAG_SOFTABS_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_DIAG_SOFTABS_NUTS_HPP
+
+#include <stan/mcmc/hmc/nuts/base_nuts.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_softabs_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_softabs_metric.hpp>
+#include <stan/mcmc/hmc/integrators/impl_leapfrog.hpp>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Riemannian disintegration and a diagonal SoftAbs
+ * metric built from a Hutchinson estimate of the diagonal of the Hessian
+ */
+template <class Model, class BaseRNG>
+class diag_softabs_nuts
+    : public base_nuts<Model, diag_softabs_metric, impl_leapfrog, BaseRNG> {
+  typedef base_nuts<Model, diag_softabs_metric, impl_leapfrog, BaseRNG>
+      base_nuts_t;
+
+ public:
+  diag_softabs_nuts(const Model& model, BaseRNG& rng)
+      : base_nuts_t(model, rng) {}
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->integrator_.reset_num_fixed_point_iterations();
+    return base_nuts_t::transition(init_sample, logger);
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    base_nuts_t::get_sampler_param_names(names);
+    names.push_back("n_fixed_point__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    base_nuts_t::get_sampler_params(values);
+    values.push_back(this->integrator_.num_fixed_point_iterations());
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
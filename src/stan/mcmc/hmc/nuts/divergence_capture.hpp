@@ -0,0 +1,143 @@
+#ifndef STAN_MCMC_HMC_NUTS_DIVERGENCE_CAPTURE_HPP
+#define STAN_MCMC_HMC_NUTS_DIVERGENCE_CAPTURE_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/math/prim.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Records the leapfrog states of a NUTS trajectory in a ring and writes
+ * them only if the trajectory diverges.
+ *
+ * Each state is stored as the number of the transition, counted from
+ * one, the position of the state in the trajectory, in leapfrog steps
+ * from the initial state and negative backwards in time, the potential
+ * energy, the energy error <code>H - H0</code> and the unconstrained
+ * parameters. The ring is allocated once for a given number of
+ * parameters and keeps the latest states, so for long trajectories the
+ * states closest to the divergence are the ones written.
+ *
+ * The names are written before the states of the first divergent
+ * trajectory; the states are written in the order they were integrated.
+ * Nothing is written without a writer.
+ */
+class divergence_capture {
+ public:
+  divergence_capture()
+      : writer_(nullptr),
+        capacity_(0),
+        num_transitions_(0),
+        start_(0),
+        size_(0),
+        position_fwd_(0),
+        position_bck_(0),
+        names_written_(false) {}
+
+  /**
+   * Set the writer divergent trajectories are written to.
+   *
+   * @param[in, out] writer writer, or a null pointer to stop capturing
+   * @param[in] capacity number of states kept from each trajectory
+   */
+  void set_writer(callbacks::writer* writer, size_t capacity) {
+    writer_ = writer;
+    capacity_ = std::max<size_t>(capacity, 1);
+    names_written_ = false;
+    states_.resize(0, 0);
+  }
+
+  bool enabled() const { return writer_ != nullptr; }
+
+  /**
+   * Start capturing a new trajectory from its initial state.
+   *
+   * @param[in] q unconstrained parameters of the initial state
+   * @param[in] V potential energy of the initial state
+   */
+  void start(const Eigen::VectorXd& q, double V) {
+    if (states_.rows() != q.size() + 4
+        || states_.cols() != static_cast<Eigen::Index>(capacity_))
+      states_.resize(q.size() + 4, capacity_);
+    ++num_transitions_;
+    start_ = 0;
+    size_ = 0;
+    position_fwd_ = 0;
+    position_bck_ = 0;
+    store(0, q, V, 0);
+  }
+
+  /**
+   * Record the next state integrated in a direction.
+   *
+   * @param[in] sign direction in time the state was integrated in
+   * @param[in] q unconstrained parameters
+   * @param[in] V potential energy
+   * @param[in] energy_error Hamiltonian less that of the initial state
+   */
+  void record(double sign, const Eigen::VectorXd& q, double V,
+              double energy_error) {
+    if (states_.cols() == 0)
+      return;
+    int position = sign > 0 ? ++position_fwd_ : -(++position_bck_);
+    store(position, q, V, energy_error);
+  }
+
+  /**
+   * Write the states recorded for the current trajectory.
+   */
+  void write() {
+    if (!writer_)
+      return;
+    if (!names_written_) {
+      std::vector<std::string> names{"transition__", "position__",
+                                     "potential__", "energy_error__"};
+      for (Eigen::Index i = 0; i < states_.rows() - 4; ++i)
+        names.push_back("q." + std::to_string(i + 1));
+      (*writer_)(names);
+      names_written_ = true;
+    }
+    row_.resize(states_.rows());
+    for (size_t n = 0; n < size_; ++n) {
+      Eigen::Map<Eigen::VectorXd>(row_.data(), row_.size())
+          = states_.col((start_ + n) % capacity_);
+      (*writer_)(row_);
+    }
+  }
+
+ private:
+  callbacks::writer* writer_;
+  size_t capacity_;
+  size_t num_transitions_;
+  // One state per column, overwriting the oldest once full
+  Eigen::MatrixXd states_;
+  size_t start_;
+  size_t size_;
+  int position_fwd_;
+  int position_bck_;
+  bool names_written_;
+  std::vector<double> row_;
+
+  void store(int position, const Eigen::VectorXd& q, double V,
+             double energy_error) {
+    size_t slot = (start_ + size_) % capacity_;
+    if (size_ < capacity_)
+      ++size_;
+    else
+      start_ = (start_ + 1) % capacity_;
+    auto state = states_.col(slot);
+    state(0) = num_transitions_;
+    state(1) = position;
+    state(2) = V;
+    state(3) = energy_error;
+    state.tail(q.size()) = q;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
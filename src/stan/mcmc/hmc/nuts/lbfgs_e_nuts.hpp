@@ -0,0 +1,33 @@
+#ifndef STAN_MCMC_HMC_NUTS_LBFGS_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_LBFGS_E_NUTS_HPP
+
+#include <stan/mcmc/hmc/nuts/base_nuts.hpp>
+#include <stan/mcmc/hmc/hamiltonians/lbfgs_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/lbfgs_e_metric.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and L-BFGS inverse Hessian
+ * metric
+ */
+template <class Model, class BaseRNG>
+class lbfgs_e_nuts
+    : public base_nuts<Model, lbfgs_e_metric, expl_leapfrog, BaseRNG> {
+ public:
+  lbfgs_e_nuts(const Model& model, BaseRNG& rng)
+      : base_nuts<Model, lbfgs_e_metric, expl_leapfrog, BaseRNG>(model, rng) {}
+
+  using base_nuts<Model, lbfgs_e_metric, expl_leapfrog, BaseRNG>::set_metric;
+
+  void set_metric(const Eigen::VectorXd& inv_e_metric, const Eigen::MatrixXd& s,
+                  const Eigen::MatrixXd& y) {
+    this->z_.set_metric(inv_e_metric, s, y);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
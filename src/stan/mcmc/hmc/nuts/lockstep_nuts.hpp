@@ -0,0 +1,716 @@
+#ifndef STAN_MCMC_HMC_NUTS_LOCKSTEP_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_LOCKSTEP_NUTS_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+#include <stan/mcmc/stepsize_adaptation.hpp>
+#include <stan/model/log_prob_grad.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Mask of the chains of a lock-step batch, true for the chains taking
+ * part in an operation.
+ */
+using chain_mask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+
+/**
+ * Batched gradient of a model, or of one model per chain, for
+ * <code>lockstep_nuts</code>. Each column is a chain, and the log density
+ * and its gradient are evaluated with <code>log_prob_grad()</code> for
+ * the columns of the active chains only.
+ *
+ * @tparam Model type of the model
+ */
+template <class Model>
+class model_batch_gradient {
+ public:
+  /**
+   * @param model model shared by all chains
+   * @param num_chains number of chains
+   */
+  model_batch_gradient(const Model& model, int num_chains)
+      : models_(num_chains, &model) {}
+
+  /**
+   * @param models model of each chain
+   */
+  explicit model_batch_gradient(const std::vector<const Model*>& models)
+      : models_(models) {}
+
+  /**
+   * @param q unconstrained parameters, one column per chain
+   * @param active chains to evaluate
+   * @param[out] lp log density of each active chain
+   * @param[out] grad gradient of each active chain, one column per chain
+   */
+  void operator()(const Eigen::MatrixXd& q, const chain_mask& active,
+                  Eigen::VectorXd& lp, Eigen::MatrixXd& grad) {
+    for (Eigen::Index k = 0; k < q.cols(); ++k) {
+      if (!active(k))
+        continue;
+      q_ = q.col(k);
+      try {
+        lp(k) = stan::model::log_prob_grad<true, true>(*models_[k], q_, grad_);
+        grad.col(k) = grad_;
+      } catch (const std::exception&) {
+        lp(k) = -std::numeric_limits<double>::infinity();
+      }
+    }
+  }
+
+ private:
+  std::vector<const Model*> models_;
+  Eigen::VectorXd q_;
+  Eigen::VectorXd grad_;
+};
+
+/**
+ * The No-U-Turn sampler with a Euclidean metric run over a batch of
+ * independent chains in lock-step, for many small models where one chain
+ * per thread leaves the vector units idle.
+ *
+ * The states are held as structure of arrays, one column per chain, so
+ * every leapfrog step updates the momenta and positions of all chains
+ * with whole-matrix operations and asks for the gradients of the whole
+ * batch in one call. The chains build their trajectories to the same
+ * depth together; a chain whose tree terminates, by a U-turn or a
+ * divergence, is masked out of the remaining steps and is no longer
+ * evaluated. Each chain has its own step size, inverse metric and
+ * generator, and draws from its generator exactly as it would if it ran
+ * alone, so a chain gives the same draws in any batch.
+ *
+ * The gradient is a functor called as
+ * <code>gradient(q, active, lp, grad)</code>, which writes the log
+ * density and its gradient of the active columns of <code>q</code>;
+ * <code>model_batch_gradient</code> adapts a model. The step sizes can be
+ * tuned per chain by dual averaging while adaptation is engaged.
+ *
+ * The metric is diagonal, one per chain, or dense and shared by all
+ * chains, as after cross-chain adaptation. With a dense metric the
+ * momenta of the batch are multiplied by the inverse metric in one
+ * matrix product per leapfrog step, so the d x d matrix is read once
+ * for the batch rather than once per chain.
+ *
+ * @tparam Gradient type of the batched gradient
+ * @tparam BaseRNG type of random number generator
+ */
+template <class Gradient, class BaseRNG>
+class lockstep_nuts {
+ public:
+  /**
+   * @param gradient batched gradient
+   * @param q initial unconstrained parameters, one column per chain
+   * @param rngs generator of each chain
+   * @throws std::invalid_argument if the number of generators does not
+   * match the number of chains
+   */
+  lockstep_nuts(Gradient& gradient, const Eigen::MatrixXd& q,
+                std::vector<BaseRNG>& rngs)
+      : gradient_(gradient),
+        rngs_(rngs),
+        dims_(q.rows()),
+        chains_(q.cols()),
+        max_depth_(10),
+        max_deltaH_(1000),
+        adapting_(false),
+        epsilon_(Eigen::ArrayXd::Constant(q.cols(), 1)),
+        inv_e_metric_(Eigen::MatrixXd::Ones(q.rows(), q.cols())),
+        dense_(false),
+        adaptations_(q.cols()),
+        depth_(q.cols()),
+        n_leapfrog_(q.cols()),
+        divergent_(q.cols()),
+        sum_metro_prob_(q.cols()),
+        accept_stat_(Eigen::ArrayXd::Zero(q.cols())),
+        energy_(Eigen::ArrayXd::Zero(q.cols())) {
+    if (static_cast<Eigen::Index>(rngs.size()) != chains_)
+      throw std::invalid_argument(
+          "lockstep_nuts: number of generators must match number of chains");
+    resize(z_);
+    resize(z_sample_);
+    resize(z_propose_);
+    z_.q = q;
+    z_.p.setZero();
+    gradient_(z_.q, chain_mask::Constant(chains_, true), z_.lp, z_.g);
+    z_sample_ = z_;
+    depth_.setZero();
+    n_leapfrog_.setZero();
+    divergent_.setConstant(false);
+  }
+
+  /**
+   * Set the step size of every chain.
+   */
+  void set_stepsize(double epsilon) {
+    if (epsilon > 0)
+      epsilon_.setConstant(epsilon);
+  }
+
+  /**
+   * Set the step size of each chain.
+   *
+   * @throws std::invalid_argument if the size does not match the number
+   * of chains
+   */
+  void set_stepsize(const Eigen::ArrayXd& epsilon) {
+    if (epsilon.size() != chains_)
+      throw std::invalid_argument(
+          "lockstep_nuts: number of step sizes must match number of chains");
+    epsilon_ = epsilon;
+  }
+
+  /**
+   * Set the diagonal inverse metric of each chain, one column per chain.
+   *
+   * @throws std::invalid_argument if the dimensions do not match those
+   * of the states
+   */
+  void set_inv_metric(const Eigen::MatrixXd& inv_e_metric) {
+    if (inv_e_metric.rows() != dims_ || inv_e_metric.cols() != chains_)
+      throw std::invalid_argument(
+          "lockstep_nuts: inverse metric must have one column per chain");
+    inv_e_metric_ = inv_e_metric;
+    dense_ = false;
+  }
+
+  /**
+   * Set a dense inverse metric shared by all chains.
+   *
+   * @throws std::invalid_argument if the matrix is not square with the
+   * dimension of the states, or not positive definite
+   */
+  void set_dense_inv_metric(const Eigen::MatrixXd& inv_e_metric) {
+    if (inv_e_metric.rows() != dims_ || inv_e_metric.cols() != dims_)
+      throw std::invalid_argument(
+          "lockstep_nuts: dense inverse metric must be square with the "
+          "dimension of the states");
+    Eigen::LLT<Eigen::MatrixXd> llt(inv_e_metric);
+    if (llt.info() != Eigen::Success)
+      throw std::invalid_argument(
+          "lockstep_nuts: dense inverse metric must be positive definite");
+    dense_inv_metric_ = inv_e_metric;
+    dense_inv_metric_factor_ = llt.matrixL();
+    dense_ = true;
+  }
+
+  /**
+   * Return true if the chains share a dense inverse metric.
+   */
+  bool dense_metric() const { return dense_; }
+
+  void set_max_depth(int d) {
+    if (d > 0)
+      max_depth_ = d;
+  }
+
+  void set_max_delta(double d) { max_deltaH_ = d; }
+
+  /**
+   * Start tuning the step sizes of the chains by dual averaging towards
+   * the given acceptance statistic, centered at ten times the current
+   * step sizes.
+   *
+   * @param delta target acceptance statistic
+   */
+  void engage_adaptation(double delta = 0.8) {
+    for (Eigen::Index k = 0; k < chains_; ++k) {
+      adaptations_[k].set_mu(std::log(10 * epsilon_(k)));
+      adaptations_[k].set_delta(delta);
+      adaptations_[k].restart();
+    }
+    adapting_ = true;
+  }
+
+  /**
+   * Stop tuning the step sizes and set them to their averaged values.
+   */
+  void disengage_adaptation() {
+    if (!adapting_)
+      return;
+    for (Eigen::Index k = 0; k < chains_; ++k)
+      adaptations_[k].complete_adaptation(epsilon_(k));
+    adapting_ = false;
+  }
+
+  bool adapting() const { return adapting_; }
+
+  /**
+   * Make one transition of every chain.
+   */
+  void transition() {
+    z_ = z_sample_;
+    for (Eigen::Index k = 0; k < chains_; ++k) {
+      p_col_.resize(dims_);
+      fill_std_normal(p_col_, rngs_[k]);
+      if (dense_)
+        z_.p.col(k) = p_col_;
+      else
+        z_.p.col(k) = p_col_.cwiseQuotient(inv_e_metric_.col(k).cwiseSqrt());
+    }
+    if (dense_)
+      dense_inv_metric_factor_.transpose()
+          .triangularView<Eigen::Upper>()
+          .solveInPlace(z_.p);
+    z_sample_ = z_;
+
+    z_fwd_ = z_;
+    z_bck_ = z_;
+
+    Eigen::MatrixXd p_sharp = dtau_dp(z_);
+    p_fwd_fwd_ = z_.p;
+    p_sharp_fwd_fwd_ = p_sharp;
+    p_fwd_bck_ = z_.p;
+    p_sharp_fwd_bck_ = p_sharp;
+    p_bck_fwd_ = z_.p;
+    p_sharp_bck_fwd_ = p_sharp;
+    p_bck_bck_ = z_.p;
+    p_sharp_bck_bck_ = p_sharp;
+    rho_ = z_.p;
+
+    Eigen::ArrayXd log_sum_weight = Eigen::ArrayXd::Zero(chains_);
+    const Eigen::ArrayXd H0 = hamiltonian(z_);
+    n_leapfrog_.setZero();
+    sum_metro_prob_.setZero();
+    divergent_.setConstant(false);
+    depth_.setZero();
+
+    chain_mask running = chain_mask::Constant(chains_, true);
+    chain_mask forward(chains_);
+    Eigen::ArrayXd step(chains_);
+    Eigen::ArrayXd log_sum_weight_subtree(chains_);
+
+    for (int depth = 0; depth < max_depth_ && running.any(); ++depth) {
+      resize_workspace(depth + 1);
+      rho_fwd_.setZero(dims_, chains_);
+      rho_bck_.setZero(dims_, chains_);
+      log_sum_weight_subtree.setConstant(
+          -std::numeric_limits<double>::infinity());
+
+      // Each running chain extends its trajectory in its own direction
+      for (Eigen::Index k = 0; k < chains_; ++k) {
+        step(k) = 0;
+        if (!running(k))
+          continue;
+        forward(k) = rand_uniform(k) > 0.5;
+        if (forward(k)) {
+          copy_col(z_, z_fwd_, k);
+          rho_bck_.col(k) = rho_.col(k);
+          p_bck_fwd_.col(k) = p_fwd_fwd_.col(k);
+          p_sharp_bck_fwd_.col(k) = p_sharp_fwd_fwd_.col(k);
+          step(k) = epsilon_(k);
+        } else {
+          copy_col(z_, z_bck_, k);
+          rho_fwd_.col(k) = rho_.col(k);
+          p_fwd_bck_.col(k) = p_bck_bck_.col(k);
+          p_sharp_fwd_bck_.col(k) = p_sharp_bck_bck_.col(k);
+          step(k) = -epsilon_(k);
+        }
+      }
+
+      // The new subtree is written into the ends of the side it extends
+      gather_ends();
+      chain_mask valid = build_subtree(
+          depth, running, z_propose_, sub_p_sharp_beg_, sub_p_sharp_end_,
+          sub_rho_, sub_p_beg_, sub_p_end_, H0, step, log_sum_weight_subtree);
+      scatter_ends(forward, running);
+
+      for (Eigen::Index k = 0; k < chains_; ++k) {
+        if (!running(k))
+          continue;
+        if (!valid(k)) {
+          running(k) = false;
+          continue;
+        }
+        ++depth_(k);
+
+        // Sample from the accepted subtree
+        double log_weight_ratio
+            = log_sum_weight_subtree(k) - log_sum_weight(k);
+        if (log_weight_ratio > 0) {
+          copy_col(z_sample_, z_propose_, k);
+          log_sum_weight(k) = log_sum_weight_subtree(k)
+                              + std::log1p(std::exp(-log_weight_ratio));
+        } else {
+          double accept_prob = std::exp(log_weight_ratio);
+          if (rand_uniform(k) < accept_prob)
+            copy_col(z_sample_, z_propose_, k);
+          log_sum_weight(k) += std::log1p(accept_prob);
+        }
+
+        // Demand satisfaction around the merged subtrees
+        rho_.col(k) = rho_bck_.col(k) + rho_fwd_.col(k);
+        bool persist = criterion(p_sharp_bck_bck_.col(k),
+                                 p_sharp_fwd_fwd_.col(k), rho_.col(k));
+        rho_extended_ = rho_bck_.col(k) + p_fwd_bck_.col(k);
+        persist &= criterion(p_sharp_bck_bck_.col(k),
+                             p_sharp_fwd_bck_.col(k), rho_extended_);
+        rho_extended_ = rho_fwd_.col(k) + p_bck_fwd_.col(k);
+        persist &= criterion(p_sharp_bck_fwd_.col(k),
+                             p_sharp_fwd_fwd_.col(k), rho_extended_);
+        if (!persist)
+          running(k) = false;
+      }
+    }
+
+    accept_stat_ = sum_metro_prob_ / n_leapfrog_.cast<double>();
+    energy_ = hamiltonian(z_sample_);
+
+    if (adapting_)
+      for (Eigen::Index k = 0; k < chains_; ++k)
+        adaptations_[k].learn_stepsize(epsilon_(k), accept_stat_(k));
+  }
+
+  Eigen::Index num_chains() const { return chains_; }
+
+  /**
+   * Return the current draws, one column per chain.
+   */
+  const Eigen::MatrixXd& q() const { return z_sample_.q; }
+
+  /**
+   * Return the log density of the current draw of each chain.
+   */
+  const Eigen::VectorXd& lp() const { return z_sample_.lp; }
+
+  const Eigen::ArrayXd& stepsize() const { return epsilon_; }
+  const Eigen::ArrayXd& accept_stat() const { return accept_stat_; }
+  const Eigen::ArrayXi& treedepth() const { return depth_; }
+  const Eigen::ArrayXi& n_leapfrog() const { return n_leapfrog_; }
+  const chain_mask& divergent() const { return divergent_; }
+  const Eigen::ArrayXd& energy() const { return energy_; }
+
+ private:
+  /**
+   * Positions, momenta, log densities and their gradients of the
+   * batch, one column per chain.
+   */
+  struct batch_state {
+    Eigen::MatrixXd q;
+    Eigen::MatrixXd p;
+    Eigen::MatrixXd g;
+    Eigen::VectorXd lp;
+  };
+
+  /**
+   * Scratch storage of one depth of the subtree recursion.
+   */
+  struct subtree_workspace {
+    batch_state z_propose_final;
+    Eigen::MatrixXd p_init_end;
+    Eigen::MatrixXd p_sharp_init_end;
+    Eigen::MatrixXd p_final_beg;
+    Eigen::MatrixXd p_sharp_final_beg;
+    Eigen::MatrixXd rho_init;
+    Eigen::MatrixXd rho_final;
+    Eigen::ArrayXd log_sum_weight_init;
+    Eigen::ArrayXd log_sum_weight_final;
+  };
+
+  Gradient& gradient_;
+  std::vector<BaseRNG>& rngs_;
+  Eigen::Index dims_;
+  Eigen::Index chains_;
+  int max_depth_;
+  double max_deltaH_;
+  bool adapting_;
+
+  Eigen::ArrayXd epsilon_;
+  Eigen::MatrixXd inv_e_metric_;
+  bool dense_;
+  Eigen::MatrixXd dense_inv_metric_;
+  Eigen::MatrixXd dense_inv_metric_factor_;
+  std::vector<stepsize_adaptation> adaptations_;
+
+  Eigen::ArrayXi depth_;
+  Eigen::ArrayXi n_leapfrog_;
+  chain_mask divergent_;
+  Eigen::ArrayXd sum_metro_prob_;
+  Eigen::ArrayXd accept_stat_;
+  Eigen::ArrayXd energy_;
+
+  batch_state z_;
+  batch_state z_sample_;
+  batch_state z_propose_;
+  batch_state z_fwd_;
+  batch_state z_bck_;
+
+  Eigen::MatrixXd p_fwd_fwd_, p_sharp_fwd_fwd_;
+  Eigen::MatrixXd p_fwd_bck_, p_sharp_fwd_bck_;
+  Eigen::MatrixXd p_bck_fwd_, p_sharp_bck_fwd_;
+  Eigen::MatrixXd p_bck_bck_, p_sharp_bck_bck_;
+  Eigen::MatrixXd rho_, rho_fwd_, rho_bck_;
+  Eigen::MatrixXd sub_p_sharp_beg_, sub_p_sharp_end_;
+  Eigen::MatrixXd sub_p_beg_, sub_p_end_, sub_rho_;
+  Eigen::VectorXd rho_extended_;
+  Eigen::VectorXd p_col_;
+  Eigen::MatrixXd p_sharp_;
+
+  std::vector<subtree_workspace> subtree_workspace_;
+
+  void resize(batch_state& z) const {
+    z.q.resize(dims_, chains_);
+    z.p.resize(dims_, chains_);
+    z.g.resize(dims_, chains_);
+    z.lp.resize(chains_);
+  }
+
+  /**
+   * Grow the scratch storage of the recursion to at least the given
+   * number of depths.
+   */
+  void resize_workspace(size_t depths) {
+    while (subtree_workspace_.size() < depths) {
+      subtree_workspace_.emplace_back();
+      resize(subtree_workspace_.back().z_propose_final);
+    }
+  }
+
+  static void copy_col(batch_state& to, const batch_state& from,
+                       Eigen::Index k) {
+    to.q.col(k) = from.q.col(k);
+    to.p.col(k) = from.p.col(k);
+    to.g.col(k) = from.g.col(k);
+    to.lp(k) = from.lp(k);
+  }
+
+  double rand_uniform(Eigen::Index k) {
+    boost::uniform_01<> uniform;
+    return uniform(rngs_[k]);
+  }
+
+  /**
+   * Return the Hamiltonian of each chain, given the sharp momenta of the
+   * state.
+   */
+  Eigen::ArrayXd hamiltonian(const batch_state& z,
+                             const Eigen::MatrixXd& p_sharp) const {
+    return 0.5 * z.p.cwiseProduct(p_sharp).colwise().sum().transpose().array()
+           - z.lp.array();
+  }
+
+  /**
+   * Return the Hamiltonian of each chain.
+   */
+  Eigen::ArrayXd hamiltonian(const batch_state& z) const {
+    return hamiltonian(z, dtau_dp(z));
+  }
+
+  /**
+   * Return the sharp momenta of the batch. A dense metric is applied to
+   * all the chains in one matrix product.
+   */
+  Eigen::MatrixXd dtau_dp(const batch_state& z) const {
+    if (dense_)
+      return dense_inv_metric_ * z.p;
+    return inv_e_metric_.cwiseProduct(z.p);
+  }
+
+  static bool criterion(const Eigen::VectorXd& p_sharp_minus,
+                        const Eigen::VectorXd& p_sharp_plus,
+                        const Eigen::VectorXd& rho) {
+    return p_sharp_plus.dot(rho) > 0 && p_sharp_minus.dot(rho) > 0;
+  }
+
+  /**
+   * Prepare the ends of the new subtrees, whose summed momenta start at
+   * zero.
+   */
+  void gather_ends() {
+    sub_p_sharp_beg_.resize(dims_, chains_);
+    sub_p_sharp_end_.resize(dims_, chains_);
+    sub_p_beg_.resize(dims_, chains_);
+    sub_p_end_.resize(dims_, chains_);
+    sub_rho_.setZero(dims_, chains_);
+  }
+
+  /**
+   * Store the ends of the new subtree in the side each chain extended.
+   */
+  void scatter_ends(const chain_mask& forward, const chain_mask& running) {
+    for (Eigen::Index k = 0; k < chains_; ++k) {
+      if (!running(k))
+        continue;
+      if (forward(k)) {
+        p_sharp_fwd_bck_.col(k) = sub_p_sharp_beg_.col(k);
+        p_sharp_fwd_fwd_.col(k) = sub_p_sharp_end_.col(k);
+        rho_fwd_.col(k) = sub_rho_.col(k);
+        p_fwd_bck_.col(k) = sub_p_beg_.col(k);
+        p_fwd_fwd_.col(k) = sub_p_end_.col(k);
+        copy_col(z_fwd_, z_, k);
+      } else {
+        p_sharp_bck_fwd_.col(k) = sub_p_sharp_beg_.col(k);
+        p_sharp_bck_bck_.col(k) = sub_p_sharp_end_.col(k);
+        rho_bck_.col(k) = sub_rho_.col(k);
+        p_bck_fwd_.col(k) = sub_p_beg_.col(k);
+        p_bck_bck_.col(k) = sub_p_end_.col(k);
+        copy_col(z_bck_, z_, k);
+      }
+    }
+  }
+
+  /**
+   * Take one leapfrog step of the active chains, evaluating the
+   * gradients of the batch once.
+   *
+   * @param step signed step size of each chain, zero if inactive
+   * @param active chains to move
+   */
+  void leapfrog(const Eigen::ArrayXd& step, const chain_mask& active) {
+    Eigen::RowVectorXd half = 0.5 * step.matrix().transpose();
+    z_.p.noalias() += z_.g * half.asDiagonal();
+    p_sharp_ = dtau_dp(z_);
+    z_.q.noalias() += p_sharp_ * step.matrix().asDiagonal();
+    gradient_(z_.q, active, z_.lp, z_.g);
+    z_.p.noalias() += z_.g * half.asDiagonal();
+  }
+
+  /**
+   * Recursively build a new subtree of every active chain, as
+   * <code>base_nuts::build_subtree()</code> does for one chain. Returns
+   * which of the active chains built a valid subtree; the others are
+   * left out of the rest of the subtree.
+   *
+   * @param depth Depth of the desired subtree
+   * @param active Chains building the subtree
+   * @param z_propose States proposed from subtree
+   * @param p_sharp_beg Sharp momenta at beginning of new tree
+   * @param p_sharp_end Sharp momenta at end of new tree
+   * @param rho Summed momenta across trajectory
+   * @param p_beg Momenta at beginning of returned tree
+   * @param p_end Momenta at end of returned tree
+   * @param H0 Hamiltonian of initial state of each chain
+   * @param step Signed step size of each chain
+   * @param log_sum_weight Log of summed weights across trajectory
+   */
+  chain_mask build_subtree(int depth, const chain_mask& active,
+                           batch_state& z_propose,
+                           Eigen::MatrixXd& p_sharp_beg,
+                           Eigen::MatrixXd& p_sharp_end, Eigen::MatrixXd& rho,
+                           Eigen::MatrixXd& p_beg, Eigen::MatrixXd& p_end,
+                           const Eigen::ArrayXd& H0,
+                           const Eigen::ArrayXd& step,
+                           Eigen::ArrayXd& log_sum_weight) {
+    // Base case
+    if (depth == 0) {
+      leapfrog(active.select(step, 0.0), active);
+      n_leapfrog_ += active.cast<int>();
+      p_sharp_ = dtau_dp(z_);
+      Eigen::ArrayXd h = hamiltonian(z_, p_sharp_);
+      chain_mask valid = active;
+      for (Eigen::Index k = 0; k < chains_; ++k) {
+        if (!active(k))
+          continue;
+        if (std::isnan(h(k)))
+          h(k) = std::numeric_limits<double>::infinity();
+        if ((h(k) - H0(k)) > max_deltaH_) {
+          divergent_(k) = true;
+          valid(k) = false;
+        }
+        log_sum_weight(k) = math::log_sum_exp(log_sum_weight(k), H0(k) - h(k));
+        // Leaves with higher energy than the initial state are accepted
+        // with probability exp(H0 - h), the others always
+        sum_metro_prob_(k) += std::exp(std::min(0.0, H0(k) - h(k)));
+
+        copy_col(z_propose, z_, k);
+        p_sharp_beg.col(k) = p_sharp_.col(k);
+        p_sharp_end.col(k) = p_sharp_beg.col(k);
+        rho.col(k) += z_.p.col(k);
+        p_beg.col(k) = z_.p.col(k);
+        p_end.col(k) = p_beg.col(k);
+      }
+      return valid;
+    }
+    // General recursion
+
+    // Scratch storage reserved for this depth; deeper recursive calls
+    // only ever touch the slots of strictly smaller depths
+    resize_workspace(depth + 1);
+    subtree_workspace& ws = subtree_workspace_[depth];
+
+    // Build the initial subtree
+    ws.log_sum_weight_init.setConstant(
+        chains_, -std::numeric_limits<double>::infinity());
+    ws.p_init_end.resize(dims_, chains_);
+    ws.p_sharp_init_end.resize(dims_, chains_);
+    ws.rho_init.setZero(dims_, chains_);
+
+    chain_mask valid_init = build_subtree(
+        depth - 1, active, z_propose, p_sharp_beg, ws.p_sharp_init_end,
+        ws.rho_init, p_beg, ws.p_init_end, H0, step, ws.log_sum_weight_init);
+
+    if (!valid_init.any())
+      return valid_init;
+
+    // Build the final subtree
+    batch_state& z_propose_final = ws.z_propose_final;
+    for (Eigen::Index k = 0; k < chains_; ++k)
+      if (valid_init(k))
+        copy_col(z_propose_final, z_, k);
+
+    ws.log_sum_weight_final.setConstant(
+        chains_, -std::numeric_limits<double>::infinity());
+    ws.p_final_beg.resize(dims_, chains_);
+    ws.p_sharp_final_beg.resize(dims_, chains_);
+    ws.rho_final.setZero(dims_, chains_);
+
+    chain_mask valid = build_subtree(
+        depth - 1, valid_init, z_propose_final, ws.p_sharp_final_beg,
+        p_sharp_end, ws.rho_final, ws.p_final_beg, p_end, H0, step,
+        ws.log_sum_weight_final);
+
+    for (Eigen::Index k = 0; k < chains_; ++k) {
+      if (!valid(k))
+        continue;
+
+      // Multinomial sample from right subtree
+      double log_init = ws.log_sum_weight_init(k);
+      double log_final = ws.log_sum_weight_final(k);
+      double log_sum_weight_subtree;
+      double accept_prob;
+      if (log_final > log_init) {
+        double ratio = std::exp(log_init - log_final);
+        log_sum_weight_subtree = log_final + std::log1p(ratio);
+        accept_prob = 1 / (1 + ratio);
+      } else {
+        double ratio = std::exp(log_final - log_init);
+        log_sum_weight_subtree = log_init + std::log1p(ratio);
+        accept_prob = ratio / (1 + ratio);
+      }
+      log_sum_weight(k)
+          = math::log_sum_exp(log_sum_weight(k), log_sum_weight_subtree);
+
+      if (rand_uniform(k) < accept_prob)
+        copy_col(z_propose, z_propose_final, k);
+
+      rho_extended_ = ws.rho_init.col(k) + ws.rho_final.col(k);
+      rho.col(k) += rho_extended_;
+
+      // Demand satisfaction around merged subtrees
+      bool persist
+          = criterion(p_sharp_beg.col(k), p_sharp_end.col(k), rho_extended_);
+
+      // Demand satisfaction between subtrees
+      rho_extended_ = ws.rho_init.col(k) + ws.p_final_beg.col(k);
+      persist &= criterion(p_sharp_beg.col(k), ws.p_sharp_final_beg.col(k),
+                           rho_extended_);
+
+      rho_extended_ = ws.rho_final.col(k) + ws.p_init_end.col(k);
+      persist &= criterion(ws.p_sharp_init_end.col(k), p_sharp_end.col(k),
+                           rho_extended_);
+
+      valid(k) = persist;
+    }
+    return valid;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
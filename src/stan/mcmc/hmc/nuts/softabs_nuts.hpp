@@ -5,6 +5,8 @@
 #include <stan/mcmc/hmc/hamiltonians/softabs_point.hpp>
 #include <stan/mcmc/hmc/hamiltonians/softabs_metric.hpp>
 #include <stan/mcmc/hmc/integrators/impl_leapfrog.hpp>
+#include <string>
+#include <vector>
 
 namespace stan {
 namespace mcmc {
@@ -15,9 +17,26 @@ namespace mcmc {
 template <class Model, class BaseRNG>
 class softabs_nuts
     : public base_nuts<Model, softabs_metric, impl_leapfrog, BaseRNG> {
+  typedef base_nuts<Model, softabs_metric, impl_leapfrog, BaseRNG> base_nuts_t;
+
  public:
   softabs_nuts(const Model& model, BaseRNG& rng)
       : base_nuts<Model, softabs_metric, impl_leapfrog, BaseRNG>(model, rng) {}
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->integrator_.reset_num_fixed_point_iterations();
+    return base_nuts_t::transition(init_sample, logger);
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    base_nuts_t::get_sampler_param_names(names);
+    names.push_back("n_fixed_point__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    base_nuts_t::get_sampler_params(values);
+    values.push_back(this->integrator_.num_fixed_point_iterations());
+  }
 };
 
 }  // namespace mcmc
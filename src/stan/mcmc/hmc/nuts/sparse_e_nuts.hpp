@@ -0,0 +1,39 @@
+#ifndef STAN_MCMC_HMC_NUTS_SPARSE_E_NUTS_HPP
+#define STAN_MCMC_HMC_NUTS_SPARSE_E_NUTS_HPP
+
+#include <stan/mcmc/hmc/nuts/base_nuts.hpp>
+#include <stan/mcmc/hmc/hamiltonians/sparse_e_point.hpp>
+#include <stan/mcmc/hmc/hamiltonians/sparse_e_metric.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+
+namespace stan {
+namespace mcmc {
+/**
+ * The No-U-Turn sampler (NUTS) with multinomial sampling
+ * with a Gaussian-Euclidean disintegration and sparse metric
+ */
+template <class Model, class BaseRNG>
+class sparse_e_nuts
+    : public base_nuts<Model, sparse_e_metric, expl_leapfrog, BaseRNG> {
+ public:
+  sparse_e_nuts(const Model& model, BaseRNG& rng)
+      : base_nuts<Model, sparse_e_metric, expl_leapfrog, BaseRNG>(model,
+                                                                  rng) {}
+
+  /**
+   * Set the mass matrix, such as the precision of a Gaussian Markov
+   * random field.
+   *
+   * @param e_metric sparse symmetric positive definite mass matrix
+   *   with both triangles
+   * @throws std::invalid_argument if the matrix has the wrong size or
+   *   isn't positive definite
+   */
+  void set_metric(const Eigen::SparseMatrix<double>& e_metric) {
+    this->z_.set_metric(e_metric);
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
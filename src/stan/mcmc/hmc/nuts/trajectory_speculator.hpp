@@ -0,0 +1,164 @@
+#ifndef STAN_MCMC_HMC_NUTS_TRAJECTORY_SPECULATOR_HPP
+#define STAN_MCMC_HMC_NUTS_TRAJECTORY_SPECULATOR_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/recording_logger.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <tbb/task_group.h>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Integrates one end of a NUTS trajectory in the background while the
+ * sampler extends the other end.
+ *
+ * The leapfrog states of an explicit integrator depend only on the
+ * starting state, the metric and the step size, and not on the random
+ * number generator. States integrated ahead of time are therefore
+ * exactly the states the sampler would compute itself, so taking them
+ * from the cache leaves the draws and the random number stream
+ * unchanged. Messages logged while integrating a state are recorded
+ * and replayed when that state is taken, so the log is unchanged too.
+ *
+ * Only one direction may be integrated at a time, and the sampler may
+ * only take states of the other direction until <code>wait()</code> or
+ * <code>cancel()</code> returns. Copies start out empty, so a copied
+ * sampler never shares cached states or a background task with the
+ * original.
+ *
+ * @tparam Hamiltonian type of the Hamiltonian
+ * @tparam Integrator type of the explicit integrator
+ */
+template <class Hamiltonian, class Integrator>
+class trajectory_speculator {
+ public:
+  typedef typename Hamiltonian::PointType point_t;
+
+  trajectory_speculator() : stop_(false) {}
+
+  trajectory_speculator(const trajectory_speculator& other) : stop_(false) {}
+
+  trajectory_speculator& operator=(const trajectory_speculator& other) {
+    cancel();
+    cache_[0].clear();
+    cache_[1].clear();
+    return *this;
+  }
+
+  ~trajectory_speculator() noexcept { cancel(); }
+
+  /**
+   * Discard the cached states of both directions. The metric of the
+   * given point is used for all states integrated until the next
+   * reset.
+   *
+   * @param z current point of the sampler
+   */
+  void reset(const point_t& z) {
+    cancel();
+    if (z_)
+      *z_ = z;
+    else
+      z_.reset(new point_t(z));
+    cache_[0].clear();
+    cache_[1].clear();
+  }
+
+  /**
+   * Start integrating in the background. <code>reset()</code> must
+   * have been called first. Integration continues from
+   * the last cached state of the direction, or from the given end of
+   * the trajectory if there is none.
+   *
+   * @param hamiltonian Hamiltonian, which is copied
+   * @param end current end of the trajectory in the direction
+   * @param sign direction in time
+   * @param epsilon step size
+   * @param num_steps number of states to add to the cache
+   * @param H0 Hamiltonian of the initial state
+   * @param max_deltaH divergence threshold; integration stops early
+   *   once a state diverges
+   */
+  void run(Hamiltonian& hamiltonian, const ps_point& end, double sign,
+           double epsilon, int num_steps, double H0, double max_deltaH) {
+    cancel();
+    std::deque<cached_state>& cache = cache_[sign > 0];
+    z_->ps_point::operator=(cache.empty() ? end : cache.back().z);
+    stop_ = false;
+    group_.run([this, &cache, hamiltonian, sign, epsilon, num_steps, H0,
+                max_deltaH]() {
+      Hamiltonian local_hamiltonian(hamiltonian);
+      Integrator integrator;
+      for (int i = 0; i < num_steps && !stop_; ++i) {
+        cached_state state(*z_);
+        integrator.evolve(*z_, local_hamiltonian, sign * epsilon,
+                          state.messages);
+        state.z = *z_;
+        cache.push_back(std::move(state));
+        double h = local_hamiltonian.H(*z_);
+        if (std::isnan(h) || h - H0 > max_deltaH)
+          break;
+      }
+    });
+  }
+
+  /**
+   * Wait for the background integration to finish.
+   */
+  void wait() { group_.wait(); }
+
+  /**
+   * Request the background integration to stop after the current state
+   * and wait for it.
+   */
+  void cancel() {
+    stop_ = true;
+    group_.wait();
+  }
+
+  /**
+   * Take the next cached state of a direction, replaying the messages
+   * logged while it was integrated.
+   *
+   * @param sign direction in time
+   * @param[out] z point whose phase space state is set
+   * @param logger logger to replay messages to
+   * @return false if no state of the direction is cached
+   */
+  bool take(double sign, ps_point& z, callbacks::logger& logger) {
+    std::deque<cached_state>& cache = cache_[sign > 0];
+    if (cache.empty())
+      return false;
+    z = cache.front().z;
+    cache.front().messages.replay(logger);
+    cache.pop_front();
+    return true;
+  }
+
+ private:
+  struct cached_state {
+    explicit cached_state(const ps_point& point) : z(point) {}
+
+    ps_point z;
+    callbacks::recording_logger messages;
+  };
+
+  // Point being integrated, which carries the metric of the sampler
+  std::unique_ptr<point_t> z_;
+  std::deque<cached_state> cache_[2];
+  std::atomic<bool> stop_;
+  tbb::task_group group_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,133 @@
+#ifndef STAN_MCMC_HMC_NUTS_TREEDEPTH_MONITOR_HPP
+#define STAN_MCMC_HMC_NUTS_TREEDEPTH_MONITOR_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <algorithm>
+#include <sstream>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Watches the tree depth of NUTS transitions during warmup and bounds
+ * their cost.
+ *
+ * The warmup transitions are counted in windows of
+ * <code>window_size</code> transitions. The first time the trajectories
+ * of at least <code>threshold</code> of the transitions of a window hit
+ * the depth limit a warning is logged, so that a badly scaled or badly
+ * parameterized model is reported while it is still warming up instead
+ * of after the run.
+ *
+ * With a positive gradient budget the depth of warmup trajectories is
+ * further limited so that a trajectory takes at most
+ * <code>budget</code> leapfrog steps, which bounds the cost of early
+ * warmup transitions taken with a poor step size or metric. The depth
+ * of trajectories after warmup is never limited by the budget, so the
+ * draws are those of the sampler with its maximum tree depth.
+ */
+class treedepth_monitor {
+ public:
+  treedepth_monitor()
+      : gradient_budget_(0),
+        window_size_(50),
+        threshold_(0.2),
+        num_window_(0),
+        num_window_saturated_(0),
+        num_saturated_(0),
+        warned_(false) {}
+
+  /**
+   * Set the largest number of leapfrog steps of a warmup trajectory.
+   *
+   * @param[in] budget number of gradient evaluations, or zero or less
+   *   to not limit warmup trajectories
+   */
+  void set_gradient_budget(int budget) { gradient_budget_ = budget; }
+
+  int get_gradient_budget() const { return gradient_budget_; }
+
+  /**
+   * Set how saturated warmup transitions are reported.
+   *
+   * @param[in] window_size number of transitions per window, at least 1
+   * @param[in] threshold fraction of a window that hits the depth limit
+   *   before the warning is logged
+   */
+  void set_window(int window_size, double threshold) {
+    window_size_ = std::max(window_size, 1);
+    threshold_ = threshold;
+  }
+
+  /**
+   * Return the depth limit of a warmup transition: the largest depth
+   * whose trajectory of <code>2^depth - 1</code> leapfrog steps fits
+   * the gradient budget, but at least one and at most
+   * <code>max_depth</code>.
+   *
+   * @param[in] max_depth maximum tree depth of the sampler
+   * @return depth limit of warmup transitions
+   */
+  int depth_limit(int max_depth) const {
+    if (gradient_budget_ <= 0)
+      return max_depth;
+    int depth = 1;
+    while (depth < std::min(max_depth, 30)
+           && (2 << depth) - 1 <= gradient_budget_)
+      ++depth;
+    return depth;
+  }
+
+  /**
+   * Record a warmup transition and log the warning at the end of the
+   * first window in which too many transitions hit the depth limit.
+   *
+   * @param[in] depth tree depth of the transition
+   * @param[in] limit depth limit the transition was built with
+   * @param[in] max_depth maximum tree depth of the sampler
+   * @param[in,out] logger logger for the warning
+   */
+  void record(int depth, int limit, int max_depth,
+              callbacks::logger& logger) {
+    ++num_window_;
+    if (depth >= limit) {
+      ++num_window_saturated_;
+      ++num_saturated_;
+    }
+    if (num_window_ < window_size_)
+      return;
+    if (!warned_ && num_window_saturated_ >= threshold_ * num_window_) {
+      std::stringstream msg;
+      msg << "Warning: " << num_window_saturated_ << " of the last "
+          << num_window_ << " warmup transitions hit the tree depth limit "
+          << "of " << limit;
+      if (limit < max_depth)
+        msg << " set by the gradient budget of " << gradient_budget_;
+      msg << ". The step size or metric may be poorly adapted; "
+          << "consider reparameterizing the model or increasing "
+          << "max_depth.";
+      logger.warn(msg);
+      warned_ = true;
+    }
+    num_window_ = 0;
+    num_window_saturated_ = 0;
+  }
+
+  /**
+   * Return the number of warmup transitions that hit the depth limit.
+   */
+  int num_saturated() const { return num_saturated_; }
+
+ private:
+  int gradient_budget_;
+  int window_size_;
+  double threshold_;
+  int num_window_;
+  int num_window_saturated_;
+  int num_saturated_;
+  bool warned_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
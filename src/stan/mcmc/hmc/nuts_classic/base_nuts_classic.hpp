@@ -65,7 +65,7 @@ class base_nuts_classic
     this->seed(init_sample.cont_params());
 
     this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
+    this->init_transition(logger);
 
     ps_point z_plus(this->z_);
     ps_point z_minus(z_plus);
@@ -13,19 +13,22 @@ namespace mcmc {
  * Gaussian-Euclidean disintegration and adaptive dense metric and
  * adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_dense_e_static_hmc : public dense_e_static_hmc<Model, BaseRNG>,
-                                 public stepsize_covar_adapter {
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_dense_e_static_hmc
+    : public dense_e_static_hmc<Model, BaseRNG, Integrator>,
+      public stepsize_covar_adapter {
  public:
   adapt_dense_e_static_hmc(const Model& model, BaseRNG& rng)
-      : dense_e_static_hmc<Model, BaseRNG>(model, rng),
+      : dense_e_static_hmc<Model, BaseRNG, Integrator>(model, rng),
         stepsize_covar_adapter(model.num_params_r()) {}
 
   ~adapt_dense_e_static_hmc() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
     sample s
-        = dense_e_static_hmc<Model, BaseRNG>::transition(init_sample, logger);
+        = dense_e_static_hmc<Model, BaseRNG, Integrator>::transition(
+            init_sample, logger);
 
     if (this->adapt_flag_) {
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
@@ -36,6 +39,7 @@ class adapt_dense_e_static_hmc : public dense_e_static_hmc<Model, BaseRNG>,
           this->z_.inv_e_metric_, this->z_.q);
 
       if (update) {
+        this->z_.update_metric_factor();
         this->init_stepsize(logger);
         this->update_L_();
 
@@ -13,19 +13,22 @@ namespace mcmc {
  * Gaussian-Euclidean disintegration and adaptive diagonal metric and
  * adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_diag_e_static_hmc : public diag_e_static_hmc<Model, BaseRNG>,
-                                public stepsize_var_adapter {
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_diag_e_static_hmc
+    : public diag_e_static_hmc<Model, BaseRNG, Integrator>,
+      public stepsize_var_adapter {
  public:
   adapt_diag_e_static_hmc(const Model& model, BaseRNG& rng)
-      : diag_e_static_hmc<Model, BaseRNG>(model, rng),
+      : diag_e_static_hmc<Model, BaseRNG, Integrator>(model, rng),
         stepsize_var_adapter(model.num_params_r()) {}
 
   ~adapt_diag_e_static_hmc() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
     sample s
-        = diag_e_static_hmc<Model, BaseRNG>::transition(init_sample, logger);
+        = diag_e_static_hmc<Model, BaseRNG, Integrator>::transition(init_sample,
+                                                                    logger);
 
     if (this->adapt_flag_) {
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
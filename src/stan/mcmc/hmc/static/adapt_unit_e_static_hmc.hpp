@@ -13,18 +13,21 @@ namespace mcmc {
  * Gaussian-Euclidean disintegration and unit metric and
  * adaptive step size
  */
-template <class Model, class BaseRNG>
-class adapt_unit_e_static_hmc : public unit_e_static_hmc<Model, BaseRNG>,
-                                public stepsize_adapter {
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
+class adapt_unit_e_static_hmc
+    : public unit_e_static_hmc<Model, BaseRNG, Integrator>,
+      public stepsize_adapter {
  public:
   adapt_unit_e_static_hmc(const Model& model, BaseRNG& rng)
-      : unit_e_static_hmc<Model, BaseRNG>(model, rng) {}
+      : unit_e_static_hmc<Model, BaseRNG, Integrator>(model, rng) {}
 
   ~adapt_unit_e_static_hmc() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
     sample s
-        = unit_e_static_hmc<Model, BaseRNG>::transition(init_sample, logger);
+        = unit_e_static_hmc<Model, BaseRNG, Integrator>::transition(init_sample,
+                                                                    logger);
 
     if (this->adapt_flag_) {
       this->stepsize_adaptation_.learn_stepsize(this->nom_epsilon_,
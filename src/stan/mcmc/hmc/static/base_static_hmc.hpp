@@ -4,6 +4,7 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/mcmc/hmc/base_hmc.hpp>
 #include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <stan/mcmc/hmc/trajectory_buffer.hpp>
 #include <cmath>
 #include <limits>
 #include <string>
@@ -23,7 +24,8 @@ class base_static_hmc
   base_static_hmc(const Model& model, BaseRNG& rng)
       : base_hmc<Model, Hamiltonian, Integrator, BaseRNG>(model, rng),
         T_(1),
-        energy_(0) {
+        energy_(0),
+        store_trajectory_(false) {
     update_L_();
   }
 
@@ -37,21 +39,42 @@ class base_static_hmc
     this->z_.set_metric(inv_e_metric);
   }
 
+  void set_metric_factor(const Eigen::MatrixXd& inv_e_metric_factor) {
+    this->z_.set_metric_factor(inv_e_metric_factor);
+  }
+
   sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->start_transition_cost();
+
     this->sample_stepsize();
 
     this->seed(init_sample.cont_params());
 
     this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
+    this->init_transition(logger);
 
     ps_point z_init(this->z_);
 
     double H0 = this->hamiltonian_.H(this->z_);
 
-    for (int i = 0; i < L_; ++i)
+    if (store_trajectory_) {
+      trajectory_.resize(this->z_.q.size(), L_ + 1);
+      trajectory_.store(0, this->z_, H0);
+    }
+
+    for (int i = 0; i < L_; ++i) {
       this->integrator_.evolve(this->z_, this->hamiltonian_, this->epsilon_,
                                logger);
+      if (store_trajectory_) {
+        double h = this->hamiltonian_.H(this->z_);
+        if (std::isnan(h))
+          h = std::numeric_limits<double>::infinity();
+        trajectory_.store(i + 1, this->z_, h);
+      }
+    }
+
+    proposal_q_ = this->z_.q;
+    this->hamiltonian_.dtau_dp_into(this->z_, proposal_velocity_);
 
     double h = this->hamiltonian_.H(this->z_);
     if (std::isnan(h))
@@ -65,19 +88,55 @@ class base_static_hmc
     acceptProb = acceptProb > 1 ? 1 : acceptProb;
 
     this->energy_ = this->hamiltonian_.H(this->z_);
+    this->end_transition_cost();
     return sample(this->z_.q, -this->hamiltonian_.V(this->z_), acceptProb);
   }
 
+  /**
+   * Set whether every state of the trajectory, including the initial
+   * state, is kept in a buffer for diagnostics such as the energy
+   * error along the trajectory. The proposal is still the end point.
+   *
+   * @param store true to keep the trajectory
+   */
+  void set_store_trajectory(bool store) { store_trajectory_ = store; }
+
+  bool get_store_trajectory() const { return store_trajectory_; }
+
+  /**
+   * Return the states of the last trajectory in trajectory order, when
+   * the trajectory is stored.
+   *
+   * @return trajectory buffer
+   */
+  const trajectory_buffer& get_trajectory() const { return trajectory_; }
+
+  /**
+   * Return the position at the end of the last trajectory, before the
+   * Metropolis correction.
+   */
+  const Eigen::VectorXd& get_proposal_q() const { return proposal_q_; }
+
+  /**
+   * Return the velocity, the derivative of the kinetic energy with
+   * respect to the momentum, at the end of the last trajectory.
+   */
+  const Eigen::VectorXd& get_proposal_velocity() const {
+    return proposal_velocity_;
+  }
+
   void get_sampler_param_names(std::vector<std::string>& names) {
     names.push_back("stepsize__");
     names.push_back("int_time__");
     names.push_back("energy__");
+    this->get_cost_param_names(names);
   }
 
   void get_sampler_params(std::vector<double>& values) {
     values.push_back(this->epsilon_);
     values.push_back(this->T_);
     values.push_back(this->energy_);
+    this->get_cost_params(values);
   }
 
   void set_nominal_stepsize_and_T(const double e, const double t) {
@@ -114,10 +173,24 @@ class base_static_hmc
 
   int get_L() { return this->L_; }
 
+  void write_state(state_writer& writer) const {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::write_state(writer);
+    writer.write(L_);
+  }
+
+  void read_state(state_reader& reader) {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::read_state(reader);
+    reader.read(L_);
+  }
+
  protected:
   double T_;
   int L_;
   double energy_;
+  bool store_trajectory_;
+  trajectory_buffer trajectory_;
+  Eigen::VectorXd proposal_q_;
+  Eigen::VectorXd proposal_velocity_;
 
   void update_L_() {
     L_ = static_cast<int>(T_ / this->nom_epsilon_);
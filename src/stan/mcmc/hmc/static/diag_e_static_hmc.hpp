@@ -4,6 +4,8 @@
 #include <stan/mcmc/hmc/hamiltonians/diag_e_point.hpp>
 #include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
 #include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/integrators/expl_three_stage.hpp>
+#include <stan/mcmc/hmc/integrators/expl_two_stage.hpp>
 #include <stan/mcmc/hmc/static/base_static_hmc.hpp>
 
 namespace stan {
@@ -12,14 +14,18 @@ namespace mcmc {
  * Hamiltonian Monte Carlo implementation using the endpoint
  * of trajectories with a static integration time with a
  * Gaussian-Euclidean disintegration and diagonal metric
+ *
+ * The integrator is the leapfrog unless another is given, such as
+ * <code>expl_two_stage</code> or <code>expl_three_stage</code>.
  */
-template <class Model, class BaseRNG>
+template <class Model, class BaseRNG,
+          template <class> class Integrator = expl_leapfrog>
 class diag_e_static_hmc
-    : public base_static_hmc<Model, diag_e_metric, expl_leapfrog, BaseRNG> {
+    : public base_static_hmc<Model, diag_e_metric, Integrator, BaseRNG> {
  public:
   diag_e_static_hmc(const Model& model, BaseRNG& rng)
-      : base_static_hmc<Model, diag_e_metric, expl_leapfrog, BaseRNG>(model,
-                                                                      rng) {}
+      : base_static_hmc<Model, diag_e_metric, Integrator, BaseRNG>(model,
+                                                                   rng) {}
 };
 
 }  // namespace mcmc
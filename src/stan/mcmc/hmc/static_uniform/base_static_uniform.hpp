@@ -4,6 +4,7 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/mcmc/hmc/base_hmc.hpp>
 #include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <stan/mcmc/hmc/trajectory_buffer.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 #include <cmath>
 #include <limits>
@@ -25,19 +26,22 @@ class base_static_uniform
   base_static_uniform(const Model& model, BaseRNG& rng)
       : base_hmc<Model, Hamiltonian, Integrator, BaseRNG>(model, rng),
         T_(1),
-        energy_(0) {
+        energy_(0),
+        store_trajectory_(false) {
     update_L_();
   }
 
   ~base_static_uniform() {}
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->start_transition_cost();
+
     this->sample_stepsize();
 
     this->seed(init_sample.cont_params());
 
     this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
+    this->init_transition(logger);
 
     ps_point z_init(this->z_);
     double H0 = this->hamiltonian_.H(this->z_);
@@ -49,6 +53,11 @@ class base_static_uniform
     boost::random::uniform_int_distribution<> uniform(0, L_ - 1);
     int Lp = uniform(this->rand_int_);
 
+    if (store_trajectory_) {
+      trajectory_.resize(this->z_.q.size(), L_);
+      trajectory_.store(Lp, this->z_, H0);
+    }
+
     for (int l = 0; l < Lp; ++l) {
       this->integrator_.evolve(this->z_, this->hamiltonian_, -this->epsilon_,
                                logger);
@@ -61,7 +70,9 @@ class base_static_uniform
       sum_prob += prob;
       sum_metro_prob += prob > 1 ? 1 : prob;
 
-      if (this->rand_uniform_() < prob / sum_prob)
+      if (store_trajectory_)
+        trajectory_.store(Lp - 1 - l, this->z_, h);
+      else if (this->rand_uniform_() < prob / sum_prob)
         z_sample = this->z_;
     }
 
@@ -79,27 +90,68 @@ class base_static_uniform
       sum_prob += prob;
       sum_metro_prob += prob > 1 ? 1 : prob;
 
-      if (this->rand_uniform_() < prob / sum_prob)
+      if (store_trajectory_)
+        trajectory_.store(Lp + 1 + l, this->z_, h);
+      else if (this->rand_uniform_() < prob / sum_prob)
         z_sample = this->z_;
     }
 
     double accept_prob = sum_metro_prob / static_cast<double>(L_);
 
+    if (store_trajectory_) {
+      // Draw the state from the whole trajectory in a single pass
+      double u = this->rand_uniform_() * sum_prob;
+      int i = 0;
+      for (; i < L_ - 1; ++i) {
+        u -= std::exp(H0 - trajectory_.H(i));
+        if (u < 0)
+          break;
+      }
+      trajectory_.load(i, this->z_);
+      this->energy_ = trajectory_.H(i);
+      this->end_transition_cost();
+      return sample(this->z_.q, -this->z_.V, accept_prob);
+    }
+
     this->z_.ps_point::operator=(z_sample);
     this->energy_ = this->hamiltonian_.H(this->z_);
+    this->end_transition_cost();
     return sample(this->z_.q, -this->hamiltonian_.V(this->z_), accept_prob);
   }
 
+  /**
+   * Set whether every state of the trajectory is kept in a buffer.
+   * With the buffer the state is drawn from the whole trajectory once
+   * it is complete, rather than progressively while integrating, which
+   * uses fewer random numbers and leaves the trajectory available
+   * through <code>get_trajectory()</code>.
+   *
+   * @param store true to keep the trajectory
+   */
+  void set_store_trajectory(bool store) { store_trajectory_ = store; }
+
+  bool get_store_trajectory() const { return store_trajectory_; }
+
+  /**
+   * Return the states of the last trajectory in trajectory order, when
+   * the trajectory is stored.
+   *
+   * @return trajectory buffer
+   */
+  const trajectory_buffer& get_trajectory() const { return trajectory_; }
+
   void get_sampler_param_names(std::vector<std::string>& names) {
     names.push_back("stepsize__");
     names.push_back("int_time__");
     names.push_back("energy__");
+    this->get_cost_param_names(names);
   }
 
   void get_sampler_params(std::vector<double>& values) {
     values.push_back(this->epsilon_);
     values.push_back(this->T_);
     values.push_back(this->energy_);
+    this->get_cost_params(values);
   }
 
   void set_nominal_stepsize_and_T(const double e, const double t) {
@@ -136,10 +188,22 @@ class base_static_uniform
 
   int get_L() { return this->L_; }
 
+  void write_state(state_writer& writer) const {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::write_state(writer);
+    writer.write(L_);
+  }
+
+  void read_state(state_reader& reader) {
+    base_hmc<Model, Hamiltonian, Integrator, BaseRNG>::read_state(reader);
+    reader.read(L_);
+  }
+
  protected:
   double T_;
   int L_;
   double energy_;
+  bool store_trajectory_;
+  trajectory_buffer trajectory_;
 
   void update_L_() {
     L_ = static_cast<int>(T_ / this->nom_epsilon_);
@@ -0,0 +1,109 @@
+#ifndef STAN_MCMC_HMC_TRAJECTORY_BUFFER_HPP
+#define STAN_MCMC_HMC_TRAJECTORY_BUFFER_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/mcmc/hmc/hamiltonians/ps_point.hpp>
+#include <cmath>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Storage for every state of a trajectory with a static number of
+ * leapfrog steps, in trajectory order.
+ *
+ * Positions, momenta and gradients are held as the columns of
+ * contiguous matrices that only grow, so a sampler can keep one buffer
+ * and refill it every transition without allocating. Proposals can be
+ * drawn from the stored states after the trajectory is complete, and
+ * the energies along the trajectory remain available for diagnostics.
+ */
+class trajectory_buffer {
+ public:
+  trajectory_buffer() : size_(0) {}
+
+  /**
+   * Prepare the buffer for a trajectory of the given number of states.
+   * Previously stored states are discarded.
+   *
+   * @param n dimension of the states
+   * @param size number of states
+   */
+  void resize(int n, int size) {
+    if (q_.rows() != n || q_.cols() < size) {
+      q_.resize(n, size);
+      p_.resize(n, size);
+      g_.resize(n, size);
+      V_.resize(size);
+      H_.resize(size);
+    }
+    size_ = size;
+  }
+
+  int size() const { return size_; }
+
+  /**
+   * Store a state at a position in the trajectory.
+   *
+   * @param i index of the state in the trajectory
+   * @param z state
+   * @param H Hamiltonian of the state
+   */
+  void store(int i, const ps_point& z, double H) {
+    q_.col(i) = z.q;
+    p_.col(i) = z.p;
+    g_.col(i) = z.g;
+    V_(i) = z.V;
+    H_(i) = H;
+  }
+
+  /**
+   * Copy a stored state into the phase space part of a point. Any
+   * metric held by a derived point is left as is.
+   *
+   * @param i index of the state in the trajectory
+   * @param[out] z point
+   */
+  void load(int i, ps_point& z) const {
+    z.q = q_.col(i);
+    z.p = p_.col(i);
+    z.g = g_.col(i);
+    z.V = V_(i);
+  }
+
+  Eigen::MatrixXd::ConstColXpr q(int i) const { return q_.col(i); }
+
+  Eigen::MatrixXd::ConstColXpr p(int i) const { return p_.col(i); }
+
+  double V(int i) const { return V_(i); }
+
+  double H(int i) const { return H_(i); }
+
+  /**
+   * Return the largest absolute difference between the Hamiltonian of a
+   * stored state and a reference, usually the initial Hamiltonian.
+   * Diverging states, stored with an infinite Hamiltonian, give an
+   * infinite error.
+   *
+   * @param H0 reference Hamiltonian
+   * @return largest absolute energy error along the trajectory
+   */
+  double max_energy_error(double H0) const {
+    double error = 0;
+    for (int i = 0; i < size_; ++i)
+      error = std::fmax(error, std::fabs(H_(i) - H0));
+    return error;
+  }
+
+ private:
+  Eigen::MatrixXd q_;
+  Eigen::MatrixXd p_;
+  Eigen::MatrixXd g_;
+  Eigen::VectorXd V_;
+  Eigen::VectorXd H_;
+  int size_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -33,6 +33,7 @@ class adapt_dense_e_xhmc : public dense_e_xhmc<Model, BaseRNG>,
           this->z_.inv_e_metric_, this->z_.q);
 
       if (update) {
+        this->z_.update_metric_factor();
         this->init_stepsize(logger);
 
         this->stepsize_adaptation_.set_mu(log(10 * this->nom_epsilon_));
@@ -51,13 +51,15 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
   double get_x_delta() { return this->x_delta_; }
 
   sample transition(sample& init_sample, callbacks::logger& logger) {
+    this->start_transition_cost();
+
     // Initialize the algorithm
     this->sample_stepsize();
 
     this->seed(init_sample.cont_params());
 
     this->hamiltonian_.sample_p(this->z_, this->rand_int_);
-    this->hamiltonian_.init(this->z_, logger);
+    this->init_transition(logger);
 
     ps_point z_plus(this->z_);
     ps_point z_minus(z_plus);
@@ -113,7 +115,8 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
         break;
     }
 
-    this->n_leapfrog_ = n_leapfrog;
+    this->n_leapfrog_
+        = n_leapfrog * Integrator<Hamiltonian<Model, BaseRNG> >::num_gradients;
 
     // Compute average acceptance probabilty across entire trajectory,
     // even over subtrees that may have been rejected
@@ -121,6 +124,7 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
 
     this->z_.ps_point::operator=(z_sample);
     this->energy_ = this->hamiltonian_.H(this->z_);
+    this->end_transition_cost();
     return sample(this->z_.q, -this->z_.V, accept_prob);
   }
 
@@ -130,6 +134,7 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     names.push_back("n_leapfrog__");
     names.push_back("divergent__");
     names.push_back("energy__");
+    this->get_cost_param_names(names);
   }
 
   void get_sampler_params(std::vector<double>& values) {
@@ -138,6 +143,7 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
     values.push_back(this->n_leapfrog_);
     values.push_back(this->divergent_);
     values.push_back(this->energy_);
+    this->get_cost_params(values);
   }
 
   /**
@@ -173,7 +179,15 @@ class base_xhmc : public base_hmc<Model, Hamiltonian, Integrator, BaseRNG> {
       if ((h - H0) > this->max_deltaH_)
         this->divergent_ = true;
 
-      double dG_dt = this->hamiltonian_.dG_dt(this->z_, logger);
+      // Reuse the gradient of phi from the last integrator step if there
+      // is one, as it is expensive for Riemannian metrics
+      const Eigen::VectorXd* dphi_dq = this->integrator_.last_dphi_dq();
+      double dG_dt = 0;
+      if (dphi_dq)
+        dG_dt = this->hamiltonian_.dG_dt_given_dphi_dq(this->z_, *dphi_dq,
+                                                       logger);
+      else
+        dG_dt = this->hamiltonian_.dG_dt(this->z_, logger);
 
       std::tie(ave, log_sum_weight)
           = stable_sum(ave, log_sum_weight, dG_dt, H0 - h);
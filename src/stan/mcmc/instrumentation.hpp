@@ -0,0 +1,550 @@
+#ifndef STAN_MCMC_INSTRUMENTATION_HPP
+#define STAN_MCMC_INSTRUMENTATION_HPP
+
+/**
+ * Named scoped regions that add up the wall time, and where available
+ * the hardware counters, spent in hot paths of the samplers.
+ *
+ * Instrumentation is compiled in only when STAN_INSTRUMENTATION is
+ * defined; otherwise STAN_INSTRUMENT_REGION() and STAN_INSTRUMENT_RUN()
+ * expand to nothing and cost nothing. Hardware counters are read
+ * through Linux perf_event when STAN_INSTRUMENTATION_PERF_EVENT is also
+ * defined, as CPU cycles, instructions and cache misses of the calling
+ * thread in user space. They are reported as NA when they aren't
+ * compiled in or the kernel refuses them, for example because of
+ * /proc/sys/kernel/perf_event_paranoid.
+ *
+ * A region adds up only its outermost activation on each thread, so
+ * recursive regions such as tree building are counted once. The
+ * totals of all regions are written to the logger, and reset, when the
+ * last of the service runs in progress ends.
+ *
+ * When STAN_INSTRUMENTATION_TRACE is defined, which implies
+ * STAN_INSTRUMENTATION, each outermost activation of a region is also
+ * recorded with its start and end time in a buffer of the thread that
+ * entered it, which only that thread appends to, without locks. When
+ * the last run ends the events of all threads are written as a Chrome
+ * trace, a JSON file that chrome://tracing and Perfetto display as a
+ * timeline per thread, to the file set with
+ * <code>registry::set_trace_file()</code>, the environment variable
+ * STAN_TRACE_FILE, or stan_trace.json.
+ */
+
+#if defined(STAN_INSTRUMENTATION_TRACE) && !defined(STAN_INSTRUMENTATION)
+#define STAN_INSTRUMENTATION
+#endif
+
+#ifdef STAN_INSTRUMENTATION
+
+#include <stan/callbacks/logger.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef STAN_INSTRUMENTATION_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace stan {
+namespace mcmc {
+namespace instrumentation {
+
+/**
+ * Hardware counters of the calling thread: CPU cycles, instructions
+ * and cache misses.
+ */
+class hardware_counters {
+ public:
+  static constexpr int size = 3;
+
+  hardware_counters() {
+#ifdef STAN_INSTRUMENTATION_PERF_EVENT
+    const std::uint64_t configs[size]
+        = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+           PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < size; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.disabled = i == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+                        i == 0 ? -1 : fds_[0], 0);
+      if (fds_[i] < 0) {
+        close_all();
+        return;
+      }
+    }
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  hardware_counters(const hardware_counters&) = delete;
+  hardware_counters& operator=(const hardware_counters&) = delete;
+
+  ~hardware_counters() { close_all(); }
+
+  bool available() const { return fds_[0] >= 0; }
+
+  /**
+   * Read the counters, returning false if they aren't available.
+   */
+  bool read(std::uint64_t (&values)[size]) const {
+#ifdef STAN_INSTRUMENTATION_PERF_EVENT
+    if (!available())
+      return false;
+    std::uint64_t buffer[1 + size];
+    if (::read(fds_[0], buffer, sizeof(buffer))
+        != static_cast<ssize_t>(sizeof(buffer)))
+      return false;
+    for (int i = 0; i < size; ++i)
+      values[i] = buffer[1 + i];
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Return the counters of the calling thread, opened on first use.
+   */
+  static const hardware_counters& thread_counters() {
+    static thread_local hardware_counters counters;
+    return counters;
+  }
+
+ private:
+  int fds_[size] = {-1, -1, -1};
+
+  void close_all() {
+#ifdef STAN_INSTRUMENTATION_PERF_EVENT
+    for (int i = size - 1; i >= 0; --i)
+      if (fds_[i] >= 0)
+        ::close(fds_[i]);
+#endif
+    for (int& fd : fds_)
+      fd = -1;
+  }
+};
+
+/**
+ * Totals of a named region over all threads.
+ */
+struct region {
+  region(const std::string& name, int id) : name(name), id(id) {}
+
+  const std::string name;
+  const int id;
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> ns{0};
+  /**
+   * Calls whose hardware counters were read.
+   */
+  std::atomic<std::uint64_t> counted_calls{0};
+  std::atomic<std::uint64_t> counters[hardware_counters::size] = {};
+
+  void reset() {
+    calls = 0;
+    ns = 0;
+    counted_calls = 0;
+    for (auto& counter : counters)
+      counter = 0;
+  }
+};
+
+/**
+ * An outermost activation of a region, in nanoseconds since the
+ * registry was created.
+ */
+struct trace_event {
+  int region;
+  std::uint64_t begin_ns;
+  std::uint64_t end_ns;
+};
+
+/**
+ * Trace events of one thread, which only that thread records. They are
+ * stored in chunks that are never moved, and the number of events is
+ * published with a release store, so they can be read from another
+ * thread. A trace belongs to an epoch of the registry; the thread
+ * starts over when it records in a later epoch, and the events of an
+ * earlier epoch are not read.
+ */
+class thread_trace {
+ public:
+  static constexpr size_t chunk_size = 4096;
+
+  explicit thread_trace(int id)
+      : id_(id), head_(new chunk), tail_(head_.get()), size_(0), epoch_(0) {}
+
+  thread_trace(const thread_trace&) = delete;
+  thread_trace& operator=(const thread_trace&) = delete;
+
+  int id() const { return id_; }
+
+  void record(std::uint64_t epoch, const trace_event& event) {
+    size_t n = size_.load(std::memory_order_relaxed);
+    if (epoch_.load(std::memory_order_relaxed) != epoch) {
+      n = 0;
+      tail_ = head_.get();
+      size_.store(0, std::memory_order_relaxed);
+      epoch_.store(epoch, std::memory_order_relaxed);
+    }
+    size_t k = n % chunk_size;
+    if (n > 0 && k == 0) {
+      if (!tail_->next)
+        tail_->next.reset(new chunk);
+      tail_ = tail_->next.get();
+    }
+    tail_->events[k] = event;
+    size_.store(n + 1, std::memory_order_release);
+  }
+
+  /**
+   * Call a function with each event recorded in an epoch.
+   */
+  template <typename F>
+  void for_each(std::uint64_t epoch, const F& f) const {
+    size_t n = size_.load(std::memory_order_acquire);
+    if (epoch_.load(std::memory_order_relaxed) != epoch)
+      return;
+    const chunk* c = head_.get();
+    for (size_t i = 0; i < n; ++i) {
+      if (i > 0 && i % chunk_size == 0)
+        c = c->next.get();
+      f(c->events[i % chunk_size]);
+    }
+  }
+
+ private:
+  struct chunk {
+    trace_event events[chunk_size];
+    std::unique_ptr<chunk> next;
+  };
+
+  const int id_;
+  std::unique_ptr<chunk> head_;
+  // Chunk the next event goes in, only used by the recording thread
+  chunk* tail_;
+  std::atomic<size_t> size_;
+  std::atomic<std::uint64_t> epoch_;
+};
+
+/**
+ * Process-wide set of regions, in the order they were first entered.
+ */
+class registry {
+ public:
+  static registry& instance() {
+    static registry r;
+    return r;
+  }
+
+  /**
+   * Return the nanoseconds from the creation of the registry to a time.
+   */
+  std::uint64_t trace_ns(std::chrono::steady_clock::time_point t) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - created_)
+        .count();
+  }
+
+  /**
+   * Record an outermost activation of a region in the trace of the
+   * calling thread.
+   */
+  void trace(const region& r, std::chrono::steady_clock::time_point begin,
+             std::chrono::steady_clock::time_point end) {
+    static thread_local thread_trace* t = add_thread_trace();
+    t->record(epoch_.load(std::memory_order_relaxed),
+              trace_event{r.id, trace_ns(begin), trace_ns(end)});
+  }
+
+  /**
+   * Set the file the trace is written to when the last run ends.
+   */
+  void set_trace_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trace_file_ = path;
+  }
+
+  /**
+   * Write the events recorded since the trace was last written as a
+   * Chrome trace, with a complete event per activation, and start a
+   * new trace. Events being recorded meanwhile may or may not be
+   * written.
+   *
+   * @param[in, out] out stream to write to
+   */
+  void write_trace(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint64_t epoch = epoch_.load();
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for (auto& t : traces_) {
+      out << separator << "{\"name\":\"thread_name\",\"ph\":\"M\","
+          << "\"pid\":1,\"tid\":" << t->id()
+          << ",\"args\":{\"name\":\"thread " << t->id() << "\"}}";
+      separator = ",\n";
+      t->for_each(epoch, [&](const trace_event& e) {
+        out << ",\n{\"name\":\"" << json_escape(regions_[e.region]->name)
+            << "\",\"cat\":\"stan\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << t->id() << ",\"ts\":" << e.begin_ns / 1000 << "."
+            << std::setw(3) << std::setfill('0') << e.begin_ns % 1000
+            << ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000 << "."
+            << std::setw(3) << (e.end_ns - e.begin_ns) % 1000
+            << std::setfill(' ') << "}";
+      });
+    }
+    out << "\n]}\n";
+    ++epoch_;
+  }
+
+  /**
+   * Return the region of that name, adding it if it's new.
+   */
+  region& add(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& r : regions_)
+      if (r->name == name)
+        return *r;
+    regions_.emplace_back(new region(name, regions_.size()));
+    return *regions_.back();
+  }
+
+  /**
+   * Write one line per entered region with its calls, seconds and
+   * hardware counters, and reset the totals.
+   */
+  void write(callbacks::logger& logger) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    logger.info(
+        "Instrumented regions: region, calls, seconds, cycles, instructions,"
+        " cache misses");
+    for (auto& r : regions_) {
+      if (r->calls == 0)
+        continue;
+      std::stringstream line;
+      line << "  " << r->name << ", " << r->calls << ", "
+           << std::setprecision(6) << r->ns * 1e-9;
+      for (auto& counter : r->counters) {
+        line << ", ";
+        if (r->counted_calls == r->calls)
+          line << counter;
+        else
+          line << "NA";
+      }
+      logger.info(line);
+      r->reset();
+    }
+  }
+
+  /**
+   * Count a service run as started.
+   */
+  void begin_run() { ++active_runs_; }
+
+  /**
+   * Count a service run as over, writing the totals if it was the last
+   * run in progress.
+   */
+  void end_run(callbacks::logger& logger) {
+    if (--active_runs_ != 0)
+      return;
+#ifdef STAN_INSTRUMENTATION_TRACE
+    std::string path;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      path = trace_file_;
+    }
+    std::ofstream out(path);
+    write_trace(out);
+    if (out)
+      logger.info("Trace written to " + path);
+    else
+      logger.warn("Can't write the trace to " + path);
+#endif
+    write(logger);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<region>> regions_;
+  std::atomic<int> active_runs_{0};
+  const std::chrono::steady_clock::time_point created_{
+      std::chrono::steady_clock::now()};
+  std::vector<std::unique_ptr<thread_trace>> traces_;
+  std::atomic<std::uint64_t> epoch_{0};
+  std::string trace_file_{std::getenv("STAN_TRACE_FILE")
+                              ? std::getenv("STAN_TRACE_FILE")
+                              : "stan_trace.json"};
+
+  thread_trace* add_thread_trace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    traces_.emplace_back(new thread_trace(traces_.size()));
+    return traces_.back().get();
+  }
+
+  static std::string json_escape(const std::string& s) {
+    std::string escaped;
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+};
+
+/**
+ * Add the time from a start to now to a region as one call, and trace
+ * it if tracing is compiled in. Used for spans that aren't scopes.
+ */
+inline void record_span(region& r,
+                        std::chrono::steady_clock::time_point begin) {
+  auto end = std::chrono::steady_clock::now();
+  r.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+              .count();
+  ++r.calls;
+#ifdef STAN_INSTRUMENTATION_TRACE
+  registry::instance().trace(r, begin, end);
+#endif
+}
+
+/**
+ * Adds the time and counters from its construction to its destruction
+ * to a region, unless the region is already active on this thread.
+ */
+class scoped_region {
+ public:
+  explicit scoped_region(region& r) : region_(r) {
+    std::vector<int>& depth = thread_depth();
+    if (depth.size() <= static_cast<size_t>(r.id))
+      depth.resize(r.id + 1, 0);
+    outermost_ = depth[r.id]++ == 0;
+    if (!outermost_)
+      return;
+    counted_ = hardware_counters::thread_counters().read(start_counters_);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  scoped_region(const scoped_region&) = delete;
+  scoped_region& operator=(const scoped_region&) = delete;
+
+  ~scoped_region() {
+    --thread_depth()[region_.id];
+    if (!outermost_)
+      return;
+    auto end = std::chrono::steady_clock::now();
+    std::uint64_t end_counters[hardware_counters::size];
+    if (counted_
+        && hardware_counters::thread_counters().read(end_counters)) {
+      for (int i = 0; i < hardware_counters::size; ++i)
+        region_.counters[i] += end_counters[i] - start_counters_[i];
+      ++region_.counted_calls;
+    }
+    region_.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      end - start_)
+                      .count();
+    ++region_.calls;
+#ifdef STAN_INSTRUMENTATION_TRACE
+    registry::instance().trace(region_, start_, end);
+#endif
+  }
+
+ private:
+  region& region_;
+  bool outermost_;
+  bool counted_ = false;
+  std::uint64_t start_counters_[hardware_counters::size];
+  std::chrono::steady_clock::time_point start_;
+
+  static std::vector<int>& thread_depth() {
+    static thread_local std::vector<int> depth;
+    return depth;
+  }
+};
+
+/**
+ * Marks a service run as in progress for its lifetime, so the totals
+ * are written when the last concurrent run ends.
+ */
+class scoped_run {
+ public:
+  explicit scoped_run(callbacks::logger& logger) : logger_(logger) {
+    registry::instance().begin_run();
+  }
+
+  scoped_run(const scoped_run&) = delete;
+  scoped_run& operator=(const scoped_run&) = delete;
+
+  ~scoped_run() { registry::instance().end_run(logger_); }
+
+ private:
+  callbacks::logger& logger_;
+};
+
+}  // namespace instrumentation
+}  // namespace mcmc
+}  // namespace stan
+
+#define STAN_INSTRUMENT_CONCAT_(a, b) a##b
+#define STAN_INSTRUMENT_CONCAT(a, b) STAN_INSTRUMENT_CONCAT_(a, b)
+
+/**
+ * Instrument the rest of the enclosing scope as the named region.
+ */
+#define STAN_INSTRUMENT_REGION(name)                                      \
+  static ::stan::mcmc::instrumentation::region& STAN_INSTRUMENT_CONCAT(   \
+      stan_instrument_region_, __LINE__)                                  \
+      = ::stan::mcmc::instrumentation::registry::instance().add(name);    \
+  ::stan::mcmc::instrumentation::scoped_region STAN_INSTRUMENT_CONCAT(    \
+      stan_instrument_scope_, __LINE__)(                                  \
+      STAN_INSTRUMENT_CONCAT(stan_instrument_region_, __LINE__))
+
+/**
+ * Add the time from a <code>std::chrono::steady_clock</code> start to
+ * now to the named region, for spans that aren't a scope.
+ */
+#define STAN_INSTRUMENT_SPAN(name, start)                                 \
+  do {                                                                    \
+    static ::stan::mcmc::instrumentation::region& stan_instrument_span    \
+        = ::stan::mcmc::instrumentation::registry::instance().add(name);  \
+    ::stan::mcmc::instrumentation::record_span(stan_instrument_span,      \
+                                               start);                    \
+  } while (0)
+
+/**
+ * Mark the rest of the enclosing scope as a service run, writing the
+ * totals of the regions to the logger when the last run ends.
+ */
+#define STAN_INSTRUMENT_RUN(logger)                                       \
+  ::stan::mcmc::instrumentation::scoped_run STAN_INSTRUMENT_CONCAT(       \
+      stan_instrument_run_, __LINE__)(logger)
+
+#else
+
+#define STAN_INSTRUMENT_REGION(name)
+#define STAN_INSTRUMENT_SPAN(name, start)
+#define STAN_INSTRUMENT_RUN(logger)
+
+#endif
+
+#endif
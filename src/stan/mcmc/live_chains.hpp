@@ -0,0 +1,282 @@
+#ifndef STAN_MCMC_LIVE_CHAINS_HPP
+#define STAN_MCMC_LIVE_CHAINS_HPP
+
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <stan/mcmc/chains.hpp>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * A <code>live_chains</code> object accumulates the draws of a fixed
+ * number of chains while they run, for analyses such as stopping rules
+ * that look at the draws of every chain before the run is over.
+ *
+ * <p><b>Synchronization</b>: Each chain has a single producer, which
+ * appends draws with <code>add()</code> concurrently with the producers
+ * of the other chains and with any number of readers, without locks.
+ * The draws of a chain are stored in a list of fixed size segments that
+ * are never moved or freed while the object lives, and the number of
+ * draws of the chain is published with a release store once a draw is
+ * complete. A reader loads it with an acquire and only ever reads the
+ * draws before it, so it sees a consistent prefix of each chain, taken
+ * when it reads that chain.
+ *
+ * <p><b>Storage Order</b>: Each segment is column major, so the draws
+ * of a parameter are contiguous within a segment and are gathered into
+ * a buffer to be analyzed.
+ */
+class live_chains {
+ public:
+  /**
+   * @param param_names names of the parameters
+   * @param num_chains number of chains
+   * @param segment_size number of draws per segment of storage
+   * @throw std::invalid_argument if there are no chains or the segment
+   *   size isn't positive
+   */
+  live_chains(const std::vector<std::string>& param_names, int num_chains,
+              size_t segment_size = 1024)
+      : param_names_(param_names), segment_size_(segment_size) {
+    if (num_chains < 1)
+      throw std::invalid_argument("live_chains: there must be a chain");
+    if (segment_size < 1)
+      throw std::invalid_argument(
+          "live_chains: the segment size must be positive");
+    for (int chain = 0; chain < num_chains; ++chain)
+      chains_.emplace_back(new chain_state(new_segment()));
+  }
+
+  ~live_chains() {
+    for (std::unique_ptr<chain_state>& state : chains_) {
+      segment* s = state->head;
+      while (s) {
+        segment* next = s->next.load(std::memory_order_relaxed);
+        delete s;
+        s = next;
+      }
+    }
+  }
+
+  live_chains(const live_chains&) = delete;
+  live_chains& operator=(const live_chains&) = delete;
+
+  int num_chains() const { return chains_.size(); }
+
+  int num_params() const { return param_names_.size(); }
+
+  const std::vector<std::string>& param_names() const { return param_names_; }
+
+  int index(const std::string& name) const {
+    for (int i = 0; i < num_params(); ++i)
+      if (param_names_[i] == name)
+        return i;
+    return -1;
+  }
+
+  /**
+   * Append a draw to a chain. Only one thread may add to a chain.
+   *
+   * @param chain chain
+   * @param draw a value per parameter
+   * @throw std::invalid_argument if the draw doesn't have a value per
+   *   parameter
+   */
+  void add(const int chain, const std::vector<double>& draw) {
+    if (draw.size() != param_names_.size())
+      throw std::invalid_argument(
+          "live_chains: number of values in draw does not match chains");
+    chain_state& state = *chains_[chain];
+    size_t n = state.size.load(std::memory_order_relaxed);
+    size_t row = n % segment_size_;
+    if (n > 0 && row == 0) {
+      segment* s = new_segment();
+      state.tail->next.store(s, std::memory_order_release);
+      state.tail = s;
+    }
+    double* values = state.tail->values.get();
+    for (size_t j = 0; j < draw.size(); ++j)
+      values[j * segment_size_ + row] = draw[j];
+    state.size.store(n + 1, std::memory_order_release);
+  }
+
+  /**
+   * Set the number of leading draws of a chain that are warmup and are
+   * not analyzed.
+   */
+  void set_warmup(const int chain, const int warmup) {
+    chains_[chain]->warmup.store(warmup, std::memory_order_release);
+  }
+
+  int warmup(const int chain) const {
+    return chains_[chain]->warmup.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Return the number of draws published in a chain, including warmup.
+   */
+  int num_samples(const int chain) const {
+    return chains_[chain]->size.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Return the number of draws published in a chain after warmup.
+   */
+  int num_kept_samples(const int chain) const {
+    return std::max(num_samples(chain) - warmup(chain), 0);
+  }
+
+  /**
+   * Return the kept draws of a parameter in a chain published so far.
+   */
+  Eigen::VectorXd samples(const int chain, const int index) const {
+    std::vector<double> x;
+    gather(chain, index, x);
+    return Eigen::Map<Eigen::VectorXd>(x.data(), x.size());
+  }
+
+  /**
+   * Return the split potential scale reduction of a parameter from the
+   * kept draws of every chain published so far, or NaN while a chain
+   * has fewer than four.
+   */
+  double split_potential_scale_reduction(const int index) const {
+    std::vector<std::vector<double>> buffers;
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    if (!kept_draws(index, buffers, draws, sizes))
+      return std::numeric_limits<double>::quiet_NaN();
+    return analyze::compute_split_potential_scale_reduction(draws, sizes);
+  }
+
+  double split_potential_scale_reduction(const std::string& name) const {
+    return split_potential_scale_reduction(index(name));
+  }
+
+  /**
+   * Return the split effective sample size of a parameter from the
+   * kept draws of every chain published so far, or NaN while a chain
+   * has fewer than four.
+   */
+  double split_effective_sample_size(const int index) const {
+    std::vector<std::vector<double>> buffers;
+    std::vector<const double*> draws;
+    std::vector<size_t> sizes;
+    if (!kept_draws(index, buffers, draws, sizes))
+      return std::numeric_limits<double>::quiet_NaN();
+    return analyze::compute_split_effective_sample_size(draws, sizes);
+  }
+
+  double split_effective_sample_size(const std::string& name) const {
+    return split_effective_sample_size(index(name));
+  }
+
+  /**
+   * Copy the draws published so far into a <code>chains</code> object,
+   * with the warmup of each chain, for the analyses it provides.
+   */
+  chains<> snapshot() const {
+    chains<> copy(param_names_);
+    for (int chain = 0; chain < num_chains(); ++chain) {
+      int warmup = this->warmup(chain);
+      int n = num_samples(chain);
+      Eigen::MatrixXd draws(n, num_params());
+      copy_rows(chain, n, draws);
+      copy.add(chain, draws);
+      copy.set_warmup(chain, std::min(warmup, n));
+    }
+    return copy;
+  }
+
+ private:
+  struct segment {
+    explicit segment(size_t size) : values(new double[size]), next(nullptr) {}
+    std::unique_ptr<double[]> values;
+    std::atomic<segment*> next;
+  };
+
+  struct chain_state {
+    explicit chain_state(segment* first)
+        : head(first), tail(first), size(0), warmup(0) {}
+    segment* head;
+    // Last segment, only used by the producer
+    segment* tail;
+    std::atomic<size_t> size;
+    std::atomic<int> warmup;
+  };
+
+  std::vector<std::string> param_names_;
+  size_t segment_size_;
+  std::vector<std::unique_ptr<chain_state>> chains_;
+
+  segment* new_segment() const {
+    return new segment(segment_size_ * std::max<size_t>(num_params(), 1));
+  }
+
+  /**
+   * Copy the first draws of every parameter of a chain into the rows
+   * of a matrix.
+   */
+  void copy_rows(const int chain, const int n, Eigen::MatrixXd& draws) const {
+    const segment* s = chains_[chain]->head;
+    for (int start = 0; start < n; start += segment_size_) {
+      int rows = std::min<int>(segment_size_, n - start);
+      draws.middleRows(start, rows)
+          = Eigen::Map<const Eigen::MatrixXd>(s->values.get(), segment_size_,
+                                              num_params())
+                .topRows(rows);
+      s = s->next.load(std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * Copy the kept draws of a parameter in a chain published so far
+   * into a buffer.
+   */
+  void gather(const int chain, const int index, std::vector<double>& x) const {
+    if (index < 0 || index >= num_params())
+      throw std::out_of_range("live_chains: parameter index out of range");
+    int n = num_samples(chain);
+    int warmup = std::min(this->warmup(chain), n);
+    x.clear();
+    x.reserve(n - warmup);
+    const segment* s = chains_[chain]->head;
+    for (int start = 0; start < n; start += segment_size_) {
+      int end = std::min<int>(start + segment_size_, n);
+      const double* column = s->values.get() + index * segment_size_;
+      for (int i = std::max(start, warmup); i < end; ++i)
+        x.push_back(column[i - start]);
+      s = s->next.load(std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * Gather the kept draws of a parameter in every chain, and return
+   * false if a chain has fewer than four.
+   */
+  bool kept_draws(const int index, std::vector<std::vector<double>>& buffers,
+                  std::vector<const double*>& draws,
+                  std::vector<size_t>& sizes) const {
+    buffers.resize(num_chains());
+    draws.resize(num_chains());
+    sizes.resize(num_chains());
+    for (int chain = 0; chain < num_chains(); ++chain) {
+      gather(chain, index, buffers[chain]);
+      draws[chain] = buffers[chain].data();
+      sizes[chain] = buffers[chain].size();
+    }
+    return *std::min_element(sizes.begin(), sizes.end()) >= 4;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
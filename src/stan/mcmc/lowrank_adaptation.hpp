@@ -0,0 +1,170 @@
+#ifndef STAN_MCMC_LOWRANK_ADAPTATION_HPP
+#define STAN_MCMC_LOWRANK_ADAPTATION_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/windowed_adaptation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Windowed adaptation of a diagonal plus low rank inverse metric.
+ *
+ * At the end of each adaptation window the diagonal is set to the
+ * regularized variance of the window draws, exactly as in
+ * <code>var_adaptation</code>. The draws are then standardized by that
+ * diagonal and the leading eigenvectors of their correlation whose
+ * eigenvalues exceed one are added as the low rank factor, so the
+ * metric captures the dominant correlations while its cost stays O(n k)
+ * for n parameters and rank k.
+ *
+ * The window draws are kept until the window closes, which takes
+ * O(n w) memory for a window of w draws. When there are more
+ * parameters than draws the eigenvectors are found from the w x w Gram
+ * matrix of the draws, so no n x n matrix is ever formed.
+ */
+class lowrank_adaptation : public windowed_adaptation {
+ public:
+  /**
+   * Construct an adaptation of n parameters.
+   *
+   * @param n number of parameters
+   * @param rank maximum number of low rank directions
+   */
+  lowrank_adaptation(int n, int rank)
+      : windowed_adaptation("low rank metric"), n_(n), rank_(rank) {}
+
+  /**
+   * Return the maximum number of low rank directions.
+   */
+  int rank() const { return rank_; }
+
+  /**
+   * Set the maximum number of low rank directions.
+   *
+   * @param rank maximum number of low rank directions
+   */
+  void set_rank(int rank) { rank_ = rank; }
+
+  /**
+   * Add a draw to the current window and, if the window closes, update
+   * the metric.
+   *
+   * @param[out] diag diagonal of the inverse metric
+   * @param[out] factor low rank factor of the inverse metric
+   * @param[in] q current draw
+   * @return true if the metric was updated
+   */
+  bool learn_metric(Eigen::VectorXd& diag, Eigen::MatrixXd& factor,
+                    const Eigen::VectorXd& q) {
+    if (adaptation_window())
+      draws_.push_back(q);
+
+    if (end_adaptation_window()) {
+      compute_next_window();
+
+      start_estimate();
+      estimate(diag, factor);
+      draws_.clear();
+      end_estimate();
+
+      ++adapt_window_counter_;
+      return true;
+    }
+
+    ++adapt_window_counter_;
+    return false;
+  }
+
+  /**
+   * Write the window position and the draws of the current window.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    writer.write(static_cast<int>(draws_.size()));
+    for (const Eigen::VectorXd& draw : draws_)
+      writer.write(draw);
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    int num_draws;
+    reader.read(num_draws);
+    if (num_draws < 0)
+      throw std::invalid_argument("Sampler state: negative number of draws");
+    draws_.resize(num_draws);
+    for (Eigen::VectorXd& draw : draws_) {
+      reader.read(draw);
+      if (draw.size() != n_)
+        throw std::invalid_argument("Sampler state: dimension mismatch");
+    }
+  }
+
+ protected:
+  int n_;
+  int rank_;
+  std::vector<Eigen::VectorXd> draws_;
+
+  void estimate(Eigen::VectorXd& diag, Eigen::MatrixXd& factor) const {
+    const int w = draws_.size();
+    if (w < 2) {
+      factor.resize(n_, 0);
+      return;
+    }
+    const double n = static_cast<double>(w);
+
+    Eigen::MatrixXd z(w, n_);
+    for (int i = 0; i < w; ++i)
+      z.row(i) = draws_[i].transpose();
+    z.rowwise() -= z.colwise().mean();
+
+    Eigen::VectorXd var = z.colwise().squaredNorm().transpose() / (n - 1.0);
+    diag = (n / (n + 5.0)) * var
+           + 1e-3 * (5.0 / (n + 5.0)) * Eigen::VectorXd::Ones(n_);
+    Eigen::VectorXd sqrt_diag = diag.array().sqrt();
+    z = z * sqrt_diag.cwiseInverse().asDiagonal();
+
+    // Eigenpairs of the correlation of the standardized draws, in
+    // ascending order of eigenvalue
+    Eigen::VectorXd values;
+    Eigen::MatrixXd vectors;
+    if (n_ <= w) {
+      Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(
+          z.transpose() * z / (n - 1.0));
+      values = solver.eigenvalues();
+      vectors = solver.eigenvectors();
+    } else {
+      Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(
+          z * z.transpose() / (n - 1.0));
+      values = solver.eigenvalues();
+      vectors = z.transpose() * solver.eigenvectors();
+      for (int j = 0; j < values.size(); ++j)
+        if (values(j) > 0)
+          vectors.col(j) /= std::sqrt((n - 1.0) * values(j));
+    }
+
+    int k = 0;
+    int num_values = values.size();
+    while (k < std::min(rank_, num_values) && values(num_values - 1 - k) > 1)
+      ++k;
+    factor.resize(n_, k);
+    for (int j = 0; j < k; ++j) {
+      int col = num_values - 1 - j;
+      double excess = (n / (n + 5.0)) * (values(col) - 1.0);
+      factor.col(j)
+          = std::sqrt(excess) * sqrt_diag.cwiseProduct(vectors.col(col));
+    }
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+#endif
@@ -0,0 +1,81 @@
+#ifndef STAN_MCMC_POOLED_MOMENTS_HPP
+#define STAN_MCMC_POOLED_MOMENTS_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/util/deterministic_reduce.hpp>
+#include <vector>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Number of draws, mean and sum of squared deviations from the mean of
+ * a set of draws, either per parameter or as a matrix of the sums of
+ * the products of deviations, which is merged with the set of another
+ * chain by the pairwise update of Chan et al.
+ *
+ * @tparam M2 type of the sum of squared deviations,
+ *   <code>Eigen::VectorXd</code> or <code>Eigen::MatrixXd</code>
+ */
+template <typename M2>
+struct pooled_moments {
+  double n = 0;
+  Eigen::VectorXd mean;
+  M2 m2;
+
+  /**
+   * Return the moments of the draws of two sets taken together.
+   *
+   * @param left moments of the first set
+   * @param right moments of the second set
+   */
+  static pooled_moments merge(const pooled_moments& left,
+                              const pooled_moments& right) {
+    if (right.n == 0)
+      return left.mean.size() > 0 ? left : right;
+    if (left.n == 0)
+      return right;
+    pooled_moments pooled;
+    pooled.n = left.n + right.n;
+    Eigen::VectorXd delta = right.mean - left.mean;
+    pooled.mean = left.mean + (right.n / pooled.n) * delta;
+    pooled.m2 = left.m2 + right.m2;
+    add_outer(pooled.m2, (left.n * right.n / pooled.n), delta);
+    return pooled;
+  }
+
+  /**
+   * Return the moments of the draws of all sets taken together, merged
+   * by a pairwise tree in the order of the sets, so that the result
+   * doesn't depend on the number of threads.
+   *
+   * @tparam F type of the moments of a set, callable as
+   *   <code>pooled_moments f(size_t i)</code>
+   * @param num_sets number of sets
+   * @param f moments of a set
+   */
+  template <typename F>
+  static pooled_moments pool(size_t num_sets, const F& f) {
+    return stan::util::deterministic_reduce(
+        num_sets, 1, pooled_moments(),
+        [&f](size_t begin, size_t end) { return f(begin); }, merge);
+  }
+
+ private:
+  static void add_outer(Eigen::VectorXd& m2, double weight,
+                        const Eigen::VectorXd& delta) {
+    m2 += weight * delta.cwiseProduct(delta);
+  }
+
+  static void add_outer(Eigen::MatrixXd& m2, double weight,
+                        const Eigen::VectorXd& delta) {
+    m2 += weight * delta * delta.transpose();
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
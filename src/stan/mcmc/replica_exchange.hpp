@@ -0,0 +1,174 @@
+#ifndef STAN_MCMC_REPLICA_EXCHANGE_HPP
+#define STAN_MCMC_REPLICA_EXCHANGE_HPP
+
+#include <stan/mcmc/base_adaptation.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * The ladder of inverse temperatures of replica exchange (parallel
+ * tempering) and its swap moves between adjacent temperatures.
+ *
+ * Temperature 0 has inverse temperature 1, the target, and the inverse
+ * temperatures decrease geometrically down to the smallest one. Swap
+ * rounds alternate between the even pairs (0, 1), (2, 3), ... and the
+ * odd pairs (1, 2), (3, 4), ..., the non-reversible scheme of Syed et
+ * al. (2022), "Non-reversible parallel tempering: a scalable highly
+ * parallel MCMC scheme", JRSS B.
+ *
+ * While adaptation is engaged, each swap updates the logarithm of the
+ * log gap between the two inverse temperatures by stochastic
+ * approximation, widening the gap when the swap acceptance probability
+ * is above the target and narrowing it when below, as in Atchade,
+ * Roberts and Rosenthal (2011), "Towards optimal scaling of Metropolis
+ * -coupled Markov chain Monte Carlo", Statistics and Computing.
+ */
+class replica_exchange : public base_adaptation {
+ public:
+  /**
+   * @param num_temps number of temperatures, at least 1
+   * @param beta_min smallest inverse temperature, in (0, 1]
+   * @throw std::invalid_argument if an argument is out of range
+   */
+  replica_exchange(size_t num_temps, double beta_min)
+      : adapt_flag_(false),
+        target_(0.234),
+        kappa_(0.6),
+        counter_(0),
+        round_(0),
+        log_gaps_(num_temps > 1 ? num_temps - 1 : 0),
+        betas_(num_temps, 1.0),
+        num_proposed_(log_gaps_.size(), 0),
+        num_accepted_(log_gaps_.size(), 0) {
+    if (num_temps < 1)
+      throw std::invalid_argument("The number of temperatures must be >= 1");
+    if (!(beta_min > 0 && beta_min <= 1))
+      throw std::invalid_argument(
+          "The smallest inverse temperature must be in (0, 1]");
+    if (num_temps > 1) {
+      double gap = -std::log(beta_min) / (num_temps - 1);
+      for (double& log_gap : log_gaps_)
+        log_gap = gap > 0 ? std::log(gap) : -30;
+    }
+    update_betas();
+  }
+
+  void set_target(double t) {
+    if (t > 0 && t < 1)
+      target_ = t;
+  }
+
+  void set_kappa(double k) {
+    if (k > 0.5 && k <= 1)
+      kappa_ = k;
+  }
+
+  double get_target() const noexcept { return target_; }
+
+  double get_kappa() const noexcept { return kappa_; }
+
+  void engage_adaptation() { adapt_flag_ = true; }
+
+  void disengage_adaptation() { adapt_flag_ = false; }
+
+  bool adapting() const { return adapt_flag_; }
+
+  size_t num_temps() const { return betas_.size(); }
+
+  /**
+   * Return the inverse temperatures, decreasing from 1.
+   */
+  const std::vector<double>& betas() const { return betas_; }
+
+  void restart() {
+    counter_ = 0;
+    std::fill(num_proposed_.begin(), num_proposed_.end(), 0);
+    std::fill(num_accepted_.begin(), num_accepted_.end(), 0);
+  }
+
+  /**
+   * Propose one round of swaps between adjacent temperatures, and adapt
+   * the ladder if adaptation is engaged.
+   *
+   * @tparam RNG type of random number generator
+   * @param log_probs untempered log density of the state at each
+   *   temperature
+   * @param rng random number generator
+   * @return for each pair of temperatures (k, k + 1), whether their
+   *   states are swapped
+   */
+  template <class RNG>
+  std::vector<bool> propose_swaps(const std::vector<double>& log_probs,
+                                  RNG& rng) {
+    boost::uniform_01<RNG&> rand_uniform(rng);
+    std::vector<bool> swapped(log_gaps_.size(), false);
+    if (log_gaps_.empty())
+      return swapped;
+
+    ++counter_;
+    const double eta = std::pow(counter_, -kappa_);
+    for (size_t k = round_ % 2; k < log_gaps_.size(); k += 2) {
+      double log_ratio
+          = (betas_[k] - betas_[k + 1]) * (log_probs[k + 1] - log_probs[k]);
+      double accept_prob = std::isnan(log_ratio) ? 0
+                           : log_ratio > 0       ? 1
+                                                 : std::exp(log_ratio);
+      swapped[k] = rand_uniform() < accept_prob;
+      ++num_proposed_[k];
+      if (swapped[k])
+        ++num_accepted_[k];
+      if (adapt_flag_)
+        log_gaps_[k] += eta * (accept_prob - target_);
+    }
+    ++round_;
+    if (adapt_flag_)
+      update_betas();
+    return swapped;
+  }
+
+  /**
+   * Return the fraction of accepted swaps between each pair of adjacent
+   * temperatures since the last restart, or 0 for pairs with no
+   * proposals.
+   */
+  std::vector<double> swap_rates() const {
+    std::vector<double> rates(log_gaps_.size(), 0);
+    for (size_t k = 0; k < rates.size(); ++k)
+      if (num_proposed_[k] > 0)
+        rates[k] = static_cast<double>(num_accepted_[k]) / num_proposed_[k];
+    return rates;
+  }
+
+ protected:
+  bool adapt_flag_;
+  double target_;
+  double kappa_;
+  double counter_;
+  size_t round_;
+  std::vector<double> log_gaps_;
+  std::vector<double> betas_;
+  std::vector<size_t> num_proposed_;
+  std::vector<size_t> num_accepted_;
+
+  void update_betas() {
+    double log_beta = 0;
+    betas_[0] = 1;
+    for (size_t k = 0; k < log_gaps_.size(); ++k) {
+      log_beta -= std::exp(log_gaps_[k]);
+      betas_[k + 1] = std::exp(log_beta);
+    }
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
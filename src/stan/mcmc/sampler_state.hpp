@@ -0,0 +1,232 @@
+#ifndef STAN_MCMC_SAMPLER_STATE_HPP
+#define STAN_MCMC_SAMPLER_STATE_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Writes the state of a sampler as whitespace separated text tokens so
+ * that a <code>state_reader</code> can restore it exactly.
+ *
+ * Doubles are written with 17 significant digits, which round trips
+ * every finite value, and as <code>inf</code>, <code>-inf</code> or
+ * <code>nan</code> otherwise. Each component starts with a tag naming
+ * it, so a reader can tell when a state was written by a different
+ * kind of sampler.
+ *
+ * The writer also adds up the memory the written values take in the
+ * sampler, which is how much memory the sampler state needs. Values
+ * are only formatted while the stream is good, so writing to a stream
+ * without a buffer counts the bytes without formatting anything.
+ */
+class state_writer {
+ public:
+  explicit state_writer(std::ostream& out) : out_(out), bytes_(0) {}
+
+  /**
+   * Return the bytes of memory the values written so far take, not
+   * counting tags.
+   */
+  size_t bytes() const { return bytes_; }
+
+  /**
+   * Write a tag naming the component whose state follows.
+   *
+   * @param name tag, which must not contain whitespace
+   */
+  void tag(const std::string& name) { out_ << name << '\n'; }
+
+  void write(double x) {
+    bytes_ += sizeof(x);
+    if (!out_)
+      return;
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", x);
+    out_ << buffer << '\n';
+  }
+
+  void write(int x) {
+    bytes_ += sizeof(x);
+    out_ << x << '\n';
+  }
+
+  void write(unsigned int x) {
+    bytes_ += sizeof(x);
+    out_ << x << '\n';
+  }
+
+  void write(bool x) {
+    bytes_ += sizeof(x);
+    out_ << (x ? 1 : 0) << '\n';
+  }
+
+  /**
+   * Write a matrix or vector as its number of rows and columns followed
+   * by its elements in column major order.
+   *
+   * @tparam Derived type of the matrix expression
+   * @param x matrix or vector
+   */
+  template <typename Derived>
+  void write(const Eigen::DenseBase<Derived>& x) {
+    bytes_ += x.size() * sizeof(typename Derived::Scalar);
+    if (!out_)
+      return;
+    out_ << x.rows() << ' ' << x.cols() << '\n';
+    char buffer[32];
+    for (Eigen::Index j = 0; j < x.cols(); ++j) {
+      for (Eigen::Index i = 0; i < x.rows(); ++i) {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", x(i, j));
+        out_ << (i > 0 ? " " : "") << buffer;
+      }
+      out_ << '\n';
+    }
+  }
+
+  void write(const std::vector<int>& x) {
+    bytes_ += x.size() * sizeof(int);
+    if (!out_)
+      return;
+    out_ << x.size();
+    for (int y : x)
+      out_ << ' ' << y;
+    out_ << '\n';
+  }
+
+  /**
+   * Write the state of a random number generator with its stream
+   * insertion operator.
+   *
+   * @tparam RNG type of random number generator
+   * @param rng random number generator
+   */
+  template <class RNG>
+  void write_rng(const RNG& rng) {
+    bytes_ += sizeof(rng);
+    out_ << rng << '\n';
+  }
+
+ private:
+  std::ostream& out_;
+  size_t bytes_;
+};
+
+/**
+ * Reads a state written by <code>state_writer</code>.
+ *
+ * Every method throws <code>std::invalid_argument</code> if the input
+ * ends early, a value can't be parsed, or a tag doesn't match.
+ */
+class state_reader {
+ public:
+  explicit state_reader(std::istream& in) : in_(in) {}
+
+  /**
+   * Read a tag and check that it names the expected component.
+   *
+   * @param name expected tag
+   */
+  void tag(const std::string& name) {
+    std::string found = token();
+    if (found != name)
+      throw std::invalid_argument("Sampler state: expected " + name
+                                  + " but found " + found);
+  }
+
+  void read(double& x) {
+    std::string s = token();
+    char* end;
+    x = std::strtod(s.c_str(), &end);
+    if (end == s.c_str() || *end != '\0')
+      throw std::invalid_argument("Sampler state: can't read " + s
+                                  + " as a real value");
+  }
+
+  void read(int& x) { x = static_cast<int>(read_integer()); }
+
+  void read(unsigned int& x) {
+    long long y = read_integer();
+    if (y < 0)
+      throw std::invalid_argument("Sampler state: negative count");
+    x = static_cast<unsigned int>(y);
+  }
+
+  void read(bool& x) { x = read_integer() != 0; }
+
+  /**
+   * Read a matrix or vector, resizing it to the size that was written.
+   *
+   * @tparam R number of rows at compile time
+   * @tparam C number of columns at compile time
+   * @param x matrix or vector
+   */
+  template <int R, int C>
+  void read(Eigen::Matrix<double, R, C>& x) {
+    long long rows = read_integer();
+    long long cols = read_integer();
+    if (rows < 0 || cols < 0 || (R != Eigen::Dynamic && rows != R)
+        || (C != Eigen::Dynamic && cols != C))
+      throw std::invalid_argument("Sampler state: bad matrix size");
+    x.resize(rows, cols);
+    for (Eigen::Index j = 0; j < x.cols(); ++j)
+      for (Eigen::Index i = 0; i < x.rows(); ++i)
+        read(x(i, j));
+  }
+
+  void read(std::vector<int>& x) {
+    long long size = read_integer();
+    if (size < 0)
+      throw std::invalid_argument("Sampler state: negative size");
+    x.resize(size);
+    for (int& y : x)
+      read(y);
+  }
+
+  /**
+   * Read the state of a random number generator with its stream
+   * extraction operator.
+   *
+   * @tparam RNG type of random number generator
+   * @param rng random number generator
+   */
+  template <class RNG>
+  void read_rng(RNG& rng) {
+    if (!(in_ >> rng))
+      throw std::invalid_argument(
+          "Sampler state: can't read the random number generator");
+  }
+
+ private:
+  std::istream& in_;
+
+  std::string token() {
+    std::string s;
+    if (!(in_ >> s))
+      throw std::invalid_argument("Sampler state: unexpected end of input");
+    return s;
+  }
+
+  long long read_integer() {
+    std::string s = token();
+    char* end;
+    long long x = std::strtoll(s.c_str(), &end, 10);
+    if (end == s.c_str() || *end != '\0')
+      throw std::invalid_argument("Sampler state: can't read " + s
+                                  + " as an integer");
+    return x;
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
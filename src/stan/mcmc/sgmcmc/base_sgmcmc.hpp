@@ -0,0 +1,267 @@
+#ifndef STAN_MCMC_SGMCMC_BASE_SGMCMC_HPP
+#define STAN_MCMC_SGMCMC_BASE_SGMCMC_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/base_adapter.hpp>
+#include <stan/mcmc/base_mcmc.hpp>
+#include <stan/mcmc/var_adaptation.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+#include <stan/model/draw_rows.hpp>
+#include <stan/model/gradient.hpp>
+#include <stan/model/rows_model.hpp>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Base class for stochastic-gradient MCMC samplers, which take one
+ * step of discretized Langevin or Hamiltonian dynamics per transition
+ * with the gradient of the log density estimated from a mini-batch of
+ * the rows of the data, and without a Metropolis correction. A
+ * transition costs time proportional to the batch size rather than to
+ * the size of the data, at the price of a bias that shrinks with the
+ * step size. The model must provide <code>log_prob_rows()</code> and
+ * <code>num_rows()</code>, see <code>stan::model::rows_model</code>.
+ *
+ * The step size of transition t, counted from zero, is
+ *
+ * <pre>
+ * stepsize * (1 + t / t0)^(-decay),
+ * </pre>
+ *
+ * the polynomial decay of Welling and Teh (2011), "Bayesian learning
+ * via stochastic gradient Langevin dynamics", ICML, which is constant
+ * with a decay of 0.
+ *
+ * The dynamics are preconditioned with a diagonal inverse metric, the
+ * unit metric until adaptation is engaged, which is then estimated
+ * from the draws of the slow windows of warmup by
+ * <code>var_adaptation</code>, as for the diagonal metric of HMC. As
+ * the step size isn't adapted, the estimate is scaled so that its
+ * smallest element is 1: the step along the narrowest direction is
+ * the one the step size was chosen for with the unit metric, and the
+ * wider directions take proportionally longer steps. The sampler
+ * disengages adaptation itself after the number of warmup transitions
+ * given to <code>set_window_params()</code>.
+ *
+ * The log density written with a draw is the estimate from the batch
+ * its gradient was computed with, which is also the one the next step
+ * uses.
+ *
+ * @tparam Model type of model
+ * @tparam BaseRNG type of random number generator
+ */
+template <class Model, class BaseRNG>
+class base_sgmcmc : public base_mcmc, public base_adapter {
+ public:
+  /**
+   * @param model model providing <code>log_prob_rows()</code>
+   * @param rng random number generator
+   * @param batch_size number of rows of data per gradient, which is
+   *   capped at the number of rows
+   * @throw std::invalid_argument if the batch size isn't positive or
+   *   the model has no rows of data
+   */
+  base_sgmcmc(const Model& model, BaseRNG& rng, int batch_size)
+      : model_(model),
+        rng_(rng),
+        num_rows_(model.num_rows()),
+        batch_size_(0),
+        var_adaptation_(model.num_params_r()),
+        var_(Eigen::VectorXd::Ones(model.num_params_r())),
+        inv_metric_(Eigen::VectorXd::Ones(model.num_params_r())),
+        sqrt_inv_metric_(Eigen::VectorXd::Ones(model.num_params_r())),
+        nom_epsilon_(0.1),
+        t0_(1),
+        decay_(0),
+        epsilon_(nom_epsilon_),
+        num_transitions_(0),
+        num_warmup_(0),
+        num_adapted_(0),
+        current_(false),
+        lp_(0) {
+    if (batch_size < 1)
+      throw std::invalid_argument("The batch size must be positive");
+    if (num_rows_ == 0)
+      throw std::invalid_argument(
+          "The model has no rows of data to subsample");
+    batch_size_ = std::min<size_t>(batch_size, num_rows_);
+  }
+
+  /**
+   * Set the step size schedule.
+   *
+   * @param stepsize step size of the first transition
+   * @param t0 number of transitions over which the step size is
+   *   halved with a decay of 1
+   * @param decay exponent of the decay, in [0, 1]
+   * @throw std::invalid_argument if an argument is out of range
+   */
+  void set_stepsize_schedule(double stepsize, double t0, double decay) {
+    if (!(stepsize > 0))
+      throw std::invalid_argument("The step size must be positive");
+    if (!(t0 > 0))
+      throw std::invalid_argument("The step size offset must be positive");
+    if (!(decay >= 0 && decay <= 1))
+      throw std::invalid_argument("The step size decay must be in [0, 1]");
+    nom_epsilon_ = stepsize;
+    t0_ = t0;
+    decay_ = decay;
+  }
+
+  double get_nominal_stepsize() const { return nom_epsilon_; }
+
+  double get_current_stepsize() const { return epsilon_; }
+
+  size_t batch_size() const { return batch_size_; }
+
+  void set_metric(const Eigen::VectorXd& inv_metric) {
+    inv_metric_ = inv_metric;
+    sqrt_inv_metric_ = inv_metric_.array().sqrt().matrix();
+  }
+
+  const Eigen::VectorXd& get_metric() const { return inv_metric_; }
+
+  void set_window_params(unsigned int num_warmup, unsigned int init_buffer,
+                         unsigned int term_buffer, unsigned int base_window,
+                         callbacks::logger& logger) {
+    num_warmup_ = num_warmup;
+    num_adapted_ = 0;
+    var_adaptation_.set_window_params(num_warmup, init_buffer, term_buffer,
+                                      base_window, logger);
+  }
+
+  sample transition(sample& init_sample, callbacks::logger& logger) {
+    const Eigen::VectorXd& q = init_sample.cont_params();
+    if (!(current_ && q.size() == q_.size() && q == q_)) {
+      q_ = q;
+      restart();
+      current_ = batch_gradient(logger);
+      if (!current_)
+        return sample(q_, -std::numeric_limits<double>::infinity(), 0);
+    }
+
+    epsilon_ = nom_epsilon_
+               * std::pow(1 + static_cast<double>(num_transitions_) / t0_,
+                          -decay_);
+    ++num_transitions_;
+    const Eigen::VectorXd q_start = q_;
+    step();
+
+    // A failed gradient keeps the chain where it was
+    if (!batch_gradient(logger)) {
+      q_ = q_start;
+      restart();
+      current_ = batch_gradient(logger);
+      return sample(q_, lp_, 0);
+    }
+
+    if (this->adapt_flag_) {
+      if (var_adaptation_.learn_variance(var_, q_))
+        set_metric(var_ / var_.minCoeff());
+      if (++num_adapted_ == num_warmup_)
+        this->disengage_adaptation();
+    }
+    return sample(q_, lp_, 1);
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    names.push_back("stepsize__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    values.push_back(epsilon_);
+  }
+
+  void write_sampler_state(callbacks::writer& writer) {
+    std::stringstream stepsize;
+    stepsize << "Step size = " << epsilon_;
+    writer(stepsize.str());
+    writer("Diagonal elements of inverse mass matrix:");
+    std::stringstream inv_metric;
+    inv_metric << inv_metric_(0);
+    for (int i = 1; i < inv_metric_.size(); ++i)
+      inv_metric << ", " << inv_metric_(i);
+    writer(inv_metric.str());
+  }
+
+ protected:
+  const Model& model_;
+  BaseRNG& rng_;
+  size_t num_rows_;
+  size_t batch_size_;
+  var_adaptation var_adaptation_;
+  // Latest estimate of the posterior variances
+  Eigen::VectorXd var_;
+  Eigen::VectorXd inv_metric_;
+  Eigen::VectorXd sqrt_inv_metric_;
+
+  double nom_epsilon_;
+  double t0_;
+  double decay_;
+  double epsilon_;
+  size_t num_transitions_;
+  unsigned int num_warmup_;
+  unsigned int num_adapted_;
+
+  // Position, and the batch estimates of the log density and its
+  // gradient there if current_
+  Eigen::VectorXd q_;
+  bool current_;
+  double lp_;
+  Eigen::VectorXd grad_;
+
+  /**
+   * Take one step of the dynamics from <code>q_</code> with step size
+   * <code>epsilon_</code> and the gradient <code>grad_</code>.
+   */
+  virtual void step() = 0;
+
+  /**
+   * Reset the auxiliary state of the dynamics when the chain is moved
+   * to a position other than the one it left.
+   */
+  virtual void restart() {}
+
+  /**
+   * Fill a vector with independent standard normal draws.
+   *
+   * @param[out] x vector to fill
+   */
+  void fill_noise(Eigen::VectorXd& x) {
+    x.resize(q_.size());
+    fill_std_normal(x, rng_);
+  }
+
+ private:
+  /**
+   * Estimate the log density and its gradient at <code>q_</code> from
+   * a batch of rows, and return false if the model throws.
+   */
+  bool batch_gradient(callbacks::logger& logger) {
+    std::vector<size_t> rows
+        = stan::model::draw_rows(num_rows_, batch_size_, rng_);
+    stan::model::rows_model<Model> batch(model_, rows);
+    try {
+      stan::model::gradient(batch, q_, lp_, grad_, logger);
+    } catch (const std::exception& e) {
+      logger.error(e.what());
+      return false;
+    }
+    return std::isfinite(lp_) && grad_.allFinite();
+  }
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
@@ -0,0 +1,87 @@
+#ifndef STAN_MCMC_SGMCMC_SGHMC_HPP
+#define STAN_MCMC_SGMCMC_SGHMC_HPP
+
+#include <stan/mcmc/sgmcmc/base_sgmcmc.hpp>
+#include <cmath>
+#include <stdexcept>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Stochastic gradient Hamiltonian Monte Carlo of Chen, Fox and Guestrin
+ * (2014), "Stochastic gradient Hamiltonian Monte Carlo", ICML, in the
+ * momentum form of its section 3.3, preconditioned with a diagonal
+ * inverse metric M^{-1}. A transition updates the velocity v and the
+ * position as
+ *
+ * <pre>
+ * v' = (1 - alpha) v + (eps^2 / 2) M^{-1} g(q)
+ *      + eps sqrt(alpha) M^{-1/2} xi,
+ * q' = q + v',
+ * </pre>
+ *
+ * where g is the mini-batch estimate of the gradient of the log
+ * density, xi is standard normal and alpha in (0, 1] is the friction.
+ * The noise of the gradient adds to the injected noise, whose variance
+ * is proportional to the friction, and isn't estimated and subtracted,
+ * so the smaller the friction the larger the batches have to be for it
+ * to be negligible. With a friction of 1 the velocity is forgotten
+ * and a transition is one of <code>sgld</code>; smaller frictions carry
+ * momentum across transitions, which explores elongated targets with
+ * fewer gradients.
+ *
+ * The velocity is set to zero when the chain is moved to a position
+ * other than the one it left.
+ *
+ * @tparam Model type of model
+ * @tparam BaseRNG type of random number generator
+ */
+template <class Model, class BaseRNG>
+class sghmc : public base_sgmcmc<Model, BaseRNG> {
+ public:
+  sghmc(const Model& model, BaseRNG& rng, int batch_size)
+      : base_sgmcmc<Model, BaseRNG>(model, rng, batch_size),
+        friction_(0.1),
+        v_(Eigen::VectorXd::Zero(model.num_params_r())) {}
+
+  /**
+   * Set the friction, the fraction of the velocity dissipated per
+   * transition.
+   *
+   * @param friction friction in (0, 1]
+   * @throw std::invalid_argument if the friction is out of range
+   */
+  void set_friction(double friction) {
+    if (!(friction > 0 && friction <= 1))
+      throw std::invalid_argument("The friction must be in (0, 1]");
+    friction_ = friction;
+  }
+
+  double get_friction() const { return friction_; }
+
+  const Eigen::VectorXd& velocity() const { return v_; }
+
+ protected:
+  void step() {
+    this->fill_noise(xi_);
+    const double eps = this->epsilon_;
+    v_.array() = (1 - friction_) * v_.array()
+                 + this->inv_metric_.array() * (0.5 * eps * eps)
+                       * this->grad_.array()
+                 + eps * std::sqrt(friction_)
+                       * this->sqrt_inv_metric_.array() * xi_.array();
+    this->q_ += v_;
+  }
+
+  void restart() { v_.setZero(this->q_.size()); }
+
+ private:
+  double friction_;
+  Eigen::VectorXd v_;
+  Eigen::VectorXd xi_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
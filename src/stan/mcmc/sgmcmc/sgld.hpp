@@ -0,0 +1,46 @@
+#ifndef STAN_MCMC_SGMCMC_SGLD_HPP
+#define STAN_MCMC_SGMCMC_SGLD_HPP
+
+#include <stan/mcmc/sgmcmc/base_sgmcmc.hpp>
+
+namespace stan {
+namespace mcmc {
+
+/**
+ * Stochastic gradient Langevin dynamics of Welling and Teh (2011),
+ * "Bayesian learning via stochastic gradient Langevin dynamics", ICML,
+ * preconditioned with a diagonal inverse metric M^{-1}. A transition is
+ * the Euler step
+ *
+ * <pre>
+ * q' = q + (eps^2 / 2) M^{-1} g(q) + eps M^{-1/2} xi,
+ * </pre>
+ *
+ * where g is the mini-batch estimate of the gradient of the log density
+ * and xi is standard normal.
+ *
+ * @tparam Model type of model
+ * @tparam BaseRNG type of random number generator
+ */
+template <class Model, class BaseRNG>
+class sgld : public base_sgmcmc<Model, BaseRNG> {
+ public:
+  sgld(const Model& model, BaseRNG& rng, int batch_size)
+      : base_sgmcmc<Model, BaseRNG>(model, rng, batch_size) {}
+
+ protected:
+  void step() {
+    this->fill_noise(xi_);
+    const double eps = this->epsilon_;
+    this->q_.array() += this->inv_metric_.array()
+                            * (0.5 * eps * eps) * this->grad_.array()
+                        + eps * this->sqrt_inv_metric_.array() * xi_.array();
+  }
+
+ private:
+  Eigen::VectorXd xi_;
+};
+
+}  // namespace mcmc
+}  // namespace stan
+#endif
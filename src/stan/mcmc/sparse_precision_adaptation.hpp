@@ -0,0 +1,244 @@
+#ifndef STAN_MCMC_SPARSE_PRECISION_ADAPTATION_HPP
+#define STAN_MCMC_SPARSE_PRECISION_ADAPTATION_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/windowed_adaptation.hpp>
+#include <Eigen/SparseCholesky>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * Windowed adaptation of a sparse precision matrix with a fixed
+ * sparsity pattern, such as the graph of a Gaussian Markov random
+ * field. The covariance itself is dense and is never estimated: each
+ * window only accumulates the covariances of the pairs of parameters
+ * that are both in the closed neighbourhood of some parameter, and row
+ * i of the precision is estimated from the regression of parameter i
+ * on its neighbours, the inverse of the covariance of its closed
+ * neighbourhood. That is the row of the precision of a Gaussian whose
+ * conditional independence graph is the pattern, it costs time
+ * proportional to the sum over the parameters of the cube of their
+ * number of neighbours, and the covariances of every neighbourhood are
+ * regularized as in <code>covar_adaptation</code>.
+ *
+ * The two estimates of every off-diagonal element are averaged. If the
+ * result isn't positive definite, which can happen for short windows,
+ * the precision falls back to the inverse of the diagonal of the
+ * covariance.
+ */
+class sparse_precision_adaptation : public windowed_adaptation {
+ public:
+  /**
+   * Construct an adaptation of n parameters with a diagonal pattern.
+   *
+   * @param n number of parameters
+   */
+  explicit sparse_precision_adaptation(int n)
+      : windowed_adaptation("sparse precision"), n_(n), num_samples_(0) {
+    Eigen::SparseMatrix<double> identity(n, n);
+    identity.setIdentity();
+    set_pattern(identity);
+  }
+
+  /**
+   * Set the sparsity pattern of the precision and restart the
+   * estimator. The pattern is that of the nonzeros of the matrix and
+   * its transpose, plus the diagonal.
+   *
+   * @param pattern square matrix with one row per parameter
+   * @throws std::invalid_argument if the matrix has the wrong size
+   */
+  void set_pattern(const Eigen::SparseMatrix<double>& pattern) {
+    if (pattern.rows() != n_ || pattern.cols() != n_)
+      throw std::invalid_argument(
+          "sparse_precision_adaptation: the pattern must be square with "
+          "one row per parameter");
+    neighbours_.assign(n_, std::vector<int>());
+    for (int k = 0; k < pattern.outerSize(); ++k) {
+      for (Eigen::SparseMatrix<double>::InnerIterator it(pattern, k); it;
+           ++it) {
+        if (it.row() == it.col())
+          continue;
+        neighbours_[it.row()].push_back(it.col());
+        neighbours_[it.col()].push_back(it.row());
+      }
+    }
+    std::vector<Eigen::Triplet<double>> precision;
+    std::vector<Eigen::Triplet<double>> products;
+    for (int i = 0; i < n_; ++i) {
+      std::vector<int>& nbhd = neighbours_[i];
+      nbhd.push_back(i);
+      std::sort(nbhd.begin(), nbhd.end());
+      nbhd.erase(std::unique(nbhd.begin(), nbhd.end()), nbhd.end());
+      for (int j : nbhd) {
+        precision.emplace_back(j, i, 0.0);
+        for (int k : nbhd)
+          if (j >= k)
+            products.emplace_back(j, k, 0.0);
+      }
+    }
+    precision_ = Eigen::SparseMatrix<double>(n_, n_);
+    precision_.setFromTriplets(precision.begin(), precision.end());
+    precision_.makeCompressed();
+    m2_ = Eigen::SparseMatrix<double>(n_, n_);
+    m2_.setFromTriplets(products.begin(), products.end(),
+                        [](double a, double b) { return a; });
+    m2_.makeCompressed();
+    restart_estimator();
+  }
+
+  /**
+   * Return the sparsity pattern of the precision, with both triangles
+   * and the diagonal, and values from the latest estimate.
+   */
+  const Eigen::SparseMatrix<double>& pattern() const { return precision_; }
+
+  /**
+   * Add a draw to the current window and, if the window closes, update
+   * the precision.
+   *
+   * @param[in, out] precision metric, which gets the sparsity pattern
+   *   of the adaptation
+   * @param[in] q current draw
+   * @return true if the precision was updated
+   */
+  bool learn_precision(Eigen::SparseMatrix<double>& precision,
+                       const Eigen::VectorXd& q) {
+    STAN_INSTRUMENT_REGION("learn_precision");
+    if (adaptation_window())
+      add_sample(q);
+
+    if (end_adaptation_window()) {
+      compute_next_window();
+
+      start_estimate();
+      estimate_precision();
+      precision = precision_;
+      restart_estimator();
+      end_estimate();
+
+      ++adapt_window_counter_;
+      return true;
+    }
+
+    ++adapt_window_counter_;
+    return false;
+  }
+
+  /**
+   * Write the window position and the running sums. The pattern is
+   * part of the configuration and must be set before the state is
+   * read.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    writer.write(num_samples_);
+    writer.write(mean_);
+    writer.write(
+        Eigen::Map<const Eigen::VectorXd>(m2_.valuePtr(), m2_.nonZeros()));
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    Eigen::VectorXd m2;
+    reader.read(num_samples_);
+    reader.read(mean_);
+    reader.read(m2);
+    if (mean_.size() != n_ || m2.size() != m2_.nonZeros())
+      throw std::invalid_argument(
+          "Sampler state: sparsity pattern doesn't match");
+    Eigen::Map<Eigen::VectorXd>(m2_.valuePtr(), m2_.nonZeros()) = m2;
+  }
+
+ protected:
+  int n_;
+  // Sorted closed neighbourhood of every parameter
+  std::vector<std::vector<int>> neighbours_;
+  // Latest estimate, with the pattern of the precision
+  Eigen::SparseMatrix<double> precision_;
+  // Welford sums of the draws and of the cross products of the lower
+  // triangle of the pairs of parameters that share a neighbourhood
+  double num_samples_;
+  Eigen::VectorXd mean_;
+  Eigen::SparseMatrix<double> m2_;
+
+  void restart_estimator() {
+    num_samples_ = 0;
+    mean_ = Eigen::VectorXd::Zero(n_);
+    Eigen::Map<Eigen::VectorXd>(m2_.valuePtr(), m2_.nonZeros()).setZero();
+  }
+
+  void add_sample(const Eigen::VectorXd& q) {
+    num_samples_ += 1;
+    Eigen::VectorXd delta = q - mean_;
+    mean_ += delta / num_samples_;
+    for (int k = 0; k < m2_.outerSize(); ++k) {
+      const double residual = q(k) - mean_(k);
+      for (Eigen::SparseMatrix<double>::InnerIterator it(m2_, k); it; ++it)
+        it.valueRef() += delta(it.row()) * residual;
+    }
+  }
+
+  /**
+   * Return the regularized covariance of two parameters that share a
+   * neighbourhood.
+   */
+  double covariance(int j, int k) const {
+    const double n = num_samples_;
+    const double covar
+        = n > 1 ? m2_.coeff(std::max(j, k), std::min(j, k)) / (n - 1) : 0;
+    return (n / (n + 5.0)) * covar + (j == k ? 1e-3 * (5.0 / (n + 5.0)) : 0);
+  }
+
+  void estimate_precision() {
+    // Rows of the precision, from the inverse of the covariance of the
+    // closed neighbourhood of each parameter
+    Eigen::SparseMatrix<double> rows = precision_;
+    for (int i = 0; i < n_; ++i) {
+      const std::vector<int>& nbhd = neighbours_[i];
+      const int size = nbhd.size();
+      Eigen::MatrixXd covar(size, size);
+      for (int a = 0; a < size; ++a)
+        for (int b = 0; b <= a; ++b)
+          covar(a, b) = covar(b, a) = covariance(nbhd[a], nbhd[b]);
+      const int self = std::lower_bound(nbhd.begin(), nbhd.end(), i)
+                       - nbhd.begin();
+      Eigen::VectorXd row
+          = covar.llt().solve(Eigen::VectorXd::Unit(size, self));
+      int a = 0;
+      for (Eigen::SparseMatrix<double>::InnerIterator it(rows, i); it;
+           ++it, ++a)
+        it.valueRef() = row(a);
+    }
+
+    // Column i of rows holds row i of the precision
+    Eigen::SparseMatrix<double> transpose = rows.transpose();
+    Eigen::Map<Eigen::VectorXd>(precision_.valuePtr(), precision_.nonZeros())
+        = 0.5
+          * (Eigen::Map<Eigen::VectorXd>(rows.valuePtr(), rows.nonZeros())
+             + Eigen::Map<Eigen::VectorXd>(transpose.valuePtr(),
+                                           transpose.nonZeros()));
+
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt(precision_);
+    if (llt.info() == Eigen::Success)
+      return;
+    for (int k = 0; k < precision_.outerSize(); ++k)
+      for (Eigen::SparseMatrix<double>::InnerIterator it(precision_, k); it;
+           ++it)
+        it.valueRef() = it.row() == it.col() ? 1 / covariance(k, k) : 0;
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
@@ -2,7 +2,9 @@
 #define STAN_MCMC_STEPSIZE_ADAPTATION_HPP
 
 #include <stan/mcmc/base_adaptation.hpp>
+#include <stan/mcmc/sampler_state.hpp>
 #include <cmath>
+#include <limits>
 
 namespace stan {
 
@@ -50,6 +52,7 @@ class stepsize_adaptation : public base_adaptation {
     counter_ = 0;
     s_bar_ = 0;
     x_bar_ = 0;
+    x_bar_change_ = std::numeric_limits<double>::infinity();
   }
 
   void learn_stepsize(double& epsilon, double adapt_stat) {
@@ -65,22 +68,57 @@ class stepsize_adaptation : public base_adaptation {
     const double x = mu_ - s_bar_ * std::sqrt(counter_) / gamma_;
     const double x_eta = std::pow(counter_, -kappa_);
 
-    x_bar_ = (1.0 - x_eta) * x_bar_ + x_eta * x;
+    const double x_bar = (1.0 - x_eta) * x_bar_ + x_eta * x;
+    x_bar_change_ = std::fabs(x_bar - x_bar_);
+    x_bar_ = x_bar;
 
     epsilon = std::exp(x);
   }
 
   void complete_adaptation(double& epsilon) { epsilon = std::exp(x_bar_); }
 
+  /**
+   * Return the absolute change of the averaged log step size in the
+   * last adaptation step, which is approximately the relative change
+   * of the step size <code>complete_adaptation()</code> would set.
+   * Infinite before the first step after a restart.
+   */
+  double stepsize_change() const { return x_bar_change_; }
+
+  /**
+   * Write the dual averaging state, including the asymptotic mean,
+   * which is reset whenever the metric is updated.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    writer.tag("stepsize_adaptation");
+    writer.write(counter_);
+    writer.write(s_bar_);
+    writer.write(x_bar_);
+    writer.write(x_bar_change_);
+    writer.write(mu_);
+  }
+
+  void read_state(state_reader& reader) {
+    reader.tag("stepsize_adaptation");
+    reader.read(counter_);
+    reader.read(s_bar_);
+    reader.read(x_bar_);
+    reader.read(x_bar_change_);
+    reader.read(mu_);
+  }
+
  protected:
-  double counter_;  // Adaptation iteration
-  double s_bar_;    // Moving average statistic
-  double x_bar_;    // Moving average parameter
-  double mu_;       // Asymptotic mean of parameter
-  double delta_;    // Target value of statistic
-  double gamma_;    // Adaptation scaling
-  double kappa_;    // Adaptation shrinkage
-  double t0_;       // Effective starting iteration
+  double counter_;       // Adaptation iteration
+  double s_bar_;         // Moving average statistic
+  double x_bar_;         // Moving average parameter
+  double x_bar_change_;  // Change of the moving average in the last step
+  double mu_;            // Asymptotic mean of parameter
+  double delta_;         // Target value of statistic
+  double gamma_;         // Adaptation scaling
+  double kappa_;         // Adaptation shrinkage
+  double t0_;            // Effective starting iteration
 };
 
 }  // namespace mcmc
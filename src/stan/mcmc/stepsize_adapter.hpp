@@ -20,6 +20,22 @@ class stepsize_adapter : public base_adapter {
     return stepsize_adaptation_;
   }
 
+  /**
+   * Write the state of the adaptation, so that warmup can be resumed
+   * exactly after <code>read_adaptation_state()</code>.
+   *
+   * @param writer state writer
+   */
+  void write_adaptation_state(state_writer& writer) const {
+    write_adapter_state(writer);
+    stepsize_adaptation_.write_state(writer);
+  }
+
+  void read_adaptation_state(state_reader& reader) {
+    read_adapter_state(reader);
+    stepsize_adaptation_.read_state(reader);
+  }
+
  protected:
   stepsize_adaptation stepsize_adaptation_;
 };
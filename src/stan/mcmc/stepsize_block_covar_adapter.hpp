@@ -0,0 +1,66 @@
+#ifndef STAN_MCMC_STEPSIZE_BLOCK_COVAR_ADAPTER_HPP
+#define STAN_MCMC_STEPSIZE_BLOCK_COVAR_ADAPTER_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/base_adapter.hpp>
+#include <stan/mcmc/block_covar_adaptation.hpp>
+#include <stan/mcmc/stepsize_adaptation.hpp>
+#include <string>
+
+namespace stan {
+
+namespace mcmc {
+
+class stepsize_block_covar_adapter : public base_adapter {
+ public:
+  explicit stepsize_block_covar_adapter(int n) : block_covar_adaptation_(n) {}
+
+  stepsize_adaptation& get_stepsize_adaptation() {
+    return stepsize_adaptation_;
+  }
+
+  const stepsize_adaptation& get_stepsize_adaptation() const noexcept {
+    return stepsize_adaptation_;
+  }
+
+  block_covar_adaptation& get_block_covar_adaptation() {
+    return block_covar_adaptation_;
+  }
+
+  void set_window_params(unsigned int num_warmup, unsigned int init_buffer,
+                         unsigned int term_buffer, unsigned int base_window,
+                         callbacks::logger& logger) {
+    block_covar_adaptation_.set_window_params(num_warmup, init_buffer,
+                                              term_buffer, base_window, logger);
+  }
+
+  void write_adaptation_state(state_writer& writer) const {
+    write_adapter_state(writer);
+    stepsize_adaptation_.write_state(writer);
+    block_covar_adaptation_.write_state(writer);
+  }
+
+  void read_adaptation_state(state_reader& reader) {
+    read_adapter_state(reader);
+    stepsize_adaptation_.read_state(reader);
+    block_covar_adaptation_.read_state(reader);
+  }
+
+  std::string adaptation_phase() const {
+    return block_covar_adaptation_.phase();
+  }
+
+  double adaptation_estimate_seconds() const {
+    return block_covar_adaptation_.estimate_seconds();
+  }
+
+ protected:
+  stepsize_adaptation stepsize_adaptation_;
+  block_covar_adaptation block_covar_adaptation_;
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
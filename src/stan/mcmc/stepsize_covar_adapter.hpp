@@ -5,6 +5,7 @@
 #include <stan/mcmc/base_adapter.hpp>
 #include <stan/mcmc/stepsize_adaptation.hpp>
 #include <stan/mcmc/covar_adaptation.hpp>
+#include <string>
 
 namespace stan {
 
@@ -31,6 +32,54 @@ class stepsize_covar_adapter : public base_adapter {
                                         base_window, logger);
   }
 
+  /**
+   * Set the tolerance of the adaptive warmup schedule, see
+   * <code>windowed_adaptation::set_convergence_tolerance()</code>. Once
+   * the schedule has been cut short, warmup ends as soon as the
+   * terminal buffer is over and the averaged step size changes by less
+   * than the same tolerance.
+   *
+   * @param tolerance convergence tolerance, or zero for the fixed
+   *   schedule
+   */
+  void set_convergence_tolerance(double tolerance) {
+    covar_adaptation_.set_convergence_tolerance(tolerance);
+  }
+
+  bool adaptive_schedule() const {
+    return covar_adaptation_.convergence_tolerance() > 0;
+  }
+
+  bool adaptation_converged() {
+    return covar_adaptation_.converged()
+           && covar_adaptation_.window_counter()
+                  >= covar_adaptation_.num_warmup()
+           && stepsize_adaptation_.stepsize_change()
+                  < covar_adaptation_.convergence_tolerance();
+  }
+
+  void write_adaptation_schedule(callbacks::writer& writer) {
+    covar_adaptation_.write_schedule(writer);
+  }
+
+  void write_adaptation_state(state_writer& writer) const {
+    write_adapter_state(writer);
+    stepsize_adaptation_.write_state(writer);
+    covar_adaptation_.write_state(writer);
+  }
+
+  void read_adaptation_state(state_reader& reader) {
+    read_adapter_state(reader);
+    stepsize_adaptation_.read_state(reader);
+    covar_adaptation_.read_state(reader);
+  }
+
+  std::string adaptation_phase() const { return covar_adaptation_.phase(); }
+
+  double adaptation_estimate_seconds() const {
+    return covar_adaptation_.estimate_seconds();
+  }
+
  protected:
   stepsize_adaptation stepsize_adaptation_;
   covar_adaptation covar_adaptation_;
@@ -5,6 +5,7 @@
 #include <stan/mcmc/base_adapter.hpp>
 #include <stan/mcmc/stepsize_adaptation.hpp>
 #include <stan/mcmc/var_adaptation.hpp>
+#include <string>
 
 namespace stan {
 namespace mcmc {
@@ -30,6 +31,53 @@ class stepsize_var_adapter : public base_adapter {
                                       base_window, logger);
   }
 
+  /**
+   * Set the tolerance of the adaptive warmup schedule, see
+   * <code>windowed_adaptation::set_convergence_tolerance()</code>. Once
+   * the schedule has been cut short, warmup ends as soon as the
+   * terminal buffer is over and the averaged step size changes by less
+   * than the same tolerance.
+   *
+   * @param tolerance convergence tolerance, or zero for the fixed
+   *   schedule
+   */
+  void set_convergence_tolerance(double tolerance) {
+    var_adaptation_.set_convergence_tolerance(tolerance);
+  }
+
+  bool adaptive_schedule() const {
+    return var_adaptation_.convergence_tolerance() > 0;
+  }
+
+  bool adaptation_converged() {
+    return var_adaptation_.converged()
+           && var_adaptation_.window_counter() >= var_adaptation_.num_warmup()
+           && stepsize_adaptation_.stepsize_change()
+                  < var_adaptation_.convergence_tolerance();
+  }
+
+  void write_adaptation_schedule(callbacks::writer& writer) {
+    var_adaptation_.write_schedule(writer);
+  }
+
+  void write_adaptation_state(state_writer& writer) const {
+    write_adapter_state(writer);
+    stepsize_adaptation_.write_state(writer);
+    var_adaptation_.write_state(writer);
+  }
+
+  void read_adaptation_state(state_reader& reader) {
+    read_adapter_state(reader);
+    stepsize_adaptation_.read_state(reader);
+    var_adaptation_.read_state(reader);
+  }
+
+  std::string adaptation_phase() const { return var_adaptation_.phase(); }
+
+  double adaptation_estimate_seconds() const {
+    return var_adaptation_.estimate_seconds();
+  }
+
  protected:
   stepsize_adaptation stepsize_adaptation_;
   var_adaptation var_adaptation_;
@@ -2,7 +2,11 @@
 #define STAN_MCMC_VAR_ADAPTATION_HPP
 
 #include <stan/math/prim.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/pooled_moments.hpp>
+#include <stan/mcmc/welford_var_estimator.hpp>
 #include <stan/mcmc/windowed_adaptation.hpp>
+#include <functional>
 #include <vector>
 
 namespace stan {
@@ -15,20 +19,36 @@ class var_adaptation : public windowed_adaptation {
       : windowed_adaptation("variance"), estimator_(n) {}
 
   bool learn_variance(Eigen::VectorXd& var, const Eigen::VectorXd& q) {
+    STAN_INSTRUMENT_REGION("learn_variance");
     if (adaptation_window())
       estimator_.add_sample(q);
 
     if (end_adaptation_window()) {
       compute_next_window();
 
+      if (cross_chain_) {
+        window_pending_ = true;
+        ++adapt_window_counter_;
+        return false;
+      }
+
+      start_estimate();
+      Eigen::VectorXd previous;
+      if (convergence_tolerance_ > 0)
+        previous = var;
+
       estimator_.sample_variance(var);
 
       double n = static_cast<double>(estimator_.num_samples());
-      var = (n / (n + 5.0)) * var
-            + 1e-3 * (5.0 / (n + 5.0)) * Eigen::VectorXd::Ones(var.size());
+      regularize(var, n);
 
       estimator_.restart();
 
+      close_window(convergence_tolerance_ > 0
+                       ? ((var - previous).array().abs() / previous.array())
+                             .maxCoeff()
+                       : 0);
+      end_estimate();
       ++adapt_window_counter_;
       return true;
     }
@@ -37,8 +57,152 @@ class var_adaptation : public windowed_adaptation {
     return false;
   }
 
+  /**
+   * Combine the pending window estimates of several chains into a
+   * single variance estimate and restart the estimator of each chain.
+   * The per-chain means and variances are merged with the pairwise
+   * Welford update, so the result is the sample variance of all of the
+   * chains' window draws taken together. The chains are merged by a
+   * pairwise tree in their order, so the estimate doesn't depend on the
+   * number of threads.
+   *
+   * @param[in,out] adaptations variance adaptations of every chain
+   * @param[out] var regularized pooled variance
+   * @return true if a window was pending and <code>var</code> was updated
+   */
+  static bool pool_variance(const std::vector<var_adaptation*>& adaptations,
+                            Eigen::VectorXd& var) {
+    std::vector<var_adaptation*> pending;
+    for (var_adaptation* adaptation : adaptations)
+      if (adaptation->window_pending_)
+        pending.push_back(adaptation);
+    if (pending.empty())
+      return false;
+
+    typedef pooled_moments<Eigen::VectorXd> moments_t;
+    moments_t pooled = moments_t::pool(pending.size(), [&pending](size_t i) {
+      moments_t chain;
+      chain.n = static_cast<double>(pending[i]->estimator_.num_samples());
+      pending[i]->estimator_.sample_mean(chain.mean);
+      chain.m2 = Eigen::VectorXd::Zero(chain.mean.size());
+      if (chain.n > 1) {
+        pending[i]->estimator_.sample_variance(chain.m2);
+        chain.m2 *= chain.n - 1.0;
+      }
+      return chain;
+    });
+
+    if (pooled.n > 1)
+      var = pooled.m2 / (pooled.n - 1.0);
+    regularize(var, pooled.n);
+
+    for (var_adaptation* adaptation : adaptations) {
+      adaptation->estimator_.restart();
+      adaptation->window_pending_ = false;
+    }
+    return true;
+  }
+
+  /**
+   * Combine the pending window estimates of the chains of several
+   * processes into a single variance estimate and restart the estimator
+   * of each chain, as <code>pool_variance()</code> does for the chains
+   * of one process.
+   *
+   * Every process calls this at the same window boundary with a function
+   * adding a vector elementwise across the processes, which is called
+   * twice with vectors of the same length on every process: first to
+   * sum the number of draws and their sums, then to sum the squared
+   * deviations from the mean of all draws. A process without pending
+   * windows still takes part.
+   *
+   * @param[in,out] adaptations variance adaptations of the chains of
+   *   this process
+   * @param[in,out] var regularized pooled variance, whose size is the
+   *   number of parameters on input
+   * @param[in] all_reduce_sum function replacing a vector by its
+   *   elementwise sum over all processes
+   * @return true if a window was pending on any process and
+   *   <code>var</code> was updated
+   */
+  static bool pool_variance(
+      const std::vector<var_adaptation*>& adaptations, Eigen::VectorXd& var,
+      const std::function<void(Eigen::VectorXd&)>& all_reduce_sum) {
+    const Eigen::Index n_params = var.size();
+    std::vector<var_adaptation*> pending;
+    std::vector<Eigen::VectorXd> chain_means;
+    Eigen::VectorXd chain_mean;
+    // Number of pending chains, number of draws and sum of the draws
+    Eigen::VectorXd sums = Eigen::VectorXd::Zero(2 + n_params);
+    for (var_adaptation* adaptation : adaptations) {
+      if (!adaptation->window_pending_)
+        continue;
+      double chain_n
+          = static_cast<double>(adaptation->estimator_.num_samples());
+      adaptation->estimator_.sample_mean(chain_mean);
+      pending.push_back(adaptation);
+      chain_means.push_back(chain_mean);
+      sums(0) += 1;
+      sums(1) += chain_n;
+      if (chain_n > 0)
+        sums.tail(n_params) += chain_n * chain_mean;
+    }
+    all_reduce_sum(sums);
+    if (sums(0) == 0)
+      return false;
+    const double n = sums(1);
+    Eigen::VectorXd mean = Eigen::VectorXd::Zero(n_params);
+    if (n > 0)
+      mean = sums.tail(n_params) / n;
+
+    Eigen::VectorXd m2 = Eigen::VectorXd::Zero(n_params);
+    Eigen::VectorXd chain_var;
+    for (size_t k = 0; k < pending.size(); ++k) {
+      double chain_n
+          = static_cast<double>(pending[k]->estimator_.num_samples());
+      if (chain_n == 0)
+        continue;
+      chain_var = Eigen::VectorXd::Zero(n_params);
+      pending[k]->estimator_.sample_variance(chain_var);
+      Eigen::VectorXd delta = chain_means[k] - mean;
+      m2 += (chain_n - 1.0) * chain_var + chain_n * delta.cwiseProduct(delta);
+    }
+    all_reduce_sum(m2);
+
+    if (n > 1)
+      var = m2 / (n - 1.0);
+    regularize(var, n);
+
+    for (var_adaptation* adaptation : adaptations) {
+      adaptation->estimator_.restart();
+      adaptation->window_pending_ = false;
+    }
+    return true;
+  }
+
+  /**
+   * Write the window position and the running sums of the current
+   * window.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    write_window_state(writer);
+    estimator_.write_state(writer);
+  }
+
+  void read_state(state_reader& reader) {
+    read_window_state(reader);
+    estimator_.read_state(reader);
+  }
+
  protected:
-  stan::math::welford_var_estimator estimator_;
+  welford_var_estimator estimator_;
+
+  static void regularize(Eigen::VectorXd& var, double n) {
+    var = (n / (n + 5.0)) * var
+          + 1e-3 * (5.0 / (n + 5.0)) * Eigen::VectorXd::Ones(var.size());
+  }
 };
 
 }  // namespace mcmc
@@ -0,0 +1,88 @@
+#ifndef STAN_MCMC_WELFORD_VAR_ESTIMATOR_HPP
+#define STAN_MCMC_WELFORD_VAR_ESTIMATOR_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stdexcept>
+
+namespace stan {
+
+namespace mcmc {
+
+/**
+ * <code>stan::math::welford_var_estimator</code> with accessors for
+ * its running sums, so that the state of an adaptation can be saved and
+ * restored.
+ */
+class welford_var_estimator : public stan::math::welford_var_estimator {
+ public:
+  explicit welford_var_estimator(int n)
+      : stan::math::welford_var_estimator(n) {}
+
+  /**
+   * Get the running sums.
+   *
+   * @param[out] num_samples number of draws added
+   * @param[out] m mean of the draws
+   * @param[out] m2 sum of squared deviations of the draws from the mean
+   */
+  void get_state(double& num_samples, Eigen::VectorXd& m,
+                 Eigen::VectorXd& m2) const {
+    num_samples = num_samples_;
+    m = m_;
+    m2 = m2_;
+  }
+
+  /**
+   * Set the running sums, as returned by <code>get_state()</code>. The
+   * estimator is unchanged if they have another dimension.
+   *
+   * @param num_samples number of draws added
+   * @param m mean of the draws
+   * @param m2 sum of squared deviations of the draws from the mean
+   * @throws std::invalid_argument if the sums have another dimension
+   */
+  void set_state(double num_samples, const Eigen::VectorXd& m,
+                 const Eigen::VectorXd& m2) {
+    if (m.size() != m_.size() || m2.size() != m_.size())
+      throw std::invalid_argument("Sampler state: estimator size mismatch");
+    num_samples_ = num_samples;
+    m_ = m;
+    m2_ = m2;
+  }
+
+  /**
+   * Write the running sums.
+   *
+   * @param writer state writer
+   */
+  void write_state(state_writer& writer) const {
+    writer.write(num_samples_);
+    writer.write(m_);
+    writer.write(m2_);
+  }
+
+  /**
+   * Read running sums written by <code>write_state()</code>. The
+   * estimator is unchanged if they can't be read.
+   *
+   * @param reader state reader
+   * @throws std::invalid_argument if the sums can't be read or have
+   *   another dimension
+   */
+  void read_state(state_reader& reader) {
+    double num_samples;
+    Eigen::VectorXd m;
+    Eigen::VectorXd m2;
+    reader.read(num_samples);
+    reader.read(m);
+    reader.read(m2);
+    set_state(num_samples, m, m2);
+  }
+};
+
+}  // namespace mcmc
+
+}  // namespace stan
+
+#endif
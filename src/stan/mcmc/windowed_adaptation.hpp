@@ -2,9 +2,15 @@
 #define STAN_MCMC_WINDOWED_ADAPTATION_HPP
 
 #include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
 #include <stan/mcmc/base_adaptation.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <chrono>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
 namespace stan {
 namespace mcmc {
@@ -16,6 +22,9 @@ class windowed_adaptation : public base_adaptation {
     adapt_init_buffer_ = 0;
     adapt_term_buffer_ = 0;
     adapt_base_window_ = 0;
+    cross_chain_ = false;
+    convergence_tolerance_ = 0;
+    estimate_seconds_ = 0;
 
     restart();
   }
@@ -24,6 +33,130 @@ class windowed_adaptation : public base_adaptation {
     adapt_window_counter_ = 0;
     adapt_window_size_ = adapt_base_window_;
     adapt_next_window_ = adapt_init_buffer_ + adapt_window_size_ - 1;
+    window_pending_ = false;
+    converged_ = false;
+    window_ends_.clear();
+  }
+
+  /**
+   * Set whether the window estimates are pooled across chains. When
+   * they are, closing an adaptation window keeps the samples of that
+   * window and flags it as pending until the estimates of all chains
+   * have been combined.
+   *
+   * @param cross_chain true to pool estimates across chains
+   */
+  void set_cross_chain(bool cross_chain) { cross_chain_ = cross_chain; }
+
+  bool cross_chain() const { return cross_chain_; }
+
+  /**
+   * Set the tolerance of the adaptive schedule. When it is positive,
+   * each window estimate after the first is compared to the estimate
+   * of the window before, and once their relative difference is below
+   * the tolerance no further windows are opened: the schedule is cut
+   * short to the terminal buffer following that window. Zero, the
+   * default, keeps the fixed doubling schedule.
+   *
+   * @param tolerance relative change below which the estimate is
+   *   considered converged
+   */
+  void set_convergence_tolerance(double tolerance) {
+    convergence_tolerance_ = tolerance;
+  }
+
+  double convergence_tolerance() const { return convergence_tolerance_; }
+
+  /**
+   * Return true if the adaptive schedule has cut the warmup short.
+   */
+  bool converged() const { return converged_; }
+
+  /**
+   * Return the number of warmup iterations of the schedule, which is
+   * smaller than the configured number once the schedule has been cut
+   * short.
+   */
+  unsigned int num_warmup() const { return num_warmup_; }
+
+  /**
+   * Return the number of adaptation steps taken so far.
+   */
+  unsigned int window_counter() const { return adapt_window_counter_; }
+
+  /**
+   * Return the iterations, counted from the start of warmup, after
+   * which each slow adaptation window so far has closed.
+   */
+  const std::vector<int>& window_ends() const { return window_ends_; }
+
+  /**
+   * Write the iterations after which the slow adaptation windows
+   * closed and, if the schedule was cut short, the number of warmup
+   * iterations it was cut to, with the adaptation info.
+   *
+   * @param writer writer of the adaptation info
+   */
+  void write_schedule(callbacks::writer& writer) const {
+    std::stringstream msg;
+    msg << "Adaptation windows closed after iterations:";
+    for (size_t i = 0; i < window_ends_.size(); ++i)
+      msg << (i > 0 ? ", " : " ") << window_ends_[i];
+    writer(msg.str());
+    if (converged_) {
+      std::stringstream converged_msg;
+      converged_msg << "The " << estimator_name_
+                    << " estimate converged, warmup cut to " << num_warmup_
+                    << " iterations";
+      writer(converged_msg.str());
+    }
+  }
+
+  /**
+   * Return the name of the warmup phase the next adaptation step
+   * belongs to: <code>init_buffer</code>, <code>window_k</code> for the
+   * k-th slow adaptation window, or <code>term_buffer</code>. Without
+   * window parameters the whole warmup only adapts the step size and
+   * the phase is <code>stepsize</code>.
+   */
+  std::string phase() const {
+    if (num_warmup_ == 0)
+      return "stepsize";
+    if (adapt_window_counter_ < adapt_init_buffer_)
+      return "init_buffer";
+    if (!adaptation_window())
+      return "term_buffer";
+    // Every window is twice as long as the one before
+    int window = 1;
+    for (unsigned int size = adapt_base_window_;
+         size > 0 && size < adapt_window_size_; size *= 2)
+      ++window;
+    return "window_" + std::to_string(window);
+  }
+
+  /**
+   * Return the total wall clock time spent computing the window
+   * estimates, in seconds.
+   */
+  double estimate_seconds() const { return estimate_seconds_; }
+
+  /**
+   * Return true if an adaptation window has closed and is waiting for
+   * its estimates to be pooled across chains.
+   */
+  bool window_pending() const { return window_pending_; }
+
+  /**
+   * Return the number of transitions up to and including the one that
+   * closes the current adaptation window, or zero if no slow adaptation
+   * window remains. Every chain configured with the same window
+   * parameters closes its windows on the same transitions.
+   */
+  unsigned int transitions_to_window_end() const {
+    if (adapt_next_window_ < adapt_window_counter_
+        || adapt_next_window_ >= num_warmup_)
+      return 0;
+    return adapt_next_window_ - adapt_window_counter_ + 1;
   }
 
   void set_window_params(unsigned int num_warmup, unsigned int init_buffer,
@@ -77,7 +210,7 @@ class windowed_adaptation : public base_adaptation {
     restart();
   }
 
-  bool adaptation_window() {
+  bool adaptation_window() const {
     return (adapt_window_counter_ >= adapt_init_buffer_)
            && (adapt_window_counter_ < num_warmup_ - adapt_term_buffer_)
            && (adapt_window_counter_ != num_warmup_);
@@ -88,6 +221,62 @@ class windowed_adaptation : public base_adaptation {
            && (adapt_window_counter_ != num_warmup_);
   }
 
+  /**
+   * Write the window parameters and the position within the windows.
+   *
+   * @param writer state writer
+   */
+  void write_window_state(state_writer& writer) const {
+    writer.tag("windowed_adaptation");
+    writer.write(num_warmup_);
+    writer.write(adapt_init_buffer_);
+    writer.write(adapt_term_buffer_);
+    writer.write(adapt_base_window_);
+    writer.write(adapt_window_counter_);
+    writer.write(adapt_next_window_);
+    writer.write(adapt_window_size_);
+    writer.write(window_pending_);
+    writer.write(converged_);
+    writer.write(window_ends_);
+  }
+
+  void read_window_state(state_reader& reader) {
+    reader.tag("windowed_adaptation");
+    reader.read(num_warmup_);
+    reader.read(adapt_init_buffer_);
+    reader.read(adapt_term_buffer_);
+    reader.read(adapt_base_window_);
+    reader.read(adapt_window_counter_);
+    reader.read(adapt_next_window_);
+    reader.read(adapt_window_size_);
+    reader.read(window_pending_);
+    reader.read(converged_);
+    reader.read(window_ends_);
+  }
+
+  /**
+   * Record the close of the current window and, with the adaptive
+   * schedule, cut the warmup short to the terminal buffer if the window
+   * estimate changed by less than the tolerance. Called with the
+   * window counter still pointing at the closing iteration.
+   *
+   * @param relative_change relative difference between the estimates
+   *   of this window and the one before; ignored for the first window
+   */
+  void close_window(double relative_change) {
+    bool first_window = window_ends_.empty();
+    window_ends_.push_back(adapt_window_counter_ + 1);
+    if (convergence_tolerance_ <= 0 || first_window
+        || !(relative_change < convergence_tolerance_))
+      return;
+    unsigned int end = adapt_window_counter_ + 1 + adapt_term_buffer_;
+    if (end >= num_warmup_)
+      return;
+    converged_ = true;
+    num_warmup_ = end;
+    adapt_next_window_ = num_warmup_;
+  }
+
   void compute_next_window() {
     if (adapt_next_window_ == num_warmup_ - adapt_term_buffer_ - 1)
       return;
@@ -120,6 +309,25 @@ class windowed_adaptation : public base_adaptation {
   unsigned int adapt_window_counter_;
   unsigned int adapt_next_window_;
   unsigned int adapt_window_size_;
+
+  bool cross_chain_;
+  bool window_pending_;
+
+  double convergence_tolerance_;
+  bool converged_;
+  std::vector<int> window_ends_;
+
+  double estimate_seconds_;
+  std::chrono::steady_clock::time_point estimate_start_;
+
+  void start_estimate() { estimate_start_ = std::chrono::steady_clock::now(); }
+
+  void end_estimate() {
+    STAN_INSTRUMENT_SPAN("adaptation_window_end", estimate_start_);
+    estimate_seconds_ += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - estimate_start_)
+                             .count();
+  }
 };
 
 }  // namespace mcmc
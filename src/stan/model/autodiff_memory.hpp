@@ -0,0 +1,70 @@
+#ifndef STAN_MODEL_AUTODIFF_MEMORY_HPP
+#define STAN_MODEL_AUTODIFF_MEMORY_HPP
+
+#include <stan/math/rev.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace stan {
+namespace model {
+
+/**
+ * Tracks the largest number of bytes of autodiff arena held at the end
+ * of a single gradient evaluation on the calling thread, as recorded by
+ * <code>log_prob_grad()</code> and <code>negative_gradient()</code>.
+ *
+ * The arena grows in blocks and keeps them from one evaluation to the
+ * next, so the peak is what a thread running a model needs for its
+ * autodiff tape, rounded up to the blocks it takes. The size of the
+ * tape itself is the number of variables on it, returned by
+ * <code>tape_size()</code>. Each thread has its own peak, as each has
+ * its own arena.
+ */
+class autodiff_memory {
+ public:
+  /**
+   * Return the bytes of the arena blocks of this thread in use, from
+   * the first block to the one the next variable is allocated in.
+   */
+  static size_t arena_bytes() {
+    return math::ChainableStack::instance_->memalloc_.bytes_allocated();
+  }
+
+  /**
+   * Return the number of variables on the autodiff tape of this thread,
+   * on its chaining and non-chaining stacks.
+   */
+  static size_t tape_size() {
+    return math::ChainableStack::instance_->var_stack_.size()
+           + math::ChainableStack::instance_->var_nochain_stack_.size();
+  }
+
+  /**
+   * Record the arena held at the end of a gradient evaluation.
+   *
+   * @param bytes arena bytes in use, as returned by
+   *   <code>arena_bytes()</code>
+   */
+  static void record(size_t bytes) { peak() = std::max(peak(), bytes); }
+
+  /**
+   * Return the largest bytes recorded on this thread since the last
+   * reset.
+   */
+  static size_t peak_bytes() { return peak(); }
+
+  /**
+   * Reset the peak of this thread, so that a new run starts afresh.
+   */
+  static void reset_peak() { peak() = 0; }
+
+ private:
+  static size_t& peak() {
+    static thread_local size_t bytes = 0;
+    return bytes;
+  }
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
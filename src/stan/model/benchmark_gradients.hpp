@@ -0,0 +1,179 @@
+#ifndef STAN_MODEL_BENCHMARK_GRADIENTS_HPP
+#define STAN_MODEL_BENCHMARK_GRADIENTS_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/math/rev.hpp>
+#include <stan/model/autodiff_memory.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Latencies in seconds of repeated evaluations of one kind.
+ */
+struct latency_summary {
+  double mean = 0;
+  double median = 0;
+  double p99 = 0;
+};
+
+/**
+ * Timings of repeated evaluations of a model's log density, and of its
+ * log density and gradient, at a single point.
+ */
+struct gradient_benchmark {
+  /**
+   * Number of evaluations of each kind.
+   */
+  int num_evals = 0;
+  /**
+   * Latency of the log density evaluated with doubles.
+   */
+  latency_summary log_prob;
+  /**
+   * Latency of the log density and its gradient by reverse mode
+   * autodiff.
+   */
+  latency_summary log_prob_grad;
+  /**
+   * Bytes of autodiff arena in use at the end of one gradient
+   * evaluation, which grows in blocks.
+   */
+  size_t tape_bytes = 0;
+  /**
+   * Number of autodiff variables on the tape after one gradient
+   * evaluation.
+   */
+  size_t tape_vars = 0;
+
+  /**
+   * Return the number of gradients evaluated per second at the mean
+   * latency.
+   */
+  double gradients_per_second() const {
+    return log_prob_grad.mean > 0 ? 1 / log_prob_grad.mean : 0;
+  }
+};
+
+namespace internal {
+
+/**
+ * Summarize latencies, reordering them. The 99th percentile is the
+ * smallest latency at least as large as 99% of them.
+ */
+inline latency_summary summarize_latencies(std::vector<double>& seconds) {
+  latency_summary summary;
+  if (seconds.empty())
+    return summary;
+  double sum = 0;
+  for (double s : seconds)
+    sum += s;
+  summary.mean = sum / seconds.size();
+  size_t n = seconds.size();
+  auto nth = [&](size_t k) {
+    std::nth_element(seconds.begin(), seconds.begin() + k, seconds.end());
+    return seconds[k];
+  };
+  summary.median
+      = n % 2 == 1 ? nth(n / 2) : 0.5 * (nth(n / 2 - 1) + nth(n / 2));
+  summary.p99
+      = nth(std::min(n - 1, static_cast<size_t>(std::ceil(0.99 * n)) - 1));
+  return summary;
+}
+
+}  // namespace internal
+
+/**
+ * Time repeated evaluations of the model's log density, with doubles,
+ * and of its log density and gradient, by reverse mode autodiff, at
+ * the specified point. Each kind is evaluated once untimed first, so
+ * that the autodiff arena has grown to its working size.
+ *
+ * The log density is evaluated with the Jacobian adjustment and
+ * dropping constants only for the gradient, as the samplers do.
+ *
+ * @tparam M model class
+ * @param[in] model model
+ * @param[in] params_r unconstrained parameters
+ * @param[in] params_i integer parameters
+ * @param[in] num_evals number of timed evaluations of each kind
+ * @param[in,out] interrupt interrupt callback called before each
+ *   evaluation
+ * @param[in,out] msgs stream for print statements in the model
+ * @return the timings
+ * @throws std::invalid_argument if <code>num_evals</code> is not
+ *   positive
+ * @throws std::exception rethrown from the model
+ */
+template <class M>
+gradient_benchmark benchmark_gradients(const M& model,
+                                       std::vector<double>& params_r,
+                                       std::vector<int>& params_i,
+                                       int num_evals,
+                                       callbacks::interrupt& interrupt,
+                                       std::ostream* msgs = 0) {
+  using clock = std::chrono::steady_clock;
+  using stan::math::var;
+  if (num_evals < 1)
+    throw std::invalid_argument("num_evals must be positive");
+
+  gradient_benchmark benchmark;
+  std::vector<double> seconds;
+  seconds.reserve(num_evals);
+  volatile double sink = 0;
+
+  model.template log_prob<false, true>(params_r, params_i, msgs);
+  for (int n = 0; n < num_evals; ++n) {
+    interrupt();
+    auto start = clock::now();
+    sink = model.template log_prob<false, true>(params_r, params_i, msgs);
+    seconds.push_back(
+        std::chrono::duration<double>(clock::now() - start).count());
+  }
+  benchmark.log_prob = internal::summarize_latencies(seconds);
+
+  std::vector<var> ad_params_r(params_r.size());
+  std::vector<double> gradient;
+  auto evaluate_gradient = [&]() {
+    for (size_t i = 0; i < params_r.size(); ++i)
+      ad_params_r[i] = params_r[i];
+    var lp = model.template log_prob<true, true>(ad_params_r, params_i, msgs);
+    lp.grad(ad_params_r, gradient);
+    return lp.val();
+  };
+  try {
+    stan::math::recover_memory();
+    evaluate_gradient();
+    benchmark.tape_bytes = autodiff_memory::arena_bytes();
+    benchmark.tape_vars = autodiff_memory::tape_size();
+    stan::math::recover_memory();
+
+    seconds.clear();
+    for (int n = 0; n < num_evals; ++n) {
+      interrupt();
+      auto start = clock::now();
+      sink = evaluate_gradient();
+      stan::math::recover_memory();
+      seconds.push_back(
+          std::chrono::duration<double>(clock::now() - start).count());
+    }
+  } catch (const std::exception& e) {
+    stan::math::recover_memory();
+    throw;
+  }
+  benchmark.log_prob_grad = internal::summarize_latencies(seconds);
+  benchmark.num_evals = num_evals;
+  static_cast<void>(sink);
+  return benchmark;
+}
+
+}  // namespace model
+}  // namespace stan
+#endif
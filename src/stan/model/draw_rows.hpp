@@ -0,0 +1,46 @@
+#ifndef STAN_MODEL_DRAW_ROWS_HPP
+#define STAN_MODEL_DRAW_ROWS_HPP
+
+#include <boost/random/uniform_int_distribution.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Draw a batch of distinct rows of data uniformly at random with
+ * Floyd's algorithm, in time proportional to the batch size, and return
+ * them in increasing order, for evaluating a model on a mini-batch with
+ * <code>rows_model</code>.
+ *
+ * @tparam RNG type of random number generator
+ * @param[in] num_rows number of rows of data
+ * @param[in] batch_size number of rows to draw, at most
+ *   <code>num_rows</code>
+ * @param[in,out] rng random number generator
+ * @return indices of the rows
+ */
+template <class RNG>
+std::vector<size_t> draw_rows(size_t num_rows, size_t batch_size, RNG& rng) {
+  std::vector<size_t> rows;
+  rows.reserve(batch_size);
+  std::unordered_set<size_t> drawn(2 * batch_size);
+  for (size_t j = num_rows - batch_size; j < num_rows; ++j) {
+    boost::random::uniform_int_distribution<size_t> pick(0, j);
+    size_t row = pick(rng);
+    if (!drawn.insert(row).second) {
+      row = j;
+      drawn.insert(row);
+    }
+    rows.push_back(row);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+}  // namespace model
+}  // namespace stan
+#endif
@@ -0,0 +1,306 @@
+#ifndef STAN_MODEL_EVALUATOR_POOL_HPP
+#define STAN_MODEL_EVALUATOR_POOL_HPP
+
+#include <stan/math/rev.hpp>
+#include <stan/model/log_prob_grad.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * An <code>evaluator_pool</code> evaluates the log density, its
+ * gradient and the constrained values of a single model instance from
+ * several threads at once, so that parallel initialization, generated
+ * quantities, variational inference and multi-start optimization share
+ * one tested way of doing so.
+ *
+ * The pool owns <code>num_threads</code> threads of its own, rather
+ * than borrowing the TBB thread pool, so that its futures make progress
+ * however many TBB workers there are, also while the caller waits on
+ * one. Each thread gets its own autodiff stack when it starts, and
+ * every evaluation runs on a nested stack, so its memory is recovered
+ * when the evaluation ends, also when it throws.
+ *
+ * The asynchronous calls copy their arguments and return a future of
+ * the result. An exception thrown by the model is rethrown by the
+ * future's <code>get()</code>. The batched call blocks until all points
+ * are evaluated and, as the batched <code>log_prob_grad()</code>, sets
+ * the results of failed points to NaN. The messages a model prints are
+ * returned with each result instead of written to a shared stream.
+ *
+ * Only the const methods of the model are called, which models must
+ * allow concurrently; see <code>model_base</code>. The model must
+ * outlive the pool, and the destructor waits for the evaluations still
+ * running. Without <code>STAN_THREADS</code> every call is evaluated on
+ * the calling thread before it returns.
+ *
+ * @tparam Model type of the model
+ */
+template <class Model>
+class evaluator_pool {
+ public:
+  /**
+   * Result of an evaluation of the log density.
+   */
+  struct evaluation {
+    double log_prob;
+    // Gradient of the log density, empty if it wasn't requested
+    Eigen::VectorXd gradient;
+    // Messages printed by the model
+    std::string messages;
+  };
+
+  /**
+   * Result of an evaluation of the constrained values.
+   */
+  struct draw {
+    Eigen::VectorXd values;
+    std::string messages;
+  };
+
+  /**
+   * Construct a pool evaluating a model.
+   *
+   * @param[in] model model evaluated by the pool
+   * @param[in] num_threads number of threads of the pool, or -1 for one
+   *   per hardware thread
+   */
+  explicit evaluator_pool(const Model& model, int num_threads = -1)
+      : model_(model), num_running_(0), stopping_(false) {
+#ifdef STAN_THREADS
+    if (num_threads < 1)
+      num_threads = std::max(1U, std::thread::hardware_concurrency());
+    for (int i = 0; i < num_threads; ++i)
+      workers_.emplace_back([this] { work(); });
+#endif
+  }
+
+  evaluator_pool(const evaluator_pool&) = delete;
+  evaluator_pool& operator=(const evaluator_pool&) = delete;
+
+  ~evaluator_pool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread& worker : workers_)
+      worker.join();
+  }
+
+  /**
+   * Return the number of threads evaluating in parallel.
+   */
+  int num_threads() const { return std::max<int>(1, workers_.size()); }
+
+  /**
+   * Wait for every asynchronous evaluation to finish.
+   */
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return queue_.empty() && !num_running_; });
+  }
+
+  /**
+   * Evaluate the log density asynchronously. The density up to a
+   * proportion is evaluated with autodiff variables, as
+   * <code>log_prob_propto()</code> does.
+   *
+   * @tparam propto true to drop constant terms
+   * @tparam jacobian true to include the Jacobian adjustment
+   * @param[in] params_r unconstrained parameters
+   * @return future of the log density, without a gradient
+   */
+  template <bool propto, bool jacobian>
+  std::future<evaluation> log_prob(Eigen::VectorXd params_r) {
+    const Model& model = model_;
+    return submit<evaluation>([&model, params_r]() mutable {
+      evaluation result;
+      std::stringstream ss;
+      if (propto) {
+        math::nested_rev_autodiff nested;
+        Eigen::Matrix<math::var, -1, 1> params_var(params_r.size());
+        for (int i = 0; i < params_r.size(); ++i)
+          params_var.coeffRef(i) = params_r.coeff(i);
+        result.log_prob
+            = model.template log_prob<true, jacobian>(params_var, &ss).val();
+      } else {
+        result.log_prob
+            = model.template log_prob<false, jacobian>(params_r, &ss);
+      }
+      result.messages = ss.str();
+      return result;
+    });
+  }
+
+  /**
+   * Evaluate the log density and its gradient asynchronously.
+   *
+   * @tparam propto true to drop constant terms
+   * @tparam jacobian true to include the Jacobian adjustment
+   * @param[in] params_r unconstrained parameters
+   * @return future of the log density and its gradient
+   */
+  template <bool propto, bool jacobian>
+  std::future<evaluation> log_prob_grad(Eigen::VectorXd params_r) {
+    const Model& model = model_;
+    return submit<evaluation>([&model, params_r]() {
+      evaluation result;
+      std::stringstream ss;
+      math::gradient(
+          internal::log_prob_functional<propto, jacobian, Model>(model, &ss),
+          params_r, result.log_prob, result.gradient);
+      result.messages = ss.str();
+      return result;
+    });
+  }
+
+  /**
+   * Compute the constrained values of a draw asynchronously, as
+   * <code>write_array()</code> of the model does.
+   *
+   * @tparam RNG type of random number generator
+   * @param[in] rng generator of the generated quantities, copied
+   * @param[in] params_r unconstrained parameters
+   * @param[in] include_tparams true to include transformed parameters
+   * @param[in] include_gqs true to include generated quantities
+   * @return future of the constrained values
+   */
+  template <class RNG>
+  std::future<draw> write_array(const RNG& rng, Eigen::VectorXd params_r,
+                                bool include_tparams = true,
+                                bool include_gqs = true) {
+    const Model& model = model_;
+    return submit<draw>([&model, draw_rng = RNG(rng), params_r,
+                         include_tparams, include_gqs]() mutable {
+      draw result;
+      std::stringstream ss;
+      model.write_array(draw_rng, params_r, result.values, include_tparams,
+                        include_gqs, &ss);
+      result.messages = ss.str();
+      return result;
+    });
+  }
+
+  /**
+   * Evaluate the log density and its gradient at each column of a
+   * matrix, spreading the columns over the pool's threads. Points whose
+   * evaluation throws get a NaN log density and gradient. Blocks until
+   * every point is evaluated, so it must not be called from a thread of
+   * the pool.
+   *
+   * @tparam propto true to drop constant terms
+   * @tparam jacobian true to include the Jacobian adjustment
+   * @param[in] params_r unconstrained parameters, one point per column
+   * @param[out] log_prob log density at each point
+   * @param[out] gradients gradient at each point, one per column
+   * @param[in,out] msgs stream the messages of the model are written to
+   *   in column order, or a null pointer
+   */
+  template <bool propto, bool jacobian>
+  void log_prob_grad(const Eigen::MatrixXd& params_r,
+                     Eigen::VectorXd& log_prob, Eigen::MatrixXd& gradients,
+                     std::ostream* msgs = 0) {
+    const Eigen::Index num_points = params_r.cols();
+    log_prob.resize(num_points);
+    gradients.resize(params_r.rows(), num_points);
+    std::vector<std::string> messages(msgs ? num_points : 0);
+    auto evaluate = [&](Eigen::Index begin, Eigen::Index end) {
+      std::stringstream ss;
+      Eigen::VectorXd gradient;
+      for (Eigen::Index j = begin; j < end; ++j) {
+        ss.str("");
+        try {
+          math::gradient(
+              internal::log_prob_functional<propto, jacobian, Model>(
+                  model_, msgs ? &ss : 0),
+              params_r.col(j), log_prob(j), gradient);
+          gradients.col(j) = gradient;
+        } catch (const std::exception&) {
+          log_prob(j) = std::numeric_limits<double>::quiet_NaN();
+          gradients.col(j).fill(std::numeric_limits<double>::quiet_NaN());
+        }
+        if (msgs)
+          messages[j] = ss.str();
+      }
+    };
+    // One block of columns per thread
+    const Eigen::Index num_blocks
+        = std::min<Eigen::Index>(num_threads(), num_points);
+    std::vector<std::future<void>> blocks;
+    for (Eigen::Index b = 0; b < num_blocks; ++b) {
+      Eigen::Index begin = b * num_points / num_blocks;
+      Eigen::Index end = (b + 1) * num_points / num_blocks;
+      blocks.emplace_back(
+          submit<void>([&evaluate, begin, end] { evaluate(begin, end); }));
+    }
+    for (std::future<void>& block : blocks)
+      block.get();
+    if (msgs)
+      for (const std::string& message : messages)
+        *msgs << message;
+  }
+
+ private:
+  const Model& model_;
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> queue_;
+  size_t num_running_;
+  bool stopping_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+
+  void work() {
+    math::ChainableStack autodiff_stack;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (queue_.empty())
+        return;
+      std::function<void()> task = std::move(queue_.front());
+      queue_.pop_front();
+      ++num_running_;
+      lock.unlock();
+      task();
+      lock.lock();
+      --num_running_;
+      if (queue_.empty() && !num_running_)
+        work_done_.notify_all();
+    }
+  }
+
+  template <typename T, typename F>
+  std::future<T> submit(F&& f) {
+    auto task = std::make_shared<std::packaged_task<T()>>(std::forward<F>(f));
+    std::future<T> result = task->get_future();
+    if (workers_.empty()) {
+      (*task)();
+      return result;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_.emplace_back([task] { (*task)(); });
+    }
+    work_ready_.notify_one();
+    return result;
+  }
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
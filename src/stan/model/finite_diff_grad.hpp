@@ -2,11 +2,90 @@
 #define STAN_MODEL_FINITE_DIFF_GRAD_HPP
 
 #include <stan/callbacks/interrupt.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace stan {
 namespace model {
+namespace internal {
+
+/**
+ * Compute central finite differences of the log density along a
+ * sequence of directions, writing the <code>j</code>-th difference
+ * into <code>result[j]</code>.
+ *
+ * The directions are given by <code>perturb(j, step, x)</code>, which
+ * must set <code>x</code> to <code>params_r</code> plus
+ * <code>step</code> times the <code>j</code>-th direction, given that
+ * <code>x</code> holds <code>params_r</code> plus some multiple of the
+ * same direction. When <code>parallel</code> is true and Stan is built
+ * with <code>STAN_THREADS</code>, blocks of directions are spread over
+ * the TBB thread pool, each thread perturbing its own copy of the
+ * parameters, and the interrupt is called once per block on the
+ * calling thread. Output from the model is written in direction order.
+ */
+template <bool propto, bool jacobian_adjust_transform, class M, class F>
+void central_differences(const M& model, stan::callbacks::interrupt& interrupt,
+                         const std::vector<double>& params_r,
+                         std::vector<int>& params_i, size_t num_directions,
+                         const F& perturb, std::vector<double>& result,
+                         double epsilon, bool parallel, std::ostream* msgs) {
+  result.resize(num_directions);
+  auto difference = [&](size_t j, std::vector<double>& perturbed,
+                        std::ostream* out) {
+    perturb(j, epsilon, perturbed);
+    double logp_plus
+        = model.template log_prob<propto, jacobian_adjust_transform>(
+            perturbed, params_i, out);
+    perturb(j, -epsilon, perturbed);
+    double logp_minus
+        = model.template log_prob<propto, jacobian_adjust_transform>(
+            perturbed, params_i, out);
+    result[j] = (logp_plus - logp_minus) / (2 * epsilon);
+    perturb(j, 0, perturbed);
+  };
+
+#ifdef STAN_THREADS
+  if (parallel && num_directions > 1) {
+    const size_t block_size = 256;
+    std::vector<std::string> messages(msgs ? block_size : 0);
+    for (size_t begin = 0; begin < num_directions; begin += block_size) {
+      interrupt();
+      const size_t end = std::min(num_directions, begin + block_size);
+      tbb::parallel_for(tbb::blocked_range<size_t>(begin, end),
+                        [&](const tbb::blocked_range<size_t>& r) {
+                          std::vector<double> perturbed(params_r);
+                          std::stringstream ss;
+                          for (size_t j = r.begin(); j < r.end(); ++j) {
+                            ss.str("");
+                            difference(j, perturbed, msgs ? &ss : 0);
+                            if (msgs)
+                              messages[j - begin] = ss.str();
+                          }
+                        });
+      if (msgs)
+        for (size_t j = begin; j < end; ++j)
+          *msgs << messages[j - begin];
+    }
+    return;
+  }
+#endif
+  std::vector<double> perturbed(params_r);
+  for (size_t j = 0; j < num_directions; ++j) {
+    interrupt();
+    difference(j, perturbed, msgs);
+  }
+}
+
+}  // namespace internal
 
 /**
  * Compute the gradient using finite differences for
@@ -33,22 +112,99 @@ void finite_diff_grad(const M& model, stan::callbacks::interrupt& interrupt,
                       std::vector<double>& params_r, std::vector<int>& params_i,
                       std::vector<double>& grad, double epsilon = 1e-6,
                       std::ostream* msgs = 0) {
-  std::vector<double> perturbed(params_r);
-  grad.resize(params_r.size());
-  for (size_t k = 0; k < params_r.size(); k++) {
-    interrupt();
-    perturbed[k] += epsilon;
-    double logp_plus
-        = model.template log_prob<propto, jacobian_adjust_transform>(
-            perturbed, params_i, msgs);
-    perturbed[k] = params_r[k] - epsilon;
-    double logp_minus
-        = model.template log_prob<propto, jacobian_adjust_transform>(
-            perturbed, params_i, msgs);
-    double gradest = (logp_plus - logp_minus) / (2 * epsilon);
-    grad[k] = gradest;
-    perturbed[k] = params_r[k];
-  }
+  internal::central_differences<propto, jacobian_adjust_transform>(
+      model, interrupt, params_r, params_i, params_r.size(),
+      [&](size_t k, double step, std::vector<double>& x) {
+        x[k] = params_r[k] + step;
+      },
+      grad, epsilon, false, msgs);
+}
+
+/**
+ * Compute the partial derivatives of the log density with respect to
+ * the specified coordinates of the parameters using finite
+ * differences, writing the derivative with respect to
+ * <code>coordinates[j]</code> into <code>grad[j]</code>.
+ *
+ * When <code>parallel</code> is true and Stan is built with
+ * <code>STAN_THREADS</code>, the coordinates are spread over the TBB
+ * thread pool and the interrupt is called once per block of
+ * coordinates rather than once per coordinate.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to the
+ * log probability.
+ * @tparam M Class of model.
+ * @param model Model.
+ * @param interrupt interrupt callback to be called before calculating
+ *   the finite differences for each parameter or block of parameters.
+ * @param params_r Real-valued parameters.
+ * @param params_i Integer-valued parameters.
+ * @param coordinates Indexes of the parameters to differentiate by.
+ * @param[out] grad Vector into which the partial derivatives are
+ *   written.
+ * @param epsilon
+ * @param parallel Whether to evaluate the coordinates in parallel.
+ * @param[in,out] msgs
+ */
+template <bool propto, bool jacobian_adjust_transform, class M>
+void finite_diff_grad(const M& model, stan::callbacks::interrupt& interrupt,
+                      const std::vector<double>& params_r,
+                      std::vector<int>& params_i,
+                      const std::vector<size_t>& coordinates,
+                      std::vector<double>& grad, double epsilon = 1e-6,
+                      bool parallel = false, std::ostream* msgs = 0) {
+  internal::central_differences<propto, jacobian_adjust_transform>(
+      model, interrupt, params_r, params_i, coordinates.size(),
+      [&](size_t j, double step, std::vector<double>& x) {
+        x[coordinates[j]] = params_r[coordinates[j]] + step;
+      },
+      grad, epsilon, parallel, msgs);
+}
+
+/**
+ * Compute the directional derivatives of the log density along the
+ * columns of the specified matrix using finite differences, writing
+ * the derivative along column <code>j</code> into
+ * <code>grad_dot_directions[j]</code>.
+ *
+ * Threading and interrupts are handled as for the coordinate version.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to the
+ * log probability.
+ * @tparam M Class of model.
+ * @param model Model.
+ * @param interrupt interrupt callback to be called before calculating
+ *   the finite differences for each direction or block of directions.
+ * @param params_r Real-valued parameters.
+ * @param params_i Integer-valued parameters.
+ * @param directions Directions, one per column.
+ * @param[out] grad_dot_directions Vector into which the directional
+ *   derivatives are written.
+ * @param epsilon
+ * @param parallel Whether to evaluate the directions in parallel.
+ * @param[in,out] msgs
+ */
+template <bool propto, bool jacobian_adjust_transform, class M>
+void finite_diff_grad(const M& model, stan::callbacks::interrupt& interrupt,
+                      const std::vector<double>& params_r,
+                      std::vector<int>& params_i,
+                      const Eigen::MatrixXd& directions,
+                      std::vector<double>& grad_dot_directions,
+                      double epsilon = 1e-6, bool parallel = false,
+                      std::ostream* msgs = 0) {
+  internal::central_differences<propto, jacobian_adjust_transform>(
+      model, interrupt, params_r, params_i, directions.cols(),
+      [&](size_t j, double step, std::vector<double>& x) {
+        for (size_t k = 0; k < x.size(); ++k)
+          x[k] = params_r[k] + step * directions(k, j);
+      },
+      grad_dot_directions, epsilon, parallel, msgs);
 }
 
 }  // namespace model
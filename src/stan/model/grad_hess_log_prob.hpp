@@ -2,6 +2,10 @@
 #define STAN_MODEL_GRAD_HESS_LOG_PROB_HPP
 
 #include <stan/model/log_prob_grad.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
 #include <iostream>
 #include <vector>
 
@@ -69,6 +73,89 @@ double grad_hess_log_prob(const M& model, std::vector<double>& params_r,
   return result;
 }
 
+/**
+ * Evaluate the log-probability, its gradient, and its Hessian at
+ * params_r, computing the Hessian numerically by finite-differencing
+ * the gradient with the same stencil as the version above.
+ *
+ * The gradient is evaluated at four perturbations of each parameter.
+ * When <code>parallel</code> is true and Stan is built with
+ * <code>STAN_THREADS</code>, the parameters are spread over the TBB
+ * thread pool. Each thread evaluates gradients on its own nested
+ * autodiff stack, as set up by
+ * <code>stan::math::init_threadpool_tbb()</code>, from its own copy
+ * of the parameters, and writes the rows of the finite differences of
+ * its own parameters, which are symmetrized once all are done.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to the
+ * log probability.
+ * @tparam M Class of model.
+ * @param[in] model Model.
+ * @param[in] params_r Real-valued parameter vector.
+ * @param[out] gradient Vector to write gradient to.
+ * @param[out] hessian Matrix to write Hessian to.
+ * @param[in] parallel Whether to evaluate the perturbations in
+ * parallel.
+ * @param[in, out] msgs Stream to which print statements in Stan
+ * programs are written, default is 0
+ */
+template <bool propto, bool jacobian_adjust_transform, class M>
+double grad_hess_log_prob(const M& model, const Eigen::VectorXd& params_r,
+                          Eigen::VectorXd& gradient, Eigen::MatrixXd& hessian,
+                          bool parallel = false, std::ostream* msgs = 0) {
+  static const double epsilon = 1e-3;
+  static const double half_epsilon = 0.5 * epsilon;
+  static const int order = 4;
+  static const double perturbations[order]
+      = {-2 * epsilon, -1 * epsilon, epsilon, 2 * epsilon};
+  static const double coefficients[order]
+      = {1.0 / 12.0, -2.0 / 3.0, 2.0 / 3.0, -1.0 / 12.0};
+  const Eigen::Index num_params = params_r.size();
+  double result;
+  stan::math::gradient(
+      internal::log_prob_functional<propto, jacobian_adjust_transform, M>(
+          model, msgs),
+      params_r, result, gradient);
+
+  // column d holds the finite differences of the gradient along d
+  Eigen::MatrixXd differences(num_params, num_params);
+  auto differentiate = [&](Eigen::Index begin, Eigen::Index end) {
+    internal::log_prob_functional<propto, jacobian_adjust_transform, M> f(
+        model, 0);
+    Eigen::VectorXd perturbed_params = params_r;
+    Eigen::VectorXd temp_grad;
+    double lp;
+    for (Eigen::Index d = begin; d < end; ++d) {
+      differences.col(d).setZero();
+      for (int i = 0; i < order; ++i) {
+        perturbed_params(d) = params_r(d) + perturbations[i];
+        stan::math::gradient(f, perturbed_params, lp, temp_grad);
+        differences.col(d) += half_epsilon * coefficients[i] * temp_grad;
+      }
+      perturbed_params(d) = params_r(d);
+    }
+  };
+
+#ifdef STAN_THREADS
+  if (parallel && num_params > 1) {
+    tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, num_params),
+                      [&](const tbb::blocked_range<Eigen::Index>& r) {
+                        differentiate(r.begin(), r.end());
+                      });
+  } else {
+    differentiate(0, num_params);
+  }
+#else
+  differentiate(0, num_params);
+#endif
+
+  hessian = differences + differences.transpose();
+  return result;
+}
+
 }  // namespace model
 }  // namespace stan
 #endif
@@ -4,9 +4,11 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/math/rev.hpp>
+#include <stan/model/autodiff_memory.hpp>
 #include <stan/model/model_functional.hpp>
-#include <sstream>
+#include <stan/model/model_messages.hpp>
 #include <stdexcept>
+#include <string>
 
 namespace stan {
 namespace model {
@@ -22,16 +24,97 @@ template <class M>
 void gradient(const M& model, const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
               double& f, Eigen::Matrix<double, Eigen::Dynamic, 1>& grad_f,
               callbacks::logger& logger) {
-  std::stringstream ss;
+  model_messages msgs(logger);
+  stan::math::gradient(model_functional<M>(model, msgs.stream()), x, f,
+                       grad_f);
+}
+
+/**
+ * Compute the negative log density of a model and its gradient, as
+ * used for the potential energy of the Hamiltonian samplers. Constants
+ * are dropped and the Jacobian adjustment is included, as for
+ * <code>gradient()</code>.
+ *
+ * The results are written straight into the output arguments: the
+ * adjoint of the log density is seeded with -1, so the adjoints of the
+ * parameters already are the negated gradient and no separate pass to
+ * flip the signs is needed. The parameters are copied into the given
+ * buffer of autodiff variables, which is only reallocated when its size
+ * changes. The evaluation runs on a nested autodiff stack whose memory
+ * is kept by the arena, so repeated calls don't allocate once the arena
+ * has grown to the size of the expression graph. The arena bytes in use
+ * are recorded with <code>autodiff_memory</code>.
+ *
+ * @tparam M type of model
+ * @param[in] model model
+ * @param[in] x unconstrained parameters
+ * @param[in,out] x_var buffer of autodiff variables for the parameters
+ * @param[out] f negative log density
+ * @param[out] grad_f negative gradient of the log density
+ * @param[in,out] logger logger for messages written by the model, see
+ *   <code>model_messages</code>
+ * @throws std::exception if the model throws; the outputs are left
+ *   unchanged in that case
+ */
+template <class M>
+void negative_gradient(const M& model,
+                       const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+                       Eigen::Matrix<math::var, Eigen::Dynamic, 1>& x_var,
+                       double& f,
+                       Eigen::Matrix<double, Eigen::Dynamic, 1>& grad_f,
+                       callbacks::logger& logger) {
+  model_messages msgs(logger);
+  math::nested_rev_autodiff nested;
+  x_var.resize(x.size());
+  for (int i = 0; i < x.size(); ++i)
+    x_var.coeffRef(i) = x.coeff(i);
+  math::var lp = model.template log_prob<true, true>(x_var, msgs.stream());
+  lp.adj() = -1;
+  math::grad();
+  autodiff_memory::record(autodiff_memory::arena_bytes());
+  f = -lp.val();
+  grad_f.resize(x.size());
+  for (int i = 0; i < x.size(); ++i)
+    grad_f.coeffRef(i) = x_var.coeff(i).adj();
+}
+
+/**
+ * Compute the negative log density of a model and its gradient as
+ * <code>negative_gradient()</code> does, but report an evaluation the
+ * model rejects with the return value instead of an exception, so that
+ * the exception thrown by the model is caught right where it leaves
+ * the model rather than unwinding the frames of the caller.
+ *
+ * The message of the rejection is copied into a string owned by the
+ * caller, whose storage is reused from one rejection to the next.
+ *
+ * @tparam M type of model
+ * @param[in] model model
+ * @param[in] x unconstrained parameters
+ * @param[in,out] x_var buffer of autodiff variables for the parameters
+ * @param[out] f negative log density
+ * @param[out] grad_f negative gradient of the log density
+ * @param[in,out] logger logger for messages written by the model
+ * @param[out] error_message message of the exception thrown by the
+ *   model, only set when the evaluation fails
+ * @return true if the model was evaluated, false if it threw a
+ *   <code>std::exception</code>; the outputs are left unchanged then
+ */
+template <class M>
+bool try_negative_gradient(const M& model,
+                           const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+                           Eigen::Matrix<math::var, Eigen::Dynamic, 1>& x_var,
+                           double& f,
+                           Eigen::Matrix<double, Eigen::Dynamic, 1>& grad_f,
+                           callbacks::logger& logger,
+                           std::string& error_message) {
   try {
-    stan::math::gradient(model_functional<M>(model, &ss), x, f, grad_f);
-  } catch (std::exception& e) {
-    if (ss.str().length() > 0)
-      logger.info(ss);
-    throw;
+    negative_gradient(model, x, x_var, f, grad_f, logger);
+  } catch (const std::exception& e) {
+    error_message.assign(e.what());
+    return false;
   }
-  if (ss.str().length() > 0)
-    logger.info(ss);
+  return true;
 }
 
 }  // namespace model
@@ -0,0 +1,86 @@
+#ifndef STAN_MODEL_HESSIAN_COLORING_HPP
+#define STAN_MODEL_HESSIAN_COLORING_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <Eigen/SparseCore>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Return the symmetric sparsity pattern of a Hessian with the
+ * specified pattern, with the structural nonzeros of the pattern, its
+ * transpose and the diagonal all set to one.
+ *
+ * @param pattern square matrix whose structural nonzeros include those
+ *   of the Hessian in its lower triangle, upper triangle, or both
+ * @return symmetric pattern
+ * @throw std::invalid_argument if the pattern isn't square
+ */
+inline Eigen::SparseMatrix<double> symmetric_hessian_pattern(
+    const Eigen::SparseMatrix<double>& pattern) {
+  if (pattern.rows() != pattern.cols())
+    throw std::invalid_argument("Hessian sparsity pattern must be square");
+  std::vector<Eigen::Triplet<double>> entries;
+  entries.reserve(2 * pattern.nonZeros() + pattern.cols());
+  for (Eigen::Index j = 0; j < pattern.outerSize(); ++j) {
+    entries.emplace_back(j, j, 1);
+    for (Eigen::SparseMatrix<double>::InnerIterator it(pattern, j); it; ++it) {
+      entries.emplace_back(it.row(), it.col(), 1);
+      entries.emplace_back(it.col(), it.row(), 1);
+    }
+  }
+  Eigen::SparseMatrix<double> symmetric(pattern.rows(), pattern.cols());
+  symmetric.setFromTriplets(entries.begin(), entries.end(),
+                            [](double a, double b) { return a; });
+  return symmetric;
+}
+
+/**
+ * Assign colors to the columns of a symmetric Hessian sparsity pattern
+ * so that no two columns of the same color have a nonzero in the same
+ * row. The product of the Hessian with the sum of the unit vectors of
+ * a color then holds every nonzero of the columns of that color, so
+ * the Hessian can be recovered from one Hessian-vector product per
+ * color.
+ *
+ * Columns are colored greedily in order, each taking the smallest
+ * color not used by a column it shares a row with. For a Hessian with
+ * at most <code>k</code> nonzeros per column this uses at most
+ * <code>k * (k - 1) + 1</code> colors, whatever the number of columns.
+ *
+ * @param pattern symmetric sparsity pattern, as returned by
+ *   <code>symmetric_hessian_pattern()</code>
+ * @param[out] colors color of each column, from zero
+ * @return number of colors
+ */
+inline int color_hessian_columns(const Eigen::SparseMatrix<double>& pattern,
+                                 std::vector<int>& colors) {
+  using iterator = Eigen::SparseMatrix<double>::InnerIterator;
+  const Eigen::Index n = pattern.cols();
+  colors.assign(n, -1);
+  // forbidden[c] == j if color c is used by a neighbor of column j
+  std::vector<Eigen::Index> forbidden;
+  int num_colors = 0;
+  for (Eigen::Index j = 0; j < n; ++j) {
+    for (iterator row(pattern, j); row; ++row)
+      for (iterator col(pattern, row.row()); col; ++col)
+        if (colors[col.row()] >= 0)
+          forbidden[colors[col.row()]] = j;
+    int color = 0;
+    while (color < num_colors && forbidden[color] == j)
+      ++color;
+    if (color == num_colors) {
+      ++num_colors;
+      forbidden.push_back(-1);
+    }
+    colors[j] = color;
+  }
+  return num_colors;
+}
+
+}  // namespace model
+}  // namespace stan
+#endif
@@ -0,0 +1,111 @@
+#ifndef STAN_MODEL_HESSIAN_TIMES_MATRIX_HPP
+#define STAN_MODEL_HESSIAN_TIMES_MATRIX_HPP
+
+#include <stan/math/mix.hpp>
+#include <stan/model/model_functional.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Compute the products of the Hessian of the log density at a point
+ * with each column of a matrix of directions, as repeated calls to
+ * <code>hessian_times_vector()</code> would, for Krylov methods such
+ * as Lanczos iteration or conjugate gradients that need many products
+ * at the same point.
+ *
+ * Each product is a forward-over-reverse sweep whose tangent is its
+ * direction, so the sweeps can't share a tape. Instead each thread
+ * reuses its operands across the columns it handles and records every
+ * sweep on a nested autodiff stack, which is recovered as soon as the
+ * product is read off. When <code>parallel</code> is true and Stan is
+ * built with <code>STAN_THREADS</code>, the columns are spread over the
+ * TBB thread pool. The results do not depend on how the columns are
+ * scheduled, and output written by the model is sent to
+ * <code>msgs</code> in column order.
+ *
+ * @tparam M Class of model.
+ * @param[in] model Model.
+ * @param[in] x Unconstrained parameters.
+ * @param[in] v Directions, one per column.
+ * @param[out] f Log density.
+ * @param[out] hess_f_times_v Product of the Hessian with each
+ *   direction, one per column.
+ * @param[in] parallel Whether to compute the products in parallel.
+ * @param[in, out] msgs Stream to which print statements in Stan
+ * programs are written, default is 0
+ * @throw std::invalid_argument if the directions don't have one row
+ *   per parameter
+ */
+template <class M>
+void hessian_times_matrix(
+    const M& model, const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+    const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& v, double& f,
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& hess_f_times_v,
+    bool parallel = false, std::ostream* msgs = 0) {
+  using stan::math::fvar;
+  using stan::math::var;
+  if (v.rows() != x.size())
+    throw std::invalid_argument(
+        "hessian_times_matrix: directions must have one row per parameter");
+  const Eigen::Index num_directions = v.cols();
+  hess_f_times_v.resize(x.size(), num_directions);
+  std::vector<std::string> messages(msgs ? num_directions : 0);
+  std::vector<double> log_prob(num_directions);
+
+  auto apply = [&](Eigen::Index begin, Eigen::Index end) {
+    std::stringstream ss;
+    model_functional<M> functional(model, msgs ? &ss : 0);
+    Eigen::Matrix<fvar<var>, Eigen::Dynamic, 1> x_fvar(x.size());
+    for (Eigen::Index j = begin; j < end; ++j) {
+      ss.str("");
+      stan::math::nested_rev_autodiff nested;
+      for (Eigen::Index i = 0; i < x.size(); ++i)
+        x_fvar(i) = fvar<var>(x(i), v(i, j));
+      fvar<var> fx = functional(x_fvar);
+      stan::math::grad(fx.d_.vi_);
+      log_prob[j] = fx.val_.val();
+      for (Eigen::Index i = 0; i < x.size(); ++i)
+        hess_f_times_v(i, j) = x_fvar(i).val_.adj();
+      if (msgs)
+        messages[j] = ss.str();
+    }
+  };
+
+#ifdef STAN_THREADS
+  if (parallel && num_directions > 1) {
+    tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, num_directions),
+                      [&](const tbb::blocked_range<Eigen::Index>& r) {
+                        apply(r.begin(), r.end());
+                      });
+  } else {
+    apply(0, num_directions);
+  }
+#else
+  apply(0, num_directions);
+#endif
+
+  if (msgs)
+    for (const std::string& message : messages)
+      *msgs << message;
+  if (num_directions > 0) {
+    f = log_prob[0];
+  } else {
+    stan::math::nested_rev_autodiff nested;
+    Eigen::Matrix<var, Eigen::Dynamic, 1> x_var(x);
+    f = model_functional<M>(model, msgs)(x_var).val();
+  }
+}
+
+}  // namespace model
+}  // namespace stan
+#endif
@@ -3,6 +3,10 @@
 
 #include <stan/math/prim.hpp>
 #include <stan/math/rev/meta.hpp>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
 
 namespace stan {
 
@@ -30,6 +34,111 @@ inline auto colwise_reverse(const T& x) {
   return x.colwise().reverse();
 }
 
+/**
+ * Check that every index of a multi index is in the range 1 to
+ * <code>size</code>, so that the elements can then be copied without
+ * further checks. The bounds are found in a single pass; if they are
+ * out of range, the first index out of range is reported as
+ * <code>stan::math::check_range()</code> does.
+ *
+ * @param[in] function Name of the indexing operation.
+ * @param[in] name Name of variable.
+ * @param[in] size Size of the indexed dimension.
+ * @param[in] ns Indexes, starting from 1.
+ * @throw std::out_of_range If any of the indices are out of bounds.
+ */
+inline void check_multi_range(const char* function, const char* name,
+                              int size, const std::vector<int>& ns) {
+  if (ns.empty())
+    return;
+  auto bounds = std::minmax_element(ns.begin(), ns.end());
+  if (*bounds.first >= 1 && *bounds.second <= size)
+    return;
+  for (int n : ns)
+    math::check_range(function, name, size, n);
+}
+
+/**
+ * Check the row and column multi indexes of a matrix indexed by a pair
+ * of multi indexes, as <code>check_multi_range()</code> does, rows
+ * first. Neither is checked if either is empty, as no element is then
+ * read or written, so indexing and assignment agree on which indexes
+ * are checked and on which is reported first.
+ *
+ * @param[in] row_function Name of the indexing operation for the rows.
+ * @param[in] col_function Name of the indexing operation for the
+ * columns.
+ * @param[in] name Name of variable.
+ * @param[in] rows Rows of the indexed matrix.
+ * @param[in] cols Columns of the indexed matrix.
+ * @param[in] row_ns Row indexes, starting from 1.
+ * @param[in] col_ns Column indexes, starting from 1.
+ * @throw std::out_of_range If any of the indices are out of bounds.
+ */
+inline void check_multi_multi_range(const char* row_function,
+                                    const char* col_function, const char* name,
+                                    int rows, int cols,
+                                    const std::vector<int>& row_ns,
+                                    const std::vector<int>& col_ns) {
+  if (row_ns.empty() || col_ns.empty())
+    return;
+  check_multi_range(row_function, name, rows, row_ns);
+  check_multi_range(col_function, name, cols, col_ns);
+}
+
+/**
+ * Whether a type is an Eigen matrix, map or block whose coefficients
+ * are stored in memory, so that an assignment can tell whether it
+ * reads the memory it writes.
+ */
+template <typename T, typename = void>
+struct is_direct_access : std::false_type {};
+
+template <typename T>
+struct is_direct_access<T, require_eigen_t<T>>
+    : std::integral_constant<bool, (std::decay_t<T>::Flags
+                                    & Eigen::DirectAccessBit)
+                                       != 0> {};
+
+template <typename T1, typename T2>
+inline bool overlaps(const T1& x, const T2& y, std::true_type) {
+  if (x.size() == 0 || y.size() == 0)
+    return false;
+  const char* x_begin = reinterpret_cast<const char*>(x.data());
+  const char* x_end = reinterpret_cast<const char*>(
+      x.data() + (x.outerSize() - 1) * x.outerStride()
+      + (x.innerSize() - 1) * x.innerStride() + 1);
+  const char* y_begin = reinterpret_cast<const char*>(y.data());
+  const char* y_end = reinterpret_cast<const char*>(
+      y.data() + (y.outerSize() - 1) * y.outerStride()
+      + (y.innerSize() - 1) * y.innerStride() + 1);
+  std::less<const char*> less;
+  return less(x_begin, y_end) && less(y_begin, x_end);
+}
+
+template <typename T1, typename T2>
+inline bool overlaps(const T1& x, const T2& y, std::false_type) {
+  return false;
+}
+
+/**
+ * Return true if the memory spanned by the coefficients of the left
+ * hand side of an assignment overlaps that of its right hand side, in
+ * which case the right hand side must be copied before it is
+ * assigned. Right hand sides that aren't stored in memory have been
+ * evaluated by <code>deep_copy()</code> if they could alias.
+ *
+ * @param[in] x Left hand side.
+ * @param[in] y Right hand side.
+ */
+template <typename T1, typename T2>
+inline bool overlaps(const T1& x, const T2& y) {
+  return overlaps(
+      x, y,
+      std::integral_constant<bool, is_direct_access<T1>::value
+                                       && is_direct_access<T2>::value>());
+}
+
 }  // namespace internal
 }  // namespace model
 }  // namespace stan
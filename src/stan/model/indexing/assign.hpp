@@ -52,6 +52,10 @@ template <
     typename T, typename U,
     require_t<std::is_assignable<std::decay_t<T>&, std::decay_t<U>>>* = nullptr>
 inline void assign(T&& x, U&& y, const char* name) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<U>(y), name);
+    return;
+  }
   x = std::forward<U>(y);
 }
 
@@ -94,12 +98,16 @@ template <typename Vec1, typename Vec2,
           require_all_eigen_vector_t<Vec1, Vec2>* = nullptr>
 inline void assign(Vec1&& x, const Vec2& y, const char* name,
                    const index_multi& idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec2>(y), name, idx);
+    return;
+  }
   const auto& y_ref = stan::math::to_ref(y);
   stan::math::check_size_match("vector[multi] assign", "left hand side",
                                idx.ns_.size(), name, y_ref.size());
-  const auto x_size = x.size();
+  internal::check_multi_range("vector[multi] assign", name, x.size(),
+                              idx.ns_);
   for (int n = 0; n < y_ref.size(); ++n) {
-    stan::math::check_range("vector[multi] assign", name, x_size, idx.ns_[n]);
     x.coeffRef(idx.ns_[n] - 1) = y_ref.coeff(n);
   }
 }
@@ -124,6 +132,10 @@ template <typename Vec1, typename Vec2,
           require_all_not_std_vector_t<Vec1, Vec2>* = nullptr>
 inline void assign(Vec1&& x, const Vec2& y, const char* name,
                    index_min_max idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec2>(y), name, idx);
+    return;
+  }
   stan::math::check_range("vector[min_max] min assign", name, x.size(),
                           idx.min_);
   stan::math::check_range("vector[min_max] max assign", name, x.size(),
@@ -162,6 +174,10 @@ template <typename Vec1, typename Vec2,
           require_all_vector_t<Vec1, Vec2>* = nullptr,
           require_all_not_std_vector_t<Vec1, Vec2>* = nullptr>
 inline void assign(Vec1&& x, const Vec2& y, const char* name, index_min idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec2>(y), name, idx);
+    return;
+  }
   stan::math::check_range("vector[min] assign", name, x.size(), idx.min_);
   stan::math::check_size_match("vector[min] assign", "left hand side",
                                x.size() - idx.min_ + 1, name, y.size());
@@ -187,6 +203,10 @@ template <typename Vec1, typename Vec2,
           require_all_vector_t<Vec1, Vec2>* = nullptr,
           require_all_not_std_vector_t<Vec1, Vec2>* = nullptr>
 inline void assign(Vec1&& x, const Vec2& y, const char* name, index_max idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec2>(y), name, idx);
+    return;
+  }
   stan::math::check_range("vector[max] assign", name, x.size(), idx.max_);
   stan::math::check_size_match("vector[max] assign", "left hand side", idx.max_,
                                name, y.size());
@@ -210,6 +230,10 @@ template <typename Vec1, typename Vec2,
           require_all_vector_t<Vec1, Vec2>* = nullptr,
           require_all_not_std_vector_t<Vec1, Vec2>* = nullptr>
 inline void assign(Vec1&& x, Vec2&& y, const char* name, index_omni /* idx */) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec2>(y), name, index_omni());
+    return;
+  }
   stan::math::check_size_match("vector[omni] assign", "left hand side",
                                x.size(), name, y.size());
   x = std::forward<Vec2>(y);
@@ -235,6 +259,10 @@ template <typename Mat, typename RowVec,
           require_dense_dynamic_t<Mat>* = nullptr,
           require_row_vector_t<RowVec>* = nullptr>
 inline void assign(Mat&& x, const RowVec& y, const char* name, index_uni idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<RowVec>(y), name, idx);
+    return;
+  }
   stan::math::check_size_match("matrix[uni] assign", "left hand side columns",
                                x.cols(), name, y.size());
   stan::math::check_range("matrix[uni] assign row", name, x.rows(), idx.n_);
@@ -260,15 +288,23 @@ template <typename Mat1, typename Mat2,
           require_all_eigen_dense_dynamic_t<Mat1, Mat2>* = nullptr>
 inline void assign(Mat1&& x, const Mat2& y, const char* name,
                    const index_multi& idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, idx);
+    return;
+  }
   const auto& y_ref = stan::math::to_ref(y);
   stan::math::check_size_match("matrix[multi] assign", "left hand side rows",
                                idx.ns_.size(), name, y.rows());
   stan::math::check_size_match("matrix[multi] assign", "left hand side columns",
                                x.cols(), name, y.cols());
-  for (int i = 0; i < idx.ns_.size(); ++i) {
-    const int n = idx.ns_[i];
-    stan::math::check_range("matrix[multi] assign row", name, x.rows(), n);
-    x.row(n - 1) = y_ref.row(i);
+  internal::check_multi_range("matrix[multi] assign row", name, x.rows(),
+                              idx.ns_);
+  // scatter column by column so both matrices are read and written in
+  // storage order
+  for (int j = 0; j < y_ref.cols(); ++j) {
+    for (int i = 0; i < idx.ns_.size(); ++i) {
+      x.coeffRef(idx.ns_[i] - 1, j) = y_ref.coeff(i, j);
+    }
   }
 }
 
@@ -289,6 +325,10 @@ inline void assign(Mat1&& x, const Mat2& y, const char* name,
 template <typename Mat1, typename Mat2,
           require_all_dense_dynamic_t<Mat1, Mat2>* = nullptr>
 inline void assign(Mat1&& x, Mat2&& y, const char* name, index_omni /* idx */) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, index_omni());
+    return;
+  }
   stan::math::check_size_match("matrix[omni] assign", "left hand side rows",
                                x.rows(), name, y.rows());
   stan::math::check_size_match("matrix[omni] assign", "left hand side columns",
@@ -315,6 +355,10 @@ template <typename Mat1, typename Mat2,
           require_dense_dynamic_t<Mat1>* = nullptr,
           require_matrix_t<Mat2>* = nullptr>
 inline void assign(Mat1&& x, const Mat2& y, const char* name, index_min idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, idx);
+    return;
+  }
   const auto row_size = x.rows() - (idx.min_ - 1);
   stan::math::check_range("matrix[min] assign row", name, x.rows(), idx.min_);
   stan::math::check_size_match("matrix[min] assign", "left hand side rows",
@@ -343,6 +387,10 @@ template <typename Mat1, typename Mat2,
           require_dense_dynamic_t<Mat1>* = nullptr,
           require_matrix_t<Mat2>* = nullptr>
 inline void assign(Mat1&& x, const Mat2& y, const char* name, index_max idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, idx);
+    return;
+  }
   stan::math::check_range("matrix[max] assign row", name, x.rows(), idx.max_);
   stan::math::check_size_match("matrix[max] assign", "left hand side rows",
                                idx.max_, name, y.rows());
@@ -370,6 +418,10 @@ template <typename Mat1, typename Mat2,
           require_dense_dynamic_t<Mat1>* = nullptr,
           require_matrix_t<Mat2>* = nullptr>
 inline void assign(Mat1&& x, Mat2&& y, const char* name, index_min_max idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, idx);
+    return;
+  }
   stan::math::check_range("matrix[min_max] max row indexing", name, x.rows(),
                           idx.max_);
   stan::math::check_range("matrix[min_max] min row indexing", name, x.rows(),
@@ -414,6 +466,10 @@ template <typename Mat1, typename Mat2,
           require_dense_dynamic_t<Mat1>* = nullptr>
 inline void assign(Mat1&& x, Mat2&& y, const char* name, index_min_max row_idx,
                    index_min_max col_idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, row_idx, col_idx);
+    return;
+  }
   stan::math::check_range("matrix[min_max, min_max] assign max row", name,
                           x.rows(), row_idx.max_);
   stan::math::check_range("matrix[min_max, min_max] assign min row", name,
@@ -523,14 +579,18 @@ template <typename Mat1, typename Vec,
           require_eigen_row_vector_t<Vec>* = nullptr>
 inline void assign(Mat1&& x, const Vec& y, const char* name, index_uni row_idx,
                    const index_multi& col_idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Vec>(y), name, row_idx, col_idx);
+    return;
+  }
   const auto& y_ref = stan::math::to_ref(y);
   stan::math::check_range("matrix[uni, multi] assign row", name, x.rows(),
                           row_idx.n_);
   stan::math::check_size_match("matrix[uni, multi] assign", "left hand side",
                                col_idx.ns_.size(), name, y_ref.size());
+  internal::check_multi_range("matrix[uni, multi] assign column", name,
+                              x.cols(), col_idx.ns_);
   for (int i = 0; i < col_idx.ns_.size(); ++i) {
-    stan::math::check_range("matrix[uni, multi] assign column", name, x.cols(),
-                            col_idx.ns_[i]);
     x.coeffRef(row_idx.n_ - 1, col_idx.ns_[i] - 1) = y_ref.coeff(i);
   }
 }
@@ -556,6 +616,10 @@ template <typename Mat1, typename Mat2,
           require_all_eigen_dense_dynamic_t<Mat1, Mat2>* = nullptr>
 inline void assign(Mat1&& x, const Mat2& y, const char* name,
                    const index_multi& row_idx, const index_multi& col_idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, row_idx, col_idx);
+    return;
+  }
   const auto& y_ref = stan::math::to_ref(y);
   stan::math::check_size_match("matrix[multi,multi] assign row sizes",
                                "left hand side", row_idx.ns_.size(), name,
@@ -563,15 +627,14 @@ inline void assign(Mat1&& x, const Mat2& y, const char* name,
   stan::math::check_size_match("matrix[multi,multi] assign column sizes",
                                "left hand side", col_idx.ns_.size(), name,
                                y_ref.cols());
+  internal::check_multi_multi_range("matrix[multi,multi] assign row",
+                                    "matrix[multi,multi] assign column", name,
+                                    x.rows(), x.cols(), row_idx.ns_,
+                                    col_idx.ns_);
   for (int j = 0; j < y_ref.cols(); ++j) {
-    const int n = col_idx.ns_[j];
-    stan::math::check_range("matrix[multi,multi] assign column", name, x.cols(),
-                            n);
+    const int n = col_idx.ns_[j] - 1;
     for (int i = 0; i < y_ref.rows(); ++i) {
-      const int m = row_idx.ns_[i];
-      stan::math::check_range("matrix[multi,multi] assign row", name, x.rows(),
-                              m);
-      x.coeffRef(m - 1, n - 1) = y_ref.coeff(i, j);
+      x.coeffRef(row_idx.ns_[i] - 1, n) = y_ref.coeff(i, j);
     }
   }
 }
@@ -623,6 +686,10 @@ template <typename Mat1, typename Mat2, typename Idx,
           require_eigen_dense_dynamic_t<Mat1>* = nullptr>
 inline void assign(Mat1&& x, const Mat2& y, const char* name,
                    const Idx& row_idx, const index_multi& col_idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, row_idx, col_idx);
+    return;
+  }
   const auto& y_ref = stan::math::to_ref(y);
   stan::math::check_size_match("matrix[..., multi] assign column sizes",
                                "left hand side", col_idx.ns_.size(), name,
@@ -739,6 +806,10 @@ template <typename Mat1, typename Mat2, typename Idx,
           require_dense_dynamic_t<Mat1>* = nullptr>
 inline void assign(Mat1&& x, Mat2&& y, const char* name, const Idx& row_idx,
                    index_min_max col_idx) {
+  if (internal::overlaps(x, y)) {
+    assign(x, plain_type_t<Mat2>(y), name, row_idx, col_idx);
+    return;
+  }
   stan::math::check_range("matrix[..., min_max] assign min column", name,
                           x.cols(), col_idx.min_);
   stan::math::check_range("matrix[..., min_max] assign max column", name,
@@ -832,6 +903,10 @@ template <typename StdVec, typename U, require_std_vector_t<StdVec>* = nullptr,
           require_t<std::is_assignable<value_type_t<StdVec>&, U>>* = nullptr>
 inline void assign(StdVec&& x, U&& y, const char* name, index_uni idx) {
   stan::math::check_range("vector[uni,...] assign", name, x.size(), idx.n_);
+  if (internal::overlaps(x[idx.n_ - 1], y)) {
+    x[idx.n_ - 1] = plain_type_t<U>(y);
+    return;
+  }
   x[idx.n_ - 1] = std::forward<U>(y);
 }
 
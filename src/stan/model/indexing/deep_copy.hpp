@@ -3,6 +3,7 @@
 
 #include <stan/math/prim/fun/Eigen.hpp>
 #include <stan/math/prim/meta.hpp>
+#include <stan/model/indexing/access_helpers.hpp>
 #include <vector>
 
 namespace stan {
@@ -10,22 +11,39 @@ namespace stan {
 namespace model {
 
 /**
- * Return the specified argument as a constant reference.
+ * Return a copy of the specified argument.
  *
- * <p>Warning: because of the usage pattern of this class, this
- * function only needs to return value references, not actual
- * copies.  The functions that call this overload recursively will
- * be doing the actual copies with assignment.
+ * <p>This guards the right hand side of an assignment that may alias
+ * its left hand side. Eigen matrices, maps and blocks whose
+ * coefficients are stored in memory are returned as they are instead,
+ * see below.
  *
  * @tparam T Any type.
  * @param x Input value.
  * @return Copy of input.
  */
-template <typename T>
+template <typename T,
+          require_not_t<internal::is_direct_access<T>>* = nullptr>
 inline plain_type_t<T> deep_copy(T&& x) {
   return std::forward<T>(x);
 }
 
+/**
+ * Return the specified Eigen matrix, map or block without copying it.
+ * The assignment it is passed to compares the memory it spans with
+ * that of the left hand side and only copies it if they overlap, as in
+ * <code>x[2:4] = x[1:3]</code>, so that the common case of no overlap
+ * doesn't pay for a copy.
+ *
+ * @tparam T Eigen type with direct access to its coefficients.
+ * @param x Input value.
+ * @return Input value.
+ */
+template <typename T, require_t<internal::is_direct_access<T>>* = nullptr>
+inline T&& deep_copy(T&& x) {
+  return std::forward<T>(x);
+}
+
 }  // namespace model
 }  // namespace stan
 #endif
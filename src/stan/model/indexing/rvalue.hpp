@@ -123,9 +123,10 @@ inline plain_type_t<EigVec> rvalue(EigVec&& v, const char* name,
                                    const index_multi& idx) {
   const auto v_size = v.size();
   const auto& v_ref = stan::math::to_ref(v);
+  internal::check_multi_range("vector[multi] indexing", name, v_ref.size(),
+                              idx.ns_);
   plain_type_t<EigVec> ret_v(idx.ns_.size());
   for (int i = 0; i < idx.ns_.size(); ++i) {
-    math::check_range("vector[multi] indexing", name, v_ref.size(), idx.ns_[i]);
     ret_v.coeffRef(i) = v_ref.coeff(idx.ns_[i] - 1);
   }
   return ret_v;
@@ -230,11 +231,15 @@ template <typename EigMat, require_eigen_dense_dynamic_t<EigMat>* = nullptr>
 inline plain_type_t<EigMat> rvalue(EigMat&& x, const char* name,
                                    const index_multi& idx) {
   const auto& x_ref = stan::math::to_ref(x);
+  internal::check_multi_range("matrix[multi] row indexing", name,
+                              x_ref.rows(), idx.ns_);
   plain_type_t<EigMat> x_ret(idx.ns_.size(), x.cols());
-  for (int i = 0; i < idx.ns_.size(); ++i) {
-    const int n = idx.ns_[i];
-    math::check_range("matrix[multi] row indexing", name, x_ref.rows(), n);
-    x_ret.row(i) = x_ref.row(n - 1);
+  // gather column by column so both matrices are read and written in
+  // storage order
+  for (int j = 0; j < x_ref.cols(); ++j) {
+    for (int i = 0; i < idx.ns_.size(); ++i) {
+      x_ret.coeffRef(i, j) = x_ref.coeff(idx.ns_[i] - 1, j);
+    }
   }
   return x_ret;
 }
@@ -404,11 +409,11 @@ inline Eigen::Matrix<value_type_t<EigMat>, 1, Eigen::Dynamic> rvalue(
   math::check_range("matrix[uni, multi] row indexing", name, x.rows(),
                     row_idx.n_);
   const auto& x_ref = stan::math::to_ref(x);
+  internal::check_multi_range("matrix[uni, multi] column indexing", name,
+                              x.cols(), col_idx.ns_);
   Eigen::Matrix<value_type_t<EigMat>, 1, Eigen::Dynamic> x_ret(
       1, col_idx.ns_.size());
   for (int i = 0; i < col_idx.ns_.size(); ++i) {
-    math::check_range("matrix[uni, multi] column indexing", name, x.cols(),
-                      col_idx.ns_[i]);
     x_ret.coeffRef(i) = x_ref.coeff(row_idx.n_ - 1, col_idx.ns_[i] - 1);
   }
   return x_ret;
@@ -434,11 +439,11 @@ inline Eigen::Matrix<value_type_t<EigMat>, Eigen::Dynamic, 1> rvalue(
   math::check_range("matrix[multi, uni] column indexing", name, x.cols(),
                     col_idx.n_);
   const auto& x_ref = stan::math::to_ref(x);
+  internal::check_multi_range("matrix[multi, uni] row indexing", name,
+                              x_ref.rows(), row_idx.ns_);
   Eigen::Matrix<value_type_t<EigMat>, Eigen::Dynamic, 1> x_ret(
       row_idx.ns_.size());
   for (int i = 0; i < row_idx.ns_.size(); ++i) {
-    math::check_range("matrix[multi, uni] row indexing", name, x_ref.rows(),
-                      row_idx.ns_[i]);
     x_ret.coeffRef(i) = x_ref.coeff(row_idx.ns_[i] - 1, col_idx.n_ - 1);
   }
   return x_ret;
@@ -464,16 +469,15 @@ inline plain_type_t<EigMat> rvalue(EigMat&& x, const char* name,
   const auto& x_ref = stan::math::to_ref(x);
   const int rows = row_idx.ns_.size();
   const int cols = col_idx.ns_.size();
+  internal::check_multi_multi_range("matrix[multi,multi] row indexing",
+                                    "matrix[multi,multi] column indexing",
+                                    name, x_ref.rows(), x_ref.cols(),
+                                    row_idx.ns_, col_idx.ns_);
   plain_type_t<EigMat> x_ret(rows, cols);
   for (int j = 0; j < cols; ++j) {
+    const int n = col_idx.ns_[j] - 1;
     for (int i = 0; i < rows; ++i) {
-      const int m = row_idx.ns_[i];
-      const int n = col_idx.ns_[j];
-      math::check_range("matrix[multi,multi] row indexing", name, x_ref.rows(),
-                        m);
-      math::check_range("matrix[multi,multi] column indexing", name,
-                        x_ref.cols(), n);
-      x_ret.coeffRef(i, j) = x_ref.coeff(m - 1, n - 1);
+      x_ret.coeffRef(i, j) = x_ref.coeff(row_idx.ns_[i] - 1, n);
     }
   }
   return x_ret;
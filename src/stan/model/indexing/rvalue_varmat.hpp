@@ -3,6 +3,7 @@
 
 #include <stan/math/prim.hpp>
 #include <stan/math/rev.hpp>
+#include <stan/model/indexing/access_helpers.hpp>
 #include <stan/model/indexing/index.hpp>
 #include <stan/model/indexing/rvalue.hpp>
 #include <type_traits>
@@ -38,6 +39,26 @@ namespace model {
  *  - General overload for nested std vectors.
  */
 
+namespace internal {
+/**
+ * Return whether a multi index selects a nonempty run of consecutive
+ * cells in ascending order. Such an index selects a block, whose
+ * adjoints can be propagated as a block without storing the indices
+ * on the arena.
+ *
+ * @param[in] idx Sequence of integers.
+ */
+inline bool is_contiguous(const index_multi& idx) noexcept {
+  if (idx.ns_.empty())
+    return false;
+  for (size_t i = 1; i < idx.ns_.size(); ++i) {
+    if (idx.ns_[i] != idx.ns_[i - 1] + 1)
+      return false;
+  }
+  return true;
+}
+}  // namespace internal
+
 /**
  * Return a non-contiguous subset of elements in a vector.
  *
@@ -61,6 +82,12 @@ inline auto rvalue(Vec&& x, const char* name, const index_multi& idx) {
   using arena_std_vec = std::vector<int, arena_allocator<int>>;
   const Eigen::Index x_size = x.size();
   const auto ret_size = idx.ns_.size();
+  if (internal::is_contiguous(idx)) {
+    internal::check_multi_range("vector[multi] assign range", name, x_size,
+                                idx.ns_);
+    return var_value<plain_type_t<value_type_t<Vec>>>(
+        x.segment(idx.ns_[0] - 1, ret_size));
+  }
   arena_t<value_type_t<Vec>> x_ret_vals(ret_size);
   arena_std_vec row_idx(ret_size);
   for (int i = 0; i < ret_size; ++i) {
@@ -97,6 +124,12 @@ inline auto rvalue(VarMat&& x, const char* name, const index_multi& idx) {
   using stan::math::var_value;
   using arena_std_vec = std::vector<int, arena_allocator<int>>;
   const auto ret_rows = idx.ns_.size();
+  if (internal::is_contiguous(idx)) {
+    internal::check_multi_range("matrix[multi] subset range", name, x.rows(),
+                                idx.ns_);
+    return var_value<plain_type_t<value_type_t<VarMat>>>(
+        x.middleRows(idx.ns_[0] - 1, ret_rows));
+  }
   arena_t<value_type_t<VarMat>> x_ret_vals(ret_rows, x.cols());
   arena_std_vec row_idx(ret_rows);
   for (int i = 0; i < ret_rows; ++i) {
@@ -220,6 +253,14 @@ inline auto rvalue(VarMat&& x, const char* name, const index_multi& row_idx,
   const auto ret_cols = col_idx.ns_.size();
   const Eigen::Index x_rows = x.rows();
   const Eigen::Index x_cols = x.cols();
+  if (internal::is_contiguous(row_idx) && internal::is_contiguous(col_idx)) {
+    internal::check_multi_range("matrix[multi,multi] row index", name, x_rows,
+                                row_idx.ns_);
+    internal::check_multi_range("matrix[multi,multi] col index", name, x_cols,
+                                col_idx.ns_);
+    return var_value<plain_type_t<value_type_t<VarMat>>>(x.block(
+        row_idx.ns_[0] - 1, col_idx.ns_[0] - 1, ret_rows, ret_cols));
+  }
   arena_t<plain_type_t<value_type_t<VarMat>>> x_ret_val(ret_rows, ret_cols);
   arena_std_vec row_idx_vals(ret_rows);
   arena_std_vec col_idx_vals(ret_cols);
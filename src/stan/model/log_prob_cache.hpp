@@ -0,0 +1,172 @@
+#ifndef STAN_MODEL_LOG_PROB_CACHE_HPP
+#define STAN_MODEL_LOG_PROB_CACHE_HPP
+
+#include <stan/model/log_prob_grad.hpp>
+#include <stan/model/log_prob_propto.hpp>
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * A <code>log_prob_cache</code> remembers the log densities and
+ * gradients of a model at the last few points it was evaluated at, so
+ * that callers evaluating the same point more than once, such as an
+ * optimizer re-evaluating an accepted point, only pay for it once.
+ *
+ * Points are looked up by a hash of their parameters and then compared
+ * exactly. The log density up to a proportion, as computed with
+ * autodiff variables, and the full log density are cached separately
+ * for each choice of Jacobian adjustment. A cached gradient also serves
+ * requests for the log density alone, but not the other way around.
+ * Evaluations that throw are not cached, and print statements in the
+ * model are not repeated when a result is reused.
+ *
+ * The cache holds results for a single model and data; it must be
+ * cleared before it is used with another. It is not thread safe.
+ */
+class log_prob_cache {
+ public:
+  /**
+   * Construct a cache holding results at up to the specified number
+   * of points, discarding the least recently used beyond that.
+   *
+   * @param capacity number of points to remember
+   */
+  explicit log_prob_cache(size_t capacity = 4)
+      : capacity_(capacity), hits_(0), misses_(0) {}
+
+  /**
+   * Return the log density and its gradient, as
+   * <code>stan::model::log_prob_grad()</code> does.
+   */
+  template <bool propto, bool jacobian_adjust_transform, class M>
+  double log_prob_grad(const M& model, std::vector<double>& params_r,
+                       std::vector<int>& params_i,
+                       std::vector<double>& gradient,
+                       std::ostream* msgs = 0) {
+    entry* e = find(params_r, propto, jacobian_adjust_transform, true);
+    if (e) {
+      gradient = e->gradient;
+      return e->lp;
+    }
+    double lp = stan::model::log_prob_grad<propto, jacobian_adjust_transform>(
+        model, params_r, params_i, gradient, msgs);
+    insert(params_r, propto, jacobian_adjust_transform, lp, &gradient);
+    return lp;
+  }
+
+  /**
+   * Return the log density, dropping constants if <code>propto</code>
+   * is true. The log density up to a proportion is computed with
+   * autodiff variables, as <code>stan::model::log_prob_propto()</code>
+   * does, and the full log density with doubles.
+   */
+  template <bool propto, bool jacobian_adjust_transform, class M>
+  double log_prob(const M& model, std::vector<double>& params_r,
+                  std::vector<int>& params_i, std::ostream* msgs = 0) {
+    entry* e = find(params_r, propto, jacobian_adjust_transform, false);
+    if (e)
+      return e->lp;
+    double lp
+        = propto ? stan::model::log_prob_propto<jacobian_adjust_transform>(
+              model, params_r, params_i, msgs)
+                 : model.template log_prob<false, jacobian_adjust_transform>(
+                     params_r, params_i, msgs);
+    insert(params_r, propto, jacobian_adjust_transform, lp, 0);
+    return lp;
+  }
+
+  /**
+   * Return the log density up to a proportion, as
+   * <code>stan::model::log_prob_propto()</code> does.
+   */
+  template <bool jacobian_adjust_transform, class M>
+  double log_prob_propto(const M& model, std::vector<double>& params_r,
+                         std::vector<int>& params_i, std::ostream* msgs = 0) {
+    return log_prob<true, jacobian_adjust_transform>(model, params_r, params_i,
+                                                     msgs);
+  }
+
+  /**
+   * Return the number of requests served from the cache.
+   */
+  size_t hits() const { return hits_; }
+
+  /**
+   * Return the number of requests that evaluated the model.
+   */
+  size_t misses() const { return misses_; }
+
+  /**
+   * Forget all cached results.
+   */
+  void clear() { entries_.clear(); }
+
+ private:
+  struct entry {
+    size_t hash;
+    bool propto;
+    bool jacobian;
+    bool has_gradient;
+    std::vector<double> params_r;
+    double lp;
+    std::vector<double> gradient;
+  };
+
+  size_t capacity_;
+  size_t hits_;
+  size_t misses_;
+  // most recently used first
+  std::vector<entry> entries_;
+
+  static size_t hash(const std::vector<double>& params_r) {
+    return boost::hash_range(params_r.begin(), params_r.end());
+  }
+
+  entry* find(const std::vector<double>& params_r, bool propto, bool jacobian,
+              bool need_gradient) {
+    size_t h = hash(params_r);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      entry& e = entries_[i];
+      if (e.hash == h && e.propto == propto && e.jacobian == jacobian
+          && (e.has_gradient || !need_gradient) && e.params_r == params_r) {
+        ++hits_;
+        std::rotate(entries_.begin(), entries_.begin() + i,
+                    entries_.begin() + i + 1);
+        return &entries_.front();
+      }
+    }
+    ++misses_;
+    return 0;
+  }
+
+  void insert(const std::vector<double>& params_r, bool propto,
+              bool jacobian, double lp, const std::vector<double>* gradient) {
+    if (capacity_ == 0)
+      return;
+    size_t h = hash(params_r);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      entry& e = entries_[i];
+      if (e.hash == h && e.propto == propto && e.jacobian == jacobian
+          && e.params_r == params_r) {
+        entries_.erase(entries_.begin() + i);
+        break;
+      }
+    }
+    if (entries_.size() == capacity_)
+      entries_.pop_back();
+    entry e{h,        propto, jacobian, gradient != 0,
+            params_r, lp,     gradient ? *gradient : std::vector<double>()};
+    entries_.insert(entries_.begin(), std::move(e));
+  }
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
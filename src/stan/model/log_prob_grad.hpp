@@ -2,11 +2,43 @@
 #define STAN_MODEL_LOG_PROB_GRAD_HPP
 
 #include <stan/math/rev.hpp>
+#include <stan/model/autodiff_memory.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace stan {
 namespace model {
+namespace internal {
+
+/**
+ * Functor evaluating the log density of a model for automatic
+ * differentiation, as <code>model_functional</code> does, with the
+ * dropping of constants and the Jacobian adjustment as template
+ * parameters.
+ */
+template <bool propto, bool jacobian_adjust_transform, class M>
+struct log_prob_functional {
+  const M& model;
+  std::ostream* o;
+
+  log_prob_functional(const M& m, std::ostream* out) : model(m), o(out) {}
+
+  template <typename T>
+  T operator()(const Eigen::Matrix<T, Eigen::Dynamic, 1>& x) const {
+    // log_prob() requires non-const but doesn't modify its argument
+    return model.template log_prob<propto, jacobian_adjust_transform, T>(
+        const_cast<Eigen::Matrix<T, -1, 1>&>(x), o);
+  }
+};
+
+}  // namespace internal
 
 /**
  * Compute the gradient using reverse-mode automatic
@@ -41,6 +73,7 @@ double log_prob_grad(const M& model, std::vector<double>& params_r,
         ad_params_r, params_i, msgs);
     double lp = adLogProb.val();
     adLogProb.grad(ad_params_r, gradient);
+    autodiff_memory::record(autodiff_memory::arena_bytes());
     stan::math::recover_memory();
     return lp;
   } catch (const std::exception& ex) {
@@ -80,6 +113,7 @@ double log_prob_grad(const M& model, Eigen::VectorXd& params_r,
         ad_params_r, msgs);
     double val = adLogProb.val();
     stan::math::grad(adLogProb, ad_params_r, gradient);
+    autodiff_memory::record(autodiff_memory::arena_bytes());
     stan::math::recover_memory();
     return val;
   } catch (std::exception& ex) {
@@ -88,6 +122,84 @@ double log_prob_grad(const M& model, Eigen::VectorXd& params_r,
   }
 }
 
+/**
+ * Compute the log density and its gradient at each column of a matrix
+ * of parameter vectors using reverse-mode automatic differentiation.
+ *
+ * Every evaluation runs on a nested autodiff stack, so the points are
+ * independent of each other and of any enclosing expression. When
+ * <code>parallel</code> is true and Stan is built with
+ * <code>STAN_THREADS</code>, the columns are spread over the TBB
+ * thread pool and each thread records on its own autodiff stack, as
+ * set up by <code>stan::math::init_threadpool_tbb()</code>.
+ * The results do not depend on how the columns are scheduled.
+ *
+ * An evaluation that throws does not stop the others. Its log density
+ * and gradient are set to NaN instead, so callers retrying or
+ * dropping failed points can check the gradient for finite values.
+ * Output written by the model is sent to <code>msgs</code> in column
+ * order.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to
+ * the log probability.
+ * @tparam M Class of model.
+ * @param[in] model Model.
+ * @param[in] params_r Real-valued parameters, one point per column.
+ * @param[out] log_prob Log density at each point.
+ * @param[out] gradients Gradient at each point, one per column.
+ * @param[in] parallel Whether to evaluate the points in parallel.
+ * @param[in,out] msgs
+ */
+template <bool propto, bool jacobian_adjust_transform, class M>
+void log_prob_grad(const M& model, const Eigen::MatrixXd& params_r,
+                   Eigen::VectorXd& log_prob, Eigen::MatrixXd& gradients,
+                   bool parallel = false, std::ostream* msgs = 0) {
+  const Eigen::Index num_points = params_r.cols();
+  log_prob.resize(num_points);
+  gradients.resize(params_r.rows(), num_points);
+  std::vector<std::string> messages(msgs ? num_points : 0);
+
+  auto evaluate = [&](Eigen::Index begin, Eigen::Index end) {
+    std::stringstream ss;
+    Eigen::VectorXd gradient;
+    for (Eigen::Index j = begin; j < end; ++j) {
+      ss.str("");
+      try {
+        stan::math::gradient(
+            internal::log_prob_functional<propto, jacobian_adjust_transform,
+                                          M>(model, msgs ? &ss : 0),
+            params_r.col(j), log_prob(j), gradient);
+        gradients.col(j) = gradient;
+      } catch (const std::exception&) {
+        log_prob(j) = std::numeric_limits<double>::quiet_NaN();
+        gradients.col(j).fill(std::numeric_limits<double>::quiet_NaN());
+      }
+      if (msgs)
+        messages[j] = ss.str();
+    }
+  };
+
+#ifdef STAN_THREADS
+  if (parallel && num_points > 1) {
+    tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, num_points),
+                      [&](const tbb::blocked_range<Eigen::Index>& r) {
+                        evaluate(r.begin(), r.end());
+                      });
+  } else {
+    evaluate(0, num_points);
+  }
+#else
+  evaluate(0, num_points);
+#endif
+
+  if (msgs)
+    for (const std::string& message : messages)
+      *msgs << message;
+}
+
 }  // namespace model
 }  // namespace stan
 #endif
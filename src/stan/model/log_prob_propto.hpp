@@ -75,16 +75,13 @@ template <bool jacobian_adjust_transform, class M>
 double log_prob_propto(const M& model, Eigen::VectorXd& params_r,
                        std::ostream* msgs = 0) {
   using stan::math::var;
-  using std::vector;
-  vector<int> params_i(0);
   try {
-    vector<var> ad_params_r;
-    ad_params_r.reserve(model.num_params_r());
-    for (size_t i = 0; i < model.num_params_r(); ++i)
-      ad_params_r.push_back(params_r(i));
+    Eigen::Matrix<var, Eigen::Dynamic, 1> ad_params_r(params_r.size());
+    for (int i = 0; i < params_r.size(); ++i)
+      ad_params_r.coeffRef(i) = params_r.coeff(i);
     double lp = model
                     .template log_prob<true, jacobian_adjust_transform>(
-                        ad_params_r, params_i, msgs)
+                        ad_params_r, msgs)
                     .val();
     stan::math::recover_memory();
     return lp;
@@ -4,6 +4,8 @@
 #include <stan/io/var_context.hpp>
 #include <stan/math/rev/core.hpp>
 #include <stan/model/prob_grad.hpp>
+#include <stan/model/transformed_data_snapshot.hpp>
+#include <stan/util/philox4x32.hpp>
 #include <boost/random/additive_combine.hpp>
 #include <ostream>
 #include <string>
@@ -29,6 +31,16 @@ namespace model {
  *<p>The approach to defining models used by the Stan language code
  * generator is use the curiously recursive template base class defined
  * in the extension `stan::model::model_base_crtp`.
+ *
+ * <p><i>Threading:</i> The const methods, which include every
+ * evaluation of the log density and `write_array`, may be called
+ * concurrently on the same instance from several threads, so they must
+ * not modify the model. Each thread evaluating with autodiff variables
+ * needs its own autodiff stack, and each call needs its own random
+ * number generator and message stream. The non-const methods, such as
+ * `read_transformed_data`, must not run concurrently with any other
+ * call. `stan::model::evaluator_pool` evaluates a model from several
+ * threads following these rules.
  */
 class model_base : public prob_grad {
  public:
@@ -61,6 +73,51 @@ class model_base : public prob_grad {
    */
   virtual std::vector<std::string> model_compile_info() const = 0;
 
+  /**
+   * Return an identifier of the build of the model, which changes
+   * whenever the model is compiled from other code or with another
+   * compiler version or flags, such as a hash of its generated code.
+   * Transformed data snapshots are only read by the build of the model
+   * that wrote them. See
+   * <code>stan::model::transformed_data_snapshot</code>.
+   *
+   * @return build identifier, by default the compile information of the
+   *   model, which doesn't change with the code of the model
+   */
+  virtual std::string model_build_hash() const {
+    std::string hash;
+    for (const std::string& info : model_compile_info())
+      hash += info + "\n";
+    return hash;
+  }
+
+  /**
+   * Write the members computed by the transformed data block, so that
+   * they can be read back instead of computed by a later instance of the
+   * model with the same data. See
+   * <code>stan::model::transformed_data_snapshot</code>.
+   *
+   * @param[in,out] writer writer of the members
+   * @return true if the members were written, false if the model
+   *   doesn't support snapshots, which is the default
+   */
+  virtual bool write_transformed_data(transformed_data_writer& writer) const {
+    return false;
+  }
+
+  /**
+   * Read the members computed by the transformed data block, as
+   * written by <code>write_transformed_data()</code>.
+   *
+   * @param[in,out] reader reader of the members
+   * @return true if the members were read, false if the model doesn't
+   *   support snapshots, which is the default
+   * @throw std::domain_error if the snapshot doesn't match the members
+   */
+  virtual bool read_transformed_data(transformed_data_reader& reader) {
+    return false;
+  }
+
   /**
    * Set the specified argument to sequence of parameters, transformed
    * parameters, and generated quantities in the order in which they
@@ -355,6 +412,27 @@ class model_base : public prob_grad {
                            bool include_tparams = true, bool include_gqs = true,
                            std::ostream* msgs = 0) const = 0;
 
+  /**
+   * Convert the specified sequence of unconstrained parameters to a
+   * sequence of constrained parameters, as for the overload taking a
+   * boost::ecuyer1988, drawing the generated quantities from a
+   * counter-based generator.
+   *
+   * @param base_rng RNG to use for generated quantities
+   * @param[in] params_r unconstrained parameters input
+   * @param[in,out] params_constrained_r constrained parameters produced
+   * @param[in] include_tparams true if transformed parameters are
+   * included in output
+   * @param[in] include_gqs true if generated quantities are included
+   * in output
+   * @param[in,out] msgs msgs stream to which messages are written
+   */
+  virtual void write_array(util::philox4x32& base_rng,
+                           Eigen::VectorXd& params_r,
+                           Eigen::VectorXd& params_constrained_r,
+                           bool include_tparams = true, bool include_gqs = true,
+                           std::ostream* msgs = 0) const = 0;
+
   // TODO(carpenter): cut redundant std::vector versions from here ===
 
   /**
@@ -591,6 +669,29 @@ class model_base : public prob_grad {
                            std::vector<double>& params_r_constrained,
                            bool include_tparams = true, bool include_gqs = true,
                            std::ostream* msgs = 0) const = 0;
+
+  /**
+   * Convert the specified sequence of unconstrained parameters to a
+   * sequence of constrained parameters, as for the overload taking a
+   * boost::ecuyer1988, drawing the generated quantities from a
+   * counter-based generator.
+   *
+   * @param base_rng RNG to use for generated quantities
+   * @param[in] params_r unconstrained parameters input
+   * @param[in] params_i integer parameters (ignored)
+   * @param[in,out] params_r_constrained constrained parameters produced
+   * @param[in] include_tparams true if transformed parameters are
+   * included in output
+   * @param[in] include_gqs true if generated quantities are included
+   * in output
+   * @param[in,out] msgs msgs stream to which messages are written
+   */
+  virtual void write_array(util::philox4x32& base_rng,
+                           std::vector<double>& params_r,
+                           std::vector<int>& params_i,
+                           std::vector<double>& params_r_constrained,
+                           bool include_tparams = true, bool include_gqs = true,
+                           std::ostream* msgs = 0) const = 0;
 };
 
 }  // namespace model
@@ -3,6 +3,7 @@
 
 #include <stan/model/model_base.hpp>
 #include <iostream>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -64,6 +65,13 @@ namespace model {
  * general, the template parameter `M` for this class is called the
  * derived class, and must be declared to extend `foo_model<M>`.
  *
+ * <p>Each gradient of `log_prob` records a new reverse-mode expression
+ * graph, even when its structure doesn't change between calls. The graph
+ * can't be recorded once and replayed at new parameter values, because
+ * each vari computes its value in its constructor and has no forward
+ * method that could be rerun; a static tape would need a replayable
+ * operator set in the math library.
+ *
  * @tparam M type of derived model, which must implemented the
  * template methods defined in the class documentation
  */
@@ -138,6 +146,14 @@ class model_base_crtp : public stan::model::model_base {
         rng, theta, vars, include_tparams, include_gqs, msgs);
   }
 
+  void write_array(util::philox4x32& rng, Eigen::VectorXd& theta,
+                   Eigen::VectorXd& vars, bool include_tparams = true,
+                   bool include_gqs = true,
+                   std::ostream* msgs = 0) const override {
+    return static_cast<const M*>(this)->template write_array(
+        rng, theta, vars, include_tparams, include_gqs, msgs);
+  }
+
   // TODO(carpenter): remove redundant std::vector methods below here =====
   // ======================================================================
 
@@ -200,6 +216,15 @@ class model_base_crtp : public stan::model::model_base {
         rng, theta, theta_i, vars, include_tparams, include_gqs, msgs);
   }
 
+  void write_array(util::philox4x32& rng,
+                   std::vector<double>& theta, std::vector<int>& theta_i,
+                   std::vector<double>& vars, bool include_tparams = true,
+                   bool include_gqs = true,
+                   std::ostream* msgs = 0) const override {
+    return static_cast<const M*>(this)->template write_array(
+        rng, theta, theta_i, vars, include_tparams, include_gqs, msgs);
+  }
+
   void transform_inits(const io::var_context& context,
                        Eigen::VectorXd& params_r,
                        std::ostream* msgs) const override {
@@ -208,6 +233,41 @@ class model_base_crtp : public stan::model::model_base {
   }
 };
 
+/**
+ * Call a function with the specified model as an instance of the
+ * derived model class `M` if it is one, and as a `model_base`
+ * otherwise. The function is typically a generic lambda calling a
+ * service, for example
+ *
+ * ```
+ * return with_concrete_model<foo_model>(model, [&](auto& m) {
+ *   return stan::services::sample::hmc_nuts_diag_e_adapt(m, ...);
+ * });
+ * ```
+ *
+ * so that the samplers and optimizers it instantiates are templated on
+ * `foo_model` and call its templated `log_prob` on Eigen vectors
+ * directly, rather than through the virtual functions of `model_base`.
+ * This saves a virtual call per evaluation of the log density, which
+ * matters for models that are cheap to evaluate. The fallback keeps
+ * the behavior of calling the function with the `model_base`.
+ *
+ * @tparam M type of derived model
+ * @tparam F type of function, callable with either `M&` or
+ * `model_base&` and returning the same type for both
+ * @param[in] model model
+ * @param[in] f function to call
+ * @return result of calling the function
+ */
+template <typename M, typename F>
+inline decltype(auto) with_concrete_model(model_base& model, F&& f) {
+  static_assert(std::is_base_of<model_base, M>::value,
+                "M must derive from model_base");
+  if (M* concrete = dynamic_cast<M*>(&model))
+    return std::forward<F>(f)(*concrete);
+  return std::forward<F>(f)(model);
+}
+
 }  // namespace model
 }  // namespace stan
 #endif
@@ -0,0 +1,74 @@
+#ifndef STAN_MODEL_MODEL_MESSAGES_HPP
+#define STAN_MODEL_MODEL_MESSAGES_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace stan {
+namespace model {
+
+/**
+ * Collects the messages a model prints during one evaluation and passes
+ * them to a logger when it goes out of scope, also when the evaluation
+ * throws.
+ *
+ * The messages are written to a stream kept by each thread and reused
+ * by every evaluation, so an evaluation that prints nothing neither
+ * constructs a stream nor allocates. Only an evaluation started while
+ * another one on the same thread is still collecting gets a stream of
+ * its own.
+ */
+class model_messages {
+ public:
+  explicit model_messages(callbacks::logger& logger)
+      : logger_(logger), owns_buffer_(!in_use()) {
+    if (owns_buffer_)
+      in_use() = true;
+    else
+      nested_.reset(new std::stringstream());
+  }
+
+  model_messages(const model_messages&) = delete;
+  model_messages& operator=(const model_messages&) = delete;
+
+  ~model_messages() {
+    std::stringstream& ss = buffer();
+    if (ss.tellp() > 0) {
+      logger_.info(ss);
+      ss.str(std::string());
+    }
+    ss.clear();
+    if (owns_buffer_)
+      in_use() = false;
+  }
+
+  /**
+   * Return the stream to pass to the model.
+   */
+  std::ostream* stream() { return &buffer(); }
+
+ private:
+  callbacks::logger& logger_;
+  bool owns_buffer_;
+  std::unique_ptr<std::stringstream> nested_;
+
+  std::stringstream& buffer() {
+    return owns_buffer_ ? thread_buffer() : *nested_;
+  }
+
+  static std::stringstream& thread_buffer() {
+    static thread_local std::stringstream ss;
+    return ss;
+  }
+
+  static bool& in_use() {
+    static thread_local bool used = false;
+    return used;
+  }
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
@@ -16,7 +16,8 @@ namespace lang {
 
 /**
  * Returns true if the specified exception can be dynamically
- * cast to the template parameter type.
+ * cast to the template parameter type. The cast is of a pointer, so a
+ * failed test does not throw <code>std::bad_cast</code>.
  *
  * @tparam E Type to test.
  * @param[in] e Exception to test.
@@ -24,12 +25,7 @@ namespace lang {
  */
 template <typename E>
 bool is_type(const std::exception& e) {
-  try {
-    (void)dynamic_cast<const E&>(e);
-    return true;
-  } catch (...) {
-    return false;
-  }
+  return dynamic_cast<const E*>(&e) != nullptr;
 }
 
 /**
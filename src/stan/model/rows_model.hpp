@@ -0,0 +1,66 @@
+#ifndef STAN_MODEL_ROWS_MODEL_HPP
+#define STAN_MODEL_ROWS_MODEL_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * View of a model whose log density is estimated from a subset of the
+ * rows of its data, for algorithms that only evaluate the log density
+ * through <code>log_prob()</code>. The model must provide
+ *
+ * ```
+ * template <bool propto, bool jacobian, typename T>
+ * T log_prob_rows(Eigen::Matrix<T, -1, 1>& params_r,
+ *                 const std::vector<size_t>& rows,
+ *                 std::ostream* msgs) const;
+ *
+ * size_t num_rows() const;
+ * ```
+ *
+ * as for <code>stan::optimization::ModelRowsAdaptor</code>, where
+ * <code>log_prob_rows()</code> returns the terms of the log density
+ * that don't depend on the rows plus the terms of the specified rows
+ * scaled by <code>num_rows()</code> over their number. The view holds
+ * references to the model and the rows, which must outlive it.
+ *
+ * @tparam M type of model
+ */
+template <class M>
+class rows_model {
+ public:
+  /**
+   * Construct a view of the specified model restricted to the
+   * specified rows.
+   *
+   * @param[in] model model
+   * @param[in] rows indices of the rows of data to evaluate
+   */
+  rows_model(const M& model, const std::vector<size_t>& rows)
+      : model_(model), rows_(rows) {}
+
+  size_t num_params_r() const { return model_.num_params_r(); }
+
+  /**
+   * Return the estimate of the log density from the rows.
+   */
+  template <bool propto, bool jacobian_adjust_transform, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+             std::ostream* msgs = 0) const {
+    return model_.template log_prob_rows<propto, jacobian_adjust_transform, T>(
+        params_r, rows_, msgs);
+  }
+
+ private:
+  const M& model_;
+  const std::vector<size_t>& rows_;
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
@@ -0,0 +1,122 @@
+#ifndef STAN_MODEL_SPARSE_HESSIAN_HPP
+#define STAN_MODEL_SPARSE_HESSIAN_HPP
+
+#include <stan/math/mix.hpp>
+#include <stan/model/hessian_coloring.hpp>
+#include <stan/model/hessian_times_vector.hpp>
+#include <stan/model/model_functional.hpp>
+#include <Eigen/SparseCore>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Return the sparsity pattern of the Hessian of the log density at the
+ * specified point, found from one Hessian-vector product per
+ * parameter. This costs as much as a dense Hessian, so it is meant to
+ * be computed once and passed to <code>sparse_hessian()</code> for
+ * every later point. Entries that happen to be zero at this point are
+ * left out, so the point should be generic, such as a random
+ * initialization rather than zero.
+ *
+ * @tparam M Class of model.
+ * @param[in] model Model.
+ * @param[in] x Unconstrained parameters.
+ * @param[in, out] msgs Stream to which print statements in Stan
+ * programs are written, default is 0
+ * @return sparsity pattern, with structural nonzeros set to one
+ */
+template <class M>
+Eigen::SparseMatrix<double> hessian_sparsity(
+    const M& model, const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+    std::ostream* msgs = 0) {
+  const Eigen::Index n = x.size();
+  std::vector<Eigen::Triplet<double>> entries;
+  Eigen::VectorXd v = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd hess_f_dot_v;
+  double f;
+  for (Eigen::Index j = 0; j < n; ++j) {
+    v(j) = 1;
+    hessian_times_vector(model, x, v, f, hess_f_dot_v, msgs);
+    v(j) = 0;
+    for (Eigen::Index i = 0; i < n; ++i)
+      if (hess_f_dot_v(i) != 0)
+        entries.emplace_back(i, j, 1);
+  }
+  Eigen::SparseMatrix<double> pattern(n, n);
+  pattern.setFromTriplets(entries.begin(), entries.end());
+  return symmetric_hessian_pattern(pattern);
+}
+
+/**
+ * Evaluate the log density, its gradient and its sparse Hessian at
+ * the specified point, given the sparsity pattern of the Hessian.
+ *
+ * The columns of the Hessian are grouped by
+ * <code>color_hessian_columns()</code> into sets with no nonzero row
+ * in common, and each set is recovered from a single forward-over-
+ * reverse Hessian-vector product along the sum of its unit vectors.
+ * This takes one product per color instead of one per parameter, so
+ * models whose parameters each interact with few others, such as
+ * hierarchical models with local parameters, need a number of sweeps
+ * that doesn't grow with the number of parameters.
+ *
+ * Entries of the Hessian outside the pattern must be zero; otherwise
+ * they are added into the entries of the pattern that share their row
+ * and color.
+ *
+ * @tparam M Class of model.
+ * @param[in] model Model.
+ * @param[in] x Unconstrained parameters.
+ * @param[in] pattern Sparsity pattern of the Hessian, in its lower
+ *   triangle, upper triangle or both, such as returned by
+ *   <code>hessian_sparsity()</code>.
+ * @param[out] f Log density.
+ * @param[out] grad_f Gradient of the log density.
+ * @param[out] hess_f Hessian of the log density, with the structure
+ *   of the symmetrized pattern.
+ * @param[in, out] msgs Stream to which print statements in Stan
+ * programs are written, default is 0
+ * @throw std::invalid_argument if the pattern isn't square with one
+ *   row per parameter
+ */
+template <class M>
+void sparse_hessian(const M& model,
+                    const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+                    const Eigen::SparseMatrix<double>& pattern, double& f,
+                    Eigen::Matrix<double, Eigen::Dynamic, 1>& grad_f,
+                    Eigen::SparseMatrix<double>& hess_f,
+                    std::ostream* msgs = 0) {
+  if (pattern.cols() != x.size())
+    throw std::invalid_argument(
+        "Hessian sparsity pattern must have one column per parameter");
+  stan::math::gradient(model_functional<M>(model, msgs), x, f, grad_f);
+
+  hess_f = symmetric_hessian_pattern(pattern);
+  std::vector<int> colors;
+  const int num_colors = color_hessian_columns(hess_f, colors);
+  std::vector<std::vector<Eigen::Index>> columns(num_colors);
+  for (Eigen::Index j = 0; j < x.size(); ++j)
+    columns[colors[j]].push_back(j);
+
+  Eigen::VectorXd v = Eigen::VectorXd::Zero(x.size());
+  Eigen::VectorXd hess_f_dot_v;
+  double f_v;
+  for (int c = 0; c < num_colors; ++c) {
+    for (Eigen::Index j : columns[c])
+      v(j) = 1;
+    hessian_times_vector(model, x, v, f_v, hess_f_dot_v, msgs);
+    for (Eigen::Index j : columns[c]) {
+      v(j) = 0;
+      for (Eigen::SparseMatrix<double>::InnerIterator it(hess_f, j); it; ++it)
+        it.valueRef() = hess_f_dot_v(it.row());
+    }
+  }
+}
+
+}  // namespace model
+}  // namespace stan
+#endif
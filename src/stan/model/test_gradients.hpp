@@ -5,12 +5,120 @@
 #include <stan/callbacks/writer.hpp>
 #include <stan/model/finite_diff_grad.hpp>
 #include <stan/model/log_prob_grad.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <algorithm>
 #include <cmath>
+#include <iomanip>
 #include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace stan {
 namespace model {
+namespace internal {
+
+/**
+ * Send model output collected in the specified stream to the logger
+ * and writer.
+ */
+inline void write_message(std::stringstream& msg,
+                          stan::callbacks::logger& logger,
+                          stan::callbacks::writer& parameter_writer) {
+  if (msg.str().length() > 0) {
+    logger.info(msg);
+    parameter_writer(msg.str());
+  }
+}
+
+/**
+ * Write a table comparing derivatives computed by the model with
+ * finite differences, returning the number of rows that differ by
+ * more than the allowed error. The value column is left out if
+ * <code>values</code> is null.
+ */
+inline int write_comparison(double lp, const std::string& label,
+                            const std::vector<size_t>& indexes,
+                            const std::vector<double>* values,
+                            const std::vector<double>& grad,
+                            const std::vector<double>& grad_fd, double error,
+                            stan::callbacks::logger& logger,
+                            stan::callbacks::writer& parameter_writer) {
+  int num_failed = 0;
+
+  std::stringstream lp_msg;
+  lp_msg << " Log probability=" << lp;
+
+  parameter_writer();
+  parameter_writer(lp_msg.str());
+  parameter_writer();
+
+  logger.info("");
+  logger.info(lp_msg);
+  logger.info("");
+
+  std::stringstream header;
+  header << std::setw(10) << label;
+  if (values)
+    header << std::setw(16) << "value";
+  header << std::setw(16) << "model" << std::setw(16) << "finite diff"
+         << std::setw(16) << "error";
+
+  parameter_writer(header.str());
+  logger.info(header);
+
+  for (size_t j = 0; j < indexes.size(); j++) {
+    std::stringstream line;
+    line << std::setw(10) << indexes[j];
+    if (values)
+      line << std::setw(16) << (*values)[j];
+    line << std::setw(16) << grad[j] << std::setw(16) << grad_fd[j]
+         << std::setw(16) << (grad[j] - grad_fd[j]);
+    parameter_writer(line.str());
+    logger.info(line);
+    if (std::fabs(grad[j] - grad_fd[j]) > error)
+      num_failed++;
+  }
+  return num_failed;
+}
+
+/**
+ * Compare the gradient of the model with finite differences with
+ * respect to the specified coordinates, as <code>test_gradients</code>
+ * does.
+ */
+template <bool propto, bool jacobian_adjust_transform, class Model>
+int test_coordinates(const Model& model, std::vector<double>& params_r,
+                     std::vector<int>& params_i,
+                     const std::vector<size_t>& coordinates, double epsilon,
+                     double error, bool parallel,
+                     stan::callbacks::interrupt& interrupt,
+                     stan::callbacks::logger& logger,
+                     stan::callbacks::writer& parameter_writer) {
+  std::stringstream msg;
+  std::vector<double> grad;
+  double lp = log_prob_grad<propto, jacobian_adjust_transform>(
+      model, params_r, params_i, grad, &msg);
+  write_message(msg, logger, parameter_writer);
+
+  std::vector<double> grad_fd;
+  finite_diff_grad<false, true>(model, interrupt, params_r, params_i,
+                                coordinates, grad_fd, epsilon, parallel, &msg);
+  write_message(msg, logger, parameter_writer);
+
+  std::vector<double> values(coordinates.size());
+  std::vector<double> grad_selected(coordinates.size());
+  for (size_t j = 0; j < coordinates.size(); ++j) {
+    values[j] = params_r[coordinates[j]];
+    grad_selected[j] = grad[coordinates[j]];
+  }
+  return write_comparison(lp, "param idx", coordinates, &values,
+                          grad_selected, grad_fd, error, logger,
+                          parameter_writer);
+}
+
+}  // namespace internal
 
 /**
  * Test the log_prob_grad() function's ability to produce
@@ -43,55 +151,140 @@ int test_gradients(const Model& model, std::vector<double>& params_r,
                    stan::callbacks::interrupt& interrupt,
                    stan::callbacks::logger& logger,
                    stan::callbacks::writer& parameter_writer) {
+  std::vector<size_t> coordinates(params_r.size());
+  for (size_t k = 0; k < coordinates.size(); ++k)
+    coordinates[k] = k;
+  return internal::test_coordinates<propto, jacobian_adjust_transform>(
+      model, params_r, params_i, coordinates, epsilon, error, false,
+      interrupt, logger, parameter_writer);
+}
+
+/**
+ * Test the log_prob_grad() function's gradients against finite
+ * differences with respect to a random subset of the parameters, as
+ * above. Each checked parameter costs two evaluations of the log
+ * density, so checking a subset keeps the test affordable for models
+ * with many parameters.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to the
+ * log probability.
+ * @tparam Model Class of model.
+ * @tparam RNG Class of random number generator.
+ * @param[in] model Model.
+ * @param[in] params_r Real-valued parameter vector.
+ * @param[in] params_i Integer-valued parameter vector.
+ * @param[in] epsilon Real-valued scalar saying how much to perturb.
+ * @param[in] error Real-valued scalar saying how much error to allow.
+ * @param[in] num_coordinates Number of parameters to check, drawn
+ *   without replacement; all are checked if there are no more.
+ * @param[in,out] rng Random number generator.
+ * @param[in] parallel Whether to compute the finite differences in
+ *   parallel when Stan is built with <code>STAN_THREADS</code>.
+ * @param[in,out] interrupt callback to be called at every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] parameter_writer Writer callback for file output
+ * @return number of failed gradient comparisons versus allowed
+ * error, so 0 if all gradients pass
+ */
+template <bool propto, bool jacobian_adjust_transform, class Model, class RNG>
+int test_gradients(const Model& model, std::vector<double>& params_r,
+                   std::vector<int>& params_i, double epsilon, double error,
+                   size_t num_coordinates, RNG& rng, bool parallel,
+                   stan::callbacks::interrupt& interrupt,
+                   stan::callbacks::logger& logger,
+                   stan::callbacks::writer& parameter_writer) {
+  std::vector<size_t> coordinates(params_r.size());
+  for (size_t k = 0; k < coordinates.size(); ++k)
+    coordinates[k] = k;
+  if (num_coordinates < coordinates.size()) {
+    for (size_t k = 0; k < num_coordinates; ++k) {
+      boost::random::uniform_int_distribution<size_t> pick(
+          k, coordinates.size() - 1);
+      std::swap(coordinates[k], coordinates[pick(rng)]);
+    }
+    coordinates.resize(num_coordinates);
+    std::sort(coordinates.begin(), coordinates.end());
+  }
+  return internal::test_coordinates<propto, jacobian_adjust_transform>(
+      model, params_r, params_i, coordinates, epsilon, error, parallel,
+      interrupt, logger, parameter_writer);
+}
+
+/**
+ * Test the log_prob_grad() function's gradients against finite
+ * differences along random directions. The directional derivative
+ * of the model is the dot product of its gradient with the direction,
+ * and is compared with a central difference along the direction, so
+ * each check costs two evaluations of the log density whatever the
+ * number of parameters. The directions are drawn uniformly from the
+ * unit sphere.
+ *
+ * @tparam propto True if calculation is up to proportion
+ * (double-only terms dropped).
+ * @tparam jacobian_adjust_transform True if the log absolute
+ * Jacobian determinant of inverse parameter transforms is added to the
+ * log probability.
+ * @tparam Model Class of model.
+ * @tparam RNG Class of random number generator.
+ * @param[in] model Model.
+ * @param[in] params_r Real-valued parameter vector.
+ * @param[in] params_i Integer-valued parameter vector.
+ * @param[in] epsilon Real-valued scalar saying how much to perturb.
+ * @param[in] error Real-valued scalar saying how much error to allow.
+ * @param[in] num_directions Number of directions to check.
+ * @param[in,out] rng Random number generator.
+ * @param[in] parallel Whether to compute the finite differences in
+ *   parallel when Stan is built with <code>STAN_THREADS</code>.
+ * @param[in,out] interrupt callback to be called at every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] parameter_writer Writer callback for file output
+ * @return number of failed comparisons versus allowed error, so 0 if
+ * all directional derivatives pass
+ */
+template <bool propto, bool jacobian_adjust_transform, class Model, class RNG>
+int test_directional_gradients(const Model& model,
+                               std::vector<double>& params_r,
+                               std::vector<int>& params_i, double epsilon,
+                               double error, size_t num_directions, RNG& rng,
+                               bool parallel,
+                               stan::callbacks::interrupt& interrupt,
+                               stan::callbacks::logger& logger,
+                               stan::callbacks::writer& parameter_writer) {
+  boost::random::normal_distribution<double> unit_normal;
+  Eigen::MatrixXd directions(params_r.size(), num_directions);
+  for (size_t j = 0; j < num_directions; ++j) {
+    for (size_t k = 0; k < params_r.size(); ++k)
+      directions(k, j) = unit_normal(rng);
+    double norm = directions.col(j).norm();
+    if (norm > 0)
+      directions.col(j) /= norm;
+  }
+
   std::stringstream msg;
   std::vector<double> grad;
   double lp = log_prob_grad<propto, jacobian_adjust_transform>(
       model, params_r, params_i, grad, &msg);
-  if (msg.str().length() > 0) {
-    logger.info(msg);
-    parameter_writer(msg.str());
-  }
+  internal::write_message(msg, logger, parameter_writer);
 
   std::vector<double> grad_fd;
-  finite_diff_grad<false, true, Model>(model, interrupt, params_r, params_i,
-                                       grad_fd, epsilon, &msg);
-  if (msg.str().length() > 0) {
-    logger.info(msg);
-    parameter_writer(msg.str());
-  }
-
-  int num_failed = 0;
-
-  std::stringstream lp_msg;
-  lp_msg << " Log probability=" << lp;
-
-  parameter_writer();
-  parameter_writer(lp_msg.str());
-  parameter_writer();
-
-  logger.info("");
-  logger.info(lp_msg);
-  logger.info("");
-
-  std::stringstream header;
-  header << std::setw(10) << "param idx" << std::setw(16) << "value"
-         << std::setw(16) << "model" << std::setw(16) << "finite diff"
-         << std::setw(16) << "error";
+  finite_diff_grad<false, true>(model, interrupt, params_r, params_i,
+                                directions, grad_fd, epsilon, parallel, &msg);
+  internal::write_message(msg, logger, parameter_writer);
 
-  parameter_writer(header.str());
-  logger.info(header);
+  Eigen::Map<const Eigen::VectorXd> grad_vector(grad.data(), grad.size());
+  std::vector<double> grad_dot_directions(num_directions);
+  for (size_t j = 0; j < num_directions; ++j)
+    grad_dot_directions[j] = grad_vector.dot(directions.col(j));
 
-  for (size_t k = 0; k < params_r.size(); k++) {
-    std::stringstream line;
-    line << std::setw(10) << k << std::setw(16) << params_r[k] << std::setw(16)
-         << grad[k] << std::setw(16) << grad_fd[k] << std::setw(16)
-         << (grad[k] - grad_fd[k]);
-    parameter_writer(line.str());
-    logger.info(line);
-    if (std::fabs(grad[k] - grad_fd[k]) > error)
-      num_failed++;
-  }
-  return num_failed;
+  std::vector<size_t> indexes(num_directions);
+  for (size_t j = 0; j < num_directions; ++j)
+    indexes[j] = j;
+  return internal::write_comparison(lp, "direction", indexes, nullptr,
+                                    grad_dot_directions, grad_fd, error,
+                                    logger, parameter_writer);
 }
 
 }  // namespace model
@@ -0,0 +1,370 @@
+#ifndef STAN_MODEL_TRANSFORMED_DATA_SNAPSHOT_HPP
+#define STAN_MODEL_TRANSFORMED_DATA_SNAPSHOT_HPP
+
+#include <stan/io/var_context.hpp>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * Writes the members computed by the transformed data block of a model
+ * to a binary stream, each under its name. Scalars are written as 8
+ * bytes, Eigen matrices as their number of rows and columns followed by
+ * their values in column major order, and strings and standard vectors
+ * as their size followed by their elements. Numbers are in the byte
+ * order of the machine writing them.
+ */
+class transformed_data_writer {
+ public:
+  explicit transformed_data_writer(std::ostream& out) : out_(out) {}
+
+  /**
+   * Write a named member.
+   *
+   * @tparam T type of the member: an arithmetic type, a dense Eigen
+   *   matrix of doubles, a string, or a standard vector of these
+   * @param name name of the member
+   * @param x value of the member
+   */
+  template <typename T>
+  void write(const std::string& name, const T& x) {
+    write_size(name.size());
+    out_.write(name.data(), name.size());
+    write_value(x);
+  }
+
+ private:
+  std::ostream& out_;
+
+  void write_size(uint64_t n) {
+    out_.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  }
+
+  template <typename T,
+            std::enable_if_t<std::is_floating_point<T>::value>* = nullptr>
+  void write_value(const T& x) {
+    double y = x;
+    out_.write(reinterpret_cast<const char*>(&y), sizeof(y));
+  }
+
+  template <typename T, std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+  void write_value(const T& x) {
+    int64_t y = x;
+    out_.write(reinterpret_cast<const char*>(&y), sizeof(y));
+  }
+
+  template <int R, int C>
+  void write_value(const Eigen::Matrix<double, R, C>& x) {
+    write_size(x.rows());
+    write_size(x.cols());
+    out_.write(reinterpret_cast<const char*>(x.data()),
+               sizeof(double) * x.size());
+  }
+
+  void write_value(const std::string& x) {
+    write_size(x.size());
+    out_.write(x.data(), x.size());
+  }
+
+  template <typename T>
+  void write_value(const std::vector<T>& x) {
+    write_size(x.size());
+    for (const T& y : x)
+      write_value(y);
+  }
+};
+
+/**
+ * Reads the members written by a <code>transformed_data_writer</code>
+ * back, in the order they were written.
+ */
+class transformed_data_reader {
+ public:
+  explicit transformed_data_reader(std::istream& in) : in_(in) {}
+
+  /**
+   * Read a named member, resizing it as needed.
+   *
+   * @tparam T type of the member
+   * @param name name of the member
+   * @param[out] x value of the member
+   * @throw std::domain_error if the next member has another name or
+   *   the stream ends early
+   */
+  template <typename T>
+  void read(const std::string& name, T& x) {
+    std::string found(read_size(), '\0');
+    read_bytes(&found[0], found.size());
+    if (found != name)
+      throw std::domain_error("transformed data snapshot: expected " + name
+                              + " but found " + found);
+    read_value(x);
+  }
+
+ private:
+  std::istream& in_;
+
+  void read_bytes(char* data, size_t n) {
+    if (n > 0 && !in_.read(data, n))
+      throw std::domain_error("transformed data snapshot: unexpected end");
+  }
+
+  uint64_t read_size() {
+    uint64_t n = 0;
+    read_bytes(reinterpret_cast<char*>(&n), sizeof(n));
+    return n;
+  }
+
+  template <typename T,
+            std::enable_if_t<std::is_floating_point<T>::value>* = nullptr>
+  void read_value(T& x) {
+    double y;
+    read_bytes(reinterpret_cast<char*>(&y), sizeof(y));
+    x = y;
+  }
+
+  template <typename T, std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+  void read_value(T& x) {
+    int64_t y;
+    read_bytes(reinterpret_cast<char*>(&y), sizeof(y));
+    x = static_cast<T>(y);
+  }
+
+  template <int R, int C>
+  void read_value(Eigen::Matrix<double, R, C>& x) {
+    uint64_t rows = read_size();
+    uint64_t cols = read_size();
+    if ((R != Eigen::Dynamic && rows != static_cast<uint64_t>(R))
+        || (C != Eigen::Dynamic && cols != static_cast<uint64_t>(C)))
+      throw std::domain_error("transformed data snapshot: wrong size");
+    x.resize(rows, cols);
+    read_bytes(reinterpret_cast<char*>(x.data()), sizeof(double) * x.size());
+  }
+
+  void read_value(std::string& x) {
+    x.resize(read_size());
+    read_bytes(&x[0], x.size());
+  }
+
+  template <typename T>
+  void read_value(std::vector<T>& x) {
+    x.resize(read_size());
+    for (T& y : x)
+      read_value(y);
+  }
+};
+
+/**
+ * A <code>transformed_data_snapshot</code> lets a model load the
+ * members computed by its transformed data block from a file instead
+ * of computing them, which saves the startup time of models with an
+ * expensive transformed data block when the same data is used again,
+ * by another chain or another run.
+ *
+ * While a snapshot is in scope, models constructed on the same thread
+ * look it up from their constructor. A generated model supporting
+ * snapshots overrides <code>write_transformed_data()</code> and
+ * <code>read_transformed_data()</code> of <code>model_base</code> and
+ * runs its transformed data block as
+ *
+ * <pre>
+ * using stan::model::transformed_data_snapshot;
+ * if (!transformed_data_snapshot::load(context__, random_seed__, *this)) {
+ *   // transformed data block
+ *   transformed_data_snapshot::save(context__, random_seed__, *this);
+ * }
+ * </pre>
+ *
+ * The file holds the magic string <code>STANTD02</code>, a 64 bit hash
+ * of the data and the seed, the name of the model, the build hash of
+ * the model and the members written by the model. A file for other
+ * data, another seed, another model or another build of the model is
+ * not loaded, and is replaced once the transformed data has been
+ * computed. The model must provide <code>model_build_hash()</code>,
+ * see <code>model_base</code>, which a generated model overrides with a
+ * hash of its code so that a snapshot isn't read after the model is
+ * recompiled with another transformed data block.
+ */
+class transformed_data_snapshot {
+ public:
+  /**
+   * Put a snapshot file in scope on this thread.
+   *
+   * @param path path of the snapshot file, which need not exist
+   */
+  explicit transformed_data_snapshot(const std::string& path)
+      : path_(path), loaded_(false), saved_(false), previous_(active()) {
+    active() = this;
+  }
+
+  transformed_data_snapshot(const transformed_data_snapshot&) = delete;
+  transformed_data_snapshot& operator=(const transformed_data_snapshot&)
+      = delete;
+
+  ~transformed_data_snapshot() { active() = previous_; }
+
+  /**
+   * Return true if a model read its transformed data from the file.
+   */
+  bool loaded() const { return loaded_; }
+
+  /**
+   * Return true if a model wrote its transformed data to the file.
+   */
+  bool saved() const { return saved_; }
+
+  const std::string& path() const { return path_; }
+
+  /**
+   * Return a 64 bit FNV-1a hash of the names, sizes and values of the
+   * variables of the data and of the seed.
+   *
+   * @param context data of the model
+   * @param seed seed of the random number generator of the transformed
+   *   data block
+   */
+  static uint64_t data_hash(const io::var_context& context,
+                            unsigned int seed) {
+    uint64_t h = 14695981039346656037ULL;
+    hash_bytes(h, &seed, sizeof(seed));
+    std::vector<std::string> names;
+    context.names_r(names);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+      hash_bytes(h, name.data(), name.size());
+      std::vector<size_t> dims = context.dims_r(name);
+      hash_bytes(h, dims.data(), sizeof(size_t) * dims.size());
+      std::vector<double> vals = context.vals_r(name);
+      hash_bytes(h, vals.data(), sizeof(double) * vals.size());
+    }
+    names.clear();
+    context.names_i(names);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+      hash_bytes(h, name.data(), name.size());
+      std::vector<size_t> dims = context.dims_i(name);
+      hash_bytes(h, dims.data(), sizeof(size_t) * dims.size());
+      std::vector<int> vals = context.vals_i(name);
+      hash_bytes(h, vals.data(), sizeof(int) * vals.size());
+    }
+    return h;
+  }
+
+  /**
+   * Read the transformed data of a model from the snapshot in scope.
+   *
+   * @tparam Model type of the model
+   * @param context data of the model
+   * @param seed seed of the random number generator of the model
+   * @param[in,out] model model whose transformed data is read
+   * @return true if the transformed data was read, false if there is no
+   *   snapshot in scope or its file is missing, unreadable or stale,
+   *   written for other data, seed, model or build of the model, in
+   *   which case the transformed data has to be computed
+   */
+  template <class Model>
+  static bool load(const io::var_context& context, unsigned int seed,
+                   Model& model) {
+    transformed_data_snapshot* snapshot = active();
+    if (!snapshot)
+      return false;
+    std::ifstream in(snapshot->path_, std::ios::binary);
+    if (!in)
+      return false;
+    try {
+      char magic[8];
+      uint64_t hash = 0;
+      if (!in.read(magic, sizeof(magic))
+          || std::memcmp(magic, "STANTD02", sizeof(magic)) != 0
+          || !in.read(reinterpret_cast<char*>(&hash), sizeof(hash))
+          || hash != data_hash(context, seed))
+        return false;
+      transformed_data_reader reader(in);
+      std::string name, build;
+      reader.read("model", name);
+      reader.read("build", build);
+      if (name != model.model_name() || build != model.model_build_hash()
+          || !model.read_transformed_data(reader))
+        return false;
+    } catch (const std::domain_error& e) {
+      return false;
+    }
+    snapshot->loaded_ = true;
+    return true;
+  }
+
+  /**
+   * Write the transformed data of a model to the snapshot in scope. The
+   * file is written next to its path and renamed, so a concurrent
+   * reader sees either the old or the new file. A file that can't be
+   * written is skipped, as the model works without it.
+   *
+   * @tparam Model type of the model
+   * @param context data of the model
+   * @param seed seed of the random number generator of the model
+   * @param model model whose transformed data is written
+   */
+  template <class Model>
+  static void save(const io::var_context& context, unsigned int seed,
+                   const Model& model) {
+    transformed_data_snapshot* snapshot = active();
+    if (!snapshot)
+      return;
+    std::string tmp_path = snapshot->path_ + ".tmp";
+    {
+      std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+      if (!out)
+        return;
+      uint64_t hash = data_hash(context, seed);
+      out.write("STANTD02", 8);
+      out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+      transformed_data_writer writer(out);
+      writer.write("model", model.model_name());
+      writer.write("build", model.model_build_hash());
+      if (!model.write_transformed_data(writer) || !out.flush()) {
+        out.close();
+        std::remove(tmp_path.c_str());
+        return;
+      }
+    }
+    if (std::rename(tmp_path.c_str(), snapshot->path_.c_str()) == 0)
+      snapshot->saved_ = true;
+    else
+      std::remove(tmp_path.c_str());
+  }
+
+ private:
+  std::string path_;
+  bool loaded_;
+  bool saved_;
+  transformed_data_snapshot* previous_;
+
+  static transformed_data_snapshot*& active() {
+    static thread_local transformed_data_snapshot* snapshot = nullptr;
+    return snapshot;
+  }
+
+  static void hash_bytes(uint64_t& h, const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+  }
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
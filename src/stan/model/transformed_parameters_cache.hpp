@@ -0,0 +1,211 @@
+#ifndef STAN_MODEL_TRANSFORMED_PARAMETERS_CACHE_HPP
+#define STAN_MODEL_TRANSFORMED_PARAMETERS_CACHE_HPP
+
+#include <boost/functional/hash.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace stan {
+namespace model {
+
+/**
+ * A <code>transformed_parameters_cache</code> keeps the values of the
+ * transformed parameters a model computed while evaluating its log
+ * density with autodiff, at the last few points evaluated on a thread,
+ * so that <code>write_array()</code> at one of those points can reuse
+ * them instead of running the transformed parameters block again. For
+ * models with expensive transformed parameters, such as ODE solutions,
+ * that block can cost as much as a leapfrog step, and the draw a
+ * sampler keeps is one of the points whose gradient it evaluated.
+ *
+ * Caching is opt-in: it is on for the evaluations on a thread while a
+ * <code>transformed_parameters_cache::scope</code> is alive there, and
+ * only for models whose generated code uses it. Such code, in the
+ * log density with autodiff variables, once the transformed parameters
+ * are computed and validated, calls
+ * <code>current()->store(params_r, values)</code> with the values of
+ * the transformed parameters as doubles, in the order
+ * <code>write_array()</code> writes them; and in
+ * <code>write_array()</code>, when the transformed parameters are
+ * requested, calls <code>current()->find(params_r)</code> and uses the
+ * values it returns instead of computing them, if it returns any. The
+ * generated code does neither when <code>current()</code> is a null
+ * pointer. Emitting these calls is up to the code generator.
+ *
+ * Points are looked up by a hash of their unconstrained parameters and
+ * then compared exactly, so a value is only reused at the very point it
+ * was computed at. The values are those of the autodiff evaluation,
+ * which may differ from a double evaluation in the last bits. The
+ * cache keeps up to <code>capacity</code> points, overwriting the
+ * oldest, and reuses their storage, so after the first few evaluations
+ * storing allocates nothing. It uses
+ * <code>capacity * (num_params + num_transformed_params)</code> doubles.
+ */
+class transformed_parameters_cache {
+ public:
+  /**
+   * Construct a cache of the values at up to the specified number of
+   * points.
+   *
+   * @param capacity number of points to remember
+   */
+  explicit transformed_parameters_cache(size_t capacity)
+      : capacity_(capacity), next_(0), hits_(0), misses_(0) {}
+
+  /**
+   * Store the values of the transformed parameters at a point,
+   * overwriting the oldest point if the cache is full.
+   *
+   * @tparam VecR type of the parameters, indexable by
+   *   <code>operator[]</code>
+   * @tparam VecT type of the values, indexable by
+   *   <code>operator[]</code>
+   * @param params_r unconstrained parameters of the point
+   * @param values values of the transformed parameters at the point
+   */
+  template <typename VecR, typename VecT>
+  void store(const VecR& params_r, const VecT& values) {
+    if (capacity_ == 0)
+      return;
+    if (entries_.size() < capacity_)
+      entries_.emplace_back();
+    entry& e = entries_[next_];
+    next_ = (next_ + 1) % capacity_;
+    e.hash = hash(params_r);
+    e.params_r.resize(params_r.size());
+    for (size_t i = 0; i < e.params_r.size(); ++i)
+      e.params_r[i] = params_r[i];
+    e.values.resize(values.size());
+    for (size_t i = 0; i < e.values.size(); ++i)
+      e.values[i] = values[i];
+  }
+
+  /**
+   * Return the values of the transformed parameters stored at a point,
+   * or a null pointer if the point isn't in the cache. The values are
+   * valid until the next call to <code>store()</code>.
+   *
+   * @tparam VecR type of the parameters, indexable by
+   *   <code>operator[]</code>
+   * @param params_r unconstrained parameters of the point
+   * @return values at the point, or a null pointer
+   */
+  template <typename VecR>
+  const std::vector<double>* find(const VecR& params_r) {
+    size_t h = hash(params_r);
+    // Newest first, as the point looked up is usually a recent one
+    for (size_t k = 1; k <= entries_.size(); ++k) {
+      const entry& e
+          = entries_[(next_ + entries_.size() - k) % entries_.size()];
+      if (e.hash == h && equal(e.params_r, params_r)) {
+        ++hits_;
+        return &e.values;
+      }
+    }
+    ++misses_;
+    return nullptr;
+  }
+
+  /**
+   * Forget all stored points, keeping their storage.
+   */
+  void clear() {
+    entries_.clear();
+    next_ = 0;
+  }
+
+  /**
+   * Return the number of points stored.
+   */
+  size_t size() const { return entries_.size(); }
+
+  size_t capacity() const { return capacity_; }
+
+  /**
+   * Return the number of lookups that found their point.
+   */
+  size_t hits() const { return hits_; }
+
+  /**
+   * Return the number of lookups that didn't find their point.
+   */
+  size_t misses() const { return misses_; }
+
+  /**
+   * Return the cache of the scope alive on this thread, or a null
+   * pointer if there is none.
+   */
+  static transformed_parameters_cache* current() { return active(); }
+
+  /**
+   * Turns caching on for the evaluations on the thread constructing it
+   * until it is destroyed, with a cache of its own.
+   */
+  class scope;
+
+ private:
+  struct entry {
+    size_t hash;
+    std::vector<double> params_r;
+    std::vector<double> values;
+  };
+  size_t capacity_;
+  size_t next_;
+  size_t hits_;
+  size_t misses_;
+  std::vector<entry> entries_;
+
+  static transformed_parameters_cache*& active() {
+    static thread_local transformed_parameters_cache* cache = nullptr;
+    return cache;
+  }
+
+  template <typename VecR>
+  static size_t hash(const VecR& params_r) {
+    size_t seed = 0;
+    for (size_t i = 0; i < static_cast<size_t>(params_r.size()); ++i)
+      boost::hash_combine(seed, static_cast<double>(params_r[i]));
+    return seed;
+  }
+
+  template <typename VecR>
+  static bool equal(const std::vector<double>& a, const VecR& b) {
+    if (a.size() != static_cast<size_t>(b.size()))
+      return false;
+    for (size_t i = 0; i < a.size(); ++i)
+      if (a[i] != b[i])
+        return false;
+    return true;
+  }
+};
+
+/**
+ * Turns caching on for the evaluations on the thread constructing it
+ * until it is destroyed, with a cache of its own. Scopes nest, and the
+ * destructor restores the cache of the enclosing scope, so a scope must
+ * be destroyed on the thread that constructed it.
+ */
+class transformed_parameters_cache::scope {
+ public:
+  /**
+   * @param capacity number of points the cache remembers
+   */
+  explicit scope(size_t capacity) : cache_(capacity), previous_(active()) {
+    active() = &cache_;
+  }
+
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+
+  ~scope() { active() = previous_; }
+
+  transformed_parameters_cache& cache() { return cache_; }
+
+ private:
+  transformed_parameters_cache cache_;
+  transformed_parameters_cache* previous_;
+};
+
+}  // namespace model
+}  // namespace stan
+#endif
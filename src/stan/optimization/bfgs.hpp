@@ -3,9 +3,11 @@
 
 #include <stan/math/prim.hpp>
 #include <stan/model/log_prob_propto.hpp>
+#include <stan/model/log_prob_cache.hpp>
 #include <stan/model/log_prob_grad.hpp>
 #include <stan/optimization/bfgs_linesearch.hpp>
 #include <stan/optimization/bfgs_update.hpp>
+#include <stan/optimization/compact_lbfgs_update.hpp>
 #include <stan/optimization/lbfgs_update.hpp>
 #include <algorithm>
 #include <cmath>
@@ -60,6 +62,7 @@ class LSOptions {
     minAlpha = 1e-12;
     maxLSIts = 20;
     maxLSRestarts = 10;
+    useMoreThuente = false;
   }
   Scalar c1;
   Scalar c2;
@@ -67,6 +70,8 @@ class LSOptions {
   Scalar minAlpha;
   Scalar maxLSIts;
   Scalar maxLSRestarts;
+  // Use MoreThuenteLineSearch() instead of WolfeLineSearch()
+  bool useMoreThuente;
 };
 template <typename FunctorType, typename QNUpdateType, typename Scalar = double,
           int DimAtCompile = Eigen::Dynamic>
@@ -83,6 +88,7 @@ class BFGSMinimizer {
   size_t _itNum;
   std::string _note;
   QNUpdateType _qn;
+  bool _warm;
 
  public:
   LSOptions<Scalar> _ls_opts;
@@ -117,7 +123,7 @@ class BFGSMinimizer {
 
   const std::string &note() const { return _note; }
 
-  std::string get_code_string(int retCode) {
+  static std::string get_code_string(int retCode) {
     switch (retCode) {
       case TERM_SUCCESS:
         return std::string("Successful step completed");
@@ -154,7 +160,7 @@ class BFGSMinimizer {
     }
   }
 
-  explicit BFGSMinimizer(FunctorType &f) : _func(f) {}
+  explicit BFGSMinimizer(FunctorType &f) : _func(f), _warm(false) {}
 
   void initialize(const VectorT &x0) {
     int ret;
@@ -167,6 +173,22 @@ class BFGSMinimizer {
 
     _itNum = 0;
     _note = "";
+    _warm = false;
+  }
+
+  /**
+   * Continue from the quasi-Newton approximation already held by the
+   * update, such as one restored from a previous run on similar data,
+   * instead of resetting it on the first step. The first search
+   * direction is taken from the approximation and its line search
+   * starts from a unit step. Does nothing if the update has no history.
+   * Must be called after <code>initialize()</code>.
+   */
+  void warm_start() {
+    if (_qn.history_size() == 0)
+      return;
+    _qn.search_direction(_pk, _gk);
+    _warm = true;
   }
 
   int step() {
@@ -177,7 +199,7 @@ class BFGSMinimizer {
 
     _itNum++;
 
-    if (_itNum == 1) {
+    if (_itNum == 1 && !_warm) {
       resetB = 1;
       _note = "";
     } else {
@@ -198,6 +220,9 @@ class BFGSMinimizer {
             1.0, 1.01
                      * CubicInterp(_gk_1.dot(_pk_1), _alphak_1, _fk - _fk_1,
                                    _gk.dot(_pk_1), _ls_opts.minAlpha, 1.0));
+      } else if (_itNum == 1 && resetB != 2) {
+        // Warm started, so the approximation should be well scaled
+        _alpha0 = _alpha = 1.0;
       } else {
         // On the first step (or, after a reset) use the default step size
         _alpha0 = _alpha = _ls_opts.alpha0;
@@ -205,10 +230,23 @@ class BFGSMinimizer {
 
       // Perform the line search.  If successful, the results are in the
       // variables: _xk_1, _fk_1 and _gk_1.
-      retCode
-          = WolfeLineSearch(_func, _alpha, _xk_1, _fk_1, _gk_1, _pk, _xk, _fk,
-                            _gk, _ls_opts.c1, _ls_opts.c2, _ls_opts.minAlpha,
-                            _ls_opts.maxLSIts, _ls_opts.maxLSRestarts);
+      if (_ls_opts.useMoreThuente) {
+        retCode = MoreThuenteLineSearch(
+            _func, _alpha, _xk_1, _fk_1, _gk_1, _pk, _xk, _fk, _gk,
+            _ls_opts.c1, _ls_opts.c2, _ls_opts.minAlpha, _ls_opts.maxLSIts,
+            _ls_opts.maxLSRestarts);
+        // Keep a point with sufficient decrease rather than resetting and
+        // searching again, as long as it can update the approximation
+        if (retCode == 2 && _gk_1.dot(_pk) > _gk.dot(_pk)) {
+          retCode = 0;
+          _note += "LS curvature condition not met";
+        }
+      } else {
+        retCode = WolfeLineSearch(_func, _alpha, _xk_1, _fk_1, _gk_1, _pk, _xk,
+                                  _fk, _gk, _ls_opts.c1, _ls_opts.c2,
+                                  _ls_opts.minAlpha, _ls_opts.maxLSIts,
+                                  _ls_opts.maxLSRestarts);
+      }
       if (retCode) {
         // Line search failed...
         if (resetB) {
@@ -289,7 +327,16 @@ class BFGSMinimizer {
   }
 };
 
-template <class M>
+/**
+ * Adapts a model to the interface of the BFGS minimizers, which
+ * minimize the negative log density.
+ *
+ * @tparam M type of model
+ * @tparam Jacobian whether to include the log Jacobian of the
+ * constraining transforms, giving the density on the unconstrained
+ * scale instead of the maximum a posteriori objective
+ */
+template <class M, bool Jacobian = false>
 class ModelAdaptor {
  private:
   M &_model;
@@ -297,25 +344,45 @@ class ModelAdaptor {
   std::ostream *_msgs;
   std::vector<double> _x, _g;
   size_t _fevals;
+  stan::model::log_prob_cache *_cache;
+
+  // Evaluate the model on Eigen vectors directly, without copying them
+  // to and from std::vector; the cache and integer parameters need the
+  // std::vector overloads
+  bool eigen_path() const { return !_cache && _params_i.empty(); }
 
  public:
   ModelAdaptor(M &model, const std::vector<int> &params_i, std::ostream *msgs)
-      : _model(model), _params_i(params_i), _msgs(msgs), _fevals(0) {}
+      : _model(model),
+        _params_i(params_i),
+        _msgs(msgs),
+        _fevals(0),
+        _cache(0) {}
+
+  /**
+   * Evaluate the model through the specified cache, so that points
+   * evaluated before are not evaluated again, or directly if the cache
+   * is null. The cache must outlive the adaptor.
+   *
+   * @param cache cache of log densities and gradients
+   */
+  void set_cache(stan::model::log_prob_cache *cache) { _cache = cache; }
 
   size_t fevals() const { return _fevals; }
   int operator()(const Eigen::Matrix<double, Eigen::Dynamic, 1> &x, double &f) {
-    using Eigen::Dynamic;
-    using Eigen::Matrix;
-    using stan::math::index_type;
     using stan::model::log_prob_propto;
-    typedef typename index_type<Matrix<double, Dynamic, 1> >::type idx_t;
-
-    _x.resize(x.size());
-    for (idx_t i = 0; i < x.size(); i++)
-      _x[i] = x[i];
 
     try {
-      f = -log_prob_propto<false>(_model, _x, _params_i, _msgs);
+      if (eigen_path()) {
+        f = -log_prob_propto<Jacobian>(
+            _model, const_cast<Eigen::Matrix<double, Eigen::Dynamic, 1> &>(x),
+            _msgs);
+      } else {
+        _x.assign(x.data(), x.data() + x.size());
+        f = _cache ? -_cache->log_prob_propto<Jacobian>(_model, _x, _params_i,
+                                                        _msgs)
+                   : -log_prob_propto<Jacobian>(_model, _x, _params_i, _msgs);
+      }
     } catch (const std::exception &e) {
       if (_msgs)
         (*_msgs) << e.what() << std::endl;
@@ -334,37 +401,38 @@ class ModelAdaptor {
   }
   int operator()(const Eigen::Matrix<double, Eigen::Dynamic, 1> &x, double &f,
                  Eigen::Matrix<double, Eigen::Dynamic, 1> &g) {
-    using Eigen::Dynamic;
-    using Eigen::Matrix;
-    using stan::math::index_type;
     using stan::model::log_prob_grad;
-    typedef typename index_type<Matrix<double, Dynamic, 1> >::type idx_t;
-
-    _x.resize(x.size());
-    for (idx_t i = 0; i < x.size(); i++)
-      _x[i] = x[i];
 
     _fevals++;
 
     try {
-      f = -log_prob_grad<true, false>(_model, _x, _params_i, _g, _msgs);
+      if (eigen_path()) {
+        f = -log_prob_grad<true, Jacobian>(
+            _model, const_cast<Eigen::Matrix<double, Eigen::Dynamic, 1> &>(x),
+            g, _msgs);
+      } else {
+        _x.assign(x.data(), x.data() + x.size());
+        f = _cache ? -_cache->log_prob_grad<true, Jacobian>(
+                         _model, _x, _params_i, _g, _msgs)
+                   : -log_prob_grad<true, Jacobian>(_model, _x, _params_i, _g,
+                                                    _msgs);
+        g = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1> >(
+            _g.data(), _g.size());
+      }
     } catch (const std::exception &e) {
       if (_msgs)
         (*_msgs) << e.what() << std::endl;
       return 1;
     }
 
-    g.resize(_g.size());
-    for (size_t i = 0; i < _g.size(); i++) {
-      if (!std::isfinite(_g[i])) {
-        if (_msgs)
-          *_msgs << "Error evaluating model log probability: "
-                    "Non-finite gradient."
-                 << std::endl;
-        return 3;
-      }
-      g[i] = -_g[i];
+    if (!g.allFinite()) {
+      if (_msgs)
+        *_msgs << "Error evaluating model log probability: "
+                  "Non-finite gradient."
+               << std::endl;
+      return 3;
     }
+    g = -g;
 
     if (std::isfinite(f)) {
       return 0;
@@ -383,14 +451,16 @@ class ModelAdaptor {
 };
 
 template <typename M, typename QNUpdateType, typename Scalar = double,
-          int DimAtCompile = Eigen::Dynamic>
-class BFGSLineSearch : public BFGSMinimizer<ModelAdaptor<M>, QNUpdateType,
-                                            Scalar, DimAtCompile> {
+          int DimAtCompile = Eigen::Dynamic, bool Jacobian = false>
+class BFGSLineSearch
+    : public BFGSMinimizer<ModelAdaptor<M, Jacobian>, QNUpdateType, Scalar,
+                           DimAtCompile> {
  private:
-  ModelAdaptor<M> _adaptor;
+  ModelAdaptor<M, Jacobian> _adaptor;
 
  public:
-  typedef BFGSMinimizer<ModelAdaptor<M>, QNUpdateType, Scalar, DimAtCompile>
+  typedef BFGSMinimizer<ModelAdaptor<M, Jacobian>, QNUpdateType, Scalar,
+                        DimAtCompile>
       BFGSBase;
   typedef typename BFGSBase::VectorT vector_t;
   typedef typename stan::math::index_type<vector_t>::type idx_t;
@@ -401,6 +471,20 @@ class BFGSLineSearch : public BFGSMinimizer<ModelAdaptor<M>, QNUpdateType,
     initialize(params_r);
   }
 
+  /**
+   * Construct a minimizer that evaluates the model through the
+   * specified cache, which must outlive it, so that points evaluated
+   * before, by it or by other users of the cache, are not evaluated
+   * again.
+   */
+  BFGSLineSearch(M &model, const std::vector<double> &params_r,
+                 const std::vector<int> &params_i,
+                 stan::model::log_prob_cache &cache, std::ostream *msgs = 0)
+      : BFGSBase(_adaptor), _adaptor(model, params_i, msgs) {
+    _adaptor.set_cache(&cache);
+    initialize(params_r);
+  }
+
   void initialize(const std::vector<double> &params_r) {
     Eigen::Matrix<double, Eigen::Dynamic, 1> x;
     x.resize(params_r.size());
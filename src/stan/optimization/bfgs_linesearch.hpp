@@ -287,6 +287,269 @@ int WolfeLineSearch(FunctorType &func, Scalar &alpha, XType &x1, Scalar &f1,
   }
   return retCode;
 }
+
+/**
+ * An internal utility function for implementing MoreThuenteLineSearch().
+ *
+ * Update the interval of uncertainty [stx, sty] with the trial step stp
+ * and compute the next trial step, following the safeguarded cubic,
+ * quadratic and secant steps of subroutine dcstep in MINPACK-2, from
+ * More and Thuente (1994), "Line search algorithms with guaranteed
+ * sufficient decrease".  The endpoint stx is the step with the lowest
+ * function value found so far.
+ **/
+template <typename Scalar>
+void MoreThuenteStep(Scalar &stx, Scalar &fx, Scalar &dx, Scalar &sty,
+                     Scalar &fy, Scalar &dy, Scalar &stp, const Scalar &fp,
+                     const Scalar &dp, bool &brackt, const Scalar &stpmin,
+                     const Scalar &stpmax) {
+  const Scalar sgnd = dp * (dx / std::fabs(dx));
+  Scalar stpf, stpc, stpq, theta, s, gamma, p, q, r;
+
+  if (fp > fx) {
+    // Higher function value: the minimum is bracketed
+    theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+    s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+    gamma = s * std::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s));
+    if (stp < stx)
+      gamma = -gamma;
+    p = (gamma - dx) + theta;
+    q = ((gamma - dx) + gamma) + dp;
+    r = p / q;
+    stpc = stx + r * (stp - stx);
+    stpq = stx + ((dx / ((fx - fp) / (stp - stx) + dx)) / 2) * (stp - stx);
+    if (std::fabs(stpc - stx) < std::fabs(stpq - stx))
+      stpf = stpc;
+    else
+      stpf = stpc + (stpq - stpc) / 2;
+    brackt = true;
+  } else if (sgnd < 0) {
+    // Derivatives of opposite sign: the minimum is bracketed
+    theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+    s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+    gamma = s * std::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s));
+    if (stp > stx)
+      gamma = -gamma;
+    p = (gamma - dp) + theta;
+    q = ((gamma - dp) + gamma) + dx;
+    r = p / q;
+    stpc = stp + r * (stx - stp);
+    stpq = stp + (dp / (dp - dx)) * (stx - stp);
+    if (std::fabs(stpc - stp) > std::fabs(stpq - stp))
+      stpf = stpc;
+    else
+      stpf = stpq;
+    brackt = true;
+  } else if (std::fabs(dp) < std::fabs(dx)) {
+    // Derivative decreasing in magnitude
+    theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+    s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+    gamma = s
+            * std::sqrt(std::max(
+                Scalar(0), (theta / s) * (theta / s) - (dx / s) * (dp / s)));
+    if (stp > stx)
+      gamma = -gamma;
+    p = (gamma - dp) + theta;
+    q = (gamma + (dx - dp)) + gamma;
+    r = p / q;
+    if (r < 0 && gamma != 0)
+      stpc = stp + r * (stx - stp);
+    else if (stp > stx)
+      stpc = stpmax;
+    else
+      stpc = stpmin;
+    stpq = stp + (dp / (dp - dx)) * (stx - stp);
+    if (brackt) {
+      if (std::fabs(stpc - stp) < std::fabs(stpq - stp))
+        stpf = stpc;
+      else
+        stpf = stpq;
+      if (stp > stx)
+        stpf = std::min(stp + 0.66 * (sty - stp), stpf);
+      else
+        stpf = std::max(stp + 0.66 * (sty - stp), stpf);
+    } else {
+      if (std::fabs(stpc - stp) > std::fabs(stpq - stp))
+        stpf = stpc;
+      else
+        stpf = stpq;
+      stpf = std::max(stpmin, std::min(stpmax, stpf));
+    }
+  } else {
+    // Derivative not decreasing in magnitude
+    if (brackt) {
+      theta = 3 * (fp - fy) / (sty - stp) + dy + dp;
+      s = std::max(std::fabs(theta), std::max(std::fabs(dy), std::fabs(dp)));
+      gamma = s * std::sqrt((theta / s) * (theta / s) - (dy / s) * (dp / s));
+      if (stp > sty)
+        gamma = -gamma;
+      p = (gamma - dp) + theta;
+      q = ((gamma - dp) + gamma) + dy;
+      r = p / q;
+      stpf = stp + r * (sty - stp);
+    } else if (stp > stx) {
+      stpf = stpmax;
+    } else {
+      stpf = stpmin;
+    }
+  }
+
+  if (fp > fx) {
+    sty = stp;
+    fy = fp;
+    dy = dp;
+  } else {
+    if (sgnd < 0) {
+      sty = stx;
+      fy = fx;
+      dy = dx;
+    }
+    stx = stp;
+    fx = fp;
+    dx = dp;
+  }
+  stp = stpf;
+}
+
+/**
+ * Perform a line search which finds an approximate solution to the
+ * same problem as WolfeLineSearch(), with the same arguments, using the
+ * algorithm of More and Thuente (1994), "Line search algorithms with
+ * guaranteed sufficient decrease".
+ *
+ * The search keeps an interval of uncertainty whose endpoints are the
+ * best step found so far and a step bracketing the minimum with it,
+ * and chooses each trial step by safeguarded interpolation of the
+ * function values and derivatives at the endpoints and the last trial
+ * step, so that every evaluation narrows the interval.  It usually
+ * needs fewer evaluations than WolfeLineSearch() when the initial step
+ * is poor.
+ *
+ * If the search fails to satisfy the curvature condition but the best
+ * step found gives a sufficient decrease, x1, f1 and gradx1 are set to
+ * that step and 2 is returned, so that the caller can accept the point
+ * without evaluating the function again.
+ *
+ * @return Returns zero on success, 2 if only a sufficient decrease was
+ * achieved and 1 otherwise.
+ **/
+template <typename FunctorType, typename Scalar, typename XType>
+int MoreThuenteLineSearch(FunctorType &func, Scalar &alpha, XType &x1,
+                          Scalar &f1, XType &gradx1, const XType &p,
+                          const XType &x0, const Scalar &f0,
+                          const XType &gradx0, const Scalar &c1,
+                          const Scalar &c2, const Scalar &minAlpha,
+                          const Scalar &maxLSIts,
+                          const Scalar &maxLSRestarts) {
+  const Scalar xtrapl(1.1), xtrapu(4.0);
+  const Scalar xtol(std::numeric_limits<Scalar>::epsilon());
+  const Scalar stpmin(minAlpha);
+  const Scalar stpmax(std::numeric_limits<Scalar>::max());
+  const Scalar ginit(gradx0.dot(p));
+  const Scalar gtest(c1 * ginit);
+
+  if (!(ginit < 0))
+    return 1;
+
+  bool brackt(false);
+  int stage(1), nits(0), lsRestarts(0);
+  Scalar width(stpmax - stpmin), width1(2 * width);
+  Scalar stx(0), fx(f0), gx(ginit);
+  Scalar sty(0), fy(f0), gy(ginit);
+  Scalar stmin(0), stmax(alpha + xtrapu * alpha);
+  Scalar stp(std::max(alpha, stpmin));
+
+  // The point, value and gradient at stx, once it has moved from x0
+  XType bestX, bestDF;
+  Scalar bestF(f0);
+
+  while (1) {
+    x1.noalias() = x0 + stp * p;
+    if (func(x1, f1, gradx1)) {
+      // Shrink toward the best step and treat the failure as the upper
+      // end of the search
+      if (lsRestarts >= maxLSRestarts)
+        break;
+      lsRestarts++;
+      stmax = stp;
+      stp = 0.5 * (stx + stp);
+      if (stp - stx < stpmin)
+        break;
+      continue;
+    }
+    lsRestarts = 0;
+
+    const Scalar g(gradx1.dot(p));
+    const Scalar ftest(f0 + stp * gtest);
+
+    if (f1 <= ftest && std::fabs(g) <= -c2 * ginit) {
+      alpha = stp;
+      return 0;
+    }
+
+    if (stage == 1 && f1 <= ftest && g >= 0)
+      stage = 2;
+    if (++nits >= maxLSIts)
+      break;
+    if (brackt && (stp <= stmin || stp >= stmax))
+      break;
+    if (brackt && stmax - stmin <= xtol * stmax)
+      break;
+    if (stp == stpmin && (f1 > ftest || g >= gtest))
+      break;
+
+    const Scalar oldStx(stx);
+    if (stage == 1 && f1 <= fx && f1 > ftest) {
+      // Use the modified function psi(a) = f(a) - f(0) - a * gtest
+      // until a step with sufficient decrease and non-negative
+      // derivative is found
+      Scalar fm(f1 - stp * gtest), fxm(fx - stx * gtest), fym(fy - sty * gtest);
+      Scalar gm(g - gtest), gxm(gx - gtest), gym(gy - gtest);
+      MoreThuenteStep(stx, fxm, gxm, sty, fym, gym, stp, fm, gm, brackt, stmin,
+                      stmax);
+      fx = fxm + stx * gtest;
+      fy = fym + sty * gtest;
+      gx = gxm + gtest;
+      gy = gym + gtest;
+    } else {
+      MoreThuenteStep(stx, fx, gx, sty, fy, gy, stp, f1, g, brackt, stmin,
+                      stmax);
+    }
+    if (stx != oldStx) {
+      // The trial step became the best step
+      bestX.swap(x1);
+      bestDF.swap(gradx1);
+      bestF = f1;
+    }
+
+    if (brackt) {
+      if (std::fabs(sty - stx) >= 0.66 * width1)
+        stp = stx + 0.5 * (sty - stx);
+      width1 = width;
+      width = std::fabs(sty - stx);
+      stmin = std::min(stx, sty);
+      stmax = std::max(stx, sty);
+    } else {
+      stmin = stp + xtrapl * (stp - stx);
+      stmax = stp + xtrapu * (stp - stx);
+    }
+    stp = std::max(stpmin, std::min(stpmax, stp));
+    // Where MINPACK would evaluate the best step again, use the cached
+    // evaluation instead
+    if (brackt
+        && (stp <= stmin || stp >= stmax || stmax - stmin <= xtol * stmax))
+      break;
+  }
+
+  if (stx > 0 && bestF <= f0 + stx * gtest) {
+    alpha = stx;
+    x1.swap(bestX);
+    f1 = bestF;
+    gradx1.swap(bestDF);
+    return 2;
+  }
+  return 1;
+}
 }  // namespace optimization
 }  // namespace stan
 
@@ -0,0 +1,241 @@
+#ifndef STAN_OPTIMIZATION_BOUNDED_LBFGS_HPP
+#define STAN_OPTIMIZATION_BOUNDED_LBFGS_HPP
+
+#include <stan/optimization/bfgs.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace optimization {
+
+/**
+ * Minimize an objective subject to lower and upper bounds on each
+ * variable with a projected L-BFGS method in the spirit of L-BFGS-B.
+ *
+ * Each iteration splits the variables into an active set, those held
+ * at a bound by a gradient pushing them out of the box, and the free
+ * variables. The search direction is the L-BFGS direction of the
+ * gradient restricted to the free variables, restricted to the free
+ * variables again, and the step backtracks along the projection of
+ * that direction onto the box until the objective decreases
+ * sufficiently. Variables can therefore land exactly on their bounds
+ * and leave them again, instead of approaching them through a
+ * transform whose conditioning degrades near the bound. The active set
+ * is kept as a list of indices, as it is usually small.
+ *
+ * The functor must provide <code>int operator()(const VectorT &x,
+ * Scalar &f, VectorT &g)</code>, as for <code>BFGSMinimizer</code>.
+ * Infinite bounds leave a variable unbounded on that side.
+ *
+ * @tparam FunctorType type of the objective
+ */
+template <typename FunctorType, typename Scalar = double,
+          int DimAtCompile = Eigen::Dynamic>
+class BoundedLBFGSMinimizer {
+ public:
+  typedef Eigen::Matrix<Scalar, DimAtCompile, 1> VectorT;
+  typedef LBFGSUpdate<Scalar, DimAtCompile> QNUpdateType;
+
+  LSOptions<Scalar> _ls_opts;
+  ConvergenceOptions<Scalar> _conv_opts;
+
+  /**
+   * Construct a minimizer of the specified objective within the
+   * specified bounds.
+   *
+   * @param f objective
+   * @param lower lower bounds
+   * @param upper upper bounds
+   * @throw std::invalid_argument if the bounds differ in size or a
+   * lower bound is above its upper bound
+   */
+  BoundedLBFGSMinimizer(FunctorType &f, const VectorT &lower,
+                        const VectorT &upper)
+      : _func(f), _lower(lower), _upper(upper) {
+    if (lower.size() != upper.size())
+      throw std::invalid_argument(
+          "Bounded L-BFGS: lower and upper bounds differ in size");
+    if ((lower.array() > upper.array()).any())
+      throw std::invalid_argument(
+          "Bounded L-BFGS: lower bound above upper bound");
+  }
+
+  QNUpdateType &get_qnupdate() { return _qn; }
+  const QNUpdateType &get_qnupdate() const { return _qn; }
+
+  const Scalar &curr_f() const { return _fk; }
+  const VectorT &curr_x() const { return _xk; }
+  const VectorT &curr_g() const { return _gk; }
+  const Scalar &prev_f() const { return _fk_1; }
+  const Scalar &alpha() const { return _alpha; }
+  size_t iter_num() const { return _itNum; }
+  const std::string &note() const { return _note; }
+
+  /**
+   * Return the indices of the variables in the active set.
+   */
+  const std::vector<Eigen::Index> &active() const { return _active; }
+
+  /**
+   * Return the infinity norm of the projected gradient, the step to the
+   * projection of <code>x - g</code> onto the box, which is zero at a
+   * solution.
+   */
+  Scalar proj_grad_norm() const {
+    return (project(_xk - _gk) - _xk).template lpNorm<Eigen::Infinity>();
+  }
+
+  static std::string get_code_string(int retCode) {
+    return BFGSMinimizer<FunctorType, QNUpdateType, Scalar,
+                         DimAtCompile>::get_code_string(retCode);
+  }
+
+  /**
+   * Project the specified point onto the box.
+   */
+  VectorT project(const VectorT &x) const {
+    return x.cwiseMax(_lower).cwiseMin(_upper);
+  }
+
+  /**
+   * Start the iterations at the projection of the specified point onto
+   * the box.
+   *
+   * @param x0 initial point
+   * @throw std::invalid_argument if the point doesn't match the bounds
+   * @throw std::runtime_error if the objective can't be evaluated
+   */
+  void initialize(const VectorT &x0) {
+    if (x0.size() != _lower.size())
+      throw std::invalid_argument(
+          "Bounded L-BFGS: initial point doesn't match the bounds");
+    _xk = project(x0);
+    if (_func(_xk, _fk, _gk))
+      throw std::runtime_error("Error evaluating initial BFGS point.");
+    _fk_1 = _fk;
+    _alpha = 0;
+    _itNum = 0;
+    _note = "";
+    _reset = true;
+    update_active_set();
+  }
+
+  int step() {
+    _itNum++;
+    _note = "";
+
+    VectorT pk, xk_1, gk_1;
+    Scalar fk_1;
+    bool found = false;
+    while (!found) {
+      // Direction on the free variables
+      VectorT g_free = _gk;
+      for (Eigen::Index i : _active)
+        g_free(i) = 0;
+      if (_reset) {
+        pk = -g_free;
+      } else {
+        _qn.search_direction(pk, g_free);
+        for (Eigen::Index i : _active)
+          pk(i) = 0;
+        if (!(pk.dot(_gk) < 0)) {
+          pk = -g_free;
+          _reset = true;
+          _note += "Hessian reset";
+        }
+      }
+      if (pk.squaredNorm() == 0)
+        return TERM_ABSGRAD;
+
+      // Backtrack along the projected path
+      _alpha = _reset ? std::min(Scalar(1), 1 / pk.norm()) : Scalar(1);
+      for (int its = 0; its < _ls_opts.maxLSIts; ++its, _alpha /= 2) {
+        xk_1 = project(_xk + _alpha * pk);
+        if ((xk_1 - _xk).squaredNorm() == 0)
+          break;
+        if (_func(xk_1, fk_1, gk_1))
+          continue;
+        if (fk_1 <= _fk + _ls_opts.c1 * _gk.dot(xk_1 - _xk)) {
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        if (_reset)
+          return TERM_LSFAIL;
+        _reset = true;
+        _note += "LS failed, Hessian reset";
+      }
+    }
+
+    VectorT sk = xk_1 - _xk;
+    VectorT yk = gk_1 - _gk;
+    const Scalar eps = std::numeric_limits<Scalar>::epsilon();
+    if (sk.dot(yk) > eps * yk.squaredNorm()) {
+      _qn.update(yk, sk, _reset);
+      _reset = false;
+    } else if (!_reset) {
+      _note += "Curvature pair skipped";
+    }
+
+    _fk_1 = _fk;
+    _fk = fk_1;
+    _xk.swap(xk_1);
+    _gk.swap(gk_1);
+    update_active_set();
+
+    if (std::fabs(_fk_1 - _fk) < _conv_opts.tolAbsF)
+      return TERM_ABSF;
+    if (proj_grad_norm() < _conv_opts.tolAbsGrad)
+      return TERM_ABSGRAD;
+    if (sk.norm() < _conv_opts.tolAbsX)
+      return TERM_ABSX;
+    if (_itNum >= _conv_opts.maxIts)
+      return TERM_MAXIT;
+    if (std::fabs(_fk_1 - _fk)
+            / std::max(std::fabs(_fk_1),
+                       std::max(std::fabs(_fk), _conv_opts.fScale))
+        < _conv_opts.tolRelF * std::numeric_limits<Scalar>::epsilon())
+      return TERM_RELF;
+    return TERM_SUCCESS;
+  }
+
+  int minimize(VectorT &x0) {
+    int retcode;
+    initialize(x0);
+    while (!(retcode = step()))
+      continue;
+    x0 = _xk;
+    return retcode;
+  }
+
+ protected:
+  FunctorType &_func;
+  VectorT _lower, _upper;
+  QNUpdateType _qn;
+  VectorT _xk, _gk;
+  Scalar _fk, _fk_1, _alpha;
+  size_t _itNum;
+  std::string _note;
+  // Whether the quasi-Newton approximation is to be reset
+  bool _reset;
+  std::vector<Eigen::Index> _active;
+
+  void update_active_set() {
+    _active.clear();
+    for (Eigen::Index i = 0; i < _xk.size(); ++i)
+      if ((_xk(i) <= _lower(i) && _gk(i) > 0)
+          || (_xk(i) >= _upper(i) && _gk(i) < 0))
+        _active.push_back(i);
+  }
+};
+
+}  // namespace optimization
+}  // namespace stan
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef STAN_OPTIMIZATION_COMPACT_LBFGS_UPDATE_HPP
+#define STAN_OPTIMIZATION_COMPACT_LBFGS_UPDATE_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <algorithm>
+#include <cstddef>
+
+namespace stan {
+namespace optimization {
+/**
+ * Implement a limited memory version of the BFGS update using the
+ * compact representation of the inverse Hessian approximation of
+ * Byrd, Nocedal and Schnabel (1994).  It computes the same search
+ * directions as <code>LBFGSUpdate</code> and can be used in its place.
+ *
+ * The update vectors are stored in the columns of a single matrix,
+ * used as a ring buffer, along with the inner products of the update
+ * vectors with each other.  A search direction then takes one product
+ * of the transposed history with the gradient, a few triangular solves
+ * of the size of the history, and one product of the history with the
+ * result, so that the history is streamed from memory twice instead of
+ * once per update vector.  All scratch space is kept between calls.
+ **/
+template <typename Scalar = double, int DimAtCompile = Eigen::Dynamic>
+class CompactLBFGSUpdate {
+ public:
+  typedef Eigen::Matrix<Scalar, DimAtCompile, 1> VectorT;
+  typedef Eigen::Matrix<Scalar, DimAtCompile, DimAtCompile> HessianT;
+  typedef Eigen::Matrix<Scalar, DimAtCompile, Eigen::Dynamic> HistoryT;
+
+  explicit CompactLBFGSUpdate(size_t L = 5)
+      : _L(L), _head(0), _size(0), _gammak(1) {}
+
+  /**
+   * Set the number of inverse Hessian updates to keep, keeping the most
+   * recent updates if the history is shortened.
+   *
+   * @param L New size of buffer.
+   **/
+  void set_history_size(size_t L) {
+    if (L == _L)
+      return;
+    HistoryT S, Y;
+    history(S, Y);
+    const size_t size = _size;
+    const size_t keep = std::min(size, L);
+    _L = L;
+    clear();
+    for (size_t i = size - keep; i < size; ++i)
+      push(Y.col(i), S.col(i));
+  }
+
+  /**
+   * Add a new set of update vectors to the history.
+   *
+   * @param yk Difference between the current and previous gradient vector.
+   * @param sk Difference between the current and previous state vector.
+   * @param reset Whether to reset the approximation, forgetting about
+   * previous values.
+   * @return In the case of a reset, returns the optimal scaling of the
+   * initial Hessian
+   * approximation which is useful for predicting step-sizes.
+   **/
+  inline Scalar update(const VectorT &yk, const VectorT &sk,
+                       bool reset = false) {
+    Scalar skyk = yk.dot(sk);
+
+    Scalar B0fact;
+    if (reset) {
+      B0fact = yk.squaredNorm() / skyk;
+      clear();
+    } else {
+      B0fact = 1.0;
+    }
+
+    _gammak = skyk / yk.squaredNorm();
+    push(yk, sk);
+
+    return B0fact;
+  }
+
+  /**
+   * Compute the search direction based on the current (inverse) Hessian
+   * approximation and given gradient.
+   *
+   * @param[out] pk The negative product of the inverse Hessian and gradient
+   * direction gk.
+   * @param[in] gk Gradient direction.
+   **/
+  inline void search_direction(VectorT &pk, const VectorT &gk) const {
+    pk.noalias() = -_gammak * gk;
+    const Eigen::Index m = _size;
+    if (m == 0)
+      return;
+    const Eigen::Index L = _L;
+
+    // S' g and Y' g in one pass over the history
+    _wg.noalias() = _W.transpose() * gk;
+
+    // Gather the small matrices in order from oldest to newest update
+    _a.resize(m);
+    _b.resize(m);
+    _R.setZero(m, m);
+    _YYc.resize(m, m);
+    for (Eigen::Index j = 0; j < m; ++j) {
+      const Eigen::Index pj = slot(j);
+      _a(j) = _wg(pj);
+      _b(j) = _wg(L + pj);
+      for (Eigen::Index i = 0; i < m; ++i) {
+        const Eigen::Index pi = slot(i);
+        if (i <= j)
+          _R(i, j) = _SY(pi, pj);
+        _YYc(i, j) = _YY(pi, pj);
+      }
+    }
+
+    // H g = gamma g + S u - gamma Y r, with r = R^-1 S' g and
+    // u = R^-T ((D + gamma Y'Y) r - gamma Y' g)
+    _r = _R.template triangularView<Eigen::Upper>().solve(_a);
+    _u.noalias() = _gammak * (_YYc * _r - _b);
+    _u.array() += _R.diagonal().array() * _r.array();
+    _R.template triangularView<Eigen::Upper>().transpose().solveInPlace(_u);
+
+    _c.setZero(2 * L);
+    for (Eigen::Index i = 0; i < m; ++i) {
+      const Eigen::Index pi = slot(i);
+      _c(pi) = _u(i);
+      _c(L + pi) = -_gammak * _r(i);
+    }
+    pk.noalias() -= _W * _c;
+  }
+
+  /**
+   * Return the number of updates in the history.
+   */
+  size_t history_size() const { return _size; }
+
+  /**
+   * Return the scaling of the initial inverse Hessian approximation.
+   */
+  Scalar gammak() const { return _gammak; }
+
+  /**
+   * Copy the update vectors in the history, from oldest to newest, into
+   * the columns of the specified matrices.
+   *
+   * @param[out] S Differences between successive state vectors.
+   * @param[out] Y Differences between successive gradient vectors.
+   **/
+  void history(HistoryT &S, HistoryT &Y) const {
+    S.resize(_W.rows(), _size);
+    Y.resize(_W.rows(), _size);
+    for (size_t i = 0; i < _size; ++i) {
+      S.col(i) = _W.col(slot(i));
+      Y.col(i) = _W.col(_L + slot(i));
+    }
+  }
+
+  /**
+   * Replace the history with the specified update vectors, from oldest
+   * to newest, and scaling of the initial inverse Hessian
+   * approximation, as returned by <code>history()</code> and
+   * <code>gammak()</code>, keeping the most recent updates if there are
+   * more than the history size.
+   *
+   * @param S Differences between successive state vectors.
+   * @param Y Differences between successive gradient vectors.
+   * @param gammak Scaling of the initial inverse Hessian approximation.
+   **/
+  void restore(const HistoryT &S, const HistoryT &Y, Scalar gammak) {
+    clear();
+    for (Eigen::Index i = 0; i < S.cols(); ++i)
+      push(Y.col(i), S.col(i));
+    _gammak = gammak;
+  }
+
+ protected:
+  typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> ScratchVectorT;
+  typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> ScratchMatrixT;
+
+  size_t _L;
+  // Slot of the oldest update and number of updates
+  size_t _head;
+  size_t _size;
+  Scalar _gammak;
+  // Columns [0, L) hold the s vectors and [L, 2L) the y vectors
+  HistoryT _W;
+  // s_i' y_j and y_i' y_j by slot
+  ScratchMatrixT _SY;
+  ScratchMatrixT _YY;
+
+  mutable ScratchVectorT _wg, _a, _b, _r, _u, _c;
+  mutable ScratchMatrixT _R, _YYc;
+
+  /**
+   * Return the slot of the i-th oldest update.
+   */
+  size_t slot(size_t i) const { return (_head + i) % _L; }
+
+  void clear() {
+    _W.resize(0, 0);
+    _head = 0;
+    _size = 0;
+  }
+
+  void push(const VectorT &yk, const VectorT &sk) {
+    if (_L == 0)
+      return;
+    const Eigen::Index L = _L;
+    if (_W.rows() != yk.size() || _W.cols() != 2 * L) {
+      _W.setZero(yk.size(), 2 * L);
+      _SY.setZero(L, L);
+      _YY.setZero(L, L);
+      _head = 0;
+      _size = 0;
+    }
+    size_t k;
+    if (_size < _L) {
+      k = slot(_size);
+      ++_size;
+    } else {
+      k = _head;
+      _head = (_head + 1) % _L;
+    }
+    _W.col(k) = sk;
+    _W.col(L + k) = yk;
+
+    // Unused slots are zero, so their products are too
+    _wg.noalias() = _W.transpose() * yk;
+    _SY.col(k) = _wg.head(L);
+    _YY.col(k) = _wg.tail(L);
+    _YY.row(k) = _wg.tail(L).transpose();
+    _SY.row(k).noalias() = sk.transpose() * _W.rightCols(L);
+  }
+};
+}  // namespace optimization
+}  // namespace stan
+
+#endif
@@ -18,10 +18,11 @@ class LBFGSUpdate {
  public:
   typedef Eigen::Matrix<Scalar, DimAtCompile, 1> VectorT;
   typedef Eigen::Matrix<Scalar, DimAtCompile, DimAtCompile> HessianT;
+  typedef Eigen::Matrix<Scalar, DimAtCompile, Eigen::Dynamic> HistoryT;
   // NOLINTNEXTLINE(build/include_what_you_use)
   typedef std::tuple<Scalar, VectorT, VectorT> UpdateT;
 
-  explicit LBFGSUpdate(size_t L = 5) : _buf(L) {}
+  explicit LBFGSUpdate(size_t L = 5) : _buf(L), _gammak(1) {}
 
   /**
    * Set the number of inverse Hessian updates to keep.
@@ -102,6 +103,52 @@ class LBFGSUpdate {
     }
   }
 
+  /**
+   * Return the number of updates in the history.
+   */
+  size_t history_size() const { return _buf.size(); }
+
+  /**
+   * Return the scaling of the initial inverse Hessian approximation.
+   */
+  Scalar gammak() const { return _gammak; }
+
+  /**
+   * Copy the update vectors in the history, from oldest to newest, into
+   * the columns of the specified matrices.
+   *
+   * @param[out] S Differences between successive state vectors.
+   * @param[out] Y Differences between successive gradient vectors.
+   **/
+  void history(HistoryT &S, HistoryT &Y) const {
+    const Eigen::Index d = _buf.empty() ? 0 : std::get<1>(_buf.front()).size();
+    S.resize(d, _buf.size());
+    Y.resize(d, _buf.size());
+    for (size_t i = 0; i < _buf.size(); ++i) {
+      Y.col(i) = std::get<1>(_buf[i]);
+      S.col(i) = std::get<2>(_buf[i]);
+    }
+  }
+
+  /**
+   * Replace the history with the specified update vectors, from oldest
+   * to newest, and scaling of the initial inverse Hessian
+   * approximation, as returned by <code>history()</code> and
+   * <code>gammak()</code>, keeping the most recent updates if there are
+   * more than the history size.
+   *
+   * @param S Differences between successive state vectors.
+   * @param Y Differences between successive gradient vectors.
+   * @param gammak Scaling of the initial inverse Hessian approximation.
+   **/
+  void restore(const HistoryT &S, const HistoryT &Y, Scalar gammak) {
+    _buf.clear();
+    for (Eigen::Index i = 0; i < S.cols(); ++i)
+      _buf.push_back(
+          UpdateT(1.0 / Y.col(i).dot(S.col(i)), Y.col(i), S.col(i)));
+    _gammak = gammak;
+  }
+
  protected:
   boost::circular_buffer<UpdateT> _buf;
   Scalar _gammak;
@@ -31,17 +31,11 @@ double newton_step(M& model, std::vector<double>& params_r,
                    std::vector<int>& params_i,
                    std::ostream* output_stream = 0) {
   std::vector<double> gradient;
-  std::vector<double> hessian;
-
+  vector_d g;
+  matrix_d H;
   double f0 = stan::model::grad_hess_log_prob<true, false>(
-      model, params_r, params_i, gradient, hessian);
-  matrix_d H(params_r.size(), params_r.size());
-  for (size_t i = 0; i < hessian.size(); i++) {
-    H(i) = hessian[i];
-  }
-  vector_d g(params_r.size());
-  for (size_t i = 0; i < gradient.size(); i++)
-    g(i) = gradient[i];
+      model, vector_d(Eigen::Map<vector_d>(params_r.data(), params_r.size())),
+      g, H, true);
   make_negative_definite_and_solve(H, g);
   //         H.ldlt().solveInPlace(g);
 
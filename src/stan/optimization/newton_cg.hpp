@@ -0,0 +1,108 @@
+#ifndef STAN_OPTIMIZATION_NEWTON_CG_HPP
+#define STAN_OPTIMIZATION_NEWTON_CG_HPP
+
+#include <stan/math/mix.hpp>
+#include <stan/model/log_prob_grad.hpp>
+#include <stan/model/model_functional.hpp>
+#include <stan/optimization/newton.hpp>
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+namespace stan {
+namespace optimization {
+
+/**
+ * Take one truncated Newton step from the specified point, increasing
+ * the log density without forming its Hessian.
+ *
+ * The Newton direction is found by running conjugate gradients on the
+ * negated Hessian, which is only touched through Hessian-vector
+ * products, until the residual is small relative to the gradient, as
+ * in Algorithm 7.1 of Nocedal and Wright (2006), Numerical
+ * Optimization. If a direction of non-negative curvature is met, the
+ * iterations stop and the direction found so far is used, or the
+ * gradient if there is none yet, so the step always points uphill.
+ * The step length is then halved until the log density increases, as
+ * <code>newton_step()</code> does. The memory used is linear in the
+ * number of parameters.
+ *
+ * @tparam M type of model
+ * @param[in] model model
+ * @param[in, out] params_r unconstrained parameters, replaced by the
+ * new point if the log density could be increased
+ * @param[in] params_i integer parameters
+ * @param[in] max_cg_iterations maximum number of conjugate gradient
+ * iterations, or the number of parameters if not positive
+ * @param[in, out] output_stream stream for print statements in the
+ * model
+ * @return log density at the new point, or at the original point if
+ * it couldn't be increased
+ */
+template <typename M>
+double newton_cg_step(M& model, std::vector<double>& params_r,
+                      std::vector<int>& params_i, int max_cg_iterations = 0,
+                      std::ostream* output_stream = 0) {
+  const size_t d = params_r.size();
+  std::vector<double> gradient;
+  double f0 = stan::model::log_prob_grad<true, false>(
+      model, params_r, params_i, gradient, output_stream);
+  vector_d x = Eigen::Map<vector_d>(params_r.data(), d);
+  vector_d g = Eigen::Map<vector_d>(gradient.data(), d);
+  if (max_cg_iterations <= 0)
+    max_cg_iterations = d;
+
+  // Solve -H p = g by conjugate gradients
+  const double g_norm = g.norm();
+  const double tol = std::min(0.5, std::sqrt(g_norm)) * g_norm;
+  stan::model::model_functional<M, false> functional(model, output_stream);
+  vector_d p = vector_d::Zero(d);
+  vector_d r = g;
+  vector_d v = r;
+  vector_d Hv;
+  double f;
+  double rr = r.squaredNorm();
+  for (int j = 0; j < max_cg_iterations && std::sqrt(rr) > tol; ++j) {
+    stan::math::hessian_times_vector(functional, x, v, f, Hv);
+    double curvature = -v.dot(Hv);
+    if (!(curvature > 0)) {
+      if (j == 0)
+        p = g;
+      break;
+    }
+    double alpha = rr / curvature;
+    p += alpha * v;
+    r += alpha * Hv;
+    double rr_new = r.squaredNorm();
+    v = r + (rr_new / rr) * v;
+    rr = rr_new;
+  }
+
+  std::vector<double> new_params_r(d);
+  double step_size = 2;
+  double min_step_size = 1e-50;
+  double f1 = -1e100;
+
+  while (f1 < f0) {
+    step_size *= 0.5;
+    if (step_size < min_step_size)
+      return f0;
+
+    for (size_t i = 0; i < d; i++)
+      new_params_r[i] = params_r[i] + step_size * p[i];
+    try {
+      f1 = stan::model::log_prob_grad<true, false>(model, new_params_r,
+                                                   params_i, gradient);
+    } catch (std::exception& e) {
+      f1 = -1e100;
+    }
+  }
+  params_r.swap(new_params_r);
+
+  return f1;
+}
+
+}  // namespace optimization
+}  // namespace stan
+#endif
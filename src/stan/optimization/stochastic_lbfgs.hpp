@@ -0,0 +1,391 @@
+#ifndef STAN_OPTIMIZATION_STOCHASTIC_LBFGS_HPP
+#define STAN_OPTIMIZATION_STOCHASTIC_LBFGS_HPP
+
+#include <stan/math/rev.hpp>
+#include <stan/optimization/bfgs.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace optimization {
+
+template <typename Scalar = double>
+class StochasticOptions {
+ public:
+  StochasticOptions() {
+    batchSize = 1000;
+    overlap = 0.25;
+    stepSize = 1.0;
+    minStepSize = 1e-10;
+    minCurvature = 1e-8;
+    maxEpochs = 10;
+  }
+  size_t batchSize;
+  Scalar overlap;
+  Scalar stepSize;
+  Scalar minStepSize;
+  Scalar minCurvature;
+  Scalar maxEpochs;
+};
+
+/**
+ * Minimize an objective that is a sum over rows of data, such as the
+ * negative log density of a model with a large data set, with L-BFGS
+ * steps on gradients estimated from mini-batches of rows, following
+ * the multi-batch L-BFGS method of Berahas, Nocedal and Takac (2016).
+ *
+ * Consecutive batches share a fraction of their rows, and the curvature
+ * pairs fed to the quasi-Newton update difference the gradients of only
+ * the shared rows, so that the pairs are not swamped by the noise of
+ * the batch gradients. The gradient of a batch is assembled from the
+ * gradients of its shared and fresh parts, so every row of a batch is
+ * evaluated once. Fresh rows are drawn without replacement from a
+ * permutation of the rows that is redrawn every epoch. Steps have a
+ * fixed length, which is halved whenever the objective can't be
+ * evaluated at the new point; pairs without enough positive curvature
+ * are skipped.
+ *
+ * The functor must provide
+ *
+ * <code>int operator()(const VectorT &x, const std::vector<size_t>
+ * &rows, Scalar &f, VectorT &g)</code>
+ *
+ * which sets <code>f</code> and <code>g</code> to an unbiased estimate
+ * of the objective and its gradient from the specified rows, that is
+ * the terms that don't depend on the data plus the sum of the terms of
+ * the rows scaled by the number of rows over the number of specified
+ * rows, and returns zero on success. Once the stochastic iterations
+ * are done, the estimate can be polished by a full-batch
+ * <code>BFGSMinimizer</code> through <code>FullBatchFunctor</code>.
+ *
+ * @tparam FunctorType type of the objective
+ * @tparam QNUpdateType type of the quasi-Newton update
+ */
+template <typename FunctorType, typename QNUpdateType = LBFGSUpdate<>,
+          typename Scalar = double, int DimAtCompile = Eigen::Dynamic>
+class StochasticLBFGS {
+ public:
+  typedef Eigen::Matrix<Scalar, DimAtCompile, 1> VectorT;
+
+  StochasticOptions<Scalar> _opts;
+
+  /**
+   * Construct a minimizer of the specified objective.
+   *
+   * @param f objective
+   * @param num_rows number of rows of data
+   * @throw std::invalid_argument if there are no rows
+   */
+  StochasticLBFGS(FunctorType &f, size_t num_rows)
+      : _func(f), _num_rows(num_rows) {
+    if (num_rows == 0)
+      throw std::invalid_argument("Stochastic L-BFGS needs at least one row");
+  }
+
+  QNUpdateType &get_qnupdate() { return _qn; }
+  const QNUpdateType &get_qnupdate() const { return _qn; }
+
+  const Scalar &curr_f() const { return _fk; }
+  const VectorT &curr_x() const { return _xk; }
+  const VectorT &curr_g() const { return _gk; }
+  size_t iter_num() const { return _itNum; }
+  const std::string &note() const { return _note; }
+
+  /**
+   * Return the step length used for the next step.
+   */
+  Scalar step_size() const { return _alpha; }
+
+  /**
+   * Return the number of passes through the data made so far.
+   */
+  Scalar epochs() const { return static_cast<Scalar>(_rowsDrawn) / _num_rows; }
+
+  /**
+   * Start the iterations at the specified point, evaluating the
+   * objective on the first batch.
+   *
+   * @param x0 initial point
+   * @param rng random number generator for drawing the batches
+   * @throw std::runtime_error if the objective can't be evaluated
+   */
+  template <class RNG>
+  void initialize(const VectorT &x0, RNG &rng) {
+    _xk = x0;
+    _itNum = 0;
+    _rowsDrawn = 0;
+    _hasPair = false;
+    _alpha = _opts.stepSize;
+    _note = "";
+    _perm.resize(_num_rows);
+    std::iota(_perm.begin(), _perm.end(), 0);
+    _permPos = _num_rows;
+    _overlapRows.clear();
+
+    VectorT g_old_overlap;
+    if (evaluate(_xk, rng, _fk, _gk, g_old_overlap))
+      throw std::runtime_error(
+          "Error evaluating initial stochastic L-BFGS point.");
+  }
+
+  /**
+   * Take a step along the quasi-Newton direction of the current batch
+   * gradient and evaluate the next batch at the new point.
+   *
+   * @param rng random number generator for drawing the batches
+   * @return <code>TERM_SUCCESS</code> while there are epochs left,
+   * <code>TERM_MAXIT</code> once they are used up, or
+   * <code>TERM_LSFAIL</code> if the step length has become too small
+   */
+  template <class RNG>
+  int step(RNG &rng) {
+    _itNum++;
+    _note = "";
+
+    if (_hasPair)
+      _qn.search_direction(_pk, _gk);
+    else
+      _pk = -_gk;
+
+    // The rows shared with the next batch and their gradient at x_k
+    std::vector<size_t> overlap_k = _overlapRows;
+    VectorT g_overlap_k = _gOverlap;
+
+    VectorT x_new = _xk + _alpha * _pk;
+    Scalar f_new;
+    VectorT g_new, g_overlap_new;
+    if (evaluate(x_new, rng, f_new, g_new, g_overlap_new)) {
+      // Keep the point and its batch and retry with a shorter step
+      _overlapRows = overlap_k;
+      _gOverlap = g_overlap_k;
+      _alpha /= 2;
+      _note = "Evaluation failed, step size halved";
+      return _alpha < _opts.minStepSize ? TERM_LSFAIL : TERM_SUCCESS;
+    }
+
+    if (!overlap_k.empty()) {
+      VectorT sk = x_new - _xk;
+      VectorT yk = g_overlap_new - g_overlap_k;
+      if (sk.dot(yk) > _opts.minCurvature * sk.squaredNorm()) {
+        _qn.update(yk, sk, !_hasPair);
+        _hasPair = true;
+      } else {
+        _note = "Curvature pair skipped";
+      }
+    }
+
+    _xk.swap(x_new);
+    _fk = f_new;
+    _gk.swap(g_new);
+
+    return epochs() >= _opts.maxEpochs ? TERM_MAXIT : TERM_SUCCESS;
+  }
+
+ protected:
+  FunctorType &_func;
+  QNUpdateType _qn;
+  size_t _num_rows;
+
+  Scalar _fk, _alpha;
+  VectorT _xk, _gk, _pk;
+  // Rows shared by the current batch and the next, and their gradient
+  // at the current point
+  std::vector<size_t> _overlapRows;
+  VectorT _gOverlap;
+
+  size_t _itNum;
+  size_t _rowsDrawn;
+  bool _hasPair;
+  std::string _note;
+
+  std::vector<size_t> _perm;
+  size_t _permPos;
+
+  template <class RNG>
+  size_t draw_row(RNG &rng) {
+    if (_permPos == _num_rows) {
+      for (size_t i = _num_rows - 1; i > 0; --i) {
+        boost::random::uniform_int_distribution<size_t> dist(0, i);
+        std::swap(_perm[i], _perm[dist(rng)]);
+      }
+      _permPos = 0;
+    }
+    ++_rowsDrawn;
+    return _perm[_permPos++];
+  }
+
+  /**
+   * Evaluate the objective and its gradient on a batch made of the rows
+   * shared with the previous batch and fresh rows, some of which are
+   * kept to be shared with the next batch.
+   *
+   * @param[out] g_old_overlap gradient of the rows shared with the
+   * previous batch
+   * @return zero on success
+   */
+  template <class RNG>
+  int evaluate(const VectorT &x, RNG &rng, Scalar &f, VectorT &g,
+               VectorT &g_old_overlap) {
+    const size_t batch_size
+        = std::max<size_t>(1, std::min(_opts.batchSize, _num_rows));
+    const size_t num_old = std::min(_overlapRows.size(), batch_size - 1);
+    size_t num_overlap = static_cast<size_t>(
+        std::round(_opts.overlap * static_cast<Scalar>(batch_size)));
+    num_overlap = std::min(num_overlap, batch_size - num_old);
+
+    std::vector<size_t> old_rows(_overlapRows.begin(),
+                                 _overlapRows.begin() + num_old);
+    std::vector<size_t> new_overlap(num_overlap);
+    std::vector<size_t> rest(batch_size - num_old - num_overlap);
+    for (size_t &row : new_overlap)
+      row = draw_row(rng);
+    for (size_t &row : rest)
+      row = draw_row(rng);
+
+    f = 0;
+    g.setZero(x.size());
+    Scalar f_part;
+    VectorT g_part;
+    auto add = [&](const std::vector<size_t> &rows, VectorT *g_rows) {
+      if (rows.empty())
+        return 0;
+      int ret = _func(x, rows, f_part, g_part);
+      if (ret)
+        return ret;
+      const Scalar weight = static_cast<Scalar>(rows.size()) / batch_size;
+      f += weight * f_part;
+      g += weight * g_part;
+      if (g_rows)
+        *g_rows = g_part;
+      return 0;
+    };
+    int ret = add(old_rows, &g_old_overlap);
+    if (!ret)
+      ret = add(new_overlap, &_gOverlap);
+    if (!ret)
+      ret = add(rest, 0);
+    if (ret)
+      return ret;
+    if (!std::isfinite(f) || !g.allFinite())
+      return 1;
+    _overlapRows.swap(new_overlap);
+    return 0;
+  }
+};
+
+/**
+ * Adapts a model whose log density can be estimated from rows of its
+ * data to the interface of <code>StochasticLBFGS</code>, which minimizes
+ * the negative log density. The model must provide
+ *
+ * ```
+ * template <bool propto, bool jacobian, typename T>
+ * T log_prob_rows(Eigen::Matrix<T, -1, 1>& params_r,
+ *                 const std::vector<size_t>& rows,
+ *                 std::ostream* msgs) const;
+ *
+ * size_t num_rows() const;
+ * ```
+ *
+ * where <code>log_prob_rows()</code> returns the terms of the log
+ * density that don't depend on the rows plus the terms of the specified
+ * rows scaled by <code>num_rows()</code> over their number, so that all
+ * rows give the log density.
+ *
+ * @tparam M type of model
+ * @tparam Jacobian whether to include the log Jacobian of the
+ * constraining transforms
+ */
+template <typename M, bool Jacobian = false>
+class ModelRowsAdaptor {
+ private:
+  struct functional {
+    const M &model;
+    const std::vector<size_t> &rows;
+    std::ostream *msgs;
+
+    template <typename T>
+    T operator()(const Eigen::Matrix<T, Eigen::Dynamic, 1> &x) const {
+      // log_prob_rows() requires non-const but doesn't modify its argument
+      return model.template log_prob_rows<true, Jacobian, T>(
+          const_cast<Eigen::Matrix<T, -1, 1> &>(x), rows, msgs);
+    }
+  };
+
+  M &_model;
+  std::ostream *_msgs;
+
+ public:
+  ModelRowsAdaptor(M &model, std::ostream *msgs) : _model(model), _msgs(msgs) {}
+
+  size_t num_rows() const { return _model.num_rows(); }
+
+  int operator()(const Eigen::Matrix<double, Eigen::Dynamic, 1> &x,
+                 const std::vector<size_t> &rows, double &f,
+                 Eigen::Matrix<double, Eigen::Dynamic, 1> &g) {
+    try {
+      stan::math::gradient(functional{_model, rows, _msgs}, x, f, g);
+    } catch (const std::exception &e) {
+      if (_msgs)
+        (*_msgs) << e.what() << std::endl;
+      return 1;
+    }
+    f = -f;
+    g = -g;
+    return 0;
+  }
+};
+
+/**
+ * Adapts an objective estimated from rows of data, as minimized by
+ * <code>StochasticLBFGS</code>, to the interface of the BFGS
+ * minimizers by evaluating it on all rows.
+ *
+ * @tparam FunctorType type of the objective
+ */
+template <typename FunctorType, typename Scalar = double,
+          int DimAtCompile = Eigen::Dynamic>
+class FullBatchFunctor {
+ public:
+  typedef Eigen::Matrix<Scalar, DimAtCompile, 1> VectorT;
+
+  FullBatchFunctor(FunctorType &f, size_t num_rows)
+      : _func(f), _rows(num_rows) {
+    std::iota(_rows.begin(), _rows.end(), 0);
+  }
+
+  int operator()(const VectorT &x, Scalar &f) {
+    VectorT g;
+    return (*this)(x, f, g);
+  }
+  int operator()(const VectorT &x, Scalar &f, VectorT &g) {
+    int ret = _func(x, _rows, f, g);
+    if (ret)
+      return ret;
+    if (!std::isfinite(f))
+      return 2;
+    if (!g.allFinite())
+      return 3;
+    return 0;
+  }
+  int df(const VectorT &x, VectorT &g) {
+    Scalar f;
+    return (*this)(x, f, g);
+  }
+
+ private:
+  FunctorType &_func;
+  std::vector<size_t> _rows;
+};
+
+}  // namespace optimization
+}  // namespace stan
+#endif
@@ -0,0 +1,256 @@
+#ifndef STAN_SERVICES_BATCH_BATCH_FIT_HPP
+#define STAN_SERVICES_BATCH_BATCH_FIT_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/model/model_base.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/chain_placement.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace batch {
+
+/**
+ * Constructs a model from its data, the seed of its transformed data and
+ * a stream for the messages of its constructor.
+ */
+using model_factory = std::function<std::unique_ptr<model::model_base>(
+    const io::var_context&, unsigned int, std::ostream*)>;
+
+/**
+ * Runs one chain of a job on its model, usually by calling a service
+ * with the writers of that chain, and returns the error code of the
+ * service.
+ */
+using chain_runner = std::function<int(model::model_base&, size_t)>;
+
+/**
+ * An independent fit of a batch: a model, its data and the chains to
+ * run on it.
+ */
+struct batch_job {
+  // Name of the factory of the model
+  std::string model;
+  // Data of the model, which must outlive the batch
+  const io::var_context* data;
+  // Seed of the transformed data block
+  unsigned int seed;
+  // Number of chains of the fit
+  size_t num_chains;
+  // Runs each chain of the fit
+  chain_runner run_chain;
+
+  batch_job() : data(nullptr), seed(0), num_chains(1) {}
+};
+
+/**
+ * Receives the progress of the jobs of a batch. Calls are serialized,
+ * but come from any of the threads running the batch.
+ */
+class batch_status {
+ public:
+  virtual ~batch_status() {}
+
+  /**
+   * Called when the first chain of a job starts.
+   *
+   * @param job index of the job
+   */
+  virtual void started(size_t job) {}
+
+  /**
+   * Called when the last chain of a job ends.
+   *
+   * @param job index of the job
+   * @param return_code <code>error_codes::OK</code> if every chain
+   *   succeeded, otherwise the error code of a failed chain
+   * @param message why the job failed, or an empty string
+   */
+  virtual void finished(size_t job, int return_code,
+                        const std::string& message) {}
+};
+
+namespace internal {
+
+/**
+ * A model shared by the jobs with the same factory, data and seed,
+ * constructed by the first chain that needs it and destroyed once the
+ * last chain using it ends.
+ */
+struct shared_model {
+  std::once_flag constructed;
+  std::unique_ptr<model::model_base> model;
+  std::string error;
+  std::atomic<size_t> chains_left;
+
+  shared_model() : chains_left(0) {}
+};
+
+/**
+ * Progress of a job.
+ */
+struct job_progress {
+  std::atomic<bool> started;
+  std::atomic<size_t> chains_left;
+  int return_code;
+  std::string message;
+
+  job_progress() : started(false), chains_left(0), return_code(0) {}
+};
+
+}  // namespace internal
+
+/**
+ * Runs a batch of independent fits in one process, as an alternative to
+ * a process per fit for many small fits.
+ *
+ * Every chain of every job is a task of the TBB thread pool, whose idle
+ * threads steal the waiting tasks, so a job with a long chain doesn't
+ * hold up the others and the threads are kept busy until the last chain
+ * ends. The chains are started in the order of the jobs. Jobs with the
+ * same model, data and seed share one instance of the model, which is
+ * constructed by the first of their chains to run and released when the
+ * last one ends, so at most the models of the running jobs are held in
+ * memory. The output of each chain goes to the writers its runner gives
+ * the service it calls.
+ *
+ * A job fails with <code>error_codes::CONFIG</code> if its factory is
+ * unknown or its model can't be constructed, and with
+ * <code>error_codes::SOFTWARE</code> if a chain throws; otherwise its
+ * error code is the first nonzero code returned by its chains. A failed
+ * job doesn't stop the others.
+ *
+ * @param[in] factories factory of each model, by name
+ * @param[in] jobs jobs of the batch
+ * @param[in,out] logger logger for the messages of the model
+ *   constructors and the failures of the jobs
+ * @param[in,out] status receives the progress of each job
+ * @param[in] placement placement of the threads running the chains, or
+ *   a null pointer to leave them unpinned
+ * @return <code>error_codes::OK</code> if every job succeeded, otherwise
+ *   the error code of a failed job
+ */
+inline int batch_fit(const std::map<std::string, model_factory>& factories,
+                     const std::vector<batch_job>& jobs,
+                     callbacks::logger& logger, batch_status& status,
+                     const util::chain_placement* placement = nullptr) {
+  using model_key = std::tuple<std::string, const io::var_context*,
+                               unsigned int>;
+  std::map<model_key, internal::shared_model> models;
+  std::vector<internal::shared_model*> job_models(jobs.size());
+  std::vector<internal::job_progress> progress(jobs.size());
+  std::vector<std::pair<size_t, size_t>> chains;
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    internal::shared_model& shared = models[model_key(
+        jobs[j].model, jobs[j].data, jobs[j].seed)];
+    shared.chains_left += jobs[j].num_chains;
+    job_models[j] = &shared;
+    progress[j].chains_left = jobs[j].num_chains;
+    for (size_t c = 0; c < jobs[j].num_chains; ++c)
+      chains.emplace_back(j, c);
+  }
+
+  std::mutex status_mutex;
+  auto finish_job = [&](size_t j) {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    if (progress[j].return_code != error_codes::OK)
+      logger.error("Job " + std::to_string(j)
+                   + " failed: " + progress[j].message);
+    status.finished(j, progress[j].return_code, progress[j].message);
+  };
+  auto fail_chain = [&](size_t j, int code, const std::string& message) {
+    std::lock_guard<std::mutex> lock(status_mutex);
+    if (progress[j].return_code == error_codes::OK) {
+      progress[j].return_code = code;
+      progress[j].message = message;
+    }
+  };
+
+  // Jobs without chains are done at once
+  for (size_t j = 0; j < jobs.size(); ++j)
+    if (jobs[j].num_chains == 0)
+      finish_job(j);
+
+  auto run = [&](size_t j, size_t c) {
+    const batch_job& job = jobs[j];
+    internal::shared_model& shared = *job_models[j];
+    if (!progress[j].started.exchange(true)) {
+      std::lock_guard<std::mutex> lock(status_mutex);
+      status.started(j);
+    }
+    std::call_once(shared.constructed, [&]() {
+      auto factory = factories.find(job.model);
+      if (factory == factories.end()) {
+        shared.error = "unknown model " + job.model;
+        return;
+      }
+      if (!job.data) {
+        shared.error = "no data for model " + job.model;
+        return;
+      }
+      std::stringstream msg;
+      try {
+        shared.model = factory->second(*job.data, job.seed, &msg);
+      } catch (const std::exception& e) {
+        shared.error = e.what();
+      }
+      std::lock_guard<std::mutex> lock(status_mutex);
+      if (msg.str().length() > 0)
+        logger.info(msg);
+    });
+    if (!shared.model) {
+      fail_chain(j, error_codes::CONFIG,
+                 shared.error.empty() ? "model could not be constructed"
+                                      : shared.error);
+    } else {
+      try {
+        int code = job.run_chain(*shared.model, c);
+        if (code != error_codes::OK)
+          fail_chain(j, code,
+                     "chain " + std::to_string(c) + " returned error code "
+                         + std::to_string(code));
+      } catch (const std::exception& e) {
+        fail_chain(j, error_codes::SOFTWARE,
+                   "chain " + std::to_string(c) + " threw: " + e.what());
+      }
+    }
+    if (--shared.chains_left == 0)
+      shared.model.reset();
+    if (--progress[j].chains_left == 0)
+      finish_job(j);
+  };
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, chains.size(), 1),
+      [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          util::chain_placement::scope pin(placement, i);
+          run(chains[i].first, chains[i].second);
+        }
+      },
+      tbb::simple_partitioner());
+
+  for (const internal::job_progress& job : progress)
+    if (job.return_code != error_codes::OK)
+      return job.return_code;
+  return error_codes::OK;
+}
+
+}  // namespace batch
+}  // namespace services
+}  // namespace stan
+#endif
@@ -69,6 +69,38 @@ struct error {
   static double default_value() { return 1e-6; }
 };
 
+/**
+ * Number of timed evaluations of each kind in the gradient benchmark.
+ */
+struct num_evals {
+  /**
+   * Return the string description of num_evals.
+   *
+   * @return description
+   */
+  static std::string description() {
+    return "Number of timed evaluations of the log density and gradient.";
+  }
+
+  /**
+   * Validates num_evals; num_evals must be greater than 0.
+   *
+   * @param[in] num_evals argument to validate
+   * @throw std::invalid_argument unless num_evals is greater than zero
+   */
+  static void validate(int num_evals) {
+    if (!(num_evals > 0))
+      throw std::invalid_argument("num_evals must be greater than 0.");
+  }
+
+  /**
+   * Return the default num_evals value.
+   *
+   * @return 1000
+   */
+  static int default_value() { return 1000; }
+};
+
 }  // namespace diagnose
 }  // namespace services
 }  // namespace stan
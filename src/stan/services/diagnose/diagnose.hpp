@@ -5,9 +5,13 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/io/var_context.hpp>
+#include <stan/model/benchmark_gradients.hpp>
 #include <stan/model/test_gradients.hpp>
 #include <stan/services/util/create_rng.hpp>
 #include <stan/services/util/initialize.hpp>
+#include <iomanip>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace stan {
@@ -43,7 +47,7 @@ int diagnose(Model& model, const stan::io::var_context& init,
              double epsilon, double error, callbacks::interrupt& interrupt,
              callbacks::logger& logger, callbacks::writer& init_writer,
              callbacks::writer& parameter_writer) {
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+  stan::rng_t rng = util::create_rng(random_seed, chain);
 
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize(
@@ -52,12 +56,108 @@ int diagnose(Model& model, const stan::io::var_context& init,
   logger.info("TEST GRADIENT MODE");
 
   int num_failed = stan::model::test_gradients<true, true>(
-      model, cont_vector, disc_vector, epsilon, error, interrupt, logger,
-      parameter_writer);
+      model, cont_vector, disc_vector, epsilon, error, cont_vector.size(), rng,
+      true, interrupt, logger, parameter_writer);
 
   return num_failed;
 }
 
+/**
+ * Times repeated evaluations of the log density of the model, and of
+ * its log density and gradient by reverse mode autodiff, at the
+ * initial point, for capacity planning.
+ *
+ * The mean, median and 99th percentile latency of each, the autodiff
+ * tape memory per gradient evaluation and the gradients per second are
+ * written to the logger and the parameter writer, followed by the
+ * predicted time of a NUTS transition reaching each tree depth from 1
+ * to 10. A transition reaching depth d takes 2^d - 1 leapfrog steps of
+ * one gradient evaluation each.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_evals number of timed evaluations of each kind
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] parameter_writer Writer callback for file output
+ * @return the gradient timings
+ */
+template <class Model>
+stan::model::gradient_benchmark benchmark(
+    Model& model, const stan::io::var_context& init, unsigned int random_seed,
+    unsigned int chain, double init_radius, int num_evals,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    callbacks::writer& init_writer, callbacks::writer& parameter_writer) {
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<int> disc_vector;
+  std::vector<double> cont_vector = util::initialize(
+      model, init, rng, init_radius, false, logger, init_writer);
+
+  logger.info("GRADIENT BENCHMARK MODE");
+
+  std::stringstream msg;
+  stan::model::gradient_benchmark timings = stan::model::benchmark_gradients(
+      model, cont_vector, disc_vector, num_evals, interrupt, &msg);
+  if (msg.str().length() > 0)
+    logger.info(msg);
+
+  auto write = [&](const std::string& line) {
+    logger.info(line);
+    parameter_writer(line);
+  };
+  auto latency_line = [](const std::string& label,
+                         const stan::model::latency_summary& latency) {
+    std::stringstream line;
+    line << std::setw(14) << label << std::setw(14) << latency.mean
+         << std::setw(14) << latency.median << std::setw(14) << latency.p99;
+    return line.str();
+  };
+
+  std::stringstream evals;
+  evals << " Evaluations=" << timings.num_evals
+        << " per kind, latencies in seconds";
+  parameter_writer();
+  logger.info("");
+  write(evals.str());
+  std::stringstream header;
+  header << std::setw(14) << "evaluation" << std::setw(14) << "mean"
+         << std::setw(14) << "median" << std::setw(14) << "p99";
+  write(header.str());
+  write(latency_line("log_prob", timings.log_prob));
+  write(latency_line("log_prob_grad", timings.log_prob_grad));
+
+  std::stringstream tape;
+  tape << " Autodiff tape per gradient=" << timings.tape_vars
+       << " variables, arena in use=" << timings.tape_bytes << " bytes";
+  write(tape.str());
+  std::stringstream throughput;
+  throughput << " Gradients per second=" << timings.gradients_per_second();
+  write(throughput.str());
+
+  parameter_writer();
+  logger.info("");
+  write(" Predicted time per NUTS transition");
+  std::stringstream depth_header;
+  depth_header << std::setw(14) << "tree depth" << std::setw(14)
+               << "gradients" << std::setw(14) << "seconds";
+  write(depth_header.str());
+  for (int depth = 1; depth <= 10; ++depth) {
+    int num_gradients = (1 << depth) - 1;
+    std::stringstream line;
+    line << std::setw(14) << depth << std::setw(14) << num_gradients
+         << std::setw(14) << num_gradients * timings.log_prob_grad.mean;
+    write(line.str());
+  }
+
+  return timings;
+}
+
 }  // namespace diagnose
 }  // namespace services
 }  // namespace stan
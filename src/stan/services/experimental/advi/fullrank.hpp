@@ -4,12 +4,16 @@
 #include <stan/callbacks/interrupt.hpp>
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
+#include <stan/services/error_codes.hpp>
 #include <stan/services/util/experimental_message.hpp>
 #include <stan/services/util/initialize.hpp>
+#include <stan/services/util/profile_report.hpp>
 #include <stan/services/util/create_rng.hpp>
 #include <stan/io/var_context.hpp>
 #include <stan/variational/advi.hpp>
 #include <boost/random/additive_combine.hpp>
+#include <istream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -19,7 +23,18 @@ namespace experimental {
 namespace advi {
 
 /**
- * Runs full rank ADVI.
+ * Runs full rank ADVI, optionally continuing the stochastic gradient
+ * ascent of an earlier run from its state, and writes the state of the
+ * ascent every time the ELBO is evaluated and at the end of the run.
+ * Each state supersedes the previous one, so the writer only needs to
+ * keep the last one it received.
+ *
+ * When continuing, the approximation, the history of the stepsize
+ * sequence, its number of iterations and eta are taken from the state,
+ * and eta adaptation is skipped, so a refit of a model whose data
+ * changed a little converges in far fewer iterations than a new run.
+ * The initial values are still read from <code>init</code> and written
+ * to <code>init_writer</code>.
  *
  * @tparam Model A model implementation
  * @param[in] model Input model to test (with data already instantiated)
@@ -45,7 +60,13 @@ namespace advi {
  * @param[in,out] init_writer Writer callback for unconstrained inits
  * @param[in,out] parameter_writer output for parameter values
  * @param[in,out] diagnostic_writer output for diagnostic values
- * @return error_codes::OK if successful
+ * @param[in,out] warm_state stream holding the state of the earlier run
+ *   to continue, or a null pointer to start a new run
+ * @param[in,out] state_writer output for the state of the ascent
+ * @param[in,out] profiles report of the profiles of the model written at
+ *   the end of the run, or a null pointer for none
+ * @return error_codes::OK if successful, error_codes::USAGE if the
+ *   state can't be read or doesn't match the model
  */
 template <class Model>
 int fullrank(Model& model, const stan::io::var_context& init,
@@ -56,15 +77,35 @@ int fullrank(Model& model, const stan::io::var_context& init,
              callbacks::interrupt& interrupt, callbacks::logger& logger,
              callbacks::writer& init_writer,
              callbacks::writer& parameter_writer,
-             callbacks::writer& diagnostic_writer) {
+             callbacks::writer& diagnostic_writer,
+             std::istream* warm_state, callbacks::writer& state_writer,
+             util::profile_report* profiles = nullptr) {
   util::experimental_message(logger);
+  if (profiles)
+    profiles->begin();
 
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+  stan::rng_t rng = util::create_rng(random_seed, chain);
 
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize(
       model, init, rng, init_radius, true, logger, init_writer);
 
+  Eigen::VectorXd cont_params
+      = Eigen::Map<Eigen::VectorXd>(&cont_vector[0], cont_vector.size(), 1);
+
+  stan::variational::normal_fullrank variational(cont_params);
+  stan::variational::ascent_update<stan::variational::normal_fullrank> update(
+      stan::variational::ascent_method::adagrad, variational);
+  if (warm_state) {
+    try {
+      stan::variational::read_advi_state(*warm_state, variational, update,
+                                         eta);
+    } catch (const std::invalid_argument& e) {
+      logger.error(e.what());
+      return error_codes::USAGE;
+    }
+  }
+
   std::vector<std::string> names;
   names.push_back("lp__");
   names.push_back("log_p__");
@@ -72,18 +113,65 @@ int fullrank(Model& model, const stan::io::var_context& init,
   model.constrained_param_names(names, true, true);
   parameter_writer(names);
 
-  Eigen::VectorXd cont_params
-      = Eigen::Map<Eigen::VectorXd>(&cont_vector[0], cont_vector.size(), 1);
-
   stan::variational::advi<Model, stan::variational::normal_fullrank,
-                          boost::ecuyer1988>
+                          stan::rng_t>
       cmd_advi(model, cont_params, rng, grad_samples, elbo_samples, eval_elbo,
                output_samples);
-  cmd_advi.run(eta, adapt_engaged, adapt_iterations, tol_rel_obj,
-               max_iterations, logger, parameter_writer, diagnostic_writer);
+  cmd_advi.run(variational, update, eta, adapt_engaged, adapt_iterations,
+               tol_rel_obj, max_iterations, logger, parameter_writer,
+               diagnostic_writer, state_writer);
+  if (profiles)
+    profiles->write();
 
   return 0;
 }
+
+/**
+ * Runs full rank ADVI.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] grad_samples number of samples for Monte Carlo estimate
+ *   of gradients
+ * @param[in] elbo_samples number of samples for Monte Carlo estimate
+ *   of ELBO
+ * @param[in] max_iterations maximum number of iterations
+ * @param[in] tol_rel_obj convergence tolerance on the relative norm of
+ *   the objective
+ * @param[in] eta stepsize scaling parameter for variational inference
+ * @param[in] adapt_engaged adaptation engaged?
+ * @param[in] adapt_iterations number of iterations for eta adaptation
+ * @param[in] eval_elbo evaluate ELBO every Nth iteration
+ * @param[in] output_samples number of posterior samples to draw and
+ *   save
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] parameter_writer output for parameter values
+ * @param[in,out] diagnostic_writer output for diagnostic values
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int fullrank(Model& model, const stan::io::var_context& init,
+             unsigned int random_seed, unsigned int chain, double init_radius,
+             int grad_samples, int elbo_samples, int max_iterations,
+             double tol_rel_obj, double eta, bool adapt_engaged,
+             int adapt_iterations, int eval_elbo, int output_samples,
+             callbacks::interrupt& interrupt, callbacks::logger& logger,
+             callbacks::writer& init_writer,
+             callbacks::writer& parameter_writer,
+             callbacks::writer& diagnostic_writer) {
+  callbacks::writer state_writer;
+  return fullrank(model, init, random_seed, chain, init_radius, grad_samples,
+                  elbo_samples, max_iterations, tol_rel_obj, eta,
+                  adapt_engaged, adapt_iterations, eval_elbo, output_samples,
+                  interrupt, logger, init_writer, parameter_writer,
+                  diagnostic_writer, nullptr, state_writer);
+}
 }  // namespace advi
 }  // namespace experimental
 }  // namespace services
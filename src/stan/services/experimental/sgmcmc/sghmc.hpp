@@ -0,0 +1,120 @@
+#ifndef STAN_SERVICES_EXPERIMENTAL_SGMCMC_SGHMC_HPP
+#define STAN_SERVICES_EXPERIMENTAL_SGMCMC_SGHMC_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/mcmc/sgmcmc/sghmc.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/experimental_message.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/run_sampler.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace experimental {
+namespace sgmcmc {
+
+/**
+ * Runs stochastic gradient Hamiltonian Monte Carlo, whose transitions
+ * each take one gradient of the log density estimated from a mini-batch of
+ * the data, so that they cost time proportional to the batch size
+ * rather than to the size of the data, and which aren't corrected by a
+ * Metropolis step. The draws are biased by the discretization, less so
+ * the smaller the step size. The friction sets the fraction of the
+ * momentum dissipated per transition, with a friction of 1 the same as
+ * stochastic gradient Langevin dynamics. The diagonal inverse metric is adapted
+ * during warmup. The model must provide <code>log_prob_rows()</code>
+ * and <code>num_rows()</code>, see <code>stan::mcmc::sghmc</code>.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] batch_size number of rows of data per gradient
+ * @param[in] stepsize step size of the first transition
+ * @param[in] stepsize_t0 offset of the polynomial decay of the step size
+ * @param[in] stepsize_decay exponent of the decay of the step size, in
+ *   [0, 1], with 0 for a constant step size
+ * @param[in] friction fraction of the momentum dissipated per
+ *   transition, in (0, 1]
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @return error_codes::OK if successful, error_codes::USAGE if the batch
+ *   size isn't positive or the model has no rows of data,
+ *   error_codes::CONFIG if the step size schedule or the friction is
+ *   invalid
+ */
+template <class Model>
+int sghmc(Model& model, const stan::io::var_context& init,
+          unsigned int random_seed, unsigned int chain, double init_radius,
+          int num_warmup, int num_samples, int num_thin, bool save_warmup,
+          int refresh, int batch_size, double stepsize, double stepsize_t0,
+          double stepsize_decay, double friction, unsigned int init_buffer,
+          unsigned int term_buffer, unsigned int window,
+          callbacks::interrupt& interrupt, callbacks::logger& logger,
+          callbacks::writer& init_writer, callbacks::writer& sample_writer,
+          callbacks::writer& diagnostic_writer) {
+  util::experimental_message(logger);
+  if (batch_size < 1) {
+    logger.error("The batch size must be positive");
+    return error_codes::USAGE;
+  }
+  if (model.num_rows() == 0) {
+    logger.error("The model has no rows of data to subsample");
+    return error_codes::USAGE;
+  }
+
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<int> disc_vector;
+  std::vector<double> cont_vector = util::initialize(
+      model, init, rng, init_radius, true, logger, init_writer);
+
+  stan::mcmc::sghmc<Model, stan::rng_t> sampler(model, rng, batch_size);
+  try {
+    sampler.set_stepsize_schedule(stepsize, stepsize_t0, stepsize_decay);
+    sampler.set_friction(friction);
+  } catch (const std::invalid_argument& e) {
+    logger.error(e.what());
+    return error_codes::CONFIG;
+  }
+  sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
+                            logger);
+  sampler.engage_adaptation();
+
+  std::stringstream msg;
+  msg << "Gradients use batches of " << sampler.batch_size() << " of "
+      << model.num_rows() << " rows of data.";
+  logger.info(msg);
+
+  util::run_sampler(sampler, model, cont_vector, num_warmup, num_samples,
+                    num_thin, refresh, save_warmup, rng, interrupt, logger,
+                    sample_writer, diagnostic_writer);
+
+  return error_codes::OK;
+}
+
+}  // namespace sgmcmc
+}  // namespace experimental
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,172 @@
+#ifndef STAN_SERVICES_OPTIMIZE_BOUNDED_LBFGS_HPP
+#define STAN_SERVICES_OPTIMIZE_BOUNDED_LBFGS_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/optimization/bounded_lbfgs.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace optimize {
+
+/**
+ * Runs the bounded L-BFGS algorithm for a model, which keeps the
+ * unconstrained parameters within the specified bounds, holding those
+ * that reach a bound in an active set instead of relying on the model's
+ * transforms near the bound. The initial values are moved into the
+ * bounds if needed.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] lower lower bounds on the unconstrained parameters, which
+ *   may be negative infinity
+ * @param[in] upper upper bounds on the unconstrained parameters, which
+ *   may be infinity
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] history_size amount of history to keep for L-BFGS
+ * @param[in] tol_obj convergence tolerance on absolute changes in
+ *   objective function value
+ * @param[in] tol_rel_obj convergence tolerance on relative changes
+ *   in objective function value
+ * @param[in] tol_grad convergence tolerance on the norm of the projected
+ *   gradient
+ * @param[in] tol_param convergence tolerance on changes in parameter
+ *   value
+ * @param[in] num_iterations maximum number of iterations
+ * @param[in] refresh how often to write output to logger
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] parameter_writer output for parameter values
+ * @return error_codes::OK if successful, error_codes::USAGE if the
+ *   bounds don't match the parameters
+ */
+template <class Model>
+int bounded_lbfgs(Model& model, const stan::io::var_context& init,
+                  const std::vector<double>& lower,
+                  const std::vector<double>& upper, unsigned int random_seed,
+                  unsigned int chain, double init_radius, int history_size,
+                  double tol_obj, double tol_rel_obj, double tol_grad,
+                  double tol_param, int num_iterations, int refresh,
+                  callbacks::interrupt& interrupt, callbacks::logger& logger,
+                  callbacks::writer& init_writer,
+                  callbacks::writer& parameter_writer) {
+  typedef stan::optimization::ModelAdaptor<Model> Adaptor;
+  typedef stan::optimization::BoundedLBFGSMinimizer<Adaptor> Optimizer;
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<int> disc_vector;
+  std::vector<double> cont_vector = util::initialize<false>(
+      model, init, rng, init_radius, false, logger, init_writer);
+  if (lower.size() != cont_vector.size()
+      || upper.size() != cont_vector.size()) {
+    logger.error("Bounds must have one value per unconstrained parameter");
+    return error_codes::USAGE;
+  }
+
+  std::stringstream lbfgs_ss;
+  Adaptor adaptor(model, disc_vector, &lbfgs_ss);
+  Eigen::VectorXd x = Eigen::Map<const Eigen::VectorXd>(cont_vector.data(),
+                                                       cont_vector.size());
+  int ret = 0;
+  try {
+    Optimizer lbfgs(
+        adaptor,
+        Eigen::Map<const Eigen::VectorXd>(lower.data(), lower.size()),
+        Eigen::Map<const Eigen::VectorXd>(upper.data(), upper.size()));
+    lbfgs.get_qnupdate().set_history_size(history_size);
+    lbfgs._conv_opts.tolAbsF = tol_obj;
+    lbfgs._conv_opts.tolRelF = tol_rel_obj;
+    lbfgs._conv_opts.tolAbsGrad = tol_grad;
+    lbfgs._conv_opts.tolAbsX = tol_param;
+    lbfgs._conv_opts.maxIts = num_iterations;
+    lbfgs.initialize(x);
+
+    std::stringstream initial_msg;
+    initial_msg << "Initial log joint probability = " << -lbfgs.curr_f();
+    logger.info(initial_msg);
+
+    while (ret == 0) {
+      interrupt();
+      if (refresh > 0
+          && (lbfgs.iter_num() == 0 || ((lbfgs.iter_num() + 1) % refresh == 0)))
+        logger.info(
+            "    Iter"
+            "      log prob"
+            "  ||proj grad||"
+            "       alpha"
+            "  # active"
+            "  Notes ");
+
+      ret = lbfgs.step();
+
+      if (refresh > 0
+          && (ret != 0 || !lbfgs.note().empty() || lbfgs.iter_num() == 0
+              || ((lbfgs.iter_num() + 1) % refresh == 0))) {
+        std::stringstream msg;
+        msg << " " << std::setw(7) << lbfgs.iter_num() << " ";
+        msg << " " << std::setw(12) << std::setprecision(6)
+            << -lbfgs.curr_f() << " ";
+        msg << " " << std::setw(14) << std::setprecision(6)
+            << lbfgs.proj_grad_norm() << " ";
+        msg << " " << std::setw(10) << std::setprecision(4) << lbfgs.alpha()
+            << " ";
+        msg << " " << std::setw(8) << lbfgs.active().size() << " ";
+        msg << " " << lbfgs.note() << " ";
+        logger.info(msg);
+      }
+
+      if (lbfgs_ss.str().length() > 0) {
+        logger.info(lbfgs_ss);
+        lbfgs_ss.str("");
+      }
+    }
+    x = lbfgs.curr_x();
+    cont_vector.assign(x.data(), x.data() + x.size());
+
+    std::vector<std::string> names;
+    names.push_back("lp__");
+    model.constrained_param_names(names, true, true);
+    parameter_writer(names);
+
+    std::vector<double> values;
+    std::stringstream msg;
+    model.write_array(rng, cont_vector, disc_vector, values, true, true, &msg);
+    if (msg.str().length() > 0)
+      logger.info(msg);
+    values.insert(values.begin(), -lbfgs.curr_f());
+    parameter_writer(values);
+  } catch (const std::invalid_argument& e) {
+    logger.error(e.what());
+    return error_codes::USAGE;
+  }
+
+  int return_code;
+  if (ret >= 0) {
+    logger.info("Optimization terminated normally: ");
+    return_code = error_codes::OK;
+  } else {
+    logger.info("Optimization terminated with error: ");
+    return_code = error_codes::SOFTWARE;
+  }
+  logger.info("  " + Optimizer::get_code_string(ret));
+
+  return return_code;
+}
+
+}  // namespace optimize
+}  // namespace services
+}  // namespace stan
+#endif
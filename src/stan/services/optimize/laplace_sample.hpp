@@ -0,0 +1,172 @@
+#ifndef STAN_SERVICES_OPTIMIZE_LAPLACE_SAMPLE_HPP
+#define STAN_SERVICES_OPTIMIZE_LAPLACE_SAMPLE_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/model/grad_hess_log_prob.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace optimize {
+
+/**
+ * Draw from the Laplace approximation to the posterior at a mode, the
+ * multivariate normal on the unconstrained scale centered at the mode
+ * whose precision is the negative Hessian of the log density there.
+ *
+ * The Hessian is computed once, by finite differences of gradients as
+ * in <code>stan::model::grad_hess_log_prob()</code>, and factored once
+ * as <code>L L'</code>. Draws are made in batches: the standard normal
+ * variates of a batch fill a matrix <code>Z</code>, one triangular
+ * solve gives <code>L'^-1 Z</code>, and the draws are mapped to the
+ * constrained scale with <code>write_array()</code> in parallel. Each
+ * draw gets its own generator for its generated quantities, seeded
+ * from the main generator, so the output doesn't depend on how the
+ * draws are scheduled.
+ *
+ * Each row of output holds <code>log_p__</code>, the log density of
+ * the model at the draw, <code>log_g__</code>, the log density of the
+ * approximation up to a constant, and the constrained parameters,
+ * transformed parameters and generated quantities.
+ *
+ * @tparam jacobian whether to include the log Jacobian of the
+ *   constraining transforms in the log density, giving the
+ *   approximation at a mode on the unconstrained scale
+ * @tparam Model type of model
+ * @param[in] model the Stan model instantiated with data
+ * @param[in] mode values of the parameters at the mode
+ * @param[in] num_draws number of draws
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the random number generator
+ * @param[in] refresh number of draws between progress messages
+ * @param[in,out] interrupt callback to be called every batch
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] sample_writer output for the draws
+ * @return error_codes::OK if successful, error_codes::DATAERR if the
+ *   mode can't be read or the Hessian isn't negative definite there
+ */
+template <bool jacobian = false, class Model>
+int laplace_sample(const Model& model, const stan::io::var_context& mode,
+                   int num_draws, unsigned int random_seed, unsigned int chain,
+                   int refresh, callbacks::interrupt& interrupt,
+                   callbacks::logger& logger,
+                   callbacks::writer& sample_writer) {
+  static const int batch_size = 256;
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  Eigen::VectorXd theta_hat;
+  Eigen::VectorXd grad;
+  Eigen::MatrixXd hessian;
+  try {
+    std::stringstream msg;
+    model.transform_inits(mode, theta_hat, &msg);
+    stan::model::grad_hess_log_prob<true, jacobian>(model, theta_hat, grad,
+                                                    hessian, true, &msg);
+    if (msg.str().length() > 0)
+      logger.info(msg);
+  } catch (const std::exception& e) {
+    logger.error(e.what());
+    return error_codes::DATAERR;
+  }
+
+  Eigen::LLT<Eigen::MatrixXd> llt(-hessian);
+  if (llt.info() != Eigen::Success || !hessian.allFinite()) {
+    logger.error(
+        "Laplace approximation failed: the Hessian of the log density "
+        "is not negative definite at the mode");
+    return error_codes::DATAERR;
+  }
+
+  std::vector<std::string> names;
+  names.push_back("log_p__");
+  names.push_back("log_g__");
+  model.constrained_param_names(names, true, true);
+  sample_writer(names);
+
+  const Eigen::Index num_params = theta_hat.size();
+  boost::random::normal_distribution<double> std_normal;
+  Eigen::MatrixXd z, draws, constrained;
+  std::vector<unsigned int> seeds;
+  std::vector<std::string> messages;
+  std::vector<double> log_p, values;
+
+  for (int n = 0; n < num_draws;) {
+    const int size = std::min(batch_size, num_draws - n);
+    z = Eigen::MatrixXd::NullaryExpr(num_params, size,
+                                     [&]() { return std_normal(rng); });
+    draws = llt.matrixU().solve(z);
+    draws.colwise() += theta_hat;
+    seeds.resize(size);
+    for (int j = 0; j < size; ++j)
+      seeds[j] = rng();
+
+    log_p.resize(size);
+    messages.assign(size, "");
+    constrained.resize(names.size() - 2, size);
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, size),
+        [&](const tbb::blocked_range<int>& r) {
+          std::stringstream ss;
+          Eigen::VectorXd draw, values_j;
+          for (int j = r.begin(); j != r.end(); ++j) {
+            ss.str("");
+            draw = draws.col(j);
+            try {
+              log_p[j] = model.template log_prob<false, jacobian>(draw, &ss);
+            } catch (const std::exception& e) {
+              ss << e.what() << std::endl;
+              log_p[j] = -std::numeric_limits<double>::infinity();
+            }
+            try {
+              stan::rng_t draw_rng(seeds[j]);
+              model.write_array(draw_rng, draw, values_j, true, true, &ss);
+              constrained.col(j) = values_j;
+            } catch (const std::exception& e) {
+              ss << e.what() << std::endl;
+              constrained.col(j).setConstant(
+                  std::numeric_limits<double>::quiet_NaN());
+            }
+            messages[j] = ss.str();
+          }
+        });
+
+    for (int j = 0; j < size; ++j) {
+      if (messages[j].length() > 0)
+        logger.info(messages[j]);
+      values.resize(constrained.rows() + 2);
+      values[0] = log_p[j];
+      values[1] = -0.5 * z.col(j).squaredNorm();
+      Eigen::Map<Eigen::VectorXd>(values.data() + 2, constrained.rows())
+          = constrained.col(j);
+      sample_writer(values);
+    }
+
+    n += size;
+    if (refresh > 0 && (n % refresh < size || n == num_draws)) {
+      std::stringstream msg;
+      msg << "Laplace draw " << n << " / " << num_draws;
+      logger.info(msg);
+    }
+    interrupt();
+  }
+  return error_codes::OK;
+}
+
+}  // namespace optimize
+}  // namespace services
+}  // namespace stan
+#endif
@@ -8,10 +8,17 @@
 #include <stan/optimization/bfgs.hpp>
 #include <stan/services/error_codes.hpp>
 #include <stan/services/util/initialize.hpp>
+#include <stan/services/util/memory_report.hpp>
+#include <stan/services/util/profile_report.hpp>
 #include <stan/services/util/create_rng.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -20,7 +27,22 @@ namespace services {
 namespace optimize {
 
 /**
- * Runs the L-BFGS algorithm for a model.
+ * Runs the L-BFGS algorithm for a model, tracing every iteration
+ * without mapping it to the constrained scale.
+ *
+ * Each iteration writes its number, log density, gradient norm, step
+ * size, line search step length and number of gradient evaluations to
+ * the trace writer, which costs nothing beyond the optimization itself.
+ * The constrained parameters, transformed parameters and generated
+ * quantities, which take a call to <code>write_array()</code>, are
+ * only written to the parameter writer every <code>save_every</code>
+ * iterations, starting with the initial point, and at the optimum.
+ *
+ * When <code>qn_history</code> holds updates, typically when refitting
+ * a model to slightly changed data from the previous optimum, the
+ * optimizer starts from that approximation of the inverse Hessian
+ * instead of the gradient direction, which can save most of the
+ * iterations.
  *
  * @tparam Model A model implementation
  * @param[in] model Input model to test (with data already instantiated)
@@ -40,13 +62,22 @@ namespace optimize {
  * @param[in] tol_param convergence tolerance on changes in parameter
  *   value
  * @param[in] num_iterations maximum number of iterations
- * @param[in] save_iterations indicates whether all the iterations should
- *   be saved to the parameter_writer
+ * @param[in] save_every number of iterations between the iterations
+ *   written to the parameter_writer, or zero to write only the optimum
  * @param[in] refresh how often to write output to logger
  * @param[in,out] interrupt callback to be called every iteration
  * @param[in,out] logger Logger for messages
  * @param[in,out] init_writer Writer callback for unconstrained inits
  * @param[in,out] parameter_writer output for parameter values
+ * @param[in,out] trace_writer output for the trace of the iterations
+ * @param[in,out] qn_history L-BFGS history to continue from, such as
+ *   the one left by a previous fit to similar data, or an empty one to
+ *   start afresh; replaced by the history at the optimum
+ * @param[in,out] memory collector of the memory taken by the autodiff
+ *   arena and the L-BFGS history, which is written at the end of the
+ *   run, or a null pointer for none
+ * @param[in,out] profiles report of the profiles of the model written at
+ *   the end of the run, or a null pointer for none
  * @return error_codes::OK if successful
  */
 template <class Model>
@@ -54,11 +85,18 @@ int lbfgs(Model& model, const stan::io::var_context& init,
           unsigned int random_seed, unsigned int chain, double init_radius,
           int history_size, double init_alpha, double tol_obj,
           double tol_rel_obj, double tol_grad, double tol_rel_grad,
-          double tol_param, int num_iterations, bool save_iterations,
-          int refresh, callbacks::interrupt& interrupt,
-          callbacks::logger& logger, callbacks::writer& init_writer,
-          callbacks::writer& parameter_writer) {
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+          double tol_param, int num_iterations, int save_every, int refresh,
+          callbacks::interrupt& interrupt, callbacks::logger& logger,
+          callbacks::writer& init_writer, callbacks::writer& parameter_writer,
+          callbacks::writer& trace_writer,
+          stan::optimization::LBFGSUpdate<>& qn_history,
+          util::memory_report* memory = nullptr,
+          util::profile_report* profiles = nullptr) {
+  if (memory)
+    memory->begin();
+  if (profiles)
+    profiles->begin();
+  stan::rng_t rng = util::create_rng(random_seed, chain);
 
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize<false>(
@@ -69,6 +107,19 @@ int lbfgs(Model& model, const stan::io::var_context& init,
                                              stan::optimization::LBFGSUpdate<> >
       Optimizer;
   Optimizer lbfgs(model, cont_vector, disc_vector, &lbfgs_ss);
+  bool warm = false;
+  if (qn_history.history_size() > 0) {
+    Eigen::MatrixXd S, Y;
+    qn_history.history(S, Y);
+    if (S.rows() == lbfgs.curr_x().size()) {
+      lbfgs.get_qnupdate() = qn_history;
+      warm = true;
+    } else {
+      logger.info(
+          "L-BFGS history doesn't match the number of parameters; "
+          "starting afresh");
+    }
+  }
   lbfgs.get_qnupdate().set_history_size(history_size);
   lbfgs._ls_opts.alpha0 = init_alpha;
   lbfgs._conv_opts.tolAbsF = tol_obj;
@@ -77,19 +128,32 @@ int lbfgs(Model& model, const stan::io::var_context& init,
   lbfgs._conv_opts.tolRelGrad = tol_rel_grad;
   lbfgs._conv_opts.tolAbsX = tol_param;
   lbfgs._conv_opts.maxIts = num_iterations;
+  if (warm)
+    lbfgs.warm_start();
 
   double lp = lbfgs.logp();
 
   std::stringstream initial_msg;
   initial_msg << "Initial log joint probability = " << lp;
   logger.info(initial_msg);
+  if (warm)
+    logger.info("Continuing from the previous L-BFGS history");
 
   std::vector<std::string> names;
   names.push_back("lp__");
   model.constrained_param_names(names, true, true);
   parameter_writer(names);
 
-  if (save_iterations) {
+  std::vector<std::string> trace_names;
+  trace_names.push_back("iter__");
+  trace_names.push_back("lp__");
+  trace_names.push_back("grad_norm__");
+  trace_names.push_back("step_size__");
+  trace_names.push_back("alpha__");
+  trace_names.push_back("evals__");
+  trace_writer(trace_names);
+
+  auto write_values = [&]() {
     std::vector<double> values;
     std::stringstream msg;
     model.write_array(rng, cont_vector, disc_vector, values, true, true, &msg);
@@ -98,7 +162,12 @@ int lbfgs(Model& model, const stan::io::var_context& init,
 
     values.insert(values.begin(), lp);
     parameter_writer(values);
-  }
+  };
+
+  trace_writer(std::vector<double>{0, lp, lbfgs.curr_g().norm(), 0, 0,
+                                   static_cast<double>(lbfgs.grad_evals())});
+  if (save_every > 0)
+    write_values();
   int ret = 0;
 
   while (ret == 0) {
@@ -143,29 +212,26 @@ int lbfgs(Model& model, const stan::io::var_context& init,
       lbfgs_ss.str("");
     }
 
-    if (save_iterations) {
-      std::vector<double> values;
-      std::stringstream msg;
-      model.write_array(rng, cont_vector, disc_vector, values, true, true,
-                        &msg);
-      if (msg.str().length() > 0)
-        logger.info(msg);
-
-      values.insert(values.begin(), lp);
-      parameter_writer(values);
-    }
+    trace_writer(std::vector<double>{
+        static_cast<double>(lbfgs.iter_num()), lp, lbfgs.curr_g().norm(),
+        lbfgs.prev_step_size(), lbfgs.alpha(),
+        static_cast<double>(lbfgs.grad_evals())});
+    if (save_every > 0 && (ret != 0 || lbfgs.iter_num() % save_every == 0))
+      write_values();
   }
 
-  if (!save_iterations) {
-    std::vector<double> values;
-    std::stringstream msg;
-    model.write_array(rng, cont_vector, disc_vector, values, true, true, &msg);
-    if (msg.str().length() > 0)
-      logger.info(msg);
-
-    values.insert(values.begin(), lp);
-    parameter_writer(values);
+  if (save_every <= 0)
+    write_values();
+  qn_history = lbfgs.get_qnupdate();
+  if (memory) {
+    memory->add_autodiff();
+    Eigen::MatrixXd S, Y;
+    qn_history.history(S, Y);
+    memory->add("lbfgs_history", (S.size() + Y.size()) * sizeof(double));
+    memory->write();
   }
+  if (profiles)
+    profiles->write();
 
   int return_code;
   if (ret >= 0) {
@@ -180,6 +246,267 @@ int lbfgs(Model& model, const stan::io::var_context& init,
   return return_code;
 }
 
+/**
+ * Runs the L-BFGS algorithm for a model, tracing every iteration
+ * without mapping it to the constrained scale, as the overload above
+ * does, starting with an empty history.
+ */
+template <class Model>
+int lbfgs(Model& model, const stan::io::var_context& init,
+          unsigned int random_seed, unsigned int chain, double init_radius,
+          int history_size, double init_alpha, double tol_obj,
+          double tol_rel_obj, double tol_grad, double tol_rel_grad,
+          double tol_param, int num_iterations, int save_every, int refresh,
+          callbacks::interrupt& interrupt, callbacks::logger& logger,
+          callbacks::writer& init_writer, callbacks::writer& parameter_writer,
+          callbacks::writer& trace_writer) {
+  stan::optimization::LBFGSUpdate<> qn_history;
+  return lbfgs(model, init, random_seed, chain, init_radius, history_size,
+               init_alpha, tol_obj, tol_rel_obj, tol_grad, tol_rel_grad,
+               tol_param, num_iterations, save_every, refresh, interrupt,
+               logger, init_writer, parameter_writer, trace_writer,
+               qn_history);
+}
+
+/**
+ * Runs the L-BFGS algorithm for a model.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] history_size amount of history to keep for L-BFGS
+ * @param[in] init_alpha line search step size for first iteration
+ * @param[in] tol_obj convergence tolerance on absolute changes in
+ *   objective function value
+ * @param[in] tol_rel_obj convergence tolerance on relative changes
+ *   in objective function value
+ * @param[in] tol_grad convergence tolerance on the norm of the gradient
+ * @param[in] tol_rel_grad convergence tolerance on the relative norm of
+ *   the gradient
+ * @param[in] tol_param convergence tolerance on changes in parameter
+ *   value
+ * @param[in] num_iterations maximum number of iterations
+ * @param[in] save_iterations indicates whether all the iterations should
+ *   be saved to the parameter_writer
+ * @param[in] refresh how often to write output to logger
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] parameter_writer output for parameter values
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int lbfgs(Model& model, const stan::io::var_context& init,
+          unsigned int random_seed, unsigned int chain, double init_radius,
+          int history_size, double init_alpha, double tol_obj,
+          double tol_rel_obj, double tol_grad, double tol_rel_grad,
+          double tol_param, int num_iterations, bool save_iterations,
+          int refresh, callbacks::interrupt& interrupt,
+          callbacks::logger& logger, callbacks::writer& init_writer,
+          callbacks::writer& parameter_writer) {
+  callbacks::writer trace_writer;
+  return lbfgs(model, init, random_seed, chain, init_radius, history_size,
+               init_alpha, tol_obj, tol_rel_obj, tol_grad, tol_rel_grad,
+               tol_param, num_iterations, save_iterations ? 1 : 0, refresh,
+               interrupt, logger, init_writer, parameter_writer, trace_writer);
+}
+
+/**
+ * Runs the L-BFGS algorithm for a model from several initializations in
+ * parallel, to find the modes of a multimodal model in one process.
+ *
+ * The starts share the model instance and its data and run on the TBB
+ * thread pool. Each start gets its own random number generator created
+ * from the random seed and its chain id, so that start
+ * <code>init_chain_id + i</code> begins where a single run with that
+ * chain id would. The optimum found by each start is written to its
+ * parameter writer, and the best of them, with the highest log
+ * density, to the best writer. Because the interrupt and the logger are
+ * shared by all starts, they must be safe to call from several threads.
+ *
+ * When <code>stall_iterations</code> is positive, a start is stopped
+ * early once another start has terminated normally with a higher log
+ * density and the start's log density has gained less over its last
+ * <code>stall_iterations</code> iterations than it still lacks from
+ * that best one, as it is then likely climbing towards a lower mode.
+ * Which starts are stopped depends on the order in which the starts
+ * finish, so the results are only reproducible with zero, the default.
+ *
+ * @tparam Model A model implementation
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam ParameterWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_starts number of starts; <code>init</code>,
+ *   <code>init_writer</code> and <code>parameter_writer</code> must be
+ *   this long
+ * @param[in] init var contexts for initialization of each start
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id chain id of the first start; start
+ *   <code>i</code> advances the pseudo random number generator by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] history_size amount of history to keep for L-BFGS
+ * @param[in] init_alpha line search step size for first iteration
+ * @param[in] tol_obj convergence tolerance on absolute changes in
+ *   objective function value
+ * @param[in] tol_rel_obj convergence tolerance on relative changes
+ *   in objective function value
+ * @param[in] tol_grad convergence tolerance on the norm of the gradient
+ * @param[in] tol_rel_grad convergence tolerance on the relative norm of
+ *   the gradient
+ * @param[in] tol_param convergence tolerance on changes in parameter
+ *   value
+ * @param[in] num_iterations maximum number of iterations of each start
+ * @param[in] stall_iterations number of iterations over which a start
+ *   must close its gap to the best optimum, or zero to run every start
+ *   to termination
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callbacks for unconstrained inits of
+ *   each start
+ * @param[in,out] parameter_writer outputs for the optimum of each start
+ * @param[in,out] best_writer output for the best optimum
+ * @return error_codes::OK if at least one start terminated normally
+ */
+template <class Model, typename InitContextPtr, typename InitWriter,
+          typename ParameterWriter>
+int lbfgs(Model& model, size_t num_starts,
+          const std::vector<InitContextPtr>& init, unsigned int random_seed,
+          unsigned int init_chain_id, double init_radius, int history_size,
+          double init_alpha, double tol_obj, double tol_rel_obj,
+          double tol_grad, double tol_rel_grad, double tol_param,
+          int num_iterations, int stall_iterations,
+          callbacks::interrupt& interrupt, callbacks::logger& logger,
+          std::vector<InitWriter>& init_writer,
+          std::vector<ParameterWriter>& parameter_writer,
+          callbacks::writer& best_writer) {
+  typedef stan::optimization::BFGSLineSearch<Model,
+                                             stan::optimization::LBFGSUpdate<> >
+      Optimizer;
+  const double no_best = -std::numeric_limits<double>::infinity();
+
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_starts);
+  std::vector<std::vector<double> > cont_vectors;
+  cont_vectors.reserve(num_starts);
+  for (size_t i = 0; i < num_starts; ++i) {
+    rngs.emplace_back(util::create_rng(random_seed, init_chain_id + i));
+    cont_vectors.emplace_back(util::initialize<false>(
+        model, *init[i], rngs[i], init_radius, false, logger, init_writer[i]));
+  }
+
+  std::vector<double> lps(num_starts, no_best);
+  std::vector<int> rets(num_starts, 0);
+  std::vector<char> stalled(num_starts, false);
+  std::atomic<double> best_lp(no_best);
+
+  auto run = [&](size_t i) {
+    std::vector<int> disc_vector;
+    std::stringstream lbfgs_ss;
+    Optimizer lbfgs(model, cont_vectors[i], disc_vector, &lbfgs_ss);
+    lbfgs.get_qnupdate().set_history_size(history_size);
+    lbfgs._ls_opts.alpha0 = init_alpha;
+    lbfgs._conv_opts.tolAbsF = tol_obj;
+    lbfgs._conv_opts.tolRelF = tol_rel_obj;
+    lbfgs._conv_opts.tolAbsGrad = tol_grad;
+    lbfgs._conv_opts.tolRelGrad = tol_rel_grad;
+    lbfgs._conv_opts.tolAbsX = tol_param;
+    lbfgs._conv_opts.maxIts = num_iterations;
+
+    std::vector<double> trace;
+    int ret = 0;
+    while (ret == 0) {
+      interrupt();
+      ret = lbfgs.step();
+      if (lbfgs_ss.str().length() > 0) {
+        logger.info(lbfgs_ss);
+        lbfgs_ss.str("");
+      }
+      if (ret != 0 || stall_iterations <= 0)
+        continue;
+      const double lp = lbfgs.logp();
+      trace.push_back(lp);
+      if (trace.size() > static_cast<size_t>(stall_iterations)) {
+        const double gain = lp - trace[trace.size() - 1 - stall_iterations];
+        const double best = best_lp.load();
+        if (lp < best && gain < best - lp) {
+          stalled[i] = true;
+          break;
+        }
+      }
+    }
+    lbfgs.params_r(cont_vectors[i]);
+    lps[i] = lbfgs.logp();
+    rets[i] = ret;
+    if (ret > 0) {
+      double best = best_lp.load();
+      while (lps[i] > best && !best_lp.compare_exchange_weak(best, lps[i])) {
+      }
+    }
+
+    std::stringstream msg;
+    msg << "Start " << init_chain_id + i << ": ";
+    if (stalled[i])
+      msg << "stopped below the best optimum";
+    else if (ret >= 0)
+      msg << "optimization terminated normally, " << lbfgs.get_code_string(ret);
+    else
+      msg << "optimization terminated with error, "
+          << lbfgs.get_code_string(ret);
+    msg << ", log joint probability = " << lps[i];
+    logger.info(msg);
+  };
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_starts, 1),
+      [&run](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i)
+          run(i);
+      },
+      tbb::simple_partitioner());
+
+  std::vector<std::string> names;
+  names.push_back("lp__");
+  model.constrained_param_names(names, true, true);
+  best_writer(names);
+
+  size_t best = num_starts;
+  std::vector<double> best_values;
+  for (size_t i = 0; i < num_starts; ++i) {
+    std::vector<int> disc_vector;
+    std::vector<double> values;
+    std::stringstream msg;
+    model.write_array(rngs[i], cont_vectors[i], disc_vector, values, true,
+                      true, &msg);
+    if (msg.str().length() > 0)
+      logger.info(msg);
+    values.insert(values.begin(), lps[i]);
+    parameter_writer[i](names);
+    parameter_writer[i](values);
+    if (rets[i] >= 0 && (best == num_starts || lps[i] > lps[best])) {
+      best = i;
+      best_values = values;
+    }
+  }
+
+  if (best == num_starts) {
+    logger.info("Optimization terminated with error for every start");
+    return error_codes::SOFTWARE;
+  }
+  best_writer(best_values);
+  std::stringstream best_msg;
+  best_msg << "Best optimum found by start " << init_chain_id + best
+           << ", log joint probability = " << lps[best];
+  logger.info(best_msg);
+  return error_codes::OK;
+}
+
 }  // namespace optimize
 }  // namespace services
 }  // namespace stan
@@ -0,0 +1,294 @@
+#ifndef STAN_SERVICES_OPTIMIZE_STOCHASTIC_LBFGS_HPP
+#define STAN_SERVICES_OPTIMIZE_STOCHASTIC_LBFGS_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/optimization/bfgs.hpp>
+#include <stan/optimization/stochastic_lbfgs.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace optimize {
+
+/**
+ * Runs the multi-batch stochastic L-BFGS algorithm for a model whose log
+ * density can be estimated from mini-batches of the rows of its data,
+ * then polishes the estimate with L-BFGS on all rows.
+ *
+ * The stochastic iterations take fixed-length quasi-Newton steps on
+ * the gradients of overlapping batches until <code>max_epochs</code>
+ * passes through the data are made, so that each costs time
+ * proportional to the batch size rather than to the size of the data;
+ * see <code>stan::optimization::StochasticLBFGS</code>. At most
+ * <code>polish_iterations</code> full-batch L-BFGS iterations with the
+ * default convergence tolerances follow. The model must provide
+ * <code>log_prob_rows()</code> and <code>num_rows()</code>, see
+ * <code>stan::optimization::ModelRowsAdaptor</code>.
+ *
+ * The log density written with each iteration is the estimate from its
+ * batch during the stochastic iterations, and the log density of all
+ * rows during polishing, both dropping constants and without the
+ * Jacobian of the constraining transforms.
+ *
+ * @tparam Model A model implementation
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] history_size amount of history to keep for L-BFGS
+ * @param[in] batch_size number of rows of data per batch
+ * @param[in] overlap fraction of the rows of a batch shared with the
+ *   next batch, in [0, 1)
+ * @param[in] step_size length of the stochastic steps along the
+ *   quasi-Newton direction
+ * @param[in] max_epochs number of passes through the data of the
+ *   stochastic iterations
+ * @param[in] polish_iterations maximum number of full-batch iterations,
+ *   or zero to keep the stochastic estimate
+ * @param[in] save_iterations indicates whether all the iterations should
+ *   be saved to the parameter_writer
+ * @param[in] refresh how often to write output to logger
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] parameter_writer output for parameter values
+ * @return error_codes::OK if successful, error_codes::USAGE if the batch
+ *   size isn't positive or the model has no rows of data,
+ *   error_codes::CONFIG if the overlap, step size or number of epochs is
+ *   invalid, error_codes::SOFTWARE if the optimization fails
+ */
+template <class Model>
+int stochastic_lbfgs(Model& model, const stan::io::var_context& init,
+                     unsigned int random_seed, unsigned int chain,
+                     double init_radius, int history_size, int batch_size,
+                     double overlap, double step_size, double max_epochs,
+                     int polish_iterations, bool save_iterations, int refresh,
+                     callbacks::interrupt& interrupt,
+                     callbacks::logger& logger,
+                     callbacks::writer& init_writer,
+                     callbacks::writer& parameter_writer) {
+  if (batch_size < 1) {
+    logger.error("The batch size must be positive");
+    return error_codes::USAGE;
+  }
+  if (model.num_rows() == 0) {
+    logger.error("The model has no rows of data to subsample");
+    return error_codes::USAGE;
+  }
+  if (!(overlap >= 0 && overlap < 1)) {
+    logger.error("The overlap must be in [0, 1)");
+    return error_codes::CONFIG;
+  }
+  if (!(step_size > 0) || !(max_epochs > 0)) {
+    logger.error("The step size and the number of epochs must be positive");
+    return error_codes::CONFIG;
+  }
+
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<int> disc_vector;
+  std::vector<double> cont_vector = util::initialize<false>(
+      model, init, rng, init_radius, false, logger, init_writer);
+
+  typedef stan::optimization::ModelRowsAdaptor<Model> objective_t;
+  typedef stan::optimization::StochasticLBFGS<objective_t> optimizer_t;
+  typedef stan::optimization::FullBatchFunctor<objective_t> full_batch_t;
+  typedef stan::optimization::BFGSMinimizer<full_batch_t,
+                                            stan::optimization::LBFGSUpdate<> >
+      polish_t;
+  std::stringstream lbfgs_ss;
+  objective_t objective(model, &lbfgs_ss);
+  optimizer_t lbfgs(objective, model.num_rows());
+  lbfgs.get_qnupdate().set_history_size(history_size);
+  lbfgs._opts.batchSize = batch_size;
+  lbfgs._opts.overlap = overlap;
+  lbfgs._opts.stepSize = step_size;
+  lbfgs._opts.maxEpochs = max_epochs;
+
+  Eigen::VectorXd x0 = Eigen::Map<Eigen::VectorXd>(cont_vector.data(),
+                                                   cont_vector.size());
+  try {
+    lbfgs.initialize(x0, rng);
+  } catch (const std::runtime_error& e) {
+    if (lbfgs_ss.str().length() > 0)
+      logger.info(lbfgs_ss);
+    logger.error(e.what());
+    return error_codes::SOFTWARE;
+  }
+  double lp = -lbfgs.curr_f();
+
+  std::stringstream initial_msg;
+  initial_msg << "Initial log joint probability estimate = " << lp;
+  logger.info(initial_msg);
+  std::stringstream batch_msg;
+  batch_msg << "Gradients use batches of "
+            << std::min<size_t>(batch_size, model.num_rows()) << " of "
+            << model.num_rows() << " rows of data.";
+  logger.info(batch_msg);
+
+  std::vector<std::string> names;
+  names.push_back("lp__");
+  model.constrained_param_names(names, true, true);
+  parameter_writer(names);
+
+  auto write_values = [&]() {
+    std::vector<double> values;
+    std::stringstream msg;
+    model.write_array(rng, cont_vector, disc_vector, values, true, true, &msg);
+    if (msg.str().length() > 0)
+      logger.info(msg);
+
+    values.insert(values.begin(), lp);
+    parameter_writer(values);
+  };
+  auto set_cont_vector = [&](const Eigen::VectorXd& x) {
+    cont_vector.assign(x.data(), x.data() + x.size());
+  };
+
+  if (save_iterations)
+    write_values();
+  int ret = 0;
+
+  while (ret == 0) {
+    interrupt();
+    if (refresh > 0
+        && (lbfgs.iter_num() == 0 || ((lbfgs.iter_num() + 1) % refresh == 0)))
+      logger.info(
+          "    Iter"
+          "  log prob est"
+          "        epochs"
+          "   step size"
+          "  Notes ");
+
+    ret = lbfgs.step(rng);
+    lp = -lbfgs.curr_f();
+    set_cont_vector(lbfgs.curr_x());
+
+    if (refresh > 0
+        && (ret != 0 || !lbfgs.note().empty() || lbfgs.iter_num() == 0
+            || ((lbfgs.iter_num() + 1) % refresh == 0))) {
+      std::stringstream msg;
+      msg << " " << std::setw(7) << lbfgs.iter_num() << " ";
+      msg << " " << std::setw(12) << std::setprecision(6) << lp << " ";
+      msg << " " << std::setw(12) << std::setprecision(6) << lbfgs.epochs()
+          << " ";
+      msg << " " << std::setw(10) << std::setprecision(4)
+          << lbfgs.step_size() << " ";
+      msg << " " << lbfgs.note() << " ";
+      logger.info(msg);
+    }
+
+    if (lbfgs_ss.str().length() > 0) {
+      logger.info(lbfgs_ss);
+      lbfgs_ss.str("");
+    }
+
+    if (save_iterations)
+      write_values();
+  }
+
+  if (ret < 0) {
+    logger.info("Stochastic optimization terminated with error: ");
+    logger.info("  The step size fell below its minimum");
+    if (!save_iterations)
+      write_values();
+    return error_codes::SOFTWARE;
+  }
+  std::stringstream epochs_msg;
+  epochs_msg << "Stochastic optimization made " << lbfgs.epochs()
+             << " passes through the data in " << lbfgs.iter_num()
+             << " iterations";
+  logger.info(epochs_msg);
+  if (polish_iterations <= 0) {
+    if (!save_iterations)
+      write_values();
+    return error_codes::OK;
+  }
+
+  full_batch_t full_batch(objective, model.num_rows());
+  polish_t polish(full_batch);
+  polish.get_qnupdate().set_history_size(history_size);
+  polish._conv_opts.maxIts = polish_iterations;
+  try {
+    polish.initialize(lbfgs.curr_x());
+  } catch (const std::runtime_error& e) {
+    if (lbfgs_ss.str().length() > 0)
+      logger.info(lbfgs_ss);
+    logger.error(e.what());
+    if (!save_iterations)
+      write_values();
+    return error_codes::SOFTWARE;
+  }
+  lp = -polish.curr_f();
+  std::stringstream polish_msg;
+  polish_msg << "Polishing on all rows from log joint probability = " << lp;
+  logger.info(polish_msg);
+
+  ret = 0;
+  while (ret == 0) {
+    interrupt();
+    if (refresh > 0
+        && (polish.iter_num() == 0 || ((polish.iter_num() + 1) % refresh == 0)))
+      logger.info(
+          "    Iter"
+          "      log prob"
+          "      ||grad||"
+          "  Notes ");
+
+    ret = polish.step();
+    lp = -polish.curr_f();
+    set_cont_vector(polish.curr_x());
+
+    if (refresh > 0
+        && (ret != 0 || !polish.note().empty() || polish.iter_num() == 0
+            || ((polish.iter_num() + 1) % refresh == 0))) {
+      std::stringstream msg;
+      msg << " " << std::setw(7) << polish.iter_num() << " ";
+      msg << " " << std::setw(12) << std::setprecision(6) << lp << " ";
+      msg << " " << std::setw(12) << std::setprecision(6)
+          << polish.curr_g().norm() << " ";
+      msg << " " << polish.note() << " ";
+      logger.info(msg);
+    }
+
+    if (lbfgs_ss.str().length() > 0) {
+      logger.info(lbfgs_ss);
+      lbfgs_ss.str("");
+    }
+
+    if (save_iterations)
+      write_values();
+  }
+
+  if (!save_iterations)
+    write_values();
+
+  int return_code;
+  if (ret >= 0) {
+    logger.info("Optimization terminated normally: ");
+    return_code = error_codes::OK;
+  } else {
+    logger.info("Optimization terminated with error: ");
+    return_code = error_codes::SOFTWARE;
+  }
+  logger.info("  " + polish_t::get_code_string(ret));
+
+  return return_code;
+}
+
+}  // namespace optimize
+}  // namespace services
+}  // namespace stan
+#endif
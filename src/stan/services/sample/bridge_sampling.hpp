@@ -0,0 +1,163 @@
+#ifndef STAN_SERVICES_SAMPLE_BRIDGE_SAMPLING_HPP
+#define STAN_SERVICES_SAMPLE_BRIDGE_SAMPLING_HPP
+
+#include <stan/analyze/mcmc/compute_bridge_sampling.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/model/evaluator_pool.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+
+/**
+ * Estimate the log marginal likelihood of a model from draws of its
+ * posterior by bridge sampling, with
+ * <code>stan::analyze::compute_bridge_sampling()</code>, for comparing
+ * models by their Bayes factors.
+ *
+ * The proposal is a multivariate normal with the mean and covariance
+ * of the first half of the draws, and the second half are the
+ * posterior draws of the bridge estimator, so that the proposal doesn't
+ * depend on the draws it is evaluated at. The log density of the model
+ * is evaluated at those draws and at the proposal draws in parallel by
+ * a <code>stan::model::evaluator_pool</code>, with every constant and
+ * the Jacobian, since the normalizing constants of models compared
+ * must be on the same scale; this requires sampling statements to keep
+ * their constants, as they do without <code>propto</code>. Draws where
+ * the model throws are given a density of zero.
+ *
+ * @tparam Model model class
+ * @param[in] model model
+ * @param[in] draws unconstrained parameters of the posterior draws, one
+ *   per row, in the order they were drawn
+ * @param[in] num_proposal_draws number of draws of the proposal, or
+ *   zero for as many as there are posterior draws in the estimator
+ * @param[in] seed seed of the random number generator of the proposal
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] num_threads number of threads evaluating the model, or -1
+ *   for one per hardware thread
+ * @param[in, out] interrupt called every evaluation collected
+ * @param[in, out] logger logger for messages
+ * @param[out] estimate log marginal likelihood and its relative error
+ * @return error_codes::OK if successful, error_codes::DATAERR if the
+ *   draws don't match the model, are too few for the proposal, have a
+ *   singular covariance, or every posterior draw fails
+ */
+template <class Model>
+int bridge_sampling(const Model& model, const Eigen::MatrixXd& draws,
+                    int num_proposal_draws, unsigned int seed,
+                    unsigned int chain, int num_threads,
+                    callbacks::interrupt& interrupt,
+                    callbacks::logger& logger,
+                    analyze::bridge_sampling_estimate& estimate) {
+  const double inf = std::numeric_limits<double>::infinity();
+  estimate.log_marginal_likelihood = std::numeric_limits<double>::quiet_NaN();
+  estimate.relative_error = inf;
+  estimate.iterations = 0;
+  estimate.converged = false;
+  const Eigen::Index num_params = model.num_params_r();
+  const Eigen::Index num_fit = draws.rows() / 2;
+  if (draws.cols() != num_params || num_fit <= num_params) {
+    std::stringstream msg;
+    msg << "Expecting more than " << 2 * num_params << " draws of "
+        << num_params << " unconstrained parameters, found " << draws.rows()
+        << " draws of " << draws.cols() << " parameters.";
+    logger.error(msg);
+    return error_codes::DATAERR;
+  }
+
+  // Proposal fitted to the first half of the draws
+  Eigen::VectorXd mean = draws.topRows(num_fit).colwise().mean().transpose();
+  Eigen::MatrixXd centered
+      = draws.topRows(num_fit).rowwise() - mean.transpose();
+  Eigen::LLT<Eigen::MatrixXd> llt(centered.transpose() * centered
+                                  / (num_fit - 1.0));
+  if (llt.info() != Eigen::Success) {
+    logger.error(
+        "The covariance of the draws is singular, the proposal can't be "
+        "fitted.");
+    return error_codes::DATAERR;
+  }
+  const Eigen::MatrixXd L = llt.matrixL();
+  const double log_q_constant = -0.5 * num_params * std::log(2 * M_PI)
+                                - L.diagonal().array().log().sum();
+
+  const Eigen::MatrixXd posterior
+      = draws.bottomRows(draws.rows() - num_fit).transpose();
+  const Eigen::Index num_posterior = posterior.cols();
+  if (num_proposal_draws <= 0)
+    num_proposal_draws = num_posterior;
+  Eigen::MatrixXd z(num_params, num_proposal_draws);
+  stan::rng_t rng = util::create_rng(seed, chain);
+  boost::random::normal_distribution<double> normal;
+  for (Eigen::Index j = 0; j < z.cols(); ++j)
+    for (Eigen::Index i = 0; i < num_params; ++i)
+      z(i, j) = normal(rng);
+  Eigen::MatrixXd proposal = (L * z).colwise() + mean;
+
+  Eigen::VectorXd log_q_proposal
+      = (log_q_constant - 0.5 * z.colwise().squaredNorm().array())
+            .transpose();
+  Eigen::MatrixXd w = posterior.colwise() - mean;
+  L.triangularView<Eigen::Lower>().solveInPlace(w);
+  Eigen::VectorXd log_q_posterior
+      = (log_q_constant - 0.5 * w.colwise().squaredNorm().array())
+            .transpose();
+
+  using evaluation = typename stan::model::evaluator_pool<Model>::evaluation;
+  stan::model::evaluator_pool<Model> pool(model, num_threads);
+  std::vector<std::future<evaluation>> evaluations;
+  evaluations.reserve(num_posterior + num_proposal_draws);
+  for (Eigen::Index n = 0; n < num_posterior; ++n)
+    evaluations.push_back(
+        pool.template log_prob<false, true>(posterior.col(n)));
+  for (Eigen::Index n = 0; n < num_proposal_draws; ++n)
+    evaluations.push_back(
+        pool.template log_prob<false, true>(proposal.col(n)));
+  Eigen::VectorXd log_p(evaluations.size());
+  for (size_t n = 0; n < evaluations.size(); ++n) {
+    interrupt();
+    log_p(n) = -inf;
+    try {
+      evaluation result = evaluations[n].get();
+      if (result.messages.length() > 0)
+        logger.info(result.messages);
+      log_p(n) = result.log_prob;
+    } catch (const std::exception& e) {
+      logger.info(e.what());
+    }
+  }
+
+  try {
+    estimate = analyze::compute_bridge_sampling(
+        log_p.head(num_posterior), log_q_posterior,
+        log_p.tail(num_proposal_draws), log_q_proposal);
+  } catch (const std::invalid_argument& e) {
+    logger.error(e.what());
+    return error_codes::DATAERR;
+  }
+  std::stringstream msg;
+  msg << "Log marginal likelihood: " << estimate.log_marginal_likelihood
+      << ", relative error " << estimate.relative_error << " after "
+      << estimate.iterations << " iterations";
+  logger.info(msg);
+  if (!estimate.converged)
+    logger.warn(
+        "The bridge sampling iteration did not converge, the estimate is "
+        "unreliable.");
+  return error_codes::OK;
+}
+
+}  // namespace services
+}  // namespace stan
+#endif
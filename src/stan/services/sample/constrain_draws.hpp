@@ -0,0 +1,154 @@
+#ifndef STAN_SERVICES_SAMPLE_CONSTRAIN_DRAWS_HPP
+#define STAN_SERVICES_SAMPLE_CONSTRAIN_DRAWS_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+
+namespace internal {
+
+/**
+ * Outcome of constraining one draw.
+ */
+struct constrained_draw {
+  // Values written by the model
+  Eigen::VectorXd values;
+  // Messages printed by the model
+  std::string msg;
+  // Error thrown by the model, empty if none
+  std::string error;
+};
+
+}  // namespace internal
+
+/**
+ * Constrain draws written with unconstrained output, see
+ * <code>util::mcmc_writer::set_run_options()</code>, computing
+ * their constrained parameters, transformed parameters and, optionally,
+ * generated quantities with <code>model.write_array()</code>.
+ *
+ * The draws are read by either <code>io::stan_csv_reader</code> or
+ * <code>io::stan_binary_reader</code>; their model columns are the
+ * index <code>draw__</code> followed by the unconstrained parameters.
+ * Draw <code>n</code> uses the generator
+ * <code>util::create_draw_rng(util::create_rng(seed, chain), n)</code>,
+ * so the values of a draw don't depend on which other draws are
+ * constrained. When Stan is built with <code>STAN_THREADS</code> the
+ * draws are constrained in parallel on the TBB thread pool; they are
+ * still written in order, each as <code>draw__</code> followed by the
+ * values of the model. A draw whose <code>write_array()</code> throws
+ * is logged and skipped.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in] draws draws with unconstrained parameters
+ * @param[in] rows rows of the draws to constrain, in the order they are
+ *   written, or empty for all of them
+ * @param[in] include_gqs whether to compute the generated quantities
+ * @param[in] seed seed to use for randomization
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in, out] interrupt called every draw
+ * @param[in, out] logger logger to which to write warning and error messages
+ * @param[in, out] sample_writer writer to which draws are written
+ * @return error code
+ */
+template <class Model>
+int constrain_draws(const Model &model, const io::stan_csv &draws,
+                    const std::vector<size_t> &rows, bool include_gqs,
+                    unsigned int seed, unsigned int chain,
+                    callbacks::interrupt &interrupt,
+                    callbacks::logger &logger,
+                    callbacks::writer &sample_writer) {
+  auto draw_col = std::find(draws.header.begin(), draws.header.end(),
+                            "draw__");
+  const size_t num_params = model.num_params_r();
+  if (draw_col == draws.header.end()
+      || static_cast<size_t>(draws.header.end() - draw_col) <= num_params) {
+    logger.error(
+        "Draws don't have unconstrained parameters after a draw__ "
+        "column.");
+    return error_codes::DATAERR;
+  }
+  const size_t first_col = draw_col - draws.header.begin();
+
+  std::vector<size_t> selected(rows);
+  if (selected.empty())
+    for (int i = 0; i < draws.samples.rows(); ++i)
+      selected.push_back(i);
+  for (size_t i : selected) {
+    if (i >= static_cast<size_t>(draws.samples.rows())) {
+      logger.error("Draw " + std::to_string(i) + " is out of range.");
+      return error_codes::DATAERR;
+    }
+  }
+
+  std::vector<std::string> names{"draw__"};
+  model.constrained_param_names(names, true, include_gqs);
+  sample_writer(names);
+
+  stan::rng_t rng = util::create_rng(seed, chain);
+  std::vector<internal::constrained_draw> results(selected.size());
+  auto constrain = [&](size_t i) {
+    internal::constrained_draw &result = results[i];
+    const size_t row = selected[i];
+    Eigen::VectorXd params_r
+        = draws.samples.row(row).segment(first_col + 1, num_params);
+    stan::rng_t draw_rng = util::create_draw_rng(
+        rng, static_cast<size_t>(draws.samples(row, first_col)));
+    std::stringstream ss;
+    try {
+      model.write_array(draw_rng, params_r, result.values, true, include_gqs,
+                        &ss);
+    } catch (const std::exception &e) {
+      result.error = e.what();
+    }
+    result.msg = ss.str();
+  };
+#ifdef STAN_THREADS
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, selected.size()),
+                    [&](const tbb::blocked_range<size_t> &r) {
+                      for (size_t i = r.begin(); i < r.end(); ++i)
+                        constrain(i);
+                    });
+#else
+  for (size_t i = 0; i < selected.size(); ++i)
+    constrain(i);
+#endif
+
+  std::vector<double> values;
+  for (size_t i = 0; i < selected.size(); ++i) {
+    const internal::constrained_draw &result = results[i];
+    interrupt();  // call out to interrupt and fail
+    if (result.msg.length() > 0)
+      logger.info(result.msg);
+    if (result.error.length() > 0) {
+      logger.info(result.error);
+      continue;
+    }
+    values.assign(1, draws.samples(selected[i], first_col));
+    values.insert(values.end(), result.values.data(),
+                  result.values.data() + result.values.size());
+    sample_writer(values);
+  }
+  return error_codes::OK;
+}
+
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -11,7 +11,17 @@
 #include <stan/services/util/generate_transitions.hpp>
 #include <stan/services/util/create_rng.hpp>
 #include <stan/services/util/initialize.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace stan {
@@ -49,7 +59,7 @@ int fixed_param(Model& model, const stan::io::var_context& init,
                 callbacks::writer& init_writer,
                 callbacks::writer& sample_writer,
                 callbacks::writer& diagnostic_writer) {
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+  stan::rng_t rng = util::create_rng(random_seed, chain);
 
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize(
@@ -80,6 +90,180 @@ int fixed_param(Model& model, const stan::io::var_context& init,
   return error_codes::OK;
 }
 
+namespace internal {
+
+/**
+ * Outcome of writing the model values of one draw of the fixed
+ * parameter sampler.
+ */
+struct fixed_param_draw {
+  // Values written by the model
+  Eigen::VectorXd values;
+  // Messages printed by the model
+  std::string msg;
+  // Error thrown by the model, empty if none
+  std::string error;
+};
+
+/**
+ * Write the model values of one draw, using an RNG for the draw's own
+ * segment of the stream, from <code>util::create_draw_rng()</code>, so
+ * that the result doesn't depend on which thread writes which draw.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in] cont_params unconstrained parameter values
+ * @param[in] writer writer of the draws, which decides the values
+ *   written
+ * @param[in] rng RNG at the start of the first draw's segment
+ * @param[in] draw index of the draw
+ * @param[out] result values, messages and errors of the draw
+ */
+template <class Model>
+void write_fixed_param_draw(const Model& model,
+                            const Eigen::VectorXd& cont_params,
+                            const util::mcmc_writer& writer,
+                            const stan::rng_t& rng, size_t draw,
+                            fixed_param_draw& result) {
+  result.msg.clear();
+  result.error.clear();
+  result.values.setConstant(std::numeric_limits<double>::quiet_NaN());
+  Eigen::VectorXd params_r = cont_params;
+  stan::rng_t draw_rng = util::create_draw_rng(rng, draw);
+  std::stringstream ss;
+  try {
+    model.write_array(draw_rng, params_r, result.values,
+                      writer.include_tparams(), writer.include_gqs(), &ss);
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+  result.msg = ss.str();
+}
+
+}  // namespace internal
+
+/**
+ * Runs the fixed parameter sampler, writing the model values of the
+ * draws in batches of iterations. When Stan is built with
+ * <code>STAN_THREADS</code> the draws of a batch are written by the
+ * model in parallel on the TBB thread pool; the draws and messages are
+ * still written in the order of the iterations, and the interrupt is
+ * still called every iteration. Every draw uses its own segment of the
+ * RNG stream, so the output doesn't depend on the batch size or the
+ * number of threads. It differs from the output of the overload
+ * without a batch size, which uses a single stream for all draws.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] refresh Controls the output
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @param[in] batch_size number of iterations whose draws are written
+ *   at a time; 0 runs the overload without a batch size
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int fixed_param(Model& model, const stan::io::var_context& init,
+                unsigned int random_seed, unsigned int chain,
+                double init_radius, int num_samples, int num_thin, int refresh,
+                callbacks::interrupt& interrupt, callbacks::logger& logger,
+                callbacks::writer& init_writer,
+                callbacks::writer& sample_writer,
+                callbacks::writer& diagnostic_writer, size_t batch_size) {
+  if (batch_size == 0)
+    return fixed_param(model, init, random_seed, chain, init_radius,
+                       num_samples, num_thin, refresh, interrupt, logger,
+                       init_writer, sample_writer, diagnostic_writer);
+
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<double> cont_vector = util::initialize(
+      model, init, rng, init_radius, false, logger, init_writer);
+
+  stan::mcmc::fixed_param_sampler sampler;
+  util::mcmc_writer writer(sample_writer, diagnostic_writer, logger);
+  Eigen::VectorXd cont_params
+      = Eigen::Map<Eigen::VectorXd>(cont_vector.data(), cont_vector.size());
+  stan::mcmc::sample s(cont_params, 0, 0);
+
+  // Headers
+  writer.write_sample_names(s, sampler, model);
+  writer.write_diagnostic_names(s, sampler, model);
+
+  std::vector<internal::fixed_param_draw> results(batch_size);
+  for (internal::fixed_param_draw& result : results)
+    result.values.resize(writer.num_model_params_);
+  std::vector<int> iterations;
+  iterations.reserve(batch_size);
+  const int it_print_width
+      = std::ceil(std::log10(static_cast<double>(num_samples)));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int first = 0; first < num_samples;
+       first += static_cast<int>(batch_size)) {
+    const int last
+        = std::min(num_samples, first + static_cast<int>(batch_size));
+    iterations.clear();
+    for (int m = first; m < last; ++m)
+      if (m % num_thin == 0)
+        iterations.push_back(m);
+
+#ifdef STAN_THREADS
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, iterations.size()),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i < r.end(); ++i)
+                          internal::write_fixed_param_draw(
+                              model, cont_params, writer, rng,
+                              iterations[i] / num_thin, results[i]);
+                      });
+#else
+    for (size_t i = 0; i < iterations.size(); ++i)
+      internal::write_fixed_param_draw(model, cont_params, writer, rng,
+                                       iterations[i] / num_thin, results[i]);
+#endif
+
+    size_t i = 0;
+    for (int m = first; m < last; ++m) {
+      interrupt();
+      if (refresh > 0
+          && (m + 1 == num_samples || m == 0 || (m + 1) % refresh == 0)) {
+        std::stringstream message;
+        message << "Iteration: " << std::setw(it_print_width) << m + 1
+                << " / " << num_samples << " [" << std::setw(3)
+                << static_cast<int>((100.0 * (m + 1)) / num_samples)
+                << "%]  (Sampling)";
+        logger.info(message);
+      }
+      if (m % num_thin != 0)
+        continue;
+      const internal::fixed_param_draw& result = results[i++];
+      if (result.msg.length() > 0)
+        logger.info(result.msg);
+      if (result.error.length() > 0)
+        logger.info(result.error);
+      writer.write_sample_params(s, sampler, result.values);
+      writer.write_diagnostic_params(s, sampler);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  double sample_delta_t
+      = std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+            .count()
+        / 1000.0;
+  writer.write_timing(0.0, sample_delta_t);
+
+  return error_codes::OK;
+}
+
 }  // namespace sample
 }  // namespace services
 }  // namespace stan
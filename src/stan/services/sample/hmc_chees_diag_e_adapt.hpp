@@ -0,0 +1,226 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_CHEES_DIAG_E_ADAPT_HPP
+#define STAN_SERVICES_SAMPLE_HMC_CHEES_DIAG_E_ADAPT_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/dump.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/chees_adaptation.hpp>
+#include <stan/mcmc/hmc/static/diag_e_static_hmc.hpp>
+#include <stan/mcmc/stepsize_adaptation.hpp>
+#include <stan/mcmc/var_adaptation.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/create_unit_e_diag_inv_metric.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/inv_metric.hpp>
+#include <stan/services/util/run_chees_sampler.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs multiple chains of static HMC with a diagonal Euclidean metric
+ * in lock-step, with the step size, the integration time and the
+ * metric adapted jointly across chains during warmup. The integration
+ * time is tuned by the ChEES criterion and jittered every iteration, so
+ * that all chains take the same number of leapfrog steps per iteration.
+ * See <code>stan::services::util::run_chees_sampler</code>.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitInvContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in lock-step.
+ *   <code>init</code>, <code>init_inv_metric</code>,
+ *   <code>init_writer</code>, <code>sample_writer</code>, and
+ *   <code>diagnostic_writer</code> must be the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] init_inv_metric An std vector of var contexts exposing an
+ *   initial diagonal inverse Euclidean metric for each chain (must be
+ *   positive definite). The metric of the first chain is used for all.
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] int_time initial maximum integration time
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitInvContextPtr,
+          typename InitWriter, typename SampleWriter, typename DiagnosticWriter>
+int hmc_chees_diag_e_adapt(
+    Model& model, size_t num_chains, const std::vector<InitContextPtr>& init,
+    const std::vector<InitInvContextPtr>& init_inv_metric,
+    unsigned int random_seed, unsigned int init_chain_id, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double int_time, double delta, double gamma,
+    double kappa, double t0, unsigned int init_buffer,
+    unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  using sampler_t = stan::mcmc::diag_e_static_hmc<Model, stan::rng_t>;
+
+  Eigen::VectorXd inv_metric;
+  try {
+    inv_metric = util::read_diag_inv_metric(*init_inv_metric[0],
+                                            model.num_params_r(), logger);
+    util::validate_diag_inv_metric(inv_metric, logger);
+  } catch (const std::domain_error& e) {
+    return error_codes::CONFIG;
+  }
+
+  // The samplers hold references to their generators, so neither vector
+  // may reallocate once the first sampler has been constructed
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_chains);
+  std::vector<std::vector<double>> cont_vectors;
+  cont_vectors.reserve(num_chains);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_chains);
+  std::vector<stan::mcmc::var_adaptation> var_adaptations;
+  var_adaptations.reserve(num_chains);
+  for (size_t i = 0; i < num_chains; ++i) {
+    rngs.emplace_back(util::create_rng(random_seed, init_chain_id + i));
+    cont_vectors.emplace_back(util::initialize(
+        model, *init[i], rngs[i], init_radius, true, logger, init_writer[i]));
+
+    samplers.emplace_back(model, rngs[i]);
+    samplers.back().set_metric(inv_metric);
+    samplers.back().set_nominal_stepsize_and_T(stepsize, int_time);
+    samplers.back().set_stepsize_jitter(0);
+
+    var_adaptations.emplace_back(model.num_params_r());
+    var_adaptations.back().set_window_params(num_warmup, init_buffer,
+                                             term_buffer, window, logger);
+  }
+
+  stan::mcmc::stepsize_adaptation stepsize_adaptation;
+  stepsize_adaptation.set_mu(log(10 * stepsize));
+  stepsize_adaptation.set_delta(delta);
+  stepsize_adaptation.set_gamma(gamma);
+  stepsize_adaptation.set_kappa(kappa);
+  stepsize_adaptation.set_t0(t0);
+
+  stan::mcmc::chees_adaptation chees;
+  chees.set_T(int_time);
+
+  util::run_chees_sampler(samplers, model, cont_vectors, num_warmup,
+                          num_samples, num_thin, refresh, save_warmup, rngs,
+                          stepsize_adaptation, chees, var_adaptations,
+                          interrupt, logger, sample_writer, diagnostic_writer,
+                          init_chain_id);
+  return error_codes::OK;
+}
+
+/**
+ * Runs multiple chains of static HMC in lock-step with ChEES adaptation
+ * of the integration time, starting from the unit diagonal metric.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in lock-step.
+ *   <code>init</code>, <code>init_writer</code>,
+ *   <code>sample_writer</code>, and <code>diagnostic_writer</code> must be
+ *   the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] int_time initial maximum integration time
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitWriter,
+          typename SampleWriter, typename DiagnosticWriter>
+int hmc_chees_diag_e_adapt(
+    Model& model, size_t num_chains, const std::vector<InitContextPtr>& init,
+    unsigned int random_seed, unsigned int init_chain_id, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double int_time, double delta, double gamma,
+    double kappa, double t0, unsigned int init_buffer,
+    unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  stan::io::dump dmp
+      = util::create_unit_e_diag_inv_metric(model.num_params_r());
+  std::vector<const stan::io::var_context*> unit_e_metrics(num_chains, &dmp);
+  return hmc_chees_diag_e_adapt(
+      model, num_chains, init, unit_e_metrics, random_seed, init_chain_id,
+      init_radius, num_warmup, num_samples, num_thin, save_warmup, refresh,
+      stepsize, int_time, delta, gamma, kappa, t0, init_buffer, term_buffer,
+      window, interrupt, logger, init_writer, sample_writer,
+      diagnostic_writer);
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_DENSE_E_ADVI_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_DENSE_E_ADVI_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/services/sample/hmc_nuts_dense_e_adapt.hpp>
+#include <stan/services/util/advi_init.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/variational/families/normal_fullrank.hpp>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs full rank ADVI and then HMC with NUTS with adaptation using
+ * dense Euclidean metric, started at the mean of the approximation
+ * with its covariance as the initial inverse metric.
+ *
+ * The approximation usually puts the sampler near the typical set with
+ * a metric of the right scales and correlations, so far less warmup is
+ * needed than from a random initialization; a schedule of 150 warmup
+ * iterations with an init buffer of 25, a term buffer of 25 and a
+ * window of 50 is a good start. ADVI draws from a generator seeded like
+ * the sampler's but advanced far past the draws the sampler makes. If
+ * ADVI fails, the sampler is run from <code>init</code> with a unit
+ * metric instead.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization of ADVI
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] grad_samples number of samples for Monte Carlo estimate
+ *   of gradients
+ * @param[in] elbo_samples number of samples for Monte Carlo estimate
+ *   of ELBO
+ * @param[in] max_iterations maximum number of ADVI iterations
+ * @param[in] tol_rel_obj convergence tolerance on the relative norm
+ *   of the objective
+ * @param[in] eta stepsize scaling parameter for variational inference
+ * @param[in] adapt_engaged whether to adapt eta
+ * @param[in] adapt_iterations number of iterations for eta adaptation
+ * @param[in] eval_elbo evaluate ELBO every Nth iteration
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int hmc_nuts_dense_e_advi(
+    Model& model, const stan::io::var_context& init, unsigned int random_seed,
+    unsigned int chain, double init_radius, int grad_samples,
+    int elbo_samples, int max_iterations, double tol_rel_obj, double eta,
+    bool adapt_engaged, int adapt_iterations, int eval_elbo, int num_warmup,
+    int num_samples, int num_thin, bool save_warmup, int refresh,
+    double stepsize, double stepsize_jitter, int max_depth, double delta,
+    double gamma, double kappa, double t0, unsigned int init_buffer,
+    unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    callbacks::writer& init_writer, callbacks::writer& sample_writer,
+    callbacks::writer& diagnostic_writer) {
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+  rng.discard(static_cast<boost::uintmax_t>(1) << 49);
+
+  logger.info("Running full rank ADVI to initialize the sampler.");
+  stan::variational::normal_fullrank variational(model.num_params_r());
+  if (!util::advi_init(model, init, rng, init_radius, grad_samples,
+                       elbo_samples, max_iterations, tol_rel_obj, eta,
+                       adapt_engaged, adapt_iterations, eval_elbo, logger,
+                       variational)) {
+    logger.warn(
+        "ADVI failed; sampling from the initialization with a unit "
+        "metric.");
+    return hmc_nuts_dense_e_adapt(
+        model, init, random_seed, chain, init_radius, num_warmup, num_samples,
+        num_thin, save_warmup, refresh, stepsize, stepsize_jitter, max_depth,
+        delta, gamma, kappa, t0, init_buffer, term_buffer, window, interrupt,
+        logger, init_writer, sample_writer, diagnostic_writer);
+  }
+
+  stan::io::array_var_context advi_init
+      = util::advi_init_context(model, variational.mean(), rng);
+  stan::io::array_var_context advi_inv_metric
+      = util::advi_inv_metric_context(variational, true);
+  return hmc_nuts_dense_e_adapt(
+      model, advi_init, advi_inv_metric, random_seed, chain, 0, num_warmup,
+      num_samples, num_thin, save_warmup, refresh, stepsize, stepsize_jitter,
+      max_depth, delta, gamma, kappa, t0, init_buffer, term_buffer, window,
+      interrupt, logger, init_writer, sample_writer, diagnostic_writer);
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -13,6 +13,8 @@
 #include <stan/services/util/create_rng.hpp>
 #include <stan/services/util/initialize.hpp>
 #include <stan/services/util/inv_metric.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <vector>
 
 namespace stan {
@@ -24,6 +26,8 @@ namespace sample {
  * with a pre-specified Euclidean metric.
  *
  * @tparam Model Model class
+ * @tparam Integrator integrator of the sampler, such as
+ *   <code>stan::mcmc::expl_two_stage</code>; the leapfrog by default
  * @param[in] model Input model to test (with data already instantiated)
  * @param[in] init var context for initialization
  * @param[in] init_inv_metric var context exposing an initial diagonal
@@ -46,7 +50,8 @@ namespace sample {
  * @param[in,out] diagnostic_writer Writer for diagnostic information
  * @return error_codes::OK if successful
  */
-template <class Model>
+template <class Model,
+          template <class> class Integrator = stan::mcmc::expl_leapfrog>
 int hmc_nuts_diag_e(Model& model, const stan::io::var_context& init,
                     const stan::io::var_context& init_inv_metric,
                     unsigned int random_seed, unsigned int chain,
@@ -57,7 +62,7 @@ int hmc_nuts_diag_e(Model& model, const stan::io::var_context& init,
                     callbacks::writer& init_writer,
                     callbacks::writer& sample_writer,
                     callbacks::writer& diagnostic_writer) {
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+  stan::rng_t rng = util::create_rng(random_seed, chain);
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize(
       model, init, rng, init_radius, true, logger, init_writer);
@@ -71,7 +76,7 @@ int hmc_nuts_diag_e(Model& model, const stan::io::var_context& init,
     return error_codes::CONFIG;
   }
 
-  stan::mcmc::diag_e_nuts<Model, boost::ecuyer1988> sampler(model, rng);
+  stan::mcmc::diag_e_nuts<Model, stan::rng_t, Integrator> sampler(model, rng);
 
   sampler.set_metric(inv_metric);
   sampler.set_nominal_stepsize(stepsize);
@@ -131,6 +136,194 @@ int hmc_nuts_diag_e(Model& model, const stan::io::var_context& init,
                          sample_writer, diagnostic_writer);
 }
 
+/**
+ * Runs multiple chains of HMC with NUTS without adaptation using diagonal
+ * Euclidean metric with a pre-specified Euclidean metric.
+ *
+ * The chains share the model instance and its data and are run in
+ * parallel on the TBB thread pool. Each chain gets its own random number
+ * generator created from the random seed and its chain id, so that the
+ * output of chain <code>init_chain_id + i</code> matches the output of
+ * a single chain run with that chain id. Because the interrupt and the
+ * logger are shared by all chains, they must be safe to call from
+ * multiple threads.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitInvContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in parallel.
+ *   <code>init</code>, <code>init_inv_metric</code>,
+ *   <code>init_writer</code>, <code>sample_writer</code>, and
+ *   <code>diagnostic_writer</code> must be the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] init_inv_metric An std vector of var contexts exposing an
+ *   initial diagonal inverse Euclidean metric for each chain (must be
+ *   positive definite)
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitInvContextPtr,
+          typename InitWriter, typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e(Model& model, size_t num_chains,
+                    const std::vector<InitContextPtr>& init,
+                    const std::vector<InitInvContextPtr>& init_inv_metric,
+                    unsigned int random_seed, unsigned int init_chain_id,
+                    double init_radius, int num_warmup, int num_samples,
+                    int num_thin, bool save_warmup, int refresh,
+                    double stepsize, double stepsize_jitter, int max_depth,
+                    callbacks::interrupt& interrupt, callbacks::logger& logger,
+                    std::vector<InitWriter>& init_writer,
+                    std::vector<SampleWriter>& sample_writer,
+                    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  if (num_chains == 1) {
+    return hmc_nuts_diag_e(
+        model, *init[0], *init_inv_metric[0], random_seed, init_chain_id,
+        init_radius, num_warmup, num_samples, num_thin, save_warmup, refresh,
+        stepsize, stepsize_jitter, max_depth, interrupt, logger, init_writer[0],
+        sample_writer[0], diagnostic_writer[0]);
+  }
+  using sampler_t = stan::mcmc::diag_e_nuts<Model, stan::rng_t>;
+
+  // The samplers hold references to their generators, so neither vector
+  // may reallocate once the first sampler has been constructed
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_chains);
+  std::vector<std::vector<double>> cont_vectors;
+  cont_vectors.reserve(num_chains);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_chains);
+  for (size_t i = 0; i < num_chains; ++i) {
+    rngs.emplace_back(util::create_rng(random_seed, init_chain_id + i));
+    cont_vectors.emplace_back(util::initialize(
+        model, *init[i], rngs[i], init_radius, true, logger, init_writer[i]));
+
+    Eigen::VectorXd inv_metric;
+    try {
+      inv_metric = util::read_diag_inv_metric(*init_inv_metric[i],
+                                              model.num_params_r(), logger);
+      util::validate_diag_inv_metric(inv_metric, logger);
+    } catch (const std::domain_error& e) {
+      return error_codes::CONFIG;
+    }
+
+    samplers.emplace_back(model, rngs[i]);
+    sampler_t& sampler = samplers.back();
+    sampler.set_metric(inv_metric);
+    sampler.set_nominal_stepsize(stepsize);
+    sampler.set_stepsize_jitter(stepsize_jitter);
+    sampler.set_max_depth(max_depth);
+  }
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_chains, 1),
+      [num_warmup, num_samples, num_thin, refresh, save_warmup, num_chains,
+       init_chain_id, &samplers, &model, &rngs, &interrupt, &logger,
+       &sample_writer, &cont_vectors,
+       &diagnostic_writer](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          util::run_sampler(
+              samplers[i], model, cont_vectors[i], num_warmup, num_samples,
+              num_thin, refresh, save_warmup, rngs[i], interrupt, logger,
+              sample_writer[i], diagnostic_writer[i], init_chain_id + i,
+              num_chains);
+        }
+      },
+      tbb::simple_partitioner());
+  return error_codes::OK;
+}
+
+/**
+ * Runs multiple chains of HMC with NUTS without adaptation using diagonal
+ * Euclidean metric, with identity matrix as initial inv_metric of
+ * every chain.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in parallel.
+ *   <code>init</code>, <code>init_writer</code>,
+ *   <code>sample_writer</code>, and <code>diagnostic_writer</code> must be
+ *   the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitWriter,
+          typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e(Model& model, size_t num_chains,
+                    const std::vector<InitContextPtr>& init,
+                    unsigned int random_seed, unsigned int init_chain_id,
+                    double init_radius, int num_warmup, int num_samples,
+                    int num_thin, bool save_warmup, int refresh,
+                    double stepsize, double stepsize_jitter, int max_depth,
+                    callbacks::interrupt& interrupt, callbacks::logger& logger,
+                    std::vector<InitWriter>& init_writer,
+                    std::vector<SampleWriter>& sample_writer,
+                    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  stan::io::dump dmp
+      = util::create_unit_e_diag_inv_metric(model.num_params_r());
+  std::vector<const stan::io::var_context*> unit_e_metrics(num_chains, &dmp);
+  return hmc_nuts_diag_e(
+      model, num_chains, init, unit_e_metrics, random_seed, init_chain_id,
+      init_radius, num_warmup, num_samples, num_thin, save_warmup, refresh,
+      stepsize, stepsize_jitter, max_depth, interrupt, logger, init_writer,
+      sample_writer, diagnostic_writer);
+}
+
 }  // namespace sample
 }  // namespace services
 }  // namespace stan
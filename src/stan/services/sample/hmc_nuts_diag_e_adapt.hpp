@@ -9,10 +9,23 @@
 #include <stan/mcmc/fixed_param_sampler.hpp>
 #include <stan/services/error_codes.hpp>
 #include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/util/chain_communicator.hpp>
+#include <stan/services/util/chain_placement.hpp>
+#include <stan/services/util/checkpoint.hpp>
+#include <stan/services/util/column_selection.hpp>
+#include <stan/services/util/profile_report.hpp>
+#include <stan/services/util/warmup_profile.hpp>
 #include <stan/services/util/run_adaptive_sampler.hpp>
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <stan/services/util/run_options.hpp>
+#include <stan/services/util/thread_budget.hpp>
 #include <stan/services/util/create_rng.hpp>
 #include <stan/services/util/initialize.hpp>
+#include <stan/services/util/memory_report.hpp>
 #include <stan/services/util/inv_metric.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <stdexcept>
 #include <vector>
 
 namespace stan {
@@ -24,6 +37,8 @@ namespace sample {
  * with a pre-specified Euclidean metric.
  *
  * @tparam Model Model class
+ * @tparam Integrator integrator of the sampler, such as
+ *   <code>stan::mcmc::expl_two_stage</code>; the leapfrog by default
  * @param[in] model Input model to test (with data already instantiated)
  * @param[in] init var context for initialization
  * @param[in] init_inv_metric var context exposing an initial diagonal
@@ -51,9 +66,16 @@ namespace sample {
  * @param[in,out] init_writer Writer callback for unconstrained inits
  * @param[in,out] sample_writer Writer for draws
  * @param[in,out] diagnostic_writer Writer for diagnostic information
- * @return error_codes::OK if successful
+ * @param[in] options optional collectors and outputs of the run,
+ *   such as a checkpoint, a time budget or a profile report, and the
+ *   tolerance of the adaptive warmup schedule; see
+ *   <code>util::run_options</code>
+ * @return error_codes::OK if successful, error_codes::CONFIG if the
+ *   checkpoint to resume from can't be restored or is combined with the
+ *   adaptive warmup schedule
  */
-template <class Model>
+template <class Model,
+          template <class> class Integrator = stan::mcmc::expl_leapfrog>
 int hmc_nuts_diag_e_adapt(
     Model& model, const stan::io::var_context& init,
     const stan::io::var_context& init_inv_metric, unsigned int random_seed,
@@ -63,12 +85,17 @@ int hmc_nuts_diag_e_adapt(
     double kappa, double t0, unsigned int init_buffer, unsigned int term_buffer,
     unsigned int window, callbacks::interrupt& interrupt,
     callbacks::logger& logger, callbacks::writer& init_writer,
-    callbacks::writer& sample_writer, callbacks::writer& diagnostic_writer) {
-  boost::ecuyer1988 rng = util::create_rng(random_seed, chain);
+    callbacks::writer& sample_writer, callbacks::writer& diagnostic_writer,
+    const util::run_options& options = util::run_options()) {
+  if (options.profiles)
+    options.profiles->begin();
+  stan::rng_t rng = util::create_rng(random_seed, chain);
 
   std::vector<int> disc_vector;
   std::vector<double> cont_vector = util::initialize(
       model, init, rng, init_radius, true, logger, init_writer);
+  if (options.startup)
+    options.startup->record("initialize");
 
   Eigen::VectorXd inv_metric;
   try {
@@ -79,7 +106,8 @@ int hmc_nuts_diag_e_adapt(
     return error_codes::CONFIG;
   }
 
-  stan::mcmc::adapt_diag_e_nuts<Model, boost::ecuyer1988> sampler(model, rng);
+  stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t, Integrator>
+      sampler(model, rng);
 
   sampler.set_metric(inv_metric);
   sampler.set_nominal_stepsize(stepsize);
@@ -94,10 +122,19 @@ int hmc_nuts_diag_e_adapt(
 
   sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
                             logger);
+  sampler.set_convergence_tolerance(options.adapt_tolerance);
 
-  util::run_adaptive_sampler(
-      sampler, model, cont_vector, num_warmup, num_samples, num_thin, refresh,
-      save_warmup, rng, interrupt, logger, sample_writer, diagnostic_writer);
+  try {
+    util::run_adaptive_sampler(sampler, model, cont_vector, num_warmup,
+                               num_samples, num_thin, refresh, save_warmup,
+                               rng, interrupt, logger, sample_writer,
+                               diagnostic_writer, 1, 1, options);
+  } catch (const std::invalid_argument& e) {
+    logger.error(e.what());
+    return error_codes::CONFIG;
+  }
+  if (options.profiles)
+    options.profiles->write();
 
   return error_codes::OK;
 }
@@ -154,6 +191,291 @@ int hmc_nuts_diag_e_adapt(
       interrupt, logger, init_writer, sample_writer, diagnostic_writer);
 }
 
+/**
+ * Runs multiple chains of HMC with NUTS with adaptation using diagonal
+ * Euclidean metric with a pre-specified Euclidean metric.
+ *
+ * The chains share the model instance and its data and are run in
+ * parallel on the TBB thread pool. Each chain gets its own random number
+ * generator created from the random seed and its chain id, so that the
+ * output of chain <code>init_chain_id + i</code> matches the output of
+ * a single chain run with that chain id. Because the interrupt and the
+ * logger are shared by all chains, they must be safe to call from
+ * multiple threads.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitInvContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in parallel.
+ *   <code>init</code>, <code>init_inv_metric</code>,
+ *   <code>init_writer</code>, <code>sample_writer</code>, and
+ *   <code>diagnostic_writer</code> must be the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] init_inv_metric An std vector of var contexts exposing an
+ *   initial diagonal inverse Euclidean metric for each chain (must be
+ *   positive definite)
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @param[in] cross_chain_adapt if true, the metric is estimated from the
+ *   pooled warmup draws of all chains at the end of each adaptation
+ *   window and shared by every chain
+ * @param[in] options options of the run, of which these apply to the
+ *   chains together: the placement of the chains' threads on cores or
+ *   NUMA nodes; the communicator connecting the processes of a run
+ *   whose chains are spread over several processes, where each process
+ *   passes its own chains, with <code>init_chain_id</code> the id of
+ *   its first chain, and the chains adapt across processes as with
+ *   <code>cross_chain_adapt</code>; the online diagnostics the draws
+ *   after warmup of jointly adapted chains are added to, which with a
+ *   communicator log the split R-hat and ESS across the chains of all
+ *   processes at the end; and the division of the threads between the
+ *   chains and the parallelism within them for chains adapting
+ *   independently. The other options belong to a single chain and are
+ *   only used when there is one chain in one process.
+ * @return error_codes::OK if successful, error_codes::CONFIG if the
+ *   thread budget is for another number of chains
+ */
+template <class Model, typename InitContextPtr, typename InitInvContextPtr,
+          typename InitWriter, typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e_adapt(
+    Model& model, size_t num_chains, const std::vector<InitContextPtr>& init,
+    const std::vector<InitInvContextPtr>& init_inv_metric,
+    unsigned int random_seed, unsigned int init_chain_id, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double stepsize_jitter, int max_depth,
+    double delta, double gamma, double kappa, double t0,
+    unsigned int init_buffer, unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer,
+    bool cross_chain_adapt = false,
+    const util::run_options& options = util::run_options()) {
+  if (num_chains == 1 && !options.communicator) {
+    return hmc_nuts_diag_e_adapt(
+        model, *init[0], *init_inv_metric[0], random_seed, init_chain_id,
+        init_radius, num_warmup, num_samples, num_thin, save_warmup, refresh,
+        stepsize, stepsize_jitter, max_depth, delta, gamma, kappa, t0,
+        init_buffer, term_buffer, window, interrupt, logger, init_writer[0],
+        sample_writer[0], diagnostic_writer[0], options);
+  }
+  const util::chain_placement* placement = options.placement;
+  const util::thread_budget* threads = options.threads;
+  using sampler_t = stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t>;
+
+  // The samplers hold references to their generators, so neither vector
+  // may reallocate once the first sampler has been constructed
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_chains);
+  std::vector<std::vector<double>> cont_vectors;
+  cont_vectors.reserve(num_chains);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_chains);
+  for (size_t i = 0; i < num_chains; ++i) {
+    rngs.emplace_back(util::create_rng(random_seed, init_chain_id + i));
+    cont_vectors.emplace_back(util::initialize(
+        model, *init[i], rngs[i], init_radius, true, logger, init_writer[i]));
+
+    Eigen::VectorXd inv_metric;
+    try {
+      inv_metric = util::read_diag_inv_metric(*init_inv_metric[i],
+                                              model.num_params_r(), logger);
+      util::validate_diag_inv_metric(inv_metric, logger);
+    } catch (const std::domain_error& e) {
+      return error_codes::CONFIG;
+    }
+
+    samplers.emplace_back(model, rngs[i]);
+    sampler_t& sampler = samplers.back();
+    sampler.set_metric(inv_metric);
+    sampler.set_nominal_stepsize(stepsize);
+    sampler.set_stepsize_jitter(stepsize_jitter);
+    sampler.set_max_depth(max_depth);
+
+    sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize));
+    sampler.get_stepsize_adaptation().set_delta(delta);
+    sampler.get_stepsize_adaptation().set_gamma(gamma);
+    sampler.get_stepsize_adaptation().set_kappa(kappa);
+    sampler.get_stepsize_adaptation().set_t0(t0);
+
+    sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
+                              logger);
+  }
+
+  if (placement)
+    placement->log(num_chains, logger);
+  if (cross_chain_adapt || options.communicator) {
+    util::run_cross_chain_adaptive_sampler(
+        samplers, model, cont_vectors, num_warmup, num_samples, num_thin,
+        refresh, save_warmup, rngs, interrupt, logger, sample_writer,
+        diagnostic_writer, init_chain_id, options);
+    return error_codes::OK;
+  }
+
+  if (threads) {
+    if (threads->num_chains() != num_chains) {
+      logger.error("The thread budget is for "
+                   + std::to_string(threads->num_chains()) + " chains, not "
+                   + std::to_string(num_chains));
+      return error_codes::CONFIG;
+    }
+    threads->log(logger);
+    threads->for_each_chain(
+        [&](size_t i) {
+          util::run_adaptive_sampler(
+              samplers[i], model, cont_vectors[i], num_warmup, num_samples,
+              num_thin, refresh, save_warmup, rngs[i], interrupt, logger,
+              sample_writer[i], diagnostic_writer[i], init_chain_id + i,
+              num_chains);
+        },
+        placement);
+    return error_codes::OK;
+  }
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_chains, 1),
+      [num_warmup, num_samples, num_thin, refresh, save_warmup, num_chains,
+       init_chain_id, placement, &samplers, &model, &rngs, &interrupt,
+       &logger, &sample_writer, &cont_vectors,
+       &diagnostic_writer](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          util::chain_placement::scope pin(placement, i);
+          util::run_adaptive_sampler(
+              samplers[i], model, cont_vectors[i], num_warmup, num_samples,
+              num_thin, refresh, save_warmup, rngs[i], interrupt, logger,
+              sample_writer[i], diagnostic_writer[i], init_chain_id + i,
+              num_chains);
+        }
+      },
+      tbb::simple_partitioner());
+  return error_codes::OK;
+}
+
+/**
+ * Runs multiple chains of HMC with NUTS with adaptation using diagonal
+ * Euclidean metric, starting each chain from the unit metric.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_chains The number of chains to run in parallel.
+ *   <code>init</code>, <code>init_writer</code>,
+ *   <code>sample_writer</code>, and <code>diagnostic_writer</code> must be
+ *   the same length as this value.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each chain.
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of chain <code>i</code> is advanced by
+ *   <code>init_chain_id + i</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each chain.
+ * @param[in] cross_chain_adapt if true, the metric is estimated from the
+ *   pooled warmup draws of all chains at the end of each adaptation
+ *   window and shared by every chain
+ * @param[in] options options of the run, of which these apply to the
+ *   chains together: the placement of the chains' threads on cores or
+ *   NUMA nodes; the communicator connecting the processes of a run
+ *   whose chains are spread over several processes, where each process
+ *   passes its own chains, with <code>init_chain_id</code> the id of
+ *   its first chain, and the chains adapt across processes as with
+ *   <code>cross_chain_adapt</code>; the online diagnostics the draws
+ *   after warmup of jointly adapted chains are added to, which with a
+ *   communicator log the split R-hat and ESS across the chains of all
+ *   processes at the end; and the division of the threads between the
+ *   chains and the parallelism within them for chains adapting
+ *   independently. The other options belong to a single chain and are
+ *   only used when there is one chain in one process.
+ * @return error_codes::OK if successful, error_codes::CONFIG if the
+ *   thread budget is for another number of chains
+ */
+template <class Model, typename InitContextPtr, typename InitWriter,
+          typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e_adapt(
+    Model& model, size_t num_chains, const std::vector<InitContextPtr>& init,
+    unsigned int random_seed, unsigned int init_chain_id, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double stepsize_jitter, int max_depth,
+    double delta, double gamma, double kappa, double t0,
+    unsigned int init_buffer, unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer,
+    bool cross_chain_adapt = false,
+    const util::run_options& options = util::run_options()) {
+  stan::io::dump dmp
+      = util::create_unit_e_diag_inv_metric(model.num_params_r());
+  std::vector<const stan::io::var_context*> unit_e_metrics(num_chains, &dmp);
+  return hmc_nuts_diag_e_adapt(
+      model, num_chains, init, unit_e_metrics, random_seed, init_chain_id,
+      init_radius, num_warmup, num_samples, num_thin, save_warmup, refresh,
+      stepsize, stepsize_jitter, max_depth, delta, gamma, kappa, t0,
+      init_buffer, term_buffer, window, interrupt, logger, init_writer,
+      sample_writer, diagnostic_writer, cross_chain_adapt, options);
+}
+
 }  // namespace sample
 }  // namespace services
 }  // namespace stan
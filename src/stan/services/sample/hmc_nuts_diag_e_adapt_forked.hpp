@@ -0,0 +1,242 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_ADAPT_FORKED_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_ADAPT_FORKED_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/create_unit_e_diag_inv_metric.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/inv_metric.hpp>
+#include <stan/services/util/run_forked_sampler.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs HMC with NUTS and an adapted diagonal Euclidean metric, warming
+ * up <code>num_warmup_chains</code> chains and forking them into
+ * <code>num_chains</code> sampling chains that all run in parallel. The
+ * sampling chains take over the step size, metric and last point of
+ * their warmup chain, so warmup costs are paid once per warmup chain.
+ * See <code>stan::services::util::run_forked_sampler</code>.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitInvContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_warmup_chains number of chains to warm up, between 1
+ *   and <code>num_chains</code>. <code>init</code>,
+ *   <code>init_inv_metric</code> and <code>init_writer</code> must be
+ *   this long.
+ * @param[in] num_chains number of sampling chains.
+ *   <code>sample_writer</code> and <code>diagnostic_writer</code> must be
+ *   this long.
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each warmup chain.
+ * @param[in] init_inv_metric An std vector of var contexts exposing an
+ *   initial diagonal inverse Euclidean metric for each warmup chain (must
+ *   be positive definite)
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id. The pseudo random number
+ *   generator of sampling chain <code>k</code> is advanced by
+ *   <code>init_chain_id + k</code> and that of warmup chain
+ *   <code>w</code> by <code>init_chain_id + num_chains + w</code>
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples of each sampling chain
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each warmup chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each
+ *   sampling chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each sampling chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitInvContextPtr,
+          typename InitWriter, typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e_adapt_forked(
+    Model& model, size_t num_warmup_chains, size_t num_chains,
+    const std::vector<InitContextPtr>& init,
+    const std::vector<InitInvContextPtr>& init_inv_metric,
+    unsigned int random_seed, unsigned int init_chain_id, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double stepsize_jitter, int max_depth,
+    double delta, double gamma, double kappa, double t0,
+    unsigned int init_buffer, unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  using sampler_t = stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t>;
+
+  if (num_warmup_chains < 1 || num_warmup_chains > num_chains) {
+    logger.error(
+        "The number of warmup chains must be between 1 and the number of "
+        "chains.");
+    return error_codes::CONFIG;
+  }
+
+  // The samplers hold references to their generators, so neither vector
+  // may reallocate once the first sampler has been constructed
+  std::vector<stan::rng_t> warmup_rngs;
+  warmup_rngs.reserve(num_warmup_chains);
+  std::vector<std::vector<double>> cont_vectors;
+  cont_vectors.reserve(num_warmup_chains);
+  std::vector<sampler_t> warmup_samplers;
+  warmup_samplers.reserve(num_warmup_chains);
+  for (size_t w = 0; w < num_warmup_chains; ++w) {
+    warmup_rngs.emplace_back(
+        util::create_rng(random_seed, init_chain_id + num_chains + w));
+    cont_vectors.emplace_back(util::initialize(model, *init[w], warmup_rngs[w],
+                                               init_radius, true, logger,
+                                               init_writer[w]));
+
+    Eigen::VectorXd inv_metric;
+    try {
+      inv_metric = util::read_diag_inv_metric(*init_inv_metric[w],
+                                              model.num_params_r(), logger);
+      util::validate_diag_inv_metric(inv_metric, logger);
+    } catch (const std::domain_error& e) {
+      return error_codes::CONFIG;
+    }
+
+    warmup_samplers.emplace_back(model, warmup_rngs[w]);
+    sampler_t& sampler = warmup_samplers.back();
+    sampler.set_metric(inv_metric);
+    sampler.set_nominal_stepsize(stepsize);
+    sampler.set_stepsize_jitter(stepsize_jitter);
+    sampler.set_max_depth(max_depth);
+
+    sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize));
+    sampler.get_stepsize_adaptation().set_delta(delta);
+    sampler.get_stepsize_adaptation().set_gamma(gamma);
+    sampler.get_stepsize_adaptation().set_kappa(kappa);
+    sampler.get_stepsize_adaptation().set_t0(t0);
+
+    sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
+                              logger);
+  }
+
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_chains);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_chains);
+  for (size_t k = 0; k < num_chains; ++k) {
+    rngs.emplace_back(util::create_rng(random_seed, init_chain_id + k));
+    samplers.emplace_back(model, rngs[k]);
+  }
+
+  util::run_forked_sampler(warmup_samplers, samplers, model, cont_vectors,
+                           num_warmup, num_samples, num_thin, refresh,
+                           save_warmup, warmup_rngs, rngs, interrupt, logger,
+                           sample_writer, diagnostic_writer, init_chain_id);
+  return error_codes::OK;
+}
+
+/**
+ * Runs HMC with NUTS and an adapted diagonal Euclidean metric, warming
+ * up <code>num_warmup_chains</code> chains from the unit metric and
+ * forking them into <code>num_chains</code> sampling chains.
+ *
+ * @tparam Model Model class
+ * @tparam InitContextPtr A pointer with underlying type derived from
+ *   <code>stan::io::var_context</code>
+ * @tparam InitWriter A type derived from <code>stan::callbacks::writer</code>
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_warmup_chains number of chains to warm up, between 1
+ *   and <code>num_chains</code>
+ * @param[in] num_chains number of sampling chains
+ * @param[in] init An std vector of init var contexts for initialization of
+ *   each warmup chain.
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] init_chain_id first chain id
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples of each sampling chain
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer std vector of Writer callbacks for
+ *   unconstrained inits of each warmup chain.
+ * @param[in,out] sample_writer std vector of Writers for draws of each
+ *   sampling chain.
+ * @param[in,out] diagnostic_writer std vector of Writers for diagnostic
+ *   information of each sampling chain.
+ * @return error_codes::OK if successful
+ */
+template <class Model, typename InitContextPtr, typename InitWriter,
+          typename SampleWriter, typename DiagnosticWriter>
+int hmc_nuts_diag_e_adapt_forked(
+    Model& model, size_t num_warmup_chains, size_t num_chains,
+    const std::vector<InitContextPtr>& init, unsigned int random_seed,
+    unsigned int init_chain_id, double init_radius, int num_warmup,
+    int num_samples, int num_thin, bool save_warmup, int refresh,
+    double stepsize, double stepsize_jitter, int max_depth, double delta,
+    double gamma, double kappa, double t0, unsigned int init_buffer,
+    unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<InitWriter>& init_writer,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer) {
+  stan::io::dump dmp
+      = util::create_unit_e_diag_inv_metric(model.num_params_r());
+  std::vector<const stan::io::var_context*> unit_e_metrics(num_warmup_chains,
+                                                           &dmp);
+  return hmc_nuts_diag_e_adapt_forked(
+      model, num_warmup_chains, num_chains, init, unit_e_metrics, random_seed,
+      init_chain_id, init_radius, num_warmup, num_samples, num_thin,
+      save_warmup, refresh, stepsize, stepsize_jitter, max_depth, delta, gamma,
+      kappa, t0, init_buffer, term_buffer, window, interrupt, logger,
+      init_writer, sample_writer, diagnostic_writer);
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
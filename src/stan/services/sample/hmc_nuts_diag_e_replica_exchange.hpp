@@ -0,0 +1,154 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_REPLICA_EXCHANGE_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_REPLICA_EXCHANGE_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/mcmc/replica_exchange.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/inv_metric.hpp>
+#include <stan/services/util/run_replica_exchange_sampler.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs replica exchange (parallel tempering) of HMC with NUTS and an
+ * adapted diagonal Euclidean metric, for posteriors with several modes
+ * that a single chain does not move between.
+ *
+ * There are <code>num_temps</code> replicas, each sampling the posterior
+ * raised to the power of its inverse temperature, on a ladder that goes
+ * geometrically from 1 down to <code>beta_min</code> and is adapted
+ * during warmup so that swaps between adjacent temperatures are
+ * accepted about 23% of the time. The replicas run in parallel and
+ * adjacent replicas propose to exchange their states every
+ * <code>swap_interval</code> iterations. Each replica adapts its own
+ * step size and metric during warmup. Only the draws of the replica at
+ * inverse temperature 1 are written; the tempered replicas are
+ * initialized from the same var context with their own random numbers.
+ * See <code>stan::services::util::run_replica_exchange_sampler</code>.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_temps number of temperatures, at least 1
+ * @param[in] init var context for initialization
+ * @param[in] init_inv_metric var context exposing an initial diagonal
+ *   inverse Euclidean metric (must be positive definite), used by every
+ *   replica
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator.
+ *   The replica at temperature <code>k</code> uses the generator of chain
+ *   <code>chain * num_temps + k</code>, and the swaps that of chain
+ *   <code>chain * num_temps + num_temps</code>.
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in] beta_min smallest initial inverse temperature, in (0, 1]
+ * @param[in] swap_interval number of iterations between swap proposals
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits of
+ *   the replica at inverse temperature 1
+ * @param[in,out] sample_writer Writer for draws at inverse temperature 1
+ * @param[in,out] diagnostic_writer Writer for diagnostic information at
+ *   inverse temperature 1
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int hmc_nuts_diag_e_replica_exchange(
+    Model& model, size_t num_temps, const stan::io::var_context& init,
+    const stan::io::var_context& init_inv_metric, unsigned int random_seed,
+    unsigned int chain, double init_radius, int num_warmup, int num_samples,
+    int num_thin, bool save_warmup, int refresh, double stepsize,
+    double stepsize_jitter, int max_depth, double delta, double gamma,
+    double kappa, double t0, unsigned int init_buffer,
+    unsigned int term_buffer, unsigned int window, double beta_min,
+    int swap_interval, callbacks::interrupt& interrupt,
+    callbacks::logger& logger, callbacks::writer& init_writer,
+    callbacks::writer& sample_writer, callbacks::writer& diagnostic_writer) {
+  using sampler_t = stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t>;
+
+  if (num_temps < 1 || !(beta_min > 0 && beta_min <= 1)) {
+    logger.error(
+        "The number of temperatures must be positive and the smallest "
+        "inverse temperature must be in (0, 1].");
+    return error_codes::CONFIG;
+  }
+  stan::mcmc::replica_exchange ladder(num_temps, beta_min);
+
+  Eigen::VectorXd inv_metric;
+  try {
+    inv_metric = util::read_diag_inv_metric(init_inv_metric,
+                                            model.num_params_r(), logger);
+    util::validate_diag_inv_metric(inv_metric, logger);
+  } catch (const std::domain_error& e) {
+    return error_codes::CONFIG;
+  }
+
+  // The samplers hold references to their generators, so neither vector
+  // may reallocate once the first sampler has been constructed
+  callbacks::writer silent_writer;
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_temps);
+  std::vector<std::vector<double>> cont_vectors;
+  cont_vectors.reserve(num_temps);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_temps);
+  for (size_t k = 0; k < num_temps; ++k) {
+    rngs.emplace_back(util::create_rng(random_seed, chain * num_temps + k));
+    cont_vectors.emplace_back(
+        util::initialize(model, init, rngs[k], init_radius, k == 0, logger,
+                         k == 0 ? init_writer : silent_writer));
+
+    samplers.emplace_back(model, rngs[k]);
+    sampler_t& sampler = samplers.back();
+    sampler.set_metric(inv_metric);
+    sampler.set_nominal_stepsize(stepsize);
+    sampler.set_stepsize_jitter(stepsize_jitter);
+    sampler.set_max_depth(max_depth);
+
+    sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize));
+    sampler.get_stepsize_adaptation().set_delta(delta);
+    sampler.get_stepsize_adaptation().set_gamma(gamma);
+    sampler.get_stepsize_adaptation().set_kappa(kappa);
+    sampler.get_stepsize_adaptation().set_t0(t0);
+
+    sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
+                              logger);
+  }
+  stan::rng_t swap_rng
+      = util::create_rng(random_seed, chain * num_temps + num_temps);
+
+  util::run_replica_exchange_sampler(
+      samplers, model, cont_vectors, num_warmup, num_samples, num_thin,
+      refresh, save_warmup, rngs, swap_rng, ladder, swap_interval, interrupt,
+      logger, sample_writer, diagnostic_writer);
+  return error_codes::OK;
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
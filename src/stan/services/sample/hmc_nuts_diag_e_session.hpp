@@ -0,0 +1,342 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_SESSION_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_SESSION_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/create_model.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <stan/services/util/run_sampler.hpp>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * A long-lived NUTS chain with a diagonal Euclidean metric for a model
+ * whose data changes a little at a time, such as a model refit
+ * whenever new observations arrive.
+ *
+ * The session owns the model, a copy of its data, the random number
+ * generator, the adapted step size and metric and the last draw. The
+ * first call to <code>sample()</code> runs the usual windowed
+ * adaptation of the step size and the metric. Later calls start from
+ * the last draw with the adapted metric, and their warmup, which can be
+ * much shorter, only re-adapts the step size by dual averaging from the
+ * adapted step size, as <code>hmc_nuts_diag_e_warm_start()</code> does.
+ *
+ * <code>update_data()</code> replaces some of the data variables.
+ * Generated models read all their data in their constructor, so the
+ * model is constructed again from the updated data, but the chain
+ * carries over: the last draw is moved to the new model through its
+ * constrained values and the adaptation is kept. If the update changes
+ * the number of unconstrained parameters, the chain is initialized
+ * again and the next call to <code>sample()</code> runs a full
+ * adaptation.
+ *
+ * @tparam Model Model class, constructible from its data, a seed and a
+ *   message stream
+ */
+template <class Model>
+class hmc_nuts_diag_e_session {
+ public:
+  /**
+   * Construct the model from its data and initialize the chain.
+   *
+   * @param[in] data data of the model
+   * @param[in] init initial values of the parameters
+   * @param[in] random_seed random seed, also the seed of the transformed
+   *   data block
+   * @param[in] chain chain id to advance the pseudo random number
+   *   generator
+   * @param[in] init_radius radius to initialize
+   * @param[in,out] logger Logger for messages
+   * @param[in,out] init_writer Writer callback for unconstrained inits
+   * @throw std::domain_error if the model can't be initialized
+   * @throw any exception thrown by the model's constructor
+   */
+  hmc_nuts_diag_e_session(const io::var_context& data,
+                          const io::var_context& init,
+                          unsigned int random_seed, unsigned int chain,
+                          double init_radius, callbacks::logger& logger,
+                          callbacks::writer& init_writer)
+      : data_(copy_data(data, io::empty_var_context())),
+        random_seed_(random_seed),
+        init_radius_(init_radius),
+        rng_(util::create_rng(random_seed, chain)),
+        model_(util::create_model<Model>(data_, random_seed, "", logger)),
+        adapted_(false),
+        stepsize_(1),
+        stepsize_jitter_(0),
+        max_depth_(10),
+        delta_(0.8),
+        gamma_(0.05),
+        kappa_(0.75),
+        t0_(10),
+        init_buffer_(75),
+        term_buffer_(50),
+        window_(25) {
+    cont_vector_ = util::initialize(*model_, init, rng_, init_radius, true,
+                                    logger, init_writer);
+    inv_metric_ = Eigen::VectorXd::Ones(model_->num_params_r());
+  }
+
+  /**
+   * Set the NUTS configuration.
+   *
+   * @param[in] stepsize_jitter uniform random jitter of stepsize
+   * @param[in] max_depth Maximum tree depth
+   */
+  void set_nuts(double stepsize_jitter, int max_depth) {
+    stepsize_jitter_ = stepsize_jitter;
+    max_depth_ = max_depth;
+  }
+
+  /**
+   * Set the adaptation configuration.
+   *
+   * @param[in] delta adaptation target acceptance statistic
+   * @param[in] gamma adaptation regularization scale
+   * @param[in] kappa adaptation relaxation exponent
+   * @param[in] t0 adaptation iteration offset
+   * @param[in] init_buffer width of initial fast adaptation interval
+   * @param[in] term_buffer width of final fast adaptation interval
+   * @param[in] window initial width of slow adaptation interval
+   */
+  void set_adaptation(double delta, double gamma, double kappa, double t0,
+                      unsigned int init_buffer, unsigned int term_buffer,
+                      unsigned int window) {
+    delta_ = delta;
+    gamma_ = gamma;
+    kappa_ = kappa;
+    t0_ = t0;
+    init_buffer_ = init_buffer;
+    term_buffer_ = term_buffer;
+    window_ = window;
+  }
+
+  /**
+   * Continue the chain with warmup followed by sampling. The warmup of
+   * the first call adapts the step size and the metric; that of later
+   * calls only re-adapts the step size, and may be zero to keep it.
+   *
+   * @param[in] num_warmup Number of warmup iterations
+   * @param[in] num_samples Number of samples
+   * @param[in] num_thin Number to thin the samples
+   * @param[in] save_warmup Indicates whether to save the warmup iterations
+   * @param[in] refresh Controls the output
+   * @param[in,out] interrupt Callback for interrupts
+   * @param[in,out] logger Logger for messages
+   * @param[in,out] sample_writer Writer for draws
+   * @param[in,out] diagnostic_writer Writer for diagnostic information
+   * @return error_codes::OK if successful, error_codes::CONFIG if the
+   *   configuration is invalid
+   */
+  int sample(int num_warmup, int num_samples, int num_thin, bool save_warmup,
+             int refresh, callbacks::interrupt& interrupt,
+             callbacks::logger& logger, callbacks::writer& sample_writer,
+             callbacks::writer& diagnostic_writer) {
+    stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t> sampler(*model_, rng_);
+
+    sampler.set_metric(inv_metric_);
+    sampler.set_nominal_stepsize(stepsize_);
+    sampler.set_stepsize_jitter(stepsize_jitter_);
+    sampler.set_max_depth(max_depth_);
+
+    sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize_));
+    sampler.get_stepsize_adaptation().set_delta(delta_);
+    sampler.get_stepsize_adaptation().set_gamma(gamma_);
+    sampler.get_stepsize_adaptation().set_kappa(kappa_);
+    sampler.get_stepsize_adaptation().set_t0(t0_);
+
+    // Once adapted, the window parameters are left unset, so the
+    // variance adaptation never opens a window and only the step size
+    // is adapted
+    if (!adapted_)
+      sampler.set_window_params(num_warmup, init_buffer_, term_buffer_,
+                                window_, logger);
+
+    try {
+      if (num_warmup == 0 && adapted_)
+        util::run_sampler(sampler, *model_, cont_vector_, 0, num_samples,
+                          num_thin, refresh, save_warmup, rng_, interrupt,
+                          logger, sample_writer, diagnostic_writer);
+      else
+        util::run_adaptive_sampler(sampler, *model_, cont_vector_,
+                                   num_warmup, num_samples, num_thin, refresh,
+                                   save_warmup, rng_, interrupt, logger,
+                                   sample_writer, diagnostic_writer);
+    } catch (const std::invalid_argument& e) {
+      logger.error(e.what());
+      return error_codes::CONFIG;
+    }
+
+    const Eigen::VectorXd& q = sampler.z().q;
+    cont_vector_.assign(q.data(), q.data() + q.size());
+    inv_metric_ = sampler.z().inv_e_metric_;
+    stepsize_ = sampler.get_nominal_stepsize();
+    adapted_ = adapted_ || num_warmup > 0;
+    return error_codes::OK;
+  }
+
+  /**
+   * Replace data variables and construct the model again, keeping the
+   * chain. Variables of the update that aren't in the data are added.
+   * If the constructor throws or the chain can't be initialized for the
+   * new model, the session is left unchanged.
+   *
+   * @param[in] update new values of some of the data variables
+   * @param[in,out] logger Logger for messages
+   * @return error_codes::OK if successful, error_codes::DATAERR if the
+   *   model can't be constructed from the updated data,
+   *   error_codes::CONFIG if no initial values are found for it
+   */
+  int update_data(const io::var_context& update, callbacks::logger& logger) {
+    io::array_var_context data = copy_data(update, data_);
+    std::unique_ptr<Model> model;
+    try {
+      model = util::create_model<Model>(data, random_seed_, "", logger);
+    } catch (const std::exception& e) {
+      logger.error(e.what());
+      return error_codes::DATAERR;
+    }
+
+    callbacks::writer init_writer;
+    io::empty_var_context no_init;
+    bool same_params = model->num_params_r() == model_->num_params_r();
+    bool reinitialize = !same_params;
+    std::vector<double> cont_vector;
+    if (same_params) {
+      std::vector<std::string> param_names;
+      std::vector<std::vector<size_t>> param_dimss;
+      get_model_parameters(*model_, param_names, param_dimss);
+      std::vector<int> params_i;
+      std::vector<double> constrained;
+      model_->write_array(rng_, cont_vector_, params_i, constrained, false,
+                          false);
+      io::array_var_context init(param_names, constrained, param_dimss);
+      try {
+        cont_vector = util::initialize(*model, init, rng_, 0, false, logger,
+                                       init_writer);
+      } catch (const std::exception& e) {
+        logger.info("The last draw isn't valid for the updated data.");
+        reinitialize = true;
+      }
+    } else {
+      logger.info(
+          "The number of parameters changed, the adaptation starts over.");
+    }
+    if (reinitialize) {
+      try {
+        cont_vector = util::initialize(*model, no_init, rng_, init_radius_,
+                                       false, logger, init_writer);
+      } catch (const std::exception& e) {
+        logger.error(e.what());
+        return error_codes::CONFIG;
+      }
+    }
+    if (!same_params) {
+      inv_metric_ = Eigen::VectorXd::Ones(model->num_params_r());
+      stepsize_ = 1;
+      adapted_ = false;
+    }
+    cont_vector_ = std::move(cont_vector);
+    data_ = std::move(data);
+    model_ = std::move(model);
+    return error_codes::OK;
+  }
+
+  const Model& model() const { return *model_; }
+
+  /**
+   * Return the unconstrained parameters of the last draw.
+   */
+  const std::vector<double>& last_draw() const { return cont_vector_; }
+
+  const Eigen::VectorXd& inv_metric() const { return inv_metric_; }
+
+  double stepsize() const { return stepsize_; }
+
+  /**
+   * Return true once the step size and metric have been adapted.
+   */
+  bool adapted() const { return adapted_; }
+
+ private:
+  io::array_var_context data_;
+  unsigned int random_seed_;
+  double init_radius_;
+  stan::rng_t rng_;
+  std::unique_ptr<Model> model_;
+  std::vector<double> cont_vector_;
+  Eigen::VectorXd inv_metric_;
+  bool adapted_;
+  double stepsize_;
+  double stepsize_jitter_;
+  int max_depth_;
+  double delta_;
+  double gamma_;
+  double kappa_;
+  double t0_;
+  unsigned int init_buffer_;
+  unsigned int term_buffer_;
+  unsigned int window_;
+
+  /**
+   * Copy the variables of two contexts into one, taking those defined
+   * in both from the first.
+   */
+  static io::array_var_context copy_data(const io::var_context& first,
+                                         const io::var_context& second) {
+    std::vector<std::string> names_r, names_i;
+    std::vector<double> values_r;
+    std::vector<int> values_i;
+    std::vector<std::vector<size_t>> dims_r, dims_i;
+    std::set<std::string> seen;
+    for (const io::var_context* context : {&first, &second}) {
+      std::vector<std::string> names;
+      context->names_i(names);
+      for (const std::string& name : names) {
+        if (!seen.insert(name).second)
+          continue;
+        std::vector<int> values = context->vals_i(name);
+        names_i.push_back(name);
+        values_i.insert(values_i.end(), values.begin(), values.end());
+        dims_i.push_back(context->dims_i(name));
+      }
+      names.clear();
+      context->names_r(names);
+      for (const std::string& name : names) {
+        if (!seen.insert(name).second)
+          continue;
+        std::vector<double> values = context->vals_r(name);
+        names_r.push_back(name);
+        values_r.insert(values_r.end(), values.begin(), values.end());
+        dims_r.push_back(context->dims_r(name));
+      }
+    }
+    return io::array_var_context(names_r, values_r, dims_r, names_i,
+                                 values_i, dims_i);
+  }
+};
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
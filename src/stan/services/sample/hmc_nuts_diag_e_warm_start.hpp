@@ -0,0 +1,127 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_WARM_START_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_DIAG_E_WARM_START_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <stan/services/util/run_sampler.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/services/util/inv_metric.hpp>
+#include <stan/services/util/warm_start.hpp>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs HMC with NUTS using diagonal Euclidean metric, starting from the
+ * last draw, the step size and the metric of a previous run of the same
+ * model.
+ *
+ * The metric of the previous run is kept as is. When
+ * <code>num_warmup</code> is positive, only the step size is
+ * re-adapted during warmup, by dual averaging from the previous step
+ * size; no metric adaptation windows are run. With no warmup the
+ * previous step size is used unchanged.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] previous output of the previous run, as read by
+ *   <code>stan::io::stan_csv_reader::parse</code>
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] num_warmup Number of step size re-adaptation iterations,
+ *   which may be zero
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @return error_codes::OK if successful, error_codes::CONFIG if the
+ *   previous run doesn't match the model
+ */
+template <class Model>
+int hmc_nuts_diag_e_warm_start(
+    Model& model, const stan::io::stan_csv& previous, unsigned int random_seed,
+    unsigned int chain, int num_warmup, int num_samples, int num_thin,
+    bool save_warmup, int refresh, double stepsize_jitter, int max_depth,
+    double delta, double gamma, double kappa, double t0,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    callbacks::writer& init_writer, callbacks::writer& sample_writer,
+    callbacks::writer& diagnostic_writer) {
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<double> last_draw;
+  Eigen::VectorXd inv_metric;
+  double stepsize;
+  try {
+    last_draw = util::read_last_draw(model, previous, logger);
+    inv_metric = util::read_adapted_diag_inv_metric(
+        previous.adaptation, model.num_params_r(), logger);
+    util::validate_diag_inv_metric(inv_metric, logger);
+    stepsize = util::read_adapted_stepsize(previous.adaptation, logger);
+  } catch (const std::domain_error& e) {
+    return error_codes::CONFIG;
+  }
+
+  std::vector<std::string> param_names;
+  std::vector<std::vector<size_t>> param_dimss;
+  get_model_parameters(model, param_names, param_dimss);
+  stan::io::array_var_context init(param_names, last_draw, param_dimss);
+  std::vector<double> cont_vector
+      = util::initialize(model, init, rng, 0, true, logger, init_writer);
+
+  stan::mcmc::adapt_diag_e_nuts<Model, stan::rng_t> sampler(model, rng);
+
+  sampler.set_metric(inv_metric);
+  sampler.set_nominal_stepsize(stepsize);
+  sampler.set_stepsize_jitter(stepsize_jitter);
+  sampler.set_max_depth(max_depth);
+
+  if (num_warmup == 0) {
+    util::run_sampler(sampler, model, cont_vector, 0, num_samples, num_thin,
+                      refresh, save_warmup, rng, interrupt, logger,
+                      sample_writer, diagnostic_writer);
+    return error_codes::OK;
+  }
+
+  sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize));
+  sampler.get_stepsize_adaptation().set_delta(delta);
+  sampler.get_stepsize_adaptation().set_gamma(gamma);
+  sampler.get_stepsize_adaptation().set_kappa(kappa);
+  sampler.get_stepsize_adaptation().set_t0(t0);
+
+  // The window parameters are left unset, so the variance adaptation
+  // never opens a window and only the step size is adapted
+  util::run_adaptive_sampler(sampler, model, cont_vector, num_warmup,
+                             num_samples, num_thin, refresh, save_warmup, rng,
+                             interrupt, logger, sample_writer,
+                             diagnostic_writer);
+
+  return error_codes::OK;
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
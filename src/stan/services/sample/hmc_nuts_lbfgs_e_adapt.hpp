@@ -0,0 +1,125 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_NUTS_LBFGS_E_ADAPT_HPP
+#define STAN_SERVICES_SAMPLE_HMC_NUTS_LBFGS_E_ADAPT_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_lbfgs_e_nuts.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs HMC with NUTS with adaptation using a diagonal Euclidean metric,
+ * starting from the L-BFGS approximation of the inverse Hessian left by
+ * an optimization run, such as the history returned by
+ * <code>stan::services::optimize::lbfgs()</code>.
+ *
+ * The chain starts with a metric that is already shaped like the
+ * posterior near the mode, at O(n m) cost per gradient for n
+ * parameters and m updates, instead of the unit metric. At the end of
+ * the first slow adaptation window the L-BFGS updates are dropped and
+ * the adapted diagonal metric is used from there on. An optimization
+ * without the Jacobian adjustment approximates the Hessian of the
+ * penalized likelihood rather than of the sampled density, which is
+ * still a good starting metric when the constraining transforms are
+ * mild. An empty history starts from the unit metric.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] init var context for initialization, such as the optimum
+ * @param[in] qn_history L-BFGS history of an optimization of the model
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] num_warmup Number of warmup samples
+ * @param[in] num_samples Number of samples
+ * @param[in] num_thin Number to thin the samples
+ * @param[in] save_warmup Indicates whether to save the warmup iterations
+ * @param[in] refresh Controls the output
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] stepsize_jitter uniform random jitter of stepsize
+ * @param[in] max_depth Maximum tree depth
+ * @param[in] delta adaptation target acceptance statistic
+ * @param[in] gamma adaptation regularization scale
+ * @param[in] kappa adaptation relaxation exponent
+ * @param[in] t0 adaptation iteration offset
+ * @param[in] init_buffer width of initial fast adaptation interval
+ * @param[in] term_buffer width of final fast adaptation interval
+ * @param[in] window initial width of slow adaptation interval
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @return error_codes::OK if successful, error_codes::CONFIG if the
+ *   history doesn't match the model or isn't positive definite
+ */
+template <class Model>
+int hmc_nuts_lbfgs_e_adapt(
+    Model& model, const stan::io::var_context& init,
+    const stan::optimization::LBFGSUpdate<>& qn_history,
+    unsigned int random_seed, unsigned int chain, double init_radius,
+    int num_warmup, int num_samples, int num_thin, bool save_warmup,
+    int refresh, double stepsize, double stepsize_jitter, int max_depth,
+    double delta, double gamma, double kappa, double t0,
+    unsigned int init_buffer, unsigned int term_buffer, unsigned int window,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    callbacks::writer& init_writer, callbacks::writer& sample_writer,
+    callbacks::writer& diagnostic_writer) {
+  stan::rng_t rng = util::create_rng(random_seed, chain);
+
+  std::vector<int> disc_vector;
+  std::vector<double> cont_vector = util::initialize(
+      model, init, rng, init_radius, true, logger, init_writer);
+
+  stan::mcmc::adapt_lbfgs_e_nuts<Model, stan::rng_t> sampler(model, rng);
+
+  if (qn_history.history_size() > 0) {
+    Eigen::MatrixXd s, y;
+    qn_history.history(s, y);
+    try {
+      sampler.set_metric(
+          Eigen::VectorXd::Constant(model.num_params_r(), qn_history.gammak()),
+          s, y);
+    } catch (const std::exception& e) {
+      logger.error(e.what());
+      return error_codes::CONFIG;
+    }
+  } else {
+    logger.info("No L-BFGS history; starting from the unit metric");
+  }
+  sampler.set_nominal_stepsize(stepsize);
+  sampler.set_stepsize_jitter(stepsize_jitter);
+  sampler.set_max_depth(max_depth);
+
+  sampler.get_stepsize_adaptation().set_mu(log(10 * stepsize));
+  sampler.get_stepsize_adaptation().set_delta(delta);
+  sampler.get_stepsize_adaptation().set_gamma(gamma);
+  sampler.get_stepsize_adaptation().set_kappa(kappa);
+  sampler.get_stepsize_adaptation().set_t0(t0);
+
+  sampler.set_window_params(num_warmup, init_buffer, term_buffer, window,
+                            logger);
+
+  util::run_adaptive_sampler(
+      sampler, model, cont_vector, num_warmup, num_samples, num_thin, refresh,
+      save_warmup, rng, interrupt, logger, sample_writer, diagnostic_writer);
+
+  return error_codes::OK;
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,95 @@
+#ifndef STAN_SERVICES_SAMPLE_HMC_STATIC_DIAG_E_SMC_HPP
+#define STAN_SERVICES_SAMPLE_HMC_STATIC_DIAG_E_SMC_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/hmc/static/diag_e_static_hmc.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/run_smc_sampler.hpp>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace sample {
+
+/**
+ * Runs a sequential Monte Carlo sampler that tempers a population of
+ * particles from a normal reference density in the unconstrained space
+ * to the posterior, moving the particles with static HMC and a diagonal
+ * metric estimated from the population, and writes the final particles
+ * as draws followed by an estimate of the log marginal likelihood.
+ * The moves of the particles run in parallel. See
+ * <code>stan::services::util::run_smc_sampler</code>.
+ *
+ * @tparam Model Model class
+ * @param[in] model Input model to test (with data already instantiated)
+ * @param[in] num_particles number of particles, the number of draws
+ * @param[in] random_seed random seed for the random number generator
+ * @param[in] chain chain id to advance the pseudo random number generator.
+ *   Particle <code>i</code> uses the generator of chain
+ *   <code>chain * (num_particles + 1) + i + 1</code>, and the
+ *   resampling that of chain <code>chain * (num_particles + 1)</code>.
+ * @param[in] reference_scale standard deviation of the reference in
+ *   every unconstrained coordinate
+ * @param[in] ess_fraction fraction of the population the effective
+ *   sample size may drop to between resamplings, in (0, 1)
+ * @param[in] num_moves number of HMC transitions per particle after each
+ *   resampling
+ * @param[in] stepsize initial stepsize for discrete evolution
+ * @param[in] int_time integration time
+ * @param[in] delta target acceptance statistic of the moves
+ * @param[in] refresh Controls the output, in tempering steps
+ * @param[in,out] interrupt Callback for interrupts
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] sample_writer Writer for draws
+ * @param[in,out] diagnostic_writer Writer for diagnostic information
+ * @return error_codes::OK if successful
+ */
+template <class Model>
+int hmc_static_diag_e_smc(Model& model, size_t num_particles,
+                          unsigned int random_seed, unsigned int chain,
+                          double reference_scale, double ess_fraction,
+                          int num_moves, double stepsize, double int_time,
+                          double delta, int refresh,
+                          callbacks::interrupt& interrupt,
+                          callbacks::logger& logger,
+                          callbacks::writer& sample_writer,
+                          callbacks::writer& diagnostic_writer) {
+  using sampler_t = stan::mcmc::diag_e_static_hmc<Model, stan::rng_t>;
+
+  if (num_particles < 1 || !(reference_scale > 0)
+      || !(ess_fraction > 0 && ess_fraction < 1) || num_moves < 0) {
+    logger.error(
+        "Sequential Monte Carlo needs at least one particle, a positive "
+        "reference scale, an ESS fraction in (0, 1) and a non-negative "
+        "number of moves.");
+    return error_codes::CONFIG;
+  }
+
+  // The samplers hold references to their generators, so the generators
+  // may not reallocate once the first sampler has been constructed
+  const unsigned int first_chain = chain * (num_particles + 1);
+  stan::rng_t rng = util::create_rng(random_seed, first_chain);
+  std::vector<stan::rng_t> rngs;
+  rngs.reserve(num_particles);
+  std::vector<sampler_t> samplers;
+  samplers.reserve(num_particles);
+  for (size_t i = 0; i < num_particles; ++i) {
+    rngs.emplace_back(util::create_rng(random_seed, first_chain + i + 1));
+    samplers.emplace_back(model, rngs[i]);
+  }
+
+  util::run_smc_sampler(samplers, model, rngs, rng, reference_scale,
+                        ess_fraction, num_moves, stepsize, int_time, delta,
+                        refresh, interrupt, logger, sample_writer,
+                        diagnostic_writer);
+  return error_codes::OK;
+}
+
+}  // namespace sample
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,283 @@
+#ifndef STAN_SERVICES_SAMPLE_IMPORTANCE_REWEIGHT_HPP
+#define STAN_SERVICES_SAMPLE_IMPORTANCE_REWEIGHT_HPP
+
+#include <stan/analyze/mcmc/compute_psis_loo.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/row_var_context.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/model/evaluator_pool.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+
+/**
+ * Largest Pareto shape of the importance weights for which the
+ * reweighted draws of <code>importance_reweight()</code> are reliable.
+ */
+constexpr double importance_reweight_max_khat = 0.7;
+
+/**
+ * Update draws of a model to new data by Pareto smoothed importance
+ * sampling instead of running MCMC again. The importance ratio of a
+ * draw is the ratio of its density under the model with the new data
+ * to its density under the model it was drawn from, which is close to
+ * one for most draws when only a few observations change.
+ *
+ * The log densities under the new data are evaluated in parallel by a
+ * <code>stan::model::evaluator_pool</code>, as the
+ * <code>lp__</code> of the draws is, up to a constant, with the
+ * Jacobian; draws where the model throws get a weight of zero. The
+ * ratios are smoothed by <code>stan::analyze::compute_psis()</code>,
+ * whose Pareto shape <code>khat</code> tells whether the reweighted
+ * draws can be trusted: above
+ * <code>importance_reweight_max_khat</code> a warning is logged and
+ * the draws should be refit, for example by
+ * <code>hmc_nuts_diag_e_session::update_data()</code>.
+ *
+ * With <code>num_resamples</code> zero, every draw is written with its
+ * constrained parameters and transformed parameters, followed by its
+ * normalized log weight <code>log_weight__</code>. Otherwise that many
+ * draws are resampled in proportion to their weights by systematic
+ * resampling and written without weights.
+ *
+ * @tparam Model model class
+ * @param[in] model model with the new data
+ * @param[in] draws unconstrained parameters of the draws, one per row
+ * @param[in] log_prob log density of each draw under the model it was
+ *   drawn from, as <code>lp__</code>
+ * @param[in] num_resamples number of draws to resample, or zero to
+ *   write weighted draws
+ * @param[in] seed seed of the random number generator of the resampling
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] num_threads number of threads evaluating the model, or -1
+ *   for one per hardware thread
+ * @param[in, out] interrupt called every draw written
+ * @param[in, out] logger logger for messages
+ * @param[in, out] sample_writer writer the draws are written to
+ * @param[out] khat estimated Pareto shape of the importance weights
+ * @return error_codes::OK if successful, error_codes::DATAERR if the
+ *   draws don't match the model or every draw fails
+ */
+template <class Model>
+int importance_reweight(const Model& model, const Eigen::MatrixXd& draws,
+                        const Eigen::VectorXd& log_prob, int num_resamples,
+                        unsigned int seed, unsigned int chain,
+                        int num_threads, callbacks::interrupt& interrupt,
+                        callbacks::logger& logger,
+                        callbacks::writer& sample_writer, double& khat) {
+  khat = std::numeric_limits<double>::infinity();
+  if (draws.cols() != static_cast<Eigen::Index>(model.num_params_r())
+      || draws.rows() != log_prob.size() || draws.rows() == 0) {
+    std::stringstream msg;
+    msg << "Expecting draws of " << model.num_params_r()
+        << " unconstrained parameters, each with a log density, found "
+        << draws.rows() << " draws of " << draws.cols() << " parameters and "
+        << log_prob.size() << " log densities.";
+    logger.error(msg);
+    return error_codes::DATAERR;
+  }
+
+  stan::model::evaluator_pool<Model> pool(model, num_threads);
+  std::vector<std::future<
+      typename stan::model::evaluator_pool<Model>::evaluation>>
+      evaluations;
+  evaluations.reserve(draws.rows());
+  for (Eigen::Index n = 0; n < draws.rows(); ++n)
+    evaluations.push_back(
+        pool.template log_prob<true, true>(draws.row(n).transpose()));
+  Eigen::VectorXd log_weights(draws.rows());
+  for (Eigen::Index n = 0; n < draws.rows(); ++n) {
+    double lp = -std::numeric_limits<double>::infinity();
+    try {
+      typename stan::model::evaluator_pool<Model>::evaluation result
+          = evaluations[n].get();
+      if (result.messages.length() > 0)
+        logger.info(result.messages);
+      lp = result.log_prob;
+    } catch (const std::exception& e) {
+      logger.info(e.what());
+    }
+    log_weights(n) = std::isnan(lp) ? -std::numeric_limits<double>::infinity()
+                                    : lp - log_prob(n);
+  }
+  if (!std::isfinite(log_weights.maxCoeff())) {
+    logger.error("The log density of every draw failed with the new data.");
+    return error_codes::DATAERR;
+  }
+
+  khat = stan::analyze::compute_psis(log_weights);
+  std::stringstream msg;
+  msg << "Pareto k of the importance weights: " << khat;
+  logger.info(msg);
+  if (!(khat <= importance_reweight_max_khat))
+    logger.warn(
+        "The Pareto k of the importance weights is too high, the draws "
+        "should be refit with the new data.");
+
+  std::vector<Eigen::Index> rows;
+  if (num_resamples == 0) {
+    for (Eigen::Index n = 0; n < draws.rows(); ++n)
+      rows.push_back(n);
+  } else {
+    stan::rng_t rng = util::create_rng(seed, chain);
+    boost::uniform_01<stan::rng_t&> uniform(rng);
+    double u = uniform();
+    double cumulative = 0;
+    Eigen::Index n = 0;
+    for (int m = 0; m < num_resamples; ++m) {
+      const double target = (m + u) / num_resamples;
+      while (n < draws.rows() - 1
+             && cumulative + std::exp(log_weights(n)) < target)
+        cumulative += std::exp(log_weights(n++));
+      rows.push_back(n);
+    }
+  }
+
+  std::vector<std::string> names;
+  model.constrained_param_names(names, true, false);
+  if (num_resamples == 0)
+    names.push_back("log_weight__");
+  sample_writer(names);
+
+  stan::rng_t rng = util::create_rng(seed, chain);
+  std::vector<
+      std::future<typename stan::model::evaluator_pool<Model>::draw>>
+      constrained;
+  constrained.reserve(rows.size());
+  for (Eigen::Index row : rows)
+    constrained.push_back(
+        pool.write_array(rng, draws.row(row).transpose(), true, false));
+  std::vector<double> values;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    interrupt();
+    typename stan::model::evaluator_pool<Model>::draw result;
+    try {
+      result = constrained[i].get();
+    } catch (const std::exception& e) {
+      logger.info(e.what());
+      continue;
+    }
+    if (result.messages.length() > 0)
+      logger.info(result.messages);
+    values.assign(result.values.data(),
+                  result.values.data() + result.values.size());
+    if (num_resamples == 0)
+      values.push_back(log_weights(rows[i]));
+    sample_writer(values);
+  }
+  return error_codes::OK;
+}
+
+/**
+ * Update the draws of a previous run to new data by Pareto smoothed
+ * importance sampling, as above. The draws are read from the output
+ * of the run, with their <code>lp__</code> as the log density they
+ * were drawn from and either their unconstrained parameters, after a
+ * <code>draw__</code> column as written with unconstrained output, or
+ * their constrained parameters, which are transformed with the model.
+ *
+ * @tparam Model model class
+ * @param[in] model model with the new data
+ * @param[in] previous output of the previous run, as read by
+ *   <code>stan::io::stan_csv_reader::parse</code>
+ * @param[in] num_resamples number of draws to resample, or zero to
+ *   write weighted draws
+ * @param[in] seed seed of the random number generator of the resampling
+ * @param[in] chain chain id to advance the pseudo random number generator
+ * @param[in] num_threads number of threads evaluating the model, or -1
+ *   for one per hardware thread
+ * @param[in, out] interrupt called every draw written
+ * @param[in, out] logger logger for messages
+ * @param[in, out] sample_writer writer the draws are written to
+ * @param[out] khat estimated Pareto shape of the importance weights
+ * @return error_codes::OK if successful, error_codes::DATAERR if the
+ *   draws don't match the model or every draw fails
+ */
+template <class Model>
+int importance_reweight(const Model& model, const io::stan_csv& previous,
+                        int num_resamples, unsigned int seed,
+                        unsigned int chain, int num_threads,
+                        callbacks::interrupt& interrupt,
+                        callbacks::logger& logger,
+                        callbacks::writer& sample_writer, double& khat) {
+  khat = std::numeric_limits<double>::infinity();
+  const std::vector<std::string>& header = previous.header;
+  auto lp_col = std::find(header.begin(), header.end(), "lp__");
+  if (lp_col == header.end()) {
+    logger.error("Draws don't have an lp__ column.");
+    return error_codes::DATAERR;
+  }
+  const Eigen::Index num_draws = previous.samples.rows();
+  Eigen::VectorXd log_prob = previous.samples.col(lp_col - header.begin());
+
+  const Eigen::Index num_params = model.num_params_r();
+  Eigen::MatrixXd draws(num_draws, num_params);
+  auto draw_col = std::find(header.begin(), header.end(), "draw__");
+  if (draw_col != header.end()) {
+    const Eigen::Index first_col = draw_col - header.begin() + 1;
+    if (first_col + num_params > previous.samples.cols()) {
+      logger.error(
+          "Draws don't have unconstrained parameters after a draw__ "
+          "column.");
+      return error_codes::DATAERR;
+    }
+    draws = previous.samples.middleCols(first_col, num_params);
+  } else {
+    std::vector<std::string> names;
+    model.constrained_param_names(names, false, false);
+    std::vector<Eigen::Index> cols;
+    for (const std::string& name : names) {
+      auto col = std::find(header.begin(), header.end(), name);
+      if (col == header.end()) {
+        logger.error("Parameter " + name + " not found in the draws.");
+        return error_codes::DATAERR;
+      }
+      cols.push_back(col - header.begin());
+    }
+    std::vector<std::string> param_names;
+    std::vector<std::vector<size_t>> param_dimss;
+    get_model_parameters(model, param_names, param_dimss);
+    io::row_var_context context(param_names, param_dimss);
+    std::vector<double> row(cols.size());
+    std::vector<int> params_i;
+    std::vector<double> params_r;
+    for (Eigen::Index n = 0; n < num_draws; ++n) {
+      for (size_t j = 0; j < cols.size(); ++j)
+        row[j] = previous.samples(n, cols[j]);
+      std::stringstream msg;
+      try {
+        context.set_row(row.data());
+        params_r.clear();
+        model.transform_inits(context, params_i, params_r, &msg);
+      } catch (const std::exception& e) {
+        if (msg.str().length() > 0)
+          logger.error(msg);
+        logger.error(e.what());
+        return error_codes::DATAERR;
+      }
+      draws.row(n) = Eigen::Map<const Eigen::RowVectorXd>(params_r.data(),
+                                                          params_r.size());
+    }
+  }
+  return importance_reweight(model, draws, log_prob, num_resamples, seed,
+                             chain, num_threads, interrupt, logger,
+                             sample_writer, khat);
+}
+
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,110 @@
+#ifndef STAN_SERVICES_SAMPLE_MODEL_BASE_INSTANTIATIONS_HPP
+#define STAN_SERVICES_SAMPLE_MODEL_BASE_INSTANTIATIONS_HPP
+
+#include <stan/model/model_base.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_dense_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_unit_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/dense_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/unit_e_nuts.hpp>
+#include <stan/mcmc/hmc/static/adapt_dense_e_static_hmc.hpp>
+#include <stan/mcmc/hmc/static/adapt_diag_e_static_hmc.hpp>
+#include <stan/mcmc/hmc/static/adapt_unit_e_static_hmc.hpp>
+#include <stan/mcmc/hmc/static/dense_e_static_hmc.hpp>
+#include <stan/mcmc/hmc/static/diag_e_static_hmc.hpp>
+#include <stan/mcmc/hmc/static/unit_e_static_hmc.hpp>
+#include <stan/services/sample/fixed_param.hpp>
+#include <stan/services/sample/hmc_nuts_dense_e.hpp>
+#include <stan/services/sample/hmc_nuts_dense_e_adapt.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
+
+/**
+ * Explicit instantiations of the HMC samplers and of the most used
+ * sampling services for models called through
+ * <code>stan::model::model_base</code>, with the default generator
+ * <code>stan::rng_t</code>.
+ *
+ * The samplers only use the model through the virtual functions of
+ * <code>model_base</code>, so their code doesn't depend on the model.
+ * Every translation unit that includes this header declares these
+ * instantiations <code>extern</code> and doesn't compile them, so a
+ * model only has to compile the model class itself and call the
+ * services with a <code>model_base</code> reference. Exactly one
+ * translation unit of the program, usually in a library built once for
+ * all models, defines <code>STAN_SERVICES_INSTANTIATE</code> before
+ * including this header to compile them.
+ *
+ * Other services and samplers still compile in the translation units
+ * that use them, as do the services for the concrete model class.
+ */
+
+#ifdef STAN_SERVICES_INSTANTIATE
+#define STAN_SERVICES_EXTERN
+#else
+#define STAN_SERVICES_EXTERN extern
+#endif
+
+#define STAN_SERVICES_INSTANTIATE_SAMPLER(sampler) \
+  STAN_SERVICES_EXTERN template class stan::mcmc::sampler< \
+      stan::model::model_base, stan::rng_t>;
+
+STAN_SERVICES_INSTANTIATE_SAMPLER(unit_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(diag_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(dense_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_unit_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_diag_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_dense_e_nuts)
+STAN_SERVICES_INSTANTIATE_SAMPLER(unit_e_static_hmc)
+STAN_SERVICES_INSTANTIATE_SAMPLER(diag_e_static_hmc)
+STAN_SERVICES_INSTANTIATE_SAMPLER(dense_e_static_hmc)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_unit_e_static_hmc)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_diag_e_static_hmc)
+STAN_SERVICES_INSTANTIATE_SAMPLER(adapt_dense_e_static_hmc)
+
+#undef STAN_SERVICES_INSTANTIATE_SAMPLER
+
+// NUTS with a fixed metric
+#define STAN_SERVICES_INSTANTIATE_NUTS(service)                               \
+  STAN_SERVICES_EXTERN template int stan::services::sample::service<          \
+      stan::model::model_base>(                                               \
+      stan::model::model_base&, const stan::io::var_context&,                 \
+      const stan::io::var_context&, unsigned int, unsigned int, double, int,  \
+      int, int, bool, int, double, double, int,                               \
+      stan::callbacks::interrupt&, stan::callbacks::logger&,                  \
+      stan::callbacks::writer&, stan::callbacks::writer&,                     \
+      stan::callbacks::writer&);
+
+STAN_SERVICES_INSTANTIATE_NUTS(hmc_nuts_diag_e)
+STAN_SERVICES_INSTANTIATE_NUTS(hmc_nuts_dense_e)
+
+#undef STAN_SERVICES_INSTANTIATE_NUTS
+
+// NUTS with an adapted metric, with the run options
+#define STAN_SERVICES_INSTANTIATE_NUTS_ADAPT(service)                         \
+  STAN_SERVICES_EXTERN template int stan::services::sample::service<          \
+      stan::model::model_base>(                                               \
+      stan::model::model_base&, const stan::io::var_context&,                 \
+      const stan::io::var_context&, unsigned int, unsigned int, double, int,  \
+      int, int, bool, int, double, double, int, double, double, double,       \
+      double, unsigned int, unsigned int, unsigned int,                       \
+      stan::callbacks::interrupt&, stan::callbacks::logger&,                  \
+      stan::callbacks::writer&, stan::callbacks::writer&,                     \
+      stan::callbacks::writer&, const stan::services::util::run_options&);
+
+STAN_SERVICES_INSTANTIATE_NUTS_ADAPT(hmc_nuts_diag_e_adapt)
+STAN_SERVICES_INSTANTIATE_NUTS_ADAPT(hmc_nuts_dense_e_adapt)
+
+#undef STAN_SERVICES_INSTANTIATE_NUTS_ADAPT
+
+STAN_SERVICES_EXTERN template int
+stan::services::sample::fixed_param<stan::model::model_base>(
+    stan::model::model_base&, const stan::io::var_context&, unsigned int,
+    unsigned int, double, int, int, int, stan::callbacks::interrupt&,
+    stan::callbacks::logger&, stan::callbacks::writer&,
+    stan::callbacks::writer&, stan::callbacks::writer&);
+
+#undef STAN_SERVICES_EXTERN
+
+#endif
@@ -4,12 +4,20 @@
 #include <stan/callbacks/interrupt.hpp>
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
-#include <stan/io/array_var_context.hpp>
+#include <stan/io/row_var_context.hpp>
+#include <stan/io/stan_csv_reader.hpp>
 #include <stan/services/error_codes.hpp>
 #include <stan/services/util/create_rng.hpp>
 #include <stan/services/util/gq_writer.hpp>
 #include <stan/math/prim/fun/Eigen.hpp>
 #include <boost/algorithm/string.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <algorithm>
+#include <istream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -97,19 +105,21 @@ int standalone_generate(const Model &model, const Eigen::MatrixXd &draws,
   util::gq_writer writer(sample_writer, logger, p_names.size());
   writer.write_gq_names(model);
 
-  boost::ecuyer1988 rng = util::create_rng(seed, 1);
+  stan::rng_t rng = util::create_rng(seed, 1);
   std::vector<std::string> param_names;
   std::vector<std::vector<size_t>> param_dimss;
   get_model_parameters(model, param_names, param_dimss);
 
   std::vector<int> dummy_params_i;
   std::vector<double> unconstrained_params_r;
+  stan::io::row_var_context context(param_names, param_dimss);
+  std::vector<double> row(draws.cols());
   for (size_t i = 0; i < draws.rows(); ++i) {
     dummy_params_i.clear();
     unconstrained_params_r.clear();
     try {
-      stan::io::array_var_context context(param_names, draws.row(i),
-                                          param_dimss);
+      Eigen::Map<Eigen::RowVectorXd>(row.data(), row.size()) = draws.row(i);
+      context.set_row(row.data());
       model.transform_inits(context, dummy_params_i, unconstrained_params_r,
                             &msg);
     } catch (const std::exception &e) {
@@ -124,6 +134,339 @@ int standalone_generate(const Model &model, const Eigen::MatrixXd &draws,
   return error_codes::OK;
 }
 
+namespace internal {
+
+/**
+ * Outcome of generating the quantities of interest for one draw.
+ */
+struct gq_draw {
+  // Values written by the model, parameters first
+  std::vector<double> values;
+  // Messages printed by the model
+  std::string msg;
+  // Error thrown by the model, empty if none
+  std::string error;
+  // False if the draw couldn't be transformed to the unconstrained scale
+  bool transformed;
+};
+
+/**
+ * Generate the quantities of interest for one draw, using an RNG
+ * for the draw's own segment of the stream, from
+ * <code>util::create_draw_rng()</code>, so that the result doesn't
+ * depend on which thread generates which draw.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in, out] context context to read the draw through
+ * @param[in] row constrained parameter values of the draw
+ * @param[in] rng RNG at the start of the first draw's segment
+ * @param[in] draw index of the draw
+ * @param[out] result values, messages and errors of the draw
+ */
+template <class Model>
+void generate_gq_draw(const Model &model, io::row_var_context &context,
+                      const double *row, const stan::rng_t &rng,
+                      size_t draw, gq_draw &result) {
+  result.values.clear();
+  result.msg.clear();
+  result.error.clear();
+  result.transformed = false;
+  std::vector<int> params_i;
+  std::vector<double> params_r;
+  std::stringstream msg;
+  try {
+    context.set_row(row);
+    model.transform_inits(context, params_i, params_r, &msg);
+  } catch (const std::exception &e) {
+    result.msg = msg.str();
+    result.error = e.what();
+    return;
+  }
+  result.transformed = true;
+  stan::rng_t draw_rng = util::create_draw_rng(rng, draw);
+  std::stringstream ss;
+  try {
+    model.write_array(draw_rng, params_r, params_i, result.values, false,
+                      true, &ss);
+  } catch (const std::exception &e) {
+    result.error = e.what();
+  }
+  result.msg = ss.str();
+}
+
+/**
+ * Generate and write the quantities of interest for a batch of draws.
+ * When Stan is built with <code>STAN_THREADS</code> the draws are
+ * generated in parallel on the TBB thread pool, each with its own RNG
+ * segment; the quantities and messages are written in the order of the
+ * draws.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in, out] context context laid out for the parameters of the
+ *   model, copied for each thread
+ * @param[in] values constrained parameter values of the draws, one draw
+ *   after the other
+ * @param[in] num_draws number of draws in the batch
+ * @param[in] rng RNG at the start of the first draw's segment
+ * @param[in] first_draw index of the first draw of the batch
+ * @param[in, out] results storage for at least <code>num_draws</code>
+ *   outcomes
+ * @param[in, out] interrupt called every iteration
+ * @param[in, out] logger logger to which to write warning and error messages
+ * @param[in, out] sample_writer writer to which draws are written
+ * @return error code
+ */
+template <class Model>
+int generate_gq_batch(const Model &model, io::row_var_context &context,
+                      const double *values, size_t num_draws,
+                      const stan::rng_t &rng, size_t first_draw,
+                      std::vector<gq_draw> &results,
+                      callbacks::interrupt &interrupt,
+                      callbacks::logger &logger,
+                      callbacks::writer &sample_writer) {
+  const size_t num_params = context.size();
+#ifdef STAN_THREADS
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_draws),
+                    [&](const tbb::blocked_range<size_t> &r) {
+                      io::row_var_context range_context(context);
+                      for (size_t i = r.begin(); i < r.end(); ++i)
+                        generate_gq_draw(model, range_context,
+                                         values + i * num_params, rng,
+                                         first_draw + i, results[i]);
+                    });
+#else
+  for (size_t i = 0; i < num_draws; ++i)
+    generate_gq_draw(model, context, values + i * num_params, rng,
+                     first_draw + i, results[i]);
+#endif
+
+  for (size_t i = 0; i < num_draws; ++i) {
+    const gq_draw &result = results[i];
+    if (!result.transformed) {
+      if (result.msg.length() > 0)
+        logger.error(result.msg);
+      logger.error(result.error);
+      return error_codes::DATAERR;
+    }
+    interrupt();  // call out to interrupt and fail
+    if (result.msg.length() > 0)
+      logger.info(result.msg);
+    if (result.error.length() > 0) {
+      logger.info(result.error);
+      continue;
+    }
+    sample_writer(std::vector<double>(result.values.begin() + num_params,
+                                      result.values.end()));
+  }
+  return error_codes::OK;
+}
+
+}  // namespace internal
+
+/**
+ * Given a Stan CSV file of draws from a fitted model, generate
+ * corresponding quantities of interest which are written to callback
+ * writer, without holding all of the draws in memory.
+ *
+ * The columns of the model parameters are found by name in the header
+ * and the draws are read in batches of <code>batch_size</code> rows,
+ * each parsed into a single buffer which one context is pointed at row
+ * by row. When Stan is built with <code>STAN_THREADS</code> the rows of
+ * a batch are generated in parallel on the TBB thread pool; the
+ * quantities and messages are still written in the order of the draws.
+ * Every draw uses its own segment of the RNG stream for the seed, so the
+ * output doesn't depend on the batch size or the number of threads. It
+ * differs from the output of the overload taking a matrix of draws,
+ * which uses a single stream for all of them.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in, out] draws stream of a Stan CSV file of draws
+ * @param[in] seed seed to use for randomization
+ * @param[in, out] interrupt called every iteration
+ * @param[in, out] logger logger to which to write warning and error messages
+ * @param[in, out] sample_writer writer to which draws are written
+ * @param[in] batch_size number of draws read and generated at a time
+ * @return error code
+ */
+template <class Model>
+int standalone_generate(const Model &model, std::istream &draws,
+                        unsigned int seed, callbacks::interrupt &interrupt,
+                        callbacks::logger &logger,
+                        callbacks::writer &sample_writer,
+                        size_t batch_size = 1024) {
+  std::vector<std::string> p_names;
+  model.constrained_param_names(p_names, false, false);
+  std::vector<std::string> gq_names;
+  model.constrained_param_names(gq_names, false, true);
+  if (!(p_names.size() < gq_names.size())) {
+    logger.error("Model doesn't generate any quantities of interest.");
+    return error_codes::CONFIG;
+  }
+
+  io::stan_csv_metadata metadata;
+  io::stan_csv_reader::read_metadata(draws, metadata, nullptr);
+  std::vector<std::string> header;
+  if (!io::stan_csv_reader::read_header(draws, header, nullptr, false)) {
+    logger.error("Error reading header of draws from fitted model.");
+    return error_codes::DATAERR;
+  }
+  io::stan_csv_adaptation adaptation;
+  io::stan_csv_reader::read_adaptation(draws, adaptation, nullptr);
+
+  // Columns of the parameters in the file, and the order they are read in
+  std::vector<size_t> columns;
+  for (const std::string &name : p_names) {
+    auto it = std::find(header.begin(), header.end(), name);
+    if (it == header.end()) {
+      logger.error("Draws from fitted model are missing column " + name
+                   + ".");
+      return error_codes::DATAERR;
+    }
+    columns.push_back(it - header.begin());
+  }
+  std::vector<size_t> read_columns(columns);
+  std::sort(read_columns.begin(), read_columns.end());
+  std::vector<size_t> perm;
+  if (read_columns != columns)
+    for (size_t col : columns)
+      perm.push_back(std::lower_bound(read_columns.begin(),
+                                      read_columns.end(), col)
+                     - read_columns.begin());
+
+  util::gq_writer writer(sample_writer, logger, p_names.size());
+  writer.write_gq_names(model);
+
+  stan::rng_t rng = util::create_rng(seed, 1);
+  std::vector<std::string> param_names;
+  std::vector<std::vector<size_t>> param_dimss;
+  get_model_parameters(model, param_names, param_dimss);
+  io::row_var_context context(param_names, param_dimss);
+
+  const size_t num_params = p_names.size();
+  batch_size = std::max(batch_size, static_cast<size_t>(1));
+  std::vector<double> values;
+  std::vector<double> permuted;
+  std::vector<internal::gq_draw> results(batch_size);
+  size_t num_draws = 0;
+  while (true) {
+    size_t num_read;
+    try {
+      num_read = io::stan_csv_reader::read_draws(
+          draws, values, header.size(), read_columns, batch_size, nullptr);
+    } catch (const std::invalid_argument &) {
+      logger.error("Error reading draws from fitted model after draw "
+                   + std::to_string(num_draws) + ".");
+      return error_codes::DATAERR;
+    }
+    if (num_read == 0)
+      break;
+    if (!perm.empty()) {
+      permuted.resize(values.size());
+      for (size_t i = 0; i < num_read; ++i)
+        for (size_t j = 0; j < num_params; ++j)
+          permuted[i * num_params + j] = values[i * num_params + perm[j]];
+      values.swap(permuted);
+    }
+
+    int return_code = internal::generate_gq_batch(
+        model, context, values.data(), num_read, rng, num_draws, results,
+        interrupt, logger, sample_writer);
+    if (return_code != error_codes::OK)
+      return return_code;
+    num_draws += num_read;
+  }
+  if (num_draws == 0) {
+    logger.error("Empty set of draws from fitted model.");
+    return error_codes::DATAERR;
+  }
+  return error_codes::OK;
+}
+
+/**
+ * Given a set of draws from a fitted model, generate corresponding
+ * quantities of interest which are written to callback writer, like
+ * <code>standalone_generate()</code>, with a parallel mode.
+ *
+ * Instead of one RNG stream for all draws, every draw uses its own
+ * segment of the stream for the seed, from
+ * <code>util::create_draw_rng()</code>. When
+ * Stan is built with <code>STAN_THREADS</code> the draws of each batch
+ * of <code>batch_size</code> rows are generated in parallel on the TBB
+ * thread pool, and the quantities and messages are still written in
+ * the order of the draws. The output doesn't depend on the number of
+ * threads or the batch size, and is the same as that of the overload of
+ * <code>standalone_generate()</code> reading the draws from a Stan CSV
+ * stream.
+ *
+ * @tparam Model model class
+ * @param[in] model instantiated model
+ * @param[in] draws sequence of draws of constrained parameters
+ * @param[in] seed seed to use for randomization
+ * @param[in, out] interrupt called every iteration
+ * @param[in, out] logger logger to which to write warning and error messages
+ * @param[in, out] sample_writer writer to which draws are written
+ * @param[in] batch_size number of draws generated at a time
+ * @return error code
+ */
+template <class Model>
+int standalone_generate_parallel(const Model &model,
+                                 const Eigen::MatrixXd &draws,
+                                 unsigned int seed,
+                                 callbacks::interrupt &interrupt,
+                                 callbacks::logger &logger,
+                                 callbacks::writer &sample_writer,
+                                 size_t batch_size = 1024) {
+  if (draws.size() == 0) {
+    logger.error("Empty set of draws from fitted model.");
+    return error_codes::DATAERR;
+  }
+
+  std::vector<std::string> p_names;
+  model.constrained_param_names(p_names, false, false);
+  std::vector<std::string> gq_names;
+  model.constrained_param_names(gq_names, false, true);
+  if (!(p_names.size() < gq_names.size())) {
+    logger.error("Model doesn't generate any quantities of interest.");
+    return error_codes::CONFIG;
+  }
+
+  if (p_names.size() != draws.cols()) {
+    std::stringstream msg;
+    msg << "Wrong number of parameter values in draws from fitted model.  ";
+    msg << "Expecting " << p_names.size() << " columns, ";
+    msg << "found " << draws.cols() << " columns.";
+    logger.error(msg.str());
+    return error_codes::DATAERR;
+  }
+  util::gq_writer writer(sample_writer, logger, p_names.size());
+  writer.write_gq_names(model);
+
+  stan::rng_t rng = util::create_rng(seed, 1);
+  std::vector<std::string> param_names;
+  std::vector<std::vector<size_t>> param_dimss;
+  get_model_parameters(model, param_names, param_dimss);
+  io::row_var_context context(param_names, param_dimss);
+
+  batch_size = std::max(batch_size, static_cast<size_t>(1));
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      batch;
+  std::vector<internal::gq_draw> results(batch_size);
+  const size_t num_draws = draws.rows();
+  for (size_t first = 0; first < num_draws; first += batch_size) {
+    size_t num_rows = std::min(batch_size, num_draws - first);
+    batch = draws.middleRows(first, num_rows);
+    int return_code = internal::generate_gq_batch(
+        model, context, batch.data(), num_rows, rng, first, results,
+        interrupt, logger, sample_writer);
+    if (return_code != error_codes::OK)
+      return return_code;
+  }
+  return error_codes::OK;
+}
+
 }  // namespace services
 }  // namespace stan
 #endif
@@ -0,0 +1,157 @@
+#ifndef STAN_SERVICES_UTIL_ADVI_INIT_HPP
+#define STAN_SERVICES_UTIL_ADVI_INIT_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <stan/variational/advi.hpp>
+#include <stan/variational/families/normal_fullrank.hpp>
+#include <stan/variational/families/normal_meanfield.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Fit a variational approximation with ADVI from the specified
+ * initialization, for use as the initialization and initial inverse
+ * metric of a sampler. Nothing is written but log messages.
+ *
+ * @tparam Q class of variational distribution
+ * @tparam Model type of model
+ * @tparam RNG type of random number generator
+ * @param[in] model the model
+ * @param[in] init var context for initialization
+ * @param[in,out] rng random number generator
+ * @param[in] init_radius radius to initialize
+ * @param[in] grad_samples number of samples for Monte Carlo estimate
+ *   of gradients
+ * @param[in] elbo_samples number of samples for Monte Carlo estimate
+ *   of ELBO
+ * @param[in] max_iterations maximum number of iterations
+ * @param[in] tol_rel_obj convergence tolerance on the relative norm
+ *   of the objective
+ * @param[in] eta stepsize scaling parameter for variational inference
+ * @param[in] adapt_engaged adaptation engaged?
+ * @param[in] adapt_iterations number of iterations for eta adaptation
+ * @param[in] eval_elbo evaluate ELBO every Nth iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] variational approximation with the dimension of the
+ *   unconstrained parameters, holding the fit on return
+ * @return true if ADVI succeeded, false if it failed, in which case the
+ *   reason has been logged and the approximation is unspecified
+ */
+template <class Q, class Model, class RNG>
+bool advi_init(Model& model, const stan::io::var_context& init, RNG& rng,
+               double init_radius, int grad_samples, int elbo_samples,
+               int max_iterations, double tol_rel_obj, double eta,
+               bool adapt_engaged, int adapt_iterations, int eval_elbo,
+               callbacks::logger& logger, Q& variational) {
+  callbacks::writer no_writer;
+  try {
+    std::vector<double> cont_vector = util::initialize(
+        model, init, rng, init_radius, false, logger, no_writer);
+    Eigen::VectorXd cont_params
+        = Eigen::Map<Eigen::VectorXd>(cont_vector.data(), cont_vector.size());
+    variational = Q(cont_params);
+    stan::variational::advi<Model, Q, RNG> fit(model, cont_params, rng,
+                                               grad_samples, elbo_samples,
+                                               eval_elbo, 1);
+    if (adapt_engaged)
+      eta = fit.adapt_eta(variational, adapt_iterations, logger);
+    fit.stochastic_gradient_ascent(variational, eta, tol_rel_obj,
+                                   max_iterations, logger, no_writer);
+  } catch (const std::exception& e) {
+    logger.warn(e.what());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Return a var context holding the constrained parameter values at the
+ * mean of a variational approximation, to pass as the initialization
+ * of a sampler.
+ *
+ * @tparam Model type of model
+ * @tparam RNG type of random number generator
+ * @param[in] model the model
+ * @param[in] mean mean of the approximation on the unconstrained scale
+ * @param[in,out] rng random number generator
+ * @return var context with the parameters at the mean
+ */
+template <class Model, class RNG>
+stan::io::array_var_context advi_init_context(Model& model,
+                                              const Eigen::VectorXd& mean,
+                                              RNG& rng) {
+  std::vector<double> cont_vector(mean.data(), mean.data() + mean.size());
+  std::vector<int> disc_vector;
+  std::vector<double> values;
+  std::stringstream msg;
+  model.write_array(rng, cont_vector, disc_vector, values, false, false, &msg);
+
+  std::vector<std::string> param_names;
+  std::vector<std::vector<size_t>> param_dimss;
+  get_model_parameters(model, param_names, param_dimss);
+  return stan::io::array_var_context(param_names, values, param_dimss);
+}
+
+/**
+ * Return a var context holding the diagonal covariance of a mean field
+ * approximation as an inverse metric.
+ *
+ * @param[in] variational mean field approximation
+ * @return var context with the inverse metric
+ */
+inline stan::io::array_var_context advi_inv_metric_context(
+    const stan::variational::normal_meanfield& variational) {
+  Eigen::VectorXd inv_metric = (2 * variational.omega()).array().exp();
+  std::vector<double> values(inv_metric.data(),
+                             inv_metric.data() + inv_metric.size());
+  size_t n = inv_metric.size();
+  return stan::io::array_var_context(std::vector<std::string>{"inv_metric"},
+                                     values,
+                                     std::vector<std::vector<size_t>>{{n}});
+}
+
+/**
+ * Return a var context holding the covariance of a full rank
+ * approximation as an inverse metric.
+ *
+ * @param[in] variational full rank approximation
+ * @param[in] dense whether to return the dense covariance instead of
+ *   its diagonal
+ * @return var context with the inverse metric
+ */
+inline stan::io::array_var_context advi_inv_metric_context(
+    const stan::variational::normal_fullrank& variational, bool dense) {
+  std::vector<std::string> names{"inv_metric"};
+  const Eigen::MatrixXd& L = variational.L_chol();
+  size_t n = L.rows();
+  if (dense) {
+    Eigen::MatrixXd inv_metric = L * L.transpose();
+    std::vector<double> values(inv_metric.data(),
+                               inv_metric.data() + inv_metric.size());
+    return stan::io::array_var_context(
+        names, values, std::vector<std::vector<size_t>>{{n, n}});
+  }
+  Eigen::VectorXd inv_metric = L.rowwise().squaredNorm();
+  std::vector<double> values(inv_metric.data(),
+                             inv_metric.data() + inv_metric.size());
+  return stan::io::array_var_context(names, values,
+                                     std::vector<std::vector<size_t>>{{n}});
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef STAN_SERVICES_UTIL_CHAIN_COMMUNICATOR_HPP
+#define STAN_SERVICES_UTIL_CHAIN_COMMUNICATOR_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#ifdef STAN_MPI
+#include <mpi.h>
+#endif
+#include <stdexcept>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Connects the processes of a multi-chain run whose chains are spread
+ * over several processes, usually on several nodes, so that they can
+ * share warmup adaptation and compute diagnostics across all chains.
+ *
+ * The base class describes a run in a single process, where the sums
+ * over all processes are the sums of this process. Collective calls are
+ * made by every process in the same order, from one thread of each.
+ */
+class chain_communicator {
+ public:
+  virtual ~chain_communicator() {}
+
+  /**
+   * Return the index of this process, from zero.
+   */
+  virtual int rank() const { return 0; }
+
+  /**
+   * Return the number of processes.
+   */
+  virtual int size() const { return 1; }
+
+  /**
+   * Replace a vector by its elementwise sum over all processes. Every
+   * process passes a vector of the same length.
+   *
+   * @param[in,out] values values of this process, replaced by the sums
+   */
+  virtual void all_reduce_sum(Eigen::VectorXd& values) {}
+};
+
+#ifdef STAN_MPI
+/**
+ * A <code>chain_communicator</code> over the processes of an MPI
+ * communicator. MPI must have been initialized by the caller, with
+ * <code>MPI_THREAD_FUNNELED</code> support or more if the process runs
+ * threads, and is finalized by the caller.
+ */
+class mpi_chain_communicator : public chain_communicator {
+ public:
+  explicit mpi_chain_communicator(MPI_Comm comm = MPI_COMM_WORLD)
+      : comm_(comm) {
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &size_);
+  }
+
+  int rank() const { return rank_; }
+
+  int size() const { return size_; }
+
+  /**
+   * @throw std::runtime_error if the reduction fails
+   */
+  void all_reduce_sum(Eigen::VectorXd& values) {
+    if (MPI_Allreduce(MPI_IN_PLACE, values.data(),
+                      static_cast<int>(values.size()), MPI_DOUBLE, MPI_SUM,
+                      comm_)
+        != MPI_SUCCESS)
+      throw std::runtime_error("mpi_chain_communicator: MPI_Allreduce failed");
+  }
+
+ private:
+  MPI_Comm comm_;
+  int rank_;
+  int size_;
+};
+#endif
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
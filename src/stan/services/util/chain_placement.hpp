@@ -0,0 +1,222 @@
+#ifndef STAN_SERVICES_UTIL_CHAIN_PLACEMENT_HPP
+#define STAN_SERVICES_UTIL_CHAIN_PLACEMENT_HPP
+
+#include <stan/callbacks/logger.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Places the threads running the chains of a multi-chain run on fixed
+ * cores or NUMA nodes, so that a chain keeps running next to the memory
+ * it allocates.
+ *
+ * The chains are spread round robin over slots, each a set of CPUs:
+ * one per core the process may run on with <code>CORES</code>, or the
+ * cores of each NUMA node with <code>NUMA_NODES</code>. While a chain
+ * runs, its thread is pinned to the CPUs of its slot and unpinned when
+ * the chain hands the thread back, as the TBB threads are shared with
+ * other work. Linux allocates pages on the node of the thread that
+ * first touches them, so the blocks of the chain's autodiff arena and
+ * the buffers its writers grow while pinned are local to its node.
+ * Memory allocated before the chains start, such as the data of the
+ * model, stays where it is; interfaces that want a copy of the data per
+ * node construct a model per node from a pinned thread and pass each
+ * chain the model of <code>slot()</code>'s node.
+ *
+ * Pinning is only supported on Linux; elsewhere, or when the topology
+ * can't be read, there is a single slot and threads are not pinned.
+ */
+class chain_placement {
+ public:
+  enum policy_t { NONE, CORES, NUMA_NODES };
+
+  /**
+   * Read the topology of the machine for a placement policy.
+   *
+   * @param policy how to place the chains
+   */
+  explicit chain_placement(policy_t policy) : pinned_(false) {
+    std::vector<int> allowed = allowed_cpus();
+    if (policy == NONE || allowed.empty()) {
+      cpu_sets_.push_back(allowed);
+      return;
+    }
+    pinned_ = true;
+    if (policy == CORES) {
+      for (int cpu : allowed)
+        cpu_sets_.push_back({cpu});
+      return;
+    }
+    for (int node = 0;; ++node) {
+      std::ifstream in("/sys/devices/system/node/node" + std::to_string(node)
+                       + "/cpulist");
+      if (!in)
+        break;
+      std::string list;
+      std::getline(in, list);
+      std::vector<int> cpus;
+      for (int cpu : parse_cpu_list(list))
+        if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+          cpus.push_back(cpu);
+      if (!cpus.empty())
+        cpu_sets_.push_back(cpus);
+    }
+    if (cpu_sets_.empty())
+      cpu_sets_.push_back(allowed);
+  }
+
+  /**
+   * Place the chains on the specified sets of CPUs.
+   *
+   * @param cpu_sets CPUs of each slot, none of them empty
+   */
+  explicit chain_placement(const std::vector<std::vector<int>>& cpu_sets)
+      : cpu_sets_(cpu_sets), pinned_(true) {}
+
+  /**
+   * Return the number of slots the chains are spread over.
+   */
+  size_t num_slots() const { return cpu_sets_.size(); }
+
+  /**
+   * Return the slot of a chain.
+   *
+   * @param chain index of the chain, from zero
+   */
+  size_t slot(size_t chain) const { return chain % cpu_sets_.size(); }
+
+  /**
+   * Return the CPUs a chain runs on.
+   *
+   * @param chain index of the chain, from zero
+   */
+  const std::vector<int>& cpus(size_t chain) const {
+    return cpu_sets_[slot(chain)];
+  }
+
+  /**
+   * Return true if the threads of the chains are pinned.
+   */
+  bool pinned() const { return pinned_; }
+
+  /**
+   * Log how the chains are placed.
+   *
+   * @param num_chains number of chains
+   * @param[in,out] logger logger for the message
+   */
+  void log(size_t num_chains, callbacks::logger& logger) const {
+    if (!pinned_)
+      return;
+    std::stringstream msg;
+    msg << "Placing " << num_chains << " chains on " << cpu_sets_.size()
+        << " sets of CPUs";
+    logger.info(msg);
+  }
+
+  /**
+   * Parse a Linux CPU list such as <code>0-3,8,10-11</code>.
+   *
+   * @param list CPU list
+   * @return CPUs of the list in increasing order
+   */
+  static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+      if (range.find_first_of("0123456789") == std::string::npos)
+        continue;
+      size_t dash = range.find('-');
+      int first = std::atoi(range.substr(0, dash).c_str());
+      int last = dash == std::string::npos
+                     ? first
+                     : std::atoi(range.substr(dash + 1).c_str());
+      for (int cpu = first; cpu <= last; ++cpu)
+        cpus.push_back(cpu);
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+  }
+
+  /**
+   * Pins the calling thread to the CPUs of a chain for the lifetime of
+   * the scope and restores the thread's previous CPUs afterwards. Does
+   * nothing for a null placement or one that doesn't pin.
+   */
+  class scope {
+   public:
+    scope(const chain_placement* placement, size_t chain) : active_(false) {
+#ifdef __linux__
+      if (!placement || !placement->pinned_)
+        return;
+      if (pthread_getaffinity_np(pthread_self(), sizeof(previous_),
+                                 &previous_)
+          != 0)
+        return;
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int cpu : placement->cpus(chain))
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+          CPU_SET(cpu, &set);
+      active_ = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)
+                == 0;
+#endif
+    }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+    ~scope() {
+#ifdef __linux__
+      if (active_)
+        pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+#endif
+    }
+
+    /**
+     * Return true if the thread is pinned.
+     */
+    bool active() const { return active_; }
+
+   private:
+    bool active_;
+#ifdef __linux__
+    cpu_set_t previous_;
+#endif
+  };
+
+ private:
+  std::vector<std::vector<int>> cpu_sets_;
+  bool pinned_;
+
+  static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set))
+          cpus.push_back(cpu);
+#endif
+    return cpus;
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,309 @@
+#ifndef STAN_SERVICES_UTIL_CHECKPOINT_HPP
+#define STAN_SERVICES_UTIL_CHECKPOINT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/base_mcmc.hpp>
+#include <stan/mcmc/sample.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/services/util/generate_transitions.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Saves the state of a running chain every <code>interval</code>
+ * iterations so that an interrupted run can be resumed, and restores
+ * such a state.
+ *
+ * A checkpoint holds the number of completed iterations, the last draw,
+ * the state of the random number generator and the state of the
+ * sampler, including its adaptation during warmup. Resuming from it
+ * continues the run with exactly the draws the uninterrupted run would
+ * have produced after that iteration.
+ *
+ * Each checkpoint is passed to the writer as a single string which
+ * supersedes the previous one, so a writer only needs to keep the last
+ * string it received. Checkpoints are only written at the end of an
+ * iteration, never while a transition is running.
+ */
+class checkpoint {
+ public:
+  /**
+   * Construct a checkpoint for a new run.
+   *
+   * @param[in] interval number of iterations between checkpoints. Zero
+   *   disables writing checkpoints.
+   * @param[in,out] writer writer receiving each checkpoint
+   */
+  checkpoint(int interval, callbacks::writer& writer)
+      : interval_(interval), writer_(writer), resume_(nullptr) {}
+
+  /**
+   * Construct a checkpoint for a run resumed from an earlier
+   * checkpoint.
+   *
+   * @param[in] interval number of iterations between checkpoints. Zero
+   *   disables writing checkpoints.
+   * @param[in,out] writer writer receiving each checkpoint
+   * @param[in,out] resume stream holding the checkpoint to resume from
+   */
+  checkpoint(int interval, callbacks::writer& writer, std::istream& resume)
+      : interval_(interval), writer_(writer), resume_(&resume) {}
+
+  /**
+   * Return the number of iterations between checkpoints.
+   */
+  int interval() const { return interval_; }
+
+  /**
+   * Return true if the run is resumed from an earlier checkpoint.
+   */
+  bool resuming() const { return resume_ != nullptr; }
+
+  /**
+   * Return true if a checkpoint is due after the given number of
+   * completed iterations out of the total.
+   *
+   * @param[in] iteration number of completed iterations
+   * @param[in] total number of iterations of the run
+   */
+  bool due(int iteration, int total) const {
+    return interval_ > 0 && iteration % interval_ == 0 && iteration < total;
+  }
+
+  /**
+   * Return the number of completed iterations after which the next
+   * checkpoint is due, or <code>end</code> if it is not due before.
+   *
+   * @param[in] iteration number of completed iterations
+   * @param[in] end number of iterations to stop at
+   */
+  int next(int iteration, int end) const {
+    if (interval_ <= 0)
+      return end;
+    int next = (iteration / interval_ + 1) * interval_;
+    return next < end ? next : end;
+  }
+
+  /**
+   * Write a checkpoint of a chain run without adaptation.
+   *
+   * @tparam RNG type of random number generator
+   * @param[in] iteration number of completed iterations
+   * @param[in] num_warmup number of warmup iterations of the run
+   * @param[in] num_samples number of post warmup iterations of the run
+   * @param[in] s last draw
+   * @param[in] sampler sampler
+   * @param[in] rng random number generator
+   */
+  template <class RNG>
+  void write(int iteration, int num_warmup, int num_samples,
+             const stan::mcmc::sample& s, const stan::mcmc::base_mcmc& sampler,
+             const RNG& rng) {
+    std::stringstream out;
+    stan::mcmc::state_writer state(out);
+    write_chain(state, iteration, num_warmup, num_samples, s, sampler, rng);
+    state.tag("no_adaptation");
+    writer_(out.str());
+  }
+
+  /**
+   * Write a checkpoint of a chain run with adaptation, including the
+   * state of the adaptation.
+   *
+   * @tparam Sampler type of adaptive sampler
+   * @tparam RNG type of random number generator
+   * @param[in] iteration number of completed iterations
+   * @param[in] num_warmup number of warmup iterations of the run
+   * @param[in] num_samples number of post warmup iterations of the run
+   * @param[in] s last draw
+   * @param[in] sampler sampler
+   * @param[in] rng random number generator
+   */
+  template <class Sampler, class RNG>
+  void write_adaptive(int iteration, int num_warmup, int num_samples,
+                      const stan::mcmc::sample& s, const Sampler& sampler,
+                      const RNG& rng) {
+    std::stringstream out;
+    stan::mcmc::state_writer state(out);
+    write_chain(state, iteration, num_warmup, num_samples, s, sampler, rng);
+    state.tag("adaptation");
+    sampler.write_adaptation_state(state);
+    writer_(out.str());
+  }
+
+  /**
+   * Restore a chain run without adaptation from the checkpoint the run
+   * is resumed from.
+   *
+   * @tparam RNG type of random number generator
+   * @param[in] num_warmup number of warmup iterations of the run
+   * @param[in] num_samples number of post warmup iterations of the run
+   * @param[in,out] s last draw
+   * @param[out] sampler sampler
+   * @param[out] rng random number generator
+   * @return number of completed iterations
+   * @throws std::invalid_argument if the checkpoint can't be read or
+   *   was written by a different kind of sampler or run
+   */
+  template <class RNG>
+  int read(int num_warmup, int num_samples, stan::mcmc::sample& s,
+           stan::mcmc::base_mcmc& sampler, RNG& rng) {
+    stan::mcmc::state_reader state(*resume_);
+    int iteration
+        = read_chain(state, num_warmup, num_samples, s, sampler, rng);
+    state.tag("no_adaptation");
+    return iteration;
+  }
+
+  /**
+   * Restore a chain run with adaptation, including the state of the
+   * adaptation, from the checkpoint the run is resumed from.
+   *
+   * @tparam Sampler type of adaptive sampler
+   * @tparam RNG type of random number generator
+   * @param[in] num_warmup number of warmup iterations of the run
+   * @param[in] num_samples number of post warmup iterations of the run
+   * @param[in,out] s last draw
+   * @param[out] sampler sampler
+   * @param[out] rng random number generator
+   * @return number of completed iterations
+   * @throws std::invalid_argument if the checkpoint can't be read or
+   *   was written by a different kind of sampler or run
+   */
+  template <class Sampler, class RNG>
+  int read_adaptive(int num_warmup, int num_samples, stan::mcmc::sample& s,
+                    Sampler& sampler, RNG& rng) {
+    stan::mcmc::state_reader state(*resume_);
+    int iteration
+        = read_chain(state, num_warmup, num_samples, s, sampler, rng);
+    state.tag("adaptation");
+    sampler.read_adaptation_state(state);
+    return iteration;
+  }
+
+ private:
+  // Version 2 added the last change of the averaged step size to the
+  // step size adaptation
+  static constexpr int version = 2;
+
+  int interval_;
+  callbacks::writer& writer_;
+  std::istream* resume_;
+
+  template <class RNG>
+  static void write_chain(stan::mcmc::state_writer& state, int iteration,
+                          int num_warmup, int num_samples,
+                          const stan::mcmc::sample& s,
+                          const stan::mcmc::base_mcmc& sampler,
+                          const RNG& rng) {
+    state.tag("stan_checkpoint");
+    state.write(version);
+    state.write(iteration);
+    state.write(num_warmup);
+    state.write(num_samples);
+    state.write(s.cont_params());
+    state.write(s.log_prob());
+    state.write(s.accept_stat());
+    state.write_rng(rng);
+    sampler.write_state(state);
+  }
+
+  template <class RNG>
+  static int read_chain(stan::mcmc::state_reader& state, int num_warmup,
+                        int num_samples, stan::mcmc::sample& s,
+                        stan::mcmc::base_mcmc& sampler, RNG& rng) {
+    state.tag("stan_checkpoint");
+    int found_version, iteration, warmup, samples;
+    state.read(found_version);
+    if (found_version != version)
+      throw std::invalid_argument("Checkpoint: unknown version");
+    state.read(iteration);
+    state.read(warmup);
+    state.read(samples);
+    if (warmup != num_warmup || samples != num_samples)
+      throw std::invalid_argument(
+          "Checkpoint: number of warmup or post warmup iterations differs"
+          " from the run that wrote it");
+    if (iteration < 0 || iteration > num_warmup + num_samples)
+      throw std::invalid_argument("Checkpoint: bad iteration");
+
+    Eigen::VectorXd q;
+    double log_prob, accept_stat;
+    state.read(q);
+    state.read(log_prob);
+    state.read(accept_stat);
+    if (q.size() != s.size_cont())
+      throw std::invalid_argument("Checkpoint: dimension mismatch");
+    state.read_rng(rng);
+    sampler.read_state(state);
+    s = stan::mcmc::sample(std::move(q), log_prob, accept_stat);
+    return iteration;
+  }
+};
+
+/**
+ * Generates the transitions of one phase of a run, stopping at every
+ * iteration a checkpoint is due at to write it.
+ *
+ * @tparam Model model class
+ * @tparam RNG random number generator class
+ * @tparam Save callable writing a checkpoint given the number of
+ *   completed iterations
+ * @param[in,out] sampler MCMC sampler used to generate transitions
+ * @param[in] begin number of iterations of the run completed before
+ * @param[in] end number of iterations of the run completed after
+ * @param[in] phase_start iteration of the run the phase starts at
+ * @param[in] finish number of iterations of the run
+ * @param[in] num_thin thinning of saved draws
+ * @param[in] refresh number of iterations between progress messages
+ * @param[in] save true if the transitions are written
+ * @param[in] warmup true if the transitions are warmup
+ * @param[in,out] mcmc_writer writer to handle mcmc output
+ * @param[in,out] s last draw
+ * @param[in] model model
+ * @param[in,out] rng random number generator
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in] chain_id the chain id used for printing messages
+ * @param[in] num_chains the number of chains run in parallel
+ * @param[in] checkpoints checkpoint telling when checkpoints are due, or
+ *   a null pointer to not write any
+ * @param[in] save_checkpoint callable writing a checkpoint
+ */
+template <class Model, class RNG, class Save>
+void generate_transitions_with_checkpoints(
+    stan::mcmc::base_mcmc& sampler, int begin, int end, int phase_start,
+    int finish, int num_thin, int refresh, bool save, bool warmup,
+    util::mcmc_writer& mcmc_writer, stan::mcmc::sample& s, Model& model,
+    RNG& rng, callbacks::interrupt& interrupt, callbacks::logger& logger,
+    size_t chain_id, size_t num_chains, const checkpoint* checkpoints,
+    const Save& save_checkpoint) {
+  for (int m = begin; m < end;) {
+    online_diagnostics* diagnostics = mcmc_writer.options().diagnostics;
+    bool stopping = diagnostics && diagnostics->target_reached();
+    int next = checkpoints && !stopping ? checkpoints->next(m, end) : end;
+    if (generate_transitions(sampler, next - m, m, finish, num_thin, refresh,
+                             save, warmup, mcmc_writer, s, model, rng,
+                             interrupt, logger, chain_id, num_chains,
+                             m - phase_start)
+        < next - m)
+      break;
+    m = next;
+    if (checkpoints && checkpoints->due(m, finish))
+      save_checkpoint(m);
+  }
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
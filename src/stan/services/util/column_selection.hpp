@@ -0,0 +1,150 @@
+#ifndef STAN_SERVICES_UTIL_COLUMN_SELECTION_HPP
+#define STAN_SERVICES_UTIL_COLUMN_SELECTION_HPP
+
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Selects the constrained parameters, transformed parameters and
+ * generated quantities written with each draw, by name pattern.
+ *
+ * A pattern selects a column if it is the column's name, such as
+ * <code>theta.2.1</code>, or the name of the variable the column
+ * belongs to, such as <code>theta</code>. Indices may also be given
+ * in brackets, as in <code>theta[2,1]</code>, and <code>*</code>
+ * matches any run of characters, as in <code>theta.*.1</code>.
+ *
+ * Once applied to a model, the selection knows whether any of its
+ * columns are transformed parameters or generated quantities, so that
+ * <code>write_array</code> can skip writing, or computing, the blocks
+ * that aren't needed.
+ */
+class column_selection {
+ public:
+  /**
+   * @param[in] patterns name patterns of the columns to write
+   */
+  explicit column_selection(const std::vector<std::string>& patterns)
+      : include_tparams_(true), include_gqs_(true), num_written_(0) {
+    for (const std::string& pattern : patterns)
+      patterns_.push_back(normalize(pattern));
+  }
+
+  /**
+   * Return true if a column name is selected by any of the patterns.
+   *
+   * @param[in] name column name, with indices separated by dots
+   */
+  bool matches(const std::string& name) const {
+    for (const std::string& pattern : patterns_)
+      if (glob(pattern.c_str(), name.c_str())
+          || glob((pattern + ".*").c_str(), name.c_str()))
+        return true;
+    return false;
+  }
+
+  /**
+   * Find the selected columns of a model.
+   *
+   * @tparam Model type of model
+   * @param[in] model model
+   */
+  template <class Model>
+  void apply(Model& model) {
+    std::vector<std::string> params;
+    std::vector<std::string> with_tparams;
+    std::vector<std::string> all;
+    model.constrained_param_names(params, false, false);
+    model.constrained_param_names(with_tparams, true, false);
+    model.constrained_param_names(all, true, true);
+
+    include_tparams_ = any_match(with_tparams, params.size());
+    include_gqs_ = any_match(all, with_tparams.size());
+
+    std::vector<std::string> written;
+    model.constrained_param_names(written, include_tparams_, include_gqs_);
+    num_written_ = written.size();
+    columns_.clear();
+    names_.clear();
+    for (size_t i = 0; i < written.size(); ++i) {
+      if (matches(written[i])) {
+        columns_.push_back(i);
+        names_.push_back(written[i]);
+      }
+    }
+  }
+
+  /**
+   * Return true if any transformed parameter is selected.
+   */
+  bool include_tparams() const { return include_tparams_; }
+
+  /**
+   * Return true if any generated quantity is selected.
+   */
+  bool include_gqs() const { return include_gqs_; }
+
+  /**
+   * Return the number of values <code>write_array</code> writes with
+   * the blocks the selection includes.
+   */
+  size_t num_written() const { return num_written_; }
+
+  /**
+   * Return the positions of the selected columns among the values
+   * written by <code>write_array</code>.
+   */
+  const std::vector<size_t>& columns() const { return columns_; }
+
+  /**
+   * Return the names of the selected columns.
+   */
+  const std::vector<std::string>& names() const { return names_; }
+
+ private:
+  std::vector<std::string> patterns_;
+  bool include_tparams_;
+  bool include_gqs_;
+  size_t num_written_;
+  std::vector<size_t> columns_;
+  std::vector<std::string> names_;
+
+  bool any_match(const std::vector<std::string>& names, size_t begin) const {
+    for (size_t i = begin; i < names.size(); ++i)
+      if (matches(names[i]))
+        return true;
+    return false;
+  }
+
+  /**
+   * Rewrite <code>a[1,2]</code> as <code>a.1.2</code>.
+   */
+  static std::string normalize(const std::string& pattern) {
+    std::string result;
+    for (char c : pattern) {
+      if (c == '[' || c == ',')
+        result += '.';
+      else if (c != ']' && c != ' ')
+        result += c;
+    }
+    return result;
+  }
+
+  static bool glob(const char* pattern, const char* name) {
+    if (*pattern == '\0')
+      return *name == '\0';
+    if (*pattern == '*')
+      return glob(pattern + 1, name)
+             || (*name != '\0' && glob(pattern, name + 1));
+    return *name == *pattern && glob(pattern + 1, name + 1);
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,71 @@
+#ifndef STAN_SERVICES_UTIL_CREATE_MODEL_HPP
+#define STAN_SERVICES_UTIL_CREATE_MODEL_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/model/transformed_data_snapshot.hpp>
+#include <stan/services/util/startup_timer.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Construct a model from its data, reading its transformed data from a
+ * snapshot file when the file was written for the same build of the
+ * model, data and seed, and writing the file otherwise. Models that don't support
+ * snapshots compute their transformed data as usual and leave the file
+ * alone. See <code>stan::model::transformed_data_snapshot</code>.
+ *
+ * The messages printed by the model's constructor and whether the
+ * snapshot was read or written are written to the logger.
+ *
+ * @tparam Model type of the model, constructible from its data, the
+ *   seed and a message stream
+ * @param[in] data data of the model
+ * @param[in] seed seed of the random number generator of the
+ *   transformed data block
+ * @param[in] snapshot_path path of the snapshot file, or an empty string
+ *   to compute the transformed data without a snapshot
+ * @param[in,out] logger logger for messages
+ * @param[in,out] startup timer the construction is recorded with as the
+ *   <code>model</code> phase, or a null pointer for none
+ * @return the model
+ * @throw any exception thrown by the model's constructor
+ */
+template <class Model>
+std::unique_ptr<Model> create_model(const io::var_context& data,
+                                    unsigned int seed,
+                                    const std::string& snapshot_path,
+                                    callbacks::logger& logger,
+                                    startup_timer* startup = nullptr) {
+  std::unique_ptr<stan::model::transformed_data_snapshot> snapshot;
+  if (!snapshot_path.empty())
+    snapshot.reset(new stan::model::transformed_data_snapshot(snapshot_path));
+  std::stringstream msg;
+  std::unique_ptr<Model> model;
+  try {
+    model.reset(new Model(data, seed, &msg));
+  } catch (...) {
+    if (msg.str().length() > 0)
+      logger.info(msg);
+    throw;
+  }
+  if (msg.str().length() > 0)
+    logger.info(msg);
+  if (snapshot && snapshot->loaded())
+    logger.info("Transformed data read from " + snapshot_path);
+  else if (snapshot && snapshot->saved())
+    logger.info("Transformed data written to " + snapshot_path);
+  if (startup)
+    startup->record("model");
+  return model;
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
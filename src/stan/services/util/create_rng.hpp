@@ -1,9 +1,24 @@
 #ifndef STAN_SERVICES_UTIL_CREATE_RNG_HPP
 #define STAN_SERVICES_UTIL_CREATE_RNG_HPP
 
+#include <stan/util/philox4x32.hpp>
 #include <boost/random/additive_combine.hpp>
+#include <cstddef>
 
 namespace stan {
+
+/**
+ * Pseudo random number generator of the services and of the models'
+ * <code>write_array()</code>. It is boost::ecuyer1988, or the counter
+ * based stan::util::philox4x32 when compiled with
+ * STAN_RNG_PHILOX.
+ */
+#ifdef STAN_RNG_PHILOX
+using rng_t = util::philox4x32;
+#else
+using rng_t = boost::ecuyer1988;
+#endif
+
 namespace services {
 namespace util {
 
@@ -18,11 +33,20 @@ namespace util {
  * that the draws used to initialized transformed data are not
  * duplicated.
  *
+ * With philox4x32 the chain id is part of the key instead, so the
+ * chains get their streams in constant time.
+ *
+ * @tparam RNG type of the generator, boost::ecuyer1988 or philox4x32
  * @param[in] seed the random seed
  * @param[in] chain the chain id
- * @return a boost::ecuyer1988 instance
+ * @return a generator of type RNG
  */
-inline boost::ecuyer1988 create_rng(unsigned int seed, unsigned int chain) {
+template <class RNG = rng_t>
+RNG create_rng(unsigned int seed, unsigned int chain);
+
+template <>
+inline boost::ecuyer1988 create_rng<boost::ecuyer1988>(unsigned int seed,
+                                                       unsigned int chain) {
   using boost::uintmax_t;
   static uintmax_t DISCARD_STRIDE = static_cast<uintmax_t>(1) << 50;
   boost::ecuyer1988 rng(seed);
@@ -30,6 +54,53 @@ inline boost::ecuyer1988 create_rng(unsigned int seed, unsigned int chain) {
   return rng;
 }
 
+template <>
+inline stan::util::philox4x32 create_rng<stan::util::philox4x32>(
+    unsigned int seed, unsigned int chain) {
+  return stan::util::philox4x32(seed, chain);
+}
+
+/**
+ * Creates the generator of one draw of a loop whose draws may run in
+ * parallel, so that the output doesn't depend on how the draws are
+ * scheduled. With boost::ecuyer1988 it is the generator advanced past
+ * pow(2, 24) times the draw index draws; with philox4x32 it is the
+ * substream of purpose 1 and the draw index.
+ *
+ * @param[in] rng generator at the start of the loop
+ * @param[in] draw index of the draw
+ * @return generator of the draw
+ */
+inline boost::ecuyer1988 create_draw_rng(const boost::ecuyer1988& rng,
+                                         size_t draw) {
+  boost::ecuyer1988 draw_rng(rng);
+  draw_rng.discard(static_cast<boost::uintmax_t>(draw) << 24);
+  return draw_rng;
+}
+
+inline stan::util::philox4x32 create_draw_rng(
+    const stan::util::philox4x32& rng, size_t draw) {
+  return rng.substream(1, draw);
+}
+
+/**
+ * Splits the generator of one draw's generated quantities off a chain's
+ * generator: returns the generator as it is and advances it past the
+ * pow(2, 24) outputs reserved for the draw. The chain's later draws
+ * then don't depend on how many of those outputs the draw uses, or on
+ * whether its generated quantities are computed at all.
+ *
+ * @tparam RNG type of generator, boost::ecuyer1988 or philox4x32
+ * @param[in,out] rng generator of the chain
+ * @return generator of the draw
+ */
+template <class RNG>
+inline RNG split_draw_rng(RNG& rng) {
+  RNG draw_rng(rng);
+  rng.discard(static_cast<boost::uintmax_t>(1) << 24);
+  return draw_rng;
+}
+
 }  // namespace util
 }  // namespace services
 }  // namespace stan
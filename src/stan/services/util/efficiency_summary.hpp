@@ -0,0 +1,203 @@
+#ifndef STAN_SERVICES_UTIL_EFFICIENCY_SUMMARY_HPP
+#define STAN_SERVICES_UTIL_EFFICIENCY_SUMMARY_HPP
+
+#include <stan/analyze/mcmc/compute_rank_normalized_diagnostics.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/base_mcmc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Summarizes the sampling efficiency of a chain as bulk ESS per second
+ * and per gradient evaluation, the number metric and step size
+ * settings are tuned against.
+ *
+ * The summary is attached to the mcmc_writer once warmup is over. It
+ * keeps the draws of <code>lp__</code> and of the model columns and
+ * counts the gradient evaluations of every sampling transition, read
+ * from the sampler parameter <code>n_grad__</code> when the sampler
+ * reports it and from <code>n_leapfrog__</code> otherwise. At the end of
+ * the run it writes the number of draws, gradient evaluations and
+ * seconds, followed by a table of the bulk ESS of each column, per
+ * second and per gradient, and rows with the minimum and median over
+ * the columns. Columns whose ESS is undefined, such as constants, are
+ * left out of the minimum and median.
+ */
+class efficiency_summary {
+ public:
+  struct column {
+    std::string name;
+    double ess_bulk;
+    double ess_per_second;
+    double ess_per_gradient;
+  };
+
+  /**
+   * @param writer writer the summary is written to
+   */
+  explicit efficiency_summary(callbacks::writer& writer)
+      : writer_(writer), gradients_(-1), num_gradients_(0) {}
+
+  /**
+   * Start a chain, dropping the draws of any previous one.
+   *
+   * @param header names of the columns of the draws
+   */
+  void begin(const std::vector<std::string>& header) {
+    names_.clear();
+    indices_.clear();
+    for (size_t i = 0; i < header.size(); ++i) {
+      const std::string& name = header[i];
+      bool sampler_column = name.size() > 2
+                            && name.compare(name.size() - 2, 2, "__") == 0;
+      if (!sampler_column || name == "lp__") {
+        names_.push_back(name);
+        indices_.push_back(i);
+      }
+    }
+    draws_.assign(names_.size(), std::vector<double>());
+    gradients_ = -1;
+    num_gradients_ = 0;
+  }
+
+  /**
+   * Add a draw.
+   *
+   * @param values values of every column of the draw
+   */
+  void add_draw(const std::vector<double>& values) {
+    for (size_t k = 0; k < indices_.size(); ++k)
+      draws_[k].push_back(values[indices_[k]]);
+  }
+
+  /**
+   * Count the gradient evaluations of a sampling transition.
+   *
+   * @param sampler sampler that made the transition
+   */
+  void record(stan::mcmc::base_mcmc& sampler) {
+    if (gradients_ == -1) {
+      std::vector<std::string> names;
+      sampler.get_sampler_param_names(names);
+      auto it = std::find(names.begin(), names.end(), "n_grad__");
+      if (it == names.end())
+        it = std::find(names.begin(), names.end(), "n_leapfrog__");
+      gradients_ = it == names.end() ? -2 : it - names.begin();
+    }
+    if (gradients_ < 0)
+      return;
+    values_.clear();
+    sampler.get_sampler_params(values_);
+    num_gradients_ += values_[gradients_];
+  }
+
+  size_t num_draws() const { return draws_.empty() ? 0 : draws_[0].size(); }
+
+  double num_gradients() const { return num_gradients_; }
+
+  /**
+   * Return the bulk ESS of each column and its rates.
+   *
+   * @param seconds seconds the sampling took
+   */
+  std::vector<column> columns(double seconds) const {
+    std::vector<column> result;
+    if (names_.empty())
+      return result;
+    std::vector<Eigen::MatrixXd> chains(1, Eigen::MatrixXd(num_draws(),
+                                                          names_.size()));
+    for (size_t k = 0; k < names_.size(); ++k)
+      chains[0].col(k)
+          = Eigen::Map<const Eigen::VectorXd>(draws_[k].data(), num_draws());
+    std::vector<stan::analyze::rank_normalized_diagnostics> diagnostics
+        = stan::analyze::compute_rank_normalized_diagnostics(chains);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (size_t k = 0; k < names_.size(); ++k) {
+      double ess = diagnostics[k].ess_bulk;
+      result.push_back(
+          column{names_[k], ess, seconds > 0 ? ess / seconds : nan,
+                 num_gradients_ > 0 ? ess / num_gradients_ : nan});
+    }
+    return result;
+  }
+
+  /**
+   * Write the summary.
+   *
+   * @param seconds seconds the sampling took
+   */
+  void write(double seconds) const {
+    std::vector<column> cols = columns(seconds);
+    std::stringstream totals;
+    totals << "Efficiency: " << num_draws() << " draws, " << num_gradients_
+           << " gradient evaluations, " << seconds << " seconds";
+    writer_(totals.str());
+    writer_(std::vector<std::string>{"column", "ess_bulk", "ess_per_second",
+                                     "ess_per_gradient"});
+    for (const column& c : cols)
+      write_row(c);
+    std::vector<column> finite;
+    for (const column& c : cols)
+      if (std::isfinite(c.ess_bulk))
+        finite.push_back(c);
+    write_row(summarize("min", finite, 0.0));
+    write_row(summarize("median", finite, 0.5));
+  }
+
+ private:
+  callbacks::writer& writer_;
+  std::vector<std::string> names_;
+  std::vector<size_t> indices_;
+  std::vector<std::vector<double>> draws_;
+  int gradients_;
+  double num_gradients_;
+  std::vector<double> values_;
+
+  void write_row(const column& c) const {
+    std::vector<std::string> row{c.name};
+    for (double x : {c.ess_bulk, c.ess_per_second, c.ess_per_gradient}) {
+      std::stringstream ss;
+      ss << x;
+      row.push_back(ss.str());
+    }
+    writer_(row);
+  }
+
+  /**
+   * Return the quantile of each rate over the columns, or NaN if there
+   * are none. The median of an even number of columns is the mean of
+   * the middle two.
+   */
+  static column summarize(const std::string& name, std::vector<column> cols,
+                          double p) {
+    auto quantile = [&](double column::*field) {
+      if (cols.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+      std::vector<double> x;
+      for (const column& c : cols)
+        x.push_back(c.*field);
+      std::sort(x.begin(), x.end());
+      double pos = p * (x.size() - 1);
+      size_t lo = static_cast<size_t>(std::floor(pos));
+      size_t hi = static_cast<size_t>(std::ceil(pos));
+      return 0.5 * (x[lo] + x[hi]);
+    };
+    return column{name, quantile(&column::ess_bulk),
+                  quantile(&column::ess_per_second),
+                  quantile(&column::ess_per_gradient)};
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -4,7 +4,11 @@
 #include <stan/callbacks/writer.hpp>
 #include <stan/callbacks/interrupt.hpp>
 #include <stan/mcmc/base_mcmc.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/model/transformed_parameters_cache.hpp>
 #include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/progress_reporter.hpp>
+#include <memory>
 #include <string>
 
 namespace stan {
@@ -36,22 +40,78 @@ namespace util {
  * @param[in,out] base_rng random number generator
  * @param[in,out] callback interrupt callback called once an iteration
  * @param[in,out] logger logger for messages
+ * @param[in] chain_id the chain id used for printing messages
+ * @param[in] num_chains the number of chains run in parallel. Iteration
+ *   messages are only prefixed with the chain id when this is greater
+ *   than one
+ * @param[in] offset number of transitions of the same phase generated by
+ *   earlier calls. Refresh messages and thinning are counted from the
+ *   start of the phase, so a phase split over several calls produces
+ *   the same output as a single call
+ *
+ * @return number of transitions generated
+ *
+ * When online diagnostics are attached to the mcmc_writer, the
+ * transitions end early once the diagnostics report that their ESS
+ * target has been reached, and when a time budget is set, once it is
+ * used up. When a progress reporter is attached, every transition is
+ * recorded with it, and so is it with an efficiency summary. When a
+ * startup timer is attached, the first transition ends its last
+ * phase. When the writer keeps transformed parameters, the
+ * evaluations of the transitions saved fill a
+ * <code>stan::model::transformed_parameters_cache</code> on this
+ * thread, from which the draws written take theirs.
  */
 template <class Model, class RNG>
-void generate_transitions(stan::mcmc::base_mcmc& sampler, int num_iterations,
-                          int start, int finish, int num_thin, int refresh,
-                          bool save, bool warmup,
-                          util::mcmc_writer& mcmc_writer,
-                          stan::mcmc::sample& init_s, Model& model,
-                          RNG& base_rng, callbacks::interrupt& callback,
-                          callbacks::logger& logger) {
+int generate_transitions(stan::mcmc::base_mcmc& sampler, int num_iterations,
+                         int start, int finish, int num_thin, int refresh,
+                         bool save, bool warmup,
+                         util::mcmc_writer& mcmc_writer,
+                         stan::mcmc::sample& init_s, Model& model,
+                         RNG& base_rng, callbacks::interrupt& callback,
+                         callbacks::logger& logger, size_t chain_id = 1,
+                         size_t num_chains = 1, int offset = 0) {
+  std::unique_ptr<stan::model::transformed_parameters_cache::scope>
+      tparams_cache;
+  size_t tparams_cache_capacity
+      = mcmc_writer.transformed_parameters_cache_capacity();
+  if (save && tparams_cache_capacity > 0)
+    tparams_cache.reset(new stan::model::transformed_parameters_cache::scope(
+        tparams_cache_capacity));
   for (int m = 0; m < num_iterations; ++m) {
     callback();
 
+    online_diagnostics* diagnostics = mcmc_writer.options().diagnostics;
+    if (diagnostics && diagnostics->target_reached()) {
+      std::stringstream message;
+      if (num_chains != 1)
+        message << "Chain [" << chain_id << "] ";
+      message << "ESS target reached, stopping after iteration " << start + m
+              << " / " << finish;
+      logger.info(message);
+      return m;
+    }
+
+    const time_budget* budget = mcmc_writer.options().budget;
+    if (budget && budget->expired()) {
+      std::stringstream message;
+      if (num_chains != 1)
+        message << "Chain [" << chain_id << "] ";
+      message << "Time budget of " << budget->seconds()
+              << " seconds used up, stopping after iteration " << start + m
+              << " / " << finish;
+      logger.info(message);
+      return m;
+    }
+
+    int phase_m = offset + m;
     if (refresh > 0
-        && (start + m + 1 == finish || m == 0 || (m + 1) % refresh == 0)) {
+        && (start + m + 1 == finish || phase_m == 0
+            || (phase_m + 1) % refresh == 0)) {
       int it_print_width = std::ceil(std::log10(static_cast<double>(finish)));
       std::stringstream message;
+      if (num_chains != 1)
+        message << "Chain [" << chain_id << "] ";
       message << "Iteration: ";
       message << std::setw(it_print_width) << m + 1 + start << " / " << finish;
       message << " [" << std::setw(3)
@@ -61,13 +121,31 @@ void generate_transitions(stan::mcmc::base_mcmc& sampler, int num_iterations,
       logger.info(message);
     }
 
-    init_s = sampler.transition(init_s, logger);
+    {
+      STAN_INSTRUMENT_REGION("transition");
+      init_s = sampler.transition(init_s, logger);
+    }
+
+    startup_timer* startup = mcmc_writer.options().startup;
+    if (startup && !startup->written()) {
+      startup->record("first_transition");
+      startup->write();
+    }
+
+    efficiency_summary* efficiency = mcmc_writer.options().efficiency;
+    if (efficiency)
+      efficiency->record(sampler);
+
+    progress_reporter* progress = mcmc_writer.options().progress;
+    if (progress)
+      progress->record(sampler, start + m + 1, finish, warmup);
 
-    if (save && ((m % num_thin) == 0)) {
+    if (save && ((phase_m % num_thin) == 0)) {
       mcmc_writer.write_sample_params(base_rng, init_s, sampler, model);
       mcmc_writer.write_diagnostic_params(init_s, sampler);
     }
   }
+  return num_iterations;
 }
 
 }  // namespace util
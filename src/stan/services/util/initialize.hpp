@@ -8,7 +8,14 @@
 #include <stan/io/chained_var_context.hpp>
 #include <stan/model/log_prob_grad.hpp>
 #include <stan/math/prim.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
+#include <algorithm>
 #include <chrono>
+#include <exception>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -90,12 +97,14 @@ std::vector<double> initialize(Model& model, const stan::io::var_context& init,
   for (; num_init_tries < MAX_INIT_TRIES; num_init_tries++) {
     std::stringstream msg;
     try {
-      stan::io::random_var_context random_context(model, rng, init_radius,
-                                                  is_initialized_with_zero);
-
       if (!any_initialized) {
-        unconstrained = random_context.get_unconstrained();
+        // Nothing to merge with, so skip constraining the draws and
+        // transforming them back
+        stan::io::random_var_context::draw_unconstrained(
+            model, rng, init_radius, is_initialized_with_zero, unconstrained);
       } else {
+        stan::io::random_var_context random_context(
+            model, rng, init_radius, is_initialized_with_zero);
         stan::io::chained_var_context context(init, random_context);
 
         model.transform_inits(context, disc_vector, unconstrained, &msg);
@@ -227,6 +236,275 @@ std::vector<double> initialize(Model& model, const stan::io::var_context& init,
   throw std::domain_error("Initialization failed.");
 }
 
+namespace internal {
+
+/**
+ * A candidate initial value of the unconstrained parameters and the
+ * outcome of evaluating the model there.
+ */
+struct init_candidate {
+  enum status_t { VALID, REJECTED, INFINITE, GRADIENT, FATAL };
+
+  std::vector<double> unconstrained;
+  status_t status = VALID;
+  // Output of the model and the message of a rejecting exception
+  std::string model_msg;
+  std::string error;
+  // Whether the fatal exception was thrown by the gradient
+  bool in_gradient = false;
+  std::exception_ptr fatal;
+  double log_prob = -std::numeric_limits<double>::infinity();
+  double seconds = 0;
+};
+
+/**
+ * Evaluate the log density and its gradient at a candidate that has
+ * been transformed to the unconstrained scale, with the same checks as
+ * <code>initialize()</code>. Exceptions are stored in the candidate.
+ */
+template <bool Jacobian, class Model>
+void evaluate_init_candidate(const Model& model, init_candidate& c) {
+  if (c.status != init_candidate::VALID)
+    return;
+  std::vector<int> disc_vector;
+  std::stringstream msg;
+  try {
+    double log_prob = model.template log_prob<false, Jacobian>(
+        c.unconstrained, disc_vector, &msg);
+    if (!std::isfinite(log_prob)) {
+      c.model_msg = msg.str();
+      c.status = init_candidate::INFINITE;
+      return;
+    }
+  } catch (const std::domain_error& e) {
+    c.model_msg = msg.str();
+    c.error = e.what();
+    c.status = init_candidate::REJECTED;
+    return;
+  } catch (const std::exception& e) {
+    c.model_msg = msg.str();
+    c.error = e.what();
+    c.fatal = std::current_exception();
+    c.status = init_candidate::FATAL;
+    return;
+  }
+
+  std::vector<double> gradient;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    c.log_prob = stan::model::log_prob_grad<true, Jacobian>(
+        model, c.unconstrained, disc_vector, gradient, &msg);
+  } catch (const std::exception& e) {
+    c.model_msg = msg.str();
+    c.error = e.what();
+    c.fatal = std::current_exception();
+    c.in_gradient = true;
+    c.status = init_candidate::FATAL;
+    return;
+  }
+  auto end = std::chrono::steady_clock::now();
+  c.seconds
+      = std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+            .count()
+        / 1000000.0;
+  c.model_msg = msg.str();
+  if (!std::isfinite(stan::math::sum(gradient)))
+    c.status = init_candidate::GRADIENT;
+}
+
+}  // namespace internal
+
+/**
+ * Returns a valid initial value of the parameters of the model on the
+ * unconstrained scale, evaluating batches of random candidates
+ * concurrently.
+ *
+ * The candidates of a batch are drawn one after the other from
+ * <code>rng</code>, exactly as <code>initialize()</code> draws its
+ * successive tries, and then evaluated in parallel on the TBB thread
+ * pool when Stan is built with <code>STAN_THREADS</code>. Candidates are
+ * inspected and logged in the order they were drawn, so for identical
+ * inputs the result and the messages do not depend on the scheduling.
+ * By default the first valid candidate is returned, which is the value
+ * <code>initialize()</code> would return. With
+ * <code>max_density</code> the valid candidate of the batch with the
+ * highest log density is returned instead.
+ *
+ * At most 100 candidates are tried in total. When the initial values
+ * are fully specified, <code>init_radius</code> is 0 or
+ * <code>num_candidates</code> is at most 1 this is
+ * <code>initialize()</code>.
+ *
+ * @tparam Jacobian indicates whether to include the Jacobian term when
+ *   evaluating the log density function
+ * @tparam Model the type of the model class
+ * @tparam RNG the type of the random number generator
+ *
+ * @param[in] model the model
+ * @param[in] init a var_context with initial values
+ * @param[in,out] rng random number generator
+ * @param[in] init_radius the radius for generating random values
+ * @param[in] num_candidates number of candidates per batch
+ * @param[in] max_density whether to return the valid candidate with the
+ *   highest log density in the first batch with a valid candidate
+ * @param[in] print_timing indicates whether a timing message should
+ *   be printed to the logger
+ * @param[in,out] logger logger for messages
+ * @param[in,out] init_writer init writer (on the unconstrained scale)
+ * @throws exception passed through from the model if the model has a
+ *   fatal error (not a std::domain_error) at a candidate inspected
+ *   before a valid one
+ * @throws std::domain_error if the model can not be initialized
+ * @return valid unconstrained parameters for the model
+ */
+template <bool Jacobian = true, class Model, class RNG>
+std::vector<double> initialize_parallel(
+    Model& model, const stan::io::var_context& init, RNG& rng,
+    double init_radius, size_t num_candidates, bool max_density,
+    bool print_timing, stan::callbacks::logger& logger,
+    stan::callbacks::writer& init_writer) {
+  bool is_fully_initialized = true;
+  bool any_initialized = false;
+  std::vector<std::string> param_names;
+  model.get_param_names(param_names);
+  for (size_t n = 0; n < param_names.size(); n++) {
+    is_fully_initialized &= init.contains_r(param_names[n]);
+    any_initialized |= init.contains_r(param_names[n]);
+  }
+
+  if (is_fully_initialized || init_radius == 0.0 || num_candidates <= 1)
+    return initialize<Jacobian>(model, init, rng, init_radius, print_timing,
+                                logger, init_writer);
+
+  typedef internal::init_candidate candidate_t;
+  const size_t MAX_INIT_TRIES = 100;
+  std::vector<candidate_t> candidates;
+  for (size_t num_init_tries = 0; num_init_tries < MAX_INIT_TRIES;) {
+    size_t batch_size
+        = std::min(num_candidates, MAX_INIT_TRIES - num_init_tries);
+    num_init_tries += batch_size;
+    candidates.assign(batch_size, candidate_t());
+
+    // Draw the candidates in order so that they only depend on the rng
+    for (candidate_t& c : candidates) {
+      std::stringstream msg;
+      try {
+        if (!any_initialized) {
+          stan::io::random_var_context::draw_unconstrained(
+              model, rng, init_radius, false, c.unconstrained);
+        } else {
+          stan::io::random_var_context random_context(model, rng,
+                                                      init_radius, false);
+          std::vector<int> disc_vector;
+          stan::io::chained_var_context context(init, random_context);
+          model.transform_inits(context, disc_vector, c.unconstrained, &msg);
+        }
+      } catch (const std::domain_error& e) {
+        c.model_msg = msg.str();
+        c.error = e.what();
+        c.status = candidate_t::REJECTED;
+      } catch (const std::exception& e) {
+        c.model_msg = msg.str();
+        c.error = e.what();
+        c.fatal = std::current_exception();
+        c.status = candidate_t::FATAL;
+      }
+    }
+
+#ifdef STAN_THREADS
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, batch_size),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i < r.end(); ++i)
+                          internal::evaluate_init_candidate<Jacobian>(
+                              model, candidates[i]);
+                      });
+#else
+    for (candidate_t& c : candidates)
+      internal::evaluate_init_candidate<Jacobian>(model, c);
+#endif
+
+    const candidate_t* selected = nullptr;
+    for (const candidate_t& c : candidates) {
+      if (c.model_msg.length() > 0)
+        logger.info(c.model_msg);
+      switch (c.status) {
+        case candidate_t::FATAL:
+          if (!c.in_gradient)
+            logger.info(
+                "Unrecoverable error evaluating the log probability"
+                " at the initial value.");
+          logger.info(c.error);
+          std::rethrow_exception(c.fatal);
+        case candidate_t::REJECTED:
+          logger.info("Rejecting initial value:");
+          logger.info(
+              "  Error evaluating the log probability"
+              " at the initial value.");
+          logger.info(c.error);
+          break;
+        case candidate_t::INFINITE:
+          logger.info("Rejecting initial value:");
+          logger.info(
+              "  Log probability evaluates to log(0),"
+              " i.e. negative infinity.");
+          logger.info(
+              "  Stan can't start sampling from this"
+              " initial value.");
+          break;
+        case candidate_t::GRADIENT:
+          logger.info("Rejecting initial value:");
+          logger.info(
+              "  Gradient evaluated at the initial value"
+              " is not finite.");
+          logger.info(
+              "  Stan can't start sampling from this"
+              " initial value.");
+          break;
+        case candidate_t::VALID:
+          if (!selected || c.log_prob > selected->log_prob)
+            selected = &c;
+          break;
+      }
+      if (selected && !max_density)
+        break;
+    }
+
+    if (selected) {
+      if (print_timing) {
+        logger.info("");
+        std::stringstream msg1;
+        msg1 << "Gradient evaluation took " << selected->seconds
+             << " seconds";
+        logger.info(msg1);
+
+        std::stringstream msg2;
+        msg2 << "1000 transitions using 10 leapfrog steps"
+             << " per transition would take"
+             << " " << 1e4 * selected->seconds << " seconds.";
+        logger.info(msg2);
+
+        logger.info("Adjust your expectations accordingly!");
+        logger.info("");
+        logger.info("");
+      }
+      init_writer(selected->unconstrained);
+      return selected->unconstrained;
+    }
+  }
+
+  logger.info("");
+  std::stringstream msg;
+  msg << "Initialization between (-" << init_radius << ", " << init_radius
+      << ") failed after"
+      << " " << MAX_INIT_TRIES << " attempts. ";
+  logger.info(msg);
+  logger.info(
+      " Try specifying initial values,"
+      " reducing ranges of constrained values,"
+      " or reparameterizing the model.");
+  throw std::domain_error("Initialization failed.");
+}
+
 }  // namespace util
 }  // namespace services
 }  // namespace stan
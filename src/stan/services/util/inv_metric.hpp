@@ -2,5 +2,7 @@
 #include <stan/services/util/create_unit_e_dense_inv_metric.hpp>
 #include <stan/services/util/read_diag_inv_metric.hpp>
 #include <stan/services/util/read_dense_inv_metric.hpp>
+#include <stan/services/util/read_dense_inv_metric_factor.hpp>
 #include <stan/services/util/validate_diag_inv_metric.hpp>
 #include <stan/services/util/validate_dense_inv_metric.hpp>
+#include <stan/services/util/write_binary_inv_metric.hpp>
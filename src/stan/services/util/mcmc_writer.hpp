@@ -4,12 +4,32 @@
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/mcmc/base_mcmc.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/mcmc/live_chains.hpp>
 #include <stan/mcmc/sample.hpp>
 #include <stan/model/prob_grad.hpp>
+#include <stan/services/util/column_selection.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/efficiency_summary.hpp>
+#include <stan/services/util/online_diagnostics.hpp>
+#include <stan/services/util/progress_reporter.hpp>
+#include <stan/services/util/run_options.hpp>
+#include <stan/services/util/startup_timer.hpp>
+#include <stan/services/util/time_budget.hpp>
+#ifdef STAN_THREADS
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#endif
+#include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace stan {
@@ -26,6 +46,40 @@ class mcmc_writer {
   callbacks::writer& sample_writer_;
   callbacks::writer& diagnostic_writer_;
   callbacks::logger& logger_;
+  std::vector<std::string> sample_names_;
+  run_options options_;
+  size_t online_chain_;
+  stan::mcmc::live_chains* live_chains_;
+  int live_chain_;
+  column_selection selection_;
+  size_t num_unconstrained_draws_;
+  std::vector<double> values_;
+  std::vector<double> diagnostic_values_;
+  Eigen::VectorXd cont_params_;
+  Eigen::VectorXd model_values_;
+
+  // A draw whose model values are computed by the pipeline
+  struct pipelined_draw {
+    size_t draw;
+    Eigen::VectorXd cont_params;
+    // Values of the sample and the sampler when the draw was pushed
+    std::vector<double> params;
+    Eigen::VectorXd values;
+    std::string msg;
+    std::string error;
+  };
+  size_t pipeline_batch_size_;
+  size_t num_pipelined_;
+  std::function<void(pipelined_draw&, bool, bool)> compute_draw_;
+  // Draws being filled by the chain and being computed by the workers;
+  // their storage is reused from batch to batch
+  std::vector<pipelined_draw> filling_;
+  std::vector<pipelined_draw> in_flight_;
+  size_t num_filling_;
+  size_t num_in_flight_;
+#ifdef STAN_THREADS
+  std::unique_ptr<tbb::task_group> pipeline_tasks_;
+#endif
 
  public:
   size_t num_sample_params_;
@@ -44,6 +98,15 @@ class mcmc_writer {
       : sample_writer_(sample_writer),
         diagnostic_writer_(diagnostic_writer),
         logger_(logger),
+        online_chain_(0),
+        live_chains_(nullptr),
+        live_chain_(0),
+        selection_(std::vector<std::string>()),
+        num_unconstrained_draws_(0),
+        pipeline_batch_size_(0),
+        num_pipelined_(0),
+        num_filling_(0),
+        num_in_flight_(0),
         num_sample_params_(0),
         num_sampler_params_(0),
         num_model_params_(0) {}
@@ -55,7 +118,10 @@ class mcmc_writer {
    * constrained parameter names.
    *
    * The names are written to the sample_stream as comma separated values
-   * with a newline at the end.
+   * with a newline at the end. With a column selection only the
+   * selected model columns are named, and with unconstrained output the
+   * model columns are <code>draw__</code> followed by the unconstrained
+   * parameters.
    *
    * @param[in] sample a sample (unconstrained) that works with the model
    * @param[in] sampler a stan::mcmc::base_mcmc object
@@ -72,10 +138,20 @@ class mcmc_writer {
     sampler.get_sampler_param_names(names);
     num_sampler_params_ = names.size() - num_sample_params_;
 
-    model.constrained_param_names(names, true, true);
+    if (options_.unconstrained_output) {
+      names.push_back("draw__");
+      model.unconstrained_param_names(names, false, false);
+    } else if (options_.columns) {
+      selection_.apply(model);
+      names.insert(names.end(), selection_.names().begin(),
+                   selection_.names().end());
+    } else {
+      model.constrained_param_names(names, true, true);
+    }
     num_model_params_ = names.size() - num_sample_params_ - num_sampler_params_;
 
     sample_writer_(names);
+    sample_names_ = names;
   }
 
   /**
@@ -85,10 +161,19 @@ class mcmc_writer {
    * of the model.
    *
    * The samples are written to the sample_stream as comma separated
-   * values with a newline at the end.
+   * values with a newline at the end. With a generated quantities
+   * pipeline the draw is queued instead, and written once the pipeline
+   * has computed its model values. With unconstrained output the
+   * unconstrained parameters are copied instead, and
+   * <code>model.write_array()</code> isn't called.
+   *
+   * Each draw splits the generator of its generated quantities off the
+   * chain's generator with <code>util::split_draw_rng()</code>, whether
+   * they are computed or not, so the column selection, unconstrained
+   * output and the pipeline don't change the chain's later draws.
    *
-   * @param[in,out] rng random number generator (used by
-   *   model.write_array())
+   * @param[in,out] rng random number generator of the chain, advanced
+   *   past the outputs reserved for the draw's generated quantities
    * @param[in] sample the sample in constrained space
    * @param[in] sampler the sampler
    * @param[in] model the model
@@ -96,20 +181,34 @@ class mcmc_writer {
   template <class Model, class RNG>
   void write_sample_params(RNG& rng, stan::mcmc::sample& sample,
                            stan::mcmc::base_mcmc& sampler, Model& model) {
-    std::vector<double> values;
-
-    sample.get_sample_params(values);
-    sampler.get_sampler_params(values);
-
-    std::vector<double> model_values;
-    std::vector<int> params_i;
+    RNG draw_rng = split_draw_rng(rng);
+    if (options_.unconstrained_output) {
+      values_.clear();
+      sample.get_sample_params(values_);
+      sampler.get_sampler_params(values_);
+      values_.push_back(num_unconstrained_draws_++);
+      const Eigen::VectorXd& q = sample.cont_params();
+      values_.insert(values_.end(), q.data(), q.data() + q.size());
+      write_values();
+      return;
+    }
+    if (pipeline_batch_size_ > 0) {
+      push_draw(sample, sampler);
+      return;
+    }
+    // The buffers keep their size from draw to draw, so the copies
+    // below don't allocate once the first draw has been written
+    cont_params_ = sample.cont_params();
+    size_t num_written
+        = options_.columns ? selection_.num_written() : num_model_params_;
+    if (model_values_.size() != static_cast<int>(num_written))
+      model_values_.resize(num_written);
+    model_values_.setConstant(std::numeric_limits<double>::quiet_NaN());
     std::stringstream ss;
     try {
-      std::vector<double> cont_params(
-          sample.cont_params().data(),
-          sample.cont_params().data() + sample.cont_params().size());
-      model.write_array(rng, cont_params, params_i, model_values, true, true,
-                        &ss);
+      STAN_INSTRUMENT_REGION("write_array");
+      model.write_array(draw_rng, cont_params_, model_values_,
+                        include_tparams(), include_gqs(), &ss);
     } catch (const std::exception& e) {
       if (ss.str().length() > 0)
         logger_.info(ss);
@@ -119,13 +218,355 @@ class mcmc_writer {
     if (ss.str().length() > 0)
       logger_.info(ss);
 
-    if (model_values.size() > 0)
-      values.insert(values.end(), model_values.begin(), model_values.end());
-    if (model_values.size() < num_model_params_)
-      values.insert(values.end(), num_model_params_ - model_values.size(),
-                    std::numeric_limits<double>::quiet_NaN());
+    write_sample_params(sample, sampler, model_values_);
+  }
+
+  /**
+   * Outputs a sample whose model values were already computed, for
+   * draws whose <code>write_array()</code> runs elsewhere, such as on
+   * another thread. The model values are those written by
+   * <code>write_array()</code> with <code>include_tparams()</code> and
+   * <code>include_gqs()</code>; missing values are written as NaN.
+   *
+   * @param[in] sample the sample in constrained space
+   * @param[in] sampler the sampler
+   * @param[in] model_values values written by the model
+   */
+  void write_sample_params(stan::mcmc::sample& sample,
+                           stan::mcmc::base_mcmc& sampler,
+                           const Eigen::VectorXd& model_values) {
+    values_.clear();
+    sample.get_sample_params(values_);
+    sampler.get_sampler_params(values_);
+    write_model_values(model_values);
+  }
 
-    sample_writer_(values);
+  /**
+   * Compute the model values of the draws, that is the transformed
+   * parameters and generated quantities, in a pipeline instead of on
+   * the chain's thread between transitions. The draws passed to
+   * <code>write_sample_params()</code> are queued with the values of
+   * the sample and the sampler at that time. Every
+   * <code>batch_size</code> draws the queued batch is handed to the TBB
+   * thread pool, where <code>write_array()</code> runs for its draws in
+   * parallel while the chain takes its next transitions. A batch is
+   * written in the order of its draws, with the messages of the model,
+   * when the next batch is full or the pipeline is flushed. Without
+   * <code>STAN_THREADS</code> the batches are computed on the chain's
+   * thread when they are written.
+   *
+   * Draw <code>n</code> of the pipeline uses the generator
+   * <code>util::create_draw_rng(rng, n)</code>, so the output doesn't
+   * depend on the batch size or the number of threads. It differs from
+   * the output without a pipeline, which uses the generators split off
+   * the chain's generator, although the chain's draws are the same.
+   *
+   * The pipeline is flushed by <code>write_adapt_finish()</code>,
+   * <code>write_timing()</code> and <code>flush_pipeline()</code>. The
+   * model must outlive the pipeline, and the writer must not be moved
+   * while draws are in flight.
+   *
+   * @tparam Model model class
+   * @tparam RNG random number generator class
+   * @param[in] model the model
+   * @param[in] rng generator the generators of the draws are split from
+   * @param[in] batch_size number of draws per batch, or 0 to compute the
+   *   model values inline
+   */
+  template <class Model, class RNG>
+  void set_gq_pipeline(const Model& model, const RNG& rng,
+                       size_t batch_size) {
+    flush_pipeline();
+    pipeline_batch_size_ = batch_size;
+    num_pipelined_ = 0;
+    compute_draw_ = [&model, rng](pipelined_draw& d, bool include_tparams,
+                                  bool include_gqs) {
+      d.msg.clear();
+      d.error.clear();
+      d.values.setConstant(std::numeric_limits<double>::quiet_NaN());
+      RNG draw_rng = create_draw_rng(rng, d.draw);
+      std::stringstream ss;
+      try {
+        model.write_array(draw_rng, d.cont_params, d.values, include_tparams,
+                          include_gqs, &ss);
+      } catch (const std::exception& e) {
+        d.error = e.what();
+      }
+      d.msg = ss.str();
+    };
+#ifdef STAN_THREADS
+    if (batch_size > 0 && !pipeline_tasks_)
+      pipeline_tasks_.reset(new tbb::task_group());
+#endif
+  }
+
+  /**
+   * Compute and write every draw queued in the generated quantities
+   * pipeline. Does nothing without a pipeline.
+   */
+  void flush_pipeline() {
+    if (pipeline_batch_size_ == 0)
+      return;
+    finish_batch();
+    std::swap(filling_, in_flight_);
+    num_in_flight_ = num_filling_;
+    num_filling_ = 0;
+    start_batch();
+    finish_batch();
+  }
+
+  ~mcmc_writer() {
+#ifdef STAN_THREADS
+    if (pipeline_tasks_)
+      pipeline_tasks_->wait();
+#endif
+  }
+
+  mcmc_writer(mcmc_writer&&) = default;
+
+ private:
+  /**
+   * Append the model values to the values of the sample and sampler in
+   * <code>values_</code> and write the draw.
+   */
+  void write_model_values(const Eigen::VectorXd& model_values) {
+    if (options_.columns) {
+      for (size_t i : selection_.columns())
+        values_.push_back(i < static_cast<size_t>(model_values.size())
+                              ? model_values(i)
+                              : std::numeric_limits<double>::quiet_NaN());
+    } else {
+      size_t num_values = std::min(static_cast<size_t>(model_values.size()),
+                                   num_model_params_);
+      values_.insert(values_.end(), model_values.data(),
+                     model_values.data() + num_values);
+      if (num_values < num_model_params_)
+        values_.insert(values_.end(), num_model_params_ - num_values,
+                       std::numeric_limits<double>::quiet_NaN());
+    }
+
+    write_values();
+  }
+
+  /**
+   * Write the draw in <code>values_</code> and add it to the online
+   * diagnostics, the live chains and the efficiency summary.
+   */
+  void write_values() {
+    {
+      STAN_INSTRUMENT_REGION("sample_writer");
+      sample_writer_(values_);
+    }
+    if (options_.diagnostics)
+      options_.diagnostics->add_draw(online_chain_, values_, logger_);
+    if (live_chains_)
+      live_chains_->add(live_chain_, values_);
+    if (options_.efficiency)
+      options_.efficiency->add_draw(values_);
+  }
+
+  void push_draw(stan::mcmc::sample& sample, stan::mcmc::base_mcmc& sampler) {
+    if (filling_.size() < pipeline_batch_size_)
+      filling_.resize(pipeline_batch_size_);
+    pipelined_draw& d = filling_[num_filling_++];
+    d.draw = num_pipelined_++;
+    d.cont_params = sample.cont_params();
+    d.params.clear();
+    sample.get_sample_params(d.params);
+    sampler.get_sampler_params(d.params);
+    size_t num_written
+        = options_.columns ? selection_.num_written() : num_model_params_;
+    if (d.values.size() != static_cast<int>(num_written))
+      d.values.resize(num_written);
+    if (num_filling_ < pipeline_batch_size_)
+      return;
+    finish_batch();
+    std::swap(filling_, in_flight_);
+    num_in_flight_ = num_filling_;
+    num_filling_ = 0;
+    start_batch();
+  }
+
+  void compute_batch() {
+    const bool tparams = include_tparams();
+    const bool gqs = include_gqs();
+#ifdef STAN_THREADS
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_in_flight_),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i < r.end(); ++i)
+                          compute_draw_(in_flight_[i], tparams, gqs);
+                      });
+#else
+    for (size_t i = 0; i < num_in_flight_; ++i)
+      compute_draw_(in_flight_[i], tparams, gqs);
+#endif
+  }
+
+  void start_batch() {
+#ifdef STAN_THREADS
+    if (num_in_flight_ > 0)
+      pipeline_tasks_->run([this] { compute_batch(); });
+#endif
+  }
+
+  void finish_batch() {
+#ifdef STAN_THREADS
+    pipeline_tasks_->wait();
+#else
+    compute_batch();
+#endif
+    for (size_t i = 0; i < num_in_flight_; ++i) {
+      const pipelined_draw& d = in_flight_[i];
+      if (d.msg.length() > 0)
+        logger_.info(d.msg);
+      if (d.error.length() > 0)
+        logger_.info(d.error);
+      values_ = d.params;
+      write_model_values(d.values);
+    }
+    num_in_flight_ = 0;
+  }
+
+ public:
+
+  /**
+   * Return whether the model values written include the transformed
+   * parameters, which is false only if a column selection needs none.
+   */
+  bool include_tparams() const {
+    return !options_.columns || selection_.include_tparams();
+  }
+
+  /**
+   * Return whether the model values written include the generated
+   * quantities, which is false only if a column selection needs none.
+   */
+  bool include_gqs() const {
+    return !options_.columns || selection_.include_gqs();
+  }
+
+  /**
+   * Sets the options of the run this writer follows, which must be set
+   * before the sample names are written:
+   *
+   * <ul>
+   * <li>A column selection writes only the model columns selected by
+   * name, computing transformed parameters and generated quantities
+   * only when some of them are selected; the sample and sampler columns
+   * are always written.</li>
+   * <li>Unconstrained output writes the unconstrained parameters of the
+   * draws instead of their constrained values, transformed parameters
+   * and generated quantities, so that the cost of a draw is that of a
+   * copy and the model is only constrained later for the draws and
+   * variables that are used, with
+   * <code>services::constrain_draws()</code>. The model columns of each
+   * draw are its index <code>draw__</code>, counting from zero the
+   * draws written, and the unconstrained parameters. Constraining draw
+   * <code>n</code> uses the generator
+   * <code>util::create_draw_rng(rng, n)</code>, so a subset of the
+   * draws is constrained as the whole run would be. Paired with a
+   * <code>callbacks::binary_writer</code> the parameters are stored as
+   * they are in memory. It takes precedence over a column selection and
+   * a generated quantities pipeline.</li>
+   * <li>A progress reporter records, and a startup timer records and
+   * writes the first of, the transitions generated with this writer,
+   * which stop once the time budget is used up.</li>
+   * <li>A transformed parameters cache reuses the transformed
+   * parameters the model computed with its gradient at the point of
+   * each draw written, instead of computing them again in
+   * <code>write_array()</code>, for models whose generated code
+   * supports it; see
+   * <code>stan::model::transformed_parameters_cache</code>. The
+   * transitions generated with this writer keep the values at the last
+   * <code>tparams_cache_capacity</code> points evaluated, which for
+   * NUTS should be the most points of a trajectory, two to the power of
+   * the maximum tree depth, for every draw to be found. Draws computed
+   * by a generated quantities pipeline or written unconstrained don't
+   * use the cache.</li>
+   * </ul>
+   *
+   * The online diagnostics and the efficiency summary, which start
+   * once warmup is over, are registered with
+   * <code>set_online_diagnostics()</code> and
+   * <code>set_efficiency_summary()</code>, and the generated quantities
+   * pipeline, which needs the model, with <code>set_gq_pipeline()</code>.
+   *
+   * @param[in] options options of the run
+   */
+  void set_run_options(const run_options& options) {
+    online_diagnostics* diagnostics = options_.diagnostics;
+    efficiency_summary* efficiency = options_.efficiency;
+    options_ = options;
+    options_.diagnostics = diagnostics;
+    options_.efficiency = efficiency;
+    if (options.columns)
+      selection_ = *options.columns;
+    num_unconstrained_draws_ = 0;
+  }
+
+  /**
+   * Returns the options of the run this writer follows, with the
+   * online diagnostics and efficiency summary once they are registered.
+   */
+  const run_options& options() const { return options_; }
+
+  /**
+   * Registers this chain with online diagnostics. Every draw written
+   * afterwards is also added to the diagnostics, so this is called
+   * once warmup is over. The sample names must have been written.
+   *
+   * @param[in,out] diagnostics online diagnostics shared by the chains
+   * @throws std::invalid_argument if a monitored column is not in the
+   *   sample names
+   */
+  void set_online_diagnostics(online_diagnostics& diagnostics) {
+    online_chain_ = diagnostics.add_chain(sample_names_);
+    options_.diagnostics = &diagnostics;
+  }
+
+  /**
+   * Appends every draw written afterwards, warmup included, to a chain
+   * of live chains shared by the chains of the run, which can be
+   * analyzed while they run. The sample names must have been written.
+   *
+   * @param[in,out] chains live chains, with the sample names as
+   *   parameter names
+   * @param[in] chain chain of the live chains this writer feeds, fed by
+   *   no other writer
+   * @throws std::invalid_argument if the names of the live chains are
+   *   not the sample names
+   */
+  void set_live_chains(stan::mcmc::live_chains& chains, int chain) {
+    if (chains.param_names() != sample_names_)
+      throw std::invalid_argument(
+          "set_live_chains: the names of the live chains are not the "
+          "sample names");
+    live_chains_ = &chains;
+    live_chain_ = chain;
+  }
+
+  /**
+   * Returns the number of points whose transformed parameters are kept
+   * for the draws written, or 0 if the draws written don't reuse them.
+   */
+  size_t transformed_parameters_cache_capacity() const {
+    if (options_.unconstrained_output || pipeline_batch_size_ > 0
+        || !include_tparams())
+      return 0;
+    return options_.tparams_cache_capacity;
+  }
+
+  /**
+   * Starts an efficiency summary of this chain. Every draw written and
+   * every transition generated afterwards is added to the summary, so
+   * this is called once warmup is over. The sample names must have
+   * been written.
+   *
+   * @param[in,out] efficiency efficiency summary of this chain
+   */
+  void set_efficiency_summary(efficiency_summary& efficiency) {
+    efficiency.begin(sample_names_);
+    options_.efficiency = &efficiency;
   }
 
   /**
@@ -136,6 +577,7 @@ class mcmc_writer {
    * @param[in] sampler sampler
    */
   void write_adapt_finish(stan::mcmc::base_mcmc& sampler) {
+    flush_pipeline();
     sample_writer_("Adaptation terminated");
   }
 
@@ -170,13 +612,13 @@ class mcmc_writer {
    */
   void write_diagnostic_params(stan::mcmc::sample& sample,
                                stan::mcmc::base_mcmc& sampler) {
-    std::vector<double> values;
+    diagnostic_values_.clear();
+    sample.get_sample_params(diagnostic_values_);
+    sampler.get_sampler_params(diagnostic_values_);
+    sampler.get_sampler_diagnostics(diagnostic_values_);
 
-    sample.get_sample_params(values);
-    sampler.get_sampler_params(values);
-    sampler.get_sampler_diagnostics(values);
-
-    diagnostic_writer_(values);
+    STAN_INSTRUMENT_REGION("diagnostic_writer");
+    diagnostic_writer_(diagnostic_values_);
   }
 
   /**
@@ -239,6 +681,18 @@ class mcmc_writer {
     logger_.info("");
   }
 
+  /**
+   * Return the bytes taken by the buffers a draw is assembled in before
+   * it is written, which keep their size from draw to draw.
+   *
+   * @return bytes of the draw buffers
+   */
+  size_t buffer_bytes() const {
+    return (values_.capacity() + diagnostic_values_.capacity()
+            + cont_params_.size() + model_values_.size())
+           * sizeof(double);
+  }
+
   /**
    * Print timing information to all streams
    *
@@ -246,6 +700,7 @@ class mcmc_writer {
    * @param[in] sampleDeltaT sample time (sec)
    */
   void write_timing(double warmDeltaT, double sampleDeltaT) {
+    flush_pipeline();
     write_timing(warmDeltaT, sampleDeltaT, sample_writer_);
     write_timing(warmDeltaT, sampleDeltaT, diagnostic_writer_);
     log_timing(warmDeltaT, sampleDeltaT);
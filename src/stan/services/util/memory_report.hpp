@@ -0,0 +1,127 @@
+#ifndef STAN_SERVICES_UTIL_MEMORY_REPORT_HPP
+#define STAN_SERVICES_UTIL_MEMORY_REPORT_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/base_mcmc.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/model/autodiff_memory.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Collects how much memory the parts of a service run take and writes
+ * them as a table to a dedicated writer once the run is over, for
+ * sizing the memory of the processes running chains.
+ *
+ * The components of a sampling run are
+ * <ul>
+ * <li><code>autodiff_arena_per_gradient</code>, the largest autodiff
+ * arena held at the end of a single gradient evaluation on the thread
+ * running the chain, which grows in blocks,</li>
+ * <li><code>sampler_state</code>, the state the sampler carries from
+ * one transition to the next, such as the metric and the adaptation
+ * estimators, as measured by writing it with a
+ * <code>stan::mcmc::state_writer</code>, and</li>
+ * <li><code>writer_buffers</code>, the buffers each draw is assembled
+ * in before it is written.</li>
+ * </ul>
+ * Callers may add their own components, such as the storage of a
+ * <code>stan::mcmc::chains</code> they collect the draws in.
+ */
+class memory_report {
+ public:
+  struct component {
+    std::string name;
+    size_t bytes;
+  };
+
+  /**
+   * @param writer writer the table is written to
+   */
+  explicit memory_report(callbacks::writer& writer) : writer_(writer) {}
+
+  /**
+   * Start a run, dropping the components of any previous run and
+   * resetting the autodiff peak of the calling thread.
+   */
+  void begin() {
+    components_.clear();
+    stan::model::autodiff_memory::reset_peak();
+  }
+
+  /**
+   * Add a component.
+   *
+   * @param name name of the component
+   * @param bytes bytes it takes
+   */
+  void add(const std::string& name, size_t bytes) {
+    components_.push_back(component{name, bytes});
+  }
+
+  /**
+   * Add the largest autodiff arena held at the end of a gradient
+   * evaluation on the calling thread since <code>begin()</code>.
+   */
+  void add_autodiff() {
+    add("autodiff_arena_per_gradient",
+        stan::model::autodiff_memory::peak_bytes());
+  }
+
+  /**
+   * Add the state of the sampler and the buffers of the writer, and
+   * the autodiff arena, at the end of a sampling run.
+   *
+   * @param sampler sampler
+   * @param writer writer of the draws
+   */
+  void add_sampling(const stan::mcmc::base_mcmc& sampler,
+                    const mcmc_writer& writer) {
+    add_autodiff();
+    std::ostream discard(nullptr);
+    stan::mcmc::state_writer state(discard);
+    sampler.write_state(state);
+    add("sampler_state", state.bytes());
+    add("writer_buffers", writer.buffer_bytes());
+  }
+
+  const std::vector<component>& components() const { return components_; }
+
+  /**
+   * Return the bytes of all the components.
+   */
+  size_t total_bytes() const {
+    size_t total = 0;
+    for (const component& c : components_)
+      total += c.bytes;
+    return total;
+  }
+
+  /**
+   * Write a header, one row per component in the order they were added
+   * and a row with their total.
+   */
+  void write() const {
+    writer_(std::vector<std::string>{"component", "bytes"});
+    for (const component& c : components_)
+      writer_(std::vector<std::string>{c.name, std::to_string(c.bytes)});
+    writer_(std::vector<std::string>{"total", std::to_string(total_bytes())});
+  }
+
+ private:
+  callbacks::writer& writer_;
+  std::vector<component> components_;
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef STAN_SERVICES_UTIL_ONLINE_DIAGNOSTICS_HPP
+#define STAN_SERVICES_UTIL_ONLINE_DIAGNOSTICS_HPP
+
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <stan/analyze/mcmc/compute_reduced_split_diagnostics.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/services/util/chain_communicator.hpp>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Accumulates convergence diagnostics for selected columns of the
+ * sampler output while the sampler is running.
+ *
+ * Each chain registers once with the names of its output columns and
+ * then adds every post warmup draw it writes. Running means and
+ * variances are kept per chain with Welford's algorithm, and the
+ * draws of the monitored columns are kept so split R-hat and split
+ * effective sample size can be computed across chains at any time.
+ *
+ * Every <code>report_every</code> draws per chain the split R-hat and
+ * ESS are written to the logger. If an ESS target is given, the
+ * accumulator requests that sampling stop as soon as every monitored
+ * column reaches it; <code>generate_transitions</code> honors the
+ * request by ending the sampling phase early.
+ *
+ * Draws from several chains may be added concurrently.
+ */
+class online_diagnostics {
+ public:
+  /**
+   * Construct an accumulator.
+   *
+   * @param[in] names names of the output columns to monitor, e.g.
+   *   <code>lp__</code> or <code>theta.1</code>
+   * @param[in] num_chains number of chains expected to register.
+   *   Diagnostics are only reported once every chain has registered.
+   * @param[in] report_every number of draws per chain between reports.
+   *   Zero disables reports, but the ESS target is still checked at
+   *   the same cadence when it is positive.
+   * @param[in] ess_target split ESS every monitored column must reach
+   *   before sampling is stopped early. Zero disables early stopping.
+   * @throws std::invalid_argument if no names are given or
+   *   <code>num_chains</code> is zero
+   */
+  online_diagnostics(const std::vector<std::string>& names, size_t num_chains,
+                     size_t report_every, double ess_target = 0)
+      : names_(names),
+        num_chains_(num_chains),
+        report_every_(report_every),
+        ess_target_(ess_target),
+        target_reached_(false) {
+    if (names_.empty())
+      throw std::invalid_argument("online_diagnostics: no columns to monitor");
+    if (num_chains_ == 0)
+      throw std::invalid_argument("online_diagnostics: no chains");
+  }
+
+  /**
+   * Register a chain.
+   *
+   * @param[in] header names of the columns of the draws the chain will
+   *   add
+   * @return index of the chain to pass to <code>add_draw</code>
+   * @throws std::invalid_argument if a monitored column is not in the
+   *   header or more than <code>num_chains</code> chains register
+   */
+  size_t add_chain(const std::vector<std::string>& header) {
+    std::vector<size_t> columns;
+    for (const std::string& name : names_) {
+      auto it = std::find(header.begin(), header.end(), name);
+      if (it == header.end())
+        throw std::invalid_argument("online_diagnostics: column " + name
+                                    + " is not in the header");
+      columns.push_back(it - header.begin());
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (chains_.size() == num_chains_)
+      throw std::invalid_argument(
+          "online_diagnostics: too many chains registered");
+    chains_.emplace_back(columns);
+    return chains_.size() - 1;
+  }
+
+  /**
+   * Add a draw of one chain. When the draw completes a reporting
+   * interval for the slowest chain the diagnostics are updated,
+   * reported and checked against the ESS target.
+   *
+   * @param[in] chain index returned by <code>add_chain</code>
+   * @param[in] values values of every column of the draw
+   * @param[in,out] logger logger for reports
+   */
+  void add_draw(size_t chain, const std::vector<double>& values,
+                callbacks::logger& logger) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chain_state& state = chains_[chain];
+    const size_t n = ++state.num_draws;
+    for (size_t k = 0; k < state.columns.size(); ++k) {
+      double x = values[state.columns[k]];
+      state.draws[k].push_back(x);
+      double delta = x - state.mean[k];
+      state.mean[k] += delta / n;
+      state.m2[k] += delta * (x - state.mean[k]);
+    }
+
+    size_t interval = default_interval;
+    if (report_every_ > 0)
+      interval = report_every_;
+    bool enabled = report_every_ > 0 || ess_target_ > 0;
+    if (!enabled || chains_.size() < num_chains_ || min_draws() != n
+        || n % interval != 0)
+      return;
+    update(logger);
+  }
+
+  /**
+   * Return true once every monitored column has reached the ESS
+   * target.
+   */
+  bool target_reached() const { return target_reached_; }
+
+  /**
+   * Return the names of the monitored columns.
+   */
+  const std::vector<std::string>& names() const { return names_; }
+
+  /**
+   * Return the number of chains registered so far.
+   */
+  size_t num_registered() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chains_.size();
+  }
+
+  /**
+   * Return the number of draws of the shortest registered chain, which
+   * is the number of draws per chain used for the diagnostics.
+   */
+  size_t num_draws() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return min_draws();
+  }
+
+  /**
+   * Return the running mean of each monitored column of a chain.
+   *
+   * @param[in] chain index returned by <code>add_chain</code>
+   */
+  Eigen::VectorXd mean(size_t chain) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chains_[chain].mean;
+  }
+
+  /**
+   * Return the running sample variance of each monitored column of a
+   * chain, or NaN with fewer than two draws.
+   *
+   * @param[in] chain index returned by <code>add_chain</code>
+   */
+  Eigen::VectorXd variance(size_t chain) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const chain_state& state = chains_[chain];
+    if (state.num_draws < 2)
+      return Eigen::VectorXd::Constant(
+          state.m2.size(), std::numeric_limits<double>::quiet_NaN());
+    return state.m2 / (state.num_draws - 1.0);
+  }
+
+  /**
+   * Return the split R-hat of each monitored column across the
+   * registered chains.
+   */
+  Eigen::VectorXd split_rhat() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return split_rhat_locked();
+  }
+
+  /**
+   * Return the split effective sample size of each monitored column
+   * across the registered chains.
+   */
+  Eigen::VectorXd split_ess() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return split_ess_locked();
+  }
+
+  /**
+   * Compute the split R-hat and split effective sample size of each
+   * monitored column across the chains of all processes of a run, each
+   * process adding the draws of its own chains to its own accumulator.
+   * Only sums are exchanged between the processes, not draws. Every
+   * process must call this with accumulators monitoring the same
+   * columns, whose chains have the same number of draws, and gets the
+   * same results.
+   *
+   * @param[in,out] comm communicator connecting the processes
+   * @param[out] rhat split R-hat of each monitored column
+   * @param[out] ess split ESS of each monitored column
+   */
+  void reduce_split_diagnostics(chain_communicator& comm, Eigen::VectorXd& rhat,
+                                Eigen::VectorXd& ess) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    analyze::autocovariance_engine<double> engine;
+    auto all_reduce_sum
+        = [&comm](Eigen::VectorXd& values) { comm.all_reduce_sum(values); };
+    rhat.resize(names_.size());
+    ess.resize(names_.size());
+    std::vector<const double*> draws(chains_.size());
+    for (size_t k = 0; k < names_.size(); ++k) {
+      for (size_t chain = 0; chain < chains_.size(); ++chain)
+        draws[chain] = chains_[chain].draws[k].data();
+      analyze::compute_reduced_split_diagnostics(
+          draws, min_draws(), all_reduce_sum, engine, rhat(k), ess(k));
+    }
+  }
+
+ private:
+  /**
+   * Interval of the ESS target checks when reports are disabled.
+   */
+  static constexpr size_t default_interval = 100;
+
+  struct chain_state {
+    explicit chain_state(const std::vector<size_t>& cols)
+        : columns(cols),
+          num_draws(0),
+          draws(cols.size()),
+          mean(Eigen::VectorXd::Zero(cols.size())),
+          m2(Eigen::VectorXd::Zero(cols.size())) {}
+
+    std::vector<size_t> columns;
+    size_t num_draws;
+    std::vector<std::vector<double>> draws;
+    Eigen::VectorXd mean;
+    Eigen::VectorXd m2;
+  };
+
+  std::vector<std::string> names_;
+  size_t num_chains_;
+  size_t report_every_;
+  double ess_target_;
+  std::atomic<bool> target_reached_;
+  std::vector<chain_state> chains_;
+  mutable std::mutex mutex_;
+
+  size_t min_draws() const {
+    if (chains_.empty())
+      return 0;
+    size_t n = chains_[0].num_draws;
+    for (const chain_state& state : chains_)
+      n = std::min(n, state.num_draws);
+    return n;
+  }
+
+  template <typename F>
+  Eigen::VectorXd summarize(const F& f) const {
+    Eigen::VectorXd result(names_.size());
+    std::vector<const double*> draws(chains_.size());
+    std::vector<size_t> sizes(chains_.size(), min_draws());
+    for (size_t k = 0; k < names_.size(); ++k) {
+      for (size_t chain = 0; chain < chains_.size(); ++chain)
+        draws[chain] = chains_[chain].draws[k].data();
+      result(k) = sizes.empty() || sizes[0] < 4
+                      ? std::numeric_limits<double>::quiet_NaN()
+                      : f(draws, sizes);
+    }
+    return result;
+  }
+
+  Eigen::VectorXd split_rhat_locked() const {
+    return summarize([](const std::vector<const double*>& draws,
+                        const std::vector<size_t>& sizes) {
+      return analyze::compute_split_potential_scale_reduction(draws, sizes);
+    });
+  }
+
+  Eigen::VectorXd split_ess_locked() const {
+    analyze::autocovariance_engine<double> engine;
+    return summarize([&engine](const std::vector<const double*>& draws,
+                               const std::vector<size_t>& sizes) {
+      return analyze::compute_split_effective_sample_size(draws, sizes,
+                                                          engine);
+    });
+  }
+
+  void update(callbacks::logger& logger) {
+    Eigen::VectorXd ess = split_ess_locked();
+    if (ess_target_ > 0 && (ess.array() >= ess_target_).all())
+      target_reached_ = true;
+    if (report_every_ == 0)
+      return;
+
+    Eigen::VectorXd rhat = split_rhat_locked();
+    std::stringstream message;
+    message << "Diagnostics after " << min_draws() << " draws per chain:";
+    logger.info(message);
+    for (size_t k = 0; k < names_.size(); ++k) {
+      double mean = 0;
+      for (const chain_state& state : chains_)
+        mean += state.mean(k);
+      mean /= chains_.size();
+      std::stringstream line;
+      line << "  " << names_[k] << ": mean = " << std::setprecision(6) << mean
+           << ", R-hat = " << std::setprecision(4) << rhat(k)
+           << ", ESS = " << std::setprecision(6) << ess(k);
+      logger.info(line);
+    }
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
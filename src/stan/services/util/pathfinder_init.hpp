@@ -0,0 +1,453 @@
+#ifndef STAN_SERVICES_UTIL_PATHFINDER_INIT_HPP
+#define STAN_SERVICES_UTIL_PATHFINDER_INIT_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <stan/math/prim/fun/constants.hpp>
+#include <stan/model/log_prob_propto.hpp>
+#include <stan/optimization/bfgs.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/initialize.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Normal approximation of a posterior on the unconstrained scale,
+ * built from the inverse Hessian estimate of L-BFGS. The covariance
+ * is
+ *
+ * <code>gamma * (I - B * B') + B * diag(basis_variance) * B'</code>,
+ *
+ * where the columns of the basis <code>B</code> are orthonormal, so it
+ * is the scaled identity outside of the span of the L-BFGS history.
+ */
+struct pathfinder_approximation {
+  pathfinder_approximation()
+      : gamma(1),
+        log_det_covariance(0),
+        elbo(-std::numeric_limits<double>::infinity()),
+        iteration(0) {}
+
+  Eigen::VectorXd mean;
+  double gamma;
+  Eigen::MatrixXd basis;
+  Eigen::VectorXd basis_variance;
+  double log_det_covariance;
+
+  // Estimated evidence lower bound and the L-BFGS iteration the
+  // approximation was built at
+  double elbo;
+  int iteration;
+
+  Eigen::VectorXd diag_covariance() const {
+    Eigen::VectorXd excess = basis_variance.array() - gamma;
+    Eigen::VectorXd diag = basis.array().square().matrix() * excess;
+    diag.array() += gamma;
+    return diag;
+  }
+
+  Eigen::MatrixXd dense_covariance() const {
+    Eigen::VectorXd excess = basis_variance.array() - gamma;
+    Eigen::MatrixXd cov = basis * excess.asDiagonal() * basis.transpose();
+    cov.diagonal().array() += gamma;
+    return cov;
+  }
+
+  /**
+   * Draw from the approximation using the symmetric square root of the
+   * covariance.
+   *
+   * @tparam RNG type of random number generator
+   * @param[in,out] rng random number generator
+   * @param[out] log_q log density of the draw under the approximation
+   * @return draw
+   */
+  template <class RNG>
+  Eigen::VectorXd draw(RNG& rng, double& log_q) const {
+    boost::variate_generator<RNG&, boost::normal_distribution<> > rand_gaus(
+        rng, boost::normal_distribution<>());
+    Eigen::VectorXd z(mean.size());
+    for (int i = 0; i < z.size(); ++i)
+      z(i) = rand_gaus();
+    Eigen::VectorXd Bz = basis.transpose() * z;
+    log_q = -0.5
+            * (z.size() * stan::math::LOG_TWO_PI + log_det_covariance
+               + z.squaredNorm());
+    return mean + std::sqrt(gamma) * (z - basis * Bz)
+           + basis * basis_variance.cwiseSqrt().cwiseProduct(Bz);
+  }
+};
+
+/**
+ * Draws and normal approximation returned by
+ * <code>pathfinder_init()</code>.
+ */
+struct pathfinder_result {
+  // Draws on the unconstrained scale, one per column, and their log
+  // densities
+  Eigen::MatrixXd draws;
+  Eigen::VectorXd lp;
+
+  // Approximation with the largest evidence lower bound over all paths
+  pathfinder_approximation best;
+
+  // Total number of gradient evaluations of the optimizations
+  size_t num_grad_evals;
+
+  Eigen::VectorXd diag_inv_metric() const { return best.diag_covariance(); }
+
+  Eigen::MatrixXd dense_inv_metric() const { return best.dense_covariance(); }
+};
+
+namespace internal {
+
+/**
+ * Build the normal approximation at an L-BFGS iterate from the history
+ * of position and gradient differences, using the compact
+ * representation of the inverse BFGS update started from the scaled
+ * identity.
+ *
+ * @param[in] s_hist position differences, oldest first
+ * @param[in] y_hist gradient differences of the negative log density
+ * @param[in] x iterate
+ * @param[in] g gradient of the negative log density at the iterate
+ * @param[out] approx approximation
+ * @return false if the approximation isn't positive definite
+ */
+inline bool lbfgs_normal_approximation(
+    const std::deque<Eigen::VectorXd>& s_hist,
+    const std::deque<Eigen::VectorXd>& y_hist, const Eigen::VectorXd& x,
+    const Eigen::VectorXd& g, pathfinder_approximation& approx) {
+  int n = x.size();
+  int m = s_hist.size();
+  Eigen::MatrixXd S(n, m);
+  Eigen::MatrixXd Y(n, m);
+  for (int i = 0; i < m; ++i) {
+    S.col(i) = s_hist[i];
+    Y.col(i) = y_hist[i];
+  }
+  double gamma = S.col(m - 1).dot(Y.col(m - 1)) / Y.col(m - 1).squaredNorm();
+
+  Eigen::MatrixXd SY = S.transpose() * Y;
+  Eigen::MatrixXd R_inv = SY.triangularView<Eigen::Upper>().solve(
+      Eigen::MatrixXd::Identity(m, m));
+  Eigen::MatrixXd inner = Y.transpose() * Y * gamma;
+  inner.diagonal() += SY.diagonal();
+
+  Eigen::MatrixXd M = Eigen::MatrixXd::Zero(2 * m, 2 * m);
+  M.topLeftCorner(m, m) = R_inv.transpose() * inner * R_inv;
+  M.topRightCorner(m, m) = -R_inv.transpose();
+  M.bottomLeftCorner(m, m) = -R_inv;
+
+  Eigen::MatrixXd W(n, 2 * m);
+  W << S, gamma * Y;
+
+  // Restrict the update to an orthonormal basis of its span
+  int r = std::min(n, 2 * m);
+  Eigen::HouseholderQR<Eigen::MatrixXd> qr(W);
+  Eigen::MatrixXd Q = qr.householderQ() * Eigen::MatrixXd::Identity(n, r);
+  Eigen::MatrixXd R_w
+      = qr.matrixQR().topRows(r).triangularView<Eigen::Upper>();
+  Eigen::MatrixXd K = R_w * M * R_w.transpose();
+  K.diagonal().array() += gamma;
+
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(K);
+  if (eigen.info() != Eigen::Success || !(eigen.eigenvalues().minCoeff() > 0)
+      || !(gamma > 0))
+    return false;
+
+  approx.gamma = gamma;
+  approx.basis = Q * eigen.eigenvectors();
+  approx.basis_variance = eigen.eigenvalues();
+  approx.log_det_covariance = (n - r) * std::log(gamma)
+                              + eigen.eigenvalues().array().log().sum();
+
+  // Newton step on the negative log density
+  Eigen::VectorXd Bg = approx.basis.transpose() * g;
+  approx.mean = x - gamma * (g - approx.basis * Bg)
+                - approx.basis * approx.basis_variance.cwiseProduct(Bg);
+  return approx.mean.allFinite();
+}
+
+/**
+ * Log density of a model on the unconstrained scale, or negative
+ * infinity where it can't be evaluated.
+ */
+template <class Model>
+double pathfinder_log_prob(Model& model, Eigen::VectorXd& x) {
+  std::stringstream msg;
+  try {
+    double lp = stan::model::log_prob_propto<true>(model, x, &msg);
+    return std::isnan(lp) ? -std::numeric_limits<double>::infinity() : lp;
+  } catch (const std::exception& e) {
+    return -std::numeric_limits<double>::infinity();
+  }
+}
+
+/**
+ * Monte Carlo estimate of the evidence lower bound of an
+ * approximation, up to the normalizing constant of the model.
+ */
+template <class Model, class RNG>
+double pathfinder_elbo(Model& model, const pathfinder_approximation& approx,
+                       int num_draws, RNG& rng) {
+  double elbo = 0;
+  for (int i = 0; i < num_draws; ++i) {
+    double log_q;
+    Eigen::VectorXd x = approx.draw(rng, log_q);
+    elbo += pathfinder_log_prob(model, x) - log_q;
+  }
+  return elbo / num_draws;
+}
+
+}  // namespace internal
+
+/**
+ * Find initial values and an initial inverse metric for HMC by
+ * following L-BFGS optimization paths towards the mode and fitting
+ * normal approximations along them, as in Pathfinder.
+ *
+ * Each path starts from an initialization drawn as for sampling and
+ * runs L-BFGS on the log density on the unconstrained scale, including
+ * the log Jacobian of the constraining transforms. After every
+ * iteration the history of the optimizer gives a normal approximation
+ * whose evidence lower bound is estimated with
+ * <code>num_elbo_draws</code> draws, and the approximation with the
+ * largest bound is kept. With a single path its draws are returned.
+ * With several paths the draws of every path's approximation are
+ * pooled and importance resampled with replacement against the model.
+ *
+ * The draws are typically in the typical set, so one of them can be
+ * used as the initialization of an adaptive sampler through
+ * <code>pathfinder_init_context()</code>, and the covariance of the
+ * best approximation as its initial inverse metric through
+ * <code>pathfinder_inv_metric_context()</code>, skipping most of the
+ * early warmup at the cost of a few hundred gradient evaluations.
+ *
+ * @tparam Model type of model
+ * @tparam RNG type of random number generator
+ * @param[in] model the model
+ * @param[in] init inits for the paths, as for sampling
+ * @param[in,out] rng random number generator
+ * @param[in] init_radius the radius for generating random values
+ * @param[in] num_paths number of optimization paths
+ * @param[in] history_size amount of history to keep for L-BFGS and
+ *   the approximations
+ * @param[in] num_iterations maximum number of iterations of each path
+ * @param[in] num_elbo_draws number of draws to estimate each evidence
+ *   lower bound
+ * @param[in] num_draws number of draws to return
+ * @param[in,out] interrupt callback to be called every iteration
+ * @param[in,out] logger Logger for messages
+ * @param[in,out] init_writer Writer callback for unconstrained inits
+ * @throws std::domain_error if initialization fails or no path finds
+ *   an approximation
+ * @return draws and the best approximation
+ */
+template <class Model, class RNG>
+pathfinder_result pathfinder_init(
+    Model& model, const stan::io::var_context& init, RNG& rng,
+    double init_radius, int num_paths, int history_size, int num_iterations,
+    int num_elbo_draws, int num_draws, callbacks::interrupt& interrupt,
+    callbacks::logger& logger, callbacks::writer& init_writer) {
+  typedef stan::optimization::BFGSLineSearch<
+      Model, stan::optimization::LBFGSUpdate<>, double, Eigen::Dynamic, true>
+      Optimizer;
+
+  pathfinder_result result;
+  result.num_grad_evals = 0;
+  std::vector<pathfinder_approximation> approxs;
+  for (int path = 1; path <= num_paths; ++path) {
+    std::vector<int> disc_vector;
+    std::vector<double> cont_vector = util::initialize<true>(
+        model, init, rng, init_radius, false, logger, init_writer);
+
+    std::stringstream lbfgs_ss;
+    Optimizer lbfgs(model, cont_vector, disc_vector, &lbfgs_ss);
+    lbfgs.get_qnupdate().set_history_size(history_size);
+    lbfgs._conv_opts.maxIts = num_iterations;
+
+    std::deque<Eigen::VectorXd> s_hist;
+    std::deque<Eigen::VectorXd> y_hist;
+    pathfinder_approximation best;
+    int ret = 0;
+    while (ret == 0) {
+      interrupt();
+      ret = lbfgs.step();
+      if (lbfgs_ss.str().length() > 0) {
+        logger.info(lbfgs_ss);
+        lbfgs_ss.str("");
+      }
+      if (ret < 0)
+        break;
+
+      // Skip pairs without enough curvature, as the approximation
+      // needs a positive definite update
+      Eigen::VectorXd s = lbfgs.curr_x() - lbfgs.prev_x();
+      Eigen::VectorXd y = lbfgs.curr_g() - lbfgs.prev_g();
+      if (!(s.dot(y)
+            > std::numeric_limits<double>::epsilon() * y.squaredNorm()))
+        continue;
+      s_hist.push_back(s);
+      y_hist.push_back(y);
+      if (static_cast<int>(s_hist.size()) > history_size) {
+        s_hist.pop_front();
+        y_hist.pop_front();
+      }
+
+      pathfinder_approximation approx;
+      if (!internal::lbfgs_normal_approximation(
+              s_hist, y_hist, lbfgs.curr_x(), lbfgs.curr_g(), approx))
+        continue;
+      approx.elbo
+          = internal::pathfinder_elbo(model, approx, num_elbo_draws, rng);
+      approx.iteration = lbfgs.iter_num();
+      if (approx.elbo > best.elbo)
+        best = approx;
+    }
+    result.num_grad_evals += lbfgs.grad_evals();
+
+    std::stringstream msg;
+    msg << "Pathfinder path " << path << ": ";
+    if (best.elbo == -std::numeric_limits<double>::infinity()) {
+      msg << "no approximation found after " << lbfgs.iter_num()
+          << " iterations";
+      logger.info(msg);
+      continue;
+    }
+    msg << "best ELBO " << best.elbo << " at iteration " << best.iteration
+        << " of " << lbfgs.iter_num() << ", " << lbfgs.grad_evals()
+        << " gradient evaluations";
+    logger.info(msg);
+    if (best.elbo > result.best.elbo)
+      result.best = best;
+    approxs.push_back(best);
+  }
+
+  if (approxs.empty()) {
+    logger.error("Pathfinder failed to find an approximation on any path.");
+    throw std::domain_error("Pathfinder failure");
+  }
+
+  int n = model.num_params_r();
+  int num_proposals = num_draws * approxs.size();
+  Eigen::MatrixXd proposals(n, num_proposals);
+  Eigen::VectorXd proposal_lp(num_proposals);
+  Eigen::VectorXd log_weights(num_proposals);
+  for (int i = 0; i < num_proposals; ++i) {
+    double log_q;
+    Eigen::VectorXd x = approxs[i % approxs.size()].draw(rng, log_q);
+    proposal_lp(i) = internal::pathfinder_log_prob(model, x);
+    log_weights(i) = proposal_lp(i) - log_q;
+    proposals.col(i) = x;
+  }
+
+  if (approxs.size() == 1) {
+    result.draws = proposals;
+    result.lp = proposal_lp;
+    return result;
+  }
+
+  // Multinomial resampling in proportion to the importance weights
+  Eigen::VectorXd weights
+      = (log_weights.array() - log_weights.maxCoeff()).exp().matrix();
+  double sum_weights = weights.sum();
+  if (!(sum_weights > 0)) {
+    logger.error("Pathfinder draws all have zero density.");
+    throw std::domain_error("Pathfinder failure");
+  }
+  boost::uniform_01<RNG&> rand_uniform(rng);
+  result.draws.resize(n, num_draws);
+  result.lp.resize(num_draws);
+  for (int i = 0; i < num_draws; ++i) {
+    double u = rand_uniform() * sum_weights;
+    int j = 0;
+    while (j < num_proposals - 1 && u >= weights(j)) {
+      u -= weights(j);
+      ++j;
+    }
+    result.draws.col(i) = proposals.col(j);
+    result.lp(i) = proposal_lp(j);
+  }
+  return result;
+}
+
+/**
+ * Return a var context holding the constrained parameter values of a
+ * Pathfinder draw, to pass as the initialization of a sampler.
+ *
+ * @tparam Model type of model
+ * @tparam RNG type of random number generator
+ * @param[in] model the model
+ * @param[in] result Pathfinder draws
+ * @param[in] draw index of the draw
+ * @param[in,out] rng random number generator
+ * @return var context with the parameters of the draw
+ */
+template <class Model, class RNG>
+stan::io::array_var_context pathfinder_init_context(
+    Model& model, const pathfinder_result& result, int draw, RNG& rng) {
+  std::vector<double> cont_vector(result.draws.col(draw).data(),
+                                  result.draws.col(draw).data()
+                                      + result.draws.rows());
+  std::vector<int> disc_vector;
+  std::vector<double> values;
+  std::stringstream msg;
+  model.write_array(rng, cont_vector, disc_vector, values, false, false, &msg);
+
+  std::vector<std::string> param_names;
+  std::vector<std::vector<size_t>> param_dimss;
+  get_model_parameters(model, param_names, param_dimss);
+  return stan::io::array_var_context(param_names, values, param_dimss);
+}
+
+/**
+ * Return a var context holding the covariance of the best Pathfinder
+ * approximation as an inverse metric, to pass as the initial inverse
+ * metric of a sampler.
+ *
+ * @param[in] result Pathfinder draws
+ * @param[in] dense whether to return the dense covariance instead of
+ *   its diagonal
+ * @return var context with the inverse metric
+ */
+inline stan::io::array_var_context pathfinder_inv_metric_context(
+    const pathfinder_result& result, bool dense) {
+  std::vector<std::string> names{"inv_metric"};
+  size_t n = result.best.mean.size();
+  if (dense) {
+    Eigen::MatrixXd inv_metric = result.dense_inv_metric();
+    std::vector<double> values(inv_metric.data(),
+                               inv_metric.data() + inv_metric.size());
+    return stan::io::array_var_context(
+        names, values, std::vector<std::vector<size_t>>{{n, n}});
+  }
+  Eigen::VectorXd inv_metric = result.diag_inv_metric();
+  std::vector<double> values(inv_metric.data(),
+                             inv_metric.data() + inv_metric.size());
+  return stan::io::array_var_context(
+      names, values, std::vector<std::vector<size_t>>{{n}});
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
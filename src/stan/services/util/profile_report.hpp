@@ -0,0 +1,88 @@
+#ifndef STAN_SERVICES_UTIL_PROFILE_REPORT_HPP
+#define STAN_SERVICES_UTIL_PROFILE_REPORT_HPP
+
+#include <stan/math/rev/core/profiling.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Writes the profiles a model collects in its <code>profile</code>
+ * statements as a table to a dedicated writer once a service run is
+ * over, for finding which part of a model takes the time.
+ *
+ * The profiles of a generated model are kept in a
+ * <code>stan::math::profile_map</code> the model file defines and
+ * returns from <code>get_stan_profile_data()</code>, so the interface
+ * passes that map in. A row is written per region and thread that
+ * entered it, sorted by region, with its forward and reverse pass
+ * seconds, the autodiff stack it took summed over its passes, and its
+ * number of forward passes with and without autodiff and of reverse
+ * passes.
+ */
+class profile_report {
+ public:
+  /**
+   * @param writer writer the table is written to
+   * @param profiles profiles of the model
+   */
+  profile_report(callbacks::writer& writer, stan::math::profile_map& profiles)
+      : writer_(writer), profiles_(profiles) {}
+
+  /**
+   * Start a run, dropping the profiles of any previous run. No other
+   * thread may be in a profiled region.
+   */
+  void begin() { profiles_.clear(); }
+
+  /**
+   * Write a header and one row per region and thread.
+   */
+  void write() const {
+    writer_(std::vector<std::string>{
+        "name", "thread_id", "total_time", "forward_time", "reverse_time",
+        "chain_stack", "no_chain_stack", "autodiff_calls",
+        "no_autodiff_calls", "reverse_calls"});
+    std::vector<std::vector<std::string>> rows;
+    for (auto& region : profiles_) {
+      stan::math::profile_info& info = region.second;
+      std::stringstream thread_id;
+      thread_id << region.first.second;
+      rows.push_back(std::vector<std::string>{
+          region.first.first, thread_id.str(),
+          format(info.get_fwd_time() + info.get_rev_time()),
+          format(info.get_fwd_time()), format(info.get_rev_time()),
+          std::to_string(info.get_chain_stack_used()),
+          std::to_string(info.get_nochain_stack_used()),
+          std::to_string(info.get_num_AD_fwd_passes()),
+          std::to_string(info.get_num_no_AD_fwd_passes()),
+          std::to_string(info.get_num_rev_passes())});
+    }
+    std::sort(rows.begin(), rows.end());
+    for (const std::vector<std::string>& row : rows)
+      writer_(row);
+  }
+
+ private:
+  callbacks::writer& writer_;
+  stan::math::profile_map& profiles_;
+
+  static std::string format(double seconds) {
+    std::stringstream ss;
+    ss << std::setprecision(6) << seconds;
+    return ss.str();
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef STAN_SERVICES_UTIL_PROGRESS_REPORTER_HPP
+#define STAN_SERVICES_UTIL_PROGRESS_REPORTER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/base_mcmc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Writes machine readable progress records of a chain, so that a
+ * scheduler can follow the throughput of long runs and spot chains
+ * that are stuck.
+ *
+ * A record is written every <code>interval</code> transitions and
+ * after the last iteration, as a row of the columns
+ * <ul>
+ * <li><code>chain</code>, the chain id,</li>
+ * <li><code>iteration</code> and <code>num_iterations</code>, the
+ * iterations done, counting warmup, and their total,</li>
+ * <li><code>warmup</code>, 1 during warmup and 0 afterwards,</li>
+ * <li><code>elapsed_seconds</code>, the time since the first
+ * transition,</li>
+ * <li><code>iterations_per_second</code> and
+ * <code>gradients_per_second</code> over the window of transitions
+ * since the previous record,</li>
+ * <li><code>mean_treedepth</code> and <code>divergences</code> over the
+ * window,</li>
+ * <li><code>total_divergences</code> since the first transition,
+ * and</li>
+ * <li><code>eta_seconds</code>, the time the remaining iterations take
+ * at the rate of the window.</li>
+ * </ul>
+ * The header is written before the first record. Gradients are read
+ * from the sampler parameter <code>n_grad__</code> when the sampler
+ * reports it and from <code>n_leapfrog__</code> otherwise; the rates
+ * and tree depths the sampler doesn't report are NaN.
+ */
+class progress_reporter {
+ public:
+  /**
+   * @param writer writer the records are written to
+   * @param chain_id chain id written with each record
+   * @param interval number of transitions between records
+   * @throws std::invalid_argument if the interval is not positive
+   */
+  progress_reporter(callbacks::writer& writer, size_t chain_id = 1,
+                    int interval = 100)
+      : writer_(writer),
+        chain_id_(chain_id),
+        interval_(interval),
+        started_(false),
+        total_divergences_(0) {
+    if (interval < 1)
+      throw std::invalid_argument("Progress interval must be positive");
+    reset_window();
+  }
+
+  /**
+   * Record a transition, writing a record when the window is full or
+   * the transition is the last iteration.
+   *
+   * @param sampler sampler that made the transition
+   * @param iteration number of iterations done, counting this one
+   * @param num_iterations total number of iterations
+   * @param warmup whether the transition is a warmup transition
+   */
+  void record(stan::mcmc::base_mcmc& sampler, int iteration,
+              int num_iterations, bool warmup) {
+    if (!started_)
+      start(sampler);
+    values_.clear();
+    sampler.get_sampler_params(values_);
+    ++window_transitions_;
+    if (treedepth_ >= 0)
+      window_treedepth_ += values_[treedepth_];
+    if (gradients_ >= 0)
+      window_gradients_ += values_[gradients_];
+    if (divergent_ >= 0 && values_[divergent_] != 0) {
+      ++window_divergences_;
+      ++total_divergences_;
+    }
+    if (window_transitions_ >= interval_ || iteration >= num_iterations)
+      write_record(iteration, num_iterations, warmup);
+  }
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  callbacks::writer& writer_;
+  size_t chain_id_;
+  int interval_;
+  bool started_;
+  int treedepth_;
+  int gradients_;
+  int divergent_;
+  std::vector<double> values_;
+  clock::time_point start_time_;
+  clock::time_point window_start_;
+  int window_transitions_;
+  double window_treedepth_;
+  double window_gradients_;
+  int window_divergences_;
+  int total_divergences_;
+
+  void start(stan::mcmc::base_mcmc& sampler) {
+    std::vector<std::string> names;
+    sampler.get_sampler_param_names(names);
+    auto index = [&](const std::string& name) {
+      auto it = std::find(names.begin(), names.end(), name);
+      return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+    treedepth_ = index("treedepth__");
+    gradients_ = index("n_grad__");
+    if (gradients_ < 0)
+      gradients_ = index("n_leapfrog__");
+    divergent_ = index("divergent__");
+    writer_(std::vector<std::string>{
+        "chain", "iteration", "num_iterations", "warmup", "elapsed_seconds",
+        "iterations_per_second", "gradients_per_second", "mean_treedepth",
+        "divergences", "total_divergences", "eta_seconds"});
+    start_time_ = clock::now();
+    window_start_ = start_time_;
+    started_ = true;
+  }
+
+  void reset_window() {
+    window_transitions_ = 0;
+    window_treedepth_ = 0;
+    window_gradients_ = 0;
+    window_divergences_ = 0;
+  }
+
+  void write_record(int iteration, int num_iterations, bool warmup) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    clock::time_point now = clock::now();
+    double seconds
+        = std::chrono::duration<double>(now - window_start_).count();
+    double iterations_per_second
+        = seconds > 0 ? window_transitions_ / seconds : nan;
+    writer_(std::vector<double>{
+        static_cast<double>(chain_id_), static_cast<double>(iteration),
+        static_cast<double>(num_iterations), warmup ? 1.0 : 0.0,
+        std::chrono::duration<double>(now - start_time_).count(),
+        iterations_per_second,
+        gradients_ >= 0 && seconds > 0 ? window_gradients_ / seconds : nan,
+        treedepth_ >= 0 ? window_treedepth_ / window_transitions_ : nan,
+        static_cast<double>(window_divergences_),
+        static_cast<double>(total_divergences_),
+        (num_iterations - iteration) / iterations_per_second});
+    window_start_ = now;
+    reset_window();
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
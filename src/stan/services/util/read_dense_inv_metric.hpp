@@ -29,8 +29,10 @@ inline Eigen::MatrixXd read_dense_inv_metric(
   try {
     init_context.validate_dims("read dense inv metric", "inv_metric", "matrix",
                                init_context.to_vec(num_params, num_params));
-    std::vector<double> dense_vals = init_context.vals_r("inv_metric");
-    inv_metric = stan::math::to_matrix(dense_vals, num_params, num_params);
+    stan::io::values_view<double> dense_vals
+        = init_context.vals_r_view("inv_metric");
+    inv_metric = Eigen::Map<const Eigen::MatrixXd>(dense_vals.data(),
+                                                   num_params, num_params);
   } catch (const std::exception& e) {
     logger.error("Cannot get inverse metric from input file.");
     logger.error("Caught exception: ");
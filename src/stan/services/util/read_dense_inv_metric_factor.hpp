@@ -0,0 +1,91 @@
+#ifndef STAN_SERVICES_UTIL_READ_DENSE_INV_METRIC_FACTOR_HPP
+#define STAN_SERVICES_UTIL_READ_DENSE_INV_METRIC_FACTOR_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/io/var_context.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/services/util/read_dense_inv_metric.hpp>
+#include <stdexcept>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Extract the lower Cholesky factor of a dense inverse Euclidean metric
+ * from a var_context object, validating the metric with the same
+ * factorization that the sampler then keeps, see
+ * <code>stan::mcmc::dense_e_point::set_metric_factor()</code>.
+ *
+ * The metric is either the matrix <code>inv_metric</code>, which is
+ * checked to be symmetric and free of NaN and factored once, or its
+ * precomputed lower Cholesky factor <code>inv_metric_cholesky</code>,
+ * which is checked to be lower triangular and finite with a positive
+ * diagonal. Both checks take O(d^2) for d parameters. Large
+ * metrics are best read from a <code>stan::io::binary_var_context</code>,
+ * whose values are viewed in place rather than parsed.
+ *
+ * @param[in] init_context a var_context with the metric or its factor
+ * @param[in] num_params expected number of row, column elements
+ * @param[in,out] logger Logger for messages
+ * @throws std::domain_error if cannot read the Euclidean metric, it
+ *   isn't positive definite, or the factor isn't lower triangular
+ * @return lower Cholesky factor of the inverse metric
+ */
+inline Eigen::MatrixXd read_dense_inv_metric_factor(
+    const stan::io::var_context& init_context, size_t num_params,
+    callbacks::logger& logger) {
+  if (!init_context.contains_r("inv_metric_cholesky")) {
+    Eigen::MatrixXd inv_metric
+        = read_dense_inv_metric(init_context, num_params, logger);
+    try {
+      stan::math::check_not_nan("read_dense_inv_metric_factor", "inv_metric",
+                                inv_metric);
+      stan::math::check_symmetric("read_dense_inv_metric_factor",
+                                  "inv_metric", inv_metric);
+    } catch (const std::domain_error& e) {
+      logger.error("Inverse Euclidean metric not positive definite.");
+      logger.error(e.what());
+      throw std::domain_error("Initialization failure");
+    }
+    // The factorization only reads the lower triangle
+    Eigen::LLT<Eigen::MatrixXd> llt(inv_metric);
+    if (llt.info() != Eigen::Success) {
+      logger.error("Inverse Euclidean metric not positive definite.");
+      throw std::domain_error("Initialization failure");
+    }
+    return llt.matrixL();
+  }
+
+  Eigen::MatrixXd factor;
+  try {
+    init_context.validate_dims("read dense inv metric", "inv_metric_cholesky",
+                               "matrix",
+                               init_context.to_vec(num_params, num_params));
+    stan::io::values_view<double> dense_vals
+        = init_context.vals_r_view("inv_metric_cholesky");
+    factor = Eigen::Map<const Eigen::MatrixXd>(dense_vals.data(), num_params,
+                                               num_params);
+  } catch (const std::exception& e) {
+    logger.error("Cannot get inverse metric Cholesky factor from input file.");
+    logger.error("Caught exception: ");
+    logger.error(e.what());
+    throw std::domain_error("Initialization failure");
+  }
+  if (!factor.triangularView<Eigen::StrictlyUpper>().toDenseMatrix().isZero(
+          0)) {
+    logger.error("Inverse metric Cholesky factor is not lower triangular.");
+    throw std::domain_error("Initialization failure");
+  }
+  if (!factor.allFinite() || !(factor.diagonal().array() > 0).all()) {
+    logger.error("Inverse Euclidean metric not positive definite.");
+    throw std::domain_error("Initialization failure");
+  }
+  return factor;
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -30,7 +30,8 @@ inline Eigen::VectorXd read_diag_inv_metric(
   try {
     init_context.validate_dims("read diag inv metric", "inv_metric", "vector_d",
                                init_context.to_vec(num_params));
-    std::vector<double> diag_vals = init_context.vals_r("inv_metric");
+    stan::io::values_view<double> diag_vals
+        = init_context.vals_r_view("inv_metric");
     for (size_t i = 0; i < num_params; i++) {
       inv_metric(i) = diag_vals[i];
     }
@@ -3,9 +3,19 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/services/util/checkpoint.hpp>
+#include <stan/services/util/column_selection.hpp>
 #include <stan/services/util/generate_transitions.hpp>
 #include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/memory_report.hpp>
+#include <stan/services/util/online_diagnostics.hpp>
+#include <stan/services/util/run_options.hpp>
+#include <stan/services/util/warmup_profile.hpp>
+#include <algorithm>
 #include <chrono>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 
 namespace stan {
@@ -33,6 +43,30 @@ namespace util {
  * @param[in,out] logger logger for messages
  * @param[in,out] sample_writer writer for draws
  * @param[in,out] diagnostic_writer writer for diagnostic information
+ * @param[in] chain_id the chain id used for printing messages
+ * @param[in] num_chains the number of chains run in parallel
+ * @param[in] options optional collectors and outputs of the run: the
+ *   online diagnostics the draws after warmup are added to, the
+ *   checkpoint the state of the chain is periodically saved to and
+ *   restored from, the warmup profile written once warmup is over, the
+ *   column selection, the memory report, progress reporter, time
+ *   budget, startup timer and efficiency summary, the batch size of the
+ *   generated quantities pipeline, unconstrained output and the
+ *   capacity of the transformed parameters cache; see
+ *   <code>run_options</code> and
+ *   <code>mcmc_writer::set_run_options()</code>
+ * @throws std::invalid_argument if the checkpoint to resume from can't
+ *   be restored, or checkpoints are combined with an adaptive warmup
+ *   schedule, a generated quantities pipeline or unconstrained output,
+ *   before anything is written
+ *
+ * When the sampler uses an adaptive warmup schedule, warmup ends as
+ * soon as the sampler reports that its adaptation has converged, the
+ * <code>num_samples</code> draws follow, and the schedule followed is
+ * written with the adaptation info, after the metric.
+ *
+ * When compiled with STAN_INSTRUMENTATION, the totals of the
+ * instrumented regions are written to the logger at the end of the run.
  */
 template <class Sampler, class Model, class RNG>
 void run_adaptive_sampler(Sampler& sampler, Model& model,
@@ -42,50 +76,152 @@ void run_adaptive_sampler(Sampler& sampler, Model& model,
                           callbacks::interrupt& interrupt,
                           callbacks::logger& logger,
                           callbacks::writer& sample_writer,
-                          callbacks::writer& diagnostic_writer) {
+                          callbacks::writer& diagnostic_writer,
+                          size_t chain_id = 1, size_t num_chains = 1,
+                          const run_options& options = run_options()) {
+  STAN_INSTRUMENT_RUN(logger);
+  checkpoint* checkpoints = options.checkpoints;
+  warmup_profile* profile = options.profile;
+  memory_report* memory = options.memory;
+  const time_budget* budget = options.budget;
+  startup_timer* startup = options.startup;
+  if (memory)
+    memory->begin();
   Eigen::Map<Eigen::VectorXd> cont_params(cont_vector.data(),
                                           cont_vector.size());
+  stan::mcmc::sample s(cont_params, 0, 0);
+  int num_done = 0;
+  if (checkpoints && sampler.adaptive_schedule())
+    throw std::invalid_argument(
+        "Checkpoints can't be combined with an adaptive warmup schedule");
+  // A checkpoint doesn't record the draws still in the pipeline
+  if (checkpoints && options.gq_batch_size > 0)
+    throw std::invalid_argument(
+        "Checkpoints can't be combined with a generated quantities "
+        "pipeline");
+  // Nor the index of the next unconstrained draw
+  if (checkpoints && options.unconstrained_output)
+    throw std::invalid_argument(
+        "Checkpoints can't be combined with unconstrained output");
 
   sampler.engage_adaptation();
-  try {
-    sampler.z().q = cont_params;
-    sampler.init_stepsize(logger);
-  } catch (const std::exception& e) {
-    logger.info("Exception initializing step size.");
-    logger.info(e.what());
-    return;
+  if (checkpoints && checkpoints->resuming()) {
+    num_done = checkpoints->read_adaptive(num_warmup, num_samples, s, sampler,
+                                          rng);
+  } else {
+    try {
+      sampler.z().q = cont_params;
+      if (startup)
+        startup->record("sampler_setup");
+      if (profile)
+        profile->begin(sampler, "initial_stepsize");
+      sampler.init_stepsize(logger);
+      if (profile)
+        profile->end(sampler);
+      if (startup)
+        startup->record("init_stepsize");
+    } catch (const std::exception& e) {
+      logger.info("Exception initializing step size.");
+      logger.info(e.what());
+      return;
+    }
   }
 
   services::util::mcmc_writer writer(sample_writer, diagnostic_writer, logger);
-  stan::mcmc::sample s(cont_params, 0, 0);
+  writer.set_run_options(options);
+  if (options.gq_batch_size > 0)
+    writer.set_gq_pipeline(model, rng, options.gq_batch_size);
 
   // Headers
   writer.write_sample_names(s, sampler, model);
   writer.write_diagnostic_names(s, sampler, model);
 
+  int num_total = num_warmup + num_samples;
+  auto save_checkpoint = [&](int m) {
+    checkpoints->write_adaptive(m, num_warmup, num_samples, s, sampler, rng);
+  };
   auto start_warm = std::chrono::steady_clock::now();
-  util::generate_transitions(sampler, num_warmup, 0, num_warmup + num_samples,
-                             num_thin, refresh, save_warmup, true, writer, s,
-                             model, rng, interrupt, logger);
+  if (sampler.adaptive_schedule()) {
+    for (int m = 0; m < num_warmup; ++m) {
+      if (profile)
+        profile->begin(sampler, sampler.adaptation_phase());
+      int num_generated = util::generate_transitions(
+          sampler, 1, m, num_total, num_thin, refresh, save_warmup, true,
+          writer, s, model, rng, interrupt, logger, chain_id, num_chains, m);
+      if (profile)
+        profile->end(sampler);
+      if (num_generated == 0) {
+        num_warmup = m;
+        num_total = num_warmup + num_samples;
+        break;
+      }
+      if (sampler.adaptation_converged()) {
+        std::stringstream msg;
+        msg << "Warmup converged after " << m + 1 << " of " << num_warmup
+            << " iterations";
+        logger.info(msg);
+        num_warmup = m + 1;
+        num_total = num_warmup + num_samples;
+        break;
+      }
+    }
+  } else if (profile) {
+    // One iteration at a time, so each is attributed to its phase
+    for (int m = num_done; m < num_warmup; ++m) {
+      profile->begin(sampler, sampler.adaptation_phase());
+      util::generate_transitions_with_checkpoints(
+          sampler, m, m + 1, 0, num_total, num_thin, refresh, save_warmup,
+          true, writer, s, model, rng, interrupt, logger, chain_id,
+          num_chains, checkpoints, save_checkpoint);
+      profile->end(sampler);
+      if (budget && budget->expired())
+        break;
+    }
+  } else {
+    util::generate_transitions_with_checkpoints(
+        sampler, num_done, num_warmup, 0, num_total, num_thin, refresh,
+        save_warmup, true, writer, s, model, rng, interrupt, logger,
+        chain_id, num_chains, checkpoints, save_checkpoint);
+  }
   auto end_warm = std::chrono::steady_clock::now();
   double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
                             end_warm - start_warm)
                             .count()
                         / 1000.0;
   sampler.disengage_adaptation();
+  if (profile)
+    profile->write();
   writer.write_adapt_finish(sampler);
   sampler.write_sampler_state(sample_writer);
+  if (sampler.adaptive_schedule())
+    sampler.write_adaptation_schedule(sample_writer);
+  if (options.diagnostics)
+    writer.set_online_diagnostics(*options.diagnostics);
+  if (options.efficiency)
+    writer.set_efficiency_summary(*options.efficiency);
+
+  if (budget && num_warmup > num_done)
+    budget->log_plan(warm_delta_t / (num_warmup - num_done), num_samples,
+                     logger);
 
   auto start_sample = std::chrono::steady_clock::now();
-  util::generate_transitions(sampler, num_samples, num_warmup,
-                             num_warmup + num_samples, num_thin, refresh, true,
-                             false, writer, s, model, rng, interrupt, logger);
+  util::generate_transitions_with_checkpoints(
+      sampler, std::max(num_done, num_warmup), num_total, num_warmup,
+      num_total, num_thin, refresh, true, false, writer, s, model, rng,
+      interrupt, logger, chain_id, num_chains, checkpoints, save_checkpoint);
+  writer.flush_pipeline();
   auto end_sample = std::chrono::steady_clock::now();
   double sample_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
                               end_sample - start_sample)
                               .count()
                           / 1000.0;
   writer.write_timing(warm_delta_t, sample_delta_t);
+  if (options.efficiency)
+    options.efficiency->write(sample_delta_t);
+  if (memory) {
+    memory->add_sampling(sampler, writer);
+    memory->write();
+  }
 }
 }  // namespace util
 }  // namespace services
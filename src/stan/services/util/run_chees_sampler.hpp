@@ -0,0 +1,240 @@
+#ifndef STAN_SERVICES_UTIL_RUN_CHEES_SAMPLER_HPP
+#define STAN_SERVICES_UTIL_RUN_CHEES_SAMPLER_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/chees_adaptation.hpp>
+#include <stan/mcmc/stepsize_adaptation.hpp>
+#include <stan/mcmc/var_adaptation.hpp>
+#include <stan/services/util/generate_transitions.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+namespace internal {
+
+/**
+ * Return the number of leapfrog steps that integrate for about the
+ * given time, at least one.
+ */
+inline int chees_num_steps(double t, double stepsize) {
+  double steps = std::ceil(t / stepsize);
+  return steps < 1 ? 1 : steps > 1e6 ? 1000000 : static_cast<int>(steps);
+}
+
+}  // namespace internal
+
+/**
+ * Runs several chains of static HMC in lock-step, with a step size,
+ * integration time and diagonal metric shared by every chain and
+ * adapted jointly during warmup.
+ *
+ * Every iteration, all chains take one transition of the same number
+ * of leapfrog steps, so the cost of an iteration is the same for every
+ * chain. The integration time is the maximum time T scaled by the next
+ * jitter of <code>chees_adaptation</code>. During warmup:
+ *  - the step size is adapted by dual averaging of the harmonic mean of
+ *    the acceptance probabilities of the chains,
+ *  - T is adapted with the ChEES criterion estimated from the
+ *    trajectories of all chains, as in <code>chees_adaptation</code>,
+ *  - the metric is estimated from the pooled draws of all chains at the
+ *    end of each slow adaptation window, after which the step size is
+ *    initialized again and its adaptation restarted.
+ *
+ * After warmup the step size and T are fixed to their averaged values
+ * and the chains keep running jittered trajectories of that length.
+ *
+ * The interrupt and the logger are shared by every chain and must be
+ * safe to call from multiple threads.
+ *
+ * @tparam Sampler Type of static HMC sampler with a diagonal metric,
+ *   derived from <code>stan::mcmc::base_static_hmc</code>
+ * @tparam Model Type of model
+ * @tparam RNG Type of random number generator
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in,out] samplers the mcmc sampler of each chain
+ * @param[in] model the model concept to use for computing log probability
+ * @param[in] cont_vectors initial parameter values of each chain
+ * @param[in] num_warmup number of warmup draws
+ * @param[in] num_samples number of post warmup draws
+ * @param[in] num_thin number to thin the draws. Must be greater than
+ *   or equal to 1.
+ * @param[in] refresh controls output to the <code>logger</code>
+ * @param[in] save_warmup indicates whether the warmup draws should be
+ *   sent to the sample writer
+ * @param[in,out] rngs random number generator of each chain
+ * @param[in,out] stepsize_adaptation shared step size adaptation
+ * @param[in,out] chees shared integration time adaptation, set to the
+ *   initial integration time
+ * @param[in,out] var_adaptations metric adaptation of each chain, with
+ *   its window parameters set
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in,out] sample_writer writer for draws of each chain
+ * @param[in,out] diagnostic_writer writer for diagnostic information of
+ *   each chain
+ * @param[in] init_chain_id chain id of the first chain, used for printing
+ *   messages
+ */
+template <class Sampler, class Model, class RNG, class SampleWriter,
+          class DiagnosticWriter>
+void run_chees_sampler(
+    std::vector<Sampler>& samplers, Model& model,
+    std::vector<std::vector<double>>& cont_vectors, int num_warmup,
+    int num_samples, int num_thin, int refresh, bool save_warmup,
+    std::vector<RNG>& rngs,
+    stan::mcmc::stepsize_adaptation& stepsize_adaptation,
+    stan::mcmc::chees_adaptation& chees,
+    std::vector<stan::mcmc::var_adaptation>& var_adaptations,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer,
+    size_t init_chain_id = 1) {
+  const size_t num_chains = samplers.size();
+  const Eigen::Index num_params = cont_vectors[0].size();
+
+  std::vector<services::util::mcmc_writer> writers;
+  writers.reserve(num_chains);
+  std::vector<stan::mcmc::sample> samples;
+  samples.reserve(num_chains);
+  std::vector<stan::mcmc::var_adaptation*> adaptations;
+  adaptations.reserve(num_chains);
+  for (size_t i = 0; i < num_chains; ++i) {
+    Eigen::Map<Eigen::VectorXd> cont_params(cont_vectors[i].data(),
+                                            cont_vectors[i].size());
+    writers.emplace_back(sample_writer[i], diagnostic_writer[i], logger);
+    samples.emplace_back(cont_params, 0, 0);
+    adaptations.push_back(&var_adaptations[i]);
+    var_adaptations[i].set_cross_chain(true);
+  }
+
+  // The shared step size is the smallest of those initialized per chain
+  std::vector<double> stepsizes(num_chains);
+  auto init_stepsize = [&]() {
+    internal::for_each_chain(num_chains, [&](size_t i) {
+      samplers[i].z().q = samples[i].cont_params();
+      samplers[i].init_stepsize(logger);
+      stepsizes[i] = samplers[i].get_nominal_stepsize();
+    });
+    double stepsize = *std::min_element(stepsizes.begin(), stepsizes.end());
+    stepsize_adaptation.set_mu(std::log(10 * stepsize));
+    stepsize_adaptation.restart();
+    return stepsize;
+  };
+  double stepsize;
+  try {
+    stepsize = init_stepsize();
+  } catch (const std::exception& e) {
+    logger.info("Exception initializing step size.");
+    logger.info(e.what());
+    return;
+  }
+  for (size_t i = 0; i < num_chains; ++i) {
+    writers[i].write_sample_names(samples[i], samplers[i], model);
+    writers[i].write_diagnostic_names(samples[i], samplers[i], model);
+  }
+
+  Eigen::MatrixXd q(num_params, num_chains);
+  Eigen::MatrixXd q_end(num_params, num_chains);
+  Eigen::MatrixXd v_end(num_params, num_chains);
+  Eigen::VectorXd accept_prob(num_chains);
+  Eigen::VectorXd var = samplers[0].z().inv_e_metric_;
+  double T = chees.get_T();
+
+  // One transition of every chain, integrating for the jittered time
+  auto iterate = [&](int iteration, int start, bool warmup, bool save) {
+    double t = chees.next_jitter() * T;
+    int num_steps = internal::chees_num_steps(t, stepsize);
+    internal::for_each_chain(num_chains, [&](size_t i) {
+      samplers[i].set_stepsize_jitter(0);
+      samplers[i].set_nominal_stepsize_and_L(stepsize, num_steps);
+      q.col(i) = samples[i].cont_params();
+      util::generate_transitions(samplers[i], 1, start + iteration,
+                                 num_warmup + num_samples, num_thin, refresh,
+                                 save, warmup, writers[i], samples[i], model,
+                                 rngs[i], interrupt, logger, init_chain_id + i,
+                                 num_chains, iteration);
+      q_end.col(i) = samplers[i].get_proposal_q();
+      v_end.col(i) = samplers[i].get_proposal_velocity();
+      accept_prob(i) = samples[i].accept_stat();
+    });
+    return stepsize * num_steps;
+  };
+
+  auto start_warm = std::chrono::steady_clock::now();
+  for (int m = 0; m < num_warmup; ++m) {
+    double t = iterate(m, 0, true, save_warmup);
+
+    double harmonic_mean
+        = (accept_prob.array() > 0).all()
+              ? num_chains / accept_prob.array().inverse().sum()
+              : 0;
+    stepsize_adaptation.learn_stepsize(stepsize, harmonic_mean);
+    chees.learn_T(q, q_end, v_end, accept_prob, t);
+    T = chees.get_T();
+
+    for (size_t i = 0; i < num_chains; ++i)
+      var_adaptations[i].learn_variance(var, samples[i].cont_params());
+    if (stan::mcmc::var_adaptation::pool_variance(adaptations, var)) {
+      for (size_t i = 0; i < num_chains; ++i) {
+        samplers[i].set_metric(var);
+        samplers[i].set_nominal_stepsize(stepsize);
+      }
+      try {
+        stepsize = init_stepsize();
+      } catch (const std::exception& e) {
+        logger.info("Exception initializing step size.");
+        logger.info(e.what());
+        return;
+      }
+    }
+  }
+  if (num_warmup > 0) {
+    stepsize_adaptation.complete_adaptation(stepsize);
+    chees.complete_adaptation(T);
+  }
+  auto end_warm = std::chrono::steady_clock::now();
+  double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            end_warm - start_warm)
+                            .count()
+                        / 1000.0;
+
+  std::stringstream message;
+  message << "Integration time = " << T;
+  logger.info(message);
+  for (size_t i = 0; i < num_chains; ++i) {
+    samplers[i].set_nominal_stepsize(stepsize);
+    if (num_warmup > 0)
+      writers[i].write_adapt_finish(samplers[i]);
+    samplers[i].write_sampler_state(sample_writer[i]);
+    sample_writer[i](message.str());
+  }
+
+  auto start_sample = std::chrono::steady_clock::now();
+  for (int m = 0; m < num_samples; ++m)
+    iterate(m, num_warmup, false, true);
+  auto end_sample = std::chrono::steady_clock::now();
+  double sample_delta_t
+      = std::chrono::duration_cast<std::chrono::milliseconds>(end_sample
+                                                              - start_sample)
+            .count()
+        / 1000.0;
+  for (size_t i = 0; i < num_chains; ++i)
+    writers[i].write_timing(warm_delta_t, sample_delta_t);
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
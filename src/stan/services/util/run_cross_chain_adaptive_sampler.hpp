@@ -0,0 +1,321 @@
+#ifndef STAN_SERVICES_UTIL_RUN_CROSS_CHAIN_ADAPTIVE_SAMPLER_HPP
+#define STAN_SERVICES_UTIL_RUN_CROSS_CHAIN_ADAPTIVE_SAMPLER_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/covar_adaptation.hpp>
+#include <stan/mcmc/stepsize_covar_adapter.hpp>
+#include <stan/mcmc/stepsize_var_adapter.hpp>
+#include <stan/mcmc/var_adaptation.hpp>
+#include <stan/services/util/chain_communicator.hpp>
+#include <stan/services/util/chain_placement.hpp>
+#include <stan/services/util/generate_transitions.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/online_diagnostics.hpp>
+#include <stan/services/util/run_options.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+namespace internal {
+
+inline mcmc::var_adaptation& metric_adaptation(
+    mcmc::stepsize_var_adapter& adapter) {
+  return adapter.get_var_adaptation();
+}
+
+inline mcmc::covar_adaptation& metric_adaptation(
+    mcmc::stepsize_covar_adapter& adapter) {
+  return adapter.get_covar_adaptation();
+}
+
+inline bool pool_metric(const std::vector<mcmc::var_adaptation*>& adaptations,
+                        Eigen::VectorXd& inv_metric,
+                        chain_communicator* communicator) {
+  if (!communicator)
+    return mcmc::var_adaptation::pool_variance(adaptations, inv_metric);
+  return mcmc::var_adaptation::pool_variance(
+      adaptations, inv_metric, [communicator](Eigen::VectorXd& values) {
+        communicator->all_reduce_sum(values);
+      });
+}
+
+// Dense metrics are only pooled within a process, which the caller checks
+inline bool pool_metric(
+    const std::vector<mcmc::covar_adaptation*>& adaptations,
+    Eigen::MatrixXd& inv_metric, chain_communicator* communicator) {
+  return mcmc::covar_adaptation::pool_covariance(adaptations, inv_metric);
+}
+
+/**
+ * Runs <code>f(i)</code> for every chain <code>i</code> on the TBB thread
+ * pool, one chain per task, with the thread pinned to the chain's CPUs
+ * if a placement is given.
+ */
+template <typename F>
+void for_each_chain(size_t num_chains, const chain_placement* placement,
+                    const F& f) {
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_chains, 1),
+      [&f, placement](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          chain_placement::scope pin(placement, i);
+          f(i);
+        }
+      },
+      tbb::simple_partitioner());
+}
+
+/**
+ * Runs <code>f(i)</code> for every chain <code>i</code> on the TBB thread
+ * pool, one chain per task.
+ */
+template <typename F>
+void for_each_chain(size_t num_chains, const F& f) {
+  for_each_chain(num_chains, nullptr, f);
+}
+
+}  // namespace internal
+
+/**
+ * Runs several chains of an adaptive sampler whose metric is learned
+ * jointly across chains.
+ *
+ * Warmup is run in parallel up to the end of each slow adaptation
+ * window. At the window boundary the Welford estimates of all chains
+ * are pooled into one metric, which is pushed back to every chain
+ * before the step size adaptation is restarted, exactly as a single
+ * chain does with its own estimate. Each window therefore sees
+ * <code>num_chains</code> times as many draws as it would in a single
+ * chain. Sampling after warmup proceeds independently per chain.
+ *
+ * With a communicator the chains may be spread over several processes,
+ * each running this function with its own chains, writers and
+ * generators. The window estimates of all processes are then pooled
+ * with two reductions of their sums at each window boundary, and at the
+ * end of warmup every chain takes the geometric mean of the adapted step
+ * sizes of all chains, so all chains sample with the same metric and
+ * step size. If online diagnostics are given, the split R-hat and ESS
+ * across all chains are computed from sums once sampling ends and
+ * logged by the first process. Only diagonal metrics are pooled across
+ * processes; every process must run the same number of warmup and
+ * sampling iterations with the same window parameters.
+ *
+ * All samplers must be configured with the same window parameters.
+ * The interrupt and the logger are shared by every chain and must be
+ * safe to call from multiple threads.
+ *
+ * @tparam Sampler Type of adaptive sampler, derived from either
+ *   <code>stan::mcmc::stepsize_var_adapter</code> or
+ *   <code>stan::mcmc::stepsize_covar_adapter</code>
+ * @tparam Model Type of model
+ * @tparam RNG Type of random number generator
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in,out] samplers the mcmc sampler of each chain
+ * @param[in] model the model concept to use for computing log probability
+ * @param[in] cont_vectors initial parameter values of each chain
+ * @param[in] num_warmup number of warmup draws
+ * @param[in] num_samples number of post warmup draws
+ * @param[in] num_thin number to thin the draws. Must be greater than
+ *   or equal to 1.
+ * @param[in] refresh controls output to the <code>logger</code>
+ * @param[in] save_warmup indicates whether the warmup draws should be
+ *   sent to the sample writer
+ * @param[in,out] rngs random number generator of each chain
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in,out] sample_writer writer for draws of each chain
+ * @param[in,out] diagnostic_writer writer for diagnostic information of
+ *   each chain
+ * @param[in] init_chain_id chain id of the first chain, used for printing
+ *   messages
+ * @param[in] options options of the run, of which the online
+ *   diagnostics the draws after warmup are added to, the placement of
+ *   the chains' threads on cores or NUMA nodes and the communicator
+ *   connecting the processes running the chains are used
+ * @throw std::invalid_argument if a communicator is given with samplers
+ *   adapting a dense metric
+ */
+template <class Sampler, class Model, class RNG, class SampleWriter,
+          class DiagnosticWriter>
+void run_cross_chain_adaptive_sampler(
+    std::vector<Sampler>& samplers, Model& model,
+    std::vector<std::vector<double>>& cont_vectors, int num_warmup,
+    int num_samples, int num_thin, int refresh, bool save_warmup,
+    std::vector<RNG>& rngs, callbacks::interrupt& interrupt,
+    callbacks::logger& logger, std::vector<SampleWriter>& sample_writer,
+    std::vector<DiagnosticWriter>& diagnostic_writer,
+    size_t init_chain_id = 1, const run_options& options = run_options()) {
+  online_diagnostics* diagnostics = options.diagnostics;
+  const chain_placement* placement = options.placement;
+  chain_communicator* communicator = options.communicator;
+  using adaptation_t = std::decay_t<decltype(
+      internal::metric_adaptation(samplers[0]))>;
+  if (communicator && !std::is_same<adaptation_t, mcmc::var_adaptation>::value)
+    throw std::invalid_argument(
+        "Only diagonal metrics can be adapted across processes");
+  const size_t num_chains = samplers.size();
+
+  std::vector<services::util::mcmc_writer> writers;
+  writers.reserve(num_chains);
+  std::vector<stan::mcmc::sample> samples;
+  samples.reserve(num_chains);
+  std::vector<adaptation_t*> adaptations;
+  adaptations.reserve(num_chains);
+  // Chains whose step size could not be initialized are dropped, as the
+  // single chain sampler returns without drawing in that case
+  std::vector<char> running(num_chains, 1);
+  for (size_t i = 0; i < num_chains; ++i) {
+    Eigen::Map<Eigen::VectorXd> cont_params(cont_vectors[i].data(),
+                                            cont_vectors[i].size());
+    writers.emplace_back(sample_writer[i], diagnostic_writer[i], logger);
+    samples.emplace_back(cont_params, 0, 0);
+    adaptations.push_back(&internal::metric_adaptation(samplers[i]));
+    adaptations.back()->set_cross_chain(true);
+  }
+
+  internal::for_each_chain(num_chains, placement, [&](size_t i) {
+    samplers[i].engage_adaptation();
+    try {
+      samplers[i].z().q = samples[i].cont_params();
+      samplers[i].init_stepsize(logger);
+    } catch (const std::exception& e) {
+      logger.info("Exception initializing step size.");
+      logger.info(e.what());
+      running[i] = 0;
+      return;
+    }
+    writers[i].write_sample_names(samples[i], samplers[i], model);
+    writers[i].write_diagnostic_names(samples[i], samplers[i], model);
+  });
+
+  auto lead = std::find(running.begin(), running.end(), 1);
+  if (communicator) {
+    // Every process takes part in every reduction, so the run stops
+    // everywhere if a process has no chain left
+    Eigen::VectorXd num_failed(1);
+    num_failed(0) = lead == running.end();
+    communicator->all_reduce_sum(num_failed);
+    if (num_failed(0) > 0) {
+      logger.error("No chain could be started on some of the processes.");
+      return;
+    }
+  }
+  if (lead == running.end())
+    return;
+  const adaptation_t& schedule = *adaptations[lead - running.begin()];
+
+  auto start_warm = std::chrono::steady_clock::now();
+  int iteration = 0;
+  while (iteration < num_warmup) {
+    int remaining = num_warmup - iteration;
+    int window_end = static_cast<int>(schedule.transitions_to_window_end());
+    int chunk = window_end == 0 ? remaining : std::min(window_end, remaining);
+
+    internal::for_each_chain(num_chains, placement, [&](size_t i) {
+      if (!running[i])
+        return;
+      util::generate_transitions(
+          samplers[i], chunk, iteration, num_warmup + num_samples, num_thin,
+          refresh, save_warmup, true, writers[i], samples[i], model, rngs[i],
+          interrupt, logger, init_chain_id + i, num_chains, iteration);
+    });
+    iteration += chunk;
+
+    auto inv_metric = samplers[lead - running.begin()].z().inv_e_metric_;
+    if (!internal::pool_metric(adaptations, inv_metric, communicator))
+      continue;
+    internal::for_each_chain(num_chains, placement, [&](size_t i) {
+      if (!running[i])
+        return;
+      samplers[i].z().set_metric(inv_metric);
+      samplers[i].init_stepsize(logger);
+      samplers[i].get_stepsize_adaptation().set_mu(
+          std::log(10 * samplers[i].get_nominal_stepsize()));
+      samplers[i].get_stepsize_adaptation().restart();
+    });
+  }
+  auto end_warm = std::chrono::steady_clock::now();
+  double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            end_warm - start_warm)
+                            .count()
+                        / 1000.0;
+
+  for (size_t i = 0; i < num_chains; ++i)
+    if (running[i])
+      samplers[i].disengage_adaptation();
+  if (communicator) {
+    Eigen::VectorXd log_stepsize = Eigen::VectorXd::Zero(2);
+    for (size_t i = 0; i < num_chains; ++i) {
+      if (!running[i])
+        continue;
+      log_stepsize(0) += std::log(samplers[i].get_nominal_stepsize());
+      log_stepsize(1) += 1;
+    }
+    communicator->all_reduce_sum(log_stepsize);
+    for (size_t i = 0; i < num_chains; ++i)
+      if (running[i])
+        samplers[i].set_nominal_stepsize(
+            std::exp(log_stepsize(0) / log_stepsize(1)));
+  }
+
+  internal::for_each_chain(num_chains, placement, [&](size_t i) {
+    if (!running[i])
+      return;
+    writers[i].write_adapt_finish(samplers[i]);
+    samplers[i].write_sampler_state(sample_writer[i]);
+    if (diagnostics)
+      writers[i].set_online_diagnostics(*diagnostics);
+
+    auto start_sample = std::chrono::steady_clock::now();
+    util::generate_transitions(samplers[i], num_samples, num_warmup,
+                               num_warmup + num_samples, num_thin, refresh,
+                               true, false, writers[i], samples[i], model,
+                               rngs[i], interrupt, logger, init_chain_id + i,
+                               num_chains);
+    auto end_sample = std::chrono::steady_clock::now();
+    double sample_delta_t
+        = std::chrono::duration_cast<std::chrono::milliseconds>(end_sample
+                                                                - start_sample)
+              .count()
+          / 1000.0;
+    writers[i].write_timing(warm_delta_t, sample_delta_t);
+  });
+
+  if (!communicator || !diagnostics)
+    return;
+  Eigen::VectorXd rhat;
+  Eigen::VectorXd ess;
+  diagnostics->reduce_split_diagnostics(*communicator, rhat, ess);
+  if (communicator->rank() != 0)
+    return;
+  std::stringstream message;
+  message << "Diagnostics across " << communicator->size() << " processes:";
+  logger.info(message);
+  for (size_t k = 0; k < diagnostics->names().size(); ++k) {
+    std::stringstream line;
+    line << "  " << diagnostics->names()[k] << ": R-hat = "
+         << std::setprecision(4) << rhat(k) << ", ESS = "
+         << std::setprecision(6) << ess(k);
+    logger.info(line);
+  }
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,207 @@
+#ifndef STAN_SERVICES_UTIL_RUN_FORKED_SAMPLER_HPP
+#define STAN_SERVICES_UTIL_RUN_FORKED_SAMPLER_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/services/util/generate_transitions.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+namespace internal {
+
+/**
+ * Set the metric of a sampler to that of another through its Cholesky
+ * factor, for metrics that cache the factor used to draw momenta.
+ */
+template <class Sampler>
+auto copy_metric(Sampler& to, const Sampler& from, int)
+    -> decltype(from.z().inv_e_metric_factor(), void()) {
+  to.set_metric_factor(from.z().inv_e_metric_factor());
+}
+
+/**
+ * Set the metric of a sampler to that of another.
+ */
+template <class Sampler>
+void copy_metric(Sampler& to, const Sampler& from, long) {
+  to.set_metric(from.z().inv_e_metric_);
+}
+
+}  // namespace internal
+
+/**
+ * Runs warmup on a few chains and then forks them into more sampling
+ * chains, so that warmup is paid for once per warmup chain instead of
+ * once per sampling chain.
+ *
+ * The warmup chains adapt in parallel on the TBB thread pool, each on
+ * its own. Sampling chain <code>k</code> is then forked from warmup
+ * chain <code>k % num_warmup_chains</code>: it takes over the adapted
+ * step size, step size jitter, maximum tree depth and metric of that
+ * chain and starts from its last warmup draw. The sampling chains run
+ * in parallel, each with its own generator and writers, without
+ * adaptation.
+ *
+ * Every sampling chain writes its own header, adaptation results and
+ * timing. With <code>save_warmup</code> the warmup draws of warmup
+ * chain <code>w</code> are written by sampling chain <code>w</code>;
+ * the other sampling chains have no warmup draws. The warmup time
+ * written by a chain is that of all of warmup.
+ *
+ * Sampling chains forked from the same warmup chain start at the same
+ * point and only separate as their generators differ, so convergence
+ * diagnostics comparing the chains are only as informative as the
+ * number of warmup chains.
+ *
+ * The interrupt and the logger are shared by every chain and must be
+ * safe to call from multiple threads.
+ *
+ * @tparam Sampler Type of adaptive sampler
+ * @tparam Model Type of model
+ * @tparam RNG Type of random number generator
+ * @tparam SampleWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @tparam DiagnosticWriter A type derived from
+ *   <code>stan::callbacks::writer</code>
+ * @param[in,out] warmup_samplers the sampler of each warmup chain
+ * @param[in,out] samplers the sampler of each sampling chain, at least as
+ *   many as warmup samplers
+ * @param[in] model the model concept to use for computing log probability
+ * @param[in] cont_vectors initial parameter values of each warmup chain
+ * @param[in] num_warmup number of warmup draws
+ * @param[in] num_samples number of post warmup draws of each sampling
+ *   chain
+ * @param[in] num_thin number to thin the draws. Must be greater than
+ *   or equal to 1.
+ * @param[in] refresh controls output to the <code>logger</code>
+ * @param[in] save_warmup indicates whether the warmup draws should be
+ *   sent to the sample writer
+ * @param[in,out] warmup_rngs random number generator of each warmup
+ *   chain, as used by its sampler
+ * @param[in,out] rngs random number generator of each sampling chain, as
+ *   used by its sampler
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in,out] sample_writer writer for draws of each sampling chain
+ * @param[in,out] diagnostic_writer writer for diagnostic information of
+ *   each sampling chain
+ * @param[in] init_chain_id chain id of the first chain, used for printing
+ *   messages
+ */
+template <class Sampler, class Model, class RNG, class SampleWriter,
+          class DiagnosticWriter>
+void run_forked_sampler(std::vector<Sampler>& warmup_samplers,
+                        std::vector<Sampler>& samplers, Model& model,
+                        std::vector<std::vector<double>>& cont_vectors,
+                        int num_warmup, int num_samples, int num_thin,
+                        int refresh, bool save_warmup,
+                        std::vector<RNG>& warmup_rngs, std::vector<RNG>& rngs,
+                        callbacks::interrupt& interrupt,
+                        callbacks::logger& logger,
+                        std::vector<SampleWriter>& sample_writer,
+                        std::vector<DiagnosticWriter>& diagnostic_writer,
+                        size_t init_chain_id = 1) {
+  const size_t num_warmup_chains = warmup_samplers.size();
+  const size_t num_chains = samplers.size();
+
+  std::vector<services::util::mcmc_writer> writers;
+  writers.reserve(num_chains);
+  std::vector<stan::mcmc::sample> samples;
+  samples.reserve(num_chains);
+  for (size_t k = 0; k < num_chains; ++k) {
+    const std::vector<double>& init = cont_vectors[k % num_warmup_chains];
+    Eigen::Map<const Eigen::VectorXd> cont_params(init.data(), init.size());
+    writers.emplace_back(sample_writer[k], diagnostic_writer[k], logger);
+    samples.emplace_back(cont_params, 0, 0);
+  }
+
+  // A warmup chain whose step size could not be initialized forks no
+  // sampling chains, as the single chain sampler returns without drawing
+  std::vector<char> running(num_warmup_chains, 1);
+  internal::for_each_chain(num_warmup_chains, [&](size_t w) {
+    warmup_samplers[w].engage_adaptation();
+    try {
+      warmup_samplers[w].z().q = samples[w].cont_params();
+      warmup_samplers[w].init_stepsize(logger);
+    } catch (const std::exception& e) {
+      logger.info("Exception initializing step size.");
+      logger.info(e.what());
+      running[w] = 0;
+    }
+  });
+  for (size_t k = 0; k < num_chains; ++k) {
+    if (!running[k % num_warmup_chains])
+      continue;
+    writers[k].write_sample_names(samples[k], samplers[k], model);
+    writers[k].write_diagnostic_names(samples[k], samplers[k], model);
+  }
+
+  auto start_warm = std::chrono::steady_clock::now();
+  internal::for_each_chain(num_warmup_chains, [&](size_t w) {
+    if (!running[w])
+      return;
+    util::generate_transitions(warmup_samplers[w], num_warmup, 0,
+                               num_warmup + num_samples, num_thin, refresh,
+                               save_warmup, true, writers[w], samples[w],
+                               model, warmup_rngs[w], interrupt, logger,
+                               init_chain_id + w, num_warmup_chains);
+    warmup_samplers[w].disengage_adaptation();
+  });
+  auto end_warm = std::chrono::steady_clock::now();
+  double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            end_warm - start_warm)
+                            .count()
+                        / 1000.0;
+
+  std::stringstream msg;
+  msg << "Forking " << num_chains << " sampling chains from "
+      << num_warmup_chains << " warmup chains";
+  logger.info(msg);
+
+  // Fork before any sampling chain moves, as chain w is both the
+  // source of its forks and a sampling chain itself
+  for (size_t k = 0; k < num_chains; ++k) {
+    const size_t w = k % num_warmup_chains;
+    if (!running[w])
+      continue;
+    Sampler& source = warmup_samplers[w];
+    internal::copy_metric(samplers[k], source, 0);
+    samplers[k].set_nominal_stepsize(source.get_nominal_stepsize());
+    samplers[k].set_stepsize_jitter(source.get_stepsize_jitter());
+    samplers[k].set_max_depth(source.get_max_depth());
+    samples[k] = samples[w];
+  }
+
+  internal::for_each_chain(num_chains, [&](size_t k) {
+    if (!running[k % num_warmup_chains])
+      return;
+    writers[k].write_adapt_finish(samplers[k]);
+    samplers[k].write_sampler_state(sample_writer[k]);
+
+    auto start_sample = std::chrono::steady_clock::now();
+    util::generate_transitions(samplers[k], num_samples, num_warmup,
+                               num_warmup + num_samples, num_thin, refresh,
+                               true, false, writers[k], samples[k], model,
+                               rngs[k], interrupt, logger, init_chain_id + k,
+                               num_chains);
+    auto end_sample = std::chrono::steady_clock::now();
+    double sample_delta_t
+        = std::chrono::duration_cast<std::chrono::milliseconds>(end_sample
+                                                                - start_sample)
+              .count()
+          / 1000.0;
+    writers[k].write_timing(warm_delta_t, sample_delta_t);
+  });
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
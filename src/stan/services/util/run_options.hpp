@@ -0,0 +1,148 @@
+#ifndef STAN_SERVICES_UTIL_RUN_OPTIONS_HPP
+#define STAN_SERVICES_UTIL_RUN_OPTIONS_HPP
+
+#include <cstddef>
+
+namespace stan {
+namespace services {
+namespace util {
+
+class chain_communicator;
+class chain_placement;
+class checkpoint;
+class column_selection;
+class efficiency_summary;
+class memory_report;
+class online_diagnostics;
+class profile_report;
+class progress_reporter;
+class startup_timer;
+class thread_budget;
+class time_budget;
+class warmup_profile;
+
+/**
+ * The optional collectors, outputs and settings of a sampler run,
+ * passed together to the samplers and services instead of one
+ * argument each. Every pointer is null and every setting off by
+ * default, so a run only names what it uses:
+ *
+ * <pre>
+ * util::run_options options;
+ * options.budget = &budget;
+ * options.progress = &progress;
+ * </pre>
+ *
+ * The options don't own what they point to, which must outlive the
+ * run. Options that don't apply to a sampler or service are ignored.
+ */
+struct run_options {
+  /**
+   * Online diagnostics the draws after warmup are added to.
+   */
+  online_diagnostics* diagnostics = nullptr;
+
+  /**
+   * Checkpoint the state of the chain is periodically saved to and,
+   * when resuming, restored from.
+   */
+  checkpoint* checkpoints = nullptr;
+
+  /**
+   * Collector of the time and gradient evaluations spent in each
+   * warmup phase, which is written once warmup is over.
+   */
+  warmup_profile* profile = nullptr;
+
+  /**
+   * Selection of the model columns written with each draw, or null to
+   * write them all.
+   */
+  const column_selection* columns = nullptr;
+
+  /**
+   * Collector of the memory taken by the autodiff arena, the sampler
+   * state and the draw buffers, which is written at the end of the run.
+   */
+  memory_report* memory = nullptr;
+
+  /**
+   * Progress reporter every transition is recorded with.
+   */
+  progress_reporter* progress = nullptr;
+
+  /**
+   * Wall clock budget of the chain, after which the remaining
+   * iterations are skipped.
+   */
+  const time_budget* budget = nullptr;
+
+  /**
+   * Timer of the startup phases, which are written after the first
+   * transition.
+   */
+  startup_timer* startup = nullptr;
+
+  /**
+   * Efficiency summary the sampling draws are added to and which is
+   * written at the end of the run.
+   */
+  efficiency_summary* efficiency = nullptr;
+
+  /**
+   * Report of the profiles of the model written at the end of the run.
+   */
+  profile_report* profiles = nullptr;
+
+  /**
+   * Placement of the chains' threads on cores or NUMA nodes, or null to
+   * leave them to the scheduler.
+   */
+  const chain_placement* placement = nullptr;
+
+  /**
+   * Communicator connecting the processes of a run whose chains are
+   * spread over several processes, or null for a run in one process.
+   */
+  chain_communicator* communicator = nullptr;
+
+  /**
+   * Division of the threads between the chains and the parallelism
+   * within them, or null to run the chains directly on the TBB pool.
+   */
+  const thread_budget* threads = nullptr;
+
+  /**
+   * Number of draws whose transformed parameters and generated
+   * quantities are computed together off the chain's thread, or 0 to
+   * compute them between transitions; see
+   * <code>mcmc_writer::set_gq_pipeline()</code>.
+   */
+  size_t gq_batch_size = 0;
+
+  /**
+   * Whether to write the unconstrained parameters of the draws, to be
+   * constrained later, instead of their constrained values; see
+   * <code>mcmc_writer::set_run_options()</code>.
+   */
+  bool unconstrained_output = false;
+
+  /**
+   * Number of points whose transformed parameters are kept from the
+   * gradient evaluations for the draws written, or 0 to compute them
+   * again; see <code>mcmc_writer::set_run_options()</code>.
+   */
+  size_t tparams_cache_capacity = 0;
+
+  /**
+   * Tolerance of the adaptive warmup schedule, which ends warmup once
+   * successive metric estimates and the step size change by less than
+   * it, or zero for the fixed schedule.
+   */
+  double adapt_tolerance = 0;
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,185 @@
+#ifndef STAN_SERVICES_UTIL_RUN_REPLICA_EXCHANGE_SAMPLER_HPP
+#define STAN_SERVICES_UTIL_RUN_REPLICA_EXCHANGE_SAMPLER_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/mcmc/replica_exchange.hpp>
+#include <stan/services/util/generate_transitions.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Runs replica exchange (parallel tempering) with one adaptive sampler
+ * per temperature of the ladder. Sampler <code>k</code> targets the
+ * density raised to the power of the k-th inverse temperature, and only
+ * the draws of sampler 0, at inverse temperature 1, are written.
+ *
+ * The replicas take their transitions in parallel on the TBB thread
+ * pool. Every <code>swap_interval</code> iterations the states of
+ * adjacent temperatures are proposed for exchange as in
+ * <code>stan::mcmc::replica_exchange</code>. During warmup each sampler
+ * adapts its own step size and metric and the ladder is adapted to the
+ * target swap rate; the adaptation of the ladder is disengaged and its
+ * swap counts restarted after warmup. The swap rates of sampling are
+ * logged at the end.
+ *
+ * The tempered replicas report their messages to a silent logger. The
+ * interrupt is shared by every replica and must be safe to call from
+ * multiple threads.
+ *
+ * @tparam Sampler Type of adaptive HMC sampler, derived from
+ *   <code>stan::mcmc::base_hmc</code>
+ * @tparam Model Type of model
+ * @tparam RNG Type of random number generator
+ * @param[in,out] samplers the mcmc sampler of each temperature
+ * @param[in] model the model concept to use for computing log probability
+ * @param[in] cont_vectors initial parameter values of each temperature
+ * @param[in] num_warmup number of warmup draws
+ * @param[in] num_samples number of post warmup draws
+ * @param[in] num_thin number to thin the draws. Must be greater than
+ *   or equal to 1.
+ * @param[in] refresh controls output to the <code>logger</code>
+ * @param[in] save_warmup indicates whether the warmup draws should be
+ *   sent to the sample writer
+ * @param[in,out] rngs random number generator of each temperature
+ * @param[in,out] swap_rng random number generator of the swaps
+ * @param[in,out] ladder ladder of inverse temperatures, with as many
+ *   temperatures as samplers
+ * @param[in] swap_interval number of iterations between swap rounds,
+ *   at least 1
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in,out] sample_writer writer for draws at inverse temperature 1
+ * @param[in,out] diagnostic_writer writer for diagnostic information at
+ *   inverse temperature 1
+ */
+template <class Sampler, class Model, class RNG>
+void run_replica_exchange_sampler(
+    std::vector<Sampler>& samplers, Model& model,
+    std::vector<std::vector<double>>& cont_vectors, int num_warmup,
+    int num_samples, int num_thin, int refresh, bool save_warmup,
+    std::vector<RNG>& rngs, RNG& swap_rng,
+    stan::mcmc::replica_exchange& ladder, int swap_interval,
+    callbacks::interrupt& interrupt, callbacks::logger& logger,
+    callbacks::writer& sample_writer, callbacks::writer& diagnostic_writer) {
+  const size_t num_temps = samplers.size();
+  if (swap_interval < 1)
+    swap_interval = 1;
+
+  callbacks::writer silent_writer;
+  callbacks::logger silent_logger;
+  auto replica_logger = [&](size_t k) -> callbacks::logger& {
+    return k == 0 ? logger : silent_logger;
+  };
+
+  std::vector<services::util::mcmc_writer> writers;
+  writers.reserve(num_temps);
+  std::vector<stan::mcmc::sample> samples;
+  samples.reserve(num_temps);
+  for (size_t k = 0; k < num_temps; ++k) {
+    Eigen::Map<Eigen::VectorXd> cont_params(cont_vectors[k].data(),
+                                            cont_vectors[k].size());
+    if (k == 0)
+      writers.emplace_back(sample_writer, diagnostic_writer, logger);
+    else
+      writers.emplace_back(silent_writer, silent_writer, silent_logger);
+    samples.emplace_back(cont_params, 0, 0);
+  }
+
+  std::vector<char> failed(num_temps, 0);
+  internal::for_each_chain(num_temps, [&](size_t k) {
+    samplers[k].engage_adaptation();
+    samplers[k].set_inverse_temperature(ladder.betas()[k]);
+    try {
+      samplers[k].z().q = samples[k].cont_params();
+      samplers[k].init_stepsize(replica_logger(k));
+    } catch (const std::exception& e) {
+      failed[k] = 1;
+    }
+  });
+  if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+    logger.info("Exception initializing step size.");
+    return;
+  }
+  writers[0].write_sample_names(samples[0], samplers[0], model);
+  writers[0].write_diagnostic_names(samples[0], samplers[0], model);
+
+  std::vector<double> log_probs(num_temps);
+  auto iterate = [&](int iteration, int start, bool warmup, bool save) {
+    internal::for_each_chain(num_temps, [&](size_t k) {
+      util::generate_transitions(
+          samplers[k], 1, start + iteration, num_warmup + num_samples,
+          num_thin, k == 0 ? refresh : 0, k == 0 && save, warmup, writers[k],
+          samples[k], model, rngs[k], interrupt, replica_logger(k), 1, 1,
+          iteration);
+    });
+    if ((iteration + 1) % swap_interval != 0)
+      return;
+    // The draws hold the tempered log density
+    for (size_t k = 0; k < num_temps; ++k)
+      log_probs[k] = samples[k].log_prob() / ladder.betas()[k];
+    std::vector<bool> swapped = ladder.propose_swaps(log_probs, swap_rng);
+    for (size_t k = 0; k < swapped.size(); ++k)
+      if (swapped[k])
+        std::swap(samples[k], samples[k + 1]);
+    if (ladder.adapting())
+      for (size_t k = 0; k < num_temps; ++k)
+        samplers[k].set_inverse_temperature(ladder.betas()[k]);
+  };
+
+  ladder.engage_adaptation();
+  auto start_warm = std::chrono::steady_clock::now();
+  for (int m = 0; m < num_warmup; ++m)
+    iterate(m, 0, true, save_warmup);
+  auto end_warm = std::chrono::steady_clock::now();
+  double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            end_warm - start_warm)
+                            .count()
+                        / 1000.0;
+  ladder.disengage_adaptation();
+  ladder.restart();
+
+  for (size_t k = 0; k < num_temps; ++k)
+    samplers[k].disengage_adaptation();
+  writers[0].write_adapt_finish(samplers[0]);
+  samplers[0].write_sampler_state(sample_writer);
+  std::stringstream ladder_message;
+  ladder_message << "Inverse temperatures = ";
+  for (size_t k = 0; k < num_temps; ++k)
+    ladder_message << (k > 0 ? ", " : "") << ladder.betas()[k];
+  sample_writer(ladder_message.str());
+  logger.info(ladder_message);
+
+  auto start_sample = std::chrono::steady_clock::now();
+  for (int m = 0; m < num_samples; ++m)
+    iterate(m, num_warmup, false, true);
+  auto end_sample = std::chrono::steady_clock::now();
+  double sample_delta_t
+      = std::chrono::duration_cast<std::chrono::milliseconds>(end_sample
+                                                              - start_sample)
+            .count()
+        / 1000.0;
+
+  std::vector<double> rates = ladder.swap_rates();
+  std::stringstream rate_message;
+  rate_message << "Swap rates between adjacent temperatures = ";
+  for (size_t k = 0; k < rates.size(); ++k)
+    rate_message << (k > 0 ? ", " : "") << rates[k];
+  logger.info(rate_message);
+  writers[0].write_timing(warm_delta_t, sample_delta_t);
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -2,8 +2,15 @@
 #define STAN_SERVICES_UTIL_RUN_SAMPLER_HPP
 
 #include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/instrumentation.hpp>
+#include <stan/services/util/checkpoint.hpp>
+#include <stan/services/util/column_selection.hpp>
 #include <stan/services/util/generate_transitions.hpp>
 #include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/memory_report.hpp>
+#include <stan/services/util/online_diagnostics.hpp>
+#include <stan/services/util/run_options.hpp>
+#include <algorithm>
 #include <chrono>
 #include <vector>
 
@@ -31,6 +38,22 @@ namespace util {
  * @param[in,out] logger logger for messages
  * @param[in,out] sample_writer writer for draws
  * @param[in,out] diagnostic_writer writer for diagnostic information
+ * @param[in] chain_id the chain id used for printing messages
+ * @param[in] num_chains the number of chains run in parallel
+ * @param[in] options optional collectors and outputs of the run: the
+ *   online diagnostics the draws after warmup are added to, the
+ *   checkpoint the state of the chain is periodically saved to and
+ *   restored from, the column selection, the memory report, progress
+ *   reporter, time budget, startup timer and efficiency summary and the
+ *   capacity of the transformed parameters cache; see
+ *   <code>run_options</code> and
+ *   <code>mcmc_writer::set_run_options()</code>. Unconstrained output
+ *   and a generated quantities pipeline are ignored.
+ * @throws std::invalid_argument if the checkpoint to resume from can't
+ *   be restored, before anything is written
+ *
+ * When compiled with STAN_INSTRUMENTATION, the totals of the
+ * instrumented regions are written to the logger at the end of the run.
  */
 template <class Model, class RNG>
 void run_sampler(stan::mcmc::base_mcmc& sampler, Model& model,
@@ -38,20 +61,40 @@ void run_sampler(stan::mcmc::base_mcmc& sampler, Model& model,
                  int num_samples, int num_thin, int refresh, bool save_warmup,
                  RNG& rng, callbacks::interrupt& interrupt,
                  callbacks::logger& logger, callbacks::writer& sample_writer,
-                 callbacks::writer& diagnostic_writer) {
+                 callbacks::writer& diagnostic_writer, size_t chain_id = 1,
+                 size_t num_chains = 1,
+                 const run_options& options = run_options()) {
+  STAN_INSTRUMENT_RUN(logger);
+  checkpoint* checkpoints = options.checkpoints;
+  memory_report* memory = options.memory;
+  const time_budget* budget = options.budget;
+  if (memory)
+    memory->begin();
   Eigen::Map<Eigen::VectorXd> cont_params(cont_vector.data(),
                                           cont_vector.size());
-  services::util::mcmc_writer writer(sample_writer, diagnostic_writer, logger);
   stan::mcmc::sample s(cont_params, 0, 0);
+  int num_done = 0;
+  if (checkpoints && checkpoints->resuming())
+    num_done = checkpoints->read(num_warmup, num_samples, s, sampler, rng);
+
+  services::util::mcmc_writer writer(sample_writer, diagnostic_writer, logger);
+  run_options writer_options = options;
+  writer_options.unconstrained_output = false;
+  writer.set_run_options(writer_options);
 
   // Headers
   writer.write_sample_names(s, sampler, model);
   writer.write_diagnostic_names(s, sampler, model);
 
+  int num_total = num_warmup + num_samples;
+  auto save_checkpoint = [&](int m) {
+    checkpoints->write(m, num_warmup, num_samples, s, sampler, rng);
+  };
   auto start_warm = std::chrono::steady_clock::now();
-  util::generate_transitions(sampler, num_warmup, 0, num_warmup + num_samples,
-                             num_thin, refresh, save_warmup, true, writer, s,
-                             model, rng, interrupt, logger);
+  util::generate_transitions_with_checkpoints(
+      sampler, num_done, num_warmup, 0, num_total, num_thin, refresh,
+      save_warmup, true, writer, s, model, rng, interrupt, logger, chain_id,
+      num_chains, checkpoints, save_checkpoint);
   auto end_warm = std::chrono::steady_clock::now();
   double warm_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
                             end_warm - start_warm)
@@ -59,17 +102,32 @@ void run_sampler(stan::mcmc::base_mcmc& sampler, Model& model,
                         / 1000.0;
   writer.write_adapt_finish(sampler);
   sampler.write_sampler_state(sample_writer);
+  if (options.diagnostics)
+    writer.set_online_diagnostics(*options.diagnostics);
+  if (options.efficiency)
+    writer.set_efficiency_summary(*options.efficiency);
+
+  if (budget && num_warmup > num_done)
+    budget->log_plan(warm_delta_t / (num_warmup - num_done), num_samples,
+                     logger);
 
   auto start_sample = std::chrono::steady_clock::now();
-  util::generate_transitions(sampler, num_samples, num_warmup,
-                             num_warmup + num_samples, num_thin, refresh, true,
-                             false, writer, s, model, rng, interrupt, logger);
+  util::generate_transitions_with_checkpoints(
+      sampler, std::max(num_done, num_warmup), num_total, num_warmup,
+      num_total, num_thin, refresh, true, false, writer, s, model, rng,
+      interrupt, logger, chain_id, num_chains, checkpoints, save_checkpoint);
   auto end_sample = std::chrono::steady_clock::now();
   double sample_delta_t = std::chrono::duration_cast<std::chrono::milliseconds>(
                               end_sample - start_sample)
                               .count()
                           / 1000.0;
   writer.write_timing(warm_delta_t, sample_delta_t);
+  if (options.efficiency)
+    options.efficiency->write(sample_delta_t);
+  if (memory) {
+    memory->add_sampling(sampler, writer);
+    memory->write();
+  }
 }
 }  // namespace util
 }  // namespace services
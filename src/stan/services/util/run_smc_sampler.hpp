@@ -0,0 +1,218 @@
+#ifndef STAN_SERVICES_UTIL_RUN_SMC_SAMPLER_HPP
+#define STAN_SERVICES_UTIL_RUN_SMC_SAMPLER_HPP
+
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/math/prim/fun/constants.hpp>
+#include <stan/mcmc/sample.hpp>
+#include <stan/services/util/mcmc_writer.hpp>
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <stan/services/util/smc_tempering.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Runs a sequential Monte Carlo sampler that tempers a population of
+ * particles from a normal reference density to the posterior, and
+ * writes the final population as draws.
+ *
+ * The particles start as exact draws from the reference, the normal
+ * with mean zero and standard deviation <code>reference_scale</code> in
+ * every unconstrained coordinate, at inverse temperature 0. Each
+ * tempering step
+ *  - picks the next inverse temperature so that the effective sample
+ *    size of the incremental weights is <code>ess_fraction</code> of the
+ *    population,
+ *  - adds the log mean incremental weight to the estimate of the log
+ *    normalizing constant,
+ *  - resamples the particles systematically,
+ *  - sets the diagonal metric to the variances of the particles, and
+ *  - moves every particle with <code>num_moves</code> transitions of its
+ *    static HMC sampler at the new temperature, in parallel on the TBB
+ *    thread pool,
+ * until the inverse temperature reaches 1. The step size is scaled
+ * after each step by the exponential of the difference between the
+ * mean acceptance statistic of the moves and <code>delta</code>.
+ *
+ * The log density is evaluated with all constants, so the final
+ * estimate is of the log marginal likelihood of the model, including
+ * the Jacobian of the transform to the unconstrained space. It is
+ * written to the sample writer and the logger after the draws.
+ *
+ * The interrupt is called once per tempering step.
+ *
+ * @tparam Sampler Type of static HMC sampler with a diagonal metric,
+ *   derived from <code>stan::mcmc::base_static_hmc</code>
+ * @tparam Model Type of model
+ * @tparam RNG Type of random number generator
+ * @param[in,out] samplers the sampler of each particle
+ * @param[in] model the model concept to use for computing log probability
+ * @param[in,out] rngs random number generator of each particle, as used
+ *   by its sampler
+ * @param[in,out] rng random number generator of the resampling and of
+ *   the generated quantities
+ * @param[in] reference_scale standard deviation of the reference
+ * @param[in] ess_fraction fraction of the population the effective
+ *   sample size may drop to at each step, in (0, 1)
+ * @param[in] num_moves number of HMC transitions per particle and step
+ * @param[in] stepsize initial step size of the moves
+ * @param[in] int_time integration time of the moves
+ * @param[in] delta target acceptance statistic of the moves
+ * @param[in] refresh controls output to the <code>logger</code>, every
+ *   <code>refresh</code> tempering steps
+ * @param[in,out] interrupt interrupt callback
+ * @param[in,out] logger logger for messages
+ * @param[in,out] sample_writer writer for the final particles
+ * @param[in,out] diagnostic_writer writer for diagnostic information
+ */
+template <class Sampler, class Model, class RNG>
+void run_smc_sampler(std::vector<Sampler>& samplers, Model& model,
+                     std::vector<RNG>& rngs, RNG& rng, double reference_scale,
+                     double ess_fraction, int num_moves, double stepsize,
+                     double int_time, double delta, int refresh,
+                     callbacks::interrupt& interrupt,
+                     callbacks::logger& logger,
+                     callbacks::writer& sample_writer,
+                     callbacks::writer& diagnostic_writer) {
+  const size_t num_particles = samplers.size();
+  const Eigen::Index num_params = model.num_params_r();
+  const double log_reference_norm
+      = -num_params * (std::log(reference_scale) + 0.5 * math::LOG_TWO_PI);
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Log density ratio of the posterior to the reference, with constants
+  auto log_ratio = [&](Eigen::VectorXd& q) {
+    std::stringstream msg;
+    double lp;
+    try {
+      lp = model.template log_prob<false, true>(q, &msg);
+    } catch (const std::exception& e) {
+      return -std::numeric_limits<double>::infinity();
+    }
+    double lr = log_reference_norm
+                - 0.5 * q.squaredNorm() / (reference_scale * reference_scale);
+    return std::isfinite(lp) ? lp - lr
+                             : -std::numeric_limits<double>::infinity();
+  };
+
+  Eigen::MatrixXd particles(num_params, num_particles);
+  Eigen::VectorXd log_ratios(num_particles);
+  callbacks::logger silent_logger;
+  internal::for_each_chain(num_particles, [&](size_t i) {
+    boost::random::normal_distribution<> normal(0, reference_scale);
+    Eigen::VectorXd q(num_params);
+    for (Eigen::Index d = 0; d < num_params; ++d)
+      q(d) = normal(rngs[i]);
+    particles.col(i) = q;
+    log_ratios(i) = log_ratio(q);
+    samplers[i].set_reference_scale(reference_scale);
+    samplers[i].set_stepsize_jitter(0);
+  });
+
+  std::vector<stan::mcmc::sample> samples(
+      num_particles, stan::mcmc::sample(Eigen::VectorXd(num_params), 0, 0));
+  Eigen::VectorXd accept_stats(num_particles);
+  Eigen::VectorXd inv_metric = Eigen::VectorXd::Constant(
+      num_params, reference_scale * reference_scale);
+  boost::uniform_01<RNG&> rand_uniform(rng);
+  double beta = 0;
+  double log_z = 0;
+  int num_steps = 0;
+  while (beta < 1) {
+    interrupt();
+    double next_beta
+        = smc_next_inverse_temperature(log_ratios, beta, ess_fraction);
+    Eigen::VectorXd log_weights = (next_beta - beta) * log_ratios;
+    log_z += smc_log_mean_exp(log_weights);
+    if (!std::isfinite(log_z)) {
+      logger.error(
+          "Sequential Monte Carlo failed: no particle has a finite log "
+          "density.");
+      return;
+    }
+    std::vector<size_t> indices
+        = smc_systematic_resample(log_weights, rand_uniform());
+    Eigen::MatrixXd resampled(num_params, num_particles);
+    Eigen::VectorXd resampled_ratios(num_particles);
+    for (size_t i = 0; i < num_particles; ++i) {
+      resampled.col(i) = particles.col(indices[i]);
+      resampled_ratios(i) = log_ratios(indices[i]);
+    }
+    particles.swap(resampled);
+    log_ratios.swap(resampled_ratios);
+    beta = next_beta;
+    ++num_steps;
+
+    if (num_particles > 1) {
+      Eigen::VectorXd mean = particles.rowwise().mean();
+      Eigen::ArrayXd sum_sq
+          = (particles.colwise() - mean).array().square().rowwise().sum();
+      inv_metric = (sum_sq / (num_particles - 1.0)).matrix().cwiseMax(1e-8);
+    }
+
+    internal::for_each_chain(num_particles, [&](size_t i) {
+      samplers[i].set_inverse_temperature(beta);
+      samplers[i].set_metric(inv_metric);
+      samplers[i].set_nominal_stepsize_and_T(stepsize, int_time);
+      samples[i] = stan::mcmc::sample(Eigen::VectorXd(particles.col(i)), 0, 0);
+      accept_stats(i) = 0;
+      for (int m = 0; m < num_moves; ++m) {
+        samples[i] = samplers[i].transition(samples[i], silent_logger);
+        accept_stats(i) += samples[i].accept_stat();
+      }
+      particles.col(i) = samples[i].cont_params();
+      Eigen::VectorXd q = particles.col(i);
+      log_ratios(i) = log_ratio(q);
+    });
+
+    double accept_stat = num_moves > 0
+                             ? accept_stats.sum() / (num_particles * num_moves)
+                             : delta;
+    if (std::isfinite(accept_stat))
+      stepsize *= std::exp(accept_stat - delta);
+
+    if (refresh > 0 && (num_steps % refresh == 0 || beta == 1)) {
+      std::stringstream message;
+      message << "Tempering step " << num_steps << ": inverse temperature = "
+              << beta << ", acceptance = " << accept_stat;
+      logger.info(message);
+    }
+  }
+
+  services::util::mcmc_writer writer(sample_writer, diagnostic_writer,
+                                     logger);
+  writer.write_sample_names(samples[0], samplers[0], model);
+  writer.write_diagnostic_names(samples[0], samplers[0], model);
+  for (size_t i = 0; i < num_particles; ++i) {
+    writer.write_sample_params(rng, samples[i], samplers[i], model);
+    writer.write_diagnostic_params(samples[i], samplers[i]);
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double delta_t
+      = std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+            .count()
+        / 1000.0;
+  std::stringstream message;
+  message << "Log marginal likelihood estimate = " << log_z << " ("
+          << num_steps << " tempering steps)";
+  sample_writer(message.str());
+  logger.info(message);
+  writer.write_timing(0, delta_t);
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,127 @@
+#ifndef STAN_SERVICES_UTIL_SMC_TEMPERING_HPP
+#define STAN_SERVICES_UTIL_SMC_TEMPERING_HPP
+
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Return the effective sample size of a population with the specified
+ * unnormalized log weights, (sum w)^2 / sum w^2. Weights that are not
+ * finite count as zero.
+ *
+ * @param log_weights unnormalized log weights
+ * @return effective sample size, 0 if every weight is zero
+ */
+inline double smc_ess(const Eigen::VectorXd& log_weights) {
+  double max = -std::numeric_limits<double>::infinity();
+  for (Eigen::Index i = 0; i < log_weights.size(); ++i)
+    if (std::isfinite(log_weights(i)) && log_weights(i) > max)
+      max = log_weights(i);
+  if (!std::isfinite(max))
+    return 0;
+  double sum = 0;
+  double sum_sq = 0;
+  for (Eigen::Index i = 0; i < log_weights.size(); ++i) {
+    if (!std::isfinite(log_weights(i)))
+      continue;
+    double w = std::exp(log_weights(i) - max);
+    sum += w;
+    sum_sq += w * w;
+  }
+  return sum * sum / sum_sq;
+}
+
+/**
+ * Return the log of the mean of the exponentiated log weights, the
+ * log of the incremental normalizing constant of a tempering step.
+ * Weights that are not finite count as zero.
+ *
+ * @param log_weights unnormalized log weights
+ * @return log mean weight, negative infinity if every weight is zero
+ */
+inline double smc_log_mean_exp(const Eigen::VectorXd& log_weights) {
+  double max = -std::numeric_limits<double>::infinity();
+  for (Eigen::Index i = 0; i < log_weights.size(); ++i)
+    if (std::isfinite(log_weights(i)) && log_weights(i) > max)
+      max = log_weights(i);
+  if (!std::isfinite(max))
+    return max;
+  double sum = 0;
+  for (Eigen::Index i = 0; i < log_weights.size(); ++i)
+    if (std::isfinite(log_weights(i)))
+      sum += std::exp(log_weights(i) - max);
+  return max + std::log(sum / log_weights.size());
+}
+
+/**
+ * Return the next inverse temperature of adaptive tempering: the largest
+ * one up to 1 at which the incremental weights of the particles keep an
+ * effective sample size of at least the specified fraction of the
+ * population, found by bisection.
+ *
+ * @param log_ratios log of the ratio of the target density to the
+ *   reference density at each particle
+ * @param beta current inverse temperature
+ * @param ess_fraction fraction of the population the effective sample
+ *   size may drop to, in (0, 1)
+ * @return next inverse temperature, greater than <code>beta</code>
+ */
+inline double smc_next_inverse_temperature(const Eigen::VectorXd& log_ratios,
+                                           double beta, double ess_fraction) {
+  const double target = ess_fraction * log_ratios.size();
+  if (smc_ess((1 - beta) * log_ratios) >= target)
+    return 1;
+  double lower = beta;
+  double upper = 1;
+  for (int n = 0; n < 60; ++n) {
+    double mid = 0.5 * (lower + upper);
+    if (smc_ess((mid - beta) * log_ratios) >= target)
+      lower = mid;
+    else
+      upper = mid;
+  }
+  // Always make progress, even if a single particle dominates
+  return lower > beta ? lower : upper;
+}
+
+/**
+ * Systematic resampling: return the indices of the particles to keep,
+ * with as many indices as particles, drawn with a single uniform.
+ *
+ * @param log_weights unnormalized log weights, not all zero weight
+ * @param u uniform draw in [0, 1)
+ * @return indices of the resampled particles, in increasing order
+ */
+inline std::vector<size_t> smc_systematic_resample(
+    const Eigen::VectorXd& log_weights, double u) {
+  const Eigen::Index n = log_weights.size();
+  double log_total = smc_log_mean_exp(log_weights);
+  std::vector<size_t> indices(n);
+  double cumulative = 0;
+  Eigen::Index j = 0;
+  for (Eigen::Index i = 0; i < n; ++i) {
+    double position = u + i;
+    while (j < n - 1) {
+      double w = std::isfinite(log_weights(j))
+                     ? std::exp(log_weights(j) - log_total)
+                     : 0;
+      if (cumulative + w > position)
+        break;
+      cumulative += w;
+      ++j;
+    }
+    indices[i] = j;
+  }
+  return indices;
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
@@ -0,0 +1,103 @@
+#ifndef STAN_SERVICES_UTIL_STARTUP_TIMER_HPP
+#define STAN_SERVICES_UTIL_STARTUP_TIMER_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Times the phases of starting a run up to the end of its first
+ * transition, so that a slow start, such as a large transformed data
+ * block or many initialization retries, shows up as a phase instead of
+ * as a slow run.
+ *
+ * The clock starts when the timer is constructed and each phase is
+ * timed from the end of the previous one. Interfaces construct the
+ * timer before reading the data and record the phases
+ * <code>data</code> and <code>model</code> as they construct the
+ * var_context and the model. The services then record
+ * <code>initialize</code>, including its retries,
+ * <code>sampler_setup</code>, <code>init_stepsize</code> and
+ * <code>first_transition</code>, after which the phases are written as
+ * a table of <code>phase,seconds</code> rows and their total.
+ */
+class startup_timer {
+ public:
+  struct phase {
+    std::string name;
+    double seconds;
+  };
+
+  /**
+   * @param writer writer the table is written to
+   */
+  explicit startup_timer(callbacks::writer& writer)
+      : writer_(writer), last_(clock::now()), written_(false) {}
+
+  /**
+   * Record a phase ending now.
+   *
+   * @param name name of the phase
+   */
+  void record(const std::string& name) {
+    clock::time_point now = clock::now();
+    phases_.push_back(
+        phase{name, std::chrono::duration<double>(now - last_).count()});
+    last_ = now;
+  }
+
+  const std::vector<phase>& phases() const { return phases_; }
+
+  /**
+   * Return the seconds of all the phases.
+   */
+  double total_seconds() const {
+    double total = 0;
+    for (const phase& p : phases_)
+      total += p.seconds;
+    return total;
+  }
+
+  /**
+   * Return true once the table has been written.
+   */
+  bool written() const { return written_; }
+
+  /**
+   * Write a header, one row per phase in the order they were recorded
+   * and a row with their total.
+   */
+  void write() {
+    writer_(std::vector<std::string>{"phase", "seconds"});
+    for (const phase& p : phases_)
+      writer_(std::vector<std::string>{p.name, format(p.seconds)});
+    writer_(std::vector<std::string>{"total", format(total_seconds())});
+    written_ = true;
+  }
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  callbacks::writer& writer_;
+  clock::time_point last_;
+  std::vector<phase> phases_;
+  bool written_;
+
+  static std::string format(double seconds) {
+    std::stringstream ss;
+    ss << seconds;
+    return ss.str();
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
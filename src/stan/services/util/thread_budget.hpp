@@ -0,0 +1,136 @@
+#ifndef STAN_SERVICES_UTIL_THREAD_BUDGET_HPP
+#define STAN_SERVICES_UTIL_THREAD_BUDGET_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/services/util/chain_placement.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Divides the threads of a run between the chains and the parallelism
+ * within each chain, such as the <code>reduce_sum</code> calls of a
+ * model, so that chains which each spawn parallel work don't
+ * oversubscribe the machine.
+ *
+ * All threads come from the one TBB pool, whose size the budget caps
+ * for its lifetime; if a smaller cap is already in force, such as the
+ * one set from <code>STAN_NUM_THREADS</code>, that one wins. At most
+ * <code>concurrent_chains()</code> chains run at once, each as the
+ * master of its own task arena, and the parallel work of a chain runs
+ * in that arena. TBB shares the spare threads among the arenas that
+ * have work for them, so the threads split evenly between the running
+ * chains, and when a chain finishes early its share moves to the chains
+ * still running instead of sitting idle.
+ */
+class thread_budget {
+ public:
+  /**
+   * @param num_threads number of threads of the run
+   * @param num_chains number of chains of the run
+   * @param min_chain_threads number of threads each running chain is
+   *   guaranteed a share of, which limits the number of chains run at
+   *   once to <code>num_threads / min_chain_threads</code>
+   * @throws std::invalid_argument if a number is not positive
+   */
+  thread_budget(int num_threads, size_t num_chains, int min_chain_threads = 1)
+      : num_threads_(num_threads),
+        num_chains_(num_chains),
+        control_(tbb::global_control::max_allowed_parallelism,
+                 std::max(num_threads, 1)) {
+    if (num_threads < 1 || num_chains < 1 || min_chain_threads < 1)
+      throw std::invalid_argument(
+          "thread_budget: the numbers of threads and chains must be "
+          "positive");
+    concurrent_chains_ = std::min<size_t>(
+        num_chains, std::max(1, num_threads / min_chain_threads));
+  }
+
+  int num_threads() const { return num_threads_; }
+
+  size_t num_chains() const { return num_chains_; }
+
+  /**
+   * Return the number of chains run at once.
+   */
+  size_t concurrent_chains() const { return concurrent_chains_; }
+
+  /**
+   * Return the number of threads a chain's arena may use, its own and
+   * every thread left over by the other running chains.
+   */
+  int max_chain_threads() const {
+    return std::max<int>(1, num_threads_ - concurrent_chains_ + 1);
+  }
+
+  /**
+   * Return the number of threads of each chain while all the concurrent
+   * chains are running.
+   */
+  int chain_threads() const {
+    return std::max<int>(1, num_threads_ / concurrent_chains_);
+  }
+
+  /**
+   * Runs <code>f(i)</code> for every chain <code>i</code>, each chain as
+   * one task of an arena of <code>concurrent_chains()</code> threads
+   * and inside its own arena of up to <code>max_chain_threads()</code>
+   * threads, with the thread pinned to the chain's CPUs if a placement
+   * is given.
+   *
+   * @param f runs one chain
+   * @param placement placement of the chains' threads, or a null pointer
+   */
+  template <typename F>
+  void for_each_chain(const F& f,
+                      const chain_placement* placement = nullptr) const {
+    tbb::task_arena chains(concurrent_chains_);
+    int max_chain_threads = this->max_chain_threads();
+    chains.execute([&]() {
+      tbb::parallel_for(
+          tbb::blocked_range<size_t>(0, num_chains_, 1),
+          [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t i = r.begin(); i != r.end(); ++i) {
+              chain_placement::scope pin(placement, i);
+              tbb::task_arena chain(max_chain_threads, 1);
+              chain.execute([&]() { f(i); });
+            }
+          },
+          tbb::simple_partitioner());
+    });
+  }
+
+  /**
+   * Write the division of the threads to the logger.
+   *
+   * @param[in,out] logger logger for messages
+   */
+  void log(callbacks::logger& logger) const {
+    std::stringstream msg;
+    msg << "Thread budget: " << num_threads_ << " threads, "
+        << concurrent_chains_ << " of " << num_chains_
+        << " chains at once with " << chain_threads()
+        << " threads each, up to " << max_chain_threads()
+        << " as other chains finish";
+    logger.info(msg);
+  }
+
+ private:
+  int num_threads_;
+  size_t num_chains_;
+  size_t concurrent_chains_;
+  tbb::global_control control_;
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+#endif
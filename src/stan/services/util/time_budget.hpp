@@ -0,0 +1,104 @@
+#ifndef STAN_SERVICES_UTIL_TIME_BUDGET_HPP
+#define STAN_SERVICES_UTIL_TIME_BUDGET_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * A wall clock budget for a chain, so that a run under a hard time
+ * limit stops cleanly instead of being killed with its output half
+ * written.
+ *
+ * The clock starts when the budget is constructed. Once the budget is
+ * used up, <code>generate_transitions()</code> stops before the next
+ * transition, as it does when an ESS target is reached. A warmup cut
+ * short ends adaptation with the estimates so far, and the draws made
+ * before the budget ran out are kept, followed by the adaptation info
+ * and the timing as usual.
+ */
+class time_budget {
+ public:
+  /**
+   * @param seconds wall clock seconds the chain may take
+   * @throws std::invalid_argument if the seconds are not positive
+   */
+  explicit time_budget(double seconds)
+      : seconds_(seconds), start_(std::chrono::steady_clock::now()) {
+    if (!(seconds > 0))
+      throw std::invalid_argument("Time budget must be positive");
+  }
+
+  double seconds() const { return seconds_; }
+
+  /**
+   * Return the seconds since the budget was constructed.
+   */
+  double elapsed_seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                         - start_)
+        .count();
+  }
+
+  /**
+   * Return the seconds left, which is zero once the budget is used up.
+   */
+  double remaining_seconds() const {
+    return std::max(0.0, seconds_ - elapsed_seconds());
+  }
+
+  bool expired() const { return elapsed_seconds() >= seconds_; }
+
+  /**
+   * Return how many iterations fit in the remaining time at the given
+   * rate, capped at the iterations wanted.
+   *
+   * @param seconds_per_iteration measured seconds per iteration
+   * @param num_iterations iterations wanted
+   * @return iterations expected to finish within the budget
+   */
+  int planned_iterations(double seconds_per_iteration,
+                         int num_iterations) const {
+    if (!(seconds_per_iteration > 0))
+      return num_iterations;
+    double fit = std::floor(remaining_seconds() / seconds_per_iteration);
+    return static_cast<int>(std::min<double>(fit, num_iterations));
+  }
+
+  /**
+   * Log how many of the iterations fit in the remaining time at the
+   * given rate, if not all of them do.
+   *
+   * @param seconds_per_iteration measured seconds per iteration
+   * @param num_iterations iterations wanted
+   * @param logger logger
+   */
+  void log_plan(double seconds_per_iteration, int num_iterations,
+                callbacks::logger& logger) const {
+    int planned = planned_iterations(seconds_per_iteration, num_iterations);
+    if (planned >= num_iterations)
+      return;
+    std::stringstream msg;
+    msg << "Time budget: about " << planned << " of the " << num_iterations
+        << " sampling iterations fit in the remaining "
+        << remaining_seconds() << " seconds";
+    logger.info(msg);
+  }
+
+ private:
+  double seconds_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef STAN_SERVICES_UTIL_WARM_START_HPP
+#define STAN_SERVICES_UTIL_WARM_START_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Extract the constrained parameter values of the last draw of a
+ * previous run, in the order of the model's constrained parameter
+ * names. The columns are looked up by name, so the output may hold
+ * other columns such as the sampler diagnostics and generated
+ * quantities.
+ *
+ * @tparam Model type of model
+ * @param[in] model model
+ * @param[in] previous output of the previous run
+ * @param[in,out] logger Logger for messages
+ * @throws std::domain_error if the previous run has no draws or a
+ *   parameter is missing from its output
+ * @return constrained parameter values of the last draw
+ */
+template <class Model>
+std::vector<double> read_last_draw(const Model& model,
+                                   const stan::io::stan_csv& previous,
+                                   callbacks::logger& logger) {
+  std::vector<std::string> param_names;
+  model.constrained_param_names(param_names, false, false);
+  if (previous.samples.rows() == 0) {
+    logger.error("Previous run has no draws to start from.");
+    throw std::domain_error("Initialization failure");
+  }
+  Eigen::Index last = previous.samples.rows() - 1;
+  std::vector<double> draw;
+  draw.reserve(param_names.size());
+  for (const std::string& name : param_names) {
+    size_t col = 0;
+    while (col < previous.header.size() && previous.header[col] != name)
+      ++col;
+    if (col == previous.header.size()
+        || static_cast<Eigen::Index>(col) >= previous.samples.cols()) {
+      logger.error("Parameter " + name
+                   + " not found in the output of the previous run.");
+      throw std::domain_error("Initialization failure");
+    }
+    draw.push_back(previous.samples(last, col));
+  }
+  return draw;
+}
+
+/**
+ * Extract the adapted diagonal inverse Euclidean metric of a previous
+ * run, which is printed as a single row.
+ *
+ * @param[in] adaptation adaptation of the previous run
+ * @param[in] num_params expected number of diagonal elements
+ * @param[in,out] logger Logger for messages
+ * @throws std::domain_error if the metric has the wrong size
+ * @return inv_metric vector of diagonal values
+ */
+inline Eigen::VectorXd read_adapted_diag_inv_metric(
+    const stan::io::stan_csv_adaptation& adaptation, size_t num_params,
+    callbacks::logger& logger) {
+  if (adaptation.metric.rows() != 1
+      || adaptation.metric.cols() != static_cast<Eigen::Index>(num_params)) {
+    std::stringstream msg;
+    msg << "Adapted inverse Euclidean metric has size "
+        << adaptation.metric.rows() << " x " << adaptation.metric.cols()
+        << ", expecting a diagonal of " << num_params << " elements.";
+    logger.error(msg);
+    throw std::domain_error("Initialization failure");
+  }
+  return adaptation.metric.row(0).transpose();
+}
+
+/**
+ * Extract the adapted dense inverse Euclidean metric of a previous run.
+ *
+ * @param[in] adaptation adaptation of the previous run
+ * @param[in] num_params expected number of rows and columns
+ * @param[in,out] logger Logger for messages
+ * @throws std::domain_error if the metric has the wrong size
+ * @return inv_metric dense inverse metric
+ */
+inline Eigen::MatrixXd read_adapted_dense_inv_metric(
+    const stan::io::stan_csv_adaptation& adaptation, size_t num_params,
+    callbacks::logger& logger) {
+  if (adaptation.metric.rows() != static_cast<Eigen::Index>(num_params)
+      || adaptation.metric.cols() != static_cast<Eigen::Index>(num_params)) {
+    std::stringstream msg;
+    msg << "Adapted inverse Euclidean metric has size "
+        << adaptation.metric.rows() << " x " << adaptation.metric.cols()
+        << ", expecting " << num_params << " x " << num_params << ".";
+    logger.error(msg);
+    throw std::domain_error("Initialization failure");
+  }
+  return adaptation.metric;
+}
+
+/**
+ * Validate the adapted step size of a previous run.
+ *
+ * @param[in] adaptation adaptation of the previous run
+ * @param[in,out] logger Logger for messages
+ * @throws std::domain_error if the step size isn't positive and finite
+ * @return step size
+ */
+inline double read_adapted_stepsize(
+    const stan::io::stan_csv_adaptation& adaptation,
+    callbacks::logger& logger) {
+  if (!(adaptation.step_size > 0)
+      || adaptation.step_size == std::numeric_limits<double>::infinity()) {
+    logger.error("Adapted step size must be positive and finite.");
+    throw std::domain_error("Initialization failure");
+  }
+  return adaptation.step_size;
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
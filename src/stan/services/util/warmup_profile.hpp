@@ -0,0 +1,121 @@
+#ifndef STAN_SERVICES_UTIL_WARMUP_PROFILE_HPP
+#define STAN_SERVICES_UTIL_WARMUP_PROFILE_HPP
+
+#include <stan/callbacks/writer.hpp>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Collects the time and the gradient evaluations spent in each phase
+ * of warmup, such as the initial buffer, each slow adaptation window
+ * and the terminal buffer, and writes them as a table to a dedicated
+ * writer once warmup is over.
+ *
+ * Each phase also reports how much of its time went into step size
+ * searches and into computing the metric estimates at the close of
+ * the adaptation windows. The step size search before the first
+ * warmup iteration is reported as its own phase,
+ * <code>initial_stepsize</code>.
+ */
+class warmup_profile {
+ public:
+  struct phase {
+    std::string name;
+    int iterations;
+    double seconds;
+    size_t grad_evals;
+    double stepsize_seconds;
+    double metric_seconds;
+  };
+
+  /**
+   * @param writer writer the table is written to
+   */
+  explicit warmup_profile(callbacks::writer& writer) : writer_(writer) {}
+
+  /**
+   * Start timing an iteration of a warmup phase. Consecutive iterations
+   * of the same phase are added up.
+   *
+   * @tparam Sampler type of adaptive HMC sampler
+   * @param sampler sampler
+   * @param name name of the phase
+   */
+  template <class Sampler>
+  void begin(Sampler& sampler, const std::string& name) {
+    if (phases_.empty() || phases_.back().name != name)
+      phases_.push_back(phase{name, 0, 0, 0, 0, 0});
+    start_ = std::chrono::steady_clock::now();
+    start_grad_evals_ = sampler.get_num_grad_evals();
+    start_stepsize_seconds_ = sampler.get_init_stepsize_seconds();
+    start_metric_seconds_ = sampler.adaptation_estimate_seconds();
+  }
+
+  /**
+   * Stop timing the iteration started by <code>begin()</code>.
+   *
+   * @tparam Sampler type of adaptive HMC sampler
+   * @param sampler sampler
+   */
+  template <class Sampler>
+  void end(Sampler& sampler) {
+    phase& current = phases_.back();
+    ++current.iterations;
+    current.seconds += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count();
+    current.grad_evals += sampler.get_num_grad_evals() - start_grad_evals_;
+    current.stepsize_seconds
+        += sampler.get_init_stepsize_seconds() - start_stepsize_seconds_;
+    current.metric_seconds
+        += sampler.adaptation_estimate_seconds() - start_metric_seconds_;
+  }
+
+  const std::vector<phase>& phases() const { return phases_; }
+
+  /**
+   * Write a header and one row per phase, in the order the phases ran.
+   */
+  void write() const {
+    writer_(std::vector<std::string>{"phase", "iterations", "seconds",
+                                     "n_grad", "stepsize_seconds",
+                                     "metric_seconds"});
+    for (const phase& p : phases_) {
+      std::vector<std::string> row;
+      row.push_back(p.name);
+      row.push_back(std::to_string(p.iterations));
+      row.push_back(format(p.seconds));
+      row.push_back(std::to_string(p.grad_evals));
+      row.push_back(format(p.stepsize_seconds));
+      row.push_back(format(p.metric_seconds));
+      writer_(row);
+    }
+  }
+
+ private:
+  callbacks::writer& writer_;
+  std::vector<phase> phases_;
+  std::chrono::steady_clock::time_point start_;
+  size_t start_grad_evals_;
+  double start_stepsize_seconds_;
+  double start_metric_seconds_;
+
+  static std::string format(double seconds) {
+    std::stringstream ss;
+    ss << std::setprecision(6) << seconds;
+    return ss.str();
+  }
+};
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
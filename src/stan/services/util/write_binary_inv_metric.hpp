@@ -0,0 +1,56 @@
+#ifndef STAN_SERVICES_UTIL_WRITE_BINARY_INV_METRIC_HPP
+#define STAN_SERVICES_UTIL_WRITE_BINARY_INV_METRIC_HPP
+
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/binary_var_context.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace stan {
+namespace services {
+namespace util {
+
+/**
+ * Write a dense inverse Euclidean metric, such as an adapted one, as
+ * the variable <code>inv_metric</code> of a binary data file, which
+ * <code>stan::io::binary_var_context</code> reads back for
+ * <code>read_dense_inv_metric()</code> without parsing text.
+ *
+ * @param[in, out] out stream to write to, opened in binary mode
+ * @param[in] inv_metric inverse metric
+ */
+inline void write_binary_inv_metric(std::ostream& out,
+                                    const Eigen::MatrixXd& inv_metric) {
+  std::vector<std::vector<size_t>> dims{
+      {static_cast<size_t>(inv_metric.rows()),
+       static_cast<size_t>(inv_metric.cols())}};
+  stan::io::array_var_context context(
+      std::vector<std::string>{"inv_metric"},
+      Eigen::Map<const Eigen::VectorXd>(inv_metric.data(), inv_metric.size()),
+      dims);
+  stan::io::binary_var_context::write(out, context);
+}
+
+/**
+ * Write a diagonal inverse Euclidean metric as the variable
+ * <code>inv_metric</code> of a binary data file.
+ *
+ * @param[in, out] out stream to write to, opened in binary mode
+ * @param[in] inv_metric diagonal of the inverse metric
+ */
+inline void write_binary_inv_metric(std::ostream& out,
+                                    const Eigen::VectorXd& inv_metric) {
+  std::vector<std::vector<size_t>> dims{
+      {static_cast<size_t>(inv_metric.size())}};
+  stan::io::array_var_context context(std::vector<std::string>{"inv_metric"},
+                                      inv_metric, dims);
+  stan::io::binary_var_context::write(out, context);
+}
+
+}  // namespace util
+}  // namespace services
+}  // namespace stan
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef STAN_UTIL_DETERMINISTIC_REDUCE_HPP
+#define STAN_UTIL_DETERMINISTIC_REDUCE_HPP
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace stan {
+namespace util {
+
+/**
+ * Number of values summed serially by one task of
+ * <code>deterministic_sum()</code>.
+ */
+constexpr size_t deterministic_sum_chunk_size = 256;
+
+/**
+ * Reduces the indices <code>0, ..., n - 1</code> in parallel on the TBB
+ * thread pool, with a result that is the same bit for bit whatever the
+ * number of threads and the order the tasks run in.
+ *
+ * The indices are split into consecutive chunks of
+ * <code>chunk_size</code> indices, the last one possibly shorter. Each
+ * chunk is mapped to a partial result by a single call, and the partial
+ * results are combined by a pairwise tree whose shape only depends on
+ * the number of chunks: at every level the neighbours
+ * <code>2 i</code> and <code>2 i + 1</code> are combined, left operand
+ * first, and an odd one out is carried up unchanged. Scheduling only
+ * decides which thread computes a node, never which nodes are
+ * computed. Floating point sums are pairwise sums, whose rounding
+ * error grows with the logarithm of the number of chunks.
+ *
+ * The result depends on the chunk size, so it must be fixed by the
+ * caller rather than derived from the number of threads.
+ *
+ * @tparam T type of the result
+ * @tparam Map type of the mapping, callable as
+ *   <code>T map(size_t begin, size_t end)</code> for the chunk of
+ *   indices <code>[begin, end)</code>
+ * @tparam Combine type of the combination, callable as
+ *   <code>T combine(const T& left, const T& right)</code>
+ * @param n number of indices
+ * @param chunk_size number of indices of a chunk
+ * @param identity result of no indices
+ * @param map mapping of a chunk to its partial result, which may be
+ *   called concurrently for different chunks
+ * @param combine associative combination of two partial results, which
+ *   may be called concurrently for different pairs
+ * @return reduction of the indices
+ * @throws std::invalid_argument if the chunk size is zero
+ */
+template <typename T, typename Map, typename Combine>
+T deterministic_reduce(size_t n, size_t chunk_size, const T& identity,
+                       const Map& map, const Combine& combine) {
+  if (chunk_size == 0)
+    throw std::invalid_argument("deterministic_reduce: chunk size is zero");
+  if (n == 0)
+    return identity;
+  size_t num_chunks = (n - 1) / chunk_size + 1;
+  std::vector<T> level(num_chunks);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, num_chunks, 1),
+                    [&](const tbb::blocked_range<size_t>& r) {
+                      for (size_t k = r.begin(); k != r.end(); ++k)
+                        level[k] = map(k * chunk_size,
+                                       std::min(n, (k + 1) * chunk_size));
+                    });
+  std::vector<T> next;
+  while (level.size() > 1) {
+    size_t num_pairs = level.size() / 2;
+    next.resize((level.size() + 1) / 2);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_pairs, 1),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i != r.end(); ++i)
+                          next[i] = combine(level[2 * i], level[2 * i + 1]);
+                      });
+    if (level.size() % 2 == 1)
+      next.back() = std::move(level.back());
+    level.swap(next);
+  }
+  return std::move(level[0]);
+}
+
+/**
+ * Returns the sum of values, computed as
+ * <code>deterministic_reduce()</code> does, so that it is the same bit
+ * for bit whatever the number of threads.
+ *
+ * @param x values
+ * @param n number of values
+ * @param chunk_size number of values summed serially by one task
+ * @return sum of the values
+ */
+inline double deterministic_sum(
+    const double* x, size_t n,
+    size_t chunk_size = deterministic_sum_chunk_size) {
+  return deterministic_reduce(
+      n, chunk_size, 0.0,
+      [x](size_t begin, size_t end) {
+        double sum = 0;
+        for (size_t i = begin; i < end; ++i)
+          sum += x[i];
+        return sum;
+      },
+      [](double left, double right) { return left + right; });
+}
+
+/**
+ * Returns the sum of values, as <code>deterministic_sum(x, n)</code>
+ * does.
+ *
+ * @param x values
+ * @param chunk_size number of values summed serially by one task
+ * @return sum of the values
+ */
+inline double deterministic_sum(
+    const std::vector<double>& x,
+    size_t chunk_size = deterministic_sum_chunk_size) {
+  return deterministic_sum(x.data(), x.size(), chunk_size);
+}
+
+}  // namespace util
+}  // namespace stan
+
+#endif
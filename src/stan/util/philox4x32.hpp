@@ -0,0 +1,158 @@
+#ifndef STAN_UTIL_PHILOX4X32_HPP
+#define STAN_UTIL_PHILOX4X32_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace stan {
+namespace util {
+
+/**
+ * Counter-based pseudo random number generator Philox4x32-10 of
+ * Salmon et al. (2011), "Parallel random numbers: as easy as 1, 2, 3",
+ * SC '11, https://doi.org/10.1145/2063384.2063405.
+ *
+ * Each block of four outputs is the encryption of a 128-bit counter
+ * under a 64-bit key, so any position of any stream is reached in
+ * constant time. The key is the seed and the chain id, and the counter
+ * is the stream, given by a purpose and an index, followed by the
+ * 64-bit number of the block in the stream. Independent substreams per
+ * thread, draw or Monte Carlo sample are derived with
+ * <code>substream()</code> instead of by discarding past the draws of
+ * the others, and each stream holds 2^66 outputs.
+ *
+ * The engine models a Boost uniform random number generator of 32-bit
+ * words, and it is written and read by the stream operators as its
+ * seed, chain, purpose, index and position.
+ */
+class philox4x32 {
+ public:
+  using result_type = std::uint32_t;
+
+  /**
+   * @param seed random seed
+   * @param chain chain id
+   * @param purpose what the stream is used for
+   * @param index index of the stream among those of the purpose
+   */
+  explicit philox4x32(std::uint32_t seed = 0, std::uint32_t chain = 0,
+                      std::uint32_t purpose = 0, std::uint32_t index = 0)
+      : key_{seed, chain}, stream_{purpose, index}, position_(0) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xFFFFFFFF; }
+
+  /**
+   * Restart the generator at the start of stream 0 of a seed and chain
+   * 0.
+   */
+  void seed(std::uint32_t seed = 0) { *this = philox4x32(seed); }
+
+  result_type operator()() {
+    std::uint64_t block = position_ >> 2;
+    if (!cached_ || block != cached_block_) {
+      std::uint32_t counter[4]
+          = {static_cast<std::uint32_t>(block),
+             static_cast<std::uint32_t>(block >> 32), stream_[0], stream_[1]};
+      encrypt(counter, key_, block_);
+      cached_block_ = block;
+      cached_ = true;
+    }
+    return block_[position_++ & 3];
+  }
+
+  /**
+   * Advance the generator by <code>n</code> outputs in constant time.
+   */
+  void discard(std::uint64_t n) { position_ += n; }
+
+  /**
+   * Return the generator of another stream of the same seed and chain,
+   * at its start.
+   *
+   * @param purpose what the stream is used for
+   * @param index index of the stream among those of the purpose
+   */
+  philox4x32 substream(std::uint32_t purpose, std::uint32_t index) const {
+    return philox4x32(key_[0], key_[1], purpose, index);
+  }
+
+  std::uint32_t purpose() const { return stream_[0]; }
+  std::uint32_t index() const { return stream_[1]; }
+
+  /**
+   * Return the number of outputs generated or discarded so far.
+   */
+  std::uint64_t position() const { return position_; }
+
+  /**
+   * Encrypt a counter under a key with the ten rounds of Philox4x32.
+   *
+   * @param counter counter
+   * @param key key
+   * @param[out] out the four words of the block
+   */
+  static void encrypt(const std::uint32_t (&counter)[4],
+                      const std::uint32_t (&key)[2], std::uint32_t (&out)[4]) {
+    const std::uint64_t M0 = 0xD2511F53;
+    const std::uint64_t M1 = 0xCD9E8D57;
+    std::uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+    std::uint32_t k[2] = {key[0], key[1]};
+    for (int round = 0; round < 10; ++round) {
+      if (round > 0) {
+        k[0] += 0x9E3779B9;
+        k[1] += 0xBB67AE85;
+      }
+      std::uint64_t p0 = M0 * c[0];
+      std::uint64_t p1 = M1 * c[2];
+      std::uint32_t next[4]
+          = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+             static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+             static_cast<std::uint32_t>(p0)};
+      for (int i = 0; i < 4; ++i)
+        c[i] = next[i];
+    }
+    for (int i = 0; i < 4; ++i)
+      out[i] = c[i];
+  }
+
+  friend bool operator==(const philox4x32& a, const philox4x32& b) {
+    return a.key_[0] == b.key_[0] && a.key_[1] == b.key_[1]
+           && a.stream_[0] == b.stream_[0] && a.stream_[1] == b.stream_[1]
+           && a.position_ == b.position_;
+  }
+
+  friend bool operator!=(const philox4x32& a, const philox4x32& b) {
+    return !(a == b);
+  }
+
+  friend std::ostream& operator<<(std::ostream& out, const philox4x32& rng) {
+    return out << rng.key_[0] << ' ' << rng.key_[1] << ' ' << rng.stream_[0]
+               << ' ' << rng.stream_[1] << ' ' << rng.position_;
+  }
+
+  friend std::istream& operator>>(std::istream& in, philox4x32& rng) {
+    std::uint32_t seed, chain, purpose, index;
+    std::uint64_t position;
+    if (in >> seed >> chain >> purpose >> index >> position) {
+      rng = philox4x32(seed, chain, purpose, index);
+      rng.discard(position);
+    }
+    return in;
+  }
+
+ private:
+  std::uint32_t key_[2];
+  std::uint32_t stream_[2];
+  std::uint64_t position_;
+  std::uint32_t block_[4] = {0, 0, 0, 0};
+  std::uint64_t cached_block_ = 0;
+  bool cached_ = false;
+};
+
+}  // namespace util
+}  // namespace stan
+
+#endif
@@ -3,17 +3,27 @@
 
 #include <stan/math.hpp>
 #include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/recording_logger.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/callbacks/stream_writer.hpp>
 #include <stan/io/dump.hpp>
 #include <stan/services/error_codes.hpp>
+#include <stan/util/deterministic_reduce.hpp>
+#include <stan/variational/advi_state.hpp>
+#include <stan/variational/ascent_update.hpp>
 #include <stan/variational/print_progress.hpp>
 #include <stan/variational/families/normal_fullrank.hpp>
+#include <stan/variational/families/normal_lowrank.hpp>
 #include <stan/variational/families/normal_meanfield.hpp>
 #include <boost/circular_buffer.hpp>
 #include <boost/lexical_cast.hpp>
+#ifdef STAN_THREADS
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#endif
 #include <algorithm>
 #include <chrono>
+#include <exception>
 #include <limits>
 #include <numeric>
 #include <ostream>
@@ -49,6 +59,15 @@ class advi {
    * @param[in] n_monte_carlo_elbo number of samples for ELBO computation
    * @param[in] eval_elbo evaluate ELBO at every "eval_elbo" iters
    * @param[in] n_posterior_samples number of samples to draw from posterior
+   * @param[in] common_elbo_draws whether to evaluate the ELBO at the same
+   * antithetic pairs of standard normal draws every time, see
+   * <code>calc_ELBO()</code>
+   * @param[in] stick_the_landing whether to estimate the gradient of the
+   * ELBO with the "sticking the landing" estimator, whose variance
+   * vanishes as the approximation approaches the posterior
+   * @param[in] antithetic_grad_draws whether to draw the gradient
+   * samples in antithetic pairs
+   * @param[in] method update rule of the stochastic gradient ascent
    * @throw std::runtime_error if n_monte_carlo_grad is not positive
    * @throw std::runtime_error if n_monte_carlo_elbo is not positive
    * @throw std::runtime_error if eval_elbo is not positive
@@ -56,14 +75,20 @@ class advi {
    */
   advi(Model& m, Eigen::VectorXd& cont_params, BaseRNG& rng,
        int n_monte_carlo_grad, int n_monte_carlo_elbo, int eval_elbo,
-       int n_posterior_samples)
+       int n_posterior_samples, bool common_elbo_draws = false,
+       bool stick_the_landing = false, bool antithetic_grad_draws = false,
+       ascent_method method = ascent_method::adagrad)
       : model_(m),
         cont_params_(cont_params),
         rng_(rng),
         n_monte_carlo_grad_(n_monte_carlo_grad),
         n_monte_carlo_elbo_(n_monte_carlo_elbo),
         eval_elbo_(eval_elbo),
-        n_posterior_samples_(n_posterior_samples) {
+        n_posterior_samples_(n_posterior_samples),
+        common_elbo_draws_(common_elbo_draws),
+        stick_the_landing_(stick_the_landing),
+        antithetic_grad_draws_(antithetic_grad_draws),
+        method_(method) {
     static const char* function = "stan::variational::advi";
     math::check_positive(function,
                          "Number of Monte Carlo samples for gradients",
@@ -76,11 +101,23 @@ class advi {
                          n_posterior_samples_);
   }
 
+  virtual ~advi() {}
+
   /**
    * Calculates the Evidence Lower BOund (ELBO) by sampling from
    * the variational distribution and then evaluating the log joint,
    * adjusted by the entropy term of the variational distribution.
    *
+   * With common ELBO draws, the standard normal draws transformed by the
+   * variational distribution are made once, as antithetic pairs
+   * <code>eta</code> and <code>-eta</code>, and reused by every
+   * evaluation. The errors of successive estimates are then strongly
+   * correlated and mostly cancel in the relative ELBO changes the
+   * convergence check is based on, and the pairs cancel the error from
+   * the odd terms of the log density around the mean, so far fewer draws
+   * give the same confidence. A draw whose evaluation fails is replaced
+   * by a fresh one for this and later evaluations.
+   *
    * @param[in] variational variational approximation at which to evaluate
    * the ELBO.
    * @param logger logger for messages
@@ -91,39 +128,7 @@ class advi {
    * that the variational distribution has somehow collapsed.
    */
   double calc_ELBO(const Q& variational, callbacks::logger& logger) const {
-    static const char* function = "stan::variational::advi::calc_ELBO";
-
-    double elbo = 0.0;
-    int dim = variational.dimension();
-    Eigen::VectorXd zeta(dim);
-
-    int n_dropped_evaluations = 0;
-    for (int i = 0; i < n_monte_carlo_elbo_;) {
-      variational.sample(rng_, zeta);
-      try {
-        std::stringstream ss;
-        double log_prob = model_.template log_prob<false, true>(zeta, &ss);
-        if (ss.str().length() > 0)
-          logger.info(ss);
-        stan::math::check_finite(function, "log_prob", log_prob);
-        elbo += log_prob;
-        ++i;
-      } catch (const std::domain_error& e) {
-        ++n_dropped_evaluations;
-        if (n_dropped_evaluations >= n_monte_carlo_elbo_) {
-          const char* name = "The number of dropped evaluations";
-          const char* msg1 = "has reached its maximum amount (";
-          const char* msg2
-              = "). Your model may be either severely "
-                "ill-conditioned or misspecified.";
-          stan::math::throw_domain_error(function, name, n_monte_carlo_elbo_,
-                                         msg1, msg2);
-        }
-      }
-    }
-    elbo /= n_monte_carlo_elbo_;
-    elbo += variational.entropy();
-    return elbo;
+    return calc_ELBO(variational, rng_, elbo_eta_, logger);
   }
 
   /**
@@ -146,13 +151,23 @@ class advi {
         function, "Dimension of variational q", variational.dimension(),
         "Dimension of variables in model", cont_params_.size());
 
-    variational.calc_grad(elbo_grad, model_, cont_params_, n_monte_carlo_grad_,
-                          rng_, logger);
+    calc_ELBO_grad(variational, elbo_grad, rng_, logger);
   }
 
   /**
    * Heuristic grid search to adapt eta to the scale of the problem.
    *
+   * Each proposed eta is tried by running stochastic gradient ascent
+   * from the initial variational distribution on a copy of it, with its
+   * own random number generator seeded from this one's, so the
+   * candidates are independent of each other and are run concurrently
+   * on the TBB thread pool when Stan is built with
+   * <code>STAN_THREADS</code>. The candidates are then inspected, and
+   * their messages logged, in the order of the sequence, and the search
+   * stops at the first eta whose ELBO is worse than that of the eta
+   * before it, so the result doesn't depend on the scheduling. Without
+   * threads the candidates after that are not run.
+   *
    * @param[in] variational initial variational distribution.
    * @param[in] adapt_iterations number of iterations to spend doing stochastic
    * gradient ascent at each proposed eta value.
@@ -176,7 +191,6 @@ class advi {
     double eta_sequence[eta_sequence_size] = {100, 10, 1, 0.1, 0.01};
 
     // Initialize ELBO tracking variables
-    double elbo = -std::numeric_limits<double>::max();
     double elbo_best = -std::numeric_limits<double>::max();
     double elbo_init;
     try {
@@ -191,59 +205,44 @@ class advi {
       stan::math::throw_domain_error(function, name, "", msg1);
     }
 
-    // Variational family to store gradients
-    Q elbo_grad = Q(model_.num_params_r());
-
-    // Adaptive step-size sequence
-    Q history_grad_squared = Q(model_.num_params_r());
-    double tau = 1.0;
-    double pre_factor = 0.9;
-    double post_factor = 0.1;
-
-    double eta_best = 0.0;
-    double eta;
-    double eta_scaled;
-
-    bool do_more_tuning = true;
-    int eta_sequence_index = 0;
-    while (do_more_tuning) {
-      // Try next eta
-      eta = eta_sequence[eta_sequence_index];
-
-      int print_progress_m;
-      for (int iter_tune = 1; iter_tune <= adapt_iterations; ++iter_tune) {
-        print_progress_m = eta_sequence_index * adapt_iterations + iter_tune;
-        variational ::print_progress(print_progress_m, 0,
-                                     adapt_iterations * eta_sequence_size,
-                                     adapt_iterations, true, "", "", logger);
-
-        // (ROBUST) Compute gradient of ELBO. It's OK if it diverges.
-        // We'll try a smaller eta.
-        try {
-          calc_ELBO_grad(variational, elbo_grad, logger);
-        } catch (const std::domain_error& e) {
-          elbo_grad.set_to_zero();
-        }
-
-        // Update step-size
-        if (iter_tune == 1) {
-          history_grad_squared += elbo_grad.square();
-        } else {
-          history_grad_squared = pre_factor * history_grad_squared
-                                 + post_factor * elbo_grad.square();
-        }
-        eta_scaled = eta / sqrt(static_cast<double>(iter_tune));
-        // Stochastic gradient update
-        variational
-            += eta_scaled * elbo_grad / (tau + history_grad_squared.sqrt());
-      }
-
-      // (ROBUST) Compute ELBO. It's OK if it has diverged.
+    // One generator per proposed eta, seeded in order
+    std::vector<unsigned int> seeds(eta_sequence_size);
+    for (int k = 0; k < eta_sequence_size; ++k)
+      seeds[k] = rng_();
+    std::vector<double> elbos(eta_sequence_size);
+    std::vector<callbacks::recording_logger> messages(eta_sequence_size);
+    std::vector<std::exception_ptr> errors(eta_sequence_size);
+    std::vector<bool> tried(eta_sequence_size, false);
+    auto try_eta = [&](int k) {
       try {
-        elbo = calc_ELBO(variational, logger);
-      } catch (const std::domain_error& e) {
-        elbo = -std::numeric_limits<double>::max();
+        BaseRNG rng(seeds[k]);
+        Eigen::MatrixXd common_eta = elbo_eta_;
+        elbos[k] = adapt_eta_candidate(
+            variational, eta_sequence[k], adapt_iterations,
+            k * adapt_iterations, eta_sequence_size * adapt_iterations, rng,
+            common_eta, messages[k]);
+      } catch (...) {
+        errors[k] = std::current_exception();
       }
+      tried[k] = true;
+    };
+#ifdef STAN_THREADS
+    tbb::parallel_for(tbb::blocked_range<int>(0, eta_sequence_size),
+                      [&](const tbb::blocked_range<int>& r) {
+                        for (int k = r.begin(); k != r.end(); ++k)
+                          try_eta(k);
+                      });
+#endif
+
+    double eta_best = 0.0;
+    for (int k = 0; k < eta_sequence_size; ++k) {
+      if (!tried[k])
+        try_eta(k);
+      messages[k].replay(logger);
+      if (errors[k])
+        std::rethrow_exception(errors[k]);
+      double eta = eta_sequence[k];
+      double elbo = elbos[k];
 
       // Check if:
       // (1) ELBO at current eta is worse than the best ELBO
@@ -252,42 +251,35 @@ class advi {
         std::stringstream ss;
         ss << "Success!"
            << " Found best value [eta = " << eta_best << "]";
-        if (eta_sequence_index < eta_sequence_size - 1)
+        if (k < eta_sequence_size - 1)
           ss << (" earlier than expected.");
         else
           ss << ".";
         logger.info(ss);
         logger.info("");
-        do_more_tuning = false;
+        break;
+      }
+      if (k < eta_sequence_size - 1) {
+        elbo_best = elbo;
+        eta_best = eta;
       } else {
-        if (eta_sequence_index < eta_sequence_size - 1) {
-          // Reset
-          elbo_best = elbo;
+        // No more eta values to try, so use current eta if it
+        // didn't diverge or fail if it did diverge
+        if (elbo > elbo_init) {
+          std::stringstream ss;
+          ss << "Success!"
+             << " Found best value [eta = " << eta_best << "].";
+          logger.info(ss);
+          logger.info("");
           eta_best = eta;
         } else {
-          // No more eta values to try, so use current eta if it
-          // didn't diverge or fail if it did diverge
-          if (elbo > elbo_init) {
-            std::stringstream ss;
-            ss << "Success!"
-               << " Found best value [eta = " << eta_best << "].";
-            logger.info(ss);
-            logger.info("");
-            eta_best = eta;
-            do_more_tuning = false;
-          } else {
-            const char* name = "All proposed step-sizes";
-            const char* msg1
-                = "failed. Your model may be either "
-                  "severely ill-conditioned or misspecified.";
-            stan::math::throw_domain_error(function, name, "", msg1);
-          }
+          const char* name = "All proposed step-sizes";
+          const char* msg1
+              = "failed. Your model may be either "
+                "severely ill-conditioned or misspecified.";
+          stan::math::throw_domain_error(function, name, "", msg1);
         }
-        // Reset
-        history_grad_squared.set_to_zero();
       }
-      ++eta_sequence_index;
-      variational = Q(cont_params_);
     }
     return eta_best;
   }
@@ -308,6 +300,36 @@ class advi {
                                   double tol_rel_obj, int max_iterations,
                                   callbacks::logger& logger,
                                   callbacks::writer& diagnostic_writer) const {
+    ascent_update<Q> update(method_, variational);
+    callbacks::writer state_writer;
+    stochastic_gradient_ascent(variational, update, eta, tol_rel_obj,
+                               max_iterations, logger, diagnostic_writer,
+                               state_writer);
+  }
+
+  /**
+   * Runs stochastic gradient ascent with the specified update rule,
+   * continuing from the steps it has already taken, and writes the
+   * state of the ascent, as returned by <code>write_advi_state()</code>,
+   * every time the ELBO is evaluated and once the ascent stops. Each
+   * state supersedes the previous one.
+   *
+   * @param[in,out] variational initial variational distribution
+   * @param[in,out] update update rule and its history
+   * @param[in] eta stepsize scaling parameter
+   * @param[in] tol_rel_obj relative tolerance parameter for convergence
+   * @param[in] max_iterations max number of iterations to run algorithm
+   * @param[in,out] logger logger for messages
+   * @param[in,out] diagnostic_writer writer for diagnostic information
+   * @param[in,out] state_writer writer for the state of the ascent
+   * @throw std::domain_error If the ELBO or its gradient is ever
+   * non-finite, at any iteration
+   */
+  void stochastic_gradient_ascent(Q& variational, ascent_update<Q>& update,
+                                  double eta, double tol_rel_obj,
+                                  int max_iterations, callbacks::logger& logger,
+                                  callbacks::writer& diagnostic_writer,
+                                  callbacks::writer& state_writer) const {
     static const char* function
         = "stan::variational::advi::stochastic_gradient_ascent";
 
@@ -317,14 +339,8 @@ class advi {
     stan::math::check_positive(function, "Maximum iterations", max_iterations);
 
     // Gradient parameters
-    Q elbo_grad = Q(model_.num_params_r());
-
-    // Stepsize sequence parameters
-    Q history_grad_squared = Q(model_.num_params_r());
-    double tau = 1.0;
-    double pre_factor = 0.9;
-    double post_factor = 0.1;
-    double eta_scaled;
+    Q elbo_grad(variational);
+    elbo_grad.set_to_zero();
 
     // Initialize ELBO and convergence tracking variables
     double elbo(0.0);
@@ -356,18 +372,8 @@ class advi {
       // Compute gradient using Monte Carlo integration
       calc_ELBO_grad(variational, elbo_grad, logger);
 
-      // Update step-size
-      if (iter_counter == 1) {
-        history_grad_squared += elbo_grad.square();
-      } else {
-        history_grad_squared = pre_factor * history_grad_squared
-                               + post_factor * elbo_grad.square();
-      }
-      eta_scaled = eta / sqrt(static_cast<double>(iter_counter));
-
       // Stochastic gradient update
-      variational
-          += eta_scaled * elbo_grad / (tau + history_grad_squared.sqrt());
+      update(variational, elbo_grad, eta);
 
       // Check for convergence every "eval_elbo_"th iteration
       if (iter_counter % eval_elbo_ == 0) {
@@ -398,6 +404,7 @@ class advi {
         print_vector.push_back(delta_t);
         print_vector.push_back(elbo);
         diagnostic_writer(print_vector);
+        state_writer(write_advi_state(variational, update, eta));
 
         if (delta_elbo_ave < tol_rel_obj) {
           ss << "   MEAN ELBO CONVERGED";
@@ -440,6 +447,7 @@ class advi {
         do_more_iterations = false;
       }
     }
+    state_writer(write_advi_state(variational, update, eta));
   }
 
   /**
@@ -459,12 +467,75 @@ class advi {
           double tol_rel_obj, int max_iterations, callbacks::logger& logger,
           callbacks::writer& parameter_writer,
           callbacks::writer& diagnostic_writer) const {
-    diagnostic_writer("iter,time_in_seconds,ELBO");
+    return run(Q(cont_params_), eta, adapt_engaged, adapt_iterations,
+               tol_rel_obj, max_iterations, logger, parameter_writer,
+               diagnostic_writer);
+  }
 
-    // Initialize variational approximation
-    Q variational = Q(cont_params_);
+  /**
+   * Runs ADVI from the specified initial variational approximation and
+   * writes to output. This is how families with settings beyond the
+   * initial mean, such as the rank of <code>normal_lowrank</code>, are
+   * run.
+   *
+   * @param[in] variational initial variational approximation
+   * @param[in] eta eta parameter of stepsize sequence
+   * @param[in] adapt_engaged boolean flag for eta adaptation
+   * @param[in] adapt_iterations number of iterations for eta adaptation
+   * @param[in] tol_rel_obj relative tolerance parameter for convergence
+   * @param[in] max_iterations max number of iterations to run algorithm
+   * @param[in,out] logger logger for messages
+   * @param[in,out] parameter_writer writer for parameters
+   *   (typically to file)
+   * @param[in,out] diagnostic_writer writer for diagnostic information
+   */
+  int run(Q variational, double eta, bool adapt_engaged, int adapt_iterations,
+          double tol_rel_obj, int max_iterations, callbacks::logger& logger,
+          callbacks::writer& parameter_writer,
+          callbacks::writer& diagnostic_writer) const {
+    ascent_update<Q> update(method_, variational);
+    callbacks::writer state_writer;
+    return run(variational, update, eta, adapt_engaged, adapt_iterations,
+               tol_rel_obj, max_iterations, logger, parameter_writer,
+               diagnostic_writer, state_writer);
+  }
 
-    if (adapt_engaged) {
+  /**
+   * Runs ADVI from the specified initial variational approximation and
+   * update rule, which may hold the state of an earlier run so that the
+   * ascent continues where that run stopped, and writes to output. The
+   * eta adaptation is skipped when the update rule has already taken
+   * steps.
+   *
+   * @param[in] variational initial variational approximation
+   * @param[in,out] update update rule and its history, holding the final
+   * history on return
+   * @param[in] eta eta parameter of stepsize sequence
+   * @param[in] adapt_engaged boolean flag for eta adaptation
+   * @param[in] adapt_iterations number of iterations for eta adaptation
+   * @param[in] tol_rel_obj relative tolerance parameter for convergence
+   * @param[in] max_iterations max number of iterations to run algorithm
+   * @param[in,out] logger logger for messages
+   * @param[in,out] parameter_writer writer for parameters
+   *   (typically to file)
+   * @param[in,out] diagnostic_writer writer for diagnostic information
+   * @param[in,out] state_writer writer for the state of the ascent, see
+   * <code>stochastic_gradient_ascent()</code>
+   */
+  int run(Q variational, ascent_update<Q>& update, double eta,
+          bool adapt_engaged, int adapt_iterations, double tol_rel_obj,
+          int max_iterations, callbacks::logger& logger,
+          callbacks::writer& parameter_writer,
+          callbacks::writer& diagnostic_writer,
+          callbacks::writer& state_writer) const {
+    diagnostic_writer("iter,time_in_seconds,ELBO");
+
+    if (update.iterations() > 0) {
+      std::stringstream ss;
+      ss << "Continuing stochastic gradient ascent after "
+         << update.iterations() << " iterations with eta = " << eta << ".";
+      logger.info(ss);
+    } else if (adapt_engaged) {
       eta = adapt_eta(variational, adapt_iterations, logger);
       parameter_writer("Stepsize adaptation complete.");
       std::stringstream ss;
@@ -472,8 +543,9 @@ class advi {
       parameter_writer(ss.str());
     }
 
-    stochastic_gradient_ascent(variational, eta, tol_rel_obj, max_iterations,
-                               logger, diagnostic_writer);
+    stochastic_gradient_ascent(variational, update, eta, tol_rel_obj,
+                               max_iterations, logger, diagnostic_writer,
+                               state_writer);
 
     // Write posterior mean of variational approximations.
     cont_params_ = variational.mean();
@@ -499,24 +571,55 @@ class advi {
     ss << "Drawing a sample of size " << n_posterior_samples_
        << " from the approximate posterior... ";
     logger.info(ss);
-    double log_p = 0;
-    double log_g = 0;
-    // Draw posterior sample. log_g is the log normal densities.
-    for (int n = 0; n < n_posterior_samples_; ++n) {
-      variational.sample_log_g(rng_, cont_params_, log_g);
-      for (int i = 0; i < cont_params_.size(); ++i) {
-        cont_vector.at(i) = cont_params_(i);
+    // Draw posterior sample in batches. log_g is the log normal
+    // densities. The draws and one seed per draw for its generated
+    // quantities are made serially from rng_, so the output for each
+    // draw doesn't depend on the number of threads
+    static const int batch_size = 256;
+    Eigen::MatrixXd draws;
+    Eigen::VectorXd log_g;
+    std::vector<unsigned int> seeds;
+    std::vector<double> log_p;
+    std::vector<std::vector<double>> draw_values;
+    std::vector<std::string> messages;
+    std::vector<std::exception_ptr> errors;
+    for (int n = 0; n < n_posterior_samples_;) {
+      const int n_batch = std::min(batch_size, n_posterior_samples_ - n);
+      variational.sample_log_g(rng_, n_batch, draws, log_g);
+      seeds.resize(n_batch);
+      for (int j = 0; j < n_batch; ++j)
+        seeds[j] = rng_();
+      log_p.assign(n_batch, 0);
+      draw_values.resize(n_batch);
+      messages.assign(n_batch, "");
+      errors.assign(n_batch, nullptr);
+      for_each_draw(n_batch, [&](int j) {
+        try {
+          std::stringstream msg2;
+          std::vector<double> draw(draws.col(j).data(),
+                                   draws.col(j).data() + draws.rows());
+          std::vector<int> disc;
+          BaseRNG draw_rng(seeds[j]);
+          model_.write_array(draw_rng, draw, disc, draw_values[j], true, true,
+                             &msg2);
+          //  log_p: Log probability in the unconstrained space
+          Eigen::VectorXd draw_j = draws.col(j);
+          log_p[j] = model_.template log_prob<false, true>(draw_j, &msg2);
+          messages[j] = msg2.str();
+        } catch (...) {
+          errors[j] = std::current_exception();
+        }
+      });
+      for (int j = 0; j < n_batch; ++j) {
+        if (messages[j].length() > 0)
+          logger.info(messages[j]);
+        if (errors[j])
+          std::rethrow_exception(errors[j]);
+        // Write lp__, log_p, and log_g.
+        draw_values[j].insert(draw_values[j].begin(), {0, log_p[j], log_g(j)});
+        parameter_writer(draw_values[j]);
       }
-      std::stringstream msg2;
-      model_.write_array(rng_, cont_vector, disc_vector, values, true, true,
-                         &msg2);
-      //  log_p: Log probability in the unconstrained space
-      log_p = model_.template log_prob<false, true>(cont_params_, &msg2);
-      if (msg2.str().length() > 0)
-        logger.info(msg2);
-      // Write lp__, log_p, and log_g.
-      values.insert(values.begin(), {0, log_p, log_g});
-      parameter_writer(values);
+      n += n_batch;
     }
     logger.info("COMPLETED.");
     return stan::services::error_codes::OK;
@@ -555,6 +658,206 @@ class advi {
   }
 
  protected:
+  /**
+   * Runs <code>f(j)</code> for every draw <code>j</code> of a batch,
+   * spread over the TBB thread pool when Stan is built with
+   * <code>STAN_THREADS</code>.
+   */
+  template <typename F>
+  static void for_each_draw(int n, const F& f) {
+#ifdef STAN_THREADS
+    tbb::parallel_for(tbb::blocked_range<int>(0, n),
+                      [&f](const tbb::blocked_range<int>& r) {
+                        for (int j = r.begin(); j != r.end(); ++j)
+                          f(j);
+                      });
+#else
+    for (int j = 0; j < n; ++j)
+      f(j);
+#endif
+  }
+
+  /**
+   * Calculates the ELBO as <code>calc_ELBO(variational, logger)</code>
+   * does, using the specified random number generator and common draws.
+   */
+  template <class RNG>
+  double calc_ELBO(const Q& variational, RNG& rng, Eigen::MatrixXd& common_eta,
+                   callbacks::logger& logger) const {
+    static const char* function = "stan::variational::advi::calc_ELBO";
+
+    int dim = variational.dimension();
+    Eigen::VectorXd zeta(dim);
+    Eigen::MatrixXd zetas;
+    std::vector<double> log_probs;
+    // Log densities of the draws evaluated so far
+    std::vector<double> evaluated;
+    std::vector<std::string> messages;
+    std::vector<std::exception_ptr> errors;
+
+    // Columns of common_eta still to be evaluated, with common draws
+    std::vector<int> pending, failed;
+    if (common_elbo_draws_) {
+      if (common_eta.rows() != variational.eta_dimension())
+        draw_elbo_eta(variational.eta_dimension(), rng, common_eta);
+      for (int j = 0; j < n_monte_carlo_elbo_; ++j)
+        pending.push_back(j);
+    }
+
+    // The draws still missing are made serially from rng, so the
+    // result doesn't depend on the number of threads, and then
+    // evaluated as one batch
+    int n_dropped_evaluations = 0;
+    for (int i = 0; i < n_monte_carlo_elbo_;) {
+      int n_batch = n_monte_carlo_elbo_ - i;
+      zetas.resize(dim, n_batch);
+      for (int j = 0; j < n_batch; ++j) {
+        if (common_elbo_draws_) {
+          zetas.col(j) = variational.transform(common_eta.col(pending[j]));
+        } else {
+          variational.sample(rng, zeta);
+          zetas.col(j) = zeta;
+        }
+      }
+      log_probs.assign(n_batch, 0.0);
+      messages.assign(n_batch, "");
+      errors.assign(n_batch, nullptr);
+      for_each_draw(n_batch, [&](int j) {
+        try {
+          std::stringstream ss;
+          Eigen::VectorXd zeta_j = zetas.col(j);
+          log_probs[j] = model_.template log_prob<false, true>(zeta_j, &ss);
+          messages[j] = ss.str();
+          stan::math::check_finite(function, "log_prob", log_probs[j]);
+        } catch (...) {
+          errors[j] = std::current_exception();
+        }
+      });
+
+      for (int j = 0; j < n_batch; ++j) {
+        if (messages[j].length() > 0)
+          logger.info(messages[j]);
+        if (!errors[j]) {
+          evaluated.push_back(log_probs[j]);
+          ++i;
+          continue;
+        }
+        try {
+          std::rethrow_exception(errors[j]);
+        } catch (const std::domain_error& e) {
+          if (common_elbo_draws_) {
+            for (int d = 0; d < common_eta.rows(); ++d)
+              common_eta(d, pending[j]) = stan::math::normal_rng(0, 1, rng);
+            failed.push_back(pending[j]);
+          }
+          ++n_dropped_evaluations;
+          if (n_dropped_evaluations >= n_monte_carlo_elbo_) {
+            const char* name = "The number of dropped evaluations";
+            const char* msg1 = "has reached its maximum amount (";
+            const char* msg2
+                = "). Your model may be either severely "
+                  "ill-conditioned or misspecified.";
+            stan::math::throw_domain_error(function, name,
+                                           n_monte_carlo_elbo_, msg1, msg2);
+          }
+        }
+      }
+      pending.swap(failed);
+      failed.clear();
+    }
+    // Summed by a pairwise tree in the order of the draws, so the ELBO
+    // doesn't depend on the number of threads
+    double elbo = stan::util::deterministic_sum(evaluated);
+    elbo /= n_monte_carlo_elbo_;
+    elbo += variational.entropy();
+    return elbo;
+  }
+
+  /**
+   * Run stochastic gradient ascent with the specified eta for eta
+   * adaptation from a copy of the specified variational distribution
+   * and return the ELBO it reaches, or the lowest double if it
+   * diverges.
+   *
+   * @param[in] variational initial variational distribution
+   * @param[in] eta stepsize scaling parameter
+   * @param[in] adapt_iterations number of iterations
+   * @param[in] progress_offset number of adaptation iterations of the
+   * proposals before this one, for the progress messages
+   * @param[in] progress_total total number of adaptation iterations
+   * @param[in,out] rng random number generator
+   * @param[in,out] common_eta common ELBO draws
+   * @param[in,out] logger logger for messages
+   * @return ELBO after the iterations
+   */
+  template <class RNG>
+  double adapt_eta_candidate(Q variational, double eta, int adapt_iterations,
+                             int progress_offset, int progress_total,
+                             RNG& rng, Eigen::MatrixXd& common_eta,
+                             callbacks::logger& logger) const {
+    Q elbo_grad(variational);
+    elbo_grad.set_to_zero();
+    ascent_update<Q> update(method_, variational);
+
+    for (int iter_tune = 1; iter_tune <= adapt_iterations; ++iter_tune) {
+      stan::variational::print_progress(progress_offset + iter_tune, 0,
+                                        progress_total, adapt_iterations,
+                                        true, "", "", logger);
+
+      // (ROBUST) Compute gradient of ELBO. It's OK if it diverges.
+      // We'll try a smaller eta.
+      try {
+        calc_ELBO_grad(variational, elbo_grad, rng, logger);
+      } catch (const std::domain_error& e) {
+        elbo_grad.set_to_zero();
+      }
+
+      // Stochastic gradient update
+      update(variational, elbo_grad, eta);
+    }
+
+    // (ROBUST) Compute ELBO. It's OK if it has diverged.
+    try {
+      return calc_ELBO(variational, rng, common_eta, logger);
+    } catch (const std::domain_error& e) {
+      return -std::numeric_limits<double>::max();
+    }
+  }
+
+  /**
+   * Calculates the "black box" gradient of the ELBO using the specified
+   * random number generator. Derived classes may override this to
+   * estimate the gradient differently, for instance from a subsample of
+   * the data.
+   */
+  virtual void calc_ELBO_grad(const Q& variational, Q& elbo_grad,
+                              BaseRNG& rng, callbacks::logger& logger) const {
+    variational.calc_grad(elbo_grad, model_, cont_params_, n_monte_carlo_grad_,
+                          rng, logger, stick_the_landing_,
+                          antithetic_grad_draws_);
+  }
+
+  /**
+   * Draw the standard normal variates for common ELBO draws as
+   * antithetic pairs, leaving the last one unpaired for an odd number
+   * of draws.
+   *
+   * @param[in] eta_dimension number of variates per draw
+   * @param[in,out] rng random number generator
+   * @param[out] common_eta variates, one draw per column
+   */
+  template <class RNG>
+  void draw_elbo_eta(int eta_dimension, RNG& rng,
+                     Eigen::MatrixXd& common_eta) const {
+    common_eta.resize(eta_dimension, n_monte_carlo_elbo_);
+    for (int j = 0; j < n_monte_carlo_elbo_; j += 2) {
+      for (int d = 0; d < eta_dimension; ++d)
+        common_eta(d, j) = stan::math::normal_rng(0, 1, rng);
+      if (j + 1 < n_monte_carlo_elbo_)
+        common_eta.col(j + 1) = -common_eta.col(j);
+    }
+  }
+
   Model& model_;
   Eigen::VectorXd& cont_params_;
   BaseRNG& rng_;
@@ -562,6 +865,12 @@ class advi {
   int n_monte_carlo_elbo_;
   int eval_elbo_;
   int n_posterior_samples_;
+  bool common_elbo_draws_;
+  bool stick_the_landing_;
+  bool antithetic_grad_draws_;
+  ascent_method method_;
+  // Standard normal variates of the common ELBO draws, one per column
+  mutable Eigen::MatrixXd elbo_eta_;
 };
 }  // namespace variational
 }  // namespace stan
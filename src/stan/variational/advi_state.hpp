@@ -0,0 +1,72 @@
+#ifndef STAN_VARIATIONAL_ADVI_STATE_HPP
+#define STAN_VARIATIONAL_ADVI_STATE_HPP
+
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/variational/ascent_update.hpp>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace stan {
+namespace variational {
+
+/**
+ * Return the state of a stochastic gradient ascent of ADVI, that is
+ * the stepsize scaling parameter, the variational approximation and
+ * the update rule with its history, as text that
+ * <code>read_advi_state()</code> restores exactly.
+ *
+ * @tparam Q class of variational distribution
+ * @param[in] variational variational approximation
+ * @param[in] update update rule and its history
+ * @param[in] eta stepsize scaling parameter
+ * @return state
+ */
+template <class Q>
+std::string write_advi_state(const Q& variational,
+                             const ascent_update<Q>& update, double eta) {
+  std::stringstream out;
+  stan::mcmc::state_writer writer(out);
+  writer.tag("advi");
+  writer.write(eta);
+  variational.write_state(writer);
+  update.write_state(writer);
+  return out.str();
+}
+
+/**
+ * Restore the state of a stochastic gradient ascent of ADVI written by
+ * <code>write_advi_state()</code>. The approximation and the update
+ * rule must already have the dimensions of the state, and are left
+ * unchanged if it can't be read.
+ *
+ * @tparam Q class of variational distribution
+ * @param[in,out] in stream holding the state
+ * @param[in,out] variational variational approximation
+ * @param[in,out] update update rule and its history
+ * @param[out] eta stepsize scaling parameter
+ * @throw std::invalid_argument If the state can't be read, was written
+ * for another family, or has other dimensions.
+ */
+template <class Q>
+void read_advi_state(std::istream& in, Q& variational,
+                     ascent_update<Q>& update, double& eta) {
+  stan::mcmc::state_reader reader(in);
+  reader.tag("advi");
+  double eta_read;
+  reader.read(eta_read);
+  if (!(eta_read > 0))
+    throw std::invalid_argument("ADVI state: eta must be positive");
+  Q variational_read(variational);
+  variational_read.read_state(reader);
+  ascent_update<Q> update_read(update);
+  update_read.read_state(reader);
+  variational = variational_read;
+  update = update_read;
+  eta = eta_read;
+}
+
+}  // namespace variational
+}  // namespace stan
+#endif
@@ -0,0 +1,186 @@
+#ifndef STAN_VARIATIONAL_ASCENT_UPDATE_HPP
+#define STAN_VARIATIONAL_ASCENT_UPDATE_HPP
+
+#include <stan/mcmc/sampler_state.hpp>
+#include <cmath>
+#include <stdexcept>
+
+namespace stan {
+
+namespace variational {
+
+/**
+ * Update rules for the stochastic gradient ascent of ADVI.
+ */
+enum class ascent_method {
+  /**
+   * The adaptive step size sequence of the ADVI paper, scaling each
+   * coordinate by a moving average of its squared gradients, with
+   * steps decaying as 1 / sqrt(iteration).
+   */
+  adagrad,
+  /**
+   * Adam, with bias corrected moving averages of the gradients and
+   * squared gradients and a constant step size.
+   */
+  adam,
+  /**
+   * Natural gradient ascent, preconditioning the gradient by the
+   * inverse Fisher information of the variational family, with steps
+   * decaying as 1 / sqrt(iteration).
+   */
+  natural_gradient
+};
+
+/**
+ * The state of a stochastic gradient ascent update rule for a
+ * variational family, applying one step at a time. The state, which
+ * includes the number of steps taken, can be written and restored to
+ * continue an ascent where an earlier run stopped.
+ *
+ * The family must support the elementwise operations the families
+ * provide for the step size sequence, and for natural gradients a
+ * <code>natural_gradient()</code> member function that returns the
+ * specified gradient preconditioned by the inverse Fisher information
+ * at the family's current parameters.
+ *
+ * @tparam Q class of variational distribution
+ */
+template <class Q>
+class ascent_update {
+ public:
+  /**
+   * Construct an update rule with an empty history.
+   *
+   * @param[in] method update rule
+   * @param[in] variational variational distribution to be updated,
+   * used for the dimensions of the history
+   */
+  ascent_update(ascent_method method, const Q& variational)
+      : method_(method),
+        iterations_(0),
+        first_moment_(variational),
+        second_moment_(variational) {
+    reset();
+  }
+
+  /**
+   * Return the update rule.
+   */
+  ascent_method method() const { return method_; }
+
+  /**
+   * Return the number of steps taken since the last reset.
+   */
+  int iterations() const { return iterations_; }
+
+  /**
+   * Forget the history of gradients and the number of steps taken.
+   */
+  void reset() {
+    iterations_ = 0;
+    first_moment_.set_to_zero();
+    second_moment_.set_to_zero();
+  }
+
+  /**
+   * Take one ascent step, the number of steps taken so far setting
+   * the decay of the step size.
+   *
+   * @param[in,out] variational variational distribution to update
+   * @param[in] elbo_grad gradient of the ELBO at the variational
+   * distribution
+   * @param[in] eta stepsize scaling parameter
+   */
+  void operator()(Q& variational, const Q& elbo_grad, double eta) {
+    const int iter = ++iterations_;
+    switch (method_) {
+      case ascent_method::adam: {
+        const double beta1 = 0.9;
+        const double beta2 = 0.999;
+        const double epsilon = 1e-8;
+        first_moment_ = beta1 * first_moment_ + (1 - beta1) * elbo_grad;
+        second_moment_
+            = beta2 * second_moment_ + (1 - beta2) * elbo_grad.square();
+        const double eta_scaled = eta * std::sqrt(1 - std::pow(beta2, iter))
+                                  / (1 - std::pow(beta1, iter));
+        variational += eta_scaled * first_moment_
+                       / (epsilon + second_moment_.sqrt());
+        break;
+      }
+      case ascent_method::natural_gradient: {
+        const double eta_scaled = eta / std::sqrt(static_cast<double>(iter));
+        variational += eta_scaled * variational.natural_gradient(elbo_grad);
+        break;
+      }
+      default: {
+        const double tau = 1.0;
+        const double pre_factor = 0.9;
+        const double post_factor = 0.1;
+        if (iter == 1) {
+          second_moment_ += elbo_grad.square();
+        } else {
+          second_moment_ = pre_factor * second_moment_
+                           + post_factor * elbo_grad.square();
+        }
+        const double eta_scaled = eta / std::sqrt(static_cast<double>(iter));
+        variational += eta_scaled * elbo_grad / (tau + second_moment_.sqrt());
+      }
+    }
+  }
+
+  /**
+   * Write the update rule, the number of steps taken and the history
+   * of gradients so that <code>read_state()</code> can restore them
+   * exactly.
+   *
+   * @param[in,out] writer state writer
+   */
+  void write_state(stan::mcmc::state_writer& writer) const {
+    writer.tag("ascent_update");
+    writer.write(static_cast<int>(method_));
+    writer.write(iterations_);
+    first_moment_.write_state(writer);
+    second_moment_.write_state(writer);
+  }
+
+  /**
+   * Restore the state written by <code>write_state()</code>, including
+   * the update rule.
+   *
+   * @param[in,out] reader state reader
+   * @throw std::invalid_argument If the state can't be read or doesn't
+   * match the variational family.
+   */
+  void read_state(stan::mcmc::state_reader& reader) {
+    reader.tag("ascent_update");
+    int method;
+    reader.read(method);
+    if (method < static_cast<int>(ascent_method::adagrad)
+        || method > static_cast<int>(ascent_method::natural_gradient))
+      throw std::invalid_argument("Ascent update: unknown update rule");
+    int iterations;
+    reader.read(iterations);
+    if (iterations < 0)
+      throw std::invalid_argument("Ascent update: negative iterations");
+    Q first_moment(first_moment_);
+    Q second_moment(second_moment_);
+    first_moment.read_state(reader);
+    second_moment.read_state(reader);
+    first_moment_ = first_moment;
+    second_moment_ = second_moment;
+    method_ = static_cast<ascent_method>(method);
+    iterations_ = iterations;
+  }
+
+ private:
+  ascent_method method_;
+  int iterations_;
+  // Moving averages of the gradients and of the squared gradients
+  Q first_moment_;
+  Q second_moment_;
+};
+
+}  // namespace variational
+}  // namespace stan
+#endif
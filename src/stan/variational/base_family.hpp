@@ -3,6 +3,7 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/math/prim.hpp>
+#include <stan/util/deterministic_reduce.hpp>
 #include <algorithm>
 #include <ostream>
 
@@ -19,6 +20,12 @@ class base_family {
    */
   virtual int dimension() const = 0;
 
+  /**
+   * Return the number of standard normal variates transformed into
+   * one draw from the approximation.
+   */
+  virtual int eta_dimension() const { return dimension(); }
+
   // Distribution-based operations
   virtual const Eigen::VectorXd& mean() const = 0;
   virtual double entropy() const = 0;
@@ -82,9 +89,38 @@ class base_family {
   template <class M, class BaseRNG>
   void calc_grad(base_family& elbo_grad, M& m, Eigen::VectorXd& cont_params,
                  int n_monte_carlo_grad, BaseRNG& rng,
-                 callbacks::logger& logger) const;
+                 callbacks::logger& logger, bool stick_the_landing = false,
+                 bool antithetic = false) const;
 
  protected:
+  /**
+   * Number of draws whose gradient terms are summed serially by one
+   * task of <code>sum_over_draws()</code>.
+   */
+  static constexpr int draw_chunk_size = 16;
+
+  /**
+   * Return the sum over the draws <code>0, ..., n - 1</code> of a
+   * batch of the terms <code>f(begin, end)</code> of consecutive chunks
+   * of draws, summed in parallel by a pairwise tree, so that the
+   * gradient doesn't depend on the number of threads.
+   *
+   * @tparam T type of the sum, an Eigen vector or matrix
+   * @tparam F type of the terms, callable as
+   *   <code>T f(int begin, int end)</code>
+   * @param n number of draws
+   * @param zero sum of no draws
+   * @param f sum of the terms of the draws <code>[begin, end)</code>
+   * @return sum over the draws
+   */
+  template <typename T, typename F>
+  static T sum_over_draws(int n, const T& zero, const F& f) {
+    return stan::util::deterministic_reduce(
+        n, draw_chunk_size, zero,
+        [&f](size_t begin, size_t end) -> T { return f(begin, end); },
+        [](const T& left, const T& right) -> T { return left + right; });
+  }
+
   void write_error_msg_(std::ostream* error_msgs,
                         const std::exception& e) const {
     if (!error_msgs) {
@@ -3,7 +3,8 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/math/prim.hpp>
-#include <stan/model/gradient.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/model/log_prob_grad.hpp>
 #include <stan/variational/base_family.hpp>
 #include <algorithm>
 #include <ostream>
@@ -198,6 +199,80 @@ class normal_fullrank : public base_family {
                            Eigen::MatrixXd(L_chol_.array().sqrt()));
   }
 
+  /**
+   * Return the natural gradient corresponding to the specified
+   * gradient with respect to the mean and Cholesky factor,
+   * preconditioned by the inverse Fisher information of this
+   * approximation.
+   *
+   * <p>The mean gradient is multiplied by the covariance L * L^T.
+   * Writing a change of Cholesky factor as L * X for lower
+   * triangular X, the Fisher information of the covariance reduces
+   * to the inner product of X + diag(X) with X, so the natural
+   * gradient of the Cholesky factor is L * X, where X is the lower
+   * triangle of L^T * grad with its diagonal halved.
+   *
+   * @param[in] grad Gradient with respect to this approximation's
+   * parameters.
+   * @return Natural gradient.
+   * @throw std::invalid_argument If the dimensionality of the
+   * gradient does not match this approximation's dimensionality.
+   */
+  normal_fullrank natural_gradient(const normal_fullrank& grad) const {
+    static const char* function
+        = "stan::variational::normal_fullrank::natural_gradient";
+    stan::math::check_size_match(function, "Dimension of gradient",
+                                 grad.dimension(), "Dimension of variational q",
+                                 dimension());
+    Eigen::MatrixXd X
+        = (L_chol_.transpose() * grad.L_chol()).triangularView<Eigen::Lower>();
+    X.diagonal() *= 0.5;
+    return normal_fullrank(
+        Eigen::VectorXd(L_chol_ * (L_chol_.transpose() * grad.mu())),
+        Eigen::MatrixXd(L_chol_ * X));
+  }
+
+  /**
+   * Write the mean vector and Cholesky factor so that
+   * <code>read_state()</code> can restore them exactly.
+   *
+   * @param[in,out] writer state writer
+   */
+  void write_state(stan::mcmc::state_writer& writer) const {
+    writer.tag("normal_fullrank");
+    writer.write(mu_);
+    writer.write(L_chol_);
+  }
+
+  /**
+   * Restore the mean vector and Cholesky factor written by
+   * <code>write_state()</code>.
+   *
+   * @param[in,out] reader state reader
+   * @throw std::invalid_argument If the state can't be read, was
+   * written by another family, or has another dimensionality.
+   */
+  void read_state(stan::mcmc::state_reader& reader) {
+    static const char* function
+        = "stan::variational::normal_fullrank::read_state";
+    reader.tag("normal_fullrank");
+    Eigen::VectorXd mu;
+    Eigen::MatrixXd L_chol;
+    reader.read(mu);
+    reader.read(L_chol);
+    stan::math::check_size_match(function, "Dimension of mean vector",
+                                 mu.size(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Rows of Cholesky factor",
+                                 L_chol.rows(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Columns of Cholesky factor",
+                                 L_chol.cols(), "Dimension of variational q",
+                                 dimension());
+    mu_ = mu;
+    L_chol_ = L_chol;
+  }
+
   /**
    * Return this approximation after setting its mean vector and
    * Cholesky factor for covariance to the values given by the
@@ -371,6 +446,33 @@ class normal_fullrank : public base_family {
     eta = transform(eta);
   }
 
+  /**
+   * Draw the specified number of posterior samples from the
+   * approximation into the columns of a matrix, and return their log
+   * densities with the constants dropped, using one matrix product for the
+   * whole batch. The standard normal variates are drawn in the same
+   * order as by successive calls to the single draw
+   * <code>sample_log_g()</code>.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] rng Base random number generator.
+   * @param[in] n Number of draws.
+   * @param[out] draws Draws, one per column.
+   * @param[out] log_g Log densities of the draws in the variational
+   * approximation; the constant terms are dropped.
+   */
+  template <class BaseRNG>
+  void sample_log_g(BaseRNG& rng, int n, Eigen::MatrixXd& draws,
+                    Eigen::VectorXd& log_g) const {
+    Eigen::MatrixXd eta(dimension(), n);
+    for (int j = 0; j < n; ++j)
+      for (int d = 0; d < dimension(); ++d)
+        eta(d, j) = stan::math::normal_rng(0, 1, rng);
+    log_g = -0.5 * eta.colwise().squaredNorm().transpose();
+    draws.noalias() = L_chol_ * eta;
+    draws.colwise() += mu_;
+  }
+
   double calc_log_g(const Eigen::VectorXd& eta) const {
     // Compute the log density wrt normal distribution dropping constants
     double log_g = 0;
@@ -394,13 +496,20 @@ class normal_fullrank : public base_family {
    * @param[in] n_monte_carlo_grad Sample size for gradient computation.
    * @param[in,out] rng Random number generator.
    * @param[in,out] logger logger for messages
+   * @param[in] stick_the_landing whether to drop the score function
+   * term, whose expectation is zero, from the gradient of the entropy
+   * instead of using its exact gradient, which lowers the variance as
+   * the approximation approaches the posterior
+   * @param[in] antithetic whether to make the draws in antithetic pairs
+   * eta and -eta
    * @throw std::domain_error If the number of divergent
    * iterations exceeds its specified bounds.
    */
   template <class M, class BaseRNG>
   void calc_grad(normal_fullrank& elbo_grad, M& m, Eigen::VectorXd& cont_params,
                  int n_monte_carlo_grad, BaseRNG& rng,
-                 callbacks::logger& logger) const {
+                 callbacks::logger& logger, bool stick_the_landing = false,
+                 bool antithetic = false) const {
     static const char* function
         = "stan::variational::normal_fullrank::calc_grad";
     stan::math::check_size_match(function, "Dimension of elbo_grad",
@@ -412,51 +521,87 @@ class normal_fullrank : public base_family {
 
     Eigen::VectorXd mu_grad = Eigen::VectorXd::Zero(dimension());
     Eigen::MatrixXd L_grad = Eigen::MatrixXd::Zero(dimension(), dimension());
-    double tmp_lp = 0.0;
-    Eigen::VectorXd tmp_mu_grad = Eigen::VectorXd::Zero(dimension());
-    Eigen::VectorXd eta = Eigen::VectorXd::Zero(dimension());
-    Eigen::VectorXd zeta = Eigen::VectorXd::Zero(dimension());
-
-    // Naive Monte Carlo integration
+    Eigen::VectorXd tmp_lp;
+    Eigen::MatrixXd tmp_mu_grad;
+    Eigen::MatrixXd eta;
+    Eigen::MatrixXd zeta;
+
+    // Naive Monte Carlo integration. The draws still missing are
+    // evaluated as one batch, spread over threads when available, and
+    // failed evaluations are redrawn in the next batch
     static const int n_retries = 10;
     for (int i = 0, n_monte_carlo_drop = 0; i < n_monte_carlo_grad;) {
       // Draw from standard normal and transform to real-coordinate space
-      for (int d = 0; d < dimension(); ++d) {
-        eta(d) = stan::math::normal_rng(0, 1, rng);
-      }
-      zeta = transform(eta);
-      try {
-        std::stringstream ss;
-        stan::model::gradient(m, zeta, tmp_lp, tmp_mu_grad, &ss);
-        if (ss.str().length() > 0)
-          logger.info(ss);
-        stan::math::check_finite(function, "Gradient of mu", tmp_mu_grad);
-
-        mu_grad += tmp_mu_grad;
-        for (int ii = 0; ii < dimension(); ++ii) {
-          for (int jj = 0; jj <= ii; ++jj) {
-            L_grad(ii, jj) += tmp_mu_grad(ii) * eta(jj);
+      int n_batch = n_monte_carlo_grad - i;
+      eta.resize(dimension(), n_batch);
+      zeta.resize(dimension(), n_batch);
+      for (int j = 0; j < n_batch; ++j) {
+        if (antithetic && j % 2 == 1) {
+          eta.col(j) = -eta.col(j - 1);
+        } else {
+          for (int d = 0; d < dimension(); ++d) {
+            eta(d, j) = stan::math::normal_rng(0, 1, rng);
           }
         }
-        ++i;
-      } catch (const std::exception& e) {
-        ++n_monte_carlo_drop;
-        if (n_monte_carlo_drop >= n_retries * n_monte_carlo_grad) {
-          const char* name = "The number of dropped evaluations";
-          const char* msg1 = "has reached its maximum amount (";
-          int y = n_retries * n_monte_carlo_grad;
-          const char* msg2
-              = "). Your model may be either severely "
-                "ill-conditioned or misspecified.";
-          stan::math::throw_domain_error(function, name, y, msg1, msg2);
+        zeta.col(j) = transform(eta.col(j));
+      }
+      std::stringstream ss;
+      stan::model::log_prob_grad<true, true>(m, zeta, tmp_lp, tmp_mu_grad,
+                                             true, &ss);
+      if (ss.str().length() > 0)
+        logger.info(ss);
+      // Move the successful draws to the leading columns
+      int n_ok = 0;
+      for (int j = 0; j < n_batch; ++j) {
+        if (tmp_mu_grad.col(j).allFinite()) {
+          if (n_ok != j) {
+            tmp_mu_grad.col(n_ok) = tmp_mu_grad.col(j);
+            eta.col(n_ok) = eta.col(j);
+          }
+          ++n_ok;
+          ++i;
+        } else {
+          ++n_monte_carlo_drop;
+          if (n_monte_carlo_drop >= n_retries * n_monte_carlo_grad) {
+            const char* name = "The number of dropped evaluations";
+            const char* msg1 = "has reached its maximum amount (";
+            int y = n_retries * n_monte_carlo_grad;
+            const char* msg2
+                = "). Your model may be either severely "
+                  "ill-conditioned or misspecified.";
+            stan::math::throw_domain_error(function, name, y, msg1, msg2);
+          }
         }
       }
+      // The gradients of log q at the draws, -L'^-1 eta, are subtracted
+      // to stick the landing
+      if (stick_the_landing)
+        tmp_mu_grad.leftCols(n_ok)
+            += L_chol_.triangularView<Eigen::Lower>().transpose().solve(
+                eta.leftCols(n_ok));
+      // Accumulate the lower triangle of the sum of the outer products
+      // of the gradients and draws as one matrix product per chunk of
+      // draws
+      mu_grad += sum_over_draws(
+          n_ok, Eigen::VectorXd::Zero(dimension()).eval(),
+          [&](int begin, int end) {
+            return Eigen::VectorXd(
+                tmp_mu_grad.middleCols(begin, end - begin).rowwise().sum());
+          });
+      L_grad.triangularView<Eigen::Lower>() += sum_over_draws(
+          n_ok, Eigen::MatrixXd::Zero(dimension(), dimension()).eval(),
+          [&](int begin, int end) {
+            return Eigen::MatrixXd(
+                tmp_mu_grad.middleCols(begin, end - begin)
+                * eta.middleCols(begin, end - begin).transpose());
+          });
     }
     mu_grad /= static_cast<double>(n_monte_carlo_grad);
     L_grad /= static_cast<double>(n_monte_carlo_grad);
 
     // Add gradient of entropy term
-    L_grad.diagonal().array() += L_chol_.diagonal().array().inverse();
+    if (!stick_the_landing)
+      L_grad.diagonal().array() += L_chol_.diagonal().array().inverse();
 
     elbo_grad.set_mu(mu_grad);
     elbo_grad.set_L_chol(L_grad);
@@ -0,0 +1,811 @@
+#ifndef STAN_VARIATIONAL_NORMAL_LOWRANK_HPP
+#define STAN_VARIATIONAL_NORMAL_LOWRANK_HPP
+
+#include <stan/callbacks/logger.hpp>
+#include <stan/math/prim.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/model/log_prob_grad.hpp>
+#include <stan/variational/base_family.hpp>
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+namespace stan {
+
+namespace variational {
+
+/**
+ * Variational family approximation with a multivariate normal
+ * distribution whose covariance is low rank plus diagonal,
+ *
+ *   Sigma = B * B' + diag(exp(2 * omega)),
+ *
+ * for a mean vector mu, a log standard deviation vector omega and a
+ * dimension x rank factor B. It captures the leading correlations of
+ * the posterior with O(dimension * rank) parameters, between the mean
+ * field and full rank families.
+ *
+ * Draws are made from dimension + rank standard normal variates eta,
+ * the first dimension of which scale the diagonal and the last rank
+ * of which multiply the factor.
+ */
+class normal_lowrank : public base_family {
+ private:
+  /**
+   * Mean vector.
+   */
+  Eigen::VectorXd mu_;
+
+  /**
+   * Log standard deviation (log scale) vector of the diagonal.
+   */
+  Eigen::VectorXd omega_;
+
+  /**
+   * Low rank factor of the covariance.
+   */
+  Eigen::MatrixXd B_;
+
+  /**
+   * Dimensionality of distribution.
+   */
+  const int dimension_;
+
+  /**
+   * Rank of the factor.
+   */
+  const int rank_;
+
+  /**
+   * Return the rank x rank matrix I + C' * C for C = diag(exp(-omega)) * B,
+   * which carries the determinant and inverse of the covariance through
+   * the matrix determinant lemma and the Woodbury identity.
+   */
+  Eigen::MatrixXd capacitance(const Eigen::MatrixXd& C) const {
+    Eigen::MatrixXd M = Eigen::MatrixXd::Identity(rank_, rank_);
+    M.selfadjointView<Eigen::Lower>().rankUpdate(C.transpose());
+    return M.selfadjointView<Eigen::Lower>();
+  }
+
+ public:
+  /**
+   * Construct a variational distribution of the specified
+   * dimensionality and rank with a zero mean, zero log standard
+   * deviation (unit standard deviation) and zero factor.
+   *
+   * @param[in] dimension Dimensionality of distribution.
+   * @param[in] rank Rank of the factor.
+   */
+  normal_lowrank(size_t dimension, size_t rank)
+      : mu_(Eigen::VectorXd::Zero(dimension)),
+        omega_(Eigen::VectorXd::Zero(dimension)),
+        B_(Eigen::MatrixXd::Zero(dimension, rank)),
+        dimension_(dimension),
+        rank_(rank) {}
+
+  /**
+   * Construct a variational distribution with the specified mean
+   * vector, zero log standard deviation (unit standard deviation) and
+   * zero factor of the specified rank.
+   *
+   * @param[in] cont_params Mean vector.
+   * @param[in] rank Rank of the factor.
+   */
+  normal_lowrank(const Eigen::VectorXd& cont_params, size_t rank)
+      : mu_(cont_params),
+        omega_(Eigen::VectorXd::Zero(cont_params.size())),
+        B_(Eigen::MatrixXd::Zero(cont_params.size(), rank)),
+        dimension_(cont_params.size()),
+        rank_(rank) {}
+
+  /**
+   * Construct a variational distribution with the specified mean
+   * vector, zero log standard deviation (unit standard deviation) and
+   * a factor of the specified rank with independent normal entries of
+   * the specified scale. A zero factor is a stationary point of the
+   * evidence lower bound in the factor, so stochastic gradient ascent
+   * from it leaves the factor at zero; a small random factor breaks
+   * the symmetry.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] cont_params Mean vector.
+   * @param[in] rank Rank of the factor.
+   * @param[in,out] rng Random number generator.
+   * @param[in] scale Standard deviation of the factor entries.
+   */
+  template <class BaseRNG>
+  normal_lowrank(const Eigen::VectorXd& cont_params, size_t rank,
+                 BaseRNG& rng, double scale = 0.01)
+      : normal_lowrank(cont_params, rank) {
+    for (int k = 0; k < rank_; ++k)
+      for (int d = 0; d < dimension_; ++d)
+        B_(d, k) = stan::math::normal_rng(0, scale, rng);
+  }
+
+  /**
+   * Construct a variational distribution with the specified mean,
+   * log standard deviation and factor.
+   *
+   * @param[in] mu Mean vector.
+   * @param[in] omega Log standard deviation vector.
+   * @param[in] B Low rank factor, with one row per dimension.
+   * @throw std::domain_error If the sizes of the mean vector, log
+   * standard deviation vector and rows of the factor are different,
+   * or if any contains a not-a-number value.
+   */
+  normal_lowrank(const Eigen::VectorXd& mu, const Eigen::VectorXd& omega,
+                 const Eigen::MatrixXd& B)
+      : mu_(mu),
+        omega_(omega),
+        B_(B),
+        dimension_(mu.size()),
+        rank_(B.cols()) {
+    static const char* function = "stan::variational::normal_lowrank";
+    stan::math::check_size_match(function, "Dimension of mean vector",
+                                 mu_.size(), "Dimension of log std vector",
+                                 omega_.size());
+    stan::math::check_size_match(function, "Dimension of mean vector",
+                                 mu_.size(), "Rows of factor", B_.rows());
+    stan::math::check_not_nan(function, "Mean vector", mu_);
+    stan::math::check_not_nan(function, "Log std vector", omega_);
+    stan::math::check_not_nan(function, "Factor", B_);
+  }
+
+  /**
+   * Return the dimensionality of the approximation.
+   */
+  int dimension() const { return dimension_; }
+
+  /**
+   * Return the rank of the factor.
+   */
+  int rank() const { return rank_; }
+
+  /**
+   * Return the number of standard normal variates transformed into
+   * one draw, the dimensionality plus the rank.
+   */
+  int eta_dimension() const { return dimension_ + rank_; }
+
+  /**
+   * Return the mean vector.
+   */
+  const Eigen::VectorXd& mu() const { return mu_; }
+
+  /**
+   * Return the log standard deviation vector.
+   */
+  const Eigen::VectorXd& omega() const { return omega_; }
+
+  /**
+   * Return the low rank factor.
+   */
+  const Eigen::MatrixXd& B() const { return B_; }
+
+  /**
+   * Set the mean vector to the specified value.
+   *
+   * @param[in] mu Mean vector.
+   * @throw std::domain_error If the mean vector's size does not
+   * match this approximation's dimensionality, or if it contains
+   * not-a-number values.
+   */
+  void set_mu(const Eigen::VectorXd& mu) {
+    static const char* function = "stan::variational::normal_lowrank::set_mu";
+
+    stan::math::check_size_match(function, "Dimension of input vector",
+                                 mu.size(), "Dimension of current vector",
+                                 dimension());
+    stan::math::check_not_nan(function, "Input vector", mu);
+    mu_ = mu;
+  }
+
+  /**
+   * Set the log standard deviation vector to the specified
+   * value.
+   *
+   * @param[in] omega Log standard deviation vector.
+   * @throw std::domain_error If the log standard deviation
+   * vector's size does not match this approximation's
+   * dimensionality, or if it contains not-a-number values.
+   */
+  void set_omega(const Eigen::VectorXd& omega) {
+    static const char* function
+        = "stan::variational::normal_lowrank::set_omega";
+
+    stan::math::check_size_match(function, "Dimension of input vector",
+                                 omega.size(), "Dimension of current vector",
+                                 dimension());
+    stan::math::check_not_nan(function, "Input vector", omega);
+    omega_ = omega;
+  }
+
+  /**
+   * Set the low rank factor to the specified value.
+   *
+   * @param[in] B Low rank factor.
+   * @throw std::domain_error If the factor's size does not match this
+   * approximation's dimensionality and rank, or if it contains
+   * not-a-number values.
+   */
+  void set_B(const Eigen::MatrixXd& B) {
+    static const char* function = "stan::variational::normal_lowrank::set_B";
+
+    stan::math::check_size_match(function, "Rows of input factor", B.rows(),
+                                 "Dimension of current vector", dimension());
+    stan::math::check_size_match(function, "Columns of input factor",
+                                 B.cols(), "Rank of current factor", rank());
+    stan::math::check_not_nan(function, "Input factor", B);
+    B_ = B;
+  }
+
+  /**
+   * Sets the mean, log standard deviation and factor of this
+   * approximation to zero.
+   */
+  void set_to_zero() {
+    mu_ = Eigen::VectorXd::Zero(dimension());
+    omega_ = Eigen::VectorXd::Zero(dimension());
+    B_ = Eigen::MatrixXd::Zero(dimension(), rank());
+  }
+
+  /**
+   * Return a new low rank approximation resulting from squaring the
+   * entries in the mean, log standard deviation and factor.  The new
+   * approximation does not hold any references to this approximation.
+   */
+  normal_lowrank square() const {
+    return normal_lowrank(Eigen::VectorXd(mu_.array().square()),
+                          Eigen::VectorXd(omega_.array().square()),
+                          Eigen::MatrixXd(B_.array().square()));
+  }
+
+  /**
+   * Return a new low rank approximation resulting from taking the
+   * square root of the entries in the mean, log standard deviation and
+   * factor.  The new approximation does not hold any references to this
+   * approximation.
+   *
+   * <b>Warning:</b>  No checks are carried out to ensure the
+   * entries are non-negative before taking square roots, so
+   * not-a-number values may result.
+   */
+  normal_lowrank sqrt() const {
+    return normal_lowrank(Eigen::VectorXd(mu_.array().sqrt()),
+                          Eigen::VectorXd(omega_.array().sqrt()),
+                          Eigen::MatrixXd(B_.array().sqrt()));
+  }
+
+  /**
+   * Return an approximate natural gradient corresponding to the
+   * specified gradient, preconditioned by the Fisher information of
+   * this approximation where it is cheap to invert.
+   *
+   * <p>The mean gradient is multiplied by the covariance
+   * B * B^T + diag(exp(2 * omega)) in O(dk) operations, which is
+   * exact.  The log standard deviation gradient is halved, which is
+   * exact only when the factor is zero, and the factor gradient is
+   * left unchanged, as the Fisher information coupling the factor
+   * and the diagonal has no inverse cheaper than the full covariance.
+   *
+   * @param[in] grad Gradient with respect to this approximation's
+   * parameters.
+   * @return Approximate natural gradient.
+   * @throw std::invalid_argument If the dimensionality or rank of the
+   * gradient does not match this approximation's.
+   */
+  normal_lowrank natural_gradient(const normal_lowrank& grad) const {
+    static const char* function
+        = "stan::variational::normal_lowrank::natural_gradient";
+    stan::math::check_size_match(function, "Dimension of gradient",
+                                 grad.dimension(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Rank of gradient", grad.rank(),
+                                 "Rank of variational q", rank());
+    Eigen::VectorXd mu_grad = B_ * (B_.transpose() * grad.mu());
+    mu_grad.array() += (2 * omega_.array()).exp() * grad.mu().array();
+    return normal_lowrank(mu_grad, Eigen::VectorXd(0.5 * grad.omega()),
+                          grad.B());
+  }
+
+  /**
+   * Write the mean, log standard deviation and factor so that
+   * <code>read_state()</code> can restore them exactly.
+   *
+   * @param[in,out] writer state writer
+   */
+  void write_state(stan::mcmc::state_writer& writer) const {
+    writer.tag("normal_lowrank");
+    writer.write(mu_);
+    writer.write(omega_);
+    writer.write(B_);
+  }
+
+  /**
+   * Restore the mean, log standard deviation and factor written by
+   * <code>write_state()</code>.
+   *
+   * @param[in,out] reader state reader
+   * @throw std::invalid_argument If the state can't be read, was
+   * written by another family, or has another dimensionality or rank.
+   */
+  void read_state(stan::mcmc::state_reader& reader) {
+    static const char* function
+        = "stan::variational::normal_lowrank::read_state";
+    reader.tag("normal_lowrank");
+    Eigen::VectorXd mu, omega;
+    Eigen::MatrixXd B;
+    reader.read(mu);
+    reader.read(omega);
+    reader.read(B);
+    stan::math::check_size_match(function, "Dimension of mean vector",
+                                 mu.size(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Dimension of omega vector",
+                                 omega.size(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Rows of factor", B.rows(),
+                                 "Dimension of variational q", dimension());
+    stan::math::check_size_match(function, "Rank of factor", B.cols(),
+                                 "Rank of variational q", rank());
+    mu_ = mu;
+    omega_ = omega;
+    B_ = B;
+  }
+
+  /**
+   * Return this approximation after setting its mean, log standard
+   * deviation and factor to the values given by the specified
+   * approximation.
+   *
+   * @param[in] rhs Approximation from which to gather the values.
+   * @return This approximation after assignment.
+   * @throw std::domain_error If the dimensionality or rank of the
+   * specified approximation does not match this approximation's.
+   */
+  normal_lowrank& operator=(const normal_lowrank& rhs) {
+    static const char* function
+        = "stan::variational::normal_lowrank::operator=";
+    stan::math::check_size_match(function, "Dimension of lhs", dimension(),
+                                 "Dimension of rhs", rhs.dimension());
+    stan::math::check_size_match(function, "Rank of lhs", rank(),
+                                 "Rank of rhs", rhs.rank());
+    mu_ = rhs.mu();
+    omega_ = rhs.omega();
+    B_ = rhs.B();
+    return *this;
+  }
+
+  /**
+   * Add the mean, log standard deviation and factor of the specified
+   * approximation to this approximation.
+   *
+   * @param[in] rhs Approximation from which to gather the values.
+   * @return This approximation after adding the specified
+   * approximation.
+   * @throw std::domain_error If the dimensionality or rank of the
+   * specified approximation does not match this approximation's.
+   */
+  normal_lowrank& operator+=(const normal_lowrank& rhs) {
+    static const char* function
+        = "stan::variational::normal_lowrank::operator+=";
+    stan::math::check_size_match(function, "Dimension of lhs", dimension(),
+                                 "Dimension of rhs", rhs.dimension());
+    stan::math::check_size_match(function, "Rank of lhs", rank(),
+                                 "Rank of rhs", rhs.rank());
+    mu_ += rhs.mu();
+    omega_ += rhs.omega();
+    B_ += rhs.B();
+    return *this;
+  }
+
+  /**
+   * Return this approximation after elementwise division by the
+   * specified approximation's mean, log standard deviation and factor.
+   *
+   * @param[in] rhs Approximation from which to gather the values.
+   * @return This approximation after elementwise division by the
+   * specified approximation.
+   * @throw std::domain_error If the dimensionality or rank of the
+   * specified approximation does not match this approximation's.
+   */
+  inline normal_lowrank& operator/=(const normal_lowrank& rhs) {
+    static const char* function
+        = "stan::variational::normal_lowrank::operator/=";
+    stan::math::check_size_match(function, "Dimension of lhs", dimension(),
+                                 "Dimension of rhs", rhs.dimension());
+    stan::math::check_size_match(function, "Rank of lhs", rank(),
+                                 "Rank of rhs", rhs.rank());
+    mu_.array() /= rhs.mu().array();
+    omega_.array() /= rhs.omega().array();
+    B_.array() /= rhs.B().array();
+    return *this;
+  }
+
+  /**
+   * Return this approximation after adding the specified scalar
+   * to each entry in the mean, log standard deviation and factor.
+   *
+   * <b>Warning:</b> No finiteness check is made on the scalar, so
+   * it may introduce NaNs.
+   *
+   * @param[in] scalar Scalar to add.
+   * @return This approximation after elementwise addition of the
+   * specified scalar.
+   */
+  normal_lowrank& operator+=(double scalar) {
+    mu_.array() += scalar;
+    omega_.array() += scalar;
+    B_.array() += scalar;
+    return *this;
+  }
+
+  /**
+   * Return this approximation after multiplying by the specified
+   * scalar each entry in the mean, log standard deviation and factor.
+   *
+   * <b>Warning:</b> No finiteness check is made on the scalar, so
+   * it may introduce NaNs.
+   *
+   * @param[in] scalar Scalar to multiply by.
+   * @return This approximation after elementwise multiplication by
+   * the specified scalar.
+   */
+  normal_lowrank& operator*=(double scalar) {
+    mu_ *= scalar;
+    omega_ *= scalar;
+    B_ *= scalar;
+    return *this;
+  }
+
+  /**
+   * Returns the mean vector for this approximation.
+   *
+   * See: <code>mu()</code>.
+   *
+   * @return Mean vector for this approximation.
+   */
+  const Eigen::VectorXd& mean() const { return mu(); }
+
+  /**
+   * Return the entropy of the approximation.
+   *
+   * <p>By the matrix determinant lemma, with D = diag(exp(omega)),
+   *   log det Sigma = 2 * sum(omega) + log det(I + B' * D^-2 * B),
+   * so the entropy
+   *   0.5 * dim * (1+log2pi) + 0.5 * log det Sigma
+   * takes O(dim * rank^2) operations.
+   *
+   * @return Entropy of this approximation.
+   */
+  double entropy() const {
+    Eigen::MatrixXd C = (-omega_).array().exp().matrix().asDiagonal() * B_;
+    Eigen::LLT<Eigen::MatrixXd> llt(capacitance(C));
+    return 0.5 * static_cast<double>(dimension())
+               * (1.0 + stan::math::LOG_TWO_PI)
+           + omega_.sum()
+           + llt.matrixLLT().diagonal().array().log().sum();
+  }
+
+  /**
+   * Return the transform of the specified vector of standard normal
+   * variates using the mean, log standard deviation and factor.
+   *
+   * The transform is defined by
+   * S^{-1}(eta) = mu + exp(omega) * eta_1 + B * eta_2,
+   * where eta_1 holds the first dimension entries of eta and eta_2
+   * the last rank entries.
+   *
+   * @param[in] eta Vector to transform, of size dimension + rank.
+   * @throw std::domain_error If the specified vector's size does
+   * not match the dimensionality plus the rank of this approximation.
+   * @return Transformed vector.
+   */
+  Eigen::VectorXd transform(const Eigen::VectorXd& eta) const {
+    static const char* function
+        = "stan::variational::normal_lowrank::transform";
+    stan::math::check_size_match(function, "Dimension plus rank",
+                                 eta_dimension(), "Dimension of input vector",
+                                 eta.size());
+    stan::math::check_not_nan(function, "Input vector", eta);
+    Eigen::VectorXd zeta = mu_ + B_ * eta.tail(rank());
+    zeta.array() += eta.head(dimension()).array() * omega_.array().exp();
+    return zeta;
+  }
+
+  /**
+   * Assign a draw from this approximation to the specified vector
+   * using the specified random number generator.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] rng Base random number generator.
+   * @param[out] eta Vector to which the draw is assigned; dimension has
+   * to be the same as the dimension of variational q.
+   */
+  template <class BaseRNG>
+  void sample(BaseRNG& rng, Eigen::VectorXd& eta) const {
+    Eigen::VectorXd z(eta_dimension());
+    for (int d = 0; d < z.size(); ++d)
+      z(d) = stan::math::normal_rng(0, 1, rng);
+    eta = transform(z);
+  }
+
+  /**
+   * Draw a posterior sample from this approximation and return its
+   * log density, dropping the terms that don't depend on the draw.
+   *
+   * <p>The log density is -0.5 * r' * Sigma^-1 * r for r = eta - mu,
+   * computed with the Woodbury identity in O(dim * rank) operations
+   * after the factorization of a rank x rank matrix.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] rng Base random number generator.
+   * @param[out] eta Vector to which the draw is assigned; dimension has
+   * to be the same as the dimension of variational q.
+   * @param[out] log_g The log density in the variational approximation;
+   * the constant terms are dropped.
+   */
+  template <class BaseRNG>
+  void sample_log_g(BaseRNG& rng, Eigen::VectorXd& eta, double& log_g) const {
+    sample(rng, eta);
+    Eigen::VectorXd inv_sigma = (-omega_).array().exp();
+    Eigen::VectorXd r = inv_sigma.cwiseProduct(eta - mu_);
+    Eigen::MatrixXd C = inv_sigma.asDiagonal() * B_;
+    Eigen::LLT<Eigen::MatrixXd> llt(capacitance(C));
+    Eigen::VectorXd Ctr = C.transpose() * r;
+    log_g = -0.5 * (r.squaredNorm() - Ctr.dot(llt.solve(Ctr)));
+  }
+
+  /**
+   * Draw the specified number of posterior samples from the
+   * approximation into the columns of a matrix, and return their log
+   * densities with the constants dropped, using one product with the
+   * factor for the whole batch. The standard normal variates are drawn
+   * in the same order as by successive calls to the single draw
+   * <code>sample_log_g()</code>.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] rng Base random number generator.
+   * @param[in] n Number of draws.
+   * @param[out] draws Draws, one per column.
+   * @param[out] log_g Log densities of the draws in the variational
+   * approximation; the constant terms are dropped.
+   */
+  template <class BaseRNG>
+  void sample_log_g(BaseRNG& rng, int n, Eigen::MatrixXd& draws,
+                    Eigen::VectorXd& log_g) const {
+    Eigen::MatrixXd eta(eta_dimension(), n);
+    for (int j = 0; j < n; ++j)
+      for (int d = 0; d < eta.rows(); ++d)
+        eta(d, j) = stan::math::normal_rng(0, 1, rng);
+    Eigen::VectorXd inv_sigma = (-omega_).array().exp();
+    Eigen::MatrixXd C = inv_sigma.asDiagonal() * B_;
+    Eigen::LLT<Eigen::MatrixXd> llt(capacitance(C));
+    // D^-1 * (draws - mu) = eta_1 + C * eta_2
+    Eigen::MatrixXd R = eta.topRows(dimension());
+    R.noalias() += C * eta.bottomRows(rank());
+    Eigen::MatrixXd CtR = C.transpose() * R;
+    log_g = -0.5
+            * (R.colwise().squaredNorm()
+               - CtR.cwiseProduct(llt.solve(CtR)).colwise().sum())
+                  .transpose();
+    draws = omega_.array().exp().matrix().asDiagonal() * R;
+    draws.colwise() += mu_;
+  }
+
+  /**
+   * Calculates the "blackbox" gradient with respect to the location
+   * vector (mu), the log-std vector (omega) and the factor (B).  It
+   * uses the same gradient computed from a set of Monte Carlo samples.
+   *
+   * <p>With G the model gradients of a batch of draws as columns, the
+   * factor gradient is accumulated as the single product G * eta_2',
+   * and the entropy gradients, Sigma^-1 * B for the factor and
+   * exp(2 * omega) * diag(Sigma^-1) for the log standard deviation,
+   * come from the Woodbury identity, so the cost is O(dim * rank) per
+   * draw and O(dim * rank^2) per call.
+   *
+   * @tparam M Model class.
+   * @tparam BaseRNG Class of base random number generator.
+   * @param[in] elbo_grad Parameters to store "blackbox" gradient
+   * @param[in] m Model.
+   * @param[in] cont_params Continuous parameters.
+   * @param[in] n_monte_carlo_grad Number of samples for gradient
+   * computation.
+   * @param[in,out] rng Random number generator.
+   * @param[in,out] logger logger for messages
+   * @param[in] stick_the_landing whether to drop the score function
+   * term, whose expectation is zero, from the gradient of the entropy
+   * instead of using its exact gradient, which lowers the variance as
+   * the approximation approaches the posterior
+   * @param[in] antithetic whether to make the draws in antithetic pairs
+   * eta and -eta
+   * @throw std::domain_error If the number of divergent
+   * iterations exceeds its specified bounds.
+   */
+  template <class M, class BaseRNG>
+  void calc_grad(normal_lowrank& elbo_grad, M& m, Eigen::VectorXd& cont_params,
+                 int n_monte_carlo_grad, BaseRNG& rng,
+                 callbacks::logger& logger, bool stick_the_landing = false,
+                 bool antithetic = false) const {
+    static const char* function
+        = "stan::variational::normal_lowrank::calc_grad";
+
+    stan::math::check_size_match(function, "Dimension of elbo_grad",
+                                 elbo_grad.dimension(),
+                                 "Dimension of variational q", dimension());
+    stan::math::check_size_match(function, "Rank of elbo_grad",
+                                 elbo_grad.rank(), "Rank of variational q",
+                                 rank());
+    stan::math::check_size_match(function, "Dimension of variational q",
+                                 dimension(), "Dimension of variables in model",
+                                 cont_params.size());
+
+    Eigen::VectorXd mu_grad = Eigen::VectorXd::Zero(dimension());
+    Eigen::VectorXd omega_grad = Eigen::VectorXd::Zero(dimension());
+    Eigen::MatrixXd B_grad = Eigen::MatrixXd::Zero(dimension(), rank());
+    Eigen::VectorXd tmp_lp;
+    Eigen::MatrixXd tmp_mu_grad;
+    Eigen::MatrixXd eta;
+    Eigen::MatrixXd zeta;
+
+    // With C = D^-1 * B and M = I + C' * C,
+    // Sigma^-1 = D^-1 * (I - C * M^-1 * C') * D^-1
+    Eigen::VectorXd inv_sigma = (-omega_).array().exp();
+    Eigen::MatrixXd C = inv_sigma.asDiagonal() * B_;
+    Eigen::LLT<Eigen::MatrixXd> llt(capacitance(C));
+
+    // Naive Monte Carlo integration. The draws still missing are
+    // evaluated as one batch and failed evaluations are redrawn in the
+    // next batch
+    static const int n_retries = 10;
+    for (int i = 0, n_monte_carlo_drop = 0; i < n_monte_carlo_grad;) {
+      // Draw from standard normal and transform to real-coordinate space
+      int n_batch = n_monte_carlo_grad - i;
+      eta.resize(eta_dimension(), n_batch);
+      zeta.resize(dimension(), n_batch);
+      for (int j = 0; j < n_batch; ++j) {
+        if (antithetic && j % 2 == 1) {
+          eta.col(j) = -eta.col(j - 1);
+        } else {
+          for (int d = 0; d < eta.rows(); ++d)
+            eta(d, j) = stan::math::normal_rng(0, 1, rng);
+        }
+        zeta.col(j) = transform(eta.col(j));
+      }
+      std::stringstream ss;
+      stan::model::log_prob_grad<true, true>(m, zeta, tmp_lp, tmp_mu_grad,
+                                             true, &ss);
+      if (ss.str().length() > 0)
+        logger.info(ss);
+      // Move the finite gradients to the front, so each batch adds in
+      // with one product
+      int n_ok = 0;
+      for (int j = 0; j < n_batch; ++j) {
+        if (tmp_mu_grad.col(j).allFinite()) {
+          if (n_ok != j) {
+            tmp_mu_grad.col(n_ok) = tmp_mu_grad.col(j);
+            eta.col(n_ok) = eta.col(j);
+          }
+          ++n_ok;
+        } else {
+          ++n_monte_carlo_drop;
+          if (n_monte_carlo_drop >= n_retries * n_monte_carlo_grad) {
+            const char* name = "The number of dropped evaluations";
+            const char* msg1 = "has reached its maximum amount (";
+            int y = n_retries * n_monte_carlo_grad;
+            const char* msg2
+                = "). Your model may be either severely "
+                  "ill-conditioned or misspecified.";
+            stan::math::throw_domain_error(function, name, y, msg1, msg2);
+          }
+        }
+      }
+      // The gradients of log q at the draws, -Sigma^-1 * (zeta - mu),
+      // are subtracted to stick the landing, with
+      // D^-1 * (zeta - mu) = eta_1 + C * eta_2
+      if (stick_the_landing) {
+        Eigen::MatrixXd W = eta.topLeftCorner(dimension(), n_ok);
+        W.noalias() += C * eta.bottomLeftCorner(rank(), n_ok);
+        W -= C * llt.solve(C.transpose() * W);
+        tmp_mu_grad.leftCols(n_ok) += inv_sigma.asDiagonal() * W;
+      }
+      const Eigen::VectorXd zero = Eigen::VectorXd::Zero(dimension());
+      mu_grad += sum_over_draws(n_ok, zero, [&](int begin, int end) {
+        return Eigen::VectorXd(
+            tmp_mu_grad.middleCols(begin, end - begin).rowwise().sum());
+      });
+      omega_grad += sum_over_draws(n_ok, zero, [&](int begin, int end) {
+        return Eigen::VectorXd(
+            tmp_mu_grad.middleCols(begin, end - begin)
+                .cwiseProduct(eta.block(0, begin, dimension(), end - begin))
+                .rowwise()
+                .sum());
+      });
+      B_grad += sum_over_draws(
+          n_ok, Eigen::MatrixXd::Zero(dimension(), rank()).eval(),
+          [&](int begin, int end) {
+            return Eigen::MatrixXd(
+                tmp_mu_grad.middleCols(begin, end - begin)
+                * eta.block(dimension(), begin, rank(), end - begin)
+                      .transpose());
+          });
+      i += n_ok;
+    }
+    mu_grad /= static_cast<double>(n_monte_carlo_grad);
+    omega_grad /= static_cast<double>(n_monte_carlo_grad);
+    B_grad /= static_cast<double>(n_monte_carlo_grad);
+
+    omega_grad.array() = omega_grad.array().cwiseProduct(omega_.array().exp());
+
+    // Add the entropy gradients,
+    // Sigma^-1 * B = D^-1 * C * M^-1 and
+    // exp(2 * omega) * diag(Sigma^-1) = 1 - diag(C * M^-1 * C')
+    if (!stick_the_landing) {
+      Eigen::MatrixXd CMinv = llt.solve(C.transpose()).transpose();
+      omega_grad.array()
+          += 1.0 - CMinv.cwiseProduct(C).rowwise().sum().array();
+      B_grad += inv_sigma.asDiagonal() * CMinv;
+    }
+
+    elbo_grad.set_mu(mu_grad);
+    elbo_grad.set_omega(omega_grad);
+    elbo_grad.set_B(B_grad);
+  }
+};
+
+/**
+ * Return a new approximation resulting from adding the mean, log
+ * standard deviation and factor of the specified approximations.
+ *
+ * @param[in] lhs First approximation.
+ * @param[in] rhs Second approximation.
+ * @return Sum of the specified approximations.
+ * @throw std::domain_error If the dimensionalities or ranks do not match.
+ */
+inline normal_lowrank operator+(normal_lowrank lhs, const normal_lowrank& rhs) {
+  return lhs += rhs;
+}
+
+/**
+ * Return a new approximation resulting from elementwise division of
+ * of the first specified approximation by the second.
+ *
+ * @param[in] lhs First approximation.
+ * @param[in] rhs Second approximation.
+ * @return Elementwise division of the specified approximations.
+ * @throw std::domain_error If the dimensionalities or ranks do not match.
+ */
+inline normal_lowrank operator/(normal_lowrank lhs, const normal_lowrank& rhs) {
+  return lhs /= rhs;
+}
+
+/**
+ * Return a new approximation resulting from elementwise addition
+ * of the specified scalar to the mean, log standard deviation and
+ * factor entries of the specified approximation.
+ *
+ * @param[in] scalar Scalar value
+ * @param[in] rhs Approximation.
+ * @return Addition of scalar to specified approximation.
+ */
+inline normal_lowrank operator+(double scalar, normal_lowrank rhs) {
+  return rhs += scalar;
+}
+
+/**
+ * Return a new approximation resulting from elementwise
+ * multiplication of the specified scalar to the mean, log standard
+ * deviation and factor entries of the specified approximation.
+ *
+ * @param[in] scalar Scalar value
+ * @param[in] rhs Approximation.
+ * @return Multiplication of scalar by the specified approximation.
+ */
+inline normal_lowrank operator*(double scalar, normal_lowrank rhs) {
+  return rhs *= scalar;
+}
+
+}  // namespace variational
+}  // namespace stan
+#endif
@@ -3,7 +3,8 @@
 
 #include <stan/callbacks/logger.hpp>
 #include <stan/math/prim.hpp>
-#include <stan/model/gradient.hpp>
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/model/log_prob_grad.hpp>
 #include <stan/variational/base_family.hpp>
 #include <algorithm>
 #include <ostream>
@@ -167,6 +168,68 @@ class normal_meanfield : public base_family {
                             Eigen::VectorXd(omega_.array().sqrt()));
   }
 
+  /**
+   * Return the natural gradient corresponding to the specified
+   * gradient with respect to the mean and log standard deviation,
+   * preconditioned by the inverse Fisher information of this
+   * approximation.  The Fisher information is diagonal, with
+   * entries 1 / sigma^2 for the mean and 2 for the log standard
+   * deviation, so the natural gradient is exact.
+   *
+   * @param[in] grad Gradient with respect to this approximation's
+   * parameters.
+   * @return Natural gradient.
+   * @throw std::invalid_argument If the dimensionality of the
+   * gradient does not match this approximation's dimensionality.
+   */
+  normal_meanfield natural_gradient(const normal_meanfield& grad) const {
+    static const char* function
+        = "stan::variational::normal_meanfield::natural_gradient";
+    stan::math::check_size_match(function, "Dimension of gradient",
+                                 grad.dimension(), "Dimension of variational q",
+                                 dimension());
+    return normal_meanfield(
+        Eigen::VectorXd(grad.mu().array() * (2 * omega_.array()).exp()),
+        Eigen::VectorXd(0.5 * grad.omega()));
+  }
+
+  /**
+   * Write the mean and log standard deviation vectors so that
+   * <code>read_state()</code> can restore them exactly.
+   *
+   * @param[in,out] writer state writer
+   */
+  void write_state(stan::mcmc::state_writer& writer) const {
+    writer.tag("normal_meanfield");
+    writer.write(mu_);
+    writer.write(omega_);
+  }
+
+  /**
+   * Restore the mean and log standard deviation vectors written by
+   * <code>write_state()</code>.
+   *
+   * @param[in,out] reader state reader
+   * @throw std::invalid_argument If the state can't be read, was
+   * written by another family, or has another dimensionality.
+   */
+  void read_state(stan::mcmc::state_reader& reader) {
+    static const char* function
+        = "stan::variational::normal_meanfield::read_state";
+    reader.tag("normal_meanfield");
+    Eigen::VectorXd mu, omega;
+    reader.read(mu);
+    reader.read(omega);
+    stan::math::check_size_match(function, "Dimension of mean vector",
+                                 mu.size(), "Dimension of variational q",
+                                 dimension());
+    stan::math::check_size_match(function, "Dimension of omega vector",
+                                 omega.size(), "Dimension of variational q",
+                                 dimension());
+    mu_ = mu;
+    omega_ = omega;
+  }
+
   /**
    * Return this approximation after setting its mean vector and
    * Cholesky factor for covariance to the values given by the
@@ -314,6 +377,35 @@ class normal_meanfield : public base_family {
     return eta.array().cwiseProduct(omega_.array().exp()) + mu_.array();
   }
 
+  using base_family::sample_log_g;
+
+  /**
+   * Draw the specified number of posterior samples from the
+   * approximation into the columns of a matrix, and return their log
+   * densities with the constants dropped, using one elementwise product for the
+   * whole batch. The standard normal variates are drawn in the same
+   * order as by successive calls to the single draw
+   * <code>sample_log_g()</code>.
+   *
+   * @tparam BaseRNG Class of random number generator.
+   * @param[in] rng Base random number generator.
+   * @param[in] n Number of draws.
+   * @param[out] draws Draws, one per column.
+   * @param[out] log_g Log densities of the draws in the variational
+   * approximation; the constant terms are dropped.
+   */
+  template <class BaseRNG>
+  void sample_log_g(BaseRNG& rng, int n, Eigen::MatrixXd& draws,
+                    Eigen::VectorXd& log_g) const {
+    draws.resize(dimension(), n);
+    for (int j = 0; j < n; ++j)
+      for (int d = 0; d < dimension(); ++d)
+        draws(d, j) = stan::math::normal_rng(0, 1, rng);
+    log_g = -0.5 * draws.colwise().squaredNorm().transpose();
+    draws.array().colwise() *= omega_.array().exp();
+    draws.colwise() += mu_;
+  }
+
   /**
    * Calculates the "blackbox" gradient with respect to both the
    * location vector (mu) and the log-std vector (omega) in
@@ -329,13 +421,21 @@ class normal_meanfield : public base_family {
    * computation.
    * @param[in,out] rng Random number generator.
    * @param[in,out] logger logger for messages
+   * @param[in] stick_the_landing whether to drop the score function
+   * term, whose expectation is zero, from the gradient of the entropy
+   * instead of using its exact gradient, which lowers the variance as
+   * the approximation approaches the posterior
+   * @param[in] antithetic whether to make the draws in antithetic pairs
+   * eta and -eta
    * @throw std::domain_error If the number of divergent
    * iterations exceeds its specified bounds.
    */
   template <class M, class BaseRNG>
   void calc_grad(normal_meanfield& elbo_grad, M& m,
                  Eigen::VectorXd& cont_params, int n_monte_carlo_grad,
-                 BaseRNG& rng, callbacks::logger& logger) const {
+                 BaseRNG& rng, callbacks::logger& logger,
+                 bool stick_the_landing = false,
+                 bool antithetic = false) const {
     static const char* function
         = "stan::variational::normal_meanfield::calc_grad";
 
@@ -348,46 +448,82 @@ class normal_meanfield : public base_family {
 
     Eigen::VectorXd mu_grad = Eigen::VectorXd::Zero(dimension());
     Eigen::VectorXd omega_grad = Eigen::VectorXd::Zero(dimension());
-    double tmp_lp = 0.0;
-    Eigen::VectorXd tmp_mu_grad = Eigen::VectorXd::Zero(dimension());
-    Eigen::VectorXd eta = Eigen::VectorXd::Zero(dimension());
-    Eigen::VectorXd zeta = Eigen::VectorXd::Zero(dimension());
-
-    // Naive Monte Carlo integration
+    Eigen::VectorXd tmp_lp;
+    Eigen::MatrixXd tmp_mu_grad;
+    Eigen::MatrixXd eta;
+    Eigen::MatrixXd zeta;
+
+    // Naive Monte Carlo integration. The draws still missing are
+    // evaluated as one batch, spread over threads when available, and
+    // failed evaluations are redrawn in the next batch
     static const int n_retries = 10;
     for (int i = 0, n_monte_carlo_drop = 0; i < n_monte_carlo_grad;) {
       // Draw from standard normal and transform to real-coordinate space
-      for (int d = 0; d < dimension(); ++d)
-        eta(d) = stan::math::normal_rng(0, 1, rng);
-      zeta = transform(eta);
-      try {
-        std::stringstream ss;
-        stan::model::gradient(m, zeta, tmp_lp, tmp_mu_grad, &ss);
-        if (ss.str().length() > 0)
-          logger.info(ss);
-        stan::math::check_finite(function, "Gradient of mu", tmp_mu_grad);
-        mu_grad += tmp_mu_grad;
-        omega_grad.array() += tmp_mu_grad.array().cwiseProduct(eta.array());
-        ++i;
-      } catch (const std::exception& e) {
-        ++n_monte_carlo_drop;
-        if (n_monte_carlo_drop >= n_retries * n_monte_carlo_grad) {
-          const char* name = "The number of dropped evaluations";
-          const char* msg1 = "has reached its maximum amount (";
-          int y = n_retries * n_monte_carlo_grad;
-          const char* msg2
-              = "). Your model may be either severely "
-                "ill-conditioned or misspecified.";
-          stan::math::throw_domain_error(function, name, y, msg1, msg2);
+      int n_batch = n_monte_carlo_grad - i;
+      eta.resize(dimension(), n_batch);
+      zeta.resize(dimension(), n_batch);
+      for (int j = 0; j < n_batch; ++j) {
+        if (antithetic && j % 2 == 1) {
+          eta.col(j) = -eta.col(j - 1);
+        } else {
+          for (int d = 0; d < dimension(); ++d)
+            eta(d, j) = stan::math::normal_rng(0, 1, rng);
+        }
+        zeta.col(j) = transform(eta.col(j));
+      }
+      std::stringstream ss;
+      stan::model::log_prob_grad<true, true>(m, zeta, tmp_lp, tmp_mu_grad,
+                                             true, &ss);
+      if (ss.str().length() > 0)
+        logger.info(ss);
+      // Move the successful draws to the leading columns
+      int n_ok = 0;
+      for (int j = 0; j < n_batch; ++j) {
+        if (tmp_mu_grad.col(j).allFinite()) {
+          if (n_ok != j) {
+            tmp_mu_grad.col(n_ok) = tmp_mu_grad.col(j);
+            eta.col(n_ok) = eta.col(j);
+          }
+          ++n_ok;
+          ++i;
+        } else {
+          ++n_monte_carlo_drop;
+          if (n_monte_carlo_drop >= n_retries * n_monte_carlo_grad) {
+            const char* name = "The number of dropped evaluations";
+            const char* msg1 = "has reached its maximum amount (";
+            int y = n_retries * n_monte_carlo_grad;
+            const char* msg2
+                = "). Your model may be either severely "
+                  "ill-conditioned or misspecified.";
+            stan::math::throw_domain_error(function, name, y, msg1, msg2);
+          }
         }
       }
+      // The gradients of log q at the draws, -eta / sigma, are
+      // subtracted to stick the landing
+      if (stick_the_landing)
+        tmp_mu_grad.leftCols(n_ok).array()
+            += eta.leftCols(n_ok).array().colwise() * (-omega_).array().exp();
+      const Eigen::VectorXd zero = Eigen::VectorXd::Zero(dimension());
+      mu_grad += sum_over_draws(n_ok, zero, [&](int begin, int end) {
+        return Eigen::VectorXd(
+            tmp_mu_grad.middleCols(begin, end - begin).rowwise().sum());
+      });
+      omega_grad += sum_over_draws(n_ok, zero, [&](int begin, int end) {
+        return Eigen::VectorXd(
+            tmp_mu_grad.middleCols(begin, end - begin)
+                .cwiseProduct(eta.middleCols(begin, end - begin))
+                .rowwise()
+                .sum());
+      });
     }
     mu_grad /= static_cast<double>(n_monte_carlo_grad);
     omega_grad /= static_cast<double>(n_monte_carlo_grad);
 
     omega_grad.array() = omega_grad.array().cwiseProduct(omega_.array().exp());
 
-    omega_grad.array() += 1.0;  // add entropy gradient (unit)
+    if (!stick_the_landing)
+      omega_grad.array() += 1.0;  // add entropy gradient (unit)
 
     elbo_grad.set_mu(mu_grad);
     elbo_grad.set_omega(omega_grad);
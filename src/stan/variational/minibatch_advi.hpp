@@ -0,0 +1,109 @@
+#ifndef STAN_VARIATIONAL_MINIBATCH_ADVI_HPP
+#define STAN_VARIATIONAL_MINIBATCH_ADVI_HPP
+
+#include <stan/math/prim.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/model/draw_rows.hpp>
+#include <stan/model/rows_model.hpp>
+#include <stan/variational/advi.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace stan {
+
+namespace variational {
+
+/**
+ * Automatic Differentiation Variational Inference with gradients
+ * estimated from mini-batches of the data.
+ *
+ * Every gradient of the ELBO evaluates the model on a batch of rows
+ * drawn without replacement, with their log likelihood scaled up to
+ * the full data, so an iteration costs time proportional to the batch
+ * size rather than to the number of rows. The ELBO, used for eta
+ * adaptation and for assessing convergence, and the posterior draws
+ * are still evaluated on all rows. The model must provide
+ * <code>log_prob_rows()</code> and <code>num_rows()</code> as
+ * described by <code>stan::model::rows_model</code>.
+ *
+ * @tparam Model class of model
+ * @tparam Q class of variational distribution
+ * @tparam BaseRNG class of random number generator
+ */
+template <class Model, class Q, class BaseRNG>
+class minibatch_advi : public advi<Model, Q, BaseRNG> {
+ public:
+  /**
+   * Constructor
+   *
+   * @param[in] m stan model
+   * @param[in] cont_params initialization of continuous parameters
+   * @param[in,out] rng random number generator
+   * @param[in] batch_size number of rows of data per gradient, which
+   * is capped at the number of rows
+   * @param[in] n_monte_carlo_grad number of samples for gradient computation
+   * @param[in] n_monte_carlo_elbo number of samples for ELBO computation
+   * @param[in] eval_elbo evaluate ELBO at every "eval_elbo" iters
+   * @param[in] n_posterior_samples number of samples to draw from posterior
+   * @throw std::domain_error if batch_size is not positive
+   * @throw std::domain_error if the model has no rows of data
+   * @throw std::runtime_error if n_monte_carlo_grad is not positive
+   * @throw std::runtime_error if n_monte_carlo_elbo is not positive
+   * @throw std::runtime_error if eval_elbo is not positive
+   * @throw std::runtime_error if n_posterior_samples is not positive
+   */
+  minibatch_advi(Model& m, Eigen::VectorXd& cont_params, BaseRNG& rng,
+                 int batch_size, int n_monte_carlo_grad,
+                 int n_monte_carlo_elbo, int eval_elbo,
+                 int n_posterior_samples)
+      : advi<Model, Q, BaseRNG>(m, cont_params, rng, n_monte_carlo_grad,
+                                n_monte_carlo_elbo, eval_elbo,
+                                n_posterior_samples),
+        num_rows_(m.num_rows()) {
+    static const char* function = "stan::variational::minibatch_advi";
+    math::check_positive(function, "Batch size", batch_size);
+    math::check_positive(function, "Number of rows of data", num_rows_);
+    batch_size_ = std::min<size_t>(batch_size, num_rows_);
+  }
+
+  using advi<Model, Q, BaseRNG>::calc_ELBO_grad;
+
+  /**
+   * Return the number of rows of data per gradient.
+   */
+  size_t batch_size() const { return batch_size_; }
+
+  /**
+   * Draw a batch of distinct rows uniformly at random with Floyd's
+   * algorithm, in time proportional to the batch size, and return them
+   * in increasing order.
+   *
+   * @param[in,out] rng random number generator
+   * @return indices of the rows
+   */
+  std::vector<size_t> draw_rows(BaseRNG& rng) const {
+    return stan::model::draw_rows(num_rows_, batch_size_, rng);
+  }
+
+ protected:
+  /**
+   * Calculates the gradient of the ELBO from a batch of rows drawn
+   * with the specified random number generator.
+   */
+  void calc_ELBO_grad(const Q& variational, Q& elbo_grad, BaseRNG& rng,
+                      callbacks::logger& logger) const override {
+    std::vector<size_t> rows = draw_rows(rng);
+    stan::model::rows_model<Model> batch(this->model_, rows);
+    variational.calc_grad(elbo_grad, batch, this->cont_params_,
+                          this->n_monte_carlo_grad_, rng, logger,
+                          this->stick_the_landing_,
+                          this->antithetic_grad_draws_);
+  }
+
+  size_t num_rows_;
+  size_t batch_size_;
+};
+}  // namespace variational
+}  // namespace stan
+#endif
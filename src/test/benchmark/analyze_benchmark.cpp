@@ -0,0 +1,68 @@
+/**
+ * Microbenchmarks of the convergence diagnostics: the autocovariance
+ * of a single chain, with and without a reused engine, and the
+ * effective sample size of four chains, for increasing numbers of
+ * draws.
+ */
+#include <test/benchmark/utility.hpp>
+#include <stan/analyze/mcmc/autocovariance.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using stan::test::benchmark::normal_draws;
+
+static void autocovariance(benchmark::State& state) {
+  Eigen::VectorXd y = normal_draws(state.range(0), 1).col(0);
+  Eigen::VectorXd acov;
+  for (auto _ : state) {
+    stan::analyze::autocovariance<double>(y, acov);
+    benchmark::DoNotOptimize(acov.data());
+  }
+  state.SetItemsProcessed(state.iterations() * y.size());
+}
+BENCHMARK(autocovariance)->RangeMultiplier(10)->Range(100, 100000);
+
+static void autocovariance_engine(benchmark::State& state) {
+  Eigen::VectorXd y = normal_draws(state.range(0), 1).col(0);
+  Eigen::VectorXd acov;
+  stan::analyze::autocovariance_engine<double> engine;
+  for (auto _ : state) {
+    engine(y, acov);
+    benchmark::DoNotOptimize(acov.data());
+  }
+  state.SetItemsProcessed(state.iterations() * y.size());
+}
+BENCHMARK(autocovariance_engine)->RangeMultiplier(10)->Range(100, 100000);
+
+static void effective_sample_size(benchmark::State& state) {
+  const int num_chains = 4;
+  Eigen::MatrixXd chains = normal_draws(state.range(0), num_chains);
+  std::vector<const double*> draws(num_chains);
+  std::vector<size_t> sizes(num_chains, chains.rows());
+  for (int chain = 0; chain < num_chains; ++chain)
+    draws[chain] = chains.col(chain).data();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        stan::analyze::compute_effective_sample_size(draws, sizes));
+  state.SetItemsProcessed(state.iterations() * chains.size());
+}
+BENCHMARK(effective_sample_size)->RangeMultiplier(10)->Range(100, 100000);
+
+static void split_effective_sample_size(benchmark::State& state) {
+  const int num_chains = 4;
+  Eigen::MatrixXd chains = normal_draws(state.range(0), num_chains);
+  std::vector<const double*> draws(num_chains);
+  std::vector<size_t> sizes(num_chains, chains.rows());
+  for (int chain = 0; chain < num_chains; ++chain)
+    draws[chain] = chains.col(chain).data();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        stan::analyze::compute_split_effective_sample_size(draws, sizes));
+  state.SetItemsProcessed(state.iterations() * chains.size());
+}
+BENCHMARK(split_effective_sample_size)
+    ->RangeMultiplier(10)
+    ->Range(100, 100000);
+
+BENCHMARK_MAIN();
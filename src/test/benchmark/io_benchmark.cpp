@@ -0,0 +1,101 @@
+/**
+ * Microbenchmarks of output and input: writing draws with
+ * stream_writer, parsing Stan csv output, and parsing data in the
+ * dump format, for increasing numbers of columns or values.
+ */
+#include <test/benchmark/utility.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <stan/io/dump.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using stan::test::benchmark::normal_draws;
+
+namespace {
+const int num_draws = 1000;
+
+std::vector<std::string> column_names(int num_cols) {
+  std::vector<std::string> names{"lp__", "accept_stat__"};
+  for (int i = 1; i <= num_cols; ++i)
+    names.push_back("x." + std::to_string(i));
+  return names;
+}
+
+/**
+ * Return Stan csv output of standard normal draws, with the draws
+ * written by stream_writer.
+ */
+std::string csv_output(int num_cols) {
+  Eigen::MatrixXd draws = normal_draws(num_draws, num_cols + 2);
+  std::stringstream out;
+  stan::callbacks::stream_writer writer(out, "# ");
+  writer("model = benchmark");
+  writer(column_names(num_cols));
+  std::vector<double> draw(draws.cols());
+  for (int n = 0; n < num_draws; ++n) {
+    Eigen::VectorXd::Map(draw.data(), draw.size()) = draws.row(n);
+    writer(draw);
+  }
+  return out.str();
+}
+}  // namespace
+
+static void stream_writer_draws(benchmark::State& state) {
+  int num_cols = state.range(0);
+  Eigen::MatrixXd draws = normal_draws(num_draws, num_cols);
+  std::vector<std::vector<double>> rows(num_draws,
+                                        std::vector<double>(num_cols));
+  for (int n = 0; n < num_draws; ++n)
+    for (int i = 0; i < num_cols; ++i)
+      rows[n][i] = draws(n, i);
+  std::stringstream out;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    out.str("");
+    stan::callbacks::stream_writer writer(out);
+    for (const std::vector<double>& row : rows)
+      writer(row);
+    bytes += out.tellp();
+  }
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * num_draws);
+}
+BENCHMARK(stream_writer_draws)->RangeMultiplier(10)->Range(10, 1000);
+
+static void stan_csv_reader_parse(benchmark::State& state) {
+  std::string csv = csv_output(state.range(0));
+  for (auto _ : state) {
+    std::stringstream in(csv);
+    stan::io::stan_csv parsed = stan::io::stan_csv_reader::parse(in, nullptr);
+    benchmark::DoNotOptimize(parsed.samples.data());
+  }
+  state.SetBytesProcessed(state.iterations() * csv.size());
+}
+BENCHMARK(stan_csv_reader_parse)->RangeMultiplier(10)->Range(10, 1000);
+
+static void dump_parse(benchmark::State& state) {
+  int size = state.range(0);
+  Eigen::MatrixXd values = normal_draws(size, 2);
+  std::stringstream data;
+  data.precision(17);
+  data << "N <- " << size << "\ny <- c(";
+  for (int i = 0; i < size; ++i)
+    data << (i ? ", " : "") << values(i, 0);
+  data << ")\nX <- structure(c(";
+  for (int i = 0; i < size; ++i)
+    data << (i ? ", " : "") << values(i, 1);
+  data << "), .Dim = c(" << size << ", 1))\n";
+  std::string text = data.str();
+  for (auto _ : state) {
+    std::stringstream in(text);
+    stan::io::dump context(in);
+    benchmark::DoNotOptimize(context.contains_r("X"));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(dump_parse)->RangeMultiplier(10)->Range(10, 100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,97 @@
+/**
+ * Microbenchmarks of the sampler: a single explicit leapfrog step for
+ * each Euclidean metric, and a whole NUTS transition for each
+ * Euclidean metric, on standard normal and anisotropic normal targets
+ * of increasing dimension.
+ */
+#include <test/benchmark/utility.hpp>
+#include <test/test-models/performance/scaled_normal.hpp>
+#include <test/test-models/performance/std_normal.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/unit_e_metric.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/nuts/dense_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/unit_e_nuts.hpp>
+#include <benchmark/benchmark.h>
+
+using stan::test::benchmark::make_model;
+using stan::test::benchmark::rng_t;
+typedef std_normal_model_namespace::std_normal_model std_normal;
+typedef scaled_normal_model_namespace::scaled_normal_model scaled_normal;
+
+template <class Metric>
+static void expl_leapfrog_evolve(benchmark::State& state) {
+  int N = state.range(0);
+  auto model = make_model<std_normal>(N);
+  stan::callbacks::logger logger;
+  Metric metric(*model);
+  stan::mcmc::expl_leapfrog<Metric> integrator;
+  typename Metric::PointType z(N);
+  z.q.setConstant(0.5);
+  z.p.setConstant(-0.5);
+  metric.init(z, logger);
+  for (auto _ : state) {
+    integrator.evolve(z, metric, 0.1, logger);
+    benchmark::DoNotOptimize(z.q.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(expl_leapfrog_evolve,
+                   stan::mcmc::unit_e_metric<std_normal, rng_t>)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+BENCHMARK_TEMPLATE(expl_leapfrog_evolve,
+                   stan::mcmc::diag_e_metric<std_normal, rng_t>)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+BENCHMARK_TEMPLATE(expl_leapfrog_evolve,
+                   stan::mcmc::dense_e_metric<std_normal, rng_t>)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+
+/**
+ * Time NUTS transitions from a fixed seed, starting from the step size
+ * found by init_stepsize(), so the trajectories and their lengths are
+ * the same from run to run of the benchmark.
+ */
+template <class Sampler, class Model>
+static void nuts_transition(benchmark::State& state) {
+  int N = state.range(0);
+  auto model = make_model<Model>(N);
+  stan::callbacks::logger logger;
+  rng_t rng(1234);
+  Sampler sampler(*model, rng);
+  Eigen::VectorXd q = Eigen::VectorXd::Constant(N, 0.1);
+  sampler.z().q = q;
+  sampler.init_stepsize(logger);
+  stan::mcmc::sample s(q, 0, 0);
+  for (auto _ : state) {
+    s = sampler.transition(s, logger);
+    benchmark::DoNotOptimize(s.cont_params().data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(nuts_transition, stan::mcmc::unit_e_nuts<std_normal, rng_t>,
+                   std_normal)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+BENCHMARK_TEMPLATE(nuts_transition,
+                   stan::mcmc::unit_e_nuts<scaled_normal, rng_t>,
+                   scaled_normal)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+BENCHMARK_TEMPLATE(nuts_transition,
+                   stan::mcmc::diag_e_nuts<scaled_normal, rng_t>,
+                   scaled_normal)
+    ->RangeMultiplier(10)
+    ->Range(10, 1000);
+BENCHMARK_TEMPLATE(nuts_transition,
+                   stan::mcmc::dense_e_nuts<scaled_normal, rng_t>,
+                   scaled_normal)
+    ->RangeMultiplier(10)
+    ->Range(10, 100);
+
+BENCHMARK_MAIN();
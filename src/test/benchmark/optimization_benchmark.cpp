@@ -0,0 +1,34 @@
+/**
+ * Microbenchmarks of the quasi-Newton updates: the L-BFGS search
+ * direction with a full history, for increasing dimensions.
+ */
+#include <test/benchmark/utility.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <benchmark/benchmark.h>
+
+using stan::test::benchmark::normal_draws;
+
+static void lbfgs_search_direction(benchmark::State& state) {
+  int N = state.range(0);
+  const int history_size = 5;
+  Eigen::MatrixXd steps = normal_draws(N, 2 * history_size + 1);
+  stan::optimization::LBFGSUpdate<> update(history_size);
+  // Updates of a quadratic with a positive diagonal Hessian, so that
+  // every update has positive curvature
+  Eigen::VectorXd hessian = steps.col(0).array().abs() + 1;
+  for (int k = 1; k <= 2 * history_size; ++k) {
+    Eigen::VectorXd sk = steps.col(k);
+    Eigen::VectorXd yk = hessian.cwiseProduct(sk);
+    update.update(yk, sk, k == 1);
+  }
+  Eigen::VectorXd gk = steps.col(0);
+  Eigen::VectorXd pk(N);
+  for (auto _ : state) {
+    update.search_direction(pk, gk);
+    benchmark::DoNotOptimize(pk.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(lbfgs_search_direction)->RangeMultiplier(10)->Range(10, 100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,211 @@
+/**
+ * Scaling study of adaptive NUTS on the synthetic performance models
+ * in src/test/test-models/performance:
+ *   - std_normal: isotropic Gaussian, dimension N
+ *   - corr_normal: AR(1) correlated Gaussian, dimension N
+ *   - funnel: hierarchical funnel, dimension N + 1
+ *   - logistic_glm: logistic regression on N simulated observations of
+ *     K predictors, dimension K + 1
+ *
+ * Each run is one chain of 1000 warmup and 1000 sampling
+ * iterations from a fixed seed, and reports, beside the wall time of
+ * the whole run, the counters
+ *   - min_ess: smallest effective sample size over the parameters
+ *   - ess_per_second: min_ess over the wall time of the whole run
+ *   - ess_per_gradient: min_ess over the gradient evaluations of the
+ *     sampling iterations
+ *   - gradients: gradient evaluations of the sampling iterations
+ * so the efficiency can be plotted against the dimension, correlation
+ * or data size of the models, e.g. with
+ * > test/benchmark/scaling_study --benchmark_filter=corr_normal
+ *     --benchmark_out=scaling.json --benchmark_out_format=json
+ */
+#include <test/benchmark/utility.hpp>
+#include <test/test-models/performance/corr_normal.hpp>
+#include <test/test-models/performance/funnel.hpp>
+#include <test/test-models/performance/logistic_glm.hpp>
+#include <test/test-models/performance/std_normal.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/sample/hmc_nuts_dense_e_adapt.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+using stan::test::benchmark::make_model;
+
+namespace {
+const int num_warmup = 1000;
+const int num_samples = 1000;
+
+/**
+ * Writer that keeps the header and the draws written by a sampler.
+ */
+class draws_writer : public stan::callbacks::writer {
+ public:
+  void operator()(const std::vector<std::string>& names) { names_ = names; }
+
+  void operator()(const std::vector<double>& draw) { draws_.push_back(draw); }
+
+  /**
+   * Return the draws of a column, or an empty vector if there is no
+   * column of that name.
+   */
+  std::vector<double> column(const std::string& name) const {
+    auto it = std::find(names_.begin(), names_.end(), name);
+    if (it == names_.end())
+      return {};
+    return column(it - names_.begin());
+  }
+
+  std::vector<double> column(size_t index) const {
+    std::vector<double> x(draws_.size());
+    for (size_t n = 0; n < draws_.size(); ++n)
+      x[n] = draws_[n][index];
+    return x;
+  }
+
+  size_t num_columns() const { return names_.size(); }
+
+  bool is_sampler_column(size_t index) const {
+    const std::string& name = names_[index];
+    return name.size() > 2 && name.compare(name.size() - 2, 2, "__") == 0;
+  }
+
+ private:
+  std::vector<std::string> names_;
+  std::vector<std::vector<double>> draws_;
+};
+
+enum class metric { diag_e, dense_e };
+
+/**
+ * Run adaptive NUTS on the model and set the wall time and the
+ * efficiency counters of the benchmark.
+ */
+template <class Model>
+void run_nuts(benchmark::State& state, Model& model, metric m) {
+  stan::io::empty_var_context init;
+  stan::callbacks::interrupt interrupt;
+  stan::callbacks::logger logger;
+  stan::callbacks::writer init_writer;
+  stan::callbacks::writer diagnostic_writer;
+  for (auto _ : state) {
+    draws_writer sample_writer;
+    auto start = std::chrono::steady_clock::now();
+    if (m == metric::diag_e)
+      stan::services::sample::hmc_nuts_diag_e_adapt(
+          model, init, 1234, 1, 2, num_warmup, num_samples, 1, false, 0, 1, 0,
+          10, 0.8, 0.05, 0.75, 10, 75, 50, 25, interrupt, logger, init_writer,
+          sample_writer, diagnostic_writer);
+    else
+      stan::services::sample::hmc_nuts_dense_e_adapt(
+          model, init, 1234, 1, 2, num_warmup, num_samples, 1, false, 0, 1, 0,
+          10, 0.8, 0.05, 0.75, 10, 75, 50, 25, interrupt, logger, init_writer,
+          sample_writer, diagnostic_writer);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    state.SetIterationTime(seconds);
+
+    stan::analyze::autocovariance_engine<double> engine;
+    double min_ess = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < sample_writer.num_columns(); ++i) {
+      if (sample_writer.is_sampler_column(i))
+        continue;
+      std::vector<double> x = sample_writer.column(i);
+      std::vector<const double*> draws{x.data()};
+      std::vector<size_t> sizes{x.size()};
+      min_ess = std::min(min_ess, stan::analyze::compute_effective_sample_size(
+                                      draws, sizes, engine));
+    }
+    double gradients = 0;
+    for (double n_leapfrog : sample_writer.column("n_leapfrog__"))
+      gradients += n_leapfrog;
+
+    state.counters["min_ess"] = min_ess;
+    state.counters["ess_per_second"] = min_ess / seconds;
+    state.counters["ess_per_gradient"] = min_ess / gradients;
+    state.counters["gradients"] = gradients;
+  }
+}
+}  // namespace
+
+static void std_normal(benchmark::State& state) {
+  auto model = make_model<std_normal_model_namespace::std_normal_model>(
+      state.range(0));
+  run_nuts(state, *model, metric::diag_e);
+}
+BENCHMARK(std_normal)
+    ->RangeMultiplier(10)
+    ->Range(10, 100000)
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Correlated Gaussian with correlation rho = range(1) / 100 between
+ * neighbours, sampled with a diagonal or, for range(2) = 1, a dense
+ * metric.
+ */
+static void corr_normal(benchmark::State& state) {
+  auto model = make_model<corr_normal_model_namespace::corr_normal_model>(
+      "N <- " + std::to_string(state.range(0))
+      + "\nrho <- " + std::to_string(state.range(1) / 100.0) + "\n");
+  run_nuts(state, *model, state.range(2) ? metric::dense_e : metric::diag_e);
+}
+static void corr_normal_args(benchmark::internal::Benchmark* b) {
+  for (int dense : {0, 1})
+    for (int N : {10, 100, 1000, 10000})
+      for (int rho : {50, 90, 99})
+        if (!dense || N <= 1000)
+          b->Args({N, rho, dense});
+}
+BENCHMARK(corr_normal)
+    ->Apply(corr_normal_args)
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void funnel(benchmark::State& state) {
+  auto model
+      = make_model<funnel_model_namespace::funnel_model>(state.range(0));
+  run_nuts(state, *model, metric::diag_e);
+}
+BENCHMARK(funnel)
+    ->RangeMultiplier(10)
+    ->Range(10, 10000)
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Logistic regression with range(0) observations and range(1)
+ * predictors, so the cost of a gradient grows with the data size at a
+ * fixed dimension.
+ */
+static void logistic_glm(benchmark::State& state) {
+  auto model = make_model<logistic_glm_model_namespace::logistic_glm_model>(
+      "N <- " + std::to_string(state.range(0))
+      + "\nK <- " + std::to_string(state.range(1)) + "\n");
+  run_nuts(state, *model, metric::diag_e);
+}
+static void logistic_glm_args(benchmark::internal::Benchmark* b) {
+  for (int K : {10, 100})
+    for (int N : {100, 1000, 10000, 100000})
+      b->Args({N, K});
+}
+BENCHMARK(logistic_glm)
+    ->Apply(logistic_glm_args)
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
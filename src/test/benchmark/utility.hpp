@@ -0,0 +1,65 @@
+#ifndef TEST_BENCHMARK_UTILITY_HPP
+#define TEST_BENCHMARK_UTILITY_HPP
+
+#include <stan/io/dump.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace stan {
+namespace test {
+namespace benchmark {
+
+typedef boost::ecuyer1988 rng_t;
+
+/**
+ * Return a model constructed from data in the dump format.
+ *
+ * @tparam Model type of the generated model
+ * @param data data of the model
+ * @param seed seed of the random numbers in transformed data
+ * @return model
+ */
+template <class Model>
+std::unique_ptr<Model> make_model(const std::string& data,
+                                  unsigned int seed = 0) {
+  std::stringstream in(data);
+  stan::io::dump context(in);
+  return std::unique_ptr<Model>(new Model(context, seed));
+}
+
+/**
+ * Return a model of the specified dimension, for the test models in
+ * src/test/test-models/performance that take their dimension as the
+ * data variable N.
+ *
+ * @tparam Model type of the generated model
+ * @param N dimension of the model
+ * @return model
+ */
+template <class Model>
+std::unique_ptr<Model> make_model(int N) {
+  return make_model<Model>("N <- " + std::to_string(N) + "\n");
+}
+
+/**
+ * Return standard normal draws with one row per draw and one column
+ * per variable, from a fixed seed.
+ */
+inline Eigen::MatrixXd normal_draws(int num_draws, int num_vars) {
+  rng_t rng(1234);
+  boost::random::normal_distribution<double> normal;
+  Eigen::MatrixXd draws(num_draws, num_vars);
+  for (int j = 0; j < num_vars; ++j)
+    for (int i = 0; i < num_draws; ++i)
+      draws(i, j) = normal(rng);
+  return draws;
+}
+
+}  // namespace benchmark
+}  // namespace test
+}  // namespace stan
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * Performance regression gate: logistic.
+ *
+ * Runs the logistic performance model a number of times with a fixed
+ * seed, measuring the wall time of each run and its ESS per second,
+ * the smallest effective sample size of the parameters over the wall
+ * time. The runs are compared to those of a stored baseline by the
+ * percentile bootstrap of the ratio of medians, and the program exits
+ * with status 1 if either is significantly worse than the baseline by
+ * more than the tolerance:
+ *   - the lower bound of the interval of the ratio of wall times is
+ *     above 1 + tolerance, or
+ *   - the upper bound of the interval of the ratio of ESS per second
+ *     is below 1 - tolerance.
+ *
+ * If there is no baseline, or with --update-baseline, the runs are
+ * written as the new baseline and the program exits with status 0.
+ *
+ * Options, with their defaults:
+ *   --baseline=test/performance/baseline.csv
+ *   --runs=20
+ *   --alpha=0.01
+ *   --tolerance=0.05
+ *   --update-baseline
+ *
+ * Run it with
+ * > make performance-gate
+ * passing options through PERFORMANCE_GATE_FLAGS.
+ */
+
+#include <test/test-models/performance/logistic.hpp>
+#include <test/performance/utility.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+using stan::test::performance::compare_medians;
+using stan::test::performance::median_comparison;
+
+namespace {
+const char* output_file = "test/performance/regression_gate_output.csv";
+
+/**
+ * Return the smallest effective sample size of the parameters in the
+ * output file.
+ */
+double min_ess(const std::string& filename) {
+  std::ifstream in(filename);
+  stan::io::stan_csv output = stan::io::stan_csv_reader::parse(in, nullptr);
+  double ess = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < output.header.size(); ++i) {
+    const std::string& name = output.header[i];
+    if (name.size() > 2 && name.compare(name.size() - 2, 2, "__") == 0)
+      continue;
+    std::vector<const double*> draws{output.samples.col(i).data()};
+    std::vector<size_t> sizes{static_cast<size_t>(output.samples.rows())};
+    ess = std::min(
+        ess, stan::analyze::compute_effective_sample_size(draws, sizes));
+  }
+  return ess;
+}
+
+bool report(const std::string& name, const median_comparison& c,
+            bool slower) {
+  std::cout << name << ": baseline median " << c.baseline_median
+            << ", current median " << c.current_median << ", ratio "
+            << c.ratio << " (" << c.lower << ", " << c.upper << ")"
+            << (slower ? "  SIGNIFICANT REGRESSION" : "") << std::endl;
+  return slower;
+}
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  std::string baseline_file = "test/performance/baseline.csv";
+  int num_runs = 20;
+  double alpha = 0.01;
+  double tolerance = 0.05;
+  bool update_baseline = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--baseline=", 0) == 0) {
+      baseline_file = value;
+    } else if (arg.rfind("--runs=", 0) == 0) {
+      num_runs = std::atoi(value.c_str());
+    } else if (arg.rfind("--alpha=", 0) == 0) {
+      alpha = std::atof(value.c_str());
+    } else if (arg.rfind("--tolerance=", 0) == 0) {
+      tolerance = std::atof(value.c_str());
+    } else if (arg == "--update-baseline") {
+      update_baseline = true;
+    } else {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+  if (num_runs < 2) {
+    std::cerr << "--runs must be at least 2" << std::endl;
+    return 2;
+  }
+
+  std::map<std::string, std::vector<double>> current;
+  std::vector<double>& seconds = current["seconds"];
+  std::vector<double>& ess_per_second = current["ess_per_second"];
+  for (int n = 0; n < num_runs; ++n) {
+    auto start = std::chrono::steady_clock::now();
+    stan::test::performance::command<stan_model>(
+        1000, 10000, "src/test/test-models/performance/logistic.data.R",
+        output_file, 0U);
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+    ess_per_second.push_back(min_ess(output_file) / seconds.back());
+    std::cout << "run " << n + 1 << " / " << num_runs << ": "
+              << seconds.back() << " seconds, " << ess_per_second.back()
+              << " ESS per second" << std::endl;
+  }
+
+  std::map<std::string, std::vector<double>> baseline
+      = stan::test::performance::read_measurements(baseline_file);
+  if (update_baseline || baseline["seconds"].empty()
+      || baseline["ess_per_second"].empty()) {
+    stan::test::performance::write_measurements(baseline_file, current);
+    std::cout << "Wrote baseline " << baseline_file << std::endl;
+    return 0;
+  }
+
+  median_comparison time
+      = compare_medians(baseline["seconds"], seconds, alpha);
+  median_comparison efficiency
+      = compare_medians(baseline["ess_per_second"], ess_per_second, alpha);
+  std::cout << "Ratios of current to baseline medians, with "
+            << 100 * (1 - alpha) << "% bootstrap intervals" << std::endl;
+  bool regression = report("wall time", time, time.lower > 1 + tolerance);
+  regression |= report("ESS per second", efficiency,
+                       efficiency.upper < 1 - tolerance);
+  return regression ? 1 : 0;
+}
@@ -0,0 +1,340 @@
+/**
+ * Thread scaling of the parallel paths.
+ *
+ * Times each parallel path of the samplers and analysis on the scalable
+ * performance models at 1, 2, 4, ... threads, up to the number of
+ * hardware threads, so the paths worth enabling on a machine, and the
+ * number of threads to give them, can be read off their scaling curves.
+ * The paths are:
+ *   - multi_chain: adaptive diagonal NUTS running --chains chains of
+ *     corr_normal (N = 100) under a thread budget; throughput in draws
+ *     per second.
+ *   - batched_gradients: log_prob_grad at 1024 points of logistic_glm
+ *     (N = 2000, K = 50) in parallel; throughput in gradients per
+ *     second.
+ *   - parallel_gq: standalone_generate_parallel of 4096 draws of
+ *     normal_gq (N = 1000); throughput in draws per second.
+ *   - parallel_diagnostics: mcmc::chains::summary of 2000 parameters
+ *     of 4 chains of 1000 draws; throughput in parameters per second.
+ *
+ * Every measurement runs in its own process, this program run again
+ * with --measure and --threads, so the thread pool is set up once for
+ * the number of threads and the peak resident memory is that of the
+ * measurement alone. Each measurement is the median wall time of
+ * --runs runs. The speedup is the ratio of the time of one thread to
+ * that of n threads and the parallel efficiency the speedup over n.
+ *
+ * The results are written to a csv file with one row per path and
+ * number of threads, with the columns
+ *   path, threads, seconds, throughput, unit, speedup, efficiency,
+ *   peak_memory_mb
+ * after a comment line with the git hash and date. plot_performance.R
+ * plots it as thread_scaling.png when run from the folder of the file.
+ *
+ * Options, with their defaults:
+ *   --output=test/performance/thread_scaling.csv
+ *   --max-threads=<number of hardware threads>
+ *   --runs=3
+ *   --chains=8
+ *   --paths=multi_chain,batched_gradients,parallel_gq,parallel_diagnostics
+ *
+ * Run it with
+ * > make thread-scaling
+ * passing options through THREAD_SCALING_FLAGS. The paths only run in
+ * parallel when built with STAN_THREADS, which the target sets.
+ */
+
+#include <test/test-models/performance/corr_normal.hpp>
+#include <test/test-models/performance/logistic_glm.hpp>
+#include <test/test-models/performance/normal_gq.hpp>
+#include <test/benchmark/utility.hpp>
+#include <test/performance/utility.hpp>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <stan/callbacks/writer.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/chains.hpp>
+#include <stan/model/log_prob_grad.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
+#include <stan/services/sample/standalone_gqs.hpp>
+#include <stan/services/util/thread_budget.hpp>
+#include <boost/algorithm/string.hpp>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using stan::test::benchmark::make_model;
+using stan::test::benchmark::normal_draws;
+
+namespace {
+const std::vector<std::string> all_paths{
+    "multi_chain", "batched_gradients", "parallel_gq", "parallel_diagnostics"};
+
+/**
+ * Return the peak resident memory of the process in megabytes, or NaN
+ * where it isn't available.
+ */
+double peak_memory_mb() {
+#ifdef _WIN32
+  return std::numeric_limits<double>::quiet_NaN();
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return std::numeric_limits<double>::quiet_NaN();
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+  return usage.ru_maxrss / 1024.0;  // kilobytes
+#endif
+#endif
+}
+
+/**
+ * A path set up for timing: <code>run</code> does the work once and
+ * returns its amount, in units of <code>unit</code>.
+ */
+struct timed_path {
+  std::string unit;
+  std::function<double()> run;
+};
+
+timed_path multi_chain(int threads, size_t num_chains) {
+  using Model = corr_normal_model_namespace::corr_normal_model;
+  std::shared_ptr<Model> model = make_model<Model>("N <- 100\nrho <- 0.9\n");
+  return {"draws", [model, threads, num_chains]() {
+            const int num_warmup = 200;
+            const int num_samples = 200;
+            stan::io::empty_var_context context;
+            std::vector<stan::io::var_context*> init(num_chains, &context);
+            std::vector<stan::callbacks::writer> init_writer(num_chains);
+            std::vector<stan::callbacks::writer> sample_writer(num_chains);
+            std::vector<stan::callbacks::writer> diagnostic_writer(num_chains);
+            stan::callbacks::interrupt interrupt;
+            stan::callbacks::logger logger;
+            stan::services::util::thread_budget budget(threads, num_chains);
+            stan::services::util::run_options options;
+            options.threads = &budget;
+            stan::services::sample::hmc_nuts_diag_e_adapt(
+                *model, num_chains, init, 1234, 1, 2, num_warmup, num_samples,
+                1, false, 0, 1, 0, 10, 0.8, 0.05, 0.75, 10, 75, 50, 25,
+                interrupt, logger, init_writer, sample_writer,
+                diagnostic_writer, false, options);
+            return static_cast<double>(num_chains * num_samples);
+          }};
+}
+
+timed_path batched_gradients() {
+  using Model = logistic_glm_model_namespace::logistic_glm_model;
+  std::shared_ptr<Model> model = make_model<Model>("N <- 2000\nK <- 50\n");
+  auto params = std::make_shared<Eigen::MatrixXd>(
+      0.1 * normal_draws(model->num_params_r(), 1024));
+  return {"gradients", [model, params]() {
+            Eigen::VectorXd log_prob;
+            Eigen::MatrixXd gradients;
+            stan::model::log_prob_grad<true, true>(*model, *params, log_prob,
+                                                   gradients, true);
+            return static_cast<double>(params->cols());
+          }};
+}
+
+timed_path parallel_gq() {
+  using Model = normal_gq_model_namespace::normal_gq_model;
+  std::shared_ptr<Model> model = make_model<Model>(1000);
+  auto draws = std::make_shared<Eigen::MatrixXd>(normal_draws(4096, 1000));
+  return {"draws", [model, draws]() {
+            stan::callbacks::interrupt interrupt;
+            stan::callbacks::logger logger;
+            stan::callbacks::writer writer;
+            stan::services::standalone_generate_parallel(
+                *model, *draws, 1234, interrupt, logger, writer);
+            return static_cast<double>(draws->rows());
+          }};
+}
+
+timed_path parallel_diagnostics() {
+  const int num_params = 2000;
+  std::vector<std::string> names;
+  for (int i = 0; i < num_params; ++i)
+    names.push_back("x." + std::to_string(i + 1));
+  auto chains = std::make_shared<stan::mcmc::chains<>>(names);
+  Eigen::MatrixXd draws = normal_draws(4000, num_params);
+  for (int chain = 0; chain < 4; ++chain)
+    chains->add(chain, draws.middleRows(1000 * chain, 1000));
+  return {"parameters", [chains]() {
+            Eigen::VectorXd probs(3);
+            probs << 0.05, 0.5, 0.95;
+            chains->summary(probs);
+            return static_cast<double>(chains->num_params());
+          }};
+}
+
+/**
+ * Time a path at a number of threads and print the median seconds, the
+ * work per run, its unit and the peak memory as one line of the form
+ * <code>result,seconds,work,unit,peak_memory_mb</code>.
+ */
+int measure(const std::string& path, int threads, int num_runs,
+            size_t num_chains) {
+  stan::math::init_threadpool_tbb(threads);
+  timed_path timed;
+  if (path == "multi_chain") {
+    timed = multi_chain(threads, num_chains);
+  } else if (path == "batched_gradients") {
+    timed = batched_gradients();
+  } else if (path == "parallel_gq") {
+    timed = parallel_gq();
+  } else if (path == "parallel_diagnostics") {
+    timed = parallel_diagnostics();
+  } else {
+    std::cerr << "Unknown path " << path << std::endl;
+    return 2;
+  }
+  std::vector<double> seconds;
+  double work = 0;
+  for (int n = 0; n < num_runs; ++n) {
+    auto start = std::chrono::steady_clock::now();
+    work = timed.run();
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+  }
+  std::cout.precision(std::numeric_limits<double>::max_digits10);
+  std::cout << "result," << stan::test::performance::median(seconds) << ","
+            << work << "," << timed.unit << "," << peak_memory_mb()
+            << std::endl;
+  return 0;
+}
+
+/**
+ * One row of the results.
+ */
+struct scaling_row {
+  std::string path;
+  int threads;
+  double seconds;
+  double work;
+  std::string unit;
+  double peak_memory_mb;
+};
+
+/**
+ * Run a measurement in a process of its own and return its row, or
+ * false if the process failed.
+ */
+bool run_measurement(const std::string& program, const std::string& path,
+                     int threads, int num_runs, size_t num_chains,
+                     scaling_row& row) {
+  std::stringstream command;
+  command << program << " --measure=" << path << " --threads=" << threads
+          << " --runs=" << num_runs << " --chains=" << num_chains;
+  stan::test::performance::run_command_output output
+      = stan::test::performance::run_command(command.str());
+  size_t start = output.output.rfind("result,");
+  if (output.hasError || start == std::string::npos) {
+    std::cerr << output << std::endl;
+    return false;
+  }
+  std::vector<std::string> fields;
+  std::string line = output.output.substr(start);
+  boost::trim(line);
+  boost::split(fields, line, boost::is_any_of(","));
+  if (fields.size() != 5)
+    return false;
+  row.path = path;
+  row.threads = threads;
+  row.seconds = std::atof(fields[1].c_str());
+  row.work = std::atof(fields[2].c_str());
+  row.unit = fields[3];
+  row.peak_memory_mb = std::atof(fields[4].c_str());
+  return true;
+}
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  std::string output_file = "test/performance/thread_scaling.csv";
+  int max_threads = std::max(1U, std::thread::hardware_concurrency());
+  int num_runs = 3;
+  int num_chains = 8;
+  std::vector<std::string> paths = all_paths;
+  std::string measured_path;
+  int threads = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--output=", 0) == 0) {
+      output_file = value;
+    } else if (arg.rfind("--max-threads=", 0) == 0) {
+      max_threads = std::atoi(value.c_str());
+    } else if (arg.rfind("--runs=", 0) == 0) {
+      num_runs = std::atoi(value.c_str());
+    } else if (arg.rfind("--chains=", 0) == 0) {
+      num_chains = std::atoi(value.c_str());
+    } else if (arg.rfind("--paths=", 0) == 0) {
+      boost::split(paths, value, boost::is_any_of(","));
+    } else if (arg.rfind("--measure=", 0) == 0) {
+      measured_path = value;
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      threads = std::atoi(value.c_str());
+    } else {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return 2;
+    }
+  }
+  if (max_threads < 1 || num_runs < 1 || num_chains < 1) {
+    std::cerr << "--max-threads, --runs and --chains must be positive"
+              << std::endl;
+    return 2;
+  }
+  if (!measured_path.empty())
+    return measure(measured_path, std::max(threads, 1), num_runs, num_chains);
+
+  std::vector<int> thread_counts;
+  for (int t = 1; t < max_threads; t *= 2)
+    thread_counts.push_back(t);
+  thread_counts.push_back(max_threads);
+
+  std::vector<scaling_row> rows;
+  for (const std::string& path : paths) {
+    for (int t : thread_counts) {
+      scaling_row row;
+      if (!run_measurement(argv[0], path, t, num_runs, num_chains, row)) {
+        std::cerr << "Measuring " << path << " at " << t
+                  << " threads failed" << std::endl;
+        return 1;
+      }
+      std::cout << path << ", " << t << " threads: " << row.seconds
+                << " seconds, " << row.work / row.seconds << " " << row.unit
+                << " per second, " << row.peak_memory_mb << " MB peak"
+                << std::endl;
+      rows.push_back(row);
+    }
+  }
+
+  std::ofstream out(output_file);
+  out << "# git hash " << stan::test::performance::get_git_hash() << ", "
+      << stan::test::performance::get_git_date() << "\n";
+  out << "path,threads,seconds,throughput,unit,speedup,efficiency,"
+         "peak_memory_mb\n";
+  double one_thread_seconds = 0;
+  for (const scaling_row& row : rows) {
+    if (row.threads == 1)
+      one_thread_seconds = row.seconds;
+    double speedup = one_thread_seconds / row.seconds;
+    out << row.path << "," << row.threads << "," << row.seconds << ","
+        << row.work / row.seconds << "," << row.unit << "," << speedup << ","
+        << speedup / row.threads << "," << row.peak_memory_mb << "\n";
+  }
+  std::cout << "Wrote " << output_file << std::endl;
+  return 0;
+}
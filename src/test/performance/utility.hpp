@@ -7,6 +7,7 @@
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/math/special_functions/fpclassify.hpp>
 #include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+#include <boost/random/uniform_int_distribution.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
 #include <stan/model/gradient.hpp>
 #include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
@@ -16,9 +17,11 @@
 #include <stan/callbacks/stream_writer.hpp>
 #include <stan/callbacks/writer.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -194,6 +197,128 @@ std::string get_date() {
   return date;
 }
 
+/**
+ * Return the median of the values.
+ */
+inline double median(std::vector<double> x) {
+  size_t n = x.size();
+  std::nth_element(x.begin(), x.begin() + n / 2, x.end());
+  double hi = x[n / 2];
+  if (n % 2)
+    return hi;
+  return 0.5 * (hi + *std::max_element(x.begin(), x.begin() + n / 2));
+}
+
+/**
+ * Ratio of the median of current runs to that of baseline runs, with
+ * a bootstrap confidence interval.
+ */
+struct median_comparison {
+  double baseline_median;
+  double current_median;
+  double ratio;
+  double lower;
+  double upper;
+};
+
+/**
+ * Compare the medians of current and baseline runs with the percentile
+ * bootstrap: both samples are resampled with replacement, and the
+ * alpha / 2 and 1 - alpha / 2 quantiles of the resampled ratios of
+ * medians bound the interval. An interval that excludes one means the
+ * medians differ at level alpha.
+ *
+ * @param baseline measurements of the baseline runs
+ * @param current measurements of the current runs
+ * @param alpha level of the test
+ * @param num_resamples number of bootstrap resamples
+ * @param seed seed of the resampling
+ * @return ratio of the medians and its confidence interval
+ * @throws std::invalid_argument if either sample is empty
+ */
+inline median_comparison compare_medians(const std::vector<double>& baseline,
+                                         const std::vector<double>& current,
+                                         double alpha = 0.05,
+                                         int num_resamples = 10000,
+                                         unsigned int seed = 0) {
+  if (baseline.empty() || current.empty())
+    throw std::invalid_argument("compare_medians: no runs to compare");
+  boost::ecuyer1988 rng(seed + 1);
+  auto resample_median = [&rng](const std::vector<double>& x) {
+    boost::random::uniform_int_distribution<size_t> index(0, x.size() - 1);
+    std::vector<double> y(x.size());
+    for (double& v : y)
+      v = x[index(rng)];
+    return median(y);
+  };
+  std::vector<double> ratios(num_resamples);
+  for (double& r : ratios)
+    r = resample_median(current) / resample_median(baseline);
+  std::sort(ratios.begin(), ratios.end());
+
+  median_comparison result;
+  result.baseline_median = median(baseline);
+  result.current_median = median(current);
+  result.ratio = result.current_median / result.baseline_median;
+  result.lower = ratios[static_cast<size_t>(alpha / 2 * (num_resamples - 1))];
+  result.upper
+      = ratios[static_cast<size_t>((1 - alpha / 2) * (num_resamples - 1))];
+  return result;
+}
+
+/**
+ * Return the columns of a csv file of measurements with a header row,
+ * skipping comment lines starting with '#', or no columns if the file
+ * can't be read.
+ */
+inline std::map<std::string, std::vector<double>> read_measurements(
+    const std::string& filename) {
+  std::map<std::string, std::vector<double>> columns;
+  std::ifstream in(filename);
+  std::string line;
+  std::vector<std::string> names;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of(","));
+    if (names.empty()) {
+      names = fields;
+      continue;
+    }
+    for (size_t i = 0; i < fields.size() && i < names.size(); ++i)
+      columns[names[i]].push_back(atof(fields[i].c_str()));
+  }
+  return columns;
+}
+
+/**
+ * Write columns of measurements of equal length as a csv file with a
+ * header row, after a comment line with the git hash and date.
+ */
+inline void write_measurements(
+    const std::string& filename,
+    const std::map<std::string, std::vector<double>>& columns) {
+  std::ofstream out(filename);
+  out << "# git hash " << get_git_hash() << ", " << get_git_date() << "\n";
+  out.precision(std::numeric_limits<double>::max_digits10);
+  std::string sep;
+  for (const auto& column : columns) {
+    out << sep << column.first;
+    sep = ",";
+  }
+  out << "\n";
+  size_t rows = columns.empty() ? 0 : columns.begin()->second.size();
+  for (size_t n = 0; n < rows; ++n) {
+    sep = "";
+    for (const auto& column : columns) {
+      out << sep << column.second[n];
+      sep = ",";
+    }
+    out << "\n";
+  }
+}
+
 template <class Model>
 int command(int num_warmup, int num_samples, const std::string data_file,
             const std::string output_file, unsigned int random_seed) {
@@ -58,3 +58,55 @@ TEST(ProbAutocovariance, test2) {
   EXPECT_NEAR(1.10, ac(4), 0.01);
   EXPECT_NEAR(0.89, ac(5), 0.01);
 }
+
+TEST(ProbAutocovariance, engine) {
+  std::fstream f("src/test/unit/analyze/mcmc/ar1.csv");
+  size_t N = 1000;
+  Eigen::VectorXd y(N);
+  for (size_t i = 0; i < N; ++i)
+    f >> y(i);
+  Eigen::VectorXd y_short = y.head(333).reverse();
+  Eigen::VectorXd z = y.reverse().array().square();
+
+  Eigen::VectorXd ac_y(N), ac_short(333), ac_z(N);
+  stan::analyze::autocovariance<double>(y, ac_y);
+  stan::analyze::autocovariance<double>(y_short, ac_short);
+  stan::analyze::autocovariance<double>(z, ac_z);
+
+  // Sequences of different lengths reuse the engine
+  stan::analyze::autocovariance_engine<double> engine;
+  Eigen::VectorXd ac1, ac2;
+  for (int n = 0; n < 2; ++n) {
+    engine(y, ac1);
+    ASSERT_EQ(N, ac1.size());
+    for (size_t i = 0; i < N; ++i)
+      EXPECT_NEAR(ac_y(i), ac1(i), 1e-10);
+    engine(y_short, ac1);
+    ASSERT_EQ(333, ac1.size());
+    for (size_t i = 0; i < 333; ++i)
+      EXPECT_NEAR(ac_short(i), ac1(i), 1e-10);
+  }
+
+  // Two sequences in one transform
+  engine(y, z, ac1, ac2);
+  ASSERT_EQ(N, ac1.size());
+  ASSERT_EQ(N, ac2.size());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_NEAR(ac_y(i), ac1(i), 1e-10);
+    EXPECT_NEAR(ac_z(i), ac2(i), 1e-8);
+  }
+  EXPECT_THROW(engine(y, y_short, ac1, ac2), std::invalid_argument);
+
+  // Columns, including an odd one out
+  Eigen::MatrixXd ys(N, 3);
+  ys << y, z, y;
+  Eigen::MatrixXd acs;
+  engine.columns(ys, acs);
+  ASSERT_EQ(N, acs.rows());
+  ASSERT_EQ(3, acs.cols());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_NEAR(ac_y(i), acs(i, 0), 1e-10);
+    EXPECT_NEAR(ac_z(i), acs(i, 1), 1e-8);
+    EXPECT_NEAR(ac_y(i), acs(i, 2), 1e-10);
+  }
+}
@@ -0,0 +1,80 @@
+#include <stan/analyze/mcmc/compute_bridge_sampling.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+double normal_log_density(double x, double mu, double sigma) {
+  double z = (x - mu) / sigma;
+  return -0.5 * std::log(2 * M_PI) - std::log(sigma) - 0.5 * z * z;
+}
+}  // namespace
+
+TEST(AnalyzeBridgeSampling, normal_with_known_constant) {
+  // p(x) = exp(log_z) N(x | 1, 2), sampled exactly, with a N(1.2, 2.5)
+  // proposal
+  const double log_z = 3.7;
+  const int N = 4000;
+  boost::ecuyer1988 rng(1234);
+  boost::random::normal_distribution<double> posterior(1, 2);
+  boost::random::normal_distribution<double> proposal(1.2, 2.5);
+  Eigen::VectorXd log_p1(N), log_q1(N), log_p2(N), log_q2(N);
+  for (int n = 0; n < N; ++n) {
+    double x = posterior(rng);
+    log_p1(n) = log_z + normal_log_density(x, 1, 2);
+    log_q1(n) = normal_log_density(x, 1.2, 2.5);
+    x = proposal(rng);
+    log_p2(n) = log_z + normal_log_density(x, 1, 2);
+    log_q2(n) = normal_log_density(x, 1.2, 2.5);
+  }
+  stan::analyze::bridge_sampling_estimate estimate
+      = stan::analyze::compute_bridge_sampling(log_p1, log_q1, log_p2,
+                                               log_q2);
+  EXPECT_TRUE(estimate.converged);
+  EXPECT_LT(estimate.iterations, 100);
+  EXPECT_GT(estimate.relative_error, 0);
+  EXPECT_LT(estimate.relative_error, 0.05);
+  EXPECT_NEAR(log_z, estimate.log_marginal_likelihood,
+              4 * estimate.relative_error);
+
+  // A failed evaluation at a proposal draw only drops that draw
+  log_p2(0) = std::numeric_limits<double>::quiet_NaN();
+  stan::analyze::bridge_sampling_estimate dropped
+      = stan::analyze::compute_bridge_sampling(log_p1, log_q1, log_p2,
+                                               log_q2);
+  EXPECT_NEAR(estimate.log_marginal_likelihood,
+              dropped.log_marginal_likelihood, 0.01);
+}
+
+TEST(AnalyzeBridgeSampling, exact_proposal) {
+  // When the proposal is the normalized posterior every ratio is the
+  // constant, and the estimate is exact from the first iteration
+  Eigen::VectorXd log_q1(3), log_q2(4);
+  log_q1 << -1, -2, -0.5;
+  log_q2 << -0.7, -3, -1.5, -1;
+  Eigen::VectorXd log_p1 = log_q1.array() + 2.5;
+  Eigen::VectorXd log_p2 = log_q2.array() + 2.5;
+  stan::analyze::bridge_sampling_estimate estimate
+      = stan::analyze::compute_bridge_sampling(log_p1, log_q1, log_p2,
+                                               log_q2);
+  EXPECT_TRUE(estimate.converged);
+  EXPECT_FLOAT_EQ(2.5, estimate.log_marginal_likelihood);
+  EXPECT_NEAR(0, estimate.relative_error, 1e-8);
+}
+
+TEST(AnalyzeBridgeSampling, checks_arguments) {
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(3);
+  Eigen::VectorXd y = Eigen::VectorXd::Zero(2);
+  EXPECT_THROW(stan::analyze::compute_bridge_sampling(x, y, x, x),
+               std::invalid_argument);
+  EXPECT_THROW(stan::analyze::compute_bridge_sampling(
+                   x.head(1), x.head(1), x, x),
+               std::invalid_argument);
+  Eigen::VectorXd failed
+      = Eigen::VectorXd::Constant(3, std::numeric_limits<double>::quiet_NaN());
+  EXPECT_THROW(stan::analyze::compute_bridge_sampling(failed, x, x, x),
+               std::invalid_argument);
+}
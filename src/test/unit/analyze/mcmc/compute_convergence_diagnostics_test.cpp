@@ -0,0 +1,107 @@
+#include <stan/analyze/mcmc/compute_convergence_diagnostics.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+class ComputeConvergenceDiagnostics : public testing::Test {
+ public:
+  void SetUp() {
+    blocker1_stream.open("src/test/unit/mcmc/test_csv_files/blocker.1.csv");
+    blocker2_stream.open("src/test/unit/mcmc/test_csv_files/blocker.2.csv");
+  }
+
+  void TearDown() {
+    blocker1_stream.close();
+    blocker2_stream.close();
+  }
+  std::ifstream blocker1_stream, blocker2_stream;
+};
+
+TEST_F(ComputeConvergenceDiagnostics, matches_separate_diagnostics) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  std::vector<Eigen::MatrixXd> chains{blocker1.samples, blocker2.samples};
+  std::vector<stan::analyze::convergence_diagnostics> batch
+      = stan::analyze::compute_convergence_diagnostics(chains);
+  ASSERT_EQ(blocker1.samples.cols(), batch.size());
+
+  // An odd number of draws leaves the middle draw out of the halves
+  for (size_t num_draws : {1000, 999}) {
+    std::vector<const double*> draws(2);
+    std::vector<size_t> sizes{num_draws, num_draws};
+    for (int index = 4; index < blocker1.samples.cols(); ++index) {
+      draws[0] = blocker1.samples.col(index).data();
+      draws[1] = blocker2.samples.col(index).data();
+      stan::analyze::convergence_diagnostics d
+          = stan::analyze::compute_convergence_diagnostics(draws, sizes);
+
+      Eigen::VectorXd all(2 * num_draws);
+      all << blocker1.samples.col(index).head(num_draws),
+          blocker2.samples.col(index).head(num_draws);
+      double sd = std::sqrt((all.array() - all.mean()).square().sum()
+                            / (all.size() - 1));
+      double ess
+          = stan::analyze::compute_effective_sample_size(draws, sizes);
+      double split_ess
+          = stan::analyze::compute_split_effective_sample_size(draws, sizes);
+      EXPECT_NEAR(all.mean(), d.mean, 1e-10);
+      EXPECT_NEAR(sd, d.sd, 1e-10);
+      EXPECT_NEAR(
+          stan::analyze::compute_potential_scale_reduction(draws, sizes),
+          d.rhat, 1e-10);
+      EXPECT_NEAR(stan::analyze::compute_split_potential_scale_reduction(
+                      draws, sizes),
+                  d.split_rhat, 1e-10);
+      EXPECT_NEAR(ess, d.ess, 1e-6 * ess);
+      EXPECT_NEAR(split_ess, d.split_ess, 1e-6 * split_ess);
+      EXPECT_NEAR(sd / std::sqrt(ess), d.mcse, 1e-8);
+      EXPECT_NEAR(sd / std::sqrt(split_ess), d.split_mcse, 1e-8);
+
+      if (num_draws == 1000) {
+        EXPECT_FLOAT_EQ(d.rhat, batch[index].rhat);
+        EXPECT_FLOAT_EQ(d.split_ess, batch[index].split_ess);
+      }
+    }
+  }
+}
+
+TEST(ComputeConvergenceDiagnosticsTest, undefined) {
+  std::vector<double> constant(20, 3.0);
+  std::vector<double> infinite(20, 1.0);
+  infinite[0] = 2.0;
+  infinite[7] = std::numeric_limits<double>::infinity();
+  std::vector<double> increasing(20);
+  for (size_t n = 0; n < increasing.size(); ++n)
+    increasing[n] = n;
+
+  for (const std::vector<double>* x : {&constant, &infinite}) {
+    stan::analyze::convergence_diagnostics d
+        = stan::analyze::compute_convergence_diagnostics(
+            {x->data(), x->data()}, {x->size(), x->size()});
+    EXPECT_TRUE(std::isnan(d.rhat));
+    EXPECT_TRUE(std::isnan(d.split_rhat));
+    EXPECT_TRUE(std::isnan(d.ess));
+    EXPECT_TRUE(std::isnan(d.split_ess));
+    EXPECT_TRUE(std::isnan(d.mcse));
+    EXPECT_TRUE(std::isnan(d.split_mcse));
+  }
+
+  // Too few draws per half for the split ESS but not for the others
+  stan::analyze::convergence_diagnostics d
+      = stan::analyze::compute_convergence_diagnostics(
+          {increasing.data(), constant.data()}, {6, 6});
+  EXPECT_FALSE(std::isnan(d.rhat));
+  EXPECT_FALSE(std::isnan(d.split_rhat));
+  EXPECT_FALSE(std::isnan(d.ess));
+  EXPECT_TRUE(std::isnan(d.split_ess));
+  EXPECT_DOUBLE_EQ(2.75, d.mean);
+}
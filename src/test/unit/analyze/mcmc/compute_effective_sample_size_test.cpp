@@ -340,3 +340,53 @@ TEST_F(ComputeEss, compute_effective_sample_size_not_constant) {
       << "n_effective for index: " << 0
       << ", parameter: " << nonconst_chains.param_name(0);
 }
+
+TEST_F(ComputeEss, compute_effective_sample_size_all_parameters) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  std::vector<Eigen::MatrixXd> chains{blocker1.samples, blocker2.samples};
+  Eigen::VectorXd n_eff
+      = stan::analyze::compute_effective_sample_size(chains);
+  Eigen::VectorXd split_n_eff
+      = stan::analyze::compute_split_effective_sample_size(chains);
+  ASSERT_EQ(blocker1.samples.cols(), n_eff.size());
+  ASSERT_EQ(blocker1.samples.cols(), split_n_eff.size());
+
+  std::vector<const double*> draws(2);
+  std::vector<size_t> sizes{static_cast<size_t>(blocker1.samples.rows()),
+                            static_cast<size_t>(blocker2.samples.rows())};
+  for (int index = 0; index < n_eff.size(); ++index) {
+    draws[0] = blocker1.samples.col(index).data();
+    draws[1] = blocker2.samples.col(index).data();
+    double expected
+        = stan::analyze::compute_effective_sample_size(draws, sizes);
+    double expected_split
+        = stan::analyze::compute_split_effective_sample_size(draws, sizes);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(n_eff(index))) << "index: " << index;
+    } else {
+      EXPECT_DOUBLE_EQ(expected, n_eff(index)) << "index: " << index;
+    }
+    if (std::isnan(expected_split)) {
+      EXPECT_TRUE(std::isnan(split_n_eff(index))) << "index: " << index;
+    } else {
+      EXPECT_DOUBLE_EQ(expected_split, split_n_eff(index))
+          << "index: " << index;
+    }
+  }
+}
+
+TEST(ComputeEssAllParameters, mismatched_chains) {
+  std::vector<Eigen::MatrixXd> chains{Eigen::MatrixXd::Zero(10, 3),
+                                      Eigen::MatrixXd::Zero(10, 2)};
+  EXPECT_THROW(stan::analyze::compute_effective_sample_size(chains),
+               std::invalid_argument);
+  std::vector<Eigen::MatrixXd> no_chains;
+  EXPECT_THROW(stan::analyze::compute_effective_sample_size(no_chains),
+               std::invalid_argument);
+}
@@ -234,3 +234,43 @@ TEST_F(ComputeRhat, compute_potential_scale_reduction_nan) {
   ASSERT_TRUE(std::isnan(chains.split_potential_scale_reduction(0)))
       << "rhat for index: " << 1 << ", parameter: " << chains.param_name(1);
 }
+
+TEST_F(ComputeRhat, compute_potential_scale_reduction_all_parameters) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  std::vector<Eigen::MatrixXd> chains{blocker1.samples, blocker2.samples};
+  Eigen::VectorXd rhat
+      = stan::analyze::compute_potential_scale_reduction(chains);
+  Eigen::VectorXd split_rhat
+      = stan::analyze::compute_split_potential_scale_reduction(chains);
+  ASSERT_EQ(blocker1.samples.cols(), rhat.size());
+  ASSERT_EQ(blocker1.samples.cols(), split_rhat.size());
+
+  std::vector<const double*> draws(2);
+  std::vector<size_t> sizes{static_cast<size_t>(blocker1.samples.rows()),
+                            static_cast<size_t>(blocker2.samples.rows())};
+  for (int index = 0; index < rhat.size(); ++index) {
+    draws[0] = blocker1.samples.col(index).data();
+    draws[1] = blocker2.samples.col(index).data();
+    double expected
+        = stan::analyze::compute_potential_scale_reduction(draws, sizes);
+    double expected_split
+        = stan::analyze::compute_split_potential_scale_reduction(draws, sizes);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(rhat(index))) << "index: " << index;
+    } else {
+      EXPECT_DOUBLE_EQ(expected, rhat(index)) << "index: " << index;
+    }
+    if (std::isnan(expected_split)) {
+      EXPECT_TRUE(std::isnan(split_rhat(index))) << "index: " << index;
+    } else {
+      EXPECT_DOUBLE_EQ(expected_split, split_rhat(index))
+          << "index: " << index;
+    }
+  }
+}
@@ -0,0 +1,180 @@
+#include <stan/analyze/mcmc/compute_psis_loo.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * Return log likelihoods of a normal model of y with unknown mean,
+ * evaluated at draws of the mean from a normal approximation of its
+ * posterior, with one row per draw and one column per observation.
+ */
+Eigen::MatrixXd normal_log_lik(const Eigen::VectorXd& y, int num_draws,
+                               boost::ecuyer1988& rng) {
+  boost::random::normal_distribution<double> normal(
+      y.mean(), 1 / std::sqrt(static_cast<double>(y.size())));
+  Eigen::MatrixXd log_lik(num_draws, y.size());
+  for (int s = 0; s < num_draws; ++s) {
+    double mu = normal(rng);
+    for (int i = 0; i < y.size(); ++i)
+      log_lik(s, i) = -0.5 * std::log(2 * M_PI)
+                      - 0.5 * (y(i) - mu) * (y(i) - mu);
+  }
+  return log_lik;
+}
+}  // namespace
+
+TEST(AnalyzePsisLoo, fit_generalized_pareto) {
+  boost::ecuyer1988 rng(1234);
+  boost::random::uniform_01<double> uniform;
+  for (double k : {-0.2, 0.3, 0.7}) {
+    std::vector<double> x(10000);
+    for (double& v : x)
+      v = stan::analyze::internal::generalized_pareto_quantile(uniform(rng),
+                                                               k, 2);
+    std::sort(x.begin(), x.end());
+    stan::analyze::generalized_pareto fit
+        = stan::analyze::fit_generalized_pareto(x);
+    EXPECT_NEAR(k, fit.k, 0.05);
+    EXPECT_NEAR(2, fit.sigma, 0.1);
+  }
+  EXPECT_THROW(stan::analyze::fit_generalized_pareto({}),
+               std::invalid_argument);
+}
+
+TEST(AnalyzePsisLoo, compute_psis) {
+  EXPECT_EQ(800, stan::analyze::psis_tail_length(4000, 0.01));
+  EXPECT_EQ(190, stan::analyze::psis_tail_length(4000));
+
+  // Weights with a generalized Pareto tail of shape 0.8
+  boost::ecuyer1988 rng(1234);
+  boost::random::uniform_01<double> uniform;
+  Eigen::VectorXd log_weights(4000);
+  for (int s = 0; s < log_weights.size(); ++s)
+    log_weights(s) = std::log(
+        stan::analyze::internal::generalized_pareto_quantile(uniform(rng),
+                                                             0.8, 1));
+  Eigen::VectorXd raw = log_weights;
+  double k = stan::analyze::compute_psis(log_weights);
+  EXPECT_NEAR(0.8, k, 0.25);
+  EXPECT_NEAR(1, log_weights.array().exp().sum(), 1e-10);
+  // Smoothing keeps the order of the weights and caps them at the
+  // largest raw ratio
+  int max_index;
+  raw.maxCoeff(&max_index);
+  EXPECT_NEAR(log_weights.maxCoeff(), log_weights(max_index), 1e-12);
+  EXPECT_LE((log_weights.array() - log_weights(max_index)).maxCoeff(), 0);
+
+  // Light-tailed weights
+  boost::random::normal_distribution<double> normal(0, 0.1);
+  for (int s = 0; s < log_weights.size(); ++s)
+    log_weights(s) = normal(rng);
+  EXPECT_LT(stan::analyze::compute_psis(log_weights), 0.5);
+
+  // Equal weights can't be fitted and stay equal
+  log_weights.setConstant(3);
+  EXPECT_TRUE(std::isinf(stan::analyze::compute_psis(log_weights)));
+  EXPECT_NEAR(-std::log(4000), log_weights(0), 1e-12);
+  EXPECT_NEAR(-std::log(4000), log_weights(3999), 1e-12);
+
+  Eigen::VectorXd empty;
+  EXPECT_THROW(stan::analyze::compute_psis(empty), std::invalid_argument);
+}
+
+TEST(AnalyzePsisLoo, normal_model) {
+  boost::ecuyer1988 rng(1234);
+  boost::random::normal_distribution<double> normal;
+  Eigen::VectorXd y(50);
+  for (int i = 0; i < y.size(); ++i)
+    y(i) = normal(rng);
+  y(0) = 6;
+  std::vector<Eigen::MatrixXd> chains{normal_log_lik(y, 1000, rng),
+                                      normal_log_lik(y, 1000, rng)};
+  stan::analyze::psis_loo loo = stan::analyze::compute_psis_loo(chains);
+
+  // The predictive densities of a normal model with a flat prior on its
+  // mean are normal with variance 1 + 1 / n given n observations
+  auto log_normal = [](double x, double mean, double var) {
+    return -0.5 * std::log(2 * M_PI * var)
+           - 0.5 * (x - mean) * (x - mean) / var;
+  };
+  int n = y.size();
+  ASSERT_EQ(n, loo.pointwise.size());
+  double elpd_loo = 0;
+  double p_loo = 0;
+  for (int i = 0; i < n; ++i) {
+    double elpd
+        = log_normal(y(i), (y.sum() - y(i)) / (n - 1), 1 + 1.0 / (n - 1));
+    double lpd = log_normal(y(i), y.mean(), 1 + 1.0 / n);
+    elpd_loo += elpd;
+    p_loo += lpd - elpd;
+    EXPECT_NEAR(elpd, loo.pointwise[i].elpd_loo, 0.05) << "observation " << i;
+  }
+  EXPECT_NEAR(elpd_loo, loo.elpd_loo, 0.1);
+  EXPECT_NEAR(p_loo, loo.p_loo, 0.1);
+  EXPECT_GT(loo.se_elpd_loo, 0);
+  EXPECT_FLOAT_EQ(1 - 1 / std::log10(2000), loo.k_threshold);
+  EXPECT_EQ(0, loo.num_high_k);
+  // The outlier is the most influential observation
+  for (int i = 1; i < y.size(); ++i)
+    EXPECT_GT(loo.pointwise[0].pareto_k, loo.pointwise[i].pareto_k);
+}
+
+TEST(AnalyzePsisLoo, files) {
+  boost::ecuyer1988 rng(1234);
+  boost::random::normal_distribution<double> normal;
+  Eigen::VectorXd y(7);
+  for (int i = 0; i < y.size(); ++i)
+    y(i) = normal(rng);
+  std::vector<Eigen::MatrixXd> chains{normal_log_lik(y, 500, rng),
+                                      normal_log_lik(y, 600, rng)};
+  stan::analyze::psis_loo expected = stan::analyze::compute_psis_loo(chains);
+
+  std::vector<std::string> header{"lp__", "mu", "log_lik_sum"};
+  for (int i = 1; i <= y.size(); ++i)
+    header.push_back("log_lik." + std::to_string(i));
+  std::vector<std::string> files{"compute_psis_loo_test.1.csv",
+                                 "compute_psis_loo_test.2.csv"};
+  for (size_t chain = 0; chain < files.size(); ++chain) {
+    std::ofstream out(files[chain]);
+    out.precision(std::numeric_limits<double>::max_digits10);
+    stan::callbacks::stream_writer writer(out);
+    writer(header);
+    for (int s = 0; s < chains[chain].rows(); ++s) {
+      std::vector<double> draw{-1, 0, chains[chain].row(s).sum()};
+      for (int i = 0; i < y.size(); ++i)
+        draw.push_back(chains[chain](s, i));
+      writer(draw);
+    }
+  }
+
+  for (size_t block_size : {1, 3, 100}) {
+    stan::analyze::psis_loo loo
+        = stan::analyze::compute_psis_loo(files, "log_lik", block_size);
+    ASSERT_EQ(y.size(), loo.pointwise.size());
+    EXPECT_FLOAT_EQ(expected.elpd_loo, loo.elpd_loo);
+    EXPECT_FLOAT_EQ(expected.se_elpd_loo, loo.se_elpd_loo);
+    EXPECT_FLOAT_EQ(expected.p_loo, loo.p_loo);
+    EXPECT_FLOAT_EQ(expected.k_threshold, loo.k_threshold);
+    for (int i = 0; i < y.size(); ++i)
+      EXPECT_FLOAT_EQ(expected.pointwise[i].pareto_k,
+                      loo.pointwise[i].pareto_k);
+  }
+
+  EXPECT_THROW(stan::analyze::compute_psis_loo(files, "log_lik", 0),
+               std::invalid_argument);
+  EXPECT_THROW(stan::analyze::compute_psis_loo(files, "log_li", 10),
+               std::invalid_argument);
+  EXPECT_THROW(stan::analyze::compute_psis_loo({}, "log_lik", 10),
+               std::invalid_argument);
+  for (const std::string& file : files)
+    std::remove(file.c_str());
+}
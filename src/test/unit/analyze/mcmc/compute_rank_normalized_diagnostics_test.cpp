@@ -0,0 +1,136 @@
+#include <stan/analyze/mcmc/compute_rank_normalized_diagnostics.hpp>
+#include <stan/mcmc/chains.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+class ComputeRankNormalizedDiagnostics : public testing::Test {
+ public:
+  void SetUp() {
+    blocker1_stream.open("src/test/unit/mcmc/test_csv_files/blocker.1.csv");
+    blocker2_stream.open("src/test/unit/mcmc/test_csv_files/blocker.2.csv");
+  }
+
+  void TearDown() {
+    blocker1_stream.close();
+    blocker2_stream.close();
+  }
+  std::ifstream blocker1_stream, blocker2_stream;
+};
+
+TEST_F(ComputeRankNormalizedDiagnostics, blocker) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  std::vector<Eigen::MatrixXd> chains{blocker1.samples, blocker2.samples};
+  std::vector<stan::analyze::rank_normalized_diagnostics> batch
+      = stan::analyze::compute_rank_normalized_diagnostics(chains);
+  ASSERT_EQ(blocker1.samples.cols(), batch.size());
+
+  std::vector<const double*> draws(2);
+  std::vector<size_t> sizes{static_cast<size_t>(blocker1.samples.rows()),
+                            static_cast<size_t>(blocker2.samples.rows())};
+  for (int index = 4; index < blocker1.samples.cols(); ++index) {
+    draws[0] = blocker1.samples.col(index).data();
+    draws[1] = blocker2.samples.col(index).data();
+    stan::analyze::rank_normalized_diagnostics single
+        = stan::analyze::compute_rank_normalized_diagnostics(draws, sizes);
+    EXPECT_FLOAT_EQ(single.rhat_bulk, batch[index].rhat_bulk);
+    EXPECT_FLOAT_EQ(single.rhat_folded, batch[index].rhat_folded);
+    EXPECT_FLOAT_EQ(single.ess_bulk, batch[index].ess_bulk);
+    EXPECT_FLOAT_EQ(single.ess_tail, batch[index].ess_tail);
+    EXPECT_FLOAT_EQ(std::max(single.rhat_bulk, single.rhat_folded),
+                    single.rhat);
+
+    EXPECT_NEAR(stan::analyze::compute_split_potential_scale_reduction(draws,
+                                                                       sizes),
+                single.rhat_bulk, 0.02)
+        << "parameter: " << blocker1.header[index];
+    EXPECT_LT(single.rhat, 1.05) << "parameter: " << blocker1.header[index];
+    EXPECT_GT(single.ess_bulk, 20) << "parameter: " << blocker1.header[index];
+    EXPECT_GT(single.ess_tail, 20) << "parameter: " << blocker1.header[index];
+  }
+}
+
+TEST(ComputeRankNormalizedDiagnosticsTest, invariant_to_monotone_transform) {
+  boost::ecuyer1988 rng(4);
+  boost::random::normal_distribution<double> normal;
+  std::vector<std::vector<double>> x(4, std::vector<double>(200));
+  std::vector<std::vector<double>> exp_x(x);
+  for (size_t chain = 0; chain < x.size(); ++chain) {
+    double state = 0;
+    for (size_t n = 0; n < x[chain].size(); ++n) {
+      state = 0.5 * state + normal(rng);
+      x[chain][n] = state;
+      exp_x[chain][n] = std::exp(state);
+    }
+  }
+  std::vector<const double*> draws, exp_draws;
+  std::vector<size_t> sizes;
+  for (size_t chain = 0; chain < x.size(); ++chain) {
+    draws.push_back(x[chain].data());
+    exp_draws.push_back(exp_x[chain].data());
+    sizes.push_back(x[chain].size());
+  }
+
+  stan::analyze::rank_normalized_diagnostics diagnostics
+      = stan::analyze::compute_rank_normalized_diagnostics(draws, sizes);
+  stan::analyze::rank_normalized_diagnostics exp_diagnostics
+      = stan::analyze::compute_rank_normalized_diagnostics(exp_draws, sizes);
+  EXPECT_FLOAT_EQ(diagnostics.rhat_bulk, exp_diagnostics.rhat_bulk);
+  EXPECT_FLOAT_EQ(diagnostics.ess_bulk, exp_diagnostics.ess_bulk);
+  EXPECT_FLOAT_EQ(diagnostics.ess_tail, exp_diagnostics.ess_tail);
+  EXPECT_LT(diagnostics.rhat, 1.05);
+}
+
+TEST(ComputeRankNormalizedDiagnosticsTest, scale_mismatch) {
+  // Chains with the same location but different scales look converged
+  // to the bulk R-hat; the folded R-hat catches them
+  boost::ecuyer1988 rng(7);
+  boost::random::normal_distribution<double> normal;
+  std::vector<std::vector<double>> x(4, std::vector<double>(500));
+  for (size_t chain = 0; chain < x.size(); ++chain)
+    for (double& v : x[chain])
+      v = (chain == 0 ? 5 : 1) * normal(rng);
+  std::vector<const double*> draws;
+  std::vector<size_t> sizes;
+  for (size_t chain = 0; chain < x.size(); ++chain) {
+    draws.push_back(x[chain].data());
+    sizes.push_back(x[chain].size());
+  }
+
+  stan::analyze::rank_normalized_diagnostics diagnostics
+      = stan::analyze::compute_rank_normalized_diagnostics(draws, sizes);
+  EXPECT_LT(diagnostics.rhat_bulk, 1.02);
+  EXPECT_GT(diagnostics.rhat_folded, 1.1);
+  EXPECT_FLOAT_EQ(diagnostics.rhat_folded, diagnostics.rhat);
+}
+
+TEST(ComputeRankNormalizedDiagnosticsTest, degenerate) {
+  std::vector<double> constant(100, 1.5);
+  std::vector<double> infinite(100, 1.5);
+  infinite[3] = std::numeric_limits<double>::infinity();
+  infinite[4] = 0;
+  std::vector<double> short_chain{1, 2, 3};
+
+  for (const std::vector<double>* x : {&constant, &infinite, &short_chain}) {
+    std::vector<const double*> draws{x->data(), x->data()};
+    std::vector<size_t> sizes{x->size(), x->size()};
+    stan::analyze::rank_normalized_diagnostics diagnostics
+        = stan::analyze::compute_rank_normalized_diagnostics(draws, sizes);
+    EXPECT_TRUE(std::isnan(diagnostics.rhat_bulk));
+    EXPECT_TRUE(std::isnan(diagnostics.rhat_folded));
+    EXPECT_TRUE(std::isnan(diagnostics.rhat));
+    EXPECT_TRUE(std::isnan(diagnostics.ess_bulk));
+    EXPECT_TRUE(std::isnan(diagnostics.ess_tail));
+  }
+}
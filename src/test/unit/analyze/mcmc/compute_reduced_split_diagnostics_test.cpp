@@ -0,0 +1,142 @@
+#include <stan/analyze/mcmc/compute_reduced_split_diagnostics.hpp>
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+// AR(1) chains with a different offset per chain
+std::vector<std::vector<double>> ar1_chains(size_t num_chains,
+                                            size_t num_draws) {
+  std::mt19937 rng(1234);
+  std::normal_distribution<double> normal;
+  std::vector<std::vector<double>> chains(num_chains);
+  for (size_t chain = 0; chain < num_chains; ++chain) {
+    double x = 0;
+    for (size_t n = 0; n < num_draws; ++n) {
+      x = 0.6 * x + normal(rng);
+      chains[chain].push_back(x + 0.1 * chain);
+    }
+  }
+  return chains;
+}
+
+// Sums vectors across the threads calling it, as an all-reduce across
+// processes does
+class thread_all_reduce {
+ public:
+  explicit thread_all_reduce(int num_threads)
+      : num_threads_(num_threads), arrived_(0), generation_(0) {}
+
+  void operator()(Eigen::VectorXd& x) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (arrived_ == 0)
+      sum_ = Eigen::VectorXd::Zero(x.size());
+    sum_ += x;
+    int generation = generation_;
+    if (++arrived_ == num_threads_) {
+      result_ = sum_;
+      arrived_ = 0;
+      ++generation_;
+      done_.notify_all();
+    } else {
+      done_.wait(lock, [&] { return generation_ != generation; });
+    }
+    x = result_;
+  }
+
+ private:
+  int num_threads_;
+  int arrived_;
+  int generation_;
+  Eigen::VectorXd sum_;
+  Eigen::VectorXd result_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+};
+}  // namespace
+
+TEST(ComputeReducedSplitDiagnostics, matches_split_diagnostics) {
+  std::vector<std::vector<double>> chains = ar1_chains(4, 101);
+  std::vector<const double*> draws;
+  std::vector<size_t> sizes;
+  for (const std::vector<double>& chain : chains) {
+    draws.push_back(chain.data());
+    sizes.push_back(chain.size());
+  }
+
+  stan::analyze::autocovariance_engine<double> engine;
+  double rhat, ess;
+  stan::analyze::compute_reduced_split_diagnostics(
+      draws, 101, [](Eigen::VectorXd&) {}, engine, rhat, ess);
+  EXPECT_NEAR(
+      stan::analyze::compute_split_potential_scale_reduction(draws, sizes),
+      rhat, 1e-10);
+  EXPECT_NEAR(stan::analyze::compute_split_effective_sample_size(draws, sizes),
+              ess, 1e-8);
+}
+
+TEST(ComputeReducedSplitDiagnostics, chains_on_several_processes) {
+  std::vector<std::vector<double>> chains = ar1_chains(5, 200);
+  std::vector<const double*> draws;
+  for (const std::vector<double>& chain : chains)
+    draws.push_back(chain.data());
+  std::vector<size_t> sizes(draws.size(), 200);
+  double expected_rhat
+      = stan::analyze::compute_split_potential_scale_reduction(draws, sizes);
+  double expected_ess
+      = stan::analyze::compute_split_effective_sample_size(draws, sizes);
+
+  // Three processes holding three, two and no chains
+  std::vector<std::vector<const double*>> local
+      = {{draws[0], draws[2], draws[4]}, {draws[1], draws[3]}, {}};
+  thread_all_reduce all_reduce(local.size());
+  std::vector<double> rhat(local.size()), ess(local.size());
+  std::vector<std::thread> processes;
+  for (size_t p = 0; p < local.size(); ++p)
+    processes.emplace_back([&, p] {
+      stan::analyze::autocovariance_engine<double> engine;
+      stan::analyze::compute_reduced_split_diagnostics(
+          local[p], 200, std::ref(all_reduce), engine, rhat[p], ess[p]);
+    });
+  for (std::thread& process : processes)
+    process.join();
+  for (size_t p = 0; p < local.size(); ++p) {
+    EXPECT_NEAR(expected_rhat, rhat[p], 1e-10);
+    EXPECT_NEAR(expected_ess, ess[p], 1e-8);
+  }
+}
+
+TEST(ComputeReducedSplitDiagnostics, nan) {
+  std::vector<std::vector<double>> chains = ar1_chains(2, 50);
+  stan::analyze::autocovariance_engine<double> engine;
+  auto identity = [](Eigen::VectorXd&) {};
+  double rhat, ess;
+
+  stan::analyze::compute_reduced_split_diagnostics({}, 50, identity, engine,
+                                                   rhat, ess);
+  EXPECT_TRUE(std::isnan(rhat));
+  EXPECT_TRUE(std::isnan(ess));
+
+  std::vector<const double*> draws{chains[0].data(), chains[1].data()};
+  stan::analyze::compute_reduced_split_diagnostics(draws, 6, identity, engine,
+                                                   rhat, ess);
+  EXPECT_FALSE(std::isnan(rhat));
+  EXPECT_TRUE(std::isnan(ess));
+
+  chains[1][7] = std::numeric_limits<double>::infinity();
+  stan::analyze::compute_reduced_split_diagnostics(draws, 50, identity, engine,
+                                                   rhat, ess);
+  EXPECT_TRUE(std::isnan(rhat));
+  EXPECT_TRUE(std::isnan(ess));
+
+  std::vector<double> constant(50, 2.0);
+  draws = {constant.data(), constant.data()};
+  stan::analyze::compute_reduced_split_diagnostics(draws, 50, identity, engine,
+                                                   rhat, ess);
+  EXPECT_TRUE(std::isnan(rhat));
+  EXPECT_TRUE(std::isnan(ess));
+}
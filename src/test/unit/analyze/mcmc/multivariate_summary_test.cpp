@@ -0,0 +1,132 @@
+#include <stan/analyze/mcmc/multivariate_summary.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * Return draws of a vector autoregressive process of order one, with
+ * the given autocorrelation and correlation between its components.
+ */
+Eigen::MatrixXd var1_draws(int n, double rho, double corr, unsigned seed) {
+  boost::ecuyer1988 rng(seed);
+  boost::variate_generator<boost::ecuyer1988&, boost::normal_distribution<>>
+      normal(rng, boost::normal_distribution<>());
+  Eigen::Matrix3d chol = Eigen::Matrix3d::Identity();
+  chol(1, 0) = corr;
+  chol(1, 1) = std::sqrt(1 - corr * corr);
+  Eigen::MatrixXd draws(n, 3);
+  Eigen::Vector3d x = Eigen::Vector3d::Zero();
+  for (int i = 0; i < n; ++i) {
+    Eigen::Vector3d e(normal(), normal(), normal());
+    x = rho * x + std::sqrt(1 - rho * rho) * chol * e;
+    draws.row(i) = x.transpose() + Eigen::RowVector3d(1, -2, 1e4);
+  }
+  return draws;
+}
+
+void expect_matrix_near(const Eigen::MatrixXd& a, const Eigen::MatrixXd& b,
+                        double tol) {
+  ASSERT_EQ(a.rows(), b.rows());
+  ASSERT_EQ(a.cols(), b.cols());
+  for (int i = 0; i < a.rows(); ++i)
+    for (int j = 0; j < a.cols(); ++j)
+      EXPECT_NEAR(a(i, j), b(i, j), tol) << "(" << i << ", " << j << ")";
+}
+}  // namespace
+
+TEST(AnalyzeMultivariateSummary, covariance_in_chunks) {
+  Eigen::MatrixXd draws = var1_draws(1000, 0.3, 0.6, 1);
+  Eigen::MatrixXd centered = draws.rowwise() - draws.colwise().mean();
+  Eigen::MatrixXd expected
+      = centered.transpose() * centered / (draws.rows() - 1.0);
+
+  for (int chunk : {1, 7, 1000}) {
+    stan::analyze::multivariate_summary summary(3, 10);
+    for (int n = 0; n < draws.rows(); n += chunk)
+      summary.add(draws.middleRows(n, std::min<int>(chunk, draws.rows() - n)));
+    EXPECT_EQ(1000U, summary.num_draws());
+    EXPECT_EQ(100U, summary.num_batches());
+    expect_matrix_near(draws.colwise().mean().transpose(), summary.mean(),
+                       1e-8);
+    expect_matrix_near(expected, summary.covariance(), 1e-8);
+  }
+  stan::analyze::multivariate_summary summary(3, 10);
+  summary.add(draws);
+  Eigen::MatrixXd corr = summary.correlation();
+  for (int i = 0; i < 3; ++i)
+    EXPECT_FLOAT_EQ(1, corr(i, i));
+  EXPECT_NEAR(0.6, corr(0, 1), 0.1);
+  EXPECT_FLOAT_EQ(corr(0, 1), corr(1, 0));
+}
+
+TEST(AnalyzeMultivariateSummary, batch_means) {
+  Eigen::MatrixXd draws(6, 1);
+  draws << 1, 3, 2, 6, 10, 20;
+  stan::analyze::multivariate_summary summary(1, 2);
+  summary.add(draws.topRows(3));
+  summary.start_chain();
+  summary.add(draws.bottomRows(3));
+  // The batches are {1, 3} and {6, 10}; 2 and 20 end unfinished batches
+  EXPECT_EQ(2U, summary.num_batches());
+  EXPECT_FLOAT_EQ(2 * 18, summary.batch_means_covariance()(0, 0));
+}
+
+TEST(AnalyzeMultivariateSummary, multivariate_ess) {
+  const int N = 40000;
+  stan::analyze::multivariate_summary independent(3, 200);
+  independent.add(var1_draws(N, 0, 0.6, 2));
+  EXPECT_NEAR(N, independent.multivariate_ess(), 0.15 * N);
+
+  // Every component has an effective sample size of n (1 - rho) / (1 + rho)
+  stan::analyze::multivariate_summary correlated(3, 200);
+  correlated.add(var1_draws(N, 0.8, 0.6, 3));
+  EXPECT_NEAR(N / 9.0, correlated.multivariate_ess(), 0.15 * N / 9);
+
+  stan::analyze::multivariate_summary too_few(3, 200);
+  too_few.add(var1_draws(300, 0.8, 0.6, 3));
+  EXPECT_TRUE(std::isnan(too_few.multivariate_ess()));
+}
+
+TEST(AnalyzeMultivariateSummary, checks_arguments) {
+  EXPECT_THROW(stan::analyze::multivariate_summary(0, 10),
+               std::invalid_argument);
+  EXPECT_THROW(stan::analyze::multivariate_summary(2, 0),
+               std::invalid_argument);
+  stan::analyze::multivariate_summary summary(2, 10);
+  EXPECT_THROW(summary.add(Eigen::MatrixXd::Zero(4, 3)),
+               std::invalid_argument);
+  EXPECT_TRUE(std::isnan(summary.covariance()(0, 0)));
+}
+
+TEST(AnalyzeMultivariateSummary, files) {
+  std::vector<std::string> files{
+      "src/test/unit/mcmc/test_csv_files/blocker.1.csv",
+      "src/test/unit/mcmc/test_csv_files/blocker.2.csv"};
+  std::vector<size_t> columns{6, 7, 28};
+  stan::mcmc::chains<> chains(
+      stan::analyze::internal::read_output_header(files[0], nullptr));
+  for (const std::string& file : files) {
+    std::ifstream in(file);
+    chains.add(stan::io::stan_csv_reader::parse(in, nullptr));
+  }
+
+  stan::analyze::multivariate_summary summary
+      = stan::analyze::summarize_multivariate(files, columns, 0, 64);
+  EXPECT_EQ(2000U, summary.num_draws());
+  // Batches of 31 draws, 32 from each chain
+  EXPECT_EQ(64U, summary.num_batches());
+  for (size_t i = 0; i < columns.size(); ++i)
+    for (size_t j = 0; j < columns.size(); ++j)
+      EXPECT_NEAR(chains.covariance(columns[i], columns[j]),
+                  summary.covariance()(i, j), 1e-6);
+  EXPECT_GT(summary.multivariate_ess(), 0);
+  EXPECT_THROW(stan::analyze::summarize_multivariate(files, {}, 0),
+               std::invalid_argument);
+}
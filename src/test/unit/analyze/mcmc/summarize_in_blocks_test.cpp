@@ -0,0 +1,94 @@
+#include <stan/analyze/mcmc/summarize_in_blocks.hpp>
+#include <stan/callbacks/binary_writer.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+const std::string blocker1_file
+    = "src/test/unit/mcmc/test_csv_files/blocker.1.csv";
+const std::string blocker2_file
+    = "src/test/unit/mcmc/test_csv_files/blocker.2.csv";
+
+stan::io::stan_csv parse(const std::string& file) {
+  std::ifstream in(file);
+  return stan::io::stan_csv_reader::parse(in, nullptr);
+}
+
+/**
+ * Return the table summarize_in_blocks should write, computed from all
+ * of the draws in memory.
+ */
+std::string expected_table(const std::vector<std::string>& files,
+                           const Eigen::VectorXd& probs) {
+  stan::mcmc::chains<> chains(parse(files[0]).header);
+  for (const std::string& file : files)
+    chains.add(parse(file));
+  std::stringstream table;
+  table << "name,mean,mcse,sd,5%,50%,95%,ess,rhat\n";
+  for (int i = 0; i < chains.num_params(); ++i) {
+    stan::mcmc::parameter_summary s = chains.summary(i, probs);
+    table << "\"" << chains.param_name(i) << "\"," << s.mean << "," << s.mcse
+          << "," << s.sd << "," << s.quantiles(0) << "," << s.quantiles(1)
+          << "," << s.quantiles(2) << "," << s.ess << "," << s.rhat << "\n";
+  }
+  return table.str();
+}
+}  // namespace
+
+TEST(AnalyzeSummarizeInBlocks, csv) {
+  Eigen::VectorXd probs(3);
+  probs << 0.05, 0.5, 0.95;
+  std::vector<std::string> files{blocker1_file, blocker2_file};
+  std::string expected = expected_table(files, probs);
+
+  for (size_t block_size : {1, 7, 1000}) {
+    std::stringstream table;
+    stan::analyze::summarize_in_blocks(files, block_size, probs, table);
+    EXPECT_EQ(expected, table.str()) << "block size " << block_size;
+  }
+}
+
+TEST(AnalyzeSummarizeInBlocks, binary) {
+  Eigen::VectorXd probs(3);
+  probs << 0.05, 0.5, 0.95;
+  std::string path = "summarize_in_blocks_test.bin";
+  {
+    stan::io::stan_csv blocker1 = parse(blocker1_file);
+    std::ofstream out(path, std::ios::binary);
+    stan::callbacks::binary_writer writer(out);
+    writer(blocker1.header);
+    for (int n = 0; n < blocker1.samples.rows(); ++n) {
+      Eigen::VectorXd draw = blocker1.samples.row(n);
+      writer(std::vector<double>(draw.data(), draw.data() + draw.size()));
+    }
+  }
+
+  std::stringstream table;
+  stan::analyze::summarize_in_blocks({path, blocker2_file}, 10, probs, table);
+  EXPECT_EQ(expected_table({blocker1_file, blocker2_file}, probs),
+            table.str());
+  std::remove(path.c_str());
+}
+
+TEST(AnalyzeSummarizeInBlocks, errors) {
+  Eigen::VectorXd probs(1);
+  probs << 0.5;
+  std::stringstream table;
+  EXPECT_THROW(stan::analyze::summarize_in_blocks({}, 10, probs, table),
+               std::invalid_argument);
+  EXPECT_THROW(
+      stan::analyze::summarize_in_blocks({blocker1_file}, 0, probs, table),
+      std::invalid_argument);
+  EXPECT_THROW(stan::analyze::summarize_in_blocks(
+                   {blocker1_file, "no_such_file.csv"}, 10, probs, table),
+               std::invalid_argument);
+  EXPECT_THROW(stan::analyze::summarize_in_blocks(
+                   {blocker1_file,
+                    "src/test/unit/mcmc/test_csv_files/epil.1.csv"},
+                   10, probs, table),
+               std::invalid_argument);
+}
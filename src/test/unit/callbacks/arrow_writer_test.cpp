@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <stan/callbacks/arrow_writer.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class StanInterfaceCallbacksArrowWriter : public ::testing::Test {
+ public:
+  void SetUp() {
+    ss.str(std::string());
+    ss.clear();
+  }
+
+  uint64_t uint_at(const std::string& bytes, size_t offset, int size) {
+    uint64_t x = 0;
+    for (int i = size - 1; i >= 0; --i)
+      x = (x << 8) | static_cast<unsigned char>(bytes[offset + i]);
+    return x;
+  }
+
+  struct message {
+    int header_type;
+    std::string body;
+  };
+
+  /**
+   * Split the stream into its messages, reading the type and the body
+   * length from the flatbuffer of each.
+   */
+  std::vector<message> messages() {
+    std::string s = ss.str();
+    std::vector<message> result;
+    size_t pos = 0;
+    while (true) {
+      EXPECT_EQ(0xFFFFFFFFU, uint_at(s, pos, 4));
+      size_t size = uint_at(s, pos + 4, 4);
+      pos += 8;
+      if (size == 0)
+        break;
+      EXPECT_EQ(0U, size % 8);
+      std::string meta = s.substr(pos, size);
+      pos += size;
+      size_t table = uint_at(meta, 0, 4);
+      size_t vtable = table - uint_at(meta, table, 4);
+      int header_type = uint_at(meta, table + uint_at(meta, vtable + 6, 2), 1);
+      size_t body_length
+          = uint_at(meta, table + uint_at(meta, vtable + 10, 2), 8);
+      result.push_back(message{header_type, s.substr(pos, body_length)});
+      pos += body_length;
+    }
+    EXPECT_EQ(s.size(), pos);
+    return result;
+  }
+
+  std::stringstream ss;
+};
+
+TEST_F(StanInterfaceCallbacksArrowWriter, schema_only) {
+  {
+    stan::callbacks::arrow_writer writer(ss);
+    writer(std::vector<std::string>{"lp__", "theta"});
+    writer("Adaptation terminated");
+    writer();
+  }
+  std::vector<message> m = messages();
+  ASSERT_EQ(1U, m.size());
+  EXPECT_EQ(1, m[0].header_type);
+  EXPECT_TRUE(m[0].body.empty());
+  EXPECT_NE(std::string::npos, ss.str().find("theta"));
+}
+
+TEST_F(StanInterfaceCallbacksArrowWriter, batches) {
+  stan::callbacks::arrow_writer writer(ss, 3);
+  writer(std::vector<std::string>{"theta"});
+  for (int n = 0; n < 7; ++n)
+    writer(std::vector<double>{0.5 * n});
+  writer.finish();
+  writer.finish();
+
+  std::vector<message> m = messages();
+  ASSERT_EQ(4U, m.size());
+  EXPECT_EQ(1, m[0].header_type);
+  for (int i = 1; i < 4; ++i)
+    EXPECT_EQ(3, m[i].header_type);
+  // A column of doubles without nulls is a single values buffer
+  ASSERT_EQ(24U, m[1].body.size());
+  for (int n = 0; n < 3; ++n) {
+    uint64_t bits = uint_at(m[1].body, 8 * n, 8);
+    double x;
+    std::memcpy(&x, &bits, 8);
+    EXPECT_FLOAT_EQ(0.5 * n, x);
+  }
+  EXPECT_EQ(8U, m[3].body.size());
+}
+
+TEST_F(StanInterfaceCallbacksArrowWriter, column_types) {
+  stan::callbacks::arrow_writer writer(ss);
+  writer(std::vector<std::string>{"treedepth__", "divergent__"});
+  writer.set_column_types(
+      {stan::io::column_type::int32, stan::io::column_type::uint8});
+  writer(std::vector<double>{3, 1});
+  writer(std::vector<double>{5, std::nan("")});
+  writer.finish();
+
+  std::vector<message> m = messages();
+  ASSERT_EQ(2U, m.size());
+  // int32 values, then the validity bitmap and the uint8 values, each
+  // padded to 8 bytes
+  const std::string& body = m[1].body;
+  ASSERT_EQ(24U, body.size());
+  EXPECT_EQ(3U, uint_at(body, 0, 4));
+  EXPECT_EQ(5U, uint_at(body, 4, 4));
+  EXPECT_EQ(1U, uint_at(body, 8, 1));
+  EXPECT_EQ(1U, uint_at(body, 16, 1));
+  EXPECT_EQ(0U, uint_at(body, 17, 1));
+}
+
+TEST_F(StanInterfaceCallbacksArrowWriter, mismatched_draw) {
+  stan::callbacks::arrow_writer writer(ss);
+  writer(std::vector<std::string>{"lp__", "theta"});
+  EXPECT_THROW(writer(std::vector<double>{1}), std::invalid_argument);
+  EXPECT_THROW(stan::callbacks::arrow_writer(ss, 0), std::invalid_argument);
+}
@@ -0,0 +1,108 @@
+#include <stan/callbacks/async_writer.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace test {
+// Blocks in its first call until released
+class gated_writer : public stan::callbacks::writer {
+ public:
+  std::atomic<bool> entered;
+  std::atomic<bool> released;
+  std::vector<std::vector<double>> states;
+
+  gated_writer() : entered(false), released(false) {}
+
+  void operator()(const std::vector<double>& state) {
+    entered = true;
+    while (!released)
+      std::this_thread::yield();
+    states.push_back(state);
+  }
+};
+
+class throwing_writer : public stan::callbacks::writer {
+ public:
+  void operator()(const std::vector<double>& state) {
+    throw std::runtime_error("disk full");
+  }
+};
+}  // namespace test
+
+TEST(StanCallbacksAsyncWriter, matches_stream_writer) {
+  std::stringstream expected_ss, ss;
+  stan::callbacks::stream_writer expected(expected_ss, "# ");
+  stan::callbacks::stream_writer stream(ss, "# ");
+
+  std::vector<std::string> names{"lp__", "accept_stat__", "theta"};
+  {
+    stan::callbacks::async_writer writer(stream, 4);
+    expected(names);
+    writer(names);
+    for (int n = 0; n < 100; ++n) {
+      std::vector<double> state{-n * 0.5, 0.9, n * 1.5};
+      expected(state);
+      writer(state);
+    }
+    expected();
+    writer();
+    EXPECT_EQ(expected_ss.str(), ss.str()) << "flushed by the blank line";
+
+    expected("Elapsed Time: 1 seconds");
+    writer("Elapsed Time: 1 seconds");
+    EXPECT_EQ(0U, writer.num_dropped());
+  }
+  EXPECT_EQ(expected_ss.str(), ss.str());
+}
+
+TEST(StanCallbacksAsyncWriter, flush_on_destruction) {
+  std::stringstream expected_ss, ss;
+  stan::callbacks::stream_writer expected(expected_ss);
+  stan::callbacks::stream_writer stream(ss);
+  {
+    stan::callbacks::async_writer writer(stream, 2);
+    for (int n = 0; n < 10; ++n) {
+      expected(std::vector<double>{static_cast<double>(n)});
+      writer(std::vector<double>{static_cast<double>(n)});
+    }
+  }
+  EXPECT_EQ(expected_ss.str(), ss.str());
+}
+
+TEST(StanCallbacksAsyncWriter, drop) {
+  test::gated_writer gated;
+  {
+    stan::callbacks::async_writer writer(gated, 2,
+                                         stan::callbacks::backpressure::drop);
+    writer(std::vector<double>{1});
+    while (!gated.entered)
+      std::this_thread::yield();
+
+    // The draw being written keeps its slot until it is out
+    writer(std::vector<double>{2});
+    writer(std::vector<double>{3});
+    writer(std::vector<double>{4});
+    EXPECT_EQ(2U, writer.num_dropped());
+    gated.released = true;
+    writer.flush();
+  }
+  ASSERT_EQ(2U, gated.states.size());
+  EXPECT_EQ(1, gated.states[0][0]);
+  EXPECT_EQ(2, gated.states[1][0]);
+}
+
+TEST(StanCallbacksAsyncWriter, rethrows) {
+  test::throwing_writer throwing;
+  stan::callbacks::async_writer writer(throwing);
+  writer(std::vector<double>{1});
+  EXPECT_THROW(writer.flush(), std::runtime_error);
+  EXPECT_NO_THROW(writer.flush());
+}
+
+TEST(StanCallbacksAsyncWriter, zero_capacity) {
+  stan::callbacks::writer base;
+  EXPECT_THROW(stan::callbacks::async_writer(base, 0), std::invalid_argument);
+}
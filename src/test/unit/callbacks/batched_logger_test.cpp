@@ -0,0 +1,56 @@
+#include <stan/callbacks/batched_logger.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+class StanInterfaceCallbacksBatchedLogger : public ::testing::Test {
+ public:
+  StanInterfaceCallbacksBatchedLogger()
+      : stream_logger(debug, info, warn, error, fatal) {}
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger stream_logger;
+};
+
+TEST_F(StanInterfaceCallbacksBatchedLogger, repeats_summarized) {
+  stan::callbacks::batched_logger logger(stream_logger);
+  for (int n = 0; n < 3; ++n) {
+    logger.error("rejected");
+    logger.error("");
+  }
+  logger.error("other");
+  EXPECT_EQ("rejected\n\nother\n", error.str());
+
+  logger.info("Iteration: 100");
+  EXPECT_EQ("rejected\n\nother\n(repeated 2 more times) rejected\n",
+            error.str());
+  EXPECT_EQ("Iteration: 100\n", info.str());
+
+  // A new interval forwards the first occurrence again
+  logger.error("rejected");
+  logger.flush();
+  EXPECT_EQ(
+      "rejected\n\nother\n(repeated 2 more times) rejected\n"
+      "rejected\n",
+      error.str());
+}
+
+TEST_F(StanInterfaceCallbacksBatchedLogger, levels) {
+  {
+    stan::callbacks::batched_logger logger(stream_logger);
+    std::stringstream message;
+    message << "warning";
+    logger.warn(message);
+    logger.warn(message);
+    logger.debug("debug");
+    logger.debug("debug");
+    logger.fatal("fatal");
+    logger.fatal("fatal");
+    EXPECT_EQ("warning\n", warn.str());
+  }
+  EXPECT_EQ("warning\n(repeated 1 more times) warning\n", warn.str());
+  EXPECT_EQ("debug\ndebug\n", debug.str());
+  EXPECT_EQ("fatal\nfatal\n", fatal.str());
+  EXPECT_EQ("", error.str());
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <stan/callbacks/binary_writer.hpp>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class StanInterfaceCallbacksBinaryWriter : public ::testing::Test {
+ public:
+  void SetUp() {
+    ss.str(std::string());
+    ss.clear();
+  }
+
+  uint64_t uint64_at(size_t offset) {
+    std::string bytes = ss.str().substr(offset, 8);
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; --i)
+      x = (x << 8) | static_cast<unsigned char>(bytes[i]);
+    return x;
+  }
+
+  double double_at(size_t offset) {
+    uint64_t bits = uint64_at(offset);
+    double x;
+    std::memcpy(&x, &bits, 8);
+    return x;
+  }
+
+  std::stringstream ss;
+};
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, magic) {
+  stan::callbacks::binary_writer writer(ss, false);
+  writer.finish();
+  EXPECT_EQ("STANBIN1", ss.str());
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, double_vector) {
+  stan::callbacks::binary_writer writer(ss, false);
+  std::vector<double> x{0, 1.5, -2.25};
+  EXPECT_NO_THROW(writer(x));
+  writer.finish();
+
+  ASSERT_EQ(8U + 16 + 3 * 8, ss.str().size());
+  EXPECT_EQ(stan::callbacks::binary_writer::values_record, uint64_at(8));
+  EXPECT_EQ(24U, uint64_at(16));
+  for (int n = 0; n < 3; ++n)
+    EXPECT_EQ(x[n], double_at(24 + 8 * n));
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, empty_double_vector) {
+  stan::callbacks::binary_writer writer(ss, false);
+  std::vector<double> x;
+  EXPECT_NO_THROW(writer(x));
+  writer.finish();
+  EXPECT_EQ("STANBIN1", ss.str());
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, string_vector) {
+  stan::callbacks::binary_writer writer(ss, false);
+  std::vector<std::string> x{"lp__", "theta.1"};
+  EXPECT_NO_THROW(writer(x));
+  writer.finish();
+
+  // count, two lengths and 11 characters padded to 16
+  ASSERT_EQ(8U + 16 + 8 + 8 + 8 + 16, ss.str().size());
+  EXPECT_EQ(stan::callbacks::binary_writer::names_record, uint64_at(8));
+  EXPECT_EQ(8U + 8 + 4 + 8 + 7, uint64_at(16));
+  EXPECT_EQ(2U, uint64_at(24));
+  EXPECT_EQ(4U, uint64_at(32));
+  EXPECT_EQ("lp__", ss.str().substr(40, 4));
+  EXPECT_EQ(7U, uint64_at(44));
+  EXPECT_EQ("theta.1", ss.str().substr(52, 7));
+  EXPECT_EQ(0U, ss.str().size() % 8);
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, blank_and_message) {
+  stan::callbacks::binary_writer writer(ss, false);
+  EXPECT_NO_THROW(writer());
+  EXPECT_NO_THROW(writer("message"));
+  writer.finish();
+
+  ASSERT_EQ(8U + 16 + 16 + 8, ss.str().size());
+  EXPECT_EQ(stan::callbacks::binary_writer::blank_record, uint64_at(8));
+  EXPECT_EQ(0U, uint64_at(16));
+  EXPECT_EQ(stan::callbacks::binary_writer::message_record, uint64_at(24));
+  EXPECT_EQ(7U, uint64_at(32));
+  EXPECT_EQ("message", ss.str().substr(40, 7));
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, index) {
+  {
+    stan::callbacks::binary_writer writer(ss);
+    std::vector<double> x{1, 2};
+    writer(x);
+    writer(x);
+    writer("Adaptation terminated");
+    writer(x);
+  }
+
+  std::string out = ss.str();
+  ASSERT_EQ("STANIDX1", out.substr(out.size() - 8));
+  uint64_t index_offset = uint64_at(out.size() - 16);
+  EXPECT_EQ(stan::callbacks::binary_writer::index_record,
+            uint64_at(index_offset));
+  ASSERT_EQ(2U * 24, uint64_at(index_offset + 8));
+
+  size_t entry = index_offset + 16;
+  EXPECT_EQ(8U, uint64_at(entry));
+  EXPECT_EQ(2U, uint64_at(entry + 8));
+  EXPECT_EQ(2U, uint64_at(entry + 16));
+
+  // two draws of 32 bytes, then a 16 + 24 byte message
+  EXPECT_EQ(8U + 2 * 32 + 40, uint64_at(entry + 24));
+  EXPECT_EQ(1U, uint64_at(entry + 32));
+  EXPECT_EQ(2U, uint64_at(entry + 40));
+
+  // draws of a run are laid out with a stride of cols + 2 doubles
+  EXPECT_EQ(1.0, double_at(8 + 16));
+  EXPECT_EQ(1.0, double_at(8 + 16 + 8 * (2 + 2)));
+  EXPECT_EQ(2.0, double_at(8 + 16 + 8 * (2 + 2) + 8));
+}
+
+TEST_F(StanInterfaceCallbacksBinaryWriter, column_types) {
+  using stan::io::column_type;
+  stan::callbacks::binary_writer writer(ss, false);
+  writer.set_column_types({column_type::float64, column_type::float32,
+                           column_type::int32, column_type::uint8});
+  writer(std::vector<double>{-1.5, 0.25, 7, 1});
+  writer(std::vector<double>{2, 3});
+  writer.finish();
+
+  // count and four type bytes padded to 16
+  EXPECT_EQ(stan::callbacks::binary_writer::column_types_record,
+            uint64_at(8));
+  EXPECT_EQ(12U, uint64_at(16));
+  EXPECT_EQ(4U, uint64_at(24));
+  EXPECT_EQ(2, ss.str()[34]);
+
+  // 8 + 4 + 4 + 1 bytes padded to 24
+  EXPECT_EQ(stan::callbacks::binary_writer::typed_values_record,
+            uint64_at(40));
+  EXPECT_EQ(17U, uint64_at(48));
+  EXPECT_EQ(-1.5, double_at(56));
+  EXPECT_EQ(7U, uint64_at(68) & 0xffffffff);
+  EXPECT_EQ(1, ss.str()[72]);
+
+  // draws of another width are still doubles
+  EXPECT_EQ(stan::callbacks::binary_writer::values_record, uint64_at(80));
+  EXPECT_EQ(16U, uint64_at(88));
+  EXPECT_EQ(3.0, double_at(104));
+  EXPECT_EQ(112U, ss.str().size());
+}
@@ -0,0 +1,69 @@
+#include <stan/callbacks/decimating_writer.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace test {
+class recording_writer : public stan::callbacks::writer {
+ public:
+  std::vector<std::vector<double>> rows;
+  int num_other = 0;
+
+  void operator()(const std::vector<std::string>& names) { ++num_other; }
+
+  void operator()(const std::vector<double>& state) { rows.push_back(state); }
+
+  void operator()() { ++num_other; }
+
+  void operator()(const std::string& message) { ++num_other; }
+};
+}  // namespace test
+
+TEST(StanCallbacksDecimatingWriter, thin) {
+  test::recording_writer recorder;
+  stan::callbacks::decimating_writer writer(recorder, 3);
+  writer(std::vector<std::string>{"lp__", "divergent__"});
+  for (int n = 0; n < 10; ++n)
+    writer(std::vector<double>{static_cast<double>(n), 0});
+  writer("Elapsed Time");
+  writer();
+
+  ASSERT_EQ(4U, recorder.rows.size());
+  EXPECT_EQ(0, recorder.rows[0][0]);
+  EXPECT_EQ(3, recorder.rows[1][0]);
+  EXPECT_EQ(9, recorder.rows[3][0]);
+  EXPECT_EQ(3, recorder.num_other);
+}
+
+TEST(StanCallbacksDecimatingWriter, single_precision) {
+  test::recording_writer recorder;
+  stan::callbacks::decimating_writer writer(recorder, 1, true);
+  writer(std::vector<double>{0.1, 1.0 / 3});
+  ASSERT_EQ(1U, recorder.rows.size());
+  EXPECT_EQ(static_cast<double>(0.1f), recorder.rows[0][0]);
+  EXPECT_EQ(static_cast<double>(1.0f / 3), recorder.rows[0][1]);
+}
+
+TEST(StanCallbacksDecimatingWriter, window) {
+  test::recording_writer recorder;
+  stan::callbacks::decimating_writer writer(recorder, 5, false, 2);
+  writer(std::vector<std::string>{"lp__", "divergent__"});
+  for (int n = 0; n < 20; ++n)
+    writer(std::vector<double>{static_cast<double>(n),
+                               n == 6 || n == 15 ? 1.0 : 0.0});
+
+  // Two rows before and after each divergent row
+  std::vector<double> expected{4, 5, 6, 7, 8, 13, 14, 15, 16, 17};
+  ASSERT_EQ(expected.size(), recorder.rows.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    EXPECT_EQ(expected[i], recorder.rows[i][0]);
+}
+
+TEST(StanCallbacksDecimatingWriter, no_trigger_column) {
+  test::recording_writer recorder;
+  stan::callbacks::decimating_writer writer(recorder, 1, false, 2);
+  writer(std::vector<std::string>{"lp__", "accept_stat__"});
+  for (int n = 0; n < 5; ++n)
+    writer(std::vector<double>{static_cast<double>(n), 1});
+  EXPECT_EQ(0U, recorder.rows.size());
+}
@@ -0,0 +1,109 @@
+#include <stan/callbacks/fanout_writer.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace test {
+// Blocks in its first call until released
+class gated_writer : public stan::callbacks::writer {
+ public:
+  std::atomic<bool> entered;
+  std::atomic<bool> released;
+  std::vector<std::vector<double>> states;
+
+  gated_writer() : entered(false), released(false) {}
+
+  void operator()(const std::vector<double>& state) {
+    entered = true;
+    while (!released)
+      std::this_thread::yield();
+    states.push_back(state);
+  }
+};
+
+class throwing_writer : public stan::callbacks::writer {
+ public:
+  void operator()(const std::vector<double>& state) {
+    throw std::runtime_error("disk full");
+  }
+};
+}  // namespace test
+
+TEST(StanCallbacksFanoutWriter, matches_stream_writer) {
+  std::stringstream expected_ss, ss1, ss2, ss3;
+  stan::callbacks::stream_writer expected(expected_ss, "# ");
+  stan::callbacks::stream_writer stream1(ss1, "# ");
+  stan::callbacks::stream_writer stream2(ss2, "# ");
+  stan::callbacks::stream_writer stream3(ss3, "# ");
+
+  std::vector<std::string> names{"lp__", "accept_stat__", "theta"};
+  {
+    stan::callbacks::fanout_writer writer(4);
+    writer.add(stream1);
+    writer.add(stream2);
+    writer.add(stream3, false);
+    expected(names);
+    writer(names);
+    for (int n = 0; n < 100; ++n) {
+      std::vector<double> state{-n * 0.5, 0.9, n * 1.5};
+      expected(state);
+      writer(state);
+    }
+    EXPECT_EQ(expected_ss.str(), ss3.str()) << "direct sink";
+    expected();
+    writer();
+    EXPECT_EQ(expected_ss.str(), ss1.str()) << "flushed by the blank line";
+    EXPECT_EQ(expected_ss.str(), ss2.str()) << "flushed by the blank line";
+
+    expected("Elapsed Time: 1 seconds");
+    writer("Elapsed Time: 1 seconds");
+    EXPECT_EQ(0U, writer.num_dropped());
+  }
+  EXPECT_EQ(expected_ss.str(), ss1.str());
+  EXPECT_EQ(expected_ss.str(), ss2.str());
+  EXPECT_EQ(expected_ss.str(), ss3.str());
+}
+
+TEST(StanCallbacksFanoutWriter, slow_sink_drop) {
+  test::gated_writer slow;
+  std::stringstream ss;
+  stan::callbacks::stream_writer fast(ss);
+  stan::callbacks::fanout_writer writer(2, stan::callbacks::backpressure::drop);
+  writer.add(slow);
+  writer.add(fast);
+
+  writer(std::vector<double>{1});
+  while (!slow.entered)
+    std::this_thread::yield();
+  // The first draw is still being forwarded by the slow sink
+  for (int n = 2; n <= 5; ++n)
+    writer(std::vector<double>{static_cast<double>(n)});
+  EXPECT_EQ(3U, writer.num_dropped());
+
+  slow.released = true;
+  writer.flush();
+  ASSERT_EQ(2U, slow.states.size());
+  EXPECT_EQ(1, slow.states[0][0]);
+  EXPECT_EQ(2, slow.states[1][0]);
+  EXPECT_EQ("1\n2\n", ss.str());
+}
+
+TEST(StanCallbacksFanoutWriter, rethrows) {
+  test::throwing_writer throwing;
+  std::stringstream ss;
+  stan::callbacks::stream_writer stream(ss);
+  stan::callbacks::fanout_writer writer;
+  writer.add(throwing);
+  writer.add(stream);
+  writer(std::vector<double>{1});
+  EXPECT_THROW(writer.flush(), std::runtime_error);
+  EXPECT_EQ("1\n", ss.str());
+  EXPECT_THROW(writer.add(stream), std::logic_error);
+}
+
+TEST(StanCallbacksFanoutWriter, zero_capacity) {
+  EXPECT_THROW(stan::callbacks::fanout_writer(0), std::invalid_argument);
+}
@@ -0,0 +1,46 @@
+#include <stan/callbacks/matrix_writer.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(StanCallbacksMatrixWriter, draws) {
+  stan::callbacks::matrix_writer writer(3);
+  writer("Adaptation terminated");
+  writer(std::vector<std::string>{"lp__", "theta"});
+  EXPECT_EQ(0, writer.num_draws());
+  EXPECT_EQ(0, writer.draws().rows());
+  EXPECT_EQ(2, writer.draws().cols());
+
+  for (int n = 0; n < 3; ++n)
+    writer(std::vector<double>{-1.0 * n, 0.5 * n});
+  writer();
+
+  ASSERT_EQ(3, writer.draws().rows());
+  for (int n = 0; n < 3; ++n) {
+    EXPECT_EQ(-1.0 * n, writer.draws()(n, 0));
+    EXPECT_EQ(0.5 * n, writer.draws()(n, 1));
+  }
+  ASSERT_EQ(2U, writer.names().size());
+  EXPECT_EQ("theta", writer.names()[1]);
+  ASSERT_EQ(2U, writer.messages().size());
+  EXPECT_EQ("Adaptation terminated", writer.messages()[0]);
+  EXPECT_EQ("", writer.messages()[1]);
+}
+
+TEST(StanCallbacksMatrixWriter, grows) {
+  stan::callbacks::matrix_writer writer(2);
+  writer(std::vector<std::string>{"lp__"});
+  for (int n = 0; n < 7; ++n)
+    writer(std::vector<double>{static_cast<double>(n)});
+  ASSERT_EQ(7, writer.num_draws());
+  for (int n = 0; n < 7; ++n)
+    EXPECT_EQ(n, writer.draws()(n, 0));
+}
+
+TEST(StanCallbacksMatrixWriter, wrong_size) {
+  stan::callbacks::matrix_writer writer(2);
+  writer(std::vector<std::string>{"lp__", "theta"});
+  EXPECT_THROW(writer(std::vector<double>{1}), std::invalid_argument);
+  EXPECT_EQ(0, writer.num_draws());
+}
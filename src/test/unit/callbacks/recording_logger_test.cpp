@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stan/callbacks/recording_logger.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+
+TEST(StanInterfaceCallbacksRecordingLogger, replay_in_order) {
+  stan::callbacks::recording_logger recorder;
+  std::stringstream message;
+  message << "message 2";
+  recorder.info("message 1");
+  recorder.warn(message);
+  recorder.info("message 3");
+  recorder.debug("message 4");
+  recorder.error("message 5");
+  recorder.fatal("message 6");
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+  recorder.replay(logger);
+
+  EXPECT_EQ("message 4\n", debug.str());
+  EXPECT_EQ("message 1\nmessage 3\n", info.str());
+  EXPECT_EQ("message 2\n", warn.str());
+  EXPECT_EQ("message 5\n", error.str());
+  EXPECT_EQ("message 6\n", fatal.str());
+
+  // Replaying again logs the messages again
+  recorder.replay(logger);
+  EXPECT_EQ("message 1\nmessage 3\nmessage 1\nmessage 3\n", info.str());
+}
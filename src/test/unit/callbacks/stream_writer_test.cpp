@@ -47,3 +47,32 @@ TEST_F(StanInterfaceCallbacksStreamWriter, string) {
   EXPECT_NO_THROW(writer("message"));
   EXPECT_EQ("message\n", ss.str());
 }
+
+TEST_F(StanInterfaceCallbacksStreamWriter, fast_format_shortest) {
+  std::vector<double> x{0, 1, -2.5, 0.1, 1.0 / 3, 1e-300, 6.02214076e23};
+  writer.use_fast_format();
+  EXPECT_NO_THROW(writer(x));
+
+  std::string row = ss.str();
+  ASSERT_EQ('\n', row.back());
+  std::stringstream row_ss(row);
+  std::string value;
+  for (size_t i = 0; i < x.size(); ++i) {
+    ASSERT_TRUE(std::getline(row_ss, value, i + 1 < x.size() ? ',' : '\n'));
+    EXPECT_EQ(x[i], std::stod(value)) << "round trip of " << value;
+  }
+  EXPECT_EQ("0,1,-2.5,0.1,", row.substr(0, 13));
+}
+
+TEST_F(StanInterfaceCallbacksStreamWriter, fast_format_precision) {
+  std::vector<double> x{0, 1, -2.5, 0.1, 1.0 / 3, 1e-300, 6.02214076e23,
+                        123456789};
+  std::stringstream expected;
+  stan::callbacks::stream_writer stream_formatted(expected);
+  expected.precision(4);
+  stream_formatted(x);
+
+  writer.use_fast_format(4);
+  writer(x);
+  EXPECT_EQ(expected.str(), ss.str());
+}
@@ -62,6 +62,23 @@ TEST(array_var_context, ctor_int) {
   EXPECT_EQ(array_dim, avc.dims_i("gamma"));
 }
 
+TEST(array_var_context, names_sorted) {
+  std::vector<std::string> names_r{"theta", "alpha"};
+  std::vector<double> values_r{1.5, 2.5};
+  std::vector<std::vector<size_t>> dims_r{{}, {}};
+  std::vector<std::string> names_i{"N", "K"};
+  std::vector<int> values_i{3, 4};
+  std::vector<std::vector<size_t>> dims_i{{}, {}};
+  stan::io::array_var_context avc(names_r, values_r, dims_r, names_i,
+                                  values_i, dims_i);
+
+  std::vector<std::string> names;
+  avc.names_r(names);
+  EXPECT_EQ((std::vector<std::string>{"alpha", "theta"}), names);
+  avc.names_i(names);
+  EXPECT_EQ((std::vector<std::string>{"K", "N"}), names);
+}
+
 TEST(array_var_context, ctor_real) {
   std::vector<double> v;
   for (size_t i = 0; i < 16; i++) {
@@ -0,0 +1,101 @@
+#include <stan/io/binary_var_context.hpp>
+#include <stan/io/dump.hpp>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+const char* dump_text
+    = "N <- 3\n"
+      "y <- c(1.5, -2, 2.5)\n"
+      "x <- structure(1:6, .Dim = c(2, 3))\n"
+      "sigma <- 0.25\n"
+      "z <- integer(0)\n";
+
+void expect_matches_dump(const stan::io::var_context& context) {
+  std::stringstream in(dump_text);
+  stan::io::dump dump(in);
+  std::vector<std::string> names, expected_names;
+  context.names_r(names);
+  dump.names_r(expected_names);
+  EXPECT_EQ(expected_names, names);
+  context.names_i(names);
+  dump.names_i(expected_names);
+  EXPECT_EQ(expected_names, names);
+  for (const std::string name : {"N", "y", "x", "sigma", "z"}) {
+    EXPECT_EQ(dump.contains_r(name), context.contains_r(name)) << name;
+    EXPECT_EQ(dump.contains_i(name), context.contains_i(name)) << name;
+    EXPECT_EQ(dump.vals_r(name), context.vals_r(name)) << name;
+    EXPECT_EQ(dump.dims_r(name), context.dims_r(name)) << name;
+    EXPECT_EQ(dump.vals_i(name), context.vals_i(name)) << name;
+    EXPECT_EQ(dump.dims_i(name), context.dims_i(name)) << name;
+    EXPECT_EQ(dump.vals_r(name), context.vals_r_view(name).to_vector())
+        << name;
+    EXPECT_EQ(dump.vals_i(name), context.vals_i_view(name).to_vector())
+        << name;
+  }
+  EXPECT_FALSE(context.contains_r("missing"));
+  EXPECT_TRUE(context.vals_r("missing").empty());
+}
+
+std::string binary_data() {
+  std::stringstream in(dump_text);
+  stan::io::dump dump(in);
+  std::stringstream out;
+  stan::io::binary_var_context::write(out, dump);
+  return out.str();
+}
+}  // namespace
+
+TEST(ioBinaryVarContext, mapped_file) {
+  std::string path = "binary_var_context_test.bin";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << binary_data();
+  }
+  {
+    stan::io::binary_var_context context(path);
+    expect_matches_dump(context);
+    EXPECT_NO_THROW(context.validate_dims("data", "x", "int", {2, 3}));
+    EXPECT_THROW(context.validate_dims("data", "x", "int", {3, 2}),
+                 std::exception);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(ioBinaryVarContext, memory) {
+  std::string data = binary_data();
+  std::vector<uint64_t> aligned((data.size() + 7) / 8);
+  std::memcpy(aligned.data(), data.data(), data.size());
+  stan::io::binary_var_context context(
+      reinterpret_cast<const char*>(aligned.data()), data.size());
+  expect_matches_dump(context);
+  // Doubles are viewed in the file's memory
+  stan::io::values_view<double> y = context.vals_r_view("y");
+  EXPECT_FALSE(y.owns_values());
+  const char* begin = reinterpret_cast<const char*>(aligned.data());
+  const char* y_data = reinterpret_cast<const char*>(y.data());
+  EXPECT_TRUE(y_data >= begin && y_data < begin + data.size());
+}
+
+TEST(ioBinaryVarContext, invalid) {
+  EXPECT_THROW(stan::io::binary_var_context("no_such_file.bin"),
+               std::invalid_argument);
+
+  std::string data = binary_data();
+  std::vector<uint64_t> aligned((data.size() + 7) / 8);
+  std::memcpy(aligned.data(), data.data(), data.size());
+  const char* begin = reinterpret_cast<const char*>(aligned.data());
+  EXPECT_THROW(stan::io::binary_var_context(begin, 40), std::invalid_argument);
+  EXPECT_THROW(stan::io::binary_var_context(begin, data.size() - 8),
+               std::invalid_argument);
+  aligned[0] = 0;
+  EXPECT_THROW(stan::io::binary_var_context(begin, data.size()),
+               std::invalid_argument);
+}
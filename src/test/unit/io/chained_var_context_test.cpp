@@ -53,3 +53,40 @@ TEST(chained_var_context, ctor) {
   std::vector<double> alpha(1, 0);
   EXPECT_EQ(alpha, vcc.vals_r("alpha"));
 }
+
+TEST(chained_var_context, vals_view) {
+  std::vector<std::string> names_r{"alpha", "beta"};
+  std::vector<double> v{1.5, 2, 3, 4};
+  std::vector<std::vector<size_t> > dims_r{{}, {3}};
+  stan::io::array_var_context avc1(names_r, v, dims_r);
+
+  std::vector<std::string> names_i{"n", "beta"};
+  std::vector<int> vi{7, 8, 9};
+  std::vector<std::vector<size_t> > dims_i{{}, {2}};
+  stan::io::array_var_context avc2(names_i, vi, dims_i);
+
+  stan::io::chained_var_context cvc(avc1, avc2);
+
+  // Stored doubles are viewed in place
+  stan::io::values_view<double> beta = cvc.vals_r_view("beta");
+  ASSERT_EQ(3U, beta.size());
+  EXPECT_FALSE(beta.owns_values());
+  EXPECT_EQ(avc1.vals_r_view("beta").data(), beta.data());
+  EXPECT_EQ(cvc.vals_r("beta"), beta.to_vector());
+
+  stan::io::values_view<int> n = cvc.vals_i_view("n");
+  ASSERT_EQ(1U, n.size());
+  EXPECT_FALSE(n.owns_values());
+  EXPECT_EQ(7, n[0]);
+
+  // Integers viewed as doubles are copied
+  stan::io::values_view<double> n_r = cvc.vals_r_view("n");
+  EXPECT_TRUE(n_r.owns_values());
+  EXPECT_EQ(std::vector<double>{7}, n_r.to_vector());
+  stan::io::values_view<double> moved(std::move(n_r));
+  EXPECT_TRUE(moved.owns_values());
+  EXPECT_EQ(7, moved[0]);
+
+  EXPECT_TRUE(cvc.vals_r_view("missing").empty());
+  EXPECT_TRUE(cvc.vals_i_view("missing").empty());
+}
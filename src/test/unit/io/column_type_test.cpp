@@ -0,0 +1,41 @@
+#include <stan/io/column_type.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+
+namespace {
+double round_trip(stan::io::column_type type, double x) {
+  unsigned char bytes[8];
+  stan::io::store_column_value(type, x, bytes);
+  return stan::io::load_column_value(type, bytes);
+}
+}  // namespace
+
+TEST(ioColumnType, int32_round_trip) {
+  using stan::io::column_type;
+  EXPECT_EQ(7, round_trip(column_type::int32, 7));
+  EXPECT_EQ(-3, round_trip(column_type::int32, -2.6));
+  EXPECT_EQ(2147483647, round_trip(column_type::int32, 2147483647.0));
+  EXPECT_EQ(-2147483647, round_trip(column_type::int32, -2147483647.0));
+}
+
+TEST(ioColumnType, int32_out_of_range_is_nan) {
+  using stan::io::column_type;
+  double inf = std::numeric_limits<double>::infinity();
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, 2147483647.5)));
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, 1e10)));
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, -2147483648.0)));
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, -1e300)));
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, inf)));
+  EXPECT_TRUE(std::isnan(round_trip(column_type::int32, -inf)));
+  EXPECT_TRUE(std::isnan(round_trip(
+      column_type::int32, std::numeric_limits<double>::quiet_NaN())));
+}
+
+TEST(ioColumnType, uint8_clamped) {
+  using stan::io::column_type;
+  EXPECT_EQ(0, round_trip(column_type::uint8, -5));
+  EXPECT_EQ(254, round_trip(column_type::uint8, 1e10));
+  EXPECT_TRUE(std::isnan(round_trip(
+      column_type::uint8, std::numeric_limits<double>::quiet_NaN())));
+}
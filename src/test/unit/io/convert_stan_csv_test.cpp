@@ -0,0 +1,97 @@
+#include <stan/io/convert_stan_csv.hpp>
+#include <stan/callbacks/binary_writer.hpp>
+#include <stan/io/stan_binary_reader.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+std::string chain_csv(double step_size, double offset) {
+  std::stringstream csv;
+  csv << "# model = test_model\n"
+      << "# num_samples = 3\n"
+      << "# num_warmup = 2\n"
+      << "# save_warmup = 1\n"
+      << "# thin = 1\n"
+      << "lp__,accept_stat__,treedepth__,theta\n"
+      << -offset << ",0.5,1," << offset << "\n"
+      << -offset - 1 << ",0.5,2," << offset + 1 << "\n"
+      << "# Adaptation terminated\n"
+      << "# Step size = " << step_size << "\n"
+      << "# Diagonal elements of inverse mass matrix:\n"
+      << "# 0.25\n"
+      << -offset - 2 << ",0.9,3," << offset + 2 << "\n"
+      << -offset - 3 << ",0.9,3," << offset + 3 << "\n"
+      << -offset - 4 << ",0.9,3," << offset + 4 << "\n"
+      << "# \n"
+      << "#  Elapsed Time: 1 seconds (Warm-up)\n"
+      << "#                2 seconds (Sampling)\n"
+      << "#                3 seconds (Total)\n"
+      << "# \n";
+  return csv.str();
+}
+}  // namespace
+
+TEST(StanIoConvertStanCsv, merges_chains) {
+  std::stringstream chain1(chain_csv(0.5, 10)), chain2(chain_csv(0.75, 20));
+  std::stringstream binary;
+  std::vector<stan::io::stan_csv> chains;
+  {
+    stan::callbacks::binary_writer writer(binary);
+    chains = stan::io::convert_stan_csv({&chain1, &chain2}, writer,
+                                        stan::io::stan_csv_conversion(), 0);
+  }
+  ASSERT_EQ(2U, chains.size());
+  EXPECT_FLOAT_EQ(0.75, chains[1].adaptation.step_size);
+  EXPECT_FLOAT_EQ(2, chains[1].timing.sampling);
+  EXPECT_EQ(0, chains[0].samples.size());
+
+  binary.seekg(0);
+  stan::io::stan_csv merged = stan::io::stan_binary_reader::parse(binary, 0);
+  std::vector<std::string> header{"chain__", "lp__", "accept_stat__",
+                                  "treedepth__", "theta"};
+  EXPECT_EQ(header, merged.header);
+  EXPECT_EQ("test_model", merged.metadata.model);
+  EXPECT_TRUE(merged.metadata.save_warmup);
+  ASSERT_EQ(10, merged.samples.rows());
+  EXPECT_FLOAT_EQ(0, merged.samples(4, 0));
+  EXPECT_FLOAT_EQ(1, merged.samples(5, 0));
+  EXPECT_FLOAT_EQ(24, merged.samples(9, 4));
+  EXPECT_FLOAT_EQ(3, merged.samples(9, 3));
+  EXPECT_FLOAT_EQ(0.5, merged.adaptation.step_size);
+  EXPECT_FLOAT_EQ(0.25, merged.adaptation.metric(0, 0));
+  EXPECT_FLOAT_EQ(2, merged.timing.warmup);
+  EXPECT_FLOAT_EQ(4, merged.timing.sampling);
+}
+
+TEST(StanIoConvertStanCsv, drop_warmup_and_thin) {
+  std::stringstream chain1(chain_csv(0.5, 10)), chain2(chain_csv(0.75, 20));
+  std::stringstream binary;
+  stan::io::stan_csv_conversion options;
+  options.drop_warmup = true;
+  options.thin = 2;
+  {
+    stan::callbacks::binary_writer writer(binary);
+    stan::io::convert_stan_csv({&chain1, &chain2}, writer, options, 0);
+  }
+  binary.seekg(0);
+  stan::io::stan_csv merged = stan::io::stan_binary_reader::parse(binary, 0);
+  EXPECT_FALSE(merged.metadata.save_warmup);
+  EXPECT_EQ(2U, merged.metadata.thin);
+  ASSERT_EQ(4, merged.samples.rows());
+  EXPECT_FLOAT_EQ(12, merged.samples(0, 4));
+  EXPECT_FLOAT_EQ(14, merged.samples(1, 4));
+  EXPECT_FLOAT_EQ(22, merged.samples(2, 4));
+}
+
+TEST(StanIoConvertStanCsv, mismatched_headers) {
+  std::stringstream chain1(chain_csv(0.5, 10));
+  std::stringstream chain2("lp__,theta\n1,2\n");
+  std::stringstream binary;
+  stan::callbacks::binary_writer writer(binary);
+  EXPECT_THROW(stan::io::convert_stan_csv({&chain1, &chain2}, writer,
+                                          stan::io::stan_csv_conversion(), 0),
+               std::invalid_argument);
+}
@@ -279,6 +279,18 @@ TEST(deserializer_array, read_vector) {
 
 // size zero
 
+TEST(deserializer_array, read_int) {
+  std::vector<int> theta_i{4, 5, 6, 7};
+  std::vector<double> theta;
+  stan::io::deserializer<double> deserializer(theta, theta_i);
+  EXPECT_EQ(4, deserializer.read<int>());
+  std::vector<int> y = deserializer.read<std::vector<int>>(2);
+  EXPECT_EQ((std::vector<int>{5, 6}), y);
+  EXPECT_EQ(1U, deserializer.available_i());
+  EXPECT_THROW(deserializer.read<std::vector<int>>(2), std::runtime_error);
+  EXPECT_EQ(7, deserializer.read<int>());
+}
+
 TEST(deserializer, zeroSizeVecs) {
   std::vector<int> theta_i;
   std::vector<double> theta;
@@ -444,6 +456,45 @@ TEST(deserializer_scalar, read_constrain_lb_constrain_jacobian) {
   EXPECT_FLOAT_EQ(-1.5 - 2.0 + 3.0 - 1.0, lp);
 }
 
+TEST(deserializer_array, read_constrain_lb_constrain) {
+  std::vector<int> theta_i;
+  std::vector<double> theta{-2.0, 3.0, -1.0, 0.0, 4.0};
+  stan::io::deserializer<double> deserializer(theta, theta_i);
+  double lp = -1.5;
+  std::vector<double> x
+      = deserializer.read_constrain_lb<std::vector<double>, true>(1.0, lp, 4);
+  ASSERT_EQ(4, x.size());
+  for (size_t i = 0; i < 4; ++i)
+    EXPECT_FLOAT_EQ(1.0 + exp(theta[i]), x[i]);
+  EXPECT_FLOAT_EQ(-1.5 - 2.0 + 3.0 - 1.0 + 0.0, lp);
+  EXPECT_EQ(1U, deserializer.available());
+  EXPECT_EQ(
+      0, (deserializer.read_constrain_lb<std::vector<double>, false>(1.0, lp,
+                                                                     0))
+             .size());
+  EXPECT_THROW((deserializer.read_constrain_lb<std::vector<double>, false>(
+                   1.0, lp, 2)),
+               std::runtime_error);
+}
+
+TEST(deserializer_array, read_constrain_lub_constrain) {
+  std::vector<int> theta_i;
+  std::vector<double> theta{-2.0, 3.0, -1.0};
+  stan::io::deserializer<double> deserializer(theta, theta_i);
+  stan::io::deserializer<double> scalar_deserializer(theta, theta_i);
+  double lp = 0.0;
+  double expected_lp = 0.0;
+  std::vector<double> x
+      = deserializer.read_constrain_lub<std::vector<double>, true>(-1.0, 2.0,
+                                                                   lp, 3);
+  for (size_t i = 0; i < 3; ++i)
+    EXPECT_FLOAT_EQ(
+        (scalar_deserializer.read_constrain_lub<double, true>(-1.0, 2.0,
+                                                              expected_lp)),
+        x[i]);
+  EXPECT_FLOAT_EQ(expected_lp, lp);
+}
+
 // ub
 
 TEST(deserializer_scalar, read_constrain_ub_constrain) {
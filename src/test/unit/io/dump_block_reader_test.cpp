@@ -0,0 +1,134 @@
+#include <stan/io/dump.hpp>
+#include <stan/io/dump_block_reader.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+// Everything read from a dump, or the message of the exception thrown
+std::string describe(stan::io::dump_reader& reader) {
+  std::stringstream out;
+  try {
+    while (reader.next()) {
+      out << reader.name() << (reader.is_int() ? " int" : " double") << " [";
+      for (size_t d : reader.dims())
+        out << d << " ";
+      out << "] ";
+      if (reader.is_int())
+        for (int n : reader.int_values())
+          out << n << " ";
+      else
+        for (double x : reader.double_values())
+          out << (std::isnan(x) ? "nan" : std::to_string(x)) << " ";
+      out << "\n";
+    }
+  } catch (const std::exception& e) {
+    out << "error: " << e.what();
+  }
+  return out.str();
+}
+
+std::string describe(stan::io::dump_block_reader& reader) {
+  std::stringstream out;
+  try {
+    while (reader.next()) {
+      out << reader.name() << (reader.is_int() ? " int" : " double") << " [";
+      for (size_t d : reader.dims())
+        out << d << " ";
+      out << "] ";
+      if (reader.is_int())
+        for (int n : reader.int_values())
+          out << n << " ";
+      else
+        for (double x : reader.double_values())
+          out << (std::isnan(x) ? "nan" : std::to_string(x)) << " ";
+      out << "\n";
+    }
+  } catch (const std::exception& e) {
+    out << "error: " << e.what();
+  }
+  return out.str();
+}
+
+void expect_same(const std::string& text) {
+  std::stringstream in(text);
+  stan::io::dump_reader reader(in);
+  std::string expected = describe(reader);
+
+  std::stringstream block_in(text);
+  stan::io::dump_block_reader block_reader(block_in, 3);
+  EXPECT_EQ(expected, describe(block_reader)) << text;
+
+  stan::io::dump_block_reader range_reader(text.data(),
+                                           text.data() + text.size());
+  EXPECT_EQ(expected, describe(range_reader)) << text;
+}
+}  // namespace
+
+TEST(ioDumpBlockReader, matches_dump_reader) {
+  std::vector<std::string> inputs{
+      "a <- 5e0",
+      "a <- 0e5",
+      "foo <- 1.0",
+      "foo <- 17",
+      "foo <- -17L",
+      "foo <- c(1, 2, 3)",
+      "foo <- c(1.5, 2, -3e2, +4)",
+      "foo <- c(1, 2.5, 3L)",
+      "foo <- c()",
+      "z <- integer(0)\nw <- double(3)\nv <- integer()",
+      "a <- structure(integer(0), .Dim = c(2, 0))",
+      "a <- structure(double(4), .Dim = c(2, 2))",
+      "a <- structure(c(1,2,3,4,5,6), .Dim = c(2,3))",
+      "a <- structure(c(1.5,2,3,4,5,6), .Dim = c(2L,3L))",
+      "a <- structure(1:6, .Dim = 2:3)",
+      "a <- structure(6:1, .Dim = 3:2)",
+      "a <- 1:10\nb <- 10:1\nc <- -2:2",
+      "'a' <- 1\n\"b\" <- c(2, 3)\nc.d_e2 <- 4",
+      "a <- c(-1.0, Inf, -Inf, 0, Infinity, 129, NaN, -4)",
+      "a <- c(1, Inf, 2)",
+      "a <- c(1, NaN)",
+      "a <- 1\n\n\n   b <- 2;\nc <- 3",
+      "a <- c( 1 ,\n 2 ,\n 3 )",
+      "a <- 2147483647",
+      "a <- -2147483647",
+      "a <- 2147483648",
+      "a <- -2147483648",
+      "a <- 99999999999999999999999L",
+      "a <- structure(c(1,2), .Dim = c(99999999999999999999999999))",
+      "a <- 2.797693134862316991999E+309912",
+      "a <- 4.940656458412465E-324994079409",
+      "a <- 1.7976931348623157e308",
+      "a <- 4.9e-324",
+      "a <- 0.000",
+      "a <- 1e",
+      "a <- 1-2",
+      "a <- c(1,2,3, ",
+      "a <- c(1:2 ",
+      "a <- structure(1:2, .Dim = c(2,3) ",
+      "a <- integer(3",
+      "a <- double(-1)",
+      "a <- NA",
+      "a <- ",
+      "a = 1",
+      "1a <- 1",
+      "",
+      "   \n  "};
+  for (const std::string& input : inputs)
+    expect_same(input);
+}
+
+TEST(ioDumpBlockReader, dump_var_context) {
+  std::stringstream in(
+      "N <- 3\ny <- c(1.5, 2, 2.5)\nx <- structure(1:6, .Dim = c(2, 3))");
+  stan::io::dump dump(in);
+  EXPECT_TRUE(dump.contains_i("N"));
+  EXPECT_EQ(std::vector<int>{3}, dump.vals_i("N"));
+  EXPECT_EQ((std::vector<double>{1.5, 2, 2.5}), dump.vals_r("y"));
+  EXPECT_EQ((std::vector<size_t>{3}), dump.dims_r("y"));
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5, 6}), dump.vals_i("x"));
+  EXPECT_EQ((std::vector<size_t>{2, 3}), dump.dims_i("x"));
+}
@@ -292,6 +292,16 @@ TEST(io_dump, reader_nan_inf) {
   test_list2(reader, "a", expected_vals, expected_dims);
 }
 
+TEST(io_dump, reader_int_then_inf) {
+  std::vector<double> expected_vals{
+      1, std::numeric_limits<double>::infinity(), 2,
+      std::numeric_limits<double>::quiet_NaN()};
+  std::vector<size_t> expected_dims{expected_vals.size()};
+  std::stringstream in("a <- c(1, Inf, 2, NaN)");
+  stan::io::dump_reader reader(in);
+  test_list2(reader, "a", expected_vals, expected_dims);
+}
+
 TEST(io_dump, reader_vec_double) {
   std::vector<double> expected_vals;
   expected_vals.push_back(1.0);
@@ -683,3 +693,30 @@ TEST(io_dump, too_large_zero_array) {
   test_exception(
       "a <- structure(double(999918446744073709551616L), .Dim = c(2,3))");
 }
+
+TEST(io_dump, vals_view) {
+  std::stringstream in("y <- c(1.5, 2, 2.5)\nn <- c(3, 4)");
+  stan::io::dump dump(in);
+  stan::io::values_view<double> y = dump.vals_r_view("y");
+  EXPECT_FALSE(y.owns_values());
+  EXPECT_EQ(dump.vals_r("y"), y.to_vector());
+  stan::io::values_view<int> n = dump.vals_i_view("n");
+  EXPECT_FALSE(n.owns_values());
+  EXPECT_EQ(dump.vals_i("n"), n.to_vector());
+  stan::io::values_view<double> n_r = dump.vals_r_view("n");
+  EXPECT_TRUE(n_r.owns_values());
+  EXPECT_EQ(dump.vals_r("n"), n_r.to_vector());
+  EXPECT_TRUE(dump.vals_i_view("y").empty());
+  EXPECT_TRUE(dump.vals_r_view("missing").empty());
+}
+
+TEST(io_dump, names_sorted) {
+  std::string txt = "b <- 2.5\na <- 1.5\nN <- 3\nK <- 4\n";
+  std::stringstream in(txt);
+  stan::io::dump dump(in);
+  std::vector<std::string> names;
+  dump.names_r(names);
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), names);
+  dump.names_i(names);
+  EXPECT_EQ((std::vector<std::string>{"K", "N"}), names);
+}
@@ -1,5 +1,9 @@
 #include <stan/io/program_reader.hpp>
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <utime.h>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
@@ -279,3 +283,49 @@ TEST(prog_reader, allowSequential) {
   stan::io::program_reader reader(ss, "foo", search_path);
   EXPECT_EQ("functions {\n// foo\n// foo\n}\nmodel { }\n", reader.program());
 }
+TEST(prog_reader, sharedCache) {
+  using std::string;
+  using std::vector;
+  std::stringstream ss1;
+  ss1 << "functions {\n"
+      << "#include simple1.stan\n"
+      << "#include simple1.stan\n"
+      << "}\n";
+  vector<string> search_path = create_search_path();
+  stan::io::program_file_cache cache;
+  stan::io::program_reader reader1(ss1, "foo", search_path, cache);
+  EXPECT_EQ("functions {\n// foo\n// foo\n}\n", reader1.program());
+  EXPECT_EQ(1U, cache.size());
+
+  std::string program = "#include simple1.stan\n#include incl_one.stan\n";
+  std::stringstream ss2(program);
+  stan::io::program_reader reader2(ss2, "bar", search_path, cache);
+  EXPECT_EQ(2U, cache.size());
+  std::stringstream ss3(program);
+  stan::io::program_reader reader3(ss3, "bar", search_path);
+  EXPECT_EQ(reader3.program(), reader2.program());
+  EXPECT_EQ(reader3.history().size(), reader2.history().size());
+}
+TEST(prog_reader, cacheRereadsChangedFile) {
+  std::string incl = "stan_program_reader_test_changed.stan";
+  { std::ofstream(incl) << "// one\n"; }
+  std::vector<std::string> search_path{"./"};
+  stan::io::program_file_cache cache;
+
+  std::stringstream ss1("#include " + incl + "\n");
+  stan::io::program_reader reader1(ss1, "foo", search_path, cache);
+  EXPECT_EQ("// one\n", reader1.program());
+
+  { std::ofstream(incl) << "// two\n// three\n"; }
+  struct stat info;
+  ASSERT_EQ(0, stat(incl.c_str(), &info));
+  struct utimbuf times;
+  times.actime = info.st_atime;
+  times.modtime = info.st_mtime + 3600;
+  ASSERT_EQ(0, utime(incl.c_str(), &times));
+  std::stringstream ss2("#include " + incl + "\n");
+  stan::io::program_reader reader2(ss2, "foo", search_path, cache);
+  EXPECT_EQ("// two\n// three\n", reader2.program());
+  EXPECT_EQ(1U, cache.size());
+  std::remove(incl.c_str());
+}
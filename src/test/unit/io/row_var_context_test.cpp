@@ -0,0 +1,55 @@
+#include <stan/io/row_var_context.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(row_var_context, set_row) {
+  std::vector<std::string> names{"mu", "sigma", "Omega"};
+  std::vector<std::vector<size_t>> dims{{}, {2}, {2, 2}};
+  stan::io::row_var_context context(names, dims);
+  EXPECT_EQ(7, context.size());
+
+  std::vector<double> row1{1, 2, 3, 4, 5, 6, 7};
+  std::vector<double> row2{-1, -2, -3, -4, -5, -6, -7};
+  context.set_row(row1.data());
+  EXPECT_TRUE(context.contains_r("sigma"));
+  EXPECT_FALSE(context.contains_r("tau"));
+  EXPECT_FALSE(context.contains_i("mu"));
+  EXPECT_EQ((std::vector<double>{1}), context.vals_r("mu"));
+  EXPECT_EQ((std::vector<double>{2, 3}), context.vals_r("sigma"));
+  EXPECT_EQ((std::vector<size_t>{2, 2}), context.dims_r("Omega"));
+  EXPECT_TRUE(context.vals_r("tau").empty());
+  EXPECT_TRUE(context.dims_r("tau").empty());
+
+  context.set_row(row2.data());
+  EXPECT_EQ((std::vector<double>{-4, -5, -6, -7}), context.vals_r("Omega"));
+  stan::io::values_view<double> view = context.vals_r_view("sigma");
+  EXPECT_FALSE(view.owns_values());
+  EXPECT_EQ(row2.data() + 1, view.data());
+  EXPECT_EQ(2, view.size());
+
+  std::vector<std::string> listed;
+  context.names_r(listed);
+  EXPECT_EQ((std::vector<std::string>{"Omega", "mu", "sigma"}), listed);
+  context.names_i(listed);
+  EXPECT_TRUE(listed.empty());
+}
+
+TEST(row_var_context, validate_dims) {
+  stan::io::row_var_context context({"sigma"}, {{2}});
+  std::vector<double> row{1, 2};
+  context.set_row(row.data());
+  EXPECT_NO_THROW(context.validate_dims("test", "sigma", "double", {2}));
+  EXPECT_THROW(context.validate_dims("test", "sigma", "double", {3}),
+               std::runtime_error);
+  EXPECT_THROW(context.validate_dims("test", "sigma", "int", {2}),
+               std::runtime_error);
+}
+
+TEST(row_var_context, invalid) {
+  EXPECT_THROW(stan::io::row_var_context({"a", "b"}, {{}}),
+               std::invalid_argument);
+  EXPECT_THROW(stan::io::row_var_context({"a", "a"}, {{}, {}}),
+               std::invalid_argument);
+}
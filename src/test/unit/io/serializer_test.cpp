@@ -172,6 +172,31 @@ TEST(serializer_stdvector, complex_write) {
   EXPECT_THROW(serializer.write(4), std::runtime_error);
 }
 
+TEST(serializer_stdvector, write_int) {
+  std::vector<double> theta(3, 0.0);
+  stan::io::serializer<double> serializer(theta);
+  serializer.write(std::vector<int>{1, -2});
+  EXPECT_FLOAT_EQ(1.0, theta[0]);
+  EXPECT_FLOAT_EQ(-2.0, theta[1]);
+  EXPECT_THROW(serializer.write(std::vector<int>{3, 4}), std::runtime_error);
+  EXPECT_EQ(1U, serializer.available());
+}
+
+TEST(serializer, write_to_buffer) {
+  Eigen::MatrixXd draws = Eigen::MatrixXd::Zero(5, 2);
+  for (int j = 0; j < 2; ++j) {
+    stan::io::serializer<double> serializer(draws.col(j).data(), 5);
+    serializer.write(j + 1.0);
+    serializer.write(std::vector<double>{j + 2.0, j + 3.0});
+    serializer.write(Eigen::Vector2d(j + 4.0, j + 5.0));
+    EXPECT_EQ(0U, serializer.available());
+    EXPECT_THROW(serializer.write(1.0), std::runtime_error);
+  }
+  for (int j = 0; j < 2; ++j)
+    for (int i = 0; i < 5; ++i)
+      EXPECT_FLOAT_EQ(i + j + 1.0, draws(i, j));
+}
+
 // size zero
 
 TEST(serializer, zeroSizeVecs) {
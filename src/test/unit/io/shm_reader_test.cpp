@@ -0,0 +1,81 @@
+#include <stan/io/shm_reader.hpp>
+#include <stan/callbacks/shm_writer.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class StanIoShmReader : public testing::Test {
+ public:
+  StanIoShmReader()
+      : name("stan_shm_reader_test_"
+             + std::to_string(::testing::UnitTest::GetInstance()->random_seed())
+             + "_"
+             + ::testing::UnitTest::GetInstance()->current_test_info()->name()),
+        names{"lp__", "theta"} {}
+
+  std::string name;
+  std::vector<std::string> names;
+};
+
+TEST_F(StanIoShmReader, chains_share_segment) {
+  stan::callbacks::shm_segment segment(name, 2, 8);
+  stan::callbacks::shm_writer writer0(segment, 0);
+  stan::callbacks::shm_writer writer1(segment, 1);
+
+  stan::io::shm_reader reader(name);
+  EXPECT_FALSE(reader.open()) << "nothing published yet";
+
+  writer0(names);
+  writer1(names);
+  writer0("Adaptation terminated");
+  ASSERT_TRUE(reader.open());
+  EXPECT_EQ(2U, reader.num_chains());
+  ASSERT_EQ(2U, reader.names().size());
+  EXPECT_EQ("theta", reader.names()[1]);
+
+  std::vector<std::vector<double>> draws;
+  EXPECT_EQ(0U, reader.read(0, draws));
+
+  for (int n = 0; n < 3; ++n) {
+    writer0(std::vector<double>{-1.0 * n, 0.5 * n});
+    writer1(std::vector<double>{-2.0 * n, 1.5 * n});
+  }
+  ASSERT_EQ(3U, reader.read(0, draws));
+  EXPECT_EQ(0.5, draws[1][1]);
+  EXPECT_EQ(0U, reader.read(0, draws)) << "already read";
+
+  writer1(std::vector<double>{-6, 4.5});
+  draws.clear();
+  ASSERT_EQ(4U, reader.read(1, draws));
+  EXPECT_EQ(-4, draws[2][0]);
+  EXPECT_EQ(4.5, draws[3][1]);
+  EXPECT_EQ(0U, reader.num_missed(1));
+}
+
+TEST_F(StanIoShmReader, overrun) {
+  stan::callbacks::shm_segment segment(name, 1, 4);
+  stan::callbacks::shm_writer writer(segment, 0);
+  writer(names);
+  stan::io::shm_reader reader(name);
+  ASSERT_TRUE(reader.open());
+
+  for (int n = 0; n < 10; ++n)
+    writer(std::vector<double>{static_cast<double>(n), 0});
+  std::vector<std::vector<double>> draws;
+  ASSERT_EQ(4U, reader.read(0, draws));
+  EXPECT_EQ(6U, reader.num_missed(0));
+  EXPECT_EQ(6, draws[0][0]);
+  EXPECT_EQ(9, draws[3][0]);
+}
+
+TEST_F(StanIoShmReader, mismatch) {
+  stan::callbacks::shm_segment segment(name, 2, 4);
+  stan::callbacks::shm_writer writer0(segment, 0);
+  stan::callbacks::shm_writer writer1(segment, 1);
+  writer0(names);
+  EXPECT_THROW(writer1(std::vector<std::string>{"lp__"}),
+               std::invalid_argument);
+  EXPECT_THROW(writer0(std::vector<double>{1}), std::invalid_argument);
+  EXPECT_THROW(stan::callbacks::shm_segment(name, 0), std::invalid_argument);
+}
@@ -0,0 +1,216 @@
+#include <stan/io/stan_binary_reader.hpp>
+#include <stan/callbacks/binary_writer.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <stan/callbacks/tee_writer.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class StanIoStanBinaryReader : public testing::Test {
+ public:
+  StanIoStanBinaryReader()
+      : csv_writer(csv, "# "),
+        binary_writer(binary),
+        writer(csv_writer, binary_writer) {
+    csv.precision(17);
+  }
+
+  /**
+   * Writes the output of a short run the way the services do.
+   */
+  void write_run() {
+    writer("stan_version_major = 2");
+    writer("stan_version_minor = 26");
+    writer("stan_version_patch = 1");
+    writer("model = test_model");
+    writer("num_samples = 3 (Default)");
+    writer("num_warmup = 2");
+    writer("id = 4");
+    writer("seed = 1234");
+    writer("algorithm = hmc (Default)");
+    writer("engine = nuts (Default)");
+    writer("max_depth = 10 (Default)");
+    writer(std::vector<std::string>{"lp__", "accept_stat__", "theta.1",
+                                    "theta.2", "sigma"});
+    writer("Adaptation terminated");
+    writer("Step size = 0.8");
+    writer("Diagonal elements of inverse mass matrix:");
+    writer("1.5, 0.25, 2");
+    for (int n = 0; n < 3; ++n)
+      writer(std::vector<double>{-7.0 - n, 0.9, 0.1 * n, 1.0 / (n + 3),
+                                 2.0 + n});
+    writer();
+    writer(" Elapsed Time: 0.5 seconds (Warm-up)");
+    writer("               0.25 seconds (Sampling)");
+    writer("               0.75 seconds (Total)");
+    writer();
+    binary_writer.finish();
+  }
+
+  std::stringstream csv;
+  std::stringstream binary;
+  stan::callbacks::stream_writer csv_writer;
+  stan::callbacks::binary_writer binary_writer;
+  stan::callbacks::tee_writer writer;
+};
+
+TEST_F(StanIoStanBinaryReader, is_binary) {
+  write_run();
+  EXPECT_TRUE(stan::io::stan_binary_reader::is_binary(binary));
+  EXPECT_EQ(0, binary.tellg());
+  EXPECT_FALSE(stan::io::stan_binary_reader::is_binary(csv));
+}
+
+TEST_F(StanIoStanBinaryReader, matches_csv) {
+  write_run();
+  std::stringstream out;
+  stan::io::stan_csv expected
+      = stan::io::stan_csv_reader::parse(csv, &out);
+  stan::io::stan_csv data = stan::io::stan_binary_reader::parse(binary, &out);
+  EXPECT_EQ("", out.str());
+
+  EXPECT_EQ(expected.metadata.stan_version_minor,
+            data.metadata.stan_version_minor);
+  EXPECT_EQ("test_model", data.metadata.model);
+  EXPECT_EQ(3U, data.metadata.num_samples);
+  EXPECT_EQ(2U, data.metadata.num_warmup);
+  EXPECT_EQ(4U, data.metadata.chain_id);
+  EXPECT_EQ(1234U, data.metadata.seed);
+  EXPECT_EQ("hmc", data.metadata.algorithm);
+  EXPECT_EQ("nuts", data.metadata.engine);
+
+  ASSERT_EQ(expected.header.size(), data.header.size());
+  for (size_t n = 0; n < expected.header.size(); ++n)
+    EXPECT_EQ(expected.header[n], data.header[n]);
+  EXPECT_EQ("theta[1]", data.header[2]);
+
+  EXPECT_FLOAT_EQ(0.8, data.adaptation.step_size);
+  ASSERT_EQ(expected.adaptation.metric.rows(), data.adaptation.metric.rows());
+  ASSERT_EQ(expected.adaptation.metric.cols(), data.adaptation.metric.cols());
+  for (int n = 0; n < expected.adaptation.metric.size(); ++n)
+    EXPECT_FLOAT_EQ(expected.adaptation.metric(n), data.adaptation.metric(n));
+
+  ASSERT_EQ(3, data.samples.rows());
+  ASSERT_EQ(5, data.samples.cols());
+  for (int n = 0; n < expected.samples.size(); ++n)
+    EXPECT_EQ(expected.samples(n), data.samples(n));
+
+  EXPECT_FLOAT_EQ(0.5, data.timing.warmup);
+  EXPECT_FLOAT_EQ(0.25, data.timing.sampling);
+  EXPECT_FLOAT_EQ(expected.timing.warmup, data.timing.warmup);
+  EXPECT_FLOAT_EQ(expected.timing.sampling, data.timing.sampling);
+}
+
+TEST_F(StanIoStanBinaryReader, read_header) {
+  write_run();
+  std::vector<std::string> header;
+  EXPECT_TRUE(
+      stan::io::stan_binary_reader::read_header(binary, header, nullptr));
+  ASSERT_EQ(5U, header.size());
+  EXPECT_EQ("lp__", header[0]);
+  EXPECT_EQ("theta[2]", header[3]);
+  EXPECT_FALSE(stan::io::stan_binary_reader::read_header(csv, header, 0));
+}
+
+TEST_F(StanIoStanBinaryReader, columns) {
+  write_run();
+  stan::io::stan_csv data
+      = stan::io::stan_binary_reader::parse(binary, nullptr, true, {0, 3});
+  ASSERT_EQ(2U, data.header.size());
+  EXPECT_EQ("lp__", data.header[0]);
+  EXPECT_EQ("theta[2]", data.header[1]);
+  EXPECT_EQ(2U, data.metadata.num_warmup);
+  ASSERT_EQ(3, data.samples.rows());
+  ASSERT_EQ(2, data.samples.cols());
+  for (int n = 0; n < 3; ++n) {
+    EXPECT_EQ(-7.0 - n, data.samples(n, 0));
+    EXPECT_EQ(1.0 / (n + 3), data.samples(n, 1));
+  }
+
+  binary.clear();
+  binary.seekg(0);
+  EXPECT_THROW(
+      stan::io::stan_binary_reader::parse(binary, nullptr, true, {0, 5}),
+      std::invalid_argument);
+}
+
+TEST_F(StanIoStanBinaryReader, column_types) {
+  using stan::io::column_type;
+  std::stringstream typed_binary;
+  stan::callbacks::binary_writer typed(typed_binary, false);
+  typed(std::vector<std::string>{"lp__", "treedepth__", "divergent__",
+                                 "theta", "y_rep"});
+  typed.set_column_types(stan::io::draws_column_types(
+      {"lp__", "treedepth__", "divergent__", "theta", "y_rep"}, 3,
+      {column_type::float32, column_type::int32}));
+  typed(std::vector<double>{-7.25, 3, 0, 0.1, 12});
+  typed(std::vector<double>{-8, 4, 1, -0.5,
+                            std::numeric_limits<double>::quiet_NaN()});
+  typed.finish();
+
+  stan::io::stan_csv data
+      = stan::io::stan_binary_reader::parse(typed_binary, nullptr);
+  ASSERT_EQ(2, data.samples.rows());
+  ASSERT_EQ(5, data.samples.cols());
+  EXPECT_EQ(-7.25, data.samples(0, 0));
+  EXPECT_EQ(3, data.samples(0, 1));
+  EXPECT_EQ(0, data.samples(0, 2));
+  EXPECT_EQ(static_cast<float>(0.1), data.samples(0, 3));
+  EXPECT_EQ(12, data.samples(0, 4));
+  EXPECT_EQ(4, data.samples(1, 1));
+  EXPECT_EQ(1, data.samples(1, 2));
+  EXPECT_EQ(-0.5, data.samples(1, 3));
+  EXPECT_TRUE(std::isnan(data.samples(1, 4)));
+}
+
+TEST_F(StanIoStanBinaryReader, read_index) {
+  write_run();
+  std::vector<stan::io::stan_binary_block> index;
+  EXPECT_TRUE(stan::io::stan_binary_reader::read_index(binary, index, 0));
+  ASSERT_EQ(1U, index.size());
+  EXPECT_EQ(3U, index[0].rows);
+  EXPECT_EQ(5U, index[0].cols);
+
+  // The draws of a run form a row major matrix with a stride of
+  // cols + 2 doubles, which could equally be a memory mapped file
+  if (stan::callbacks::binary_writer::is_little_endian()) {
+    std::string bytes = binary.str();
+    std::vector<double> aligned(bytes.size() / 8);
+    std::memcpy(aligned.data(), bytes.data(), 8 * aligned.size());
+    Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                                   Eigen::RowMajor>,
+               0, Eigen::OuterStride<>>
+        draws(aligned.data() + index[0].offset / 8 + 2, index[0].rows,
+              index[0].cols, Eigen::OuterStride<>(index[0].cols + 2));
+    binary.clear();
+    binary.seekg(0);
+    stan::io::stan_csv data = stan::io::stan_binary_reader::parse(binary, 0);
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 5; ++j)
+        EXPECT_EQ(data.samples(i, j), draws(i, j));
+  }
+}
+
+TEST_F(StanIoStanBinaryReader, no_index) {
+  std::stringstream in;
+  stan::callbacks::binary_writer unindexed(in, false);
+  unindexed(std::vector<std::string>{"lp__"});
+  unindexed(std::vector<double>{1});
+  unindexed.finish();
+  std::vector<stan::io::stan_binary_block> index;
+  std::stringstream out;
+  EXPECT_FALSE(stan::io::stan_binary_reader::read_index(in, index, &out));
+  EXPECT_EQ("Error: no index found at the end of the file\n", out.str());
+  EXPECT_TRUE(index.empty());
+}
+
+TEST_F(StanIoStanBinaryReader, not_binary) {
+  std::stringstream out;
+  std::stringstream in("lp__,theta\n1,2\n");
+  EXPECT_THROW(stan::io::stan_binary_reader::parse(in, &out),
+               std::invalid_argument);
+  EXPECT_EQ("Error: not a Stan binary output file\n", out.str());
+}
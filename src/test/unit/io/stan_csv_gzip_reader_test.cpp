@@ -0,0 +1,107 @@
+#include <stan/io/stan_csv_gzip_reader.hpp>
+#include <stan/callbacks/gzip_writer.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <stan/callbacks/tee_writer.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class StanIoStanCsvGzipReader : public testing::Test {
+ public:
+  StanIoStanCsvGzipReader()
+      : csv_writer(csv, "# "),
+        gzip_writer(gzip, "# ", 256),
+        writer(csv_writer, gzip_writer) {}
+
+  /**
+   * Writes the output of a short run the way the services do.
+   */
+  void write_run() {
+    writer("stan_version_major = 2");
+    writer("stan_version_minor = 26");
+    writer("stan_version_patch = 1");
+    writer("model = test_model");
+    writer("num_samples = 100 (Default)");
+    writer("num_warmup = 0");
+    writer("algorithm = hmc (Default)");
+    writer("engine = nuts (Default)");
+    writer(std::vector<std::string>{"lp__", "accept_stat__", "theta.1",
+                                    "theta.2"});
+    writer("Adaptation terminated");
+    writer("Step size = 0.8");
+    writer("Diagonal elements of inverse mass matrix:");
+    writer("1.5, 0.25");
+    for (int n = 0; n < 100; ++n)
+      writer(std::vector<double>{-7.0 - n, 0.9, 0.1 * n, 1.0 / (n + 3)});
+    writer();
+    writer(" Elapsed Time: 0.5 seconds (Warm-up)");
+    writer("               0.25 seconds (Sampling)");
+    writer("               0.75 seconds (Total)");
+    writer();
+    gzip_writer.flush();
+  }
+
+  std::stringstream csv;
+  std::stringstream gzip;
+  stan::callbacks::stream_writer csv_writer;
+  stan::callbacks::gzip_writer gzip_writer;
+  stan::callbacks::tee_writer writer;
+};
+
+TEST_F(StanIoStanCsvGzipReader, is_gzip) {
+  write_run();
+  EXPECT_TRUE(stan::io::stan_csv_gzip_reader::is_gzip(gzip));
+  EXPECT_EQ(0, gzip.tellg());
+  EXPECT_FALSE(stan::io::stan_csv_gzip_reader::is_gzip(csv));
+}
+
+TEST_F(StanIoStanCsvGzipReader, decompresses_frames) {
+  write_run();
+  EXPECT_LT(gzip.str().size(), csv.str().size());
+
+  // Every frame is a complete gzip member
+  std::string compressed = gzip.str();
+  int members = 0;
+  for (size_t i = 0; i + 2 < compressed.size(); ++i)
+    if (compressed.compare(i, 3, "\x1f\x8b\x08") == 0)
+      ++members;
+  EXPECT_LT(1, members);
+
+  stan::io::gzip_istreambuf buffer(gzip, 64);
+  std::istream text(&buffer);
+  std::stringstream decompressed;
+  decompressed << text.rdbuf();
+  EXPECT_EQ(csv.str(), decompressed.str());
+}
+
+TEST_F(StanIoStanCsvGzipReader, matches_csv) {
+  write_run();
+  std::stringstream out;
+  stan::io::stan_csv expected = stan::io::stan_csv_reader::parse(csv, &out);
+  stan::io::stan_csv data = stan::io::stan_csv_gzip_reader::parse(gzip, &out);
+  EXPECT_EQ("", out.str());
+
+  EXPECT_EQ("test_model", data.metadata.model);
+  ASSERT_EQ(expected.header.size(), data.header.size());
+  for (size_t n = 0; n < expected.header.size(); ++n)
+    EXPECT_EQ(expected.header[n], data.header[n]);
+  EXPECT_FLOAT_EQ(0.8, data.adaptation.step_size);
+  ASSERT_EQ(100, data.samples.rows());
+  ASSERT_EQ(4, data.samples.cols());
+  for (int n = 0; n < expected.samples.size(); ++n)
+    EXPECT_EQ(expected.samples(n), data.samples(n));
+  EXPECT_FLOAT_EQ(0.75, data.timing.warmup + data.timing.sampling);
+}
+
+TEST_F(StanIoStanCsvGzipReader, corrupt) {
+  write_run();
+  std::string compressed = gzip.str();
+  for (size_t i = 20; i < compressed.size(); i += 7)
+    compressed[i] = ~compressed[i];
+  std::stringstream corrupt(compressed);
+  std::stringstream out;
+  EXPECT_THROW(stan::io::stan_csv_gzip_reader::parse(corrupt, &out),
+               std::runtime_error);
+}
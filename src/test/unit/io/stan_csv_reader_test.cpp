@@ -1,7 +1,10 @@
 #include <stan/io/stan_csv_reader.hpp>
 #include <test/unit/util.hpp>
 #include <gtest/gtest.h>
+#include <clocale>
+#include <cmath>
 #include <fstream>
+#include <limits>
 #include <sstream>
 
 class StanIoStanCsvReader : public testing::Test {
@@ -500,3 +503,250 @@ TEST_F(StanIoStanCsvReader, ParseEightSchools) {
 
   EXPECT_EQ("", out.str());
 }
+
+TEST(StanIoStanCsvReaderSamples, read_samples_across_blocks) {
+  // Large enough that some lines straddle the blocks read from the stream
+  const int rows = 3000;
+  const int cols = 80;
+  std::stringstream in;
+  in.precision(17);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j)
+      in << (j ? "," : "") << (i - 0.5 * j) / 3.0;
+    in << (i % 2 ? "\r\n" : "\n");
+  }
+  in << "\n#  Elapsed Time: 1.5 seconds (Warm-up)\n"
+     << "#                0.5 seconds (Sampling)\n";
+
+  Eigen::MatrixXd samples;
+  stan::io::stan_csv_timing timing;
+  EXPECT_TRUE(
+      stan::io::stan_csv_reader::read_samples(in, samples, timing, 0));
+  ASSERT_EQ(rows, samples.rows());
+  ASSERT_EQ(cols, samples.cols());
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j)
+      EXPECT_FLOAT_EQ((i - 0.5 * j) / 3.0, samples(i, j));
+  EXPECT_FLOAT_EQ(1.5, timing.warmup);
+  EXPECT_FLOAT_EQ(0.5, timing.sampling);
+}
+
+TEST(StanIoStanCsvReaderSamples, read_samples_ragged) {
+  std::stringstream in("1, 2,3\n4,5\n");
+  std::stringstream out;
+  Eigen::MatrixXd samples;
+  stan::io::stan_csv_timing timing;
+  EXPECT_FALSE(
+      stan::io::stan_csv_reader::read_samples(in, samples, timing, &out));
+  EXPECT_EQ("Error: expected 3 columns, but found 2 instead for row 2\n",
+            out.str());
+}
+
+TEST(StanIoStanCsvReaderSamples, read_draws_batches) {
+  std::stringstream in("1,2,3\n\n4,5,6\n# comment\n7,8,9\n");
+  std::vector<double> values;
+  std::vector<size_t> columns{0, 2};
+  EXPECT_EQ(2, stan::io::stan_csv_reader::read_draws(in, values, 3, columns,
+                                                      2, 0));
+  EXPECT_EQ((std::vector<double>{1, 3, 4, 6}), values);
+  EXPECT_EQ(1, stan::io::stan_csv_reader::read_draws(in, values, 3, columns,
+                                                      2, 0));
+  EXPECT_EQ((std::vector<double>{7, 9}), values);
+  EXPECT_EQ(0, stan::io::stan_csv_reader::read_draws(in, values, 3, columns,
+                                                      2, 0));
+  EXPECT_TRUE(values.empty());
+}
+
+TEST(StanIoStanCsvReaderSamples, read_draws_ragged) {
+  std::stringstream in("1,2,3\n4,5\n");
+  std::vector<double> values;
+  EXPECT_THROW(
+      stan::io::stan_csv_reader::read_draws(in, values, 3, {}, 10, 0),
+      std::invalid_argument);
+  EXPECT_THROW(
+      stan::io::stan_csv_reader::read_draws(in, values, 3, {3}, 10, 0),
+      std::invalid_argument);
+}
+
+TEST_F(StanIoStanCsvReader, parse_selection) {
+  std::stringstream out;
+  stan::io::stan_csv full
+      = stan::io::stan_csv_reader::parse(eight_schools_stream, &out);
+  eight_schools_stream.clear();
+  eight_schools_stream.seekg(0);
+
+  stan::io::stan_csv_selection selection;
+  selection.names = {"theta[1]", "lp__", "tau"};
+  selection.indices = {7, 0};
+  selection.first_draw = 10;
+  selection.num_draws = 25;
+  stan::io::stan_csv data = stan::io::stan_csv_reader::parse(
+      eight_schools_stream, &out, selection);
+  EXPECT_EQ("", out.str());
+
+  ASSERT_EQ(4U, data.header.size());
+  EXPECT_EQ("lp__", data.header[0]);
+  EXPECT_EQ("mu", data.header[1]);
+  EXPECT_EQ("tau", data.header[2]);
+  EXPECT_EQ("theta[1]", data.header[3]);
+
+  std::vector<int> full_cols{0, 7, 8, 17};
+  ASSERT_EQ(25, data.samples.rows());
+  ASSERT_EQ(4, data.samples.cols());
+  for (int i = 0; i < 25; ++i)
+    for (int j = 0; j < 4; ++j)
+      EXPECT_EQ(full.samples(10 + i, full_cols[j]), data.samples(i, j));
+
+  EXPECT_FLOAT_EQ(full.adaptation.step_size, data.adaptation.step_size);
+  EXPECT_FLOAT_EQ(full.timing.warmup, data.timing.warmup);
+  EXPECT_FLOAT_EQ(full.timing.sampling, data.timing.sampling);
+}
+
+TEST_F(StanIoStanCsvReader, parse_selection_past_end) {
+  std::stringstream out;
+  stan::io::stan_csv_selection selection;
+  selection.indices = {24};
+  selection.first_draw = 990;
+  stan::io::stan_csv data = stan::io::stan_csv_reader::parse(
+      eight_schools_stream, &out, selection);
+  ASSERT_EQ(10, data.samples.rows());
+  ASSERT_EQ(1, data.samples.cols());
+  EXPECT_EQ("theta[8]", data.header[0]);
+}
+
+TEST_F(StanIoStanCsvReader, parse_selection_unknown_column) {
+  std::stringstream out;
+  stan::io::stan_csv_selection selection;
+  selection.names = {"theta[9]"};
+  EXPECT_THROW(stan::io::stan_csv_reader::parse(eight_schools_stream, &out,
+                                                selection),
+               std::invalid_argument);
+  EXPECT_EQ("Error: column theta[9] is not in the header\n", out.str());
+
+  out.str("");
+  eight_schools_stream.clear();
+  eight_schools_stream.seekg(0);
+  selection.names.clear();
+  selection.indices = {25};
+  EXPECT_THROW(stan::io::stan_csv_reader::parse(eight_schools_stream, &out,
+                                                selection),
+               std::invalid_argument);
+  EXPECT_EQ("Error: column index 25 is out of range\n", out.str());
+}
+
+TEST_F(StanIoStanCsvReader, parse_metadata_stops_before_draws) {
+  std::stringstream out;
+  stan::io::stan_csv metadata
+      = stan::io::stan_csv_reader::parse_metadata(blocker0_stream, &out);
+  EXPECT_EQ("", out.str());
+  EXPECT_EQ(0, metadata.samples.size());
+
+  std::ifstream full_stream("src/test/unit/io/test_csv_files/blocker.0.csv");
+  stan::io::stan_csv full = stan::io::stan_csv_reader::parse(full_stream, 0);
+  EXPECT_EQ(full.metadata.model, metadata.metadata.model);
+  EXPECT_EQ(full.metadata.seed, metadata.metadata.seed);
+  EXPECT_EQ(full.header, metadata.header);
+  EXPECT_FLOAT_EQ(full.adaptation.step_size, metadata.adaptation.step_size);
+  EXPECT_MATRIX_EQ(full.adaptation.metric, metadata.adaptation.metric);
+
+  // The stream is left at the first draw
+  std::string line;
+  std::getline(blocker0_stream, line);
+  EXPECT_EQ(0U, line.find("-5919.76,"));
+}
+
+TEST_F(StanIoStanCsvReader, read_timing_from_end) {
+  std::stringstream out;
+  stan::io::stan_csv_timing timing;
+  EXPECT_TRUE(
+      stan::io::stan_csv_reader::read_timing(blocker0_stream, timing, &out));
+  EXPECT_EQ("", out.str());
+  EXPECT_FLOAT_EQ(0.391415, timing.warmup);
+  EXPECT_FLOAT_EQ(0.648336, timing.sampling);
+
+  std::stringstream no_timing("lp__,theta\n1,2\n3,4\n");
+  EXPECT_FALSE(
+      stan::io::stan_csv_reader::read_timing(no_timing, timing, &out));
+}
+
+TEST(StanIoStanCsvReaderMetadata, saved_warmup_and_no_adaptation) {
+  std::stringstream saved_warmup(
+      "# save_warmup = 1\n"
+      "lp__,theta\n"
+      "-1,0.5\n"
+      "-2,0.25\n"
+      "# Adaptation terminated\n"
+      "# Step size = 0.5\n"
+      "# Diagonal elements of inverse mass matrix:\n"
+      "# 2\n"
+      "-3,0.75\n"
+      "# \n"
+      "#  Elapsed Time: 1.5 seconds (Warm-up)\n"
+      "#                2.5 seconds (Sampling)\n"
+      "#                4 seconds (Total)\n"
+      "# \n");
+  stan::io::stan_csv data
+      = stan::io::stan_csv_reader::parse_metadata(saved_warmup, 0);
+  EXPECT_TRUE(data.metadata.save_warmup);
+  EXPECT_FLOAT_EQ(0.5, data.adaptation.step_size);
+  ASSERT_EQ(1, data.adaptation.metric.size());
+  EXPECT_FLOAT_EQ(2, data.adaptation.metric(0, 0));
+  EXPECT_TRUE(
+      stan::io::stan_csv_reader::read_timing(saved_warmup, data.timing, 0));
+  EXPECT_FLOAT_EQ(1.5, data.timing.warmup);
+  EXPECT_FLOAT_EQ(2.5, data.timing.sampling);
+
+  std::stringstream out;
+  std::stringstream fixed_param(
+      "lp__,theta\n"
+      "0,0.5\n"
+      "# \n"
+      "#  Elapsed Time: 0 seconds (Warm-up)\n"
+      "#                2.5 seconds (Sampling)\n"
+      "#                2.5 seconds (Total)\n");
+  data = stan::io::stan_csv_reader::parse_metadata(fixed_param, &out);
+  EXPECT_EQ(0, data.adaptation.metric.size());
+  EXPECT_NE(std::string::npos, out.str().find("adaptation"));
+}
+
+TEST(StanIoStanCsvReaderSamples, read_samples_special_values) {
+  std::stringstream in("inf,-inf,nan,1e400,-1e-400,+2.5, x\n");
+  Eigen::MatrixXd samples;
+  stan::io::stan_csv_timing timing;
+  EXPECT_TRUE(
+      stan::io::stan_csv_reader::read_samples(in, samples, timing, 0));
+  ASSERT_EQ(7, samples.cols());
+  EXPECT_EQ(std::numeric_limits<double>::infinity(), samples(0, 0));
+  EXPECT_EQ(-std::numeric_limits<double>::infinity(), samples(0, 1));
+  EXPECT_TRUE(std::isnan(samples(0, 2)));
+  EXPECT_EQ(std::numeric_limits<double>::infinity(), samples(0, 3));
+  EXPECT_EQ(0, samples(0, 4));
+  EXPECT_EQ(2.5, samples(0, 5));
+  EXPECT_EQ(0, samples(0, 6));
+}
+
+TEST(StanIoStanCsvReaderSamples, read_samples_comma_decimal_locale) {
+  // The locale of the calling program must not change the decimal point
+  std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+  const char* locale = nullptr;
+  for (const char* name :
+       {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8",
+        "fr_FR", "German_Germany.1252"}) {
+    locale = std::setlocale(LC_NUMERIC, name);
+    if (locale)
+      break;
+  }
+  if (!locale)
+    GTEST_SKIP() << "no locale with a comma as the decimal point";
+  ASSERT_STREQ(",", std::localeconv()->decimal_point);
+
+  std::stringstream in("1.5,-0.25,3e-2\n1,2.75e+1,-4.125\n");
+  Eigen::MatrixXd samples;
+  stan::io::stan_csv_timing timing;
+  bool ok = stan::io::stan_csv_reader::read_samples(in, samples, timing, 0);
+  std::setlocale(LC_NUMERIC, previous.c_str());
+  EXPECT_TRUE(ok);
+  Eigen::MatrixXd expected(2, 3);
+  expected << 1.5, -0.25, 0.03, 1, 27.5, -4.125;
+  EXPECT_TRUE(expected.isApprox(samples)) << samples;
+}
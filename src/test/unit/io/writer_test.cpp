@@ -584,3 +584,40 @@ TEST(io_reader_writer, cholesky_factor_roundtrip_asymmetric) {
     for (int n = 0; n < 3; ++n)
       EXPECT_FLOAT_EQ(y(m, n), L(m, n));
 }
+TEST(io_writer, array_unconstrain_matches_scalar) {
+  std::vector<int> theta_i;
+  std::vector<double> theta;
+  stan::io::writer<double> writer(theta, theta_i);
+  std::vector<int> expected_i;
+  std::vector<double> expected;
+  stan::io::writer<double> expected_writer(expected, expected_i);
+  std::vector<double> y = {0.5, 1.5, 7.25};
+
+  writer.reserve(5 * y.size());
+  writer.scalar_unconstrain(y);
+  writer.scalar_pos_unconstrain(y);
+  writer.scalar_lb_unconstrain(0.25, y);
+  writer.scalar_ub_unconstrain(8.0, y);
+  writer.scalar_lub_unconstrain(0.0, 10.0, y);
+  writer.scalar_offset_multiplier_unconstrain(1.0, 2.0, y);
+  for (double x : y)
+    expected_writer.scalar_unconstrain(x);
+  for (double x : y)
+    expected_writer.scalar_pos_unconstrain(x);
+  for (double x : y)
+    expected_writer.scalar_lb_unconstrain(0.25, x);
+  for (double x : y)
+    expected_writer.scalar_ub_unconstrain(8.0, x);
+  for (double x : y)
+    expected_writer.scalar_lub_unconstrain(0.0, 10.0, x);
+  for (double x : y)
+    expected_writer.scalar_offset_multiplier_unconstrain(1.0, 2.0, x);
+
+  ASSERT_EQ(expected_writer.data_r().size(), writer.data_r().size());
+  for (size_t n = 0; n < writer.data_r().size(); ++n)
+    EXPECT_FLOAT_EQ(expected_writer.data_r()[n], writer.data_r()[n]);
+
+  std::vector<double> negative = {1.0, -1.0};
+  EXPECT_THROW(writer.scalar_pos_unconstrain(negative), std::runtime_error);
+  EXPECT_THROW(writer.scalar_lb_unconstrain(0.0, negative), std::domain_error);
+}
@@ -0,0 +1,78 @@
+#ifdef STAN_OPENCL
+#include <stan/mcmc/batched_welford_covar_estimator.hpp>
+#include <stan/mcmc/batched_welford_covar_estimator_cl.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+
+namespace {
+Eigen::MatrixXd draws(int n, int num_draws) {
+  Eigen::MatrixXd q(n, num_draws);
+  for (int j = 0; j < num_draws; ++j)
+    for (int i = 0; i < n; ++i)
+      q(i, j) = 100 + std::sin(3.0 * i + j) + 0.25 * i * std::cos(j);
+  return q;
+}
+}  // namespace
+
+TEST(McmcBatchedWelfordCovarEstimatorCl, matches_host_estimator) {
+  const int n = 7;
+  Eigen::MatrixXd q = draws(n, 75);
+
+  for (int batch_size : {1, 4, 32, 100}) {
+    stan::mcmc::batched_welford_covar_estimator host(n, batch_size);
+    stan::mcmc::batched_welford_covar_estimator_cl device(n, batch_size);
+    for (int count : {1, 2, 31, 33, 75}) {
+      host.restart();
+      device.restart();
+      for (int j = 0; j < count; ++j) {
+        host.add_sample(q.col(j));
+        device.add_sample(q.col(j));
+      }
+      EXPECT_EQ(count, device.num_samples());
+
+      Eigen::VectorXd host_mean, device_mean;
+      host.sample_mean(host_mean);
+      device.sample_mean(device_mean);
+      Eigen::MatrixXd host_covar = Eigen::MatrixXd::Zero(n, n);
+      Eigen::MatrixXd device_covar = Eigen::MatrixXd::Zero(n, n);
+      host.sample_covariance(host_covar);
+      device.sample_covariance(device_covar);
+      for (int i = 0; i < n; ++i) {
+        EXPECT_NEAR(host_mean(i), device_mean(i), 1e-12);
+        for (int j = 0; j < n; ++j)
+          EXPECT_NEAR(host_covar(i, j), device_covar(i, j), 1e-10)
+              << "batch size " << batch_size << ", count " << count;
+      }
+    }
+  }
+}
+
+TEST(McmcBatchedWelfordCovarEstimatorCl, state) {
+  const int n = 4;
+  Eigen::MatrixXd q = draws(n, 20);
+  stan::mcmc::batched_welford_covar_estimator_cl estimator(n, 8);
+  stan::mcmc::batched_welford_covar_estimator host(n, 8);
+  for (int j = 0; j < 11; ++j) {
+    estimator.add_sample(q.col(j));
+    host.add_sample(q.col(j));
+  }
+
+  // The state is that of the host estimator, and pending draws are kept
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  estimator.write_state(writer);
+  stan::mcmc::batched_welford_covar_estimator_cl restored(n, 8);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(11, restored.num_samples());
+
+  Eigen::MatrixXd expected = Eigen::MatrixXd::Zero(n, n);
+  Eigen::MatrixXd covar = Eigen::MatrixXd::Zero(n, n);
+  host.sample_covariance(expected);
+  restored.sample_covariance(covar);
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      EXPECT_NEAR(expected(i, j), covar(i, j), 1e-10);
+}
+#endif
@@ -0,0 +1,83 @@
+#include <stan/mcmc/batched_welford_covar_estimator.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+Eigen::MatrixXd draws(int n, int num_draws) {
+  Eigen::MatrixXd q(n, num_draws);
+  for (int j = 0; j < num_draws; ++j)
+    for (int i = 0; i < n; ++i)
+      q(i, j) = 100 + std::sin(3.0 * i + j) + 0.25 * i * std::cos(j);
+  return q;
+}
+}  // namespace
+
+TEST(McmcBatchedWelfordCovarEstimator, matches_sample_covariance) {
+  const int n = 7;
+  Eigen::MatrixXd q = draws(n, 75);
+
+  for (int batch_size : {1, 4, 32, 100}) {
+    stan::mcmc::batched_welford_covar_estimator estimator(n, batch_size);
+    for (int count : {1, 2, 31, 32, 33, 75}) {
+      estimator.restart();
+      for (int j = 0; j < count; ++j)
+        estimator.add_sample(q.col(j));
+      EXPECT_EQ(count, estimator.num_samples());
+
+      Eigen::VectorXd expected_mean = q.leftCols(count).rowwise().mean();
+      Eigen::MatrixXd centered
+          = q.leftCols(count).colwise() - expected_mean;
+      Eigen::VectorXd mean;
+      estimator.sample_mean(mean);
+      Eigen::MatrixXd covar = Eigen::MatrixXd::Zero(n, n);
+      estimator.sample_covariance(covar);
+      for (int i = 0; i < n; ++i) {
+        EXPECT_NEAR(expected_mean(i), mean(i), 1e-12);
+        for (int j = 0; j < n; ++j) {
+          double expected = count > 1 ? centered.row(i).dot(centered.row(j))
+                                            / (count - 1.0)
+                                      : 0;
+          EXPECT_NEAR(expected, covar(i, j), 1e-12)
+              << "batch size " << batch_size << ", count " << count;
+        }
+      }
+    }
+  }
+}
+
+TEST(McmcBatchedWelfordCovarEstimator, state) {
+  const int n = 4;
+  Eigen::MatrixXd q = draws(n, 20);
+  stan::mcmc::batched_welford_covar_estimator estimator(n, 8);
+  for (int j = 0; j < 11; ++j)
+    estimator.add_sample(q.col(j));
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  estimator.write_state(writer);
+
+  stan::mcmc::batched_welford_covar_estimator restored(n, 3);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(11, restored.num_samples());
+  for (int j = 11; j < 20; ++j) {
+    estimator.add_sample(q.col(j));
+    restored.add_sample(q.col(j));
+  }
+  Eigen::MatrixXd covar(n, n);
+  Eigen::MatrixXd restored_covar(n, n);
+  estimator.sample_covariance(covar);
+  restored.sample_covariance(restored_covar);
+  for (int i = 0; i < covar.size(); ++i)
+    EXPECT_NEAR(covar(i), restored_covar(i), 1e-12);
+
+  std::stringstream other_state;
+  stan::mcmc::state_writer other_writer(other_state);
+  stan::mcmc::batched_welford_covar_estimator(n + 1).write_state(other_writer);
+  stan::mcmc::state_reader other_reader(other_state);
+  EXPECT_THROW(restored.read_state(other_reader), std::invalid_argument);
+  EXPECT_THROW(stan::mcmc::batched_welford_covar_estimator(n, 0),
+               std::invalid_argument);
+}
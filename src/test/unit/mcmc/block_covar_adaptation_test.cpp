@@ -0,0 +1,41 @@
+#include <stan/mcmc/block_covar_adaptation.hpp>
+#include <stan/mcmc/covar_adaptation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+TEST(McmcBlockCovarAdaptation, matches_dense_blocks) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 5;
+  const int n_learn = 10;
+  std::vector<int> block_sizes{2, 1, 2};
+
+  stan::mcmc::block_covar_adaptation adapter(n);
+  adapter.set_blocks(block_sizes);
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+  stan::mcmc::covar_adaptation dense(n);
+  dense.set_window_params(50, 0, 0, n_learn, logger);
+
+  std::vector<Eigen::MatrixXd> covar;
+  Eigen::MatrixXd dense_covar(Eigen::MatrixXd::Zero(n, n));
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd q(n);
+    q << i, std::sin(i), i * i, std::cos(i), -0.5 * i + std::sin(2 * i);
+    EXPECT_EQ(i == n_learn - 1, adapter.learn_covariance(covar, q));
+    dense.learn_covariance(dense_covar, q);
+  }
+
+  ASSERT_EQ(3u, covar.size());
+  int start = 0;
+  for (size_t b = 0; b < block_sizes.size(); ++b) {
+    ASSERT_EQ(block_sizes[b], covar[b].rows());
+    ASSERT_EQ(block_sizes[b], covar[b].cols());
+    for (int i = 0; i < block_sizes[b]; ++i)
+      for (int j = 0; j < block_sizes[b]; ++j)
+        EXPECT_FLOAT_EQ(dense_covar(start + i, start + j), covar[b](i, j));
+    start += block_sizes[b];
+  }
+  EXPECT_EQ(0, logger.call_count());
+}
@@ -2,6 +2,7 @@
 #include <stan/io/stan_csv_reader.hpp>
 #include <gtest/gtest.h>
 #include <boost/random/additive_combine.hpp>
+#include <cstdio>
 #include <set>
 #include <exception>
 #include <utility>
@@ -172,6 +173,166 @@ TEST_F(McmcChains, add_adapter) {
   EXPECT_EQ(1000, chains.num_samples(0));
 }
 
+TEST_F(McmcChains, add_one_at_a_time) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  stan::mcmc::chains<> bulk(blocker1.header);
+  bulk.add(blocker1.samples);
+  bulk.set_warmup(0, 100);
+
+  stan::mcmc::chains<> draws(blocker1.header);
+  for (int i = 0; i < blocker1.samples.rows(); i++)
+    draws.add(0, blocker1.samples.row(i));
+  draws.set_warmup(0, 100);
+  EXPECT_EQ(1, draws.num_chains());
+  EXPECT_EQ(1000, draws.num_samples(0));
+  EXPECT_EQ(900, draws.num_kept_samples(0));
+  for (int j = 0; j < blocker1.header.size(); j++) {
+    Eigen::VectorXd expected = bulk.samples(0, j);
+    Eigen::VectorXd actual = draws.samples(0, j);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); i++)
+      EXPECT_EQ(expected(i), actual(i));
+  }
+  EXPECT_FLOAT_EQ(bulk.mean(0, 5), draws.mean(0, 5));
+  EXPECT_FLOAT_EQ(bulk.split_effective_sample_size(5),
+                  draws.split_effective_sample_size(5));
+
+  stan::mcmc::chains<> reserved(blocker1.header);
+  reserved.reserve(0, 1000);
+  EXPECT_EQ(1, reserved.num_chains());
+  EXPECT_EQ(0, reserved.num_samples(0));
+  reserved.add(0, blocker1.samples.topRows(400));
+  reserved.add(0, blocker1.samples.bottomRows(600));
+  EXPECT_EQ(1000, reserved.num_samples(0));
+  EXPECT_EQ(1000 * blocker1.header.size() * sizeof(double),
+            reserved.memory_bytes());
+  EXPECT_LE(reserved.memory_bytes(), draws.memory_bytes())
+      << "draws added one at a time reserve room for more";
+  EXPECT_FLOAT_EQ(bulk.mean(0, 5) * 900 / 1000
+                      + blocker1.samples.col(5).topRows(100).mean() / 10,
+                  reserved.mean(0, 5));
+}
+
+TEST_F(McmcChains, add_mapped) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  stan::mcmc::chains<> in_memory(blocker1.header);
+  in_memory.add(blocker1.samples);
+  in_memory.add(blocker2.samples);
+  in_memory.set_warmup(0, 100);
+
+  std::string path = "chains_test_mapped.bin";
+  {
+    std::ofstream file(path, std::ios::binary);
+    stan::mcmc::chains<>::write_columnar(file, blocker1.samples, 100);
+  }
+  {
+    stan::mcmc::chains<> mapped(blocker1.header);
+    mapped.add_mapped(path);
+    mapped.add(blocker2.samples);
+    EXPECT_EQ(2, mapped.num_chains());
+    EXPECT_EQ(1000, mapped.num_samples(0));
+    EXPECT_EQ(100, mapped.warmup(0));
+    EXPECT_EQ(0, mapped.warmup(1));
+    EXPECT_EQ(1000 * blocker1.header.size() * sizeof(double),
+              mapped.memory_bytes())
+        << "only the chain in memory takes memory";
+
+    for (int j = 0; j < blocker1.header.size(); j++) {
+      Eigen::VectorXd expected = in_memory.samples(0, j);
+      Eigen::VectorXd actual = mapped.samples(0, j);
+      ASSERT_EQ(expected.size(), actual.size());
+      for (int i = 0; i < expected.size(); i++)
+        EXPECT_EQ(expected(i), actual(i));
+    }
+    EXPECT_FLOAT_EQ(in_memory.mean(5), mapped.mean(5));
+    EXPECT_FLOAT_EQ(in_memory.split_effective_sample_size(5),
+                    mapped.split_effective_sample_size(5));
+    EXPECT_FLOAT_EQ(in_memory.split_potential_scale_reduction(5),
+                    mapped.split_potential_scale_reduction(5));
+    EXPECT_FLOAT_EQ(in_memory.quantile(5, 0.1), mapped.quantile(5, 0.1));
+
+    EXPECT_THROW(mapped.add(0, blocker1.samples.topRows(1)),
+                 std::invalid_argument);
+
+    stan::mcmc::chains<> wrong_width(
+        std::vector<std::string>(blocker1.header.begin() + 1,
+                                 blocker1.header.end()));
+    EXPECT_THROW(wrong_width.add_mapped(path), std::invalid_argument);
+  }
+  std::remove(path.c_str());
+}
+
+TEST_F(McmcChains, column_types) {
+  using stan::io::column_type;
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  stan::mcmc::chains<> doubles(blocker1.header);
+  doubles.add(blocker1.samples);
+  doubles.add(blocker2.samples);
+  doubles.set_warmup(0, 100);
+
+  int num_params = blocker1.header.size();
+  std::vector<column_type> types
+      = stan::io::draws_column_types(blocker1.header, 4);
+  types[num_params - 1] = column_type::float32;
+  int treedepth = doubles.index("treedepth__");
+  EXPECT_EQ(column_type::int32, types[treedepth]);
+
+  stan::mcmc::chains<> typed(blocker1.header);
+  EXPECT_THROW(typed.set_column_types({column_type::float32}),
+               std::invalid_argument);
+  typed.set_column_types(types);
+  typed.add(blocker1.samples);
+  typed.add(blocker2.samples);
+  typed.set_warmup(0, 100);
+  EXPECT_THROW(typed.set_column_types(types), std::invalid_argument);
+  EXPECT_LT(typed.memory_bytes(), doubles.memory_bytes());
+
+  for (int j = 0; j < num_params; j++) {
+    Eigen::VectorXd expected = doubles.samples(j);
+    Eigen::VectorXd actual = typed.samples(j);
+    ASSERT_EQ(expected.size(), actual.size());
+    for (int i = 0; i < expected.size(); i++) {
+      if (types[j] == column_type::float32)
+        EXPECT_FLOAT_EQ(expected(i), actual(i));
+      else
+        EXPECT_EQ(expected(i), actual(i));
+    }
+  }
+  {
+    int j = treedepth;
+    EXPECT_EQ(doubles.mean(j), typed.mean(j));
+    EXPECT_EQ(doubles.split_effective_sample_size(j),
+              typed.split_effective_sample_size(j));
+    EXPECT_EQ(doubles.split_potential_scale_reduction(j),
+              typed.split_potential_scale_reduction(j));
+    Eigen::VectorXd probs(2);
+    probs << 0.1, 0.9;
+    stan::mcmc::parameter_summary a = doubles.summary(j, probs);
+    stan::mcmc::parameter_summary b = typed.summary(j, probs);
+    EXPECT_EQ(a.mean, b.mean);
+    EXPECT_EQ(a.ess, b.ess);
+    EXPECT_EQ(a.quantiles(1), b.quantiles(1));
+  }
+  EXPECT_NEAR(doubles.split_effective_sample_size(num_params - 1),
+              typed.split_effective_sample_size(num_params - 1), 1e-2);
+}
+
 TEST_F(McmcChains, blocker1_num_chains) {
   std::stringstream out;
   stan::io::stan_csv blocker1
@@ -875,3 +1036,88 @@ TEST_F(McmcChains, blocker_split_potential_scale_reduction) {
               chains.split_potential_scale_reduction(name));
   }
 }
+
+TEST_F(McmcChains, blocker_all_parameters) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  stan::mcmc::chains<> chains(blocker1);
+  chains.add(blocker2);
+  chains.set_warmup(100);
+
+  Eigen::VectorXd ess = chains.effective_sample_size();
+  Eigen::VectorXd split_ess = chains.split_effective_sample_size();
+  Eigen::VectorXd rhat = chains.split_potential_scale_reduction();
+  Eigen::VectorXd unsplit_rhat = chains.potential_scale_reduction();
+  ASSERT_EQ(chains.num_params(), ess.size());
+  ASSERT_EQ(chains.num_params(), split_ess.size());
+  ASSERT_EQ(chains.num_params(), rhat.size());
+  ASSERT_EQ(chains.num_params(), unsplit_rhat.size());
+  for (int index = 0; index < chains.num_params(); index++) {
+    EXPECT_FLOAT_EQ(chains.effective_sample_size(index), ess(index));
+    EXPECT_FLOAT_EQ(chains.split_effective_sample_size(index),
+                    split_ess(index));
+    EXPECT_FLOAT_EQ(chains.split_potential_scale_reduction(index),
+                    rhat(index));
+    EXPECT_FLOAT_EQ(chains.potential_scale_reduction(index),
+                    unsplit_rhat(index));
+  }
+  EXPECT_FLOAT_EQ(chains.potential_scale_reduction(4),
+                  chains.potential_scale_reduction(chains.param_name(4)));
+
+  std::vector<int> indices{7, 4, 7};
+  Eigen::VectorXd some = chains.split_effective_sample_size(indices);
+  ASSERT_EQ(3, some.size());
+  EXPECT_FLOAT_EQ(split_ess(7), some(0));
+  EXPECT_FLOAT_EQ(split_ess(4), some(1));
+  EXPECT_FLOAT_EQ(split_ess(7), some(2));
+  EXPECT_EQ(0, chains.effective_sample_size(std::vector<int>()).size());
+
+  EXPECT_THROW(chains.effective_sample_size(std::vector<int>{-1}),
+               std::out_of_range);
+  EXPECT_THROW(chains.split_potential_scale_reduction(
+                   std::vector<int>{chains.num_params()}),
+               std::out_of_range);
+}
+
+TEST_F(McmcChains, blocker_summary) {
+  std::stringstream out;
+  stan::io::stan_csv blocker1
+      = stan::io::stan_csv_reader::parse(blocker1_stream, &out);
+  stan::io::stan_csv blocker2
+      = stan::io::stan_csv_reader::parse(blocker2_stream, &out);
+  EXPECT_EQ("", out.str());
+
+  stan::mcmc::chains<> chains(blocker1);
+  chains.add(blocker2);
+  chains.set_warmup(100);
+
+  Eigen::VectorXd probs(5);
+  probs << 0.05, 0.25, 0.5, 0.75, 0.95;
+
+  std::vector<stan::mcmc::parameter_summary> summaries
+      = chains.summary(probs);
+  ASSERT_EQ(chains.num_params(), summaries.size());
+  for (int index = 0; index < chains.num_params(); index++) {
+    const stan::mcmc::parameter_summary& s = summaries[index];
+    EXPECT_FLOAT_EQ(chains.mean(index), s.mean);
+    EXPECT_FLOAT_EQ(chains.sd(index), s.sd);
+    EXPECT_FLOAT_EQ(chains.split_effective_sample_size(index), s.ess);
+    EXPECT_FLOAT_EQ(s.sd / std::sqrt(s.ess), s.mcse);
+    EXPECT_FLOAT_EQ(chains.split_potential_scale_reduction(index), s.rhat);
+    ASSERT_EQ(5, s.quantiles.size());
+    Eigen::VectorXd quantiles = chains.quantiles(index, probs);
+    for (int i = 0; i < probs.size(); i++)
+      EXPECT_EQ(quantiles(i), s.quantiles(i));
+
+    stan::mcmc::parameter_summary single
+        = chains.summary(chains.param_name(index), probs);
+    EXPECT_EQ(s.mean, single.mean);
+    EXPECT_EQ(s.ess, single.ess);
+    EXPECT_EQ(s.quantiles(2), single.quantiles(2));
+  }
+}
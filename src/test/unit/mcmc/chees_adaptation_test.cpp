@@ -0,0 +1,83 @@
+#include <stan/mcmc/chees_adaptation.hpp>
+#include <gtest/gtest.h>
+#include <limits>
+
+TEST(McmcCheesAdaptation, set_T) {
+  stan::mcmc::chees_adaptation adaptation;
+
+  adaptation.set_T(2.5);
+  EXPECT_FLOAT_EQ(2.5, adaptation.get_T());
+
+  adaptation.set_T(-1);
+  EXPECT_FLOAT_EQ(2.5, adaptation.get_T());
+}
+
+TEST(McmcCheesAdaptation, halton_jitter) {
+  stan::mcmc::chees_adaptation adaptation;
+
+  EXPECT_FLOAT_EQ(0.5, adaptation.next_jitter());
+  EXPECT_FLOAT_EQ(0.25, adaptation.next_jitter());
+  EXPECT_FLOAT_EQ(0.75, adaptation.next_jitter());
+  EXPECT_FLOAT_EQ(0.125, adaptation.next_jitter());
+  EXPECT_FLOAT_EQ(0.625, adaptation.next_jitter());
+
+  adaptation.restart();
+  EXPECT_FLOAT_EQ(0.5, adaptation.next_jitter());
+}
+
+TEST(McmcCheesAdaptation, learn_T_direction) {
+  // Four chains that start bunched and end spread out, moving outwards
+  Eigen::MatrixXd q(2, 4);
+  q << 0.1, -0.1, 0.1, -0.1, 0.1, 0.1, -0.1, -0.1;
+  Eigen::MatrixXd q_end = 10 * q;
+  Eigen::MatrixXd v_end = q_end;
+  Eigen::VectorXd accept_prob = Eigen::VectorXd::Constant(4, 0.8);
+
+  stan::mcmc::chees_adaptation growing;
+  growing.set_T(1);
+  growing.learn_T(q, q_end, v_end, accept_prob, 1);
+  EXPECT_GT(growing.get_T(), 1);
+
+  // Chains that have spread out but are turning back
+  stan::mcmc::chees_adaptation shrinking;
+  shrinking.set_T(1);
+  Eigen::MatrixXd v_back = -q_end;
+  shrinking.learn_T(q, q_end, v_back, accept_prob, 1);
+  EXPECT_LT(shrinking.get_T(), 1);
+}
+
+TEST(McmcCheesAdaptation, learn_T_skips_nonfinite) {
+  Eigen::MatrixXd q(1, 3);
+  q << -0.1, 0.0, 0.1;
+  Eigen::MatrixXd q_end(1, 3);
+  q_end << -1, std::numeric_limits<double>::quiet_NaN(), 1;
+  Eigen::MatrixXd v_end = q_end;
+  Eigen::VectorXd accept_prob(3);
+  accept_prob << 1, 1, 0;
+
+  stan::mcmc::chees_adaptation adaptation;
+  adaptation.set_T(1);
+  adaptation.learn_T(q, q_end, v_end, accept_prob, 1);
+  EXPECT_TRUE(std::isfinite(adaptation.get_T()));
+}
+
+TEST(McmcCheesAdaptation, complete_adaptation) {
+  stan::mcmc::chees_adaptation adaptation;
+  adaptation.set_T(3);
+
+  double T = 0;
+  adaptation.complete_adaptation(T);
+  EXPECT_FLOAT_EQ(3, T);
+
+  Eigen::MatrixXd q(1, 2);
+  q << -0.1, 0.1;
+  Eigen::MatrixXd q_end = 10 * q;
+  Eigen::VectorXd accept_prob = Eigen::VectorXd::Ones(2);
+  for (int n = 0; n < 10; ++n)
+    adaptation.learn_T(q, q_end, q_end, accept_prob, 1);
+  double last_T = adaptation.get_T();
+  adaptation.complete_adaptation(T);
+  EXPECT_GT(T, 3);
+  EXPECT_LT(T, last_T);
+  EXPECT_FLOAT_EQ(T, adaptation.get_T());
+}
@@ -27,3 +27,141 @@ TEST(McmcCovarAdaptation, learn_covariance) {
   }
   EXPECT_EQ(0, logger.call_count());
 }
+
+TEST(McmcCovarAdaptation, pool_covariance) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 3;
+  const int n_learn = 10;
+  const int num_chains = 3;
+
+  std::vector<stan::mcmc::covar_adaptation> chains(
+      num_chains, stan::mcmc::covar_adaptation(n));
+  std::vector<stan::mcmc::covar_adaptation*> adaptations;
+  for (auto& chain : chains) {
+    chain.set_window_params(50, 0, 0, n_learn, logger);
+    chain.set_cross_chain(true);
+    adaptations.push_back(&chain);
+  }
+  stan::mcmc::covar_adaptation pooled(n);
+  pooled.set_window_params(100, 0, 0, num_chains * n_learn, logger);
+
+  Eigen::MatrixXd covar(Eigen::MatrixXd::Zero(n, n));
+  Eigen::MatrixXd pooled_covar(Eigen::MatrixXd::Zero(n, n));
+  for (int c = 0; c < num_chains; ++c) {
+    for (int i = 0; i < n_learn; ++i) {
+      Eigen::VectorXd q(n);
+      q << c + 0.5 * i, std::sin(c * n_learn + i), -2.0 * c + i * i;
+      EXPECT_FALSE(chains[c].learn_covariance(covar, q));
+      pooled.learn_covariance(pooled_covar, q);
+    }
+    EXPECT_TRUE(chains[c].window_pending());
+  }
+
+  EXPECT_TRUE(
+      stan::mcmc::covar_adaptation::pool_covariance(adaptations, covar));
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      EXPECT_FLOAT_EQ(pooled_covar(i, j), covar(i, j));
+    }
+  }
+  for (auto& chain : chains)
+    EXPECT_FALSE(chain.window_pending());
+
+  EXPECT_FALSE(
+      stan::mcmc::covar_adaptation::pool_covariance(adaptations, covar));
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(McmcCovarAdaptation, ledoit_wolf) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 6;
+  const int n_learn = 4;
+  std::vector<Eigen::VectorXd> draws;
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd q(n);
+    for (int j = 0; j < n; ++j)
+      q(j) = (j + 1) * std::sin(1.7 * i + j) + 0.1 * i * j;
+    draws.push_back(q);
+  }
+
+  Eigen::VectorXd mean = Eigen::VectorXd::Zero(n);
+  for (const Eigen::VectorXd& q : draws)
+    mean += q / n_learn;
+  Eigen::MatrixXd s = Eigen::MatrixXd::Zero(n, n);
+  double sum_fourth = 0;
+  for (const Eigen::VectorXd& q : draws) {
+    s += (q - mean) * (q - mean).transpose() / n_learn;
+    sum_fourth += std::pow((q - mean).squaredNorm(), 2);
+  }
+  double mu = s.trace() / n;
+  Eigen::MatrixXd target = mu * Eigen::MatrixXd::Identity(n, n);
+  double d2 = (s - target).squaredNorm();
+  double b2 = std::min(d2, (sum_fourth / n_learn - s.squaredNorm()) / n_learn);
+  Eigen::MatrixXd expected = (1 - b2 / d2) * s + (b2 / d2) * target;
+
+  stan::mcmc::covar_adaptation adapter(n);
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+  adapter.set_ledoit_wolf(true);
+  Eigen::MatrixXd covar(Eigen::MatrixXd::Zero(n, n));
+  for (const Eigen::VectorXd& q : draws)
+    adapter.learn_covariance(covar, q);
+
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      EXPECT_NEAR(expected(i, j), covar(i, j), 1e-10);
+  // Fewer draws than parameters, yet the estimate is positive definite
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(covar);
+  EXPECT_GT(eigen.eigenvalues().minCoeff(), 0);
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(McmcCovarAdaptation, gradient_diagonal) {
+  stan::test::unit::instrumented_logger logger;
+
+  // Draws and gradients of independent normals with scales 1, 2 and 3
+  const int n = 3;
+  const int n_learn = 20;
+  Eigen::VectorXd sigma(n);
+  sigma << 1, 2, 3;
+  std::vector<Eigen::VectorXd> draws;
+  std::vector<Eigen::VectorXd> grads;
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd z(n);
+    z << std::sin(i), std::cos(1.3 * i), std::sin(0.7 * i + 1);
+    draws.push_back(sigma.cwiseProduct(z));
+    grads.push_back(-z.cwiseQuotient(sigma));
+  }
+
+  stan::mcmc::covar_adaptation adapter(n);
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+  stan::mcmc::covar_adaptation scaled(n);
+  scaled.set_window_params(50, 0, 0, n_learn, logger);
+  scaled.set_gradient_diagonal(true);
+  Eigen::MatrixXd covar(Eigen::MatrixXd::Zero(n, n));
+  Eigen::MatrixXd scaled_covar(Eigen::MatrixXd::Zero(n, n));
+  for (int i = 0; i < n_learn; ++i) {
+    adapter.learn_covariance(covar, draws[i], grads[i]);
+    scaled.learn_covariance(scaled_covar, draws[i], grads[i]);
+  }
+
+  // The gradient variances are the inverse draw variances up to the
+  // sample variance of z, so the geometric mean recovers sigma^2 before
+  // the regularization
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(n_learn / (n_learn + 5.0) * sigma(i) * sigma(i)
+                    + 1e-3 * 5.0 / (n_learn + 5.0),
+                scaled_covar(i, i), 1e-8);
+  }
+  // and the correlations are kept
+  double reg = 1e-3 * 5.0 / (n_learn + 5.0);
+  Eigen::VectorXd sd
+      = ((covar.diagonal().array() - reg) * (n_learn + 5.0) / n_learn).sqrt();
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      if (i != j)
+        EXPECT_NEAR(covar(i, j) / (sd(i) * sd(j)),
+                    scaled_covar(i, j) / (sigma(i) * sigma(j)), 1e-12);
+  EXPECT_EQ(0, logger.call_count());
+}
@@ -0,0 +1,39 @@
+#include <stan/mcmc/damping_adaptation.hpp>
+#include <gtest/gtest.h>
+
+TEST(McmcDampingAdaptation, learn_damping) {
+  stan::mcmc::damping_adaptation adaptation(2, 4);
+
+  // Draws with variance 4 in the first parameter and 1 in the second
+  Eigen::VectorXd q(2);
+  double damping = 1;
+  for (int i = 0; i < 3; ++i) {
+    q << (i % 2 ? 2 : -2), (i % 2 ? 1 : -1);
+    EXPECT_FALSE(adaptation.learn_damping(damping, q,
+                                          Eigen::VectorXd::Ones(2)));
+    EXPECT_EQ(1, damping);
+  }
+  q << 2, 1;
+  EXPECT_TRUE(adaptation.learn_damping(damping, q, Eigen::VectorXd::Ones(2)));
+  double var = 16.0 / 3;
+  EXPECT_FLOAT_EQ(1 / std::sqrt(var), damping);
+
+  // In the units of a metric that already captures the first scale the
+  // second one is the widest
+  adaptation.restart();
+  for (int i = 0; i < 4; ++i) {
+    q << (i % 2 ? 2 : -2), (i % 2 ? 1 : -1);
+    adaptation.learn_damping(damping, q, Eigen::Vector2d(4, 0.5));
+  }
+  EXPECT_FLOAT_EQ(1 / std::sqrt(var / 4 / 0.5), damping);
+}
+
+TEST(McmcDampingAdaptation, constant_draws) {
+  stan::mcmc::damping_adaptation adaptation(1, 2);
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(1);
+  double damping = 0.5;
+  adaptation.learn_damping(damping, q, Eigen::VectorXd::Ones(1));
+  EXPECT_FALSE(adaptation.learn_damping(damping, q, Eigen::VectorXd::Ones(1)));
+  EXPECT_EQ(0.5, damping);
+}
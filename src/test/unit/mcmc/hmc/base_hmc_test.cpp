@@ -1,5 +1,6 @@
 #include <test/unit/mcmc/hmc/mock_hmc.hpp>
 #include <stan/callbacks/stream_writer.hpp>
+#include <stan/callbacks/stream_logger.hpp>
 #include <stan/mcmc/hmc/base_hmc.hpp>
 #include <boost/random/additive_combine.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -130,3 +131,38 @@ TEST(McmcBaseHMC, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(McmcBaseHMC, init_stepsize_capped) {
+  rng_t base_rng(0);
+
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_hmc sampler(model, base_rng);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  // The mock Hamiltonian is constant, so every step size is accepted
+  // and the step size keeps doubling
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_max_init_stepsize_evals(5);
+  EXPECT_EQ(5, sampler.get_max_init_stepsize_evals());
+  sampler.init_stepsize(logger);
+
+  EXPECT_EQ(5, sampler.get_init_stepsize_evals());
+  EXPECT_FLOAT_EQ(1.6, sampler.get_nominal_stepsize());
+  EXPECT_NE(std::string::npos, warn.str().find("stopped after 5"));
+}
+
+TEST(McmcBaseHMC, init_stepsize_improper) {
+  rng_t base_rng(0);
+
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_hmc sampler(model, base_rng);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  sampler.set_nominal_stepsize(0.1);
+  EXPECT_THROW(sampler.init_stepsize(logger), std::runtime_error);
+  EXPECT_EQ("", warn.str());
+}
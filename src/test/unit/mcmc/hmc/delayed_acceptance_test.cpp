@@ -0,0 +1,105 @@
+#include <stan/mcmc/hmc/delayed_acceptance.hpp>
+#include <stan/mcmc/hmc/nuts/diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/static/unit_e_static_hmc.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <stan/io/dump.hpp>
+#include <test/test-models/good/mcmc/hmc/integrators/command.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+typedef command_model_namespace::command_model model_t;
+
+namespace {
+// The posterior of mu is normal(y, 1)
+model_t make_model(double y) {
+  std::stringstream data_stream("y <- " + std::to_string(y) + "\n");
+  stan::io::dump data_var_context(data_stream);
+  return model_t(data_var_context);
+}
+
+template <class Sampler>
+void expect_model_target(Sampler& sampler, stan::callbacks::logger& logger) {
+  Eigen::VectorXd q(1);
+  q(0) = 0;
+  stan::mcmc::sample s(q, 0, 0);
+  const int num_draws = 4000;
+  double sum = 0;
+  double sum_sq = 0;
+  for (int n = 0; n < num_draws; ++n) {
+    s = sampler.transition(s, logger);
+    double mu = s.cont_params()(0);
+    sum += mu;
+    sum_sq += mu * mu;
+    EXPECT_NEAR(-0.5 * mu * mu, s.log_prob(), 1e-8);
+  }
+  double mean = sum / num_draws;
+  EXPECT_NEAR(0, mean, 0.15);
+  EXPECT_NEAR(1, sum_sq / num_draws - mean * mean, 0.2);
+  // One evaluation at the start and at most one per draw
+  EXPECT_LE(sampler.get_num_full_evals(), num_draws + 1);
+}
+}  // namespace
+
+class McmcDelayedAcceptance : public testing::Test {
+ public:
+  McmcDelayedAcceptance()
+      : logger(debug, info, warn, error, fatal),
+        model(make_model(0)),
+        surrogate(make_model(0.7)),
+        rng(4839294) {}
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger;
+  model_t model;
+  model_t surrogate;
+  rng_t rng;
+};
+
+TEST_F(McmcDelayedAcceptance, static_hmc_targets_model) {
+  stan::mcmc::delayed_acceptance<model_t,
+                                 stan::mcmc::unit_e_static_hmc<model_t, rng_t>>
+      sampler(model, surrogate, rng);
+  sampler.set_nominal_stepsize_and_T(0.3, 1.5);
+  expect_model_target(sampler, logger);
+  EXPECT_EQ("", error.str());
+}
+
+TEST_F(McmcDelayedAcceptance, nuts_targets_model) {
+  stan::mcmc::delayed_acceptance<model_t,
+                                 stan::mcmc::diag_e_nuts<model_t, rng_t>>
+      sampler(model, surrogate, rng);
+  sampler.set_nominal_stepsize(0.5);
+  expect_model_target(sampler, logger);
+  EXPECT_EQ("", error.str());
+}
+
+TEST_F(McmcDelayedAcceptance, sampler_params) {
+  stan::mcmc::delayed_acceptance<model_t,
+                                 stan::mcmc::diag_e_nuts<model_t, rng_t>>
+      sampler(model, surrogate, rng);
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  ASSERT_FALSE(names.empty());
+  EXPECT_EQ("delayed_accept_stat__", names.back());
+
+  Eigen::VectorXd q(1);
+  q(0) = 0;
+  stan::mcmc::sample s(q, 0, 0);
+  double min_accept = 1;
+  for (int n = 0; n < 100; ++n) {
+    s = sampler.transition(s, logger);
+    std::vector<double> values;
+    sampler.get_sampler_params(values);
+    ASSERT_EQ(names.size(), values.size());
+    EXPECT_LE(0, values.back());
+    EXPECT_GE(1, values.back());
+    min_accept = std::min(min_accept, values.back());
+  }
+  // The surrogate is off, so some proposals are rejected by the model
+  EXPECT_GT(1, min_accept);
+}
@@ -0,0 +1,155 @@
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/ghmc/base_ghmc.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace stan {
+namespace mcmc {
+
+// Hamiltonian whose energy grows away from the origin, so that moves
+// outwards are rejected
+template <typename Model, typename BaseRNG>
+class mock_growing_hamiltonian : public mock_hamiltonian<Model, BaseRNG> {
+ public:
+  explicit mock_growing_hamiltonian(const Model& model)
+      : mock_hamiltonian<Model, BaseRNG>(model) {}
+
+  double T(ps_point& z) { return 100 * z.q.squaredNorm(); }
+};
+
+class mock_ghmc
+    : public base_ghmc<mock_model, mock_hamiltonian, mock_integrator, rng_t> {
+ public:
+  mock_ghmc(const mock_model& m, rng_t& rng)
+      : base_ghmc<mock_model, mock_hamiltonian, mock_integrator, rng_t>(m,
+                                                                        rng) {}
+};
+
+class mock_growing_ghmc : public base_ghmc<mock_model, mock_growing_hamiltonian,
+                                           mock_integrator, rng_t> {
+ public:
+  mock_growing_ghmc(const mock_model& m, rng_t& rng)
+      : base_ghmc<mock_model, mock_growing_hamiltonian, mock_integrator,
+                  rng_t>(m, rng) {}
+};
+
+}  // namespace mcmc
+}  // namespace stan
+
+TEST(McmcGhmcBaseGhmc, set_nominal_stepsize_and_L) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(5);
+  stan::mcmc::mock_ghmc sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize_and_L(0.5, 4);
+  EXPECT_EQ(0.5, sampler.get_nominal_stepsize());
+  EXPECT_EQ(4, sampler.get_L());
+
+  sampler.set_nominal_stepsize_and_L(-0.1, 5);
+  EXPECT_EQ(0.5, sampler.get_nominal_stepsize());
+  EXPECT_EQ(4, sampler.get_L());
+
+  sampler.set_L(0);
+  EXPECT_EQ(4, sampler.get_L());
+}
+
+TEST(McmcGhmcBaseGhmc, set_damping) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(5);
+  stan::mcmc::mock_ghmc sampler(model, base_rng);
+
+  sampler.set_damping(0.25);
+  EXPECT_EQ(0.25, sampler.get_damping());
+
+  sampler.set_damping(-1);
+  EXPECT_EQ(0.25, sampler.get_damping());
+
+  sampler.set_damping(0);
+  EXPECT_EQ(0, sampler.get_damping());
+}
+
+TEST(McmcGhmcBaseGhmc, partial_refreshment) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_ghmc sampler(model, base_rng);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  sampler.set_nominal_stepsize_and_L(0.5, 4);
+  sampler.set_damping(0.5);
+  sampler.z().p.setOnes();
+
+  // The first transition has no momentum to carry over
+  Eigen::VectorXd q0 = Eigen::VectorXd::Zero(2);
+  stan::mcmc::sample s0(q0, 0, 0);
+  stan::mcmc::sample s1 = sampler.transition(s0, logger);
+  EXPECT_EQ(0, sampler.get_alpha());
+  EXPECT_FLOAT_EQ(2, s1.cont_params()(0));
+  EXPECT_FLOAT_EQ(1, s1.accept_stat());
+
+  // The mock Hamiltonian draws no fresh momentum, so the refreshed
+  // momentum is the old one scaled by alpha + sqrt(1 - alpha^2)
+  double alpha = std::exp(-0.5 * 0.5 * 4);
+  sampler.transition(s1, logger);
+  EXPECT_FLOAT_EQ(alpha, sampler.get_alpha());
+  double scale = alpha + std::sqrt(1 - alpha * alpha);
+  EXPECT_FLOAT_EQ(scale, sampler.z().p(0));
+  EXPECT_FLOAT_EQ(2 + 2 * scale, sampler.z().q(1));
+
+  // A transition that doesn't start where the last one ended, or one
+  // after the momentum is reset, draws the momentum afresh
+  sampler.transition(s1, logger);
+  EXPECT_EQ(0, sampler.get_alpha());
+
+  stan::mcmc::sample s2(sampler.z().q, 0, 0);
+  sampler.reset_momentum();
+  sampler.transition(s2, logger);
+  EXPECT_EQ(0, sampler.get_alpha());
+}
+
+TEST(McmcGhmcBaseGhmc, rejection_negates_momentum) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_growing_ghmc sampler(model, base_rng);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  sampler.set_nominal_stepsize_and_L(0.5, 4);
+  sampler.z().p.setOnes();
+
+  Eigen::VectorXd q0 = Eigen::VectorXd::Zero(2);
+  stan::mcmc::sample s0(q0, 0, 0);
+  stan::mcmc::sample s1 = sampler.transition(s0, logger);
+
+  EXPECT_LT(s1.accept_stat(), 1e-10);
+  EXPECT_EQ(0, s1.cont_params()(0));
+  EXPECT_EQ(0, s1.cont_params()(1));
+  EXPECT_EQ(-1, sampler.z().p(0));
+  EXPECT_EQ(-1, sampler.z().p(1));
+}
+
+TEST(McmcGhmcBaseGhmc, sampler_params) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_ghmc sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize_and_L(0.5, 4);
+  sampler.set_damping(0.25);
+
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  std::vector<double> values;
+  sampler.get_sampler_params(values);
+  ASSERT_EQ(names.size(), values.size());
+  EXPECT_EQ("stepsize__", names[0]);
+  EXPECT_EQ("int_time__", names[1]);
+  EXPECT_EQ("damping__", names[2]);
+  EXPECT_EQ("energy__", names[3]);
+  EXPECT_FLOAT_EQ(0.25, values[2]);
+}
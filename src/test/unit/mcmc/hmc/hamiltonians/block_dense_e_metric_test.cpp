@@ -0,0 +1,105 @@
+#include <boost/random/additive_combine.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/block_dense_e_metric.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+// Inverse metric with a 2 x 2 block followed by a 1 x 1 block
+std::vector<Eigen::MatrixXd> test_blocks() {
+  Eigen::MatrixXd first(2, 2);
+  first << 3.0, -2.0, -2.0, 4.0;
+  Eigen::MatrixXd second(1, 1);
+  second << 0.5;
+  return {first, second};
+}
+}  // namespace
+
+TEST(McmcBlockDenseEMetric, sample_p) {
+  rng_t base_rng(0);
+
+  std::vector<Eigen::MatrixXd> blocks = test_blocks();
+  Eigen::MatrixXd inv_metric = Eigen::MatrixXd::Zero(3, 3);
+  inv_metric.block(0, 0, 2, 2) = blocks[0];
+  inv_metric.block(2, 2, 1, 1) = blocks[1];
+  Eigen::MatrixXd m = inv_metric.inverse();
+
+  stan::mcmc::mock_model model(3);
+
+  stan::mcmc::block_dense_e_metric<stan::mcmc::mock_model, rng_t> metric(
+      model);
+  stan::mcmc::block_dense_e_point z(3);
+  z.set_blocks({2, 1});
+  z.set_metric(blocks);
+
+  int n_samples = 10000;
+
+  Eigen::MatrixXd sample_cov = Eigen::MatrixXd::Zero(3, 3);
+  for (int i = 0; i < n_samples; ++i) {
+    metric.sample_p(z, base_rng);
+    sample_cov += z.p * z.p.transpose() / n_samples;
+  }
+
+  // Covariance matrix within 5sigma of expected value (comes from a Wishart
+  // distribution)
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      double var = m(i, j) * m(i, j) + m(i, i) * m(j, j);
+      EXPECT_LT(std::fabs(m(i, j) - sample_cov(i, j)),
+                5.0 * sqrt(var / n_samples));
+    }
+  }
+}
+
+TEST(McmcBlockDenseEMetric, kinetic_energy) {
+  stan::mcmc::mock_model model(3);
+  stan::mcmc::block_dense_e_metric<stan::mcmc::mock_model, rng_t> metric(
+      model);
+  stan::mcmc::block_dense_e_point z(3);
+  z.p << 0.3, -1.2, 0.7;
+
+  // Blocks of size one with the identity inverse metric by default
+  EXPECT_EQ(3, z.num_blocks());
+  EXPECT_FLOAT_EQ(0.5 * z.p.squaredNorm(), metric.T(z));
+
+  Eigen::MatrixXd dense(3, 3);
+  dense << 3.0, -2.0, 1.0, -2.0, 4.0, 1.0, 1.0, 1.0, 0.5;
+  z.set_blocks({2, 1});
+  z.set_metric(dense);
+
+  Eigen::MatrixXd inv_metric = dense;
+  inv_metric.block(0, 2, 2, 1).setZero();
+  inv_metric.block(2, 0, 1, 2).setZero();
+  Eigen::VectorXd expected = inv_metric * z.p;
+  Eigen::VectorXd dtau_dp = metric.dtau_dp(z);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_FLOAT_EQ(expected(i), dtau_dp(i));
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(expected), metric.T(z));
+  EXPECT_FLOAT_EQ(metric.T(z), metric.tau(z));
+}
+
+TEST(McmcBlockDenseEMetric, set_blocks_errors) {
+  stan::mcmc::block_dense_e_point z(3);
+  EXPECT_THROW(z.set_blocks({2, 2}), std::invalid_argument);
+  EXPECT_THROW(z.set_blocks({3, 0}), std::invalid_argument);
+  EXPECT_NO_THROW(z.set_blocks({3}));
+
+  std::vector<Eigen::MatrixXd> blocks = test_blocks();
+  EXPECT_THROW(z.set_metric(blocks), std::invalid_argument);
+  z.set_blocks({1, 2});
+  EXPECT_THROW(z.set_metric(blocks), std::invalid_argument);
+}
+
+TEST(McmcBlockDenseEMetric, write_metric) {
+  stan::mcmc::block_dense_e_point z(3);
+  z.set_blocks({2, 1});
+  z.set_metric(test_blocks());
+
+  stan::test::unit::instrumented_writer writer;
+  z.write_metric(writer);
+  EXPECT_EQ(4, writer.call_count("string"));
+}
@@ -0,0 +1,87 @@
+#ifdef STAN_OPENCL
+#include <boost/random/additive_combine.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_cl_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_metric.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+Eigen::MatrixXd test_inv_metric() {
+  Eigen::MatrixXd m_inv(3, 3);
+  m_inv << 2, 0.5, 0, 0.5, 1, 0.2, 0, 0.2, 3;
+  return m_inv;
+}
+
+void expect_near(const Eigen::MatrixXd& a, const Eigen::MatrixXd& b) {
+  ASSERT_EQ(a.rows(), b.rows());
+  ASSERT_EQ(a.cols(), b.cols());
+  for (int i = 0; i < a.size(); ++i)
+    EXPECT_NEAR(a(i), b(i), 1e-12);
+}
+}  // namespace
+
+TEST(McmcDenseEClMetric, matches_dense_e_metric) {
+  stan::mcmc::mock_model model(3);
+  stan::mcmc::dense_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::dense_e_cl_metric<stan::mcmc::mock_model, rng_t> metric_cl(
+      model);
+  stan::mcmc::dense_e_point z(3);
+  stan::mcmc::dense_e_cl_point z_cl(3);
+  z.set_metric(test_inv_metric());
+  z_cl.set_metric(test_inv_metric());
+  z.p << 1, -2, 0.5;
+  z_cl.p = z.p;
+
+  EXPECT_FLOAT_EQ(metric.T(z), metric_cl.T(z_cl));
+  expect_near(metric.dtau_dp(z), metric_cl.dtau_dp(z_cl));
+  Eigen::VectorXd p_sharp;
+  metric_cl.dtau_dp_into(z_cl, p_sharp);
+  expect_near(test_inv_metric() * z.p, p_sharp);
+
+  // Neither a new momentum nor a new metric reuses the cached product
+  z_cl.p << 0.1, 0.2, 0.3;
+  expect_near(test_inv_metric() * z_cl.p, metric_cl.dtau_dp(z_cl));
+  z_cl.inv_e_metric_ *= 2;
+  EXPECT_TRUE(z_cl.update_metric_factor());
+  expect_near(2 * test_inv_metric() * z_cl.p,
+                     metric_cl.dtau_dp(z_cl));
+
+  // A metric set from its factor is copied back to the host
+  stan::mcmc::dense_e_cl_point z_factor(3);
+  Eigen::MatrixXd factor = test_inv_metric().llt().matrixL();
+  z_factor.set_metric_factor(factor);
+  expect_near(test_inv_metric(), z_factor.inv_e_metric_);
+}
+
+TEST(McmcDenseEClMetric, sample_p) {
+  rng_t base_rng(0);
+  stan::mcmc::mock_model model(3);
+  stan::mcmc::dense_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::dense_e_cl_metric<stan::mcmc::mock_model, rng_t> metric_cl(
+      model);
+  stan::mcmc::dense_e_point z(3);
+  stan::mcmc::dense_e_cl_point z_cl(3);
+  z.set_metric(test_inv_metric());
+  z_cl.set_metric(test_inv_metric());
+
+  // The same standard normal draws give the same momenta
+  rng_t rng_cl(0);
+  for (int i = 0; i < 5; ++i) {
+    metric.sample_p(z, base_rng);
+    metric_cl.sample_p(z_cl, rng_cl);
+    expect_near(z.p, z_cl.p);
+  }
+}
+
+TEST(McmcDenseEClMetric, not_positive_definite) {
+  stan::mcmc::dense_e_cl_point z(2);
+  Eigen::MatrixXd bad(2, 2);
+  bad << 1, 2, 2, 1;
+  EXPECT_THROW(z.set_metric(bad), std::domain_error);
+  z.inv_e_metric_ = bad;
+  EXPECT_FALSE(z.update_metric_factor());
+}
+#endif
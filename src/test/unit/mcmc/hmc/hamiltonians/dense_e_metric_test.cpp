@@ -1,3 +1,4 @@
+#define EIGEN_RUNTIME_NO_MALLOC
 #include <string>
 #include <boost/random/additive_combine.hpp>
 #include <stan/io/dump.hpp>
@@ -61,6 +62,36 @@ TEST(McmcDenseEMetric, sample_p) {
               < 5.0 * sqrt(var(1, 1) / n_samples));
 }
 
+TEST(McmcDenseEMetric, reuses_storage) {
+  rng_t base_rng(0);
+
+  Eigen::Matrix3d m_inv;
+  m_inv << 2, 0.5, 0, 0.5, 1, 0.2, 0, 0.2, 3;
+
+  stan::mcmc::mock_model model(3);
+
+  stan::mcmc::dense_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::dense_e_point z(3);
+  z.set_metric(m_inv);
+  z.p << 1, -2, 0.5;
+
+  Eigen::VectorXd p_sharp(3);
+  metric.sample_p(z, base_rng);
+  Eigen::VectorXd p = z.p;
+
+  // Once sized, neither the sharp momentum nor new momenta allocate
+  Eigen::internal::set_is_malloc_allowed(false);
+  metric.dtau_dp_into(z, p_sharp);
+  metric.sample_p(z, base_rng);
+  Eigen::internal::set_is_malloc_allowed(true);
+
+  z.p = p;
+  Eigen::VectorXd expected = m_inv * z.p;
+  metric.dtau_dp_into(z, p_sharp);
+  EXPECT_MATRIX_EQ(expected, p_sharp);
+  EXPECT_MATRIX_EQ(metric.dtau_dp(z), p_sharp);
+}
+
 TEST(McmcDenseEMetric, gradients) {
   rng_t base_rng(0);
 
@@ -175,3 +206,47 @@ TEST(McmcDenseEMetric, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(McmcDenseEMetric, cached_metric_factor) {
+  rng_t base_rng(0);
+  rng_t expected_rng(0);
+
+  Eigen::Matrix2d m_inv;
+  m_inv << 0.5, 0.1, 0.1, 0.3;
+
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::dense_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::dense_e_point z(2);
+  EXPECT_TRUE(z.inv_e_metric_factor().isIdentity());
+
+  z.set_metric(m_inv);
+  Eigen::MatrixXd L = m_inv.llt().matrixL();
+  EXPECT_TRUE(z.inv_e_metric_factor().isApprox(L));
+
+  boost::variate_generator<rng_t&, boost::normal_distribution<> > rand_gaus(
+      expected_rng, boost::normal_distribution<>());
+  for (int n = 0; n < 5; ++n) {
+    metric.sample_p(z, base_rng);
+    Eigen::VectorXd u(2);
+    u(0) = rand_gaus();
+    u(1) = rand_gaus();
+    Eigen::VectorXd expected = m_inv.llt().matrixU().solve(u);
+    EXPECT_DOUBLE_EQ(expected(0), z.p(0));
+    EXPECT_DOUBLE_EQ(expected(1), z.p(1));
+  }
+
+  // In place updates, as made by adaptation, need an explicit refresh
+  z.inv_e_metric_ *= 4;
+  EXPECT_TRUE(z.update_metric_factor());
+  EXPECT_TRUE(z.inv_e_metric_factor().isApprox(2 * L));
+
+  // A precomputed factor is kept as is and sets the metric
+  Eigen::MatrixXd L_upper = L;
+  L_upper(0, 1) = 7;
+  z.set_metric_factor(L_upper);
+  EXPECT_TRUE(z.inv_e_metric_factor() == L);
+  EXPECT_TRUE(z.inv_e_metric_.isApprox(m_inv));
+
+  z.inv_e_metric_(1, 1) = -1;
+  EXPECT_FALSE(z.update_metric_factor());
+}
@@ -0,0 +1,255 @@
+#include <stan/io/dump.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_softabs_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/softabs_metric.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <test/test-models/good/mcmc/hmc/hamiltonians/funnel.hpp>
+#include <test/unit/util.hpp>
+
+#include <boost/random/additive_combine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+typedef boost::ecuyer1988 rng_t;
+
+TEST(McmcDiagSoftAbs, sample_p) {
+  rng_t base_rng(0);
+
+  Eigen::VectorXd q(2);
+  q(0) = 5;
+  q(1) = 1;
+
+  stan::mcmc::mock_model model(q.size());
+  stan::mcmc::diag_softabs_metric<stan::mcmc::mock_model, rng_t> metric(
+      model);
+  stan::mcmc::diag_softabs_point z(q.size());
+
+  int n_samples = 1000;
+  double m = 0;
+  double m2 = 0;
+
+  std::stringstream model_output;
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  metric.update_metric(z, logger);
+
+  for (int i = 0; i < n_samples; ++i) {
+    metric.sample_p(z, base_rng);
+    double tau = metric.tau(z);
+
+    double delta = tau - m;
+    m += delta / static_cast<double>(i + 1);
+    m2 += delta * (tau - m);
+  }
+
+  double var = m2 / (n_samples + 1.0);
+
+  // Mean within 5sigma of expected value (d / 2)
+  EXPECT_TRUE(std::fabs(m - 0.5 * q.size()) < 5.0 * sqrt(var));
+
+  // Variance within 10% of expected value (d / 2)
+  EXPECT_TRUE(std::fabs(var - 0.5 * q.size()) < 0.1 * q.size());
+
+  EXPECT_EQ("", model_output.str());
+  EXPECT_EQ("", debug.str());
+  EXPECT_EQ("", info.str());
+  EXPECT_EQ("", warn.str());
+  EXPECT_EQ("", error.str());
+  EXPECT_EQ("", fatal.str());
+}
+
+TEST(McmcDiagSoftAbs, gradients) {
+  rng_t base_rng(0);
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(11);
+
+  stan::mcmc::diag_softabs_point z(q.size());
+  z.q = q;
+  z.p.setOnes();
+
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  std::stringstream model_output;
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  funnel_model_namespace::funnel_model model(data_var_context, 0,
+                                             &model_output);
+
+  stan::mcmc::diag_softabs_metric<funnel_model_namespace::funnel_model,
+                                  rng_t>
+      metric(model);
+
+  // The gradients are exact for any fixed probes, the unit vectors or
+  // fewer Rademacher probes
+  for (int k : {11, 3}) {
+    z.set_num_probes(k);
+    double epsilon = 1e-6;
+
+    metric.init(z, logger);
+    Eigen::VectorXd g1 = metric.dtau_dq(z, logger);
+
+    for (int i = 0; i < z.q.size(); ++i) {
+      double delta = 0;
+
+      z.q(i) += epsilon;
+      metric.init(z, logger);
+      delta += metric.tau(z);
+
+      z.q(i) -= 2 * epsilon;
+      metric.init(z, logger);
+      delta -= metric.tau(z);
+
+      z.q(i) += epsilon;
+
+      delta /= 2 * epsilon;
+
+      EXPECT_NEAR(delta, g1(i), epsilon);
+    }
+
+    metric.init(z, logger);
+    Eigen::VectorXd g2 = metric.dtau_dp(z);
+
+    for (int i = 0; i < z.q.size(); ++i) {
+      double delta = 0;
+
+      z.p(i) += epsilon;
+      delta += metric.tau(z);
+
+      z.p(i) -= 2 * epsilon;
+      delta -= metric.tau(z);
+
+      z.p(i) += epsilon;
+
+      delta /= 2 * epsilon;
+
+      EXPECT_NEAR(delta, g2(i), epsilon);
+    }
+
+    Eigen::VectorXd g3 = metric.dphi_dq(z, logger);
+
+    for (int i = 0; i < z.q.size(); ++i) {
+      double delta = 0;
+
+      z.q(i) += epsilon;
+      metric.init(z, logger);
+      delta += metric.phi(z);
+
+      z.q(i) -= 2 * epsilon;
+      metric.init(z, logger);
+      delta -= metric.phi(z);
+
+      z.q(i) += epsilon;
+
+      delta /= 2 * epsilon;
+
+      EXPECT_NEAR(delta, g3(i), epsilon);
+    }
+  }
+
+  EXPECT_EQ("", model_output.str());
+  EXPECT_EQ("", debug.str());
+  EXPECT_EQ("", info.str());
+  EXPECT_EQ("", warn.str());
+  EXPECT_EQ("", error.str());
+  EXPECT_EQ("", fatal.str());
+}
+
+TEST(McmcDiagSoftAbs, exact_hessian_diag) {
+  Eigen::VectorXd q = Eigen::VectorXd::LinSpaced(11, -1, 1);
+
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  std::stringstream model_output;
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  funnel_model_namespace::funnel_model model(data_var_context, 0,
+                                             &model_output);
+
+  stan::mcmc::softabs_point exact_z(q.size());
+  exact_z.q = q;
+  stan::mcmc::softabs_metric<funnel_model_namespace::funnel_model, rng_t>
+      exact_metric(model);
+  exact_metric.update_metric(exact_z, logger);
+
+  stan::mcmc::diag_softabs_point z(q.size());
+  z.q = q;
+  z.set_num_probes(q.size());
+  stan::mcmc::diag_softabs_metric<funnel_model_namespace::funnel_model,
+                                  rng_t>
+      metric(model);
+  metric.update_metric(z, logger);
+
+  ASSERT_EQ(q.size(), z.num_probes());
+  Eigen::VectorXd diag = exact_z.hessian.diagonal();
+  double log_det = 0;
+  for (int i = 0; i < q.size(); ++i) {
+    EXPECT_NEAR(diag(i), z.hessian_diag(i), 1e-8);
+    EXPECT_GE(z.softabs_diag(i), 1 / z.alpha);
+    log_det += std::log(z.softabs_diag(i));
+  }
+  EXPECT_FLOAT_EQ(log_det, z.log_det_metric);
+
+  // Fewer probes give an unbiased but noisy estimate with the same
+  // positive metric
+  z.set_num_probes(3);
+  metric.update_metric(z, logger);
+  ASSERT_EQ(3, z.num_probes());
+  for (int i = 0; i < q.size(); ++i)
+    EXPECT_GE(z.softabs_diag(i), 1 / z.alpha);
+
+  EXPECT_EQ("", model_output.str());
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcDiagSoftAbs, streams) {
+  stan::test::capture_std_streams();
+  rng_t base_rng(0);
+
+  Eigen::VectorXd q(2);
+  q(0) = 5;
+  q(1) = 1;
+  stan::mcmc::mock_model model(q.size());
+
+  // for use in Google Test macros below
+  typedef stan::mcmc::diag_softabs_metric<stan::mcmc::mock_model, rng_t>
+      softabs;
+
+  EXPECT_NO_THROW(softabs metric(model));
+
+  stan::test::reset_std_streams();
+  EXPECT_EQ("", stan::test::cout_ss.str());
+  EXPECT_EQ("", stan::test::cerr_ss.str());
+}
+
+TEST(McmcDiagSoftAbs, num_grad_evals) {
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+  stan::mcmc::mock_model model(q.size());
+  stan::mcmc::diag_softabs_metric<stan::mcmc::mock_model, rng_t> metric(
+      model);
+  stan::mcmc::diag_softabs_point z(q.size());
+  z.q = q;
+  z.p.setOnes();
+  z.set_num_probes(2);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  // One gradient and one Hessian-vector product per probe
+  metric.init(z, logger);
+  EXPECT_EQ(3u, metric.num_grad_evals());
+  metric.dtau_dq(z, logger);
+  EXPECT_EQ(5u, metric.num_grad_evals());
+  metric.dphi_dq(z, logger);
+  EXPECT_EQ(7u, metric.num_grad_evals());
+  EXPECT_EQ(0u, metric.num_log_prob_evals());
+}
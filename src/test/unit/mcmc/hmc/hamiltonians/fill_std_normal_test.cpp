@@ -0,0 +1,48 @@
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cmath>
+
+TEST(McmcFillStdNormal, matches_elementwise_draws) {
+  boost::ecuyer1988 rng(1234);
+  boost::ecuyer1988 reference(1234);
+  boost::variate_generator<boost::ecuyer1988&, boost::normal_distribution<> >
+      rand_gaus(reference, boost::normal_distribution<>());
+
+  Eigen::VectorXd x(101);
+  stan::mcmc::fill_std_normal(x, rng);
+  for (int i = 0; i < x.size(); ++i)
+    EXPECT_EQ(rand_gaus(), x(i));
+  EXPECT_EQ(reference, rng);
+}
+
+TEST(McmcFillStdNormal, philox_bulk) {
+  stan::util::philox4x32 rng(1234, 1);
+  stan::util::philox4x32 same(1234, 1);
+  Eigen::VectorXd x(100001);
+  Eigen::VectorXd y(100001);
+  stan::mcmc::fill_std_normal(x, rng);
+  stan::mcmc::fill_std_normal(y, same);
+  EXPECT_EQ(x, y);
+  EXPECT_EQ(2U * 50001, rng.position());
+
+  EXPECT_NEAR(0, x.mean(), 0.01);
+  EXPECT_NEAR(1, (x.array() - x.mean()).square().mean(), 0.02);
+  EXPECT_LT(x.cwiseAbs().maxCoeff(), 6.8);
+  EXPECT_TRUE(x.allFinite());
+
+  stan::mcmc::fill_std_normal(y, rng);
+  EXPECT_NE(x, y);
+}
+
+TEST(McmcFillStdNormal, philox_sizes) {
+  stan::util::philox4x32 rng(7);
+  Eigen::VectorXd empty(0);
+  stan::mcmc::fill_std_normal(empty, rng);
+  EXPECT_EQ(0U, rng.position());
+  Eigen::VectorXd one(1);
+  stan::mcmc::fill_std_normal(one, rng);
+  EXPECT_EQ(2U, rng.position());
+  EXPECT_TRUE(std::isfinite(one(0)));
+}
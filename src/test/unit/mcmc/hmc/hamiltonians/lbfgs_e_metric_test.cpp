@@ -0,0 +1,141 @@
+#include <boost/random/additive_combine.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/lbfgs_e_metric.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+// Updates of a quadratic with Hessian a, y = a s
+void quadratic_updates(Eigen::MatrixXd& s, Eigen::MatrixXd& y) {
+  Eigen::MatrixXd a(4, 4);
+  a << 4, 1, 0, 0.5, 1, 3, 0.5, 0, 0, 0.5, 2, 0.25, 0.5, 0, 0.25, 1;
+  s.resize(4, 2);
+  s << 1, 0.5, -0.5, 1, 0.25, -1, 0, 0.5;
+  y = a * s;
+}
+
+// Inverse Hessian of the BFGS recursion from a diagonal, formed densely
+Eigen::MatrixXd bfgs_inverse(const Eigen::VectorXd& diag,
+                             const Eigen::MatrixXd& s,
+                             const Eigen::MatrixXd& y) {
+  Eigen::MatrixXd h = diag.asDiagonal();
+  Eigen::MatrixXd id = Eigen::MatrixXd::Identity(diag.size(), diag.size());
+  for (int i = 0; i < s.cols(); ++i) {
+    double rho = 1 / s.col(i).dot(y.col(i));
+    Eigen::MatrixXd v = id - rho * y.col(i) * s.col(i).transpose();
+    h = v.transpose() * h * v + rho * s.col(i) * s.col(i).transpose();
+  }
+  return h;
+}
+}  // namespace
+
+TEST(McmcLbfgsEMetric, kinetic_energy) {
+  Eigen::MatrixXd s, y;
+  quadratic_updates(s, y);
+  Eigen::Vector4d diag(0.5, 2.0, 1.0, 0.25);
+  Eigen::MatrixXd inv_metric = bfgs_inverse(diag, s, y);
+
+  stan::mcmc::mock_model model(4);
+  stan::mcmc::lbfgs_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::lbfgs_e_point z(4);
+  z.set_metric(diag, s, y);
+  z.p << 0.3, -1.2, 0.7, 2.0;
+
+  Eigen::VectorXd expected = inv_metric * z.p;
+  Eigen::VectorXd dtau_dp = metric.dtau_dp(z);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_FLOAT_EQ(expected(i), dtau_dp(i));
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(expected), metric.T(z));
+  EXPECT_FLOAT_EQ(metric.T(z), metric.tau(z));
+
+  z.set_metric(diag);
+  EXPECT_EQ(0, z.history_size());
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(diag.cwiseProduct(z.p)), metric.T(z));
+}
+
+TEST(McmcLbfgsEMetric, matches_search_direction) {
+  Eigen::MatrixXd s, y;
+  quadratic_updates(s, y);
+  stan::optimization::LBFGSUpdate<> update(5);
+  update.restore(s, y, 0.75);
+
+  stan::mcmc::lbfgs_e_point z(4);
+  z.set_metric(Eigen::VectorXd::Constant(4, update.gammak()), s, y);
+
+  Eigen::VectorXd g(4), direction;
+  g << 1.0, -2.0, 0.5, 0.25;
+  update.search_direction(direction, g);
+  Eigen::VectorXd h_g = z.inv_metric_times(g);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_FLOAT_EQ(-direction(i), h_g(i));
+}
+
+TEST(McmcLbfgsEMetric, sample_p) {
+  rng_t base_rng(0);
+
+  Eigen::MatrixXd s, y;
+  quadratic_updates(s, y);
+  Eigen::Vector4d diag(0.5, 2.0, 1.0, 0.25);
+  Eigen::MatrixXd m = bfgs_inverse(diag, s, y).inverse();
+
+  stan::mcmc::mock_model model(4);
+  stan::mcmc::lbfgs_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::lbfgs_e_point z(4);
+  z.set_metric(diag, s, y);
+
+  // The factor is an exact square root of the mass matrix
+  Eigen::MatrixXd factor(4, 4);
+  for (int j = 0; j < 4; ++j)
+    factor.col(j) = z.metric_sqrt_times(Eigen::VectorXd::Unit(4, j));
+  Eigen::MatrixXd product = factor * factor.transpose();
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 4; ++j)
+      EXPECT_NEAR(m(i, j), product(i, j), 1e-10);
+
+  int n_samples = 10000;
+
+  Eigen::MatrixXd sample_cov = Eigen::MatrixXd::Zero(4, 4);
+  for (int i = 0; i < n_samples; ++i) {
+    metric.sample_p(z, base_rng);
+    sample_cov += z.p * z.p.transpose() / n_samples;
+  }
+
+  // Covariance matrix within 5sigma of expected value (comes from a Wishart
+  // distribution)
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      double var = m(i, j) * m(i, j) + m(i, i) * m(j, j);
+      EXPECT_LT(std::fabs(m(i, j) - sample_cov(i, j)),
+                5.0 * sqrt(var / n_samples));
+    }
+  }
+}
+
+TEST(McmcLbfgsEMetric, set_metric_checks) {
+  Eigen::MatrixXd s, y;
+  quadratic_updates(s, y);
+  stan::mcmc::lbfgs_e_point z(4);
+
+  EXPECT_THROW(z.set_metric(Eigen::VectorXd::Ones(3), s, y),
+               std::invalid_argument);
+  Eigen::MatrixXd y_bad = y;
+  y_bad.col(1) = -s.col(1);
+  EXPECT_THROW(z.set_metric(Eigen::VectorXd::Ones(4), s, y_bad),
+               std::domain_error);
+  EXPECT_EQ(0, z.history_size());
+}
+
+TEST(McmcLbfgsEMetric, write_metric) {
+  Eigen::MatrixXd s, y;
+  quadratic_updates(s, y);
+  stan::mcmc::lbfgs_e_point z(4);
+  z.set_metric(Eigen::VectorXd::Ones(4), s, y);
+
+  stan::test::unit::instrumented_writer writer;
+  z.write_metric(writer);
+  EXPECT_EQ(6, writer.call_count("string"));
+}
@@ -0,0 +1,78 @@
+#include <boost/random/additive_combine.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/lowrank_e_metric.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+
+typedef boost::ecuyer1988 rng_t;
+
+TEST(McmcLowrankEMetric, sample_p) {
+  rng_t base_rng(0);
+
+  Eigen::Vector3d diag(0.5, 2.0, 1.0);
+  Eigen::MatrixXd factor(3, 2);
+  factor << 1.0, 0.0, -0.5, 1.5, 2.0, 0.5;
+  Eigen::MatrixXd m = (Eigen::MatrixXd(diag.asDiagonal())
+                       + factor * factor.transpose())
+                          .inverse();
+
+  stan::mcmc::mock_model model(3);
+
+  stan::mcmc::lowrank_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::lowrank_e_point z(3);
+  z.set_metric(diag, factor);
+
+  int n_samples = 10000;
+
+  Eigen::MatrixXd sample_cov = Eigen::MatrixXd::Zero(3, 3);
+  for (int i = 0; i < n_samples; ++i) {
+    metric.sample_p(z, base_rng);
+    sample_cov += z.p * z.p.transpose() / n_samples;
+  }
+
+  // Covariance matrix within 5sigma of expected value (comes from a Wishart
+  // distribution)
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      double var = m(i, j) * m(i, j) + m(i, i) * m(j, j);
+      EXPECT_LT(std::fabs(m(i, j) - sample_cov(i, j)),
+                5.0 * sqrt(var / n_samples));
+    }
+  }
+}
+
+TEST(McmcLowrankEMetric, kinetic_energy) {
+  Eigen::Vector3d diag(0.5, 2.0, 1.0);
+  Eigen::MatrixXd factor(3, 1);
+  factor << 1.0, -0.5, 2.0;
+  Eigen::MatrixXd inv_metric
+      = Eigen::MatrixXd(diag.asDiagonal()) + factor * factor.transpose();
+
+  stan::mcmc::mock_model model(3);
+  stan::mcmc::lowrank_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::lowrank_e_point z(3);
+  z.set_metric(diag, factor);
+  z.p << 0.3, -1.2, 0.7;
+
+  Eigen::VectorXd expected = inv_metric * z.p;
+  Eigen::VectorXd dtau_dp = metric.dtau_dp(z);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_FLOAT_EQ(expected(i), dtau_dp(i));
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(expected), metric.T(z));
+  EXPECT_FLOAT_EQ(metric.T(z), metric.tau(z));
+
+  z.set_metric(diag);
+  EXPECT_EQ(0, z.lowrank_factor_.cols());
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(diag.cwiseProduct(z.p)), metric.T(z));
+}
+
+TEST(McmcLowrankEMetric, write_metric) {
+  stan::mcmc::lowrank_e_point z(3);
+  Eigen::MatrixXd factor(3, 2);
+  factor << 1.0, 0.0, -0.5, 1.5, 2.0, 0.5;
+  z.set_metric(Eigen::Vector3d(0.5, 2.0, 1.0), factor);
+
+  stan::test::unit::instrumented_writer writer;
+  z.write_metric(writer);
+  EXPECT_EQ(4, writer.call_count("string"));
+}
@@ -170,3 +170,27 @@ TEST(McmcSoftAbs, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(McmcSoftAbs, num_grad_evals) {
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+  stan::mcmc::mock_model model(q.size());
+  stan::mcmc::softabs_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::softabs_point z(q.size());
+  z.q = q;
+  z.p.setOnes();
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  // The Hessian and the gradients of traces with it take one pass per
+  // dimension
+  metric.init(z, logger);
+  EXPECT_EQ(3u, metric.num_grad_evals());
+  metric.dtau_dq(z, logger);
+  EXPECT_EQ(6u, metric.num_grad_evals());
+  metric.dphi_dq(z, logger);
+  EXPECT_EQ(9u, metric.num_grad_evals());
+  metric.update_metric_gradient(z, logger);
+  EXPECT_EQ(9u, metric.num_grad_evals());
+  EXPECT_EQ(0u, metric.num_log_prob_evals());
+}
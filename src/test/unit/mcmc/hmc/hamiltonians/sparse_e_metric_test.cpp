@@ -0,0 +1,119 @@
+#include <boost/random/additive_combine.hpp>
+#include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/mcmc/hmc/hamiltonians/sparse_e_metric.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+// Tridiagonal mass matrix, whose inverse is dense
+Eigen::SparseMatrix<double> test_metric() {
+  Eigen::MatrixXd dense(3, 3);
+  dense << 2.0, -0.8, 0.0, -0.8, 1.5, 0.6, 0.0, 0.6, 1.0;
+  return dense.sparseView();
+}
+}  // namespace
+
+TEST(McmcSparseEMetric, sample_p) {
+  rng_t base_rng(0);
+
+  Eigen::MatrixXd m = Eigen::MatrixXd(test_metric());
+
+  stan::mcmc::mock_model model(3);
+
+  stan::mcmc::sparse_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::sparse_e_point z(3);
+  z.set_metric(test_metric());
+
+  int n_samples = 10000;
+
+  Eigen::MatrixXd sample_cov = Eigen::MatrixXd::Zero(3, 3);
+  for (int i = 0; i < n_samples; ++i) {
+    metric.sample_p(z, base_rng);
+    sample_cov += z.p * z.p.transpose() / n_samples;
+  }
+
+  // Covariance matrix within 5sigma of expected value (comes from a Wishart
+  // distribution)
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      double var = m(i, j) * m(i, j) + m(i, i) * m(j, j);
+      EXPECT_LT(std::fabs(m(i, j) - sample_cov(i, j)),
+                5.0 * sqrt(var / n_samples));
+    }
+  }
+}
+
+TEST(McmcSparseEMetric, kinetic_energy) {
+  stan::mcmc::mock_model model(3);
+  stan::mcmc::sparse_e_metric<stan::mcmc::mock_model, rng_t> metric(model);
+  stan::mcmc::sparse_e_point z(3);
+  z.p << 0.3, -1.2, 0.7;
+
+  // The identity by default
+  EXPECT_FLOAT_EQ(0.5 * z.p.squaredNorm(), metric.T(z));
+
+  z.set_metric(test_metric());
+  Eigen::MatrixXd inv_metric = Eigen::MatrixXd(test_metric()).inverse();
+  Eigen::VectorXd expected = inv_metric * z.p;
+  Eigen::VectorXd dtau_dp = metric.dtau_dp(z);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_FLOAT_EQ(expected(i), dtau_dp(i));
+  EXPECT_FLOAT_EQ(0.5 * z.p.dot(expected), metric.T(z));
+  EXPECT_FLOAT_EQ(metric.T(z), metric.tau(z));
+
+  // Copies share the factor until the metric of one of them changes
+  stan::mcmc::sparse_e_point copy(z);
+  z.e_metric_ *= 2;
+  z.update_metric_factor();
+  EXPECT_FLOAT_EQ(0.5 * metric.T(copy), metric.T(z));
+}
+
+TEST(McmcSparseEMetric, set_metric_errors) {
+  stan::mcmc::sparse_e_point z(3);
+  EXPECT_THROW(z.set_metric(Eigen::SparseMatrix<double>(2, 2)),
+               std::invalid_argument);
+
+  Eigen::MatrixXd indefinite(3, 3);
+  indefinite << 1.0, 2.0, 0.0, 2.0, 1.0, 0.0, 0.0, 0.0, 1.0;
+  EXPECT_THROW(z.set_metric(indefinite.sparseView()), std::invalid_argument);
+
+  // The previous metric is kept
+  z.p << 0.3, -1.2, 0.7;
+  EXPECT_FLOAT_EQ(z.p.squaredNorm(), z.p.dot(z.inv_metric_times(z.p)));
+  EXPECT_EQ(3, z.e_metric_.nonZeros());
+}
+
+TEST(McmcSparseEMetric, write_metric) {
+  stan::mcmc::sparse_e_point z(3);
+  z.set_metric(test_metric());
+
+  stan::test::unit::instrumented_writer writer;
+  z.write_metric(writer);
+  // Header and the five nonzeros of the lower triangle
+  EXPECT_EQ(6, writer.call_count("string"));
+}
+
+TEST(McmcSparseEMetric, state) {
+  stan::mcmc::sparse_e_point z(3);
+  z.set_metric(test_metric());
+  z.q << 1, 2, 3;
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  z.write_state(writer);
+
+  stan::mcmc::sparse_e_point restored(3);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(0, (Eigen::MatrixXd(restored.e_metric_)
+                - Eigen::MatrixXd(test_metric()))
+                   .norm());
+  Eigen::VectorXd x(3);
+  x << 0.5, -1, 2;
+  EXPECT_FLOAT_EQ(z.inv_metric_times(x).dot(x),
+                  restored.inv_metric_times(x).dot(x));
+}
@@ -0,0 +1,91 @@
+#include <stan/mcmc/hmc/integrators/expl_three_stage.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stan/callbacks/stream_logger.hpp>
+#include <test/test-models/good/mcmc/hmc/integrators/gauss.hpp>
+#include <stan/io/dump.hpp>
+#include <stan/mcmc/hmc/hamiltonians/unit_e_metric.hpp>
+#include <stan/mcmc/hmc/hamiltonians/diag_e_metric.hpp>
+#include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+
+typedef boost::ecuyer1988 rng_t;
+typedef stan::mcmc::unit_e_metric<gauss_model_namespace::gauss_model, rng_t>
+    unit_metric_t;
+
+class McmcHmcIntegratorsExplThreeStage : public testing::Test {
+ public:
+  McmcHmcIntegratorsExplThreeStage()
+      : data_var_context(data_stream),
+        logger(debug, info, warn, error, fatal),
+        model(data_var_context) {}
+
+  void TearDown() {
+    EXPECT_EQ("", debug.str());
+    EXPECT_EQ("", info.str());
+    EXPECT_EQ("", warn.str());
+    EXPECT_EQ("", error.str());
+    EXPECT_EQ("", fatal.str());
+  }
+
+  // Largest energy error along a trajectory of a given length
+  template <class Integrator>
+  double max_energy_error(Integrator& integrator, double epsilon,
+                          double tau) {
+    unit_metric_t metric(model);
+    stan::mcmc::unit_e_point z(1);
+    z.q(0) = 1;
+    z.p(0) = 1;
+    metric.init(z, logger);
+    double H0 = metric.H(z);
+    double max_error = 0;
+    for (size_t n = 0; n < tau / epsilon; ++n) {
+      integrator.evolve(z, metric, epsilon, logger);
+      max_error = std::max(max_error, std::fabs(metric.H(z) - H0));
+    }
+    return max_error;
+  }
+
+  std::stringstream data_stream;
+  stan::io::dump data_var_context;
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger;
+  gauss_model_namespace::gauss_model model;
+};
+
+TEST_F(McmcHmcIntegratorsExplThreeStage, energy_conservation) {
+  stan::mcmc::expl_three_stage<unit_metric_t> integrator;
+  double epsilon = 1e-3;
+  EXPECT_NEAR(0, max_energy_error(integrator, epsilon, 6.28318530717959),
+              epsilon * epsilon);
+}
+
+TEST_F(McmcHmcIntegratorsExplThreeStage, smaller_error_than_leapfrog) {
+  // Steps of the same cost: one three-stage step takes three gradients
+  stan::mcmc::expl_three_stage<unit_metric_t> three_stage;
+  stan::mcmc::expl_leapfrog<unit_metric_t> leapfrog;
+  for (double epsilon : {0.5, 1.0, 1.25}) {
+    double three_stage_error
+        = max_energy_error(three_stage, 3 * epsilon, 6.28318530717959);
+    double leapfrog_error
+        = max_energy_error(leapfrog, epsilon, 6.28318530717959);
+    EXPECT_LT(three_stage_error, leapfrog_error) << "epsilon = " << epsilon;
+  }
+}
+
+TEST_F(McmcHmcIntegratorsExplThreeStage, reversibility) {
+  stan::mcmc::expl_three_stage<unit_metric_t> integrator;
+  unit_metric_t metric(model);
+  stan::mcmc::unit_e_point z(1);
+  z.q(0) = 0.7;
+  z.p(0) = -1.3;
+  metric.init(z, logger);
+  for (int n = 0; n < 20; ++n)
+    integrator.evolve(z, metric, 0.6, logger);
+  z.p = -z.p;
+  for (int n = 0; n < 20; ++n)
+    integrator.evolve(z, metric, 0.6, logger);
+  EXPECT_NEAR(0.7, z.q(0), 1e-10);
+  EXPECT_NEAR(1.3, z.p(0), 1e-10);
+}
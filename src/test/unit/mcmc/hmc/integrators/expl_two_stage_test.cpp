@@ -0,0 +1,128 @@
+#include <stan/mcmc/hmc/integrators/expl_two_stage.hpp>
+#include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stan/callbacks/stream_logger.hpp>
+#include <test/test-models/good/mcmc/hmc/integrators/gauss.hpp>
+#include <stan/io/dump.hpp>
+#include <stan/mcmc/hmc/hamiltonians/unit_e_metric.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/static/unit_e_static_hmc.hpp>
+#include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+
+typedef boost::ecuyer1988 rng_t;
+typedef stan::mcmc::unit_e_metric<gauss_model_namespace::gauss_model, rng_t>
+    unit_metric_t;
+
+class McmcHmcIntegratorsExplTwoStage : public testing::Test {
+ public:
+  McmcHmcIntegratorsExplTwoStage()
+      : data_var_context(data_stream),
+        logger(debug, info, warn, error, fatal),
+        model(data_var_context) {}
+
+  void TearDown() {
+    EXPECT_EQ("", debug.str());
+    EXPECT_EQ("", info.str());
+    EXPECT_EQ("", warn.str());
+    EXPECT_EQ("", error.str());
+    EXPECT_EQ("", fatal.str());
+  }
+
+  // Largest energy error along a trajectory of a given length
+  template <class Integrator>
+  double max_energy_error(Integrator& integrator, double epsilon,
+                          double tau) {
+    unit_metric_t metric(model);
+    stan::mcmc::unit_e_point z(1);
+    z.q(0) = 1;
+    z.p(0) = 1;
+    metric.init(z, logger);
+    double H0 = metric.H(z);
+    double max_error = 0;
+    for (size_t n = 0; n < tau / epsilon; ++n) {
+      integrator.evolve(z, metric, epsilon, logger);
+      max_error = std::max(max_error, std::fabs(metric.H(z) - H0));
+    }
+    return max_error;
+  }
+
+  std::stringstream data_stream;
+  stan::io::dump data_var_context;
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger;
+  gauss_model_namespace::gauss_model model;
+};
+
+TEST_F(McmcHmcIntegratorsExplTwoStage, energy_conservation) {
+  stan::mcmc::expl_two_stage<unit_metric_t> integrator;
+  double epsilon = 1e-3;
+  EXPECT_NEAR(0, max_energy_error(integrator, epsilon, 6.28318530717959),
+              epsilon * epsilon);
+}
+
+TEST_F(McmcHmcIntegratorsExplTwoStage, smaller_error_than_leapfrog) {
+  // Steps of the same cost: one two-stage step takes two gradients
+  stan::mcmc::expl_two_stage<unit_metric_t> two_stage;
+  stan::mcmc::expl_leapfrog<unit_metric_t> leapfrog;
+  for (double epsilon : {0.5, 0.75, 1.0}) {
+    double two_stage_error
+        = max_energy_error(two_stage, 2 * epsilon, 6.28318530717959);
+    double leapfrog_error
+        = max_energy_error(leapfrog, epsilon, 6.28318530717959);
+    EXPECT_LT(two_stage_error, leapfrog_error) << "epsilon = " << epsilon;
+  }
+}
+
+TEST_F(McmcHmcIntegratorsExplTwoStage, reversibility) {
+  stan::mcmc::expl_two_stage<unit_metric_t> integrator;
+  unit_metric_t metric(model);
+  stan::mcmc::unit_e_point z(1);
+  z.q(0) = 0.7;
+  z.p(0) = -1.3;
+  metric.init(z, logger);
+  for (int n = 0; n < 20; ++n)
+    integrator.evolve(z, metric, 0.4, logger);
+  z.p = -z.p;
+  for (int n = 0; n < 20; ++n)
+    integrator.evolve(z, metric, 0.4, logger);
+  EXPECT_NEAR(0.7, z.q(0), 1e-10);
+  EXPECT_NEAR(1.3, z.p(0), 1e-10);
+}
+
+TEST_F(McmcHmcIntegratorsExplTwoStage, samplers) {
+  rng_t base_rng(4839294);
+  Eigen::VectorXd q(1);
+  q(0) = 1;
+
+  stan::mcmc::adapt_diag_e_nuts<gauss_model_namespace::gauss_model, rng_t,
+                                stan::mcmc::expl_two_stage>
+      nuts(model, base_rng);
+  nuts.z().q = q;
+  nuts.init_hamiltonian(logger);
+  nuts.set_nominal_stepsize(0.5);
+  stan::mcmc::sample s(q, 0, 0);
+  s = nuts.transition(s, logger);
+  for (int n = 1; n < 10; ++n) {
+    // n_leapfrog__ counts both gradients of every step; the gradient at
+    // the start of the transition is reused from the previous one
+    size_t grad_evals = nuts.get_num_grad_evals();
+    s = nuts.transition(s, logger);
+    EXPECT_EQ(grad_evals + static_cast<size_t>(nuts.n_leapfrog_),
+              nuts.get_num_grad_evals());
+    EXPECT_EQ(0, nuts.n_leapfrog_ % 2);
+  }
+  EXPECT_FALSE(nuts.divergent_);
+
+  stan::mcmc::unit_e_static_hmc<gauss_model_namespace::gauss_model, rng_t,
+                                stan::mcmc::expl_two_stage>
+      hmc(model, base_rng);
+  hmc.z().q = q;
+  hmc.init_hamiltonian(logger);
+  hmc.set_nominal_stepsize_and_T(1.0, 3.0);
+  stan::mcmc::sample t(q, 0, 0);
+  for (int n = 0; n < 10; ++n)
+    t = hmc.transition(t, logger);
+  EXPECT_LT(0.5, t.accept_stat());
+}
@@ -575,6 +575,41 @@ TEST_F(McmcHmcIntegratorsImplLeapfrogF, softabs_evolve) {
   EXPECT_NEAR(z.p(0), 0.51066062899615283, 5e-14);
   EXPECT_NEAR(z.g(0), -1.8280659814655078, 5e-14);
 
+  // At least one iteration each for the two momentum half steps and the
+  // position update, at most the maximum for the fixed point updates
+  int n = softabs_integrator.num_fixed_point_iterations();
+  EXPECT_LE(3, n);
+  EXPECT_GE(2 * softabs_integrator.max_num_fixed_point() + 1, n);
+  softabs_integrator.reset_num_fixed_point_iterations();
+  EXPECT_EQ(0, softabs_integrator.num_fixed_point_iterations());
+
+  EXPECT_EQ("", debug.str());
+  EXPECT_EQ("", info.str());
+  EXPECT_EQ("", warn.str());
+  EXPECT_EQ("", error.str());
+  EXPECT_EQ("", fatal.str());
+}
+
+TEST_F(McmcHmcIntegratorsImplLeapfrogF, softabs_last_dphi_dq) {
+  stan::mcmc::softabs_point z(1);
+  z.q(0) = 1.27097196280777;
+  z.p(0) = -0.159996782671291;
+
+  stan::mcmc::softabs_metric<command_model_namespace::command_model, rng_t>
+      hamiltonian(*model);
+  hamiltonian.init(z, logger);
+
+  EXPECT_EQ(nullptr, softabs_integrator.last_dphi_dq());
+  softabs_integrator.evolve(z, hamiltonian, 2.40769920051673, logger);
+
+  // The gradient of phi from the final momentum update is the gradient
+  // at the end point, so the virial derivative can reuse it
+  const Eigen::VectorXd* dphi_dq = softabs_integrator.last_dphi_dq();
+  ASSERT_NE(nullptr, dphi_dq);
+  EXPECT_EQ(hamiltonian.dphi_dq(z, logger), *dphi_dq);
+  EXPECT_EQ(hamiltonian.dG_dt(z, logger),
+            hamiltonian.dG_dt_given_dphi_dq(z, *dphi_dq, logger));
+
   EXPECT_EQ("", debug.str());
   EXPECT_EQ("", info.str());
   EXPECT_EQ("", warn.str());
@@ -1,7 +1,9 @@
 #include <test/unit/mcmc/hmc/mock_hmc.hpp>
+#include <stan/callbacks/matrix_writer.hpp>
 #include <stan/callbacks/stream_logger.hpp>
 #include <stan/mcmc/hmc/nuts/base_nuts.hpp>
 #include <stan/mcmc/hmc/integrators/expl_leapfrog.hpp>
+#include <stan/mcmc/hmc/hamiltonians/fill_std_normal.hpp>
 #include <vector>
 #include <boost/random/additive_combine.hpp>
 #include <gtest/gtest.h>
@@ -99,6 +101,52 @@ class divergent_nuts : public base_nuts<mock_model, divergent_hamiltonian,
             m, rng) {}
 };
 
+// Harmonic oscillator, whose trajectories turn around
+template <typename M, typename BaseRNG>
+class oscillator_hamiltonian : public base_hamiltonian<M, ps_point, BaseRNG> {
+ public:
+  explicit oscillator_hamiltonian(const M& m)
+      : base_hamiltonian<M, ps_point, BaseRNG>(m) {}
+
+  double T(ps_point& z) { return 0.5 * z.p.squaredNorm(); }
+
+  double tau(ps_point& z) { return T(z); }
+  double phi(ps_point& z) { return this->V(z); }
+
+  double dG_dt(ps_point& z, callbacks::logger& logger) {
+    return 2 * T(z) - z.q.dot(z.g);
+  }
+
+  Eigen::VectorXd dtau_dq(ps_point& z, callbacks::logger& logger) {
+    return Eigen::VectorXd::Zero(z.q.size());
+  }
+
+  Eigen::VectorXd dtau_dp(ps_point& z) { return z.p; }
+
+  Eigen::VectorXd dphi_dq(ps_point& z, callbacks::logger& logger) {
+    return z.g;
+  }
+
+  void init(ps_point& z, callbacks::logger& logger) {
+    update_potential_gradient(z, logger);
+  }
+
+  void sample_p(ps_point& z, BaseRNG& rng) { fill_std_normal(z.p, rng); }
+
+  void update_potential_gradient(ps_point& z, callbacks::logger& logger) {
+    z.V = 0.5 * z.q.squaredNorm();
+    z.g = z.q;
+  }
+};
+
+class oscillator_nuts : public base_nuts<mock_model, oscillator_hamiltonian,
+                                         expl_leapfrog, rng_t> {
+ public:
+  oscillator_nuts(const mock_model& m, rng_t& rng)
+      : base_nuts<mock_model, oscillator_hamiltonian, expl_leapfrog, rng_t>(
+            m, rng) {}
+};
+
 }  // namespace mcmc
 }  // namespace stan
 
@@ -373,6 +421,56 @@ TEST(McmcNutsBaseNuts, transition) {
   EXPECT_EQ("", fatal.str());
 }
 
+TEST(McmcNutsBaseNuts, transition_reuses_workspace) {
+  rng_t base_rng(0);
+  rng_t fresh_rng(0);
+
+  int model_size = 1;
+  double init_momentum = 1.5;
+
+  stan::mcmc::ps_point z_init(model_size);
+  z_init.q(0) = 0;
+  z_init.p(0) = init_momentum;
+
+  stan::mcmc::mock_model model(model_size);
+  stan::mcmc::mock_nuts sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize(1);
+  sampler.set_stepsize_jitter(0);
+  sampler.sample_stepsize();
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  stan::mcmc::sample init_sample(z_init.q, 0, 0);
+
+  // Scratch storage left over from previous trajectories, including
+  // ones deeper than the current maximum, must not leak into new ones
+  sampler.set_max_depth(7);
+  sampler.z() = z_init;
+  sampler.transition(init_sample, logger);
+  sampler.set_max_depth(5);
+
+  for (int n = 0; n < 3; ++n) {
+    fresh_rng = base_rng;
+    stan::mcmc::mock_nuts fresh_sampler(model, fresh_rng);
+    fresh_sampler.set_nominal_stepsize(1);
+    fresh_sampler.set_stepsize_jitter(0);
+    fresh_sampler.sample_stepsize();
+    fresh_sampler.z() = z_init;
+    stan::mcmc::sample s_fresh = fresh_sampler.transition(init_sample, logger);
+
+    sampler.z() = z_init;
+    stan::mcmc::sample s = sampler.transition(init_sample, logger);
+
+    EXPECT_EQ(fresh_sampler.depth_, sampler.depth_);
+    EXPECT_EQ(fresh_sampler.n_leapfrog_, sampler.n_leapfrog_);
+    EXPECT_EQ(s_fresh.cont_params()(0), s.cont_params()(0));
+    EXPECT_EQ(s_fresh.accept_stat(), s.accept_stat());
+  }
+  EXPECT_EQ("", error.str());
+}
+
 TEST(McmcNutsBaseNuts, transition_egde_momenta) {
   rng_t base_rng(0);
 
@@ -437,3 +535,245 @@ TEST(McmcNutsBaseNuts, transition_egde_momenta) {
   EXPECT_EQ(init_momentum, sampler.p_sharp_minus_values[8]);
   EXPECT_EQ(3 * init_momentum, sampler.p_sharp_plus_values[8]);
 }
+
+TEST(McmcNutsBaseNuts, divergence_writer) {
+  rng_t base_rng(0);
+
+  int model_size = 1;
+
+  stan::mcmc::ps_point z_init(model_size);
+  z_init.q(0) = 0;
+  z_init.p(0) = 1.5;
+
+  stan::mcmc::mock_model model(model_size);
+  stan::mcmc::divergent_nuts sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize(1);
+  sampler.set_stepsize_jitter(0);
+  sampler.set_max_delta(100);
+  sampler.sample_stepsize();
+  sampler.z() = z_init;
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  stan::callbacks::matrix_writer writer(16);
+  sampler.set_divergence_writer(&writer);
+
+  stan::mcmc::sample init_sample(z_init.q, 0, 0);
+  sampler.transition(init_sample, logger);
+  ASSERT_TRUE(sampler.divergent_);
+
+  std::vector<std::string> names{"transition__", "position__", "potential__",
+                                 "energy_error__", "q.1"};
+  EXPECT_EQ(names, writer.names());
+  Eigen::MatrixXd draws = writer.draws();
+  ASSERT_EQ(sampler.n_leapfrog_ + 1, draws.rows());
+  EXPECT_EQ(1, draws(0, 0));
+  EXPECT_EQ(0, draws(0, 1));
+  EXPECT_EQ(0, draws(0, 3));
+  EXPECT_GT(draws(draws.rows() - 1, 3), sampler.get_max_delta());
+
+  // Only the latest states are kept; names are written again, which
+  // clears the draws of the matrix writer
+  sampler.set_divergence_writer(&writer, 2);
+  sampler.z() = z_init;
+  sampler.transition(init_sample, logger);
+  ASSERT_TRUE(sampler.divergent_);
+  EXPECT_EQ(names, writer.names());
+  draws = writer.draws();
+  ASSERT_EQ(2, draws.rows());
+  EXPECT_EQ(2, draws(1, 0));
+  EXPECT_GT(draws(draws.rows() - 1, 3), sampler.get_max_delta());
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcNutsBaseNuts, divergence_writer_no_divergence) {
+  rng_t base_rng(0);
+
+  stan::mcmc::ps_point z_init(1);
+  z_init.q(0) = 0;
+  z_init.p(0) = 1.5;
+
+  stan::mcmc::mock_model model(1);
+  stan::mcmc::mock_nuts sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize(1);
+  sampler.set_stepsize_jitter(0);
+  sampler.sample_stepsize();
+  sampler.z() = z_init;
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  stan::callbacks::matrix_writer writer(16);
+  sampler.set_divergence_writer(&writer);
+
+  stan::mcmc::sample init_sample(z_init.q, 0, 0);
+  sampler.transition(init_sample, logger);
+  EXPECT_FALSE(sampler.divergent_);
+  EXPECT_TRUE(writer.names().empty());
+  EXPECT_EQ(0, writer.num_draws());
+}
+
+TEST(McmcNutsBaseNuts, iterative_rho_aggregation) {
+  rng_t base_rng(0);
+  rng_t iterative_rng(0);
+
+  int model_size = 1;
+  double init_momentum = 1.5;
+
+  stan::mcmc::ps_point z_init(model_size);
+  z_init.q(0) = 0;
+  z_init.p(0) = init_momentum;
+
+  stan::mcmc::mock_model model(model_size);
+  stan::mcmc::rho_inspector_mock_nuts sampler(model, base_rng);
+  stan::mcmc::rho_inspector_mock_nuts iterative(model, iterative_rng);
+  iterative.set_iterative(true);
+  EXPECT_TRUE(iterative.get_iterative());
+  EXPECT_FALSE(sampler.get_iterative());
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  for (stan::mcmc::rho_inspector_mock_nuts* s : {&sampler, &iterative}) {
+    stan::mcmc::ps_point z_propose(model_size);
+    Eigen::VectorXd p_begin = Eigen::VectorXd::Zero(model_size);
+    Eigen::VectorXd p_sharp_begin = Eigen::VectorXd::Zero(model_size);
+    Eigen::VectorXd p_end = Eigen::VectorXd::Zero(model_size);
+    Eigen::VectorXd p_sharp_end = Eigen::VectorXd::Zero(model_size);
+    Eigen::VectorXd rho = z_init.p;
+    double log_sum_weight = -std::numeric_limits<double>::infinity();
+    int n_leapfrog = 0;
+    double sum_metro_prob = 0;
+
+    s->set_nominal_stepsize(1);
+    s->set_stepsize_jitter(0);
+    s->sample_stepsize();
+    s->z() = z_init;
+    EXPECT_TRUE(s->build_tree(3, z_propose, p_sharp_begin, p_sharp_end, rho,
+                              p_begin, p_end, -0.1, 1, n_leapfrog,
+                              log_sum_weight, sum_metro_prob, logger));
+    EXPECT_EQ(8, n_leapfrog);
+    EXPECT_EQ(9 * init_momentum, rho(0));
+  }
+  EXPECT_EQ(sampler.rho_values, iterative.rho_values);
+  EXPECT_EQ(base_rng(), iterative_rng());
+}
+
+TEST(McmcNutsBaseNuts, iterative_same_draws_as_recursive) {
+  rng_t base_rng(483892);
+  rng_t iterative_rng(483892);
+
+  int model_size = 3;
+  stan::mcmc::mock_model model(model_size);
+  stan::mcmc::oscillator_nuts sampler(model, base_rng);
+  stan::mcmc::oscillator_nuts iterative(model, iterative_rng);
+  iterative.set_iterative(true);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  Eigen::VectorXd q(model_size);
+  q << 1, -1, 0.5;
+  stan::mcmc::sample s(q, 0, 0);
+  stan::mcmc::sample s_iterative(q, 0, 0);
+  for (stan::mcmc::oscillator_nuts* n : {&sampler, &iterative}) {
+    n->set_nominal_stepsize(0.05);
+    n->set_stepsize_jitter(0);
+    n->set_max_depth(8);
+  }
+
+  int max_depth_seen = 0;
+  int num_divergent = 0;
+  for (int n = 0; n < 200; ++n) {
+    // Large steps every so often for divergences
+    double stepsize = n % 10 == 9 ? 2.5 : 0.05 + 0.01 * (n % 7);
+    sampler.set_nominal_stepsize(stepsize);
+    iterative.set_nominal_stepsize(stepsize);
+    s = sampler.transition(s, logger);
+    s_iterative = iterative.transition(s_iterative, logger);
+    for (int i = 0; i < model_size; ++i)
+      ASSERT_EQ(s.cont_params()(i), s_iterative.cont_params()(i));
+    ASSERT_EQ(s.log_prob(), s_iterative.log_prob());
+    ASSERT_EQ(s.accept_stat(), s_iterative.accept_stat());
+    ASSERT_EQ(sampler.depth_, iterative.depth_);
+    ASSERT_EQ(sampler.n_leapfrog_, iterative.n_leapfrog_);
+    ASSERT_EQ(sampler.divergent_, iterative.divergent_);
+    ASSERT_EQ(sampler.energy_, iterative.energy_);
+    max_depth_seen = std::max(max_depth_seen, sampler.depth_);
+    num_divergent += sampler.divergent_;
+  }
+  EXPECT_GE(max_depth_seen, 5);
+  EXPECT_GT(num_divergent, 0);
+  EXPECT_EQ(base_rng(), iterative_rng());
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcNutsBaseNuts, warmup_gradient_budget) {
+  rng_t base_rng(0);
+
+  stan::mcmc::ps_point z_init(1);
+  z_init.q(0) = 0;
+  z_init.p(0) = 1.5;
+
+  stan::mcmc::mock_model model(1);
+  stan::mcmc::mock_nuts sampler(model, base_rng);
+
+  sampler.set_nominal_stepsize(1);
+  sampler.set_stepsize_jitter(0);
+  sampler.sample_stepsize();
+  sampler.set_max_depth(8);
+  sampler.set_warmup_gradient_budget(20);
+  EXPECT_EQ(20, sampler.get_warmup_gradient_budget());
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+  stan::mcmc::sample init_sample(z_init.q, 0, 0);
+
+  // Only warmup transitions are limited to 15 leapfrog steps
+  sampler.z() = z_init;
+  sampler.set_warmup_transition(true);
+  sampler.transition(init_sample, logger);
+  EXPECT_EQ(4, sampler.depth_);
+  EXPECT_EQ(15, sampler.n_leapfrog_);
+  EXPECT_EQ(1, sampler.get_treedepth_monitor().num_saturated());
+
+  sampler.z() = z_init;
+  sampler.set_warmup_transition(false);
+  sampler.transition(init_sample, logger);
+  EXPECT_EQ(8, sampler.depth_);
+  EXPECT_EQ(255, sampler.n_leapfrog_);
+  EXPECT_EQ(1, sampler.get_treedepth_monitor().num_saturated());
+}
+
+TEST(McmcNutsBaseNuts, treedepth_monitor_warns_once) {
+  stan::mcmc::treedepth_monitor monitor;
+  monitor.set_window(4, 0.5);
+  EXPECT_EQ(10, monitor.depth_limit(10));
+  monitor.set_gradient_budget(1);
+  EXPECT_EQ(1, monitor.depth_limit(10));
+  monitor.set_gradient_budget(7);
+  EXPECT_EQ(3, monitor.depth_limit(10));
+  EXPECT_EQ(2, monitor.depth_limit(2));
+  monitor.set_gradient_budget(0);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  // A window with one saturated transition of four stays quiet
+  for (int depth : {10, 3, 4, 5})
+    monitor.record(depth, 10, 10, logger);
+  EXPECT_EQ("", warn.str());
+
+  for (int depth : {10, 10, 4, 5})
+    monitor.record(depth, 10, 10, logger);
+  EXPECT_NE(std::string::npos, warn.str().find("2 of the last 4"));
+
+  std::string first = warn.str();
+  for (int depth : {10, 10, 10, 10})
+    monitor.record(depth, 10, 10, logger);
+  EXPECT_EQ(first, warn.str());
+  EXPECT_EQ(7, monitor.num_saturated());
+}
@@ -0,0 +1,243 @@
+#include <stan/mcmc/hmc/nuts/lockstep_nuts.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+
+/**
+ * Independent normals centered at zero with a scale per chain, counting
+ * the evaluations of each chain.
+ */
+struct normal_batch_gradient {
+  Eigen::VectorXd scale;
+  std::vector<int> evaluations;
+
+  explicit normal_batch_gradient(const Eigen::VectorXd& s)
+      : scale(s), evaluations(s.size(), 0) {}
+
+  void operator()(const Eigen::MatrixXd& q,
+                  const stan::mcmc::chain_mask& active, Eigen::VectorXd& lp,
+                  Eigen::MatrixXd& grad) {
+    for (Eigen::Index k = 0; k < q.cols(); ++k) {
+      if (!active(k))
+        continue;
+      double inv_var = 1 / (scale(k) * scale(k));
+      lp(k) = -0.5 * q.col(k).squaredNorm() * inv_var;
+      grad.col(k) = -q.col(k) * inv_var;
+      ++evaluations[k];
+    }
+  }
+};
+
+/**
+ * Correlated normal centered at zero with the same precision for every
+ * chain.
+ */
+struct correlated_batch_gradient {
+  Eigen::MatrixXd precision;
+
+  explicit correlated_batch_gradient(const Eigen::MatrixXd& covariance)
+      : precision(covariance.inverse()) {}
+
+  void operator()(const Eigen::MatrixXd& q,
+                  const stan::mcmc::chain_mask& active, Eigen::VectorXd& lp,
+                  Eigen::MatrixXd& grad) {
+    for (Eigen::Index k = 0; k < q.cols(); ++k) {
+      if (!active(k))
+        continue;
+      grad.col(k) = -precision * q.col(k);
+      lp(k) = 0.5 * q.col(k).dot(grad.col(k));
+    }
+  }
+};
+
+typedef stan::mcmc::lockstep_nuts<normal_batch_gradient, rng_t> sampler_t;
+typedef stan::mcmc::lockstep_nuts<correlated_batch_gradient, rng_t>
+    dense_sampler_t;
+
+}  // namespace
+
+TEST(McmcLockstepNuts, chain_draws_do_not_depend_on_batch) {
+  Eigen::VectorXd scale(4);
+  scale << 1, 0.1, 3, 20;
+  Eigen::MatrixXd q0 = Eigen::MatrixXd::Constant(3, 4, 0.5);
+  std::vector<rng_t> rngs;
+  for (int k = 0; k < 4; ++k)
+    rngs.emplace_back(1234 + k);
+  normal_batch_gradient batch_gradient(scale);
+  sampler_t batch(batch_gradient, q0, rngs);
+  batch.set_stepsize(0.3);
+
+  std::vector<rng_t> rng_alone(1, rng_t(1234 + 2));
+  normal_batch_gradient gradient_alone(scale.segment(2, 1));
+  sampler_t alone(gradient_alone, q0.col(2), rng_alone);
+  alone.set_stepsize(0.3);
+
+  for (int n = 0; n < 200; ++n) {
+    batch.transition();
+    alone.transition();
+    for (int i = 0; i < 3; ++i)
+      ASSERT_EQ(alone.q()(i, 0), batch.q()(i, 2));
+    ASSERT_EQ(alone.lp()(0), batch.lp()(2));
+    ASSERT_EQ(alone.treedepth()(0), batch.treedepth()(2));
+    ASSERT_EQ(alone.n_leapfrog()(0), batch.n_leapfrog()(2));
+    ASSERT_EQ(alone.accept_stat()(0), batch.accept_stat()(2));
+    ASSERT_EQ(alone.energy()(0), batch.energy()(2));
+  }
+  EXPECT_EQ(rng_alone[0](), rngs[2]());
+}
+
+TEST(McmcLockstepNuts, masked_chains_are_not_evaluated) {
+  Eigen::VectorXd scale(3);
+  scale << 1, 0.01, 100;
+  std::vector<rng_t> rngs{rng_t(1), rng_t(2), rng_t(3)};
+  normal_batch_gradient gradient(scale);
+  sampler_t sampler(gradient, Eigen::MatrixXd::Ones(2, 3), rngs);
+  sampler.set_stepsize(0.5);
+
+  int n_leapfrog[3] = {0, 0, 0};
+  for (int n = 0; n < 50; ++n) {
+    sampler.transition();
+    for (int k = 0; k < 3; ++k)
+      n_leapfrog[k] += sampler.n_leapfrog()(k);
+  }
+  // One evaluation at the initial point and one per leapfrog step
+  for (int k = 0; k < 3; ++k)
+    EXPECT_EQ(n_leapfrog[k] + 1, gradient.evaluations[k]);
+  // The narrow chain diverges at once and the wide one runs long
+  EXPECT_TRUE(sampler.divergent()(1));
+  EXPECT_EQ(1, sampler.n_leapfrog()(1));
+  EXPECT_FALSE(sampler.divergent()(2));
+  EXPECT_GT(n_leapfrog[2], n_leapfrog[0]);
+}
+
+TEST(McmcLockstepNuts, max_depth) {
+  Eigen::VectorXd scale = Eigen::VectorXd::Ones(2);
+  std::vector<rng_t> rngs{rng_t(5), rng_t(6)};
+  normal_batch_gradient gradient(scale);
+  sampler_t sampler(gradient, Eigen::MatrixXd::Ones(2, 2), rngs);
+  Eigen::ArrayXd epsilon(2);
+  epsilon << 1e-3, 0.8;
+  sampler.set_stepsize(epsilon);
+  sampler.set_max_depth(6);
+  sampler.transition();
+  EXPECT_EQ(6, sampler.treedepth()(0));
+  EXPECT_EQ(63, sampler.n_leapfrog()(0));
+  EXPECT_LT(sampler.treedepth()(1), 6);
+  EXPECT_FALSE(sampler.divergent().any());
+}
+
+TEST(McmcLockstepNuts, moments_with_adapted_stepsizes) {
+  const int K = 8;
+  Eigen::VectorXd scale = Eigen::VectorXd::LinSpaced(K, 0.5, 4);
+  std::vector<rng_t> rngs;
+  for (int k = 0; k < K; ++k)
+    rngs.emplace_back(98765 + k);
+  normal_batch_gradient gradient(scale);
+  sampler_t sampler(gradient, Eigen::MatrixXd::Zero(2, K), rngs);
+
+  sampler.engage_adaptation(0.8);
+  EXPECT_TRUE(sampler.adapting());
+  for (int n = 0; n < 500; ++n)
+    sampler.transition();
+  sampler.disengage_adaptation();
+  EXPECT_FALSE(sampler.adapting());
+  Eigen::ArrayXd epsilon = sampler.stepsize();
+
+  const int N = 4000;
+  Eigen::MatrixXd sum = Eigen::MatrixXd::Zero(2, K);
+  Eigen::MatrixXd sum_sq = Eigen::MatrixXd::Zero(2, K);
+  Eigen::ArrayXd accept = Eigen::ArrayXd::Zero(K);
+  for (int n = 0; n < N; ++n) {
+    sampler.transition();
+    sum += sampler.q();
+    sum_sq += sampler.q().cwiseAbs2();
+    accept += sampler.accept_stat();
+  }
+  for (int k = 0; k < K; ++k) {
+    double s = scale(k);
+    EXPECT_FLOAT_EQ(epsilon(k), sampler.stepsize()(k));
+    EXPECT_NEAR(0.8, accept(k) / N, 0.1);
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_NEAR(0, sum(i, k) / N, 0.1 * s);
+      EXPECT_NEAR(s * s, sum_sq(i, k) / N, 0.15 * s * s);
+    }
+  }
+}
+
+TEST(McmcLockstepNuts, checks_sizes) {
+  Eigen::VectorXd scale = Eigen::VectorXd::Ones(2);
+  std::vector<rng_t> rngs{rng_t(1)};
+  normal_batch_gradient gradient(scale);
+  EXPECT_THROW(sampler_t(gradient, Eigen::MatrixXd::Ones(2, 2), rngs),
+               std::invalid_argument);
+  rngs.emplace_back(2);
+  sampler_t sampler(gradient, Eigen::MatrixXd::Ones(2, 2), rngs);
+  EXPECT_THROW(sampler.set_stepsize(Eigen::ArrayXd::Ones(3)),
+               std::invalid_argument);
+  EXPECT_THROW(sampler.set_inv_metric(Eigen::MatrixXd::Ones(2, 3)),
+               std::invalid_argument);
+  EXPECT_THROW(sampler.set_dense_inv_metric(Eigen::MatrixXd::Identity(3, 3)),
+               std::invalid_argument);
+  EXPECT_THROW(sampler.set_dense_inv_metric(Eigen::MatrixXd::Ones(2, 2)),
+               std::invalid_argument);
+  EXPECT_FALSE(sampler.dense_metric());
+}
+
+TEST(McmcLockstepNuts, dense_diagonal_metric_matches_diagonal) {
+  Eigen::VectorXd scale = Eigen::VectorXd::Constant(3, 2);
+  Eigen::MatrixXd inv_metric(3, 3);
+  inv_metric << 0.5, 0, 0, 0, 2, 0, 0, 0, 4;
+  std::vector<rng_t> rngs_diag{rng_t(11), rng_t(12), rng_t(13)};
+  std::vector<rng_t> rngs_dense{rng_t(11), rng_t(12), rng_t(13)};
+  normal_batch_gradient gradient_diag(scale), gradient_dense(scale);
+  Eigen::MatrixXd q0 = Eigen::MatrixXd::Constant(3, 3, 0.5);
+  sampler_t diag(gradient_diag, q0, rngs_diag);
+  sampler_t dense(gradient_dense, q0, rngs_dense);
+  diag.set_stepsize(0.4);
+  dense.set_stepsize(0.4);
+  diag.set_inv_metric(inv_metric.diagonal().replicate(1, 3));
+  dense.set_dense_inv_metric(inv_metric);
+  EXPECT_TRUE(dense.dense_metric());
+
+  for (int n = 0; n < 20; ++n) {
+    diag.transition();
+    dense.transition();
+    for (int k = 0; k < 3; ++k) {
+      ASSERT_EQ(diag.treedepth()(k), dense.treedepth()(k));
+      ASSERT_NEAR(diag.lp()(k), dense.lp()(k), 1e-8);
+      ASSERT_NEAR(diag.energy()(k), dense.energy()(k), 1e-8);
+    }
+  }
+}
+
+TEST(McmcLockstepNuts, moments_with_shared_dense_metric) {
+  const int K = 4;
+  Eigen::MatrixXd covariance(2, 2);
+  covariance << 1, 0.95, 0.95, 1;
+  std::vector<rng_t> rngs;
+  for (int k = 0; k < K; ++k)
+    rngs.emplace_back(4321 + k);
+  correlated_batch_gradient gradient(covariance);
+  dense_sampler_t sampler(gradient, Eigen::MatrixXd::Zero(2, K), rngs);
+  sampler.set_dense_inv_metric(covariance);
+  sampler.set_stepsize(0.8);
+
+  const int N = 2000;
+  Eigen::MatrixXd sum = Eigen::MatrixXd::Zero(2, 2);
+  int n_leapfrog = 0;
+  for (int n = 0; n < N; ++n) {
+    sampler.transition();
+    sum += sampler.q() * sampler.q().transpose();
+    n_leapfrog += sampler.n_leapfrog().sum();
+  }
+  Eigen::MatrixXd estimate = sum / (N * K);
+  for (int i = 0; i < 2; ++i)
+    for (int j = 0; j < 2; ++j)
+      EXPECT_NEAR(covariance(i, j), estimate(i, j), 0.1);
+  // The metric whitens the target, so the trajectories stay short
+  EXPECT_LT(n_leapfrog, 8 * N * K);
+}
@@ -3,12 +3,67 @@
 #include <stan/mcmc/hmc/nuts/softabs_nuts.hpp>
 #include <boost/random/additive_combine.hpp>
 #include <stan/io/dump.hpp>
+#include <algorithm>
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 typedef boost::ecuyer1988 rng_t;
 
+namespace {
+// SoftAbs metric that counts its Hessians and gradients of traces with
+// the Hessian, each of which takes one pass per dimension
+template <class Model, class BaseRNG>
+class counting_softabs_metric
+    : public stan::mcmc::softabs_metric<Model, BaseRNG> {
+ public:
+  explicit counting_softabs_metric(const Model& model)
+      : stan::mcmc::softabs_metric<Model, BaseRNG>(model), num_passes(0) {}
+
+  void init(stan::mcmc::softabs_point& z,
+            stan::callbacks::logger& logger) {
+    num_passes += z.q.size();
+    stan::mcmc::softabs_metric<Model, BaseRNG>::init(z, logger);
+  }
+
+  void update_metric(stan::mcmc::softabs_point& z,
+                     stan::callbacks::logger& logger) {
+    num_passes += z.q.size();
+    stan::mcmc::softabs_metric<Model, BaseRNG>::update_metric(z, logger);
+  }
+
+  Eigen::VectorXd dtau_dq(stan::mcmc::softabs_point& z,
+                          stan::callbacks::logger& logger) {
+    num_passes += z.q.size();
+    return stan::mcmc::softabs_metric<Model, BaseRNG>::dtau_dq(z, logger);
+  }
+
+  Eigen::VectorXd dphi_dq(stan::mcmc::softabs_point& z,
+                          stan::callbacks::logger& logger) {
+    num_passes += z.q.size();
+    return stan::mcmc::softabs_metric<Model, BaseRNG>::dphi_dq(z, logger);
+  }
+
+  size_t num_passes;
+};
+
+class counting_softabs_nuts
+    : public stan::mcmc::base_nuts<gauss3D_model_namespace::gauss3D_model,
+                                   counting_softabs_metric,
+                                   stan::mcmc::impl_leapfrog, rng_t> {
+ public:
+  counting_softabs_nuts(const gauss3D_model_namespace::gauss3D_model& model,
+                        rng_t& rng)
+      : stan::mcmc::base_nuts<gauss3D_model_namespace::gauss3D_model,
+                              counting_softabs_metric,
+                              stan::mcmc::impl_leapfrog, rng_t>(model, rng) {}
+
+  size_t num_passes() const { return this->hamiltonian_.num_passes; }
+};
+}  // namespace
+
 TEST(McmcSoftAbsNuts, build_tree_test) {
   rng_t base_rng(4839294);
 
@@ -332,6 +387,8 @@ TEST(McmcSoftAbsNuts, transition_test) {
 
   stan::mcmc::softabs_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
       sampler(model, base_rng);
+  // The SoftAbs metric depends on the position, so nothing is reused
+  EXPECT_FALSE(sampler.get_reuse_gradient());
 
   sampler.z() = z_init;
   sampler.init_hamiltonian(logger);
@@ -352,9 +409,59 @@ TEST(McmcSoftAbsNuts, transition_test) {
   EXPECT_FLOAT_EQ(1.6008, s.cont_params()(2));
   EXPECT_FLOAT_EQ(-3.5239484, s.log_prob());
   EXPECT_FLOAT_EQ(0.99690288, s.accept_stat());
+
+  // Each leapfrog step runs at least one fixed point iteration for
+  // each half step of the momentum and for the position
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  std::vector<double> values;
+  sampler.get_sampler_params(values);
+  ASSERT_EQ(names.size(), values.size());
+  EXPECT_EQ("n_fixed_point__", names.back());
+  EXPECT_LE(3 * sampler.n_leapfrog_, values.back());
+  EXPECT_GE(21 * sampler.n_leapfrog_, values.back());
   EXPECT_EQ("", debug.str());
   EXPECT_EQ("", info.str());
   EXPECT_EQ("", warn.str());
   EXPECT_EQ("", error.str());
   EXPECT_EQ("", fatal.str());
 }
+
+TEST(McmcSoftAbsNuts, num_grad_evals) {
+  rng_t base_rng(4839294);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  counting_softabs_nuts sampler(model, base_rng);
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_stepsize_jitter(0);
+  sampler.sample_stepsize();
+  sampler.set_report_cost(true);
+
+  Eigen::VectorXd q(3);
+  q << 1, -1, 1;
+  stan::mcmc::sample init_sample(q, 0, 0);
+  sampler.transition(init_sample, logger);
+
+  // The count is that of the passes the metric took, not of the
+  // leapfrog steps
+  EXPECT_LT(0u, sampler.num_passes());
+  EXPECT_EQ(sampler.num_passes(), sampler.get_num_grad_evals());
+  EXPECT_LT(3u * sampler.n_leapfrog_, sampler.get_num_grad_evals());
+
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  std::vector<double> values;
+  sampler.get_sampler_params(values);
+  ASSERT_EQ(names.size(), values.size());
+  size_t n_grad = std::find(names.begin(), names.end(), "n_grad__")
+                  - names.begin();
+  ASSERT_LT(n_grad, names.size());
+  EXPECT_EQ(sampler.num_passes(), static_cast<size_t>(values[n_grad]));
+  EXPECT_EQ("", error.str());
+}
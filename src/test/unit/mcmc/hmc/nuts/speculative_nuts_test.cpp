@@ -0,0 +1,112 @@
+#include <test/test-models/good/mcmc/hmc/common/gauss3D.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <stan/mcmc/hmc/nuts/diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/dense_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/trajectory_speculator.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <stan/io/dump.hpp>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+typedef boost::ecuyer1988 rng_t;
+
+template <class Sampler, class Model>
+void expect_same_draws(const Model& model) {
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  rng_t serial_rng(4839294);
+  rng_t speculative_rng(4839294);
+  Sampler serial(model, serial_rng);
+  Sampler speculative(model, speculative_rng);
+  speculative.set_speculative(true);
+  EXPECT_TRUE(speculative.get_speculative());
+  EXPECT_FALSE(serial.get_speculative());
+
+  Eigen::VectorXd q(3);
+  q << 1, -1, 1;
+  stan::mcmc::sample serial_sample(q, 0, 0);
+  stan::mcmc::sample speculative_sample(q, 0, 0);
+  for (Sampler* sampler : {&serial, &speculative}) {
+    sampler->set_nominal_stepsize(0.1);
+    sampler->set_stepsize_jitter(0);
+    sampler->set_max_depth(8);
+  }
+
+  for (int n = 0; n < 100; ++n) {
+    serial_sample = serial.transition(serial_sample, logger);
+    speculative_sample = speculative.transition(speculative_sample, logger);
+    for (int i = 0; i < 3; ++i)
+      ASSERT_EQ(serial_sample.cont_params()(i),
+                speculative_sample.cont_params()(i));
+    ASSERT_EQ(serial_sample.log_prob(), speculative_sample.log_prob());
+    ASSERT_EQ(serial_sample.accept_stat(), speculative_sample.accept_stat());
+    ASSERT_EQ(serial.depth_, speculative.depth_);
+    ASSERT_EQ(serial.n_leapfrog_, speculative.n_leapfrog_);
+    ASSERT_EQ(serial.divergent_, speculative.divergent_);
+  }
+  EXPECT_EQ(serial_rng(), speculative_rng());
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcSpeculativeNuts, same_draws_as_serial) {
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  expect_same_draws<
+      stan::mcmc::diag_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>>(
+      model);
+  expect_same_draws<
+      stan::mcmc::dense_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>>(
+      model);
+}
+
+TEST(McmcSpeculativeNuts, speculator_matches_integrator) {
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  typedef stan::mcmc::diag_e_metric<gauss3D_model_namespace::gauss3D_model,
+                                    rng_t>
+      metric_t;
+  metric_t metric(model);
+  stan::mcmc::expl_leapfrog<metric_t> integrator;
+
+  stan::mcmc::diag_e_point z(3);
+  z.q << 1, -1, 1;
+  z.p << -1, 1, -1;
+  z.inv_e_metric_ << 1, 0.5, 2;
+  metric.init(z, logger);
+  double H0 = metric.H(z);
+
+  typedef stan::mcmc::trajectory_speculator<
+      metric_t, stan::mcmc::expl_leapfrog<metric_t>>
+      speculator_t;
+  speculator_t speculator;
+  speculator.reset(z);
+  speculator.run(metric, z, -1, 0.1, 3, H0, 1000);
+  speculator.wait();
+  // Continues from the last cached state
+  speculator.run(metric, z, -1, 0.1, 2, H0, 1000);
+  speculator.wait();
+
+  stan::mcmc::diag_e_point expected = z;
+  stan::mcmc::diag_e_point taken = z;
+  EXPECT_FALSE(speculator.take(1, taken, logger));
+  for (int n = 0; n < 5; ++n) {
+    integrator.evolve(expected, metric, -0.1, logger);
+    ASSERT_TRUE(speculator.take(-1, taken, logger));
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(expected.q(i), taken.q(i));
+      EXPECT_EQ(expected.p(i), taken.p(i));
+      EXPECT_EQ(expected.g(i), taken.g(i));
+    }
+    EXPECT_EQ(expected.V, taken.V);
+  }
+  EXPECT_FALSE(speculator.take(-1, taken, logger));
+}
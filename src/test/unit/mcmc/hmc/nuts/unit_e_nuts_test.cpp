@@ -4,6 +4,7 @@
 #include <boost/random/additive_combine.hpp>
 #include <stan/io/dump.hpp>
 #include <fstream>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -358,3 +359,165 @@ TEST(McmcUnitENuts, transition_test) {
   EXPECT_EQ("", error.str());
   EXPECT_EQ("", fatal.str());
 }
+
+TEST(McmcUnitENuts, init_stepsize_bisections) {
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+
+  // A step size far too large is halved until it is accepted
+  rng_t plain_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      plain(model, plain_rng);
+  plain.seed(q);
+  plain.set_nominal_stepsize(100);
+  plain.init_stepsize(logger);
+  double plain_stepsize = plain.get_nominal_stepsize();
+  EXPECT_GT(100, plain_stepsize);
+  EXPECT_LT(1, plain.get_init_stepsize_evals());
+
+  // The same trials bracket the step size, which bisection then narrows
+  rng_t bisect_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      bisect(model, bisect_rng);
+  bisect.seed(q);
+  bisect.set_nominal_stepsize(100);
+  bisect.set_init_stepsize_bisections(4);
+  bisect.init_stepsize(logger);
+  EXPECT_EQ(plain.get_init_stepsize_evals() + 4,
+            bisect.get_init_stepsize_evals());
+  EXPECT_LT(plain_stepsize, bisect.get_nominal_stepsize());
+  EXPECT_GT(2 * plain_stepsize, bisect.get_nominal_stepsize());
+
+  EXPECT_EQ(q, bisect.z().q);
+  EXPECT_NE(std::string::npos, debug.str().find("leapfrog steps"));
+  EXPECT_EQ("", warn.str());
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcUnitENuts, report_cost) {
+  rng_t base_rng(4839294);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      sampler(model, base_rng);
+  sampler.set_nominal_stepsize(0.1);
+
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  EXPECT_EQ(5u, names.size());
+
+  sampler.set_report_cost(true);
+  names.clear();
+  sampler.get_sampler_param_names(names);
+  ASSERT_EQ(8u, names.size());
+  EXPECT_EQ("n_grad__", names[5]);
+  EXPECT_EQ("n_log_prob__", names[6]);
+  EXPECT_EQ("transition_ns__", names[7]);
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+  stan::mcmc::sample s(q, 0, 0);
+  s = sampler.transition(s, logger);
+  s = sampler.transition(s, logger);
+
+  // One gradient at the initial point and one per leapfrog step
+  std::vector<double> values;
+  sampler.get_sampler_params(values);
+  ASSERT_EQ(8u, values.size());
+  EXPECT_EQ(sampler.n_leapfrog_ + 1, values[5]);
+  EXPECT_EQ(0, values[6]);
+  EXPECT_LT(0, values[7]);
+
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcUnitENuts, reuse_gradient) {
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+
+  rng_t base_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      sampler(model, base_rng);
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_reuse_gradient(false);
+  EXPECT_FALSE(sampler.get_reuse_gradient());
+  rng_t reuse_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      reuse_sampler(model, reuse_rng);
+  reuse_sampler.set_nominal_stepsize(0.1);
+  // Euclidean samplers reuse the gradient by default
+  EXPECT_TRUE(reuse_sampler.get_reuse_gradient());
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+  stan::mcmc::sample s(q, 0, 0);
+  stan::mcmc::sample reuse_s(q, 0, 0);
+  for (int n = 0; n < 5; ++n) {
+    s = sampler.transition(s, logger);
+    size_t grad_evals = reuse_sampler.get_num_grad_evals();
+    reuse_s = reuse_sampler.transition(reuse_s, logger);
+    // only the first transition evaluates the initial point
+    EXPECT_EQ(reuse_sampler.n_leapfrog_ + (n == 0),
+              reuse_sampler.get_num_grad_evals() - grad_evals);
+    EXPECT_EQ(s.cont_params(), reuse_s.cont_params());
+    EXPECT_EQ(s.log_prob(), reuse_s.log_prob());
+  }
+
+  // a different seed is evaluated again
+  reuse_s = stan::mcmc::sample(q, 0, 0);
+  size_t grad_evals = reuse_sampler.get_num_grad_evals();
+  reuse_sampler.transition(reuse_s, logger);
+  EXPECT_EQ(reuse_sampler.n_leapfrog_ + 1,
+            reuse_sampler.get_num_grad_evals() - grad_evals);
+  EXPECT_EQ("", error.str());
+}
+
+TEST(McmcUnitENuts, approximate_warmup) {
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss3D_model_namespace::gauss3D_model model(data_var_context);
+  gauss3D_model_namespace::gauss3D_model approximate_model(data_var_context);
+
+  rng_t base_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      sampler(model, base_rng);
+  sampler.set_nominal_stepsize(0.1);
+  rng_t approximate_rng(4839294);
+  stan::mcmc::unit_e_nuts<gauss3D_model_namespace::gauss3D_model, rng_t>
+      approximate_sampler(model, approximate_rng);
+  approximate_sampler.set_nominal_stepsize(0.1);
+  approximate_sampler.set_approximate_warmup(approximate_model, 2);
+  EXPECT_EQ(2u, approximate_sampler.get_approximate_transitions());
+
+  Eigen::VectorXd q = Eigen::VectorXd::Ones(3);
+  stan::mcmc::sample s(q, 0, 0);
+  stan::mcmc::sample approximate_s(q, 0, 0);
+  for (int n = 0; n < 4; ++n) {
+    s = sampler.transition(s, logger);
+    approximate_s = approximate_sampler.transition(approximate_s, logger);
+    // the approximate model here is exact, so the chains agree
+    EXPECT_EQ(s.cont_params(), approximate_s.cont_params());
+    EXPECT_EQ(s.log_prob(), approximate_s.log_prob());
+  }
+  EXPECT_EQ(0u, approximate_sampler.get_approximate_transitions());
+  EXPECT_EQ(sampler.get_num_grad_evals(),
+            approximate_sampler.get_num_grad_evals());
+  EXPECT_EQ("", error.str());
+}
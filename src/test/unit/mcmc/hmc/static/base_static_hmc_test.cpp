@@ -2,6 +2,7 @@
 #include <stan/mcmc/hmc/static/base_static_hmc.hpp>
 #include <stan/callbacks/writer.hpp>
 #include <stan/callbacks/stream_writer.hpp>
+#include <stan/callbacks/stream_logger.hpp>
 #include <boost/random/additive_combine.hpp>
 #include <gtest/gtest.h>
 
@@ -115,3 +116,32 @@ TEST(McmcStaticBaseStaticHMC, set_nominal_stepsize_and_L) {
   EXPECT_EQ(old_epsilon, sampler.get_nominal_stepsize());
   EXPECT_EQ(old_L, sampler.get_L());
 }
+
+TEST(McmcStaticBaseStaticHMC, store_trajectory) {
+  rng_t base_rng(0);
+
+  stan::mcmc::mock_model model(2);
+  stan::mcmc::mock_static_hmc sampler(model, base_rng);
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  sampler.set_nominal_stepsize_and_L(0.5, 4);
+  sampler.set_stepsize_jitter(0);
+  sampler.set_store_trajectory(true);
+  sampler.z().p.setOnes();
+
+  Eigen::VectorXd q0 = Eigen::VectorXd::Zero(2);
+  stan::mcmc::sample init_sample(q0, 0, 0);
+  sampler.transition(init_sample, logger);
+
+  // The mock integrator moves the position along the momentum
+  const stan::mcmc::trajectory_buffer& trajectory = sampler.get_trajectory();
+  ASSERT_EQ(5, trajectory.size());
+  for (int i = 0; i < trajectory.size(); ++i) {
+    EXPECT_FLOAT_EQ(0.5 * i, trajectory.q(i)(0));
+    EXPECT_FLOAT_EQ(0.5 * i, trajectory.q(i)(1));
+  }
+  EXPECT_FLOAT_EQ(0, trajectory.max_energy_error(trajectory.H(0)));
+  EXPECT_FLOAT_EQ(2, sampler.z().q(0));
+}
@@ -14,6 +14,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 typedef boost::ecuyer1988 rng_t;
 
 TEST(McmcStaticUniform, unit_e_transition) {
@@ -53,6 +55,61 @@ TEST(McmcStaticUniform, unit_e_transition) {
   EXPECT_EQ("", fatal.str());
 }
 
+TEST(McmcStaticUniform, unit_e_stored_trajectory) {
+  rng_t base_rng(4839294);
+
+  stan::mcmc::unit_e_point z_init(1);
+  z_init.q(0) = 1;
+  z_init.p(0) = -1;
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger(debug, info, warn, error, fatal);
+
+  std::fstream empty_stream("", std::fstream::in);
+  stan::io::dump data_var_context(empty_stream);
+  gauss_model_namespace::gauss_model model(data_var_context);
+
+  stan::mcmc::unit_e_static_uniform<gauss_model_namespace::gauss_model, rng_t>
+      sampler(model, base_rng);
+
+  sampler.z() = z_init;
+  sampler.init_hamiltonian(logger);
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_stepsize_jitter(0);
+  sampler.sample_stepsize();
+  sampler.set_store_trajectory(true);
+
+  stan::mcmc::sample init_sample(z_init.q, 0, 0);
+
+  stan::mcmc::sample s = sampler.transition(init_sample, logger);
+
+  // The trajectory is the same as without the buffer, only the draw
+  // from it differs
+  EXPECT_FLOAT_EQ(0.9998666, s.accept_stat());
+
+  const stan::mcmc::trajectory_buffer& trajectory = sampler.get_trajectory();
+  ASSERT_EQ(sampler.get_L(), trajectory.size());
+  std::vector<double> values;
+  sampler.get_sampler_params(values);
+  int n_found = 0;
+  for (int i = 0; i < trajectory.size(); ++i) {
+    if (trajectory.q(i)(0) == s.cont_params()(0)) {
+      ++n_found;
+      EXPECT_FLOAT_EQ(-trajectory.V(i), s.log_prob());
+      EXPECT_FLOAT_EQ(trajectory.H(i), values[2]);
+    }
+  }
+  EXPECT_EQ(1, n_found);
+  EXPECT_LT(0, trajectory.max_energy_error(trajectory.H(0)));
+  EXPECT_GT(0.01, trajectory.max_energy_error(trajectory.H(0)));
+
+  EXPECT_EQ("", debug.str());
+  EXPECT_EQ("", info.str());
+  EXPECT_EQ("", warn.str());
+  EXPECT_EQ("", error.str());
+  EXPECT_EQ("", fatal.str());
+}
+
 TEST(McmcStaticUniform, diag_e_transition) {
   rng_t base_rng(4839294);
 
@@ -0,0 +1,77 @@
+#define STAN_INSTRUMENTATION
+#include <stan/mcmc/instrumentation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+int fibonacci(int n) {
+  STAN_INSTRUMENT_REGION("instrumentation_test_fibonacci");
+  return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+void leaf() { STAN_INSTRUMENT_REGION("instrumentation_test_leaf"); }
+}  // namespace
+
+using stan::mcmc::instrumentation::registry;
+
+TEST(McmcInstrumentation, add) {
+  stan::mcmc::instrumentation::region& a
+      = registry::instance().add("instrumentation_test_add");
+  EXPECT_EQ(&a, &registry::instance().add("instrumentation_test_add"));
+  EXPECT_EQ("instrumentation_test_add", a.name);
+  EXPECT_NE(&a, &registry::instance().add("instrumentation_test_other"));
+}
+
+TEST(McmcInstrumentation, recursion_counted_once) {
+  stan::mcmc::instrumentation::region& r
+      = registry::instance().add("instrumentation_test_fibonacci");
+  r.reset();
+  EXPECT_EQ(55, fibonacci(10));
+  EXPECT_EQ(1U, r.calls);
+  EXPECT_EQ(8, fibonacci(6));
+  EXPECT_EQ(2U, r.calls);
+  r.reset();
+  EXPECT_EQ(0U, r.calls);
+  EXPECT_EQ(0U, r.ns);
+}
+
+TEST(McmcInstrumentation, threads) {
+  stan::mcmc::instrumentation::region& r
+      = registry::instance().add("instrumentation_test_leaf");
+  r.reset();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([] {
+      for (int n = 0; n < 100; ++n)
+        leaf();
+    });
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(400U, r.calls);
+}
+
+TEST(McmcInstrumentation, run_writes_totals) {
+  registry::instance().add("instrumentation_test_leaf").reset();
+  stan::test::unit::instrumented_logger logger;
+  {
+    STAN_INSTRUMENT_RUN(logger);
+    {
+      STAN_INSTRUMENT_RUN(logger);
+      leaf();
+    }
+    // Totals wait for the outer run
+    EXPECT_EQ(0, logger.call_count());
+    leaf();
+  }
+  EXPECT_EQ(1, logger.find_info("Instrumented regions"));
+  EXPECT_EQ(1, logger.find_info("instrumentation_test_leaf, 2, "));
+  EXPECT_EQ(0, logger.find_info("instrumentation_test_fibonacci"));
+  EXPECT_EQ(
+      0U, registry::instance().add("instrumentation_test_leaf").calls.load());
+
+  // Hardware counters are only written when compiled in
+#ifndef STAN_INSTRUMENTATION_PERF_EVENT
+  EXPECT_EQ(1, logger.find_info("NA, NA, NA"));
+#endif
+}
@@ -0,0 +1,86 @@
+#define STAN_INSTRUMENTATION_TRACE
+#include <stan/mcmc/instrumentation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+int depth(int n) {
+  STAN_INSTRUMENT_REGION("trace_test_depth");
+  return n == 0 ? 0 : 1 + depth(n - 1);
+}
+
+void leaf() { STAN_INSTRUMENT_REGION("trace_test_leaf"); }
+
+int count(const std::string& s, const std::string& pattern) {
+  int n = 0;
+  for (size_t pos = s.find(pattern); pos != std::string::npos;
+       pos = s.find(pattern, pos + 1))
+    ++n;
+  return n;
+}
+}  // namespace
+
+using stan::mcmc::instrumentation::registry;
+
+TEST(McmcInstrumentationTrace, events_per_thread) {
+  std::stringstream discard;
+  registry::instance().write_trace(discard);
+
+  EXPECT_EQ(5, depth(5));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 3; ++t)
+    threads.emplace_back([] {
+      for (int n = 0; n < 5000; ++n)
+        leaf();
+    });
+  for (auto& thread : threads)
+    thread.join();
+  auto start = std::chrono::steady_clock::now();
+  STAN_INSTRUMENT_SPAN("trace_test_span", start);
+
+  std::stringstream trace;
+  registry::instance().write_trace(trace);
+  std::string json = trace.str();
+  EXPECT_EQ(0U, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_EQ("]}\n", json.substr(json.size() - 3));
+
+  // Only the outermost activation of a recursive region is traced
+  EXPECT_EQ(1, count(json, "\"name\":\"trace_test_depth\""));
+  // More events than fit in a chunk of each thread
+  EXPECT_EQ(15000, count(json, "\"name\":\"trace_test_leaf\""));
+  EXPECT_EQ(1, count(json, "\"name\":\"trace_test_span\""));
+  EXPECT_LE(4, count(json, "\"ph\":\"M\""));
+  EXPECT_EQ(15002, count(json, "\"ph\":\"X\""));
+
+  // Writing starts a new trace
+  std::stringstream next;
+  registry::instance().write_trace(next);
+  EXPECT_EQ(0, count(next.str(), "\"ph\":\"X\""));
+  leaf();
+  std::stringstream last;
+  registry::instance().write_trace(last);
+  EXPECT_EQ(1, count(last.str(), "\"ph\":\"X\""));
+}
+
+TEST(McmcInstrumentationTrace, run_writes_trace_file) {
+  std::string path = "instrumentation_trace_test.json";
+  registry::instance().set_trace_file(path);
+  stan::test::unit::instrumented_logger logger;
+  {
+    STAN_INSTRUMENT_RUN(logger);
+    leaf();
+  }
+  EXPECT_EQ(1, logger.find_info("Trace written to " + path));
+  std::ifstream in(path);
+  std::stringstream json;
+  json << in.rdbuf();
+  EXPECT_EQ(1, count(json.str(), "\"name\":\"trace_test_leaf\""));
+  std::remove(path.c_str());
+}
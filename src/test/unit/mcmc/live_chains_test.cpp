@@ -0,0 +1,96 @@
+#include <stan/mcmc/live_chains.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(McmcLiveChains, errors) {
+  EXPECT_THROW(stan::mcmc::live_chains({"a"}, 0), std::invalid_argument);
+  EXPECT_THROW(stan::mcmc::live_chains({"a"}, 1, 0), std::invalid_argument);
+  stan::mcmc::live_chains chains({"a", "b"}, 1);
+  EXPECT_THROW(chains.add(0, {1.0}), std::invalid_argument);
+  EXPECT_THROW(chains.samples(0, 2), std::out_of_range);
+}
+
+TEST(McmcLiveChains, matches_chains) {
+  std::vector<std::string> names{"a", "b"};
+  stan::mcmc::live_chains live(names, 2, 7);
+  stan::mcmc::chains<> expected(names);
+  boost::ecuyer1988 rng(3);
+  boost::random::normal_distribution<> normal;
+  for (int chain = 0; chain < 2; ++chain) {
+    Eigen::MatrixXd draws(50 + chain, 2);
+    for (int i = 0; i < draws.rows(); ++i) {
+      draws(i, 0) = normal(rng);
+      draws(i, 1) = i + 0.1 * normal(rng);
+      live.add(chain, {draws(i, 0), draws(i, 1)});
+    }
+    expected.add(chain, draws);
+  }
+  live.set_warmup(0, 10);
+  expected.set_warmup(0, 10);
+
+  EXPECT_EQ(51, live.num_samples(1));
+  EXPECT_EQ(40, live.num_kept_samples(0));
+  for (int chain = 0; chain < 2; ++chain)
+    for (int j = 0; j < 2; ++j) {
+      Eigen::VectorXd x = live.samples(chain, j);
+      Eigen::VectorXd y = expected.samples(chain, j);
+      ASSERT_EQ(y.size(), x.size());
+      for (int i = 0; i < x.size(); ++i)
+        EXPECT_EQ(y(i), x(i));
+    }
+  for (int j = 0; j < 2; ++j) {
+    EXPECT_FLOAT_EQ(expected.split_potential_scale_reduction(j),
+                    live.split_potential_scale_reduction(j));
+    EXPECT_FLOAT_EQ(expected.split_effective_sample_size(j),
+                    live.split_effective_sample_size(j));
+  }
+
+  stan::mcmc::chains<> snapshot = live.snapshot();
+  EXPECT_EQ(2, snapshot.num_chains());
+  EXPECT_EQ(10, snapshot.warmup(0));
+  EXPECT_FLOAT_EQ(expected.mean(1), snapshot.mean(1));
+}
+
+TEST(McmcLiveChains, concurrent_producers_and_readers) {
+  const int num_chains = 4;
+  const int num_draws = 5000;
+  stan::mcmc::live_chains live({"i", "twice_i"}, num_chains, 64);
+  std::atomic<bool> done(false);
+
+  // Every published prefix of a chain is complete and in order
+  std::atomic<int> bad_prefixes(0);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      for (int chain = 0; chain < num_chains; ++chain) {
+        Eigen::VectorXd i = live.samples(chain, 0);
+        Eigen::VectorXd twice_i = live.samples(chain, 1);
+        int n = std::min(i.size(), twice_i.size());
+        for (int k = 0; k < n; ++k)
+          if (i(k) != k || twice_i(k) != 2 * k)
+            ++bad_prefixes;
+      }
+      live.split_potential_scale_reduction(0);
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (int chain = 0; chain < num_chains; ++chain)
+    producers.emplace_back([&live, chain]() {
+      for (int k = 0; k < num_draws; ++k)
+        live.add(chain, {static_cast<double>(k), 2.0 * k});
+    });
+  for (std::thread& producer : producers)
+    producer.join();
+  done.store(true);
+  reader.join();
+
+  EXPECT_EQ(0, bad_prefixes.load());
+  for (int chain = 0; chain < num_chains; ++chain)
+    EXPECT_EQ(num_draws, live.num_samples(chain));
+  EXPECT_FLOAT_EQ(live.snapshot().split_potential_scale_reduction(1),
+                  live.split_potential_scale_reduction(1));
+}
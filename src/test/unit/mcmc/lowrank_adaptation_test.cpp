@@ -0,0 +1,77 @@
+#include <stan/mcmc/lowrank_adaptation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <gtest/gtest.h>
+
+// Draws with independent unit scale noise plus a strong shared direction
+void learn_correlated(stan::mcmc::lowrank_adaptation& adapter, int n,
+                      int n_learn, Eigen::VectorXd& diag,
+                      Eigen::MatrixXd& factor, Eigen::VectorXd& direction) {
+  boost::ecuyer1988 rng(0);
+  boost::random::normal_distribution<double> normal;
+  direction = Eigen::VectorXd::Ones(n) / std::sqrt(n);
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd q(n);
+    for (int j = 0; j < n; ++j)
+      q(j) = normal(rng);
+    q += 10 * normal(rng) * direction;
+    adapter.learn_metric(diag, factor, q);
+  }
+}
+
+TEST(McmcLowrankAdaptation, learn_metric_zero) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 10;
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd diag(Eigen::VectorXd::Zero(n));
+  Eigen::MatrixXd factor(n, 0);
+
+  const int n_learn = 10;
+
+  Eigen::VectorXd target_var(Eigen::VectorXd::Ones(n));
+  target_var *= 1e-3 * 5.0 / (n_learn + 5.0);
+
+  stan::mcmc::lowrank_adaptation adapter(n, 3);
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+
+  for (int i = 0; i < n_learn - 1; ++i)
+    EXPECT_FALSE(adapter.learn_metric(diag, factor, q));
+  EXPECT_TRUE(adapter.learn_metric(diag, factor, q));
+
+  for (int i = 0; i < n; ++i)
+    EXPECT_EQ(target_var(i), diag(i));
+  EXPECT_EQ(n, factor.rows());
+  EXPECT_EQ(0, factor.cols());
+
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(McmcLowrankAdaptation, learn_correlated_direction) {
+  stan::test::unit::instrumented_logger logger;
+
+  // More draws than parameters, so the eigenvectors come from the
+  // covariance, and fewer, so they come from the Gram matrix
+  for (int n : {5, 200}) {
+    const int n_learn = 100;
+    stan::mcmc::lowrank_adaptation adapter(n, 2);
+    adapter.set_window_params(200, 0, 0, n_learn, logger);
+
+    Eigen::VectorXd diag;
+    Eigen::MatrixXd factor;
+    Eigen::VectorXd direction;
+    learn_correlated(adapter, n, n_learn, diag, factor, direction);
+
+    ASSERT_EQ(n, diag.size());
+    ASSERT_EQ(n, factor.rows());
+    ASSERT_GE(factor.cols(), 1);
+    EXPECT_LE(factor.cols(), 2);
+
+    // The leading column spans the shared direction
+    Eigen::VectorXd w = factor.col(0);
+    EXPECT_GT(std::fabs(w.normalized().dot(direction)), 0.9);
+    EXPECT_GT(w.norm(), 5);
+  }
+  EXPECT_EQ(0, logger.call_count());
+}
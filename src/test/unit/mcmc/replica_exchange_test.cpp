@@ -0,0 +1,82 @@
+#include <stan/mcmc/replica_exchange.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(McmcReplicaExchange, geometric_ladder) {
+  stan::mcmc::replica_exchange ladder(4, 0.125);
+
+  ASSERT_EQ(4U, ladder.num_temps());
+  EXPECT_FLOAT_EQ(1, ladder.betas()[0]);
+  EXPECT_FLOAT_EQ(0.5, ladder.betas()[1]);
+  EXPECT_FLOAT_EQ(0.25, ladder.betas()[2]);
+  EXPECT_FLOAT_EQ(0.125, ladder.betas()[3]);
+}
+
+TEST(McmcReplicaExchange, invalid_arguments) {
+  EXPECT_THROW(stan::mcmc::replica_exchange(0, 0.5), std::invalid_argument);
+  EXPECT_THROW(stan::mcmc::replica_exchange(3, 0), std::invalid_argument);
+  EXPECT_THROW(stan::mcmc::replica_exchange(3, 1.5), std::invalid_argument);
+}
+
+TEST(McmcReplicaExchange, alternating_pairs) {
+  boost::ecuyer1988 rng(7);
+  stan::mcmc::replica_exchange ladder(4, 0.125);
+  // Equal densities are always swapped
+  std::vector<double> log_probs(4, -1.0);
+
+  std::vector<bool> even = ladder.propose_swaps(log_probs, rng);
+  ASSERT_EQ(3U, even.size());
+  EXPECT_TRUE(even[0]);
+  EXPECT_FALSE(even[1]);
+  EXPECT_TRUE(even[2]);
+
+  std::vector<bool> odd = ladder.propose_swaps(log_probs, rng);
+  EXPECT_FALSE(odd[0]);
+  EXPECT_TRUE(odd[1]);
+  EXPECT_FALSE(odd[2]);
+
+  std::vector<double> rates = ladder.swap_rates();
+  EXPECT_FLOAT_EQ(1, rates[0]);
+  EXPECT_FLOAT_EQ(1, rates[1]);
+  EXPECT_FLOAT_EQ(1, rates[2]);
+
+  ladder.restart();
+  EXPECT_FLOAT_EQ(0, ladder.swap_rates()[0]);
+}
+
+TEST(McmcReplicaExchange, rejects_worse_state_at_target) {
+  boost::ecuyer1988 rng(7);
+  stan::mcmc::replica_exchange ladder(2, 0.5);
+  // The hot state is far less probable, so swapping it down is rejected
+  std::vector<double> log_probs = {0.0, -1000.0};
+
+  for (int n = 0; n < 10; ++n)
+    EXPECT_FALSE(ladder.propose_swaps(log_probs, rng)[0]);
+  EXPECT_FLOAT_EQ(0, ladder.swap_rates()[0]);
+}
+
+TEST(McmcReplicaExchange, adapts_gaps) {
+  boost::ecuyer1988 rng(7);
+  stan::mcmc::replica_exchange widening(3, 0.5);
+  widening.engage_adaptation();
+  std::vector<double> equal(3, -1.0);
+  for (int n = 0; n < 20; ++n)
+    widening.propose_swaps(equal, rng);
+  EXPECT_LT(widening.betas()[2], 0.5);
+  EXPECT_FLOAT_EQ(1, widening.betas()[0]);
+
+  stan::mcmc::replica_exchange narrowing(3, 0.5);
+  narrowing.engage_adaptation();
+  std::vector<double> apart = {0.0, -1000.0, -2000.0};
+  for (int n = 0; n < 20; ++n)
+    narrowing.propose_swaps(apart, rng);
+  EXPECT_GT(narrowing.betas()[2], 0.5);
+
+  // Without adaptation the ladder is fixed
+  stan::mcmc::replica_exchange fixed(3, 0.5);
+  for (int n = 0; n < 20; ++n)
+    fixed.propose_swaps(equal, rng);
+  EXPECT_FLOAT_EQ(0.5, fixed.betas()[2]);
+}
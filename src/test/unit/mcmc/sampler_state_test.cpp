@@ -0,0 +1,178 @@
+#include <stan/mcmc/sampler_state.hpp>
+#include <stan/mcmc/covar_adaptation.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_point.hpp>
+#include <stan/mcmc/stepsize_adaptation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+TEST(McmcSamplerState, round_trips_values) {
+  std::vector<double> values{0.1,
+                             -1.0 / 3,
+                             1e-310,
+                             std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity()};
+  Eigen::MatrixXd m(2, 3);
+  m << 1, 2, 3, 4, 5, 6.25;
+  boost::ecuyer1988 rng(7);
+  rng.discard(11);
+
+  std::stringstream stream;
+  stan::mcmc::state_writer writer(stream);
+  writer.tag("test");
+  for (double x : values)
+    writer.write(x);
+  writer.write(std::numeric_limits<double>::quiet_NaN());
+  writer.write(m);
+  writer.write(std::vector<int>{3, 1, 2});
+  writer.write(-4);
+  writer.write(true);
+  writer.write_rng(rng);
+
+  stan::mcmc::state_reader reader(stream);
+  reader.tag("test");
+  for (double x : values) {
+    double y;
+    reader.read(y);
+    EXPECT_EQ(x, y);
+  }
+  double nan;
+  reader.read(nan);
+  EXPECT_TRUE(std::isnan(nan));
+  Eigen::MatrixXd m_read;
+  reader.read(m_read);
+  EXPECT_EQ(m, m_read);
+  std::vector<int> sizes;
+  reader.read(sizes);
+  EXPECT_EQ((std::vector<int>{3, 1, 2}), sizes);
+  int k;
+  reader.read(k);
+  EXPECT_EQ(-4, k);
+  bool flag;
+  reader.read(flag);
+  EXPECT_TRUE(flag);
+  boost::ecuyer1988 rng_read(1);
+  reader.read_rng(rng_read);
+  EXPECT_EQ(rng(), rng_read());
+
+  EXPECT_THROW(reader.read(k), std::invalid_argument);
+}
+
+TEST(McmcSamplerState, counts_bytes) {
+  std::stringstream stream;
+  stan::mcmc::state_writer writer(stream);
+  writer.tag("test");
+  writer.write(1.5);
+  writer.write(Eigen::MatrixXd::Zero(2, 3));
+  writer.write(std::vector<int>{3, 1, 2});
+  writer.write(-4);
+  EXPECT_EQ(7 * sizeof(double) + 4 * sizeof(int), writer.bytes());
+  EXPECT_FALSE(stream.str().empty());
+
+  // Without a buffer the bytes are counted and nothing is formatted
+  std::ostream discard(nullptr);
+  stan::mcmc::state_writer counter(discard);
+  counter.write(1.5);
+  counter.write(Eigen::MatrixXd::Zero(2, 3));
+  counter.write(std::vector<int>{3, 1, 2});
+  counter.write(-4);
+  EXPECT_EQ(writer.bytes(), counter.bytes());
+}
+
+TEST(McmcSamplerState, rejects_mismatches) {
+  std::stringstream stream;
+  stan::mcmc::state_writer writer(stream);
+  writer.tag("one");
+  writer.write(Eigen::VectorXd::Ones(3));
+  writer.write(1.5);
+
+  stan::mcmc::state_reader reader(stream);
+  EXPECT_THROW(reader.tag("two"), std::invalid_argument);
+  Eigen::Vector2d fixed;
+  EXPECT_THROW(reader.read(fixed), std::invalid_argument);
+  std::stringstream real("1.5");
+  stan::mcmc::state_reader real_reader(real);
+  int k;
+  EXPECT_THROW(real_reader.read(k), std::invalid_argument);
+}
+
+TEST(McmcSamplerState, dense_e_point) {
+  stan::mcmc::dense_e_point z(2);
+  z.q << 1, 2;
+  z.p << -0.5, 0.25;
+  z.g << 3, 4;
+  z.V = 1.75;
+  z.inv_e_metric_ << 2, 0.5, 0.5, 1;
+
+  std::stringstream stream;
+  stan::mcmc::state_writer writer(stream);
+  z.write_state(writer);
+
+  stan::mcmc::dense_e_point restored(2);
+  stan::mcmc::state_reader reader(stream);
+  restored.read_state(reader);
+  EXPECT_EQ(z.q, restored.q);
+  EXPECT_EQ(z.p, restored.p);
+  EXPECT_EQ(z.g, restored.g);
+  EXPECT_EQ(z.V, restored.V);
+  EXPECT_EQ(z.inv_e_metric_, restored.inv_e_metric_);
+
+  std::stringstream again(stream.str());
+  stan::mcmc::state_reader other_reader(again);
+  stan::mcmc::dense_e_point other(3);
+  EXPECT_THROW(other.read_state(other_reader), std::invalid_argument);
+}
+
+TEST(McmcSamplerState, resumed_adaptation_matches) {
+  stan::test::unit::instrumented_logger logger;
+  const int n = 3;
+  stan::mcmc::covar_adaptation adaptation(n);
+  adaptation.set_window_params(60, 5, 5, 20, logger);
+  stan::mcmc::stepsize_adaptation stepsize;
+  stepsize.set_mu(0.5);
+  stepsize.restart();
+
+  auto step = [](stan::mcmc::covar_adaptation& a,
+                 stan::mcmc::stepsize_adaptation& s, Eigen::MatrixXd& covar,
+                 double& epsilon, int i) {
+    Eigen::VectorXd q(3);
+    q << std::sin(i), std::cos(3 * i), 0.1 * i;
+    s.learn_stepsize(epsilon, 0.5 + 0.4 * std::sin(i));
+    return a.learn_covariance(covar, q);
+  };
+  Eigen::MatrixXd covar(n, n);
+  double epsilon = 1;
+  for (int i = 0; i < 17; ++i)
+    step(adaptation, stepsize, covar, epsilon, i);
+
+  std::stringstream stream;
+  stan::mcmc::state_writer writer(stream);
+  adaptation.write_state(writer);
+  stepsize.write_state(writer);
+
+  stan::mcmc::covar_adaptation resumed(n);
+  stan::mcmc::stepsize_adaptation resumed_stepsize;
+  stan::mcmc::state_reader reader(stream);
+  resumed.read_state(reader);
+  resumed_stepsize.read_state(reader);
+
+  Eigen::MatrixXd resumed_covar(n, n);
+  double resumed_epsilon = epsilon;
+  for (int i = 17; i < 60; ++i) {
+    bool updated = step(adaptation, stepsize, covar, epsilon, i);
+    EXPECT_EQ(updated, step(resumed, resumed_stepsize, resumed_covar,
+                            resumed_epsilon, i));
+    EXPECT_EQ(epsilon, resumed_epsilon);
+    // The resumed estimator folds the pending draws in at another point
+    // of the batch, so the estimates only match up to rounding
+    if (updated)
+      for (int k = 0; k < covar.size(); ++k)
+        EXPECT_NEAR(covar(k), resumed_covar(k), 1e-12);
+  }
+}
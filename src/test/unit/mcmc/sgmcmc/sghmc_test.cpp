@@ -0,0 +1,133 @@
+#include <stan/mcmc/sgmcmc/sghmc.hpp>
+#include <stan/mcmc/sgmcmc/sgld.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+// Normal model for the mean of the rows of y, with a standard normal
+// prior, whose posterior is normal with precision num_rows + 1
+class rows_mock_model {
+ public:
+  explicit rows_mock_model(size_t num_rows) : y(num_rows) {
+    for (size_t i = 0; i < num_rows; ++i)
+      y(i) = 2 + 0.5 * std::sin(static_cast<double>(i));
+  }
+
+  size_t num_params_r() const { return 1; }
+
+  size_t num_rows() const { return y.size(); }
+
+  double posterior_mean() const { return y.sum() / (y.size() + 1); }
+
+  double posterior_variance() const { return 1.0 / (y.size() + 1); }
+
+  template <bool propto, bool jacobian_adjust_transforms, typename T>
+  T log_prob_rows(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* output_stream = 0) const {
+    T lp = -0.5 * params_r(0) * params_r(0);
+    T ll = 0;
+    for (size_t i : rows)
+      ll += -0.5 * (y(i) - params_r(0)) * (y(i) - params_r(0));
+    return lp + static_cast<double>(y.size()) / rows.size() * ll;
+  }
+
+  Eigen::VectorXd y;
+};
+}  // namespace
+
+class McmcSghmc : public testing::Test {
+ public:
+  McmcSghmc()
+      : logger(debug, info, warn, error, fatal), model(1000), rng(4839294) {}
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger;
+  rows_mock_model model;
+  rng_t rng;
+};
+
+TEST_F(McmcSghmc, targets_posterior) {
+  // The noise of the gradients of large batches is negligible against
+  // the injected noise even with a small friction
+  stan::mcmc::sghmc<rows_mock_model, rng_t> sampler(model, rng, 500);
+  sampler.set_stepsize_schedule(0.01, 1, 0);
+  sampler.set_friction(0.1);
+
+  Eigen::VectorXd q(1);
+  q(0) = 0;
+  stan::mcmc::sample s(q, 0, 0);
+  for (int n = 0; n < 500; ++n)
+    s = sampler.transition(s, logger);
+
+  const int num_draws = 20000;
+  double sum = 0;
+  double sum_sq = 0;
+  for (int n = 0; n < num_draws; ++n) {
+    s = sampler.transition(s, logger);
+    double mu = s.cont_params()(0);
+    sum += mu;
+    sum_sq += mu * mu;
+  }
+  double mean = sum / num_draws;
+  double sd = std::sqrt(model.posterior_variance());
+  EXPECT_NEAR(model.posterior_mean(), mean, 0.2 * sd);
+  EXPECT_NEAR(1, (sum_sq / num_draws - mean * mean) / (sd * sd), 0.2);
+  EXPECT_EQ("", error.str());
+}
+
+TEST_F(McmcSghmc, unit_friction_is_sgld) {
+  rng_t sghmc_rng(123);
+  rng_t sgld_rng(123);
+  stan::mcmc::sghmc<rows_mock_model, rng_t> sghmc(model, sghmc_rng, 20);
+  stan::mcmc::sgld<rows_mock_model, rng_t> sgld(model, sgld_rng, 20);
+  sghmc.set_friction(1);
+  sghmc.set_stepsize_schedule(0.01, 1, 0);
+  sgld.set_stepsize_schedule(0.01, 1, 0);
+
+  Eigen::VectorXd q(1);
+  q(0) = 1;
+  stan::mcmc::sample s1(q, 0, 0);
+  stan::mcmc::sample s2(q, 0, 0);
+  for (int n = 0; n < 100; ++n) {
+    s1 = sghmc.transition(s1, logger);
+    s2 = sgld.transition(s2, logger);
+    EXPECT_NEAR(s2.cont_params()(0), s1.cont_params()(0), 1e-12);
+    EXPECT_NEAR(s2.log_prob(), s1.log_prob(), 1e-8);
+  }
+}
+
+TEST_F(McmcSghmc, velocity_reset_when_moved) {
+  stan::mcmc::sghmc<rows_mock_model, rng_t> sampler(model, rng, 20);
+  sampler.set_stepsize_schedule(0.01, 1, 0);
+  Eigen::VectorXd q(1);
+  q(0) = 0;
+  stan::mcmc::sample s(q, 0, 0);
+  for (int n = 0; n < 10; ++n)
+    s = sampler.transition(s, logger);
+  EXPECT_NE(0, sampler.velocity()(0));
+
+  // Moved elsewhere, the chain continues as a fresh one from rest
+  rng_t fresh_rng(rng);
+  stan::mcmc::sghmc<rows_mock_model, rng_t> fresh(model, fresh_rng, 20);
+  fresh.set_stepsize_schedule(0.01, 1, 0);
+  stan::mcmc::sample moved(q, 0, 0);
+  s = sampler.transition(moved, logger);
+  stan::mcmc::sample fresh_s = fresh.transition(moved, logger);
+  EXPECT_FLOAT_EQ(fresh_s.cont_params()(0), s.cont_params()(0));
+  EXPECT_FLOAT_EQ(fresh.velocity()(0), sampler.velocity()(0));
+}
+
+TEST_F(McmcSghmc, invalid_friction) {
+  stan::mcmc::sghmc<rows_mock_model, rng_t> sampler(model, rng, 20);
+  EXPECT_THROW(sampler.set_friction(0), std::invalid_argument);
+  EXPECT_THROW(sampler.set_friction(1.5), std::invalid_argument);
+  sampler.set_friction(0.5);
+  EXPECT_FLOAT_EQ(0.5, sampler.get_friction());
+}
@@ -0,0 +1,155 @@
+#include <stan/mcmc/sgmcmc/sgld.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+namespace {
+// Normal model for the mean of the rows of y, with a standard normal
+// prior, whose posterior is normal with precision num_rows + 1
+class rows_mock_model {
+ public:
+  explicit rows_mock_model(size_t num_rows) : y(num_rows) {
+    for (size_t i = 0; i < num_rows; ++i)
+      y(i) = 2 + 0.5 * std::sin(static_cast<double>(i));
+  }
+
+  size_t num_params_r() const { return 1; }
+
+  size_t num_rows() const { return y.size(); }
+
+  double posterior_mean() const { return y.sum() / (y.size() + 1); }
+
+  double posterior_variance() const { return 1.0 / (y.size() + 1); }
+
+  template <bool propto, bool jacobian_adjust_transforms, typename T>
+  T log_prob_rows(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* output_stream = 0) const {
+    T lp = -0.5 * params_r(0) * params_r(0);
+    T ll = 0;
+    for (size_t i : rows)
+      ll += -0.5 * (y(i) - params_r(0)) * (y(i) - params_r(0));
+    return lp + static_cast<double>(y.size()) / rows.size() * ll;
+  }
+
+  Eigen::VectorXd y;
+};
+}  // namespace
+
+class McmcSgld : public testing::Test {
+ public:
+  McmcSgld()
+      : logger(debug, info, warn, error, fatal), model(1000), rng(4839294) {}
+
+  std::stringstream debug, info, warn, error, fatal;
+  stan::callbacks::stream_logger logger;
+  rows_mock_model model;
+  rng_t rng;
+};
+
+TEST_F(McmcSgld, targets_posterior) {
+  stan::mcmc::sgld<rows_mock_model, rng_t> sampler(model, rng, 50);
+  EXPECT_EQ(50, sampler.batch_size());
+  sampler.set_stepsize_schedule(0.01, 1, 0);
+
+  Eigen::VectorXd q(1);
+  q(0) = 0;
+  stan::mcmc::sample s(q, 0, 0);
+  for (int n = 0; n < 500; ++n)
+    s = sampler.transition(s, logger);
+
+  const int num_draws = 20000;
+  double sum = 0;
+  double sum_sq = 0;
+  for (int n = 0; n < num_draws; ++n) {
+    s = sampler.transition(s, logger);
+    double mu = s.cont_params()(0);
+    sum += mu;
+    sum_sq += mu * mu;
+  }
+  double mean = sum / num_draws;
+  double sd = std::sqrt(model.posterior_variance());
+  EXPECT_NEAR(model.posterior_mean(), mean, 0.2 * sd);
+  EXPECT_NEAR(1, (sum_sq / num_draws - mean * mean) / (sd * sd), 0.2);
+  EXPECT_EQ("", error.str());
+}
+
+TEST_F(McmcSgld, stepsize_schedule) {
+  stan::mcmc::sgld<rows_mock_model, rng_t> sampler(model, rng, 10);
+  sampler.set_stepsize_schedule(0.01, 10, 0.5);
+  std::vector<std::string> names;
+  sampler.get_sampler_param_names(names);
+  ASSERT_EQ(1, names.size());
+  EXPECT_EQ("stepsize__", names[0]);
+
+  Eigen::VectorXd q(1);
+  q(0) = 1.9;
+  stan::mcmc::sample s(q, 0, 0);
+  for (int n = 0; n < 30; ++n) {
+    s = sampler.transition(s, logger);
+    std::vector<double> values;
+    sampler.get_sampler_params(values);
+    ASSERT_EQ(1, values.size());
+    EXPECT_FLOAT_EQ(0.01 * std::pow(1 + n / 10.0, -0.5), values[0]);
+  }
+  EXPECT_FLOAT_EQ(0.01, sampler.get_nominal_stepsize());
+}
+
+TEST_F(McmcSgld, invalid_arguments) {
+  EXPECT_THROW((stan::mcmc::sgld<rows_mock_model, rng_t>(model, rng, 0)),
+               std::invalid_argument);
+  rows_mock_model empty(0);
+  EXPECT_THROW((stan::mcmc::sgld<rows_mock_model, rng_t>(empty, rng, 1)),
+               std::invalid_argument);
+
+  stan::mcmc::sgld<rows_mock_model, rng_t> sampler(model, rng, 2000);
+  EXPECT_EQ(1000, sampler.batch_size());
+  EXPECT_THROW(sampler.set_stepsize_schedule(0, 1, 0), std::invalid_argument);
+  EXPECT_THROW(sampler.set_stepsize_schedule(0.1, 0, 0),
+               std::invalid_argument);
+  EXPECT_THROW(sampler.set_stepsize_schedule(0.1, 1, 1.5),
+               std::invalid_argument);
+}
+
+TEST_F(McmcSgld, adapts_metric) {
+  stan::mcmc::sgld<rows_mock_model, rng_t> sampler(model, rng, 50);
+  sampler.set_stepsize_schedule(0.01, 1, 0);
+  const int num_warmup = 1000;
+  sampler.set_window_params(num_warmup, 75, 50, 25, logger);
+  sampler.engage_adaptation();
+
+  Eigen::VectorXd q(1);
+  q(0) = model.posterior_mean();
+  stan::mcmc::sample s(q, 0, 0);
+  for (int n = 0; n < num_warmup; ++n) {
+    EXPECT_TRUE(sampler.adapting());
+    s = sampler.transition(s, logger);
+  }
+  EXPECT_FALSE(sampler.adapting());
+  // The estimate is scaled to keep the step along the narrowest
+  // direction, the only one here
+  EXPECT_FLOAT_EQ(1, sampler.get_metric()(0));
+
+  const int num_draws = 20000;
+  double sum = 0;
+  for (int n = 0; n < num_draws; ++n) {
+    s = sampler.transition(s, logger);
+    sum += s.cont_params()(0);
+  }
+  EXPECT_NEAR(model.posterior_mean(), sum / num_draws,
+              0.2 * std::sqrt(model.posterior_variance()));
+
+  std::stringstream state;
+  stan::callbacks::stream_writer writer(state);
+  sampler.write_sampler_state(writer);
+  EXPECT_NE(std::string::npos, state.str().find("Step size = 0.01"));
+  EXPECT_NE(std::string::npos,
+            state.str().find("Diagonal elements of inverse mass matrix:"));
+}
@@ -0,0 +1,118 @@
+#include <stan/mcmc/sparse_precision_adaptation.hpp>
+#include <stan/mcmc/covar_adaptation.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+// Tridiagonal precision of a first order autoregressive chain with
+// unit innovations started from a standard normal
+Eigen::SparseMatrix<double> chain_precision(int n, double rho) {
+  std::vector<Eigen::Triplet<double>> triplets;
+  for (int i = 0; i < n; ++i) {
+    triplets.emplace_back(i, i, i == n - 1 ? 1 : 1 + rho * rho);
+    if (i > 0) {
+      triplets.emplace_back(i, i - 1, -rho);
+      triplets.emplace_back(i - 1, i, -rho);
+    }
+  }
+  Eigen::SparseMatrix<double> precision(n, n);
+  precision.setFromTriplets(triplets.begin(), triplets.end());
+  return precision;
+}
+}  // namespace
+
+TEST(McmcSparsePrecisionAdaptation, full_pattern_matches_dense) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 4;
+  const int n_learn = 10;
+
+  stan::mcmc::sparse_precision_adaptation adapter(n);
+  adapter.set_pattern(Eigen::MatrixXd::Ones(n, n).sparseView());
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+  stan::mcmc::covar_adaptation dense(n);
+  dense.set_window_params(50, 0, 0, n_learn, logger);
+
+  Eigen::SparseMatrix<double> precision;
+  Eigen::MatrixXd dense_covar(Eigen::MatrixXd::Zero(n, n));
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd q(n);
+    q << i, std::sin(i), std::cos(i), -0.5 * i + std::sin(2 * i);
+    EXPECT_EQ(i == n_learn - 1, adapter.learn_precision(precision, q));
+    dense.learn_covariance(dense_covar, q);
+  }
+
+  Eigen::MatrixXd expected = dense_covar.inverse();
+  ASSERT_EQ(n * n, precision.nonZeros());
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < n; ++j)
+      EXPECT_NEAR(expected(i, j), precision.coeff(i, j),
+                  1e-8 * std::fabs(expected(i, i)));
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(McmcSparsePrecisionAdaptation, recovers_chain_precision) {
+  stan::test::unit::instrumented_logger logger;
+  boost::ecuyer1988 rng(7);
+  boost::random::normal_distribution<> normal;
+
+  const int n = 6;
+  const int n_learn = 20000;
+  const double rho = 0.8;
+  Eigen::SparseMatrix<double> expected = chain_precision(n, rho);
+
+  stan::mcmc::sparse_precision_adaptation adapter(n);
+  adapter.set_pattern(expected);
+  adapter.set_window_params(2 * n_learn, 0, 0, n_learn, logger);
+
+  Eigen::SparseMatrix<double> precision;
+  bool updated = false;
+  for (int m = 0; m < n_learn; ++m) {
+    Eigen::VectorXd q(n);
+    q(0) = normal(rng);
+    for (int i = 1; i < n; ++i)
+      q(i) = rho * q(i - 1) + normal(rng);
+    updated = adapter.learn_precision(precision, q);
+  }
+  ASSERT_TRUE(updated);
+
+  // Only the pattern of the chain is estimated
+  EXPECT_EQ(3 * n - 2, precision.nonZeros());
+  for (int k = 0; k < n; ++k)
+    for (Eigen::SparseMatrix<double>::InnerIterator it(expected, k); it;
+         ++it)
+      EXPECT_NEAR(it.value(), precision.coeff(it.row(), it.col()), 0.05);
+}
+
+TEST(McmcSparsePrecisionAdaptation, diagonal_pattern) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 3;
+  const int n_learn = 10;
+  stan::mcmc::sparse_precision_adaptation adapter(n);
+  adapter.set_window_params(50, 0, 0, n_learn, logger);
+  stan::mcmc::covar_adaptation dense(n);
+  dense.set_window_params(50, 0, 0, n_learn, logger);
+
+  Eigen::SparseMatrix<double> precision;
+  Eigen::MatrixXd dense_covar(Eigen::MatrixXd::Zero(n, n));
+  for (int i = 0; i < n_learn; ++i) {
+    Eigen::VectorXd q(n);
+    q << i, std::sin(i), i * i;
+    adapter.learn_precision(precision, q);
+    dense.learn_covariance(dense_covar, q);
+  }
+  ASSERT_EQ(n, precision.nonZeros());
+  for (int i = 0; i < n; ++i)
+    EXPECT_FLOAT_EQ(1 / dense_covar(i, i), precision.coeff(i, i));
+}
+
+TEST(McmcSparsePrecisionAdaptation, bad_pattern) {
+  stan::mcmc::sparse_precision_adaptation adapter(3);
+  EXPECT_THROW(adapter.set_pattern(Eigen::SparseMatrix<double>(2, 3)),
+               std::invalid_argument);
+}
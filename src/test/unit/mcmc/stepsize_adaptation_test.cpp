@@ -1,5 +1,6 @@
 #include <stan/mcmc/stepsize_adaptation.hpp>
 #include <gtest/gtest.h>
+#include <limits>
 
 TEST(McmcStepsizeAdaptation, set_mu) {
   stan::mcmc::stepsize_adaptation adaptation;
@@ -141,3 +142,22 @@ TEST(McmcStepsizeAdaptation, learn_stepsize_3) {
   EXPECT_NEAR(0.75, adaptation.kappa(), 1e-14);
   EXPECT_NEAR(10, adaptation.t0(), 1e-14);
 }
+
+TEST(McmcStepsizeAdaptation, stepsize_change) {
+  stan::mcmc::stepsize_adaptation adapter;
+  adapter.set_mu(0.5);
+  adapter.restart();
+  EXPECT_EQ(std::numeric_limits<double>::infinity(),
+            adapter.stepsize_change());
+
+  // The first step moves the averaged log step size from 0 to mu
+  double epsilon = 1;
+  adapter.learn_stepsize(epsilon, 0.5);
+  EXPECT_FLOAT_EQ(0.5, adapter.stepsize_change());
+  adapter.learn_stepsize(epsilon, 0.5);
+  EXPECT_FLOAT_EQ(0, adapter.stepsize_change());
+
+  adapter.restart();
+  EXPECT_EQ(std::numeric_limits<double>::infinity(),
+            adapter.stepsize_change());
+}
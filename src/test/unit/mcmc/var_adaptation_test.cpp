@@ -1,6 +1,9 @@
 #include <stan/mcmc/var_adaptation.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
 #include <gtest/gtest.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 TEST(McmcVarAdaptation, learn_variance) {
   stan::test::unit::instrumented_logger logger;
@@ -25,3 +28,170 @@ TEST(McmcVarAdaptation, learn_variance) {
 
   EXPECT_EQ(0, logger.call_count());
 }
+
+TEST(McmcVarAdaptation, pool_variance) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 3;
+  const int n_learn = 10;
+  const int num_chains = 3;
+
+  std::vector<stan::mcmc::var_adaptation> chains(num_chains,
+                                                 stan::mcmc::var_adaptation(n));
+  std::vector<stan::mcmc::var_adaptation*> adaptations;
+  for (auto& chain : chains) {
+    chain.set_window_params(50, 0, 0, n_learn, logger);
+    chain.set_cross_chain(true);
+    adaptations.push_back(&chain);
+  }
+  stan::mcmc::var_adaptation pooled(n);
+  pooled.set_window_params(100, 0, 0, num_chains * n_learn, logger);
+
+  Eigen::VectorXd var(Eigen::VectorXd::Zero(n));
+  Eigen::VectorXd pooled_var(Eigen::VectorXd::Zero(n));
+  for (int c = 0; c < num_chains; ++c) {
+    for (int i = 0; i < n_learn; ++i) {
+      Eigen::VectorXd q(n);
+      q << c + 0.5 * i, std::sin(c * n_learn + i), -2.0 * c + i * i;
+      EXPECT_FALSE(chains[c].learn_variance(var, q));
+      pooled.learn_variance(pooled_var, q);
+    }
+    EXPECT_TRUE(chains[c].window_pending());
+  }
+
+  EXPECT_TRUE(stan::mcmc::var_adaptation::pool_variance(adaptations, var));
+  for (int i = 0; i < n; ++i)
+    EXPECT_FLOAT_EQ(pooled_var(i), var(i));
+  for (auto& chain : chains)
+    EXPECT_FALSE(chain.window_pending());
+
+  EXPECT_FALSE(stan::mcmc::var_adaptation::pool_variance(adaptations, var));
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(McmcVarAdaptation, pool_variance_across_processes) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 3;
+  const int n_learn = 10;
+  const int num_chains = 3;
+
+  std::vector<stan::mcmc::var_adaptation> chains(num_chains,
+                                                 stan::mcmc::var_adaptation(n));
+  for (auto& chain : chains) {
+    chain.set_window_params(50, 0, 0, n_learn, logger);
+    chain.set_cross_chain(true);
+  }
+  std::vector<stan::mcmc::var_adaptation> copies(chains);
+  Eigen::VectorXd var(Eigen::VectorXd::Zero(n));
+  for (int c = 0; c < num_chains; ++c) {
+    for (int i = 0; i < n_learn; ++i) {
+      Eigen::VectorXd q(n);
+      q << c + 0.5 * i, std::sin(c * n_learn + i), -2.0 * c + i * i;
+      chains[c].learn_variance(var, q);
+      copies[c].learn_variance(var, q);
+    }
+  }
+  Eigen::VectorXd expected(Eigen::VectorXd::Zero(n));
+  std::vector<stan::mcmc::var_adaptation*> all_chains
+      = {&copies[0], &copies[1], &copies[2]};
+  stan::mcmc::var_adaptation::pool_variance(all_chains, expected);
+
+  // Two processes holding two chains and one chain, whose sums are
+  // exchanged through a barrier
+  std::vector<std::vector<stan::mcmc::var_adaptation*>> local
+      = {{&chains[0], &chains[2]}, {&chains[1]}};
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Parts of each process in each of the two reductions
+  std::vector<std::vector<Eigen::VectorXd>> parts(
+      2, std::vector<Eigen::VectorXd>(2));
+  int round = 0;
+  std::vector<Eigen::VectorXd> pooled(2, Eigen::VectorXd::Zero(n));
+  std::vector<bool> updated(2);
+  auto process = [&](int p) {
+    int calls = 0;
+    auto all_reduce_sum = [&](Eigen::VectorXd& x) {
+      std::unique_lock<std::mutex> lock(mutex);
+      parts[calls][p] = x;
+      ++round;
+      cv.notify_all();
+      cv.wait(lock, [&] { return round >= 2 * (calls + 1); });
+      x = parts[calls][0] + parts[calls][1];
+      ++calls;
+    };
+    updated[p] = stan::mcmc::var_adaptation::pool_variance(
+        local[p], pooled[p], all_reduce_sum);
+  };
+  std::thread first(process, 0);
+  std::thread second(process, 1);
+  first.join();
+  second.join();
+
+  for (int p = 0; p < 2; ++p) {
+    EXPECT_TRUE(updated[p]);
+    for (int i = 0; i < n; ++i)
+      EXPECT_FLOAT_EQ(expected(i), pooled[p](i));
+  }
+  for (auto& chain : chains)
+    EXPECT_FALSE(chain.window_pending());
+
+  // Without pending windows nothing is pooled
+  auto identity = [](Eigen::VectorXd&) {};
+  EXPECT_FALSE(
+      stan::mcmc::var_adaptation::pool_variance(local[0], var, identity));
+}
+
+TEST(McmcVarAdaptation, adaptive_schedule) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 2;
+  Eigen::VectorXd var(Eigen::VectorXd::Ones(n));
+
+  stan::mcmc::var_adaptation adapter(n);
+  adapter.set_window_params(200, 10, 20, 10, logger);
+  adapter.set_convergence_tolerance(0.2);
+
+  // Alternating draws give window variances of 10 / 9 and 20 / 19,
+  // which differ by less than the tolerance after regularization
+  int num_updates = 0;
+  for (int i = 0; i < 200; ++i) {
+    Eigen::VectorXd q = Eigen::VectorXd::Constant(n, i % 2 == 0 ? 1 : -1);
+    if (adapter.learn_variance(var, q))
+      ++num_updates;
+    if (i == 38)
+      EXPECT_FALSE(adapter.converged());
+  }
+
+  EXPECT_EQ(2, num_updates);
+  EXPECT_TRUE(adapter.converged());
+  EXPECT_EQ(60u, adapter.num_warmup());
+  EXPECT_EQ((std::vector<int>{20, 40}), adapter.window_ends());
+
+  stan::test::unit::instrumented_writer writer;
+  adapter.write_schedule(writer);
+  std::vector<std::string> info = writer.string_values();
+  ASSERT_EQ(2u, info.size());
+  EXPECT_EQ("Adaptation windows closed after iterations: 20, 40", info[0]);
+  EXPECT_EQ("The variance estimate converged, warmup cut to 60 iterations",
+            info[1]);
+}
+
+TEST(McmcVarAdaptation, fixed_schedule) {
+  stan::test::unit::instrumented_logger logger;
+
+  const int n = 2;
+  Eigen::VectorXd var(Eigen::VectorXd::Ones(n));
+
+  stan::mcmc::var_adaptation adapter(n);
+  adapter.set_window_params(200, 10, 20, 10, logger);
+
+  for (int i = 0; i < 200; ++i) {
+    Eigen::VectorXd q = Eigen::VectorXd::Constant(n, i % 2 == 0 ? 1 : -1);
+    adapter.learn_variance(var, q);
+  }
+
+  EXPECT_FALSE(adapter.converged());
+  EXPECT_EQ(200u, adapter.num_warmup());
+  EXPECT_EQ((std::vector<int>{20, 40, 80, 180}), adapter.window_ends());
+}
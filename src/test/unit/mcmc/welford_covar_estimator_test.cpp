@@ -0,0 +1,54 @@
+#include <stan/mcmc/welford_covar_estimator.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+TEST(McmcWelfordCovarEstimator, state) {
+  const int n = 3;
+  stan::mcmc::welford_covar_estimator estimator(n);
+  Eigen::VectorXd q(n);
+  for (int j = 0; j < 7; ++j) {
+    q << std::sin(j), std::cos(2 * j), 0.5 * j;
+    estimator.add_sample(q);
+  }
+
+  double num_samples;
+  Eigen::VectorXd m;
+  Eigen::MatrixXd m2;
+  estimator.get_state(num_samples, m, m2);
+  EXPECT_EQ(7, num_samples);
+  Eigen::VectorXd mean;
+  estimator.sample_mean(mean);
+  EXPECT_EQ(mean, m);
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  estimator.write_state(writer);
+  stan::mcmc::welford_covar_estimator restored(n);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  double restored_num_samples;
+  Eigen::VectorXd restored_m;
+  Eigen::MatrixXd restored_m2;
+  restored.get_state(restored_num_samples, restored_m, restored_m2);
+  EXPECT_EQ(num_samples, restored_num_samples);
+  EXPECT_EQ(m, restored_m);
+  EXPECT_EQ(m2, restored_m2);
+
+  // Adding the same draws to both keeps them equal
+  q << 1, -1, 2;
+  estimator.add_sample(q);
+  restored.add_sample(q);
+  Eigen::MatrixXd estimate;
+  Eigen::MatrixXd restored_estimate;
+  estimator.sample_covariance(estimate);
+  restored.sample_covariance(restored_estimate);
+  EXPECT_EQ(estimate, restored_estimate);
+
+  EXPECT_THROW(restored.set_state(num_samples, Eigen::VectorXd::Zero(n + 1),
+                                  m2),
+               std::invalid_argument);
+  restored.get_state(restored_num_samples, restored_m, restored_m2);
+  EXPECT_EQ(num_samples + 1, restored_num_samples);
+}
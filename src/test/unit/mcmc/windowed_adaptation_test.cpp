@@ -1,4 +1,5 @@
 #include <stan/mcmc/windowed_adaptation.hpp>
+#include <stan/mcmc/var_adaptation.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
 #include <gtest/gtest.h>
 
@@ -46,3 +47,46 @@ TEST(McmcWindowedAdaptation, set_window_params3) {
   ASSERT_EQ(0, logger.call_count());
   ASSERT_EQ(0, logger.call_count_info());
 }
+
+TEST(McmcWindowedAdaptation, transitions_to_window_end) {
+  stan::test::unit::instrumented_logger logger;
+
+  stan::mcmc::windowed_adaptation adapter("test");
+  EXPECT_EQ(0U, adapter.transitions_to_window_end());
+
+  adapter.set_window_params(1000, 75, 50, 25, logger);
+  EXPECT_EQ(100U, adapter.transitions_to_window_end());
+
+  stan::mcmc::windowed_adaptation short_warmup("test");
+  short_warmup.set_window_params(10, 1, 1, 1, logger);
+  EXPECT_EQ(0U, short_warmup.transitions_to_window_end());
+}
+
+TEST(McmcWindowedAdaptation, phase) {
+  stan::test::unit::instrumented_logger logger;
+
+  stan::mcmc::var_adaptation adapter(2);
+  EXPECT_EQ("stepsize", adapter.phase());
+
+  adapter.set_window_params(100, 10, 10, 20, logger);
+
+  Eigen::VectorXd var = Eigen::VectorXd::Ones(2);
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(2);
+  std::vector<std::string> phases;
+  for (int n = 0; n < 100; ++n) {
+    phases.push_back(adapter.phase());
+    q(0) = n % 3;
+    q(1) = n % 5;
+    adapter.learn_variance(var, q);
+  }
+  EXPECT_EQ("init_buffer", phases[0]);
+  EXPECT_EQ("init_buffer", phases[9]);
+  EXPECT_EQ("window_1", phases[10]);
+  EXPECT_EQ("window_1", phases[29]);
+  // The second window is stretched to the terminal buffer
+  EXPECT_EQ("window_2", phases[30]);
+  EXPECT_EQ("window_2", phases[89]);
+  EXPECT_EQ("term_buffer", phases[90]);
+  EXPECT_EQ("term_buffer", phases[99]);
+  EXPECT_LE(0, adapter.estimate_seconds());
+}
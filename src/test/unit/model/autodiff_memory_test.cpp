@@ -0,0 +1,39 @@
+#include <stan/model/autodiff_memory.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(ModelAutodiffMemory, peak) {
+  using stan::model::autodiff_memory;
+  autodiff_memory::reset_peak();
+  EXPECT_EQ(0U, autodiff_memory::peak_bytes());
+  autodiff_memory::record(100);
+  autodiff_memory::record(300);
+  autodiff_memory::record(200);
+  EXPECT_EQ(300U, autodiff_memory::peak_bytes());
+
+  // Each thread has its own peak
+  std::thread other([] {
+    EXPECT_EQ(0U, autodiff_memory::peak_bytes());
+    autodiff_memory::record(1000);
+  });
+  other.join();
+  EXPECT_EQ(300U, autodiff_memory::peak_bytes());
+
+  autodiff_memory::reset_peak();
+  EXPECT_EQ(0U, autodiff_memory::peak_bytes());
+}
+
+TEST(ModelAutodiffMemory, tape) {
+  using stan::math::var;
+  using stan::model::autodiff_memory;
+  stan::math::recover_memory();
+  size_t start = autodiff_memory::tape_size();
+  var x = 2;
+  var y = x * x + stan::math::exp(x);
+  EXPECT_GT(y.val(), 0);
+  // One variable each for x, the product, the exponential and the sum
+  EXPECT_EQ(start + 4, autodiff_memory::tape_size());
+  EXPECT_GT(autodiff_memory::arena_bytes(), 0U);
+  stan::math::recover_memory();
+  EXPECT_EQ(0U, autodiff_memory::tape_size());
+}
@@ -0,0 +1,24 @@
+#include <stan/model/benchmark_gradients.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(ModelBenchmarkGradients, summarize_latencies) {
+  std::vector<double> seconds;
+  for (int n = 100; n >= 1; --n)
+    seconds.push_back(n);
+  stan::model::latency_summary summary
+      = stan::model::internal::summarize_latencies(seconds);
+  EXPECT_FLOAT_EQ(50.5, summary.mean);
+  EXPECT_FLOAT_EQ(50.5, summary.median);
+  EXPECT_FLOAT_EQ(99, summary.p99);
+
+  seconds = {3, 1, 2};
+  summary = stan::model::internal::summarize_latencies(seconds);
+  EXPECT_FLOAT_EQ(2, summary.mean);
+  EXPECT_FLOAT_EQ(2, summary.median);
+  EXPECT_FLOAT_EQ(3, summary.p99);
+
+  seconds.clear();
+  summary = stan::model::internal::summarize_latencies(seconds);
+  EXPECT_FLOAT_EQ(0, summary.mean);
+}
@@ -0,0 +1,69 @@
+#include <stan/model/evaluator_pool.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <test/test-models/good/model/valid.hpp>
+#include <gtest/gtest.h>
+#include <future>
+#include <vector>
+
+TEST(ModelUtil, evaluator_pool_async) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  stan::model::evaluator_pool<stan_model> pool(model, 3);
+
+  std::vector<std::future<stan::model::evaluator_pool<stan_model>::evaluation>>
+      results;
+  for (int i = 0; i < 20; ++i)
+    results.push_back(pool.log_prob_grad<true, true>(
+        Eigen::VectorXd::Constant(1, 0.25 * i - 2)));
+  for (int i = 0; i < 20; ++i) {
+    double x = 0.25 * i - 2;
+    auto result = results[i].get();
+    EXPECT_FLOAT_EQ(-0.5 * x * x, result.log_prob);
+    ASSERT_EQ(1, result.gradient.size());
+    EXPECT_NEAR(-x, result.gradient(0), 1e-6);
+    EXPECT_EQ("", result.messages);
+  }
+
+  Eigen::VectorXd x = Eigen::VectorXd::Constant(1, 1.5);
+  EXPECT_FLOAT_EQ(-1.125, (pool.log_prob<true, true>(x).get().log_prob));
+  EXPECT_FLOAT_EQ(-1.125, (pool.log_prob<false, true>(x).get().log_prob));
+  EXPECT_EQ(0, (pool.log_prob<false, true>(x).get().gradient.size()));
+
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  auto draw = pool.write_array(rng, x).get();
+  ASSERT_EQ(1, draw.values.size());
+  EXPECT_FLOAT_EQ(1.5, draw.values(0));
+  pool.wait();
+}
+
+TEST(ModelUtil, evaluator_pool_batch) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  stan::model::evaluator_pool<stan_model> pool(model, 2);
+  Eigen::MatrixXd params_r(1, 5);
+  params_r << -2, -0.5, 0, 1, 3;
+
+  // the pool matches the batched function
+  Eigen::VectorXd log_prob, expected_log_prob;
+  Eigen::MatrixXd gradients, expected_gradients;
+  std::stringstream out;
+  pool.log_prob_grad<true, true>(params_r, log_prob, gradients, &out);
+  stan::model::log_prob_grad<true, true>(model, params_r, expected_log_prob,
+                                         expected_gradients);
+  EXPECT_EQ("", out.str());
+  ASSERT_EQ(5, log_prob.size());
+  for (int j = 0; j < params_r.cols(); ++j) {
+    EXPECT_FLOAT_EQ(expected_log_prob(j), log_prob(j));
+    EXPECT_FLOAT_EQ(expected_gradients(0, j), gradients(0, j));
+  }
+
+  pool.log_prob_grad<true, true>(Eigen::MatrixXd(1, 0), log_prob, gradients);
+  EXPECT_EQ(0, log_prob.size());
+  EXPECT_EQ(0, gradients.cols());
+}
@@ -128,3 +128,33 @@ TEST(ModelUtil, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(ModelUtil, finite_diff_grad_coordinates_and_directions) {
+  TestModel_uniform_01 model;
+  std::vector<double> params_r(1, 1.5);
+  std::vector<int> params_i(0);
+  std::vector<double> gradient;
+  stan::callbacks::interrupt interrupt;
+  stan::model::finite_diff_grad<false, true>(model, interrupt, params_r,
+                                             params_i, gradient);
+
+  for (bool parallel : {false, true}) {
+    std::vector<double> partials;
+    stan::model::finite_diff_grad<false, true>(
+        model, interrupt, params_r, params_i, std::vector<size_t>{0, 0},
+        partials, 1e-6, parallel);
+    ASSERT_EQ(2U, partials.size());
+    EXPECT_FLOAT_EQ(gradient[0], partials[0]);
+    EXPECT_FLOAT_EQ(gradient[0], partials[1]);
+
+    Eigen::MatrixXd directions(1, 2);
+    directions << 1, -2;
+    std::vector<double> derivatives;
+    stan::model::finite_diff_grad<false, true>(
+        model, interrupt, params_r, params_i, directions, derivatives, 1e-6,
+        parallel);
+    ASSERT_EQ(2U, derivatives.size());
+    EXPECT_NEAR(gradient[0], derivatives[0], 1e-8);
+    EXPECT_NEAR(-2 * gradient[0], derivatives[1], 1e-8);
+  }
+}
@@ -46,3 +46,33 @@ TEST(ModelUtil, grad_hess_log_prob) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(ModelUtil, grad_hess_log_prob_eigen) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  std::vector<double> params_r(1, 1.5);
+  std::vector<int> params_i(0);
+  std::vector<double> gradient;
+  std::vector<double> hessian;
+  double lp = stan::model::grad_hess_log_prob<true, true>(
+      model, params_r, params_i, gradient, hessian);
+
+  for (bool parallel : {false, true}) {
+    Eigen::VectorXd eigen_gradient;
+    Eigen::MatrixXd eigen_hessian;
+    std::stringstream out;
+    double eigen_lp = stan::model::grad_hess_log_prob<true, true>(
+        model, Eigen::VectorXd::Constant(1, 1.5), eigen_gradient,
+        eigen_hessian, parallel, &out);
+    EXPECT_EQ("", out.str());
+    EXPECT_FLOAT_EQ(lp, eigen_lp);
+    ASSERT_EQ(1, eigen_gradient.size());
+    EXPECT_FLOAT_EQ(gradient[0], eigen_gradient(0));
+    ASSERT_EQ(1, eigen_hessian.rows());
+    ASSERT_EQ(1, eigen_hessian.cols());
+    EXPECT_FLOAT_EQ(hessian[0], eigen_hessian(0, 0));
+  }
+}
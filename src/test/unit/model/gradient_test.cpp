@@ -57,3 +57,72 @@ TEST(ModelUtil, gradient_writer) {
   // &output); EXPECT_THROW(stan::model::gradient(domain_fail_model, x, f, g),
   // std::domain_error); EXPECT_EQ("", output.str());
 }
+
+TEST(ModelUtil, negative_gradient) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  std::stringstream output;
+  stan::test::unit::instrumented_logger logger;
+  valid_model_namespace::valid_model valid_model(data_var_context, 0, &output);
+
+  Eigen::VectorXd x(1);
+  Eigen::Matrix<stan::math::var, Eigen::Dynamic, 1> x_var;
+  double f;
+  Eigen::VectorXd g(1);
+  for (double x0 : {1.5, -0.25}) {
+    x(0) = x0;
+    EXPECT_NO_THROW(
+        stan::model::negative_gradient(valid_model, x, x_var, f, g, logger));
+    EXPECT_FLOAT_EQ(0.5 * x0 * x0, f);
+    ASSERT_EQ(1, g.size());
+    EXPECT_FLOAT_EQ(x0, g(0));
+  }
+
+  double f_expected;
+  Eigen::VectorXd g_expected;
+  stan::model::gradient(valid_model, x, f_expected, g_expected, logger);
+  EXPECT_FLOAT_EQ(-f_expected, f);
+  EXPECT_FLOAT_EQ(-g_expected(0), g(0));
+
+  EXPECT_EQ(1, x_var.size());
+  EXPECT_EQ(0, logger.call_count());
+  EXPECT_EQ("", output.str());
+}
+
+namespace {
+// Rejects every point outside the positive half line
+struct positive_model {
+  template <bool propto, bool jacobian, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& x, std::ostream* msgs) const {
+    if (!(x(0) > 0))
+      throw std::domain_error("x is not positive");
+    return -x(0);
+  }
+};
+}  // namespace
+
+TEST(ModelUtil, try_negative_gradient) {
+  positive_model model;
+  stan::test::unit::instrumented_logger logger;
+  Eigen::VectorXd x(1);
+  Eigen::Matrix<stan::math::var, Eigen::Dynamic, 1> x_var;
+  double f = 0;
+  Eigen::VectorXd g(1);
+  std::string error_message;
+
+  x(0) = 2;
+  EXPECT_TRUE(stan::model::try_negative_gradient(model, x, x_var, f, g,
+                                                 logger, error_message));
+  EXPECT_FLOAT_EQ(2, f);
+  EXPECT_FLOAT_EQ(1, g(0));
+  EXPECT_EQ("", error_message);
+
+  x(0) = -1;
+  EXPECT_FALSE(stan::model::try_negative_gradient(model, x, x_var, f, g,
+                                                  logger, error_message));
+  EXPECT_EQ("x is not positive", error_message);
+  EXPECT_FLOAT_EQ(2, f);
+  EXPECT_EQ(0, logger.call_count());
+}
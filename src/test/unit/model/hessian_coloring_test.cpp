@@ -0,0 +1,52 @@
+#include <stan/model/hessian_coloring.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+Eigen::SparseMatrix<double> tridiagonal_pattern(int n) {
+  std::vector<Eigen::Triplet<double>> entries;
+  for (int i = 1; i < n; ++i)
+    entries.emplace_back(i, i - 1, 1);
+  Eigen::SparseMatrix<double> pattern(n, n);
+  pattern.setFromTriplets(entries.begin(), entries.end());
+  return pattern;
+}
+}  // namespace
+
+TEST(ModelUtil, symmetric_hessian_pattern) {
+  Eigen::SparseMatrix<double> pattern
+      = stan::model::symmetric_hessian_pattern(tridiagonal_pattern(4));
+  Eigen::MatrixXd expected(4, 4);
+  expected << 1, 1, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1, 1;
+  EXPECT_EQ(10, pattern.nonZeros());
+  EXPECT_TRUE(expected.isApprox(Eigen::MatrixXd(pattern)));
+
+  EXPECT_THROW(stan::model::symmetric_hessian_pattern(
+                   Eigen::SparseMatrix<double>(2, 3)),
+               std::invalid_argument);
+}
+
+TEST(ModelUtil, color_hessian_columns) {
+  const int n = 100;
+  Eigen::SparseMatrix<double> pattern
+      = stan::model::symmetric_hessian_pattern(tridiagonal_pattern(n));
+  std::vector<int> colors;
+  EXPECT_EQ(3, stan::model::color_hessian_columns(pattern, colors));
+  ASSERT_EQ(n, colors.size());
+
+  // columns of the same color have no row in common
+  Eigen::MatrixXd dense(pattern);
+  for (int j = 0; j < n; ++j)
+    for (int k = j + 1; k < n; ++k)
+      if (colors[j] == colors[k])
+        EXPECT_EQ(0, dense.col(j).dot(dense.col(k)));
+
+  Eigen::SparseMatrix<double> diagonal
+      = stan::model::symmetric_hessian_pattern(
+          Eigen::SparseMatrix<double>(n, n));
+  EXPECT_EQ(1, stan::model::color_hessian_columns(diagonal, colors));
+
+  Eigen::SparseMatrix<double> dense_pattern
+      = Eigen::MatrixXd::Ones(5, 5).sparseView();
+  EXPECT_EQ(5, stan::model::color_hessian_columns(dense_pattern, colors));
+}
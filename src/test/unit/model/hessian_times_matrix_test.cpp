@@ -0,0 +1,47 @@
+#include <stan/model/hessian_times_matrix.hpp>
+#include <stan/model/hessian_times_vector.hpp>
+#include <test/test-models/good/model/valid.hpp>
+#include <gtest/gtest.h>
+
+TEST(ModelUtil, hessian_times_matrix) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  std::stringstream output;
+  valid_model_namespace::valid_model valid_model(data_var_context, 0, &output);
+  Eigen::VectorXd x(1);
+  x << 0.3;
+  Eigen::MatrixXd v(1, 3);
+  v << 1, -2, 0.5;
+
+  for (bool parallel : {false, true}) {
+    double f;
+    Eigen::MatrixXd hess_f_times_v;
+    stan::model::hessian_times_matrix(valid_model, x, v, f, hess_f_times_v,
+                                      parallel, &output);
+    ASSERT_EQ(1, hess_f_times_v.rows());
+    ASSERT_EQ(3, hess_f_times_v.cols());
+    for (int j = 0; j < v.cols(); ++j) {
+      double f_j;
+      Eigen::VectorXd hess_f_dot_v;
+      stan::model::hessian_times_vector(valid_model, x,
+                                        Eigen::VectorXd(v.col(j)), f_j,
+                                        hess_f_dot_v);
+      EXPECT_FLOAT_EQ(f_j, f);
+      EXPECT_FLOAT_EQ(hess_f_dot_v(0), hess_f_times_v(0, j));
+    }
+  }
+  EXPECT_EQ("", output.str());
+
+  double f;
+  Eigen::MatrixXd hess_f_times_v;
+  stan::model::hessian_times_matrix(valid_model, x, Eigen::MatrixXd(1, 0), f,
+                                    hess_f_times_v);
+  EXPECT_FLOAT_EQ(-0.045, f);
+  EXPECT_EQ(0, hess_f_times_v.cols());
+  EXPECT_THROW(stan::model::hessian_times_matrix(valid_model, x,
+                                                 Eigen::MatrixXd(2, 1), f,
+                                                 hess_f_times_v),
+               std::invalid_argument);
+}
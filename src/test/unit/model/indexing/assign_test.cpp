@@ -5,6 +5,7 @@
 #include <stan/model/indexing/rvalue.hpp>
 #include <stan/math/rev.hpp>
 #include <gtest/gtest.h>
+#include <test/unit/util.hpp>
 
 using Eigen::Dynamic;
 using Eigen::Matrix;
@@ -1154,3 +1155,98 @@ TEST(model_indexing, assign_densemat_densemat_multi_index_multi_index) {
   ns[ns.size() - 1] = 10;
   test_throw(x, y, index_multi(ms), index_multi(ns));
 }
+
+TEST(model_indexing, assign_densemat_multi_index_multi_index_out_of_range) {
+  MatrixXd x(3, 4);
+  x << 0.0, 0.1, 0.2, 0.3, 1.0, 1.1, 1.2, 1.3, 2.0, 2.1, 2.2, 2.3;
+  MatrixXd x_copy = x;
+  MatrixXd y(2, 3);
+  y << 10, 11, 12, 20, 21, 22;
+  vector<int> ms{3, 1};
+  vector<int> ns{2, 4, 1};
+  vector<int> bad_ms{3, 4};
+  vector<int> bad_ns{2, 0, 1};
+  vector<int> empty;
+
+  test_throw(x, y, index_multi(bad_ms), index_multi(ns));
+  test_throw(x, y, index_multi(ms), index_multi(bad_ns));
+  EXPECT_THROW_MSG(
+      assign(x, y, "x", index_multi(bad_ms), index_multi(bad_ns)),
+      std::out_of_range, "matrix[multi,multi] assign row");
+  EXPECT_THROW_MSG(assign(x, y, "x", index_multi(ms), index_multi(bad_ns)),
+                   std::out_of_range, "matrix[multi,multi] assign column");
+  // nothing is written before the indexes are checked
+  EXPECT_EQ(x_copy, x);
+
+  // no element is written, so no index is checked
+  MatrixXd y_no_rows(0, 3);
+  assign(x, y_no_rows, "x", index_multi(empty), index_multi(bad_ns));
+  MatrixXd y_no_cols(2, 0);
+  assign(x, y_no_cols, "x", index_multi(bad_ms), index_multi(empty));
+  EXPECT_EQ(x_copy, x);
+}
+
+TEST(model_indexing, assign_eigvec_overlapping_slice) {
+  using stan::model::deep_copy;
+  VectorXd x(5);
+  x << 0, 1, 2, 3, 4;
+  // x[2:5] = x[1:4]
+  assign(x, deep_copy(x.head(4)), "", index_min_max(2, 5));
+  VectorXd expected(5);
+  expected << 0, 0, 1, 2, 3;
+  for (int i = 0; i < 5; ++i)
+    EXPECT_FLOAT_EQ(expected(i), x(i));
+
+  // x[5:1] = x
+  assign(x, deep_copy(x), "", index_min_max(5, 1));
+  expected << 3, 2, 1, 0, 0;
+  for (int i = 0; i < 5; ++i)
+    EXPECT_FLOAT_EQ(expected(i), x(i));
+
+  // x[{2, 3, 1}] = x[1:3]
+  vector<int> ns{2, 3, 1};
+  assign(x, deep_copy(x.head(3)), "", index_multi(ns));
+  expected << 1, 3, 2, 0, 0;
+  for (int i = 0; i < 5; ++i)
+    EXPECT_FLOAT_EQ(expected(i), x(i));
+
+  // x = x[2:3] resizes the storage it reads from
+  assign(x, deep_copy(x.segment(1, 2)), "");
+  ASSERT_EQ(2, x.size());
+  EXPECT_FLOAT_EQ(3, x(0));
+  EXPECT_FLOAT_EQ(2, x(1));
+}
+
+TEST(model_indexing, assign_densemat_overlapping_slice) {
+  using stan::model::deep_copy;
+  MatrixXd x(3, 3);
+  x << 1, 2, 3, 4, 5, 6, 7, 8, 9;
+  MatrixXd y = x;
+  // x[2:3, ] = x[1:2, ]
+  assign(x, deep_copy(x.topRows(2)), "", index_min(2));
+  EXPECT_TRUE(y.row(0) == x.row(0));
+  EXPECT_TRUE(y.topRows(2) == x.bottomRows(2));
+
+  // x[, {3, 1}] = x[, 1:2]
+  x = y;
+  vector<int> ns{3, 1};
+  assign(x, deep_copy(x.leftCols(2)), "", index_omni(), index_multi(ns));
+  EXPECT_TRUE(y.col(0) == x.col(2));
+  EXPECT_TRUE(y.col(1) == x.col(0));
+  EXPECT_TRUE(y.col(1) == x.col(1));
+}
+
+TEST(model_indexing, overlaps) {
+  using stan::model::internal::overlaps;
+  MatrixXd x(4, 4);
+  VectorXd y(4);
+  EXPECT_TRUE(overlaps(x, x));
+  EXPECT_TRUE(overlaps(x, x.col(1)));
+  EXPECT_TRUE(overlaps(x.row(1), x.col(1)));
+  EXPECT_FALSE(overlaps(x.col(0), x.col(1)));
+  EXPECT_FALSE(overlaps(x.topRows(2).leftCols(2), x.rightCols(2)));
+  EXPECT_FALSE(overlaps(x, y));
+  EXPECT_FALSE(overlaps(x, x.col(1).reverse()));
+  EXPECT_FALSE(overlaps(y, y.head(0)));
+  EXPECT_FALSE(overlaps(y, 1.0));
+}
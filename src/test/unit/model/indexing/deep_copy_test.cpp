@@ -99,3 +99,17 @@ TEST(modelIndexingDeepCopy, stdVectorStdVectorDouble) {
   EXPECT_FLOAT_EQ(20, ac[1][1]);
   EXPECT_FLOAT_EQ(11, a[1][1]);
 }
+
+TEST(modelIndexingDeepCopy, eigenDirectAccessNotCopied) {
+  using Eigen::MatrixXd;
+  using stan::model::deep_copy;
+
+  MatrixXd b(2, 3);
+  b << 1, 2, 3, 4, 5, 6;
+  EXPECT_EQ(b.data(), deep_copy(b).data());
+  EXPECT_EQ(b.data() + 2, deep_copy(b.col(1)).data());
+
+  // expressions without storage are evaluated
+  MatrixXd bc = deep_copy(b.transpose() * 2);
+  EXPECT_FLOAT_EQ(4, bc(1, 0));
+}
@@ -4,6 +4,7 @@
 #include <stan/model/indexing/rvalue.hpp>
 #include <stan/math.hpp>
 #include <gtest/gtest.h>
+#include <test/unit/util.hpp>
 
 using stan::model::rvalue;
 
@@ -561,6 +562,27 @@ TEST(ModelIndexing, rvalue_doubless_multi_multi_eigen) {
   test_out_of_range(x, index_max(2), index_min(0));
 }
 
+TEST(ModelIndexing, rvalue_eigen_multi_multi_out_of_range) {
+  Eigen::MatrixXd x(3, 4);
+  x << 0.0, 0.1, 0.2, 0.3, 1.0, 1.1, 1.2, 1.3, 2.0, 2.1, 2.2, 2.3;
+  std::vector<int> ms{3, 1};
+  std::vector<int> ns{2, 4, 1};
+  std::vector<int> bad_ms{3, 4};
+  std::vector<int> bad_ns{2, 0, 1};
+  std::vector<int> empty;
+
+  test_out_of_range(x, index_multi(bad_ms), index_multi(ns));
+  test_out_of_range(x, index_multi(ms), index_multi(bad_ns));
+  EXPECT_THROW_MSG(rvalue(x, "x", index_multi(bad_ms), index_multi(bad_ns)),
+                   std::out_of_range, "matrix[multi,multi] row indexing");
+  EXPECT_THROW_MSG(rvalue(x, "x", index_multi(ms), index_multi(bad_ns)),
+                   std::out_of_range, "matrix[multi,multi] column indexing");
+
+  // no element is read, so no index is checked
+  EXPECT_EQ(0, rvalue(x, "", index_multi(empty), index_multi(bad_ns)).size());
+  EXPECT_EQ(0, rvalue(x, "", index_multi(bad_ms), index_multi(empty)).size());
+}
+
 template <typename T>
 void vector_uni_test() {
   T v(3);
@@ -679,6 +679,48 @@ TEST_F(RvalueRev, multi_multi_mat) {
   test_throw_out_of_range(rx, index_multi(row_idx), index_multi(col_idx));
 }
 
+TEST_F(RvalueRev, contiguous_multi_vec) {
+  Eigen::VectorXd v(5);
+  v << 0, 1, 2, 3, 4;
+  stan::math::var_value<Eigen::VectorXd> rv(v);
+  std::vector<int> ns{2, 3, 4};
+  stan::math::var_value<Eigen::VectorXd> vi = rvalue(rv, "", index_multi(ns));
+  EXPECT_MATRIX_EQ(vi.val(), v.segment(1, 3));
+  stan::math::sum(vi).grad();
+  Eigen::VectorXd expected_adj(5);
+  expected_adj << 0, 1, 1, 1, 0;
+  EXPECT_MATRIX_EQ(rv.adj(), expected_adj);
+
+  ns = {4, 5, 6};
+  test_throw_out_of_range(rv, index_multi(ns));
+  ns = {0, 1};
+  test_throw_out_of_range(rv, index_multi(ns));
+}
+
+TEST_F(RvalueRev, contiguous_multi_multi_mat) {
+  using stan::model::test::generate_linear_var_matrix;
+  auto x = generate_linear_var_matrix(4, 5);
+  std::vector<int> row_idx{2, 3};
+  std::vector<int> col_idx{3, 4, 5};
+  stan::math::var_value<Eigen::MatrixXd> y
+      = rvalue(x, "", index_multi(row_idx), index_multi(col_idx));
+  EXPECT_MATRIX_EQ(y.val(), x.val().block(1, 2, 2, 3));
+  stan::math::var_value<Eigen::MatrixXd> z
+      = rvalue(x, "", index_multi(row_idx));
+  EXPECT_MATRIX_EQ(z.val(), x.val().middleRows(1, 2));
+
+  (stan::math::sum(y) + stan::math::sum(z)).grad();
+  Eigen::MatrixXd expected_adj = Eigen::MatrixXd::Zero(4, 5);
+  expected_adj.middleRows(1, 2).array() += 1;
+  expected_adj.block(1, 2, 2, 3).array() += 1;
+  EXPECT_MATRIX_EQ(x.adj(), expected_adj);
+
+  col_idx = {4, 5, 6};
+  test_throw_out_of_range(x, index_multi(row_idx), index_multi(col_idx));
+  row_idx = {4, 5};
+  test_throw_out_of_range(x, index_multi(row_idx));
+}
+
 TEST_F(RvalueRev, minmax_multi_matrix) {
   using stan::math::sum;
   using stan::math::var_value;
@@ -0,0 +1,59 @@
+#include <stan/model/log_prob_cache.hpp>
+#include <test/test-models/good/model/valid.hpp>
+#include <gtest/gtest.h>
+
+TEST(ModelUtil, log_prob_cache) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  std::vector<double> params_r(1, 0.5);
+  std::vector<int> params_i(0);
+  std::vector<double> gradient;
+  std::vector<double> expected_gradient;
+  double expected_lp = stan::model::log_prob_grad<true, true>(
+      model, params_r, params_i, expected_gradient);
+
+  stan::model::log_prob_cache cache(2);
+  EXPECT_FLOAT_EQ(expected_lp, (cache.log_prob_grad<true, true>(
+                                   model, params_r, params_i, gradient)));
+  EXPECT_EQ(expected_gradient, gradient);
+  EXPECT_EQ(0U, cache.hits());
+  EXPECT_EQ(1U, cache.misses());
+
+  // the gradient and the log density alone are served from the cache
+  gradient.clear();
+  EXPECT_FLOAT_EQ(expected_lp, (cache.log_prob_grad<true, true>(
+                                   model, params_r, params_i, gradient)));
+  EXPECT_EQ(expected_gradient, gradient);
+  EXPECT_FLOAT_EQ(expected_lp, (cache.log_prob_propto<true>(model, params_r,
+                                                            params_i)));
+  EXPECT_EQ(2U, cache.hits());
+
+  // other settings and points are evaluated
+  EXPECT_FLOAT_EQ(
+      (model.log_prob<false, true>(params_r, params_i, 0)),
+      (cache.log_prob<false, true>(model, params_r, params_i)));
+  std::vector<double> other(1, -1.5);
+  EXPECT_FLOAT_EQ((stan::model::log_prob_propto<true>(model, other, params_i)),
+                  (cache.log_prob_propto<true>(model, other, params_i)));
+  EXPECT_EQ(2U, cache.hits());
+  EXPECT_EQ(3U, cache.misses());
+
+  // a log density alone doesn't serve a gradient
+  EXPECT_FLOAT_EQ(
+      (stan::model::log_prob_grad<true, true>(model, other, params_i,
+                                              expected_gradient)),
+      (cache.log_prob_grad<true, true>(model, other, params_i, gradient)));
+  EXPECT_EQ(expected_gradient, gradient);
+  EXPECT_EQ(4U, cache.misses());
+
+  // the least recently used point is discarded
+  cache.log_prob_propto<true>(model, params_r, params_i);
+  EXPECT_EQ(5U, cache.misses());
+
+  cache.clear();
+  cache.log_prob_propto<true>(model, other, params_i);
+  EXPECT_EQ(6U, cache.misses());
+}
@@ -61,3 +61,37 @@ TEST(ModelUtil, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(ModelUtil, log_prob_grad_batch) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  Eigen::MatrixXd params_r(1, 5);
+  params_r << -2, -0.5, 0, 1, 3;
+
+  for (bool parallel : {false, true}) {
+    Eigen::VectorXd log_prob;
+    Eigen::MatrixXd gradients;
+    std::stringstream out;
+    stan::model::log_prob_grad<true, true>(model, params_r, log_prob,
+                                           gradients, parallel, &out);
+    EXPECT_EQ("", out.str());
+    ASSERT_EQ(5, log_prob.size());
+    ASSERT_EQ(1, gradients.rows());
+    ASSERT_EQ(5, gradients.cols());
+    for (int j = 0; j < params_r.cols(); ++j) {
+      double x = params_r(0, j);
+      EXPECT_FLOAT_EQ(-0.5 * x * x, log_prob(j));
+      EXPECT_NEAR(-x, gradients(0, j), 1e-6);
+    }
+  }
+
+  Eigen::VectorXd log_prob;
+  Eigen::MatrixXd gradients;
+  stan::model::log_prob_grad<true, true>(model, Eigen::MatrixXd(1, 0),
+                                         log_prob, gradients);
+  EXPECT_EQ(0, log_prob.size());
+  EXPECT_EQ(0, gradients.cols());
+}
@@ -146,3 +146,27 @@ TEST(model, modelTemplateLogProb) {
   double v8 = bm.template log_prob<true, true>(params_r_v, msgs).val();
   EXPECT_FLOAT_EQ(8, v8);
 }
+
+struct other_mock_model : public mock_model {
+  other_mock_model() : mock_model(3) {}
+};
+
+TEST(model, withConcreteModel) {
+  mock_model m(17);
+  stan::model::model_base& bm = m;
+  auto is_concrete = [](auto& model) {
+    return std::is_same<std::decay_t<decltype(model)>, mock_model>::value;
+  };
+  EXPECT_TRUE(stan::model::with_concrete_model<mock_model>(bm, is_concrete));
+
+  Eigen::VectorXd params_r(2);
+  double lp = stan::model::with_concrete_model<mock_model>(
+      bm, [&](auto& model) {
+        return model.template log_prob<true, true>(params_r, 0);
+      });
+  EXPECT_FLOAT_EQ(7, lp);
+
+  // not an other_mock_model, so called with the model_base
+  EXPECT_FALSE(
+      stan::model::with_concrete_model<other_mock_model>(bm, is_concrete));
+}
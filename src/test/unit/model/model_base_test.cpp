@@ -81,6 +81,11 @@ struct mock_model : public stan::model::model_base {
                    Eigen::VectorXd& params_constrained_r, bool include_tparams,
                    bool include_gqs, std::ostream* msgs) const override {}
 
+  void write_array(stan::util::philox4x32& base_rng,
+                   Eigen::VectorXd& params_r,
+                   Eigen::VectorXd& params_constrained_r, bool include_tparams,
+                   bool include_gqs, std::ostream* msgs) const override {}
+
   double log_prob(std::vector<double>& params_r, std::vector<int>& params_i,
                   std::ostream* msgs) const override {
     return 11;
@@ -138,6 +143,12 @@ struct mock_model : public stan::model::model_base {
                    std::vector<double>& params_r_constrained,
                    bool include_tparams, bool include_gqs,
                    std::ostream* msgs) const override {}
+
+  void write_array(stan::util::philox4x32& base_rng,
+                   std::vector<double>& params_r, std::vector<int>& params_i,
+                   std::vector<double>& params_r_constrained,
+                   bool include_tparams, bool include_gqs,
+                   std::ostream* msgs) const override {}
 };
 
 TEST(model, modelBaseInheritance) {
@@ -186,3 +197,20 @@ TEST(model, modelTemplateLogProb) {
   double v8 = bm.template log_prob<true, true>(params_r_v, msgs).val();
   EXPECT_FLOAT_EQ(8, v8);
 }
+
+TEST(model, modelBaseTransformedDataSnapshot) {
+  // models don't support snapshots unless they override the methods
+  mock_model m(17);
+  std::stringstream buffer;
+  stan::model::transformed_data_writer writer(buffer);
+  stan::model::transformed_data_reader reader(buffer);
+  EXPECT_FALSE(m.write_transformed_data(writer));
+  EXPECT_FALSE(m.read_transformed_data(reader));
+  EXPECT_EQ(0U, buffer.str().size());
+}
+
+TEST(model, modelBaseBuildHash) {
+  // without an override the build is identified by the compile info
+  mock_model m(17);
+  EXPECT_EQ("stanc_version = stanc3\n", m.model_build_hash());
+}
@@ -0,0 +1,55 @@
+#include <stan/model/model_messages.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+TEST(ModelMessages, nothing_printed) {
+  stan::test::unit::instrumented_logger logger;
+  { stan::model::model_messages msgs(logger); }
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST(ModelMessages, printed_messages_logged_once) {
+  stan::test::unit::instrumented_logger logger;
+  {
+    stan::model::model_messages msgs(logger);
+    *msgs.stream() << "first";
+  }
+  {
+    stan::model::model_messages msgs(logger);
+    *msgs.stream() << "second";
+  }
+  { stan::model::model_messages msgs(logger); }
+  EXPECT_EQ(2, logger.call_count_info());
+  EXPECT_EQ(1, logger.find_info("first"));
+  EXPECT_EQ(1, logger.find_info("second"));
+  EXPECT_EQ(0, logger.find_info("firstsecond"));
+}
+
+TEST(ModelMessages, logged_when_throwing) {
+  stan::test::unit::instrumented_logger logger;
+  try {
+    stan::model::model_messages msgs(logger);
+    *msgs.stream() << "before throwing";
+    throw std::domain_error("bad");
+  } catch (const std::domain_error& e) {
+  }
+  EXPECT_EQ(1, logger.find_info("before throwing"));
+}
+
+TEST(ModelMessages, nested) {
+  stan::test::unit::instrumented_logger logger;
+  {
+    stan::model::model_messages outer(logger);
+    *outer.stream() << "outer";
+    {
+      stan::model::model_messages inner(logger);
+      EXPECT_NE(outer.stream(), inner.stream());
+      *inner.stream() << "inner";
+    }
+    EXPECT_EQ(1, logger.find_info("inner"));
+    EXPECT_EQ(0, logger.find_info("outer"));
+  }
+  EXPECT_EQ(1, logger.find_info("outer"));
+  EXPECT_EQ(0, logger.find_info("outerinner"));
+}
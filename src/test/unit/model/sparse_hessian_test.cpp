@@ -0,0 +1,39 @@
+#include <stan/model/hessian.hpp>
+#include <stan/model/sparse_hessian.hpp>
+#include <test/test-models/good/model/valid.hpp>
+#include <gtest/gtest.h>
+
+TEST(ModelUtil, sparse_hessian) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  std::stringstream output;
+  valid_model_namespace::valid_model valid_model(data_var_context, 0, &output);
+  Eigen::VectorXd x(1);
+  x << 0.7;
+
+  Eigen::SparseMatrix<double> pattern
+      = stan::model::hessian_sparsity(valid_model, x);
+  EXPECT_EQ(1, pattern.nonZeros());
+
+  double f;
+  Eigen::VectorXd grad_f;
+  Eigen::MatrixXd hess_f;
+  stan::model::hessian(valid_model, x, f, grad_f, hess_f);
+
+  double sparse_f;
+  Eigen::VectorXd sparse_grad_f;
+  Eigen::SparseMatrix<double> sparse_hess_f;
+  stan::model::sparse_hessian(valid_model, x, pattern, sparse_f,
+                              sparse_grad_f, sparse_hess_f);
+  EXPECT_FLOAT_EQ(f, sparse_f);
+  EXPECT_TRUE(grad_f.isApprox(sparse_grad_f));
+  EXPECT_TRUE(hess_f.isApprox(Eigen::MatrixXd(sparse_hess_f)));
+  EXPECT_EQ("", output.str());
+
+  EXPECT_THROW(stan::model::sparse_hessian(
+                   valid_model, x, Eigen::SparseMatrix<double>(2, 2),
+                   sparse_f, sparse_grad_f, sparse_hess_f),
+               std::invalid_argument);
+}
@@ -4,6 +4,7 @@
 #include <test/test-models/good/model/valid.hpp>
 #include <test/unit/util.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/additive_combine.hpp>
 #include <gtest/gtest.h>
 
 TEST(ModelUtil, streams) {
@@ -64,3 +65,50 @@ TEST(ModelUtil, streams) {
   EXPECT_EQ("", stan::test::cout_ss.str());
   EXPECT_EQ("", stan::test::cerr_ss.str());
 }
+
+TEST(ModelUtil, test_gradients_subset_and_directions) {
+  std::fstream data_stream(std::string("").c_str(), std::fstream::in);
+  stan::io::dump data_var_context(data_stream);
+  data_stream.close();
+
+  stan_model model(data_var_context, 0, static_cast<std::stringstream*>(0));
+  std::vector<double> params_r(1);
+  std::vector<int> params_i(0);
+  stan::callbacks::interrupt interrupt;
+  boost::ecuyer1988 rng(123);
+  std::stringstream out;
+  stan::callbacks::stream_writer writer(out);
+  stan::test::unit::instrumented_logger logger;
+
+  for (bool parallel : {false, true}) {
+    out.str("");
+    EXPECT_EQ(0, (stan::model::test_gradients<true, true>(
+                     model, params_r, params_i, 1e-6, 1e-6, 5, rng, parallel,
+                     interrupt, logger, writer)));
+    EXPECT_EQ(
+        "\n Log probability=0\n\n param idx           value           model    "
+        " finite diff           error\n         0               0              "
+        " 0               0               0\n",
+        out.str());
+
+    out.str("");
+    EXPECT_EQ(0, (stan::model::test_gradients<true, true>(
+                     model, params_r, params_i, 1e-6, 1e-6, 0, rng, parallel,
+                     interrupt, logger, writer)));
+    EXPECT_EQ(
+        "\n Log probability=0\n\n param idx           value           model    "
+        " finite diff           error\n",
+        out.str());
+
+    out.str("");
+    EXPECT_EQ(0, (stan::model::test_directional_gradients<true, true>(
+                     model, params_r, params_i, 1e-6, 1e-6, 2, rng, parallel,
+                     interrupt, logger, writer)));
+    EXPECT_EQ(
+        "\n Log probability=0\n\n direction           model     finite diff"
+        "           error\n         0               0               0"
+        "               0\n         1               0               0"
+        "               0\n",
+        out.str());
+  }
+}
@@ -0,0 +1,152 @@
+#include <stan/model/transformed_data_snapshot.hpp>
+#include <stan/io/dump.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+std::string snapshot_model_build = "build 1";
+
+// A model whose constructor runs its transformed data block as a
+// generated model supporting snapshots does
+struct snapshot_model {
+  Eigen::MatrixXd dist_;
+  std::vector<int> idx_;
+  double scale_;
+  bool computed_;
+
+  snapshot_model(const stan::io::var_context& context, unsigned int seed,
+                 std::ostream* msgs)
+      : computed_(false) {
+    using stan::model::transformed_data_snapshot;
+    if (!transformed_data_snapshot::load(context, seed, *this)) {
+      std::vector<double> x = context.vals_r("x");
+      dist_.resize(x.size(), x.size());
+      for (size_t i = 0; i < x.size(); ++i)
+        for (size_t j = 0; j < x.size(); ++j)
+          dist_(i, j) = std::abs(x[i] - x[j]);
+      idx_ = {3, 1, 2};
+      scale_ = 0.5 * seed;
+      computed_ = true;
+      transformed_data_snapshot::save(context, seed, *this);
+    }
+  }
+
+  std::string model_name() const { return "snapshot_model"; }
+
+  std::string model_build_hash() const { return snapshot_model_build; }
+
+  bool write_transformed_data(stan::model::transformed_data_writer& w) const {
+    w.write("dist", dist_);
+    w.write("idx", idx_);
+    w.write("scale", scale_);
+    return true;
+  }
+
+  bool read_transformed_data(stan::model::transformed_data_reader& r) {
+    r.read("dist", dist_);
+    r.read("idx", idx_);
+    r.read("scale", scale_);
+    return true;
+  }
+};
+
+stan::io::dump data(const std::string& text) {
+  std::stringstream in(text);
+  return stan::io::dump(in);
+}
+}  // namespace
+
+TEST(ModelUtil, transformed_data_snapshot) {
+  std::string path = "transformed_data_snapshot_test.bin";
+  std::remove(path.c_str());
+  stan::io::dump context = data("x <- c(1.5, -2, 2.5)\nN <- 3\n");
+
+  snapshot_model no_snapshot(context, 4, 0);
+  EXPECT_TRUE(no_snapshot.computed_);
+
+  {
+    stan::model::transformed_data_snapshot snapshot(path);
+    snapshot_model first(context, 4, 0);
+    EXPECT_TRUE(first.computed_);
+    EXPECT_FALSE(snapshot.loaded());
+    EXPECT_TRUE(snapshot.saved());
+  }
+  {
+    stan::model::transformed_data_snapshot snapshot(path);
+    snapshot_model second(context, 4, 0);
+    EXPECT_FALSE(second.computed_);
+    EXPECT_TRUE(snapshot.loaded());
+    EXPECT_EQ(no_snapshot.dist_, second.dist_);
+    EXPECT_EQ(no_snapshot.idx_, second.idx_);
+    EXPECT_FLOAT_EQ(no_snapshot.scale_, second.scale_);
+  }
+
+  // other data or another seed recompute and replace the snapshot
+  stan::io::dump other = data("x <- c(1.5, -2, 3)\nN <- 3\n");
+  {
+    stan::model::transformed_data_snapshot snapshot(path);
+    EXPECT_TRUE(snapshot_model(other, 4, 0).computed_);
+    EXPECT_TRUE(snapshot_model(other, 5, 0).computed_);
+    EXPECT_FALSE(snapshot_model(other, 5, 0).computed_);
+  }
+  EXPECT_NE(stan::model::transformed_data_snapshot::data_hash(context, 4),
+            stan::model::transformed_data_snapshot::data_hash(other, 4));
+  EXPECT_NE(stan::model::transformed_data_snapshot::data_hash(context, 4),
+            stan::model::transformed_data_snapshot::data_hash(context, 5));
+
+  // another build of the model recomputes and replaces the snapshot
+  {
+    stan::model::transformed_data_snapshot snapshot(path);
+    snapshot_model_build = "build 2";
+    EXPECT_TRUE(snapshot_model(other, 5, 0).computed_);
+    EXPECT_FALSE(snapshot_model(other, 5, 0).computed_);
+    snapshot_model_build = "build 1";
+    EXPECT_TRUE(snapshot_model(other, 5, 0).computed_);
+  }
+
+  // out of scope, snapshots are neither read nor written
+  EXPECT_TRUE(snapshot_model(other, 5, 0).computed_);
+  std::remove(path.c_str());
+}
+
+TEST(ModelUtil, transformed_data_snapshot_corrupt) {
+  std::string path = "transformed_data_snapshot_corrupt.bin";
+  stan::io::dump context = data("x <- c(1.5, -2, 2.5)\n");
+  {
+    stan::model::transformed_data_snapshot snapshot(path);
+    snapshot_model first(context, 4, 0);
+  }
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size() - 4);
+  }
+  stan::model::transformed_data_snapshot snapshot(path);
+  snapshot_model second(context, 4, 0);
+  EXPECT_TRUE(second.computed_);
+  EXPECT_FALSE(snapshot.loaded());
+  std::remove(path.c_str());
+}
+
+TEST(ModelUtil, transformed_data_reader_names) {
+  std::stringstream buffer;
+  stan::model::transformed_data_writer writer(buffer);
+  writer.write("a", std::vector<Eigen::VectorXd>(2, Eigen::VectorXd::Ones(3)));
+  writer.write("b", 7);
+  stan::model::transformed_data_reader reader(buffer);
+  std::vector<Eigen::VectorXd> a;
+  reader.read("a", a);
+  ASSERT_EQ(2U, a.size());
+  EXPECT_EQ(Eigen::VectorXd::Ones(3), a[1]);
+  int c;
+  EXPECT_THROW(reader.read("c", c), std::domain_error);
+}
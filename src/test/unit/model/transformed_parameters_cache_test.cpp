@@ -0,0 +1,72 @@
+#include <stan/model/transformed_parameters_cache.hpp>
+#include <stan/math/prim/fun/Eigen.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using stan::model::transformed_parameters_cache;
+
+TEST(ModelTransformedParametersCache, store_find) {
+  transformed_parameters_cache cache(2);
+  std::vector<double> x{0.5, -1.0};
+  Eigen::VectorXd y(2);
+  y << 2.0, 3.0;
+  EXPECT_EQ(nullptr, cache.find(x));
+  cache.store(x, std::vector<double>{1.0, 2.0, 3.0});
+  cache.store(y, std::vector<double>{4.0});
+
+  const std::vector<double>* values = cache.find(x);
+  ASSERT_NE(nullptr, values);
+  EXPECT_EQ((std::vector<double>{1.0, 2.0, 3.0}), *values);
+  values = cache.find(std::vector<double>{2.0, 3.0});
+  ASSERT_NE(nullptr, values);
+  EXPECT_EQ((std::vector<double>{4.0}), *values);
+
+  // Only the exact point matches
+  EXPECT_EQ(nullptr, cache.find(std::vector<double>{0.5, -1.0 + 1e-15}));
+  EXPECT_EQ(nullptr, cache.find(std::vector<double>{0.5}));
+  EXPECT_EQ(2U, cache.hits());
+  EXPECT_EQ(3U, cache.misses());
+}
+
+TEST(ModelTransformedParametersCache, overwrites_oldest) {
+  transformed_parameters_cache cache(2);
+  for (int i = 0; i < 3; ++i)
+    cache.store(std::vector<double>{1.0 * i}, std::vector<double>{10.0 * i});
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_EQ(nullptr, cache.find(std::vector<double>{0.0}));
+  ASSERT_NE(nullptr, cache.find(std::vector<double>{1.0}));
+  ASSERT_NE(nullptr, cache.find(std::vector<double>{2.0}));
+  EXPECT_EQ(20.0, (*cache.find(std::vector<double>{2.0}))[0]);
+
+  cache.clear();
+  EXPECT_EQ(0U, cache.size());
+  EXPECT_EQ(nullptr, cache.find(std::vector<double>{2.0}));
+
+  transformed_parameters_cache none(0);
+  none.store(std::vector<double>{1.0}, std::vector<double>{1.0});
+  EXPECT_EQ(0U, none.size());
+  EXPECT_EQ(nullptr, none.find(std::vector<double>{1.0}));
+}
+
+TEST(ModelTransformedParametersCache, scopes) {
+  EXPECT_EQ(nullptr, transformed_parameters_cache::current());
+  {
+    transformed_parameters_cache::scope outer(4);
+    EXPECT_EQ(&outer.cache(), transformed_parameters_cache::current());
+    EXPECT_EQ(4U, transformed_parameters_cache::current()->capacity());
+    {
+      transformed_parameters_cache::scope inner(1);
+      EXPECT_EQ(&inner.cache(), transformed_parameters_cache::current());
+    }
+    EXPECT_EQ(&outer.cache(), transformed_parameters_cache::current());
+
+    // Other threads have no cache of their own
+    transformed_parameters_cache* other = &outer.cache();
+    std::thread([&other] {
+      other = transformed_parameters_cache::current();
+    }).join();
+    EXPECT_EQ(nullptr, other);
+  }
+  EXPECT_EQ(nullptr, transformed_parameters_cache::current());
+}
@@ -192,3 +192,104 @@ TEST(OptimizationBfgsLinesearch, wolfeLineSearch) {
   EXPECT_LE(f1, f0 + c1 * alpha * p.dot(gradx0));
   EXPECT_LE(std::fabs(p.dot(gradx1)), c2 * std::fabs(p.dot(gradx0)));
 }
+
+class linesearch_rosenbrock {
+ public:
+  int evals;
+  linesearch_rosenbrock() : evals(0) {}
+  int operator()(const Eigen::Matrix<double, Eigen::Dynamic, 1> &x, double &f,
+                 Eigen::Matrix<double, Eigen::Dynamic, 1> &g) {
+    ++evals;
+    double a = 1 - x(0), b = x(1) - x(0) * x(0);
+    f = a * a + 100 * b * b;
+    g.resize(2);
+    g(0) = -2 * a - 400 * x(0) * b;
+    g(1) = 200 * b;
+    return 0;
+  }
+};
+
+TEST(OptimizationBfgsLinesearch, moreThuenteLineSearch) {
+  using stan::optimization::MoreThuenteLineSearch;
+
+  static const double c1 = 1e-4;
+  static const double c2 = 0.9;
+  static const double minAlpha = 1e-16;
+  static const double maxLSIts = 20;
+  static const double maxLSRestarts = 10;
+
+  linesearch_testfunc func1;
+  Eigen::Matrix<double, -1, 1> x0, x1;
+  double f0, f1;
+  Eigen::Matrix<double, -1, 1> p, gradx0, gradx1;
+  double alpha;
+  int ret;
+
+  x0.setOnes(5, 1);
+  func1(x0, f0, gradx0);
+
+  p = -gradx0;
+
+  for (double alpha_init : {2.0, 10.0, 0.25, 1e-3}) {
+    alpha = alpha_init;
+    ret = MoreThuenteLineSearch(func1, alpha, x1, f1, gradx1, p, x0, f0,
+                                gradx0, c1, c2, minAlpha, maxLSIts,
+                                maxLSRestarts);
+    EXPECT_EQ(0, ret) << alpha_init;
+    EXPECT_NEAR(0, (x1 - (x0 + alpha * p)).norm(), 1e-8);
+    EXPECT_EQ(f1, func1(x1));
+    EXPECT_LE(f1, f0 + c1 * alpha * p.dot(gradx0));
+    EXPECT_LE(std::fabs(p.dot(gradx1)), c2 * std::fabs(p.dot(gradx0)));
+  }
+
+  // The initial step satisfies the Wolfe conditions, so it is the only
+  // step tried
+  alpha = 0.25;
+  ret = MoreThuenteLineSearch(func1, alpha, x1, f1, gradx1, p, x0, f0, gradx0,
+                              c1, c2, minAlpha, maxLSIts, maxLSRestarts);
+  EXPECT_EQ(0, ret);
+  EXPECT_FLOAT_EQ(0.25, alpha);
+
+  // Not a descent direction
+  Eigen::Matrix<double, -1, 1> up = gradx0;
+  alpha = 1;
+  ret = MoreThuenteLineSearch(func1, alpha, x1, f1, gradx1, up, x0, f0,
+                              gradx0, c1, c2, minAlpha, maxLSIts,
+                              maxLSRestarts);
+  EXPECT_EQ(1, ret);
+}
+
+TEST(OptimizationBfgsLinesearch, moreThuenteLineSearch_rosenbrock) {
+  using stan::optimization::MoreThuenteLineSearch;
+  using stan::optimization::WolfeLineSearch;
+
+  static const double c1 = 1e-4;
+  static const double c2 = 0.9;
+  static const double minAlpha = 1e-16;
+  static const double maxLSIts = 20;
+  static const double maxLSRestarts = 10;
+
+  Eigen::Matrix<double, -1, 1> x0(2), x1, p, gradx0, gradx1;
+  double f0, f1;
+  x0 << -1.2, 1;
+  linesearch_rosenbrock eval;
+  eval(x0, f0, gradx0);
+  p = -gradx0;
+
+  for (double alpha_init : {1e-3, 1.0, 100.0}) {
+    linesearch_rosenbrock mt;
+    double alpha = alpha_init;
+    int ret = MoreThuenteLineSearch(mt, alpha, x1, f1, gradx1, p, x0, f0,
+                                    gradx0, c1, c2, minAlpha, maxLSIts,
+                                    maxLSRestarts);
+    EXPECT_EQ(0, ret) << alpha_init;
+    EXPECT_LE(f1, f0 + c1 * alpha * p.dot(gradx0));
+    EXPECT_LE(std::fabs(p.dot(gradx1)), c2 * std::fabs(p.dot(gradx0)));
+
+    linesearch_rosenbrock wolfe;
+    alpha = alpha_init;
+    WolfeLineSearch(wolfe, alpha, x1, f1, gradx1, p, x0, f0, gradx0, c1, c2,
+                    minAlpha, maxLSIts, maxLSRestarts);
+    EXPECT_LE(mt.evals, wolfe.evals) << alpha_init;
+  }
+}
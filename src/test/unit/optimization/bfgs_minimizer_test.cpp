@@ -46,6 +46,7 @@ TEST_F(OptimizationBfgsMinimizer, ls_opts) {
   EXPECT_FLOAT_EQ(bfgs._ls_opts.c2, 0.9);
   EXPECT_FLOAT_EQ(bfgs._ls_opts.minAlpha, 1e-12);
   EXPECT_FLOAT_EQ(bfgs._ls_opts.alpha0, 1e-3);
+  EXPECT_FALSE(bfgs._ls_opts.useMoreThuente);
 }
 
 TEST_F(OptimizationBfgsMinimizer, conv_opts) {
@@ -394,3 +395,74 @@ TEST_F(OptimizationBfgsMinimizer, minimize) {
 
   EXPECT_FLOAT_EQ(bfgs.minimize(cont_vector), 31);
 }
+
+TEST_F(OptimizationBfgsMinimizer, minimize_more_thuente) {
+  static const std::string DATA("");
+  std::stringstream data_stream(DATA);
+  stan::io::dump dummy_context(data_stream);
+  Model rb_model(dummy_context);
+  std::stringstream out;
+  stan::optimization::ModelAdaptor<Model> _adaptor(rb_model, disc_vector, &out);
+  Optimizer bfgs(_adaptor);
+  bfgs._ls_opts.useMoreThuente = true;
+
+  int ret = bfgs.minimize(cont_vector);
+  EXPECT_GT(ret, 0);
+  EXPECT_NEAR(1, cont_vector[0], 1e-3);
+  EXPECT_NEAR(1, cont_vector[1], 1e-3);
+}
+
+// Rosenbrock function with its minimum at (c, c^2)
+struct shifted_rosenbrock {
+  double c;
+  int evals;
+  explicit shifted_rosenbrock(double c) : c(c), evals(0) {}
+  int operator()(const Eigen::Matrix<double, Eigen::Dynamic, 1> &x, double &f,
+                 Eigen::Matrix<double, Eigen::Dynamic, 1> &g) {
+    ++evals;
+    double a = c - x(0), b = x(1) - x(0) * x(0);
+    f = a * a + 100 * b * b;
+    g.resize(2);
+    g(0) = -2 * a - 400 * x(0) * b;
+    g(1) = 200 * b;
+    return 0;
+  }
+};
+
+TEST(OptimizationBfgsMinimizerWarmStart, warm_start) {
+  typedef stan::optimization::BFGSMinimizer<shifted_rosenbrock,
+                                            stan::optimization::LBFGSUpdate<> >
+      LbfgsOptimizer;
+  Eigen::Matrix<double, Eigen::Dynamic, 1> x(2);
+  x << 0, 0;
+  shifted_rosenbrock f(1);
+  LbfgsOptimizer first(f);
+  EXPECT_GT(first.minimize(x), 0);
+
+  // Refit to a slightly moved objective, from scratch and from the
+  // previous history
+  Eigen::Matrix<double, Eigen::Dynamic, 1> x_cold = x;
+  shifted_rosenbrock f_cold(1.05);
+  LbfgsOptimizer cold(f_cold);
+  EXPECT_GT(cold.minimize(x_cold), 0);
+
+  shifted_rosenbrock f_warm(1.05);
+  LbfgsOptimizer warm(f_warm);
+  warm.get_qnupdate() = first.get_qnupdate();
+  warm.initialize(x);
+  warm.warm_start();
+  int ret;
+  while (!(ret = warm.step()))
+    continue;
+  EXPECT_GT(ret, 0);
+  EXPECT_NEAR(1.05, warm.curr_x()(0), 1e-4);
+  EXPECT_NEAR(1.1025, warm.curr_x()(1), 1e-4);
+  EXPECT_LT(f_warm.evals, f_cold.evals);
+
+  // Without history there is nothing to warm start from
+  shifted_rosenbrock f_empty(1.05);
+  LbfgsOptimizer empty(f_empty);
+  empty.initialize(x);
+  empty.warm_start();
+  EXPECT_EQ(-empty.curr_g(), empty.curr_p());
+}
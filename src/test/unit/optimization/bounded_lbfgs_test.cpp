@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <stan/optimization/bounded_lbfgs.hpp>
+#include <limits>
+#include <stdexcept>
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1> vector_t;
+
+// Rosenbrock function, minimized at (1, 1)
+struct bounded_rosenbrock {
+  int operator()(const vector_t &x, double &f, vector_t &g) {
+    double a = 1 - x(0), b = x(1) - x(0) * x(0);
+    f = a * a + 100 * b * b;
+    g.resize(2);
+    g(0) = -2 * a - 400 * x(0) * b;
+    g(1) = 200 * b;
+    return 0;
+  }
+};
+
+// Separable quadratic sum_i (x_i - c_i)^2 / d_i
+struct bounded_quadratic {
+  vector_t c, d;
+  int operator()(const vector_t &x, double &f, vector_t &g) {
+    f = ((x - c).array().square() / d.array()).sum();
+    g = 2 * (x - c).array() / d.array();
+    return 0;
+  }
+};
+
+TEST(OptimizationBoundedLbfgs, unbounded_rosenbrock) {
+  bounded_rosenbrock f;
+  double inf = std::numeric_limits<double>::infinity();
+  vector_t lower = vector_t::Constant(2, -inf);
+  vector_t upper = vector_t::Constant(2, inf);
+  stan::optimization::BoundedLBFGSMinimizer<bounded_rosenbrock> lbfgs(
+      f, lower, upper);
+  vector_t x(2);
+  x << -1.2, 1;
+  int ret = lbfgs.minimize(x);
+  EXPECT_GT(ret, 0) << lbfgs.get_code_string(ret);
+  EXPECT_NEAR(1, x(0), 1e-4);
+  EXPECT_NEAR(1, x(1), 1e-4);
+  EXPECT_TRUE(lbfgs.active().empty());
+}
+
+TEST(OptimizationBoundedLbfgs, bounded_rosenbrock) {
+  bounded_rosenbrock f;
+  double inf = std::numeric_limits<double>::infinity();
+  vector_t lower(2), upper(2);
+  lower << -inf, -inf;
+  upper << 0.5, inf;
+  stan::optimization::BoundedLBFGSMinimizer<bounded_rosenbrock> lbfgs(
+      f, lower, upper);
+  vector_t x(2);
+  x << -1.2, 1;
+  int ret = lbfgs.minimize(x);
+  EXPECT_GT(ret, 0) << lbfgs.get_code_string(ret);
+  EXPECT_DOUBLE_EQ(0.5, x(0));
+  EXPECT_NEAR(0.25, x(1), 1e-5);
+  ASSERT_EQ(1, lbfgs.active().size());
+  EXPECT_EQ(0, lbfgs.active()[0]);
+  EXPECT_LT(lbfgs.proj_grad_norm(), 1e-4);
+}
+
+TEST(OptimizationBoundedLbfgs, quadratic_on_bounds) {
+  const int n = 50;
+  bounded_quadratic f;
+  f.c = vector_t::LinSpaced(n, -2, 2);
+  f.d = vector_t::LinSpaced(n, 1, 100);
+  vector_t lower = vector_t::Constant(n, -1);
+  vector_t upper = vector_t::Constant(n, 1);
+  stan::optimization::BoundedLBFGSMinimizer<bounded_quadratic> lbfgs(
+      f, lower, upper);
+  // The initial point is projected onto the box
+  vector_t x = vector_t::Constant(n, 3);
+  int ret = lbfgs.minimize(x);
+  EXPECT_GT(ret, 0) << lbfgs.get_code_string(ret);
+  vector_t expected = f.c.cwiseMax(lower).cwiseMin(upper);
+  for (int i = 0; i < n; ++i)
+    EXPECT_NEAR(expected(i), x(i), 1e-5) << i;
+  size_t num_bound = ((f.c.array() < -1) || (f.c.array() > 1)).count();
+  EXPECT_EQ(num_bound, lbfgs.active().size());
+  EXPECT_LT(lbfgs.iter_num(), 50);
+}
+
+TEST(OptimizationBoundedLbfgs, bad_bounds) {
+  bounded_rosenbrock f;
+  vector_t lower(2), upper(2), upper_short(1);
+  lower << 0, 1;
+  upper << 1, 0;
+  upper_short << 1;
+  typedef stan::optimization::BoundedLBFGSMinimizer<bounded_rosenbrock>
+      Optimizer;
+  EXPECT_THROW(Optimizer(f, lower, upper), std::invalid_argument);
+  EXPECT_THROW(Optimizer(f, lower, upper_short), std::invalid_argument);
+
+  upper << 1, 2;
+  Optimizer lbfgs(f, lower, upper);
+  EXPECT_THROW(lbfgs.initialize(vector_t::Zero(3)), std::invalid_argument);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <stan/optimization/compact_lbfgs_update.hpp>
+#include <stan/optimization/lbfgs_update.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+TEST(OptimizationCompactLbfgsUpdate, matches_lbfgs_update) {
+  typedef stan::optimization::CompactLBFGSUpdate<> QNUpdateT;
+  typedef QNUpdateT::VectorT VectorT;
+
+  boost::ecuyer1988 rng(12345);
+  boost::variate_generator<boost::ecuyer1988&, boost::normal_distribution<> >
+      rand_normal(rng, boost::normal_distribution<>());
+
+  const unsigned int nDim = 20;
+  const unsigned int maxRank = 6;
+  VectorT yk(nDim), sk(nDim), gk(nDim), sdir(nDim), expected(nDim);
+
+  for (unsigned int rank = 2; rank <= maxRank; rank++) {
+    QNUpdateT compactUp(rank);
+    stan::optimization::LBFGSUpdate<> bfgsUp(rank);
+    for (unsigned int i = 0; i < 3 * rank; i++) {
+      // curvature pairs of a convex quadratic, so sk' yk > 0
+      for (unsigned int n = 0; n < nDim; n++) {
+        sk[n] = rand_normal();
+        yk[n] = (1 + n) * sk[n];
+        gk[n] = rand_normal();
+      }
+      EXPECT_FLOAT_EQ(bfgsUp.update(yk, sk, i == 0),
+                      compactUp.update(yk, sk, i == 0));
+      EXPECT_EQ(std::min(i + 1, rank), compactUp.history_size());
+
+      bfgsUp.search_direction(expected, gk);
+      compactUp.search_direction(sdir, gk);
+      EXPECT_NEAR((sdir - expected).norm(), 0.0, 1e-10 * expected.norm());
+    }
+
+    // shortening the history keeps the most recent updates
+    QNUpdateT::HistoryT S, Y, S_short, Y_short;
+    compactUp.history(S, Y);
+    compactUp.set_history_size(rank - 1);
+    compactUp.history(S_short, Y_short);
+    EXPECT_EQ(rank - 1, compactUp.history_size());
+    EXPECT_TRUE(S_short.isApprox(S.rightCols(rank - 1)));
+    EXPECT_TRUE(Y_short.isApprox(Y.rightCols(rank - 1)));
+    bfgsUp.set_history_size(rank - 1);
+    bfgsUp.search_direction(expected, gk);
+    compactUp.search_direction(sdir, gk);
+    EXPECT_NEAR((sdir - expected).norm(), 0.0, 1e-10 * expected.norm());
+  }
+}
+
+TEST(OptimizationCompactLbfgsUpdate, lbfgs_update_secant) {
+  typedef stan::optimization::CompactLBFGSUpdate<> QNUpdateT;
+  typedef QNUpdateT::VectorT VectorT;
+
+  const unsigned int nDim = 10;
+  const unsigned int maxRank = 3;
+  VectorT yk(nDim), sk(nDim), sdir(nDim);
+
+  // Construct a set of BFGS update vectors and check that
+  // the secant equation H*yk = sk is always satisfied.
+  for (unsigned int rank = 1; rank <= maxRank; rank++) {
+    QNUpdateT bfgsUp(rank);
+    for (unsigned int i = 0; i < nDim; i++) {
+      sk.setZero(nDim);
+      yk.setZero(nDim);
+      sk[i] = 1;
+      yk[i] = 1;
+
+      bfgsUp.update(yk, sk, i == 0);
+
+      for (unsigned int j = 0; j <= std::min(rank - 1, i); j++) {
+        sk.setZero(nDim);
+        yk.setZero(nDim);
+        sk[i - j] = 1;
+        yk[i - j] = 1;
+
+        bfgsUp.search_direction(sdir, yk);
+
+        EXPECT_NEAR((sdir + sk).norm(), 0.0, 1e-10);
+      }
+    }
+  }
+}
+
+TEST(OptimizationCompactLbfgsUpdate, restore) {
+  typedef stan::optimization::LBFGSUpdate<> LBFGST;
+  typedef stan::optimization::CompactLBFGSUpdate<> CompactT;
+  typedef LBFGST::VectorT VectorT;
+
+  const int nDim = 8;
+  LBFGST lbfgs(4);
+  std::srand(11);
+  for (int i = 0; i < 6; i++) {
+    VectorT sk = VectorT::Random(nDim);
+    VectorT yk = sk + 0.1 * VectorT::Random(nDim);
+    lbfgs.update(yk, sk, i == 0);
+  }
+
+  LBFGST::HistoryT S, Y;
+  lbfgs.history(S, Y);
+  CompactT compact(4);
+  compact.restore(S, Y, lbfgs.gammak());
+  EXPECT_EQ(4, compact.history_size());
+  EXPECT_FLOAT_EQ(lbfgs.gammak(), compact.gammak());
+
+  VectorT gk = VectorT::Random(nDim), pk, pk_compact;
+  lbfgs.search_direction(pk, gk);
+  compact.search_direction(pk_compact, gk);
+  EXPECT_NEAR(0, (pk - pk_compact).norm(), 1e-10 * pk.norm());
+}
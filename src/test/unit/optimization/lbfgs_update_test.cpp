@@ -119,3 +119,45 @@ TEST(OptimizationLbfgsUpdate, search_direction) {
     }
   }
 }
+
+TEST(OptimizationLbfgsUpdate, history_restore) {
+  typedef stan::optimization::LBFGSUpdate<> QNUpdateT;
+  typedef QNUpdateT::VectorT VectorT;
+  typedef QNUpdateT::HistoryT HistoryT;
+
+  const int nDim = 6;
+  QNUpdateT bfgsUp(3);
+  EXPECT_EQ(0, bfgsUp.history_size());
+  std::srand(7);
+  for (int i = 0; i < 5; i++) {
+    VectorT sk = VectorT::Random(nDim);
+    VectorT yk = sk + 0.1 * VectorT::Random(nDim);
+    bfgsUp.update(yk, sk, i == 0);
+  }
+  EXPECT_EQ(3, bfgsUp.history_size());
+
+  HistoryT S, Y;
+  bfgsUp.history(S, Y);
+  ASSERT_EQ(nDim, S.rows());
+  ASSERT_EQ(3, S.cols());
+  ASSERT_EQ(3, Y.cols());
+
+  QNUpdateT restored(3);
+  restored.restore(S, Y, bfgsUp.gammak());
+  EXPECT_EQ(3, restored.history_size());
+  EXPECT_FLOAT_EQ(bfgsUp.gammak(), restored.gammak());
+
+  VectorT gk = VectorT::Random(nDim), pk, pk_restored;
+  bfgsUp.search_direction(pk, gk);
+  restored.search_direction(pk_restored, gk);
+  EXPECT_NEAR(0, (pk - pk_restored).norm(), 1e-12);
+
+  // A shorter history keeps the most recent updates
+  QNUpdateT shorter(2);
+  shorter.restore(S, Y, bfgsUp.gammak());
+  HistoryT S2, Y2;
+  shorter.history(S2, Y2);
+  ASSERT_EQ(2, S2.cols());
+  EXPECT_EQ(S.col(2), S2.col(1));
+  EXPECT_EQ(Y.col(1), Y2.col(0));
+}
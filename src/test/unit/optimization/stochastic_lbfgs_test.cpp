@@ -0,0 +1,88 @@
+#include <stan/optimization/stochastic_lbfgs.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Negative log density of a linear regression with a standard normal
+// prior on the coefficients, estimated from rows of the data
+class regression_objective {
+ public:
+  Eigen::MatrixXd X;
+  Eigen::VectorXd y;
+  size_t num_evals;
+
+  regression_objective(size_t num_rows, size_t num_coefs)
+      : X(num_rows, num_coefs), y(num_rows), num_evals(0) {
+    boost::ecuyer1988 rng(1234);
+    boost::variate_generator<boost::ecuyer1988&,
+                             boost::normal_distribution<> >
+        rand_normal(rng, boost::normal_distribution<>());
+    for (size_t j = 0; j < num_coefs; ++j)
+      for (size_t i = 0; i < num_rows; ++i)
+        X(i, j) = rand_normal();
+    for (size_t i = 0; i < num_rows; ++i)
+      y(i) = X.row(i).sum() + 0.5 * rand_normal();
+  }
+
+  Eigen::VectorXd mode() const {
+    Eigen::MatrixXd A = X.transpose() * X;
+    A.diagonal().array() += 1;
+    return A.ldlt().solve(X.transpose() * y);
+  }
+
+  int operator()(const Eigen::VectorXd& b, const std::vector<size_t>& rows,
+                 double& f, Eigen::VectorXd& g) {
+    num_evals += rows.size();
+    const double scale = static_cast<double>(X.rows()) / rows.size();
+    f = 0.5 * b.squaredNorm();
+    g = b;
+    for (size_t i : rows) {
+      double r = X.row(i).dot(b) - y(i);
+      f += scale * 0.5 * r * r;
+      g += scale * r * X.row(i).transpose();
+    }
+    return 0;
+  }
+};
+
+TEST(OptimizationStochasticLbfgs, regression) {
+  const size_t num_rows = 5000;
+  regression_objective objective(num_rows, 5);
+  stan::optimization::StochasticLBFGS<regression_objective> lbfgs(objective,
+                                                                  num_rows);
+  lbfgs._opts.batchSize = 250;
+  lbfgs._opts.maxEpochs = 3;
+  lbfgs._opts.stepSize = 0.5;
+  boost::ecuyer1988 rng(4321);
+  lbfgs.initialize(Eigen::VectorXd::Zero(5), rng);
+
+  int ret = 0;
+  while (ret == 0)
+    ret = lbfgs.step(rng);
+  EXPECT_EQ(stan::optimization::TERM_MAXIT, ret);
+  EXPECT_GE(lbfgs.epochs(), 3);
+  // every row of a batch is evaluated once
+  EXPECT_EQ(250 * (lbfgs.iter_num() + 1), objective.num_evals);
+
+  Eigen::VectorXd mode = objective.mode();
+  EXPECT_LT((lbfgs.curr_x() - mode).norm(), 0.05 * mode.norm());
+
+  // polish on the full data
+  typedef stan::optimization::FullBatchFunctor<regression_objective>
+      full_batch_t;
+  full_batch_t full_batch(objective, num_rows);
+  stan::optimization::BFGSMinimizer<full_batch_t,
+                                    stan::optimization::LBFGSUpdate<> >
+      polish(full_batch);
+  Eigen::VectorXd x = lbfgs.curr_x();
+  EXPECT_GT(polish.minimize(x), 0);
+  EXPECT_LT((x - mode).norm(), 1e-6 * mode.norm());
+}
+
+TEST(OptimizationStochasticLbfgs, no_rows) {
+  regression_objective objective(0, 2);
+  typedef stan::optimization::StochasticLBFGS<regression_objective> lbfgs_t;
+  EXPECT_THROW(lbfgs_t(objective, 0), std::invalid_argument);
+}
@@ -0,0 +1,125 @@
+#include <stan/services/batch/batch_fit.hpp>
+#include <gtest/gtest.h>
+#include <stan/callbacks/interrupt.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+class recorded_status : public stan::services::batch::batch_status {
+ public:
+  explicit recorded_status(size_t num_jobs)
+      : started_(num_jobs, 0), finished_(num_jobs, 0), codes_(num_jobs, -1) {}
+
+  void started(size_t job) { ++started_[job]; }
+
+  void finished(size_t job, int return_code, const std::string& message) {
+    ++finished_[job];
+    codes_[job] = return_code;
+  }
+
+  std::vector<int> started_, finished_, codes_;
+};
+}  // namespace
+
+class ServicesBatchFit : public ::testing::Test {
+ public:
+  ServicesBatchFit()
+      : data1({"N", "y"}, std::vector<int>{4, 0, 1, 0, 0}, {{}, {4}}),
+        data2({"N", "y"}, std::vector<int>{3, 1, 1, 0}, {{}, {3}}),
+        constructed(0) {
+    factories["bernoulli"] = [this](const stan::io::var_context& data,
+                                    unsigned int seed, std::ostream* msg) {
+      ++constructed;
+      return std::unique_ptr<stan::model::model_base>(
+          new stan_model(data, seed, msg));
+    };
+  }
+
+  /**
+   * A job sampling its chains with NUTS into a stream per chain.
+   */
+  stan::services::batch::batch_job nuts_job(const stan::io::var_context& data,
+                                            size_t job) {
+    stan::services::batch::batch_job result;
+    result.model = "bernoulli";
+    result.data = &data;
+    result.num_chains = 2;
+    result.run_chain = [this, job](stan::model::model_base& model,
+                                   size_t chain) {
+      stan::io::empty_var_context init;
+      stan::callbacks::interrupt interrupt;
+      stan::callbacks::logger logger;
+      stan::callbacks::writer init_writer, diagnostic_writer;
+      stan::callbacks::stream_writer sample_writer(*outputs[2 * job + chain]);
+      return stan::services::sample::hmc_nuts_diag_e(
+          model, init, 17, chain, 2, 0, 20, 1, false, 0, 1, 0, 5, interrupt,
+          logger, init_writer, sample_writer, diagnostic_writer);
+    };
+    return result;
+  }
+
+  void SetUp() {
+    for (int i = 0; i < 8; ++i)
+      outputs.emplace_back(new std::stringstream());
+  }
+
+  stan::io::array_var_context data1, data2;
+  std::map<std::string, stan::services::batch::model_factory> factories;
+  std::vector<std::unique_ptr<std::stringstream>> outputs;
+  std::atomic<int> constructed;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesBatchFit, shares_models_and_streams_outputs) {
+  std::vector<stan::services::batch::batch_job> jobs{
+      nuts_job(data1, 0), nuts_job(data2, 1), nuts_job(data1, 2)};
+  recorded_status status(jobs.size());
+  int return_code = stan::services::batch::batch_fit(factories, jobs, logger,
+                                                     status);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  // Jobs 0 and 2 share the model of data1
+  EXPECT_EQ(2, constructed);
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    EXPECT_EQ(1, status.started_[j]);
+    EXPECT_EQ(1, status.finished_[j]);
+    EXPECT_EQ(stan::services::error_codes::OK, status.codes_[j]);
+  }
+  for (int i = 0; i < 6; ++i)
+    EXPECT_NE(std::string::npos, outputs[i]->str().find("lp__"));
+  // The same seed and chain on the same data give the same draws
+  EXPECT_EQ(outputs[0]->str(), outputs[4]->str());
+  EXPECT_NE(outputs[0]->str(), outputs[2]->str());
+}
+
+TEST_F(ServicesBatchFit, failed_jobs_do_not_stop_others) {
+  std::vector<stan::services::batch::batch_job> jobs{
+      nuts_job(data1, 0), nuts_job(data2, 1), nuts_job(data1, 2)};
+  jobs[1].model = "unknown";
+  jobs[2].run_chain = [](stan::model::model_base& model, size_t chain) {
+    if (chain == 1)
+      throw std::runtime_error("chain failure");
+    return 0;
+  };
+  recorded_status status(jobs.size());
+  int return_code = stan::services::batch::batch_fit(factories, jobs, logger,
+                                                     status);
+  EXPECT_NE(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(stan::services::error_codes::OK, status.codes_[0]);
+  EXPECT_EQ(stan::services::error_codes::CONFIG, status.codes_[1]);
+  EXPECT_EQ(stan::services::error_codes::SOFTWARE, status.codes_[2]);
+  EXPECT_EQ(1, status.finished_[1]);
+  EXPECT_EQ(1, logger.find_error("unknown model unknown"));
+  EXPECT_EQ(1, logger.find_error("chain failure"));
+  EXPECT_NE(std::string::npos, outputs[1]->str().find("lp__"));
+}
@@ -22,3 +22,15 @@ TEST(diagnose_defaults, error) {
 
   EXPECT_FLOAT_EQ(1e-6, error::default_value());
 }
+
+TEST(diagnose_defaults, num_evals) {
+  using stan::services::diagnose::num_evals;
+  EXPECT_EQ("Number of timed evaluations of the log density and gradient.",
+            num_evals::description());
+
+  EXPECT_NO_THROW(num_evals::validate(num_evals::default_value()));
+  EXPECT_NO_THROW(num_evals::validate(1));
+  EXPECT_THROW(num_evals::validate(0), std::invalid_argument);
+
+  EXPECT_EQ(1000, num_evals::default_value());
+}
@@ -37,3 +37,34 @@ TEST_F(ServicesDiagnose, diagnose) {
   EXPECT_TRUE(parameter_ss.str().find("Log probability=3.218")
               != std::string::npos);
 }
+
+TEST_F(ServicesDiagnose, benchmark) {
+  stan::model::gradient_benchmark timings
+      = stan::services::diagnose::benchmark(model, context, 0, 1, 0, 50,
+                                            interrupt, logger, init,
+                                            parameter);
+  EXPECT_EQ("", model_ss.str());
+  EXPECT_EQ("0,0\n", init_ss.str());
+
+  EXPECT_EQ(50, timings.num_evals);
+  EXPECT_GT(timings.log_prob.mean, 0);
+  EXPECT_GT(timings.log_prob_grad.mean, 0);
+  EXPECT_LE(timings.log_prob_grad.median, timings.log_prob_grad.p99);
+  EXPECT_GT(timings.tape_bytes, 0U);
+  EXPECT_GT(timings.tape_vars, 0U);
+  EXPECT_GT(timings.gradients_per_second(), 0);
+
+  EXPECT_EQ(1, logger.find_info("GRADIENT BENCHMARK MODE"));
+  EXPECT_EQ(1, logger.find_info("Evaluations=50"));
+  EXPECT_EQ(1, logger.find_info("log_prob_grad"));
+  EXPECT_EQ(1, logger.find_info("Gradients per second="));
+  EXPECT_EQ(1, logger.find_info("Predicted time per NUTS transition"));
+  EXPECT_EQ(1, logger.find_info("      1023"));
+  EXPECT_TRUE(parameter_ss.str().find("Autodiff tape per gradient=")
+              != std::string::npos);
+
+  EXPECT_THROW(stan::services::diagnose::benchmark(model, context, 0, 1, 0, 0,
+                                                   interrupt, logger, init,
+                                                   parameter),
+               std::invalid_argument);
+}
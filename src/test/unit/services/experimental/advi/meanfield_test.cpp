@@ -95,3 +95,33 @@ TEST_F(ServicesExperimentalAdvi, meanfield) {
 
   EXPECT_EQ(0, interrupt.call_count());
 }
+
+TEST_F(ServicesExperimentalAdvi, meanfield_warm_start) {
+  stan::test::unit::instrumented_writer state;
+  int return_code = stan::services::experimental::advi::meanfield(
+      model, context, 0, 1, 0, 1, 100, 10000, 0.01, 1.0, true, 50, 100, 1000,
+      interrupt, logger, init, parameter, diagnostic, nullptr, state);
+  EXPECT_EQ(0, return_code);
+  ASSERT_GT(state.string_values().size(), 0);
+  std::string last_state = state.string_values().back();
+
+  // Continuing skips eta adaptation
+  stan::test::unit::instrumented_logger warm_logger;
+  stan::test::unit::instrumented_writer warm_parameter, warm_diagnostic,
+      warm_state;
+  std::stringstream in(last_state);
+  return_code = stan::services::experimental::advi::meanfield(
+      model, context, 0, 1, 0, 1, 100, 10000, 0.01, 1.0, true, 50, 100, 1000,
+      interrupt, warm_logger, init, warm_parameter, warm_diagnostic, &in,
+      warm_state);
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(0, warm_logger.find_info("Begin eta adaptation"));
+  EXPECT_EQ(1, warm_logger.find_info("Continuing stochastic gradient ascent"));
+  ASSERT_GT(warm_state.string_values().size(), 0);
+
+  std::stringstream bad_state("advi\n1\nnormal_fullrank\n");
+  return_code = stan::services::experimental::advi::meanfield(
+      model, context, 0, 1, 0, 1, 100, 10000, 0.01, 1.0, true, 50, 100, 1000,
+      interrupt, logger, init, parameter, diagnostic, &bad_state, state);
+  EXPECT_EQ(stan::services::error_codes::USAGE, return_code);
+}
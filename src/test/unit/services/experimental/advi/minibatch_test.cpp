@@ -0,0 +1,75 @@
+#include <stan/services/experimental/advi/minibatch.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+
+// The test model treats its whole log density as a single row of data
+class rows_model : public stan_model {
+ public:
+  rows_model(stan::io::var_context& context, std::ostream* msgs)
+      : stan_model(context, 0, msgs) {}
+
+  size_t num_rows() const { return 1; }
+
+  template <bool propto, bool jacobian, typename T>
+  T log_prob_rows(Eigen::Matrix<T, -1, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* msgs = 0) const {
+    return this->template log_prob<propto, jacobian>(params_r, msgs);
+  }
+};
+
+class ServicesExperimentalAdvi : public testing::Test {
+ public:
+  ServicesExperimentalAdvi() : model(context, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::test::unit::instrumented_logger logger;
+  stan::io::empty_var_context context;
+  stan::test::unit::instrumented_interrupt interrupt;
+  rows_model model;
+};
+
+TEST_F(ServicesExperimentalAdvi, minibatch) {
+  unsigned int seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int batch_size = 1;
+  int grad_samples = 1;
+  int elbo_samples = 100;
+  int max_iterations = 10000;
+  double tol_rel_obj = 0.01;
+  double eta = 1.0;
+  bool adapt_engaged = true;
+  int adapt_iterations = 50;
+  int eval_elbo = 100;
+  int output_samples = 1000;
+
+  int return_code = stan::services::experimental::advi::minibatch(
+      model, context, seed, chain, init_radius, batch_size, grad_samples,
+      elbo_samples, max_iterations, tol_rel_obj, eta, adapt_engaged,
+      adapt_iterations, eval_elbo, output_samples, interrupt, logger, init,
+      parameter, diagnostic);
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(1, logger.find_info("batches of 1 of 1 rows"));
+
+  std::vector<std::vector<std::string> > parameter_names;
+  parameter_names = parameter.vector_string_values();
+  ASSERT_EQ(8, parameter_names[0].size());
+  EXPECT_EQ("lp__", parameter_names[0][0]);
+  EXPECT_EQ("log_p__", parameter_names[0][1]);
+  EXPECT_EQ("log_g__", parameter_names[0][2]);
+
+  ASSERT_EQ(output_samples + 1, parameter.vector_double_values().size());
+  EXPECT_EQ(0, interrupt.call_count());
+}
+
+TEST_F(ServicesExperimentalAdvi, minibatch_bad_batch_size) {
+  int return_code = stan::services::experimental::advi::minibatch(
+      model, context, 0, 1, 0, 0, 1, 100, 10000, 0.01, 1.0, true, 50, 100,
+      1000, interrupt, logger, init, parameter, diagnostic);
+  EXPECT_EQ(stan::services::error_codes::USAGE, return_code);
+  EXPECT_EQ(1, logger.find_error("batch size"));
+}
@@ -0,0 +1,89 @@
+#include <stan/services/experimental/sgmcmc/sghmc.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <string>
+#include <vector>
+
+// The test model treats its whole log density as a single row of data
+class rows_model : public stan_model {
+ public:
+  rows_model(stan::io::var_context& context, std::ostream* msgs)
+      : stan_model(context, 0, msgs) {}
+
+  size_t num_rows() const { return 1; }
+
+  template <bool propto, bool jacobian, typename T>
+  T log_prob_rows(Eigen::Matrix<T, -1, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* msgs = 0) const {
+    return this->template log_prob<propto, jacobian>(params_r, msgs);
+  }
+};
+
+class ServicesExperimentalSghmc : public testing::Test {
+ public:
+  ServicesExperimentalSghmc() : model(context, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::test::unit::instrumented_logger logger;
+  stan::io::empty_var_context context;
+  stan::test::unit::instrumented_interrupt interrupt;
+  rows_model model;
+};
+
+TEST_F(ServicesExperimentalSghmc, call_count) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  int batch_size = 1;
+  double stepsize = 0.1;
+  double stepsize_t0 = 100;
+  double stepsize_decay = 0.55;
+  double friction = 0.2;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 25;
+
+  int return_code = stan::services::experimental::sgmcmc::sghmc(
+      model, context, random_seed, chain, init_radius, num_warmup,
+      num_samples, num_thin, save_warmup, refresh, batch_size, stepsize,
+      stepsize_t0, stepsize_decay, friction, init_buffer, term_buffer, window,
+      interrupt, logger, init, parameter, diagnostic);
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(1, logger.find_info("batches of 1 of 1 rows"));
+
+  int num_output_lines = (num_warmup + num_samples) / num_thin;
+  EXPECT_EQ(num_warmup + num_samples, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, parameter.call_count("vector_double"));
+  EXPECT_EQ(1, diagnostic.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, diagnostic.call_count("vector_double"));
+
+  std::vector<std::string> names = parameter.vector_string_values()[0];
+  ASSERT_LE(3, names.size());
+  EXPECT_EQ("lp__", names[0]);
+  EXPECT_EQ("accept_stat__", names[1]);
+  EXPECT_EQ("stepsize__", names[2]);
+}
+
+TEST_F(ServicesExperimentalSghmc, bad_arguments) {
+  int return_code = stan::services::experimental::sgmcmc::sghmc(
+      model, context, 0, 1, 0, 200, 400, 1, false, 0, 0, 0.1, 100, 0.55, 0.2,
+      50, 50, 25, interrupt, logger, init, parameter, diagnostic);
+  EXPECT_EQ(stan::services::error_codes::USAGE, return_code);
+  EXPECT_EQ(1, logger.find_error("batch size"));
+
+  return_code = stan::services::experimental::sgmcmc::sghmc(
+      model, context, 0, 1, 0, 200, 400, 1, false, 0, 1, 0.1, 100, 0.55, 0,
+      50, 50, 25, interrupt, logger, init, parameter, diagnostic);
+  EXPECT_EQ(stan::services::error_codes::CONFIG, return_code);
+  EXPECT_EQ(1, logger.find_error("friction"));
+}
@@ -0,0 +1,73 @@
+#include <stan/services/optimize/bounded_lbfgs.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+class values : public stan::callbacks::stream_writer {
+ public:
+  std::vector<std::string> names_;
+  std::vector<std::vector<double> > states_;
+
+  values(std::ostream& stream) : stan::callbacks::stream_writer(stream) {}
+
+  void operator()(const std::vector<std::string>& names) { names_ = names; }
+
+  void operator()(const std::vector<double>& state) {
+    states_.push_back(state);
+  }
+};
+
+class ServicesOptimizeBoundedLbfgs : public testing::Test {
+ public:
+  ServicesOptimizeBoundedLbfgs()
+      : init(init_ss), parameter(parameter_ss), model(context, 0, &model_ss) {}
+
+  std::stringstream init_ss, parameter_ss, model_ss;
+  stan::callbacks::stream_writer init;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_interrupt interrupt;
+  values parameter;
+  stan::io::empty_var_context context;
+  stan_model model;
+};
+
+TEST_F(ServicesOptimizeBoundedLbfgs, rosenbrock) {
+  double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> lower = {-inf, -inf};
+  std::vector<double> upper = {0.5, inf};
+
+  int return_code = stan::services::optimize::bounded_lbfgs(
+      model, context, lower, upper, 0, 1, 0, 5, 1e-12, 10000, 1e-8, 1e-8,
+      2000, 1, interrupt, logger, init, parameter);
+
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(logger.call_count(), logger.call_count_info())
+      << "all output to info";
+  EXPECT_EQ(1, logger.find("Initial log joint probability = -1"));
+  EXPECT_EQ(1, logger.find("Optimization terminated normally: "));
+  EXPECT_GT(interrupt.call_count(), 0);
+
+  ASSERT_EQ(3, parameter.names_.size());
+  EXPECT_EQ("lp__", parameter.names_[0]);
+  ASSERT_EQ(1, parameter.states_.size());
+  EXPECT_FLOAT_EQ(-0.25, parameter.states_[0][0]);
+  EXPECT_FLOAT_EQ(0.5, parameter.states_[0][1]);
+  EXPECT_NEAR(0.25, parameter.states_[0][2], 1e-5);
+}
+
+TEST_F(ServicesOptimizeBoundedLbfgs, bad_bounds) {
+  std::vector<double> lower = {0};
+  std::vector<double> upper = {1};
+
+  int return_code = stan::services::optimize::bounded_lbfgs(
+      model, context, lower, upper, 0, 1, 0, 5, 1e-12, 10000, 1e-8, 1e-8,
+      2000, 0, interrupt, logger, init, parameter);
+  EXPECT_EQ(stan::services::error_codes::USAGE, return_code);
+  EXPECT_EQ(1, logger.call_count_error());
+  EXPECT_EQ(0, parameter.states_.size());
+}
@@ -0,0 +1,101 @@
+#include <stan/services/optimize/laplace_sample.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class values : public stan::callbacks::stream_writer {
+ public:
+  std::vector<std::string> names_;
+  std::vector<std::vector<double> > states_;
+
+  values(std::ostream& stream) : stan::callbacks::stream_writer(stream) {}
+
+  void operator()(const std::vector<std::string>& names) { names_ = names; }
+
+  void operator()(const std::vector<double>& state) {
+    states_.push_back(state);
+  }
+};
+
+class ServicesOptimizeLaplaceSample : public testing::Test {
+ public:
+  ServicesOptimizeLaplaceSample()
+      : sample(sample_ss), model(context, 0, &model_ss) {}
+
+  stan::io::array_var_context mode(double x, double y) {
+    std::vector<std::string> names = {"x", "y"};
+    std::vector<double> vals = {x, y};
+    std::vector<std::vector<size_t> > dims(2);
+    return stan::io::array_var_context(names, vals, dims);
+  }
+
+  std::stringstream sample_ss, model_ss;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_interrupt interrupt;
+  values sample;
+  stan::io::empty_var_context context;
+  stan_model model;
+};
+
+TEST_F(ServicesOptimizeLaplaceSample, rosenbrock) {
+  int num_draws = 4000;
+  stan::io::array_var_context mode_context = mode(1, 1);
+  int return_code = stan::services::optimize::laplace_sample(
+      model, mode_context, num_draws, 0, 1, 1000, interrupt, logger, sample);
+
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(0, logger.call_count_error());
+  EXPECT_EQ(1, logger.find_info("Laplace draw 4000 / 4000"));
+  EXPECT_GT(interrupt.call_count(), 0);
+
+  ASSERT_EQ(4, sample.names_.size());
+  EXPECT_EQ("log_p__", sample.names_[0]);
+  EXPECT_EQ("log_g__", sample.names_[1]);
+  EXPECT_EQ("x", sample.names_[2]);
+  EXPECT_EQ("y", sample.names_[3]);
+  ASSERT_EQ(num_draws, sample.states_.size());
+
+  // The covariance is the inverse of [[802, -400], [-400, 200]]
+  Eigen::MatrixXd draws(num_draws, 2);
+  for (int n = 0; n < num_draws; ++n) {
+    ASSERT_EQ(4, sample.states_[n].size());
+    EXPECT_LE(sample.states_[n][1], 0);
+    draws(n, 0) = sample.states_[n][2];
+    draws(n, 1) = sample.states_[n][3];
+  }
+  Eigen::RowVectorXd mean = draws.colwise().mean();
+  Eigen::MatrixXd centered = draws.rowwise() - mean;
+  Eigen::MatrixXd cov = centered.transpose() * centered / (num_draws - 1);
+  EXPECT_NEAR(1, mean(0), 0.05);
+  EXPECT_NEAR(1, mean(1), 0.1);
+  EXPECT_NEAR(0.5, cov(0, 0), 0.05);
+  EXPECT_NEAR(1, cov(0, 1), 0.1);
+  EXPECT_NEAR(2.005, cov(1, 1), 0.2);
+}
+
+TEST_F(ServicesOptimizeLaplaceSample, reproducible) {
+  stan::io::array_var_context mode_context = mode(1, 1);
+  std::stringstream other_ss;
+  values other(other_ss);
+  stan::services::optimize::laplace_sample(model, mode_context, 300, 3, 1, 0,
+                                           interrupt, logger, sample);
+  stan::services::optimize::laplace_sample(model, mode_context, 300, 3, 1, 0,
+                                           interrupt, logger, other);
+  EXPECT_EQ(sample.states_, other.states_);
+}
+
+TEST_F(ServicesOptimizeLaplaceSample, not_negative_definite) {
+  stan::io::array_var_context mode_context = mode(0, 1);
+  int return_code = stan::services::optimize::laplace_sample(
+      model, mode_context, 100, 0, 1, 0, interrupt, logger, sample);
+
+  EXPECT_EQ(stan::services::error_codes::DATAERR, return_code);
+  EXPECT_EQ(1, logger.find_error("not negative definite"));
+  EXPECT_EQ(0, sample.states_.size());
+}
@@ -1,9 +1,13 @@
 #include <stan/services/optimize/lbfgs.hpp>
 #include <gtest/gtest.h>
+#include <stan/io/array_var_context.hpp>
 #include <stan/io/empty_var_context.hpp>
 #include <test/test-models/good/optimization/rosenbrock.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
 #include <stan/callbacks/stream_writer.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 struct mock_callback : public stan::callbacks::interrupt {
   int n;
@@ -89,3 +93,107 @@ TEST_F(ServicesOptimizeLbfgs, rosenbrock) {
   EXPECT_FLOAT_EQ(return_code, 0);
   EXPECT_EQ(22, callback.n);
 }
+
+TEST_F(ServicesOptimizeLbfgs, rosenbrock_trace) {
+  unsigned int seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+
+  int save_every = 5;
+  int refresh = 0;
+  mock_callback callback;
+  std::stringstream trace_ss;
+  values trace(trace_ss);
+
+  int return_code = stan::services::optimize::lbfgs(
+      model, context, seed, chain, init_radius, 5, 0.001, 1e-12, 10000, 1e-8,
+      10000000, 1e-8, 2000, save_every, refresh, callback, logger, init,
+      parameter, trace);
+  EXPECT_EQ(0, return_code);
+
+  ASSERT_EQ(6, trace.names_.size());
+  EXPECT_EQ("iter__", trace.names_[0]);
+  EXPECT_EQ("lp__", trace.names_[1]);
+  EXPECT_EQ("grad_norm__", trace.names_[2]);
+  EXPECT_EQ("evals__", trace.names_[5]);
+  ASSERT_EQ(23, trace.states_.size());
+  for (size_t i = 0; i < trace.states_.size(); ++i)
+    EXPECT_FLOAT_EQ(i, trace.states_[i][0]);
+  EXPECT_FLOAT_EQ(-1, trace.states_.front()[1]);
+
+  // Iterations 0, 5, 10, 15 and 20, then the optimum at 22
+  ASSERT_EQ(6, parameter.states_.size());
+  EXPECT_FLOAT_EQ(trace.states_[5][1], parameter.states_[1][0]);
+  EXPECT_FLOAT_EQ(trace.states_.back()[1], parameter.states_.back()[0]);
+  EXPECT_FLOAT_EQ(0.99998301, parameter.states_.back()[1]);
+  EXPECT_FLOAT_EQ(0.99996597, parameter.states_.back()[2]);
+}
+
+TEST_F(ServicesOptimizeLbfgs, rosenbrock_warm_start) {
+  mock_callback callback;
+  stan::callbacks::writer trace;
+  stan::optimization::LBFGSUpdate<> qn_history;
+
+  int return_code = stan::services::optimize::lbfgs(
+      model, context, 0, 1, 0, 5, 0.001, 1e-12, 10000, 1e-8, 10000000, 1e-8,
+      2000, 0, 0, callback, logger, init, parameter, trace, qn_history);
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(5, qn_history.history_size());
+  EXPECT_EQ(0, logger.find("Continuing from the previous L-BFGS history"));
+  ASSERT_EQ(1, parameter.states_.size());
+  int cold_iterations = callback.n;
+
+  std::vector<std::string> names = {"x", "y"};
+  std::vector<double> optimum = {parameter.states_[0][1],
+                                 parameter.states_[0][2]};
+  std::vector<std::vector<size_t> > dims(2);
+  stan::io::array_var_context optimum_context(names, optimum, dims);
+  callback.n = 0;
+  return_code = stan::services::optimize::lbfgs(
+      model, optimum_context, 0, 1, 0, 5, 0.001, 1e-12, 10000, 1e-8, 10000000,
+      1e-8, 2000, 0, 0, callback, logger, init, parameter, trace, qn_history);
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(1, logger.find("Continuing from the previous L-BFGS history"));
+  EXPECT_LT(callback.n, cold_iterations);
+  EXPECT_NEAR(1, parameter.states_.back()[1], 1e-3);
+  EXPECT_NEAR(1, parameter.states_.back()[2], 1e-3);
+}
+
+TEST_F(ServicesOptimizeLbfgs, rosenbrock_multistart) {
+  const size_t num_starts = 3;
+  std::vector<std::shared_ptr<stan::io::var_context>> inits;
+  std::vector<std::stringstream> init_streams(num_starts);
+  std::vector<stan::callbacks::stream_writer> init_writers;
+  std::vector<std::stringstream> parameter_streams(num_starts);
+  std::vector<values> parameter_writers;
+  for (size_t i = 0; i < num_starts; ++i) {
+    inits.push_back(std::make_shared<stan::io::empty_var_context>());
+    init_writers.emplace_back(init_streams[i]);
+    parameter_writers.emplace_back(parameter_streams[i]);
+  }
+  std::stringstream best_ss;
+  values best(best_ss);
+  mock_callback callback;
+
+  int return_code = stan::services::optimize::lbfgs(
+      model, num_starts, inits, 0, 1, 1.5, 5, 0.001, 1e-12, 10000, 1e-8,
+      10000000, 1e-8, 2000, 0, callback, logger, init_writers,
+      parameter_writers, best);
+
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(num_starts, logger.find("optimization terminated normally"));
+  EXPECT_EQ(1, logger.find("Best optimum found by start "));
+  for (size_t i = 0; i < num_starts; ++i) {
+    ASSERT_EQ(3, parameter_writers[i].names_.size());
+    ASSERT_EQ(1, parameter_writers[i].states_.size());
+    EXPECT_NEAR(1, parameter_writers[i].states_[0][1], 1e-3);
+    EXPECT_NEAR(1, parameter_writers[i].states_[0][2], 1e-3);
+  }
+  // the starts are initialized from different random streams
+  EXPECT_NE(init_streams[0].str(), init_streams[1].str());
+
+  ASSERT_EQ(3, best.names_.size());
+  ASSERT_EQ(1, best.states_.size());
+  for (size_t i = 0; i < num_starts; ++i)
+    EXPECT_LE(parameter_writers[i].states_[0][0], best.states_[0][0]);
+}
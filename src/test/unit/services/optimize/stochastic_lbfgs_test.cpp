@@ -0,0 +1,108 @@
+#include <stan/services/optimize/stochastic_lbfgs.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <string>
+#include <vector>
+
+// The test model treats its whole log density as a single row of data
+class rows_model : public stan_model {
+ public:
+  rows_model(stan::io::var_context& context, std::ostream* msgs)
+      : stan_model(context, 0, msgs) {}
+
+  size_t num_rows() const { return 1; }
+
+  template <bool propto, bool jacobian, typename T>
+  T log_prob_rows(Eigen::Matrix<T, -1, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* msgs = 0) const {
+    return this->template log_prob<propto, jacobian>(params_r, msgs);
+  }
+};
+
+class ServicesOptimizeStochasticLbfgs : public testing::Test {
+ public:
+  ServicesOptimizeStochasticLbfgs() : model(context, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_writer init, parameter;
+  stan::test::unit::instrumented_logger logger;
+  stan::io::empty_var_context context;
+  stan::test::unit::instrumented_interrupt interrupt;
+  rows_model model;
+};
+
+TEST_F(ServicesOptimizeStochasticLbfgs, polish) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 2;
+  int history_size = 5;
+  int batch_size = 1;
+  double overlap = 0;
+  double step_size = 0.5;
+  double max_epochs = 10;
+  int polish_iterations = 100;
+  bool save_iterations = false;
+  int refresh = 0;
+
+  int return_code = stan::services::optimize::stochastic_lbfgs(
+      model, context, random_seed, chain, init_radius, history_size,
+      batch_size, overlap, step_size, max_epochs, polish_iterations,
+      save_iterations, refresh, interrupt, logger, init, parameter);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(1, logger.find_info("batches of 1 of 1 rows"));
+  EXPECT_EQ(1, logger.find_info("made 10 passes through the data"));
+  EXPECT_EQ(1, logger.find_info("Polishing on all rows"));
+  EXPECT_EQ(1, logger.find_info("Optimization terminated normally"));
+
+  // one row per batch: 9 iterations after the first batch, then polishing
+  EXPECT_LT(9, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(1, parameter.call_count("vector_double"));
+
+  std::vector<std::string> names = parameter.vector_string_values()[0];
+  ASSERT_EQ(6, names.size());
+  EXPECT_EQ("lp__", names[0]);
+  EXPECT_EQ("y.1", names[1]);
+  EXPECT_EQ("y.2", names[2]);
+
+  // the mode of y ~ normal(0, 1) without the Jacobian is at zero
+  std::vector<double> optimum = parameter.vector_double_values()[0];
+  EXPECT_NEAR(0, optimum[1], 1e-3);
+  EXPECT_NEAR(0, optimum[2], 1e-3);
+}
+
+TEST_F(ServicesOptimizeStochasticLbfgs, save_iterations_without_polish) {
+  int return_code = stan::services::optimize::stochastic_lbfgs(
+      model, context, 0, 1, 2, 5, 1, 0, 0.5, 4, 0, true, 0, interrupt, logger,
+      init, parameter);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(0, logger.find_info("Polishing"));
+
+  // the initial point, then the point after each of the 3 iterations
+  EXPECT_EQ(3, interrupt.call_count());
+  EXPECT_EQ(4, parameter.call_count("vector_double"));
+}
+
+TEST_F(ServicesOptimizeStochasticLbfgs, bad_arguments) {
+  int return_code = stan::services::optimize::stochastic_lbfgs(
+      model, context, 0, 1, 2, 5, 0, 0, 0.5, 4, 0, false, 0, interrupt, logger,
+      init, parameter);
+  EXPECT_EQ(stan::services::error_codes::USAGE, return_code);
+  EXPECT_EQ(1, logger.find_error("batch size"));
+
+  return_code = stan::services::optimize::stochastic_lbfgs(
+      model, context, 0, 1, 2, 5, 1, 1, 0.5, 4, 0, false, 0, interrupt, logger,
+      init, parameter);
+  EXPECT_EQ(stan::services::error_codes::CONFIG, return_code);
+  EXPECT_EQ(1, logger.find_error("overlap"));
+
+  return_code = stan::services::optimize::stochastic_lbfgs(
+      model, context, 0, 1, 2, 5, 1, 0, 0, 4, 0, false, 0, interrupt, logger,
+      init, parameter);
+  EXPECT_EQ(stan::services::error_codes::CONFIG, return_code);
+  EXPECT_EQ(1, logger.find_error("step size"));
+  EXPECT_EQ(0, parameter.call_count());
+}
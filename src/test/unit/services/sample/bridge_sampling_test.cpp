@@ -0,0 +1,70 @@
+#include <stan/services/sample/bridge_sampling.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <cmath>
+
+class ServicesBridgeSampling : public ::testing::Test {
+ public:
+  ServicesBridgeSampling() : model(context, 0, &model_log), draws(4000, 2) {
+    // Exact draws of y ~ normal(0, 1), restricted to (-10, 10), on the
+    // unconstrained scale
+    boost::ecuyer1988 rng(1234);
+    boost::random::normal_distribution<double> normal;
+    for (int n = 0; n < draws.rows(); ++n)
+      for (int i = 0; i < 2; ++i) {
+        double u = (normal(rng) + 10) / 20;
+        draws(n, i) = std::log(u / (1 - u));
+      }
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  Eigen::MatrixXd draws;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesBridgeSampling, normalized_model) {
+  // The density of y is normalized up to its negligible mass outside
+  // (-10, 10), so the log marginal likelihood is zero
+  stan::analyze::bridge_sampling_estimate estimate;
+  int return_code = stan::services::bridge_sampling(
+      model, draws, 0, 3, 1, 2, interrupt, logger, estimate);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(4000, interrupt.call_count());
+  EXPECT_TRUE(estimate.converged);
+  EXPECT_LT(estimate.relative_error, 0.05);
+  EXPECT_NEAR(0, estimate.log_marginal_likelihood,
+              4 * estimate.relative_error);
+  EXPECT_EQ(1, logger.find_info("Log marginal likelihood"));
+
+  // More proposal draws, another seed, the same answer
+  stan::analyze::bridge_sampling_estimate more;
+  return_code = stan::services::bridge_sampling(
+      model, draws, 8000, 4, 1, 2, interrupt, logger, more);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_NEAR(estimate.log_marginal_likelihood,
+              more.log_marginal_likelihood, 4 * estimate.relative_error);
+}
+
+TEST_F(ServicesBridgeSampling, rejects_bad_draws) {
+  stan::analyze::bridge_sampling_estimate estimate;
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            stan::services::bridge_sampling(model, draws.leftCols(1), 0, 3, 1,
+                                            2, interrupt, logger, estimate));
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            stan::services::bridge_sampling(model, draws.topRows(4), 0, 3, 1,
+                                            2, interrupt, logger, estimate));
+  Eigen::MatrixXd singular = draws;
+  singular.col(1) = singular.col(0);
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            stan::services::bridge_sampling(model, singular, 0, 3, 1, 2,
+                                            interrupt, logger, estimate));
+  EXPECT_EQ(3, logger.call_count_error());
+  EXPECT_TRUE(std::isnan(estimate.log_marginal_likelihood));
+}
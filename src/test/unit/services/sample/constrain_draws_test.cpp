@@ -0,0 +1,76 @@
+#include <stan/services/sample/constrain_draws.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <string>
+#include <vector>
+
+class ServicesConstrainDraws : public ::testing::Test {
+ public:
+  ServicesConstrainDraws() : model(context, 0, &model_log) {
+    draws.header = {"lp__", "accept_stat__", "draw__", "y.1", "y.2"};
+    draws.samples.resize(4, 5);
+    for (int n = 0; n < 4; ++n)
+      draws.samples.row(n) << 0, 1, n, 0.5 * n, -1.5 + n;
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  stan::io::stan_csv draws;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer writer;
+};
+
+TEST_F(ServicesConstrainDraws, subset) {
+  unsigned int seed = 3;
+  unsigned int chain = 2;
+  std::vector<size_t> rows{3, 1};
+  int return_code = stan::services::constrain_draws(
+      model, draws, rows, true, seed, chain, interrupt, logger, writer);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(2, interrupt.call_count());
+
+  std::vector<std::string> names = writer.vector_string_values()[0];
+  std::vector<std::string> expected_names{"draw__"};
+  model.constrained_param_names(expected_names, true, true);
+  EXPECT_EQ(expected_names, names);
+
+  // Every draw is constrained with its own generator, as it would be
+  // with all the others
+  boost::ecuyer1988 rng = stan::services::util::create_rng(seed, chain);
+  std::vector<std::vector<double>> values = writer.vector_double_values();
+  ASSERT_EQ(2U, values.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    Eigen::VectorXd params_r = draws.samples.row(rows[i]).tail(2);
+    Eigen::VectorXd expected;
+    boost::ecuyer1988 draw_rng
+        = stan::services::util::create_draw_rng(rng, rows[i]);
+    model.write_array(draw_rng, params_r, expected, true, true, &model_log);
+    ASSERT_EQ(expected.size() + 1, values[i].size());
+    EXPECT_FLOAT_EQ(rows[i], values[i][0]);
+    for (int j = 0; j < expected.size(); ++j)
+      EXPECT_FLOAT_EQ(expected(j), values[i][j + 1]);
+  }
+}
+
+TEST_F(ServicesConstrainDraws, all_draws) {
+  int return_code = stan::services::constrain_draws(
+      model, draws, {}, false, 0, 1, interrupt, logger, writer);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(4U, writer.vector_double_values().size());
+}
+
+TEST_F(ServicesConstrainDraws, bad_draws) {
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            stan::services::constrain_draws(model, draws, {4}, true, 0, 1,
+                                            interrupt, logger, writer));
+
+  draws.header[2] = "stepsize__";
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            stan::services::constrain_draws(model, draws, {}, true, 0, 1,
+                                            interrupt, logger, writer));
+  EXPECT_EQ(0U, writer.vector_double_values().size());
+}
@@ -150,3 +150,31 @@ TEST_F(ServicesSamplesFixedParam, output_regression) {
 
   EXPECT_EQ(0, init_values.size());
 }
+
+TEST_F(ServicesSamplesFixedParam, batched_matches_across_batch_sizes) {
+  unsigned int seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_iterations = 10;
+  int num_thin = 3;
+
+  int refresh = 0;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::services::sample::fixed_param(
+      model, context, seed, chain, init_radius, num_iterations, num_thin,
+      refresh, interrupt, logger, init, parameter, diagnostic, 4);
+  EXPECT_EQ(num_iterations, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(4, parameter.call_count("vector_double"));
+  EXPECT_EQ(4, diagnostic.call_count("vector_double"));
+
+  stan::test::unit::instrumented_writer parameter_1, diagnostic_1;
+  stan::services::sample::fixed_param(
+      model, context, seed, chain, init_radius, num_iterations, num_thin,
+      refresh, interrupt, logger, init, parameter_1, diagnostic_1, 1);
+  EXPECT_EQ(parameter.vector_string_values(),
+            parameter_1.vector_string_values());
+  EXPECT_EQ(parameter.vector_double_values(),
+            parameter_1.vector_double_values());
+  EXPECT_EQ(0, logger.call_count_error());
+}
@@ -0,0 +1,65 @@
+#include <stan/services/sample/hmc_nuts_diag_e_adapt_forked.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <iostream>
+
+class ServicesSampleHmcNutsDiagEAdaptForked : public testing::Test {
+ public:
+  ServicesSampleHmcNutsDiagEAdaptForked()
+      : num_warmup_chains(2), num_chains(5), model(context, 0, &model_log) {
+    for (int w = 0; w < num_warmup_chains; ++w) {
+      init.push_back(stan::test::unit::instrumented_writer{});
+      contexts.push_back(&context);
+    }
+    for (int k = 0; k < num_chains; ++k) {
+      parameter.push_back(stan::test::unit::instrumented_writer{});
+      diagnostic.push_back(stan::test::unit::instrumented_writer{});
+    }
+  }
+
+  int num_warmup_chains;
+  int num_chains;
+  std::stringstream model_log;
+  stan::test::unit::instrumented_logger logger;
+  std::vector<stan::test::unit::instrumented_writer> init;
+  std::vector<stan::test::unit::instrumented_writer> parameter;
+  std::vector<stan::test::unit::instrumented_writer> diagnostic;
+  stan::io::empty_var_context context;
+  std::vector<stan::io::var_context*> contexts;
+  stan_model model;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagEAdaptForked, call_count) {
+  int num_warmup = 200;
+  int num_samples = 100;
+  stan::callbacks::interrupt interrupt;
+
+  int return_code = stan::services::sample::hmc_nuts_diag_e_adapt_forked(
+      model, num_warmup_chains, num_chains, contexts, 0, 1, 0, num_warmup,
+      num_samples, 1, true, 0, 0.1, 0, 8, 0.8, 0.05, 0.75, 10, 50, 50, 100,
+      interrupt, logger, init, parameter, diagnostic);
+
+  EXPECT_EQ(0, return_code);
+  for (int k = 0; k < num_chains; ++k) {
+    // Only the chains that warmed up have warmup draws
+    int num_draws = num_samples + (k < num_warmup_chains ? num_warmup : 0);
+    EXPECT_EQ(1, parameter[k].call_count("vector_string"));
+    EXPECT_EQ(num_draws, parameter[k].call_count("vector_double"));
+    EXPECT_EQ(num_draws, diagnostic[k].call_count("vector_double"));
+  }
+  EXPECT_EQ(1, logger.find_info("Forking 5 sampling chains from 2"));
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEAdaptForked, too_many_warmup_chains) {
+  stan::test::unit::instrumented_interrupt interrupt;
+  int return_code = stan::services::sample::hmc_nuts_diag_e_adapt_forked(
+      model, num_chains + 1, num_chains, contexts, 0, 1, 0, 10, 10, 1, false,
+      0, 0.1, 0, 8, 0.8, 0.05, 0.75, 10, 5, 5, 10, interrupt, logger, init,
+      parameter, diagnostic);
+
+  EXPECT_EQ(stan::services::error_codes::CONFIG, return_code);
+  EXPECT_EQ(0, interrupt.call_count());
+  EXPECT_EQ(1, logger.call_count_error());
+}
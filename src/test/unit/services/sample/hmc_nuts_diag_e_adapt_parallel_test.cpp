@@ -0,0 +1,152 @@
+#include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <iostream>
+
+class ServicesSampleHmcNutsDiagEAdaptPar : public testing::Test {
+ public:
+  ServicesSampleHmcNutsDiagEAdaptPar()
+      : num_chains(4), model(context, 0, &model_log) {
+    for (int i = 0; i < num_chains; ++i) {
+      init.push_back(stan::test::unit::instrumented_writer{});
+      parameter.push_back(stan::test::unit::instrumented_writer{});
+      diagnostic.push_back(stan::test::unit::instrumented_writer{});
+      contexts.push_back(&context);
+    }
+  }
+
+  int num_chains;
+  std::stringstream model_log;
+  stan::callbacks::logger logger;
+  std::vector<stan::test::unit::instrumented_writer> init;
+  std::vector<stan::test::unit::instrumented_writer> parameter;
+  std::vector<stan::test::unit::instrumented_writer> diagnostic;
+  stan::io::empty_var_context context;
+  std::vector<stan::io::var_context*> contexts;
+  stan_model model;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagEAdaptPar, call_count) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  double stepsize = 0.1;
+  double stepsize_jitter = 0;
+  int max_depth = 8;
+  double delta = .1;
+  double gamma = .1;
+  double kappa = .1;
+  double t0 = .1;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 100;
+  stan::callbacks::interrupt interrupt;
+
+  int return_code = stan::services::sample::hmc_nuts_diag_e_adapt(
+      model, num_chains, contexts, random_seed, chain, init_radius,
+      num_warmup, num_samples, num_thin, save_warmup, refresh, stepsize,
+      stepsize_jitter, max_depth, delta, gamma, kappa, t0, init_buffer,
+      term_buffer, window, interrupt, logger, init, parameter, diagnostic);
+
+  EXPECT_EQ(0, return_code);
+
+  int num_output_lines = (num_warmup + num_samples) / num_thin;
+  for (int i = 0; i < num_chains; ++i) {
+    EXPECT_EQ(1, parameter[i].call_count("vector_string"));
+    EXPECT_EQ(num_output_lines, parameter[i].call_count("vector_double"));
+    EXPECT_EQ(1, diagnostic[i].call_count("vector_string"));
+    EXPECT_EQ(num_output_lines, diagnostic[i].call_count("vector_double"));
+  }
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEAdaptPar, matches_single_chain) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  double stepsize = 0.1;
+  double stepsize_jitter = 0;
+  int max_depth = 8;
+  double delta = .1;
+  double gamma = .1;
+  double kappa = .1;
+  double t0 = .1;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 100;
+  stan::callbacks::interrupt interrupt;
+
+  stan::services::sample::hmc_nuts_diag_e_adapt(
+      model, num_chains, contexts, random_seed, chain, init_radius,
+      num_warmup, num_samples, num_thin, save_warmup, refresh, stepsize,
+      stepsize_jitter, max_depth, delta, gamma, kappa, t0, init_buffer,
+      term_buffer, window, interrupt, logger, init, parameter, diagnostic);
+
+  // Chain i of the parallel run uses the same RNG stream as a single
+  // chain run with chain id (chain + i)
+  for (int i = 0; i < num_chains; ++i) {
+    stan::test::unit::instrumented_writer single_init, single_parameter,
+        single_diagnostic;
+    stan::services::sample::hmc_nuts_diag_e_adapt(
+        model, context, random_seed, chain + i, init_radius, num_warmup,
+        num_samples, num_thin, save_warmup, refresh, stepsize,
+        stepsize_jitter, max_depth, delta, gamma, kappa, t0, init_buffer,
+        term_buffer, window, interrupt, logger, single_init,
+        single_parameter, single_diagnostic);
+
+    std::vector<std::vector<double> > parallel_values
+        = parameter[i].vector_double_values();
+    std::vector<std::vector<double> > single_values
+        = single_parameter.vector_double_values();
+    ASSERT_EQ(single_values.size(), parallel_values.size());
+    for (size_t n = 0; n < single_values.size(); ++n) {
+      ASSERT_EQ(single_values[n].size(), parallel_values[n].size());
+      for (size_t k = 0; k < single_values[n].size(); ++k)
+        EXPECT_FLOAT_EQ(single_values[n][k], parallel_values[n][k]);
+    }
+  }
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEAdaptPar, output_regression) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  double stepsize = 0.1;
+  double stepsize_jitter = 0;
+  int max_depth = 8;
+  double delta = .1;
+  double gamma = .1;
+  double kappa = .1;
+  double t0 = .1;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 100;
+  stan::callbacks::interrupt interrupt;
+
+  stan::services::sample::hmc_nuts_diag_e_adapt(
+      model, num_chains, contexts, random_seed, chain, init_radius,
+      num_warmup, num_samples, num_thin, save_warmup, refresh, stepsize,
+      stepsize_jitter, max_depth, delta, gamma, kappa, t0, init_buffer,
+      term_buffer, window, interrupt, logger, init, parameter, diagnostic);
+
+  for (auto&& param_writer : parameter) {
+    std::vector<std::string> param_str_values = param_writer.string_values();
+    EXPECT_EQ(param_str_values[0], "Adaptation terminated");
+  }
+}
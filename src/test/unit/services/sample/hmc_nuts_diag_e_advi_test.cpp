@@ -0,0 +1,50 @@
+#include <stan/services/sample/hmc_nuts_diag_e_advi.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/dump.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/error_codes.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+class ServicesSampleHmcNutsDiagEAdvi : public testing::Test {
+ public:
+  void SetUp() {
+    std::fstream data_stream(
+        "src/test/test-models/good/services/bernoulli.data.R",
+        std::fstream::in);
+    stan::io::dump data_var_context(data_stream);
+    data_stream.close();
+    model = new stan_model(data_var_context);
+  }
+
+  void TearDown() { delete model; }
+
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::io::empty_var_context context;
+  stan_model* model;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagEAdvi, short_warmup) {
+  int return_code = stan::services::sample::hmc_nuts_diag_e_advi(
+      *model, context, 4, 1, 2, 1, 100, 10000, 0.001, 1.0, true, 50, 100,
+      150, 100, 1, true, 0, 1, 0, 10, 0.8, 0.05, 0.75, 10, 25, 25, 50,
+      interrupt, logger, init, parameter, diagnostic);
+
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(1, logger.find_info("Running mean field ADVI"));
+  EXPECT_EQ(0u, logger.call_count_warn());
+  EXPECT_EQ(250, interrupt.call_count());
+  EXPECT_EQ(250, parameter.call_count("vector_double"));
+
+  // The sampler starts at the mean of the approximation, near
+  // logit(0.25) for the beta(3, 9) posterior
+  std::vector<std::vector<double>> inits = init.vector_double_values();
+  ASSERT_EQ(1u, inits.size());
+  ASSERT_EQ(1u, inits[0].size());
+  EXPECT_NEAR(std::log(1.0 / 3), inits[0][0], 0.5);
+}
@@ -0,0 +1,64 @@
+#include <stan/services/sample/hmc_nuts_diag_e_delayed_acceptance.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <algorithm>
+#include <iostream>
+
+class ServicesSampleHmcNutsDiagEDelayedAcceptance : public testing::Test {
+ public:
+  ServicesSampleHmcNutsDiagEDelayedAcceptance()
+      : model(context, 0, &model_log), surrogate(context, 0, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::io::empty_var_context context;
+  stan_model model;
+  stan_model surrogate;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagEDelayedAcceptance, call_count) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  double stepsize = 0.1;
+  double stepsize_jitter = 0;
+  int max_depth = 8;
+  double delta = .8;
+  double gamma = .05;
+  double kappa = .75;
+  double t0 = 10;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 100;
+  stan::test::unit::instrumented_interrupt interrupt;
+  EXPECT_EQ(interrupt.call_count(), 0);
+
+  int return_code
+      = stan::services::sample::hmc_nuts_diag_e_delayed_acceptance(
+          model, surrogate, context, random_seed, chain, init_radius,
+          num_warmup, num_samples, num_thin, save_warmup, refresh, stepsize,
+          stepsize_jitter, max_depth, delta, gamma, kappa, t0, init_buffer,
+          term_buffer, window, interrupt, logger, init, parameter,
+          diagnostic);
+
+  EXPECT_EQ(0, return_code);
+
+  int num_output_lines = (num_warmup + num_samples) / num_thin;
+  EXPECT_EQ(num_warmup + num_samples, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, parameter.call_count("vector_double"));
+  EXPECT_EQ(1, diagnostic.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, diagnostic.call_count("vector_double"));
+
+  std::vector<std::string> names = parameter.vector_string_values()[0];
+  EXPECT_NE(names.end(),
+            std::find(names.begin(), names.end(), "delayed_accept_stat__"));
+}
@@ -0,0 +1,81 @@
+#include <stan/services/sample/hmc_nuts_diag_e_session.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/array_var_context.hpp>
+#include <stan/io/dump.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/error_codes.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ServicesSampleHmcNutsDiagESession : public testing::Test {
+ public:
+  void SetUp() {
+    std::fstream data_stream(
+        "src/test/test-models/good/services/bernoulli.data.R",
+        std::fstream::in);
+    stan::io::dump data_var_context(data_stream);
+    data_stream.close();
+    session.reset(new stan::services::sample::hmc_nuts_diag_e_session<
+                  stan_model>(data_var_context, empty_init, 4, 1, 2, logger,
+                              init));
+  }
+
+  int sample(int num_warmup) {
+    return session->sample(num_warmup, 100, 1, false, 0, interrupt, logger,
+                           parameter, diagnostic);
+  }
+
+  stan::io::empty_var_context empty_init;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  std::unique_ptr<stan::services::sample::hmc_nuts_diag_e_session<stan_model>>
+      session;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagESession, keeps_adaptation_across_updates) {
+  EXPECT_FALSE(session->adapted());
+  EXPECT_EQ(stan::services::error_codes::OK, sample(200));
+  EXPECT_TRUE(session->adapted());
+  EXPECT_EQ(300, interrupt.call_count());
+  Eigen::VectorXd inv_metric = session->inv_metric();
+  EXPECT_NE(1.0, inv_metric(0));
+  std::vector<double> last_draw = session->last_draw();
+
+  // Twenty more observations, all successes
+  std::vector<int> values = {30, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  values.insert(values.end(), 20, 1);
+  stan::io::array_var_context update({"N", "y"}, values, {{}, {30}});
+  EXPECT_EQ(stan::services::error_codes::OK,
+            session->update_data(update, logger));
+  EXPECT_TRUE(session->adapted());
+  EXPECT_FLOAT_EQ(last_draw[0], session->last_draw()[0]);
+
+  // Only the step size is re-adapted
+  double stepsize = session->stepsize();
+  EXPECT_EQ(stan::services::error_codes::OK, sample(20));
+  EXPECT_EQ(420, interrupt.call_count());
+  EXPECT_FLOAT_EQ(inv_metric(0), session->inv_metric()(0));
+  EXPECT_NE(stepsize, session->stepsize());
+
+  // theta is pulled towards the new successes
+  std::vector<std::vector<double>> draws = parameter.vector_double_values();
+  double mean = 0;
+  for (size_t n = draws.size() - 100; n < draws.size(); ++n)
+    mean += draws[n].back() / 100;
+  EXPECT_GT(mean, 0.5);
+}
+
+TEST_F(ServicesSampleHmcNutsDiagESession, rejects_invalid_data) {
+  EXPECT_EQ(stan::services::error_codes::OK, sample(100));
+  std::vector<double> last_draw = session->last_draw();
+  stan::io::array_var_context update({"N"}, std::vector<int>{11}, {{}});
+  EXPECT_EQ(stan::services::error_codes::DATAERR,
+            session->update_data(update, logger));
+  EXPECT_EQ(last_draw, session->last_draw());
+  EXPECT_EQ(stan::services::error_codes::OK, sample(0));
+}
@@ -0,0 +1,90 @@
+#include <stan/services/sample/hmc_nuts_diag_e_warm_start.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/dump.hpp>
+#include <stan/io/stan_csv_reader.hpp>
+#include <stan/services/error_codes.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class ServicesSampleHmcNutsDiagEWarmStart : public testing::Test {
+ public:
+  void SetUp() {
+    std::fstream data_stream(
+        "src/test/test-models/good/services/bernoulli.data.R",
+        std::fstream::in);
+    stan::io::dump data_var_context(data_stream);
+    data_stream.close();
+    model = new stan_model(data_var_context);
+
+    std::ifstream csv_stream(
+        "src/test/test-models/good/services/bernoulli_fit.csv");
+    std::stringstream out;
+    previous = stan::io::stan_csv_reader::parse(csv_stream, &out);
+    csv_stream.close();
+  }
+
+  void TearDown() { delete model; }
+
+  int run(int num_warmup) {
+    return stan::services::sample::hmc_nuts_diag_e_warm_start(
+        *model, previous, 4, 1, num_warmup, 100, 1, true, 0, 0, 10, 0.8, 0.05,
+        0.75, 10, interrupt, logger, init, parameter, diagnostic);
+  }
+
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::io::stan_csv previous;
+  stan_model* model;
+};
+
+TEST_F(ServicesSampleHmcNutsDiagEWarmStart, starts_from_last_draw) {
+  EXPECT_EQ(stan::services::error_codes::OK, run(0));
+  EXPECT_EQ(100, interrupt.call_count());
+  EXPECT_EQ(100, parameter.call_count("vector_double"));
+
+  // theta is the only parameter, on the logit scale unconstrained
+  std::vector<std::vector<double>> inits = init.vector_double_values();
+  ASSERT_EQ(1u, inits.size());
+  ASSERT_EQ(1u, inits[0].size());
+  double theta = previous.samples(previous.samples.rows() - 1, 7);
+  EXPECT_FLOAT_EQ(std::log(theta / (1 - theta)), inits[0][0]);
+
+  // Without warmup the previous step size is kept
+  std::vector<std::vector<double>> draws = parameter.vector_double_values();
+  EXPECT_FLOAT_EQ(previous.adaptation.step_size, draws[0][2]);
+  EXPECT_FLOAT_EQ(previous.adaptation.step_size, draws.back()[2]);
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEWarmStart, readapts_stepsize) {
+  EXPECT_EQ(stan::services::error_codes::OK, run(50));
+  EXPECT_EQ(150, interrupt.call_count());
+  EXPECT_EQ(150, parameter.call_count("vector_double"));
+  EXPECT_EQ(0, logger.find_info("variance estimation"));
+  // The metric of the previous run is printed back unchanged
+  std::vector<std::string> messages = parameter.string_values();
+  EXPECT_NE(messages.end(), std::find(messages.begin(), messages.end(),
+                                      "Adaptation terminated"));
+  EXPECT_NE(messages.end(),
+            std::find(messages.begin(), messages.end(), "0.417768"));
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEWarmStart, rejects_mismatched_metric) {
+  previous.adaptation.metric.resize(1, 2);
+  previous.adaptation.metric << 1, 1;
+  EXPECT_EQ(stan::services::error_codes::CONFIG, run(50));
+  EXPECT_EQ(0, interrupt.call_count());
+  EXPECT_EQ(1, logger.call_count_error());
+}
+
+TEST_F(ServicesSampleHmcNutsDiagEWarmStart, rejects_missing_parameter) {
+  previous.header[7] = "phi";
+  EXPECT_EQ(stan::services::error_codes::CONFIG, run(50));
+  EXPECT_EQ(1, logger.find_error("theta"));
+}
@@ -0,0 +1,79 @@
+#include <stan/services/sample/hmc_nuts_sparse_e_adapt.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <iostream>
+
+class ServicesSampleHmcNutsSparseEAdapt : public testing::Test {
+ public:
+  ServicesSampleHmcNutsSparseEAdapt() : model(context, 0, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::io::empty_var_context context;
+  stan_model model;
+};
+
+TEST_F(ServicesSampleHmcNutsSparseEAdapt, call_count) {
+  unsigned int random_seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int num_warmup = 200;
+  int num_samples = 400;
+  int num_thin = 5;
+  bool save_warmup = true;
+  int refresh = 0;
+  double stepsize = 0.1;
+  double stepsize_jitter = 0;
+  int max_depth = 8;
+  double delta = .1;
+  double gamma = .1;
+  double kappa = .1;
+  double t0 = .1;
+  unsigned int init_buffer = 50;
+  unsigned int term_buffer = 50;
+  unsigned int window = 100;
+  Eigen::MatrixXd dense(2, 2);
+  dense << 1.0, 0.5, 0.5, 1.0;
+  Eigen::SparseMatrix<double> e_metric = dense.sparseView();
+  stan::test::unit::instrumented_interrupt interrupt;
+  EXPECT_EQ(interrupt.call_count(), 0);
+
+  int return_code = stan::services::sample::hmc_nuts_sparse_e_adapt(
+      model, context, e_metric, random_seed, chain, init_radius, num_warmup,
+      num_samples, num_thin, save_warmup, refresh, stepsize, stepsize_jitter,
+      max_depth, delta, gamma, kappa, t0, init_buffer, term_buffer, window,
+      interrupt, logger, init, parameter, diagnostic);
+
+  EXPECT_EQ(0, return_code);
+
+  int num_output_lines = (num_warmup + num_samples) / num_thin;
+  EXPECT_EQ(num_warmup + num_samples, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, parameter.call_count("vector_double"));
+  EXPECT_EQ(1, diagnostic.call_count("vector_string"));
+  EXPECT_EQ(num_output_lines, diagnostic.call_count("vector_double"));
+
+  std::vector<std::string> messages = parameter.string_values();
+  EXPECT_NE(messages.end(),
+            std::find(messages.begin(), messages.end(),
+                      "Sparse elements of mass matrix (row, column, value):"));
+  EXPECT_EQ(0, logger.call_count_error());
+}
+
+TEST_F(ServicesSampleHmcNutsSparseEAdapt, bad_metric) {
+  stan::test::unit::instrumented_interrupt interrupt;
+  Eigen::SparseMatrix<double> e_metric(3, 3);
+  e_metric.setIdentity();
+
+  int return_code = stan::services::sample::hmc_nuts_sparse_e_adapt(
+      model, context, e_metric, 0, 1, 0, 200, 400, 5, true, 0, 0.1, 0, 8,
+      .1, .1, .1, .1, 50, 50, 100, interrupt, logger, init, parameter,
+      diagnostic);
+
+  EXPECT_EQ(stan::services::error_codes::CONFIG, return_code);
+  EXPECT_EQ(1, logger.call_count_error());
+  EXPECT_EQ(0, parameter.call_count("vector_double"));
+}
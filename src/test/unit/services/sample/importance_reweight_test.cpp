@@ -0,0 +1,115 @@
+#include <stan/services/sample/importance_reweight.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/array_var_context.hpp>
+#include <stan/model/log_prob_propto.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <cmath>
+#include <string>
+#include <vector>
+
+class ServicesImportanceReweight : public ::testing::Test {
+ public:
+  ServicesImportanceReweight()
+      : old_data({"N", "y"}, std::vector<int>{10, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1},
+                 {{}, {10}}),
+        new_data({"N", "y"},
+                 std::vector<int>{11, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1},
+                 {{}, {11}}),
+        old_model(old_data, 0, &model_log),
+        new_model(new_data, 0, &model_log),
+        draws(200, 1),
+        log_prob(200) {
+    // Draws of logit(theta) around the posterior mode under the old data
+    for (int n = 0; n < 200; ++n) {
+      draws(n, 0) = -1.4 + 2.0 * (n - 100) / 100;
+      Eigen::VectorXd params_r = draws.row(n).transpose();
+      log_prob(n) = stan::model::log_prob_propto<true>(old_model, params_r,
+                                                       &model_log);
+    }
+  }
+
+  std::stringstream model_log;
+  stan::io::array_var_context old_data, new_data;
+  stan_model old_model, new_model;
+  Eigen::MatrixXd draws;
+  Eigen::VectorXd log_prob;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer writer;
+};
+
+TEST_F(ServicesImportanceReweight, weights) {
+  double khat;
+  int return_code = stan::services::importance_reweight(
+      new_model, draws, log_prob, 0, 3, 1, 2, interrupt, logger, writer,
+      khat);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_TRUE(std::isfinite(khat));
+  EXPECT_EQ(200, interrupt.call_count());
+
+  std::vector<std::string> names = writer.vector_string_values()[0];
+  std::vector<std::string> expected_names{"theta", "log_weight__"};
+  EXPECT_EQ(expected_names, names);
+
+  // The weights are normalized, and increase with theta as the new
+  // observation is a success
+  std::vector<std::vector<double>> values = writer.vector_double_values();
+  ASSERT_EQ(200U, values.size());
+  double total = 0;
+  for (size_t n = 0; n < values.size(); ++n) {
+    EXPECT_FLOAT_EQ(1 / (1 + std::exp(-draws(n, 0))), values[n][0]);
+    total += std::exp(values[n][1]);
+  }
+  EXPECT_NEAR(1, total, 1e-8);
+  EXPECT_GT(values[199][1], values[0][1]);
+}
+
+TEST_F(ServicesImportanceReweight, resample) {
+  double khat;
+  int return_code = stan::services::importance_reweight(
+      new_model, draws, log_prob, 50, 3, 1, 2, interrupt, logger, writer,
+      khat);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  std::vector<std::string> expected_names{"theta"};
+  EXPECT_EQ(expected_names, writer.vector_string_values()[0]);
+  std::vector<std::vector<double>> values = writer.vector_double_values();
+  ASSERT_EQ(50U, values.size());
+  for (size_t m = 1; m < values.size(); ++m)
+    EXPECT_LE(values[m - 1][0], values[m][0]);
+}
+
+TEST_F(ServicesImportanceReweight, mismatched_draws) {
+  double khat;
+  Eigen::MatrixXd two_params(200, 2);
+  int return_code = stan::services::importance_reweight(
+      new_model, two_params, log_prob, 0, 3, 1, 1, interrupt, logger, writer,
+      khat);
+  EXPECT_EQ(stan::services::error_codes::DATAERR, return_code);
+  EXPECT_EQ(1, logger.call_count_error());
+  EXPECT_EQ(0U, writer.vector_double_values().size());
+}
+
+TEST_F(ServicesImportanceReweight, stan_csv_constrained) {
+  stan::io::stan_csv previous;
+  previous.header = {"lp__", "accept_stat__", "theta"};
+  previous.samples.resize(200, 3);
+  for (int n = 0; n < 200; ++n)
+    previous.samples.row(n) << log_prob(n), 1, 1 / (1 + std::exp(-draws(n, 0)));
+  double khat;
+  double csv_khat;
+  stan::test::unit::instrumented_writer csv_writer;
+  stan::services::importance_reweight(new_model, draws, log_prob, 0, 3, 1, 1,
+                                      interrupt, logger, writer, khat);
+  int return_code = stan::services::importance_reweight(
+      new_model, previous, 0, 3, 1, 1, interrupt, logger, csv_writer,
+      csv_khat);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_FLOAT_EQ(khat, csv_khat);
+  std::vector<std::vector<double>> values = writer.vector_double_values();
+  std::vector<std::vector<double>> csv_values
+      = csv_writer.vector_double_values();
+  ASSERT_EQ(values.size(), csv_values.size());
+  for (size_t n = 0; n < values.size(); ++n)
+    EXPECT_NEAR(values[n][1], csv_values[n][1], 1e-8);
+}
@@ -0,0 +1,77 @@
+#define STAN_SERVICES_INSTANTIATE
+#include <stan/math/prim.hpp>
+#include <stan/services/sample/model_base_instantiations.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/util/create_unit_e_dense_inv_metric.hpp>
+#include <stan/services/util/create_unit_e_diag_inv_metric.hpp>
+#include <stan/services/util/profile_report.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <iostream>
+
+class ServicesSampleModelBaseInstantiations : public testing::Test {
+ public:
+  ServicesSampleModelBaseInstantiations() : model(context, 0, &model_log) {}
+
+  std::stringstream model_log;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init, parameter, diagnostic;
+  stan::io::empty_var_context context;
+  stan_model model;
+};
+
+TEST_F(ServicesSampleModelBaseInstantiations, hmc_nuts_diag_e_adapt) {
+  stan::model::model_base& base = model;
+  stan::io::dump metric
+      = stan::services::util::create_unit_e_diag_inv_metric(
+          base.num_params_r());
+  stan::test::unit::instrumented_interrupt interrupt;
+
+  int return_code = stan::services::sample::hmc_nuts_diag_e_adapt(
+      base, context, metric, 0, 1, 0, 100, 100, 1, false, 0, 1, 0, 10, 0.8,
+      0.05, 0.75, 10, 15, 5, 25, interrupt, logger, init, parameter,
+      diagnostic);
+
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(200, interrupt.call_count());
+  EXPECT_EQ(1, parameter.call_count("vector_string"));
+  EXPECT_EQ(100, parameter.call_count("vector_double"));
+}
+
+// Passes the run options, so that the call resolves to the instantiated
+// signature
+TEST_F(ServicesSampleModelBaseInstantiations, hmc_nuts_dense_e_adapt_options) {
+  stan::model::model_base& base = model;
+  stan::io::dump metric
+      = stan::services::util::create_unit_e_dense_inv_metric(
+          base.num_params_r());
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_writer profile_writer;
+  stan::math::profile_map profiles;
+  stan::services::util::profile_report report(profile_writer, profiles);
+  stan::services::util::run_options options;
+  options.profiles = &report;
+
+  int return_code = stan::services::sample::hmc_nuts_dense_e_adapt(
+      base, context, metric, 0, 1, 0, 100, 100, 1, false, 0, 1, 0, 10, 0.8,
+      0.05, 0.75, 10, 15, 5, 25, interrupt, logger, init, parameter,
+      diagnostic, options);
+
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(200, interrupt.call_count());
+  EXPECT_EQ(100, parameter.call_count("vector_double"));
+  EXPECT_EQ(1, profile_writer.call_count("vector_string"));
+}
+
+TEST_F(ServicesSampleModelBaseInstantiations, fixed_param) {
+  stan::model::model_base& base = model;
+  stan::test::unit::instrumented_interrupt interrupt;
+
+  int return_code = stan::services::sample::fixed_param(
+      base, context, 0, 1, 0, 10, 1, 0, interrupt, logger, init, parameter,
+      diagnostic);
+
+  EXPECT_EQ(0, return_code);
+  EXPECT_EQ(10, parameter.call_count("vector_double"));
+}
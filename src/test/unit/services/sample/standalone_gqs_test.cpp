@@ -87,3 +87,75 @@ TEST_F(ServicesStandaloneGQ, genDraws_bad) {
   EXPECT_EQ(count_matches("Wrong number of parameter values", logger_ss.str()),
             1);
 }
+
+TEST_F(ServicesStandaloneGQ, genDraws_stream_bernoulli) {
+  std::ifstream csv_stream(
+      "src/test/test-models/good/services/bernoulli_fit.csv");
+  std::stringstream sample_ss;
+  stan::callbacks::stream_writer sample_writer(sample_ss, "");
+  int return_code = stan::services::standalone_generate(
+      *model, csv_stream, 12345, interrupt, logger, sample_writer, 64);
+  EXPECT_EQ(return_code, stan::services::error_codes::OK);
+  EXPECT_EQ(count_matches("mu", sample_ss.str()), 1);
+  EXPECT_EQ(count_matches("y_rep", sample_ss.str()), 10);
+  EXPECT_EQ(count_matches("\n", sample_ss.str()), 1001);
+  EXPECT_EQ(interrupt.call_count(), 1000);
+}
+
+TEST_F(ServicesStandaloneGQ, genDraws_stream_batch_size) {
+  std::vector<std::string> outputs;
+  for (size_t batch_size : {1, 7, 1000}) {
+    std::ifstream csv_stream(
+        "src/test/test-models/good/services/bernoulli_fit.csv");
+    std::stringstream sample_ss;
+    stan::callbacks::stream_writer sample_writer(sample_ss, "");
+    int return_code = stan::services::standalone_generate(
+        *model, csv_stream, 12345, interrupt, logger, sample_writer,
+        batch_size);
+    EXPECT_EQ(return_code, stan::services::error_codes::OK);
+    outputs.push_back(sample_ss.str());
+  }
+  EXPECT_EQ(outputs[0], outputs[1]);
+  EXPECT_EQ(outputs[0], outputs[2]);
+}
+
+TEST_F(ServicesStandaloneGQ, genDraws_stream_bad) {
+  std::stringstream missing("lp__,mu\n0,0.5\n");
+  std::stringstream sample_ss;
+  stan::callbacks::stream_writer sample_writer(sample_ss, "");
+  int return_code = stan::services::standalone_generate(
+      *model, missing, 12345, interrupt, logger, sample_writer);
+  EXPECT_EQ(return_code, stan::services::error_codes::DATAERR);
+  EXPECT_EQ(count_matches("missing column theta", logger_ss.str()), 1);
+
+  std::stringstream empty("lp__,theta\n");
+  return_code = stan::services::standalone_generate(
+      *model, empty, 12345, interrupt, logger, sample_writer);
+  EXPECT_EQ(return_code, stan::services::error_codes::DATAERR);
+  EXPECT_EQ(count_matches("Empty set of draws", logger_ss.str()), 1);
+}
+
+TEST_F(ServicesStandaloneGQ, genDraws_parallel_bernoulli) {
+  std::ifstream csv_stream(
+      "src/test/test-models/good/services/bernoulli_fit.csv");
+  std::stringstream stream_ss;
+  stan::callbacks::stream_writer stream_writer(stream_ss, "");
+  EXPECT_EQ(stan::services::standalone_generate(
+                *model, csv_stream, 12345, interrupt, logger, stream_writer),
+            stan::services::error_codes::OK);
+  csv_stream.clear();
+  csv_stream.seekg(0);
+  std::stringstream out;
+  stan::io::stan_csv bern_csv = stan::io::stan_csv_reader::parse(csv_stream,
+                                                                 &out);
+
+  for (size_t batch_size : {1, 64, 5000}) {
+    std::stringstream sample_ss;
+    stan::callbacks::stream_writer sample_writer(sample_ss, "");
+    int return_code = stan::services::standalone_generate_parallel(
+        *model, bern_csv.samples.middleCols<1>(7), 12345, interrupt, logger,
+        sample_writer, batch_size);
+    EXPECT_EQ(return_code, stan::services::error_codes::OK);
+    EXPECT_EQ(stream_ss.str(), sample_ss.str());
+  }
+}
@@ -0,0 +1,85 @@
+#include <stan/services/util/advi_init.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/dump.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+class ServicesUtilAdviInit : public testing::Test {
+ public:
+  ServicesUtilAdviInit() : rng(stan::services::util::create_rng(0, 1)) {}
+
+  void SetUp() {
+    std::fstream data_stream(
+        "src/test/test-models/good/services/bernoulli.data.R",
+        std::fstream::in);
+    stan::io::dump data_var_context(data_stream);
+    data_stream.close();
+    model = new stan_model(data_var_context);
+  }
+
+  void TearDown() { delete model; }
+
+  stan_model* model;
+  stan::io::empty_var_context empty_context;
+  stan::test::unit::instrumented_logger logger;
+  boost::ecuyer1988 rng;
+};
+
+TEST_F(ServicesUtilAdviInit, meanfield) {
+  stan::variational::normal_meanfield variational(1);
+  ASSERT_TRUE(stan::services::util::advi_init(*model, empty_context, rng, 2,
+                                              1, 100, 10000, 0.001, 1.0,
+                                              true, 50, 100, logger,
+                                              variational));
+
+  // The posterior is beta(3, 9), whose mean on the logit scale is near
+  // logit(0.25) with a variance near 1 / (12 * 0.25 * 0.75)
+  EXPECT_NEAR(std::log(1.0 / 3), variational.mu()(0), 0.5);
+
+  stan::io::array_var_context init
+      = stan::services::util::advi_init_context(*model, variational.mean(),
+                                                rng);
+  std::vector<double> theta = init.vals_r("theta");
+  ASSERT_EQ(1u, theta.size());
+  EXPECT_FLOAT_EQ(1 / (1 + std::exp(-variational.mu()(0))), theta[0]);
+
+  stan::io::array_var_context inv_metric
+      = stan::services::util::advi_inv_metric_context(variational);
+  std::vector<double> values = inv_metric.vals_r("inv_metric");
+  ASSERT_EQ(1u, values.size());
+  EXPECT_FLOAT_EQ(std::exp(2 * variational.omega()(0)), values[0]);
+  EXPECT_GT(values[0], 0.1);
+  EXPECT_LT(values[0], 2);
+}
+
+TEST_F(ServicesUtilAdviInit, fullrank_inv_metric) {
+  Eigen::VectorXd mu(2);
+  mu << 0, 0;
+  Eigen::MatrixXd L_chol(2, 2);
+  L_chol << 2, 0, 1, 3;
+  stan::variational::normal_fullrank variational(mu, L_chol);
+
+  stan::io::array_var_context dense
+      = stan::services::util::advi_inv_metric_context(variational, true);
+  std::vector<size_t> dims = dense.dims_r("inv_metric");
+  ASSERT_EQ(2u, dims.size());
+  std::vector<double> values = dense.vals_r("inv_metric");
+  ASSERT_EQ(4u, values.size());
+  EXPECT_FLOAT_EQ(4, values[0]);
+  EXPECT_FLOAT_EQ(2, values[1]);
+  EXPECT_FLOAT_EQ(2, values[2]);
+  EXPECT_FLOAT_EQ(10, values[3]);
+
+  stan::io::array_var_context diag
+      = stan::services::util::advi_inv_metric_context(variational, false);
+  EXPECT_EQ(1u, diag.dims_r("inv_metric").size());
+  values = diag.vals_r("inv_metric");
+  ASSERT_EQ(2u, values.size());
+  EXPECT_FLOAT_EQ(4, values[0]);
+  EXPECT_FLOAT_EQ(10, values[1]);
+}
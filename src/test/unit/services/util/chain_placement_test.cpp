@@ -0,0 +1,70 @@
+#include <stan/services/util/chain_placement.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+TEST(ServicesUtilChainPlacement, parse_cpu_list) {
+  using stan::services::util::chain_placement;
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}),
+            chain_placement::parse_cpu_list("0-3,8,10-11\n"));
+  EXPECT_EQ(std::vector<int>({5}), chain_placement::parse_cpu_list("5"));
+  EXPECT_TRUE(chain_placement::parse_cpu_list("").empty());
+}
+
+TEST(ServicesUtilChainPlacement, slots) {
+  stan::services::util::chain_placement placement({{0, 1}, {2, 3}});
+  EXPECT_EQ(2U, placement.num_slots());
+  EXPECT_EQ(0U, placement.slot(0));
+  EXPECT_EQ(1U, placement.slot(1));
+  EXPECT_EQ(0U, placement.slot(4));
+  EXPECT_EQ(std::vector<int>({2, 3}), placement.cpus(3));
+
+  stan::test::unit::instrumented_logger logger;
+  placement.log(5, logger);
+  EXPECT_EQ(1, logger.find_info("Placing 5 chains on 2 sets of CPUs"));
+}
+
+TEST(ServicesUtilChainPlacement, policies) {
+  using stan::services::util::chain_placement;
+  chain_placement none(chain_placement::NONE);
+  EXPECT_EQ(1U, none.num_slots());
+  EXPECT_FALSE(none.pinned());
+  chain_placement::scope unpinned(&none, 0);
+  EXPECT_FALSE(unpinned.active());
+  chain_placement::scope null(nullptr, 0);
+  EXPECT_FALSE(null.active());
+
+  chain_placement nodes(chain_placement::NUMA_NODES);
+  EXPECT_GE(nodes.num_slots(), 1U);
+#ifdef __linux__
+  chain_placement cores(chain_placement::CORES);
+  EXPECT_EQ(none.cpus(0).size(), cores.num_slots());
+  EXPECT_EQ(1U, cores.cpus(0).size());
+#endif
+}
+
+#ifdef __linux__
+TEST(ServicesUtilChainPlacement, scope_pins_thread) {
+  using stan::services::util::chain_placement;
+  chain_placement cores(chain_placement::CORES);
+  ASSERT_GE(cores.num_slots(), 1U);
+  int cpu = cores.cpus(cores.num_slots() - 1)[0];
+  cpu_set_t before;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(before), &before));
+  {
+    chain_placement::scope pin(&cores, cores.num_slots() - 1);
+    EXPECT_TRUE(pin.active());
+    cpu_set_t set;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+    EXPECT_EQ(1, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(cpu, &set));
+  }
+  cpu_set_t after;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(after), &after));
+  EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+#endif
@@ -0,0 +1,242 @@
+#include <stan/services/util/checkpoint.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/mcmc/hmc/nuts/diag_e_nuts.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <stan/services/util/run_sampler.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef stan::mcmc::adapt_diag_e_nuts<stan_model, boost::ecuyer1988>
+    adaptive_sampler;
+
+// Stops the run after a given number of iterations, as a crash would
+class stopping_interrupt : public stan::callbacks::interrupt {
+ public:
+  explicit stopping_interrupt(int num_iterations)
+      : num_iterations_(num_iterations) {}
+
+  void operator()() {
+    if (num_iterations_-- == 0)
+      throw std::runtime_error("stopped");
+  }
+
+ private:
+  int num_iterations_;
+};
+
+// Keeps the last checkpoint only
+class last_writer : public stan::callbacks::writer {
+ public:
+  last_writer() : count(0) {}
+
+  void operator()(const std::string& message) {
+    last = message;
+    ++count;
+  }
+
+  std::string last;
+  int count;
+};
+
+void configure(adaptive_sampler& sampler,
+               stan::test::unit::instrumented_logger& logger) {
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_max_depth(6);
+  sampler.get_stepsize_adaptation().set_mu(log(10 * 0.1));
+  sampler.get_stepsize_adaptation().set_delta(0.8);
+  sampler.get_stepsize_adaptation().set_gamma(0.05);
+  sampler.get_stepsize_adaptation().set_kappa(0.75);
+  sampler.get_stepsize_adaptation().set_t0(10);
+  sampler.set_window_params(100, 15, 25, 20, logger);
+}
+
+}  // namespace
+
+class ServicesUtilCheckpoint : public testing::Test {
+ public:
+  ServicesUtilCheckpoint()
+      : model(context, 0, &model_log),
+        num_warmup(100),
+        num_samples(80),
+        cont_vector{0.5, -0.5} {}
+
+  // Run a complete chain, resuming from a checkpoint if one is given,
+  // and return its draws
+  std::vector<std::vector<double>> run_adaptive(
+      stan::services::util::checkpoint* checkpoint,
+      stan::callbacks::interrupt& interrupt, unsigned int seed = 3) {
+    boost::ecuyer1988 rng = stan::services::util::create_rng(seed, 1);
+    adaptive_sampler sampler(model, rng);
+    configure(sampler, logger);
+    stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+    std::vector<double> cont = cont_vector;
+    stan::services::util::run_options options;
+    options.checkpoints = checkpoint;
+    try {
+      stan::services::util::run_adaptive_sampler(
+          sampler, model, cont, num_warmup, num_samples, 1, 0, true, rng,
+          interrupt, logger, sample_writer, diagnostic_writer, 1, 1, options);
+    } catch (const std::runtime_error& e) {
+    }
+    return sample_writer.vector_double_values();
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  int num_warmup, num_samples;
+  std::vector<double> cont_vector;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesUtilCheckpoint, resume_during_warmup_matches) {
+  stan::callbacks::interrupt interrupt;
+  std::vector<std::vector<double>> expected = run_adaptive(nullptr, interrupt);
+  ASSERT_EQ(num_warmup + num_samples, expected.size());
+
+  last_writer saved;
+  stan::services::util::checkpoint writing(30, saved);
+  stopping_interrupt crash(75);
+  std::vector<std::vector<double>> before = run_adaptive(&writing, crash);
+  EXPECT_EQ(75u, before.size());
+  EXPECT_EQ(2, saved.count);
+  for (size_t i = 0; i < before.size(); ++i)
+    EXPECT_EQ(expected[i], before[i]);
+
+  // A different seed shows the generator is restored from the checkpoint
+  std::stringstream in(saved.last);
+  last_writer resaved;
+  stan::services::util::checkpoint resuming(30, resaved, in);
+  std::vector<std::vector<double>> after
+      = run_adaptive(&resuming, interrupt, 17);
+  ASSERT_EQ(expected.size() - 60, after.size());
+  for (size_t i = 0; i < after.size(); ++i)
+    EXPECT_EQ(expected[60 + i], after[i]);
+  EXPECT_EQ(3, resaved.count);
+}
+
+TEST_F(ServicesUtilCheckpoint, resume_after_warmup_matches) {
+  stan::callbacks::interrupt interrupt;
+  std::vector<std::vector<double>> expected = run_adaptive(nullptr, interrupt);
+
+  last_writer saved;
+  stan::services::util::checkpoint writing(50, saved);
+  stopping_interrupt crash(170);
+  run_adaptive(&writing, crash);
+  EXPECT_EQ(3, saved.count);
+
+  std::stringstream in(saved.last);
+  stan::services::util::checkpoint resuming(0, saved, in);
+  std::vector<std::vector<double>> after
+      = run_adaptive(&resuming, interrupt, 17);
+  ASSERT_EQ(expected.size() - 150, after.size());
+  for (size_t i = 0; i < after.size(); ++i)
+    EXPECT_EQ(expected[150 + i], after[i]);
+}
+
+TEST_F(ServicesUtilCheckpoint, run_sampler_resume_matches) {
+  stan::callbacks::interrupt interrupt;
+  auto run = [&](stan::services::util::checkpoint* checkpoint,
+                 stan::callbacks::interrupt& interrupt, unsigned int seed) {
+    boost::ecuyer1988 rng = stan::services::util::create_rng(seed, 1);
+    stan::mcmc::diag_e_nuts<stan_model, boost::ecuyer1988> sampler(model,
+                                                                   rng);
+    sampler.set_nominal_stepsize(0.2);
+    sampler.set_max_depth(5);
+    stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+    std::vector<double> cont = cont_vector;
+    stan::services::util::run_options options;
+    options.checkpoints = checkpoint;
+    try {
+      stan::services::util::run_sampler(
+          sampler, model, cont, 10, 50, 1, 0, false, rng, interrupt, logger,
+          sample_writer, diagnostic_writer, 1, 1, options);
+    } catch (const std::runtime_error& e) {
+    }
+    return sample_writer.vector_double_values();
+  };
+  std::vector<std::vector<double>> expected = run(nullptr, interrupt, 3);
+  ASSERT_EQ(50u, expected.size());
+
+  last_writer saved;
+  stan::services::util::checkpoint writing(20, saved);
+  stopping_interrupt crash(45);
+  run(&writing, crash, 3);
+
+  std::stringstream in(saved.last);
+  stan::services::util::checkpoint resuming(20, saved, in);
+  std::vector<std::vector<double>> after = run(&resuming, interrupt, 17);
+  ASSERT_EQ(20u, after.size());
+  for (size_t i = 0; i < after.size(); ++i)
+    EXPECT_EQ(expected[30 + i], after[i]);
+}
+
+TEST_F(ServicesUtilCheckpoint, rejects_other_runs) {
+  stan::callbacks::interrupt interrupt;
+  last_writer saved;
+  stan::services::util::checkpoint writing(40, saved);
+  run_adaptive(&writing, interrupt);
+  ASSERT_FALSE(saved.last.empty());
+
+  boost::ecuyer1988 rng = stan::services::util::create_rng(3, 1);
+  adaptive_sampler sampler(model, rng);
+  configure(sampler, logger);
+  stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+  std::stringstream in(saved.last);
+  stan::services::util::checkpoint resuming(40, saved, in);
+  stan::services::util::run_options options;
+  options.checkpoints = &resuming;
+  EXPECT_THROW(stan::services::util::run_adaptive_sampler(
+                   sampler, model, cont_vector, num_warmup, num_samples + 1,
+                   1, 0, true, rng, interrupt, logger, sample_writer,
+                   diagnostic_writer, 1, 1, options),
+               std::invalid_argument);
+  EXPECT_EQ(0u, sample_writer.call_count());
+
+  std::stringstream garbage("not a checkpoint");
+  stan::services::util::checkpoint bad(40, saved, garbage);
+  options.checkpoints = &bad;
+  EXPECT_THROW(stan::services::util::run_adaptive_sampler(
+                   sampler, model, cont_vector, num_warmup, num_samples, 1, 0,
+                   true, rng, interrupt, logger, sample_writer,
+                   diagnostic_writer, 1, 1, options),
+               std::invalid_argument);
+}
+
+TEST_F(ServicesUtilCheckpoint, rejects_previous_version) {
+  stan::callbacks::interrupt interrupt;
+  last_writer saved;
+  stan::services::util::checkpoint writing(40, saved);
+  run_adaptive(&writing, interrupt);
+  const std::string header = "stan_checkpoint\n2\n";
+  ASSERT_EQ(0u, saved.last.find(header));
+
+  // Version 1 didn't record the change of the averaged step size
+  boost::ecuyer1988 rng = stan::services::util::create_rng(3, 1);
+  adaptive_sampler sampler(model, rng);
+  configure(sampler, logger);
+  stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+  std::stringstream in("stan_checkpoint\n1\n"
+                       + saved.last.substr(header.size()));
+  stan::services::util::checkpoint resuming(40, saved, in);
+  stan::services::util::run_options options;
+  options.checkpoints = &resuming;
+  try {
+    stan::services::util::run_adaptive_sampler(
+        sampler, model, cont_vector, num_warmup, num_samples, 1, 0, true, rng,
+        interrupt, logger, sample_writer, diagnostic_writer, 1, 1, options);
+    FAIL() << "a version 1 checkpoint was read";
+  } catch (const std::invalid_argument& e) {
+    EXPECT_EQ(std::string("Checkpoint: unknown version"), e.what());
+  }
+  EXPECT_EQ(0u, sample_writer.call_count());
+}
@@ -0,0 +1,63 @@
+#include <stan/services/util/column_selection.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/empty_var_context.hpp>
+#include <test/test-models/good/services/test_lp.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST(ServicesUtilColumnSelection, matches) {
+  stan::services::util::column_selection selection(
+      {"theta", "z[2,1]", "sigma.*.2", "x*_gq"});
+  EXPECT_TRUE(selection.matches("theta"));
+  EXPECT_TRUE(selection.matches("theta.1"));
+  EXPECT_TRUE(selection.matches("theta.3.4"));
+  EXPECT_FALSE(selection.matches("theta_raw.1"));
+  EXPECT_FALSE(selection.matches("thet"));
+
+  EXPECT_TRUE(selection.matches("z.2.1"));
+  EXPECT_FALSE(selection.matches("z.2.2"));
+  EXPECT_FALSE(selection.matches("z.1"));
+
+  EXPECT_TRUE(selection.matches("sigma.1.2"));
+  EXPECT_TRUE(selection.matches("sigma.10.2"));
+  EXPECT_FALSE(selection.matches("sigma.1.1"));
+
+  EXPECT_TRUE(selection.matches("x_gq"));
+  EXPECT_TRUE(selection.matches("xy_gq.3"));
+  EXPECT_FALSE(selection.matches("x_gq2"));
+}
+
+TEST(ServicesUtilColumnSelection, apply) {
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model(context, 0, &model_log);
+
+  // y are parameters, z transformed parameters and xgq a generated
+  // quantity
+  stan::services::util::column_selection params({"y.2"});
+  params.apply(model);
+  EXPECT_FALSE(params.include_tparams());
+  EXPECT_FALSE(params.include_gqs());
+  EXPECT_EQ(2U, params.num_written());
+  ASSERT_EQ(1U, params.columns().size());
+  EXPECT_EQ(1U, params.columns()[0]);
+  EXPECT_EQ("y.2", params.names()[0]);
+
+  stan::services::util::column_selection gqs({"y", "xgq"});
+  gqs.apply(model);
+  EXPECT_FALSE(gqs.include_tparams());
+  EXPECT_TRUE(gqs.include_gqs());
+  EXPECT_EQ(3U, gqs.num_written());
+  ASSERT_EQ(3U, gqs.columns().size());
+  EXPECT_EQ(2U, gqs.columns()[2]);
+  EXPECT_EQ("xgq", gqs.names()[2]);
+
+  stan::services::util::column_selection tparams({"z[1]"});
+  tparams.apply(model);
+  EXPECT_TRUE(tparams.include_tparams());
+  EXPECT_FALSE(tparams.include_gqs());
+  EXPECT_EQ(4U, tparams.num_written());
+  ASSERT_EQ(1U, tparams.columns().size());
+  EXPECT_EQ(2U, tparams.columns()[0]);
+}
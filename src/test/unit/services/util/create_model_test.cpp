@@ -0,0 +1,86 @@
+#include <stan/services/util/create_model.hpp>
+#include <stan/io/dump.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct snapshot_model {
+  std::vector<double> sums_;
+  bool computed_;
+
+  snapshot_model(const stan::io::var_context& context, unsigned int seed,
+                 std::ostream* msgs)
+      : computed_(false) {
+    using stan::model::transformed_data_snapshot;
+    if (!context.contains_r("x"))
+      throw std::domain_error("x is missing");
+    if (msgs)
+      *msgs << "constructing" << std::endl;
+    if (!transformed_data_snapshot::load(context, seed, *this)) {
+      double sum = 0;
+      for (double x : context.vals_r("x"))
+        sums_.push_back(sum += x);
+      computed_ = true;
+      transformed_data_snapshot::save(context, seed, *this);
+    }
+  }
+
+  std::string model_name() const { return "snapshot_model"; }
+
+  bool write_transformed_data(stan::model::transformed_data_writer& w) const {
+    w.write("sums", sums_);
+    return true;
+  }
+
+  bool read_transformed_data(stan::model::transformed_data_reader& r) {
+    r.read("sums", sums_);
+    return true;
+  }
+};
+}  // namespace
+
+TEST(ServicesUtil, create_model_snapshot) {
+  std::string path = "create_model_test.bin";
+  std::remove(path.c_str());
+  std::stringstream in("x <- c(1, 2, 3)\n");
+  stan::io::dump context(in);
+
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::startup_timer startup(writer);
+  auto first = stan::services::util::create_model<snapshot_model>(
+      context, 3, path, logger, &startup);
+  EXPECT_TRUE(first->computed_);
+  EXPECT_EQ(1, logger.find_info("constructing"));
+  EXPECT_EQ(1, logger.find_info("Transformed data written to"));
+  ASSERT_EQ(1U, startup.phases().size());
+  EXPECT_EQ("model", startup.phases()[0].name);
+
+  auto second = stan::services::util::create_model<snapshot_model>(
+      context, 3, path, logger);
+  EXPECT_FALSE(second->computed_);
+  EXPECT_EQ(first->sums_, second->sums_);
+  EXPECT_EQ(1, logger.find_info("Transformed data read from"));
+
+  auto plain = stan::services::util::create_model<snapshot_model>(
+      context, 3, "", logger);
+  EXPECT_TRUE(plain->computed_);
+  EXPECT_EQ(3, logger.find_info("constructing"));
+  EXPECT_EQ(2, logger.find_info("Transformed data"));
+  std::remove(path.c_str());
+}
+
+TEST(ServicesUtil, create_model_throws) {
+  std::stringstream in("y <- 1\n");
+  stan::io::dump context(in);
+  stan::test::unit::instrumented_logger logger;
+  EXPECT_THROW(stan::services::util::create_model<snapshot_model>(
+                   context, 3, "create_model_throws.bin", logger),
+               std::domain_error);
+  EXPECT_EQ(0, logger.call_count());
+}
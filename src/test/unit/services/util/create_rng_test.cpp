@@ -28,3 +28,43 @@ TEST(rng, initialize_with_zero) {
   rng2();
   EXPECT_NE(rng1, rng2);
 }
+
+TEST(rng, philox_chains) {
+  using stan::util::philox4x32;
+  philox4x32 rng1 = stan::services::util::create_rng<philox4x32>(0, 1);
+  EXPECT_EQ(philox4x32(0, 1), rng1);
+  for (unsigned int n = 2; n < 20; n++) {
+    philox4x32 rng2 = stan::services::util::create_rng<philox4x32>(0, n);
+    EXPECT_NE(rng1, rng2);
+    EXPECT_NE(rng1(), rng2());
+  }
+}
+
+TEST(rng, create_draw_rng) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  boost::ecuyer1988 expected(rng);
+  expected.discard(static_cast<boost::uintmax_t>(3) << 24);
+  EXPECT_EQ(expected, stan::services::util::create_draw_rng(rng, 3));
+
+  using stan::util::philox4x32;
+  philox4x32 philox(5, 1);
+  philox();
+  EXPECT_EQ(philox4x32(5, 1, 1, 3),
+            stan::services::util::create_draw_rng(philox, 3));
+}
+
+TEST(rng, split_draw_rng) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  boost::ecuyer1988 expected(rng);
+  boost::ecuyer1988 draw_rng = stan::services::util::split_draw_rng(rng);
+  EXPECT_EQ(expected, draw_rng);
+  expected.discard(static_cast<boost::uintmax_t>(1) << 24);
+  EXPECT_EQ(expected, rng);
+
+  using stan::util::philox4x32;
+  philox4x32 philox(5, 1);
+  philox();
+  philox4x32 philox_expected(philox);
+  EXPECT_EQ(philox_expected, stan::services::util::split_draw_rng(philox));
+  EXPECT_EQ(philox_expected.position() + (1 << 24), philox.position());
+}
@@ -0,0 +1,90 @@
+#include <stan/services/util/efficiency_summary.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+// Reports 7 gradient evaluations per transition
+class mock_sampler : public stan::mcmc::base_mcmc {
+ public:
+  stan::mcmc::sample transition(stan::mcmc::sample& init_sample,
+                                stan::callbacks::logger& logger) {
+    return init_sample;
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    names.push_back("stepsize__");
+    names.push_back("n_leapfrog__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    values.push_back(0.5);
+    values.push_back(7);
+  }
+};
+}  // namespace
+
+TEST(ServicesUtilEfficiencySummary, summarizes_model_columns) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::efficiency_summary summary(writer);
+  summary.begin({"lp__", "accept_stat__", "stepsize__", "a", "b", "c"});
+
+  mock_sampler sampler;
+  boost::ecuyer1988 rng(1);
+  boost::variate_generator<boost::ecuyer1988&, boost::normal_distribution<>>
+      normal(rng, boost::normal_distribution<>());
+  double ar = 0;
+  for (int n = 0; n < 1000; ++n) {
+    ar = 0.9 * ar + normal();
+    summary.add_draw({normal(), 0.9, 0.5, normal(), ar, 1.0});
+    summary.record(sampler);
+  }
+  EXPECT_EQ(1000U, summary.num_draws());
+  EXPECT_FLOAT_EQ(7000, summary.num_gradients());
+
+  std::vector<stan::services::util::efficiency_summary::column> columns
+      = summary.columns(2.0);
+  ASSERT_EQ(4U, columns.size());
+  EXPECT_EQ("lp__", columns[0].name);
+  EXPECT_EQ("a", columns[1].name);
+  EXPECT_EQ("b", columns[2].name);
+  EXPECT_EQ("c", columns[3].name);
+  EXPECT_GT(columns[1].ess_bulk, 500);
+  EXPECT_LT(columns[2].ess_bulk, 200);
+  EXPECT_TRUE(std::isnan(columns[3].ess_bulk));
+  EXPECT_FLOAT_EQ(columns[1].ess_bulk / 2, columns[1].ess_per_second);
+  EXPECT_FLOAT_EQ(columns[1].ess_bulk / 7000, columns[1].ess_per_gradient);
+}
+
+TEST(ServicesUtilEfficiencySummary, write) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::efficiency_summary summary(writer);
+  summary.begin({"lp__", "a", "b"});
+  mock_sampler sampler;
+  for (int n = 0; n < 100; ++n) {
+    summary.add_draw({std::sin(n * 1.0), std::cos(n * 2.0), 3.0});
+    summary.record(sampler);
+  }
+  summary.write(1.0);
+
+  ASSERT_EQ(1U, writer.string_values().size());
+  EXPECT_EQ(0U, writer.string_values()[0].find("Efficiency: 100 draws, 700"));
+  std::vector<std::vector<std::string>> rows
+      = writer.vector_string_values();
+  ASSERT_EQ(6U, rows.size());
+  EXPECT_EQ("column", rows[0][0]);
+  EXPECT_EQ("lp__", rows[1][0]);
+  EXPECT_EQ("b", rows[3][0]);
+  EXPECT_EQ("min", rows[4][0]);
+  EXPECT_EQ("median", rows[5][0]);
+  double lp = std::stod(rows[1][1]);
+  double a = std::stod(rows[2][1]);
+  EXPECT_NEAR(std::min(lp, a), std::stod(rows[4][1]), 1e-3);
+  EXPECT_NEAR(0.5 * (lp + a), std::stod(rows[5][1]), 1e-3);
+}
@@ -7,7 +7,9 @@
 #include <test/test-models/good/optimization/rosenbrock.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
 #include <iostream>
+#include <chrono>
 #include <exception>
+#include <thread>
 
 class ServicesSamplesGenerateTransitions : public testing::Test {
  public:
@@ -128,3 +130,129 @@ TEST_F(ServicesSamplesGenerateTransitions, output_sizes) {
   EXPECT_EQ(parameter_names[0].size(), parameter_values[0].size());
   EXPECT_EQ(diagnostic_names[0].size(), diagnostic_values[0].size());
 }
+
+TEST_F(ServicesSamplesGenerateTransitions, chain_id_prefix) {
+  unsigned int seed = 0;
+  unsigned int chain = 1;
+  double init_radius = 0;
+  int refresh = 5;
+  int num_iterations = 10;
+  stan::test::unit::instrumented_interrupt interrupt;
+
+  boost::ecuyer1988 rng = stan::services::util::create_rng(seed, chain);
+
+  std::vector<double> cont_vector = stan::services::util::initialize(
+      model, context, rng, init_radius, false, logger, diagnostic);
+
+  stan::mcmc::fixed_param_sampler sampler;
+  stan::services::util::mcmc_writer writer(parameter, diagnostic, logger);
+  Eigen::VectorXd cont_params(cont_vector.size());
+  for (size_t i = 0; i < cont_vector.size(); i++)
+    cont_params[i] = cont_vector[i];
+  stan::mcmc::sample s(cont_params, 0, 0);
+
+  stan::services::util::generate_transitions(
+      sampler, num_iterations, 0, num_iterations, 1, refresh, true, false,
+      writer, s, model, rng, interrupt, logger);
+  EXPECT_EQ(3, logger.find_info("Iteration:"));
+  EXPECT_EQ(0, logger.find_info("Chain ["));
+
+  stan::services::util::generate_transitions(
+      sampler, num_iterations, 0, num_iterations, 1, refresh, true, false,
+      writer, s, model, rng, interrupt, logger, 2, 4);
+  EXPECT_EQ(3, logger.find_info("Chain [2] Iteration:"));
+}
+
+TEST_F(ServicesSamplesGenerateTransitions, progress_reporter) {
+  stan::test::unit::instrumented_interrupt interrupt;
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  std::vector<double> cont_vector = stan::services::util::initialize(
+      model, context, rng, 0, false, logger, diagnostic);
+
+  stan::mcmc::fixed_param_sampler sampler;
+  stan::services::util::mcmc_writer writer(parameter, diagnostic, logger);
+  stan::test::unit::instrumented_writer progress_writer;
+  stan::services::util::progress_reporter progress(progress_writer, 1, 5);
+  stan::services::util::run_options options;
+  options.progress = &progress;
+  writer.set_run_options(options);
+  EXPECT_EQ(&progress, writer.options().progress);
+  Eigen::VectorXd cont_params
+      = Eigen::Map<Eigen::VectorXd>(cont_vector.data(), cont_vector.size());
+  stan::mcmc::sample s(cont_params, 0, 0);
+
+  stan::services::util::generate_transitions(sampler, 7, 0, 12, 1, 0, false,
+                                             true, writer, s, model, rng,
+                                             interrupt, logger);
+  stan::services::util::generate_transitions(sampler, 5, 7, 12, 1, 0, false,
+                                             false, writer, s, model, rng,
+                                             interrupt, logger);
+
+  std::vector<std::vector<double>> records
+      = progress_writer.vector_double_values();
+  ASSERT_EQ(3U, records.size());
+  EXPECT_EQ(5, records[0][1]);
+  EXPECT_EQ(1, records[0][3]) << "warmup";
+  EXPECT_EQ(10, records[1][1]);
+  EXPECT_EQ(0, records[1][3]);
+  EXPECT_EQ(12, records[2][1]);
+  EXPECT_EQ(12, records[2][2]);
+}
+
+TEST_F(ServicesSamplesGenerateTransitions, time_budget) {
+  stan::test::unit::instrumented_interrupt interrupt;
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  std::vector<double> cont_vector = stan::services::util::initialize(
+      model, context, rng, 0, false, logger, diagnostic);
+
+  stan::mcmc::fixed_param_sampler sampler;
+  stan::services::util::mcmc_writer writer(parameter, diagnostic, logger);
+  stan::services::util::time_budget budget(1e-3);
+  stan::services::util::run_options options;
+  options.budget = &budget;
+  writer.set_run_options(options);
+  EXPECT_EQ(&budget, writer.options().budget);
+  Eigen::VectorXd cont_params
+      = Eigen::Map<Eigen::VectorXd>(cont_vector.data(), cont_vector.size());
+  stan::mcmc::sample s(cont_params, 0, 0);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  int num_generated = stan::services::util::generate_transitions(
+      sampler, 10, 0, 10, 1, 0, true, false, writer, s, model, rng,
+      interrupt, logger);
+  EXPECT_EQ(0, num_generated);
+  EXPECT_EQ(1U, interrupt.call_count());
+  EXPECT_EQ(1, logger.find_info("Time budget of"));
+  EXPECT_EQ(1, logger.find_info("stopping after iteration 0 / 10"));
+}
+
+TEST_F(ServicesSamplesGenerateTransitions, startup_timer) {
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_writer startup_writer;
+  stan::services::util::startup_timer startup(startup_writer);
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  std::vector<double> cont_vector = stan::services::util::initialize(
+      model, context, rng, 0, false, logger, diagnostic);
+  startup.record("initialize");
+
+  stan::mcmc::fixed_param_sampler sampler;
+  stan::services::util::mcmc_writer writer(parameter, diagnostic, logger);
+  stan::services::util::run_options options;
+  options.startup = &startup;
+  writer.set_run_options(options);
+  EXPECT_EQ(&startup, writer.options().startup);
+  Eigen::VectorXd cont_params
+      = Eigen::Map<Eigen::VectorXd>(cont_vector.data(), cont_vector.size());
+  stan::mcmc::sample s(cont_params, 0, 0);
+
+  stan::services::util::generate_transitions(sampler, 5, 0, 10, 1, 0, false,
+                                             true, writer, s, model, rng,
+                                             interrupt, logger);
+  stan::services::util::generate_transitions(sampler, 5, 5, 10, 1, 0, false,
+                                             false, writer, s, model, rng,
+                                             interrupt, logger);
+
+  ASSERT_EQ(2U, startup.phases().size());
+  EXPECT_EQ("first_transition", startup.phases()[1].name);
+  EXPECT_EQ(4U, startup_writer.vector_string_values().size());
+}
@@ -519,16 +519,16 @@ class mock_throwing_model_in_write_array : public stan::model::prob_grad {
 TEST_F(ServicesUtilInitialize, model_throws_in_write_array__radius_zero) {
   test::mock_throwing_model_in_write_array throwing_model;
 
+  // Without initial values the draws aren't constrained, so
+  // write_array is never called
   double init_radius = 0;
   bool print_timing = false;
-  EXPECT_THROW(
-      stan::services::util::initialize(throwing_model, empty_context, rng,
-                                       init_radius, print_timing, logger, init),
-      std::domain_error);
+  EXPECT_NO_THROW(stan::services::util::initialize(
+      throwing_model, empty_context, rng, init_radius, print_timing, logger,
+      init));
 
-  EXPECT_EQ(3, logger.call_count());
-  EXPECT_EQ(3, logger.call_count_info());
-  EXPECT_EQ(1, logger.find_info("throwing within write_array"));
+  EXPECT_EQ(0, throwing_model.write_array_calls);
+  EXPECT_EQ(0, logger.find_info("throwing within write_array"));
 }
 
 TEST_F(ServicesUtilInitialize, model_throws_in_write_array__radius_two) {
@@ -536,25 +536,29 @@ TEST_F(ServicesUtilInitialize, model_throws_in_write_array__radius_two) {
 
   double init_radius = 2;
   bool print_timing = false;
-  EXPECT_THROW(
-      stan::services::util::initialize(throwing_model, empty_context, rng,
-                                       init_radius, print_timing, logger, init),
-      std::domain_error);
-  EXPECT_EQ(303, logger.call_count());
-  EXPECT_EQ(303, logger.call_count_info());
-  EXPECT_EQ(100, logger.find_info("throwing within write_array"));
+  EXPECT_NO_THROW(stan::services::util::initialize(
+      throwing_model, empty_context, rng, init_radius, print_timing, logger,
+      init));
+  EXPECT_EQ(0, throwing_model.write_array_calls);
+  EXPECT_EQ(0, logger.find_info("throwing within write_array"));
+}
+
+TEST_F(ServicesUtilInitialize, random_draws_match_random_var_context) {
+  boost::ecuyer1988 context_rng = stan::services::util::create_rng(0, 1);
+  stan::io::random_var_context context(model, context_rng, 2, false);
+  std::vector<double> params;
+  stan::io::random_var_context::draw_unconstrained(model, rng, 2, false,
+                                                   params);
+  EXPECT_EQ(context.get_unconstrained(), params);
 }
 
 TEST_F(ServicesUtilInitialize, model_throws_in_write_array__full_init) {
   std::vector<std::string> names_r;
   std::vector<double> values_r;
   std::vector<std::vector<size_t> > dim_r;
-  names_r.push_back("y");
-  values_r.push_back(6.35149);  // 1.5 unconstrained: -10 + 20 * inv.logit(1.5)
-  values_r.push_back(-2.449187);  // -0.5 unconstrained
-  std::vector<size_t> d;
-  d.push_back(2);
-  dim_r.push_back(d);
+  names_r.push_back("theta");
+  values_r.push_back(1.5);
+  dim_r.push_back(std::vector<size_t>());
   stan::io::array_var_context init_context(names_r, values_r, dim_r);
 
   test::mock_throwing_model_in_write_array throwing_model;
@@ -565,7 +569,72 @@ TEST_F(ServicesUtilInitialize, model_throws_in_write_array__full_init) {
       stan::services::util::initialize(throwing_model, init_context, rng,
                                        init_radius, print_timing, logger, init),
       std::domain_error);
+  EXPECT_EQ(3, logger.call_count());
+  EXPECT_EQ(3, logger.call_count_info());
+  EXPECT_EQ(1, logger.find_info("throwing within write_array"));
+}
+
+TEST_F(ServicesUtilInitialize, parallel__first_valid) {
+  double init_radius = 2;
+  boost::ecuyer1988 sequential_rng = stan::services::util::create_rng(0, 1);
+  stan::test::unit::instrumented_writer sequential_init;
+  std::vector<double> expected = stan::services::util::initialize(
+      model, empty_context, sequential_rng, init_radius, false, logger,
+      sequential_init);
+
+  std::vector<double> params = stan::services::util::initialize_parallel(
+      model, empty_context, rng, init_radius, 4, false, false, logger, init);
+  ASSERT_EQ(expected.size(), params.size());
+  for (size_t i = 0; i < params.size(); ++i)
+    EXPECT_FLOAT_EQ(expected[i], params[i]);
+
+  EXPECT_EQ(0, logger.call_count());
+  ASSERT_EQ(1, init.vector_double_values().size());
+  EXPECT_EQ(params, init.vector_double_values()[0]);
+}
+
+TEST_F(ServicesUtilInitialize, parallel__max_density) {
+  double init_radius = 2;
+  boost::ecuyer1988 first_rng = stan::services::util::create_rng(0, 1);
+  std::vector<double> first = stan::services::util::initialize_parallel(
+      model, empty_context, first_rng, init_radius, 4, false, false, logger,
+      init);
+  std::vector<double> best = stan::services::util::initialize_parallel(
+      model, empty_context, rng, init_radius, 4, true, true, logger, init);
+
+  std::vector<int> disc_vector;
+  std::vector<double> gradient;
+  double first_lp = stan::model::log_prob_grad<true, true>(
+      model, first, disc_vector, gradient);
+  double best_lp = stan::model::log_prob_grad<true, true>(
+      model, best, disc_vector, gradient);
+  EXPECT_LE(first_lp, best_lp);
+  EXPECT_EQ(1, logger.find_info("Gradient evaluation"));
+  ASSERT_EQ(2, init.vector_double_values().size());
+  EXPECT_EQ(best, init.vector_double_values()[1]);
+}
+
+TEST_F(ServicesUtilInitialize, parallel__model_throws) {
+  test::mock_throwing_model throwing_model;
+
+  double init_radius = 2;
+  EXPECT_THROW(stan::services::util::initialize_parallel(
+                   throwing_model, empty_context, rng, init_radius, 8, false,
+                   false, logger, init),
+               std::domain_error);
   EXPECT_EQ(303, logger.call_count());
   EXPECT_EQ(303, logger.call_count_info());
-  EXPECT_EQ(100, logger.find_info("throwing within write_array"));
+  EXPECT_EQ(100, logger.find_info("throwing within log_prob"));
+}
+
+TEST_F(ServicesUtilInitialize, parallel__model_errors) {
+  test::mock_error_model error_model;
+
+  double init_radius = 2;
+  EXPECT_THROW_MSG(stan::services::util::initialize_parallel(
+                       error_model, empty_context, rng, init_radius, 8, false,
+                       false, logger, init),
+                   std::out_of_range, "out_of_range error in log_prob");
+  EXPECT_EQ(2, logger.call_count());
+  EXPECT_EQ(1, logger.find_info("out_of_range error in log_prob"));
 }
@@ -1,5 +1,9 @@
 #include <stan/services/util/inv_metric.hpp>
 #include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
 
 TEST(inv_metric, create_diag_sz1) {
   stan::io::dump dmp = stan::services::util::create_unit_e_diag_inv_metric(1);
@@ -192,3 +196,91 @@ TEST(inv_metric, validate_dense_imm) {
   EXPECT_THROW(stan::services::util::validate_dense_inv_metric(m2, logger),
                std::domain_error);
 }
+
+TEST(inv_metric, read_dense_factor) {
+  stan::callbacks::logger logger;
+  std::string txt = "inv_metric <- structure(c(4, 2, 2, 5), .Dim=c(2, 2))";
+  std::stringstream in(txt);
+  stan::io::dump dump(in);
+  Eigen::MatrixXd factor
+      = stan::services::util::read_dense_inv_metric_factor(dump, 2, logger);
+  Eigen::MatrixXd expected(2, 2);
+  expected << 2, 0, 1, 2;
+  EXPECT_TRUE(factor.isApprox(expected));
+
+  // A precomputed factor is used as is
+  std::stringstream in_chol(
+      "inv_metric_cholesky <- structure(c(2, 1, 0, 2), .Dim=c(2, 2))");
+  stan::io::dump dump_chol(in_chol);
+  EXPECT_TRUE(stan::services::util::read_dense_inv_metric_factor(dump_chol, 2,
+                                                                 logger)
+              == expected);
+
+  std::stringstream in_bad(
+      "inv_metric <- structure(c(1, 2, 2, 1), .Dim=c(2, 2))");
+  stan::io::dump dump_bad(in_bad);
+  EXPECT_THROW(
+      stan::services::util::read_dense_inv_metric_factor(dump_bad, 2, logger),
+      std::domain_error);
+
+  // Only the lower triangle would be factored
+  std::stringstream in_asym(
+      "inv_metric <- structure(c(4, 2, 9, 5), .Dim=c(2, 2))");
+  stan::io::dump dump_asym(in_asym);
+  EXPECT_THROW(
+      stan::services::util::read_dense_inv_metric_factor(dump_asym, 2, logger),
+      std::domain_error);
+
+  std::stringstream in_nan(
+      "inv_metric <- structure(c(4, 2, 2, NaN), .Dim=c(2, 2))");
+  stan::io::dump dump_nan(in_nan);
+  EXPECT_THROW(
+      stan::services::util::read_dense_inv_metric_factor(dump_nan, 2, logger),
+      std::domain_error);
+
+  std::stringstream in_bad_chol(
+      "inv_metric_cholesky <- structure(c(1, 2, 0, 0), .Dim=c(2, 2))");
+  stan::io::dump dump_bad_chol(in_bad_chol);
+  EXPECT_THROW(stan::services::util::read_dense_inv_metric_factor(
+                   dump_bad_chol, 2, logger),
+               std::domain_error);
+
+  std::stringstream in_upper_chol(
+      "inv_metric_cholesky <- structure(c(2, 1, 9, 2), .Dim=c(2, 2))");
+  stan::io::dump dump_upper_chol(in_upper_chol);
+  EXPECT_THROW(stan::services::util::read_dense_inv_metric_factor(
+                   dump_upper_chol, 2, logger),
+               std::domain_error);
+}
+
+TEST(inv_metric, binary_round_trip) {
+  stan::callbacks::logger logger;
+  Eigen::MatrixXd inv_metric(3, 3);
+  inv_metric << 2, 0.5, 0, 0.5, 1, 0.25, 0, 0.25, 3;
+  std::stringstream out;
+  stan::services::util::write_binary_inv_metric(out, inv_metric);
+
+  // The binary reader needs its data aligned to 8 bytes
+  std::string bytes = out.str();
+  std::vector<double> buffer(bytes.size() / 8 + 1);
+  std::memcpy(buffer.data(), bytes.data(), bytes.size());
+  stan::io::binary_var_context context(
+      reinterpret_cast<const char*>(buffer.data()), bytes.size());
+  EXPECT_TRUE(stan::services::util::read_dense_inv_metric(context, 3, logger)
+              == inv_metric);
+  EXPECT_TRUE(
+      stan::services::util::read_dense_inv_metric_factor(context, 3, logger)
+          .isApprox(inv_metric.llt().matrixL().toDenseMatrix()));
+
+  Eigen::VectorXd diag = inv_metric.diagonal();
+  std::stringstream diag_out;
+  stan::services::util::write_binary_inv_metric(diag_out, diag);
+  bytes = diag_out.str();
+  buffer.assign(bytes.size() / 8 + 1, 0);
+  std::memcpy(buffer.data(), bytes.data(), bytes.size());
+  stan::io::binary_var_context diag_context(
+      reinterpret_cast<const char*>(buffer.data()), bytes.size());
+  EXPECT_TRUE(stan::services::util::read_diag_inv_metric(diag_context, 3,
+                                                         logger)
+              == diag);
+}
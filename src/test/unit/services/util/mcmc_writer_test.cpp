@@ -248,6 +248,182 @@ TEST_F(ServicesUtil, write_sample_params) {
   EXPECT_EQ(0, logger.call_count());
 }
 
+TEST_F(ServicesUtil, write_sample_params_repeated) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(2);
+  mock_sampler sampler;
+  stan::mcmc::sample first(x, 1, 2);
+  mcmc_writer.write_sample_names(first, sampler, model);
+  mcmc_writer.write_sample_params(rng, first, sampler, model);
+
+  x << 0.5, -1.5;
+  stan::mcmc::sample second(x, 3, 0.5);
+  mcmc_writer.write_sample_params(rng, second, sampler, model);
+
+  // A second draw through the same buffers matches a fresh writer
+  stan::test::unit::instrumented_writer fresh_writer;
+  stan::services::util::mcmc_writer fresh(fresh_writer, diagnostic_writer,
+                                          logger);
+  fresh.write_sample_names(second, sampler, model);
+  fresh.write_sample_params(rng, second, sampler, model);
+
+  std::vector<std::vector<double>> values
+      = sample_writer.vector_double_values();
+  std::vector<std::vector<double>> expected
+      = fresh_writer.vector_double_values();
+  ASSERT_EQ(2U, values.size());
+  ASSERT_EQ(1U, expected.size());
+  ASSERT_EQ(expected[0].size(), values[1].size());
+  for (size_t i = 0; i < values[1].size(); ++i)
+    EXPECT_FLOAT_EQ(expected[0][i], values[1][i]);
+  EXPECT_FLOAT_EQ(3, values[1][0]);
+  EXPECT_FLOAT_EQ(1, values[0][0]);
+}
+
+TEST_F(ServicesUtil, write_sample_params_live_chains) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(2);
+  mock_sampler sampler;
+  stan::mcmc::sample sample(x, 1, 2);
+  mcmc_writer.write_sample_names(sample, sampler, model);
+
+  stan::mcmc::live_chains wrong({"lp__"}, 1);
+  EXPECT_THROW(mcmc_writer.set_live_chains(wrong, 0), std::invalid_argument);
+
+  std::vector<std::string> names = sample_writer.vector_string_values()[0];
+  stan::mcmc::live_chains chains(names, 2);
+  mcmc_writer.set_live_chains(chains, 1);
+  mcmc_writer.write_sample_params(rng, sample, sampler, model);
+  mcmc_writer.write_sample_params(rng, sample, sampler, model);
+
+  EXPECT_EQ(0, chains.num_samples(0));
+  ASSERT_EQ(2, chains.num_samples(1));
+  std::vector<double> values = sample_writer.vector_double_values()[1];
+  for (size_t j = 0; j < names.size(); ++j)
+    EXPECT_EQ(values[j], chains.samples(1, j)(1));
+}
+
+TEST_F(ServicesUtil, write_selected_columns) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  Eigen::VectorXd x(2);
+  x << 0.5, -1.5;
+  stan::mcmc::sample sample(x, 1, 2);
+  mock_sampler sampler;
+
+  stan::services::util::column_selection selection({"y[2]", "xgq"});
+  stan::services::util::run_options options;
+  options.columns = &selection;
+  mcmc_writer.set_run_options(options);
+  mcmc_writer.write_sample_names(sample, sampler, model);
+  EXPECT_EQ(2, mcmc_writer.num_model_params_);
+  mcmc_writer.write_sample_params(rng, sample, sampler, model);
+
+  std::vector<std::string> names = sample_writer.vector_string_values()[0];
+  ASSERT_EQ(4U, names.size());
+  EXPECT_EQ("lp__", names[0]);
+  EXPECT_EQ("y.2", names[2]);
+  EXPECT_EQ("xgq", names[3]);
+
+  std::vector<std::vector<double>> values
+      = sample_writer.vector_double_values();
+  ASSERT_EQ(1U, values.size());
+  ASSERT_EQ(4U, values[0].size());
+  EXPECT_FLOAT_EQ(1, values[0][0]);
+  EXPECT_FALSE(std::isnan(values[0][2]));
+  EXPECT_FLOAT_EQ(0.007, values[0][3]);
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST_F(ServicesUtil, write_sample_params_pipelined) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  mock_sampler sampler;
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(2);
+  stan::mcmc::sample first(x, 0, 2);
+  mcmc_writer.write_sample_names(first, sampler, model);
+  mcmc_writer.set_gq_pipeline(model, rng, 2);
+  const boost::ecuyer1988 pipeline_rng = rng;
+
+  stan::test::unit::instrumented_writer inline_writer;
+  stan::services::util::mcmc_writer expected_writer(
+      inline_writer, diagnostic_writer, logger);
+  expected_writer.write_sample_names(first, sampler, model);
+
+  for (int n = 0; n < 5; ++n) {
+    x << 0.5 * n, -1.5 + n;
+    stan::mcmc::sample sample(x, n, 2);
+    mcmc_writer.write_sample_params(rng, sample, sampler, model);
+    boost::ecuyer1988 draw_rng
+        = stan::services::util::create_draw_rng(pipeline_rng, n);
+    expected_writer.write_sample_params(draw_rng, sample, sampler, model);
+    // A batch is written once the batch after it is full
+    EXPECT_EQ(n < 3 ? 0U : 2U, sample_writer.call_count("vector_double"));
+  }
+  mcmc_writer.flush_pipeline();
+
+  std::vector<std::vector<double>> values
+      = sample_writer.vector_double_values();
+  std::vector<std::vector<double>> expected
+      = inline_writer.vector_double_values();
+  ASSERT_EQ(5U, values.size());
+  ASSERT_EQ(5U, expected.size());
+  for (size_t n = 0; n < values.size(); ++n) {
+    EXPECT_FLOAT_EQ(n, values[n][0]);
+    ASSERT_EQ(expected[n].size(), values[n].size());
+    for (size_t i = 0; i < values[n].size(); ++i)
+      EXPECT_FLOAT_EQ(expected[n][i], values[n][i]);
+  }
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST_F(ServicesUtil, write_sample_params_unconstrained) {
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  mock_sampler sampler;
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(2);
+  stan::mcmc::sample first(x, 0, 2);
+  stan::services::util::run_options options;
+  options.unconstrained_output = true;
+  mcmc_writer.set_run_options(options);
+  mcmc_writer.write_sample_names(first, sampler, model);
+
+  std::vector<std::string> names = sample_writer.vector_string_values()[0];
+  std::vector<std::string> unconstrained_names;
+  model.unconstrained_param_names(unconstrained_names, false, false);
+  ASSERT_EQ(3U + unconstrained_names.size(), names.size());
+  EXPECT_EQ("lp__", names[0]);
+  EXPECT_EQ("draw__", names[2]);
+  EXPECT_EQ(unconstrained_names[0], names[3]);
+
+  for (int n = 0; n < 3; ++n) {
+    x << 0.5 * n, -1.5 + n;
+    stan::mcmc::sample sample(x, n, 2);
+    mcmc_writer.write_sample_params(rng, sample, sampler, model);
+  }
+
+  std::vector<std::vector<double>> values
+      = sample_writer.vector_double_values();
+  ASSERT_EQ(3U, values.size());
+  for (size_t n = 0; n < values.size(); ++n) {
+    ASSERT_EQ(5U, values[n].size());
+    EXPECT_FLOAT_EQ(n, values[n][0]);
+    EXPECT_FLOAT_EQ(n, values[n][2]);
+    EXPECT_FLOAT_EQ(0.5 * n, values[n][3]);
+    EXPECT_FLOAT_EQ(-1.5 + n, values[n][4]);
+  }
+  EXPECT_EQ(0, logger.call_count());
+}
+
+TEST_F(ServicesUtil, transformed_parameters_cache_capacity) {
+  EXPECT_EQ(0U, mcmc_writer.transformed_parameters_cache_capacity());
+  stan::services::util::run_options options;
+  options.tparams_cache_capacity = 1024;
+  mcmc_writer.set_run_options(options);
+  EXPECT_EQ(1024U, mcmc_writer.transformed_parameters_cache_capacity());
+  // Unconstrained draws don't compute transformed parameters
+  options.unconstrained_output = true;
+  mcmc_writer.set_run_options(options);
+  EXPECT_EQ(0U, mcmc_writer.transformed_parameters_cache_capacity());
+}
+
 TEST_F(ServicesUtil, write_adapt_finish) {
   mock_sampler sampler;
 
@@ -0,0 +1,61 @@
+#include <stan/services/util/memory_report.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+class stateful_sampler : public stan::mcmc::base_mcmc {
+ public:
+  stan::mcmc::sample transition(stan::mcmc::sample& init_sample,
+                                stan::callbacks::logger& logger) {
+    return init_sample;
+  }
+
+  void write_state(stan::mcmc::state_writer& writer) const {
+    writer.tag("stateful");
+    writer.write(Eigen::MatrixXd::Identity(10, 10));
+    writer.write(0.5);
+  }
+};
+}  // namespace
+
+TEST(ServicesUtilMemoryReport, components) {
+  std::stringstream out;
+  stan::callbacks::stream_writer writer(out);
+  stan::services::util::memory_report memory(writer);
+  memory.begin();
+  memory.add("first", 100);
+  memory.add("second", 23);
+  EXPECT_EQ(123U, memory.total_bytes());
+  memory.write();
+  EXPECT_EQ("component,bytes\nfirst,100\nsecond,23\ntotal,123\n", out.str());
+
+  memory.begin();
+  EXPECT_TRUE(memory.components().empty());
+  stan::model::autodiff_memory::record(4096);
+  stan::model::autodiff_memory::record(1024);
+  memory.add_autodiff();
+  ASSERT_EQ(1U, memory.components().size());
+  EXPECT_EQ(4096U, memory.components()[0].bytes);
+}
+
+TEST(ServicesUtilMemoryReport, add_sampling) {
+  stan::test::unit::instrumented_writer sample_writer, diagnostic_writer,
+      report_writer;
+  stan::test::unit::instrumented_logger logger;
+  stan::services::util::mcmc_writer mcmc_writer(sample_writer,
+                                                diagnostic_writer, logger);
+  stateful_sampler sampler;
+
+  stan::services::util::memory_report memory(report_writer);
+  memory.begin();
+  memory.add_sampling(sampler, mcmc_writer);
+  ASSERT_EQ(3U, memory.components().size());
+  EXPECT_EQ("sampler_state", memory.components()[1].name);
+  EXPECT_EQ(101 * sizeof(double), memory.components()[1].bytes);
+  EXPECT_EQ("writer_buffers", memory.components()[2].name);
+  EXPECT_EQ(mcmc_writer.buffer_bytes(), memory.components()[2].bytes);
+}
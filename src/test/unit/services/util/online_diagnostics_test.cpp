@@ -0,0 +1,179 @@
+#include <stan/services/util/online_diagnostics.hpp>
+#include <stan/analyze/mcmc/compute_effective_sample_size.hpp>
+#include <stan/analyze/mcmc/compute_potential_scale_reduction.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+class ServicesUtilOnlineDiagnostics : public testing::Test {
+ public:
+  ServicesUtilOnlineDiagnostics()
+      : header{"lp__", "accept_stat__", "mu", "sigma"} {}
+
+  // Autoregressive draws so the effective sample size is well below the number
+  // of draws
+  void add_draws(stan::services::util::online_diagnostics& diagnostics,
+                 size_t num_chains, size_t num_draws) {
+    boost::ecuyer1988 rng(1234);
+    boost::random::normal_distribution<double> normal;
+    std::vector<size_t> chains;
+    std::vector<std::vector<double>> states(num_chains,
+                                            std::vector<double>(4, 0));
+    for (size_t i = 0; i < num_chains; ++i)
+      chains.push_back(diagnostics.add_chain(header));
+    draws.assign(num_chains, std::vector<std::vector<double>>(2));
+    for (size_t n = 0; n < num_draws; ++n) {
+      for (size_t i = 0; i < num_chains; ++i) {
+        std::vector<double>& state = states[i];
+        state[0] = -n;
+        state[1] = 0.8;
+        state[2] = 0.7 * state[2] + normal(rng);
+        state[3] = 3 + 0.2 * state[3] + normal(rng);
+        draws[i][0].push_back(state[2]);
+        draws[i][1].push_back(state[3]);
+        diagnostics.add_draw(chains[i], state, logger);
+      }
+    }
+  }
+
+  std::vector<std::string> header;
+  std::vector<std::vector<std::vector<double>>> draws;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesUtilOnlineDiagnostics, matches_offline_diagnostics) {
+  stan::services::util::online_diagnostics diagnostics({"mu", "sigma"}, 3, 0);
+  add_draws(diagnostics, 3, 500);
+
+  EXPECT_EQ(3u, diagnostics.num_registered());
+  EXPECT_EQ(500u, diagnostics.num_draws());
+  EXPECT_EQ(0u, logger.call_count());
+
+  Eigen::VectorXd rhat = diagnostics.split_rhat();
+  Eigen::VectorXd ess = diagnostics.split_ess();
+  ASSERT_EQ(2, rhat.size());
+  ASSERT_EQ(2, ess.size());
+  for (size_t k = 0; k < 2; ++k) {
+    std::vector<const double*> ptrs;
+    for (size_t i = 0; i < 3; ++i)
+      ptrs.push_back(draws[i][k].data());
+    std::vector<size_t> sizes(3, 500);
+    EXPECT_DOUBLE_EQ(
+        stan::analyze::compute_split_potential_scale_reduction(ptrs, sizes),
+        rhat(k));
+    EXPECT_DOUBLE_EQ(
+        stan::analyze::compute_split_effective_sample_size(ptrs, sizes),
+        ess(k));
+  }
+
+  for (size_t i = 0; i < 3; ++i) {
+    Eigen::VectorXd mean = diagnostics.mean(i);
+    Eigen::VectorXd variance = diagnostics.variance(i);
+    for (size_t k = 0; k < 2; ++k) {
+      Eigen::Map<Eigen::VectorXd> x(draws[i][k].data(), draws[i][k].size());
+      double expected_mean = x.mean();
+      double expected_variance
+          = (x.array() - expected_mean).square().sum() / (x.size() - 1);
+      EXPECT_NEAR(expected_mean, mean(k), 1e-10);
+      EXPECT_NEAR(expected_variance, variance(k), 1e-10);
+    }
+  }
+}
+
+TEST_F(ServicesUtilOnlineDiagnostics, reduce_split_diagnostics) {
+  stan::services::util::online_diagnostics diagnostics({"mu", "sigma"}, 3, 0);
+  add_draws(diagnostics, 3, 301);
+
+  stan::services::util::chain_communicator communicator;
+  Eigen::VectorXd rhat, ess;
+  diagnostics.reduce_split_diagnostics(communicator, rhat, ess);
+  ASSERT_EQ(2, rhat.size());
+  ASSERT_EQ(2, ess.size());
+  for (int k = 0; k < 2; ++k) {
+    EXPECT_NEAR(diagnostics.split_rhat()(k), rhat(k), 1e-10);
+    EXPECT_NEAR(diagnostics.split_ess()(k), ess(k), 1e-8);
+  }
+}
+
+TEST_F(ServicesUtilOnlineDiagnostics, reports_every_interval) {
+  stan::services::util::online_diagnostics diagnostics({"mu"}, 2, 50);
+  add_draws(diagnostics, 2, 220);
+
+  EXPECT_EQ(4u, logger.find_info("Diagnostics after"));
+  EXPECT_EQ(1u, logger.find_info("Diagnostics after 200 draws per chain"));
+  EXPECT_EQ(4u, logger.find_info("mu: mean = "));
+  EXPECT_EQ(0u, logger.find_info("sigma"));
+  EXPECT_FALSE(diagnostics.target_reached());
+}
+
+TEST_F(ServicesUtilOnlineDiagnostics, ess_target) {
+  stan::services::util::online_diagnostics diagnostics({"mu", "sigma"}, 2, 0,
+                                                       100);
+  add_draws(diagnostics, 2, 99);
+  EXPECT_FALSE(diagnostics.target_reached());
+  EXPECT_EQ(0u, logger.call_count());
+
+  stan::services::util::online_diagnostics reached({"mu", "sigma"}, 2, 0, 20);
+  add_draws(reached, 2, 100);
+  EXPECT_TRUE(reached.target_reached());
+  EXPECT_EQ(0u, logger.call_count());
+}
+
+TEST_F(ServicesUtilOnlineDiagnostics, add_chain_errors) {
+  stan::services::util::online_diagnostics diagnostics({"mu", "tau"}, 1, 10);
+  EXPECT_THROW(diagnostics.add_chain(header), std::invalid_argument);
+
+  stan::services::util::online_diagnostics one_chain({"mu"}, 1, 10);
+  EXPECT_EQ(0u, one_chain.add_chain(header));
+  EXPECT_THROW(one_chain.add_chain(header), std::invalid_argument);
+
+  EXPECT_THROW(stan::services::util::online_diagnostics({}, 1, 10),
+               std::invalid_argument);
+  EXPECT_THROW(stan::services::util::online_diagnostics({"mu"}, 0, 10),
+               std::invalid_argument);
+}
+
+TEST_F(ServicesUtilOnlineDiagnostics, run_adaptive_sampler_stops_early) {
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model(context, 0, &model_log);
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  stan::mcmc::adapt_diag_e_nuts<stan_model, boost::ecuyer1988> sampler(model,
+                                                                        rng);
+  sampler.set_nominal_stepsize(0.1);
+  sampler.set_max_depth(6);
+  sampler.get_stepsize_adaptation().set_mu(log(10 * 0.1));
+  sampler.get_stepsize_adaptation().set_delta(0.8);
+  sampler.get_stepsize_adaptation().set_gamma(0.05);
+  sampler.get_stepsize_adaptation().set_kappa(0.75);
+  sampler.get_stepsize_adaptation().set_t0(10);
+  sampler.set_window_params(200, 15, 50, 25, logger);
+
+  int num_warmup = 200;
+  int num_samples = 2000;
+  std::vector<double> cont_vector{0.5, -0.5};
+  stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+  stan::callbacks::interrupt interrupt;
+  stan::services::util::online_diagnostics diagnostics({"x", "y"}, 1, 50, 5);
+  stan::services::util::run_options options;
+  options.diagnostics = &diagnostics;
+  stan::services::util::run_adaptive_sampler(
+      sampler, model, cont_vector, num_warmup, num_samples, 1, 0, false, rng,
+      interrupt, logger, sample_writer, diagnostic_writer, 1, 1, options);
+
+  size_t num_draws = diagnostics.num_draws();
+  EXPECT_TRUE(diagnostics.target_reached());
+  EXPECT_TRUE((diagnostics.split_ess().array() >= 5).all());
+  EXPECT_EQ(1u, logger.find_info("ESS target reached"));
+  EXPECT_EQ(num_draws / 50, logger.find_info("Diagnostics after"));
+  EXPECT_EQ(0u, num_draws % 50);
+  EXPECT_LT(num_draws, num_samples);
+  EXPECT_EQ(num_draws, sample_writer.call_count("vector_double"));
+}
@@ -0,0 +1,125 @@
+#include <stan/services/util/pathfinder_init.hpp>
+#include <gtest/gtest.h>
+#include <stan/io/dump.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/services/error_codes.hpp>
+#include <stan/services/sample/hmc_nuts_diag_e_adapt.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <test/test-models/good/services/bernoulli.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <cmath>
+#include <deque>
+#include <fstream>
+
+class ServicesUtilPathfinderInit : public testing::Test {
+ public:
+  ServicesUtilPathfinderInit() : rng(stan::services::util::create_rng(0, 1)) {}
+
+  void SetUp() {
+    std::fstream data_stream(
+        "src/test/test-models/good/services/bernoulli.data.R",
+        std::fstream::in);
+    stan::io::dump data_var_context(data_stream);
+    data_stream.close();
+    model = new stan_model(data_var_context);
+  }
+
+  void TearDown() { delete model; }
+
+  stan_model* model;
+  stan::io::empty_var_context empty_context;
+  stan::test::unit::instrumented_interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  stan::test::unit::instrumented_writer init;
+  boost::ecuyer1988 rng;
+};
+
+TEST_F(ServicesUtilPathfinderInit, single_path) {
+  stan::services::util::pathfinder_result result
+      = stan::services::util::pathfinder_init(*model, empty_context, rng, 2,
+                                              1, 5, 100, 10, 50, interrupt,
+                                              logger, init);
+
+  EXPECT_EQ(1, logger.find_info("Pathfinder path 1: best ELBO"));
+  EXPECT_LT(0, interrupt.call_count());
+  EXPECT_LT(0u, result.num_grad_evals);
+  EXPECT_LT(0, result.best.iteration);
+
+  ASSERT_EQ(1, result.draws.rows());
+  ASSERT_EQ(50, result.draws.cols());
+  ASSERT_EQ(50, result.lp.size());
+  EXPECT_TRUE(result.draws.allFinite());
+  EXPECT_TRUE(result.lp.allFinite());
+
+  // The posterior is beta(3, 9), whose mode on the logit scale is
+  // logit(0.25) with a variance near 1 / (12 * 0.25 * 0.75)
+  EXPECT_NEAR(std::log(1.0 / 3), result.best.mean(0), 0.5);
+  ASSERT_EQ(1, result.diag_inv_metric().size());
+  EXPECT_GT(result.diag_inv_metric()(0), 0.1);
+  EXPECT_LT(result.diag_inv_metric()(0), 2);
+  EXPECT_FLOAT_EQ(result.diag_inv_metric()(0), result.dense_inv_metric()(0, 0));
+}
+
+TEST_F(ServicesUtilPathfinderInit, multi_path_feeds_sampler) {
+  stan::services::util::pathfinder_result result
+      = stan::services::util::pathfinder_init(*model, empty_context, rng, 2,
+                                              4, 5, 100, 10, 20, interrupt,
+                                              logger, init);
+  EXPECT_EQ(4, logger.find_info("best ELBO"));
+  EXPECT_EQ(20, result.draws.cols());
+
+  stan::io::array_var_context init_context
+      = stan::services::util::pathfinder_init_context(*model, result, 0, rng);
+  std::vector<double> theta = init_context.vals_r("theta");
+  ASSERT_EQ(1u, theta.size());
+  EXPECT_FLOAT_EQ(1 / (1 + std::exp(-result.draws(0, 0))), theta[0]);
+
+  stan::io::array_var_context inv_metric_context
+      = stan::services::util::pathfinder_inv_metric_context(result, false);
+  EXPECT_FLOAT_EQ(result.diag_inv_metric()(0),
+                  inv_metric_context.vals_r("inv_metric")[0]);
+
+  stan::test::unit::instrumented_writer sample_init, parameter, diagnostic;
+  int return_code = stan::services::sample::hmc_nuts_diag_e_adapt(
+      *model, init_context, inv_metric_context, 0, 1, 0, 50, 20, 1, false, 0,
+      1, 0, 10, 0.8, 0.05, 0.75, 10, 5, 10, 20, interrupt, logger,
+      sample_init, parameter, diagnostic);
+  EXPECT_EQ(stan::services::error_codes::OK, return_code);
+  EXPECT_EQ(20, parameter.call_count("vector_double"));
+}
+
+TEST(ServicesUtilPathfinderApproximation, matches_inverse_bfgs) {
+  int n = 4;
+  Eigen::MatrixXd A(n, n);
+  A << 4, 1, 0, 0, 1, 3, 1, 0, 0, 1, 2, 0.5, 0, 0, 0.5, 1;
+
+  std::deque<Eigen::VectorXd> s_hist;
+  std::deque<Eigen::VectorXd> y_hist;
+  for (int i = 0; i < 2; ++i) {
+    Eigen::VectorXd s = Eigen::VectorXd::LinSpaced(n, i + 1, -i);
+    s_hist.push_back(s);
+    y_hist.push_back(A * s);
+  }
+
+  // Recursive inverse BFGS update from the scaled identity
+  double gamma
+      = s_hist.back().dot(y_hist.back()) / y_hist.back().squaredNorm();
+  Eigen::MatrixXd H = gamma * Eigen::MatrixXd::Identity(n, n);
+  for (int i = 0; i < 2; ++i) {
+    double rho = 1 / y_hist[i].dot(s_hist[i]);
+    Eigen::MatrixXd V = Eigen::MatrixXd::Identity(n, n)
+                        - rho * y_hist[i] * s_hist[i].transpose();
+    H = V.transpose() * H * V + rho * s_hist[i] * s_hist[i].transpose();
+  }
+
+  Eigen::VectorXd x = Eigen::VectorXd::Ones(n);
+  Eigen::VectorXd g = A * x;
+  stan::services::util::pathfinder_approximation approx;
+  ASSERT_TRUE(stan::services::util::internal::lbfgs_normal_approximation(
+      s_hist, y_hist, x, g, approx));
+
+  EXPECT_NEAR(0, (approx.dense_covariance() - H).norm(), 1e-12);
+  EXPECT_NEAR(0, (approx.diag_covariance() - H.diagonal()).norm(), 1e-12);
+  EXPECT_NEAR(std::log(H.determinant()), approx.log_det_covariance, 1e-12);
+  EXPECT_NEAR(0, (approx.mean - (x - H * g)).norm(), 1e-12);
+}
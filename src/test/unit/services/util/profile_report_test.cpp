@@ -0,0 +1,49 @@
+#include <stan/services/util/profile_report.hpp>
+#include <stan/math/rev.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+TEST(ServicesUtilProfileReport, regions) {
+  stan::math::profile_map profiles;
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::profile_report report(writer, profiles);
+  report.begin();
+
+  for (int n = 0; n < 3; ++n) {
+    stan::math::var x = n;
+    stan::math::var y;
+    {
+      stan::math::profile<stan::math::var> region("likelihood", profiles);
+      y = x * x;
+    }
+    y.grad();
+    stan::math::recover_memory();
+  }
+  {
+    stan::math::profile<double> region("generated", profiles);
+  }
+  report.write();
+
+  std::vector<std::vector<std::string>> rows = writer.vector_string_values();
+  ASSERT_EQ(3U, rows.size());
+  std::vector<std::string> header{
+      "name",           "thread_id",      "total_time",
+      "forward_time",   "reverse_time",   "chain_stack",
+      "no_chain_stack", "autodiff_calls", "no_autodiff_calls",
+      "reverse_calls"};
+  EXPECT_EQ(header, rows[0]);
+  EXPECT_EQ("generated", rows[1][0]);
+  EXPECT_EQ("0", rows[1][7]);
+  EXPECT_EQ("1", rows[1][8]);
+  EXPECT_EQ("0", rows[1][9]);
+  EXPECT_EQ("likelihood", rows[2][0]);
+  EXPECT_EQ("3", rows[2][7]);
+  EXPECT_EQ("0", rows[2][8]);
+  EXPECT_EQ("3", rows[2][9]);
+  EXPECT_NE("0", rows[2][5]);
+
+  report.begin();
+  EXPECT_TRUE(profiles.empty());
+}
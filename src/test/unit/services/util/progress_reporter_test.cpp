@@ -0,0 +1,100 @@
+#include <stan/services/util/progress_reporter.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+// Reports a tree depth of 1, 2, 3, ... and a divergence every third
+// transition, with 2^depth - 1 leapfrog steps
+class mock_nuts : public stan::mcmc::base_mcmc {
+ public:
+  int n = 0;
+
+  stan::mcmc::sample transition(stan::mcmc::sample& init_sample,
+                                stan::callbacks::logger& logger) {
+    ++n;
+    return init_sample;
+  }
+
+  void get_sampler_param_names(std::vector<std::string>& names) {
+    names.push_back("stepsize__");
+    names.push_back("treedepth__");
+    names.push_back("n_leapfrog__");
+    names.push_back("divergent__");
+  }
+
+  void get_sampler_params(std::vector<double>& values) {
+    values.push_back(0.5);
+    values.push_back(n);
+    values.push_back(std::pow(2, n) - 1);
+    values.push_back(n % 3 == 0);
+  }
+};
+
+class mock_fixed : public stan::mcmc::base_mcmc {
+ public:
+  stan::mcmc::sample transition(stan::mcmc::sample& init_sample,
+                                stan::callbacks::logger& logger) {
+    return init_sample;
+  }
+};
+}  // namespace
+
+TEST(ServicesUtilProgressReporter, records) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::progress_reporter progress(writer, 3, 4);
+  mock_nuts sampler;
+  for (int m = 1; m <= 10; ++m) {
+    sampler.n = m;
+    progress.record(sampler, m, 10, m <= 4);
+  }
+
+  std::vector<std::vector<std::string>> names = writer.vector_string_values();
+  ASSERT_EQ(1U, names.size());
+  ASSERT_EQ(11U, names[0].size());
+  EXPECT_EQ("chain", names[0][0]);
+  EXPECT_EQ("eta_seconds", names[0][10]);
+
+  // Records after 4 and 8 transitions and after the last iteration
+  std::vector<std::vector<double>> records = writer.vector_double_values();
+  ASSERT_EQ(3U, records.size());
+  std::vector<double> iterations{4, 8, 10};
+  std::vector<double> warmup{1, 0, 0};
+  std::vector<double> mean_treedepth{2.5, 6.5, 9.5};
+  std::vector<double> divergences{1, 1, 1};
+  std::vector<double> total_divergences{1, 2, 3};
+  for (size_t r = 0; r < records.size(); ++r) {
+    ASSERT_EQ(11U, records[r].size());
+    EXPECT_EQ(3, records[r][0]);
+    EXPECT_EQ(iterations[r], records[r][1]);
+    EXPECT_EQ(10, records[r][2]);
+    EXPECT_EQ(warmup[r], records[r][3]);
+    EXPECT_GE(records[r][4], 0);
+    EXPECT_FLOAT_EQ(mean_treedepth[r], records[r][7]);
+    EXPECT_EQ(divergences[r], records[r][8]);
+    EXPECT_EQ(total_divergences[r], records[r][9]);
+  }
+  EXPECT_LE(records[0][4], records[2][4]);
+  EXPECT_EQ(0, records[2][10]) << "no iterations remain";
+}
+
+TEST(ServicesUtilProgressReporter, sampler_without_tree) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::progress_reporter progress(writer);
+  mock_fixed sampler;
+  for (int m = 1; m <= 150; ++m)
+    progress.record(sampler, m, 150, false);
+
+  std::vector<std::vector<double>> records = writer.vector_double_values();
+  ASSERT_EQ(2U, records.size());
+  EXPECT_EQ(100, records[0][1]);
+  EXPECT_EQ(150, records[1][1]);
+  EXPECT_TRUE(std::isnan(records[0][6])) << "no gradients";
+  EXPECT_TRUE(std::isnan(records[0][7])) << "no tree depth";
+  EXPECT_EQ(0, records[1][9]);
+
+  EXPECT_THROW(stan::services::util::progress_reporter(writer, 1, 0),
+               std::invalid_argument);
+}
@@ -0,0 +1,70 @@
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <gtest/gtest.h>
+#include <test/test-models/good/services/test_gq.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/util/column_selection.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class ServicesUtilColumns : public testing::Test {
+ public:
+  ServicesUtilColumns() : model(context, 0, &model_log) {}
+
+  // Run a chain of a fixed seed with the specified column selection, or
+  // all columns, and return its header and draws
+  void run(const stan::services::util::column_selection* columns,
+           std::vector<std::string>& names,
+           std::vector<std::vector<double>>& draws) {
+    boost::ecuyer1988 rng = stan::services::util::create_rng(4, 1);
+    stan::mcmc::adapt_diag_e_nuts<stan_model, boost::ecuyer1988> sampler(
+        model, rng);
+    sampler.set_nominal_stepsize(0.5);
+    sampler.set_max_depth(5);
+    sampler.set_window_params(50, 15, 25, 10, logger);
+    std::vector<double> cont_vector{0.2, -0.3};
+    stan::test::unit::instrumented_writer sample_writer, diagnostic_writer;
+    stan::services::util::run_options options;
+    options.columns = columns;
+    stan::services::util::run_adaptive_sampler(
+        sampler, model, cont_vector, 50, 30, 1, 0, true, rng, interrupt,
+        logger, sample_writer, diagnostic_writer, 1, 1, options);
+    names = sample_writer.vector_string_values()[0];
+    draws = sample_writer.vector_double_values();
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  stan::callbacks::interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesUtilColumns, selection_keeps_draws) {
+  std::vector<std::string> all_names;
+  std::vector<std::vector<double>> all_draws;
+  run(nullptr, all_names, all_draws);
+  ASSERT_EQ(80U, all_draws.size());
+
+  // Without the generated quantities write_array() draws no random
+  // numbers, and with them only some of its columns are written
+  for (const std::vector<std::string>& patterns :
+       {std::vector<std::string>{"y"}, std::vector<std::string>{"y_rep"}}) {
+    stan::services::util::column_selection selection(patterns);
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> draws;
+    run(&selection, names, draws);
+    ASSERT_EQ(all_draws.size(), draws.size());
+    ASSERT_LT(names.size(), all_names.size());
+    for (size_t j = 0; j < names.size(); ++j) {
+      auto it = std::find(all_names.begin(), all_names.end(), names[j]);
+      ASSERT_TRUE(it != all_names.end()) << names[j];
+      size_t i = it - all_names.begin();
+      for (size_t n = 0; n < draws.size(); ++n)
+        EXPECT_EQ(all_draws[n][i], draws[n][j]) << names[j] << " " << n;
+    }
+  }
+}
@@ -197,3 +197,31 @@ TEST_F(ServicesUtil, num_warmup_num_samples_refresh) {
   EXPECT_EQ(num_samples, diagnostic_writer.call_count("vector_double"))
       << "draws";
 }
+
+TEST_F(ServicesUtil, warmup_profile) {
+  num_warmup = 50;
+  num_samples = 10;
+  stan::test::unit::instrumented_writer profile_writer;
+  stan::services::util::warmup_profile profile(profile_writer);
+  stan::services::util::run_options options;
+  options.profile = &profile;
+  stan::services::util::run_adaptive_sampler(
+      sampler, model, cont_vector, num_warmup, num_samples, num_thin, refresh,
+      save_warmup, rng, interrupt, logger, sample_writer, diagnostic_writer, 1,
+      1, options);
+  EXPECT_EQ(num_warmup + num_samples, interrupt.call_count());
+
+  // The unit metric only adapts the step size
+  ASSERT_EQ(2U, profile.phases().size());
+  EXPECT_EQ("initial_stepsize", profile.phases()[0].name);
+  EXPECT_EQ(1, profile.phases()[0].iterations);
+  EXPECT_EQ("stepsize", profile.phases()[1].name);
+  EXPECT_EQ(num_warmup, profile.phases()[1].iterations);
+  EXPECT_LT(0U, profile.phases()[1].grad_evals);
+  EXPECT_EQ(0, profile.phases()[1].metric_seconds);
+
+  EXPECT_EQ(3, profile_writer.call_count());
+  EXPECT_EQ(3, profile_writer.call_count("vector_string"))
+      << "header and one row per phase";
+  EXPECT_EQ(num_samples, sample_writer.call_count("vector_double"));
+}
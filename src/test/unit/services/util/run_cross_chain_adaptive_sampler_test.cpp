@@ -0,0 +1,140 @@
+#include <stan/services/util/run_cross_chain_adaptive_sampler.hpp>
+#include <gtest/gtest.h>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_diag_e_nuts.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <stan/services/util/run_adaptive_sampler.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <vector>
+
+typedef stan::mcmc::adapt_diag_e_nuts<stan_model, boost::ecuyer1988>
+    sampler_t;
+
+class ServicesUtilCrossChain : public testing::Test {
+ public:
+  ServicesUtilCrossChain()
+      : model(context, 0, &model_log),
+        num_warmup(200),
+        num_samples(100),
+        num_thin(3),
+        refresh(7),
+        save_warmup(true) {}
+
+  void make_chains(size_t num_chains) {
+    rngs.reserve(num_chains);
+    samplers.reserve(num_chains);
+    for (size_t i = 0; i < num_chains; ++i) {
+      rngs.emplace_back(stan::services::util::create_rng(0, i + 1));
+      samplers.emplace_back(model, rngs.back());
+      configure(samplers.back());
+      cont_vectors.push_back(std::vector<double>{0.5, -0.5});
+      sample_writer.emplace_back();
+      diagnostic_writer.emplace_back();
+    }
+  }
+
+  void configure(sampler_t& sampler) {
+    sampler.set_nominal_stepsize(0.1);
+    sampler.set_max_depth(6);
+    sampler.get_stepsize_adaptation().set_mu(log(10 * 0.1));
+    sampler.get_stepsize_adaptation().set_delta(0.8);
+    sampler.get_stepsize_adaptation().set_gamma(0.05);
+    sampler.get_stepsize_adaptation().set_kappa(0.75);
+    sampler.get_stepsize_adaptation().set_t0(10);
+    sampler.set_window_params(num_warmup, 15, 50, 25, logger);
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  std::vector<boost::ecuyer1988> rngs;
+  std::vector<sampler_t> samplers;
+  std::vector<std::vector<double>> cont_vectors;
+  std::vector<stan::test::unit::instrumented_writer> sample_writer;
+  std::vector<stan::test::unit::instrumented_writer> diagnostic_writer;
+  stan::callbacks::interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+  int num_warmup, num_samples, num_thin, refresh;
+  bool save_warmup;
+};
+
+TEST_F(ServicesUtilCrossChain, single_chain_matches_run_adaptive_sampler) {
+  make_chains(1);
+  stan::services::util::run_cross_chain_adaptive_sampler(
+      samplers, model, cont_vectors, num_warmup, num_samples, num_thin,
+      refresh, save_warmup, rngs, interrupt, logger, sample_writer,
+      diagnostic_writer);
+
+  boost::ecuyer1988 rng = stan::services::util::create_rng(0, 1);
+  sampler_t sampler(model, rng);
+  configure(sampler);
+  std::vector<double> cont_vector{0.5, -0.5};
+  stan::test::unit::instrumented_writer single_sample, single_diagnostic;
+  stan::test::unit::instrumented_logger single_logger;
+  stan::services::util::run_adaptive_sampler(
+      sampler, model, cont_vector, num_warmup, num_samples, num_thin, refresh,
+      save_warmup, rng, interrupt, single_logger, single_sample,
+      single_diagnostic);
+
+  EXPECT_EQ(single_logger.find_info("Iteration:"),
+            logger.find_info("Iteration:"));
+
+  std::vector<std::vector<double>> expected
+      = single_sample.vector_double_values();
+  std::vector<std::vector<double>> values
+      = sample_writer[0].vector_double_values();
+  ASSERT_EQ(expected.size(), values.size());
+  for (size_t n = 0; n < expected.size(); ++n) {
+    ASSERT_EQ(expected[n].size(), values[n].size());
+    for (size_t k = 0; k < expected[n].size(); ++k)
+      EXPECT_FLOAT_EQ(expected[n][k], values[n][k]);
+  }
+}
+
+TEST_F(ServicesUtilCrossChain, chains_share_metric) {
+  const size_t num_chains = 3;
+  make_chains(num_chains);
+  // The instrumented logger is not thread safe
+  stan::callbacks::logger shared_logger;
+  stan::services::util::run_cross_chain_adaptive_sampler(
+      samplers, model, cont_vectors, num_warmup, num_samples, num_thin,
+      refresh, save_warmup, rngs, interrupt, shared_logger, sample_writer,
+      diagnostic_writer);
+
+  int num_output_lines = (num_warmup + num_thin - 1) / num_thin
+                         + (num_samples + num_thin - 1) / num_thin;
+  for (size_t i = 0; i < num_chains; ++i) {
+    EXPECT_EQ(num_output_lines, sample_writer[i].call_count("vector_double"));
+    EXPECT_FALSE(samplers[i].get_var_adaptation().window_pending());
+    for (int k = 0; k < samplers[0].z().inv_e_metric_.size(); ++k)
+      EXPECT_EQ(samplers[0].z().inv_e_metric_(k),
+                samplers[i].z().inv_e_metric_(k));
+  }
+}
+
+TEST_F(ServicesUtilCrossChain, chains_share_stepsize_with_communicator) {
+  const size_t num_chains = 3;
+  make_chains(num_chains);
+  stan::callbacks::logger shared_logger;
+  stan::services::util::online_diagnostics diagnostics({"lp__"}, num_chains,
+                                                       0);
+  stan::services::util::chain_communicator communicator;
+  stan::services::util::run_options options;
+  options.diagnostics = &diagnostics;
+  options.communicator = &communicator;
+  stan::services::util::run_cross_chain_adaptive_sampler(
+      samplers, model, cont_vectors, num_warmup, num_samples, num_thin,
+      refresh, save_warmup, rngs, interrupt, shared_logger, sample_writer,
+      diagnostic_writer, 1, options);
+
+  for (size_t i = 0; i < num_chains; ++i) {
+    EXPECT_EQ(samplers[0].get_nominal_stepsize(),
+              samplers[i].get_nominal_stepsize());
+    for (int k = 0; k < samplers[0].z().inv_e_metric_.size(); ++k)
+      EXPECT_EQ(samplers[0].z().inv_e_metric_(k),
+                samplers[i].z().inv_e_metric_(k));
+  }
+  EXPECT_EQ(num_chains, diagnostics.num_registered());
+  EXPECT_EQ(static_cast<size_t>(num_samples), diagnostics.num_draws());
+}
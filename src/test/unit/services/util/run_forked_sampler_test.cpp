@@ -0,0 +1,76 @@
+#include <stan/services/util/run_forked_sampler.hpp>
+#include <gtest/gtest.h>
+#include <test/test-models/good/optimization/rosenbrock.hpp>
+#include <stan/io/empty_var_context.hpp>
+#include <stan/mcmc/hmc/hamiltonians/dense_e_metric.hpp>
+#include <stan/mcmc/hmc/nuts/adapt_dense_e_nuts.hpp>
+#include <stan/services/util/create_rng.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <vector>
+
+typedef stan::mcmc::adapt_dense_e_nuts<stan_model, boost::ecuyer1988>
+    sampler_t;
+
+class ServicesUtilForked : public testing::Test {
+ public:
+  ServicesUtilForked() : model(context, 0, &model_log), inv_metric(2, 2) {
+    inv_metric << 2.0, 0.5, 0.5, 1.0;
+  }
+
+  void make_chains(size_t num_warmup_chains, size_t num_chains) {
+    warmup_rngs.reserve(num_warmup_chains);
+    warmup_samplers.reserve(num_warmup_chains);
+    for (size_t w = 0; w < num_warmup_chains; ++w) {
+      warmup_rngs.emplace_back(stan::services::util::create_rng(0, w + 1));
+      warmup_samplers.emplace_back(model, warmup_rngs.back());
+      warmup_samplers.back().set_nominal_stepsize(0.1);
+      warmup_samplers.back().set_max_depth(6);
+      warmup_samplers.back().set_metric(inv_metric);
+      cont_vectors.push_back(std::vector<double>{0.5, -0.5});
+    }
+    rngs.reserve(num_chains);
+    samplers.reserve(num_chains);
+    for (size_t k = 0; k < num_chains; ++k) {
+      rngs.emplace_back(stan::services::util::create_rng(0, k + 1));
+      samplers.emplace_back(model, rngs.back());
+      sample_writer.emplace_back();
+      diagnostic_writer.emplace_back();
+    }
+  }
+
+  std::stringstream model_log;
+  stan::io::empty_var_context context;
+  stan_model model;
+  Eigen::MatrixXd inv_metric;
+  std::vector<boost::ecuyer1988> warmup_rngs;
+  std::vector<boost::ecuyer1988> rngs;
+  std::vector<sampler_t> warmup_samplers;
+  std::vector<sampler_t> samplers;
+  std::vector<std::vector<double>> cont_vectors;
+  std::vector<stan::test::unit::instrumented_writer> sample_writer;
+  std::vector<stan::test::unit::instrumented_writer> diagnostic_writer;
+  stan::callbacks::interrupt interrupt;
+  stan::test::unit::instrumented_logger logger;
+};
+
+TEST_F(ServicesUtilForked, momenta_drawn_from_inherited_metric) {
+  make_chains(2, 5);
+  // Without warmup draws the metric of the warmup chains isn't adapted
+  stan::services::util::run_forked_sampler(
+      warmup_samplers, samplers, model, cont_vectors, 0, 10, 1, 0, false,
+      warmup_rngs, rngs, interrupt, logger, sample_writer, diagnostic_writer);
+
+  stan::mcmc::dense_e_metric<stan_model, boost::ecuyer1988> metric(model);
+  stan::mcmc::dense_e_point reference(2);
+  reference.set_metric(inv_metric);
+  for (size_t k = 0; k < samplers.size(); ++k) {
+    EXPECT_TRUE(inv_metric.isApprox(samplers[k].z().inv_e_metric_));
+
+    boost::ecuyer1988 rng = stan::services::util::create_rng(1, k);
+    stan::mcmc::dense_e_point z = samplers[k].z();
+    metric.sample_p(z, rng);
+    rng = stan::services::util::create_rng(1, k);
+    metric.sample_p(reference, rng);
+    EXPECT_TRUE(reference.p.isApprox(z.p)) << "chain " << k;
+  }
+}
@@ -5,6 +5,7 @@
 #include <stan/services/util/create_rng.hpp>
 #include <test/unit/services/instrumented_callbacks.hpp>
 #include <stan/callbacks/stream_logger.hpp>
+#include <stan/callbacks/stream_writer.hpp>
 
 class mock_sampler : public stan::mcmc::base_mcmc {
  public:
@@ -241,3 +242,30 @@ TEST_F(ServicesUtil, num_warmup_num_samples_refresh) {
   EXPECT_EQ(num_samples, diagnostic_writer.call_count("vector_double"))
       << "draws";
 }
+
+TEST_F(ServicesUtil, memory_report) {
+  num_samples = 10;
+  std::stringstream memory_ss;
+  stan::callbacks::stream_writer memory_writer(memory_ss);
+  stan::services::util::memory_report memory(memory_writer);
+  stan::services::util::run_options options;
+  options.memory = &memory;
+
+  stan::services::util::run_sampler(
+      sampler, model, cont_vector, num_warmup, num_samples, num_thin, refresh,
+      save_warmup, rng, interrupt, logger, sample_writer, diagnostic_writer, 1,
+      1, options);
+  EXPECT_EQ(3 + 2, logger.call_count()) << "Nothing more is logged";
+
+  ASSERT_EQ(3U, memory.components().size());
+  EXPECT_EQ("autodiff_arena_per_gradient", memory.components()[0].name);
+  EXPECT_EQ("sampler_state", memory.components()[1].name);
+  EXPECT_EQ(0U, memory.components()[1].bytes) << "the mock has no state";
+  EXPECT_EQ("writer_buffers", memory.components()[2].name);
+  EXPECT_GT(memory.components()[2].bytes, 0U);
+  EXPECT_EQ(memory.components()[2].bytes + memory.components()[0].bytes,
+            memory.total_bytes());
+  EXPECT_EQ(0, memory_ss.str().find("component,bytes\n"));
+  EXPECT_NE(std::string::npos, memory_ss.str().find("\nwriter_buffers,"));
+  EXPECT_NE(std::string::npos, memory_ss.str().find("\ntotal,"));
+}
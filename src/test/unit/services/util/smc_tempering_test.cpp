@@ -0,0 +1,69 @@
+#include <stan/services/util/smc_tempering.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+TEST(SmcTempering, ess) {
+  Eigen::VectorXd equal = Eigen::VectorXd::Constant(8, -3.0);
+  EXPECT_FLOAT_EQ(8, stan::services::util::smc_ess(equal));
+
+  Eigen::VectorXd one(3);
+  one << 0, -std::numeric_limits<double>::infinity(),
+      std::numeric_limits<double>::quiet_NaN();
+  EXPECT_FLOAT_EQ(1, stan::services::util::smc_ess(one));
+
+  Eigen::VectorXd none
+      = Eigen::VectorXd::Constant(3, -std::numeric_limits<double>::infinity());
+  EXPECT_FLOAT_EQ(0, stan::services::util::smc_ess(none));
+}
+
+TEST(SmcTempering, log_mean_exp) {
+  Eigen::VectorXd log_weights(2);
+  log_weights << std::log(1.0), std::log(3.0);
+  EXPECT_FLOAT_EQ(std::log(2.0),
+                  stan::services::util::smc_log_mean_exp(log_weights));
+
+  log_weights << 1000, -std::numeric_limits<double>::infinity();
+  EXPECT_FLOAT_EQ(1000 - std::log(2.0),
+                  stan::services::util::smc_log_mean_exp(log_weights));
+}
+
+TEST(SmcTempering, next_inverse_temperature) {
+  // Identical particles keep the full sample size all the way
+  Eigen::VectorXd flat = Eigen::VectorXd::Constant(10, -5.0);
+  EXPECT_FLOAT_EQ(
+      1, stan::services::util::smc_next_inverse_temperature(flat, 0.2, 0.5));
+
+  Eigen::VectorXd log_ratios(10);
+  for (int i = 0; i < 10; ++i)
+    log_ratios(i) = -100.0 * i;
+  double beta
+      = stan::services::util::smc_next_inverse_temperature(log_ratios, 0, 0.5);
+  EXPECT_GT(beta, 0);
+  EXPECT_LT(beta, 1);
+  EXPECT_NEAR(5, stan::services::util::smc_ess(beta * log_ratios), 1e-6);
+
+  double next = stan::services::util::smc_next_inverse_temperature(
+      log_ratios, beta, 0.5);
+  EXPECT_GT(next, beta);
+}
+
+TEST(SmcTempering, systematic_resample) {
+  Eigen::VectorXd log_weights(4);
+  log_weights << std::log(0.5), std::log(0.25), std::log(0.25),
+      -std::numeric_limits<double>::infinity();
+
+  std::vector<size_t> indices
+      = stan::services::util::smc_systematic_resample(log_weights, 0.1);
+  ASSERT_EQ(4U, indices.size());
+  EXPECT_EQ(0U, indices[0]);
+  EXPECT_EQ(0U, indices[1]);
+  EXPECT_EQ(1U, indices[2]);
+  EXPECT_EQ(2U, indices[3]);
+
+  Eigen::VectorXd equal = Eigen::VectorXd::Zero(5);
+  indices = stan::services::util::smc_systematic_resample(equal, 0.99);
+  for (size_t i = 0; i < 5; ++i)
+    EXPECT_EQ(i, indices[i]);
+}
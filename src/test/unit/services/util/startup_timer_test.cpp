@@ -0,0 +1,43 @@
+#include <stan/services/util/startup_timer.hpp>
+#include <stan/callbacks/logger.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ServicesUtilStartupTimer, records_phases) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::startup_timer timer(writer);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  timer.record("data");
+  timer.record("model");
+
+  ASSERT_EQ(2U, timer.phases().size());
+  EXPECT_EQ("data", timer.phases()[0].name);
+  EXPECT_GE(timer.phases()[0].seconds, 0.01);
+  EXPECT_EQ("model", timer.phases()[1].name);
+  EXPECT_LT(timer.phases()[1].seconds, timer.phases()[0].seconds);
+  EXPECT_FLOAT_EQ(timer.phases()[0].seconds + timer.phases()[1].seconds,
+                  timer.total_seconds());
+  EXPECT_FALSE(timer.written());
+}
+
+TEST(ServicesUtilStartupTimer, write) {
+  stan::test::unit::instrumented_writer writer;
+  stan::services::util::startup_timer timer(writer);
+  timer.record("initialize");
+  timer.record("first_transition");
+  timer.write();
+  EXPECT_TRUE(timer.written());
+
+  std::vector<std::vector<std::string>> rows
+      = writer.vector_string_values();
+  ASSERT_EQ(4U, rows.size());
+  EXPECT_EQ((std::vector<std::string>{"phase", "seconds"}), rows[0]);
+  EXPECT_EQ("initialize", rows[1][0]);
+  EXPECT_EQ("first_transition", rows[2][0]);
+  EXPECT_EQ("total", rows[3][0]);
+  EXPECT_FLOAT_EQ(timer.total_seconds(), std::stod(rows[3][1]));
+}
@@ -0,0 +1,99 @@
+#include <stan/services/util/thread_budget.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+/**
+ * Counts the threads busy at once and the threads each chain used.
+ */
+struct thread_usage {
+  std::atomic<int> busy{0};
+  std::atomic<int> max_busy{0};
+  std::mutex mutex;
+  std::vector<std::set<std::thread::id>> chain_threads;
+
+  explicit thread_usage(size_t num_chains) : chain_threads(num_chains) {}
+
+  void work(size_t chain, int tasks) {
+    tbb::parallel_for(0, tasks, [&](int) {
+      int now = ++busy;
+      int seen = max_busy;
+      while (now > seen && !max_busy.compare_exchange_weak(seen, now)) {
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chain_threads[chain].insert(std::this_thread::get_id());
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      --busy;
+    });
+  }
+};
+}  // namespace
+
+TEST(ServicesUtilThreadBudget, division) {
+  stan::services::util::thread_budget budget(8, 4);
+  EXPECT_EQ(4U, budget.concurrent_chains());
+  EXPECT_EQ(2, budget.chain_threads());
+  EXPECT_EQ(5, budget.max_chain_threads());
+
+  stan::services::util::thread_budget wide(8, 4, 4);
+  EXPECT_EQ(2U, wide.concurrent_chains());
+  EXPECT_EQ(4, wide.chain_threads());
+  EXPECT_EQ(7, wide.max_chain_threads());
+
+  stan::services::util::thread_budget narrow(2, 4);
+  EXPECT_EQ(2U, narrow.concurrent_chains());
+  EXPECT_EQ(1, narrow.chain_threads());
+
+  stan::test::unit::instrumented_logger logger;
+  budget.log(logger);
+  EXPECT_EQ(1, logger.find_info("8 threads, 4 of 4 chains at once with 2"));
+
+  EXPECT_THROW(stan::services::util::thread_budget(0, 4),
+               std::invalid_argument);
+  EXPECT_THROW(stan::services::util::thread_budget(4, 0),
+               std::invalid_argument);
+}
+
+TEST(ServicesUtilThreadBudget, chains_run_in_their_own_arenas) {
+  stan::services::util::thread_budget budget(4, 3, 2);
+  thread_usage usage(3);
+  std::vector<int> concurrency(3);
+  std::atomic<int> running{0}, max_running{0};
+  budget.for_each_chain([&](size_t i) {
+    int now = ++running;
+    int seen = max_running;
+    while (now > seen && !max_running.compare_exchange_weak(seen, now)) {
+    }
+    concurrency[i] = tbb::this_task_arena::max_concurrency();
+    usage.work(i, 40);
+    --running;
+  });
+  EXPECT_LE(max_running, 2);
+  for (int c : concurrency)
+    EXPECT_EQ(3, c);
+  EXPECT_LE(usage.max_busy, 4);
+}
+
+TEST(ServicesUtilThreadBudget, finished_chains_free_their_threads) {
+  stan::services::util::thread_budget budget(4, 2);
+  thread_usage usage(2);
+  budget.for_each_chain([&](size_t i) {
+    if (i == 1)
+      usage.work(i, 200);
+  });
+  // Chain 0 ends at once, so chain 1 gets the threads it would have had
+  EXPECT_GT(usage.chain_threads[1].size(), 2U);
+  EXPECT_LE(usage.max_busy, 4);
+}
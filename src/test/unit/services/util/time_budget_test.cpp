@@ -0,0 +1,44 @@
+#include <stan/services/util/time_budget.hpp>
+#include <test/unit/services/instrumented_callbacks.hpp>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+TEST(ServicesUtilTimeBudget, throws_unless_positive) {
+  EXPECT_THROW(stan::services::util::time_budget(0), std::invalid_argument);
+  EXPECT_THROW(stan::services::util::time_budget(-1), std::invalid_argument);
+  EXPECT_NO_THROW(stan::services::util::time_budget(1e-3));
+}
+
+TEST(ServicesUtilTimeBudget, expires) {
+  stan::services::util::time_budget budget(0.01);
+  EXPECT_FLOAT_EQ(0.01, budget.seconds());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(budget.expired());
+  EXPECT_GE(budget.elapsed_seconds(), 0.01);
+  EXPECT_EQ(0, budget.remaining_seconds());
+  EXPECT_EQ(0, budget.planned_iterations(0.001, 100));
+
+  stan::services::util::time_budget long_budget(3600);
+  EXPECT_FALSE(long_budget.expired());
+  EXPECT_GT(long_budget.remaining_seconds(), 3500);
+}
+
+TEST(ServicesUtilTimeBudget, planned_iterations) {
+  stan::services::util::time_budget budget(100);
+  EXPECT_EQ(1000, budget.planned_iterations(0.01, 1000));
+  int planned = budget.planned_iterations(1, 1000);
+  EXPECT_LE(planned, 100);
+  EXPECT_GE(planned, 98);
+  EXPECT_EQ(1000, budget.planned_iterations(0, 1000));
+}
+
+TEST(ServicesUtilTimeBudget, log_plan) {
+  stan::services::util::time_budget budget(100);
+  stan::test::unit::instrumented_logger logger;
+  budget.log_plan(0.01, 1000, logger);
+  EXPECT_EQ(0, logger.find_info("Time budget"));
+  budget.log_plan(1, 1000, logger);
+  EXPECT_EQ(1, logger.find_info("sampling iterations fit in the remaining"));
+}
@@ -0,0 +1,61 @@
+#include <stan/util/deterministic_reduce.hpp>
+#include <gtest/gtest.h>
+#include <tbb/task_arena.h>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(UtilDeterministicReduce, tree_shape) {
+  // Non-commutative combination that records the shape of the tree
+  auto map = [](size_t begin, size_t end) {
+    std::string chunk;
+    for (size_t i = begin; i < end; ++i)
+      chunk += std::to_string(i);
+    return chunk;
+  };
+  auto combine = [](const std::string& left, const std::string& right) {
+    return "(" + left + " " + right + ")";
+  };
+
+  EXPECT_EQ("((01 23) 4)", stan::util::deterministic_reduce(
+                               5, 2, std::string(), map, combine));
+  EXPECT_EQ("((0 1) (2 3))", stan::util::deterministic_reduce(
+                                 4, 1, std::string(), map, combine));
+  EXPECT_EQ("012", stan::util::deterministic_reduce(
+                       3, 8, std::string(), map, combine));
+  EXPECT_EQ("empty", stan::util::deterministic_reduce(
+                         0, 2, std::string("empty"), map, combine));
+  EXPECT_THROW(stan::util::deterministic_reduce(
+                   3, 0, std::string(), map, combine),
+               std::invalid_argument);
+}
+
+TEST(UtilDeterministicReduce, independent_of_threads) {
+  // Values whose sum depends on the order of the additions
+  std::vector<double> x(100003);
+  for (size_t i = 0; i < x.size(); ++i)
+    x[i] = std::sin(i) * std::pow(10.0, static_cast<double>(i % 17) - 8);
+
+  double reference;
+  tbb::task_arena single(1);
+  single.execute([&] {
+    reference = stan::util::deterministic_sum(x);
+  });
+  for (int threads : {2, 3, 4, 8}) {
+    tbb::task_arena arena(threads);
+    for (int rep = 0; rep < 5; ++rep) {
+      double sum;
+      arena.execute([&] { sum = stan::util::deterministic_sum(x); });
+      EXPECT_EQ(reference, sum) << threads << " threads";
+    }
+  }
+
+  long double exact = 0;
+  double magnitude = 0;
+  for (double v : x) {
+    exact += v;
+    magnitude += std::fabs(v);
+  }
+  EXPECT_NEAR(static_cast<double>(exact), reference, 1e-14 * magnitude);
+}
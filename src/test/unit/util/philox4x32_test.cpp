@@ -0,0 +1,116 @@
+#include <stan/util/philox4x32.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+using stan::util::philox4x32;
+
+namespace {
+std::vector<std::uint32_t> encrypt(std::uint32_t c0, std::uint32_t c1,
+                                   std::uint32_t c2, std::uint32_t c3,
+                                   std::uint32_t k0, std::uint32_t k1) {
+  std::uint32_t counter[4] = {c0, c1, c2, c3};
+  std::uint32_t key[2] = {k0, k1};
+  std::uint32_t out[4];
+  philox4x32::encrypt(counter, key, out);
+  return std::vector<std::uint32_t>(out, out + 4);
+}
+}  // namespace
+
+// Known answers of Philox4x32-10 from the Random123 distribution
+TEST(UtilPhilox4x32, known_answers) {
+  EXPECT_EQ((std::vector<std::uint32_t>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                        0x9b00dbd8}),
+            encrypt(0, 0, 0, 0, 0, 0));
+  EXPECT_EQ((std::vector<std::uint32_t>{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                        0x6d5451fd}),
+            encrypt(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+                    0xffffffff, 0xffffffff));
+  EXPECT_EQ((std::vector<std::uint32_t>{0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                        0x24126ea1}),
+            encrypt(0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
+                    0xa4093822, 0x299f31d0));
+}
+
+TEST(UtilPhilox4x32, outputs_blocks_in_order) {
+  philox4x32 rng(0xa4093822, 0x299f31d0, 0x13198a2e, 0x03707344);
+  std::vector<std::uint32_t> first = encrypt(0, 0, 0x13198a2e, 0x03707344,
+                                             0xa4093822, 0x299f31d0);
+  std::vector<std::uint32_t> second = encrypt(1, 0, 0x13198a2e, 0x03707344,
+                                              0xa4093822, 0x299f31d0);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(first[i], rng());
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(second[i], rng());
+  EXPECT_EQ(8U, rng.position());
+}
+
+TEST(UtilPhilox4x32, discard) {
+  philox4x32 a(1, 2);
+  philox4x32 b(1, 2);
+  for (int i = 0; i < 11; ++i)
+    a();
+  b.discard(11);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a(), b());
+
+  philox4x32 far(1, 2);
+  far.discard(std::uint64_t(1) << 40);
+  EXPECT_EQ(std::uint64_t(1) << 40, far.position());
+  far();
+}
+
+TEST(UtilPhilox4x32, streams_differ) {
+  philox4x32 rng(1, 2);
+  philox4x32 chain(1, 3);
+  philox4x32 sub = rng.substream(1, 0);
+  EXPECT_EQ(1U, sub.purpose());
+  EXPECT_EQ(0U, sub.index());
+  EXPECT_EQ(philox4x32(1, 2, 1, 0), sub);
+  EXPECT_NE(rng, sub);
+  std::uint32_t x = rng();
+  EXPECT_NE(x, chain());
+  EXPECT_NE(x, sub());
+  EXPECT_NE(x, rng.substream(0, 1)());
+}
+
+TEST(UtilPhilox4x32, stream_operators) {
+  philox4x32 rng(7, 3, 1, 5);
+  rng.discard(6);
+  std::stringstream ss;
+  ss << rng;
+  philox4x32 restored;
+  ss >> restored;
+  EXPECT_EQ(rng, restored);
+  EXPECT_EQ(rng(), restored());
+
+  std::stringstream bad("7 3");
+  philox4x32 unchanged;
+  EXPECT_FALSE(bad >> unchanged);
+  EXPECT_EQ(philox4x32(), unchanged);
+}
+
+TEST(UtilPhilox4x32, boost_distributions) {
+  philox4x32 rng(42, 1);
+  boost::variate_generator<philox4x32&, boost::uniform_01<>> uniform(
+      rng, boost::uniform_01<>());
+  double sum = 0;
+  for (int n = 0; n < 10000; ++n) {
+    double u = uniform();
+    EXPECT_GE(u, 0);
+    EXPECT_LT(u, 1);
+    sum += u;
+  }
+  EXPECT_NEAR(0.5, sum / 10000, 0.02);
+
+  boost::variate_generator<philox4x32&, boost::normal_distribution<>> normal(
+      rng, boost::normal_distribution<>());
+  sum = 0;
+  for (int n = 0; n < 10000; ++n)
+    sum += normal();
+  EXPECT_NEAR(0, sum / 10000, 0.05);
+}
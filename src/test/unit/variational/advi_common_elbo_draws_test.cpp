@@ -0,0 +1,83 @@
+#include <test/test-models/good/variational/multivariate_no_constraint.hpp>
+#include <stan/variational/advi.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <gtest/gtest.h>
+#include <test/unit/util.hpp>
+#include <vector>
+#include <string>
+#include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+
+typedef boost::ecuyer1988 rng_t;
+typedef multivariate_no_constraint_model_namespace::
+    multivariate_no_constraint_model Model;
+
+class advi_common_elbo_draws_test : public testing::Test {
+ public:
+  advi_common_elbo_draws_test()
+      : data_stream(""),
+        dummy_context(data_stream),
+        my_model(dummy_context),
+        base_rng(0),
+        logger(log_stream, log_stream, log_stream, log_stream, log_stream),
+        cont_params(Eigen::VectorXd::Constant(2, 0.75)) {}
+
+  // ELBO of the model for a normal approximation with identity
+  // covariance and the specified mean
+  double elbo_true(const Eigen::VectorXd& mu) {
+    double zeta = -0.5 * (3 * 2 * log(2.0 * stan::math::pi()) + 18.5 + 25 + 13);
+    Eigen::VectorXd mu_J(2);
+    mu_J << 10.5, 7.5;
+    return zeta + mu_J.dot(mu) - 0.5 * (3 * mu.dot(mu) + 3 * 2) + 1
+           + log(2.0 * stan::math::pi());
+  }
+
+  std::stringstream data_stream;
+  stan::io::dump dummy_context;
+  Model my_model;
+  rng_t base_rng;
+  std::stringstream log_stream;
+  stan::callbacks::stream_logger logger;
+  Eigen::VectorXd cont_params;
+};
+
+TEST_F(advi_common_elbo_draws_test, meanfield) {
+  stan::variational::advi<Model, stan::variational::normal_meanfield, rng_t>
+      test_advi(my_model, cont_params, base_rng, 10, 2000, 100, 1, true);
+
+  Eigen::VectorXd mu = Eigen::VectorXd::Constant(2, 2.5);
+  stan::variational::normal_meanfield q(mu, Eigen::VectorXd::Zero(2));
+  double elbo = test_advi.calc_ELBO(q, logger);
+  EXPECT_NEAR(elbo_true(mu), elbo, 0.3);
+
+  // The same draws are used again
+  EXPECT_FLOAT_EQ(elbo, test_advi.calc_ELBO(q, logger));
+
+  // The antithetic pairs cancel the linear terms, so a shift in the mean
+  // changes the estimate by exactly the change in the ELBO
+  Eigen::VectorXd mu_shifted = Eigen::VectorXd::Constant(2, 1.5);
+  q.set_mu(mu_shifted);
+  EXPECT_NEAR(elbo_true(mu_shifted) - elbo_true(mu),
+              test_advi.calc_ELBO(q, logger) - elbo, 1e-6);
+}
+
+TEST_F(advi_common_elbo_draws_test, fullrank) {
+  stan::variational::advi<Model, stan::variational::normal_fullrank, rng_t>
+      test_advi(my_model, cont_params, base_rng, 10, 2000, 100, 1, true);
+
+  Eigen::VectorXd mu = Eigen::VectorXd::Constant(2, 2.5);
+  stan::variational::normal_fullrank q(mu, Eigen::MatrixXd::Identity(2, 2));
+  double elbo = test_advi.calc_ELBO(q, logger);
+  EXPECT_NEAR(elbo_true(mu), elbo, 0.3);
+  EXPECT_FLOAT_EQ(elbo, test_advi.calc_ELBO(q, logger));
+}
+
+TEST_F(advi_common_elbo_draws_test, lowrank) {
+  stan::variational::advi<Model, stan::variational::normal_lowrank, rng_t>
+      test_advi(my_model, cont_params, base_rng, 10, 2000, 100, 1, true);
+
+  Eigen::VectorXd mu = Eigen::VectorXd::Constant(2, 2.5);
+  stan::variational::normal_lowrank q(mu, 1);
+  double elbo = test_advi.calc_ELBO(q, logger);
+  EXPECT_NEAR(elbo_true(mu), elbo, 0.3);
+  EXPECT_FLOAT_EQ(elbo, test_advi.calc_ELBO(q, logger));
+}
@@ -0,0 +1,125 @@
+#include <stan/variational/advi.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <stan/model/prob_grad.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+#include <tbb/task_arena.h>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+// Standard normal model whose log density fails for the draws with a
+// first coordinate above a threshold and which prints every draw it
+// evaluates
+class failing_normal_model : public stan::model::prob_grad {
+ public:
+  failing_normal_model(size_t num_params_r, double threshold)
+      : stan::model::prob_grad(num_params_r), threshold_(threshold) {}
+
+  template <bool propto, bool jacobian_adjust_transforms, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+             std::ostream* output_stream = 0) const {
+    if (stan::math::value_of(params_r(0)) > threshold_)
+      throw std::domain_error("draw out of support");
+    if (output_stream)
+      *output_stream << "draw " << stan::math::value_of(params_r(0));
+    return -0.5 * params_r.dot(params_r);
+  }
+
+ private:
+  double threshold_;
+};
+
+class advi_parallel_elbo_test : public testing::Test {
+ public:
+  advi_parallel_elbo_test()
+      : cont_params(Eigen::VectorXd::Zero(2)),
+        mu(2),
+        logger(log_stream, log_stream, log_stream, log_stream, log_stream) {
+    mu << 0.3, -0.2;
+  }
+
+  // ELBO of the model for the specified approximation evaluated one
+  // draw after the other from the specified RNG, replacing each failed
+  // draw by the next one, with the messages of the draws logged to
+  // log_stream
+  double serial_elbo(const failing_normal_model& model,
+                     const stan::variational::normal_meanfield& q, rng_t& rng,
+                     int n_draws, int& n_dropped) {
+    std::vector<double> log_probs;
+    Eigen::VectorXd zeta(q.dimension());
+    n_dropped = 0;
+    while (static_cast<int>(log_probs.size()) < n_draws) {
+      q.sample(rng, zeta);
+      std::stringstream ss;
+      try {
+        log_probs.push_back(model.log_prob<false, true>(zeta, &ss));
+        logger.info(ss);
+      } catch (const std::domain_error& e) {
+        if (++n_dropped >= n_draws)
+          throw;
+      }
+    }
+    return stan::util::deterministic_sum(log_probs) / n_draws + q.entropy();
+  }
+
+  Eigen::VectorXd cont_params;
+  Eigen::VectorXd mu;
+  std::stringstream log_stream;
+  stan::callbacks::stream_logger logger;
+};
+
+TEST_F(advi_parallel_elbo_test, matches_serial_evaluation) {
+  // About a quarter of the draws fail and are redrawn in later batches
+  failing_normal_model model(2, 0.7);
+  stan::variational::normal_meanfield q(mu, Eigen::VectorXd::Zero(2));
+
+  rng_t reference_rng(7);
+  int n_dropped;
+  double reference = serial_elbo(model, q, reference_rng, 200, n_dropped);
+  std::string reference_log = log_stream.str();
+  ASSERT_GT(n_dropped, 0);
+
+  // With STAN_THREADS the batch is spread over the threads of the arena
+  for (int threads : {1, 2, 4}) {
+    tbb::task_arena arena(threads);
+    rng_t rng(7);
+    stan::variational::advi<failing_normal_model,
+                            stan::variational::normal_meanfield, rng_t>
+        test_advi(model, cont_params, rng, 1, 200, 1, 1);
+    log_stream.str("");
+    double elbo;
+    arena.execute([&] { elbo = test_advi.calc_ELBO(q, logger); });
+    EXPECT_EQ(reference, elbo) << threads << " threads";
+    EXPECT_EQ(reference_log, log_stream.str()) << threads << " threads";
+    // The failed draws were replaced by the same number of new ones
+    EXPECT_TRUE(reference_rng == rng) << threads << " threads";
+  }
+}
+
+TEST_F(advi_parallel_elbo_test, throws_when_all_draws_fail) {
+  failing_normal_model model(2, -std::numeric_limits<double>::infinity());
+  stan::variational::normal_meanfield q(mu, Eigen::VectorXd::Zero(2));
+
+  rng_t reference_rng(7);
+  int n_dropped;
+  EXPECT_THROW(serial_elbo(model, q, reference_rng, 50, n_dropped),
+               std::domain_error);
+
+  for (int threads : {1, 4}) {
+    tbb::task_arena arena(threads);
+    rng_t rng(7);
+    stan::variational::advi<failing_normal_model,
+                            stan::variational::normal_meanfield, rng_t>
+        test_advi(model, cont_params, rng, 1, 50, 1, 1);
+    arena.execute([&] {
+      EXPECT_THROW(test_advi.calc_ELBO(q, logger), std::domain_error);
+    });
+    EXPECT_TRUE(reference_rng == rng) << threads << " threads";
+  }
+  EXPECT_EQ("", log_stream.str());
+}
@@ -0,0 +1,74 @@
+#include <stan/variational/advi_state.hpp>
+#include <stan/variational/families/normal_fullrank.hpp>
+#include <stan/variational/families/normal_meanfield.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using stan::variational::ascent_method;
+using stan::variational::ascent_update;
+using stan::variational::normal_fullrank;
+using stan::variational::normal_meanfield;
+
+TEST(advi_state_test, round_trip) {
+  Eigen::VectorXd mu(2);
+  mu << 0.5, -1.0 / 3;
+  Eigen::MatrixXd L(2, 2);
+  L << 1.2, 0, -0.7, 0.4;
+  normal_fullrank q(mu, L);
+  ascent_update<normal_fullrank> update(ascent_method::adagrad, q);
+  normal_fullrank grad(mu, L);
+  update(q, grad, 0.1);
+  update(q, grad, 0.1);
+
+  std::stringstream state(stan::variational::write_advi_state(q, update, 0.1));
+
+  normal_fullrank q_restored(2);
+  ascent_update<normal_fullrank> update_restored(ascent_method::adam,
+                                                 q_restored);
+  double eta = 1;
+  stan::variational::read_advi_state(state, q_restored, update_restored, eta);
+  EXPECT_EQ(0.1, eta);
+  EXPECT_EQ(q.mu(), q_restored.mu());
+  EXPECT_EQ(q.L_chol(), q_restored.L_chol());
+  EXPECT_EQ(ascent_method::adagrad, update_restored.method());
+  EXPECT_EQ(2, update_restored.iterations());
+
+  update(q, grad, 0.1);
+  update_restored(q_restored, grad, 0.1);
+  EXPECT_EQ(q.mu(), q_restored.mu());
+  EXPECT_EQ(q.L_chol(), q_restored.L_chol());
+}
+
+TEST(advi_state_test, mismatch) {
+  normal_meanfield q(Eigen::VectorXd::Constant(3, 0.5));
+  ascent_update<normal_meanfield> update(ascent_method::adagrad, q);
+  std::string state = stan::variational::write_advi_state(q, update, 1.0);
+
+  // Another dimension
+  normal_meanfield q_small(2);
+  ascent_update<normal_meanfield> update_small(ascent_method::adagrad,
+                                               q_small);
+  double eta = 0.5;
+  std::stringstream in(state);
+  EXPECT_THROW(
+      stan::variational::read_advi_state(in, q_small, update_small, eta),
+      std::invalid_argument);
+  EXPECT_EQ(0.5, eta);
+  EXPECT_TRUE(q_small.mu().isZero());
+
+  // Another family
+  normal_fullrank q_fullrank(3);
+  ascent_update<normal_fullrank> update_fullrank(ascent_method::adagrad,
+                                                 q_fullrank);
+  std::stringstream in_fullrank(state);
+  EXPECT_THROW(stan::variational::read_advi_state(in_fullrank, q_fullrank,
+                                                  update_fullrank, eta),
+               std::invalid_argument);
+
+  // Truncated
+  std::stringstream truncated(state.substr(0, state.size() / 2));
+  normal_meanfield q_same(3);
+  EXPECT_THROW(
+      stan::variational::read_advi_state(truncated, q_same, update, eta),
+      std::invalid_argument);
+}
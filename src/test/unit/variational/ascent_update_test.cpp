@@ -0,0 +1,138 @@
+#include <stan/variational/ascent_update.hpp>
+#include <stan/variational/families/normal_meanfield.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+
+using stan::variational::ascent_method;
+using stan::variational::ascent_update;
+using stan::variational::normal_meanfield;
+
+class ascent_update_test : public testing::Test {
+ public:
+  ascent_update_test() : mu(2), omega(2), mu_grad(2), omega_grad(2) {
+    mu << 0.5, -1.5;
+    omega << 0.2, -0.3;
+    mu_grad << 2.0, -0.25;
+    omega_grad << -1.0, 0.5;
+  }
+
+  Eigen::VectorXd mu, omega, mu_grad, omega_grad;
+};
+
+TEST_F(ascent_update_test, adagrad) {
+  normal_meanfield q(mu, omega);
+  normal_meanfield grad(mu_grad, omega_grad);
+  ascent_update<normal_meanfield> update(ascent_method::adagrad, q);
+
+  double eta = 0.1;
+  update(q, grad, eta);
+  Eigen::VectorXd hist_mu = mu_grad.array().square();
+  Eigen::VectorXd mu_expected
+      = mu.array() + eta * mu_grad.array() / (1 + hist_mu.array().sqrt());
+  EXPECT_TRUE(q.mu().isApprox(mu_expected));
+
+  update(q, grad, eta);
+  hist_mu = 0.9 * hist_mu.array() + 0.1 * mu_grad.array().square();
+  mu_expected.array() += eta / std::sqrt(2.0) * mu_grad.array()
+                         / (1 + hist_mu.array().sqrt());
+  EXPECT_TRUE(q.mu().isApprox(mu_expected));
+}
+
+TEST_F(ascent_update_test, adam) {
+  normal_meanfield q(mu, omega);
+  normal_meanfield grad(mu_grad, omega_grad);
+  ascent_update<normal_meanfield> update(ascent_method::adam, q);
+
+  // The bias corrected first step has length eta in every coordinate
+  double eta = 0.1;
+  update(q, grad, eta);
+  EXPECT_EQ(1, update.iterations());
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_NEAR(mu(i) + eta * (mu_grad(i) > 0 ? 1 : -1), q.mu()(i), 1e-6);
+    EXPECT_NEAR(omega(i) + eta * (omega_grad(i) > 0 ? 1 : -1), q.omega()(i),
+                1e-6);
+  }
+
+  // A reset forgets the moments
+  normal_meanfield q_reset(mu, omega);
+  update.reset();
+  EXPECT_EQ(0, update.iterations());
+  update(q_reset, grad, eta);
+  EXPECT_TRUE(q_reset.mu().isApprox(q.mu()));
+}
+
+TEST_F(ascent_update_test, natural_gradient) {
+  normal_meanfield q(mu, omega);
+  normal_meanfield grad(mu_grad, omega_grad);
+  ascent_update<normal_meanfield> update(ascent_method::natural_gradient, q);
+
+  // Steps along a zero gradient only advance the step size decay
+  double eta = 0.1;
+  normal_meanfield zero(2);
+  for (int n = 0; n < 3; ++n)
+    update(q, zero, eta);
+  EXPECT_EQ(3, update.iterations());
+  normal_meanfield natural = q.natural_gradient(grad);
+  update(q, grad, eta);
+  EXPECT_TRUE(q.mu().isApprox(mu + 0.5 * eta * natural.mu()));
+  EXPECT_TRUE(q.omega().isApprox(omega + 0.5 * eta * natural.omega()));
+}
+
+TEST_F(ascent_update_test, converges_on_gaussian_target) {
+  // Exact ELBO gradient for a N(m, s^2) target
+  Eigen::VectorXd m(2);
+  m << 1.0, -2.0;
+  Eigen::VectorXd s(2);
+  s << 0.5, 2.0;
+  for (ascent_method method :
+       {ascent_method::adagrad, ascent_method::adam,
+        ascent_method::natural_gradient}) {
+    normal_meanfield q(2);
+    ascent_update<normal_meanfield> update(method, q);
+    for (int iter = 1; iter <= 5000; ++iter) {
+      Eigen::VectorXd sigma2 = (2 * q.omega()).array().exp();
+      normal_meanfield grad(
+          Eigen::VectorXd((m - q.mu()).array() / s.array().square()),
+          Eigen::VectorXd(1 - sigma2.array() / s.array().square()));
+      update(q, grad, 0.5);
+    }
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_NEAR(m(i), q.mu()(i), 1e-2);
+      EXPECT_NEAR(std::log(s(i)), q.omega()(i), 1e-2);
+    }
+  }
+}
+
+TEST_F(ascent_update_test, state) {
+  normal_meanfield q(mu, omega);
+  normal_meanfield grad(mu_grad, omega_grad);
+  ascent_update<normal_meanfield> update(ascent_method::adam, q);
+  for (int n = 0; n < 3; ++n)
+    update(q, grad, 0.1);
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  update.write_state(writer);
+
+  normal_meanfield q_restored(q);
+  ascent_update<normal_meanfield> restored(ascent_method::adagrad, q);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(ascent_method::adam, restored.method());
+  EXPECT_EQ(3, restored.iterations());
+
+  // The restored update continues exactly as the original
+  update(q, grad, 0.1);
+  restored(q_restored, grad, 0.1);
+  EXPECT_EQ(q.mu(), q_restored.mu());
+  EXPECT_EQ(q.omega(), q_restored.omega());
+
+  std::stringstream other_state;
+  stan::mcmc::state_writer other_writer(other_state);
+  ascent_update<normal_meanfield>(ascent_method::adam, normal_meanfield(3))
+      .write_state(other_writer);
+  stan::mcmc::state_reader other_reader(other_state);
+  EXPECT_THROW(restored.read_state(other_reader), std::invalid_argument);
+  EXPECT_EQ(4, restored.iterations());
+}
@@ -1,8 +1,35 @@
 #include <stan/variational/families/normal_fullrank.hpp>
+#include <stan/variational/families/normal_meanfield.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <sstream>
 #include <vector>
 #include <gtest/gtest.h>
 #include <test/unit/util.hpp>
 
+// Correlated normal target, log p(x) = -0.5 * x' * A * x + c' * x
+struct correlated_normal_model {
+  Eigen::MatrixXd A;
+  Eigen::VectorXd c;
+
+  correlated_normal_model() : A(3, 3), c(3) {
+    A << 2.0, 0.6, 0.1, 0.6, 1.5, -0.3, 0.1, -0.3, 1.0;
+    c << 0.5, -1.0, 0.25;
+  }
+
+  template <bool propto, bool jacobian_adjust_transform, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& x,
+             std::ostream* msgs = 0) const {
+    T lp = 0;
+    for (int i = 0; i < x.size(); ++i) {
+      lp += c(i) * x(i);
+      for (int j = 0; j < x.size(); ++j)
+        lp -= 0.5 * A(i, j) * x(i) * x(j);
+    }
+    return lp;
+  }
+};
+
 TEST(normal_fullrank_test, zero_init) {
   int my_dimension = 10;
 
@@ -157,3 +184,145 @@ TEST(normal_fullrank_test, calc_log_g) {
 
   EXPECT_FLOAT_EQ(log_g_out, log_g_true);
 }
+
+TEST(normal_fullrank_test, sample_log_g_batch) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Matrix3d L;
+  L << 1.3, 0, 0, 2.3, 41, 0, 3.3, 42, 92;
+  stan::variational::normal_fullrank my_normal_fullrank(mu, L);
+  boost::ecuyer1988 rng_batch(1234);
+  boost::ecuyer1988 rng_single(1234);
+
+  Eigen::MatrixXd draws;
+  Eigen::VectorXd log_g;
+  my_normal_fullrank.sample_log_g(rng_batch, 5, draws, log_g);
+  ASSERT_EQ(3, draws.rows());
+  ASSERT_EQ(5, draws.cols());
+
+  Eigen::VectorXd draw(3);
+  double log_g_single;
+  for (int j = 0; j < 5; ++j) {
+    my_normal_fullrank.sample_log_g(rng_single, draw, log_g_single);
+    for (int i = 0; i < 3; ++i)
+      EXPECT_FLOAT_EQ(draw(i), draws(i, j));
+    EXPECT_FLOAT_EQ(log_g_single, log_g(j));
+  }
+}
+
+TEST(normal_fullrank_test, natural_gradient) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Matrix3d L;
+  L << 1.3, 0, 0, 2.3, 0.41, 0, 3.3, -0.42, 0.92;
+  stan::variational::normal_fullrank my_normal_fullrank(mu, L);
+
+  Eigen::Vector3d mu_grad;
+  mu_grad << 0.3, -1.2, 2.5;
+  Eigen::Matrix3d L_grad;
+  L_grad << 1.1, 0, 0, 0.4, -0.8, 0, 0.7, 0.2, -1.5;
+  stan::variational::normal_fullrank grad(mu_grad, L_grad);
+
+  stan::variational::normal_fullrank natural
+      = my_normal_fullrank.natural_gradient(grad);
+
+  // The Fisher information applied to the natural gradient must give
+  // back the gradient, checked against every lower triangular direction
+  Eigen::Matrix3d Sigma = L * L.transpose();
+  Eigen::Matrix3d Sigma_inv = Sigma.inverse();
+  EXPECT_TRUE((Sigma_inv * natural.mu()).isApprox(mu_grad));
+  Eigen::Matrix3d dSigma
+      = L * natural.L_chol().transpose() + natural.L_chol() * L.transpose();
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      Eigen::Matrix3d Y = Eigen::Matrix3d::Zero();
+      Y(i, j) = 1;
+      Eigen::Matrix3d dSigma_Y = L * Y.transpose() + Y * L.transpose();
+      double fisher
+          = 0.5 * (Sigma_inv * dSigma * Sigma_inv * dSigma_Y).trace();
+      EXPECT_NEAR(L_grad(i, j), fisher, 1e-8);
+    }
+  }
+}
+
+TEST(normal_fullrank_test, state) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Matrix3d L;
+  L << 1.3, 0, 0, 2.3, 1.0 / 3, 0, 3.3, -0.42, 0.92;
+  stan::variational::normal_fullrank my_normal_fullrank(mu, L);
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  my_normal_fullrank.write_state(writer);
+
+  stan::variational::normal_fullrank restored(3);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(mu, restored.mu());
+  EXPECT_EQ(L, restored.L_chol());
+
+  // A state written by another family is rejected
+  std::stringstream state_again(state.str());
+  stan::mcmc::state_reader reader_again(state_again);
+  stan::variational::normal_meanfield meanfield(3);
+  EXPECT_THROW(meanfield.read_state(reader_again), std::invalid_argument);
+}
+
+TEST(normal_fullrank_test, calc_grad_finite_diffs) {
+  Eigen::VectorXd mu(3);
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::MatrixXd L(3, 3);
+  L << 1.3, 0, 0, 2.3, 1.0 / 3, 0, 3.3, -0.42, 0.92;
+
+  correlated_normal_model model;
+  Eigen::VectorXd cont_params = mu;
+  std::stringstream log_stream;
+  stan::callbacks::stream_logger logger(log_stream, log_stream, log_stream,
+                                        log_stream, log_stream);
+  const int n_draws = 5;
+  const int seed = 4321;
+
+  // The Monte Carlo ELBO estimate with the draws calc_grad makes
+  auto elbo = [&](const stan::variational::normal_fullrank& q) {
+    boost::ecuyer1988 rng(seed);
+    Eigen::MatrixXd eta(q.dimension(), n_draws);
+    for (int j = 0; j < n_draws; ++j)
+      for (int d = 0; d < eta.rows(); ++d)
+        eta(d, j) = stan::math::normal_rng(0, 1, rng);
+    double lp = 0;
+    for (int j = 0; j < n_draws; ++j) {
+      Eigen::VectorXd zeta = q.transform(eta.col(j));
+      lp += model.log_prob<true, true>(zeta);
+    }
+    return lp / n_draws + q.entropy();
+  };
+
+  stan::variational::normal_fullrank q(mu, L);
+  stan::variational::normal_fullrank grad(3);
+  boost::ecuyer1988 rng(seed);
+  q.calc_grad(grad, model, cont_params, n_draws, rng, logger);
+
+  const double h = 1e-6;
+  for (int d = 0; d < 3; ++d) {
+    Eigen::VectorXd mu_plus = mu, mu_minus = mu;
+    mu_plus(d) += h;
+    mu_minus(d) -= h;
+    double fd = (elbo(stan::variational::normal_fullrank(mu_plus, L))
+                 - elbo(stan::variational::normal_fullrank(mu_minus, L)))
+                / (2 * h);
+    EXPECT_NEAR(fd, grad.mu()(d), 1e-5 * std::fmax(1.0, std::fabs(fd)));
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      Eigen::MatrixXd L_plus = L, L_minus = L;
+      L_plus(i, j) += h;
+      L_minus(i, j) -= h;
+      double fd = (elbo(stan::variational::normal_fullrank(mu, L_plus))
+                   - elbo(stan::variational::normal_fullrank(mu, L_minus)))
+                  / (2 * h);
+      EXPECT_NEAR(fd, grad.L_chol()(i, j),
+                  1e-5 * std::fmax(1.0, std::fabs(fd)));
+    }
+  }
+}
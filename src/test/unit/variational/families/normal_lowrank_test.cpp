@@ -0,0 +1,298 @@
+#include <stan/variational/families/normal_lowrank.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <sstream>
+#include <vector>
+#include <gtest/gtest.h>
+#include <test/unit/util.hpp>
+
+// Correlated normal target, log p(x) = -0.5 * x' * A * x + c' * x
+struct correlated_normal_model {
+  Eigen::MatrixXd A;
+  Eigen::VectorXd c;
+
+  correlated_normal_model() : A(4, 4), c(4) {
+    A << 2.0, 0.6, 0.1, 0.0, 0.6, 1.5, -0.3, 0.2, 0.1, -0.3, 1.0, 0.4, 0.0,
+        0.2, 0.4, 3.0;
+    c << 0.5, -1.0, 0.25, 2.0;
+  }
+
+  template <bool propto, bool jacobian_adjust_transform, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& x,
+             std::ostream* msgs = 0) const {
+    T lp = 0;
+    for (int i = 0; i < x.size(); ++i) {
+      lp += c(i) * x(i);
+      for (int j = 0; j < x.size(); ++j)
+        lp -= 0.5 * A(i, j) * x(i) * x(j);
+    }
+    return lp;
+  }
+};
+
+class normal_lowrank_test : public testing::Test {
+ public:
+  normal_lowrank_test() : mu(4), omega(4), B(4, 2) {
+    mu << 5.7, -3.2, 0.1332, 1.1;
+    omega << -0.42, 0.8922, 0.4, -1.3;
+    B << 1.3, 0.2, -0.7, 2.3, 0.5, -1.1, 3.3, 0.4;
+  }
+
+  Eigen::MatrixXd covariance() const {
+    Eigen::MatrixXd Sigma = B * B.transpose();
+    Sigma.diagonal() += (2 * omega).array().exp().matrix();
+    return Sigma;
+  }
+
+  Eigen::VectorXd mu, omega;
+  Eigen::MatrixXd B;
+};
+
+TEST_F(normal_lowrank_test, zero_init) {
+  stan::variational::normal_lowrank my_normal_lowrank(10, 3);
+  EXPECT_EQ(10, my_normal_lowrank.dimension());
+  EXPECT_EQ(3, my_normal_lowrank.rank());
+  EXPECT_TRUE(my_normal_lowrank.mu().isZero());
+  EXPECT_TRUE(my_normal_lowrank.omega().isZero());
+  EXPECT_EQ(10, my_normal_lowrank.B().rows());
+  EXPECT_EQ(3, my_normal_lowrank.B().cols());
+  EXPECT_TRUE(my_normal_lowrank.B().isZero());
+
+  stan::variational::normal_lowrank from_params(mu, 2);
+  EXPECT_TRUE(from_params.mu().isApprox(mu));
+  EXPECT_TRUE(from_params.omega().isZero());
+  EXPECT_TRUE(from_params.B().isZero());
+}
+
+TEST_F(normal_lowrank_test, validation) {
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  Eigen::MatrixXd B_nan = B;
+  B_nan(1, 1) = nan;
+  EXPECT_THROW(stan::variational::normal_lowrank(mu, omega, B_nan),
+               std::domain_error);
+  EXPECT_THROW(stan::variational::normal_lowrank(mu, omega, B.topRows(3)),
+               std::invalid_argument);
+
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+  EXPECT_THROW(my_normal_lowrank.set_B(B_nan), std::domain_error);
+  EXPECT_THROW(my_normal_lowrank.set_B(B.leftCols(1)), std::invalid_argument);
+
+  stan::variational::normal_lowrank other_rank(4, 3);
+  EXPECT_THROW(my_normal_lowrank += other_rank, std::invalid_argument);
+  EXPECT_THROW(my_normal_lowrank = other_rank, std::invalid_argument);
+}
+
+TEST_F(normal_lowrank_test, entropy) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+
+  double entropy_true
+      = 0.5 * 4 * (1 + stan::math::LOG_TWO_PI)
+        + 0.5 * std::log(covariance().determinant());
+
+  EXPECT_FLOAT_EQ(entropy_true, my_normal_lowrank.entropy());
+}
+
+TEST_F(normal_lowrank_test, transform) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+
+  Eigen::VectorXd eta(6);
+  eta << 7.1, -9.2, 0.59, 0.3, -1.4, 2.2;
+
+  Eigen::VectorXd x_transformed
+      = mu + B * eta.tail(2)
+        + omega.array().exp().matrix().cwiseProduct(eta.head(4));
+  Eigen::VectorXd x_result = my_normal_lowrank.transform(eta);
+  for (int i = 0; i < my_normal_lowrank.dimension(); ++i)
+    EXPECT_FLOAT_EQ(x_transformed(i), x_result(i));
+
+  EXPECT_THROW(my_normal_lowrank.transform(eta.head(4)),
+               std::invalid_argument);
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  Eigen::VectorXd eta_nan = Eigen::VectorXd::Constant(6, nan);
+  EXPECT_THROW(my_normal_lowrank.transform(eta_nan), std::domain_error);
+}
+
+TEST_F(normal_lowrank_test, sample_log_g) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+  boost::ecuyer1988 rng(1234);
+  Eigen::MatrixXd Sigma = covariance();
+
+  Eigen::VectorXd draw(4);
+  double log_g;
+  for (int n = 0; n < 10; ++n) {
+    my_normal_lowrank.sample_log_g(rng, draw, log_g);
+    Eigen::VectorXd r = draw - mu;
+    EXPECT_FLOAT_EQ(-0.5 * r.dot(Sigma.ldlt().solve(r)), log_g);
+  }
+}
+
+TEST_F(normal_lowrank_test, sample_moments) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+  boost::ecuyer1988 rng(1234);
+
+  const int n_draws = 100000;
+  Eigen::MatrixXd draws(4, n_draws);
+  Eigen::VectorXd draw(4);
+  for (int n = 0; n < n_draws; ++n) {
+    my_normal_lowrank.sample(rng, draw);
+    draws.col(n) = draw;
+  }
+  Eigen::VectorXd mean = draws.rowwise().mean();
+  draws.colwise() -= mean;
+  Eigen::MatrixXd cov = draws * draws.transpose() / (n_draws - 1);
+
+  Eigen::MatrixXd Sigma = covariance();
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NEAR(mu(i), mean(i), 0.05);
+    for (int j = 0; j < 4; ++j)
+      EXPECT_NEAR(Sigma(i, j), cov(i, j), 0.1 * Sigma.norm() / 4);
+  }
+}
+
+TEST_F(normal_lowrank_test, arithmetic) {
+  stan::variational::normal_lowrank q(mu, omega, B);
+  stan::variational::normal_lowrank sum = q + 2.0 * q;
+  EXPECT_TRUE(sum.mu().isApprox(3 * mu));
+  EXPECT_TRUE(sum.omega().isApprox(3 * omega));
+  EXPECT_TRUE(sum.B().isApprox(3 * B));
+
+  stan::variational::normal_lowrank ratio = q.square() / (1.0 + q.square());
+  EXPECT_TRUE(ratio.B().array().isApprox(
+      B.array().square() / (1 + B.array().square())));
+
+  q.set_to_zero();
+  EXPECT_TRUE(q.B().isZero());
+  EXPECT_EQ(2, q.rank());
+}
+
+TEST_F(normal_lowrank_test, sample_log_g_batch) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+  boost::ecuyer1988 rng_batch(1234);
+  boost::ecuyer1988 rng_single(1234);
+
+  Eigen::MatrixXd draws;
+  Eigen::VectorXd log_g;
+  my_normal_lowrank.sample_log_g(rng_batch, 5, draws, log_g);
+  ASSERT_EQ(4, draws.rows());
+  ASSERT_EQ(5, draws.cols());
+  ASSERT_EQ(5, log_g.size());
+
+  Eigen::VectorXd draw(4);
+  double log_g_single;
+  for (int j = 0; j < 5; ++j) {
+    my_normal_lowrank.sample_log_g(rng_single, draw, log_g_single);
+    for (int i = 0; i < 4; ++i)
+      EXPECT_FLOAT_EQ(draw(i), draws(i, j));
+    EXPECT_FLOAT_EQ(log_g_single, log_g(j));
+  }
+}
+
+TEST_F(normal_lowrank_test, natural_gradient) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+
+  Eigen::VectorXd mu_grad(4);
+  mu_grad << 0.3, -1.2, 2.5, 0.7;
+  Eigen::VectorXd omega_grad(4);
+  omega_grad << 1.1, 0.4, -0.8, 0.2;
+  Eigen::MatrixXd B_grad(4, 2);
+  B_grad << 0.5, -0.1, 0.9, 0.3, -0.6, 1.2, 0.05, -0.4;
+  stan::variational::normal_lowrank grad(mu_grad, omega_grad, B_grad);
+
+  stan::variational::normal_lowrank natural
+      = my_normal_lowrank.natural_gradient(grad);
+  EXPECT_TRUE(natural.mu().isApprox(covariance() * mu_grad));
+  EXPECT_TRUE(natural.omega().isApprox(0.5 * omega_grad));
+  EXPECT_TRUE(natural.B().isApprox(B_grad));
+
+  stan::variational::normal_lowrank other_rank(4, 3);
+  EXPECT_THROW(my_normal_lowrank.natural_gradient(other_rank),
+               std::invalid_argument);
+}
+
+TEST_F(normal_lowrank_test, state) {
+  stan::variational::normal_lowrank my_normal_lowrank(mu, omega, B);
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  my_normal_lowrank.write_state(writer);
+
+  stan::variational::normal_lowrank restored(4, 2);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(mu, restored.mu());
+  EXPECT_EQ(omega, restored.omega());
+  EXPECT_EQ(B, restored.B());
+
+  std::stringstream state_again(state.str());
+  stan::mcmc::state_reader reader_again(state_again);
+  stan::variational::normal_lowrank other_rank(4, 3);
+  EXPECT_THROW(other_rank.read_state(reader_again), std::invalid_argument);
+}
+
+TEST_F(normal_lowrank_test, random_init) {
+  Eigen::VectorXd cont_params = Eigen::VectorXd::Zero(10);
+  boost::ecuyer1988 rng(1234);
+  stan::variational::normal_lowrank my_normal_lowrank(cont_params, 3, rng);
+  EXPECT_TRUE(my_normal_lowrank.mu().isZero());
+  EXPECT_TRUE(my_normal_lowrank.omega().isZero());
+  EXPECT_EQ(10, my_normal_lowrank.B().rows());
+  EXPECT_EQ(3, my_normal_lowrank.B().cols());
+  EXPECT_FALSE(my_normal_lowrank.B().isZero());
+  EXPECT_LT(my_normal_lowrank.B().cwiseAbs().maxCoeff(), 0.1);
+}
+
+// With the standard normal draws held fixed, the gradient returned by
+// calc_grad is the exact gradient of the Monte Carlo evidence lower
+// bound, which is checked against central finite differences
+TEST_F(normal_lowrank_test, calc_grad_finite_diffs) {
+  correlated_normal_model model;
+  Eigen::VectorXd cont_params = mu;
+  std::stringstream log_stream;
+  stan::callbacks::stream_logger logger(log_stream, log_stream, log_stream,
+                                        log_stream, log_stream);
+  const int n_draws = 5;
+  const int seed = 4321;
+
+  auto elbo = [&](const stan::variational::normal_lowrank& q) {
+    boost::ecuyer1988 rng(seed);
+    Eigen::MatrixXd eta(q.eta_dimension(), n_draws);
+    for (int j = 0; j < n_draws; ++j)
+      for (int d = 0; d < eta.rows(); ++d)
+        eta(d, j) = stan::math::normal_rng(0, 1, rng);
+    double lp = 0;
+    for (int j = 0; j < n_draws; ++j) {
+      Eigen::VectorXd zeta = q.transform(eta.col(j));
+      lp += model.log_prob<true, true>(zeta);
+    }
+    return lp / n_draws + q.entropy();
+  };
+
+  stan::variational::normal_lowrank q(mu, omega, B);
+  stan::variational::normal_lowrank grad(4, 2);
+  boost::ecuyer1988 rng(seed);
+  q.calc_grad(grad, model, cont_params, n_draws, rng, logger);
+
+  const double h = 1e-6;
+  for (int d = 0; d < 4; ++d) {
+    Eigen::VectorXd omega_plus = omega, omega_minus = omega;
+    omega_plus(d) += h;
+    omega_minus(d) -= h;
+    double fd
+        = (elbo(stan::variational::normal_lowrank(mu, omega_plus, B))
+           - elbo(stan::variational::normal_lowrank(mu, omega_minus, B)))
+          / (2 * h);
+    EXPECT_NEAR(fd, grad.omega()(d), 1e-5 * std::fmax(1.0, std::fabs(fd)));
+  }
+  for (int d = 0; d < 4; ++d) {
+    for (int k = 0; k < 2; ++k) {
+      Eigen::MatrixXd B_plus = B, B_minus = B;
+      B_plus(d, k) += h;
+      B_minus(d, k) -= h;
+      double fd
+          = (elbo(stan::variational::normal_lowrank(mu, omega, B_plus))
+             - elbo(stan::variational::normal_lowrank(mu, omega, B_minus)))
+            / (2 * h);
+      EXPECT_NEAR(fd, grad.B()(d, k), 1e-5 * std::fmax(1.0, std::fabs(fd)));
+    }
+  }
+}
@@ -1,4 +1,6 @@
 #include <stan/variational/families/normal_meanfield.hpp>
+#include <boost/random/additive_combine.hpp>
+#include <sstream>
 #include <vector>
 #include <gtest/gtest.h>
 #include <test/unit/util.hpp>
@@ -153,3 +155,76 @@ TEST(normal_meanfield_test, calc_log_g) {
 
   EXPECT_FLOAT_EQ(log_g_out, log_g_true);
 }
+
+TEST(normal_meanfield_test, sample_log_g_batch) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Vector3d omega;
+  omega << -0.42, 0.8922, 1.4;
+  stan::variational::normal_meanfield my_normal_meanfield(mu, omega);
+  boost::ecuyer1988 rng_batch(1234);
+  boost::ecuyer1988 rng_single(1234);
+
+  Eigen::MatrixXd draws;
+  Eigen::VectorXd log_g;
+  my_normal_meanfield.sample_log_g(rng_batch, 5, draws, log_g);
+  ASSERT_EQ(3, draws.rows());
+  ASSERT_EQ(5, draws.cols());
+
+  Eigen::VectorXd draw(3);
+  double log_g_single;
+  for (int j = 0; j < 5; ++j) {
+    my_normal_meanfield.sample_log_g(rng_single, draw, log_g_single);
+    for (int i = 0; i < 3; ++i)
+      EXPECT_FLOAT_EQ(draw(i), draws(i, j));
+    EXPECT_FLOAT_EQ(log_g_single, log_g(j));
+  }
+}
+
+TEST(normal_meanfield_test, natural_gradient) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Vector3d omega;
+  omega << -0.42, 0.8922, 0.4;
+  stan::variational::normal_meanfield my_normal_meanfield(mu, omega);
+
+  Eigen::Vector3d mu_grad;
+  mu_grad << 0.3, -1.2, 2.5;
+  Eigen::Vector3d omega_grad;
+  omega_grad << 1.1, 0.4, -0.8;
+  stan::variational::normal_meanfield grad(mu_grad, omega_grad);
+
+  stan::variational::normal_meanfield natural
+      = my_normal_meanfield.natural_gradient(grad);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_FLOAT_EQ(std::exp(2 * omega(i)) * mu_grad(i), natural.mu()(i));
+    EXPECT_FLOAT_EQ(0.5 * omega_grad(i), natural.omega()(i));
+  }
+
+  stan::variational::normal_meanfield other(4);
+  EXPECT_THROW(my_normal_meanfield.natural_gradient(other),
+               std::invalid_argument);
+}
+
+TEST(normal_meanfield_test, state) {
+  Eigen::Vector3d mu;
+  mu << 5.7, -3.2, 0.1332;
+  Eigen::Vector3d omega;
+  omega << -0.42, 0.8922, 1.0 / 3;
+  stan::variational::normal_meanfield my_normal_meanfield(mu, omega);
+
+  std::stringstream state;
+  stan::mcmc::state_writer writer(state);
+  my_normal_meanfield.write_state(writer);
+
+  stan::variational::normal_meanfield restored(3);
+  stan::mcmc::state_reader reader(state);
+  restored.read_state(reader);
+  EXPECT_EQ(mu, restored.mu());
+  EXPECT_EQ(omega, restored.omega());
+
+  std::stringstream state_again(state.str());
+  stan::mcmc::state_reader reader_again(state_again);
+  stan::variational::normal_meanfield other(4);
+  EXPECT_THROW(other.read_state(reader_again), std::invalid_argument);
+}
@@ -0,0 +1,133 @@
+#include <stan/variational/minibatch_advi.hpp>
+#include <stan/callbacks/stream_logger.hpp>
+#include <stan/callbacks/stream_writer.hpp>
+#include <gtest/gtest.h>
+#include <boost/random/additive_combine.hpp>  // L'Ecuyer RNG
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+typedef boost::ecuyer1988 rng_t;
+
+// Normal model for the mean of the rows of y, with a standard normal
+// prior, counting the rows its log density is evaluated on
+class rows_mock_model {
+ public:
+  explicit rows_mock_model(size_t num_rows)
+      : y(num_rows), rows_evaluated(0) {
+    for (size_t i = 0; i < num_rows; ++i)
+      y(i) = 2 + 0.5 * std::sin(static_cast<double>(i));
+  }
+
+  size_t num_params_r() const { return 1; }
+
+  size_t num_rows() const { return y.size(); }
+
+  double posterior_mean() const { return y.sum() / (y.size() + 1); }
+
+  template <bool propto, bool jacobian_adjust_transforms, typename T>
+  T log_prob(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+             std::ostream* output_stream = 0) const {
+    std::vector<size_t> rows(y.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+      rows[i] = i;
+    return log_prob_rows<propto, jacobian_adjust_transforms>(params_r, rows,
+                                                             output_stream);
+  }
+
+  template <bool propto, bool jacobian_adjust_transforms, typename T>
+  T log_prob_rows(Eigen::Matrix<T, Eigen::Dynamic, 1>& params_r,
+                  const std::vector<size_t>& rows,
+                  std::ostream* output_stream = 0) const {
+    rows_evaluated += rows.size();
+    T lp = -0.5 * params_r(0) * params_r(0);
+    T ll = 0;
+    for (size_t i : rows)
+      ll += -0.5 * (y(i) - params_r(0)) * (y(i) - params_r(0));
+    return lp + static_cast<double>(y.size()) / rows.size() * ll;
+  }
+
+  Eigen::VectorXd y;
+  mutable std::atomic<size_t> rows_evaluated;
+};
+
+class minibatch_advi_test : public testing::Test {
+ public:
+  minibatch_advi_test()
+      : model(1000),
+        base_rng(0),
+        logger(log_stream, log_stream, log_stream, log_stream, log_stream),
+        diagnostic_writer(diagnostic_stream),
+        cont_params(Eigen::VectorXd::Zero(1)) {}
+
+  rows_mock_model model;
+  rng_t base_rng;
+  std::stringstream log_stream;
+  stan::callbacks::stream_logger logger;
+  std::stringstream diagnostic_stream;
+  stan::callbacks::stream_writer diagnostic_writer;
+  Eigen::VectorXd cont_params;
+};
+
+typedef stan::variational::minibatch_advi<
+    rows_mock_model, stan::variational::normal_meanfield, rng_t>
+    minibatch_advi_t;
+
+TEST_F(minibatch_advi_test, draw_rows) {
+  minibatch_advi_t test_advi(model, cont_params, base_rng, 50, 1, 100, 100,
+                             1);
+  EXPECT_EQ(50, test_advi.batch_size());
+  for (int n = 0; n < 20; ++n) {
+    std::vector<size_t> rows = test_advi.draw_rows(base_rng);
+    ASSERT_EQ(50, rows.size());
+    EXPECT_LT(rows.back(), 1000);
+    for (size_t i = 1; i < rows.size(); ++i)
+      EXPECT_LT(rows[i - 1], rows[i]);
+  }
+
+  minibatch_advi_t all_advi(model, cont_params, base_rng, 5000, 1, 100, 100,
+                            1);
+  EXPECT_EQ(1000, all_advi.batch_size());
+  std::vector<size_t> rows = all_advi.draw_rows(base_rng);
+  for (size_t i = 0; i < rows.size(); ++i)
+    EXPECT_EQ(i, rows[i]);
+}
+
+TEST_F(minibatch_advi_test, invalid_batch_size) {
+  EXPECT_THROW(minibatch_advi_t(model, cont_params, base_rng, 0, 1, 100, 100,
+                                1),
+               std::domain_error);
+  rows_mock_model no_rows(0);
+  EXPECT_THROW(minibatch_advi_t(no_rows, cont_params, base_rng, 10, 1, 100,
+                                100, 1),
+               std::domain_error);
+}
+
+TEST_F(minibatch_advi_test, gradient_uses_batch) {
+  minibatch_advi_t test_advi(model, cont_params, base_rng, 50, 3, 100, 100,
+                             1);
+  stan::variational::normal_meanfield q(cont_params);
+  stan::variational::normal_meanfield grad(1);
+  model.rows_evaluated = 0;
+  test_advi.calc_ELBO_grad(q, grad, logger);
+  EXPECT_EQ(3 * 50, model.rows_evaluated);
+
+  // The batch estimate is unbiased for the full data gradient
+  const int n_gradients = 2000;
+  double mu_grad = 0;
+  for (int n = 0; n < n_gradients; ++n) {
+    test_advi.calc_ELBO_grad(q, grad, logger);
+    mu_grad += grad.mu()(0) / n_gradients;
+  }
+  double mu_grad_true = model.y.sum();
+  EXPECT_NEAR(mu_grad_true, mu_grad, 0.01 * mu_grad_true);
+}
+
+TEST_F(minibatch_advi_test, stochastic_gradient_ascent) {
+  minibatch_advi_t test_advi(model, cont_params, base_rng, 50, 1, 100, 100,
+                             1);
+  stan::variational::normal_meanfield q(cont_params);
+  test_advi.stochastic_gradient_ascent(q, 0.1, 0.001, 2000, logger,
+                                       diagnostic_writer);
+  EXPECT_NEAR(model.posterior_mean(), q.mu()(0), 0.05);
+}